@@ -652,7 +652,15 @@ STATUS process_all_client_messages(asd_state* state,
         for (int i = 0; i < num_fds; i++)
         {
             struct pollfd poll_fd = poll_fds[i];
-            if ((poll_fd.revents & POLLIN) == POLLIN)
+            bool b_data_pending = false;
+            extnet_conn_t* p_extconn =
+                session_lookup_conn(state->session, poll_fd.fd);
+
+            // data already buffered for the connection doesn't raise POLLIN
+            if (p_extconn)
+                session_get_data_pending(state->session, p_extconn,
+                                         &b_data_pending);
+            if ((poll_fd.revents & POLLIN) == POLLIN || b_data_pending)
             {
                 STATUS client_result = process_client_message(state, poll_fd);
 
@@ -1385,6 +1385,14 @@ STATUS process_jtag_message(ASD_MSG* state, struct asd_message* s_message)
         }
     }
 
+    // A TAP move held back for a shift that never came goes out now.
+    if (JTAG_flush(state->jtag_handler) != ST_OK)
+    {
+        ASD_log(ASD_LogLevel_Error, ASD_LogStream_SDK, ASD_LogOption_None,
+                "JTAG_flush failed");
+        status = ST_ERR;
+    }
+
     if (status == ST_OK)
     {
         if (memcpy_s(&state->out_msg.header, sizeof(struct message_header),
@@ -1923,9 +1931,6 @@ int get_message_size(struct asd_message* s_message)
 
 STATUS send_response(ASD_MSG* state, struct asd_message* message)
 {
-    unsigned char send_buffer[MAX_PACKET_SIZE];
-    size_t send_buffer_size = 0;
-
     if (!state || !message)
         return ST_ERR;
 
@@ -1956,24 +1961,11 @@ STATUS send_response(ASD_MSG* state, struct asd_message* message)
                    "NetRsp");
 #endif
 
-    send_buffer_size = sizeof(struct message_header) + size;
-
-    if (memcpy_s(&send_buffer, MAX_PACKET_SIZE,
-                 (unsigned char*)&message->header, sizeof(message->header)))
-    {
-        ASD_log(ASD_LogLevel_Error, ASD_LogStream_JTAG, ASD_LogOption_None,
-                "memcpy_s: message header to send_buffer copy failed.");
-    }
-    if (memcpy_s(&send_buffer[sizeof(message->header)],
-                 MAX_PACKET_SIZE - sizeof(message->header), message->buffer,
-                 (size_t)size))
-    {
-        ASD_log(ASD_LogLevel_Error, ASD_LogStream_JTAG, ASD_LogOption_None,
-                "memcpy_s: message buffer to send buffer offset copy failed.");
-    }
-
-    return state->send_function(state->callback_state, send_buffer,
-                                send_buffer_size);
+    // struct asd_message is packed, the payload directly follows the header:
+    // send it in place rather than copying it to a packet buffer first.
+    return state->send_function(state->callback_state,
+                                (unsigned char*)message,
+                                sizeof(struct message_header) + size);
 }
 
 STATUS asd_msg_get_fds(ASD_MSG* state, target_fdarr_t* fds, int* num_fds)
@@ -32,9 +32,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ext_tcp.h"
 
+#include <errno.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
 
 #include "asd_common.h"
 #include "logging.h"
@@ -44,6 +48,37 @@ extnet_hdlrs_t tcp_hdlrs = {
     exttcp_recv, exttcp_send,      exttcp_cleanup,
 };
 
+// Receive buffers of the connections. A single recv() fills the buffer with
+// as much as the socket has, so the header and the payload of a message (and
+// often the next messages) are read with one system call.
+#define EXTTCP_RX_POOL_SIZE 8
+#define EXTTCP_RX_BUF_SIZE (2 * MAX_PACKET_SIZE)
+
+typedef struct
+{
+    bool b_in_use;
+    size_t head;
+    size_t tail;
+    unsigned char data[EXTTCP_RX_BUF_SIZE];
+} exttcp_rxbuf_t;
+
+static exttcp_rxbuf_t rx_pool[EXTTCP_RX_POOL_SIZE];
+
+static exttcp_rxbuf_t* exttcp_rxbuf_get(void)
+{
+    for (int i = 0; i < EXTTCP_RX_POOL_SIZE; i++)
+    {
+        if (!rx_pool[i].b_in_use)
+        {
+            rx_pool[i].b_in_use = true;
+            rx_pool[i].head = 0;
+            rx_pool[i].tail = 0;
+            return &rx_pool[i];
+        }
+    }
+    return NULL;
+}
+
 /** @brief Initialize TCP
  *
  *  Called to initialize External Network Interface
@@ -72,8 +107,25 @@ void exttcp_cleanup(void)
  */
 STATUS exttcp_on_accept(void* net_state, extnet_conn_t* pconn)
 {
+    int n_delay = 1;
     (void)net_state;
-    (void)pconn;
+
+    if (!pconn)
+        return ST_ERR;
+
+    // Responses are small and latency bound, don't let Nagle hold them back
+    // whether or not the accepted socket inherited it from the listener.
+    if (setsockopt(pconn->sockfd, IPPROTO_TCP, TCP_NODELAY, &n_delay,
+                   sizeof(n_delay)) < 0)
+    {
+        ASD_log(ASD_LogLevel_Warning, ASD_LogStream_Network,
+                ASD_LogOption_None,
+                "setsockopt(TCP_NODELAY) failed on fd %d errno: %d",
+                pconn->sockfd, errno);
+    }
+
+    // Without a free buffer the connection reads straight from the socket.
+    pconn->p_hdlr_data = exttcp_rxbuf_get();
     return ST_OK;
 }
 
@@ -99,13 +151,23 @@ STATUS exttcp_init_client(extnet_conn_t* pconn)
  */
 STATUS exttcp_on_close_client(extnet_conn_t* pconn)
 {
-    (void)pconn;
+    exttcp_rxbuf_t* p_rx = NULL;
+
+    if (pconn)
+    {
+        p_rx = (exttcp_rxbuf_t*)pconn->p_hdlr_data;
+        if (p_rx)
+            p_rx->b_in_use = false;
+        pconn->p_hdlr_data = NULL;
+    }
     return ST_OK;
 }
 
 /** @brief Read data from external network connection
  *
- *  Called each time data is available on the external socket.
+ *  Called each time data is available on the external socket. The data is
+ *  served from the receive buffer of the connection, which is refilled by one
+ *  recv() when empty; b_data_pending tells if more of it is buffered.
  *
  *  @param [in] pconn Connetion pointer
  *  @param [out] pv_buf Buffer where data will be stored.
@@ -133,21 +195,45 @@ int exttcp_recv(extnet_conn_t* pconn, void* pv_buf, size_t sz_len,
                 "%s called with invalid file descriptor %d", __FUNCTION__,
                 pconn->sockfd);
     }
-    else
+    else if (!pconn->p_hdlr_data)
     {
         n_read = (int)recv(pconn->sockfd, pv_buf, sz_len, 0);
     }
+    else
+    {
+        exttcp_rxbuf_t* p_rx = (exttcp_rxbuf_t*)pconn->p_hdlr_data;
+        if (p_rx->head == p_rx->tail)
+        {
+            p_rx->head = 0;
+            p_rx->tail = 0;
+            n_read = (int)recv(pconn->sockfd, p_rx->data, sizeof(p_rx->data),
+                               0);
+            if (n_read > 0)
+                p_rx->tail = (size_t)n_read;
+        }
+        if (p_rx->tail > p_rx->head)
+        {
+            size_t n_avail = p_rx->tail - p_rx->head;
+            if (sz_len > n_avail)
+                sz_len = n_avail;
+            memcpy(pv_buf, &p_rx->data[p_rx->head], sz_len);
+            p_rx->head += sz_len;
+            n_read = (int)sz_len;
+            *b_data_pending = p_rx->head < p_rx->tail;
+        }
+    }
     return n_read;
 }
 
 /** @brief Write data to external network connection
  *
- *  Called each time data is available on the external socket.
+ *  Called each time data is available on the external socket. A partial
+ *  write is continued until the whole buffer is sent.
  *
  *  @param [in] pconn Connetion pointer
  *  @param [out] pv_buf Buffer where data will be stored.
  *  @param [in] sz_len sizeof pv_buf
- *  @return number of bytes received.
+ *  @return number of bytes sent.
  */
 int exttcp_send(extnet_conn_t* pconn, void* pv_buf, size_t sz_len)
 {
@@ -171,7 +257,18 @@ int exttcp_send(extnet_conn_t* pconn, void* pv_buf, size_t sz_len)
     }
     else
     {
-        n_wr = (int)send(pconn->sockfd, pv_buf, sz_len, 0);
+        size_t sz_sent = 0;
+        while (sz_sent < sz_len)
+        {
+            ssize_t n = send(pconn->sockfd, (unsigned char*)pv_buf + sz_sent,
+                             sz_len - sz_sent, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            sz_sent += (size_t)n;
+        }
+        n_wr = sz_sent == sz_len ? (int)sz_len : -1;
     }
     return n_wr;
 }
@@ -55,7 +55,8 @@ static const ASD_LogOption option = ASD_LogOption_None;
 bool i2c_enabled(I2C_Handler* state);
 STATUS i2c_open_driver(I2C_Handler* state, uint8_t bus);
 void i2c_close_driver(I2C_Handler* state);
-bool i2c_bus_allowed(I2C_Handler* state, uint8_t bus);
+int i2c_bus_index(I2C_Handler* state, uint8_t bus);
+int i2c_bus_handle(I2C_Handler* state, uint8_t bus);
 
 I2C_Handler* I2CHandler(bus_config* config)
 {
@@ -74,7 +75,10 @@ I2C_Handler* I2CHandler(bus_config* config)
     }
     else
     {
+        state->i2c_bus = 0;
         state->i2c_driver_handle = UNINITIALIZED_I2C_DRIVER_HANDLE;
+        for (int i = 0; i < MAX_IxC_BUSES; i++)
+            state->bus_handles[i] = UNINITIALIZED_I2C_DRIVER_HANDLE;
         state->config = config;
     }
 
@@ -105,7 +109,10 @@ STATUS i2c_bus_flock(I2C_Handler* state, uint8_t bus, int op)
     STATUS status = ST_OK;
     ASD_log(ASD_LogLevel_Debug, ASD_LogStream_I2C, ASD_LogOption_None,
             "i2c - bus %d %s", bus, op == LOCK_EX ? "LOCK" : "UNLOCK");
-    if (flock(state->i2c_driver_handle, op) != 0)
+    // The lock is taken on the handle of the bus itself, which may not be
+    // the selected one yet: bus select locks the new bus before switching.
+    int handle = i2c_bus_handle(state, bus);
+    if (handle == UNINITIALIZED_I2C_DRIVER_HANDLE || flock(handle, op) != 0)
     {
         ASD_log(ASD_LogLevel_Debug, ASD_LogStream_I2C, ASD_LogOption_None,
                 "i2c flock for bus %d failed", bus);
@@ -119,16 +126,23 @@ STATUS i2c_bus_select(I2C_Handler* state, uint8_t bus)
     STATUS status = ST_ERR;
     if (state != NULL && i2c_enabled(state))
     {
-        if (bus == state->i2c_bus)
+        if (bus == state->i2c_bus &&
+            state->i2c_driver_handle != UNINITIALIZED_I2C_DRIVER_HANDLE)
         {
             status = ST_OK;
         }
-        else if (i2c_bus_allowed(state, bus))
+        else if (i2c_bus_index(state, bus) >= 0)
         {
-            i2c_close_driver(state);
             ASD_log(ASD_LogLevel_Error, stream, option, "Selecting Bus %d",
                     bus);
-            status = i2c_open_driver(state, bus);
+            int handle = i2c_bus_handle(state, bus);
+            if (handle != UNINITIALIZED_I2C_DRIVER_HANDLE)
+            {
+                state->i2c_driver_handle = handle;
+                state->i2c_bus = bus;
+                state->config->default_bus = bus;
+                status = ST_OK;
+            }
         }
         else
         {
@@ -175,35 +189,51 @@ bool i2c_enabled(I2C_Handler* state)
 STATUS i2c_open_driver(I2C_Handler* state, uint8_t bus)
 {
     char i2c_dev[MAX_I2C_DEV_FILENAME];
+    int index = i2c_bus_index(state, bus);
+    if (index < 0)
+        return ST_ERR;
     snprintf(i2c_dev, sizeof(i2c_dev), "%s-%d", I2C_DEV_FILE_NAME, bus);
-    state->i2c_driver_handle = open(i2c_dev, O_RDWR);
-    if (state->i2c_driver_handle == -1)
+    state->bus_handles[index] = open(i2c_dev, O_RDWR);
+    if (state->bus_handles[index] == -1)
     {
+        state->bus_handles[index] = UNINITIALIZED_I2C_DRIVER_HANDLE;
         ASD_log(ASD_LogLevel_Error, stream, option,
                 "Can't open %s, please install driver", i2c_dev);
         return ST_ERR;
     }
-    state->i2c_bus = bus;
-    state->config->default_bus = bus;
     return ST_OK;
 }
 
 void i2c_close_driver(I2C_Handler* state)
 {
-    if (state->i2c_driver_handle != UNINITIALIZED_I2C_DRIVER_HANDLE)
+    for (int i = 0; i < MAX_IxC_BUSES; i++)
     {
-        close(state->i2c_driver_handle);
-        state->i2c_driver_handle = UNINITIALIZED_I2C_DRIVER_HANDLE;
+        if (state->bus_handles[i] != UNINITIALIZED_I2C_DRIVER_HANDLE)
+        {
+            close(state->bus_handles[i]);
+            state->bus_handles[i] = UNINITIALIZED_I2C_DRIVER_HANDLE;
+        }
     }
+    state->i2c_driver_handle = UNINITIALIZED_I2C_DRIVER_HANDLE;
 }
 
-bool i2c_bus_allowed(I2C_Handler* state, uint8_t bus)
+int i2c_bus_index(I2C_Handler* state, uint8_t bus)
 {
     for (int i = 0; i < MAX_IxC_BUSES; i++)
     {
         if (state->config->bus_config_map[i] == bus &&
             state->config->bus_config_type[i] == BUS_CONFIG_I2C)
-            return true;
+            return i;
     }
-    return false;
-}
\ No newline at end of file
+    return -1;
+}
+
+int i2c_bus_handle(I2C_Handler* state, uint8_t bus)
+{
+    int index = i2c_bus_index(state, bus);
+    if (index < 0)
+        return UNINITIALIZED_I2C_DRIVER_HANDLE;
+    if (state->bus_handles[index] == UNINITIALIZED_I2C_DRIVER_HANDLE)
+        i2c_open_driver(state, bus);
+    return state->bus_handles[index];
+}
@@ -37,6 +37,9 @@ typedef struct I2C_Handler
     uint8_t i2c_bus;
     bus_config* config;
     int i2c_driver_handle;
+    // Handles of the allowed buses, by bus_config_map index. Opened on
+    // first use and kept for the session, a bus switch just picks one.
+    int bus_handles[MAX_IxC_BUSES];
 } I2C_Handler;
 
 I2C_Handler* I2CHandler(bus_config* config);
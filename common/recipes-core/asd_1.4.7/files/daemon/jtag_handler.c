@@ -34,6 +34,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 // clang-format off
 #include <safe_mem_lib.h>
@@ -56,6 +57,14 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
                      enum jtag_states current_tap_state,
                      enum jtag_states end_tap_state);
 
+static uint64_t jtag_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 void initialize_jtag_chains(JTAG_Handler* state)
 {
     for (int i = 0; i < MAX_SCAN_CHAINS; i++)
@@ -83,6 +92,8 @@ JTAG_Handler* JTAGHandler()
     memset_s(state->padDataOne, sizeof(state->padDataOne), ~0,
              sizeof(state->padDataOne));
     explicit_bzero(state->padDataZero, sizeof(state->padDataZero));
+    state->tap_move_pending = false;
+    explicit_bzero(&state->stats, sizeof(state->stats));
     state->JTAG_driver_handle = -1;
 
     for (unsigned int i = 0; i < MAX_WAIT_CYCLES; i++)
@@ -122,6 +133,9 @@ STATUS JTAG_initialize(JTAG_Handler* state, bool sw_mode)
         return ST_ERR;
 
     state->sw_mode = (state->force_jtag_hw) ? false : sw_mode;
+    state->tap_move_pending = false;
+    explicit_bzero(&state->stats, sizeof(state->stats));
+    state->stats.start_ms = jtag_now_ms();
     ASD_log(ASD_LogLevel_Info, stream, option, "JTAG mode set to '%s'.",
             state->sw_mode ? "software" : "hardware");
 
@@ -165,9 +179,29 @@ STATUS JTAG_initialize(JTAG_Handler* state, bool sw_mode)
 
 STATUS JTAG_deinitialize(JTAG_Handler* state)
 {
+    JTAG_Stats* stats;
+    uint64_t elapsed_ms;
+
     if (state == NULL)
         return ST_ERR;
 
+    if (state->JTAG_driver_handle != -1)
+    {
+        stats = &state->stats;
+        elapsed_ms = jtag_now_ms() - stats->start_ms;
+        ASD_log(ASD_LogLevel_Info, stream, option,
+                "JTAG session: %llu shifts, %llu tap moves, %llu bits, "
+                "%llu ioctls (%llu saved), %llu bits/s",
+                (unsigned long long)stats->shifts,
+                (unsigned long long)stats->tap_moves,
+                (unsigned long long)stats->bits,
+                (unsigned long long)stats->ioctls,
+                (unsigned long long)stats->ioctls_saved,
+                elapsed_ms ? (unsigned long long)(stats->bits * 1000 /
+                                                  elapsed_ms)
+                           : 0ULL);
+    }
+    state->tap_move_pending = false;
     close(state->JTAG_driver_handle);
     state->JTAG_driver_handle = -1;
 
@@ -229,13 +263,18 @@ STATUS JTAG_tap_reset(JTAG_Handler* state)
     return JTAG_set_tap_state(state, jtag_tlr);
 }
 
-//
-// Request the TAP to go to the target state
-//
-STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
+static void log_tap_state(enum jtag_states tap_state)
+{
+    ASD_log(ASD_LogLevel_Info, stream, option, "Goto state: %s (%d)",
+            tap_state >=
+                    (sizeof(JtagStatesString) / sizeof(JtagStatesString[0]))
+                ? "Unknown"
+                : JtagStatesString[tap_state],
+            tap_state);
+}
+
+static STATUS goto_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
 {
-    if (state == NULL)
-        return ST_ERR;
 #ifdef JTAG_LEGACY_DRIVER
     struct tap_state_param params;
     params.mode = state->sw_mode ? SW_MODE : HW_MODE;
@@ -250,6 +289,7 @@ STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
     tap_state_t.tck = 1;
 #endif
 
+    state->stats.ioctls++;
 #ifdef JTAG_LEGACY_DRIVER
     if (ioctl(state->JTAG_driver_handle, AST_JTAG_SET_TAPSTATE, &params)
 #else
@@ -263,17 +303,87 @@ STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
     }
 
     state->active_chain->tap_state = tap_state;
+    return ST_OK;
+}
+
+//
+// A move from RTI or Pause into Shift-IR/DR is held back: the driver
+// moves the TAP into the shift state at the start of a scan, so the move
+// is dropped when the next operation is a shift, and only sent to the
+// driver by JTAG_flush() otherwise.
+//
+static bool can_defer_tap_move(JTAG_Handler* state,
+                               enum jtag_states tap_state)
+{
+#ifdef JTAG_LEGACY_DRIVER
+    return false;
+#else
+    enum jtag_states current = state->active_chain->tap_state;
+
+    if (tap_state != jtag_shf_dr && tap_state != jtag_shf_ir)
+        return false;
+    return current == jtag_rti || current == jtag_pau_dr ||
+           current == jtag_pau_ir;
+#endif
+}
+
+//
+// Send the held back TAP move, if any, to the driver
+//
+STATUS JTAG_flush(JTAG_Handler* state)
+{
+    enum jtag_states tap_state;
+
+    if (state == NULL)
+        return ST_ERR;
+    if (!state->tap_move_pending)
+        return ST_OK;
+
+    state->tap_move_pending = false;
+    tap_state = state->active_chain->tap_state;
+    // The driver is still in the state the move started from.
+    state->active_chain->tap_state = state->pending_from_state;
+    return goto_tap_state(state, tap_state);
+}
+
+// A shift performs the held back move into its shift state.
+static void take_tap_move(JTAG_Handler* state)
+{
+    if (state->tap_move_pending)
+    {
+        state->tap_move_pending = false;
+        state->stats.ioctls_saved++;
+    }
+}
+
+//
+// Request the TAP to go to the target state
+//
+STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state)
+{
+    if (state == NULL)
+        return ST_ERR;
+
+    state->stats.tap_moves++;
+    if (!state->tap_move_pending && can_defer_tap_move(state, tap_state))
+    {
+        state->tap_move_pending = true;
+        state->pending_from_state = state->active_chain->tap_state;
+        state->active_chain->tap_state = tap_state;
+        log_tap_state(tap_state);
+        return ST_OK;
+    }
+
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
+    if (goto_tap_state(state, tap_state) != ST_OK)
+        return ST_ERR;
 
     if ((tap_state == jtag_rti) || (tap_state == jtag_pau_dr))
         if (JTAG_wait_cycles(state, 5) != ST_OK)
             return ST_ERR;
 
-    ASD_log(ASD_LogLevel_Info, stream, option, "Goto state: %s (%d)",
-            tap_state >=
-                    (sizeof(JtagStatesString) / sizeof(JtagStatesString[0]))
-                ? "Unknown"
-                : JtagStatesString[tap_state],
-            tap_state);
+    log_tap_state(tap_state);
     return ST_OK;
 }
 
@@ -288,6 +398,73 @@ STATUS JTAG_get_tap_state(JTAG_Handler* state, enum jtag_states* tap_state)
     return ST_OK;
 }
 
+//
+// Shift the pre padding, the data and the post padding of a software mode
+// shift in one scan: the TAP stays in the shift state between them, so
+// the bits on the wire are the same as with three scans.
+//
+static STATUS perform_padded_shift(JTAG_Handler* state, unsigned int pre,
+                                   unsigned int post, unsigned char pad_value,
+                                   unsigned int number_of_bits,
+                                   unsigned int input_bytes,
+                                   unsigned char* input,
+                                   unsigned int output_bytes,
+                                   unsigned char* output,
+                                   enum jtag_states current_tap_state,
+                                   enum jtag_states end_tap_state)
+{
+    unsigned int total_bits = pre + number_of_bits + post;
+    unsigned int total_bytes = DIV_ROUND_UP(total_bits, BITS_PER_BYTE);
+    unsigned int i, bit, pos;
+
+    if (total_bytes > sizeof(state->shift_tdi))
+    {
+        ASD_log(ASD_LogLevel_Error, stream, option,
+                "Shift of %u bits with padding is too long", number_of_bits);
+        return ST_ERR;
+    }
+
+    memset(state->shift_tdi, pad_value ? 0xff : 0, total_bytes);
+    for (i = 0; i < number_of_bits; i++)
+    {
+        bit = 0;
+        if (input != NULL && i / BITS_PER_BYTE < input_bytes)
+            bit = (input[i / BITS_PER_BYTE] >> (i % BITS_PER_BYTE)) & 1;
+        pos = pre + i;
+        if (bit)
+            state->shift_tdi[pos / BITS_PER_BYTE] |=
+                (unsigned char)(1 << (pos % BITS_PER_BYTE));
+        else
+            state->shift_tdi[pos / BITS_PER_BYTE] &=
+                (unsigned char)~(1 << (pos % BITS_PER_BYTE));
+    }
+
+    if (perform_shift(state, total_bits, total_bytes, state->shift_tdi,
+                      total_bytes, state->shift_tdo, current_tap_state,
+                      end_tap_state) != ST_OK)
+        return ST_ERR;
+    state->stats.ioctls_saved += (pre ? 1 : 0) + (post ? 1 : 0);
+
+    if (output != NULL)
+    {
+        for (i = 0; i < number_of_bits && i / BITS_PER_BYTE < output_bytes;
+             i++)
+        {
+            pos = pre + i;
+            bit = (state->shift_tdo[pos / BITS_PER_BYTE] >>
+                   (pos % BITS_PER_BYTE)) &
+                  1;
+            if (bit)
+                output[i / BITS_PER_BYTE] |=
+                    (unsigned char)(1 << (i % BITS_PER_BYTE));
+            else
+                output[i / BITS_PER_BYTE] &=
+                    (unsigned char)~(1 << (i % BITS_PER_BYTE));
+        }
+    }
+    return ST_OK;
+}
+
 //
 //  Optionally write and read the requested number of
 //  bits and go to the requested target state
@@ -300,6 +477,10 @@ STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
     if (state == NULL)
         return ST_ERR;
 
+    take_tap_move(state);
+    state->stats.shifts++;
+    state->stats.bits += number_of_bits;
+
 #ifndef JTAG_LEGACY_DRIVER
     if (!state->sw_mode && !state->force_jtag_hw)
         return JTAG_shift_hw(state, number_of_bits, input_bytes, input,
@@ -308,7 +489,7 @@ STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
 
     unsigned int preFix = 0;
     unsigned int postFix = 0;
-    unsigned char* padData = NULL;
+    unsigned char padValue = 0;
     enum jtag_states current_state;
     JTAG_get_tap_state(state, &current_state);
 
@@ -316,13 +497,13 @@ STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
     {
         preFix = state->active_chain->shift_padding.irPre;
         postFix = state->active_chain->shift_padding.irPost;
-        padData = state->padDataOne;
+        padValue = 1;
     }
     else if (current_state == jtag_shf_dr)
     {
         preFix = state->active_chain->shift_padding.drPre;
         postFix = state->active_chain->shift_padding.drPost;
-        padData = state->padDataZero;
+        padValue = 0;
     }
     else
     {
@@ -331,40 +512,25 @@ STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
         return ST_ERR;
     }
 
+    // The pre padding starts a scan, the post padding ends it.
     if (state->active_chain->scan_state == JTAGScanState_Done)
-    {
         state->active_chain->scan_state = JTAGScanState_Run;
-        if (preFix)
-        {
-            if (perform_shift(state, preFix, IRMAXPADSIZE / 8, padData, 0, NULL,
-                              current_state, current_state) != ST_OK)
-                return ST_ERR;
-        }
-    }
+    else
+        preFix = 0;
 
-    if ((postFix) && (current_state != end_tap_state))
-    {
+    if (current_state != end_tap_state)
         state->active_chain->scan_state = JTAGScanState_Done;
-        if (perform_shift(state, number_of_bits, input_bytes, input,
-                          output_bytes, output, current_state,
-                          current_state) != ST_OK)
-            return ST_ERR;
-        if (perform_shift(state, postFix, IRMAXPADSIZE / 8, padData, 0, NULL,
-                          current_state, end_tap_state) != ST_OK)
-            return ST_ERR;
-    }
     else
-    {
-        if (perform_shift(state, number_of_bits, input_bytes, input,
-                          output_bytes, output, current_state,
-                          end_tap_state) != ST_OK)
-            return ST_ERR;
-        if (current_state != end_tap_state)
-        {
-            state->active_chain->scan_state = JTAGScanState_Done;
-        }
-    }
-    return ST_OK;
+        postFix = 0;
+
+    if (preFix || postFix)
+        return perform_padded_shift(state, preFix, postFix, padValue,
+                                    number_of_bits, input_bytes, input,
+                                    output_bytes, output, current_state,
+                                    end_tap_state);
+
+    return perform_shift(state, number_of_bits, input_bytes, input,
+                         output_bytes, output, current_state, end_tap_state);
 }
 
 STATUS JTAG_shift_hw(JTAG_Handler* state, unsigned int number_of_bits,
@@ -380,6 +546,7 @@ STATUS JTAG_shift_hw(JTAG_Handler* state, unsigned int number_of_bits,
     if (state == NULL)
         return ST_ERR;
 
+    take_tap_move(state);
     JTAG_get_tap_state(state, &current_state);
 
     padding.int_value = 0;
@@ -449,6 +616,7 @@ STATUS JTAG_shift_hw(JTAG_Handler* state, unsigned int number_of_bits,
         }
         xfer.tdio = (__u64)(uintptr_t)tdio;
     }
+    state->stats.ioctls++;
     if (ioctl(state->JTAG_driver_handle, JTAG_IOCXFER, &xfer) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
@@ -500,6 +668,7 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
     scan_xfer.tdo = output;
     scan_xfer.end_tap_state = end_tap_state;
 
+    state->stats.ioctls++;
     if (ioctl(state->JTAG_driver_handle, AST_JTAG_READWRITESCAN, &scan_xfer) <
         0)
     {
@@ -538,6 +707,7 @@ STATUS perform_shift(JTAG_Handler* state, unsigned int number_of_bits,
         }
         xfer.tdio = (__u64)(uintptr_t)tdio;
     }
+    state->stats.ioctls++;
     if (ioctl(state->JTAG_driver_handle, JTAG_IOCXFER, &xfer) < 0)
     {
         ASD_log(ASD_LogLevel_Error, stream, option,
@@ -575,10 +745,13 @@ STATUS JTAG_wait_cycles(JTAG_Handler* state, unsigned int number_of_cycles)
 #ifdef JTAG_LEGACY_DRIVER
     if (state == NULL)
         return ST_ERR;
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
     if (state->sw_mode)
     {
         for (unsigned int i = 0; i < number_of_cycles; i++)
         {
+            state->stats.ioctls++;
             if (JTAG_clock_cycle(state->JTAG_driver_handle, 0, 0) != ST_OK)
                 return ST_ERR;
         }
@@ -590,6 +763,9 @@ STATUS JTAG_wait_cycles(JTAG_Handler* state, unsigned int number_of_cycles)
     if (number_of_cycles > MAX_WAIT_CYCLES)
         return ST_ERR;
 
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
+
     // Execute wait cycles in SW and HW mode
     ASD_log(ASD_LogLevel_Debug, stream, option, "Wait %d cycles",
             number_of_cycles);
@@ -598,6 +774,7 @@ STATUS JTAG_wait_cycles(JTAG_Handler* state, unsigned int number_of_cycles)
     {
         for (unsigned int i = 0; i < number_of_cycles; i++)
         {
+            state->stats.ioctls++;
             if (ioctl(state->JTAG_driver_handle, JTAG_IOCBITBANG, &state->bitbang_data[i]) < 0)
             {
                 ASD_log(ASD_LogLevel_Error, stream, option,
@@ -614,6 +791,8 @@ STATUS JTAG_set_jtag_tck(JTAG_Handler* state, unsigned int tck)
 {
     if (state == NULL)
         return ST_ERR;
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
 #ifdef JTAG_LEGACY_DRIVER
     struct set_tck_param params;
     params.mode = state->sw_mode ? SW_MODE : HW_MODE;
@@ -649,6 +828,9 @@ STATUS JTAG_set_active_chain(JTAG_Handler* state, scanChain chain)
         return ST_ERR;
     }
 
+    if (JTAG_flush(state) != ST_OK)
+        return ST_ERR;
+
     state->active_chain = &state->chains[chain];
 
     return ST_OK;
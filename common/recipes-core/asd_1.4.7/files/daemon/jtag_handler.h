@@ -114,6 +114,17 @@ typedef struct JTAG_Chain_State
     JTAGScanState scan_state;
 } JTAG_Chain_State;
 
+// Per session counters of the JTAG operations and of the driver calls
+typedef struct JTAG_Stats
+{
+    uint64_t shifts;
+    uint64_t tap_moves;
+    uint64_t bits;
+    uint64_t ioctls;
+    uint64_t ioctls_saved;
+    uint64_t start_ms;
+} JTAG_Stats;
+
 typedef enum {
     JFLOW_BMC = 1,
     JFLOW_BIC = 2
@@ -126,6 +137,13 @@ typedef struct JTAG_Handler
     unsigned char padDataOne[IRMAXPADSIZE / 8];
     unsigned char padDataZero[IRMAXPADSIZE / 8];
     struct tck_bitbang bitbang_data[MAX_WAIT_CYCLES];
+    // pre padding, data and post padding of a software mode shift
+    unsigned char shift_tdi[2 * (IRMAXPADSIZE / 8) + MAX_DATA_SIZE];
+    unsigned char shift_tdo[2 * (IRMAXPADSIZE / 8) + MAX_DATA_SIZE];
+    // move into Shift-IR/DR done by the next shift, see JTAG_flush()
+    bool tap_move_pending;
+    enum jtag_states pending_from_state;
+    JTAG_Stats stats;
     int JTAG_driver_handle;
     bool sw_mode;
     bool force_jtag_hw;
@@ -141,6 +159,7 @@ STATUS JTAG_set_padding(JTAG_Handler* state, JTAGPaddingTypes padding,
 STATUS JTAG_tap_reset(JTAG_Handler* state);
 STATUS JTAG_set_tap_state(JTAG_Handler* state, enum jtag_states tap_state);
 STATUS JTAG_get_tap_state(JTAG_Handler* state, enum jtag_states* tap_state);
+STATUS JTAG_flush(JTAG_Handler* state);
 STATUS JTAG_shift(JTAG_Handler* state, unsigned int number_of_bits,
                   unsigned int input_bytes, unsigned char* input,
                   unsigned int output_bytes, unsigned char* output,
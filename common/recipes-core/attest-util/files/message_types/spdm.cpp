@@ -1,5 +1,6 @@
 #include "spdm.hpp"
 #include <stdint.h>
+#include <stddef.h>
 #include <utils.hpp>
 #include <unordered_map>
 #include <openbmc/pal.h>
@@ -9,6 +10,7 @@
 
 #define DEFAULT_EID 0x8
 #define MAX_PAYLOAD_SIZE 4099 // including Message Header and body
+#define SPDM_RSP_OFFSET ((int)offsetof(struct obmc_mctp_spdm_hdr, Msg_Type))
 
 /**
  *  These are the supported output types of the responses.
@@ -17,7 +19,7 @@
  *  CLI11 automatically checks to make sure the option passed in
  *  is present in this list and handles the error if it isn't.
  */
-typedef void (*OutputFunctionType)(std::string, std::string);
+typedef void (*OutputFunctionType)(const std::string&, const std::string&);
 static const std::unordered_map<std::string, OutputFunctionType>
     acceptedOutputs = {
         {"raw", handleResponseRaw},
@@ -60,7 +62,7 @@ CLI::App* SpdmMessage::setupSubcommand(
 }
 
 // SPDM payload must start with 0x05 according to spec.
-static bool isPayloadValid(vector<uint8_t> payload) {
+static bool isPayloadValid(const vector<uint8_t> &payload) {
   if (payload.size() == 0 || payload[0] != 0x05)
     return false;
   return true;
@@ -107,10 +109,10 @@ void benchmarkSpdmMessage(uint8_t bus, uint8_t eid, vector<uint8_t> &message, ui
   return;
 }
 
-vector<uint8_t> sendSpdmMessage(uint8_t bus, uint8_t eid, vector<uint8_t> &message, bool debugOutput) {
-  uint8_t rbuf[MAX_PAYLOAD_SIZE] = {0};
+// Returns the length of the response in rbuf, MCTP header included.
+static int sendSpdmMessage(uint8_t bus, uint8_t eid, vector<uint8_t> &message,
+                           uint8_t *rbuf, bool debugOutput) {
   uint16_t addr = 0;
-  vector<uint8_t> returnMessage;
   int rlen = 0;
 
   if(debugOutput == true)
@@ -121,7 +123,8 @@ vector<uint8_t> sendSpdmMessage(uint8_t bus, uint8_t eid, vector<uint8_t> &messa
               << std::endl;
 
   pal_get_bmc_ipmb_slave_addr(&addr, bus);
-  send_spdm_cmd(bus, addr, DEFAULT_EID, eid, &message[0], message.size(), rbuf, &rlen);
+  if (send_spdm_cmd(bus, addr, DEFAULT_EID, eid, &message[0], message.size(), rbuf, &rlen) < 0)
+    return 0;
 
   if (debugOutput == true) {
     std::cout << "Raw Response Length: " << std::dec << rlen << std::endl;
@@ -129,18 +132,16 @@ vector<uint8_t> sendSpdmMessage(uint8_t bus, uint8_t eid, vector<uint8_t> &messa
     printHexValues(rbuf, rlen);
   }
 
-  for(int index = 0; index < rlen; ++index)
-    returnMessage.push_back(rbuf[index]);
-
-  return returnMessage;
+  return rlen;
 }
 
 
 void SpdmMessage::sendMessage(SubcommandOptions const& opt) {
   string errorMessage = "";
   string encodedMessage;
-  vector<uint8_t> returnMessage;
-  vector<string> messages;
+  vector<std::string_view> messages;
+  uint8_t rbuf[MAX_PAYLOAD_SIZE] = {0};
+  int rlen;
   const string delimiter = ",";
   const uint8_t bus = 8;
 
@@ -158,12 +159,17 @@ void SpdmMessage::sendMessage(SubcommandOptions const& opt) {
     throw CLI::CallForHelp();
   }
 
-  messages = splitMessage(encodedMessage, delimiter); 
- 
-  vector<vector<uint8_t>> decodedMessages;
+  messages = splitMessage(encodedMessage, delimiter);
+
+  vector<vector<uint8_t>> decodedMessages(messages.size());
   for (int index = 0; index < messages.size(); ++index) {
-    // decode from base64.
-    decodedMessages.push_back(decodeBase64(messages[index]));
+    // decode from base64, an invalid message is left empty.
+    vector<uint8_t> &decoded = decodedMessages[index];
+    int len;
+
+    decoded.resize(base64DecodedSize(messages[index].size()));
+    len = decodeBase64(messages[index], decoded.data(), decoded.size());
+    decoded.resize(len > 0 ? len : 0);
   }
 
   if(opt.benchmarkCount > 0) {
@@ -176,7 +182,7 @@ void SpdmMessage::sendMessage(SubcommandOptions const& opt) {
 
   for (int index = 0; index < messages.size(); ++index) {
     string encodedResponse = "DUMMYRESPONSE";
-    vector<uint8_t> message = decodedMessages[index];
+    vector<uint8_t> &message = decodedMessages[index];
 
     if (opt.debugOutput == true)
       std::cout << "Attempting to send SPDM message: " << index << std::endl;
@@ -192,13 +198,12 @@ void SpdmMessage::sendMessage(SubcommandOptions const& opt) {
         std::cout << "Message is valid SPDM message!" << std::endl;
 
       // send message over MCTP
-      returnMessage = sendSpdmMessage(bus, opt.device, message, opt.debugOutput);
+      rlen = sendSpdmMessage(bus, opt.device, message, rbuf, opt.debugOutput);
 
-      if(returnMessage.size() > 0) {
-        // Remove the MCTP header.
-        returnMessage.erase(returnMessage.begin(), returnMessage.begin()+3);
-        // Re-encode response to base64
-        encodedResponse = encodeBase64(returnMessage);
+      if(rlen > SPDM_RSP_OFFSET) {
+        // Re-encode response to base64 straight from the receive buffer,
+        // past the MCTP header.
+        encodedResponse = encodeBase64(rbuf + SPDM_RSP_OFFSET, rlen - SPDM_RSP_OFFSET);
         errorMessage = "Success";
       } else {
         errorMessage = "Empty Response";
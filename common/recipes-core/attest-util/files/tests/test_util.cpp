@@ -260,3 +260,42 @@ TEST_F(UtilTest, Encode_Decode) {
   EXPECT_EQ(decoded, answer);
 }
 
+
+TEST_F(UtilTest, Encode_Into_Buffer) {
+  vector<uint8_t> testBytes = {126, 127, 128, 129};
+  char encoded[16];
+  size_t len;
+
+  len = encodeBase64(testBytes.data(), testBytes.size(), encoded);
+  EXPECT_EQ(len, base64EncodedSize(testBytes.size()));
+  EXPECT_EQ(std::string(encoded, len), "fn+AgQ==");
+}
+
+TEST_F(UtilTest, Decode_Into_Buffer) {
+  vector<uint8_t> answer = {126, 127, 128, 129};
+  uint8_t decoded[8];
+  int len;
+
+  len = decodeBase64("fn+A\ngQ==\n", decoded, sizeof(decoded));
+  ASSERT_EQ(len, 4);
+  EXPECT_EQ(vector<uint8_t>(decoded, decoded + len), answer);
+}
+
+TEST_F(UtilTest, Decode_Invalid) {
+  uint8_t decoded[8];
+
+  EXPECT_EQ(decodeBase64("fn*A", decoded, sizeof(decoded)), -1);
+  EXPECT_EQ(decodeBase64("fn+Ag", decoded, sizeof(decoded)), -1);
+  EXPECT_EQ(decodeBase64("fn+AgQ==", decoded, 3), -1);
+  EXPECT_TRUE(decodeBase64(std::string("fn*A")).empty());
+}
+
+TEST_F(UtilTest, Split_Message) {
+  std::string message = "YWJj,ZGVm,Z2hp";
+  vector<std::string_view> messages = splitMessage(message, ",");
+
+  ASSERT_EQ(messages.size(), 3);
+  EXPECT_EQ(messages[0], "YWJj");
+  EXPECT_EQ(messages[2], "Z2hp");
+  EXPECT_EQ(messages[1].data(), message.data() + 5);
+}
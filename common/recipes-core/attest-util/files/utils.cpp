@@ -3,13 +3,13 @@
 #include <iomanip>
 #include "nlohmann/json.hpp"
 
-void handleResponseRaw(string response, string error) {
+void handleResponseRaw(const string& response, const string& error) {
   std::cout << response << std::endl;
   if (error != "Success")
     std::cerr << error << std::endl;
 }
 
-void handleResponseJson(string response, string error) {
+void handleResponseJson(const string& response, const string& error) {
   nlohmann::json jsonResponse;
 
   jsonResponse["version"] = VERSION;
@@ -19,100 +19,122 @@ void handleResponseJson(string response, string error) {
   std::cout << jsonResponse.dump() << std::endl;
 }
 
-static const string characterSet =
+static constexpr char characterSet[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-static inline void decodeChunk(
-    vector<uint8_t>& characters,
-    vector<uint8_t>& decodedBytes,
-    int end) {
-  vector<uint8_t> values(3, 0);
+// Values of the characters: 0-63, SKIP for whitespace, BAD for the others.
+enum : int8_t { SKIP = -2, BAD = -1 };
 
-  for (int i = 0; i < (int)characters.size(); ++i)
-    characters[i] = characterSet.find(characters[i]);
+struct DecodeTable {
+  int8_t value[256];
+};
 
-  values[0] = (characters[0] << 2) + ((characters[1] & 0x30) >> 4);
-  values[1] = ((characters[1] & 0xf) << 4) + ((characters[2] & 0x3c) >> 2);
-  values[2] = characters[2] = ((characters[2] & 0x3) << 6) + characters[3];
+static constexpr DecodeTable makeDecodeTable() {
+  DecodeTable table{};
 
-  for (int i = 0; i < end; i++) {
-    decodedBytes.push_back(values[i]);
-  }
+  for (int i = 0; i < 256; ++i)
+    table.value[i] = BAD;
+  for (int i = 0; i < 64; ++i)
+    table.value[(uint8_t)characterSet[i]] = i;
+  table.value[(uint8_t)' '] = table.value[(uint8_t)'\t'] = SKIP;
+  table.value[(uint8_t)'\r'] = table.value[(uint8_t)'\n'] = SKIP;
+  return table;
 }
 
-vector<uint8_t> decodeBase64(string& encodedString) {
-  vector<uint8_t> characters(4, 0);
-  vector<uint8_t> decodedBytes;
-  int i = 0;
+static constexpr DecodeTable decodeTable = makeDecodeTable();
 
-  for (char nextChar : encodedString) {
-    if (nextChar == '=')
-      break;
+int decodeBase64(std::string_view encoded, uint8_t* out, size_t outSize) {
+  uint32_t chunk = 0;
+  size_t len = 0;
+  int count = 0;
 
-    characters[i] = nextChar;
+  for (char nextChar : encoded) {
+    int8_t value = decodeTable.value[(uint8_t)nextChar];
 
-    if (i == 3) {
-      decodeChunk(characters, decodedBytes, i);
-      i = 0;
-    } else {
-      ++i;
+    if (value < 0) {
+      if (nextChar == '=')
+        break;
+      if (value == SKIP)
+        continue;
+      return -1;
     }
-  }
 
-  if (i) {
-    for (int j = i; j < 4; j++)
-      characters[j] = 0;
+    chunk = (chunk << 6) | value;
+    if (++count == 4) {
+      if (len + 3 > outSize)
+        return -1;
+      out[len++] = chunk >> 16;
+      out[len++] = chunk >> 8;
+      out[len++] = chunk;
+      chunk = 0;
+      count = 0;
+    }
+  }
 
-    decodeChunk(characters, decodedBytes, i - 1);
+  // 2 or 3 characters of a last chunk are 1 or 2 bytes
+  if (count == 1)
+    return -1;
+  if (count) {
+    if (len + count - 1 > outSize)
+      return -1;
+    chunk <<= 6 * (4 - count);
+    out[len++] = chunk >> 16;
+    if (count == 3)
+      out[len++] = chunk >> 8;
   }
 
-  return decodedBytes;
+  return len;
 }
 
-static inline string accumulateBytes(const vector<uint8_t>& temp, int end) {
-  vector<uint8_t> accumulator(4, 0);
-  string encoded;
+vector<uint8_t> decodeBase64(const string& encodedString) {
+  vector<uint8_t> decodedBytes(base64DecodedSize(encodedString.size()));
+  int len;
 
-  accumulator[0] = (temp[0] & 0xfc) >> 2;
-  accumulator[1] = ((temp[0] & 0x03) << 4) + ((temp[1] & 0xf0) >> 4);
-  accumulator[2] = ((temp[1] & 0x0f) << 2) + ((temp[2] & 0xc0) >> 6);
-  accumulator[3] = temp[2] & 0x3f;
-
-  for (int i = 0; i < end; ++i)
-    encoded += characterSet[accumulator[i]];
-
-  return encoded;
+  len = decodeBase64(encodedString, decodedBytes.data(), decodedBytes.size());
+  decodedBytes.resize(len > 0 ? len : 0);
+  return decodedBytes;
 }
 
-string encodeBase64(vector<uint8_t>& bytes) {
-  string encodedBytes;
-  int i = 0;
-  vector<uint8_t> temp(3, 0);
+size_t encodeBase64(const uint8_t* bytes, size_t size, char* out) {
+  char* next = out;
+  size_t i;
 
   // Handle 24 bits at a time
-  for (uint8_t nextByte : bytes) {
-    temp[i++] = nextByte;
+  for (i = 0; i + 3 <= size; i += 3) {
+    uint32_t chunk = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
 
-    if (i == 3) {
-      encodedBytes += accumulateBytes(temp, 4);
-      i = 0;
-    }
+    *next++ = characterSet[chunk >> 18];
+    *next++ = characterSet[(chunk >> 12) & 0x3f];
+    *next++ = characterSet[(chunk >> 6) & 0x3f];
+    *next++ = characterSet[chunk & 0x3f];
   }
 
   // Handle the case that the number of input bits is not divisible by 24
-  if (i != 0) {
-    for (int j = i; j < (int)temp.size(); j++)
-      temp[j] = '\0';
+  if (i < size) {
+    uint32_t chunk = bytes[i] << 16;
+
+    if (i + 1 < size)
+      chunk |= bytes[i + 1] << 8;
+    *next++ = characterSet[chunk >> 18];
+    *next++ = characterSet[(chunk >> 12) & 0x3f];
+    *next++ = i + 1 < size ? characterSet[(chunk >> 6) & 0x3f] : '=';
+    *next++ = '=';
+  }
 
-    encodedBytes += accumulateBytes(temp, i + 1);
+  return next - out;
+}
 
-    for (; i < (int)temp.size(); ++i)
-      encodedBytes += '=';
-  }
+string encodeBase64(const uint8_t* bytes, size_t size) {
+  string encoded(base64EncodedSize(size), '\0');
 
-  return encodedBytes;
+  encodeBase64(bytes, size, &encoded[0]);
+  return encoded;
+}
+
+string encodeBase64(const vector<uint8_t>& bytes) {
+  return encodeBase64(bytes.data(), bytes.size());
 }
 
 
@@ -132,18 +154,18 @@ void printHexValues(uint8_t *values, int size) {
   std::cout << std::endl;
 }
 
-vector<string> splitMessage(string message, string delimiter) {
-    int end;
-    vector<string> messages;
-    
-    while((end = message.find(delimiter)) != string::npos) {
-        messages.push_back(message.substr(0, end));
-        message.erase(0, end + delimiter.length());
-    }
+vector<std::string_view> splitMessage(std::string_view message, std::string_view delimiter) {
+  vector<std::string_view> messages;
+  size_t end;
+
+  while ((end = message.find(delimiter)) != std::string_view::npos) {
+    messages.push_back(message.substr(0, end));
+    message.remove_prefix(end + delimiter.length());
+  }
 
-    // Don't forget last message, assuming they didn't end with a delimiter.
-    if(message.length() > 0)
-        messages.push_back(message);
+  // Don't forget last message, assuming they didn't end with a delimiter.
+  if (message.length() > 0)
+    messages.push_back(message);
 
-    return messages;
+  return messages;
 }
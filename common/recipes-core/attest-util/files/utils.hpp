@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using std::string;
@@ -14,31 +15,58 @@ const string VERSION = "0.1";
  * and outputs the response to stdout and if the error string is not
  * empty it outputs it to stderr.
  */
-void handleResponseRaw(string response, string error);
+void handleResponseRaw(const string& response, const string& error);
 
 /**
  * This function takes the response and error strings as well as
  * the utility versions and packages them into a json format before
  * outputting them to stdout
  */
-void handleResponseJson(string response, string error);
+void handleResponseJson(const string& response, const string& error);
+
+/** Bytes of the base64 encoding of size bytes, padding included. */
+inline size_t base64EncodedSize(size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+/** Most bytes a base64 string of size characters decodes to. */
+inline size_t base64DecodedSize(size_t size) {
+  return (size + 3) / 4 * 3;
+}
+
+/**
+ * This function takes a string encoded as base64 and decodes it into out
+ * using the "a-zA-Z+/" encoding character set, skipping whitespace. The
+ * string ends at the first '=' padding character.
+ * Returns the number of decoded bytes, or -1 if the string has other
+ * characters or out is smaller than the decoded bytes.
+ */
+int decodeBase64(std::string_view encoded, uint8_t* out, size_t outSize);
 
 /**
  * This function takes a string encoded as base64 and decodes into an unsigned
- * byte vector using the "a-zA-Z+/" encoding character set. This function
- * assumes an '=' padded encoded string.
+ * byte vector, empty if the string is not valid base64.
  */
-vector<uint8_t> decodeBase64(string& encodedString);
+vector<uint8_t> decodeBase64(const string& encodedString);
 
 /**
- * This function takes a unsigned byte vector and encodes it into a
- * base64 string. It encodes it using the "a-zA-Z+/" character set and
- * uses '=' as padding when the byte count is not divisible by 3.
+ * This function takes size bytes and encodes them as base64 into out, which
+ * must hold base64EncodedSize(size) characters. It encodes it using the
+ * "a-zA-Z+/" character set and uses '=' as padding when the byte count is
+ * not divisible by 3. Returns the number of characters written.
  */
-string encodeBase64(std::vector<uint8_t>& bytes);
+size_t encodeBase64(const uint8_t* bytes, size_t size, char* out);
+
+/** Same as above, into a new string. */
+string encodeBase64(const uint8_t* bytes, size_t size);
+string encodeBase64(const vector<uint8_t>& bytes);
 
 /** Prints an array of bytes as 2-character hex values. */
 void printHexValues(uint8_t *values, int size);
 
 
-vector<string> splitMessage(string message, string delimiter);
+/**
+ * Splits message at every delimiter. The returned views point into the
+ * storage of message.
+ */
+vector<std::string_view> splitMessage(std::string_view message, std::string_view delimiter);
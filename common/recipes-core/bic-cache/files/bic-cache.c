@@ -29,6 +29,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <linux/limits.h>
 #include <openbmc/log.h>
 #include <openbmc/ipmi.h>
@@ -39,16 +40,192 @@
 #define LAST_RECORD_ID 0xFFFF
 #define BYTES_ENTIRE_RECORD 0xFF
 
+/*
+ * Copies of the caches across reboots: they are restored instead of read
+ * from the BIC as long as its firmware version and SDR repository info
+ * are unchanged.
+ */
+#define BIC_CACHE_PERSIST_DIR "/mnt/data/bic-cache"
+
+typedef struct {
+  uint8_t bic_ver[8];
+  uint16_t sdr_rec_count;
+  uint8_t sdr_add_ts[4];
+  uint8_t sdr_erase_ts[4];
+} bic_cache_stamp_t;
+
+static void
+fruid_cache_path(uint8_t slot_id, char *path, size_t size) {
+  char fru_name[NAME_MAX];
+
+  pal_get_fru_name(slot_id + 1, fru_name);
+  snprintf(path, size, "/tmp/fruid_%s.bin", fru_name);
+}
+
+static void
+sdr_cache_path(uint8_t slot_id, char *path, size_t size) {
+  char fru_name[NAME_MAX];
+
+  pal_get_fru_name(slot_id + 1, fru_name);
+  snprintf(path, size, "/tmp/sdr_%s.bin", fru_name);
+}
+
+/* Path of the persisted copy of a cache file in /tmp */
+static void
+persist_path(const char *cache_path, char *path, size_t size) {
+  const char *name = strrchr(cache_path, '/');
+
+  snprintf(path, size, "%s%s", BIC_CACHE_PERSIST_DIR, name);
+}
+
+static void
+stamp_path(uint8_t slot_id, char *path, size_t size) {
+  char fru_name[NAME_MAX];
+
+  pal_get_fru_name(slot_id + 1, fru_name);
+  snprintf(path, size, "%s/%s.stamp", BIC_CACHE_PERSIST_DIR, fru_name);
+}
+
+/* Copy src to dst through a temporary file, so dst is never partial. */
+static int
+copy_file(const char *src, const char *dst) {
+  char tmp_path[PATH_MAX];
+  char buf[4096];
+  ssize_t n;
+  int in, out, ret = 0;
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", dst);
+  in = open(src, O_RDONLY);
+  if (in < 0) {
+    return -1;
+  }
+  out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (out < 0) {
+    close(in);
+    return -1;
+  }
+
+  while ((n = read(in, buf, sizeof(buf))) > 0) {
+    if (write(out, buf, n) != n) {
+      ret = -1;
+      break;
+    }
+  }
+  if (n < 0) {
+    ret = -1;
+  }
+  close(in);
+  if (close(out) < 0) {
+    ret = -1;
+  }
+
+  if (ret == 0 && rename(tmp_path, dst) < 0) {
+    ret = -1;
+  }
+  if (ret) {
+    unlink(tmp_path);
+  }
+  return ret;
+}
+
+static int
+get_cache_stamp(uint8_t slot_id, bic_cache_stamp_t *stamp) {
+  ipmi_sel_sdr_info_t info;
+
+  memset(stamp, 0, sizeof(*stamp));
+  if (bic_get_fw_ver(slot_id, FW_BIC, stamp->bic_ver) ||
+      bic_get_sdr_info(slot_id, &info)) {
+    return -1;
+  }
+  stamp->sdr_rec_count = info.rec_count;
+  memcpy(stamp->sdr_add_ts, info.add_ts, sizeof(stamp->sdr_add_ts));
+  memcpy(stamp->sdr_erase_ts, info.erase_ts, sizeof(stamp->sdr_erase_ts));
+  return 0;
+}
+
+/*
+ * Restore the FRU and SDR caches of the slot from the persisted copies
+ * if they were read from the BIC with the same stamp.
+ */
+static int
+cache_restore(uint8_t slot_id, const bic_cache_stamp_t *stamp) {
+  bic_cache_stamp_t saved;
+  char path[PATH_MAX], cache[PATH_MAX], copy[PATH_MAX];
+  int fd;
+  ssize_t n;
+
+  stamp_path(slot_id, path, sizeof(path));
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  n = read(fd, &saved, sizeof(saved));
+  close(fd);
+  if (n != sizeof(saved) || memcmp(&saved, stamp, sizeof(saved))) {
+    return -1;
+  }
+
+  fruid_cache_path(slot_id, cache, sizeof(cache));
+  persist_path(cache, copy, sizeof(copy));
+  if (copy_file(copy, cache)) {
+    return -1;
+  }
+  sdr_cache_path(slot_id, cache, sizeof(cache));
+  persist_path(cache, copy, sizeof(copy));
+  if (copy_file(copy, cache)) {
+    return -1;
+  }
+
+  syslog(LOG_INFO, "slot %d: restored FRU and SDR caches\n", slot_id);
+  return 0;
+}
+
+static void
+cache_persist(uint8_t slot_id, const bic_cache_stamp_t *stamp) {
+  char path[PATH_MAX], cache[PATH_MAX], copy[PATH_MAX];
+  int fd;
+
+  if (mkdir(BIC_CACHE_PERSIST_DIR, 0755) && errno != EEXIST) {
+    syslog(LOG_WARNING, "failed to create %s: %s\n",
+           BIC_CACHE_PERSIST_DIR, strerror(errno));
+    return;
+  }
+
+  // Drop the stamp first: the copies are stale until it is rewritten.
+  stamp_path(slot_id, path, sizeof(path));
+  unlink(path);
+
+  fruid_cache_path(slot_id, cache, sizeof(cache));
+  persist_path(cache, copy, sizeof(copy));
+  if (copy_file(cache, copy)) {
+    return;
+  }
+  sdr_cache_path(slot_id, cache, sizeof(cache));
+  persist_path(cache, copy, sizeof(copy));
+  if (copy_file(cache, copy)) {
+    return;
+  }
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  if (write(fd, stamp, sizeof(*stamp)) != sizeof(*stamp)) {
+    close(fd);
+    unlink(path);
+    return;
+  }
+  close(fd);
+}
+
 int
 fruid_cache_init(uint8_t slot_id) {
 
   int ret = 0;
   int fru_size = 0;
   char fruid_path[PATH_MAX];
-  char fru_name[NAME_MAX];
 
-  pal_get_fru_name(slot_id + 1, fru_name);
-  sprintf(fruid_path, "/tmp/fruid_%s.bin", fru_name);
+  fruid_cache_path(slot_id, fruid_path, sizeof(fruid_path));
 
   ret = bic_read_fruid(slot_id, 0, fruid_path, &fru_size);
   if (ret) {
@@ -59,18 +236,16 @@ fruid_cache_init(uint8_t slot_id) {
   return ret;
 }
 
-void
+int
 sdr_cache_init(uint8_t slot_id) {
   int fd, ret, retry;
   size_t rlen;
   uint8_t rbuf[MAX_IPMB_RES_LEN];
   char sdr_path[PATH_MAX];
-  char fru_name[NAME_MAX];
   ipmi_sel_sdr_req_t req;
   ipmi_sel_sdr_res_t *res = (ipmi_sel_sdr_res_t *) rbuf;
 
-  pal_get_fru_name(slot_id + 1, fru_name);
-  snprintf(sdr_path, sizeof(sdr_path), "/tmp/sdr_%s.bin", fru_name);
+  sdr_cache_path(slot_id, sdr_path, sizeof(sdr_path));
 
   req.rsv_id = 0;
   req.rec_id = 0;
@@ -82,14 +257,14 @@ sdr_cache_init(uint8_t slot_id) {
   fd = open(sdr_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
   if (fd < 0) {
     syslog(LOG_WARNING, "failed to open %s: %s\n", sdr_path, strerror(errno));
-    return;
+    return -1;
   }
 
   ret = pal_flock_retry(fd);
   if (ret == -1) {
    syslog(LOG_WARNING, "failed to flock %s: %s", sdr_path, strerror(errno));
    close(fd);
-   return;
+   return -1;
   }
 
   retry = 3;
@@ -115,8 +290,10 @@ sdr_cache_init(uint8_t slot_id) {
     } else if (ret != sizeof(sdr_full_t)) {
       OBMC_WARN("data truncated (write %s): expect %i, actual %d\n",
                 sdr_path, sizeof(sdr_full_t), ret);
+      ret = -1;
       break;
     }
+    ret = 0;
 
     req.rec_id = res->next_rec_id;
     if (req.rec_id == LAST_RECORD_ID) {
@@ -125,30 +302,23 @@ sdr_cache_init(uint8_t slot_id) {
     }
   }
 
-  ret = pal_unflock_retry(fd);
-  if (ret == -1) {
+  if (pal_unflock_retry(fd) == -1) {
    syslog(LOG_WARNING, "failed to unflock %s: %s\n", sdr_path, strerror(errno));
   }
 
   close(fd);
+  return ret ? -1 : 0;
 }
 
-int
-main (int argc, char * const argv[])
-{
-  int ret;
-  uint8_t slot_id;
+static void *
+slot_cache_init(void *arg) {
+  uint8_t slot_id = (uint8_t)(uintptr_t)arg;
   uint8_t self_test_result[2]={0};
+  bic_cache_stamp_t stamp;
+  bool have_stamp;
   int retry = 0;
   int max_retry = 3;
-
-  if (argc != 2) {
-    syslog(LOG_WARNING,
-           "invalid command line argument: <slot-id> is missing\n");
-    return -1;
-  }
-
-  slot_id = atoi(argv[1]);
+  int ret;
 
   /* Check BIC Self Test Result */
   do {
@@ -161,8 +331,13 @@ main (int argc, char * const argv[])
     sleep(5);
   } while (retry++ < max_retry);
   if (ret != 0) {
-    syslog(LOG_ERR, "failed to get bic self test result. Exiting!\n");
-    return -1;
+    syslog(LOG_ERR, "slot %d: failed to get bic self test result.\n", slot_id);
+    return NULL;
+  }
+
+  have_stamp = get_cache_stamp(slot_id, &stamp) == 0;
+  if (have_stamp && cache_restore(slot_id, &stamp) == 0) {
+    return NULL;
   }
 
   /* Get uServer FRU */
@@ -179,7 +354,43 @@ main (int argc, char * const argv[])
     syslog(LOG_CRIT, "Fail on getting uServer FRU.");
   }
 
-  sdr_cache_init(slot_id);
+  if (sdr_cache_init(slot_id) == 0 && ret == 0 && have_stamp) {
+    cache_persist(slot_id, &stamp);
+  }
+
+  return NULL;
+}
+
+/*
+ * The caches of the slots of the command line are filled concurrently,
+ * each by its own thread.
+ */
+int
+main (int argc, char * const argv[])
+{
+  pthread_t tids[argc];
+  int i, num_threads = 0;
+
+  if (argc < 2) {
+    syslog(LOG_WARNING,
+           "invalid command line argument: <slot-id> is missing\n");
+    return -1;
+  }
+
+  for (i = 1; i < argc; i++) {
+    uintptr_t slot_id = (uint8_t)atoi(argv[i]);
+
+    if (pthread_create(&tids[num_threads], NULL, slot_cache_init,
+                       (void *)slot_id)) {
+      syslog(LOG_WARNING, "slot %d: failed to create thread\n", (int)slot_id);
+      slot_cache_init((void *)slot_id);
+      continue;
+    }
+    num_threads++;
+  }
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(tids[i], NULL);
+  }
 
   return 0;
 }
@@ -18,6 +18,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -29,6 +30,7 @@
 #include <poll.h>
 #include <termios.h>
 #include <signal.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <openbmc/pal.h>
 
@@ -37,6 +39,10 @@
 #define ASCII_ENTER   0x0D
 #define MAX_LOGFILE_LINES 1200 // Maximum lines based on carriage returns or new line
 #define MAX_LOGFILE_SIZE 102400 // 100KB size => 1200 lines of 80 characters each = ~108000B
+#define SPLICE_CHUNK  4096
+// In buffer mode, let a burst build up in the tty before reading it
+#define COALESCE_MS     20
+#define COALESCE_BYTES  128
 static sig_atomic_t sigexit = 0;
 
 static void
@@ -58,6 +64,81 @@ write_data(int file, char *buf, int len, char *fname) {
   }
 }
 
+/*
+ * Moves len bytes queued in pipe rd to file, with splice() unless file
+ * does not support it, in which case *spliced is cleared and the data
+ * goes through a buffer instead.
+ */
+static void
+drain_pipe(int rd, int file, int len, char *fname, int *spliced) {
+  char buf[256];
+  int n;
+
+  while (len > 0 && *spliced) {
+    n = splice(rd, NULL, file, NULL, len, SPLICE_F_MOVE);
+    if (n > 0) {
+      len -= n;
+    } else if (n < 0 && errno == EINVAL) {
+      *spliced = 0;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      syslog(LOG_WARNING, "drain_pipe: splice() failed to file %s | errno: %d",
+          fname, errno);
+      break;
+    }
+  }
+  while (len > 0) {
+    n = read(rd, buf, len < sizeof(buf) ? len : sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    if (file >= 0) {
+      write_data(file, buf, n, fname);
+    }
+    len -= n;
+  }
+}
+
+/*
+ * Moves what the tty has to the log file, and to stdout when stdo is
+ * set, through the pipes without copying it to userspace.
+ * Returns the number of bytes moved, 0 if there was nothing to read,
+ * or -1 with errno EINVAL if the tty can't be spliced from.
+ */
+static int
+splice_console(int tty, int pipefd[2], int tpipefd[2], int buf_fd, int stdo,
+               char *bfname, int *log_spliced, int *out_spliced) {
+  int n, t;
+
+  n = splice(tty, NULL, pipefd[1], NULL, SPLICE_CHUNK,
+             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n <= 0) {
+    return (n < 0 && errno == EAGAIN) ? 0 : n;
+  }
+
+  if (stdo >= 0) {
+    t = tee(pipefd[0], tpipefd[1], n, 0);
+    if (t > 0) {
+      drain_pipe(tpipefd[0], stdo, t, "STDOUT_FILENO", out_spliced);
+    }
+  }
+  drain_pipe(pipefd[0], buf_fd, n, bfname, log_spliced);
+
+  return n;
+}
+
+static int
+open_log(const char *bfname) {
+  // No O_APPEND, splice() does not take it; consoled is the only writer
+  int fd = open(bfname, O_RDWR | O_CREAT, 0666);
+
+  if (fd >= 0) {
+    lseek(fd, 0, SEEK_END);
+  }
+  return fd;
+}
+
 static void
 exit_session(int sig)
 {
@@ -79,6 +160,10 @@ run_console(char* fru_name, int term) {
   int nfd = 0;      // For number of fd
   int nevents;      // For number of events in fd
   int nline = 0;
+  int use_splice = 1, log_spliced = 1, out_spliced = 1;
+  int pipefd[2] = {-1, -1}, tpipefd[2] = {-1, -1};
+  int timeout = -1;
+  int avail;
   //int pid_fd;
   int flags;
   pid_t pid;        // For pid of the daemon
@@ -147,11 +232,15 @@ run_console(char* fru_name, int term) {
   /* Buffering the console data into a file */
   sprintf(old_bfname, "/tmp/consoled_%s_log-old", fru_name);
   sprintf(bfname, "/tmp/consoled_%s_log", fru_name);
-  if ((buf_fd = open(bfname, O_RDWR | O_APPEND | O_CREAT, 0666)) < 0) {
+  if ((buf_fd = open_log(bfname)) < 0) {
     syslog(LOG_WARNING, "Cannot open the file %s", bfname);
     exit(-1);
   }
 
+  if (pipe(pipefd) || (term && pipe(tpipefd))) {
+    use_splice = 0;
+  }
+
   if (term) {
     /* Changing the attributes of STDIN_FILENO */
     stdi = STDIN_FILENO;
@@ -176,7 +265,24 @@ run_console(char* fru_name, int term) {
   }
 
   /* Handling the input event from the  terminal and tty dev */
-  while (!sigexit && (nevents = poll(pfd, nfd, -1 /* Timeout */))) {
+  while (!sigexit && ((nevents = poll(pfd, nfd, timeout)) || timeout >= 0)) {
+    if (nevents < 0) {
+      continue;
+    }
+
+    /* Coalescing time is over, read what was received meanwhile */
+    if (nevents == 0) {
+      pfd[0].events = POLLIN;
+      pfd[0].revents = POLLIN;
+      timeout = -1;
+      nevents = 1;
+    } else if (!term && pfd[0].events && pfd[0].revents == POLLIN &&
+               ioctl(tty, FIONREAD, &avail) == 0 && avail < COALESCE_BYTES) {
+      /* Wait a little for more before reading a few bytes */
+      pfd[0].events = 0;
+      timeout = COALESCE_MS;
+      continue;
+    }
 
     /* Input to the terminal from the user */
     if (term && nevents && nfd > 1 && pfd[1].revents > 0) {
@@ -196,8 +302,23 @@ run_console(char* fru_name, int term) {
 
     /* Input from the tty dev */
     if (nevents && pfd[0].revents > 0) {
-      blen = read(tty, buf, sizeof(buf));
-      if (blen > 0) {
+      if (use_splice) {
+        blen = splice_console(tty, pipefd, tpipefd, buf_fd, term ? stdo : -1,
+                              bfname, &log_spliced, &out_spliced);
+        if (blen < 0 && errno == EINVAL) {
+          /* The tty driver doesn't splice, use read() from now on */
+          use_splice = 0;
+          blen = 0;
+        }
+      } else {
+        blen = read(tty, buf, sizeof(buf));
+      }
+      if (use_splice) {
+        // Data didn't go through buf, rotation is by size only
+        if (blen < 0) {
+          raise(SIGHUP);
+        }
+      } else if (blen > 0) {
         for (i = 0; i < blen; i++) {
           if (buf[i] == 0xD || buf[i] == 0xA)
             nline++;
@@ -220,7 +341,7 @@ run_console(char* fru_name, int term) {
         close(buf_fd);
         remove(old_bfname);
         rename(bfname, old_bfname);
-        if ((buf_fd = open(bfname, O_RDWR | O_APPEND | O_CREAT, 0666)) < 0) {
+        if ((buf_fd = open_log(bfname)) < 0) {
           syslog(LOG_WARNING, "Cannot open the file %s", bfname);
           exit(-1);
         }
@@ -232,6 +353,12 @@ run_console(char* fru_name, int term) {
 
   /* Close the console buffer file */
   close(buf_fd);
+  for (i = 0; i < 2; i++) {
+    if (pipefd[i] >= 0)
+      close(pipefd[i]);
+    if (tpipefd[i] >= 0)
+      close(tpipefd[i]);
+  }
 
   /* Revert the tty dev to old attributes */
   tcflush(tty, TCIFLUSH);
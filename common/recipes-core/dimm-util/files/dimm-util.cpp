@@ -128,6 +128,22 @@ util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
   return -1;
 }
 
+// read up to len bytes off SPD bus in one transaction,
+//   platforms which support block reads override it
+// input:  fru_id/cpu/dimm/offset/len
+// returns the number of bytes read into buf, or -1
+int __attribute__((weak))
+util_read_spd(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset,
+              uint8_t len, uint8_t *buf)
+{
+  int value = util_read_spd_byte(fru_id, cpu, dimm, offset);
+
+  if (value < 0 || len == 0)
+    return -1;
+  buf[0] = value;
+  return 1;
+}
+
 // allows each platform to populate cpu num, dimm num, num frus
 int __attribute__((weak))
 plat_init()
@@ -160,21 +176,23 @@ util_read_spd_with_retry(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint16_t off
                   uint16_t early_exit_cnt, uint8_t *buf, uint8_t *present) {
   uint16_t j, fail_cnt = 0;
   uint8_t retry = 0;
-  int value = 0;
+  int n = 0;
 
   *present = 0;
-  for (j = 0; j < len; ++j) {
+  for (j = 0; j < len; j += n) {
     retry = 0;
     while (retry < MAX_RETRY) {
-      value = util_read_spd_byte(fru_id, cpu, dimm, offset + j);
-      if (value >= 0)
+      n = util_read_spd(fru_id, cpu, dimm, offset + j,
+                        (len - j > 0xff) ? 0xff : len - j, buf + j);
+      if (n > 0)
         break;
       retry++;
     }
-    if (value >= 0) {
-      buf[j] = value;
+    if (n > 0) {
       *present = 1;
     } else {
+      // skip the byte, as a failed read of 1 byte
+      n = 1;
       // only consider early exit if it's non-0
       if (early_exit_cnt) {
         fail_cnt ++;
@@ -190,6 +208,53 @@ util_read_spd_with_retry(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint16_t off
 }
 
 
+// read the SPD bytes of a DIMM used by --serial, --part and --config
+//
+// The image is persisted per DIMM slot, and used as long as the serial
+// number of the DIMM in the slot matches the cached one: a cached DIMM
+// costs one page select and one serial number read instead of the
+// whole image.
+static int
+util_read_spd_image(uint8_t fru_id, uint8_t cpu, uint8_t dimm,
+                    spd_image_t *img, uint8_t *present) {
+  char key[MAX_KEY_LEN] = {0};
+  uint8_t serial[LEN_SERIAL] = {0};
+  spd_image_t cached;
+  size_t len = 0;
+
+  snprintf(key, sizeof(key), "dimm_util/fru%d_dimm%d_spd",
+           fru_id, cpu * num_dimms_per_cpu + dimm);
+  if (kv_get(key, (char *)&cached, &len, KV_FPERSIST) == 0 &&
+      len == sizeof(cached)) {
+    util_set_EE_page(fru_id, cpu, dimm, 1);
+    util_read_spd_with_retry(fru_id, cpu, dimm, OFFSET_SERIAL, LEN_SERIAL,
+      0, serial, present);
+    if (*present &&
+        !memcmp(serial, &cached.page1[OFFSET_SERIAL - P1_OFFSET], LEN_SERIAL)) {
+      DBG_PRINT("%s: cached SPD of %s\n", __FUNCTION__, get_dimm_label(cpu, dimm));
+      memcpy(img, &cached, sizeof(*img));
+      return 0;
+    }
+  }
+
+  memset(img, 0, sizeof(*img));
+  util_set_EE_page(fru_id, cpu, dimm, 0);
+  util_read_spd_with_retry(fru_id, cpu, dimm, P0_OFFSET, P0_LEN,
+    MAX_FAIL_CNT, img->page0, present);
+  if (*present) {
+    util_set_EE_page(fru_id, cpu, dimm, 1);
+    util_read_spd_with_retry(fru_id, cpu, dimm, P1_OFFSET, P1_LEN,
+      0, img->page1, present);
+  }
+
+  if (*present) {
+    kv_set(key, (const char *)img, sizeof(*img), KV_FPERSIST);
+  } else if (len) {
+    kv_del(key, KV_FPERSIST);
+  }
+  return *present ? 0 : -1;
+}
+
 // convert system dimm number to  (cpu, dimm) pair
 //     eg.   on a 2-socket system with 24 dimms (0-23)
 //               dimms 0-11 would be on cpu 0
@@ -221,7 +286,7 @@ set_dimm_loop(uint8_t dimm, uint8_t *startCPU, uint8_t *endCPU,
 static int
 util_get_serial(uint8_t fru_id, uint8_t dimm, bool json) {
   uint8_t i, j, cpu, startCPU, endCPU, startDimm, endDimm, dimm_present = 0;
-  uint8_t dimm_serial[MAX_CPU_NUM][MAX_DIMM_PER_CPU][LEN_SERIAL] = {0};
+  spd_image_t img;
   json_t *config_arr = NULL;
   char   sn[LEN_SERIAL_STRING] = {0};
 
@@ -236,13 +301,12 @@ util_get_serial(uint8_t fru_id, uint8_t dimm, bool json) {
   set_dimm_loop(dimm, &startCPU, &endCPU, &startDimm, &endDimm);
   for (cpu = startCPU; cpu < endCPU; cpu++) {
     for (i = startDimm; i < endDimm; ++i) {
-      util_set_EE_page(fru_id, cpu, i, 1);
-      util_read_spd_with_retry(fru_id, cpu, i, OFFSET_SERIAL, LEN_SERIAL, 0,
-        dimm_serial[cpu][i], &dimm_present);
+      util_read_spd_image(fru_id, cpu, i, &img, &dimm_present);
 
       if (dimm_present)
           for (j = 0; j < LEN_SERIAL; ++j)
-            snprintf(sn + (2 * j), LEN_SERIAL_STRING - (2 * j), "%02X", dimm_serial[cpu][i][j]);
+            snprintf(sn + (2 * j), LEN_SERIAL_STRING - (2 * j), "%02X",
+                     img.page1[OFFSET_SERIAL - P1_OFFSET + j]);
 
       if (json) {
         json_t *sn_obj = json_object();
@@ -286,7 +350,7 @@ err_exit:
 static int
 util_get_part(uint8_t fru_id, uint8_t dimm, bool json) {
   uint8_t i, j, cpu, startCPU, endCPU, startDimm, endDimm, dimm_present = 0;
-  uint8_t dimm_part[MAX_CPU_NUM][MAX_DIMM_PER_CPU][LEN_PART_NUMBER] = {0};
+  spd_image_t img;
   json_t *config_arr = NULL;
   char   pn[LEN_PN_STRING] = {0};
 
@@ -301,13 +365,12 @@ util_get_part(uint8_t fru_id, uint8_t dimm, bool json) {
   set_dimm_loop(dimm, &startCPU, &endCPU, &startDimm, &endDimm);
   for (cpu = startCPU; cpu < endCPU; cpu++) {
     for (i = startDimm; i < endDimm; ++i) {
-      util_set_EE_page(fru_id, cpu, i, 1);
-      util_read_spd_with_retry(fru_id, cpu, i, OFFSET_PART_NUMBER, LEN_PART_NUMBER,
-        MAX_FAIL_CNT, dimm_part[cpu][i], &dimm_present);
+      util_read_spd_image(fru_id, cpu, i, &img, &dimm_present);
 
       if (dimm_present)
           for (j = 0; j < LEN_PART_NUMBER; ++j)
-            snprintf(pn + j, LEN_PN_STRING - j, "%c", dimm_part[cpu][i][j]);
+            snprintf(pn + j, LEN_PN_STRING - j, "%c",
+                     img.page1[OFFSET_PART_NUMBER - P1_OFFSET + j]);
 
       if (json) {
         json_t *part_obj = json_object();
@@ -470,20 +533,17 @@ util_get_size(char *size_str, uint8_t size_str_len, uint8_t *buf) {
 static int
 util_get_config(uint8_t fru_id, uint8_t dimm, bool json) {
 // page 0 constants
-#define P0_OFFSET   0
-#define P0_LEN      20
 #define TYPE_OFFSET 2
 #define MIN_CYCLE_TIME_OFFSET 18
-// page 1 constants
-#define P1_OFFSET 0x40
-#define P1_LEN    0x30
+// page 1 constants, relative to P1_OFFSET
 #define MANUFACTURER_OFFSET 1
 #define DATE_OFFSET 3
 #define SERIAL_OFFSET 5
 #define PN_OFFSET 9
 #define BUF_SIZE 64
   uint8_t i, j, cpu, startCPU, endCPU, startDimm, endDimm, dimm_present = 0;
-  uint8_t buf[BUF_SIZE] = {0};
+  spd_image_t img;
+  uint8_t *buf;
   json_t *config_arr = NULL;
   char   pn[LEN_PN_STRING] = {0};
   char   sn[LEN_SERIAL_STRING] = {0};
@@ -504,30 +564,25 @@ util_get_config(uint8_t fru_id, uint8_t dimm, bool json) {
   set_dimm_loop(dimm, &startCPU, &endCPU, &startDimm, &endDimm);
   for (cpu = startCPU; cpu < endCPU; cpu++) {
     for (i = startDimm; i < endDimm; ++i) {
-      util_set_EE_page(fru_id, cpu, i, 0);
-      // read page 0 to get type, speed, capacity
-      memset(buf, 0, BUF_SIZE);
-      util_read_spd_with_retry(fru_id, cpu, i, P0_OFFSET, P0_LEN, 0, buf, &dimm_present);
+      util_read_spd_image(fru_id, cpu, i, &img, &dimm_present);
       if (dimm_present) {
+        // page 0 to get type, speed, capacity
+        buf = img.page0;
         dimm_type = buf[TYPE_OFFSET];
         mincycle  = buf[MIN_CYCLE_TIME_OFFSET];
         util_get_size(size, BUF_SIZE, buf);
 
-        // read page 1 to get pn, sn, manufacturer, manufacturer week
-        util_set_EE_page(fru_id, cpu, i, 1);
-        memset(buf, 0, BUF_SIZE);
-        util_read_spd_with_retry(fru_id, cpu, i, P1_OFFSET, P1_LEN, 0, buf, &dimm_present);
-        if (dimm_present) {
-            for (j = 0; j < LEN_PART_NUMBER; ++j) {
-              snprintf(pn + j, LEN_PN_STRING - j, "%c", buf[PN_OFFSET + j]);
-            }
-            for (j = 0; j < LEN_SERIAL; ++j) {
-              snprintf(sn + (2 * j), LEN_SERIAL_STRING - (2 * j), "%02X", buf[SERIAL_OFFSET + j]);
-            }
-            snprintf(manu, BUF_SIZE, "%s", manu_string(buf[MANUFACTURER_OFFSET]));
-            snprintf(week, BUF_SIZE, "20%02x Week%02x",
-                      buf[DATE_OFFSET], buf[DATE_OFFSET + 1]);
+        // page 1 to get pn, sn, manufacturer, manufacturer week
+        buf = img.page1;
+        for (j = 0; j < LEN_PART_NUMBER; ++j) {
+          snprintf(pn + j, LEN_PN_STRING - j, "%c", buf[PN_OFFSET + j]);
+        }
+        for (j = 0; j < LEN_SERIAL; ++j) {
+          snprintf(sn + (2 * j), LEN_SERIAL_STRING - (2 * j), "%02X", buf[SERIAL_OFFSET + j]);
         }
+        snprintf(manu, BUF_SIZE, "%s", manu_string(buf[MANUFACTURER_OFFSET]));
+        snprintf(week, BUF_SIZE, "20%02x Week%02x",
+                  buf[DATE_OFFSET], buf[DATE_OFFSET + 1]);
       }
 
      if (json) {
@@ -31,6 +31,19 @@
 #define LEN_PART_NUMBER    20
 #define LEN_PN_STRING      (LEN_PART_NUMBER + 1)
 
+// SPD bytes used by --serial, --part and --config, cached per DIMM
+// page 0: type, speed, capacity
+#define P0_OFFSET   0
+#define P0_LEN      20
+// page 1: manufacturer, date, serial and part number
+#define P1_OFFSET   0x40
+#define P1_LEN      0x30
+
+typedef struct {
+  uint8_t page0[P0_LEN];
+  uint8_t page1[P1_LEN];
+} spd_image_t;
+
 #define DEFAULT_DUMP_OFFSET 0
 #define DEFAULT_DUMP_LEN    0x100
 #define MAX_RETRY 3
@@ -76,6 +89,8 @@ int get_package_rank(uint8_t data);
 int util_check_me_status(uint8_t fru_id);
 int util_set_EE_page(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t page_num);
 int util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset);
+int util_read_spd(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset,
+                  uint8_t len, uint8_t *buf);
 int plat_init();
 const char * get_dimm_label(uint8_t cpu, uint8_t dimm);
 
@@ -24,19 +24,34 @@
 #include <getopt.h>
 #include <syslog.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <time.h>
 #include <pthread.h>
 #include <sys/file.h>
 #include <sys/types.h>
 
 #include <openbmc/log.h>
 #include <openbmc/misc-utils.h>
+#include <openbmc/obmc-mmc.h>
 
 #define DAEMON_NAME          "emmcd"
 
+#define EMMC_BLK_DEV         "/dev/mmcblk0"
+#define EMMC_BLK_STAT_FILE   "/sys/block/mmcblk0/stat"
 #define EMMC_DEV_DIR         "/sys/bus/mmc/devices/mmc0:0001"
 #define EMMC_PRE_EOL_FILE    EMMC_DEV_DIR "/pre_eol_info"
 #define EMMC_LIFE_TIME_FILE  EMMC_DEV_DIR "/life_time"
 
+/* Block device statistics count 512-byte sectors */
+#define EMMC_SECTOR_SIZE     512
+
+/* Processes tracked by emmc_log_top_writers() */
+#define EMMC_MAX_WRITERS     512
+#define EMMC_TOP_WRITERS     3
+
 /*
  * eMMC Pre EOL definitions.
  * Refer to JEDEC Standard, EXT_CSD[267] PRE_EOL_INFO for details.
@@ -107,10 +122,28 @@ static int verbose_logging = 0;
 
 static struct {
   unsigned int check_interval;
+  unsigned int stat_interval;
+  unsigned long write_budget;  /* MiB per day */
 } emmcd_config = {
   .check_interval = 36000,  /* 10 hours */
+  .stat_interval = 3600,    /* 1 hour */
+  .write_budget = 1024,
 };
 
+/*
+ * The health snapshot published for consumers (rest-api, mmc tools),
+ * updated by both monitor threads.
+ */
+static mmc_health_snapshot_t emmc_snapshot;
+static pthread_mutex_t emmc_snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void emmc_snapshot_publish(void)
+{
+  if (mmc_health_snapshot_write(EMMC_BLK_DEV, &emmc_snapshot) != 0) {
+    OBMC_ERROR(errno, "failed to publish %s health snapshot", EMMC_BLK_DEV);
+  }
+}
+
 static int read_file_helper(int fd, void *buf, size_t size)
 {
   int ret;
@@ -239,9 +272,21 @@ static int parse_emmc_life_time(unsigned long eol,
 static void *emmc_life_time_monitor(void* unused)
 {
   int eol_fd, life_time_fd;
+  mmc_dev_t *mmc;
+  mmc_extcsd_t extcsd;
 
   EMMCD_VERBOSE("life_time_monitor thread starts running");
 
+  /*
+   * The sysfs files are filled in when the card is initialized, so
+   * EXT_CSD is read from the device, and the files are the fallback.
+   */
+  mmc = mmc_dev_open(EMMC_BLK_DEV);
+  if (mmc == NULL) {
+    OBMC_ERROR(errno, "failed to open %s", EMMC_BLK_DEV);
+    fallthrough;
+  }
+
   /*
    * open files.
    */
@@ -257,9 +302,9 @@ static void *emmc_life_time_monitor(void* unused)
   }
 
   /*
-   * Terminate the thread if neither file can be opened.
+   * Terminate the thread if no source can be opened.
    */
-  if ((eol_fd < 0) && (life_time_fd < 0)) {
+  if ((mmc == NULL) && (eol_fd < 0) && (life_time_fd < 0)) {
     return NULL;
   }
 
@@ -269,17 +314,35 @@ static void *emmc_life_time_monitor(void* unused)
     unsigned long life_time_a = EMMC_LIFE_TIME_TYPE_MAX;
     unsigned long life_time_b = EMMC_LIFE_TIME_TYPE_MAX;
 
-    /*
-     * Terminate the thread if none of the data can be fetched.
-     */
-    if (emmc_read_eol(eol_fd, &eol) < 0) {
-      error++;
-    }
-    if (emmc_read_life_time(life_time_fd, &life_time_a, &life_time_b) < 0) {
-      error++;
-    }
-    if (error == 2) {
-      break;
+    if (mmc != NULL && mmc_extcsd_read(mmc, &extcsd) == 0) {
+      eol = extcsd.raw[EXT_CSD_PRE_EOL_INFO];
+      life_time_a = extcsd.raw[EXT_CSD_DEVICE_LIFE_TIME_EST_TYP_A];
+      life_time_b = extcsd.raw[EXT_CSD_DEVICE_LIFE_TIME_EST_TYP_B];
+
+      pthread_mutex_lock(&emmc_snapshot_lock);
+      memcpy(&emmc_snapshot.extcsd, &extcsd, sizeof(extcsd));
+      emmc_snapshot.extcsd_time = time(NULL);
+      emmc_snapshot_publish();
+      pthread_mutex_unlock(&emmc_snapshot_lock);
+    } else {
+      if (mmc != NULL) {
+        OBMC_WARN("failed to read EXT_CSD of %s: %s", EMMC_BLK_DEV,
+                  strerror(errno));
+      }
+
+      /*
+       * Terminate the thread if none of the data can be fetched.
+       */
+      if (emmc_read_eol(eol_fd, &eol) < 0) {
+        error++;
+      }
+      if (emmc_read_life_time(life_time_fd, &life_time_a,
+                              &life_time_b) < 0) {
+        error++;
+      }
+      if (error == 2) {
+        break;
+      }
     }
 
     /*
@@ -302,6 +365,209 @@ static void *emmc_life_time_monitor(void* unused)
     close(life_time_fd);
   if (eol_fd >= 0)
     close(eol_fd);
+  mmc_dev_close(mmc);
+  return NULL;
+}
+
+static int emmc_read_write_stat(int fd, uint64_t *ios, uint64_t *sectors)
+{
+  int ret;
+  char buf[256];
+  unsigned long long val_ios, val_sectors;
+
+  ret = read_file_helper(fd, buf, sizeof(buf) - 1);
+  if (ret < 0) {
+    return -1;
+  }
+  buf[ret] = '\0';
+
+  /*
+   * Refer to Documentation/block/stat.rst: write I/Os and write sectors
+   * are the 5th and 7th fields.
+   */
+  if (sscanf(buf, "%*u %*u %*u %*u %llu %*u %llu",
+             &val_ios, &val_sectors) != 2) {
+    OBMC_WARN("Unexpected format in file (fd=%d): %s", fd, buf);
+    return -1;
+  }
+
+  *ios = val_ios;
+  *sectors = val_sectors;
+  return 0;
+}
+
+/*
+ * Log the processes which wrote the most to block devices since the
+ * previous call, from the write_bytes of /proc/<pid>/io.
+ */
+static void emmc_log_top_writers(bool report)
+{
+  static struct {
+    pid_t pid;
+    uint64_t bytes;
+  } prev[EMMC_MAX_WRITERS], curr[EMMC_MAX_WRITERS];
+  static int num_prev;
+  struct {
+    pid_t pid;
+    uint64_t delta;
+  } top[EMMC_TOP_WRITERS] = {};
+  int i, j, num_curr = 0;
+  struct dirent *ent;
+  DIR *dir;
+
+  dir = opendir("/proc");
+  if (dir == NULL) {
+    return;
+  }
+  while ((ent = readdir(dir)) != NULL && num_curr < EMMC_MAX_WRITERS) {
+    char path[64], line[64];
+    unsigned long long bytes;
+    uint64_t delta;
+    FILE *fp;
+    pid_t pid;
+
+    if (!isdigit(ent->d_name[0])) {
+      continue;
+    }
+    pid = atoi(ent->d_name);
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+      continue;
+    }
+    bytes = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+      if (sscanf(line, "write_bytes: %llu", &bytes) == 1) {
+        break;
+      }
+    }
+    fclose(fp);
+
+    curr[num_curr].pid = pid;
+    curr[num_curr].bytes = bytes;
+    num_curr++;
+
+    delta = bytes;
+    for (i = 0; i < num_prev; i++) {
+      if (prev[i].pid == pid) {
+        if (bytes >= prev[i].bytes) {
+          delta = bytes - prev[i].bytes;
+        }
+        break;
+      }
+    }
+    for (i = 0; i < EMMC_TOP_WRITERS; i++) {
+      if (delta > top[i].delta) {
+        for (j = EMMC_TOP_WRITERS - 1; j > i; j--) {
+          top[j] = top[j - 1];
+        }
+        top[i].pid = pid;
+        top[i].delta = delta;
+        break;
+      }
+    }
+  }
+  closedir(dir);
+
+  memcpy(prev, curr, num_curr * sizeof(curr[0]));
+  num_prev = num_curr;
+
+  for (i = 0; report && i < EMMC_TOP_WRITERS && top[i].delta > 0; i++) {
+    char path[64], comm[32] = "unknown";
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", top[i].pid);
+    fp = fopen(path, "r");
+    if (fp != NULL) {
+      if (fgets(comm, sizeof(comm), fp) != NULL) {
+        comm[strcspn(comm, "\n")] = '\0';
+      }
+      fclose(fp);
+    }
+    OBMC_WARN("eMMC top writer: %s (pid %d) wrote %llu KiB",
+              comm, top[i].pid, (unsigned long long)(top[i].delta / 1024));
+  }
+}
+
+/*
+ * Track the writes to the eMMC from the block device statistics, and
+ * warn about write rates over the daily budget: the flash wears out
+ * with the data written, amplified by small writes.
+ */
+static void *emmc_write_monitor(void* unused)
+{
+  int fd;
+  time_t last_time;
+  uint64_t last_ios, last_sectors;
+
+  EMMCD_VERBOSE("write_monitor thread starts running");
+
+  fd = open(EMMC_BLK_STAT_FILE, O_RDONLY);
+  if (fd < 0) {
+    OBMC_ERROR(errno, "failed to open %s", EMMC_BLK_STAT_FILE);
+    return NULL;
+  }
+
+  if (emmc_read_write_stat(fd, &last_ios, &last_sectors) < 0) {
+    close(fd);
+    return NULL;
+  }
+  last_time = time(NULL);
+  emmc_log_top_writers(false);
+
+  while (1) {
+    uint64_t ios, sectors, window_ios, window_sectors;
+    unsigned long long rate, budget;
+    time_t now;
+
+    sleep(emmcd_config.stat_interval);
+
+    if (emmc_read_write_stat(fd, &ios, &sectors) < 0) {
+      break;
+    }
+    now = time(NULL);
+    if (now <= last_time) {
+      continue;
+    }
+
+    /* The counters restart from 0 if the device is re-probed */
+    window_ios = ios >= last_ios ? ios - last_ios : ios;
+    window_sectors = sectors >= last_sectors ? sectors - last_sectors :
+                     sectors;
+
+    pthread_mutex_lock(&emmc_snapshot_lock);
+    emmc_snapshot.stat_time = now;
+    emmc_snapshot.write_ios = ios;
+    emmc_snapshot.write_sectors = sectors;
+    emmc_snapshot.window_write_ios = window_ios;
+    emmc_snapshot.window_write_sectors = window_sectors;
+    emmc_snapshot.window_seconds = now - last_time;
+    emmc_snapshot_publish();
+    pthread_mutex_unlock(&emmc_snapshot_lock);
+
+    /* KiB per day */
+    rate = window_sectors * EMMC_SECTOR_SIZE / 1024 * 86400 /
+           (now - last_time);
+    budget = (unsigned long long)emmcd_config.write_budget * 1024;
+    if (rate > budget) {
+      OBMC_WARN("eMMC write rate %llu MiB/day over budget %lu MiB/day "
+                "(%llu writes of %llu KiB average)",
+                rate / 1024, emmcd_config.write_budget,
+                (unsigned long long)window_ios,
+                window_ios ? (unsigned long long)(window_sectors *
+                    EMMC_SECTOR_SIZE / 1024 / window_ios) : 0);
+    } else {
+      EMMCD_VERBOSE("eMMC write rate %llu MiB/day, %llu writes",
+                    rate / 1024, (unsigned long long)window_ios);
+    }
+    emmc_log_top_writers(rate > budget);
+
+    last_time = now;
+    last_ios = ios;
+    last_sectors = sectors;
+  }
+
+  close(fd);
   return NULL;
 }
 
@@ -314,12 +580,13 @@ static void dump_usage(const char *prog_name)
   } options[] = {
     {"-h|--help", "print this help message"},
     {"-v|--verbose", "enable verbose logging"},
+    {"-w|--write-budget=MiB", "daily eMMC write budget (1024 MiB)"},
     {NULL, NULL},
   };
 
   printf("Usage: %s [options]\n", prog_name);
   for (i = 0; options[i].opt != NULL; i++) {
-    printf("    %-18s - %s\n", options[i].opt, options[i].desc);
+    printf("    %-22s - %s\n", options[i].opt, options[i].desc);
   }
 }
 
@@ -329,6 +596,7 @@ int main (int argc, char * const argv[])
   struct option long_opts[] = {
     {"help",    no_argument, NULL, 'h'},
     {"verbose", no_argument, NULL, 'v'},
+    {"write-budget", required_argument, NULL, 'w'},
     {NULL,      0,           NULL, 0},
   };
   struct {
@@ -342,6 +610,11 @@ int main (int argc, char * const argv[])
       .func = emmc_life_time_monitor,
       .args = NULL,
     },
+    {
+      .name = "write_monitor",
+      .func = emmc_write_monitor,
+      .args = NULL,
+    },
 
     /* This is the last entry */
     {
@@ -354,7 +627,7 @@ int main (int argc, char * const argv[])
   while (1) {
     int opt_index = 0;
 
-    ret = getopt_long(argc, argv, "hv", long_opts, &opt_index);
+    ret = getopt_long(argc, argv, "hvw:", long_opts, &opt_index);
     if (ret == -1)
       break; /* end of arguments */
 
@@ -367,6 +640,10 @@ int main (int argc, char * const argv[])
       verbose_logging = 1;
       break;
 
+    case 'w':
+      emmcd_config.write_budget = strtoul(optarg, NULL, 0);
+      break;
+
     default:
       return -1;
     }
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * fan-pid-sim replays a recorded temperature trace through the fand step
+ * table and the PID controller of fan_pid.h, and compares the fan power
+ * and the thermal margin of both.
+ *
+ * The trace has one "<seconds> <temp-C> [<pwm-%>]" sample per line, the
+ * temperature recorded while the fans ran at <pwm> (or -P). The heat load
+ * of every sample is derived from it with a first-order airflow model:
+ *
+ *   temp = ambient + load / (leak + pwm / 100)
+ *
+ * and the temperature under each controller follows the steady state of
+ * that load with time constant <tau>. Fan power is taken as pwm^3.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <vector>
+
+#include "fan_pid.h"
+
+#define MAX_STEPS 8
+
+struct sample {
+  float time;
+  float temp;
+  float pwm;
+};
+
+/* A step of the raising/falling tables, as in the CMM fand */
+struct step {
+  float raise;
+  float fall;
+  int pwm;
+};
+
+struct sim_result {
+  float power;    /* mean fan power, % of all fans at 100% */
+  float pwm;      /* mean duty */
+  float max_temp;
+  float above;    /* seconds above the limit */
+  int changes;
+};
+
+static float ambient = 25;
+static float leak = 0.2f;
+static float tau = 60;
+static float limit = 40;
+static int fan_low = 32;
+static int fan_high = 72;
+static struct step steps[MAX_STEPS] = {
+  {31, 27, 51},
+  {36, 33, 72},
+};
+static int num_steps = 2;
+
+static void usage(void)
+{
+  fprintf(stderr,
+          "fan-pid-sim [-p <setpoint>[,<kp>,<ki>,<kd>,<feed-forward>]] "
+          "[-l <low-pct>] [-h <high-pct>]\n"
+          "\t[-s <raise>/<fall>:<pct>,...] [-P <pwm>] [-a <ambient>] "
+          "[-k <leak>] [-T <tau>] [-L <limit>] <trace>\n\n"
+          "\tsetpoint defaults to the limit - 5C\n"
+          "\tlow-pct and high-pct default to %d%% and %d%%\n"
+          "\tthe steps default to the CMM fand tables "
+          "(31/27:51,36/33:72)\n"
+          "\tpwm of the trace samples defaults to %d%%\n"
+          "\tambient defaults to %.0fC, leak to %.2f, tau to %.0fs, "
+          "limit to %.0fC\n",
+          fan_low, fan_high, fan_low, ambient, leak, tau, limit);
+  exit(1);
+}
+
+static int parse_steps(const char *arg)
+{
+  const char *p = arg;
+  int n = 0, len;
+
+  while (*p != '\0') {
+    if (n == MAX_STEPS ||
+        sscanf(p, "%f/%f:%d%n", &steps[n].raise, &steps[n].fall,
+               &steps[n].pwm, &len) != 3)
+      return -1;
+    n++;
+    p += len;
+    if (*p == ',')
+      p++;
+  }
+  num_steps = n;
+  return n > 0 ? 0 : -1;
+}
+
+static int read_trace(const char *path, float pwm,
+                      std::vector<struct sample> &trace)
+{
+  FILE *fp;
+  char line[256];
+  struct sample s;
+  int n;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (line[0] == '#')
+      continue;
+    s.pwm = pwm;
+    n = sscanf(line, "%f %f %f", &s.time, &s.temp, &s.pwm);
+    if (n < 2)
+      continue;
+    trace.push_back(s);
+  }
+  fclose(fp);
+  return trace.empty() ? -1 : 0;
+}
+
+/* Same as calculate_raising_fan_pwm()/calculate_falling_fan_pwm() */
+static int step_pwm(float temp, bool raising)
+{
+  int i, pwm = fan_low;
+
+  for (i = 0; i < num_steps; i++) {
+    if (temp >= (raising ? steps[i].raise : steps[i].fall))
+      pwm = steps[i].pwm;
+  }
+  return pwm;
+}
+
+static void simulate(const std::vector<struct sample> &trace,
+                     struct fan_pid *pid, struct sim_result *res)
+{
+  float temp = trace[0].temp, old_temp = temp;
+  float load, target, dt, duration = 0;
+  int pwm = fan_low, next, raising, falling;
+  size_t i;
+
+  memset(res, 0, sizeof(*res));
+  res->max_temp = temp;
+  for (i = 1; i < trace.size(); i++) {
+    dt = trace[i].time - trace[i - 1].time;
+    if (dt <= 0)
+      continue;
+
+    /* fand acts on the temperature it reads */
+    if (pid != NULL) {
+      next = fan_pid_update(pid, temp, dt, pwm);
+    } else {
+      raising = step_pwm(temp, true);
+      falling = step_pwm(temp, false);
+      next = pwm;
+      if (old_temp <= temp) {
+        if (raising >= pwm)
+          next = raising;
+      } else {
+        if (falling <= pwm)
+          next = falling;
+      }
+    }
+    old_temp = temp;
+    if (next != pwm)
+      res->changes++;
+    pwm = next;
+
+    load = (trace[i].temp - ambient) * (leak + trace[i].pwm / 100);
+    target = ambient + load / (leak + pwm / 100.0f);
+    temp += (target - temp) * (1 - expf(-dt / tau));
+
+    res->power += powf(pwm / 100.0f, 3) * dt;
+    res->pwm += pwm * dt;
+    if (temp > res->max_temp)
+      res->max_temp = temp;
+    if (temp > limit)
+      res->above += dt;
+    duration += dt;
+  }
+  if (duration > 0) {
+    res->power = res->power * 100 / duration;
+    res->pwm /= duration;
+  }
+}
+
+static void print_result(const char *name, const struct sim_result *res)
+{
+  printf("%-6s %8.2f %8.1f %8.1f %8.1f %8.0f %8d\n", name, res->power,
+         res->pwm, res->max_temp, limit - res->max_temp, res->above,
+         res->changes);
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<struct sample> trace;
+  struct sim_result step_res, pid_res;
+  struct fan_pid pid;
+  const char *pid_arg = NULL;
+  float pwm = -1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:l:h:s:P:a:k:T:L:")) != -1) {
+    switch (opt) {
+    case 'p':
+      pid_arg = optarg;
+      break;
+    case 'l':
+      fan_low = atoi(optarg);
+      break;
+    case 'h':
+      fan_high = atoi(optarg);
+      break;
+    case 's':
+      if (parse_steps(optarg) != 0)
+        usage();
+      break;
+    case 'P':
+      pwm = atof(optarg);
+      break;
+    case 'a':
+      ambient = atof(optarg);
+      break;
+    case 'k':
+      leak = atof(optarg);
+      break;
+    case 'T':
+      tau = atof(optarg);
+      break;
+    case 'L':
+      limit = atof(optarg);
+      break;
+    default:
+      usage();
+      break;
+    }
+  }
+  if (optind + 1 != argc || tau <= 0 || leak <= 0)
+    usage();
+  if (pwm < 0)
+    pwm = fan_low;
+
+  fan_pid_init(&pid, limit - 5, fan_low, fan_high);
+  if (pid_arg != NULL && fan_pid_parse(&pid, pid_arg) != 0)
+    usage();
+
+  if (read_trace(argv[optind], pwm, trace) != 0) {
+    fprintf(stderr, "no samples in %s\n", argv[optind]);
+    return 1;
+  }
+
+  simulate(trace, NULL, &step_res);
+  simulate(trace, &pid, &pid_res);
+
+  printf("%zu samples, %.0fs, PID setpoint %.1fC (kp %.2f ki %.3f kd %.2f "
+         "feed-forward %.0f%%)\n\n",
+         trace.size(), trace.back().time - trace.front().time,
+         pid.setpoint, pid.kp, pid.ki, pid.kd, pid.feed_forward);
+  printf("%-6s %8s %8s %8s %8s %8s %8s\n", "mode", "power%", "pwm%",
+         "max-C", "margin", "above-s", "changes");
+  print_result("step", &step_res);
+  print_result("pid", &pid_res);
+  return 0;
+}
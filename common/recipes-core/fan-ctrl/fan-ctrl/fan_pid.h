@@ -0,0 +1,162 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __FAN_PID_H__
+#define __FAN_PID_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * PID controller for the fand control loop, an alternative to the
+ * temperature step tables.
+ *
+ * The fan duty (in percent) is
+ *
+ *   feed_forward + kp * e + ki * integral(e) + kd * d(temp)/dt
+ *
+ * with e = temp - setpoint: <feed_forward> is the duty expected to hold
+ * the setpoint, the integral trims it. The derivative is taken on the
+ * temperature rather than the error, so a setpoint change causes no kick.
+ *
+ * The integral only moves while the output is not saturated in the
+ * direction of the error (anti-windup), the output moves at most
+ * <max_rate> percent per second, and changes smaller than <deadband>
+ * percent are not applied, to keep the fans from toggling constantly.
+ */
+struct fan_pid {
+  /* configuration */
+  float setpoint;     /* C */
+  float kp;           /* % per C */
+  float ki;           /* % per C*s */
+  float kd;           /* % per C/s */
+  float feed_forward; /* % */
+  float max_rate;     /* % per s, 0 for no limit */
+  int deadband;       /* % */
+  int out_min;        /* % */
+  int out_max;        /* % */
+
+  /* state */
+  float integral;     /* C*s */
+  float last_temp;
+  bool started;
+};
+
+#define FAN_PID_KP 4.0f
+#define FAN_PID_KI 0.05f
+#define FAN_PID_KD 0.0f
+#define FAN_PID_MAX_RATE 2.0f
+#define FAN_PID_DEADBAND 2
+
+static inline void fan_pid_init(struct fan_pid *pid, float setpoint,
+                                int out_min, int out_max)
+{
+  pid->setpoint = setpoint;
+  pid->kp = FAN_PID_KP;
+  pid->ki = FAN_PID_KI;
+  pid->kd = FAN_PID_KD;
+  pid->feed_forward = (out_min + out_max) / 2.0f;
+  pid->max_rate = FAN_PID_MAX_RATE;
+  pid->deadband = FAN_PID_DEADBAND;
+  pid->out_min = out_min;
+  pid->out_max = out_max;
+  pid->integral = 0;
+  pid->last_temp = 0;
+  pid->started = false;
+}
+
+/*
+ * Parse "<setpoint>[,<kp>[,<ki>[,<kd>[,<feed-forward>]]]]" of the fand
+ * command line into <pid>, initialized by fan_pid_init().
+ * Return 0 for success, or -1 on a malformed argument.
+ */
+static inline int fan_pid_parse(struct fan_pid *pid, const char *arg)
+{
+  float val[5];
+  int n;
+
+  n = sscanf(arg, "%f,%f,%f,%f,%f", &val[0], &val[1], &val[2], &val[3],
+             &val[4]);
+  if (n < 1)
+    return -1;
+  pid->setpoint = val[0];
+  if (n > 1)
+    pid->kp = val[1];
+  if (n > 2)
+    pid->ki = val[2];
+  if (n > 3)
+    pid->kd = val[3];
+  if (n > 4)
+    pid->feed_forward = val[4];
+  return 0;
+}
+
+/*
+ * Compute the fan duty for temperature <temp>, <dt> seconds after the
+ * previous update; <current> is the duty the fans run at now (which may
+ * have been forced elsewhere, e.g. to max after a fan failure).
+ */
+static inline int fan_pid_update(struct fan_pid *pid, float temp, float dt,
+                                 int current)
+{
+  float error = temp - pid->setpoint;
+  float deriv = 0, integral, out, step;
+  int deadband, duty;
+
+  if (pid->started && dt > 0)
+    deriv = (temp - pid->last_temp) / dt;
+  pid->last_temp = temp;
+  pid->started = true;
+
+  integral = pid->integral + error * dt;
+  out = pid->feed_forward + pid->kp * error + pid->ki * integral +
+        pid->kd * deriv;
+  if ((out > pid->out_max && error > 0) ||
+      (out < pid->out_min && error < 0)) {
+    /* Saturated: leave the integral where it was */
+    out -= pid->ki * (integral - pid->integral);
+  } else {
+    pid->integral = integral;
+  }
+
+  if (out > pid->out_max)
+    out = pid->out_max;
+  if (out < pid->out_min)
+    out = pid->out_min;
+
+  deadband = pid->deadband;
+  if (pid->max_rate > 0 && dt > 0) {
+    step = pid->max_rate * dt;
+    if (out > current + step)
+      out = current + step;
+    if (out < current - step)
+      out = current - step;
+    /* A rate limited output has to be able to leave the deadband */
+    if (deadband > step)
+      deadband = (int)step;
+  }
+
+  /* Small changes are dropped unless the output reaches its limits */
+  duty = (int)(out + 0.5f);
+  if (duty - current < deadband && current - duty < deadband &&
+      duty > pid->out_min && duty < pid->out_max)
+    return current;
+  return duty;
+}
+
+#endif /* __FAN_PID_H__ */
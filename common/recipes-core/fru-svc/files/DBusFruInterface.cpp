@@ -45,6 +45,9 @@ static const char* xml =
 "      <arg type='s' name='binFilePath' direction='in'/>"
 "      <arg type='b' name='status' direction='out'/>"
 "    </method>"
+"    <method name='fruIdRefresh'>"
+"      <arg type='b' name='status' direction='out'/>"
+"    </method>"
 "  </interface>"
 "</node>";
 
@@ -117,6 +120,19 @@ void DBusFruInterface::fruIdWriteBinaryData(GVariant*              parameters,
   }
 }
 
+void DBusFruInterface::fruIdRefresh(GDBusMethodInvocation* invocation,
+                                    gpointer               arg){
+  FRU* fru = static_cast<FRU*>(arg);
+  LOG(INFO) << "fruIdRefresh " << fru->getName();
+
+  if (fru->fruIdRefresh()) {
+    g_dbus_method_invocation_return_value (invocation,  g_variant_new ("(b)", TRUE));
+  }
+  else {
+    g_dbus_method_invocation_return_value (invocation,  g_variant_new ("(b)", FALSE));
+  }
+}
+
 void DBusFruInterface::methodCallBack(GDBusConnection*       connection,
                                       const char*            sender,
                                       const char*            objectPath,
@@ -137,6 +153,9 @@ void DBusFruInterface::methodCallBack(GDBusConnection*       connection,
   else if (g_strcmp0(methodName, "fruIdWriteBinaryData") == 0) {
     fruIdWriteBinaryData(parameters, invocation, arg);
   }
+  else if (g_strcmp0(methodName, "fruIdRefresh") == 0) {
+    fruIdRefresh(invocation, arg);
+  }
 }
 
 } // namespace qin
@@ -75,6 +75,13 @@ class DBusFruInterface: public DBusInterfaceBase {
     static void fruIdWriteBinaryData(GVariant*              parameters,
                                      GDBusMethodInvocation* invocation,
                                      gpointer               arg);
+
+    /**
+     * Callback for fruIdRefresh method,
+     * reads fruID information from the eeprom again instead of the cache
+     */
+    static void fruIdRefresh(GDBusMethodInvocation* invocation,
+                             gpointer               arg);
 };
 } // namespace qin
 } // namespace openbmc
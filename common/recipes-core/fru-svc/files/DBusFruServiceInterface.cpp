@@ -18,6 +18,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <map>
 #include <string>
 #include <glog/logging.h>
 #include <gio/gio.h>
@@ -46,6 +47,9 @@ static const char* xml =
   "      <arg type='s' name='fruPath' direction='in'/>"
   "      <arg type='b' name='status' direction='out'/>"
   "    </method>"
+  "    <method name='getAllFruIdInfo'>"
+  "      <arg type='a{sa{ss}}' name='fruIdInfo' direction='out'/>"
+  "    </method>"
   "  </interface>"
   "</node>";
 
@@ -141,6 +145,48 @@ void DBusFruServiceInterface::removeFRU(GDBusMethodInvocation* invocation,
                                          g_variant_new ("(b)", status));
 }
 
+/**
+ * Helper function to collect the FRUs of the subtree at obj by path
+ */
+static void collectFRUs(Object* obj, std::map<std::string, FRU*> &frus) {
+  for (auto &it : obj->getChildMap()) {
+    FRU* fru = dynamic_cast<FRU*>(it.second);
+    if (fru != nullptr) {
+      frus.emplace(fru->getObjectPath(), fru);
+    }
+    collectFRUs(it.second, frus);
+  }
+}
+
+void DBusFruServiceInterface::getAllFruIdInfo(
+                                    GDBusMethodInvocation* invocation,
+                                    FruObjectTree*         fruTree,
+                                    const char*            objectPath) {
+  std::map<std::string, FRU*> frus;
+  GVariantBuilder builder;
+
+  Object* obj = fruTree->getObject(objectPath);
+  if (obj != nullptr) {
+    collectFRUs(obj, frus);
+  }
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sa{ss}}"));
+  for (auto &it : frus) {
+    g_variant_builder_open(&builder, G_VARIANT_TYPE("{sa{ss}}"));
+    g_variant_builder_add(&builder, "s", it.first.c_str());
+    g_variant_builder_open(&builder, G_VARIANT_TYPE("a{ss}"));
+    for (auto &info : it.second->getFruIdInfoList()) {
+      g_variant_builder_add(&builder, "{ss}",
+                            info.first.c_str(), info.second.c_str());
+    }
+    g_variant_builder_close(&builder);
+    g_variant_builder_close(&builder);
+  }
+
+  g_dbus_method_invocation_return_value(invocation,
+                                        g_variant_new("(a{sa{ss}})", &builder));
+}
+
 void DBusFruServiceInterface::methodCallBack(
                                      GDBusConnection*       connection,
                                      const char*            sender,
@@ -164,6 +210,9 @@ void DBusFruServiceInterface::methodCallBack(
   else if (g_strcmp0(methodName, "removeFRU") == 0) {
     removeFRU(invocation, parameters, fruTree, objectPath);
   }
+  else if (g_strcmp0(methodName, "getAllFruIdInfo") == 0) {
+    getAllFruIdInfo(invocation, fruTree, objectPath);
+  }
 }
 
 } // namespace qin
@@ -77,6 +77,14 @@ class DBusFruServiceInterface: public DBusInterfaceBase {
                           GVariant*              parameters,
                           FruObjectTree*         fruTree,
                           const char*            objectPath);
+
+    /**
+     * Callback for getAllFruIdInfo method, returns fruId information of
+     * every FRU under FruService keyed by object path, in one reply
+     */
+    static void getAllFruIdInfo(GDBusMethodInvocation* invocation,
+                                FruObjectTree*         fruTree,
+                                const char*            objectPath);
 };
 
 } // namespace qin
@@ -64,6 +64,17 @@ class FRU : public Object {
       }
     }
 
+    /*
+     * Reads fruId information from the device again, e.g. after it was
+     * changed by other tools
+     * Returns whether fruId information is available
+     */
+    bool fruIdRefresh() {
+      fruIdAccess_.get()->refresh();
+      fruIdInfoList_ = fruIdAccess_.get()->getFruIdInfoList();
+      return !fruIdInfoList_.empty();
+    }
+
     /*
      * Dumps fruId binary data at destFilePath
      * Returns status of operation
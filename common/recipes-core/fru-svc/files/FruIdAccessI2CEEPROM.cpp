@@ -29,8 +29,11 @@
 namespace openbmc {
 namespace qin {
 
-std::vector<std::pair<std::string, std::string>> FruIdAccessI2CEEPROM::getFruIdInfoList() {
-  std::vector<std::pair<std::string, std::string>> fruIdInfoList;
+bool FruIdAccessI2CEEPROM::readImage() {
+  if (!image_.empty()) {
+    return true;
+  }
+
   std::ifstream eepromFile;
 
   //open eeprom file
@@ -41,86 +44,15 @@ std::vector<std::pair<std::string, std::string>> FruIdAccessI2CEEPROM::getFruIdI
     int size = eepromFile.tellg();
 
     if (size >= FRUID_SIZE) {
-      unsigned char fruIdData[FRUID_SIZE] = {0};
-      fruid_info_t fruid;
+      std::vector<unsigned char> image(FRUID_SIZE, 0);
 
       //Get binary data from eepromFile
       eepromFile.seekg (0, std::ios::beg);
-      eepromFile.read ((char*)fruIdData, FRUID_SIZE);
-
-      // parse fruId from eepromFile dump
-      fruid_parse_eeprom(fruIdData, FRUID_SIZE, &fruid);
-
-      //decode struct fruid and stored it in map
-      if (fruid.chassis.flag == 1) {
-        fruIdInfoList.push_back({"Chassis Type", std::string(fruid.chassis.type_str)});
-        fruIdInfoList.push_back({"Chassis Part Number", std::string(fruid.chassis.part)});
-        fruIdInfoList.push_back({"Chassis Serial Number", std::string(fruid.chassis.serial)});
-        if (fruid.chassis.custom1 != nullptr) {
-          fruIdInfoList.push_back({"Chassis Custom Data 1", std::string(fruid.chassis.custom1)});
-        }
-        if (fruid.chassis.custom2 != nullptr) {
-          fruIdInfoList.push_back({"Chassis Custom Data 2", std::string(fruid.chassis.custom2)});
-        }
-        if (fruid.chassis.custom3 != nullptr) {
-          fruIdInfoList.push_back({"Chassis Custom Data 3", std::string(fruid.chassis.custom3)});
-        }
-        if (fruid.chassis.custom4 != nullptr) {
-          fruIdInfoList.push_back({"Chassis Custom Data 4", std::string(fruid.chassis.custom4)});
-        }
-      }
-      else {
-        LOG(INFO) << "Chassis Info not set";
-      }
-
-      if (fruid.board.flag == 1) {
-        fruIdInfoList.push_back({"Board Mfg Date", std::string(fruid.board.mfg_time_str)});
-        fruIdInfoList.push_back({"Board Manufacturer", std::string(fruid.board.mfg)});
-        fruIdInfoList.push_back({"Board Product", std::string(fruid.board.name)});
-        fruIdInfoList.push_back({"Board Serial", std::string(fruid.board.serial)});
-        fruIdInfoList.push_back({"Board Part Number", std::string(fruid.board.part)});
-        fruIdInfoList.push_back({"Board Fru Id", std::string(fruid.board.fruid)});
-        if (fruid.board.custom1 != nullptr) {
-          fruIdInfoList.push_back({"Board Custom Data 1", std::string(fruid.board.custom1)});
-        }
-        if (fruid.board.custom2 != nullptr) {
-          fruIdInfoList.push_back({"Board Custom Data 2", std::string(fruid.board.custom2)});
-        }
-        if (fruid.board.custom3 != nullptr) {
-          fruIdInfoList.push_back({"Board Custom Data 3", std::string(fruid.board.custom3)});
-        }
-        if (fruid.board.custom4 != nullptr) {
-          fruIdInfoList.push_back({"Board Custom Data 4", std::string(fruid.board.custom4)});
-        }
-
-      }
-      else {
-        LOG(INFO) << "Board Info not set";
-      }
-
-      if (fruid.product.flag == 1) {
-        fruIdInfoList.push_back({"Product Manufacturer", std::string(fruid.product.mfg)});
-        fruIdInfoList.push_back({"Product Name", std::string(fruid.product.name)});
-        fruIdInfoList.push_back({"Product Part Number", std::string(fruid.product.part)});
-        fruIdInfoList.push_back({"Product Version", std::string(fruid.product.version)});
-        fruIdInfoList.push_back({"Product Serial", std::string(fruid.product.serial)});
-        fruIdInfoList.push_back({"Product Asset Tag", std::string(fruid.product.asset_tag)});
-        fruIdInfoList.push_back({"Product Fru Id", std::string(fruid.product.fruid)});
-        if (fruid.product.custom1 != nullptr) {
-          fruIdInfoList.push_back({"Product Custom Data 1", std::string(fruid.product.custom1)});
-        }
-        if (fruid.product.custom2 != nullptr) {
-          fruIdInfoList.push_back({"Product Custom Data 2", std::string(fruid.product.custom2)});
-        }
-        if (fruid.product.custom3 != nullptr) {
-          fruIdInfoList.push_back({"Product Custom Data 3", std::string(fruid.product.custom3)});
-        }
-        if (fruid.product.custom4 != nullptr) {
-          fruIdInfoList.push_back({"Product Custom Data 4", std::string(fruid.product.custom4)});
-        }
+      if (eepromFile.read ((char*)image.data(), FRUID_SIZE)) {
+        image_.swap(image);
       }
       else {
-        LOG(INFO) << "Product Info not set";
+        LOG(ERROR) << "Could not read " << FRUID_SIZE << " bytes from " << eepromPath_;
       }
     }
     else {
@@ -134,7 +66,99 @@ std::vector<std::pair<std::string, std::string>> FruIdAccessI2CEEPROM::getFruIdI
     LOG(ERROR) << "File " << eepromPath_ << " does not exists";
   }
 
-  return fruIdInfoList;
+  return !image_.empty();
+}
+
+std::vector<std::pair<std::string, std::string>> FruIdAccessI2CEEPROM::getFruIdInfoList() {
+  if (parsed_ || !readImage()) {
+    //Not read yet if the eeprom is not available, try again next time
+    return fruIdInfoList_;
+  }
+
+  fruid_info_t fruid;
+
+  // parse fruId from eepromFile dump
+  if (fruid_parse_eeprom(image_.data(), FRUID_SIZE, &fruid) != 0) {
+    LOG(ERROR) << "FRUID parse failed for " << eepromPath_;
+    parsed_ = true;
+    return fruIdInfoList_;
+  }
+
+  //decode struct fruid and stored it in map
+  if (fruid.chassis.flag == 1) {
+    fruIdInfoList_.push_back({"Chassis Type", std::string(fruid.chassis.type_str)});
+    fruIdInfoList_.push_back({"Chassis Part Number", std::string(fruid.chassis.part)});
+    fruIdInfoList_.push_back({"Chassis Serial Number", std::string(fruid.chassis.serial)});
+    if (fruid.chassis.custom1 != nullptr) {
+      fruIdInfoList_.push_back({"Chassis Custom Data 1", std::string(fruid.chassis.custom1)});
+    }
+    if (fruid.chassis.custom2 != nullptr) {
+      fruIdInfoList_.push_back({"Chassis Custom Data 2", std::string(fruid.chassis.custom2)});
+    }
+    if (fruid.chassis.custom3 != nullptr) {
+      fruIdInfoList_.push_back({"Chassis Custom Data 3", std::string(fruid.chassis.custom3)});
+    }
+    if (fruid.chassis.custom4 != nullptr) {
+      fruIdInfoList_.push_back({"Chassis Custom Data 4", std::string(fruid.chassis.custom4)});
+    }
+  }
+  else {
+    LOG(INFO) << "Chassis Info not set";
+  }
+
+  if (fruid.board.flag == 1) {
+    fruIdInfoList_.push_back({"Board Mfg Date", std::string(fruid.board.mfg_time_str)});
+    fruIdInfoList_.push_back({"Board Manufacturer", std::string(fruid.board.mfg)});
+    fruIdInfoList_.push_back({"Board Product", std::string(fruid.board.name)});
+    fruIdInfoList_.push_back({"Board Serial", std::string(fruid.board.serial)});
+    fruIdInfoList_.push_back({"Board Part Number", std::string(fruid.board.part)});
+    fruIdInfoList_.push_back({"Board Fru Id", std::string(fruid.board.fruid)});
+    if (fruid.board.custom1 != nullptr) {
+      fruIdInfoList_.push_back({"Board Custom Data 1", std::string(fruid.board.custom1)});
+    }
+    if (fruid.board.custom2 != nullptr) {
+      fruIdInfoList_.push_back({"Board Custom Data 2", std::string(fruid.board.custom2)});
+    }
+    if (fruid.board.custom3 != nullptr) {
+      fruIdInfoList_.push_back({"Board Custom Data 3", std::string(fruid.board.custom3)});
+    }
+    if (fruid.board.custom4 != nullptr) {
+      fruIdInfoList_.push_back({"Board Custom Data 4", std::string(fruid.board.custom4)});
+    }
+
+  }
+  else {
+    LOG(INFO) << "Board Info not set";
+  }
+
+  if (fruid.product.flag == 1) {
+    fruIdInfoList_.push_back({"Product Manufacturer", std::string(fruid.product.mfg)});
+    fruIdInfoList_.push_back({"Product Name", std::string(fruid.product.name)});
+    fruIdInfoList_.push_back({"Product Part Number", std::string(fruid.product.part)});
+    fruIdInfoList_.push_back({"Product Version", std::string(fruid.product.version)});
+    fruIdInfoList_.push_back({"Product Serial", std::string(fruid.product.serial)});
+    fruIdInfoList_.push_back({"Product Asset Tag", std::string(fruid.product.asset_tag)});
+    fruIdInfoList_.push_back({"Product Fru Id", std::string(fruid.product.fruid)});
+    if (fruid.product.custom1 != nullptr) {
+      fruIdInfoList_.push_back({"Product Custom Data 1", std::string(fruid.product.custom1)});
+    }
+    if (fruid.product.custom2 != nullptr) {
+      fruIdInfoList_.push_back({"Product Custom Data 2", std::string(fruid.product.custom2)});
+    }
+    if (fruid.product.custom3 != nullptr) {
+      fruIdInfoList_.push_back({"Product Custom Data 3", std::string(fruid.product.custom3)});
+    }
+    if (fruid.product.custom4 != nullptr) {
+      fruIdInfoList_.push_back({"Product Custom Data 4", std::string(fruid.product.custom4)});
+    }
+  }
+  else {
+    LOG(INFO) << "Product Info not set";
+  }
+
+  free_fruid_info(&fruid);
+  parsed_ = true;
+  return fruIdInfoList_;
 }
 
 bool FruIdAccessI2CEEPROM::writeBinaryData(const std::string & binFilePath){
@@ -159,6 +183,8 @@ bool FruIdAccessI2CEEPROM::writeBinaryData(const std::string & binFilePath){
         //Write to eepromPath_
         std::string command = "dd if=" + binFilePath + " of=" + eepromPath_ + " bs=" + std::to_string(FRUID_SIZE) + " count=1";
         if (system(command.c_str()) == EXIT_SUCCESS) {
+          //eeprom changed, read it again
+          refresh();
           return true;
         }
         else{
@@ -183,40 +209,19 @@ bool FruIdAccessI2CEEPROM::writeBinaryData(const std::string & binFilePath){
 }
 
 bool FruIdAccessI2CEEPROM::dumpBinaryData(const std::string & destFilePath){
-  std::ifstream eepromFile;
   std::ofstream outFile;
-  eepromFile.open(eepromPath_, std::ios::in | std::ios::binary | std::ios::ate);
-
-  if (eepromFile.is_open()) {
-    //Get size of eepromFile
-    int size = eepromFile.tellg();
-    if (size >= FRUID_SIZE) {
-      unsigned char fruIdData[FRUID_SIZE] = {0};
 
-      //Get binary data from eepromFile
-      eepromFile.seekg (0, std::ios::beg);
-      eepromFile.read ((char*)fruIdData, FRUID_SIZE);
-
-      //write data to destFilePath
-      outFile.open(destFilePath, std::ios::binary);
-      if(outFile.is_open()) {
-        outFile.write((char*)fruIdData, FRUID_SIZE);
-        outFile.close();
-        return true;
-      }
-      else {
-        LOG(ERROR) << "Unable to create file " << destFilePath;
-      }
+  if (readImage()) {
+    //write data to destFilePath
+    outFile.open(destFilePath, std::ios::binary);
+    if(outFile.is_open()) {
+      outFile.write((char*)image_.data(), FRUID_SIZE);
+      outFile.close();
+      return true;
     }
     else {
-      LOG(ERROR) << "File " << eepromPath_ << " size " << size << " is less than " << FRUID_SIZE;
+      LOG(ERROR) << "Unable to create file " << destFilePath;
     }
-
-    //close eepromFile
-    eepromFile.close();
-  }
-  else {
-    LOG(ERROR) << "File " << eepromPath_ << " does not exists";
   }
 
   return false;
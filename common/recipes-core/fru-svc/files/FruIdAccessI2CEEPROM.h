@@ -19,6 +19,8 @@
  */
 
 #pragma once
+#include <string>
+#include <vector>
 #include "FruIdAccessMechanism.h"
 
 namespace openbmc {
@@ -28,6 +30,17 @@ class FruIdAccessI2CEEPROM : public FruIdAccessMechanism {
   private:
     std::string eepromPath_;               //path for eeprom file
     static const int FRUID_SIZE = 512;     //FRUID size in eeprom file
+    std::vector<unsigned char> image_;     //FRUID read from eeprom,
+                                           //empty until read
+    bool parsed_{false};                   //fruIdInfoList_ decoded
+    std::vector<std::pair<std::string, std::string>> fruIdInfoList_;
+                                           //FruId information of image_
+
+    /*
+     * Reads image_ from eeprom file at eepromPath_ unless already read.
+     * Returns whether image_ is available.
+     */
+    bool readImage();
 
   public:
     /*
@@ -37,7 +50,8 @@ class FruIdAccessI2CEEPROM : public FruIdAccessMechanism {
 
     /*
      * Parses FruId information from eeprom file at eepromPath_
-     * and returns vector represensation FruId information
+     * and returns vector represensation FruId information.
+     * The eeprom is read and parsed once, until refresh().
      */
     std::vector<std::pair<std::string, std::string>> getFruIdInfoList() override;
 
@@ -53,6 +67,15 @@ class FruIdAccessI2CEEPROM : public FruIdAccessMechanism {
      * Returns status of operation
      */
     virtual bool dumpBinaryData(const std::string & destFilePath) override;
+
+    /*
+     * Drops the cached image and FruId information
+     */
+    void refresh() override {
+      image_.clear();
+      fruIdInfoList_.clear();
+      parsed_ = false;
+    }
 };
 
 } // namespace qin
@@ -28,6 +28,7 @@ namespace qin {
  */
 class FruIdAccessMechanism {
   public:
+    virtual ~FruIdAccessMechanism() {}
 
     /*
      * Returns vector represensation FruId information
@@ -45,6 +46,12 @@ class FruIdAccessMechanism {
      * Returns status of operation
      */
     virtual bool dumpBinaryData(const std::string & destFilePath) = 0;
+
+    /*
+     * Drops any cached FruId information, so that it is read again
+     * from the device
+     */
+    virtual void refresh() {}
 };
 
 } // namespace qin
@@ -29,8 +29,10 @@
 
 #define FRU_SVC_DBUS_NAME "org.openbmc.FruService"
 #define FRU_SVC_BASE_PATH "/org/openbmc/FruService"
+#define FRU_SVC_INTERFACE "org.openbmc.FruService"
 #define FRU_SVC_FRU_OBJECT_INTERFACE "org.openbmc.FruObject"
 #define FRU_SVC_METHOD_GET_FRUID_INFO "getFruIdInfo"
+#define FRU_SVC_METHOD_GET_ALL_FRUID_INFO "getAllFruIdInfo"
 #define FRU_SVC_METHOD_FRUID_WRITE_BIN_DATA "fruIdWriteBinaryData"
 #define FRU_SVC_METHOD_FRUID_DUMP_BIN_DATA "fruIdDumpBinaryData"
 
@@ -188,32 +190,10 @@ static void printRow(const char* str1 , const char* str2) {
 }
 
 /**
- * This gets fruId information of fru at fruPath from fru-svc over dbus
- * and prints fruid information on console
+ * Prints fruid information of fru at fruPath from an a{ss} iterator
+ * Frees iter
  */
-static void printFruIdInfo(const std::string & fruPath) {
-  GVariant *response;
-  GVariantIter *iter = nullptr;
-  GError *error = nullptr;
-
-  // Get proxy to fru object
-  GDBusProxy* proxy = getDBusProxy(fruPath.c_str(), FRU_SVC_FRU_OBJECT_INTERFACE);
-
-  // Get fruid information from fru
-  response = g_dbus_proxy_call_sync(
-      proxy,
-      FRU_SVC_METHOD_GET_FRUID_INFO,
-      nullptr,
-      G_DBUS_CALL_FLAGS_NONE,
-      -1,
-      nullptr,
-      &error);
-
-  checkDBusErrorAndExit(error);
-
-  // extract fruid info from response
-  g_variant_get(response, "(a{ss})", &iter);
-
+static void printFruIdEntries(const std::string & fruPath, GVariantIter *iter) {
   printRow("---------------------", "---------------------");
   // Get position of fruName in fruPath
   int pos = fruPath.find_last_of("/");
@@ -238,6 +218,35 @@ static void printFruIdInfo(const std::string & fruPath) {
   else{
     cout << "NA" << endl;
   }
+}
+
+/**
+ * This gets fruId information of fru at fruPath from fru-svc over dbus
+ * and prints fruid information on console
+ */
+static void printFruIdInfo(const std::string & fruPath) {
+  GVariant *response;
+  GVariantIter *iter = nullptr;
+  GError *error = nullptr;
+
+  // Get proxy to fru object
+  GDBusProxy* proxy = getDBusProxy(fruPath.c_str(), FRU_SVC_FRU_OBJECT_INTERFACE);
+
+  // Get fruid information from fru
+  response = g_dbus_proxy_call_sync(
+      proxy,
+      FRU_SVC_METHOD_GET_FRUID_INFO,
+      nullptr,
+      G_DBUS_CALL_FLAGS_NONE,
+      -1,
+      nullptr,
+      &error);
+
+  checkDBusErrorAndExit(error);
+
+  // extract fruid info from response
+  g_variant_get(response, "(a{ss})", &iter);
+  printFruIdEntries(fruPath, iter);
 
   g_variant_unref(response);
   g_object_unref(proxy);
@@ -275,7 +284,7 @@ static std::string getFruPath(const std::string & parent, const std::string & fr
  * This is recursive function to traverse fruTree at basepath
  * and print fruId information on console for each fru
  */
-static void printAllFruIdInfo(const string & basepath) {
+static void walkAllFruIdInfo(const string & basepath) {
   vector<string> list = getFruNamesFromXml(getIntrospectionXml(basepath));
 
   for (auto &it : list) {
@@ -283,8 +292,46 @@ static void printAllFruIdInfo(const string & basepath) {
     printFruIdInfo(basepath + "/" + it);
 
     //Call recursively for child frus
-    printAllFruIdInfo(basepath + "/" + it);
+    walkAllFruIdInfo(basepath + "/" + it);
+  }
+}
+
+/**
+ * Prints fruId information of all frus, fetched from fru-svc with a
+ * single getAllFruIdInfo call. Falls back to walking the tree with
+ * fru-svc versions not providing the method.
+ */
+static void printAllFruIdInfo(const string & basepath) {
+  GVariantIter *iter = nullptr;
+  GVariantIter *fruIter = nullptr;
+  GError *error = nullptr;
+  const gchar* fruPath = nullptr;
+
+  GDBusProxy* proxy = getDBusProxy(basepath.c_str(), FRU_SVC_INTERFACE);
+  GVariant *response = g_dbus_proxy_call_sync(
+      proxy,
+      FRU_SVC_METHOD_GET_ALL_FRUID_INFO,
+      nullptr,
+      G_DBUS_CALL_FLAGS_NONE,
+      -1,
+      nullptr,
+      &error);
+  g_object_unref(proxy);
+
+  if (error != nullptr &&
+      g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD)) {
+    g_error_free(error);
+    walkAllFruIdInfo(basepath);
+    return;
   }
+  checkDBusErrorAndExit(error);
+
+  g_variant_get(response, "(a{sa{ss}})", &iter);
+  while (g_variant_iter_next(iter, "{&sa{ss}}", &fruPath, &fruIter)) {
+    printFruIdEntries(fruPath, fruIter);
+  }
+  g_variant_iter_free(iter);
+  g_variant_unref(response);
 }
 
 /*
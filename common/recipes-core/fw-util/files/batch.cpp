@@ -0,0 +1,202 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <syslog.h>
+#include <sys/stat.h>
+#include <openbmc/misc-utils.h>
+#include "batch.h"
+
+using namespace std;
+
+extern std::atomic<bool> quit_process;
+
+int BatchUpdater::load(const string &manifest)
+{
+  json entries;
+
+  try {
+    ifstream ifs(manifest);
+    if (!ifs.good()) {
+      cerr << "Cannot access: " << manifest << endl;
+      return -1;
+    }
+    entries = json::parse(ifs);
+    if (!entries.is_array()) {
+      cerr << "Manifest " << manifest << " is not a JSON array" << endl;
+      return -1;
+    }
+    for (auto &e : entries) {
+      Job job;
+      string fru = e.at("fru");
+      string comp = e.at("component");
+      struct stat st;
+
+      job.image = e.at("image");
+      job.comp = Component::find_component(fru, comp);
+      if (!job.comp) {
+        cerr << "Unknown component: " << fru << " : " << comp << endl;
+        return -1;
+      }
+      if (stat(job.image.c_str(), &st) < 0) {
+        cerr << "Cannot access: " << job.image << endl;
+        return -1;
+      }
+      job.size = st.st_size;
+      job.resources.push_back("fru:" + job.comp->alias_fru());
+      if (e.contains("resources")) {
+        for (string r : e["resources"]) {
+          job.resources.push_back(r);
+        }
+      }
+      job.ret = FW_STATUS_FAILURE;
+      jobs.push_back(job);
+    }
+  } catch (json::exception &e) {
+    cerr << "Invalid manifest " << manifest << ": " << e.what() << endl;
+    return -1;
+  }
+  if (jobs.empty()) {
+    cerr << "Manifest " << manifest << " has no updates" << endl;
+    return -1;
+  }
+  return 0;
+}
+
+// The guards of a single "fw-util FRU --update", then the update
+int BatchUpdater::run_job(size_t idx)
+{
+  Job &job = jobs[idx];
+  Component *c = job.comp;
+  string name = c->fru() + " : " + c->component();
+  int lfd, ret;
+
+  if (c->is_sled_cycle_initiated()) {
+    cerr << "Upgrade of " << name << " aborted due to fw update preparing" << endl;
+    return FW_STATUS_FAILURE;
+  }
+  lfd = single_instance_lock_blocked(string("fw-util_" + c->fru()).c_str());
+  if (lfd < 0) {
+    syslog(LOG_WARNING, "Error getting single_instance_lock");
+  }
+  if (c->is_update_ongoing()) {
+    cerr << "Upgrade aborted due to ongoing upgrade on FRU: " << c->fru() << endl;
+    single_instance_unlock(lfd);
+    return FW_STATUS_FAILURE;
+  }
+  c->set_update_ongoing(60 * 10);
+  single_instance_unlock(lfd);
+
+  if (system.wait_shutdown_non_executable(2)) {
+    syslog(LOG_WARNING, "fw-util: shutdown command can still be executed after 2 seconds waiting");
+  }
+  if (system.is_reboot_ongoing()) {
+    cerr << "Upgrade of " << name << " aborted due to reboot ongoing" << endl;
+    c->set_update_ongoing(0);
+    return FW_STATUS_FAILURE;
+  }
+
+  cout << "[" << idx + 1 << "/" << jobs.size() << "] Upgrade of " << name
+       << " started" << endl;
+  auto start = chrono::steady_clock::now();
+  ret = c->update(job.image);
+  double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  c->set_update_ongoing(0);
+
+  stringstream ss;
+  ss << "[" << idx + 1 << "/" << jobs.size() << "] Upgrade of " << name;
+  if (ret == 0) {
+    c->update_finish();
+    ss << " succeeded in " << fixed << setprecision(1) << secs << "s";
+    if (secs > 0) {
+      ss << " (" << setprecision(1) << job.size / 1024.0 / secs << " KiB/s)";
+    }
+    cout << ss.str() << endl;
+  } else {
+    ss << (ret == FW_STATUS_NOT_SUPPORTED ? " not supported" : " failed");
+    cerr << ss.str() << endl;
+  }
+  return ret;
+}
+
+int BatchUpdater::run(const string &manifest)
+{
+  mutex m;
+  condition_variable cv;
+  set<string> busy;
+  vector<bool> started;
+  vector<thread> workers;
+  size_t done = 0;
+  int failed = 0;
+
+  if (load(manifest)) {
+    return -1;
+  }
+  started.assign(jobs.size(), false);
+
+  // Each worker takes the first pending update of which no resource is
+  // in use, in the order of the manifest
+  auto worker = [&]() {
+    unique_lock<mutex> lk(m);
+    while (true) {
+      size_t idx = jobs.size();
+      bool pending = false;
+
+      for (size_t i = 0; i < jobs.size(); i++) {
+        if (started[i]) {
+          continue;
+        }
+        pending = true;
+        auto &res = jobs[i].resources;
+        if (none_of(res.begin(), res.end(),
+                    [&](const string &r) { return busy.count(r); })) {
+          idx = i;
+          break;
+        }
+      }
+      if (!pending || quit_process.load()) {
+        break;
+      }
+      if (idx == jobs.size()) {
+        cv.wait(lk);
+        continue;
+      }
+      started[idx] = true;
+      busy.insert(jobs[idx].resources.begin(), jobs[idx].resources.end());
+      lk.unlock();
+      jobs[idx].ret = run_job(idx);
+      lk.lock();
+      for (auto &r : jobs[idx].resources) {
+        busy.erase(r);
+      }
+      done++;
+      cv.notify_all();
+    }
+    cv.notify_all();
+  };
+
+  size_t num = min(jobs.size(), (size_t)max(max_jobs, 1));
+  for (size_t i = 0; i < num; i++) {
+    workers.emplace_back(worker);
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+
+  for (auto &job : jobs) {
+    if (job.ret != FW_STATUS_SUCCESS) {
+      failed++;
+    }
+  }
+  if (done < jobs.size()) {
+    syslog(LOG_DEBUG, "fw-util: Terminate request handled");
+    cout << "Aborted action due to signal\n";
+  }
+  cout << jobs.size() - failed << " of " << jobs.size() << " upgrades succeeded" << endl;
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,32 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+#include <string>
+#include <vector>
+#include "fw-util.h"
+
+// Runs the updates of a manifest, a JSON array of
+//   {"fru": FRU, "component": COMPONENT, "image": IMAGE_PATH,
+//    "resources": [NAME, ...]}
+// Updates run concurrently unless they share a resource: the (alias
+// target) FRU implicitly, plus the optional named ones, e.g. the USB hub,
+// I2C bus or SPI mux the components are updated through.
+class BatchUpdater {
+  private:
+    struct Job {
+      Component *comp;
+      std::string image;
+      std::vector<std::string> resources;
+      size_t size;
+      int ret;
+    };
+    std::vector<Job> jobs;
+    int max_jobs;
+    System &system;
+    int load(const std::string &manifest);
+    int run_job(size_t idx);
+  public:
+    BatchUpdater(System &sys, int max = 4) : max_jobs(max), system(sys) {}
+    int run(const std::string &manifest);
+};
+
+#endif
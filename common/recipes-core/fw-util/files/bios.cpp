@@ -108,27 +108,13 @@ int BiosComponent::check_image(const char *path)
   return 0;
 }
 
-int BiosComponent::update(std::string image, bool force) {
+int BiosComponent::release_flash(uint8_t fruid, bool force) {
   int retry = 0, poff_retry = 3;
-  int ret = 0;
-  uint8_t fruid = 1;
   uint8_t status;
   const int max_retry_power_ctl = 3;
   const int max_retry_me_recovery = 15;
   bool setLow = true;
 
-  if (pal_get_fru_id((char *)_fru.c_str(), &fruid)) {
-    return -1;
-  }
-
-  if (!force) {
-    ret = check_image(image.c_str());
-    if (ret) {
-      sys().error << "Invalid image. Stopping the update!" << endl;
-      return -1;
-    }
-  }
-
   while (poff_retry > 0) {
     retry = max_retry_power_ctl;
     pal_set_server_power(fruid, SERVER_POWER_OFF);
@@ -180,6 +166,28 @@ int BiosComponent::update(std::string image, bool force) {
     sys().error << "ERROR: failed to Power Off Server. Stopping the update!\n";
     return -1;
   }
+  return 0;
+}
+
+int BiosComponent::update(std::string image, bool force) {
+  int ret = 0;
+  uint8_t fruid = 1;
+
+  if (pal_get_fru_id((char *)_fru.c_str(), &fruid)) {
+    return -1;
+  }
+
+  if (!force) {
+    ret = check_image(image.c_str());
+    if (ret) {
+      sys().error << "Invalid image. Stopping the update!" << endl;
+      return -1;
+    }
+  }
+
+  if (release_flash(fruid, force)) {
+    return -1;
+  }
 
   ret = GPIOSwitchedSPIMTDComponent::update(image);
 
@@ -197,6 +205,22 @@ int BiosComponent::fupdate(string image) {
   return update(image, 1);
 }
 
+int BiosComponent::dump(string image) {
+  uint8_t fruid = 1;
+  int ret;
+
+  if (pal_get_fru_id((char *)_fru.c_str(), &fruid)) {
+    return -1;
+  }
+  // The host cannot run while the flash is switched to the BMC
+  if (release_flash(fruid, false)) {
+    return -1;
+  }
+  ret = GPIOSwitchedSPIMTDComponent::dump(image);
+  reboot(fruid);
+  return ret;
+}
+
 int BiosComponent::setDeepSleepWell(bool setting) {
   return 0;
 }
@@ -9,6 +9,8 @@ class BiosComponent : public GPIOSwitchedSPIMTDComponent {
     virtual int extract_signature(const char *path, std::string &sig);
     virtual int check_image(const char *path);
     int update(std::string image, bool force);
+    // Power off the host and put the ME in recovery to free the flash
+    int release_flash(uint8_t fruid, bool force);
   public:
     BiosComponent(std::string fru, std::string comp, std::string mtd, std::string devpath, std::string dev,
       std::string shadow, bool level, std::string verp) :
@@ -20,6 +22,7 @@ class BiosComponent : public GPIOSwitchedSPIMTDComponent {
     int print_version();
     int update(std::string image) override;
     int fupdate(std::string image) override;
+    int dump(std::string image) override;
     virtual int setDeepSleepWell(bool setting);
     virtual int reboot(uint8_t fruid);
 };
@@ -6,7 +6,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <algorithm>
+#include <vector>
+#include <cctype>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <syslog.h>
 #include <openbmc/pal.h>
 #include <openbmc/kv.h>
@@ -17,13 +23,81 @@ using namespace std;
 #define BMC_RW_OFFSET               (64 * 1024)
 #define ROMX_SIZE                   (84 * 1024)
 #define META_SIZE                   (64 * 1024)
+#define COPY_BUF_SIZE               (1024 * 1024)
+#define UBOOT_VERSION_SCAN          (6 * 64 * 1024)
+#define UBOOT_PREFIX                "U-Boot "
+
+// Copy len bytes (or until EOF with SIZE_MAX) from the current offset of
+// fd_in to fd_out: in the kernel where the files allow it, else through a
+// large buffer. Returns the number of bytes copied, or -1.
+static ssize_t copy_fd(int fd_in, int fd_out, size_t len)
+{
+  size_t total = 0;
+  ssize_t rc;
+  bool in_kernel = true, use_sendfile = false;
+
+  while (in_kernel && total < len) {
+    size_t chunk = min(len - total, (size_t)0x40000000);
+    if (use_sendfile) {
+      rc = sendfile(fd_out, fd_in, NULL, chunk);
+    } else {
+      rc = copy_file_range(fd_in, NULL, fd_out, NULL, chunk, 0);
+    }
+    if (rc > 0) {
+      total += rc;
+    } else if (rc == 0) {
+      return total;
+    } else if (total == 0 && !use_sendfile && errno != EIO && errno != ENOSPC) {
+      // e.g. EXDEV, EINVAL or ENOSYS: try sendfile
+      use_sendfile = true;
+    } else if (total == 0 && errno != EIO && errno != ENOSPC) {
+      in_kernel = false;
+    } else {
+      return -1;
+    }
+  }
+  if (total == len) {
+    return total;
+  }
+
+  // Neither works for a character device (like an MTD), or old kernels
+  void *buf = NULL;
+  if (posix_memalign(&buf, getpagesize(), COPY_BUF_SIZE) != 0) {
+    return -1;
+  }
+  while (total < len) {
+    size_t to_copy = min(len - total, (size_t)COPY_BUF_SIZE);
+    ssize_t r_b = read(fd_in, buf, to_copy);
+    if (r_b < 0) {
+      if (errno == EINTR)
+        continue;
+      free(buf);
+      return -1;
+    }
+    if (r_b == 0) {
+      break;
+    }
+    for (ssize_t w_b = 0; w_b < r_b;) {
+      rc = write(fd_out, (uint8_t *)buf + w_b, r_b - w_b);
+      if (rc < 0) {
+        if (errno == EINTR)
+          continue;
+        free(buf);
+        return -1;
+      }
+      w_b += rc;
+    }
+    total += r_b;
+  }
+  free(buf);
+  return total;
+}
 
 int BmcComponent::update(string image_path)
 {
   string dev;
   int ret;
   string flash_image = image_path;
-  stringstream cmd_str;
   string comp = this->component();
   char key[MAX_KEY_LEN] = {0}, value[MAX_VALUE_LEN] = {0};
 
@@ -70,9 +144,6 @@ int BmcComponent::update(string image_path)
       close(fd_r);
       return FW_STATUS_FAILURE;
     }
-    uint8_t buf[1024];
-    size_t r_b;
-
     if (_skip_offset > _writable_offset) {
       size_t copy = _skip_offset - _writable_offset;
       int fd_d = open(dev.c_str(), O_RDONLY);
@@ -81,33 +152,20 @@ int BmcComponent::update(string image_path)
         close(fd_w);
         return FW_STATUS_FAILURE;
       }
-      while (copy > 0) {
-        size_t to_copy = copy > sizeof(buf) ? sizeof(buf) : copy;
-        r_b = read(fd_d, buf, to_copy);
-        if (r_b != to_copy) {
-          close(fd_r);
-          close(fd_w);
-          close(fd_d);
-          return FW_STATUS_FAILURE;
-        }
-        if (write(fd_w, buf, to_copy) != (int)to_copy) {
-          close(fd_r);
-          close(fd_w);
-          close(fd_d);
-          return FW_STATUS_FAILURE;
-        }
-        copy -= to_copy;
+      if (copy_fd(fd_d, fd_w, copy) != (ssize_t)copy) {
+        close(fd_r);
+        close(fd_w);
+        close(fd_d);
+        return FW_STATUS_FAILURE;
       }
       close(fd_d);
     }
 
     // Copy from r to w.
-    while ((r_b = read(fd_r, buf, 1024)) > 0) {
-      if (write(fd_w, buf, r_b) != (int)r_b) {
-        close(fd_r);
-        close(fd_w);
-        return -1;
-      }
+    if (copy_fd(fd_r, fd_w, SIZE_MAX) < 0) {
+      close(fd_r);
+      close(fd_w);
+      return -1;
     }
     close(fd_r);
     close(fd_w);
@@ -118,14 +176,13 @@ int BmcComponent::update(string image_path)
     kv_set(key, get_bmc_version().c_str(), 0, 0);
   }
 
-  cmd_str << "flashcp -v " << flash_image << " " << dev;
-  ret = sys().runcmd(cmd_str.str());
-  if (_writable_offset > 0) {
+  ret = sys().flash_mtd(flash_image, dev);
+  if (flash_image != image_path) {
     // this is a temp. file, remove it.
     remove(flash_image.c_str());
   }
 
-  // If flashcp cmd was successful, keep historical info that BMC fw was upgraded
+  // If flashing was successful, keep historical info that BMC fw was upgraded
   if (ret == 0) {
     syslog(LOG_CRIT, "BMC fw upgrade completed. Version: %s", get_bmc_version().c_str());
   }
@@ -133,6 +190,20 @@ int BmcComponent::update(string image_path)
   return ret;
 }
 
+int BmcComponent::dump(string image)
+{
+  string dev;
+
+  if (_mtd_name == "") {
+    return FW_STATUS_NOT_SUPPORTED;
+  }
+  if (!sys().get_mtd_name(_mtd_name, dev)) {
+    sys().error << "Failed to get device for " << _mtd_name << endl;
+    return FW_STATUS_FAILURE;
+  }
+  return sys().dump_mtd(dev, image);
+}
+
 std::string BmcComponent::get_bmc_version()
 {
   std::string bmc_ver = "NA";
@@ -173,33 +244,93 @@ std::string BmcComponent::get_bmc_version()
   return get_bmc_version(mtd);
 }
 
+static bool is_str_char(char c)
+{
+  return (c >= 0x20 && c < 0x7f) || c == '\t';
+}
+
+// "U-Boot (SPL )*20dd.dd", as grep -E of the version of an image
+static bool is_uboot_version(const char *p, const char *end)
+{
+  p += sizeof(UBOOT_PREFIX) - 1;
+  while (end - p >= 4 && !memcmp(p, "SPL ", 4)) {
+    p += 4;
+  }
+  return end - p >= 7 && p[0] == '2' && p[1] == '0' && isdigit(p[2]) &&
+    isdigit(p[3]) && p[4] == '.' && isdigit(p[5]) && isdigit(p[6]);
+}
+
+// Look for the version in buf[from, len), as strings | grep | sscanf would.
+// A candidate string which may continue past len is left for the next
+// call, unless this is the last data.
+static bool scan_uboot_version(const char *buf, size_t len, size_t &from,
+                               bool last, std::string &bmc_ver)
+{
+  const char *end = buf + len;
+  const char *p = buf + from;
+
+  while ((p = (const char *)memmem(p, end - p, UBOOT_PREFIX, sizeof(UBOOT_PREFIX) - 1))) {
+    const char *e = p, *s = p;
+    while (e < end && is_str_char(*e)) {
+      e++;
+    }
+    if (e == end && !last) {
+      from = p - buf;
+      return false;
+    }
+    if (is_uboot_version(p, e)) {
+      char *ver = NULL;
+      while (s > buf && is_str_char(s[-1])) {
+        s--;
+      }
+      std::string line(s, e);
+      line += '\n';
+      int ret = sscanf(line.c_str(), "U-Boot%*[^2]20%*2d.%*2d%*[ ]%m[^ \n]%*[ ](%*[^)])\n", &ver);
+      if (ver) {
+        if (ret == 1) {
+          bmc_ver = ver;
+        }
+        free(ver);
+        if (ret == 1) {
+          return true;
+        }
+      }
+    }
+    p = e;
+  }
+  // The prefix may be split at len
+  from = len >= sizeof(UBOOT_PREFIX) ? len - sizeof(UBOOT_PREFIX) + 1 : 0;
+  return false;
+}
+
 std::string BmcComponent::get_bmc_version(const std::string &mtd)
 {
   // parsering the image to get the version string
   std::string bmc_ver = "NA";
-  char cmd[128];
-  FILE *fp;
-
-  snprintf(cmd, sizeof(cmd),
-      "dd if=%s bs=64k count=6 2>/dev/null | strings | grep -E 'U-Boot (SPL ){,}20[[:digit:]]{2}\\.[[:digit:]]{2}'",
-      mtd.c_str());
-  fp = popen(cmd, "r");
-  if (fp) {
-    char line[256];
-    char *ver = 0;
-    while (fgets(line, sizeof(line), fp)) {
-      int ret;
-      ret = sscanf(line, "U-Boot%*[^2]20%*2d.%*2d%*[ ]%m[^ \n]%*[ ](%*[^)])\n", &ver);
-      if (1 == ret) {
-        bmc_ver = ver;
-        break;
-      }
+  vector<char> buf(UBOOT_VERSION_SCAN);
+  size_t len = 0, from = 0;
+  int fd;
+
+  fd = open(mtd.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return bmc_ver;
+  }
+  // The version is usually in the first erase block; stop at it
+  while (len < buf.size()) {
+    ssize_t rc = pread(fd, buf.data() + len, min(buf.size() - len, (size_t)(64 * 1024)), len);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      scan_uboot_version(buf.data(), len, from, true, bmc_ver);
+      break;
     }
-    if (ver) {
-       free(ver);
+    len += rc;
+    if (scan_uboot_version(buf.data(), len, from, len == buf.size(), bmc_ver)) {
+      break;
     }
-    pclose(fp);
   }
+  close(fd);
 
   return bmc_ver;
 }
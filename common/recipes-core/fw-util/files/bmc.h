@@ -16,6 +16,7 @@ class BmcComponent : public Component {
       : Component(fru, comp), _mtd_name(mtd), _vers_mtd(vers), _writable_offset(w_offset), _skip_offset(skip_offset) {}
 
     int update(std::string image);
+    int dump(std::string image);
     int print_version();
     void get_version(json& j);
     virtual bool is_valid(std::string &image, bool pfr_active);
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <fstream>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 extern "C" {
   #include <libfdt.h>
@@ -240,6 +242,14 @@ class PartitionDescriptor
         throw "TYPE unknown" + type + " in " + name;
       }
     }
+    bool is_uboot()
+    {
+      return name == "uboot" || name == "u-boot";
+    }
+    off_t end()
+    {
+      return offset + size;
+    }
     bool valid(const unsigned char *image, off_t image_size)
     {
       if (image_size < offset)
@@ -274,6 +284,15 @@ class ImageDescriptor {
     }
     return true;
   }
+  // End of the U-Boot partition, 0 if there is none
+  off_t uboot_end() {
+    for (auto it = partitions.begin(); it != partitions.end(); it++) {
+      if ((*it)->is_uboot()) {
+        return (*it)->end();
+      }
+    }
+    return 0;
+  }
   ~ImageDescriptor() {
     partitions.clear();
   }
@@ -286,24 +305,17 @@ class Image {
   size_t               fsize;
   int                  fd;
   friend class         ImageDescriptorList;
-  bool match(const char *s, const char *p)
+  // Version banner of U-Boot at p: "U-Boot dddd.dd "
+  static bool is_uboot_version(const unsigned char *p)
   {
-    for (; *s != '\0' && *p != '\0'; s++, p++) {
-      bool esc = false;
-      if (*p == '\\') {
-        p++;
-        esc = true;
-      }
-      // If escaping and we are looking for a decimal
-      if (esc && *p == 'd') {
-        if (!isdigit(*s)) {
-          return false;
-        }
-      } else if (*p != *s) {
-        return false;
-      }
+    static const char prefix[] = "U-Boot ";
+
+    if (memcmp(p, prefix, sizeof(prefix) - 1) != 0) {
+      return false;
     }
-    return true;
+    p += sizeof(prefix) - 1;
+    return isdigit(p[0]) && isdigit(p[1]) && isdigit(p[2]) && isdigit(p[3]) &&
+      p[4] == '.' && isdigit(p[5]) && isdigit(p[6]) && p[7] == ' ';
   }
   bool istrncmp(const char *s1, const char *s2, size_t len)
   {
@@ -321,44 +333,64 @@ class Image {
     }
     fsize = lseek(fd, 0, SEEK_END);
     if (fsize == 0) {
+      close(fd);
       throw "Zero size image file " + string(file);
     } else if (fsize > FLASH_SIZE) {
       close(fd);
       throw string(file) + " over size ( > 32MB )";
     }
 
-    lseek(fd, 0, SEEK_SET);
-    unsigned char *img = (unsigned char *)calloc(FLASH_SIZE, 1);
-    for (int bread = 0; bread < (int)fsize;) {
-      int rc = read(fd, img + bread, fsize - bread);
-      if (rc > 0) {
-        bread += rc;
-      }
+    // The image is mapped over a zero filled range of the flash size, so
+    // the partition checks see zeros past its end, as they would reading
+    // the flash. Neither takes up memory but the pages of the file read.
+    void *base = mmap(NULL, FLASH_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      close(fd);
+      throw "Cannot map " + string(file);
     }
-    image = (const unsigned char *)img;
+    if (mmap(base, fsize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      munmap(base, FLASH_SIZE);
+      close(fd);
+      throw "Cannot map " + string(file);
+    }
+    madvise(base, fsize, MADV_SEQUENTIAL);
+    image = (const unsigned char *)base;
   }
   ~Image() {
     if (image)
-      free((void *)image);
+      munmap((void *)image, FLASH_SIZE);
     if (fd >= 0)
       close(fd);
   }
-  bool supports_machine(string &machine) {
+  // Look for the machine in the U-Boot version banner, which starts
+  // before limit (the end of the U-Boot partitions, 0 for anywhere).
+  bool supports_machine(string &machine, size_t limit) {
     // Just dont check in the last 256 bytes of the image. Technically we
     // need to find this in the uboot section so it should be pretty early on.
-    for (int i = 0; i < (int)fsize - 256; i++) {
-      const char *str = (const char *)&image[i];
-      if (isalnum(image[i]) && match(str, "U-Boot \\d\\d\\d\\d\\.\\d\\d ")) {
-        str += 15;
-        if (*str == '(') {
-          for (int j = 0; j < 32 && *str != ')'; j++, str++);
-          if (*(str++) != ')')
-            continue;
-          for (; *str == ' '; str++);
-        }
-        if (istrncmp(str, machine.c_str(), machine.size()))
-          return true;
+    size_t end = fsize > 256 ? fsize - 256 : 0;
+    if (limit > 0 && limit < end) {
+      end = limit;
+    }
+    const unsigned char *p = image, *last = image + end;
+
+    // memchr() is vectorized, the banner is checked at every 'U' only
+    for (; p < last; p++) {
+      p = (const unsigned char *)memchr(p, 'U', last - p);
+      if (p == NULL) {
+        break;
+      }
+      if (!is_uboot_version(p)) {
+        continue;
       }
+      const char *str = (const char *)p + 15;
+      if (*str == '(') {
+        for (int j = 0; j < 32 && *str != ')'; j++, str++);
+        if (*(str++) != ')')
+          continue;
+        for (; *str == ' '; str++);
+      }
+      if (istrncmp(str, machine.c_str(), machine.size()))
+        return true;
     }
     return false;
   }
@@ -397,6 +429,20 @@ class ImageDescriptorList {
   }
   ~ImageDescriptorList() {
   }
+  // End of the U-Boot partitions (and whatever precedes them, e.g. SPL
+  // and the recovery U-Boot) of any layout, 0 if a layout has none
+  size_t uboot_end()
+  {
+    off_t end = 0;
+    for (auto it = images.begin(); it != images.end(); it++) {
+      off_t e = (*it)->uboot_end();
+      if (e == 0) {
+        return 0;
+      }
+      end = max(end, e);
+    }
+    return (size_t)end;
+  }
   bool is_valid(Image &image)
   {
     for (auto it = images.begin(); it != images.end(); it++) {
@@ -413,15 +459,16 @@ bool BmcComponent::is_valid(string &file, bool pfr_active)
   try {
     Image image(file);
     string machine = sys().name();
-    if (!image.supports_machine(machine)) {
-      return false;
-    }
-    
+
+    // The layout of the partitions does not apply to PFR images
     if (pfr_active) {
-      return true;
+      return image.supports_machine(machine, 0);
     }
 
     ImageDescriptorList desc_list(sys().partition_conf().c_str());
+    if (!image.supports_machine(machine, desc_list.uboot_end())) {
+      return false;
+    }
     valid = desc_list.is_valid(image);
   } catch(string &ex) {
     cerr << ex << endl;
@@ -429,4 +476,3 @@ bool BmcComponent::is_valid(string &file, bool pfr_active)
   }
   return valid;
 }
-
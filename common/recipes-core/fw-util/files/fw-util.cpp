@@ -30,6 +30,8 @@
 #include <signal.h>
 #include <syslog.h>
 #include <atomic>
+#include <thread>
+#include <vector>
 #include <openbmc/pal.h>
 #include <openbmc/misc-utils.h>
 #ifdef __TEST__
@@ -37,8 +39,12 @@
 #endif
 #include "fw-util.h"
 #include "scheduler.h"
+#include "batch.h"
 using namespace std;
 
+// FRUs whose versions are collected at once by --version-json
+#define MAX_VERSION_JOBS 8
+
 std::atomic<bool> quit_process(false);
 
 string exec_name = "Unknown";
@@ -136,6 +142,41 @@ bool AliasComponent::is_update_ongoing()
   return _target_comp->is_update_ongoing();
 }
 
+// Fill in the versions of the components in json_array (in the same order).
+// The components of a FRU are queried one after the other, as they usually
+// share a path (the BIC of a slot, say), while up to MAX_VERSION_JOBS
+// FRUs are queried in parallel.
+static void collect_versions(vector<Component *> &comps, json &json_array)
+{
+  vector<pair<size_t, size_t>> groups;
+  atomic<size_t> next(0);
+  vector<thread> workers;
+
+  for (size_t i = 0; i < comps.size(); i++) {
+    if (groups.empty() || comps[i]->fru() != comps[groups.back().first]->fru()) {
+      groups.emplace_back(i, i);
+    }
+    groups.back().second = i + 1;
+  }
+
+  auto worker = [&]() {
+    size_t g;
+    while ((g = next++) < groups.size() && !quit_process.load()) {
+      for (size_t i = groups[g].first; i < groups[g].second; i++) {
+        comps[i]->get_version(json_array[i]);
+      }
+    }
+  };
+  size_t num = min(groups.size(), (size_t)MAX_VERSION_JOBS);
+  for (size_t i = 1; i < num; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : workers) {
+    t.join();
+  }
+}
+
 void fw_util_sig_handler(int signo)
 {
   quit_process.store(true);
@@ -150,6 +191,7 @@ void usage()
   cout << "       " << exec_name << " FRU --force --update [--]COMPONENT IMAGE_PATH" << endl;
   cout << "       " << exec_name << " FRU --dump [--]COMPONENT IMAGE_PATH" << endl;
   cout << "       " << exec_name << " FRU --update COMPONENT IMAGE_PATH --schedule now" << endl;
+  cout << "       " << exec_name << " all --update-batch MANIFEST" << endl;
   cout << "       " << exec_name << " all --show-schedule" << endl;
   cout << "       " << exec_name << " all --delete-schedule TASK_ID" << endl;
   cout << endl;
@@ -207,6 +249,7 @@ int main(int argc, char *argv[])
   string time("");
   string task_id("");
   json json_array(nullptr);
+  vector<Component *> json_comps;
   bool add_task = false;
   Scheduler tasker;
 
@@ -294,6 +337,12 @@ int main(int argc, char *argv[])
       cerr << "Upgrading all components not supported" << endl;
       return -1;
     }
+  } else if (action == "--update-batch") {
+    if (argc != 4 || fru != "all") {
+      usage();
+      return -1;
+    }
+    image.assign(argv[3]);
   } else if (action == "--version") {
     if(argc > 4) {
       usage();
@@ -328,6 +377,12 @@ int main(int argc, char *argv[])
   sigaction(SIGINT, &sa, NULL);
   sigaction(SIGTERM, &sa, NULL);
   sigaction(SIGPIPE, &sa, NULL); // for ssh terminate
+
+  if (action == "--update-batch") {
+    BatchUpdater batch(system);
+    return batch.run(image);
+  }
+
   //print the fw version or do the fw update when the fru and the comp are found
   for (auto fkv : *Component::fru_list) {
     if (fru == "all" || fru == fkv.first) {
@@ -379,9 +434,10 @@ int main(int argc, char *argv[])
                 << " on fru: " << c->fru() << endl;
             }
           } else if ( action == "--version-json" ) {
+            // Collected once all the components are known
             json j_object = {{"FRU", c->fru()}, {"COMPONENT", c->component()}};
-            c->get_version(j_object);
             json_array.push_back(j_object);
+            json_comps.push_back(c);
           } else {  // update or dump
             if (fru == "all") {
               usage();
@@ -423,7 +479,9 @@ int main(int argc, char *argv[])
             }
             c->set_update_ongoing(0);
             if (ret == 0) {
-              cout << str_act << " of " << c->fru() << " : " << component << " succeeded" << endl;
+              // A dump to "-" is the only thing on stdout
+              ostream &status = (str_act == "Dump" && image == "-") ? cerr : cout;
+              status << str_act << " of " << c->fru() << " : " << component << " succeeded" << endl;
               c->update_finish();
             } else {
               cerr << str_act << " of " << c->fru() << " : " << component;
@@ -452,6 +510,11 @@ int main(int argc, char *argv[])
   }
 
   if ( action == "--version-json" ) {
+    collect_versions(json_comps, json_array);
+    if (quit_process.load()) {
+      cout << "Aborted action due to signal\n";
+      return -1;
+    }
     cout << json_array.dump(4) << endl;
   }
 
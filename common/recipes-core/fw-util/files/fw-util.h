@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <map>
 #include <atomic>
+#include <string_view>
 #include <regex>
 #include "system_intf.h"
 #include <nlohmann/json.hpp>
@@ -19,25 +20,23 @@ using json = nlohmann::json;
 // then compare the integer parts of the strings rather than a pure lexicographical comparison.
 // tl;dr return device4 < device10 instead of the other way around.
 class partialLexCompare {
-  std::regex rx;
-  // Split string into numeric and string part.
-  void split_string(const std::string &in, std::string &out_s, int &out_i) const {
-    std::smatch sm;
-    if (std::regex_match(in, sm, rx)) {
-      out_s.assign(sm[1]);
-      out_i = std::stoi(sm[2]);
-      return;
+  // Split string into numeric and string part: what "(.+)(\d+)$" matches,
+  // the (greedy) text and the last digit, without the regex and copies as
+  // this compares every key of an insertion or find_component().
+  static std::string_view split_string(const std::string &in, int &out_i) {
+    size_t len = in.size();
+    if (len >= 2 && in[len - 1] >= '0' && in[len - 1] <= '9') {
+      out_i = in[len - 1] - '0';
+      return std::string_view(in.data(), len - 1);
     }
-    out_s.assign(in);
     out_i = -1;
+    return std::string_view(in);
   }
   public:
-    partialLexCompare() : rx(R"((.+)(\d+)$)") {}
     bool operator()(const std::string& a, const std::string& b) const {
-      std::string aa, bb;
       int ai, bi;
-      split_string(a, aa, ai);
-      split_string(b, bb, bi);
+      std::string_view aa = split_string(a, ai);
+      std::string_view bb = split_string(b, bi);
       if (aa == bb && ai >= 0 && bi >= 0) {
         return ai < bi;
       }
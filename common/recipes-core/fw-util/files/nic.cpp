@@ -1,11 +1,17 @@
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <openbmc/kv.hpp>
+#include <openbmc/ncsi.h>
+#include <openbmc/nl-wrapper.h>
+#include <openbmc/pldm.h>
 #include "nic.h"
+#include "progress.h"
 
 #define NCSI_DATA_PAYLOAD 64
 #define NCSI_MIN_DATA_PAYLOAD 36
+#define PLDM_BUF_SIZE 1024
 
 typedef struct {
   char mfg_name[10];  // manufacture name
@@ -105,19 +111,45 @@ int NicComponent::print_version() {
   return FW_STATUS_SUCCESS;
 }
 
-int NicComponent::upgrade_ncsi_util(const std::string& img, int channel)
+struct pldm_progress {
+  std::unique_ptr<Progress> progress;
+  std::string name;
+  uint64_t done;
+};
+
+static void pldm_update_progress(void *arg, uint64_t done, uint64_t total)
+{
+  auto p = static_cast<struct pldm_progress *>(arg);
+
+  // The image size is known once the package is parsed
+  if (!p->progress) {
+    p->progress.reset(new Progress(p->name, total));
+    p->progress->phase("download");
+  }
+  p->progress->advance(done - p->done);
+  p->done = done;
+}
+
+int NicComponent::upgrade_pldm(const std::string& img, int channel)
 {
-  std::string cmd = "/usr/local/bin/ncsi-util";
-  // If channel is provided, pass it to ncsi-util, else let it use a default
-  if (channel >= 0) {
-    cmd += " -c " + std::to_string(channel);
+  struct pldm_progress prog = {nullptr, _fru + "_" + _component, 0};
+  pldm_ncsi_update_t upd{};
+  std::string path(img);
+  int ret;
+
+  upd.send_nl_msg = send_nl_msg_libnl;
+  upd.pldm_bufsize = PLDM_BUF_SIZE;
+  upd.progress = pldm_update_progress;
+  upd.arg = &prog;
+  ret = ncsi_pldm_update_fw(&path[0], channel >= 0 ? channel : 0, &upd);
+  ret = ret ? FW_STATUS_FAILURE : FW_STATUS_SUCCESS;
+  if (prog.progress) {
+    prog.progress->finish(ret);
   }
-  // Double quote the image to support paths with space.
-  cmd += " -p \"" + img + "\"";
-  return sys().runcmd(cmd);
+  return ret;
 }
 
 int NicComponent::update(std::string image)
 {
-  return upgrade_ncsi_util(image);
+  return upgrade_pldm(image);
 }
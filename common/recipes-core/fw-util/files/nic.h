@@ -10,7 +10,8 @@
 class NicComponent : public Component {
   protected:
     std::string _ver_key = NIC_FW_VER_KEY;
-    int upgrade_ncsi_util(const std::string& img, int channel=-1);
+    // PLDM update over NC-SI, run in process; channel -1 is channel 0
+    virtual int upgrade_pldm(const std::string& img, int channel=-1);
     virtual int get_key(const std::string& key, std::string& buf);
   public:
     NicComponent(std::string fru, std::string comp)
@@ -67,5 +67,5 @@ int NicExtComponent::print_version() {
 
 int NicExtComponent::update(std::string img)
 {
-  return upgrade_ncsi_util(img, _ch_id);
+  return upgrade_pldm(img, _ch_id);
 }
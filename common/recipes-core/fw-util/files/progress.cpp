@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <sys/stat.h>
+#include <fstream>
+#include "progress.h"
+#include "fw-util.h"
+
+using namespace std;
+
+Progress::Progress(const string &name, size_t total)
+  : _path(string(PROGRESS_DIR) + "/" + name + ".json"), _phase("start"),
+    _done(0), _total(total), _start(chrono::steady_clock::now()), _last(_start)
+{
+  mkdir(PROGRESS_DIR, 0755);
+  write("running");
+}
+
+void Progress::write(const char *status)
+{
+  double secs = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+  double mbps = secs > 0 ? _done / secs / (1024 * 1024) : 0;
+  json j = {
+    {"phase", _phase},
+    {"bytes_done", _done},
+    {"bytes_total", _total},
+    {"percent", _total ? _done * 100 / _total : 100},
+    {"mbps", mbps},
+    {"eta_sec", mbps > 0 ? (_total - _done) / (mbps * 1024 * 1024) : -1},
+    {"status", status},
+  };
+  if (!_sha256.empty()) {
+    j["sha256"] = _sha256;
+  }
+
+  // Readers never see a partial file
+  string tmp = _path + ".tmp";
+  ofstream ofs(tmp);
+  if (!ofs.is_open()) {
+    return;
+  }
+  ofs << j.dump() << endl;
+  ofs.close();
+  rename(tmp.c_str(), _path.c_str());
+}
+
+void Progress::phase(const string &phase)
+{
+  _phase = phase;
+}
+
+void Progress::advance(size_t bytes)
+{
+  auto now = chrono::steady_clock::now();
+
+  _done += bytes;
+  if (now - _last >= chrono::milliseconds(500)) {
+    _last = now;
+    write("running");
+  }
+}
+
+void Progress::finish(int ret)
+{
+  _phase = "done";
+  write(ret == FW_STATUS_SUCCESS ? "success" : "failure");
+}
@@ -0,0 +1,33 @@
+#ifndef _PROGRESS_H_
+#define _PROGRESS_H_
+#include <string>
+#include <chrono>
+#include <cstddef>
+
+#define PROGRESS_DIR "/tmp/fw-util"
+
+// Progress of an update for automation, kept in PROGRESS_DIR/<name>.json:
+//   {"phase": ..., "bytes_done": ..., "bytes_total": ..., "percent": ...,
+//    "mbps": ..., "eta_sec": ..., "status": "running"|"success"|"failure"}
+// plus any "sha256" of the data written.
+class Progress {
+  private:
+    std::string _path;
+    std::string _phase;
+    std::string _sha256;
+    size_t _done;
+    size_t _total;
+    std::chrono::steady_clock::time_point _start;
+    std::chrono::steady_clock::time_point _last;
+    void write(const char *status);
+  public:
+    Progress(const std::string &name, size_t total);
+    // Shown from the next write
+    void phase(const std::string &phase);
+    // Account for bytes more; the file is rewritten at most twice a second.
+    void advance(size_t bytes);
+    void sha256(const std::string &hex) { _sha256 = hex; }
+    void finish(int ret);
+};
+
+#endif
@@ -10,7 +10,6 @@ using namespace std;
 int MTDComponent::update(std::string image)
 {
   string dev;
-  string cmd;
   string comp = this->component();
   int ret;
 
@@ -20,8 +19,7 @@ int MTDComponent::update(std::string image)
   syslog(LOG_CRIT, "Component %s upgrade initiated", comp.c_str());
 
   sys().output << "Flashing to device: " << dev << endl;
-  cmd = "flashcp -v " + image + " " + dev;
-  ret = sys().runcmd(cmd);
+  ret = sys().flash_mtd(image, dev);
   if (ret == 0) {
     syslog(LOG_CRIT, "Component %s upgrade completed", comp.c_str());
     return FW_STATUS_SUCCESS;
@@ -29,7 +27,17 @@ int MTDComponent::update(std::string image)
   return FW_STATUS_FAILURE;
 }
 
-int SPIMTDComponent::update(std::string image)
+int MTDComponent::dump(std::string image)
+{
+  string dev;
+
+  if (!sys().get_mtd_name(_mtd_name, dev)) {
+    return FW_STATUS_FAILURE;
+  }
+  return sys().dump_mtd(dev, image) ? FW_STATUS_FAILURE : FW_STATUS_SUCCESS;
+}
+
+int SPIMTDComponent::with_spi(const std::function<int()> &op)
 {
   string cmd;
   std::ofstream ofs;
@@ -46,7 +54,7 @@ int SPIMTDComponent::update(std::string image)
     return -1;
   }
   ofs.close();
-  rc = MTDComponent::update(image);
+  rc = op();
   ofs.open(spipath + "/unbind");
   if (!ofs.is_open()) {
     sys().error << "ERROR: Cannot unbind " << spidev << " rc=" << rc << std::endl;
@@ -57,7 +65,17 @@ int SPIMTDComponent::update(std::string image)
   return rc;
 }
 
-int GPIOSwitchedSPIMTDComponent::update(std::string  image)
+int SPIMTDComponent::update(std::string image)
+{
+  return with_spi([&]() { return MTDComponent::update(image); });
+}
+
+int SPIMTDComponent::dump(std::string image)
+{
+  return with_spi([&]() { return MTDComponent::dump(image); });
+}
+
+int GPIOSwitchedSPIMTDComponent::with_gpio(const std::function<int()> &op)
 {
   int rc;
   gpio_desc_t *desc = gpio_open_by_shadow(gpio_shadow.c_str());
@@ -70,7 +88,7 @@ int GPIOSwitchedSPIMTDComponent::update(std::string  image)
     return -1;
   }
   std::this_thread::sleep_for(std::chrono::seconds(1));
-  rc = SPIMTDComponent::update(image);
+  rc = op();
   if (gpio_set_value(desc, access_level ? GPIO_VALUE_LOW : GPIO_VALUE_HIGH) ||
       (change_direction && gpio_set_direction(desc, GPIO_DIRECTION_IN))) {
     gpio_close(desc);
@@ -80,3 +98,13 @@ int GPIOSwitchedSPIMTDComponent::update(std::string  image)
   gpio_close(desc);
   return rc;
 }
+
+int GPIOSwitchedSPIMTDComponent::update(std::string image)
+{
+  return with_gpio([&]() { return SPIMTDComponent::update(image); });
+}
+
+int GPIOSwitchedSPIMTDComponent::dump(std::string image)
+{
+  return with_gpio([&]() { return SPIMTDComponent::dump(image); });
+}
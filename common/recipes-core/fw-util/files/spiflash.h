@@ -1,6 +1,7 @@
 #ifndef _SPI_FLASH_H_
 #define _SPI_FLASH_H_
 #include <string>
+#include <functional>
 #include "fw-util.h"
 
 
@@ -13,6 +14,7 @@ class MTDComponent : public Component {
     MTDComponent(std::string fru, std::string comp, std::string mtd) :
       Component(fru, comp), _mtd_name(mtd) {}
     int update(std::string image) override;
+    int dump(std::string image) override;
 };
 
 // Upgrade SPI Flash whose partitions need to be temporarily mounted as MTD
@@ -20,10 +22,13 @@ class SPIMTDComponent : public MTDComponent {
   protected:
     std::string spipath = "/sys/bus/spi/drivers/m25p80";
     std::string spidev;
+    // Run op with the flash bound to the MTD driver
+    int with_spi(const std::function<int()> &op);
   public:
     SPIMTDComponent(std::string fru, std::string comp, std::string mtd, std::string dev) :
       MTDComponent(fru, comp, mtd), spidev(dev) {}
     int update(std::string image) override;
+    int dump(std::string image) override;
 };
 
 // These SPI devices are connected only a GPIO is asserted.
@@ -32,10 +37,13 @@ class GPIOSwitchedSPIMTDComponent : public SPIMTDComponent {
     std::string gpio_shadow;
     bool access_level;
     bool change_direction;
+    // Run op with the flash switched to the BMC
+    int with_gpio(const std::function<int()> &op);
   public:
   GPIOSwitchedSPIMTDComponent(std::string fru, std::string comp, std::string mtd, std::string dev, std::string shadow, bool level, bool change = true) :
     SPIMTDComponent(fru, comp, mtd, dev), gpio_shadow(shadow), access_level(level), change_direction(change) {}
   int update(std::string image) override;
+  int dump(std::string image) override;
 };
 
 #endif
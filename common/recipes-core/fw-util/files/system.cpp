@@ -12,15 +12,29 @@ namespace std
 #include <string>
 #include <cstdio>
 #include <cstring>
+#include <cerrno>
 #include <unistd.h>
 #include <fcntl.h>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <netdb.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <mtd/mtd-user.h>
+#include <memory>
+#include <openssl/evp.h>
 #include <openbmc/pal.h>
 #include <openbmc/vbs.h>
 #include <openbmc/kv.hpp>
 #include "fw-util.h"
+#include "progress.h"
 
 #define PAGE_SIZE                     0x1000
+#define DUMP_CHUNK_SIZE               (1024 * 1024)
 #define VERIFIED_BOOT_STRUCT_BASE     0x1E720000
 #define VERIFIED_BOOT_HARDWARE_ENFORCE(base) \
   *((uint8_t *)(base + 0x215))
@@ -43,6 +57,317 @@ int System::runcmd(const string &cmd)
   return FW_STATUS_FAILURE;
 }
 
+static bool read_full(int fd, uint8_t *buf, size_t len, off_t off)
+{
+  while (len > 0) {
+    ssize_t rc = pread(fd, buf, len, off);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    buf += rc;
+    len -= rc;
+    off += rc;
+  }
+  return true;
+}
+
+static bool write_full(int fd, const uint8_t *buf, size_t len, off_t off)
+{
+  while (len > 0) {
+    ssize_t rc = pwrite(fd, buf, len, off);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    buf += rc;
+    len -= rc;
+    off += rc;
+  }
+  return true;
+}
+
+int System::flash_mtd(const string &image, const string &dev)
+{
+  struct mtd_info_user info;
+  struct stat st;
+  int fd_img, fd_mtd;
+  int ret = FW_STATUS_FAILURE;
+  unique_ptr<Progress> progress;
+  EVP_MD_CTX *sha = NULL;
+
+  fd_mtd = open(dev.c_str(), O_RDWR | O_SYNC);
+  if (fd_mtd < 0) {
+    error << "Cannot open " << dev << ": " << strerror(errno) << endl;
+    return FW_STATUS_FAILURE;
+  }
+  if (ioctl(fd_mtd, MEMGETINFO, &info) < 0 || info.erasesize == 0) {
+    // Not an MTD (NOR) character device, leave it to flashcp
+    close(fd_mtd);
+    return runcmd("flashcp -v " + image + " " + dev);
+  }
+  fd_img = open(image.c_str(), O_RDONLY);
+  if (fd_img < 0 || fstat(fd_img, &st) < 0) {
+    error << "Cannot open " << image << ": " << strerror(errno) << endl;
+    goto bail;
+  }
+  if ((uint64_t)st.st_size > info.size) {
+    error << image << " does not fit into " << dev << endl;
+    goto bail;
+  }
+
+  progress.reset(new Progress(filesystem::path(dev).filename().string(), st.st_size));
+  // The digest of what is verified on the flash, for the status file
+  sha = EVP_MD_CTX_new();
+  if (!sha || !EVP_DigestInit_ex(sha, EVP_sha256(), NULL)) {
+    goto bail;
+  }
+
+  {
+    size_t esize = info.erasesize;
+    size_t wsize = info.writesize ? info.writesize : 1;
+    size_t blocks = (st.st_size + esize - 1) / esize;
+    size_t changed = 0;
+    vector<uint8_t> img(esize), cur(esize);
+
+    for (size_t b = 0; b < blocks; b++) {
+      off_t off = (off_t)b * esize;
+      size_t len = min<size_t>(esize, st.st_size - off);
+      // The program size rounds up the last block, padded as erased
+      size_t plen = min(esize, (len + wsize - 1) / wsize * wsize);
+
+      if (!read_full(fd_img, img.data(), len, off)) {
+        error << "Cannot read " << image << endl;
+        goto bail;
+      }
+      memset(img.data() + len, 0xff, esize - len);
+      EVP_DigestUpdate(sha, img.data(), len);
+      progress->phase("compare");
+      if (!read_full(fd_mtd, cur.data(), plen, off)) {
+        error << "Cannot read " << dev << " at 0x" << hex << off << dec << endl;
+        goto bail;
+      }
+      if (!memcmp(img.data(), cur.data(), plen)) {
+        progress->advance(len);
+        continue;
+      }
+
+      progress->phase("erase");
+      struct erase_info_user erase = {(uint32_t)off, (uint32_t)esize};
+      if (ioctl(fd_mtd, MEMERASE, &erase) < 0) {
+        error << "Cannot erase " << dev << " at 0x" << hex << off << dec
+              << ": " << strerror(errno) << endl;
+        goto bail;
+      }
+      progress->phase("program");
+      if (!write_full(fd_mtd, img.data(), plen, off)) {
+        error << "Cannot write " << dev << " at 0x" << hex << off << dec
+              << ": " << strerror(errno) << endl;
+        goto bail;
+      }
+      progress->phase("verify");
+      if (!read_full(fd_mtd, cur.data(), plen, off) ||
+          memcmp(img.data(), cur.data(), plen)) {
+        error << "Verification of " << dev << " failed at 0x" << hex << off
+              << dec << endl;
+        goto bail;
+      }
+      changed++;
+      progress->advance(len);
+      output << "\rWriting block " << b + 1 << " of " << blocks << flush;
+    }
+    output << "\r" << changed << " of " << blocks << " erase blocks of "
+           << dev << " updated" << endl;
+    ret = FW_STATUS_SUCCESS;
+  }
+
+  {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    char hex[2 * EVP_MAX_MD_SIZE + 1];
+
+    EVP_DigestFinal_ex(sha, md, &md_len);
+    for (unsigned int i = 0; i < md_len; i++) {
+      snprintf(hex + 2 * i, 3, "%02x", md[i]);
+    }
+    hex[2 * md_len] = '\0';
+    progress->sha256(hex);
+  }
+
+bail:
+  if (progress) {
+    progress->finish(ret);
+  }
+  if (sha) {
+    EVP_MD_CTX_free(sha);
+  }
+  if (fd_img >= 0) {
+    close(fd_img);
+  }
+  close(fd_mtd);
+  return ret;
+}
+
+// "-" is stdout, "tcp:<host>:<port>" a connection to host, else a file
+static int open_dump_output(const string &image, ostream &error)
+{
+  if (image == "-") {
+    return dup(STDOUT_FILENO);
+  }
+  if (image.compare(0, 4, "tcp:") != 0) {
+    int fd = open(image.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      error << "Cannot open " << image << ": " << strerror(errno) << endl;
+    }
+    return fd;
+  }
+
+  size_t colon = image.rfind(':');
+  string host = image.substr(4, colon - 4);
+  string port = image.substr(colon + 1);
+  struct addrinfo hints = {}, *res, *ai;
+  int fd = -1;
+
+  // [addr]:port for IPv6
+  if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  hints.ai_socktype = SOCK_STREAM;
+  if (colon < 4 || getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0) {
+    error << "Cannot resolve " << image << endl;
+    return -1;
+  }
+  for (ai = res; ai != NULL; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    error << "Cannot connect to " << image << ": " << strerror(errno) << endl;
+  }
+  return fd;
+}
+
+static bool write_stream(int fd, const uint8_t *buf, size_t len)
+{
+  while (len > 0) {
+    ssize_t rc = write(fd, buf, len);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    buf += rc;
+    len -= rc;
+  }
+  return true;
+}
+
+int System::dump_mtd(const string &dev, const string &image)
+{
+  struct mtd_info_user info;
+  uint64_t size, off;
+  size_t chunk = DUMP_CHUNK_SIZE;
+  uint8_t *buf = NULL;
+  int fd_mtd, fd_out = -1;
+  int ret = FW_STATUS_FAILURE;
+  unique_ptr<Progress> progress;
+  EVP_MD_CTX *sha = NULL;
+  // Messages would corrupt an image streamed to stdout
+  ostream &msg = (image == "-") ? error : output;
+
+  fd_mtd = open(dev.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_mtd < 0) {
+    error << "Cannot open " << dev << ": " << strerror(errno) << endl;
+    return FW_STATUS_FAILURE;
+  }
+  if (ioctl(fd_mtd, MEMGETINFO, &info) == 0) {
+    size = info.size;
+    // Whole erase blocks per read
+    if (info.erasesize > 0) {
+      chunk = (chunk + info.erasesize - 1) / info.erasesize * info.erasesize;
+    }
+  } else {
+    off_t end = lseek(fd_mtd, 0, SEEK_END);
+    if (end < 0) {
+      error << "Cannot get the size of " << dev << endl;
+      goto bail;
+    }
+    size = end;
+  }
+  if (posix_memalign((void **)&buf, PAGE_SIZE, chunk) != 0) {
+    buf = NULL;
+    goto bail;
+  }
+  sha = EVP_MD_CTX_new();
+  if (!sha || !EVP_DigestInit_ex(sha, EVP_sha256(), NULL)) {
+    goto bail;
+  }
+  fd_out = open_dump_output(image, error);
+  if (fd_out < 0) {
+    goto bail;
+  }
+
+  progress.reset(new Progress(filesystem::path(dev).filename().string(), size));
+  progress->phase("dump");
+  for (off = 0; off < size; off += chunk) {
+    size_t len = min<uint64_t>(chunk, size - off);
+
+    if (!read_full(fd_mtd, buf, len, off)) {
+      error << "Cannot read " << dev << " at 0x" << hex << off << dec << endl;
+      goto bail;
+    }
+    EVP_DigestUpdate(sha, buf, len);
+    if (!write_stream(fd_out, buf, len)) {
+      error << "Cannot write " << image << ": " << strerror(errno) << endl;
+      goto bail;
+    }
+    progress->advance(len);
+  }
+  ret = FW_STATUS_SUCCESS;
+
+  {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    char hex[2 * EVP_MAX_MD_SIZE + 1];
+
+    EVP_DigestFinal_ex(sha, md, &md_len);
+    for (unsigned int i = 0; i < md_len; i++) {
+      snprintf(hex + 2 * i, 3, "%02x", md[i]);
+    }
+    hex[2 * md_len] = '\0';
+    progress->sha256(hex);
+    msg << "Read " << size << " bytes of " << dev << ", sha256 " << hex << endl;
+  }
+
+bail:
+  if (fd_out >= 0 && close(fd_out) < 0 && ret == FW_STATUS_SUCCESS) {
+    error << "Cannot write " << image << ": " << strerror(errno) << endl;
+    ret = FW_STATUS_FAILURE;
+  }
+  if (progress) {
+    progress->finish(ret);
+  }
+  if (sha) {
+    EVP_MD_CTX_free(sha);
+  }
+  free(buf);
+  close(fd_mtd);
+  return ret;
+}
+
 int System::vboot_support_status(void)
 {
   struct vbs *v = vboot_status();
@@ -112,7 +437,7 @@ string& System::partition_conf()
 uint8_t System::get_fru_id(string &name)
 {
   uint8_t fru_id;
-  if (pal_get_fru_id((char *)name.c_str(), &fru_id))
+  if (pal_get_fru_id_cached((char *)name.c_str(), &fru_id))
   {
 
     // Set to some default FRU which should be present
@@ -139,8 +464,24 @@ bool System::is_sled_cycle_initiated()
 
 bool System::is_healthd_running()
 {
-  static const char* cmd = "ps -w | grep [/]usr/local/bin/healthd > /dev/null";
-  return (system(cmd) == 0) ? true : false;
+  static const std::string healthd = "/usr/local/bin/healthd";
+  std::error_code ec;
+
+  // As "ps -w | grep", without forking a shell for it
+  for (const auto& entry : std::filesystem::directory_iterator("/proc", ec)) {
+    const std::string pid = entry.path().filename().string();
+    if (pid.find_first_not_of("0123456789") != std::string::npos) {
+      continue;
+    }
+    std::ifstream ifs(entry.path() / "cmdline");
+    std::string cmdline((std::istreambuf_iterator<char>(ifs)),
+                        std::istreambuf_iterator<char>());
+    std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
+    if (cmdline.find(healthd) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool System::is_reboot_ongoing()
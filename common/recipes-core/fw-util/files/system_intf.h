@@ -19,6 +19,12 @@ class System {
     System(std::ostream &out, std::ostream &err): output(out), error(err) {}
 
     virtual int runcmd(const std::string &cmd);
+    // Write image to the MTD device dev like "flashcp -v", but erasing and
+    // programming only the erase blocks whose contents differ.
+    virtual int flash_mtd(const std::string &image, const std::string &dev);
+    // Read the MTD device dev into image: a file, "-" for stdout or
+    // "tcp:<host>:<port>", and print the SHA-256 of what was read.
+    virtual int dump_mtd(const std::string &dev, const std::string &image);
     virtual int vboot_support_status();
     virtual bool get_mtd_name(std::string name, std::string &dev, size_t& size, size_t& esize);
     virtual bool get_mtd_name(std::string name) {
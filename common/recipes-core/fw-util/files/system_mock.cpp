@@ -25,6 +25,16 @@ int System::runcmd(const string &cmd)
   return FW_STATUS_SUCCESS;
 }
 
+int System::flash_mtd(const string &image, const string &dev)
+{
+  return runcmd("flashcp -v " + image + " " + dev);
+}
+
+int System::dump_mtd(const string &dev, const string &image)
+{
+  return runcmd("cat " + dev + " > " + image);
+}
+
 int System::vboot_support_status(void)
 {
   const char *env = std::getenv("FWUTIL_HWENFORCE");
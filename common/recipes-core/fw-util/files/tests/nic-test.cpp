@@ -12,6 +12,7 @@ class NicMockComponent : public NicComponent {
       NicComponent(fru, comp, ver_key_store) {}
     MOCK_METHOD2(get_key, int(const std::string& key, std::string& val));
     MOCK_METHOD0(sys, System&());
+    MOCK_METHOD2(upgrade_pldm, int(const std::string& img, int channel));
 };
 
 
@@ -87,15 +88,11 @@ TEST(NicVersionTest, Unknown)
 
 TEST(NicUpgrade, CallTest)
 {
-  stringstream out, err;
-  SystemMock smock(out, err);
-  EXPECT_CALL(smock, runcmd(string("/usr/local/bin/ncsi-util -p \"MY_IMAGE\"")))
+  NicMockComponent nic("nic", "nic0");
+  EXPECT_CALL(nic, upgrade_pldm(string("MY_IMAGE"), -1))
     .Times(2)
     .WillOnce(Return(-1))
     .WillOnce(Return(0));
-  NicMockComponent nic("nic", "nic0");
-  EXPECT_CALL(nic, sys())
-    .WillRepeatedly(ReturnRef(smock));
 
   EXPECT_EQ(nic.update("MY_IMAGE"), -1);
   EXPECT_EQ(nic.update("MY_IMAGE"), 0);
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <openbmc/kv.h>
@@ -9,6 +10,46 @@ using namespace std;
 
 #define MAX_LINE_LENGTH 80
 
+#define TPM2_PT_FIRMWARE_VERSION_1 0x10b
+#define TPM2_GETCAP_RSP_SIZE 27
+
+static uint32_t be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+// TPM2_GetCapability(TPM_CAP_TPM_PROPERTIES, TPM_PT_FIRMWARE_VERSION_1)
+static int tpm2_query_fw_ver(const string& dev, uint32_t *fw_ver) {
+  static const uint8_t cmd[] = {
+    0x80, 0x01,              // TPM_ST_NO_SESSIONS
+    0x00, 0x00, 0x00, 0x16,  // commandSize
+    0x00, 0x00, 0x01, 0x7a,  // TPM_CC_GetCapability
+    0x00, 0x00, 0x00, 0x06,  // TPM_CAP_TPM_PROPERTIES
+    0x00, 0x00, 0x01, 0x0b,  // TPM_PT_FIRMWARE_VERSION_1
+    0x00, 0x00, 0x00, 0x01,  // propertyCount
+  };
+  uint8_t rsp[64];
+  ssize_t len = -1;
+  int fd;
+
+  fd = open(dev.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  if (write(fd, cmd, sizeof(cmd)) == (ssize_t)sizeof(cmd)) {
+    len = read(fd, rsp, sizeof(rsp));
+  }
+  close(fd);
+
+  // header, responseCode, moreData, capability, count, then the property
+  if (len < TPM2_GETCAP_RSP_SIZE || be32(&rsp[6]) != 0 ||
+      be32(&rsp[19]) != TPM2_PT_FIRMWARE_VERSION_1) {
+    return -1;
+  }
+  *fw_ver = be32(&rsp[23]);
+  return 0;
+}
+
 int tpm2_get_ver(char *ver, Tpm2Component *tpm2) {
   FILE *fp;
   char value[MAX_VALUE_LEN] = {0};
@@ -16,7 +57,7 @@ int tpm2_get_ver(char *ver, Tpm2Component *tpm2) {
   uint32_t fw_ver;
 
   if (ver == NULL || tpm2->device.c_str() == NULL ||
-      tpm2->version_command.size() == 0 ||
+      (tpm2->version_command.size() == 0 && tpm2->cmd_device.size() == 0) ||
       tpm2->verion_cache.c_str() == NULL
      ) {
     return FW_STATUS_NOT_SUPPORTED;
@@ -28,6 +69,14 @@ int tpm2_get_ver(char *ver, Tpm2Component *tpm2) {
 
   if (kv_get(tpm2->verion_cache.c_str(), value, NULL, 0)) {
     match = false;
+    for (size_t i = 0; !match && i < tpm2->cmd_device.size(); i++) {
+      if (tpm2_query_fw_ver(tpm2->cmd_device[i], &fw_ver) == 0) {
+        sprintf(value, "%d.%d", fw_ver >> 16, fw_ver & 0xFFFF);
+        kv_set(tpm2->verion_cache.c_str(), value, 0, 0);
+        match = true;
+      }
+    }
+    // The device is busy when a resource manager daemon holds it
     for (size_t i = 0; !match && i < tpm2->version_command.size(); i++) {
       fp = popen(tpm2->version_command[i].c_str(), "r");
       if (!fp) {
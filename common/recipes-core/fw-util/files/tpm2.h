@@ -8,13 +8,17 @@ class Tpm2Component : public Component {
     std::string device;
     std::vector<std::string> version_command;
     std::string verion_cache;
+    // Queried directly for the version; version_command is the fallback
+    std::vector<std::string> cmd_device;
     Tpm2Component(std::string fru, std::string comp,
                   std::string dev = "/sys/class/tpm/tpm0",
                   std::vector<std::string> ver_cmd = {
                     "/usr/bin/tpm2_getcap -c properties-fixed 2>/dev/null | grep TPM_PT_FIRMWARE_VERSION_1",
                     "/usr/bin/tpm2_getcap properties-fixed 2>/dev/null | grep -A1 TPM2_PT_FIRMWARE_VERSION_1"},
-                  std::string ver_cache = "tpm2_version")
-      : Component(fru, comp), device(dev), version_command(ver_cmd), verion_cache(ver_cache) {}
+                  std::string ver_cache = "tpm2_version",
+                  std::vector<std::string> cmd_dev = {"/dev/tpmrm0", "/dev/tpm0"})
+      : Component(fru, comp), device(dev), version_command(ver_cmd), verion_cache(ver_cache),
+        cmd_device(cmd_dev) {}
     int print_version();
     void get_version(json& j);
 };
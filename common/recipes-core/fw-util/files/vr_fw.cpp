@@ -6,11 +6,27 @@
 
 using namespace std;
 
+// The first version query of the process reads all the VRs, bus by bus
+// concurrently, into the cache the other components look up.
+static void prefetch_versions() {
+  static bool fetched = false;
+
+  if (!fetched) {
+    vr_fw_version_all();
+    fetched = true;
+  }
+}
+
 void VrComponent::get_version(json& j) {
   char ver[MAX_VER_STR_LEN] = {0};
 
   try {
-    if (vr_probe() || vr_fw_version(-1, dev_name.c_str(), ver)) {
+    if (vr_probe()) {
+      throw "Error in getting the version of " + dev_name;
+    }
+    prefetch_versions();
+    if (vr_fw_version(-1, dev_name.c_str(), ver)) {
+      vr_remove();
       throw "Error in getting the version of " + dev_name;
     }
     vr_remove();
@@ -56,6 +72,7 @@ int VrComponent::print_version() {
     return -1;
   }
 
+  prefetch_versions();
   if (vr_fw_version(-1, dev_name.c_str(), ver)) {
     cout << dev_name << " Version: NA" << endl;
   } else {
@@ -29,6 +29,11 @@
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <time.h>
 #include <pthread.h>
 #include <jansson.h>
 #include <stdbool.h>
@@ -55,6 +60,8 @@
 #define VERSION_HISTORY_COUNT  (4)
 
 #define CPU_INFO_PATH "/proc/stat"
+#define MEM_INFO_PATH "/proc/meminfo"
+#define MAX_PROC_SAMPLES 256
 #define CPU_NAME_LENGTH 10
 #define DEFAULT_WINDOW_SIZE 120
 #define DEFAULT_MONITOR_INTERVAL 1
@@ -107,6 +114,13 @@
 
 #define MAX_LOG_SIZE 128
 
+#define METRICS_PATH "/tmp/healthd_metrics"
+#define METRICS_MAGIC 0x4d444c48  // "HLDM"
+#define METRICS_VERSION 1
+#define METRICS_NUM_RECS 360
+#define METRICS_NUM_PROCS 4
+#define DEFAULT_METRICS_INTERVAL 10 // seconds
+
 struct i2c_bus_s {
   uint32_t offset;
   char     *name;
@@ -192,6 +206,7 @@ static int bmc_health = 0; // CPU/MEM/ECC error flag
 
 /* I2C Monitor enabled */
 static bool i2c_monitor_enabled = false;
+static uint32_t i2c_crash_count = 0;
 
 /* ECC configuration */
 static char *recoverable_ecc_name = "ECC Recoverable Error";
@@ -206,6 +221,8 @@ static struct threshold_s *unrec_ecc_threshold;
 static size_t unrec_ecc_threshold_num = 0;
 static unsigned int ecc_recov_max_counter = MAX_ECC_RECOVERABLE_ERROR_COUNTER;
 static unsigned int ecc_unrec_max_counter = MAX_ECC_UNRECOVERABLE_ERROR_COUNTER;
+static uint16_t ecc_recov_count = 0;
+static uint16_t ecc_unrec_count = 0;
 
 /* BMC Health Monitor */
 static bool regen_log_enabled = false;
@@ -229,7 +246,8 @@ static bool bmc_timestamp_enabled = false;
 /* PFR status Monitor */
 extern bool pfr_monitor_enabled;
 extern void initialize_pfr_monitor_config(json_t *);
-extern void * pfr_monitor();
+extern int pfr_monitor_init(void);
+extern int pfr_monitor(void);
 
 /* BIC health monitor */
 static bool bic_health_enabled = false;
@@ -249,6 +267,10 @@ static struct ubifs_health_monitor_config uhm_config = {
   .monitor_interval = DEFAULT_UBIFS_HEALTH_INTERVAL,
 };
 
+/* BMC metrics ring */
+static bool metrics_enabled = false;
+static int metrics_interval = DEFAULT_METRICS_INTERVAL;
+
 static void
 initialize_threshold(const char *target, json_t *thres, struct threshold_s *t) {
   json_t *tmp;
@@ -625,6 +647,26 @@ static void initialize_ubifs_health_config(json_t *obj) {
   }
 }
 
+static void initialize_metrics_config(json_t *obj) {
+  json_t *tmp = NULL;
+
+  if (obj == NULL) {
+    return;
+  }
+  tmp = json_object_get(obj, "enabled");
+  if (!tmp || !json_is_boolean(tmp)) {
+    return;
+  }
+  metrics_enabled = json_is_true(tmp);
+
+  tmp = json_object_get(obj, "monitor_interval");
+  if (tmp && json_is_number(tmp)) {
+    metrics_interval = json_integer_value(tmp);
+    if (metrics_interval <= 0)
+      metrics_interval = DEFAULT_METRICS_INTERVAL;
+  }
+}
+
 static int
 initialize_configuration(void) {
   json_error_t error;
@@ -656,12 +698,324 @@ initialize_configuration(void) {
   initialize_bmc_timestamp_config(json_object_get(conf, "bmc_timestamp"));
   initialize_bic_health_config(json_object_get(conf, "bic_health"));
   initialize_ubifs_health_config(json_object_get(conf, "ubifs_health"));
+  initialize_metrics_config(json_object_get(conf, "bmc_metrics"));
 
   json_decref(conf);
 
   return 0;
 }
 
+/*
+ * /proc/stat and /proc/meminfo stay open and are re-read with pread(),
+ * and are sampled at most once per pass of the event loop, so the
+ * monitors due at the same time share one read. The files are parsed
+ * in place by the scan_*() helpers, without stdio or allocation.
+ */
+static unsigned long loop_pass = 1;
+
+struct cpu_stat_s {
+  unsigned long long user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice;
+};
+
+struct mem_stat_s {
+  unsigned long long total_kb, free_kb;
+};
+
+struct proc_sample_s {
+  pid_t pid;
+  unsigned long long ticks;  // utime + stime
+  unsigned long long rss;    // pages
+  char comm[16];
+};
+
+// Unsigned decimal at *p after blanks, *p is moved past it
+static bool
+scan_ull(const char **p, unsigned long long *val) {
+  const char *s = *p;
+  unsigned long long v = 0;
+
+  while (*s == ' ' || *s == '\t') {
+    s++;
+  }
+  if (*s < '0' || *s > '9') {
+    return false;
+  }
+  while (*s >= '0' && *s <= '9') {
+    v = v * 10 + (*s++ - '0');
+  }
+  *val = v;
+  *p = s;
+  return true;
+}
+
+// Skip the blank separated token at *p
+static void
+scan_skip(const char **p) {
+  const char *s = *p;
+
+  while (*s == ' ' || *s == '\t') {
+    s++;
+  }
+  while (*s && *s != ' ' && *s != '\t' && *s != '\n') {
+    s++;
+  }
+  *p = s;
+}
+
+// Value of "<key> <value> kB" in the meminfo text
+static bool
+scan_meminfo(const char *buf, const char *key, unsigned long long *val) {
+  const char *s = strstr(buf, key);
+
+  if (s == NULL) {
+    return false;
+  }
+  s += strlen(key);
+  return scan_ull(&s, val);
+}
+
+// Read up to len - 1 bytes of the file from offset 0, opened on first use
+static ssize_t
+pread_proc_file(int *fd, const char *path, char *buf, size_t len) {
+  ssize_t rlen;
+
+  if (*fd < 0 && (*fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+    return -1;
+  }
+  rlen = pread(*fd, buf, len - 1, 0);
+  if (rlen <= 0) {
+    close(*fd);
+    *fd = -1;
+    return -1;
+  }
+  buf[rlen] = '\0';
+  return rlen;
+}
+
+static int
+get_cpu_stat(struct cpu_stat_s *stat) {
+  static int fd = -1;
+  static unsigned long sample_pass = 0;
+  static struct cpu_stat_s sample;
+  unsigned long long *fields[] = {
+    &sample.user, &sample.nice, &sample.system, &sample.idle, &sample.iowait,
+    &sample.irq, &sample.softirq, &sample.steal, &sample.guest, &sample.guest_nice,
+  };
+  const char *p;
+  char buf[256];
+  size_t i;
+
+  if (sample_pass == loop_pass) {
+    *stat = sample;
+    return 0;
+  }
+
+  if (pread_proc_file(&fd, CPU_INFO_PATH, buf, sizeof(buf)) < 0) {
+    return -1;
+  }
+  // "cpu  <user> <nice> <system> ..."
+  p = buf;
+  scan_skip(&p);
+  for (i = 0; i < ARRAY_SIZE(fields); i++) {
+    if (!scan_ull(&p, fields[i])) {
+      return -2;
+    }
+  }
+  sample_pass = loop_pass;
+  *stat = sample;
+  return 0;
+}
+
+static int
+get_mem_stat(struct mem_stat_s *stat) {
+  static int fd = -1;
+  static unsigned long sample_pass = 0;
+  static struct mem_stat_s sample;
+  char buf[256];
+
+  if (sample_pass == loop_pass) {
+    *stat = sample;
+    return 0;
+  }
+
+  // MemTotal and MemFree are the first lines
+  if (pread_proc_file(&fd, MEM_INFO_PATH, buf, sizeof(buf)) < 0) {
+    return -1;
+  }
+  if (!scan_meminfo(buf, "MemTotal:", &sample.total_kb) ||
+      !scan_meminfo(buf, "MemFree:", &sample.free_kb) ||
+      sample.total_kb == 0) {
+    return -2;
+  }
+  sample_pass = loop_pass;
+  *stat = sample;
+  return 0;
+}
+
+/*
+ * Per-process CPU attribution: while the BMC CPU utilization is over
+ * the lowest CPU threshold, /proc/<pid>/stat of every process is
+ * sampled at every CPU check, and the process with the most CPU time
+ * between the last two samples is named when a CPU threshold asserts.
+ */
+static struct proc_sample_s proc_samples[2][MAX_PROC_SAMPLES];
+static size_t num_proc_samples[2];
+static unsigned long long proc_sample_total[2];  // jiffies of /proc/stat
+static int proc_sample_cur = 0;
+static int proc_sample_valid = 0;  // samples taken, up to 2
+
+static int
+cmp_proc_sample(const void *a, const void *b) {
+  const struct proc_sample_s *x = a, *y = b;
+
+  return x->pid < y->pid ? -1 : x->pid > y->pid;
+}
+
+// utime + stime, rss and comm of /proc/<pid>/stat
+static bool
+read_proc_sample(const char *pid, struct proc_sample_s *sample) {
+  char path[32], buf[512];
+  const char *p, *comm;
+  unsigned long long pid_val, utime, stime, rss;
+  ssize_t len;
+  size_t comm_len;
+  int fd, i;
+
+  snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0) {
+    return false;
+  }
+  buf[len] = '\0';
+
+  // "<pid> (<comm>) <state> ...", comm may hold blanks and parentheses
+  p = buf;
+  if (!scan_ull(&p, &pid_val)) {
+    return false;
+  }
+  comm = strchr(p, '(');
+  p = strrchr(p, ')');
+  if (comm == NULL || p == NULL || p < comm) {
+    return false;
+  }
+  comm_len = p - comm - 1;
+  if (comm_len >= sizeof(sample->comm)) {
+    comm_len = sizeof(sample->comm) - 1;
+  }
+  memcpy(sample->comm, comm + 1, comm_len);
+  sample->comm[comm_len] = '\0';
+
+  // state (field 3) to cmajflt (field 13) come before utime and stime
+  p++;
+  for (i = 3; i <= 13; i++) {
+    scan_skip(&p);
+  }
+  if (!scan_ull(&p, &utime) || !scan_ull(&p, &stime)) {
+    return false;
+  }
+  // cutime (field 16) to starttime (field 22) and vsize come before rss
+  for (i = 16; i <= 23; i++) {
+    scan_skip(&p);
+  }
+  if (!scan_ull(&p, &rss)) {
+    return false;
+  }
+  sample->pid = (pid_t)pid_val;
+  sample->ticks = utime + stime;
+  sample->rss = rss;
+  return true;
+}
+
+// Sample every process, up to max
+static size_t
+scan_procs(struct proc_sample_s *samples, size_t max) {
+  struct dirent *de;
+  size_t num = 0;
+  DIR *dir;
+
+  dir = opendir("/proc");
+  if (dir == NULL) {
+    return 0;
+  }
+  while ((de = readdir(dir)) != NULL && num < max) {
+    if (de->d_name[0] < '1' || de->d_name[0] > '9') {
+      continue;
+    }
+    if (read_proc_sample(de->d_name, &samples[num])) {
+      num++;
+    }
+  }
+  closedir(dir);
+  return num;
+}
+
+static void
+sample_procs(unsigned long long total) {
+  int idx = proc_sample_cur ^ 1;
+  struct proc_sample_s *samples = proc_samples[idx];
+  size_t num;
+
+  num = scan_procs(samples, MAX_PROC_SAMPLES);
+  qsort(samples, num, sizeof(samples[0]), cmp_proc_sample);
+  num_proc_samples[idx] = num;
+  proc_sample_total[idx] = total;
+  proc_sample_cur = idx;
+  if (proc_sample_valid < 2) {
+    proc_sample_valid++;
+  }
+}
+
+static void
+reset_proc_samples(void) {
+  proc_sample_valid = 0;
+}
+
+// Log the process with the most CPU time between the last two samples
+static void
+log_cpu_top_proc(int log_level) {
+  const struct proc_sample_s *cur, *prev, *top = NULL;
+  unsigned long long delta, top_delta = 0, total_diff;
+  size_t i, j, num_cur, num_prev;
+
+  if (proc_sample_valid < 2) {
+    return;
+  }
+  cur = proc_samples[proc_sample_cur];
+  num_cur = num_proc_samples[proc_sample_cur];
+  prev = proc_samples[proc_sample_cur ^ 1];
+  num_prev = num_proc_samples[proc_sample_cur ^ 1];
+  total_diff = proc_sample_total[proc_sample_cur] - proc_sample_total[proc_sample_cur ^ 1];
+  if (total_diff == 0) {
+    return;
+  }
+
+  // Both samples are sorted by pid
+  for (i = 0, j = 0; i < num_cur; i++) {
+    while (j < num_prev && prev[j].pid < cur[i].pid) {
+      j++;
+    }
+    if (j < num_prev && prev[j].pid == cur[i].pid && cur[i].ticks >= prev[j].ticks) {
+      delta = cur[i].ticks - prev[j].ticks;
+    } else {
+      delta = cur[i].ticks;  // started since the last sample
+    }
+    if (delta > top_delta) {
+      top_delta = delta;
+      top = &cur[i];
+    }
+  }
+
+  if (top != NULL) {
+    syslog(log_level, "Top CPU consumer: %s (pid %d), %.2f%%\n", top->comm, top->pid,
+           (float)top_delta * 100.0 / total_diff);
+  }
+}
+
 static void threshold_assert_check(const char *target, float value, struct threshold_s *thres) {
 
   struct sysinfo info;
@@ -670,6 +1024,9 @@ static void threshold_assert_check(const char *target, float value, struct thres
     thres->asserted = true;
     if (thres->log) {
       syslog(thres->log_level, "ASSERT: %s (%.2f%%) exceeds the threshold (%.2f%%).\n", target, value, thres->value);
+      if (strcasestr(target, "CPU") != 0ULL) {
+        log_cpu_top_proc(thres->log_level);
+      }
     }
     if (thres->reboot) {
       sysinfo(&info);
@@ -797,25 +1154,25 @@ initilize_all_kv() {
   pal_set_def_key_value();
 }
 
-static void *
-hb_handler() {
+static int
+hb_init(void) {
   // set flag to notice BMC healthd hb_handler is ready
   kv_set("flag_healthd_hb_led", "1", 0, 0);
+  return 0;
+}
 
-  while(1) {
-    /* Turn ON the HB Led*/
-    pal_set_hb_led(1);
-    msleep(hb_interval);
+static int
+hb_handler(void) {
+  static bool hb_led_on = false;
 
-    /* Turn OFF the HB led */
-    pal_set_hb_led(0);
-    msleep(hb_interval);
-  }
-  return NULL;
+  /* Toggle the HB Led */
+  hb_led_on = !hb_led_on;
+  pal_set_hb_led(hb_led_on);
+  return hb_interval;
 }
 
-static void *
-watchdog_handler() {
+static int
+watchdog_init(void) {
 
   /* Start watchdog in manual mode */
   open_watchdog(0, 0);
@@ -827,194 +1184,210 @@ watchdog_handler() {
 
   // set flag to notice BMC healthd watchdog_handler is ready
   kv_set("flag_healthd_wtd", "1", 0, 0);
+  return 5 * 1000;
+}
 
-  while(1) {
-
-    sleep(5);
-
-    /*
-     * Restart the watchdog countdown. If this process is terminated,
-     * the persistent watchdog setting will cause the system to reboot after
-     * the watchdog timeout.
-     */
-    kick_watchdog();
-  }
-  return NULL;
+static int
+watchdog_handler(void) {
+  /*
+   * Restart the watchdog countdown. If this process is terminated,
+   * the persistent watchdog setting will cause the system to reboot after
+   * the watchdog timeout.
+   */
+  kick_watchdog();
+  return 5 * 1000;
 }
 
-static void *
-i2c_mon_handler() {
+static int
+i2c_mon_handler(void) {
   char i2c_bus_device[16];
   int dev;
   int bus_status = 0;
-  int asserted_flag[I2C_BUS_NUM] = {};
+  static int asserted_flag[I2C_BUS_NUM] = {};
   bool assert_handle = 0;
   int i;
 
-  while (1) {
-    for (i = 0; i < I2C_BUS_NUM; i++) {
-      if (!ast_i2c_dev_offset[i].enabled) {
-        continue;
+  for (i = 0; i < I2C_BUS_NUM; i++) {
+    if (!ast_i2c_dev_offset[i].enabled) {
+      continue;
+    }
+    sprintf(i2c_bus_device, "/dev/i2c-%d", i);
+    dev = open(i2c_bus_device, O_RDWR);
+    if (dev < 0) {
+      syslog(LOG_DEBUG, "%s(): open() failed", __func__);
+      continue;
+    }
+    bus_status = i2c_smbus_status(dev);
+    close(dev);
+
+    assert_handle = 0;
+    if (bus_status == 0) {
+      /* Bus status is normal */
+      if (asserted_flag[i] != 0) {
+        asserted_flag[i] = 0;
+        syslog(LOG_CRIT, "DEASSERT: I2C(%d) Bus recoveried. (I2C bus index base 0)", i);
+        pal_i2c_crash_deassert_handle(i);
       }
-      sprintf(i2c_bus_device, "/dev/i2c-%d", i);
-      dev = open(i2c_bus_device, O_RDWR);
-      if (dev < 0) {
-        syslog(LOG_DEBUG, "%s(): open() failed", __func__);
-        continue;
+    } else {
+      /* Check each case */
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_ERROR)
+          && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
+                         "Recovery error. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_ERROR);
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT)
+          && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
+                         "Recovery timed out. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT);
+      if (GETBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS)) {
+        syslog(LOG_CRIT, "I2C(%d) bus had been locked (Master Lock or Slave Clock Stretch) "
+                         "and has been recoveried successfully. (I2C bus index base 0)", i);
+      }
+      bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR)
+          && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDA keeps low). "
+                         "Bus recovery error. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT)
+          && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDAs keep low). "
+                         "Bus recovery timed out. (I2C bus index base 0)", i);
+        assert_handle = 1;
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT);
+      if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS)) {
+        syslog(LOG_CRIT, "I2C(%d) Slave was dead. and bus has been recoveried successfully. "
+                         "(I2C bus index base 0)", i);
+      }
+      bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS);
+      /* Check if any undefined bit remain in bus_status */
+      if ((bus_status != 0) && !GETBIT(asserted_flag[i], UNDEFINED_CASE)) {
+        asserted_flag[i] = SETBIT(asserted_flag[i], 8);
+        syslog(LOG_CRIT, "ASSERT: I2C(%d) Undefined case. (I2C bus index base 0)", i);
+        assert_handle = 1;
       }
-      bus_status = i2c_smbus_status(dev);
-      close(dev);
-
-      assert_handle = 0;
-      if (bus_status == 0) {
-        /* Bus status is normal */
-        if (asserted_flag[i] != 0) {
-          asserted_flag[i] = 0;
-          syslog(LOG_CRIT, "DEASSERT: I2C(%d) Bus recoveried. (I2C bus index base 0)", i);
-          pal_i2c_crash_deassert_handle(i);
-        }
-      } else {
-        /* Check each case */
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_ERROR)
-            && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_ERROR);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
-                           "Recovery error. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_ERROR);
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT)
-            && !GETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], BUS_LOCK_RECOVER_TIMEOUT);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) bus is locked (Master Lock or Slave Clock Stretch). "
-                           "Recovery timed out. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_TIMEOUT);
-        if (GETBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS)) {
-          syslog(LOG_CRIT, "I2C(%d) bus had been locked (Master Lock or Slave Clock Stretch) "
-                           "and has been recoveried successfully. (I2C bus index base 0)", i);
-        }
-        bus_status = CLEARBIT(bus_status, BUS_LOCK_RECOVER_SUCCESS);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR)
-            && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_ERROR);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDA keeps low). "
-                           "Bus recovery error. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_ERROR);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT)
-            && !GETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], SLAVE_DEAD_RECOVER_TIMEOUT);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Slave is dead (SDAs keep low). "
-                           "Bus recovery timed out. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_TIMEOUT);
-        if (GETBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS)) {
-          syslog(LOG_CRIT, "I2C(%d) Slave was dead. and bus has been recoveried successfully. "
-                           "(I2C bus index base 0)", i);
-        }
-        bus_status = CLEARBIT(bus_status, SLAVE_DEAD_RECOVER_SUCCESS);
-        /* Check if any undefined bit remain in bus_status */
-        if ((bus_status != 0) && !GETBIT(asserted_flag[i], UNDEFINED_CASE)) {
-          asserted_flag[i] = SETBIT(asserted_flag[i], 8);
-          syslog(LOG_CRIT, "ASSERT: I2C(%d) Undefined case. (I2C bus index base 0)", i);
-          assert_handle = 1;
-        }
 
-        if (assert_handle) {
-          pal_i2c_crash_assert_handle(i);
-        }
+      if (assert_handle) {
+        i2c_crash_count++;
+        pal_i2c_crash_assert_handle(i);
       }
     }
-    sleep(30);
   }
-  return NULL;
+  return 30 * 1000;
 }
 
-static void *
-CPU_usage_monitor() {
-  unsigned long long user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice;
-  unsigned long long total_diff, idle_diff, non_idle, idle_time = 0, total = 0, pre_total = 0, pre_idle = 0;
-  char cpu[CPU_NAME_LENGTH] = {0};
-  int i, ready_flag = 0, timer = 0, retry = 0;
-  float cpu_util_avg, cpu_util_total;
-  float cpu_utilization[cpu_window_size];
-  FILE *fp;
-  int ret;
+static float *cpu_utilization;
+static float cpu_proc_sample_min = MAX_THRESHOLD;
 
-  sleep(180); //Wait 180s for BMC to idle stage.
+static int
+CPU_usage_init(void) {
+  size_t i;
 
-  memset(cpu_utilization, 0, sizeof(float) * cpu_window_size);
+  cpu_utilization = calloc(cpu_window_size, sizeof(float));
+  if (cpu_utilization == NULL) {
+    syslog(LOG_CRIT, "Cannot allocate the CPU window. Stop %s\n", __func__);
+    return -1;
+  }
 
-  // set flag to notice BMC healthd CPU_usage_monitor is ready
-  kv_set("flag_healthd_cpu", "1", 0, 0);
+  // The processes are sampled from the lowest threshold on
+  for (i = 0; i < cpu_threshold_num; i++) {
+    if (cpu_threshold[i].value < cpu_proc_sample_min) {
+      cpu_proc_sample_min = cpu_threshold[i].value;
+    }
+  }
 
-  while (1) {
+  return 180 * 1000; //Wait 180s for BMC to idle stage.
+}
 
-    if (retry > HEALTHD_MAX_RETRY) {
-      syslog(LOG_CRIT, "Cannot get CPU statistics. Stop %s\n", __func__);
-      return NULL;
-    }
+static int
+CPU_usage_monitor(void) {
+  static unsigned long long pre_total = 0, pre_idle = 0;
+  static int ready_flag = 0, timer = 0, retry = 0;
+  static bool kv_flag = false;
+  unsigned long long total_diff, idle_diff, non_idle, idle_time = 0, total = 0;
+  struct cpu_stat_s stat;
+  float cpu_util_avg, cpu_util_total;
+  int i, ret;
 
-    // Get CPU statistics. Time unit: jiffies
-    fp = fopen(CPU_INFO_PATH, "r");
-    if(!fp) {
-      syslog(LOG_WARNING, "Failed to get CPU statistics.\n");
-      retry++;
-      continue;
-    }
+  if (!kv_flag) {
+    // set flag to notice BMC healthd CPU_usage_monitor is ready
+    kv_set("flag_healthd_cpu", "1", 0, 0);
+    kv_flag = true;
+  }
 
-    ret = fscanf(fp, "%s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
-    if (ret != 11) {
-      syslog(LOG_WARNING, "Cannot parse CPU statistic. Stop %s\n", __func__);
-      retry++;
-      continue;
-    }
-    retry = 0;
+  if (retry > HEALTHD_MAX_RETRY) {
+    syslog(LOG_CRIT, "Cannot get CPU statistics. Stop %s\n", __func__);
+    return -1;
+  }
 
-    fclose(fp);
+  // Get CPU statistics. Time unit: jiffies
+  ret = get_cpu_stat(&stat);
+  if (ret == -1) {
+    syslog(LOG_WARNING, "Failed to get CPU statistics.\n");
+    retry++;
+    return 0;
+  }
+  if (ret) {
+    syslog(LOG_WARNING, "Cannot parse CPU statistic. Stop %s\n", __func__);
+    retry++;
+    return 0;
+  }
+  retry = 0;
 
-    timer %= cpu_window_size;
+  timer %= cpu_window_size;
 
-    // Need more data to cacluate the avg. utilization. We average 60 records here.
-    if (timer == (cpu_window_size-1) && !ready_flag)
-      ready_flag = 1;
+  // Need more data to cacluate the avg. utilization. We average 60 records here.
+  if (timer == (cpu_window_size-1) && !ready_flag)
+    ready_flag = 1;
 
 
-    // guset and guest_nice are already accounted in user and nice so they are not included in total caculation
-    idle_time = idle + iowait;
-    non_idle = user + nice + system + irq + softirq + steal;
-    total = idle_time + non_idle;
+  // guset and guest_nice are already accounted in user and nice so they are not included in total caculation
+  idle_time = stat.idle + stat.iowait;
+  non_idle = stat.user + stat.nice + stat.system + stat.irq + stat.softirq + stat.steal;
+  total = idle_time + non_idle;
 
-    // For runtime caculation, we need to take into account previous value.
-    total_diff = total - pre_total;
-    idle_diff = idle_time - pre_idle;
+  // For runtime caculation, we need to take into account previous value.
+  total_diff = total - pre_total;
+  idle_diff = idle_time - pre_idle;
 
-    // These records are used to caculate the avg. utilization.
-    cpu_utilization[timer] = (float) (total_diff - idle_diff)/total_diff;
+  // These records are used to caculate the avg. utilization.
+  cpu_utilization[timer] = (float) (total_diff - idle_diff)/total_diff;
 
-    // Start to average the cpu utilization
-    if (ready_flag) {
-      cpu_util_total = 0;
-      for (i=0; i<cpu_window_size; i++) {
-        cpu_util_total += cpu_utilization[i];
-      }
-      cpu_util_avg = (cpu_util_total/cpu_window_size) * 100.0;
-      threshold_check(cpu_monitor_name, cpu_util_avg, cpu_threshold, cpu_threshold_num);
+  // Keep track of the processes while the CPU is busy
+  if (cpu_utilization[timer] * 100.0 >= cpu_proc_sample_min) {
+    sample_procs(total);
+  } else {
+    reset_proc_samples();
+  }
+
+  // Start to average the cpu utilization
+  if (ready_flag) {
+    cpu_util_total = 0;
+    for (i=0; i<cpu_window_size; i++) {
+      cpu_util_total += cpu_utilization[i];
     }
+    cpu_util_avg = (cpu_util_total/cpu_window_size) * 100.0;
+    threshold_check(cpu_monitor_name, cpu_util_avg, cpu_threshold, cpu_threshold_num);
+  }
 
-    // Record current value for next caculation
-    pre_total = total;
-    pre_idle  = idle_time;
+  // Record current value for next caculation
+  pre_total = total;
+  pre_idle  = idle_time;
 
-    timer++;
-    sleep(cpu_monitor_interval);
-  }
-  return NULL;
+  timer++;
+  return cpu_monitor_interval * 1000;
 }
 
 static int set_panic_on_oom(void) {
@@ -1051,15 +1424,17 @@ static int set_panic_on_oom(void) {
   return 0;
 }
 
-static void *
-memory_usage_monitor() {
-  struct sysinfo s_info;
-  int i, error, timer = 0, ready_flag = 0, retry = 0;
-  float mem_util_avg, mem_util_total;
-  float mem_utilization[mem_window_size];
+static float *mem_utilization;
+
+static int
+memory_usage_init(void) {
   char cmd[128];
 
-  memset(mem_utilization, 0, sizeof(float) * mem_window_size);
+  mem_utilization = calloc(mem_window_size, sizeof(float));
+  if (mem_utilization == NULL) {
+    syslog(LOG_CRIT, "Cannot allocate the memory window. Stop %s\n", __func__);
+    return -1;
+  }
 
   if (mem_enable_panic) {
     set_panic_on_oom();
@@ -1074,156 +1449,165 @@ memory_usage_monitor() {
 
   // set flag to notice BMC healthd memory_usage_monitor is ready
   kv_set("flag_healthd_mem", "1", 0, 0);
+  return 0;
+}
 
-  while (1) {
-
-    if (retry > HEALTHD_MAX_RETRY) {
-      syslog(LOG_CRIT, "Cannot get sysinfo. Stop the %s\n", __func__);
-      return NULL;
-    }
+static int
+memory_usage_monitor(void) {
+  static int timer = 0, ready_flag = 0, retry = 0;
+  struct mem_stat_s mem;
+  int i, error;
+  float mem_util_avg, mem_util_total;
 
-    timer %= mem_window_size;
+  if (retry > HEALTHD_MAX_RETRY) {
+    syslog(LOG_CRIT, "Cannot get memory info. Stop the %s\n", __func__);
+    return -1;
+  }
 
-    // Need more data to cacluate the avg. utilization. We average 60 records here.
-    if (timer == (mem_window_size-1) && !ready_flag)
-      ready_flag = 1;
+  timer %= mem_window_size;
 
-    // Get sys info
-    error = sysinfo(&s_info);
-    if (error) {
-      syslog(LOG_WARNING, "%s Failed to get sys info. Error: %d\n", __func__, error);
-      retry++;
-      continue;
-    }
-    retry = 0;
+  // Need more data to cacluate the avg. utilization. We average 60 records here.
+  if (timer == (mem_window_size-1) && !ready_flag)
+    ready_flag = 1;
 
-    // These records are used to caculate the avg. utilization.
-    mem_utilization[timer] = (float) (s_info.totalram - s_info.freeram)/s_info.totalram;
+  // Get memory info
+  error = get_mem_stat(&mem);
+  if (error) {
+    syslog(LOG_WARNING, "%s Failed to get memory info. Error: %d\n", __func__, error);
+    retry++;
+    return 0;
+  }
+  retry = 0;
 
-    // Start to average the memory utilization
-    if (ready_flag) {
-      mem_util_total = 0;
-      for (i=0; i<mem_window_size; i++)
-        mem_util_total += mem_utilization[i];
+  // These records are used to caculate the avg. utilization.
+  mem_utilization[timer] = (float) (mem.total_kb - mem.free_kb)/mem.total_kb;
 
-      mem_util_avg = (mem_util_total/mem_window_size) * 100.0;
+  // Start to average the memory utilization
+  if (ready_flag) {
+    mem_util_total = 0;
+    for (i=0; i<mem_window_size; i++)
+      mem_util_total += mem_utilization[i];
 
-      threshold_check(mem_monitor_name, mem_util_avg, mem_threshold, mem_threshold_num);
-    }
+    mem_util_avg = (mem_util_total/mem_window_size) * 100.0;
 
-    timer++;
-    sleep(mem_monitor_interval);
+    threshold_check(mem_monitor_name, mem_util_avg, mem_threshold, mem_threshold_num);
   }
-  return NULL;
+
+  timer++;
+  return mem_monitor_interval * 1000;
 }
 
-// Thread to monitor the ECC counter
-static void *
-ecc_mon_handler() {
-  uint32_t mcr_fd = 0;
+static int
+ecc_mon_init(void) {
+  // set flag to notice BMC healthd ecc_mon_handler is ready
+  kv_set("flag_healthd_ecc", "1", 0, 0);
+  return 0;
+}
+
+// Monitor the ECC counter
+static int
+ecc_mon_handler(void) {
+  static int mcr_fd = -1;
+  static void *mcr_base_addr = MAP_FAILED;
+  static int retry_err = 0;
   uint32_t ecc_status = 0;
   uint32_t unrecover_ecc_err_addr = 0;
   uint32_t recover_ecc_err_addr = 0;
   uint16_t ecc_recoverable_error_counter = 0;
   uint8_t ecc_unrecoverable_error_counter = 0;
-  void *mcr_base_addr;
   void *mcr50_addr;
   void *mcr58_addr;
   void *mcr5c_addr;
-  int retry_err = 0;
-
-  // set flag to notice BMC healthd ecc_mon_handler is ready
-  kv_set("flag_healthd_ecc", "1", 0, 0);
 
-  while (1) {
-    mcr_fd = open("/dev/mem", O_RDWR | O_SYNC );
+  // The MCR page stays mapped between the checks
+  if (mcr_base_addr == MAP_FAILED) {
     if (mcr_fd < 0) {
-      // In case of error opening the file, sleep for 2 sec and retry.
+      mcr_fd = open("/dev/mem", O_RDWR | O_SYNC );
+    }
+    if (mcr_fd >= 0) {
+      mcr_base_addr = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mcr_fd,
+          AST_MCR_BASE);
+    }
+    if (mcr_base_addr == MAP_FAILED) {
+      // In case of error opening the file, retry after 2 sec.
       // During continuous failures, log the error every 20 minutes.
-      sleep(2);
       if (++retry_err >= 600) {
         syslog(LOG_ERR, "%s - cannot open /dev/mem", __func__);
         retry_err = 0;
       }
-      continue;
+      return 2 * 1000;
     }
+  }
 
-    retry_err = 0;
+  retry_err = 0;
 
-    mcr_base_addr = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mcr_fd,
-        AST_MCR_BASE);
-    mcr50_addr = (char*)mcr_base_addr + INTR_CTRL_STS_OFFSET;
-    ecc_status = *(volatile uint32_t*) mcr50_addr;
-    if (ecc_addr_log) {
-      mcr58_addr = (char*)mcr_base_addr + ADDR_FIRST_UNRECOVER_ECC_OFFSET;
-      unrecover_ecc_err_addr = *(volatile uint32_t*) mcr58_addr;
-      mcr5c_addr = (char*)mcr_base_addr + ADDR_LAST_RECOVER_ECC_OFFSET;
-      recover_ecc_err_addr = *(volatile uint32_t*) mcr5c_addr;
-    }
-    munmap(mcr_base_addr, PAGE_SIZE);
-    close(mcr_fd);
+  mcr50_addr = (char*)mcr_base_addr + INTR_CTRL_STS_OFFSET;
+  ecc_status = *(volatile uint32_t*) mcr50_addr;
+  if (ecc_addr_log) {
+    mcr58_addr = (char*)mcr_base_addr + ADDR_FIRST_UNRECOVER_ECC_OFFSET;
+    unrecover_ecc_err_addr = *(volatile uint32_t*) mcr58_addr;
+    mcr5c_addr = (char*)mcr_base_addr + ADDR_LAST_RECOVER_ECC_OFFSET;
+    recover_ecc_err_addr = *(volatile uint32_t*) mcr5c_addr;
+  }
 
-    ecc_recoverable_error_counter = (ecc_status >> 16) & 0xFF;
-    ecc_unrecoverable_error_counter = (ecc_status >> 12) & 0xF;
+  ecc_recoverable_error_counter = (ecc_status >> 16) & 0xFF;
+  ecc_unrecoverable_error_counter = (ecc_status >> 12) & 0xF;
+  ecc_recov_count = ecc_recoverable_error_counter;
+  ecc_unrec_count = ecc_unrecoverable_error_counter;
 
-    // Check ECC recoverable error counter
-    ecc_threshold_check(recoverable_ecc_name, ecc_recoverable_error_counter,
-                        recov_ecc_threshold, recov_ecc_threshold_num, recover_ecc_err_addr);
+  // Check ECC recoverable error counter
+  ecc_threshold_check(recoverable_ecc_name, ecc_recoverable_error_counter,
+                      recov_ecc_threshold, recov_ecc_threshold_num, recover_ecc_err_addr);
 
-    // Check ECC un-recoverable error counter
-    ecc_threshold_check(unrecoverable_ecc_name, ecc_unrecoverable_error_counter,
-                        unrec_ecc_threshold, unrec_ecc_threshold_num, unrecover_ecc_err_addr);
+  // Check ECC un-recoverable error counter
+  ecc_threshold_check(unrecoverable_ecc_name, ecc_unrecoverable_error_counter,
+                      unrec_ecc_threshold, unrec_ecc_threshold_num, unrecover_ecc_err_addr);
 
-    sleep(ecc_monitor_interval);
-  }
-  return NULL;
+  return ecc_monitor_interval * 1000;
 }
 
-static void *
-bmc_health_monitor()
+static int
+bmc_health_monitor(void)
 {
-  int bmc_health_last_state = 1;
+  static int bmc_health_last_state = 1;
+  static int relog_counter = 0;
   int bmc_health_kv_state = 1;
   char tmp_health[MAX_VALUE_LEN];
-  int relog_counter = 0;
   int relog_counter_criteria = regen_interval / bmc_health_monitor_interval;
   size_t i;
   int ret = 0;
 
-  while(1) {
-    // get current health status from kv_store
-    memset(tmp_health, 0, MAX_VALUE_LEN);
-    ret = pal_get_key_value(BMC_HEALTH_FILE, tmp_health);
-    if (ret){
-      syslog(LOG_ERR, " %s - kv get bmc_health status failed", __func__);
-    }
-    bmc_health_kv_state = atoi(tmp_health);
-
-    // If log-util clear all fru, cleaning CPU/MEM/ECC error status
-    // After doing it, daemon will regenerate asserted log
-    // Generage a syslog every regen_interval loop counter
-    if ((relog_counter >= relog_counter_criteria) ||
-        ((bmc_health_last_state == 0) && (bmc_health_kv_state == 1))) {
-
-      for(i = 0; i < cpu_threshold_num; i++)
-        cpu_threshold[i].asserted = false;
-      for(i = 0; i < mem_threshold_num; i++)
-        mem_threshold[i].asserted = false;
-      for(i = 0; i < recov_ecc_threshold_num; i++)
-        recov_ecc_threshold[i].asserted = false;
-      for(i = 0; i < unrec_ecc_threshold_num; i++)
-        unrec_ecc_threshold[i].asserted = false;
-
-      pthread_mutex_lock(&global_error_mutex);
-      bmc_health = 0;
-      pthread_mutex_unlock(&global_error_mutex);
-      relog_counter = 0;
-    }
-    bmc_health_last_state = bmc_health_kv_state;
-    relog_counter++;
-    sleep(bmc_health_monitor_interval);
-  }
-  return NULL;
+  // get current health status from kv_store
+  memset(tmp_health, 0, MAX_VALUE_LEN);
+  ret = pal_get_key_value(BMC_HEALTH_FILE, tmp_health);
+  if (ret){
+    syslog(LOG_ERR, " %s - kv get bmc_health status failed", __func__);
+  }
+  bmc_health_kv_state = atoi(tmp_health);
+
+  // If log-util clear all fru, cleaning CPU/MEM/ECC error status
+  // After doing it, daemon will regenerate asserted log
+  // Generage a syslog every regen_interval loop counter
+  if ((relog_counter >= relog_counter_criteria) ||
+      ((bmc_health_last_state == 0) && (bmc_health_kv_state == 1))) {
+
+    for(i = 0; i < cpu_threshold_num; i++)
+      cpu_threshold[i].asserted = false;
+    for(i = 0; i < mem_threshold_num; i++)
+      mem_threshold[i].asserted = false;
+    for(i = 0; i < recov_ecc_threshold_num; i++)
+      recov_ecc_threshold[i].asserted = false;
+    for(i = 0; i < unrec_ecc_threshold_num; i++)
+      unrec_ecc_threshold[i].asserted = false;
+
+    pthread_mutex_lock(&global_error_mutex);
+    bmc_health = 0;
+    pthread_mutex_unlock(&global_error_mutex);
+    relog_counter = 0;
+  }
+  bmc_health_last_state = bmc_health_kv_state;
+  relog_counter++;
+  return bmc_health_monitor_interval * 1000;
 }
 
 void check_nm_selftest_result(uint8_t fru, int result, uint8_t *selftest_result)
@@ -1322,21 +1706,16 @@ nm_selftest(uint8_t fru) {
 }
 
 
-static void *
-nm_monitor()
+static int
+nm_monitor(void)
 {
   int fru;
 
-  while (1)
+  for ( fru = 1; fru <= MAX_NUM_FRUS; fru++)
   {
-    for ( fru = 1; fru <= MAX_NUM_FRUS; fru++)
-    {
-      nm_selftest(fru);
-    }
-    sleep(nm_monitor_interval);
+    nm_selftest(fru);
   }
-
-  return NULL;
+  return nm_monitor_interval * 1000;
 }
 
 void
@@ -1375,40 +1754,40 @@ crit_proc_ongoing_handle(bool is_crit_proc_updating)
 }
 
 //Block reboot and shutdown commands in BMC during any FW updating
-static void *
-crit_proc_monitor() {
-
-  bool is_fw_updating = false;
-  bool is_crashdump_ongoing = false;
-  bool is_cplddump_ongoing = false;
-
+static int
+crit_proc_init(void) {
   // set flag to notice BMC healthd crit_proc_monitor is ready
   kv_set("flag_healthd_crit_proc", "1", 0, 0);
+  return 0;
+}
 
-  while(1)
-  {
-    //if is_fw_updating == true, means BMC is Updating a Device FW
-    is_fw_updating = pal_is_fw_update_ongoing_system();
+static int
+crit_proc_monitor(void) {
 
-    //if is_autodump_ongoing == true, modify the permission
-    is_crashdump_ongoing = pal_is_crashdump_ongoing_system();
+  bool is_fw_updating = false;
+  bool is_crashdump_ongoing = false;
+  bool is_cplddump_ongoing = false;
 
-    //if is_cplddump_ongoing == true, modify the permission
-    is_cplddump_ongoing = pal_is_cplddump_ongoing_system();
+  //if is_fw_updating == true, means BMC is Updating a Device FW
+  is_fw_updating = pal_is_fw_update_ongoing_system();
 
-    if ( (true == is_fw_updating) || (true == is_crashdump_ongoing) || (true == is_cplddump_ongoing) )
-    {
-      crit_proc_ongoing_handle(true);
-    }
+  //if is_autodump_ongoing == true, modify the permission
+  is_crashdump_ongoing = pal_is_crashdump_ongoing_system();
 
-    if ( (false == is_fw_updating) && (false == is_crashdump_ongoing) && (false == is_cplddump_ongoing) )
-    {
-      crit_proc_ongoing_handle(false);
-    }
+  //if is_cplddump_ongoing == true, modify the permission
+  is_cplddump_ongoing = pal_is_cplddump_ongoing_system();
 
-    sleep(1);
+  if ( (true == is_fw_updating) || (true == is_crashdump_ongoing) || (true == is_cplddump_ongoing) )
+  {
+    crit_proc_ongoing_handle(true);
   }
-  return NULL;
+
+  if ( (false == is_fw_updating) && (false == is_crashdump_ongoing) && (false == is_cplddump_ongoing) )
+  {
+    crit_proc_ongoing_handle(false);
+  }
+
+  return 1000;
 }
 
 static int log_count(const char *str)
@@ -1686,18 +2065,14 @@ log_reboot_cause(char *sled_off_time)
   close(mem_fd);
 }
 
-// Thread to monitor SLED Cycles by using time stamp
-static void *
-timestamp_handler()
+// Monitor SLED Cycles by using time stamp
+static long time_sled_off;
+
+static int
+timestamp_init(void)
 {
-  int count = 0;
-  struct timespec ts;
-  struct timespec mts;
   char tstr[MAX_VALUE_LEN] = {0};
   char buf[128] = {0};
-  uint8_t time_init = 0;
-  long time_sled_on;
-  long time_sled_off;
 
   // Read the last timestamp from KV storage
   pal_get_key_value("timestamp_sled", tstr);
@@ -1707,156 +2082,156 @@ timestamp_handler()
 
   // set flag to notice BMC healthd timestamp_handler is ready
   kv_set("flag_healthd_bmc_timestamp", "1", 0, 0);
+  return 0;
+}
 
-  while (1) {
-
-    // Make sure the time is initialized properly
-    // Since there is no battery backup, the time could be reset to build time
-    // wait 100s at most, to prevent infinite waiting
-    if ( time_init < SLED_TS_TIMEOUT ) {
-      // Read current time
-      clock_gettime(CLOCK_REALTIME, &ts);
+static int
+timestamp_handler(void)
+{
+  static int count = 0;
+  static uint8_t time_init = 0;
+  struct timespec ts;
+  struct timespec mts;
+  char buf[128] = {0};
+  long time_sled_on;
 
-      if ( (ts.tv_sec < time_sled_off) && (++time_init < SLED_TS_TIMEOUT) ) {
-        sleep(1);
-        continue;
-      }
+  // Make sure the time is initialized properly
+  // Since there is no battery backup, the time could be reset to build time
+  // wait 100s at most, to prevent infinite waiting
+  if ( time_init < SLED_TS_TIMEOUT ) {
+    // Read current time
+    clock_gettime(CLOCK_REALTIME, &ts);
 
-      // If get the correct time or time sync timeout
-      time_init = SLED_TS_TIMEOUT;
+    if ( (ts.tv_sec < time_sled_off) && (++time_init < SLED_TS_TIMEOUT) ) {
+      return 1000;
+    }
 
-      // Need to log SLED ON event, if this is Power-On-Reset
-      if (pal_is_bmc_por()) {
-        // Get uptime
-        clock_gettime(CLOCK_MONOTONIC, &mts);
-        // To find out when SLED was on, subtract the uptime from current time
-        time_sled_on = ts.tv_sec - mts.tv_sec;
+    // If get the correct time or time sync timeout
+    time_init = SLED_TS_TIMEOUT;
 
-        ctime_r(&time_sled_on, buf);
-        // Log an event if this is Power-On-Reset
-        syslog(LOG_CRIT, "SLED Powered ON at %s", buf);
-      }
-      pal_update_ts_sled();
-    }
+    // Need to log SLED ON event, if this is Power-On-Reset
+    if (pal_is_bmc_por()) {
+      // Get uptime
+      clock_gettime(CLOCK_MONOTONIC, &mts);
+      // To find out when SLED was on, subtract the uptime from current time
+      time_sled_on = ts.tv_sec - mts.tv_sec;
 
-    // Store timestamp every one hour to keep track of SLED power
-    if (count++ == HB_TIMESTAMP_COUNT) {
-      pal_update_ts_sled();
-      count = 0;
+      ctime_r(&time_sled_on, buf);
+      // Log an event if this is Power-On-Reset
+      syslog(LOG_CRIT, "SLED Powered ON at %s", buf);
     }
+    pal_update_ts_sled();
+  }
 
-    sleep(HB_SLEEP_TIME);
+  // Store timestamp every one hour to keep track of SLED power
+  if (count++ == HB_TIMESTAMP_COUNT) {
+    pal_update_ts_sled();
+    count = 0;
   }
 
-  return NULL;
+  return HB_SLEEP_TIME * 1000;
 }
 
-static void *
-bic_health_monitor() {
-  int err_cnt = 0;
+static int
+bic_health_init(void) {
+  // set flag to notice BMC healthd bic_health_monitor is ready
+  kv_set("flag_healthd_bic_health", "1", 0, 0);
+  return 0;
+}
+
+static int
+bic_health_monitor(void) {
+  static int err_cnt = 0;
+  static uint8_t err_type[BIC_RESET_ERR_CNT] = {0};
+  static bool is_already_reset = false;
   int i = 0;
   uint8_t status = 0;
-  uint8_t err_type[BIC_RESET_ERR_CNT] = {0};
   uint8_t type = 0;
   const char* err_str[BIC_ERR_TYPE_CNT] = {
     "heartbeat", "IPMB", "BIC ready"
   };
   char err_log[MAX_LOG_SIZE] = "\0";
-  bool is_already_reset = false;
 
-  // set flag to notice BMC healthd bic_health_monitor is ready
-  kv_set("flag_healthd_bic_health", "1", 0, 0);
-
-  while (1) {
-    if ((pal_get_server_12v_power(bic_fru, &status) < 0) || (status == SERVER_12V_OFF)) {
-      goto next_run;
-    }
-    
-    // Check if bic is updating
-    if (pal_is_fw_update_ongoing(bic_fru) == true) {
-      err_cnt = 0;
-      sleep(BIC_HEALTH_INTERVAL);
-      continue;
-    }
+  if ((pal_get_server_12v_power(bic_fru, &status) < 0) || (status == SERVER_12V_OFF)) {
+    goto next_run;
+  }
+  
+  // Check if bic is updating
+  if (pal_is_fw_update_ongoing(bic_fru) == true) {
+    err_cnt = 0;
+    return BIC_HEALTH_INTERVAL * 1000;
+  }
 
-    // Read BIC ready pin to check BIC boots up completely
-    if ((pal_is_bic_ready(bic_fru, &status) < 0) || (status == false)) {
-      err_type[err_cnt++] = BIC_READY_ERR;
-      goto next_run;
-    }
+  // Read BIC ready pin to check BIC boots up completely
+  if ((pal_is_bic_ready(bic_fru, &status) < 0) || (status == false)) {
+    err_type[err_cnt++] = BIC_READY_ERR;
+    goto next_run;
+  }
 
-    // Check whether BIC heartbeat works 
-    if (pal_is_bic_heartbeat_ok(bic_fru) == false) {
-      err_type[err_cnt++] = BIC_HB_ERR;
-      goto next_run;
-    }
+  // Check whether BIC heartbeat works 
+  if (pal_is_bic_heartbeat_ok(bic_fru) == false) {
+    err_type[err_cnt++] = BIC_HB_ERR;
+    goto next_run;
+  }
 
-    // Send a IPMB command to check IPMB service works normal
-    if (pal_bic_self_test() < 0) {
-      err_type[err_cnt++] = BIC_IPMB_ERR;
-      goto next_run;
-    }
-    // if all check pass, clear error counter and reset flag
-    err_cnt = 0;
-    is_already_reset = false;
+  // Send a IPMB command to check IPMB service works normal
+  if (pal_bic_self_test() < 0) {
+    err_type[err_cnt++] = BIC_IPMB_ERR;
+    goto next_run;
+  }
+  // if all check pass, clear error counter and reset flag
+  err_cnt = 0;
+  is_already_reset = false;
 
-    // The ME commands are transmit via BIC on Grand Canyon, so check ME health when BIC health is good.
-    if ((nm_monitor_enabled == true) && (nm_transmission_via_bic == true)) {
-      nm_selftest(bic_fru);
-    }
+  // The ME commands are transmit via BIC on Grand Canyon, so check ME health when BIC health is good.
+  if ((nm_monitor_enabled == true) && (nm_transmission_via_bic == true)) {
+    nm_selftest(bic_fru);
+  }
 next_run:
-    if ((err_cnt >= BIC_RESET_ERR_CNT) && (is_already_reset == false)) {
-      // if error counter over 3, reset BIC by hardware
-      if (pal_bic_hw_reset() == 0) {
-        memset(err_log, 0, sizeof(err_log));
-        for (i = 0; i < BIC_RESET_ERR_CNT; i++) {
-          type = err_type[i];
-          strcat(err_log, err_str[type]);
-          if (i != BIC_RESET_ERR_CNT - 1) { // last one
-            strcat(err_log, ", ");
-          }          
-        }
-        syslog(LOG_CRIT, "FRU %d BIC reset by BIC health monitor due to health check failed in following order: %s", 
-                bic_fru, err_log);
-        err_cnt = 0;
-        is_already_reset = true;
+  if ((err_cnt >= BIC_RESET_ERR_CNT) && (is_already_reset == false)) {
+    // if error counter over 3, reset BIC by hardware
+    if (pal_bic_hw_reset() == 0) {
+      memset(err_log, 0, sizeof(err_log));
+      for (i = 0; i < BIC_RESET_ERR_CNT; i++) {
+        type = err_type[i];
+        strcat(err_log, err_str[type]);
+        if (i != BIC_RESET_ERR_CNT - 1) { // last one
+          strcat(err_log, ", ");
+        }          
       }
+      syslog(LOG_CRIT, "FRU %d BIC reset by BIC health monitor due to health check failed in following order: %s", 
+              bic_fru, err_log);
+      err_cnt = 0;
+      is_already_reset = true;
     }
-    sleep(BIC_HEALTH_INTERVAL);
   }
-
-  return NULL;
+  return BIC_HEALTH_INTERVAL * 1000;
 }
 
-static void *
-log_rearm_check() {
+static int
+log_rearm_check(void) {
   int ret = 0;
   char val[MAX_KEY_LEN] = {0};
 
-  while (1) {
-    ret = kv_get(KV_KEY_HEALTHD_REARM, val, NULL, 0);
-    if (ret < 0) {
-      sleep(LOG_REARM_CHECK_INTERVAL);
-      continue;
+  ret = kv_get(KV_KEY_HEALTHD_REARM, val, NULL, 0);
+  if (ret < 0) {
+    return LOG_REARM_CHECK_INTERVAL * 1000;
+  }
+  if (strcmp(val, "1") == 0) {
+    if (nm_monitor_enabled == true) {        
+      memset(is_duplicated_unaccess_event, 0, sizeof(is_duplicated_unaccess_event));
+      memset(is_duplicated_abnormal_event, 0, sizeof(is_duplicated_abnormal_event));
     }
-    if (strcmp(val, "1") == 0) {
-      if (nm_monitor_enabled == true) {        
-        memset(is_duplicated_unaccess_event, 0, sizeof(is_duplicated_unaccess_event));
-        memset(is_duplicated_abnormal_event, 0, sizeof(is_duplicated_abnormal_event));
-      }
-      if (vboot_state_check && vboot_supported()) {
-        check_vboot_state();
-      }
-      kv_set(KV_KEY_HEALTHD_REARM, "0", 0, 0);
+    if (vboot_state_check && vboot_supported()) {
+      check_vboot_state();
     }
-    sleep(LOG_REARM_CHECK_INTERVAL);
+    kv_set(KV_KEY_HEALTHD_REARM, "0", 0, 0);
   }
-  
-  return NULL;
+  return LOG_REARM_CHECK_INTERVAL * 1000;
 }
 
-static void *
-ubifs_health_monitor() {
+static int
+ubifs_health_monitor(void) {
   const char ubifs_ro_error[] = "/sys/kernel/debug/ubifs/ubi0_0/ro_error";
   FILE *fp;
   int val;
@@ -1865,6 +2240,23 @@ ubifs_health_monitor() {
   uint32_t sram_bmc_reboot_base = 0x0;
   uint32_t sram_offset = 0x0;
 
+  fp = fopen(ubifs_ro_error, "r");
+  if (fp == NULL) {
+    syslog(LOG_ERR, "%s: open %s failed", __func__, ubifs_ro_error);
+    return uhm_config.monitor_interval * 1000;
+  }
+  if (fscanf(fp, "%d", &val) != 1) {
+    syslog(LOG_ERR, "%s: read %s failed", __func__, ubifs_ro_error);
+    fclose(fp);
+    return uhm_config.monitor_interval * 1000;
+  }
+  fclose(fp);
+  if (val == 0) {
+    return uhm_config.monitor_interval * 1000;
+  }
+
+  syslog(LOG_CRIT, "%s: ubifs (/dev/ubi0_0) in read-only mode (ro_error=%d)", __func__, val);
+
   if (get_soc_model() == SOC_MODEL_ASPEED_G6) {
     sram_bmc_reboot_base = AST_G6_SRAM_BMC_REBOOT_BASE;
     sram_offset = AST_G6_SRAM_BMC_REBOOT_OFFSET;
@@ -1873,222 +2265,470 @@ ubifs_health_monitor() {
     sram_offset = AST_SRAM_BMC_REBOOT_OFFSET;
   }
 
-  while (1) {
-    fp = fopen(ubifs_ro_error, "r");
-    if (fp == NULL) {
-      syslog(LOG_ERR, "%s: open %s failed", __func__, ubifs_ro_error);
-    } else if (fscanf(fp, "%d", &val) != 1) {
-      syslog(LOG_ERR, "%s: read %s failed", __func__, ubifs_ro_error);
-    } else if (val != 0) {
-      syslog(LOG_CRIT, "%s: ubifs (/dev/ubi0_0) in read-only mode (ro_error=%d)", __func__, val);
-
-      mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-      if (mem_fd < 0) {
-        syslog(LOG_ERR, "devmem open failed");
-      } else {
-        bmc_reboot_base = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mem_fd, sram_bmc_reboot_base);
-        if (bmc_reboot_base == NULL) {
-          syslog(LOG_ERR, "Mapping SRAM_BMC_REBOOT_BASE failed");
-        } else {
-          BMC_REBOOT_BY_CMD(bmc_reboot_base, sram_offset) |= BIT_RECORD_LOG | FLAG_UBIFS_ERROR;
-        }
-        close(mem_fd);
-      }
-      fclose(fp);
-      break;
+  mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
+  if (mem_fd < 0) {
+    syslog(LOG_ERR, "devmem open failed");
+  } else {
+    bmc_reboot_base = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, mem_fd, sram_bmc_reboot_base);
+    if (bmc_reboot_base == NULL) {
+      syslog(LOG_ERR, "Mapping SRAM_BMC_REBOOT_BASE failed");
+    } else {
+      BMC_REBOOT_BY_CMD(bmc_reboot_base, sram_offset) |= BIT_RECORD_LOG | FLAG_UBIFS_ERROR;
     }
-    if (fp != NULL)
-      fclose(fp);
-    sleep(uhm_config.monitor_interval);
+    close(mem_fd);
   }
 
   pal_bmc_reboot(RB_AUTOBOOT);
-  return NULL;
+  return -1;
 }
 
-void sig_handler(int signo) {
-  // Catch SIGALRM and SIGTERM. If recived signal record BMC log
-  syslog(LOG_CRIT, "BMC health daemon stopped.");
-  exit(0);
-}
+/*
+ * Time-series ring of the BMC health metrics, a file mapped shared so
+ * the latest samples outlive the process and are read without IPC.
+ * The writer zeroes the seq of a record, fills it in and then sets its
+ * seq: a reader keeps a copy only if the seq is the expected one before
+ * and after the copy.
+ */
+struct metrics_proc_s {
+  char comm[16];
+  uint32_t pid;
+  uint32_t rss_kb;
+};
 
-int
-main(int argc, char **argv) {
-  pthread_t tid_watchdog;
-  pthread_t tid_hb_led;
-  pthread_t tid_i2c_mon;
-  pthread_t tid_cpu_monitor;
-  pthread_t tid_mem_monitor;
-  pthread_t tid_crit_proc_monitor;
-  pthread_t tid_ecc_monitor;
-  pthread_t tid_bmc_health_monitor;
-  pthread_t tid_nm_monitor;
-  pthread_t tid_pfr_monitor;
-  pthread_t tid_timestamp_handler;
-  pthread_t tid_bic_health_monitor;
-  pthread_t tid_log_rearm_check;
-  pthread_t tid_ubifs_health_monitor;
+struct metrics_rec_s {
+  uint32_t seq;          // 0 while the record is written
+  uint32_t time;         // seconds since the Epoch
+  uint16_t cpu_util;     // 0.01%
+  uint16_t mem_util;     // 0.01%
+  uint32_t i2c_errors;   // failed libobmc-i2c transactions, all buses
+  uint32_t i2c_crashes;  // bus crashes found by the I2C monitor
+  uint16_t ecc_recov;    // ECC error counters
+  uint16_t ecc_unrec;
+  struct metrics_proc_s procs[METRICS_NUM_PROCS];  // largest RSS first
+};
 
-  if (argc > 1) {
-    exit(1);
-  }
+struct metrics_ring_s {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t rec_size;
+  uint32_t num_recs;
+  uint32_t seq;          // of the latest record
+  uint32_t reserved[3];
+  struct metrics_rec_s recs[METRICS_NUM_RECS];
+};
 
-  //Catch signals
-  signal(SIGALRM, sig_handler);
-  signal(SIGTERM, sig_handler);
+static struct metrics_ring_s *metrics_ring;
 
-  initilize_all_kv();
+static bool
+metrics_ring_valid(const struct metrics_ring_s *ring) {
+  return ring->magic == METRICS_MAGIC && ring->version == METRICS_VERSION &&
+         ring->rec_size == sizeof(struct metrics_rec_s) &&
+         ring->num_recs == METRICS_NUM_RECS;
+}
 
-  initialize_configuration();
+static int
+metrics_init(void) {
+  void *addr;
+  int fd;
 
-  if (vboot_state_check && vboot_supported()) {
-    check_vboot_state();
-    /* curr version is stored only when vboot is
-     * successful */
-  } else {
-    store_curr_version();
+  fd = open(METRICS_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    syslog(LOG_WARNING, "%s: open %s failed", __func__, METRICS_PATH);
+    return -1;
   }
-
-// For current platforms, we are using WDT from either fand or fscd
-// TODO: keeping this code until we make healthd as central daemon that
-//  monitors all the important daemons for the platforms.
-  if (pthread_create(&tid_watchdog, NULL, watchdog_handler, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for watchdog error\n");
-    exit(1);
+  if (ftruncate(fd, sizeof(*metrics_ring)) < 0) {
+    syslog(LOG_WARNING, "%s: truncate %s failed", __func__, METRICS_PATH);
+    close(fd);
+    return -1;
   }
+  addr = mmap(NULL, sizeof(*metrics_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    syslog(LOG_WARNING, "%s: mmap %s failed", __func__, METRICS_PATH);
+    return -1;
+  }
+  metrics_ring = addr;
 
-  if (pthread_create(&tid_hb_led, NULL, hb_handler, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for heartbeat error\n");
-    exit(1);
+  // Samples of a previous run are kept
+  if (!metrics_ring_valid(metrics_ring)) {
+    memset(metrics_ring, 0, sizeof(*metrics_ring));
+    metrics_ring->magic = METRICS_MAGIC;
+    metrics_ring->version = METRICS_VERSION;
+    metrics_ring->rec_size = sizeof(struct metrics_rec_s);
+    metrics_ring->num_recs = METRICS_NUM_RECS;
   }
+  return 0;
+}
 
-  if (cpu_monitor_enabled) {
-    if (pthread_create(&tid_cpu_monitor, NULL, CPU_usage_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for monitor CPU usage\n");
-      exit(1);
+// The processes of the largest RSS, largest first
+static void
+metrics_top_rss(struct metrics_rec_s *rec) {
+  static struct proc_sample_s samples[MAX_PROC_SAMPLES];
+  struct proc_sample_s *top[METRICS_NUM_PROCS] = {NULL};
+  long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  size_t i, j, num;
+
+  num = scan_procs(samples, MAX_PROC_SAMPLES);
+  for (i = 0; i < num; i++) {
+    for (j = METRICS_NUM_PROCS; j > 0 && (!top[j-1] || top[j-1]->rss < samples[i].rss); j--) {
+      if (j < METRICS_NUM_PROCS) {
+        top[j] = top[j-1];
+      }
+    }
+    if (j < METRICS_NUM_PROCS) {
+      top[j] = &samples[i];
     }
   }
+  for (i = 0; i < METRICS_NUM_PROCS && top[i]; i++) {
+    memcpy(rec->procs[i].comm, top[i]->comm, sizeof(rec->procs[i].comm));
+    rec->procs[i].pid = top[i]->pid;
+    rec->procs[i].rss_kb = top[i]->rss * page_kb;
+  }
+}
 
-  if (mem_monitor_enabled) {
-    if (pthread_create(&tid_mem_monitor, NULL, memory_usage_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for monitor memory usage\n");
-      exit(1);
+static int
+metrics_monitor(void) {
+  static unsigned long long pre_total = 0, pre_idle = 0;
+  struct metrics_rec_s *rec;
+  struct cpu_stat_s cpu;
+  struct mem_stat_s mem;
+  i2c_bus_stats_t stats;
+  unsigned long long total, idle;
+  uint32_t seq = metrics_ring->seq + 1;
+  int bus;
+
+  rec = &metrics_ring->recs[seq % METRICS_NUM_RECS];
+  rec->seq = 0;
+  __sync_synchronize();
+
+  memset(&rec->time, 0, sizeof(*rec) - offsetof(struct metrics_rec_s, time));
+  rec->time = time(NULL);
+  if (get_cpu_stat(&cpu) == 0) {
+    idle = cpu.idle + cpu.iowait;
+    total = idle + cpu.user + cpu.nice + cpu.system + cpu.irq + cpu.softirq + cpu.steal;
+    if (pre_total && total > pre_total) {
+      rec->cpu_util = (total - pre_total - (idle - pre_idle)) * 10000 / (total - pre_total);
     }
+    pre_total = total;
+    pre_idle = idle;
   }
-
-  if (i2c_monitor_enabled) {
-    // Add a thread for monitoring all I2C buses crash or not
-    if (pthread_create(&tid_i2c_mon, NULL, i2c_mon_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for I2C errorr\n");
-      exit(1);
+  if (get_mem_stat(&mem) == 0) {
+    rec->mem_util = (mem.total_kb - mem.free_kb) * 10000 / mem.total_kb;
+  }
+  for (bus = 0; bus < I2C_BUS_STATS_MAX; bus++) {
+    if (i2c_bus_stats_get(bus, &stats) == 0) {
+      rec->i2c_errors += stats.naks + stats.timeouts + stats.errors;
     }
   }
+  rec->i2c_crashes = i2c_crash_count;
+  rec->ecc_recov = ecc_recov_count;
+  rec->ecc_unrec = ecc_unrec_count;
+  metrics_top_rss(rec);
 
-  if (ecc_monitor_enabled) {
-    if (pthread_create(&tid_ecc_monitor, NULL, ecc_mon_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for ECC monitoring errorr\n");
-      exit(1);
-    }
+  __sync_synchronize();
+  rec->seq = seq;
+  metrics_ring->seq = seq;
+  return metrics_interval * 1000;
+}
+
+// Print the ring, oldest sample first: "healthd --metrics"
+static int
+dump_metrics(void) {
+  const struct metrics_ring_s *ring;
+  struct metrics_rec_s rec;
+  char tstr[32];
+  struct tm tm;
+  time_t t;
+  uint32_t seq, last;
+  int fd, i;
+
+  fd = open(METRICS_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open %s: %s\n", METRICS_PATH, strerror(errno));
+    return -1;
+  }
+  ring = mmap(NULL, sizeof(*ring), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ring == MAP_FAILED || !metrics_ring_valid(ring)) {
+    fprintf(stderr, "Invalid metrics in %s\n", METRICS_PATH);
+    return -1;
   }
 
-  if (regen_log_enabled) {
-    if (pthread_create(&tid_bmc_health_monitor, NULL, bmc_health_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for BMC Health monitoring errorr\n");
-      exit(1);
+  printf("%-19s %7s %7s %8s %9s %5s %5s  %s\n", "time", "cpu%", "mem%",
+         "i2c_err", "i2c_crash", "ecc_r", "ecc_u", "top rss (kB)");
+  last = ring->seq;
+  seq = (last > METRICS_NUM_RECS) ? last - METRICS_NUM_RECS + 1 : 1;
+  for (; seq != 0 && seq <= last; seq++) {
+    const struct metrics_rec_s *slot = &ring->recs[seq % METRICS_NUM_RECS];
+
+    if (slot->seq != seq) {
+      continue;
+    }
+    __sync_synchronize();
+    rec = *slot;
+    __sync_synchronize();
+    if (slot->seq != seq) {
+      continue;  // overwritten while copied
+    }
+
+    t = rec.time;
+    localtime_r(&t, &tm);
+    strftime(tstr, sizeof(tstr), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("%-19s %7.2f %7.2f %8u %9u %5u %5u ", tstr, rec.cpu_util / 100.0,
+           rec.mem_util / 100.0, rec.i2c_errors, rec.i2c_crashes, rec.ecc_recov, rec.ecc_unrec);
+    for (i = 0; i < METRICS_NUM_PROCS && rec.procs[i].comm[0]; i++) {
+      printf(" %.16s(%u):%u", rec.procs[i].comm, rec.procs[i].pid, rec.procs[i].rss_kb);
     }
+    printf("\n");
   }
+  munmap((void *)ring, sizeof(*ring));
+  return 0;
+}
 
-  if ((nm_monitor_enabled == true) && (nm_transmission_via_bic == false)) {
-    if (pthread_create(&tid_nm_monitor, NULL, nm_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for nm monitor error\n");
-      exit(1);
+/*
+ * The monitors enabled by healthd-config.json are run by one event loop
+ * on a timerfd: init() (optional) is called once and run() at every
+ * check, both return the milliseconds until the next run(), or -1 to
+ * stop the monitor. The monitors doing blocking transactions (IPMB,
+ * PFR mailbox) run in a thread of their own, so they do not hold up
+ * the watchdog kick and the other checks.
+ */
+#define MAX_MONITORS 16
+
+struct monitor_s {
+  const char *name;
+  int (*init)(void);
+  int (*run)(void);
+  bool blocking;
+  bool stopped;
+  uint64_t next_ms;
+  pthread_t tid;
+};
+
+static struct monitor_s monitors[MAX_MONITORS];
+static size_t num_monitors = 0;
+
+static uint64_t
+monotonic_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+add_monitor(const char *name, int (*init)(void), int (*run)(void), bool blocking) {
+  struct monitor_s *mon;
+
+  if (num_monitors >= MAX_MONITORS) {
+    syslog(LOG_WARNING, "%s: too many monitors, %s not started", __func__, name);
+    return;
+  }
+  mon = &monitors[num_monitors++];
+  mon->name = name;
+  mon->init = init;
+  mon->run = run;
+  mon->blocking = blocking;
+}
+
+static void *
+monitor_thread(void *arg) {
+  struct monitor_s *mon = (struct monitor_s *)arg;
+  int delay = mon->init ? mon->init() : 0;
+
+  while (delay >= 0) {
+    if (delay > 0) {
+      msleep(delay);
     }
+    delay = mon->run();
   }
+  return NULL;
+}
 
-  if (pfr_monitor_enabled) {
-    if (pthread_create(&tid_pfr_monitor, NULL, pfr_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for pfr monitor error\n");
+static void
+start_blocking_monitors(void) {
+  size_t i;
+
+  for (i = 0; i < num_monitors; i++) {
+    if (!monitors[i].blocking) {
+      continue;
+    }
+    if (pthread_create(&monitors[i].tid, NULL, monitor_thread, &monitors[i])) {
+      syslog(LOG_WARNING, "pthread_create for %s error\n", monitors[i].name);
       exit(1);
     }
   }
+}
 
-  if (pthread_create(&tid_crit_proc_monitor, NULL, crit_proc_monitor, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for FW Update Monitor error\n");
+// Returns once every non-blocking monitor has stopped
+static void
+run_monitors(void) {
+  struct itimerspec its = {0};
+  struct monitor_s *mon;
+  uint64_t now, next, expirations;
+  int tfd, delay;
+  size_t i;
+
+  tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (tfd < 0) {
+    syslog(LOG_CRIT, "%s: timerfd_create failed: %s", __func__, strerror(errno));
     exit(1);
   }
 
-  if (bmc_timestamp_enabled) {
-    if (pthread_create(&tid_timestamp_handler, NULL, timestamp_handler, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for time stamp handler error\n");
-      exit(1);
+  now = monotonic_ms();
+  for (i = 0; i < num_monitors; i++) {
+    mon = &monitors[i];
+    if (mon->blocking) {
+      continue;
+    }
+    delay = mon->init ? mon->init() : 0;
+    if (delay < 0) {
+      mon->stopped = true;
+      continue;
     }
+    mon->next_ms = now + delay;
   }
 
-  if (bic_health_enabled) {
-    if (pthread_create(&tid_bic_health_monitor, NULL, bic_health_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for bic health monitor error\n");
+  while (1) {
+    // The monitors are run in the order they are added
+    next = UINT64_MAX;
+    for (i = 0; i < num_monitors; i++) {
+      mon = &monitors[i];
+      if (mon->blocking || mon->stopped) {
+        continue;
+      }
+      now = monotonic_ms();
+      if (mon->next_ms <= now) {
+        delay = mon->run();
+        if (delay < 0) {
+          syslog(LOG_WARNING, "%s monitor stopped", mon->name);
+          mon->stopped = true;
+          continue;
+        }
+        mon->next_ms = monotonic_ms() + delay;
+      }
+      if (mon->next_ms < next) {
+        next = mon->next_ms;
+      }
+    }
+    if (next == UINT64_MAX) {
+      break;
+    }
+    loop_pass++;
+
+    // it_value of 0 would disarm the timer
+    its.it_value.tv_sec = next / 1000;
+    its.it_value.tv_nsec = (next % 1000) * 1000000 + 1;
+    if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+      syslog(LOG_CRIT, "%s: timerfd_settime failed: %s", __func__, strerror(errno));
       exit(1);
     }
-  }
-  if (pthread_create(&tid_log_rearm_check, NULL, log_rearm_check, NULL)) {
-    syslog(LOG_WARNING, "pthread_create for log re-arm monitor error\n");
-    exit(1);
-  }
-  if (uhm_config.enabled) {
-    if (pthread_create(&tid_ubifs_health_monitor, NULL, ubifs_health_monitor, NULL)) {
-      syslog(LOG_WARNING, "pthread_create for ubifs health monitor error\n");
+    if (read(tfd, &expirations, sizeof(expirations)) < 0 && errno != EINTR) {
+      syslog(LOG_CRIT, "%s: read timerfd failed: %s", __func__, strerror(errno));
       exit(1);
     }
   }
+  close(tfd);
+}
 
-  pthread_join(tid_watchdog, NULL);
+void sig_handler(int signo) {
+  // Catch SIGALRM and SIGTERM. If recived signal record BMC log
+  syslog(LOG_CRIT, "BMC health daemon stopped.");
+  exit(0);
+}
 
-  pthread_join(tid_hb_led, NULL);
+int
+main(int argc, char **argv) {
+  size_t i;
 
-  if (i2c_monitor_enabled) {
-    pthread_join(tid_i2c_mon, NULL);
+  if (argc == 2 && !strcmp(argv[1], "--metrics")) {
+    return dump_metrics() ? 1 : 0;
+  }
+  if (argc > 1) {
+    exit(1);
+  }
+
+  //Catch signals
+  signal(SIGALRM, sig_handler);
+  signal(SIGTERM, sig_handler);
+
+  initilize_all_kv();
+
+  initialize_configuration();
+
+  if (vboot_state_check && vboot_supported()) {
+    check_vboot_state();
+    /* curr version is stored only when vboot is
+     * successful */
+  } else {
+    store_curr_version();
   }
+
+// For current platforms, we are using WDT from either fand or fscd
+// TODO: keeping this code until we make healthd as central daemon that
+//  monitors all the important daemons for the platforms.
+  add_monitor("watchdog", watchdog_init, watchdog_handler, false);
+
+  add_monitor("heartbeat", hb_init, hb_handler, false);
+
   if (cpu_monitor_enabled) {
-    pthread_join(tid_cpu_monitor, NULL);
+    add_monitor("CPU usage", CPU_usage_init, CPU_usage_monitor, false);
   }
 
   if (mem_monitor_enabled) {
-    pthread_join(tid_mem_monitor, NULL);
+    add_monitor("memory usage", memory_usage_init, memory_usage_monitor, false);
+  }
+
+  if (i2c_monitor_enabled) {
+    // Monitor all I2C buses crash or not
+    add_monitor("I2C", NULL, i2c_mon_handler, false);
   }
 
   if (ecc_monitor_enabled) {
-    pthread_join(tid_ecc_monitor, NULL);
+    add_monitor("ECC", ecc_mon_init, ecc_mon_handler, false);
   }
 
   if (regen_log_enabled) {
-    pthread_join(tid_bmc_health_monitor, NULL);
+    add_monitor("BMC health", NULL, bmc_health_monitor, false);
   }
 
   if ((nm_monitor_enabled == true) && (nm_transmission_via_bic == false)) {
-    pthread_join(tid_nm_monitor, NULL);
+    add_monitor("nm", NULL, nm_monitor, true);
   }
 
   if (pfr_monitor_enabled) {
-    pthread_join(tid_pfr_monitor, NULL);
+    add_monitor("pfr", pfr_monitor_init, pfr_monitor, true);
   }
 
-  pthread_join(tid_crit_proc_monitor, NULL);
+  add_monitor("FW Update", crit_proc_init, crit_proc_monitor, false);
 
   if (bmc_timestamp_enabled) {
-    pthread_join(tid_timestamp_handler, NULL);
+    add_monitor("time stamp", timestamp_init, timestamp_handler, false);
   }
 
   if (bic_health_enabled) {
-    pthread_join(tid_bic_health_monitor, NULL);
+    add_monitor("bic health", bic_health_init, bic_health_monitor, true);
   }
 
-  if (log_rearm_enabled){
-    pthread_join(tid_log_rearm_check, NULL);
-  }
+  add_monitor("log re-arm", NULL, log_rearm_check, false);
 
   if (uhm_config.enabled) {
-    pthread_join(tid_ubifs_health_monitor, NULL);
-  }  
+    add_monitor("ubifs health", NULL, ubifs_health_monitor, false);
+  }
+
+  if (metrics_enabled) {
+    add_monitor("metrics", metrics_init, metrics_monitor, false);
+  }
+
+  start_blocking_monitors();
+
+  run_monitors();
+
+  for (i = 0; i < num_monitors; i++) {
+    if (monitors[i].blocking) {
+      pthread_join(monitors[i].tid, NULL);
+    }
+  }
 
   return 0;
 }
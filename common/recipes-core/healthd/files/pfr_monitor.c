@@ -342,14 +342,13 @@ initialize_pfr_monitor_config(json_t *conf) {
   pfr_monitor_enabled = false;
 }
 
+// state-history offsets of every FRU, kept between the checks
+static uint8_t rb_start[MAX_NUM_FRUS], rb_end[MAX_NUM_FRUS], rb_wrapped[MAX_NUM_FRUS];
+
 static int
-monitor_ring_buffer() {
+init_ring_buffer() {
   uint8_t bus, addr;
-  uint8_t i, j, idx;
-  uint8_t tbuf[8], rbuf[80];
-  uint8_t start[MAX_NUM_FRUS], end[MAX_NUM_FRUS], wrapped[MAX_NUM_FRUS], last;
-  char log_buf[256];
-  const char *log_ptr;
+  uint8_t i;
   bool bridged;
   int is_por;
 
@@ -368,14 +367,14 @@ monitor_ring_buffer() {
 
   is_por = pal_is_bmc_por();
   for (i = 0; i < pfr_fru_count; i++) {
-    get_last_offset(pfr_mbox[i].fru, &start[i], &end[i]);
+    get_last_offset(pfr_mbox[i].fru, &rb_start[i], &rb_end[i]);
     if (is_por || !is_magic_set ||
-        (start[i] <= 1) || (end[i] <= 1) ||
-        (start[i] >= PFR_STATE_SIZE) || (end[i] >= PFR_STATE_SIZE)) {
-      start[i] = 0x00;
-      end[i] = 0x01;
+        (rb_start[i] <= 1) || (rb_end[i] <= 1) ||
+        (rb_start[i] >= PFR_STATE_SIZE) || (rb_end[i] >= PFR_STATE_SIZE)) {
+      rb_start[i] = 0x00;
+      rb_end[i] = 0x01;
     }
-    wrapped[i] = (start[i] > end[i]) ? 1 : 0;
+    rb_wrapped[i] = (rb_start[i] > rb_end[i]) ? 1 : 0;
 
     if (pal_get_pfr_address(pfr_mbox[i].fru, &bus, &addr, &bridged)) {
       syslog(LOG_WARNING, "%s: get PFR address failed, fru %d", __func__, pfr_mbox[i].fru);
@@ -389,108 +388,104 @@ monitor_ring_buffer() {
   memset(st_table, 0x00, sizeof(st_table));
   init_pfr_state_table(st_table);
 
-  while (1) {
-    for (i = 0; i < pfr_fru_count; i++) {
-      if (pfr_mbox[i].bus == 0xFF) {  // failed get PFR address
-        continue;
-      }
+  return 0;
+}
 
-      tbuf[0] = state_history_mbox_offset; // get start/end offset of state-history
-      if (pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, &rbuf[0], 2)) {
-        syslog(LOG_WARNING, "%s: read state-history index failed", __func__);
-        continue;
-      }
+static void
+monitor_ring_buffer() {
+  uint8_t i, j, idx;
+  uint8_t tbuf[8], rbuf[80];
+  uint8_t last;
+  char log_buf[256];
+  const char *log_ptr;
 
-      if ((rbuf[0] == start[i]) && (rbuf[1] == end[i])) {
-        continue;
-      }
+  for (i = 0; i < pfr_fru_count; i++) {
+    if (pfr_mbox[i].bus == 0xFF) {  // failed get PFR address
+      continue;
+    }
 
-      if ((wrapped[i] || (end[i] > rbuf[1])) && (rbuf[1] > rbuf[0])) {
-        start[i] = 0x00;
-        end[i] = 0x01;
-      }
+    tbuf[0] = state_history_mbox_offset; // get start/end offset of state-history
+    if (pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, &rbuf[0], 2)) {
+      syslog(LOG_WARNING, "%s: read state-history index failed", __func__);
+      continue;
+    }
 
-      for (j = 0; j < PFR_STATE_SIZE; j += 16) {  // get whole state-history
-        tbuf[0] = state_history_mbox_offset + j;
-        if (pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, &rbuf[j], 16)) {
-          syslog(LOG_WARNING, "%s: read state-history failed", __func__);
-          break;
-        }
-      }
-      if (j < PFR_STATE_SIZE)
-        continue;
+    if ((rbuf[0] == rb_start[i]) && (rbuf[1] == rb_end[i])) {
+      continue;
+    }
 
-      last = end[i];
-      start[i] = rbuf[0];
-      end[i] = rbuf[1];
+    if ((rb_wrapped[i] || (rb_end[i] > rbuf[1])) && (rbuf[1] > rbuf[0])) {
+      rb_start[i] = 0x00;
+      rb_end[i] = 0x01;
+    }
 
-      if (last > rbuf[1]) {
-        rbuf[1] += PFR_STATE_SIZE;
-        wrapped[i] = 1;
+    for (j = 0; j < PFR_STATE_SIZE; j += 16) {  // get whole state-history
+      tbuf[0] = state_history_mbox_offset + j;
+      if (pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, &rbuf[j], 16)) {
+        syslog(LOG_WARNING, "%s: read state-history failed", __func__);
+        break;
       }
-      for (j = last+1; j <= rbuf[1]; j++) {
-        idx = j % PFR_STATE_SIZE;
-        if ((idx > 1) && rbuf[idx] && st_table[rbuf[idx]].desc) {
-          switch (rbuf[idx] & 0xF0) {
-            case 0x70:
-              sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x01)");
-              log_ptr = log_buf;
-              break;
-            case 0x80:
-              sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x02)");
-              log_ptr = log_buf;
-              break;
-            case 0x90:
-              sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x03)");
-              log_ptr = log_buf;
-              break;
-            case 0xB0:
-              sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x04)");
-              log_ptr = log_buf;
-              break;
-            default:
-              log_ptr = st_table[rbuf[idx]].desc;
-              break;
-          }
+    }
+    if (j < PFR_STATE_SIZE)
+      continue;
+
+    last = rb_end[i];
+    rb_start[i] = rbuf[0];
+    rb_end[i] = rbuf[1];
 
-          syslog(LOG_CRIT, "PFR: %s (0x%02X, 0x%02X), FRU: %u", log_ptr,
-                 st_table[rbuf[idx]].addr, st_table[rbuf[idx]].val, pfr_mbox[i].fru);
+    if (last > rbuf[1]) {
+      rbuf[1] += PFR_STATE_SIZE;
+      rb_wrapped[i] = 1;
+    }
+    for (j = last+1; j <= rbuf[1]; j++) {
+      idx = j % PFR_STATE_SIZE;
+      if ((idx > 1) && rbuf[idx] && st_table[rbuf[idx]].desc) {
+        switch (rbuf[idx] & 0xF0) {
+          case 0x70:
+            sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x01)");
+            log_ptr = log_buf;
+            break;
+          case 0x80:
+            sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x02)");
+            log_ptr = log_buf;
+            break;
+          case 0x90:
+            sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x03)");
+            log_ptr = log_buf;
+            break;
+          case 0xB0:
+            sprintf(log_buf, st_table[rbuf[idx]].desc, " (0x08, 0x04)");
+            log_ptr = log_buf;
+            break;
+          default:
+            log_ptr = st_table[rbuf[idx]].desc;
+            break;
         }
-      }
 
-      set_last_offset(pfr_mbox[i].fru, start[i], end[i]);
+        syslog(LOG_CRIT, "PFR: %s (0x%02X, 0x%02X), FRU: %u", log_ptr,
+               st_table[rbuf[idx]].addr, st_table[rbuf[idx]].val, pfr_mbox[i].fru);
+      }
     }
 
-    sleep(pfr_monitor_interval);
+    set_last_offset(pfr_mbox[i].fru, rb_start[i], rb_end[i]);
   }
 
-  return 0;
 }
 
+static const uint8_t mbox_cmd[] = {
+  PLATFORM_STATE,  // Platform State
+  LAST_RECOVERY,   // Last Recovery Reason
+  LAST_PANIC,      // Last Panic Reason
+  MAJOR_ERROR,     // Major error code
+};
+
+// mailbox status of every FRU, kept between the checks
+static uint8_t mbox_sts[MAX_NUM_FRUS][sizeof(mbox_cmd)], mbox_sts2[MAX_NUM_FRUS];
+
 static int
-monitor_mailbox() {
-  uint8_t cmd[] = {
-    PLATFORM_STATE,  // Platform State
-    LAST_RECOVERY,   // Last Recovery Reason
-    LAST_PANIC,      // Last Panic Reason
-    MAJOR_ERROR,     // Major error code
-  };
+init_mailbox() {
   uint8_t bus, addr;
-  uint8_t i, j, tbuf[8], rbuf[8];
-  uint8_t sts[MAX_NUM_FRUS][sizeof(cmd)] = {0}, sts2[MAX_NUM_FRUS] = {0};
-  uint8_t log_sel, sts_code, min_code;
-  char log_buf[256], minor_buf[128];
-  const char **log_str[] = {
-    plat_state,
-    last_recovery,
-    last_panic,
-    major_err
-  };
-  const char **log_str2[] = {
-    minor_auth_err,
-    minor_update_err
-  };
-  int ret;
+  uint8_t i;
   bool bridged;
 
   for (i = 0; i < pfr_fru_count; i++) {
@@ -571,86 +566,112 @@ monitor_mailbox() {
   INIT_PFR_ERR(minor_update_err, 0x11, "CPLD_UPDATE_AUTH_FAILED");
   INIT_PFR_ERR(minor_update_err, 0x12, "CPLD_UPDATE_EXCEEDED_MAX_FAILED_ATTEMPTS");
 
-  sleep(2);
+  return 2 * 1000;
+}
 
-  while (1) {
-    for (i = 0; i < pfr_fru_count; i++) {
-      if (pfr_mbox[i].bus == 0xFF) {  // failed get PFR address
+static void
+monitor_mailbox() {
+  uint8_t i, j, tbuf[8], rbuf[8];
+  uint8_t log_sel, sts_code, min_code;
+  char log_buf[256], minor_buf[128];
+  const char **log_str[] = {
+    plat_state,
+    last_recovery,
+    last_panic,
+    major_err
+  };
+  const char **log_str2[] = {
+    minor_auth_err,
+    minor_update_err
+  };
+  int ret;
+
+  for (i = 0; i < pfr_fru_count; i++) {
+    if (pfr_mbox[i].bus == 0xFF) {  // failed get PFR address
+      continue;
+    }
+
+    for (j = 0; j < sizeof(mbox_cmd); j++) {
+      tbuf[0] = mbox_cmd[j];
+      ret = pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, rbuf, 1);
+      if (ret) {
+        syslog(LOG_WARNING, "i2c%u xfer failed, offset = %x", pfr_mbox[i].bus, mbox_cmd[j]);
         continue;
       }
 
-      for (j = 0; j < sizeof(cmd); j++) {
-        tbuf[0] = cmd[j];
+      log_sel = 0;
+      if (mbox_sts[i][j] != rbuf[0]) {
+        mbox_sts[i][j] = rbuf[0];
+        if (mbox_sts[i][j]) {
+          log_sel = 1;
+        }
+      }
+      sts_code = mbox_sts[i][j];
+
+      if ((mbox_cmd[j] == MAJOR_ERROR) && sts_code && (sts_code <= 0x04)) {  // major error code: 0x01 ~ 0x04
+        tbuf[0] = MINOR_ERROR;  // minor error code
         ret = pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, rbuf, 1);
         if (ret) {
-          syslog(LOG_WARNING, "i2c%u xfer failed, offset = %x", pfr_mbox[i].bus, cmd[j]);
+          syslog(LOG_WARNING, "i2c%u xfer failed, offset = %x", pfr_mbox[i].bus, mbox_cmd[j]);
           continue;
         }
 
-        log_sel = 0;
-        if (sts[i][j] != rbuf[0]) {
-          sts[i][j] = rbuf[0];
-          if (sts[i][j]) {
-            log_sel = 1;
-          }
-        }
-        sts_code = sts[i][j];
-
-        if ((cmd[j] == MAJOR_ERROR) && sts_code && (sts_code <= 0x04)) {  // major error code: 0x01 ~ 0x04
-          tbuf[0] = MINOR_ERROR;  // minor error code
-          ret = pfr_mbox[i].transfer(&pfr_mbox[i], tbuf, 1, rbuf, 1);
-          if (ret) {
-            syslog(LOG_WARNING, "i2c%u xfer failed, offset = %x", pfr_mbox[i].bus, cmd[j]);
-            continue;
-          }
-
-          if (sts2[i] != rbuf[0]) {
-            sts2[i] = rbuf[0];
-            log_sel = 2;
-          }
+        if (mbox_sts2[i] != rbuf[0]) {
+          mbox_sts2[i] = rbuf[0];
+          log_sel = 2;
         }
+      }
 
-        if (log_sel) {
-          if (log_str[j][sts_code]) {
-            snprintf(log_buf, sizeof(log_buf), "%s (0x%02X, 0x%02X)", log_str[j][sts_code], cmd[j], sts_code);
-
-            if (cmd[j] == MAJOR_ERROR) {
-              min_code = sts2[i];
-              if ((sts_code <= 0x04) && (log_str2[(sts_code-1)/2][min_code])) {
-                snprintf(minor_buf, sizeof(minor_buf), ", %s (0x%02X, 0x%02X)",
-                                    log_str2[(sts_code-1)/2][min_code], MINOR_ERROR, min_code);
-              } else {
-                snprintf(minor_buf, sizeof(minor_buf), ", Unknown minor (0x%02X, 0x%02X)",
-                                    MINOR_ERROR, min_code);
-              }
-              strcat(log_buf, minor_buf);
+      if (log_sel) {
+        if (log_str[j][sts_code]) {
+          snprintf(log_buf, sizeof(log_buf), "%s (0x%02X, 0x%02X)", log_str[j][sts_code], mbox_cmd[j], sts_code);
+
+          if (mbox_cmd[j] == MAJOR_ERROR) {
+            min_code = mbox_sts2[i];
+            if ((sts_code <= 0x04) && (log_str2[(sts_code-1)/2][min_code])) {
+              snprintf(minor_buf, sizeof(minor_buf), ", %s (0x%02X, 0x%02X)",
+                                  log_str2[(sts_code-1)/2][min_code], MINOR_ERROR, min_code);
+            } else {
+              snprintf(minor_buf, sizeof(minor_buf), ", Unknown minor (0x%02X, 0x%02X)",
+                                  MINOR_ERROR, min_code);
             }
-          } else {
-            snprintf(log_buf, sizeof(log_buf), "Unknown status (0x%02X, 0x%02X)", cmd[j], sts_code);
+            strcat(log_buf, minor_buf);
           }
-
-          syslog(LOG_CRIT, "PFR: %s, FRU: %u", log_buf, pfr_mbox[i].fru);
+        } else {
+          snprintf(log_buf, sizeof(log_buf), "Unknown status (0x%02X, 0x%02X)", mbox_cmd[j], sts_code);
         }
+
+        syslog(LOG_CRIT, "PFR: %s, FRU: %u", log_buf, pfr_mbox[i].fru);
       }
     }
-
-    sleep(pfr_monitor_interval);
   }
 
-  return 0;
 }
 
-void *
-pfr_monitor() {
+/*
+ * Monitor callbacks of healthd: pfr_monitor_init() sets up the monitor
+ * and pfr_monitor() does one check, both return the milliseconds until
+ * the next check, or -1 to stop.
+ */
+int
+pfr_monitor_init(void) {
   if (!pal_is_pfr_active()) {
-    return NULL;
+    return -1;
+  }
+
+  if (pfr_monitor_ringbuf) {
+    return init_ring_buffer();
   }
+  return init_mailbox();
+}
 
+int
+pfr_monitor(void) {
   if (pfr_monitor_ringbuf) {
     monitor_ring_buffer();
   } else {
     monitor_mailbox();
   }
 
-  return NULL;
+  return pfr_monitor_interval * 1000;
 }
@@ -59,12 +59,13 @@
 #include <stdint.h>
 #include <mqueue.h>
 #include <semaphore.h>
+#include <sys/mman.h>
 #include <poll.h>
 #include <assert.h>
 #include <getopt.h>
 #include <stddef.h>
+#include <limits.h>
 #include <linux/limits.h>
-#include <linux/version.h>
 
 #include <openbmc/log.h>
 #include <openbmc/obmc-i2c.h>
@@ -104,6 +105,8 @@
 }
 
 #define SEQ_NUM_MAX 64
+// Threads serving the IPMB lib requests, queued up to SEQ_NUM_MAX
+#define SVC_WORKERS 16
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(_a) (sizeof(_a) / sizeof((_a)[0]))
@@ -124,9 +127,18 @@
 #define RES_VERBOSE(fmt, args...) __VERBOSE(IPMBD_RES_THREAD ": " fmt, ##args)
 #define SVC_VERBOSE(fmt, args...) __VERBOSE(IPMBD_SVC_THREAD ": " fmt, ##args)
 
+// States of a seq#, changed by compare and swap only
+enum {
+  SEQ_FREE = 0,
+  SEQ_RESERVED, // taken by a requester, not waiting (yet or any more)
+  SEQ_WAITING,  // p_buf can take the response
+  SEQ_FILLING,  // the response is being copied to p_buf
+  SEQ_DONE,     // the response is in p_buf, seq_sem posted
+};
+
 // Structure for sequence number and buffer
 typedef struct {
-  bool in_use; // seq# is being used
+  uint32_t state; // SEQ_*
   uint8_t len; // buffer size
   uint8_t *p_buf; // pointer to buffer
   sem_t seq_sem; // semaphore for thread sync.
@@ -135,13 +147,16 @@ typedef struct {
 // Structure for holding currently used sequence number and
 // array of all possible sequence number
 static struct {
-  pthread_mutex_t seq_mutex;
-
-  uint8_t curr_seq; // currently used seq#
+  uint32_t curr_seq; // next seq# to try
   seq_buf_t seq[SEQ_NUM_MAX]; //array of all possible seq# struct.
-} ipmb_seq_buf = {
-  .seq_mutex = PTHREAD_MUTEX_INITIALIZER,
-};
+} ipmb_seq_buf;
+
+// Counters of the bus, in shm for lib_ipmb_get_stats()
+static ipmb_stats_t ipmb_stats_local;
+static ipmb_stats_t *ipmb_stats = &ipmb_stats_local;
+
+#define STATS_ADD(field, n) \
+  __atomic_fetch_add(&ipmb_stats->field, (n), __ATOMIC_RELAXED)
 
 static pthread_mutex_t i2c_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -191,73 +206,139 @@ calc_cksum(uint8_t *buf, uint8_t len) {
 static void ipmb_seq_buf_init(void) {
   int i;
   for (i = 0; i < ARRAY_SIZE(ipmb_seq_buf.seq); i++) {
-    ipmb_seq_buf.seq[i].in_use = false;
+    ipmb_seq_buf.seq[i].state = SEQ_FREE;
     assert(sem_init(&ipmb_seq_buf.seq[i].seq_sem, 0, 0) == 0);
     ipmb_seq_buf.seq[i].len = 0;
     ipmb_seq_buf.seq[i].p_buf = NULL;
   }
 }
 
+static bool seq_cas(seq_buf_t *s, uint32_t from, uint32_t to)
+{
+  return __atomic_compare_exchange_n(&s->state, &from, to, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void ipmb_stats_init(int bus_num)
+{
+  char shm_name[NAME_MAX];
+  ipmb_stats_t *shm;
+  int fd;
+
+  ipc_name_gen(shm_name, sizeof(shm_name), IPMB_STATS_SHM, bus_num);
+  fd = shm_open(shm_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    OBMC_ERROR(errno, "failed to open %s", shm_name);
+    return;
+  }
+  if (ftruncate(fd, sizeof(*shm)) == 0) {
+    shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shm != MAP_FAILED) {
+      ipmb_stats = shm;
+    }
+  }
+  close(fd);
+}
+
+static uint64_t
+mono_us(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void
+stats_response(uint64_t sent_us) {
+  uint64_t us = mono_us() - sent_us;
+  uint32_t max, b = 0;
+
+  STATS_ADD(responses, 1);
+  STATS_ADD(latency_ms_total, (uint32_t)(us / 1000));
+  max = __atomic_load_n(&ipmb_stats->latency_us_max, __ATOMIC_RELAXED);
+  while (us > max &&
+         !__atomic_compare_exchange_n(&ipmb_stats->latency_us_max, &max,
+           us > UINT32_MAX ? UINT32_MAX : (uint32_t)us, true,
+           __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  while (b < IPMB_LATENCY_BUCKETS - 1 && us >= (1000ULL << b)) {
+    b++;
+  }
+  STATS_ADD(latency_hist[b], 1);
+}
+
 static int seq_put(uint8_t seq, uint8_t *buf, uint8_t len)
 {
   seq_buf_t *s;
-  int rc = -1;
 
   if (seq >= ARRAY_SIZE(ipmb_seq_buf.seq)) {
     return -1;
   }
   // Check if the response is being waited for
-  pthread_mutex_lock(&ipmb_seq_buf.seq_mutex);
   s = &ipmb_seq_buf.seq[seq];
-  if (s->in_use && s->p_buf) {
-    // Copy the response to the requester's buffer
-    memcpy(s->p_buf, buf, len);
-    s->len = len;
-
-    // Wake up the worker thread to receive the response
-    sem_post(&s->seq_sem);
-    rc = 0;
+  if (!seq_cas(s, SEQ_WAITING, SEQ_FILLING)) {
+    return -1;
   }
-  pthread_mutex_unlock(&ipmb_seq_buf.seq_mutex);
-  return rc;
+  // Copy the response to the requester's buffer
+  memcpy(s->p_buf, buf, len);
+  s->len = len;
+  __atomic_store_n(&s->state, SEQ_DONE, __ATOMIC_RELEASE);
+
+  // Wake up the worker thread to receive the response
+  sem_post(&s->seq_sem);
+  return 0;
 }
 
 // Returns an unused seq# from all possible seq#
 static int8_t
 seq_get_new(unsigned char *resp) {
-  int8_t ret = -1;
-  uint8_t index;
-
-  pthread_mutex_lock(&ipmb_seq_buf.seq_mutex);
+  uint32_t start, index, i, depth, max;
+  seq_buf_t *s;
 
   // Search for unused sequence number
-  index = ipmb_seq_buf.curr_seq;
-  do {
-    if (!ipmb_seq_buf.seq[index].in_use) {
-      // Found it!
-      ret = index;
-      ipmb_seq_buf.seq[index].in_use = true;
-      ipmb_seq_buf.seq[index].len = 0;
-      ipmb_seq_buf.seq[index].p_buf = resp;
-      break;
-    }
-
-    if (++index == ARRAY_SIZE(ipmb_seq_buf.seq)) {
-      index = 0;
-    }
-  } while (index != ipmb_seq_buf.curr_seq);
-
-  // Update the current seq num
-  if (ret >= 0) {
-    if (++index == ARRAY_SIZE(ipmb_seq_buf.seq)) {
-      index = 0;
+  start = __atomic_load_n(&ipmb_seq_buf.curr_seq, __ATOMIC_RELAXED);
+  for (i = 0; i < ARRAY_SIZE(ipmb_seq_buf.seq); i++) {
+    index = (start + i) % ARRAY_SIZE(ipmb_seq_buf.seq);
+    s = &ipmb_seq_buf.seq[index];
+    if (__atomic_load_n(&s->state, __ATOMIC_RELAXED) != SEQ_FREE ||
+        !seq_cas(s, SEQ_FREE, SEQ_RESERVED)) {
+      continue;
     }
-    ipmb_seq_buf.curr_seq = index;
+    // Found it!
+    s->len = 0;
+    s->p_buf = resp;
+    __atomic_store_n(&s->state, SEQ_WAITING, __ATOMIC_RELEASE);
+
+    // Update the current seq num
+    __atomic_store_n(&ipmb_seq_buf.curr_seq,
+                     (index + 1) % ARRAY_SIZE(ipmb_seq_buf.seq), __ATOMIC_RELAXED);
+
+    depth = STATS_ADD(inflight, 1) + 1;
+    max = __atomic_load_n(&ipmb_stats->max_inflight, __ATOMIC_RELAXED);
+    while (depth > max &&
+           !__atomic_compare_exchange_n(&ipmb_stats->max_inflight, &max, depth,
+             true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return index;
   }
+  STATS_ADD(no_seq, 1);
+  return -1;
+}
 
-  pthread_mutex_unlock(&ipmb_seq_buf.seq_mutex);
-
-  return ret;
+// Releases the seq#, posted if seq_sem was taken already. Returns the
+// length of the response received, -1 if none.
+static int
+seq_release(int8_t index, bool posted) {
+  seq_buf_t *s = &ipmb_seq_buf.seq[index];
+  int len = -1;
+
+  // No response can come once reserved, one being copied is waited for
+  if (posted || !seq_cas(s, SEQ_WAITING, SEQ_RESERVED)) {
+    while (!posted && sem_wait(&s->seq_sem) != 0 && errno == EINTR);
+    len = s->len;
+  }
+  s->p_buf = NULL;
+  __atomic_store_n(&s->state, SEQ_FREE, __ATOMIC_RELEASE);
+  STATS_ADD(inflight, -1);
+  return len;
 }
 
 static int
@@ -287,6 +368,12 @@ ipmb_write_satellite(int fd, uint8_t *buf, uint16_t len) {
                len, msg.addr);
   }
   pthread_mutex_unlock(&i2c_mutex);
+  if (i > 0) {
+    STATS_ADD(retries, rc < 0 ? i - 1 : i);
+  }
+  if (rc < 0) {
+    STATS_ADD(write_errors, 1);
+  }
 
   return (rc < 0 ? -1 : 0);
 }
@@ -479,6 +566,7 @@ ipmb_res_handler(void *args) {
 
     if (seq_put(index, buf, len)) {
       // Either the IPMB packet is corrupted or arrived late after client exits
+      STATS_ADD(late, 1);
       OBMC_WARN("%s: WRONG packet received with seq #%d\n",
                 IPMBD_RES_THREAD, index);
     }
@@ -494,31 +582,134 @@ ipmb_res_handler(void *args) {
 }
 
 /*
- * Determine poll() timeout value based on kernel versions:
+ * Determine the next poll() timeout of the slave:
+ * - mqueue backend (kernel 4.18 or higher versions):
+ *   poll() returns as soon as a message is queued, so it waits for good
+ *   and the rx thread only wakes up for messages.
  * - kernel 4.1:
  *   poll() cannot return when BMC slave buffer is filled with data (due
- *   to the implementation BMC slave transfer), thus we need a smaller
- *   timeout (polling every 10 milliseconds) so ipmbd can obtain ipmi
- *   messages from its peer timely.
- * - kernel 5.0 (or higher versions):
- *   poll() returns when BMC slave buffer is filled with data, so it can
- *   be a negative value (infinite timeout) technically. Setting it to 3
- *   seconds is a little conservative, so feel free to adjust the value.
+ *   to the implementation BMC slave transfer), so the buffer is polled
+ *   every 10 milliseconds while responses are waited for. Otherwise the
+ *   interval doubles up to 80 milliseconds while the bus stays idle.
  */
+#define SLAVE_POLL_MIN_MS 10
+#define SLAVE_POLL_MAX_MS 80
+
 static int
-determine_poll_timeout(void)
+next_poll_timeout(bool signaled, int prev)
 {
-  int timeout;
-  k_version_t cur_ver;
+  if (signaled) {
+    return -1;
+  }
+  if (prev <= 0 || __atomic_load_n(&ipmb_stats->inflight, __ATOMIC_RELAXED)) {
+    return SLAVE_POLL_MIN_MS;
+  }
+  return prev * 2 > SLAVE_POLL_MAX_MS ? SLAVE_POLL_MAX_MS : prev * 2;
+}
 
-  cur_ver = get_kernel_version();
-  if (cur_ver <= KERNEL_VERSION(4, 1, 51)) {
-    timeout = 10;    /* 10 milliseconds */
-  } else {
-    timeout = 3000;  /* 3 seconds */
+/*
+ * Queue a received message, giving its handler thread up to
+ * MQ_SEND_TIMEOUT_MS to make room in a full queue.
+ */
+#define MQ_SEND_TIMEOUT_MS 100
+
+static int
+rx_queue_msg(mqd_t mq, uint8_t *buf, uint8_t len)
+{
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += MQ_SEND_TIMEOUT_MS * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (mq_timedsend(mq, (char *)buf, len, 0, &deadline) != 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
   }
+  return 0;
+}
 
-  return timeout;
+// Checks (and fixes up) a packet received as slave and posts it to the
+// request or response queue. buf has room for one more byte than len.
+static void
+ipmb_rx_dispatch(uint8_t *buf, uint8_t len, uint16_t addr,
+                 mqd_t mq_req, const char *mq_name_req,
+                 mqd_t mq_res, const char *mq_name_res) {
+  int ret;
+  ipmb_req_t *p_req;
+  uint8_t tlun, fbyte;
+  uint8_t tbuf[IPMB_PKT_MAX_SIZE + 1];
+
+  // TODO: HACK: Due to i2cdriver issues, we are seeing two different type of packet corruptions
+  // 1. The firstbyte(BMC's slave address) byte is same as second byte
+  //    Workaround: Replace the first byte with correct slave address
+  // 2. The missing slave address as first byte
+  //    Workaround: move the buffer by one byte and add the correct slave address
+  // Verify the IPMB hdr cksum: first two bytes are hdr and 3-rd byte cksum
+
+  if (len < IPMB_PKT_MIN_SIZE) {
+    OBMC_WARN("%s: IPMB Packet invalid size %d", IPMBD_RX_THREAD, len);
+    return;
+  }
+
+  if (buf[2] != calc_cksum(buf, 2)) {
+    //handle wrong slave address
+    if (buf[0] != addr<<1) {
+      // Store the first byte
+      fbyte = buf[0];
+      // Update the first byte with correct slave address
+      buf[0] = addr<<1;
+      // Check again if the cksum passes
+      if (buf[2] != calc_cksum(buf,2)) {
+        //handle missing slave address
+        // restore the first byte
+        buf[0] = fbyte;
+        //copy the buffer to temporary
+        memcpy(tbuf, buf, len);
+        // correct the slave address
+        buf[0] = addr<<1;
+        // copy back from temp buffer
+        memcpy(&buf[1], tbuf, len);
+        // increase length as we added slave address byte
+        len++;
+        // Check if the above hacks corrected the header
+        if (buf[2] != calc_cksum(buf,2)) {
+          OBMC_WARN("%s: IPMB Header cksum error after fixup",
+                    IPMBD_RX_THREAD);
+          return;
+        }
+      }
+    } else {
+        OBMC_WARN("%s: IPMB Header cksum does not match", IPMBD_RX_THREAD);
+        return;
+    }
+  }
+
+  // Verify the IPMB data cksum: data starts from 4-th byte
+  if (buf[len-1] != calc_cksum(&buf[3], len-4)) {
+    OBMC_WARN("%s: IPMB Data cksum does not match\n", IPMBD_RX_THREAD);
+    return;
+  }
+
+  // Check if the messages is request or response
+  // Even NetFn: Request, Odd NetFn: Response
+  // Post message to approriate Queue for further processing
+  p_req = (ipmb_req_t*)buf;
+  tlun = p_req->netfn_lun >> LUN_OFFSET;
+  if (tlun % 2) {
+    RX_VERBOSE("sending packet to %s", mq_name_res);
+    ret = rx_queue_msg(mq_res, buf, len);
+  } else {
+    RX_VERBOSE("sending packet to %s", mq_name_req);
+    ret = rx_queue_msg(mq_req, buf, len);
+  }
+  if (ret != 0) {
+    OBMC_WARN("%s: dropped a packet of %u bytes, queue full",
+              IPMBD_RX_THREAD, len);
+  }
 }
 
 // Thread to receive the IPMB messages over i2c bus as a slave
@@ -527,15 +718,13 @@ ipmb_rx_handler(void *args) {
   i2c_mslave_t *bmc_slave;
   mqd_t mq_req = MQ_DESC_INVALID;
   mqd_t mq_res = MQ_DESC_INVALID;
-  struct timespec req = {
-    .tv_sec = 0,
-    .tv_nsec = 10000000, //10mSec
-  };
   char mq_name_req[NAME_MAX], mq_name_res[NAME_MAX];
   int bus_num = *((int*)args);
   uint16_t addr=0;
   int ret=0;
-  int poll_timeout = determine_poll_timeout();
+  bool signaled;
+  int poll_timeout = 0;
+  uint32_t queue_full = 0;
   char flag_name[NAME_MAX] = {0};
 
   RX_VERBOSE("thread starts execution");
@@ -557,6 +746,7 @@ ipmb_rx_handler(void *args) {
   }
   RX_VERBOSE("opened bmc i2c-%d master as slave successfully",
              bus_num);
+  signaled = i2c_mslave_poll_signaled(bmc_slave);
 
   // Open the message queues for post processing
   ipc_name_gen(mq_name_req, sizeof(mq_name_req), MQ_IPMB_REQ, bus_num);
@@ -581,89 +771,40 @@ ipmb_rx_handler(void *args) {
   snprintf(flag_name, sizeof(flag_name), "flag_ipmbd_rx_%d", bus_num);
   kv_set(flag_name, "1", 0, 0);
 
-  // Loop that retrieves messages
+  // Loop that retrieves messages: each wakeup drains all the messages
+  // queued by the driver
   while (1) {
-    int ret;
-    ipmb_req_t *p_req;
-    uint8_t len, tlun, fbyte;
-    uint8_t buf[IPMB_PKT_MAX_SIZE], tbuf[IPMB_PKT_MAX_SIZE];
+    uint8_t bufs[I2C_MSLAVE_MQUEUE_DEPTH][IPMB_PKT_MAX_SIZE + 1];
+    void *pbufs[I2C_MSLAVE_MQUEUE_DEPTH];
+    size_t lens[I2C_MSLAVE_MQUEUE_DEPTH];
+    i2c_mslave_stats_t stats;
+    int i;
+
+    for (i = 0; i < I2C_MSLAVE_MQUEUE_DEPTH; i++) {
+      pbufs[i] = bufs[i];
+      lens[i] = IPMB_PKT_MAX_SIZE;
+    }
 
     // Read messages from i2c driver
-    ret = i2c_mslave_read(bmc_slave, buf, sizeof(buf));
+    ret = i2c_mslave_read_batch(bmc_slave, pbufs, lens, I2C_MSLAVE_MQUEUE_DEPTH);
     if (ret <= 0) {
+      poll_timeout = next_poll_timeout(signaled, poll_timeout);
       i2c_mslave_poll(bmc_slave, poll_timeout);
       continue;
     }
-    len = (uint8_t)ret;
-    RX_VERBOSE("read %u bytes from ipmb bus %d", len, bus_num);
-
-    // TODO: HACK: Due to i2cdriver issues, we are seeing two different type of packet corruptions
-    // 1. The firstbyte(BMC's slave address) byte is same as second byte
-    //    Workaround: Replace the first byte with correct slave address
-    // 2. The missing slave address as first byte
-    //    Workaround: move the buffer by one byte and add the correct slave address
-    // Verify the IPMB hdr cksum: first two bytes are hdr and 3-rd byte cksum
-
-    if (len < IPMB_PKT_MIN_SIZE) {
-      OBMC_WARN("%s: IPMB Packet invalid size %d", IPMBD_RX_THREAD, len);
-      continue;
-    }
+    poll_timeout = 0;
 
-    if (buf[2] != calc_cksum(buf, 2)) {
-      //handle wrong slave address
-      if (buf[0] != addr<<1) {
-        // Store the first byte
-        fbyte = buf[0];
-        // Update the first byte with correct slave address
-        buf[0] = addr<<1;
-        // Check again if the cksum passes
-        if (buf[2] != calc_cksum(buf,2)) {
-          //handle missing slave address
-          // restore the first byte
-          buf[0] = fbyte;
-          //copy the buffer to temporary
-          memcpy(tbuf, buf, len);
-          // correct the slave address
-          buf[0] = addr<<1;
-          // copy back from temp buffer
-          memcpy(&buf[1], tbuf, len);
-          // increase length as we added slave address byte
-          len++;
-          // Check if the above hacks corrected the header
-          if (buf[2] != calc_cksum(buf,2)) {
-            OBMC_WARN("%s: IPMB Header cksum error after fixup",
-                      IPMBD_RX_THREAD);
-            continue;
-          }
-        }
-      } else {
-          OBMC_WARN("%s: IPMB Header cksum does not match", IPMBD_RX_THREAD);
-          continue;
-      }
-    }
-
-    // Verify the IPMB data cksum: data starts from 4-th byte
-    if (buf[len-1] != calc_cksum(&buf[3], len-4)) {
-      OBMC_WARN("%s: IPMB Data cksum does not match\n", IPMBD_RX_THREAD);
-      continue;
+    if (i2c_mslave_get_stats(bmc_slave, &stats) == 0 &&
+        stats.queue_full != queue_full) {
+      queue_full = stats.queue_full;
+      OBMC_WARN("%s: slave queue of bus %d was full, packets may be lost "
+                "(%u times)", IPMBD_RX_THREAD, bus_num, queue_full);
     }
 
-    // Check if the messages is request or response
-    // Even NetFn: Request, Odd NetFn: Response
-    // Post message to approriate Queue for further processing
-    p_req = (ipmb_req_t*)buf;
-    tlun = p_req->netfn_lun >> LUN_OFFSET;
-    if (tlun % 2) {
-      RX_VERBOSE("sending packet to %s", mq_name_res);
-      ret = mq_timedsend(mq_res, (char *)buf, len, 0, &req);
-    } else {
-      RX_VERBOSE("sending packet to %s", mq_name_req);
-      ret = mq_timedsend(mq_req, (char *)buf, len, 0, &req);
-    }
-    if (ret != 0) {
-      //syslog(LOG_WARNING, "mq_send failed for queue %d\n", tmq);
-      msleep(10);
-      continue;
+    for (i = 0; i < ret; i++) {
+      RX_VERBOSE("read %zu bytes from ipmb bus %d", lens[i], bus_num);
+      ipmb_rx_dispatch(bufs[i], (uint8_t)lens[i], addr, mq_req, mq_name_req,
+                       mq_res, mq_name_res);
     }
   }
 
@@ -677,39 +818,51 @@ cleanup:
   }
 
   if (mq_res != MQ_DESC_INVALID) {
-    mq_close(mq_req);
+    mq_close(mq_res);
   }
   return NULL;
 }
 
-/*
- * Function to handle all IPMB requests
- */
+// IPMB request of a client, from its send to its response
+typedef struct {
+  unsigned char *request;
+  unsigned short req_len;
+  unsigned char *response;
+  int8_t index;
+  bool prepared;
+  uint64_t sent_us;
+} ipmb_xfer_t;
+
+// Take a seq# for the request and send it over the bus. The response is
+// collected by ipmb_xfer_finish(), whether this succeeded or not.
 static void
-ipmb_handle (int fd, unsigned char *request, unsigned short req_len,
-       unsigned char *response, unsigned char *res_len)
+ipmb_xfer_start(int fd, ipmb_xfer_t *x)
 {
-  ipmb_req_t *req = (ipmb_req_t *) request;
-  int i, ret;
-  int8_t index;
-  struct timespec ts;
+  ipmb_req_t *req = (ipmb_req_t *) x->request;
+  unsigned char *request = x->request;
+  unsigned short req_len = x->req_len;
   uint16_t addr=0;
+  int i, ret;
+
+  x->prepared = false;
+  x->sent_us = 0;
 
   // Allocate right sequence Number
-  index = seq_get_new(response);
-  if (index < 0) {
-    *res_len = 0;
-    return ;
+  x->index = seq_get_new(x->response);
+  if (x->index < 0) {
+    return;
   }
 
   ret = pal_get_bmc_ipmb_slave_addr(&addr, ipmbd_config.bus_id);
   if (ret < 0) {
-    return ;
+    seq_release(x->index, false);
+    x->index = -1;
+    return;
   }
 #ifdef DEBUG
   syslog(LOG_WARNING, "%s ADDR=%x BUS_ID=%x\n", __func__, addr, ipmbd_config.bus_id);
 #endif
-  req->seq_lun = index << LUN_OFFSET;
+  req->seq_lun = x->index << LUN_OFFSET;
   req->req_slave_addr = addr << 1;
 
   // Calculate/update header Cksum
@@ -726,38 +879,161 @@ ipmb_handle (int fd, unsigned char *request, unsigned short req_len,
 
   request[req_len-1] = ZERO_CKSUM_CONST - request[req_len-1];
 
+  x->prepared = true;
   if (pal_ipmb_processing(ipmbd_config.bus_id, request, req_len)) {
-    goto ipmb_handle_out;
+    return;
   }
 
   // Send request over i2c bus
+  STATS_ADD(requests, 1);
   if (ipmb_write_satellite(fd, request, req_len)) {
-    goto ipmb_handle_out;
+    return;
   }
+  x->sent_us = mono_us();
+}
 
-  // Wait on semaphore for that sequence Number
-  clock_gettime(CLOCK_REALTIME, &ts);
+// Wait for the response of a request until <deadline> (CLOCK_REALTIME),
+// and release its seq#. Returns the response length, 0 for none, with
+// the time the response took in *latency_us.
+static unsigned char
+ipmb_xfer_finish(ipmb_xfer_t *x, const struct timespec *deadline,
+                 uint32_t *latency_us)
+{
+  bool posted = false;
+  unsigned char res_len;
+  uint64_t us;
+  int ret, len;
 
-  ts.tv_sec += TIMEOUT_IPMB;
+  *latency_us = 0;
+  if (x->index < 0) {
+    return 0;
+  }
 
-  ret = sem_timedwait(&ipmb_seq_buf.seq[index].seq_sem, &ts);
-  if (ret == -1) {
-    IPMBD_VERBOSE("No response for sequence number: %d\n", index);
-    *res_len = 0;
+  if (x->sent_us) {
+    // Wait on semaphore for that sequence Number
+    while ((ret = sem_timedwait(&ipmb_seq_buf.seq[x->index].seq_sem, deadline)) == -1 &&
+           errno == EINTR);
+    if (ret == -1) {
+      IPMBD_VERBOSE("No response for sequence number: %d\n", x->index);
+    } else {
+      posted = true;
+    }
   }
 
-ipmb_handle_out:
   // Reply to user with data
-  pthread_mutex_lock(&ipmb_seq_buf.seq_mutex);
-  *res_len = ipmb_seq_buf.seq[index].len;
+  len = seq_release(x->index, posted);
+  res_len = len < 0 ? 0 : len;
+  if (x->sent_us) {
+    if (len < 0) {
+      STATS_ADD(timeouts, 1);
+    } else {
+      us = mono_us() - x->sent_us;
+      *latency_us = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+      stats_response(x->sent_us);
+    }
+  }
+
+  if (x->prepared) {
+    pal_ipmb_finished(ipmbd_config.bus_id, x->request, res_len);
+  }
+  return res_len;
+}
 
-  ipmb_seq_buf.seq[index].in_use = false;
-  ipmb_seq_buf.seq[index].p_buf = NULL;
-  pthread_mutex_unlock(&ipmb_seq_buf.seq_mutex);
+/*
+ * Function to handle all IPMB requests
+ */
+static void
+ipmb_handle (int fd, unsigned char *request, unsigned short req_len,
+       unsigned char *response, unsigned char *res_len)
+{
+  ipmb_xfer_t x = {request, req_len, response};
+  struct timespec ts;
+  uint32_t latency_us;
 
-  pal_ipmb_finished(ipmbd_config.bus_id, request, *res_len);
+  ipmb_xfer_start(fd, &x);
 
-  return;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += TIMEOUT_IPMB;
+  *res_len = ipmb_xfer_finish(&x, &ts, &latency_us);
+}
+
+// Whether a client request goes out while the BIC is being updated
+static bool
+ipmb_req_allowed(const unsigned char *req_buf, size_t req_len)
+{
+  if (!ipmbd_config.bic_update_enabled) {
+    return true;
+  }
+  return req_len > 5 && req_buf[1] == 0xe0 &&
+         req_buf[5] == CMD_OEM_1S_ENABLE_BIC_UPDATE;
+}
+
+/*
+ * Requests of a batch (see lib_ipmb_handle_batch()) are all sent before
+ * the first response is waited for, each with a seq# of its own, so the
+ * BIC works on them together. They share the one deadline.
+ */
+static int
+ipmb_handle_batch(int fd, unsigned char *req_buf, size_t req_len,
+                  unsigned char **res_buf, size_t *res_len)
+{
+  ipmb_xfer_t x[IPMB_BATCH_MAX];
+  ipmb_batch_hdr_t *hdr = (ipmb_batch_hdr_t *)req_buf;
+  unsigned char *resp, *p = req_buf + sizeof(*hdr), *out;
+  struct timespec ts;
+  ipmb_batch_res_t r;
+  int i, count = hdr->count;
+  uint16_t len;
+
+  if (count > IPMB_BATCH_MAX) {
+    return -1;
+  }
+  resp = malloc(count * MAX_IPMB_RES_LEN);
+  out = malloc(sizeof(*hdr) + count * (sizeof(r) + UCHAR_MAX));
+  if (!resp || !out) {
+    free(resp);
+    free(out);
+    return -1;
+  }
+
+  for (i = 0; i < count; i++) {
+    if (p + sizeof(len) > req_buf + req_len) {
+      break;
+    }
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    if (len < MIN_IPMB_REQ_LEN || p + len > req_buf + req_len) {
+      break;
+    }
+    x[i] = (ipmb_xfer_t){p, len, resp + i * MAX_IPMB_RES_LEN, -1};
+    p += len;
+  }
+  if (i < count) {
+    free(resp);
+    free(out);
+    return -1;
+  }
+
+  for (i = 0; i < count; i++) {
+    if (ipmb_req_allowed(x[i].request, x[i].req_len)) {
+      ipmb_xfer_start(fd, &x[i]);
+    }
+  }
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += TIMEOUT_IPMB;
+  memcpy(out, hdr, sizeof(*hdr));
+  p = out + sizeof(*hdr);
+  for (i = 0; i < count; i++) {
+    r.len = ipmb_xfer_finish(&x[i], &ts, &r.latency_us);
+    memcpy(p, &r, sizeof(r));
+    memcpy(p + sizeof(r), x[i].response, r.len);
+    p += sizeof(r) + r.len;
+  }
+  free(resp);
+  *res_buf = out;
+  *res_len = p - out;
+  return 0;
 }
 
 
@@ -792,11 +1068,25 @@ conn_handler(client_t *cli) {
     return 0;
   }
 
-  if(ipmbd_config.bic_update_enabled) {
-    if(!((req_buf[1] == 0xe0) &&
-        (req_buf[5] == CMD_OEM_1S_ENABLE_BIC_UPDATE))) {
+  if (req_len >= sizeof(ipmb_batch_hdr_t) && req_buf[0] == IPMB_BATCH_MAGIC) {
+    unsigned char *batch_res = NULL;
+    size_t batch_len = 0;
+    int ret;
+
+    if (ipmb_handle_batch(svc->i2c_fd, req_buf, req_len, &batch_res, &batch_len)) {
+      return -1;
+    }
+    ret = ipc_send_resp(cli, batch_res, batch_len);
+    free(batch_res);
+    if (ret != 0) {
+      OBMC_ERROR(errno, "%s: ipc_send_resp() failed", IPMBD_SVC_THREAD);
       return -1;
     }
+    return 0;
+  }
+
+  if (!ipmb_req_allowed(req_buf, req_len)) {
+    return -1;
   }
 
   ipmb_handle(svc->i2c_fd, req_buf,
@@ -829,7 +1119,7 @@ start_ipmb_lib_handler(int bus_num) {
   IPMBD_VERBOSE("bic opened successfully, fd=%d", svc->i2c_fd);
 
   ipc_name_gen(sock_path, sizeof(sock_path), SOCK_PATH_IPMB, bus_num);
-  if (ipc_start_svc(sock_path, conn_handler, SEQ_NUM_MAX, svc, NULL)) {
+  if (ipc_start_svc_pool(sock_path, conn_handler, SVC_WORKERS, SEQ_NUM_MAX, svc, NULL)) {
     OBMC_ERROR(errno, "failed to start svc thread");
     free(svc);
     return -1;
@@ -992,6 +1282,8 @@ main(int argc, char * const argv[]) {
   ipmb_seq_buf_init();
   IPMBD_VERBOSE("sequence buffer initialized");
 
+  ipmb_stats_init(ipmbd_config.bus_id);
+
   for (i = 0; i < ARRAY_SIZE(ipmb_threads); i++) {
     IPMBD_VERBOSE("creating thread %s", ipmb_threads[i].name);
     rc = pthread_create(&ipmb_threads[i].tid, NULL,
@@ -45,6 +45,7 @@
 #include "sensor.h"
 
 #define MAX_REQUESTS 64
+#define NUM_WORKERS 16
 #define SIZE_IANA_ID 3
 #define SIZE_GUID 16
 
@@ -77,7 +78,13 @@ extern void plat_lan_init(lan_config_t *lan);
 static lan_config_t g_lan_config = { 0 };
 
 // TODO: Need to store this info after identifying proper storage
-static sys_info_param_t g_sys_info_params;
+static sys_info_param_t g_sys_info_params[MAX_NODES + 1];
+
+static sys_info_param_t *
+get_sys_info_params(unsigned char payload_id)
+{
+  return &g_sys_info_params[payload_id <= MAX_NODES ? payload_id : 0];
+}
 
 // enable IPMI cmd logging
 static uint8_t gLogEnable = 0;
@@ -166,20 +173,29 @@ enum {
   DUMP_ONGOING = 0x3,
 };
 
-// TODO: Based on performance testing results, might need fine grained locks
-// Since the global data is specific to a NetFunction, adding locs at NetFn level
-static pthread_mutex_t m_chassis;
-static pthread_mutex_t m_sensor;
-static pthread_mutex_t m_app;
-static pthread_mutex_t m_storage;
+// The global data of a NetFn is per payload (node), and so are its locks:
+// a slow command of a host (e.g. bridged to its BIC) does not block the
+// other hosts. Payloads beyond MAX_NODES share the lock of payload 0.
+#define NUM_LOCK_PAYLOADS (MAX_NODES + 1)
+static pthread_mutex_t m_chassis[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_sensor[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_app[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_storage[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_oem[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_oem_storage[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_oem_1s[NUM_LOCK_PAYLOADS];
+static pthread_mutex_t m_oem_q[NUM_LOCK_PAYLOADS];
+// LAN config, the debug card and the Zion system mode are shared by all
 static pthread_mutex_t m_transport;
-static pthread_mutex_t m_oem;
-static pthread_mutex_t m_oem_storage;
-static pthread_mutex_t m_oem_1s;
 static pthread_mutex_t m_oem_usb_dbg;
-static pthread_mutex_t m_oem_q;
 static pthread_mutex_t m_oem_zion;
 
+static pthread_mutex_t *
+payload_lock(pthread_mutex_t *locks, unsigned char payload_id)
+{
+  return &locks[payload_id < NUM_LOCK_PAYLOADS ? payload_id : 0];
+}
+
 extern int plat_udbg_get_frame_info(uint8_t *num);
 extern int plat_udbg_get_updated_frames(uint8_t *count, uint8_t *buffer);
 extern int plat_udbg_get_post_desc(uint8_t index, uint8_t *next, uint8_t phase,  uint8_t *end, uint8_t *length, uint8_t *buffer);
@@ -397,9 +413,11 @@ ipmi_handle_chassis (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_chassis);
+  lock = payload_lock(m_chassis, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_CHASSIS_GET_STATUS:
@@ -431,7 +449,7 @@ ipmi_handle_chassis (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_chassis);
+  pthread_mutex_unlock(lock);
 }
 
 /*
@@ -495,6 +513,60 @@ sensor_alert_immediate_msg(unsigned char *request, unsigned char req_len,
   res->cc = CC_SUCCESS;
 }
 
+// Responses of Get Sensor Reading, kept until sensord writes a new value
+// in to the sensor cache (see sensor_cache_generation()) or the SDR Repo
+// is rebuilt. Protected by the Sensor NetFn lock of the payload.
+typedef struct {
+  bool valid;
+  uint8_t fru;
+  uint32_t cache_gen;
+  uint32_t sdr_gen;
+  unsigned char data[3];
+} sensor_reading_t;
+
+static sensor_reading_t g_sensor_reading[MAX_NODES + 1][256];
+
+// Get Sensor Reading (IPMI/Section 35.14)
+static void
+sensor_get_reading(unsigned char *request, unsigned char req_len,
+                   unsigned char *response, unsigned char *res_len)
+{
+  ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
+  ipmi_res_t *res = (ipmi_res_t *) response;
+  uint8_t fru = req->payload_id;
+  uint8_t sensor_num;
+  sensor_reading_t *cached;
+  uint32_t cache_gen, sdr_gen;
+  bool has_gen, available;
+  float value = 0;
+
+  if (length_check(1, req_len, response, res_len))
+    return;
+  sensor_num = req->data[0];
+  cached = &g_sensor_reading[fru <= MAX_NODES ? fru : 0][sensor_num];
+
+  // Read the generation first, the value read after is at least as new
+  has_gen = sensor_cache_generation(fru, sensor_num, &cache_gen) == 0;
+  if (!has_gen || !cached->valid || cached->fru != fru ||
+      cached->cache_gen != cache_gen || cached->sdr_gen != sdr_generation()) {
+    available = sensor_cache_read(fru, sensor_num, &value) == 0;
+    if (sdr_sensor_reading(sensor_num, available, value, cached->data,
+                           &sdr_gen)) {
+      cached->valid = false;
+      res->cc = CC_NOT_PRESENT;
+      return;
+    }
+    cached->valid = has_gen;
+    cached->fru = fru;
+    cached->cache_gen = cache_gen;
+    cached->sdr_gen = sdr_gen;
+  }
+
+  res->cc = CC_SUCCESS;
+  memcpy(res->data, cached->data, sizeof(cached->data));
+  *res_len = sizeof(cached->data);
+}
+
 // Set sensor reading (IPMI/Section 35.17)
 static void
 sensor_set_reading(unsigned char *request, unsigned char req_len,
@@ -544,9 +616,11 @@ ipmi_handle_sensor(unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_sensor);
+  lock = payload_lock(m_sensor, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_SENSOR_PLAT_EVENT_MSG:
@@ -558,11 +632,14 @@ ipmi_handle_sensor(unsigned char *request, unsigned char req_len,
     case CMD_SENSOR_SET_SENSOR_READING:
       sensor_set_reading(request, req_len, response, res_len);
       break;
+    case CMD_SENSOR_GET_SENSOR_READING:
+      sensor_get_reading(request, req_len, response, res_len);
+      break;
     default:
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_sensor);
+  pthread_mutex_unlock(lock);
 }
 
 /*
@@ -955,6 +1032,7 @@ app_set_sys_info_params (unsigned char *request, unsigned char req_len,
 
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  sys_info_param_t *sys_info = get_sys_info_params(req->payload_id);
   unsigned char param = req->data[0];
 
   res->cc = CC_SUCCESS;
@@ -962,51 +1040,51 @@ app_set_sys_info_params (unsigned char *request, unsigned char req_len,
   switch (param)
   {
     case SYS_INFO_PARAM_SET_IN_PROG:
-      g_sys_info_params.set_in_prog = req->data[1];
+      sys_info->set_in_prog = req->data[1];
       break;
     case SYS_INFO_PARAM_SYSFW_VER:
-      memcpy(g_sys_info_params.sysfw_ver, &req->data[1], SIZE_SYSFW_VER);
-      pal_set_sysfw_ver(req->payload_id, g_sys_info_params.sysfw_ver);
+      memcpy(sys_info->sysfw_ver, &req->data[1], SIZE_SYSFW_VER);
+      pal_set_sysfw_ver(req->payload_id, sys_info->sysfw_ver);
       break;
     case SYS_INFO_PARAM_SYS_NAME:
-      memcpy(g_sys_info_params.sys_name, &req->data[1], SIZE_SYS_NAME);
+      memcpy(sys_info->sys_name, &req->data[1], SIZE_SYS_NAME);
       break;
     case SYS_INFO_PARAM_PRI_OS_NAME:
-      memcpy(g_sys_info_params.pri_os_name, &req->data[1], SIZE_OS_NAME);
+      memcpy(sys_info->pri_os_name, &req->data[1], SIZE_OS_NAME);
       break;
     case SYS_INFO_PARAM_PRESENT_OS_NAME:
-      memcpy(g_sys_info_params.present_os_name, &req->data[1], SIZE_OS_NAME);
+      memcpy(sys_info->present_os_name, &req->data[1], SIZE_OS_NAME);
       break;
     case SYS_INFO_PARAM_PRESENT_OS_VER:
-      memcpy(g_sys_info_params.present_os_ver, &req->data[1], SIZE_OS_VER);
+      memcpy(sys_info->present_os_ver, &req->data[1], SIZE_OS_VER);
       break;
     case SYS_INFO_PARAM_BMC_URL:
-      memcpy(g_sys_info_params.bmc_url, &req->data[1], SIZE_BMC_URL);
+      memcpy(sys_info->bmc_url, &req->data[1], SIZE_BMC_URL);
       break;
     case SYS_INFO_PARAM_OS_HV_URL:
-      memcpy(g_sys_info_params.os_hv_url, &req->data[1], SIZE_OS_HV_URL);
+      memcpy(sys_info->os_hv_url, &req->data[1], SIZE_OS_HV_URL);
       break;
     case SYS_INFO_PARAM_BIOS_CURRENT_BOOT_LIST:
-      memcpy(g_sys_info_params.bios_current_boot_list, &req->data[1], req_len-4); // boot list length = req_len-4 (payload_id, cmd, netfn, param)
-      pal_set_bios_current_boot_list(req->payload_id, g_sys_info_params.bios_current_boot_list, req_len-4, &res->cc);
+      memcpy(sys_info->bios_current_boot_list, &req->data[1], req_len-4); // boot list length = req_len-4 (payload_id, cmd, netfn, param)
+      pal_set_bios_current_boot_list(req->payload_id, sys_info->bios_current_boot_list, req_len-4, &res->cc);
       break;
     case SYS_INFO_PARAM_BIOS_FIXED_BOOT_DEVICE:
       if(length_check(SIZE_BIOS_FIXED_BOOT_DEVICE+1, req_len, response, res_len))
         break;
-      memcpy(g_sys_info_params.bios_fixed_boot_device, &req->data[1], SIZE_BIOS_FIXED_BOOT_DEVICE);
-      pal_set_bios_fixed_boot_device(req->payload_id, g_sys_info_params.bios_fixed_boot_device);
+      memcpy(sys_info->bios_fixed_boot_device, &req->data[1], SIZE_BIOS_FIXED_BOOT_DEVICE);
+      pal_set_bios_fixed_boot_device(req->payload_id, sys_info->bios_fixed_boot_device);
       break;
     case SYS_INFO_PARAM_BIOS_RESTORES_DEFAULT_SETTING:
       if(length_check(SIZE_BIOS_RESTORES_DEFAULT_SETTING+1, req_len, response, res_len))
         break;
-      memcpy(g_sys_info_params.bios_restores_default_setting, &req->data[1], SIZE_BIOS_RESTORES_DEFAULT_SETTING);
-      pal_set_bios_restores_default_setting(req->payload_id, g_sys_info_params.bios_restores_default_setting);
+      memcpy(sys_info->bios_restores_default_setting, &req->data[1], SIZE_BIOS_RESTORES_DEFAULT_SETTING);
+      pal_set_bios_restores_default_setting(req->payload_id, sys_info->bios_restores_default_setting);
       break;
     case SYS_INFO_PARAM_LAST_BOOT_TIME:
       if(length_check(SIZE_LAST_BOOT_TIME+1, req_len, response, res_len))
         break;
-      memcpy(g_sys_info_params.last_boot_time, &req->data[1], SIZE_LAST_BOOT_TIME);
-      pal_set_last_boot_time(req->payload_id, g_sys_info_params.last_boot_time);
+      memcpy(sys_info->last_boot_time, &req->data[1], SIZE_LAST_BOOT_TIME);
+      pal_set_last_boot_time(req->payload_id, sys_info->last_boot_time);
       break;
     default:
       res->cc = CC_INVALID_PARAM;
@@ -1024,6 +1102,7 @@ app_get_sys_info_params (unsigned char *request, unsigned char req_len,
 
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  sys_info_param_t *sys_info = get_sys_info_params(req->payload_id);
   unsigned char *data = &res->data[0];
   unsigned char param = req->data[1];
 
@@ -1035,71 +1114,71 @@ app_get_sys_info_params (unsigned char *request, unsigned char req_len,
     switch (param)
     {
       case SYS_INFO_PARAM_SET_IN_PROG:
-        *data++ = g_sys_info_params.set_in_prog;
+        *data++ = sys_info->set_in_prog;
         break;
       case SYS_INFO_PARAM_SYSFW_VER:
-        pal_get_sysfw_ver(req->payload_id, g_sys_info_params.sysfw_ver);
-        memcpy(data, g_sys_info_params.sysfw_ver, SIZE_SYSFW_VER);
+        pal_get_sysfw_ver(req->payload_id, sys_info->sysfw_ver);
+        memcpy(data, sys_info->sysfw_ver, SIZE_SYSFW_VER);
         data += SIZE_SYSFW_VER;
         break;
       case SYS_INFO_PARAM_SYS_NAME:
-        memcpy(data, g_sys_info_params.sys_name, SIZE_SYS_NAME);
+        memcpy(data, sys_info->sys_name, SIZE_SYS_NAME);
         data += SIZE_SYS_NAME;
         break;
       case SYS_INFO_PARAM_PRI_OS_NAME:
-        memcpy(data, g_sys_info_params.pri_os_name, SIZE_OS_NAME);
+        memcpy(data, sys_info->pri_os_name, SIZE_OS_NAME);
         data += SIZE_OS_NAME;
         break;
       case SYS_INFO_PARAM_PRESENT_OS_NAME:
-        memcpy(data, g_sys_info_params.present_os_name, SIZE_OS_NAME);
+        memcpy(data, sys_info->present_os_name, SIZE_OS_NAME);
         data += SIZE_OS_NAME;
         break;
       case SYS_INFO_PARAM_PRESENT_OS_VER:
-        memcpy(data, g_sys_info_params.present_os_ver, SIZE_OS_VER);
+        memcpy(data, sys_info->present_os_ver, SIZE_OS_VER);
         data += SIZE_OS_VER;
         break;
       case SYS_INFO_PARAM_BMC_URL:
-        memcpy(data, g_sys_info_params.bmc_url, SIZE_BMC_URL);
+        memcpy(data, sys_info->bmc_url, SIZE_BMC_URL);
         data += SIZE_BMC_URL;
         break;
       case SYS_INFO_PARAM_OS_HV_URL:
-        memcpy(data, g_sys_info_params.os_hv_url, SIZE_OS_HV_URL);
+        memcpy(data, sys_info->os_hv_url, SIZE_OS_HV_URL);
         data += SIZE_OS_HV_URL;
         break;
       case SYS_INFO_PARAM_BIOS_CURRENT_BOOT_LIST:
-        if(pal_get_bios_current_boot_list(req->payload_id, g_sys_info_params.bios_current_boot_list, res_len))
+        if(pal_get_bios_current_boot_list(req->payload_id, sys_info->bios_current_boot_list, res_len))
         {
           res->cc = CC_UNSPECIFIED_ERROR;
           break;
         }
-        memcpy(data, g_sys_info_params.bios_current_boot_list, *res_len);
+        memcpy(data, sys_info->bios_current_boot_list, *res_len);
         data += *res_len;
         break;
       case SYS_INFO_PARAM_BIOS_FIXED_BOOT_DEVICE:
-        if(pal_get_bios_fixed_boot_device(req->payload_id, g_sys_info_params.bios_fixed_boot_device))
+        if(pal_get_bios_fixed_boot_device(req->payload_id, sys_info->bios_fixed_boot_device))
         {
           res->cc = CC_UNSPECIFIED_ERROR;
           break;
         }
-        memcpy(data, g_sys_info_params.bios_fixed_boot_device, SIZE_BIOS_FIXED_BOOT_DEVICE);
+        memcpy(data, sys_info->bios_fixed_boot_device, SIZE_BIOS_FIXED_BOOT_DEVICE);
         data += SIZE_BIOS_FIXED_BOOT_DEVICE;
         break;
       case SYS_INFO_PARAM_BIOS_RESTORES_DEFAULT_SETTING:
-        if(pal_get_bios_restores_default_setting(req->payload_id, g_sys_info_params.bios_restores_default_setting))
+        if(pal_get_bios_restores_default_setting(req->payload_id, sys_info->bios_restores_default_setting))
         {
           res->cc = CC_UNSPECIFIED_ERROR;
           break;
         }
-        memcpy(data, g_sys_info_params.bios_restores_default_setting, SIZE_BIOS_RESTORES_DEFAULT_SETTING);
+        memcpy(data, sys_info->bios_restores_default_setting, SIZE_BIOS_RESTORES_DEFAULT_SETTING);
         data += SIZE_BIOS_RESTORES_DEFAULT_SETTING;
         break;
       case SYS_INFO_PARAM_LAST_BOOT_TIME:
-        if(pal_get_last_boot_time(req->payload_id, g_sys_info_params.last_boot_time))
+        if(pal_get_last_boot_time(req->payload_id, sys_info->last_boot_time))
         {
           res->cc = CC_UNSPECIFIED_ERROR;
           break;
         }
-        memcpy(data, g_sys_info_params.last_boot_time, SIZE_LAST_BOOT_TIME);
+        memcpy(data, sys_info->last_boot_time, SIZE_LAST_BOOT_TIME);
         data += SIZE_LAST_BOOT_TIME;
         break;
       default:
@@ -1211,9 +1290,11 @@ ipmi_handle_app (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_app);
+  lock = payload_lock(m_app, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_APP_GET_DEVICE_ID:
@@ -1274,7 +1355,7 @@ ipmi_handle_app (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_app);
+  pthread_mutex_unlock(lock);
 }
 
 /*
@@ -1690,12 +1771,14 @@ ipmi_handle_storage (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
   unsigned char cmd = req->cmd;
 
   res->cc = CC_SUCCESS;
   *res_len = 0;
 
-  pthread_mutex_lock(&m_storage);
+  lock = payload_lock(m_storage, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_STORAGE_GET_FRUID_INFO:
@@ -1748,7 +1831,7 @@ ipmi_handle_storage (unsigned char *request, unsigned char req_len,
       break;
   }
 
-  pthread_mutex_unlock(&m_storage);
+  pthread_mutex_unlock(lock);
   return;
 }
 
@@ -2041,6 +2124,133 @@ ipmi_handle_transport (unsigned char *request, unsigned char req_len,
 /*
  * Function(s) to handle IPMI messages with NetFn: DCMI
  */
+#define DCMI_GROUP_EXT_ID            0xDC
+#define DCMI_POWER_MODE_SYSTEM       0x01
+#define DCMI_POWER_STATE_ACTIVE      0x40
+// Samples of the power sensor (see pal_get_dcmi_power_sensor()) kept
+// per FRU, the statistics are over the last DCMI_POWER_PERIOD_SEC of them
+#define DCMI_POWER_RING_SIZE         128
+#define DCMI_POWER_PERIOD_SEC        60
+// The PAL answers if sensord stopped logging the sensor
+#define DCMI_POWER_STALE_SEC         10
+
+typedef struct {
+  int head;
+  int count;
+  long log_time[DCMI_POWER_RING_SIZE];
+  float value[DCMI_POWER_RING_SIZE];
+} dcmi_power_ring_t;
+
+static dcmi_power_ring_t g_dcmi_power[MAX_NODES + 1];
+static pthread_mutex_t m_dcmi = PTHREAD_MUTEX_INITIALIZER;
+
+// Appends the samples of the sensor history newer than the ring's
+// latest one
+static void
+dcmi_power_ring_update(dcmi_power_ring_t *ring, uint8_t fru, uint8_t snr_num)
+{
+  long log_time[DCMI_POWER_RING_SIZE];
+  float value[DCMI_POWER_RING_SIZE];
+  long last = 0;
+  int cnt, i;
+
+  if (ring->count)
+    last = ring->log_time[(ring->head + DCMI_POWER_RING_SIZE - 1) % DCMI_POWER_RING_SIZE];
+
+  cnt = sensor_read_history_samples(fru, snr_num, log_time, value,
+                                    DCMI_POWER_RING_SIZE);
+  // Newest first, stop at what the ring already has
+  for (i = 0; i < cnt && log_time[i] > last; i++)
+    ;
+  while (i-- > 0) {
+    ring->log_time[ring->head] = log_time[i];
+    ring->value[ring->head] = value[i];
+    ring->head = (ring->head + 1) % DCMI_POWER_RING_SIZE;
+    if (ring->count < DCMI_POWER_RING_SIZE)
+      ring->count++;
+  }
+}
+
+static void
+dcmi_put_word(unsigned char *buf, float watts)
+{
+  uint16_t v = watts <= 0 ? 0 : (watts >= 0xFFFF ? 0xFFFF : (uint16_t)(watts + 0.5));
+
+  buf[0] = v & 0xFF;
+  buf[1] = v >> 8;
+}
+
+// Get Power Reading (DCMI/Section 6.6.1) in system power statistics
+// mode, from the ring of the FRU. Returns -1 to leave it to the PAL.
+static int
+dcmi_get_power_reading(unsigned char *request, unsigned char req_len,
+                       unsigned char *response, unsigned char *res_len)
+{
+  ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
+  ipmi_res_t *res = (ipmi_res_t *) response;
+  unsigned char *data = res->data;
+  dcmi_power_ring_t *ring;
+  uint8_t fru = req->payload_id;
+  uint8_t snr_num;
+  float cur, min, max, sum = 0;
+  long newest, oldest;
+  uint32_t period;
+  int i, idx, n = 0;
+
+  if (req_len < IPMI_MN_REQ_HDR_SIZE + 4 || req->data[0] != DCMI_GROUP_EXT_ID ||
+      req->data[1] != DCMI_POWER_MODE_SYSTEM || fru > MAX_NODES)
+    return -1;
+  if (pal_get_dcmi_power_sensor(fru, &snr_num) != 0)
+    return -1;
+
+  pthread_mutex_lock(&m_dcmi);
+  ring = &g_dcmi_power[fru];
+  dcmi_power_ring_update(ring, fru, snr_num);
+  if (ring->count == 0) {
+    pthread_mutex_unlock(&m_dcmi);
+    return -1;
+  }
+  idx = (ring->head + DCMI_POWER_RING_SIZE - 1) % DCMI_POWER_RING_SIZE;
+  newest = oldest = ring->log_time[idx];
+  if (time(NULL) - newest > DCMI_POWER_STALE_SEC) {
+    pthread_mutex_unlock(&m_dcmi);
+    return -1;
+  }
+  cur = min = max = ring->value[idx];
+  for (i = 0; i < ring->count; i++) {
+    idx = (ring->head + DCMI_POWER_RING_SIZE - 1 - i) % DCMI_POWER_RING_SIZE;
+    if (newest - ring->log_time[idx] > DCMI_POWER_PERIOD_SEC)
+      break;
+    oldest = ring->log_time[idx];
+    if (ring->value[idx] < min)
+      min = ring->value[idx];
+    if (ring->value[idx] > max)
+      max = ring->value[idx];
+    sum += ring->value[idx];
+    n++;
+  }
+  pthread_mutex_unlock(&m_dcmi);
+
+  period = (uint32_t)(newest - oldest) * 1000;
+  data[0] = DCMI_GROUP_EXT_ID;
+  dcmi_put_word(&data[1], cur);
+  dcmi_put_word(&data[3], min);
+  dcmi_put_word(&data[5], max);
+  dcmi_put_word(&data[7], sum / n);
+  data[9] = newest & 0xFF;
+  data[10] = (newest >> 8) & 0xFF;
+  data[11] = (newest >> 16) & 0xFF;
+  data[12] = (newest >> 24) & 0xFF;
+  data[13] = period & 0xFF;
+  data[14] = (period >> 8) & 0xFF;
+  data[15] = (period >> 16) & 0xFF;
+  data[16] = (period >> 24) & 0xFF;
+  data[17] = DCMI_POWER_STATE_ACTIVE;
+  *res_len = 18;
+  res->cc = CC_SUCCESS;
+  return 0;
+}
+
 static void
 ipmi_handle_dcmi(unsigned char *request, unsigned char req_len,
      unsigned char *response, unsigned char *res_len)
@@ -2056,6 +2266,10 @@ ipmi_handle_dcmi(unsigned char *request, unsigned char req_len,
     return;
   }
 
+  if (req->cmd == CMD_DCMI_GET_POWER_READING &&
+      dcmi_get_power_reading(request, req_len, response, res_len) == 0)
+    return;
+
   // Since DCMI handling is specific to platform, call PAL to process
   ret = pal_handle_dcmi(req->payload_id, &request[1], req_len-1, res->data, res_len);
   if (ret < 0) {
@@ -3232,7 +3446,7 @@ oem_set_flash_info ( unsigned char *request, unsigned char req_len,
   memcpy(&dev_id, &req->data[4], 2);
   memcpy(&sts, &req->data[6], 2);
 
-  if (pal_get_fru_name(req->payload_id, fruname)) {
+  if (pal_get_fru_name_cached(req->payload_id, fruname)) {
     res->cc = CC_UNSPECIFIED_ERROR;
     return;
   }
@@ -3262,7 +3476,7 @@ oem_get_flash_info ( unsigned char *request, unsigned char req_len,
 
   *res_len = 0;
 
-  if (pal_get_fru_name(req->payload_id, fruname)) {
+  if (pal_get_fru_name_cached(req->payload_id, fruname)) {
     res->cc = CC_UNSPECIFIED_ERROR;
     return;
   }
@@ -3762,9 +3976,11 @@ ipmi_handle_oem (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
 
   unsigned char cmd = req->cmd;
-  pthread_mutex_lock(&m_oem);
+  lock = payload_lock(m_oem, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_OEM_ADD_RAS_SEL:
@@ -3915,7 +4131,7 @@ ipmi_handle_oem (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem);
+  pthread_mutex_unlock(lock);
 }
 
 static void
@@ -3924,10 +4140,12 @@ ipmi_handle_oem_storage (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_storage);
+  lock = payload_lock(m_oem_storage, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_OEM_STOR_ADD_STRING_SEL:
@@ -3955,7 +4173,7 @@ ipmi_handle_oem_storage (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem_storage);
+  pthread_mutex_unlock(lock);
 }
 
 static void
@@ -3964,9 +4182,11 @@ ipmi_handle_oem_q (unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
 
   unsigned char cmd = req->cmd;
-  pthread_mutex_lock(&m_oem_q);
+  lock = payload_lock(m_oem_q, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_OEM_Q_SET_PROC_INFO:
@@ -4003,7 +4223,7 @@ ipmi_handle_oem_q (unsigned char *request, unsigned char req_len,
       res->cc = CC_INVALID_CMD;
       break;
   }
-  pthread_mutex_unlock(&m_oem_q);
+  pthread_mutex_unlock(lock);
 }
 
 static void
@@ -4088,11 +4308,13 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
 {
   ipmi_mn_req_t *req = (ipmi_mn_req_t *) request;
   ipmi_res_t *res = (ipmi_res_t *) response;
+  pthread_mutex_t *lock;
   int i;
 
   unsigned char cmd = req->cmd;
 
-  pthread_mutex_lock(&m_oem_1s);
+  lock = payload_lock(m_oem_1s, req->payload_id);
+  pthread_mutex_lock(lock);
   switch (cmd)
   {
     case CMD_OEM_1S_MSG_IN:
@@ -4100,9 +4322,9 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
       // all IPMI request will be process by ipmi_handle
       // which will "properly" serialize the processing according to netfn
       // Thus it is not necessary to serialize processing of MSG-IN.
-      pthread_mutex_unlock(&m_oem_1s);
+      pthread_mutex_unlock(lock);
       oem_1s_handle_ipmb_req(request, req_len, response, res_len);
-      pthread_mutex_lock(&m_oem_1s);
+      pthread_mutex_lock(lock);
       break;
     case CMD_OEM_1S_INTR:
 #ifdef DEBUG
@@ -4219,6 +4441,9 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
       break;
     case CMD_OEM_1S_UPDATE_SDR:
       res->cc = pal_handle_oem_1s_update_sdr(req->payload_id);
+      if (res->cc == CC_SUCCESS) {
+        sdr_rebuild();
+      }
       break;
     default:
       res->cc = CC_INVALID_CMD;
@@ -4226,7 +4451,7 @@ ipmi_handle_oem_1s(unsigned char *request, unsigned char req_len,
       *res_len = 3;
       break;
   }
-  pthread_mutex_unlock(&m_oem_1s);
+  pthread_mutex_unlock(lock);
 }
 
 static void
@@ -4771,7 +4996,7 @@ wdt_timer (void *arg) {
 int
 main (int argc, char **argv)
 {
-  int fru;
+  int fru, i;
   pthread_t tid;
   uint8_t max_slot_num = 0;
 
@@ -4795,15 +5020,18 @@ main (int argc, char **argv)
   sdr_init();
   sel_init();
 
-  pthread_mutex_init(&m_chassis, NULL);
-  pthread_mutex_init(&m_sensor, NULL);
-  pthread_mutex_init(&m_app, NULL);
-  pthread_mutex_init(&m_storage, NULL);
+  for (i = 0; i < NUM_LOCK_PAYLOADS; i++) {
+    pthread_mutex_init(&m_chassis[i], NULL);
+    pthread_mutex_init(&m_sensor[i], NULL);
+    pthread_mutex_init(&m_app[i], NULL);
+    pthread_mutex_init(&m_storage[i], NULL);
+    pthread_mutex_init(&m_oem[i], NULL);
+    pthread_mutex_init(&m_oem_storage[i], NULL);
+    pthread_mutex_init(&m_oem_1s[i], NULL);
+    pthread_mutex_init(&m_oem_q[i], NULL);
+  }
   pthread_mutex_init(&m_transport, NULL);
-  pthread_mutex_init(&m_oem, NULL);
-  pthread_mutex_init(&m_oem_1s, NULL);
   pthread_mutex_init(&m_oem_usb_dbg, NULL);
-  pthread_mutex_init(&m_oem_q, NULL);
   pthread_mutex_init(&m_oem_zion, NULL);
 
   pal_get_num_slots(&max_slot_num);
@@ -4832,20 +5060,27 @@ main (int argc, char **argv)
   // set flag to notice BMC ipmid is ready
   kv_set("flag_ipmid", "1", 0, 0);
 
-  if (ipc_start_svc(SOCK_PATH_IPMI, conn_handler, MAX_REQUESTS, NULL, &tid) == 0) {
+  // Requests are served by a fixed pool of workers, up to MAX_REQUESTS
+  // waiting for one
+  if (ipc_start_svc_pool(SOCK_PATH_IPMI, conn_handler, NUM_WORKERS, MAX_REQUESTS,
+                         NULL, &tid) == 0) {
     pthread_join(tid, NULL);
   }
 
 
-  pthread_mutex_destroy(&m_chassis);
-  pthread_mutex_destroy(&m_sensor);
-  pthread_mutex_destroy(&m_app);
-  pthread_mutex_destroy(&m_storage);
+  for (i = 0; i < NUM_LOCK_PAYLOADS; i++) {
+    pthread_mutex_destroy(&m_chassis[i]);
+    pthread_mutex_destroy(&m_sensor[i]);
+    pthread_mutex_destroy(&m_app[i]);
+    pthread_mutex_destroy(&m_storage[i]);
+    pthread_mutex_destroy(&m_oem[i]);
+    pthread_mutex_destroy(&m_oem_storage[i]);
+    pthread_mutex_destroy(&m_oem_1s[i]);
+    pthread_mutex_destroy(&m_oem_q[i]);
+  }
   pthread_mutex_destroy(&m_transport);
-  pthread_mutex_destroy(&m_oem);
-  pthread_mutex_destroy(&m_oem_1s);
   pthread_mutex_destroy(&m_oem_usb_dbg);
-  pthread_mutex_destroy(&m_oem_q);
+  pthread_mutex_destroy(&m_oem_zion);
 
   return 0;
 }
@@ -31,6 +31,10 @@
 #include <linux/if_link.h>
 #include <sys/ioctl.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <openbmc/ipmi.h>
 #include <openbmc/pal.h>
 
@@ -42,7 +46,62 @@
 #define BYTE2_OFFSET 16
 #define BYTE3_OFFSET 24
 
-void plat_lan_init(lan_config_t *lan)
+/*
+ * The addresses are read once and cached; a netlink socket subscribed to
+ * the link and address groups tells when they have to be read again.
+ */
+static pthread_mutex_t lan_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lan_config_t lan_cache;
+static bool lan_cache_valid = false;
+static int lan_nl_fd = -1;
+
+static int lan_nl_open(void)
+{
+  struct sockaddr_nl addr;
+  int fd;
+
+  fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+              NETLINK_ROUTE);
+  if (fd < 0) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+// Drain the pending notifications, return true if there were any
+static bool lan_nl_changed(void)
+{
+  char buf[4096];
+  bool changed = false;
+  int rc;
+
+  while (1) {
+    rc = recv(lan_nl_fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (rc > 0) {
+      changed = true;
+    } else if (rc < 0 && errno == EINTR) {
+      continue;
+    } else if (rc < 0 && errno == ENOBUFS) {
+      // notifications were dropped, so something changed
+      changed = true;
+    } else {
+      break;
+    }
+  }
+
+  return changed;
+}
+
+static void lan_read_config(lan_config_t *lan)
 {
   struct ifaddrs *ifaddr, *ifa;
   struct sockaddr_in *addr;
@@ -139,3 +198,29 @@ void plat_lan_init(lan_config_t *lan)
 init_done:
   freeifaddrs(ifaddr);
 }
+
+void plat_lan_init(lan_config_t *lan)
+{
+  pthread_mutex_lock(&lan_cache_mutex);
+
+  if (lan_nl_fd < 0) {
+    lan_nl_fd = lan_nl_open();
+  }
+
+  // Without the socket every call has to read the addresses again
+  if (lan_nl_fd < 0 || lan_nl_changed()) {
+    lan_cache_valid = false;
+  }
+
+  if (!lan_cache_valid) {
+    lan_read_config(&lan_cache);
+    lan_cache_valid = true;
+  }
+
+  memcpy(lan->ip_addr, lan_cache.ip_addr, SIZE_IP_ADDR);
+  memcpy(lan->mac_addr, lan_cache.mac_addr, SIZE_MAC_ADDR);
+  memcpy(lan->ip6_addr, lan_cache.ip6_addr, SIZE_IP6_ADDR);
+  lan->ip6_prefix = lan_cache.ip6_prefix;
+
+  pthread_mutex_unlock(&lan_cache_mutex);
+}
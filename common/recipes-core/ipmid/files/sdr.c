@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <syslog.h>
 #include <string.h>
+#include <pthread.h>
 #include <openbmc/ipmi.h>
 #include <openbmc/pal.h>
 
@@ -59,6 +60,8 @@
 #define SDR_VERSION 0x51
 #define SDR_LEN_MAX 64
 
+#define SDR_SENSOR_NUM_MAX 256
+
 #define SDR_FULL_TYPE 0x01
 #define SDR_MGMT_TYPE 0x12
 #define SDR_OEM_TYPE 0xC0
@@ -84,6 +87,13 @@ static int g_rsv_id[MAX_NODES+1];
 static sdr_hdr_t g_sdr_hdr;
 static sdr_rec_t g_sdr_data[SDR_RECORDS_MAX];
 
+// Index of the full SDR of every sensor number, -1 if none
+static short g_sdr_snr_index[SDR_SENSOR_NUM_MAX];
+
+// Generation of the repository, changes when it is rebuilt
+static uint32_t g_sdr_gen;
+static pthread_rwlock_t m_sdr = PTHREAD_RWLOCK_INITIALIZER;
+
 // Add a new SDR entry
 static int
 sdr_add_entry(sdr_rec_t *rec, int *rec_id) {
@@ -200,6 +210,7 @@ sdr_add_thresh_rec(sensor_thresh_t *p_rec) {
 
   rec.owner = p_rec->owner;
   rec.lun = p_rec->lun;
+  rec.sensor_num = p_rec->sensor_num;
 
   rec.ent_id = p_rec->ent_id;
   rec.ent_inst = p_rec->ent_inst;
@@ -218,6 +229,8 @@ sdr_add_thresh_rec(sensor_thresh_t *p_rec) {
   rec.m_tolerance = p_rec->m_tolerance;
   rec.b_val = p_rec->b_val;
   rec.b_accuracy = p_rec->b_accuracy;
+  rec.accuracy_dir = p_rec->accuracy_dir;
+  rec.rb_exp = p_rec->rb_exp;
   rec.analog_flags = p_rec->analog_flags;
   rec.nominal = p_rec->nominal;
   rec.normal_max = p_rec->normal_max;
@@ -244,6 +257,7 @@ sdr_add_thresh_rec(sensor_thresh_t *p_rec) {
     syslog(LOG_WARNING, "sdr_add_thresh_rec: sdr_add_entry failed\n");
     return -1;
   }
+  g_sdr_snr_index[p_rec->sensor_num] = rec_id - 1;
 
   return 0;
 }
@@ -319,8 +333,8 @@ sdr_rsv_id(int node) {
 
 // Get the SDR entry for a given record ID
 // IPMI/Section 33.12
-int
-sdr_get_entry(int node, int rsv_id, int read_rec_id, sdr_rec_t *rec,
+static int
+sdr_get_entry_locked(int node, int rsv_id, int read_rec_id, sdr_rec_t *rec,
                    int *next_rec_id) {
 
   int index;
@@ -376,9 +390,164 @@ sdr_get_entry(int node, int rsv_id, int read_rec_id, sdr_rec_t *rec,
 }
 
 
-// Initialize SDR Repo structure
 int
-sdr_init(void) {
+sdr_get_entry(int node, int rsv_id, int read_rec_id, sdr_rec_t *rec,
+                   int *next_rec_id) {
+  int ret;
+
+  pthread_rwlock_rdlock(&m_sdr);
+  ret = sdr_get_entry_locked(node, rsv_id, read_rec_id, rec, next_rec_id);
+  pthread_rwlock_unlock(&m_sdr);
+
+  return ret;
+}
+
+// Signed value of the low bits of a field
+static int
+sdr_sign_extend(int val, int bits) {
+  return (val & (1 << (bits - 1))) ? val - (1 << bits) : val;
+}
+
+static float
+sdr_exp10(int exp) {
+  float val = 1.0;
+
+  for (; exp > 0; exp--) {
+    val *= 10;
+  }
+  for (; exp < 0; exp++) {
+    val /= 10;
+  }
+  return val;
+}
+
+// Raw reading of a full SDR (IPMI/Section 43.1, byte 21) as an int
+static int
+sdr_raw_to_int(sdr_full_t *rec, unsigned char raw) {
+  switch (rec->sensor_units1 >> 6) {
+    case 1: // 1's complement
+      return (raw & 0x80) ? -(~raw & 0x7F) : raw;
+    case 2: // 2's complement
+      return (signed char)raw;
+    default:
+      return raw;
+  }
+}
+
+// Convert a value in to the raw reading of a full SDR (IPMI/Section 36.3)
+static int
+sdr_value_to_raw(sdr_full_t *rec, float value, int *raw) {
+  int m, b, r_exp, b_exp, min, max;
+  float x;
+
+  // Only linear sensors in analog format
+  if ((rec->linear & 0x7F) || (rec->sensor_units1 >> 6) == 3) {
+    return -1;
+  }
+
+  m = sdr_sign_extend(((rec->m_tolerance & 0xC0) << 2) | rec->m_val, 10);
+  b = sdr_sign_extend(((rec->b_accuracy & 0xC0) << 2) | rec->b_val, 10);
+  r_exp = sdr_sign_extend(rec->rb_exp >> 4, 4);
+  b_exp = sdr_sign_extend(rec->rb_exp & 0x0F, 4);
+  if (m == 0) {
+    return -1;
+  }
+
+  // y = (M * x + B * 10^Bexp) * 10^Rexp
+  x = (value / sdr_exp10(r_exp) - b * sdr_exp10(b_exp)) / m;
+  *raw = x >= 0 ? (int)(x + 0.5) : -(int)(-x + 0.5);
+
+  switch (rec->sensor_units1 >> 6) {
+    case 1:
+      min = -127;
+      max = 127;
+      break;
+    case 2:
+      min = -128;
+      max = 127;
+      break;
+    default:
+      min = 0;
+      max = 255;
+      break;
+  }
+  if (*raw < min) {
+    *raw = min;
+  } else if (*raw > max) {
+    *raw = max;
+  }
+
+  return 0;
+}
+
+// Response data of Get Sensor Reading (IPMI/Section 35.14) of a threshold
+// sensor. Returns -1 if the repository has no full SDR of the sensor.
+int
+sdr_sensor_reading(uint8_t snr, bool available, float value,
+                   unsigned char *data, uint32_t *gen) {
+  static const unsigned char thresh_bit[] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20,
+  };
+  sdr_full_t *rec;
+  unsigned char thresh[6];
+  unsigned char status = 0;
+  int raw = 0, t, i;
+
+  pthread_rwlock_rdlock(&m_sdr);
+  *gen = g_sdr_gen;
+  if (g_sdr_snr_index[snr] < 0) {
+    pthread_rwlock_unlock(&m_sdr);
+    return -1;
+  }
+  rec = (sdr_full_t *)g_sdr_data[g_sdr_snr_index[snr]].rec;
+
+  if (available && sdr_value_to_raw(rec, value, &raw)) {
+    available = false;
+  }
+
+  if (available) {
+    // Thresholds in the order of the status (and readable mask) bits
+    thresh[0] = rec->lnc_thresh;
+    thresh[1] = rec->lc_thresh;
+    thresh[2] = rec->lnr_thresh;
+    thresh[3] = rec->unc_thresh;
+    thresh[4] = rec->uc_thresh;
+    thresh[5] = rec->unr_thresh;
+    for (i = 0; i < 6; i++) {
+      if (!(rec->set_thresh_mask[0] & thresh_bit[i])) {
+        continue;
+      }
+      t = sdr_raw_to_int(rec, thresh[i]);
+      if ((i < 3 && raw <= t) || (i >= 3 && raw >= t)) {
+        status |= thresh_bit[i];
+      }
+    }
+  }
+  pthread_rwlock_unlock(&m_sdr);
+
+  data[0] = available ? (raw & 0xFF) : 0;
+  // Scanning enabled, reading unavailable
+  data[1] = available ? 0x40 : 0x60;
+  // Reserved bits are returned as 1b
+  data[2] = 0xC0 | status;
+
+  return 0;
+}
+
+uint32_t
+sdr_generation(void) {
+  uint32_t gen;
+
+  pthread_rwlock_rdlock(&m_sdr);
+  gen = g_sdr_gen;
+  pthread_rwlock_unlock(&m_sdr);
+
+  return gen;
+}
+
+// Populate the SDR Repo from the platform sensor tables
+static void
+sdr_build(void) {
   int num;
   int i;
   sensor_mgmt_t *p_mgmt;
@@ -393,6 +562,10 @@ sdr_init(void) {
   g_sdr_hdr.end = SDR_INDEX_MIN;
   memset(g_sdr_hdr.ts_add.ts, 0x0, 4);
   memset(g_sdr_hdr.ts_erase.ts, 0x0, 4);
+  memset(g_sdr_data, 0, sizeof(g_sdr_data));
+  for (i = 0; i < SDR_SENSOR_NUM_MAX; i++) {
+    g_sdr_snr_index[i] = -1;
+  }
 
   // Populate all mgmt control sensors
   plat_sensor_mgmt_info(&num, &p_mgmt);
@@ -417,6 +590,23 @@ sdr_init(void) {
   for (i = 0; i < num; i++) {
     sdr_add_oem_rec(&p_oem[i]);
   }
+}
+
+// Rebuild the SDR Repo, e.g. after the pal signalled a change of sensors
+void
+sdr_rebuild(void) {
+  pthread_rwlock_wrlock(&m_sdr);
+  sdr_build();
+  g_sdr_gen++;
+  pthread_rwlock_unlock(&m_sdr);
+}
+
+// Initialize SDR Repo structure
+int
+sdr_init(void) {
+  int i;
+
+  sdr_build();
 
   // Initialize the reservation IDs
   for (i = 0; i <= MAX_NODES; i++) {
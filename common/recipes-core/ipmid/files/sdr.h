@@ -21,6 +21,8 @@
 #ifndef __SDR_H__
 #define __SDR_H__
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "timestamp.h"
 
 typedef struct {
@@ -68,5 +70,9 @@ int sdr_rsv_id(int node);
 int sdr_get_entry(int node, int rsv_id, int read_rec_id, sdr_rec_t *rec,
                        int *next_rec_id);
 int sdr_init(void);
+void sdr_rebuild(void);
+uint32_t sdr_generation(void);
+int sdr_sensor_reading(uint8_t snr, bool available, float value,
+                       unsigned char *data, uint32_t *gen);
 
 #endif /* __SDR_H__ */
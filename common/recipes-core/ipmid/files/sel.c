@@ -5,8 +5,8 @@
  * This file represents platform specific implementation for storing
  * SEL logs and acts as back-end for IPMI stack
  *
- * TODO: Optimize the file handling to keep file open always instead of
- * current open/seek/close
+ * The SEL of a node is a ring of fixed size records in a file, which is
+ * kept open and mapped for the life of ipmid.
  *
  *
  * This program is free software; you can redistribute it and/or modify
@@ -23,7 +23,7 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
-#define _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
 #include "sel.h"
 #include "timestamp.h"
 #include <stdio.h>
@@ -33,9 +33,14 @@
 #include <syslog.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <openbmc/pal.h>
 
 // SEL File.
@@ -46,7 +51,10 @@
 #define SEL_HDR_MAGIC 0xFBFBFBFB
 
 // SEL Header version number
-#define SEL_HDR_VERSION 0x01
+#define SEL_HDR_VERSION 0x02
+// Version 1 logs had a ring of 128 records, they get migrated
+#define SEL_HDR_VERSION_V1 0x01
+#define SEL_RECORDS_MAX_V1 128
 
 // SEL Data offset from file beginning
 #define SEL_DATA_OFFSET 0x100
@@ -56,7 +64,8 @@
 #define SEL_RSVID_MAX  0xFFFE
 
 // Number of SEL records before wrap
-#define SEL_RECORDS_MAX 128 // TODO: Based on need we can make it bigger
+// The free space (in bytes) reported by Get SEL Info is 16 bits
+#define SEL_RECORDS_MAX 4095
 #define SEL_ELEMS_MAX (SEL_RECORDS_MAX+1)
 
 // Index for circular array
@@ -73,6 +82,8 @@
 
 #define RAS_SEL_LENGTH 1024
 
+#define SEL_FILE_SIZE (SEL_DATA_OFFSET + SEL_ELEMS_MAX * sizeof(sel_msg_t))
+
 // SEL header struct to keep track of SEL Log entries
 typedef struct {
   int magic; // Magic number to check validity
@@ -86,127 +97,134 @@ typedef struct {
 // Keep track of last Reservation ID
 static int g_rsv_id[MAX_NODES+1];
 
-// Cached version of SEL Header and data
-static sel_hdr_t g_sel_hdr[MAX_NODES+1];
-static sel_msg_t g_sel_data[MAX_NODES+1][SEL_ELEMS_MAX];
-
-// Local helper functions to interact with file system
-static int
-file_get_sel_hdr(int node) {
-  FILE *fp;
-  char fpath[SIZE_PATH_MAX] = {0};
-
-  sprintf(fpath, SEL_LOG_FILE, node);
+// Header and data of the SEL file of a node. The file is mapped shared,
+// or where the filesystem can not do that (e.g. JFFS2), image is a copy
+// which is written back with pwrite().
+typedef struct {
+  int fd;
+  bool mapped;
+  uint8_t *image;
+} sel_file_t;
 
-  fp = fopen(fpath, "r");
-  if (fp == NULL) {
-    return -1;
-  }
+static sel_file_t g_sel_file[MAX_NODES+1];
+static sel_hdr_t *g_sel_hdr[MAX_NODES+1];
+static sel_msg_t *g_sel_data[MAX_NODES+1];
 
-  if (fread(&g_sel_hdr[node], sizeof(sel_hdr_t), 1, fp) == 0) {
-    syslog(LOG_WARNING, "file_get_sel_hdr: fread\n");
-    fclose (fp);
-    return -1;
-  }
+// The SEL of a node is written by the Storage, Sensor and OEM NetFns
+static pthread_mutex_t m_sel[MAX_NODES+1];
 
-  fclose(fp);
-  return 0;
-}
+// Local helper functions to interact with file system
 
+// Write back the header and, if index is not negative, the record of the
+// SEL of a node. An append dirties just these two pages, so a single
+// msync() of the range up to the record writes both.
 static int
-file_get_sel_data(int node) {
-  FILE *fp;
-  int i, j;
-  char fpath[SIZE_PATH_MAX] = {0};
-
-  sprintf(fpath, SEL_LOG_FILE, node);
+file_sync_sel(int node, int index) {
+  sel_file_t *sf = &g_sel_file[node];
+  size_t len = SEL_DATA_OFFSET;
+  off_t offset;
 
-  fp = fopen(fpath, "r");
-  if (fp == NULL) {
-    syslog(LOG_WARNING, "file_get_sel_data: fopen\n");
-    return -1;
+  if (index >= 0) {
+    len += (index + 1) * sizeof(sel_msg_t);
   }
 
-  if (fseek(fp, SEL_DATA_OFFSET, SEEK_SET)) {
-    syslog(LOG_WARNING, "file_get_sel_data: fseek\n");
-    fclose(fp);
-    return -1;
+  if (sf->mapped) {
+    if (msync(sf->image, len, MS_SYNC)) {
+      syslog(LOG_WARNING, "file_sync_sel: msync: %s\n", strerror(errno));
+      return -1;
+    }
+    return 0;
   }
 
-  unsigned char buf[SEL_ELEMS_MAX * 16];
-  if (fread(buf, 1, SEL_ELEMS_MAX * sizeof(sel_msg_t), fp) == 0) {
-    syslog(LOG_WARNING, "file_get_sel_data: fread\n");
-    fclose(fp);
-    return -1;
+  if (index >= 0) {
+    offset = SEL_DATA_OFFSET + index * sizeof(sel_msg_t);
+    if (pwrite(sf->fd, sf->image + offset, sizeof(sel_msg_t), offset) !=
+        sizeof(sel_msg_t)) {
+      syslog(LOG_WARNING, "file_sync_sel: pwrite data: %s\n", strerror(errno));
+      return -1;
+    }
   }
 
-  fclose(fp);
-
-  for (i = 0; i < SEL_ELEMS_MAX; i++) {
-    for (j = 0; j < sizeof(sel_msg_t);j++) {
-      g_sel_data[node][i].msg[j] = buf[i*16 + j];
-    }
+  if (pwrite(sf->fd, sf->image, sizeof(sel_hdr_t), 0) != sizeof(sel_hdr_t)) {
+    syslog(LOG_WARNING, "file_sync_sel: pwrite hdr: %s\n", strerror(errno));
+    return -1;
   }
 
   return 0;
 }
 
+// Write back the whole SEL of a node
 static int
-file_store_sel_hdr(int node) {
-  FILE *fp;
-  char fpath[SIZE_PATH_MAX] = {0};
+file_sync_sel_all(int node) {
+  sel_file_t *sf = &g_sel_file[node];
 
-  sprintf(fpath, SEL_LOG_FILE, node);
-
-  fp = fopen(fpath, "r+");
-  if (fp == NULL) {
-    syslog(LOG_WARNING, "file_store_sel_hdr: fopen\n");
-    return -1;
+  if (sf->mapped) {
+    return file_sync_sel(node, SEL_INDEX_MAX);
   }
 
-  if (fwrite(&g_sel_hdr[node], sizeof(sel_hdr_t), 1, fp) == 0) {
-    syslog(LOG_WARNING, "file_store_sel_hdr: fwrite\n");
-    fclose(fp);
+  if (pwrite(sf->fd, sf->image, SEL_FILE_SIZE, 0) != SEL_FILE_SIZE) {
+    syslog(LOG_WARNING, "file_sync_sel_all: pwrite: %s\n", strerror(errno));
     return -1;
   }
 
-  fclose(fp);
-
   return 0;
 }
 
-static int
-file_store_sel_data(int node, int recId, sel_msg_t *data) {
-  FILE *fp;
-  int index;
+// Open and map the SEL file of a node, growing it to SEL_FILE_SIZE.
+// Returns the size of the file before, 0 if it was just created.
+static off_t
+file_open_sel(int node) {
+  sel_file_t *sf = &g_sel_file[node];
   char fpath[SIZE_PATH_MAX] = {0};
+  struct stat st;
+  void *map;
 
-  sprintf(fpath, SEL_LOG_FILE, node);
+  snprintf(fpath, sizeof(fpath), SEL_LOG_FILE, node);
 
-  fp = fopen(fpath, "r+");
-  if (fp == NULL) {
-    syslog(LOG_WARNING, "file_store_sel_data: fopen\n");
+  sf->fd = open(fpath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (sf->fd < 0) {
+    syslog(LOG_WARNING, "file_open_sel: open %s: %s\n", fpath, strerror(errno));
     return -1;
   }
 
-  // Records are stored using zero-based index
-  index = (recId-1) * sizeof(sel_msg_t);
+  if (fstat(sf->fd, &st)) {
+    syslog(LOG_WARNING, "file_open_sel: fstat: %s\n", strerror(errno));
+    goto bail;
+  }
 
-  if (fseek(fp, SEL_DATA_OFFSET+index, SEEK_SET)) {
-    syslog(LOG_WARNING, "file_store_sel_data: fseek\n");
-    fclose(fp);
-    return -1;
+  if (st.st_size < SEL_FILE_SIZE && ftruncate(sf->fd, SEL_FILE_SIZE)) {
+    syslog(LOG_WARNING, "file_open_sel: ftruncate: %s\n", strerror(errno));
+    goto bail;
   }
 
-  if (fwrite(data->msg, sizeof(sel_msg_t), 1, fp) == 0) {
-    syslog(LOG_WARNING, "file_store_sel_data: fwrite\n");
-    fclose(fp);
-    return -1;
+  map = mmap(NULL, SEL_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, sf->fd, 0);
+  if (map != MAP_FAILED) {
+    sf->image = map;
+    sf->mapped = true;
+  } else {
+    sf->image = malloc(SEL_FILE_SIZE);
+    if (sf->image == NULL) {
+      syslog(LOG_WARNING, "file_open_sel: malloc\n");
+      goto bail;
+    }
+    if (pread(sf->fd, sf->image, SEL_FILE_SIZE, 0) != SEL_FILE_SIZE) {
+      syslog(LOG_WARNING, "file_open_sel: pread: %s\n", strerror(errno));
+      free(sf->image);
+      sf->image = NULL;
+      goto bail;
+    }
+    sf->mapped = false;
   }
 
-  fclose(fp);
+  g_sel_hdr[node] = (sel_hdr_t *)sf->image;
+  g_sel_data[node] = (sel_msg_t *)(sf->image + SEL_DATA_OFFSET);
 
-  return 0;
+  return st.st_size;
+
+bail:
+  close(sf->fd);
+  sf->fd = -1;
+  return -1;
 }
 
 static void
@@ -403,22 +421,22 @@ parse_sel(uint8_t fru, sel_msg_t *data) {
 // Retrieve time stamp for recent add operation
 void
 sel_ts_recent_add(int node, time_stamp_t *ts) {
-  memcpy(ts->ts, g_sel_hdr[node].ts_add.ts, 0x04);
+  memcpy(ts->ts, g_sel_hdr[node]->ts_add.ts, 0x04);
 }
 
 // Retrieve time stamp for recent erase operation
 void
 sel_ts_recent_erase(int node, time_stamp_t *ts) {
-  memcpy(ts->ts, g_sel_hdr[node].ts_erase.ts, 0x04);
+  memcpy(ts->ts, g_sel_hdr[node]->ts_erase.ts, 0x04);
 }
 
 // Retrieve total number of entries in SEL log
 int
 sel_num_entries(int node) {
-  if (g_sel_hdr[node].begin <= g_sel_hdr[node].end) {
-      return (g_sel_hdr[node].end - g_sel_hdr[node].begin);
+  if (g_sel_hdr[node]->begin <= g_sel_hdr[node]->end) {
+      return (g_sel_hdr[node]->end - g_sel_hdr[node]->begin);
   } else {
-    return (g_sel_hdr[node].end + (SEL_INDEX_MAX - g_sel_hdr[node].begin + 1));
+    return (g_sel_hdr[node]->end + (SEL_INDEX_MAX - g_sel_hdr[node]->begin + 1));
   }
 }
 
@@ -438,27 +456,32 @@ sel_free_space(int node) {
 // IPMI/Section 31.4
 int
 sel_rsv_id(int node) {
+  int rsv_id;
+
   // Increment the current reservation ID and return
+  pthread_mutex_lock(&m_sel[node]);
   if (g_rsv_id[node]++ == SEL_RSVID_MAX) {
     g_rsv_id[node] = SEL_RSVID_MIN;
   }
+  rsv_id = g_rsv_id[node];
+  pthread_mutex_unlock(&m_sel[node]);
 
-  return g_rsv_id[node];
+  return rsv_id;
 }
 
 // Get the SEL entry for a given record ID
 // IPMI/Section 31.5
-int
-sel_get_entry(int node, int read_rec_id, sel_msg_t *msg, int *next_rec_id) {
+static int
+sel_get_entry_locked(int node, int read_rec_id, sel_msg_t *msg, int *next_rec_id) {
 
   int index;
 
   // Find the index in to array based on given index
   if (read_rec_id == SEL_RECID_FIRST) {
-    index = g_sel_hdr[node].begin;
+    index = g_sel_hdr[node]->begin;
   } else if (read_rec_id == SEL_RECID_LAST) {
-    if (g_sel_hdr[node].end) {
-      index = g_sel_hdr[node].end - 1;
+    if (g_sel_hdr[node]->end) {
+      index = g_sel_hdr[node]->end - 1;
     } else {
       index = SEL_INDEX_MAX;
     }
@@ -479,16 +502,16 @@ sel_get_entry(int node, int read_rec_id, sel_msg_t *msg, int *next_rec_id) {
   }
 
   // If begin < end, check to make sure the given id falls between
-  if (g_sel_hdr[node].begin < g_sel_hdr[node].end) {
-    if (index < g_sel_hdr[node].begin || index >= g_sel_hdr[node].end) {
+  if (g_sel_hdr[node]->begin < g_sel_hdr[node]->end) {
+    if (index < g_sel_hdr[node]->begin || index >= g_sel_hdr[node]->end) {
       syslog(LOG_WARNING, "sel_get_entry: Wrong Record ID %d\n", read_rec_id);
       return -1;
     }
   }
 
   // If end < begin, check to make sure the given id is valid
-  if (g_sel_hdr[node].begin > g_sel_hdr[node].end) {
-    if (index >= g_sel_hdr[node].end && index < g_sel_hdr[node].begin) {
+  if (g_sel_hdr[node]->begin > g_sel_hdr[node]->end) {
+    if (index >= g_sel_hdr[node]->end && index < g_sel_hdr[node]->begin) {
       syslog(LOG_WARNING, "sel_get_entry: Wrong Record ID2 %d\n", read_rec_id);
       return -1;
     }
@@ -503,13 +526,24 @@ sel_get_entry(int node, int read_rec_id, sel_msg_t *msg, int *next_rec_id) {
   }
 
   // If this is the last entry in the log, return 0xFFFF
-  if (*next_rec_id == g_sel_hdr[node].end) {
+  if (*next_rec_id == g_sel_hdr[node]->end) {
     *next_rec_id = SEL_RECID_LAST;
   }
 
   return 0;
 }
 
+int
+sel_get_entry(int node, int read_rec_id, sel_msg_t *msg, int *next_rec_id) {
+  int ret;
+
+  pthread_mutex_lock(&m_sel[node]);
+  ret = sel_get_entry_locked(node, read_rec_id, msg, next_rec_id);
+  pthread_mutex_unlock(&m_sel[node]);
+
+  return ret;
+}
+
 // Add a new entry in to SEL log for RAS SEL
 int
 ras_sel_add_entry(int node, ras_sel_msg_t *msg) {
@@ -525,29 +559,31 @@ ras_sel_add_entry(int node, ras_sel_msg_t *msg) {
 
 // Add a new entry in to SEL log
 // IPMI/Section 31.6
-int
-sel_add_entry(int node, sel_msg_t *msg, int *rec_id) {
+static int
+sel_add_entry_locked(int node, sel_msg_t *msg, int *rec_id) {
+  int index = g_sel_hdr[node]->end;
+
   // If the SEL if full, roll over. To keep track of empty condition, use
   // one empty location less than the max records.
   if (sel_num_entries(node) == SEL_RECORDS_MAX) {
       syslog(LOG_WARNING, "sel_add_entry: SEL rollover\n");
-    if (++g_sel_hdr[node].begin > SEL_INDEX_MAX) {
-      g_sel_hdr[node].begin = SEL_INDEX_MIN;
+    if (++g_sel_hdr[node]->begin > SEL_INDEX_MAX) {
+      g_sel_hdr[node]->begin = SEL_INDEX_MIN;
     }
   }
 
-  msg->msg[0] = g_sel_hdr[node].end & 0xFF;
-  msg->msg[1] = (g_sel_hdr[node].end >> 8) & 0xFF;
+  msg->msg[0] = g_sel_hdr[node]->end & 0xFF;
+  msg->msg[1] = (g_sel_hdr[node]->end >> 8) & 0xFF;
 
   // Update message's time stamp starting at byte 4
   if (msg->msg[2] < 0xE0)
     time_stamp_fill(&msg->msg[3]);
 
   // Add the enry at end
-  memcpy(g_sel_data[node][g_sel_hdr[node].end].msg, msg->msg, sizeof(sel_msg_t));
+  memcpy(g_sel_data[node][g_sel_hdr[node]->end].msg, msg->msg, sizeof(sel_msg_t));
 
   // Return the newly added record ID
-  *rec_id = g_sel_hdr[node].end+1;
+  *rec_id = g_sel_hdr[node]->end+1;
 
   // Print the data in syslog
   dump_sel_syslog(node, msg);
@@ -555,53 +591,70 @@ sel_add_entry(int node, sel_msg_t *msg, int *rec_id) {
   // Parse the SEL message
   parse_sel((uint8_t) node, msg);
 
-  if (file_store_sel_data(node, *rec_id, msg)) {
-    syslog(LOG_WARNING, "sel_add_entry: file_store_sel_data\n");
-    return -1;
-  }
-
   // Increment the end pointer
-  if (++g_sel_hdr[node].end > SEL_INDEX_MAX) {
-    g_sel_hdr[node].end = SEL_INDEX_MIN;
+  if (++g_sel_hdr[node]->end > SEL_INDEX_MAX) {
+    g_sel_hdr[node]->end = SEL_INDEX_MIN;
   }
 
   // Update timestamp for add in header
-  time_stamp_fill(g_sel_hdr[node].ts_add.ts);
+  time_stamp_fill(g_sel_hdr[node]->ts_add.ts);
 
-  // Store the structure persistently
-  if (file_store_sel_hdr(node)) {
-    syslog(LOG_WARNING, "sel_add_entry: file_store_sel_hdr\n");
+  // Store the entry and the header persistently
+  if (file_sync_sel(node, index)) {
+    syslog(LOG_WARNING, "sel_add_entry: file_sync_sel\n");
     return -1;
   }
 
   return 0;
 }
 
+int
+sel_add_entry(int node, sel_msg_t *msg, int *rec_id) {
+  int ret;
+
+  pthread_mutex_lock(&m_sel[node]);
+  ret = sel_add_entry_locked(node, msg, rec_id);
+  pthread_mutex_unlock(&m_sel[node]);
+
+  return ret;
+}
+
 // Erase the SEL completely
 // IPMI/Section 31.9
 // Note: To reduce wear/tear, instead of erasing, manipulating the metadata
-int
-sel_erase(int node, int rsv_id) {
+static int
+sel_erase_locked(int node, int rsv_id) {
   if (rsv_id != g_rsv_id[node]) {
     return -1;
   }
 
   // Erase SEL Logs
-  g_sel_hdr[node].begin = SEL_INDEX_MIN;
-  g_sel_hdr[node].end = SEL_INDEX_MIN;
+  g_sel_hdr[node]->begin = SEL_INDEX_MIN;
+  g_sel_hdr[node]->end = SEL_INDEX_MIN;
 
   // Update timestamp for erase in header
-  time_stamp_fill(g_sel_hdr[node].ts_erase.ts);
+  time_stamp_fill(g_sel_hdr[node]->ts_erase.ts);
 
   // Store the structure persistently
-  if (file_store_sel_hdr(node)) {
-    syslog(LOG_WARNING, "sel_erase: file_store_sel_hdr\n");
+  if (file_sync_sel(node, -1)) {
+    syslog(LOG_WARNING, "sel_erase: file_sync_sel\n");
     return -1;
   }
 
   return 0;
 }
 
+int
+sel_erase(int node, int rsv_id) {
+  int ret;
+
+  pthread_mutex_lock(&m_sel[node]);
+  ret = sel_erase_locked(node, rsv_id);
+  pthread_mutex_unlock(&m_sel[node]);
+
+  return ret;
+}
+
 // To get the erase status while erase happens
 // IPMI/Section 31.2
 // Note: Since we are not doing offline erasing, need not return in-progress state
@@ -617,60 +670,77 @@ sel_erase_status(int node, int rsv_id, sel_erase_stat_t *status) {
   return 0;
 }
 
-// Initialize SEL log file
+// Version 1 logs kept a ring of SEL_RECORDS_MAX_V1 records at the same
+// offset, unroll it to the beginning of the current ring
 static int
-sel_node_init(int node) {
-  FILE *fp;
-  int i;
-  char fpath[SIZE_PATH_MAX] = {0};
+sel_migrate_v1(int node) {
+  sel_hdr_t *hdr = g_sel_hdr[node];
+  sel_msg_t old[SEL_RECORDS_MAX_V1 + 1];
+  int i, num = 0, index;
 
-  sprintf(fpath, SEL_LOG_FILE, node);
-
-  // Check if the file exists or not
-  if (access(fpath, F_OK) == 0) {
-    // Since file is present, fetch all the contents to cache
-    if (file_get_sel_hdr(node)) {
-      syslog(LOG_WARNING, "init_sel: file_get_sel_hdr\n");
-      return -1;
-    }
-
-    if (file_get_sel_data(node)) {
-      syslog(LOG_WARNING, "init_sel: file_get_sel_data\n");
-      return -1;
-    }
+  if (hdr->begin < SEL_INDEX_MIN || hdr->begin > SEL_RECORDS_MAX_V1 ||
+      hdr->end < SEL_INDEX_MIN || hdr->end > SEL_RECORDS_MAX_V1) {
+    return -1;
+  }
 
-    return 0;
+  for (index = hdr->begin; index != hdr->end;
+       index = (index + 1) % (SEL_RECORDS_MAX_V1 + 1)) {
+    memcpy(old[num++].msg, g_sel_data[node][index].msg, sizeof(sel_msg_t));
   }
 
-  // File not present, so create the file
-  fp = fopen(fpath, "w+");
-  if (fp == NULL) {
-    syslog(LOG_WARNING, "init_sel: fopen\n");
-    return -1;
+  memset(g_sel_data[node], 0, SEL_ELEMS_MAX * sizeof(sel_msg_t));
+  for (i = 0; i < num; i++) {
+    // Record ID is the index in to the ring
+    old[i].msg[0] = i & 0xFF;
+    old[i].msg[1] = (i >> 8) & 0xFF;
+    memcpy(g_sel_data[node][i].msg, old[i].msg, sizeof(sel_msg_t));
   }
 
-  fclose (fp);
+  hdr->version = SEL_HDR_VERSION;
+  hdr->begin = SEL_INDEX_MIN;
+  hdr->end = SEL_INDEX_MIN + num;
 
-  // Populate SEL Header in to the file
-  g_sel_hdr[node].magic = SEL_HDR_MAGIC;
-  g_sel_hdr[node].version = SEL_HDR_VERSION;
-  g_sel_hdr[node].begin = SEL_INDEX_MIN;
-  g_sel_hdr[node].end = SEL_INDEX_MIN;
-  memset(g_sel_hdr[node].ts_add.ts, 0x0, 4);
-  memset(g_sel_hdr[node].ts_erase.ts, 0x0, 4);
+  syslog(LOG_INFO, "init_sel: migrated %d entries of node %d\n", num, node);
+  return file_sync_sel_all(node);
+}
 
-  if (file_store_sel_hdr(node)) {
-    syslog(LOG_WARNING, "init_sel: file_store_sel_hdr\n");
+// Initialize SEL log file
+static int
+sel_node_init(int node) {
+  sel_hdr_t *hdr;
+  off_t size;
+
+  size = file_open_sel(node);
+  if (size < 0) {
     return -1;
   }
+  hdr = g_sel_hdr[node];
 
-  // Populate SEL Data in to the file
-  for (i = 1;  i <= SEL_RECORDS_MAX; i++) {
-    sel_msg_t msg = {0};
-    if (file_store_sel_data(node, i, &msg)) {
-      syslog(LOG_WARNING, "init_sel: file_store_sel_data\n");
-      return -1;
+  // Since file is present, its contents are mapped already
+  if (size > 0 && hdr->magic == SEL_HDR_MAGIC) {
+    if (hdr->version == SEL_HDR_VERSION &&
+        hdr->begin >= SEL_INDEX_MIN && hdr->begin <= SEL_INDEX_MAX &&
+        hdr->end >= SEL_INDEX_MIN && hdr->end <= SEL_INDEX_MAX) {
+      return 0;
     }
+
+    if (hdr->version == SEL_HDR_VERSION_V1 && sel_migrate_v1(node) == 0) {
+      return 0;
+    }
+
+    syslog(LOG_WARNING, "init_sel: invalid SEL of node %d, erased\n", node);
+  }
+
+  // Populate SEL Header and empty SEL Data in to the file
+  memset(g_sel_file[node].image, 0, SEL_FILE_SIZE);
+  hdr->magic = SEL_HDR_MAGIC;
+  hdr->version = SEL_HDR_VERSION;
+  hdr->begin = SEL_INDEX_MIN;
+  hdr->end = SEL_INDEX_MIN;
+
+  if (file_sync_sel_all(node)) {
+    syslog(LOG_WARNING, "init_sel: file_sync_sel_all\n");
+    return -1;
   }
 
   g_rsv_id[node] = 0x01;
@@ -683,6 +753,10 @@ sel_init(void) {
   int ret;
   int i;
 
+  for (i = 0; i < MAX_NODES+1; i++) {
+    pthread_mutex_init(&m_sel[i], NULL);
+  }
+
   for (i = 1; i < MAX_NODES+1; i++) {
     ret = sel_node_init(i);
     if (ret) {
@@ -30,6 +30,7 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <openbmc/pal.h>
 #include <openbmc/sdr.h>
 #include <openbmc/kv.h>
@@ -58,6 +59,9 @@
 
 #define MAX_UART_SEL_NAME_SIZE    16
 
+// The info frame has no change notification, it is rebuilt at most this often
+#define INFO_FRAME_REFRESH        5
+
 struct frame {
   char title[32];
   size_t max_size;
@@ -351,6 +355,26 @@ static FRAME_DECLARE(frame_info);
 static FRAME_DECLARE(frame_sel);
 static FRAME_DECLARE(frame_snr);
 
+// Rendered line of a critical sensor, kept until sensord writes a new
+// value into the sensor cache (see sensor_cache_generation()).
+typedef struct {
+  bool valid;
+  uint32_t gen;
+  char str[64];
+} snr_line_t;
+
+// Rendered critical sensor lines of a debug card position (FRU)
+typedef struct {
+  uint8_t pos;
+  sensor_desc_t *desc;
+  size_t count;
+  snr_line_t *lines;
+} snr_lines_t;
+
+static snr_lines_t g_snr_lines[MAX_NODES + 1];
+// Position frame_snr was last packed for
+static uint8_t frame_snr_pos = 0xff;
+
 enum ENUM_PANEL {
   PANEL_MAIN = 1,
   PANEL_BOOT_ORDER = 2,
@@ -428,6 +452,108 @@ chk_cri_sel_update(uint8_t *cri_sel_up) {
   return 0;
 }
 
+static snr_lines_t *
+get_snr_lines(uint8_t pos) {
+  snr_lines_t *sl = &g_snr_lines[pos <= MAX_NODES ? pos : 0];
+  sensor_desc_t *desc = NULL;
+  size_t count = 0;
+
+  if (plat_get_sensor_desc(pos, &desc, &count)) {
+    return NULL;
+  }
+  if (sl->lines == NULL || sl->pos != pos || sl->desc != desc || sl->count != count) {
+    free(sl->lines);
+    sl->lines = calloc(count ? count : 1, sizeof(snr_line_t));
+    sl->desc = sl->lines ? desc : NULL;
+    sl->count = sl->lines ? count : 0;
+    sl->pos = pos;
+    if (sl->lines == NULL) {
+      return NULL;
+    }
+  }
+  return sl;
+}
+
+// Whether the line of the sensor i needs rendering again, gen is its
+// current generation.
+static bool
+snr_line_stale(snr_lines_t *sl, int i, uint32_t *gen) {
+  uint8_t fru = sl->desc[i].fru == FRU_ALL ? sl->pos : sl->desc[i].fru;
+  bool has_gen = sensor_cache_generation(fru, sl->desc[i].sensor_num, gen) == 0;
+
+  return !has_gen || !sl->lines[i].valid || sl->lines[i].gen != *gen;
+}
+
+static void
+render_snr_line(snr_lines_t *sl, int i, uint32_t gen) {
+  char temp_val[16], temp_thresh[8], print_format[32];
+  int ret;
+  float fvalue;
+  thresh_sensor_t thresh;
+  sensor_desc_t *cri_sensor = &sl->desc[i];
+  snr_line_t *line = &sl->lines[i];
+  uint8_t fru = cri_sensor->fru == FRU_ALL ? sl->pos : cri_sensor->fru;
+
+  temp_thresh[0] = 0;
+  ret = sensor_cache_read(fru, cri_sensor->sensor_num, &fvalue);
+  if (ret < 0) {
+    strcpy(temp_val, "NA");
+  } else {
+    ret = sdr_get_snr_thresh(fru, cri_sensor->sensor_num, &thresh);
+    if (ret == 0) {
+      if ((GETBIT(thresh.flag, UNR_THRESH) == 1) && (fvalue > thresh.unr_thresh)) {
+        strcpy(temp_thresh, "/UNR");
+      } else if (((GETBIT(thresh.flag, UCR_THRESH) == 1)) && (fvalue > thresh.ucr_thresh)) {
+        strcpy(temp_thresh, "/UCR");
+      } else if (((GETBIT(thresh.flag, UNC_THRESH) == 1)) && (fvalue > thresh.unc_thresh)) {
+        strcpy(temp_thresh, "/UNC");
+      } else if (((GETBIT(thresh.flag, LNR_THRESH) == 1)) && (fvalue < thresh.lnr_thresh)) {
+        strcpy(temp_thresh, "/LNR");
+      } else if (((GETBIT(thresh.flag, LCR_THRESH) == 1)) && (fvalue < thresh.lcr_thresh)) {
+        strcpy(temp_thresh, "/LCR");
+      } else if (((GETBIT(thresh.flag, LNC_THRESH) == 1)) && (fvalue < thresh.lnc_thresh)) {
+        strcpy(temp_thresh, "/LNC");
+      }
+    }
+    snprintf(print_format, sizeof(print_format), "%%.%df%%s", (int)cri_sensor->disp_prec);
+    snprintf(temp_val, sizeof(temp_val), (const char *)print_format, fvalue, cri_sensor->unit);
+  }
+  if (temp_thresh[0] != 0)
+    snprintf(line->str, sizeof(line->str), ESC_ALT"%s%s%s"ESC_RST, cri_sensor->name, temp_val, temp_thresh);
+  else
+    snprintf(line->str, sizeof(line->str), ESC_NOR"%s%s"ESC_RST, cri_sensor->name, temp_val);
+  line->gen = gen;
+  line->valid = true;
+}
+
+// Pos implies BMC (FRU_ALL) and configuration for this sensor
+// wants us to use the FRU info from the pos. Skip this sensor
+static bool
+snr_line_skipped(snr_lines_t *sl, int i) {
+  return sl->desc[i].fru == FRU_ALL && sl->pos == FRU_ALL;
+}
+
+static int
+chk_cri_sensor_update(uint8_t *cri_snr_up) {
+  uint8_t pos = plat_get_fru_sel();
+  snr_lines_t *sl = get_snr_lines(pos);
+  uint32_t gen;
+  int i;
+
+  *cri_snr_up = 0;
+  if (sl == NULL || frame_snr_pos != pos) {
+    *cri_snr_up = 1;
+    return 0;
+  }
+  for (i = 0; i < sl->count; i++) {
+    if (!snr_line_skipped(sl, i) && snr_line_stale(sl, i, &gen)) {
+      *cri_snr_up = 1;
+      break;
+    }
+  }
+  return 0;
+}
+
 int
 plat_udbg_get_frame_info(uint8_t *num)
 {
@@ -442,6 +568,7 @@ plat_udbg_get_frame_info(uint8_t *num)
 int
 plat_udbg_get_updated_frames(uint8_t *count, uint8_t *buffer) {
   uint8_t cri_sel_up = 0;
+  uint8_t cri_snr_up = 0;
   uint8_t info_page_up = 1;
 
   if (!plat_supported()) {
@@ -464,8 +591,11 @@ plat_udbg_get_updated_frames(uint8_t *count, uint8_t *buffer) {
   }
 
   // cri sensor update
-  buffer[*count] = 3;
-  *count += 1;
+  chk_cri_sensor_update(&cri_snr_up);
+  if (cri_snr_up == 1) {
+    buffer[*count] = 3;
+    *count += 1;
+  }
 
   return 0;
 }
@@ -662,63 +792,35 @@ udbg_get_cri_sel(uint8_t frame, uint8_t page, uint8_t *next, uint8_t *count, uin
 
 static int
 udbg_get_cri_sensor (uint8_t frame, uint8_t page, uint8_t *next, uint8_t *count, uint8_t *buffer) {
-  char str[64], temp_val[16], temp_thresh[8], print_format[32];
-  int i, ret;
-  float fvalue;
-  thresh_sensor_t thresh;
-  sensor_desc_t *cri_sensor = NULL;
-  size_t sensor_count = 0;
+  int i, ret, changed = 0;
+  uint32_t gen;
   uint8_t pos = plat_get_fru_sel();
-  uint8_t fru;
+  snr_lines_t *sl = get_snr_lines(pos);
 
-  if (plat_get_sensor_desc(pos, &cri_sensor, &sensor_count)) {
+  if (sl == NULL) {
     return -1;
   }
 
   if (page == 1) {
-    // Only update frame data while getting page 1
-
-    // initialize and clear frame
-    frame_snr.init(&frame_snr, FRAME_BUFF_SIZE);
-    snprintf(frame_snr.title, 32, "CriSensor");
-
-    for (i = 0; i < sensor_count; i++) {
-      /* Pos implies BMC (FRU_ALL) and configuration for this sensor
-       * wants us to use the FRU info from the pos. Skip this sensor */
-      if (cri_sensor[i].fru == FRU_ALL && pos == FRU_ALL) {
-        continue;
+    // Only update frame data while getting page 1, and only the lines
+    // of the sensors which changed since
+    for (i = 0; i < sl->count; i++) {
+      if (!snr_line_skipped(sl, i) && snr_line_stale(sl, i, &gen)) {
+        render_snr_line(sl, i, gen);
+        changed++;
       }
-      fru = cri_sensor[i].fru == FRU_ALL ? pos : cri_sensor[i].fru;
+    }
 
-      temp_thresh[0] = 0;
-      ret = sensor_cache_read(fru, cri_sensor[i].sensor_num, &fvalue);
-      if (ret < 0) {
-        strcpy(temp_val, "NA");
-      } else {
-        ret = sdr_get_snr_thresh(fru, cri_sensor[i].sensor_num, &thresh);
-        if (ret == 0) {
-          if ((GETBIT(thresh.flag, UNR_THRESH) == 1) && (fvalue > thresh.unr_thresh)) {
-            strcpy(temp_thresh, "/UNR");
-          } else if (((GETBIT(thresh.flag, UCR_THRESH) == 1)) && (fvalue > thresh.ucr_thresh)) {
-            strcpy(temp_thresh, "/UCR");
-          } else if (((GETBIT(thresh.flag, UNC_THRESH) == 1)) && (fvalue > thresh.unc_thresh)) {
-            strcpy(temp_thresh, "/UNC");
-          } else if (((GETBIT(thresh.flag, LNR_THRESH) == 1)) && (fvalue < thresh.lnr_thresh)) {
-            strcpy(temp_thresh, "/LNR");
-          } else if (((GETBIT(thresh.flag, LCR_THRESH) == 1)) && (fvalue < thresh.lcr_thresh)) {
-            strcpy(temp_thresh, "/LCR");
-          } else if (((GETBIT(thresh.flag, LNC_THRESH) == 1)) && (fvalue < thresh.lnc_thresh)) {
-            strcpy(temp_thresh, "/LNC");
-          }
+    if (changed || frame_snr_pos != pos || frame_snr.buf == NULL) {
+      // initialize and clear frame
+      frame_snr.init(&frame_snr, FRAME_BUFF_SIZE);
+      snprintf(frame_snr.title, 32, "CriSensor");
+      for (i = 0; i < sl->count; i++) {
+        if (!snr_line_skipped(sl, i)) {
+          frame_snr.append(&frame_snr, sl->lines[i].str, 0);
         }
-        snprintf(print_format, sizeof(print_format), "%%.%df%%s", (int)cri_sensor[i].disp_prec);
-        snprintf(temp_val, sizeof(temp_val), (const char *)print_format, fvalue, cri_sensor[i].unit);
       }
-      if (temp_thresh[0] != 0)
-        snprintf(str, sizeof(str), ESC_ALT"%s%s%s"ESC_RST, cri_sensor[i].name, temp_val, temp_thresh);
-      else
-        snprintf(str, sizeof(str), ESC_NOR"%s%s"ESC_RST, cri_sensor[i].name, temp_val);
-      frame_snr.append(&frame_snr, str, 0);
+      frame_snr_pos = pos;
     }
   }  // End of update frame
 
@@ -756,7 +858,8 @@ udbg_get_info_page (uint8_t frame, uint8_t page, uint8_t *next, uint8_t *count,
   int ret;
   char line_buff[2048], *pres_dev = line_buff, *delim = "\n";
   FILE *fp;
-  fruid_info_t fruid;
+  fruid_lazy_t *fruid;
+  const char *fru_sn, *fru_pn;
   lan_config_t lan_config = { 0 };
   unsigned char zero_ip_addr[SIZE_IP_ADDR] = { 0 };
   unsigned char zero_ip6_addr[SIZE_IP6_ADDR] = { 0 };
@@ -764,9 +867,16 @@ udbg_get_info_page (uint8_t frame, uint8_t page, uint8_t *next, uint8_t *count,
   uint8_t pos = plat_get_fru_sel();
   char uart_sel_name[MAX_UART_SEL_NAME_SIZE] = {0};
   uint8_t uart_sel_num = 0;
+  static uint8_t info_pos = 0xff;
+  static time_t info_time = 0;
+  struct timespec ts;
 
-  if (page == 1) {
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  if (page == 1 && (frame_info.buf == NULL || info_pos != pos ||
+                    ts.tv_sec - info_time >= INFO_FRAME_REFRESH)) {
     // Only update frame data while getting page 1
+    info_pos = pos;
+    info_time = ts.tv_sec;
 
     // initialize and clear frame
     frame_info.init(&frame_info, FRAME_BUFF_SIZE);
@@ -784,12 +894,16 @@ udbg_get_info_page (uint8_t frame, uint8_t page, uint8_t *next, uint8_t *count,
 
     // FRU
     if (pos != FRU_ALL && pal_get_fruid_path(pos, fruid_path) == 0 &&
-      fruid_parse(fruid_path, &fruid) == 0) {
-      frame_info.append(&frame_info, "SN:", 0);
-      frame_info.append(&frame_info, fruid.board.serial, 1);
-      frame_info.append(&frame_info, "PN:", 0);
-      frame_info.append(&frame_info, fruid.board.part, 1);
-      free_fruid_info(&fruid);
+      (fruid = fruid_open(fruid_path)) != NULL) {
+      fru_sn = fruid_get_field(fruid, BSN);
+      fru_pn = fruid_get_field(fruid, BPN);
+      if (fru_sn && fru_pn) {
+        frame_info.append(&frame_info, "SN:", 0);
+        frame_info.append(&frame_info, (char *)fru_sn, 1);
+        frame_info.append(&frame_info, "PN:", 0);
+        frame_info.append(&frame_info, (char *)fru_pn, 1);
+      }
+      fruid_close(fruid);
     }
 
     // LAN
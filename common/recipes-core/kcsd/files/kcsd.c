@@ -61,6 +61,7 @@
 #include <signal.h>
 #include <time.h>
 #include <getopt.h>
+#include <poll.h>
 
 #include <openbmc/ipmi.h>
 #include <openbmc/libgpio.h>
@@ -226,13 +227,85 @@ static void *handle_add_sel(void *unused)
   return NULL;
 }
 
+/*
+ * The round trip of a KCS request to ipmid is done by ipmi_thread, so
+ * that kcs_thread keeps polling the KCS device meanwhile. KCS carries a
+ * single transaction at a time: a request read before the response to
+ * the previous one supersedes it, since the host has aborted that one,
+ * and the late response is dropped.
+ */
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t pending_cond;
+  uint32_t seq;         /* of the latest request */
+  bool pending;         /* the latest request is not taken by ipmi_thread */
+  unsigned char req_len;
+  uint8_t req_buf[257]; /* payload id + request */
+  bool ready;           /* res_buf holds the response to the latest request */
+  unsigned short res_len;
+  uint8_t res_buf[300];
+  int notify[2];        /* pipe written by ipmi_thread with a response */
+} ipmi_xfer =
+{
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .pending_cond = PTHREAD_COND_INITIALIZER,
+  .notify = {-1, -1},
+};
+
+static void *ipmi_thread(void *unused)
+{
+  uint8_t req_buf[sizeof(ipmi_xfer.req_buf)];
+  uint8_t res_buf[sizeof(ipmi_xfer.res_buf)];
+  unsigned char req_len;
+  unsigned short res_len;
+  uint32_t seq;
+  bool latest;
+
+  KCSD_VERBOSE("ipmi thread started");
+
+  while (1) {
+    pthread_mutex_lock(&ipmi_xfer.lock);
+    while (!ipmi_xfer.pending) {
+      pthread_cond_wait(&ipmi_xfer.pending_cond, &ipmi_xfer.lock);
+    }
+    seq = ipmi_xfer.seq;
+    req_len = ipmi_xfer.req_len;
+    memcpy(req_buf, ipmi_xfer.req_buf, req_len);
+    ipmi_xfer.pending = false;
+    pthread_mutex_unlock(&ipmi_xfer.lock);
+
+    // Send to IPMI stack and get response
+    lib_ipmi_handle(req_buf, req_len, res_buf, &res_len);
+
+    pthread_mutex_lock(&ipmi_xfer.lock);
+    latest = (seq == ipmi_xfer.seq);
+    if (latest) {
+      memcpy(ipmi_xfer.res_buf, res_buf, res_len);
+      ipmi_xfer.res_len = res_len;
+      ipmi_xfer.ready = true;
+    }
+    pthread_mutex_unlock(&ipmi_xfer.lock);
+
+    if (!latest) {
+      KCSD_VERBOSE("kcs_dev: dropped response (netfn=0x%02x, cmd=0x%02x) "
+                   "to an aborted request", req_buf[1], req_buf[2]);
+    } else if (write(ipmi_xfer.notify[1], "", 1) < 0 && errno != EAGAIN) {
+      OBMC_ERROR(errno, "failed to notify a response");
+    }
+  }
+
+  return NULL;
+}
+
 static void *kcs_thread(void *unused) {
   struct timespec req;
   struct timespec rem;
-  unsigned char req_len;
+  struct pollfd fds[2];
+  ssize_t req_len;
   unsigned short res_len;
   uint8_t req_buf[256];
   uint8_t res_buf[300];
+  uint8_t drain[16];
 
 #ifdef DEBUG
   struct timespec req_tv;
@@ -246,13 +319,47 @@ static void *kcs_thread(void *unused) {
 
   set_bmc_ready(true);
 
-  // Setup wait time
+  // Wait time of a device which polls ready without a request
   req.tv_sec = 0;
   req.tv_nsec = 10000000;//10mSec
 
+  fds[0].fd = kcs_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = ipmi_xfer.notify[0];
+  fds[1].events = POLLIN;
+
   while (1) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno != EINTR) {
+        OBMC_ERROR(errno, "failed to poll kcs device");
+        nanosleep(&req, &rem);
+      }
+      continue;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      while (read(ipmi_xfer.notify[0], drain, sizeof(drain)) > 0);
+
+      pthread_mutex_lock(&ipmi_xfer.lock);
+      res_len = 0;
+      if (ipmi_xfer.ready) {
+        res_len = ipmi_xfer.res_len;
+        memcpy(res_buf, ipmi_xfer.res_buf, res_len);
+        ipmi_xfer.ready = false;
+      }
+      pthread_mutex_unlock(&ipmi_xfer.lock);
+
+      if (res_len > 0) {
+        goto respond;
+      }
+    }
+
+    if (!(fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+      continue;
+    }
     req_len = read(kcs_fd, req_buf, sizeof(req_buf));
     if (req_len <= 0) {
+      // The legacy driver may not implement poll
       nanosleep(&req, &rem);
       continue;
     }
@@ -264,12 +371,18 @@ static void *kcs_thread(void *unused) {
     for(i=0; i < req_len; i++) {
       snprintf(cmd, sizeof(cmd), "%s %02x", cmd, req_buf[i]);
     }
-    OBMC_WARN("[ %ld.%ld ] KCS Req: %s, len=%d",
+    OBMC_WARN("[ %ld.%ld ] KCS Req: %s, len=%zd",
               req_tv.tv_sec, req_tv.tv_nsec, cmd, req_len);
 #endif
 
     TOUCH("/tmp/kcs_touch");
 
+    // Any request in flight is superseded
+    pthread_mutex_lock(&ipmi_xfer.lock);
+    ipmi_xfer.seq++;
+    ipmi_xfer.ready = false;
+    pthread_mutex_unlock(&ipmi_xfer.lock);
+
     if ( true == is_add_sel_req(req_buf)) {
       KCSD_VERBOSE("kcs_dev: new SEL entry received");
 
@@ -284,19 +397,26 @@ static void *kcs_thread(void *unused) {
 
       res_len = default_add_sel_res_len;
       memcpy(res_buf, default_add_sel_resp, default_add_sel_res_len);
-    } else {
-      KCSD_VERBOSE("kcs_dev: send message (netfn=0x%02x, cmd=0x%02x) to ipmid",
-                   req_buf[0], req_buf[1]);
-
-      memmove(&req_buf[1], req_buf, req_len);
-      req_buf[0] = FRU_SERVER;
-
-      // Send to IPMI stack and get response
-      // Additional byte as we are adding and passing payload ID for MN support
-      lib_ipmi_handle(req_buf, req_len + 1, res_buf, &res_len);
+      goto respond;
     }
 
-    res_len = write(kcs_fd, res_buf, res_len);
+    KCSD_VERBOSE("kcs_dev: send message (netfn=0x%02x, cmd=0x%02x) to ipmid",
+                 req_buf[0], req_buf[1]);
+
+    // Additional byte as we are adding and passing payload ID for MN support
+    pthread_mutex_lock(&ipmi_xfer.lock);
+    ipmi_xfer.req_buf[0] = FRU_SERVER;
+    memcpy(&ipmi_xfer.req_buf[1], req_buf, req_len);
+    ipmi_xfer.req_len = req_len + 1;
+    ipmi_xfer.pending = true;
+    pthread_cond_signal(&ipmi_xfer.pending_cond);
+    pthread_mutex_unlock(&ipmi_xfer.lock);
+    continue;
+
+respond:
+    if (write(kcs_fd, res_buf, res_len) < 0) {
+      OBMC_ERROR(errno, "failed to write kcs response");
+    }
 
 #ifdef DEBUG
     memset(cmd, 0, 200);
@@ -381,6 +501,7 @@ int
 main(int argc, char * const argv[]) {
   int ret;
   pthread_t kcs_tid;
+  pthread_t ipmi_tid;
   pthread_t add_sel_tid;
   uint8_t kcs_channel_num = 2;
   const char *bmc_ready_n_shadow = DEFAULT_BMC_READY_GPIO_SHADOW;
@@ -445,8 +566,22 @@ main(int argc, char * const argv[]) {
     }
   }
 
+  if (pipe(ipmi_xfer.notify) != 0 ||
+      fcntl(ipmi_xfer.notify[0], F_SETFL, O_NONBLOCK) != 0 ||
+      fcntl(ipmi_xfer.notify[1], F_SETFL, O_NONBLOCK) != 0) {
+    OBMC_ERROR(errno, "failed to create notify pipe");
+    return -1;
+  }
+
   sleep(1);
 
+  KCSD_VERBOSE("creating ipmi thread");
+  ret = pthread_create(&ipmi_tid, NULL, ipmi_thread, NULL);
+  if (ret != 0) {
+    OBMC_ERROR(ret, "failed to create ipmi_thread");
+    return -1;
+  }
+
   KCSD_VERBOSE("creating kcs_dev thread");
   ret = pthread_create(&kcs_tid, NULL, kcs_thread, NULL);
   if (ret != 0) {
@@ -465,6 +600,8 @@ main(int argc, char * const argv[]) {
 
   pthread_join(kcs_tid, NULL);
 
+  pthread_join(ipmi_tid, NULL);
+
   pthread_join(add_sel_tid, NULL);
 
   close(kcs_fd);
@@ -3,7 +3,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <arpa/inet.h>
-#include <ifaddrs.h>
+#include <net/if.h>
 #include <sys/socket.h>
 #include "net_lib.h"
 #include "strlib.h"
@@ -23,34 +23,32 @@
 int
 is_valid_if_name(char *if_name)
 {
-  struct ifaddrs *ifaddr, *ifa;
+  struct if_nameindex *ifs, *ifn;
   bool is_valid_if = false, is_vlan_exist = false;
   char *temp = NULL;
   int len = 0, index = 0, size = 0;
 
-  if ( getifaddrs(&ifaddr) == -1 )
+  // one link dump only, the addresses getifaddrs() also dumps are not needed
+  ifs = if_nameindex();
+  if ( NULL == ifs )
   {
     printf("Cannot get interface info!\n");
     return -1;
   }
 
-  for ( ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next )
+  for ( ifn = ifs; ifn->if_index != 0; ifn++ )
   {
-    //check the eth by AF_PACKET
-    if ( ifa->ifa_addr->sa_family == AF_PACKET )
+    if ( 0 == start_with(if_name, ifn->if_name) )
     {
-      if ( 0 == start_with(if_name, ifa->ifa_name) )
-      {
-        is_valid_if = true;
-      }
+      is_valid_if = true;
+    }
 
-      if ( index_of(ifa->ifa_name, ".") > 0 ) 
-      {
-        is_vlan_exist = true;
-      }           
+    if ( index_of(ifn->if_name, ".") > 0 )
+    {
+      is_vlan_exist = true;
     }
   }
-  freeifaddrs(ifaddr);
+  if_freenameindex(ifs);
 
   if ( false == is_valid_if )
   {
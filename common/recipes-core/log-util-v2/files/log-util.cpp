@@ -1,5 +1,250 @@
 #include "log-util.hpp"
+#include "selindex.hpp"
 #include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint64_t min_indexed_size = 4 * SELIndex::chunk_size;
+
+// Whether logfile is large enough for its index to pay off and the
+// filter one it can narrow down, with the time range it gives.
+static bool index_filter(
+    const std::string& logfile,
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time,
+    bool& timed,
+    time_t& start,
+    time_t& end) {
+  struct stat st;
+
+  timed = !(start_time.empty() || end_time.empty());
+  start = end = 0;
+  if (!timed && frus.count(SELFormat::FRU_ALL))
+    return false;
+  if (stat(logfile.c_str(), &st) || uint64_t(st.st_size) < min_indexed_size)
+    return false;
+  return !timed ||
+      (SELFormat::parse_time(start_time, start) &&
+       SELFormat::parse_time(end_time, end));
+}
+
+// Read the parts of logfile which can match the filter into buf, if the
+// file is large enough for its index to pay off and they are a fraction
+// of it.
+static bool read_indexed(
+    const std::string& logfile,
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time,
+    std::string& buf) {
+  bool timed;
+  time_t start, end;
+
+  if (!index_filter(logfile, frus, start_time, end_time, timed, start, end))
+    return false;
+
+  SELIndex index(logfile);
+  if (!index.update() || index.file_size() < min_indexed_size)
+    return false;
+  auto ranges = index.ranges(frus, timed, start, end);
+  uint64_t total = 0;
+  for (auto& r : ranges)
+    total += r.second - r.first;
+  if (total > index.file_size() / 2)
+    return false;
+
+  int fd = open(logfile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  buf.clear();
+  buf.reserve(total);
+  for (auto& r : ranges) {
+    size_t at = buf.size();
+    buf.resize(at + (r.second - r.first));
+    ssize_t rc = pread(fd, &buf[at], r.second - r.first, r.first);
+    if (rc < 0) {
+      close(fd);
+      return false;
+    }
+    // The file may have been rotated meanwhile; keep what was there
+    buf.resize(at + rc);
+  }
+  close(fd);
+  return true;
+}
+
+static bool copy_range(int fd_in, int fd_out, uint64_t off, uint64_t len) {
+  loff_t in_off = off;
+  while (len > 0) {
+    ssize_t rc = copy_file_range(fd_in, &in_off, fd_out, nullptr, len, 0);
+    if (rc <= 0)
+      break;
+    len -= rc;
+  }
+  // Not supported by the filesystem (or the kernel), copy by hand
+  char buf[SELIndex::chunk_size];
+  while (len > 0) {
+    ssize_t rc = pread(fd_in, buf, std::min<uint64_t>(len, sizeof(buf)), in_off);
+    if (rc <= 0 || write(fd_out, buf, rc) != rc)
+      return false;
+    in_off += rc;
+    len -= rc;
+  }
+  return true;
+}
+
+// Clear the matching lines of logfile parsing only the chunks its index
+// cannot rule out, the others are copied as they are. A logfile with
+// nothing to clear is left alone but for the breadcrumb, appended to it.
+// The breadcrumb goes in if last. Returns false if the index is of no
+// use for the filter, else whether the logfile was replaced in replaced.
+static bool clear_indexed(
+    SELStream& stream,
+    const std::string& logfile,
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time,
+    bool last,
+    bool& replaced) {
+  bool timed;
+  time_t start, end;
+
+  if (!index_filter(logfile, frus, start_time, end_time, timed, start, end))
+    return false;
+
+  SELIndex index(logfile);
+  if (!index.update() || index.file_size() < min_indexed_size)
+    return false;
+  int fd = open(logfile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  // Parsed parts of the logfile with what is left of them, the rest is
+  // kept as it is. The last chunk runs up to whatever rsyslogd has
+  // appended meanwhile, and may end without a newline.
+  struct Part {
+    uint64_t offset, len;
+    std::string out;
+  };
+  const auto& chunks = index.chunks();
+  std::vector<Part> parsed;
+  bool changed = false;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    bool tail = i + 1 == chunks.size();
+    if (!tail && !(chunks[i].flags & SELIndex::HAS_INVALID) &&
+        !index.may_match(i, frus, timed, start, end))
+      continue;
+    uint64_t off = chunks[i].offset;
+    std::string buf;
+    if (tail) {
+      char tmp[SELIndex::chunk_size];
+      ssize_t rc;
+      while ((rc = pread(fd, tmp, sizeof(tmp), off + buf.size())) > 0)
+        buf.append(tmp, rc);
+    } else {
+      buf.resize(index.chunk_end(i) - off);
+      ssize_t rc = pread(fd, &buf[0], buf.size(), off);
+      if (rc < 0) {
+        close(fd);
+        return false;
+      }
+      buf.resize(rc);
+    }
+    std::istringstream is(buf);
+    std::ostringstream os;
+    stream.start(is, os, frus, start_time, end_time);
+    Part part{off, buf.size(), os.str()};
+    changed = changed || part.out != buf;
+    parsed.push_back(std::move(part));
+  }
+
+  std::string breadcrumb;
+  if (last) {
+    std::ostringstream os;
+    stream.log_cleared(os, frus, start_time, end_time);
+    breadcrumb = os.str();
+  }
+  replaced = false;
+  if (!changed) {
+    close(fd);
+    if (breadcrumb.empty())
+      return true;
+    int afd = open(logfile.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (afd < 0)
+      throw std::runtime_error(logfile + " open failed");
+    ssize_t rc = write(afd, breadcrumb.data(), breadcrumb.size());
+    close(afd);
+    if (rc != ssize_t(breadcrumb.size()))
+      throw std::runtime_error(logfile + " write failed");
+    return true;
+  }
+
+  std::string nfile = logfile + ".tmp";
+  int ofd = open(nfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (ofd < 0) {
+    close(fd);
+    throw std::runtime_error(nfile + " creation failed");
+  }
+  bool ok = true;
+  uint64_t at = 0;
+  for (auto& part : parsed) {
+    ok = ok && copy_range(fd, ofd, at, part.offset - at) &&
+        write(ofd, part.out.data(), part.out.size()) == ssize_t(part.out.size());
+    at = part.offset + part.len;
+  }
+  ok = ok &&
+      write(ofd, breadcrumb.data(), breadcrumb.size()) ==
+          ssize_t(breadcrumb.size());
+  close(fd);
+  if (close(ofd) || !ok) {
+    unlink(nfile.c_str());
+    throw std::runtime_error(nfile + " write failed");
+  }
+  if (rename(nfile.c_str(), logfile.c_str())) {
+    throw std::runtime_error(nfile + " renamed as " + logfile + " failed");
+  }
+  unlink(SELIndex::sidecar(logfile).c_str());
+  replaced = true;
+  return true;
+}
+
+// Parse logfile mapped in memory, if large enough to be parsed in
+// parallel.
+static bool print_mapped(
+    SELStream& stream,
+    const std::string& logfile,
+    const fru_set& frus,
+    const std::string& start_time,
+    const std::string& end_time,
+    std::ostream& os) {
+  int fd = open(logfile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) || uint64_t(st.st_size) < SELStream::parallel_min) {
+    close(fd);
+    return false;
+  }
+  // Only rotated or cleared by rename, the mapping stays as it was
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  try {
+    stream.start(static_cast<const char*>(map), st.st_size, os, frus,
+        start_time, end_time);
+  } catch (...) {
+    munmap(map, st.st_size);
+    throw;
+  }
+  munmap(map, st.st_size);
+  return true;
+}
 
 void LogUtil::print(
         const fru_set& frus,
@@ -11,6 +256,15 @@ void LogUtil::print(
       make_stream(opt_json ? FORMAT_JSON : FORMAT_PRINT);
   for (auto& logfile : logfile_list()) {
     try {
+      // Only the chunks the index cannot rule out
+      if (std::string buf;
+          read_indexed(logfile, frus, start_time, end_time, buf)) {
+        stream->start(buf.data(), buf.size(), os, frus, start_time, end_time);
+        continue;
+      }
+      if (print_mapped(*stream, logfile, frus, start_time, end_time, os)) {
+        continue;
+      }
       auto fd = std::ifstream(logfile);
       if (!fd.is_open()) {
         throw std::runtime_error(logfile + " open failed");
@@ -26,7 +280,14 @@ void LogUtil::print(
 void LogUtil::clear(const fru_set& frus, const std::string& start_time, const std::string& end_time) {
   std::unique_ptr<SELStream> stream = make_stream(FORMAT_RAW);
   const std::vector<std::string>& llist = logfile_list();
+  bool reload = false;
   for (auto& logfile : llist) {
+    if (bool replaced; clear_indexed(
+            *stream, logfile, frus, start_time, end_time,
+            logfile == llist.back(), replaced)) {
+      reload = reload || replaced;
+      continue;
+    }
     auto fd = std::ifstream(logfile);
     if (!fd.is_open()) {
       continue;
@@ -47,7 +308,12 @@ void LogUtil::clear(const fru_set& frus, const std::string& start_time, const st
     if (rename(nfile.c_str(), logfile.c_str())) {
       throw std::runtime_error(nfile + " renamed as " + logfile + " failed");
     }
+    unlink(SELIndex::sidecar(logfile).c_str());
+    reload = true;
+  }
+  // rsyslogd keeps writing into a replaced logfile until reloaded
+  if (reload) {
+    std::unique_ptr<rsyslogd> rd = make_rsyslogd();
+    rd->reload();
   }
-  std::unique_ptr<rsyslogd> rd = make_rsyslogd();
-  rd->reload();
 }
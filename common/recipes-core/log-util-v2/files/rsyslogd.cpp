@@ -1,47 +1,77 @@
 #include "rsyslogd.hpp"
+#include <dirent.h>
 #include <errno.h>
-#include <array>
-#include <cstdio>
+#include <signal.h>
+#include <cstring>
 #include <exception>
-#include <memory>
+#include <fstream>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <system_error>
 
-void rsyslogd::runcmd(const std::string& cmd, std::string& output) {
-  // 128char lines.
-  std::array<char, 128> out;
-  FILE* fp = popen(cmd.c_str(), "r");
-  if (!fp)
-    throw std::runtime_error("Cannot run: " + cmd);
-  while (fgets(out.data(), out.size(), fp) != NULL) {
-    output.append(out.data());
-  }
-  int status = pclose(fp);
-  if (status == -1) {
-    throw std::runtime_error(std::strerror(errno));
-  } else if (status > 0) {
-    throw std::runtime_error("Subprocess exited with non-zero code");
+using namespace std::literals;
+
+std::string rsyslogd::read_pidfile() {
+  std::ifstream ifs(pidfile);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+int rsyslogd::find_pid() {
+  DIR* dir = opendir("/proc");
+  if (!dir)
+    throw std::runtime_error("Cannot open /proc");
+  int found = -1;
+  while (struct dirent* ent = readdir(dir)) {
+    char* end = nullptr;
+    long p = strtol(ent->d_name, &end, 10);
+    if (p <= 0 || *end != '\0')
+      continue;
+    std::ifstream comm("/proc/"s + ent->d_name + "/comm");
+    std::string name;
+    if (std::getline(comm, name) && name == "rsyslogd") {
+      found = p;
+      break;
+    }
   }
+  closedir(dir);
+  return found;
 }
 
-void rsyslogd::runcmd(const std::string& cmd) {
-  if (system(cmd.c_str()) != 0)
-    throw std::runtime_error("Sending HUP to rsyslogd failed");
+void rsyslogd::signal(int pid, int sig) {
+  if (kill(pid, sig) != 0)
+    throw std::system_error(errno, std::generic_category(), "kill");
 }
 
 int rsyslogd::getpid(void) {
-  std::string pid;
-  runcmd("pidof rsyslogd", pid);
+  if (pid != -1)
+    return pid;
+  std::string pid_s = read_pidfile();
   static const std::regex num_regex(R"(^(\d+)[\r\n\s]*$)");
-  if (std::smatch match; std::regex_match(pid, match, num_regex)) {
-    return std::stoi(match[1]);
+  if (std::smatch match; std::regex_match(pid_s, match, num_regex)) {
+    pid = std::stoi(match[1]);
+  } else if (pid_s.empty()) {
+    // No pid file, look for it the way pidof(1) does.
+    pid = find_pid();
+    if (pid == -1)
+      throw std::runtime_error("rsyslogd is not running");
+  } else {
+    throw std::runtime_error(
+        "Non numeric PID in "s + pidfile + ": \"" + pid_s + "\"");
   }
-  throw std::runtime_error(
-      "Non numeric PID received from `pidof rsyslogd`: \"" + pid + "\"");
+  return pid;
 }
 
 void rsyslogd::reload() {
-  int pid = getpid();
-  std::string cmd = "kill -HUP " + std::to_string(pid);
-  runcmd(cmd);
+  try {
+    signal(getpid(), SIGHUP);
+  } catch (std::system_error& e) {
+    if (e.code().value() != ESRCH)
+      throw std::runtime_error("Sending HUP to rsyslogd failed");
+    // Restarted since the pid was cached.
+    pid = -1;
+    signal(getpid(), SIGHUP);
+  }
 }
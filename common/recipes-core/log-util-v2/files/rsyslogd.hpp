@@ -3,12 +3,18 @@
 
 class rsyslogd {
  private:
+  // Cached for the lifetime of the object, dropped if rsyslogd is gone.
   int pid = -1;
 
-  virtual void runcmd(const std::string& cmd);
-  virtual void runcmd(const std::string& cmd, std::string& out);
+  // Contents of the pid file, empty if there is none.
+  virtual std::string read_pidfile();
+  // PID of the process named rsyslogd from /proc, -1 if none.
+  virtual int find_pid();
+  virtual void signal(int pid, int sig);
 
  public:
+  static constexpr const char* pidfile = "/var/run/rsyslogd.pid";
+
   virtual int getpid(void);
   rsyslogd() {}
   virtual ~rsyslogd() {}
@@ -7,6 +7,8 @@
 #include <cstdio>
 #include <regex>
 #include <fstream>
+#include <algorithm>
+#include <array>
 
 using namespace std::literals;
 
@@ -73,6 +75,135 @@ void SELFormat::set_clear_timestamp(uint8_t fru, const std::string& start_time,
     set_raw(std::move(log));
 }
 
+namespace {
+
+// \s and \S of the std::regex patterns
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+      c == '\r';
+}
+
+bool is_digits(std::string_view s) {
+  return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+    return c >= '0' && c <= '9';
+  });
+}
+
+// The next whitespace separated token of line, from pos
+bool next_token(std::string_view line, size_t& pos, std::string_view& tok) {
+  while (pos < line.size() && is_space(line[pos]))
+    pos++;
+  size_t start = pos;
+  while (pos < line.size() && !is_space(line[pos]))
+    pos++;
+  tok = line.substr(start, pos - start);
+  return !tok.empty();
+}
+
+// d+:d+:d+
+bool is_clock(std::string_view s) {
+  size_t c1 = s.find(':');
+  if (c1 == std::string_view::npos)
+    return false;
+  size_t c2 = s.find(':', c1 + 1);
+  if (c2 == std::string_view::npos)
+    return false;
+  return is_digits(s.substr(0, c1)) && is_digits(s.substr(c1 + 1, c2 - c1 - 1)) &&
+      is_digits(s.substr(c2 + 1));
+}
+
+// "APP:" as matched by (\S+):\s+
+bool strip_colon(std::string_view tok, std::string_view& out) {
+  if (tok.size() < 2 || tok.back() != ':')
+    return false;
+  out = tok.substr(0, tok.size() - 1);
+  return true;
+}
+
+// Whether s has the shape of pattern at pos, where 'd' is a digit
+bool has_shape(const std::string& s, size_t pos, std::string_view pattern) {
+  if (s.size() < pos + pattern.size())
+    return false;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    char c = s[pos + i];
+    if (pattern[i] == 'd' ? !(c >= '0' && c <= '9') : c != pattern[i])
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+// The common case of log_fmt in one pass over the line: a log starting
+// (after whitespace) with the year. Whenever this accepts a line, it is
+// what the leftmost match of log_fmt captures, so anything else is left
+// to parse_regex().
+bool SELFormat::parse_tokens(const std::string& line) {
+  std::string_view l(line);
+  std::string_view year, mon, day, clock, host, sev, ver, app;
+  size_t pos = 0;
+
+  if (!next_token(l, pos, year) || year.size() != 4 || !is_digits(year))
+    return false;
+  size_t time_start = pos - year.size();
+  if (!next_token(l, pos, mon) || !next_token(l, pos, day) ||
+      !is_digits(day) || !next_token(l, pos, clock) || !is_clock(clock))
+    return false;
+  size_t time_end = pos;
+  if (!next_token(l, pos, host) || !next_token(l, pos, sev) ||
+      !next_token(l, pos, ver) || !strip_colon(ver, ver) ||
+      !next_token(l, pos, app) || !strip_colon(app, app))
+    return false;
+  while (pos < l.size() && is_space(l[pos]))
+    pos++;
+  std::string_view msg = l.substr(pos);
+  // (.+)$ needs a message, and . does not match line terminators
+  if (msg.empty() || msg.find_first_of("\r\n") != std::string_view::npos)
+    return false;
+
+  std::array<char, 256> curtime;
+  struct tm ts;
+  std::string stamp(l.substr(time_start, time_end - time_start));
+  strptime(stamp.c_str(), "%Y %b %d %H:%M:%S", &ts);
+  strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
+  time_.assign(curtime.data());
+  hostname_.assign(host);
+  version_.assign(ver);
+  app_.assign(app);
+  msg_.assign(msg);
+  bare_ = false;
+  return true;
+}
+
+bool SELFormat::parse_regex(const std::string& line) {
+  static const std::regex log_match(log_fmt.data());
+  static const std::regex log_match_legacy(log_fmt_legacy.data());
+
+  std::smatch sm;
+  if (bool year_fmt = false;
+      (year_fmt = std::regex_search(line, sm, log_match)) ||
+      std::regex_search(line, sm, log_match_legacy)) {
+    std::array<char, 256> curtime;
+    struct tm ts;
+
+    if (!year_fmt) {
+      strptime(sm[1].str().c_str(), "%b %d %H:%M:%S", &ts);
+      strftime(curtime.data(), curtime.size(), "%m-%d %H:%M:%S", &ts);
+    } else {
+      strptime(sm[1].str().c_str(), "%Y %b %d %H:%M:%S", &ts);
+      strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
+    }
+    time_.assign(curtime.data());
+    hostname_ = sm[2];
+    version_ = sm[3];
+    app_ = sm[4];
+    msg_ = sm[5];
+    bare_ = false;
+    return true;
+  }
+  return false;
+}
+
 void SELFormat::set_raw(std::string&& line) {
   self_log_ = false;
   bare_ = true;
@@ -89,10 +220,14 @@ void SELFormat::set_raw(std::string&& line) {
   } else {
     fru_num_ = default_fru_num_;
   }
-  static const std::regex find_fru_re(R"(FRU: (\d+))");
-  std::smatch find_fru_match;
-  if (regex_search(line, find_fru_match, find_fru_re)) {
-    fru_num_ = std::stoi(find_fru_match[1]);
+  // The first "FRU: (\d+)"
+  for (size_t pos = 0; (pos = line.find("FRU: ", pos)) != std::string::npos;
+       pos++) {
+    size_t num = pos + 5;
+    if (num < line.size() && line[num] >= '0' && line[num] <= '9') {
+      fru_num_ = std::stoi(line.substr(num));
+      break;
+    }
   }
   if (fru_num_ == FRU_ALL) {
     fru_ = "all";
@@ -103,75 +238,51 @@ void SELFormat::set_raw(std::string&& line) {
   } else {
     fru_ = get_fru_name(fru_num_);
   }
-  static const std::regex log_match(log_fmt.data());
-  static const std::regex log_match_legacy(log_fmt_legacy.data());
-
-  std::smatch sm;
-  if (bool year_fmt = false;
-      (year_fmt = std::regex_search(line, sm, log_match)) ||
-      std::regex_search(line, sm, log_match_legacy)) {
-    std::array<char, 256> curtime;
-    struct tm ts;
-
-    if (!year_fmt) {
-      strptime(sm[1].str().c_str(), "%b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%m-%d %H:%M:%S", &ts);
-    } else {
-      strptime(sm[1].str().c_str(), "%Y %b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
-    }
-    time_.assign(curtime.data());
-    hostname_ = sm[2];
-    version_ = sm[3];
-    app_ = sm[4];
-    msg_ = sm[5];
-    bare_ = false;
+  if (!parse_tokens(line)) {
+    parse_regex(line);
   }
 }
 
-bool SELFormat::fits_time_range(const std::string& start_time, const std::string& end_time) {
-  time_t time_s, time_e, time_c;
-  std::smatch sm;
-
-  // construct the regexes
+// As searching time_fmt then time_fmt_legacy in s, but without the regex
+// for what a time of time_ or a command line usually is.
+bool SELFormat::parse_time(const std::string& s, time_t& t) {
   static const std::regex time_match(time_fmt.data());
   static const std::regex time_match_legacy(time_fmt_legacy.data());
+  std::smatch sm;
+  std::string stamp;
+  const char* fmt;
 
-  // not expecting both of these strings to be in the same format just in case
-  if (std::regex_search(start_time, sm, time_match)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
-  } else if (std::regex_search(start_time, sm, time_match_legacy)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
+  if (has_shape(s, 0, "dddd-dd-dd dd:dd:dd")) {
+    stamp = s.substr(0, 19);
+    fmt = "%Y-%m-%d %H:%M:%S";
+  } else if (s.size() == 14 && has_shape(s, 0, "dd-dd dd:dd:dd")) {
+    // Too short for time_fmt
+    stamp = s;
+    fmt = "%m-%d %H:%M:%S";
+  } else if (std::regex_search(s, sm, time_match)) {
+    stamp = sm[0].str();
+    fmt = "%Y-%m-%d %H:%M:%S";
+  } else if (std::regex_search(s, sm, time_match_legacy)) {
+    stamp = sm[0].str();
+    fmt = "%m-%d %H:%M:%S";
   } else {
     return false;
   }
+  // strptime() leaves tm_isdst alone, let mktime() work it out
+  std::tm ts{};
+  ts.tm_isdst = -1;
+  strptime(stamp.c_str(), fmt, &ts);
+  t = std::mktime(&ts);
+  return true;
+}
 
-  if (std::regex_search(end_time, sm, time_match)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
-  } else if (std::regex_search(end_time, sm, time_match_legacy)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
-  } else {
-    return false;
-  }
+bool SELFormat::fits_time_range(const std::string& start_time, const std::string& end_time) {
+  time_t time_s, time_e, time_c;
 
+  // not expecting both of these strings to be in the same format just in case
   // time_ is stored in a different format than displayed from what I can tell
-  if (std::regex_search(time_, sm, time_match)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
-  } else if (std::regex_search(time_, sm, time_match_legacy)) {
-    std::tm ts;
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
-  } else {
+  if (!parse_time(start_time, time_s) || !parse_time(end_time, time_e) ||
+      !parse_time(time_, time_c)) {
     return false;
   }
 
@@ -220,17 +331,3 @@ std::ostream& operator<<(std::ostream& os, const SELFormat& s) {
   os << s.str() << '\n';
   return os;
 }
-
-std::string get_output(const std::string& cmd) {
-  char buffer[128];
-  std::string output;
-  std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-  if (!pipe) {
-    std::cerr << "Failed to open a pipe" << std::endl;
-    return "Error";
-  }
-  while (fgets(buffer, 128, pipe.get()) != NULL) {
-    output += buffer;
-  }
-  return output;
-}
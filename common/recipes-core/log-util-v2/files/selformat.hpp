@@ -3,6 +3,7 @@
 #include <set>
 #include <string>
 #include <string_view>
+#include <ctime>
 
 using fru_set = std::set<uint8_t>;
 
@@ -71,6 +72,14 @@ class SELFormat {
   }
 
   bool fits_time_range(const std::string& start_time, const std::string& end_time);
+  // A time of time_, or the range of fits_time_range(), as it compares them
+  static bool parse_time(const std::string& s, time_t& t);
+
+ protected:
+  // Parse the fields of the log line: the common format by hand, or
+  // log_fmt/log_fmt_legacy. Returns false if the line is bare.
+  bool parse_tokens(const std::string& line);
+  bool parse_regex(const std::string& line);
 
  private:
   bool bare_ = true;
@@ -123,4 +132,3 @@ class SELFormat {
 void to_json(nlohmann::json& j, const SELFormat& sel);
 std::istream& operator>>(std::istream& is, SELFormat& s);
 std::ostream& operator<<(std::ostream& os, const SELFormat& s);
-std::string get_output(const std::string& cmd);
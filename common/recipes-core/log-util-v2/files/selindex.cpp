@@ -0,0 +1,260 @@
+#include "selindex.hpp"
+#include "selexception.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char index_magic[8] = {'S', 'E', 'L', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32_t index_version = 2;
+// Leading bytes of the logfile that must stay the same
+constexpr uint64_t signature_len = 4096;
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_chunks;
+  uint64_t inode;
+  uint64_t indexed;
+  uint64_t signature;
+  int64_t tz_probe[2];
+};
+
+// Parses as SELStream does, without looking FRU names up
+class IndexSELFormat : public SELFormat {
+ public:
+  IndexSELFormat() : SELFormat(SELFormat::FRU_ALL) {}
+  std::string get_fru_name(uint8_t) override {
+    return "";
+  }
+};
+
+bool read_full(int fd, void* buf, size_t len, uint64_t off) {
+  uint8_t* p = static_cast<uint8_t*>(buf);
+  while (len > 0) {
+    ssize_t rc = pread(fd, p, len, off);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+      return false;
+    p += rc;
+    len -= rc;
+    off += rc;
+  }
+  return true;
+}
+
+} // namespace
+
+SELIndex::SELIndex(const std::string& logfile)
+    : logfile_(logfile), sidecar_(sidecar(logfile)) {}
+
+std::string SELIndex::sidecar(const std::string& logfile) {
+  size_t slash = logfile.rfind('/');
+  if (slash == std::string::npos)
+    return "." + logfile + ".idx";
+  return logfile.substr(0, slash + 1) + "." + logfile.substr(slash + 1) +
+      ".idx";
+}
+
+// The times of the index depend on the time zone of mktime()
+std::array<int64_t, 2> SELIndex::probe_tz() {
+  std::array<int64_t, 2> probe{};
+  time_t t;
+  if (SELFormat::parse_time("2020-01-01 00:00:00", t))
+    probe[0] = t;
+  if (SELFormat::parse_time("2020-07-01 00:00:00", t))
+    probe[1] = t;
+  return probe;
+}
+
+uint64_t SELIndex::signature(int fd, uint64_t len) const {
+  std::vector<uint8_t> buf(std::min(len, signature_len));
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  if (!read_full(fd, buf.data(), buf.size(), 0))
+    return 0;
+  for (uint8_t b : buf) {
+    hash = (hash ^ b) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool SELIndex::load() {
+  IndexHeader hdr;
+  int fd = open(sidecar_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  bool ok = read_full(fd, &hdr, sizeof(hdr), 0) &&
+      !memcmp(hdr.magic, index_magic, sizeof(index_magic)) &&
+      hdr.version == index_version;
+  if (ok) {
+    chunks_.resize(hdr.num_chunks);
+    ok = read_full(fd, chunks_.data(), chunks_.size() * sizeof(Chunk), sizeof(hdr));
+  }
+  close(fd);
+  if (!ok) {
+    chunks_.clear();
+    return false;
+  }
+  inode_ = hdr.inode;
+  indexed_ = hdr.indexed;
+  signature_ = hdr.signature;
+  tz_probe_ = {hdr.tz_probe[0], hdr.tz_probe[1]};
+  return true;
+}
+
+void SELIndex::save() const {
+  IndexHeader hdr{};
+  std::string tmp = sidecar_ + ".tmp";
+
+  memcpy(hdr.magic, index_magic, sizeof(index_magic));
+  hdr.version = index_version;
+  hdr.num_chunks = chunks_.size();
+  hdr.inode = inode_;
+  hdr.indexed = indexed_;
+  hdr.signature = signature_;
+  hdr.tz_probe[0] = tz_probe_[0];
+  hdr.tz_probe[1] = tz_probe_[1];
+
+  // Best effort: without the sidecar, the next query indexes again
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  bool ok = write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr);
+  size_t len = chunks_.size() * sizeof(Chunk);
+  ok = ok && write(fd, chunks_.data(), len) == (ssize_t)len;
+  close(fd);
+  if (!ok || rename(tmp.c_str(), sidecar_.c_str()))
+    unlink(tmp.c_str());
+}
+
+// Index the complete lines from the offset from (the start of the file
+// or of a chunk) on, after the chunks before it
+bool SELIndex::index_from(int fd, uint64_t from) {
+  std::string data(size_ - from, '\0');
+  IndexSELFormat sel;
+  size_t pos = 0, nl;
+
+  if (!read_full(fd, data.data(), data.size(), from))
+    return false;
+  while ((nl = data.find('\n', pos)) != std::string::npos) {
+    uint64_t off = from + pos;
+    std::string line = data.substr(pos, nl - pos);
+    pos = nl + 1;
+
+    if (off == from)
+      chunks_.push_back(Chunk{off, 0, 0, 0, {}});
+    if (line.find('\0') != std::string::npos) {
+      chunks_.back().flags |= HAS_INVALID;
+      line.erase(std::remove(line.begin(), line.end(), '\0'), line.end());
+    }
+    try {
+      sel.set_raw(std::move(line));
+    } catch (SELException&) {
+      chunks_.back().flags |= HAS_INVALID;
+      continue;
+    }
+    if (!sel.is_bare() && !sel.is_self() &&
+        off - chunks_.back().offset >= chunk_size)
+      chunks_.push_back(Chunk{off, 0, 0, 0, {}});
+
+    Chunk& c = chunks_.back();
+    time_t t;
+    if (SELFormat::parse_time(sel.time_stamp(), t)) {
+      if (!(c.flags & HAS_TIME)) {
+        c.tmin = c.tmax = t;
+        c.flags |= HAS_TIME;
+      } else {
+        c.tmin = std::min<int64_t>(c.tmin, t);
+        c.tmax = std::max<int64_t>(c.tmax, t);
+      }
+    }
+    c.frus[sel.fru_id() / 8] |= 1 << (sel.fru_id() % 8);
+    if (sel.fru_name() == "sys")
+      c.flags |= HAS_SYS;
+    // Under FRU_SYS, these would be "sys" lines
+    if (!sel.is_self() && sel.fru_name() == "all")
+      c.flags |= HAS_DEFAULT;
+  }
+  indexed_ = from + pos;
+  return true;
+}
+
+bool SELIndex::update() {
+  struct stat st;
+  int fd = open(logfile_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return false;
+  }
+  size_ = st.st_size;
+
+  uint64_t from = 0;
+  std::array<int64_t, 2> tz = probe_tz();
+  bool valid = load() && inode_ == (uint64_t)st.st_ino && size_ >= indexed_ &&
+      tz_probe_ == tz && signature(fd, indexed_) == signature_;
+  if (valid && size_ == indexed_) {
+    close(fd);
+    return true;
+  }
+  if (valid && !chunks_.empty()) {
+    // The last chunk may go on in the appended lines
+    from = chunks_.back().offset;
+    chunks_.pop_back();
+  } else {
+    chunks_.clear();
+  }
+
+  inode_ = st.st_ino;
+  tz_probe_ = tz;
+  bool ok = index_from(fd, from);
+  if (ok) {
+    signature_ = signature(fd, indexed_);
+    save();
+  } else {
+    chunks_.clear();
+  }
+  close(fd);
+  return ok;
+}
+
+bool SELIndex::may_match(size_t i, const fru_set& frus, bool timed,
+                         time_t start, time_t end) const {
+  const Chunk& c = chunks_[i];
+
+  if (timed && (!(c.flags & HAS_TIME) || c.tmax < start || c.tmin > end))
+    return false;
+  if (frus.count(SELFormat::FRU_ALL) ||
+      (frus.count(SELFormat::FRU_SYS) && (c.flags & (HAS_SYS | HAS_DEFAULT))))
+    return true;
+  return std::any_of(frus.begin(), frus.end(), [&c](uint8_t f) {
+    return c.frus[f / 8] & (1 << (f % 8));
+  });
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> SELIndex::ranges(
+    const fru_set& frus, bool timed, time_t start, time_t end) const {
+  std::vector<std::pair<uint64_t, uint64_t>> out;
+
+  if (chunks_.empty()) {
+    if (size_ > 0)
+      out.emplace_back(0, size_);
+    return out;
+  }
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    if (!may_match(i, frus, timed, start, end))
+      continue;
+    if (!out.empty() && out.back().second == chunks_[i].offset)
+      out.back().second = chunk_end(i);
+    else
+      out.emplace_back(chunks_[i].offset, chunk_end(i));
+  }
+  return out;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "selformat.hpp"
+
+// Sidecar index of a logfile (.<logfile>.idx next to it) for the time
+// range and FRU filters of LogUtil::print. The file is split into chunks
+// of about chunk_size bytes, each starting at a line that fully sets the
+// state of a SELFormat (parsed, not a log-util line), so a chunk parses
+// the same wherever reading starts. Every chunk records the range of
+// times and the FRUs its lines filter on.
+//
+// The index follows the logfile: appended lines are indexed on the next
+// update(), a rotated, cleared or otherwise rewritten file (another inode,
+// shorter, or other leading bytes) is indexed again from the start.
+class SELIndex {
+ public:
+  static constexpr size_t chunk_size = 4096;
+
+  struct Chunk {
+    uint64_t offset;
+    int64_t tmin;
+    int64_t tmax;
+    uint8_t flags;
+    // fru_id() of the lines
+    std::array<uint8_t, 32> frus;
+  };
+  // Chunk flags
+  static constexpr uint8_t HAS_TIME = 1;    // tmin/tmax are set
+  static constexpr uint8_t HAS_SYS = 2;     // a line of FRU "sys"
+  static constexpr uint8_t HAS_DEFAULT = 4; // a line of the default FRU
+  static constexpr uint8_t HAS_INVALID = 8; // a line clear() drops or edits
+
+  explicit SELIndex(const std::string& logfile);
+  virtual ~SELIndex() {}
+
+  static std::string sidecar(const std::string& logfile);
+
+  // Bring the index up to date with the logfile, saving the sidecar if it
+  // changed. Returns false if the logfile cannot be read.
+  bool update();
+
+  // The byte ranges [first, second) of the logfile holding every line that
+  // SELStream could output for the filter; with times only if timed.
+  std::vector<std::pair<uint64_t, uint64_t>>
+  ranges(const fru_set& frus, bool timed, time_t start, time_t end) const;
+
+  // Whether chunk i can hold a line SELStream outputs (or clears) for the
+  // filter, and where it ends
+  bool may_match(size_t i, const fru_set& frus, bool timed, time_t start,
+                 time_t end) const;
+  uint64_t chunk_end(size_t i) const {
+    // The last chunk takes any line still being written too
+    return i + 1 < chunks_.size() ? chunks_[i + 1].offset : size_;
+  }
+
+  const std::vector<Chunk>& chunks() const {
+    return chunks_;
+  }
+  uint64_t file_size() const {
+    return size_;
+  }
+
+ private:
+  std::string logfile_;
+  std::string sidecar_;
+  uint64_t inode_ = 0;
+  uint64_t size_ = 0;
+  uint64_t indexed_ = 0;
+  uint64_t signature_ = 0;
+  std::array<int64_t, 2> tz_probe_{};
+  std::vector<Chunk> chunks_;
+
+  static std::array<int64_t, 2> probe_tz();
+  bool load();
+  void save() const;
+  uint64_t signature(int fd, uint64_t len) const;
+  bool index_from(int fd, uint64_t from);
+};
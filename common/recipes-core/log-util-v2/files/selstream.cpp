@@ -1,12 +1,35 @@
 #include "selstream.hpp"
 #include "selexception.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <thread>
+
+void SELStream::write_json(std::ostream& os, const nlohmann::json& j) {
+  static const std::string indent(8, ' ');
+  std::string rec = j.dump(4);
+
+  os << (json_records_++ ? ",\n" : "{\n    \"Logs\": [\n") << indent;
+  // Strings are escaped, every newline is of the layout
+  for (size_t pos = 0, nl; pos < rec.size(); pos = nl + 1) {
+    nl = rec.find('\n', pos);
+    if (nl == std::string::npos) {
+      os.write(rec.data() + pos, rec.size() - pos);
+      break;
+    }
+    os.write(rec.data() + pos, nl - pos + 1);
+    os << indent;
+  }
+}
 
 void SELStream::flush(std::ostream& os) {
   if (fmt_ == FORMAT_JSON) {
-    nlohmann::json j;
-    j["Logs"] = sel_list_;
-    os << j.dump(4) << '\n';
+    if (json_records_) {
+      os << "\n    ]\n}\n";
+    } else {
+      os << "{\n    \"Logs\": []\n}\n";
+    }
+    json_records_ = 0;
   }
   os.flush();
 }
@@ -15,6 +38,25 @@ std::unique_ptr<SELFormat> SELStream::make_sel(uint8_t default_fru) {
   return std::make_unique<SELFormat>(default_fru);
 }
 
+bool SELStream::selected(
+    SELFormat& sel,
+    const fru_set& filter_fru,
+    const std::string& start_time,
+    const std::string& end_time) {
+  if (fmt_ == FORMAT_JSON && sel.is_bare()) {
+    // RAW is used by clear and we filter out all previous
+    // logs injected by this utility.
+    // We do not send this as JSON format as well.
+    return false;
+  }
+  bool blacklist = fmt_ == FORMAT_RAW;
+  bool timestamp = !(start_time.empty() || end_time.empty());
+  if (timestamp) {
+    return (sel.fru_matches(filter_fru) && sel.fits_time_range(start_time, end_time)) ^ blacklist;
+  }
+  return sel.fru_matches(filter_fru) ^ blacklist;
+}
+
 void SELStream::start(
     std::istream& is,
     std::ostream& os,
@@ -30,28 +72,12 @@ void SELStream::start(
     try {
       if (!(is >> *sel))
         break;
-      if (fmt_ == FORMAT_JSON && sel->is_bare()) {
-        // RAW is used by clear and we filter out all previous
-        // logs injected by this utility.
-        // We do not send this as JSON format as well.
+      if (!selected(*sel, filter_fru, start_time, end_time))
         continue;
-      }
-      bool blacklist = fmt_ == FORMAT_RAW;
-      bool timestamp = !(start_time.empty() || end_time.empty());
-      if (timestamp) {
-          if (!((sel->fru_matches(filter_fru) && sel->fits_time_range(start_time, end_time)) ^ blacklist)) {
-            continue;
-          }
-      } else {
-          if (!(sel->fru_matches(filter_fru) ^ blacklist)) {
-            continue;
-          }
-      }
       if (fmt_ == FORMAT_RAW)
         sel->force_bare();
       if (fmt_ == FORMAT_JSON) {
-        nlohmann::json j(*sel);
-        sel_list_.push_back(j);
+        write_json(os, nlohmann::json(*sel));
       } else {
         os << *sel;
       }
@@ -64,6 +90,101 @@ void SELStream::start(
   } while (!is.eof());
 }
 
+void SELStream::parse(
+    const char* p,
+    const char* end,
+    Part& out,
+    const fru_set& filter_fru,
+    const std::string& start_time,
+    const std::string& end_time,
+    const ParserFlag flag) {
+  uint8_t default_fru_id = filter_fru.count(SELFormat::FRU_SYS) > 0
+      ? SELFormat::FRU_SYS
+      : SELFormat::FRU_ALL;
+  std::unique_ptr<SELFormat> sel = make_sel(default_fru_id);
+
+  // Most of a logfile is selected by a print, and lines are ~120 bytes
+  if (fmt_ == FORMAT_JSON)
+    out.records.reserve((end - p) / 128);
+  else
+    out.text.reserve(end - p);
+  while (p < end) {
+    const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    const char* eol = nl ? nl : end;
+    // One allocation per line, kept by the SELFormat
+    std::string line(p, eol);
+    p = nl ? nl + 1 : end;
+    line.erase(std::remove(line.begin(), line.end(), '\0'), line.end());
+    try {
+      sel->set_raw(std::move(line));
+      if (!selected(*sel, filter_fru, start_time, end_time))
+        continue;
+      if (fmt_ == FORMAT_RAW)
+        sel->force_bare();
+      if (fmt_ == FORMAT_JSON) {
+        out.records.emplace_back(*sel);
+      } else {
+        out.text += sel->str();
+        out.text += '\n';
+      }
+    } catch (SELException &e) {
+      if (flag & PARSE_STOP_ON_ERR) {
+        out.error = e.what();
+        break;
+      }
+    }
+  }
+}
+
+void SELStream::start(
+    const char* data,
+    size_t len,
+    std::ostream& os,
+    const fru_set& filter_fru,
+    const std::string& start_time,
+    const std::string& end_time,
+    const ParserFlag flag) {
+  size_t jobs = 1;
+  if (len >= parallel_min)
+    jobs = std::min<size_t>(
+        {max_jobs, len / (parallel_min / 2),
+         std::max(1u, std::thread::hardware_concurrency())});
+
+  // Parts begin after a newline, and end before the next part
+  std::vector<const char*> bounds{data};
+  const char* end = data + len;
+  for (size_t i = 1; i < jobs; i++) {
+    const char* p = std::max(data + len * i / jobs, bounds.back());
+    const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    bounds.push_back(nl ? nl + 1 : end);
+  }
+  bounds.push_back(end);
+
+  std::vector<Part> parts(jobs);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < jobs; i++) {
+    workers.emplace_back(&SELStream::parse, this, bounds[i], bounds[i + 1],
+        std::ref(parts[i]), std::cref(filter_fru), std::cref(start_time),
+        std::cref(end_time), flag);
+  }
+  parse(bounds[0], bounds[1], parts[0], filter_fru, start_time, end_time, flag);
+  for (auto& w : workers)
+    w.join();
+
+  for (auto& part : parts) {
+    if (fmt_ == FORMAT_JSON) {
+      for (auto& j : part.records)
+        write_json(os, j);
+    } else {
+      os.write(part.text.data(), part.text.size());
+    }
+    if (!part.error.empty()) {
+      std::cerr << "[ERR] " << part.error << std::endl;
+      break;
+    }
+  }
+}
+
 void SELStream::log_cleared(std::ostream& os,
         const fru_set& affected_frus,
         const std::string& start_time,
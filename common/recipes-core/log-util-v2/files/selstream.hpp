@@ -1,6 +1,7 @@
 #pragma once
 #include <iostream>
 #include <memory>
+#include <vector>
 #include "selformat.hpp"
 
 enum OutputFormat { FORMAT_PRINT, FORMAT_RAW, FORMAT_JSON };
@@ -9,15 +10,39 @@ enum ParserFlag {
   PARSE_STOP_ON_ERR = 1,
 };
 class SELStream {
-  nlohmann::json sel_list_ = nlohmann::json::array();
+  // JSON records are written as they are parsed, inside {"Logs": [...]}
+  // laid out as json::dump(4) would the whole object.
+  size_t json_records_ = 0;
   OutputFormat fmt_;
 
+  // Output of a part of a logfile parsed by start(data, len), which the
+  // errors of PARSE_STOP_ON_ERR end.
+  struct Part {
+    std::string text;
+    std::vector<nlohmann::json> records;
+    std::string error;
+  };
+
+  void write_json(std::ostream& os, const nlohmann::json& j);
+  bool selected(SELFormat& sel, const fru_set& filter_fru,
+          const std::string& start_time, const std::string& end_time);
+  void parse(const char* p, const char* end, Part& out, const fru_set& filter_fru,
+          const std::string& start_time, const std::string& end_time, const ParserFlag flag);
+
  public:
+  // Logfiles parsed by more than one thread by start(data, len)
+  static constexpr size_t parallel_min = 64 * 1024;
+  static constexpr size_t max_jobs = 4;
+
   SELStream(OutputFormat fmt) : fmt_(fmt) {}
   virtual ~SELStream() {}
   void flush(std::ostream& os);
   virtual std::unique_ptr<SELFormat> make_sel(uint8_t default_fru);
   void start(std::istream& is, std::ostream& os, const fru_set& filter_fru,
           const std::string& start_time, const std::string& end_time, const ParserFlag flag = PARSE_ALL);
+  // As start(), on a logfile in memory. Large ones are split into line
+  // aligned parts parsed in parallel, their output written in order.
+  void start(const char* data, size_t len, std::ostream& os, const fru_set& filter_fru,
+          const std::string& start_time, const std::string& end_time, const ParserFlag flag = PARSE_ALL);
   void log_cleared(std::ostream& os, const fru_set& affected_frus, const std::string& start_time, const std::string& end_time);
 };
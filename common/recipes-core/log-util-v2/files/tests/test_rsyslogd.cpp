@@ -1,5 +1,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <signal.h>
+#include <system_error>
 #include "rsyslogd.hpp"
 
 using namespace std;
@@ -9,30 +11,62 @@ class MockRsyslogd : public rsyslogd {
  public:
   MockRsyslogd() : rsyslogd() {}
   MOCK_METHOD0(getpid, int());
-  MOCK_METHOD1(runcmd, void(const std::string&));
-  MOCK_METHOD2(runcmd, void(const std::string&, std::string&));
+  MOCK_METHOD0(read_pidfile, std::string());
+  MOCK_METHOD0(find_pid, int());
+  MOCK_METHOD2(signal, void(int, int));
 };
 
 TEST(rsyslogdTest, BasicCallTest) {
   MockRsyslogd r;
   EXPECT_CALL(r, getpid()).Times(1).WillOnce(Return(42));
-  EXPECT_CALL(r, runcmd("kill -HUP 42")).Times(1);
+  EXPECT_CALL(r, signal(42, SIGHUP)).Times(1);
   r.reload();
 }
 
 class Mock2Rsyslogd : public rsyslogd {
  public:
   Mock2Rsyslogd() : rsyslogd() {}
-  MOCK_METHOD1(runcmd, void(const std::string&));
-  MOCK_METHOD2(runcmd, void(const std::string&, std::string&));
+  MOCK_METHOD0(read_pidfile, std::string());
+  MOCK_METHOD0(find_pid, int());
+  MOCK_METHOD2(signal, void(int, int));
 };
 
 TEST(rsyslogdTest, FullCallTest) {
   Mock2Rsyslogd r;
-  // EXPECT_CALL(r, getpid()).WillOnce([&r]() {return r.rsyslogd::getpid();});
-  EXPECT_CALL(r, runcmd("pidof rsyslogd", _))
-      .Times(1)
-      .WillRepeatedly(SetArgReferee<1>("42"));
-  EXPECT_CALL(r, runcmd("kill -HUP 42")).Times(1);
+  EXPECT_CALL(r, read_pidfile()).Times(1).WillOnce(Return("42\n"));
+  EXPECT_CALL(r, find_pid()).Times(0);
+  EXPECT_CALL(r, signal(42, SIGHUP)).Times(2);
+  r.reload();
+  // The pid is cached
+  r.reload();
+}
+
+TEST(rsyslogdTest, NoPidFile) {
+  Mock2Rsyslogd r;
+  EXPECT_CALL(r, read_pidfile()).Times(1).WillOnce(Return(""));
+  EXPECT_CALL(r, find_pid()).Times(1).WillOnce(Return(43));
+  EXPECT_CALL(r, signal(43, SIGHUP)).Times(1);
+  r.reload();
+}
+
+TEST(rsyslogdTest, BadPidFile) {
+  Mock2Rsyslogd r;
+  EXPECT_CALL(r, read_pidfile()).Times(1).WillOnce(Return("abc\n"));
+  EXPECT_CALL(r, signal(_, _)).Times(0);
+  EXPECT_THROW(r.reload(), std::runtime_error);
+}
+
+TEST(rsyslogdTest, Restarted) {
+  Mock2Rsyslogd r;
+  EXPECT_CALL(r, read_pidfile())
+      .Times(2)
+      .WillOnce(Return("42\n"))
+      .WillOnce(Return("44\n"));
+  EXPECT_CALL(r, signal(42, SIGHUP))
+      .Times(2)
+      .WillOnce(Return())
+      .WillOnce(Throw(std::system_error(ESRCH, std::generic_category())));
+  EXPECT_CALL(r, signal(44, SIGHUP)).Times(1);
+  r.reload();
   r.reload();
 }
@@ -1,5 +1,6 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <chrono>
 #include "selformat.hpp"
 
 // NOTE:
@@ -190,3 +191,67 @@ TEST(SELFormat, TimestampCompare) {
 }
 
 
+
+class ParserSELFormat : public SELFormat {
+ public:
+  ParserSELFormat() : SELFormat(SELFormat::FRU_ALL) {}
+  using SELFormat::parse_regex;
+  using SELFormat::parse_tokens;
+  std::string get_fru_name(uint8_t) override {
+    return "fru";
+  }
+  std::string fields() const {
+    return time_stamp() + "|" + hostname() + "|" + version() + "|" + app() +
+        "|" + msg();
+  }
+};
+
+static vector<string> parser_corpus() {
+  vector<string> lines = {
+      " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - caused by reboot command",
+      "2020 May  8 10:18:37 bmc-oob. user.crit fbtp-v2020.1: ncsid: FRU: 2 NIC AEN Supported: 0x7",
+      "2021\tJan 1 00:00:01\tbmc user.crit v1:x: app: message with  spaces ",
+      "May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d: healthd: legacy log",
+      "12020 May 18 10:18:40 bmc user.crit ver: app: five digit year",
+      "2020 May 18 10:18:40 log-util: User cleared FRU: 2 logs",
+      "2020 May 18 10:18:40 bmc user.crit ver: app:   ",
+      "2020 May 18 10:18:40 bmc user.crit ver: app: CR\r",
+      "2020 May 18 10:18:40 bmc user.crit ver app: no colon",
+      "x 2020 May 18 10:18:40 bmc user.crit ver: app: prefixed",
+      "2020 May 18 10:18 bmc user.crit ver: app: short clock",
+      "2020 May 18 10:18:40 bmc user.crit ver: : empty app",
+  };
+  return lines;
+}
+
+// The hand written parser must agree with the regex wherever it accepts
+// a line; report the time of both over a log sized workload.
+TEST(SELFormat, TokenParserMatchesRegex) {
+  ParserSELFormat tok, re;
+  vector<string> lines = parser_corpus();
+
+  for (auto& line : lines) {
+    bool tok_ok = tok.parse_tokens(line);
+    bool re_ok = re.parse_regex(line);
+    if (tok_ok) {
+      EXPECT_TRUE(re_ok) << line;
+      EXPECT_EQ(tok.fields(), re.fields()) << line;
+    }
+  }
+  EXPECT_TRUE(tok.parse_tokens(lines[0]));
+  EXPECT_FALSE(tok.parse_tokens(lines[3]));
+
+  constexpr int num = 50000;
+  auto bench = [&](bool (ParserSELFormat::*parse)(const std::string&)) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < num; i++) {
+      (tok.*parse)(lines[i % 2]);
+    }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start)
+        .count();
+  };
+  double tok_ms = bench(&ParserSELFormat::parse_tokens);
+  double re_ms = bench(&ParserSELFormat::parse_regex);
+  cout << num << " lines: tokens " << tok_ms << " ms, regex " << re_ms
+       << " ms" << endl;
+}
@@ -0,0 +1,193 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "log-util.hpp"
+#include "selindex.hpp"
+
+using namespace std;
+using namespace testing;
+
+class CountRsyslog : public rsyslogd {
+  int& reloads_;
+
+ public:
+  explicit CountRsyslog(int& reloads) : reloads_(reloads) {}
+  void reload() override {
+    reloads_++;
+  }
+};
+
+class IndexLogUtil : public LogUtil {
+  const std::vector<std::string> logfiles = {"./idx_logfile"};
+
+ public:
+  int reloads = 0;
+  const std::vector<std::string>& logfile_list() override {
+    return logfiles;
+  }
+  std::unique_ptr<rsyslogd> make_rsyslogd() override {
+    return std::make_unique<CountRsyslog>(reloads);
+  }
+};
+
+class SELIndexTest : public ::testing::Test {
+ protected:
+  const string logfile = "./idx_logfile";
+
+  // Days of May 2020 with FRUs 1-4, sys, log-util and malformed lines
+  void append(int first_day, int days) {
+    ofstream ofs(logfile, ios::app);
+    for (int d = first_day; d < first_day + days; d++) {
+      for (int i = 0; i < 40; i++) {
+        ofs << " 2020 May " << (d < 10 ? " " : "") << d << " 10:"
+            << 10 + i << ":40 bmc-oob. user.crit fbtp-v2020.09.1: ";
+        if (i % 5 == 0)
+          ofs << "healthd: BMC Reboot detected - caused by reboot command\n";
+        else
+          ofs << "sensord: ASSERT: Upper Critical threshold - FRU: "
+              << i % 5 << ", num: 0xC0 curr_val: 88.00 C\n";
+        if (i % 13 == 0)
+          ofs << "2020 May " << d << " 10:11:00 log-util: User cleared FRU: 3 logs\n";
+        if (i % 17 == 0)
+          ofs << "May " << d << " 11:00:00 bmc-oob. user.info v1: x: no crit\n";
+      }
+    }
+  }
+
+  string print_direct(const fru_set& frus, const string& s, const string& e) {
+    stringstream out;
+    SELStream stream(FORMAT_PRINT);
+    ifstream ifs(logfile);
+    stream.start(ifs, out, frus, s, e);
+    stream.flush(out);
+    return out.str();
+  }
+
+  string print_indexed(const fru_set& frus, const string& s, const string& e) {
+    stringstream out;
+    IndexLogUtil util;
+    util.print(frus, s, e, false, out);
+    return out.str();
+  }
+
+  void expect_same() {
+    const vector<fru_set> fru_sets = {
+        {SELFormat::FRU_ALL}, {1}, {2, 4}, {3}, {SELFormat::FRU_SYS}};
+    const vector<pair<string, string>> windows = {
+        {"", ""},
+        {"2020-05-03 00:00:00", "2020-05-03 23:59:59"},
+        {"2020-05-10 10:20:00", "2020-05-10 10:30:00"},
+        {"2020-06-01 00:00:00", "2020-06-02 00:00:00"},
+        {"2020-05-01 00:00:00", "2020-05-31 00:00:00"},
+    };
+    for (auto& frus : fru_sets) {
+      for (auto& w : windows) {
+        EXPECT_EQ(print_indexed(frus, w.first, w.second),
+                  print_direct(frus, w.first, w.second))
+            << *frus.begin() << " " << w.first;
+      }
+    }
+  }
+
+  void TearDown() {
+    remove(logfile.c_str());
+    remove(SELIndex::sidecar(logfile).c_str());
+  }
+};
+
+TEST_F(SELIndexTest, Chunks) {
+  append(1, 10);
+  SELIndex index(logfile);
+  ASSERT_TRUE(index.update());
+  ASSERT_GT(index.chunks().size(), 4);
+  EXPECT_EQ(index.chunks()[0].offset, 0);
+
+  time_t s, e;
+  ASSERT_TRUE(SELFormat::parse_time("2020-05-03 00:00:00", s));
+  ASSERT_TRUE(SELFormat::parse_time("2020-05-03 23:59:59", e));
+  auto ranges = index.ranges({SELFormat::FRU_ALL}, true, s, e);
+  ASSERT_EQ(ranges.size(), 1);
+  EXPECT_LT(ranges[0].second - ranges[0].first, index.file_size() / 4);
+
+  // Kept in the sidecar
+  SELIndex loaded(logfile);
+  ASSERT_TRUE(loaded.update());
+  EXPECT_EQ(loaded.chunks().size(), index.chunks().size());
+}
+
+TEST_F(SELIndexTest, SameOutput) {
+  append(1, 10);
+  expect_same();
+}
+
+TEST_F(SELIndexTest, AppendAndRewrite) {
+  append(1, 10);
+  expect_same();
+  // Indexed incrementally
+  append(11, 5);
+  expect_same();
+  // Rewritten shorter (rotated or cleared)
+  remove(logfile.c_str());
+  append(20, 6);
+  expect_same();
+}
+
+// What clear leaves, the breadcrumb (timed) aside
+static string cleared(const string& text) {
+  stringstream in(text), out;
+  for (string line; getline(in, line);) {
+    if (line.find("log-util: User cleared") == string::npos ||
+        line.find("2020 May") == 0)
+      out << line << '\n';
+  }
+  return out.str();
+}
+
+TEST_F(SELIndexTest, ClearSameAsRewrite) {
+  const vector<fru_set> fru_sets = {{1}, {2, 4}, {SELFormat::FRU_SYS}};
+  const vector<pair<string, string>> windows = {
+      {"", ""},
+      {"2020-05-03 00:00:00", "2020-05-03 23:59:59"},
+      {"2020-06-01 00:00:00", "2020-06-02 00:00:00"},
+  };
+  for (auto& frus : fru_sets) {
+    for (auto& w : windows) {
+      remove(logfile.c_str());
+      append(1, 10);
+      stringstream exp;
+      {
+        SELStream stream(FORMAT_RAW);
+        ifstream ifs(logfile);
+        stream.start(ifs, exp, frus, w.first, w.second);
+      }
+      IndexLogUtil util;
+      util.clear(frus, w.first, w.second);
+      ifstream ifs(logfile);
+      stringstream got;
+      got << ifs.rdbuf();
+      EXPECT_EQ(cleared(got.str()), cleared(exp.str()))
+          << *frus.begin() << " " << w.first;
+      EXPECT_EQ(util.reloads, 1);
+    }
+  }
+}
+
+TEST_F(SELIndexTest, ClearNothingAppends) {
+  append(1, 10);
+  // Drops the malformed lines
+  IndexLogUtil first;
+  first.clear({1}, "2020-06-01 00:00:00", "2020-06-02 00:00:00");
+  EXPECT_EQ(first.reloads, 1);
+  struct stat before;
+  ASSERT_EQ(stat(logfile.c_str(), &before), 0);
+  IndexLogUtil util;
+  util.clear({1}, "2020-06-01 00:00:00", "2020-06-02 00:00:00");
+  struct stat after;
+  ASSERT_EQ(stat(logfile.c_str(), &after), 0);
+  // Not replaced, only the breadcrumb added
+  EXPECT_EQ(after.st_ino, before.st_ino);
+  EXPECT_GT(after.st_size, before.st_size);
+  EXPECT_EQ(util.reloads, 0);
+}
@@ -118,6 +118,34 @@ TEST(SELStream, BasicJSON) {
       "ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH");
 }
 
+// The records are written as parsed, in the layout of dumping them all
+TEST(SELStream, JSONLayout) {
+  stringstream inp;
+  inp << " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC \"Reboot\" detected\n";
+  inp << " 2020 May 18 10:18:38 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: ncsid: FRU: 2 NIC AEN Supported: 0x7\n";
+  MockSELStream stream(FORMAT_JSON);
+
+  auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+  EXPECT_CALL(*sel, get_fru_name(2)).WillRepeatedly(Return(string("nic")));
+  EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(sel))));
+  stringstream outp;
+  stream.start(inp, outp, {SELFormat::FRU_ALL}, "", "");
+  stream.flush(outp);
+
+  nlohmann::json exp;
+  exp["Logs"] = nlohmann::json::parse(outp.str())["Logs"];
+  EXPECT_EQ(exp["Logs"].size(), 2);
+  EXPECT_EQ(outp.str(), exp.dump(4) + "\n");
+
+  MockSELStream empty(FORMAT_JSON);
+  stringstream outp2;
+  empty.flush(outp2);
+  exp["Logs"] = nlohmann::json::array();
+  EXPECT_EQ(outp2.str(), exp.dump(4) + "\n");
+}
+
 TEST(SELStream, ClearAll) {
   MockSELStream stream(FORMAT_RAW);
 
@@ -187,3 +215,35 @@ TEST(SELStream, ClearFru) {
   exp << "2020 Jun 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
   ASSERT_EQ(outp.str(), exp.str());
 }
+
+TEST(SELStream, InMemoryParallel) {
+  string log;
+  for (int i = 0; i < 2000; i++) {
+    log += " 2020 May 18 10:" + to_string(10 + i % 50) +
+        ":40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: FRU: " +
+        to_string(i % 3) + ", num: 0xC0 curr_val: 88.00 C\n";
+    if (i % 7 == 0)
+      log += "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+    if (i % 11 == 0)
+      log += string("bad\0line\n", 9);
+  }
+  // No newline at the end
+  log += "2020 May 22 17:29:55 log-util: User cleared FRU: 1 logs";
+  ASSERT_GT(log.size(), 2 * SELStream::parallel_min);
+
+  const vector<fru_set> fru_sets = {{SELFormat::FRU_ALL}, {1}, {SELFormat::FRU_SYS}};
+  for (auto fmt : {FORMAT_PRINT, FORMAT_RAW, FORMAT_JSON}) {
+    for (auto& frus : fru_sets) {
+      for (const string& s : {"", "2020-05-18 10:20:00"}) {
+        string e = s.empty() ? "" : "2020-05-18 10:30:00";
+        SELStream by_line(fmt), in_memory(fmt);
+        stringstream inp(log), exp, outp;
+        by_line.start(inp, exp, frus, s, e);
+        by_line.flush(exp);
+        in_memory.start(log.data(), log.size(), outp, frus, s, e);
+        in_memory.flush(outp);
+        EXPECT_EQ(outp.str(), exp.str()) << fmt << " " << *frus.begin() << " " << s;
+      }
+    }
+  }
+}
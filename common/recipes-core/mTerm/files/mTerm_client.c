@@ -176,13 +176,48 @@ static void connectClient(const char *dev) {
   close(clientfd);
 }
 
+/* Print the log requested by a tlv of type, without a console session */
+static int dumpLog(const char *dev, uint16_t type, char *arg) {
+  char buf[SEND_SIZE];
+  int clientfd, nbytes;
+
+  clientfd = createClientSocket(dev);
+  if (clientfd < 0) {
+    return -1;
+  }
+  if (fcntl(clientfd, F_SETFL, 0) < 0) {
+    perror("mTerm_client: Socket could not be made blocking");
+    close(clientfd);
+    return -1;
+  }
+
+  // The server closes the connection after it sent the log
+  if ((sendTlv(clientfd, type, arg, strlen(arg)) < 0) ||
+      (sendTlv(clientfd, 'x', NULL, 0) < 0)) {
+    close(clientfd);
+    return -1;
+  }
+  while ((nbytes = read(clientfd, buf, sizeof(buf))) > 0) {
+    writeData(STDOUT_FILENO, buf, nbytes, "stdout");
+  }
+  close(clientfd);
+  return 0;
+}
+
 static void
 print_usage() {
-  printf("Usage example: /usr/local/bin/mTerm_client <fru> \n");
+  printf("Usage example: /usr/local/bin/mTerm_client <fru> \n"
+         "\t/usr/local/bin/mTerm_client <fru> -k <N>: print the last N KB of the log\n"
+         "\t/usr/local/bin/mTerm_client <fru> -t <T>: print the log since time T\n");
 }
 
 int main(int argc, char **argv)
 {
+   if (argc == 4) {
+     if (!strcmp(argv[2], "-k") || !strcmp(argv[2], "-t")) {
+       return dumpLog(argv[1], argv[2][1], argv[3]) ? 1 : 0;
+     }
+   }
    if (argc != 2) {
      print_usage();
      exit(1);
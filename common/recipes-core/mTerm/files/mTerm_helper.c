@@ -19,6 +19,7 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #include <errno.h>
@@ -40,8 +41,8 @@ void escHelp(void) {
   printf("  CTRL-l x : Terminate the connection.\r\n");
   printf("  /var/log/mTerm_%s.log : Log location\r\n", g_fru);
   printf("  CTRL-l + b : Send Break\r\n");
-  /*TODO: Log file read from tool*/
-  //printf("  CTRL-L :N - For reading last N lines from end of buffer.\r\n");
+  printf("  CTRL-l :N k : Read the last N KB of the log\r\n");
+  printf("  CTRL-l :T t : Read the log since time T (seconds since epoch)\r\n");
   printf("\r\n-----------------------------------------------------------\r\n");
   return;
 }
@@ -108,15 +109,15 @@ int escSend(int clientfd, char c, escMode* mode) {
   static char rbuf[BUF_SIZE];
   static int rbuf_len = 0;
 
-  if (c == ASCII_CR) {
-    sendTlv(clientfd, ASCII_CTRL_L, rbuf, rbuf_len);
+  if ((c == ASCII_CR) || (c == LOG_TAIL_KB) || (c == LOG_SINCE)) {
+    sendTlv(clientfd, (c == ASCII_CR) ? ASCII_CTRL_L : c, rbuf, rbuf_len);
     *mode = EOL;
 
     //reset buf and length
     rbuf_len = 0;
     memset(rbuf, 0, sizeof(rbuf));
    } else {
-     if (!isdigit(c) || (rbuf_len > BUF_SIZE)) {
+     if (!isdigit(c) || (rbuf_len >= BUF_SIZE)) {
        rbuf_len = 0;
        memset(rbuf, 0, sizeof(rbuf));
        return -1;
@@ -133,7 +134,7 @@ void charSend(int clientfd, char* c, int length) {
 bufStore* createBuffer(const char *dev, int fsize) {
   bufStore* buf;
 
-  buf = (bufStore*)malloc(sizeof(bufStore));
+  buf = (bufStore*)calloc(1, sizeof(bufStore));
   if (buf == NULL) {
     perror("Malloc error");
     return NULL;
@@ -156,6 +157,10 @@ bufStore* createBuffer(const char *dev, int fsize) {
   }
 
   buf->buf_fd = open(buf->file, O_RDWR | O_APPEND | O_CREAT, 0666) ;
+  buf->size = lseek(buf->buf_fd, 0, SEEK_END);
+  if (buf->size < 0) {
+    buf->size = 0;
+  }
   buf->maxSizeBytes = fsize;
   buf->needTimestamp = 1;
   return buf;
@@ -169,12 +174,19 @@ void closeBuffer(bufStore* buf) {
   free(buf);
 }
 
-/* Write human-readable timestamp with line number in the provided buffer */
-void writeTimestampToBuffer(bufStore *buf) {
+/*
+ * Log data is staged with its timestamps and written with one write per
+ * flush, rather than two writes for every line.
+ */
+#define LOG_STAGE_SIZE (2 * SEND_SIZE)
+#define LOG_STAMP_MAX 64
+
+/* Format human-readable timestamp with line number in the provided buffer */
+static int formatTimestamp(bufStore *buf, char *out, size_t size) {
 
   time_t cur_time;
   size_t dateLen;
-  char dateBuff[64];
+  char dateBuff[LOG_STAMP_MAX];
 
   time(&cur_time);
 
@@ -184,54 +196,79 @@ void writeTimestampToBuffer(bufStore *buf) {
   dateLen = strlen(dateBuff);
   dateBuff[dateLen - 1] = ' ';
   snprintf(dateBuff + dateLen, sizeof(dateBuff) - dateLen, "%07lu ", buf->lineNumber++);
-  writeData(buf->buf_fd, dateBuff, strlen(dateBuff), "buffer");
+  dateLen = strlen(dateBuff);
+  if (dateLen > size) {
+    dateLen = size;
+  }
+  memcpy(out, dateBuff, dateLen);
+  return dateLen;
 }
 
-int backupBuffer(bufStore *buf) {
-  int ret = 0;
-  int in_fd, out_fd;
-  ssize_t r_cnt, w_cnt;
-  uint8_t rd_buf[1024];
-
-  in_fd = open(buf->file, O_RDONLY);
-  if (in_fd < 0) {
-    perror("Cannot open the mTerm buffer log file");
-    return -1;
-  }
+/*
+ * Rotate by renaming the current file over the backup file: the previous
+ * backup is dropped and nothing is copied.
+ */
+static void rotateBuffer(bufStore *buf) {
+  int fd;
 
-  out_fd = open(buf->backupfile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-  if (out_fd < 0) {
-    perror("Cannot create the mTerm backup buffer log file");
-    close(in_fd);
-    return -1;
+  if (rename(buf->file, buf->backupfile) != 0) {
+    syslog(LOG_WARNING, "Rename of the buffer file failed, errno=%d\n", errno);
+    if (ftruncate(buf->buf_fd, 0) != 0) {
+      syslog(LOG_WARNING, "Truncation post-rotation failed, errno=%d\n", errno);
+    }
+    lseek(buf->buf_fd, 0, SEEK_SET);
+    buf->nmarks[1] = 0;
+  } else {
+    fd = open(buf->file, O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+      perror("Cannot open the mTerm buffer log file");
+      exit(-1);
+    }
+    close(buf->buf_fd);
+    buf->buf_fd = fd;
+    memcpy(buf->index[1], buf->index[0], sizeof(buf->index[0]));
+    buf->nmarks[1] = buf->nmarks[0];
   }
+  syncfs(buf->buf_fd);
+  buf->nmarks[0] = 0;
+  buf->size = 0;
+}
 
-  while (1) {
-    r_cnt = read(in_fd, rd_buf, sizeof(rd_buf));
-    if (r_cnt <= 0) {
-      if (r_cnt < 0) {
-        ret = -1;
-      }
-      break;
-    }
+/* Add the line at offset of the current segment to the index */
+static void markBuffer(bufStore *buf, off_t offset) {
+  logMark *marks = buf->index[0];
+  time_t now = time(NULL);
+  int i;
 
-    w_cnt = write(out_fd, rd_buf, r_cnt);
-    if (w_cnt != r_cnt) {
-      ret = -1;
-      break;
+  if (buf->nmarks[0] &&
+      (now - marks[buf->nmarks[0] - 1].time < LOG_INDEX_SEC)) {
+    return;
+  }
+  if (buf->nmarks[0] == LOG_INDEX_SIZE) {
+    // Halve the resolution of a full index
+    for (i = 0; i < LOG_INDEX_SIZE / 2; i++) {
+      marks[i] = marks[2 * i];
     }
+    buf->nmarks[0] = LOG_INDEX_SIZE / 2;
   }
+  marks[buf->nmarks[0]].time = now;
+  marks[buf->nmarks[0]].offset = offset;
+  buf->nmarks[0]++;
+}
 
-  close(in_fd);
-  close(out_fd);
-  return ret;
+static void flushStage(bufStore *buf, char *stage, int *staged) {
+  writeData(buf->buf_fd, stage, *staged, "buffer");
+  buf->size += *staged;
+  *staged = 0;
 }
 
 void writeToBuffer(bufStore *buf, char* data, int len) {
    bool rotate = false;
    struct stat file_stat;
    int rc = stat(buf->file, &file_stat), nbytes = len, cur_len;
-   char *cur = data, *prev = data;
+   int staged = 0, room;
+   char *cur, *prev = data;
+   char stage[LOG_STAGE_SIZE];
 
    if (rc != 0) {
      if (errno == ENOENT) {
@@ -243,6 +280,8 @@ void writeToBuffer(bufStore *buf, char* data, int len) {
          exit(-1);
        }
        syncfs(buf->buf_fd);
+       buf->nmarks[0] = 0;
+       buf->size = 0;
      } else {
        // We couldn't figure out if the file needs to be rotated.
        // Don't rotate the file.  Continue and log the data anyway, though.
@@ -250,6 +289,7 @@ void writeToBuffer(bufStore *buf, char* data, int len) {
               "errno=%d", errno);
      }
    } else {
+     buf->size = file_stat.st_size;
      if (file_stat.st_size >= buf->maxSizeBytes) {
        rotate = true;
      }
@@ -257,37 +297,110 @@ void writeToBuffer(bufStore *buf, char* data, int len) {
 
    // Rollover to a backup file when buffer hits filesize
    if (rotate) {
-     backupBuffer(buf);
-     if (ftruncate(buf->buf_fd, 0) != 0) {
-       syslog(LOG_WARNING, "Truncation post-rotation failed, errno=%d\n", errno);
-     }
-     syncfs(buf->buf_fd);
-     lseek(buf->buf_fd, 0, SEEK_SET);
+     rotateBuffer(buf);
    }
 
   /*
    * Treat data as byte array but try to seek out newline characters. When they are
    * found, add current timestamp and sequential line number.
    */
-   while ((cur = memchr(cur, '\n', nbytes)) || nbytes) {
+   while (nbytes > 0) {
      if (buf->needTimestamp) {
-       writeTimestampToBuffer(buf);
+       if (staged + LOG_STAMP_MAX > sizeof(stage)) {
+         flushStage(buf, stage, &staged);
+       }
+       markBuffer(buf, buf->size + staged);
+       staged += formatTimestamp(buf, stage + staged, sizeof(stage) - staged);
        buf->needTimestamp = 0;
      }
-     /* there is no new line in this buffer, move on */
-     if (!cur) {
-       writeData(buf->buf_fd, prev, nbytes, "buffer");
-       break;
-     }
 
-     cur_len = cur - prev + 1;
+     cur = memchr(prev, '\n', nbytes);
+     /* there is no new line in this buffer, stage the rest of it */
+     cur_len = cur ? (cur - prev + 1) : nbytes;
      nbytes -= cur_len;
+     while (cur_len > 0) {
+       if (staged == sizeof(stage)) {
+         flushStage(buf, stage, &staged);
+       }
+       room = sizeof(stage) - staged;
+       if (room > cur_len) {
+         room = cur_len;
+       }
+       memcpy(stage + staged, prev, room);
+       staged += room;
+       prev += room;
+       cur_len -= room;
+     }
+     if (cur) {
+       buf->needTimestamp = 1;
+     }
+  }
 
-     writeData(buf->buf_fd, prev, cur_len, "buffer");
-     prev = ++cur;
-     buf->needTimestamp = 1;
+  if (staged) {
+    flushStage(buf, stage, &staged);
   }
+}
 
+/* Send the log from offset of segment seg on, through the current one */
+static void sendSegments(bufStore *buf, int clientfd, int seg, off_t offset) {
+  const char *files[2] = {buf->file, buf->backupfile};
+  struct stat st;
+  ssize_t n;
+  int fd;
+
+  for (; seg >= 0; seg--, offset = 0) {
+    fd = open(files[seg], O_RDONLY);
+    if (fd < 0) {
+      continue;
+    }
+    if (fstat(fd, &st) == 0) {
+      while (offset < st.st_size) {
+        n = sendfile(clientfd, fd, &offset, st.st_size - offset);
+        if (n <= 0) {
+          break;
+        }
+      }
+    }
+    close(fd);
+  }
+}
+
+void bufferGetTail(bufStore *buf, int clientfd, off_t nbytes) {
+  struct stat st;
+  off_t size = 0;
+
+  if (stat(buf->file, &st) == 0) {
+    size = st.st_size;
+  }
+  if (nbytes <= size) {
+    sendSegments(buf, clientfd, 0, size - nbytes);
+    return;
+  }
+  nbytes -= size;
+  if ((stat(buf->backupfile, &st) == 0) && (nbytes < st.st_size)) {
+    sendSegments(buf, clientfd, 1, st.st_size - nbytes);
+  } else {
+    sendSegments(buf, clientfd, 1, 0);
+  }
+}
+
+void bufferGetSince(bufStore *buf, int clientfd, time_t since) {
+  int seg, i;
+
+  /*
+   * Start at the newest mark before since: the log from there on has all
+   * the lines since then. Lines not indexed (e.g. logged before a restart)
+   * are sent in full.
+   */
+  for (seg = 0; seg < 2; seg++) {
+    for (i = buf->nmarks[seg] - 1; i >= 0; i--) {
+      if (buf->index[seg][i].time < since) {
+        sendSegments(buf, clientfd, seg, buf->index[seg][i].offset);
+        return;
+      }
+    }
+  }
+  sendSegments(buf, clientfd, 1, 0);
 }
 
 long int bufferGetLines(char* fname, int clientfd, int nlines, long int curr) {
@@ -17,7 +17,9 @@
  */
 
 #include <sys/socket.h>
+#include <sys/types.h>
 #include <arpa/inet.h>
+#include <time.h>
 
 #define ASCII_DELETE  0177
 #define ESC_CHAR_HELP '?'
@@ -27,6 +29,8 @@
 #define ASCII_COLON 58 // :
 #define ASCII_CARAT 94 // ^
 #define ASCII_CR 015
+#define LOG_TAIL_KB 'k' // request the last N KB of the log
+#define LOG_SINCE 't' // request the log since time T
 #define BUF_SIZE 10
 #define PATH_SIZE 64
 /* SEND_SIZE definition:
@@ -43,6 +47,9 @@
 #define FILE_SIZE_BYTES 300000
 #define FILE_SIZE_MAX_BYTES 10000000
 #define MAX_BYTE 5120
+/* Marks of the log index per segment, at most one per LOG_INDEX_SEC */
+#define LOG_INDEX_SIZE 128
+#define LOG_INDEX_SEC 1
 
 typedef enum escMode {
   EOL,
@@ -51,6 +58,16 @@ typedef enum escMode {
   SEND
 } escMode;
 
+/* Offset of the line logged at time */
+typedef struct logMark {
+  time_t time;
+  off_t offset;
+} logMark;
+
+/*
+ * The log is kept in two segments of maxSizeBytes: the current file and
+ * the backup file. Segment 0 is the current one, segment 1 the backup.
+ */
 typedef struct bufStore {
   int  buf_fd;
   int  maxSizeBytes;
@@ -58,6 +75,9 @@ typedef struct bufStore {
   char backupfile[PATH_SIZE];
   char needTimestamp;
   unsigned long lineNumber;
+  off_t size;
+  int nmarks[2];
+  logMark index[2][LOG_INDEX_SIZE];
 } bufStore;
 
 typedef struct TlvHeader {
@@ -77,6 +97,8 @@ bufStore* createBuffer(const char *dev, int fsize);
 void closeBuffer(bufStore* buf);
 long int bufferGetLines(char* fname, int clientfd, int n, long int curr);
 void writeToBuffer(bufStore *buf, char* data, int len);
+void bufferGetTail(bufStore *buf, int clientfd, off_t nbytes);
+void bufferGetSince(bufStore *buf, int clientfd, time_t since);
 // tx
 int sendTlv(int fd, uint16_t type, void* value, uint16_t valLen);
 int escSendBreak(int clientfd, char *c);
@@ -18,6 +18,7 @@
 #include <ctype.h>
 #include <sys/file.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <arpa/inet.h>
 #include <sys/un.h>
 #include <errno.h>
@@ -27,8 +28,22 @@
 #include "mTerm_helper.h"
 
 #define NUM_CLIENTS 10
+#define MAX_EVENTS 16
+/* Console output queued for a client which doesn't keep up; a client
+ * lagging behind by more than this is dropped. */
+#define CLIENT_RING_SIZE (8 * SEND_SIZE)
+
+typedef struct mTermClient {
+  int fd;
+  int head;
+  int len;
+  char ring[CLIENT_RING_SIZE];
+  struct mTermClient *next;
+} mTermClient;
 
 static size_t file_size = FILE_SIZE_BYTES;
+static int epollFd = -1;
+static mTermClient *clients = NULL;
 
 static int createServerSocket(const char* dev) {
   int serverFd;
@@ -88,9 +103,123 @@ static int acceptClient(int serverFd) {
   return fd;
 }
 
-void closeClient(fd_set* master, int clientfd) {
-  close(clientfd);
-  FD_CLR(clientfd, master);
+static int watchClient(mTermClient *cli, int op, int out) {
+  struct epoll_event ev = {0};
+
+  ev.events = EPOLLIN | (out ? EPOLLOUT : 0);
+  ev.data.ptr = cli;
+  return epoll_ctl(epollFd, op, cli->fd, &ev);
+}
+
+static mTermClient* addClient(int fd) {
+  mTermClient *cli;
+
+  cli = (mTermClient*)malloc(sizeof(mTermClient));
+  if (cli == NULL) {
+    syslog(LOG_ERR, "mTerm_server: No memory for client fd=%d\n", fd);
+    close(fd);
+    return NULL;
+  }
+  cli->fd = fd;
+  cli->head = 0;
+  cli->len = 0;
+  if (watchClient(cli, EPOLL_CTL_ADD, 0) < 0) {
+    syslog(LOG_ERR, "mTerm_server: Cannot watch client fd=%d\n", fd);
+    close(fd);
+    free(cli);
+    return NULL;
+  }
+  cli->next = clients;
+  clients = cli;
+  return cli;
+}
+
+/* The client is freed by reapClients(), once no event refers to it. */
+void closeClient(mTermClient *cli) {
+  if (cli->fd < 0) {
+    return;
+  }
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, cli->fd, NULL);
+  close(cli->fd);
+  cli->fd = -1;
+}
+
+static void reapClients(void) {
+  mTermClient **pcli = &clients, *cli;
+
+  while ((cli = *pcli) != NULL) {
+    if (cli->fd < 0) {
+      *pcli = cli->next;
+      free(cli);
+    } else {
+      pcli = &cli->next;
+    }
+  }
+}
+
+/* Send as much of the queued output as the client takes without blocking */
+static int flushClient(mTermClient *cli) {
+  int chunk, n;
+
+  while (cli->len > 0) {
+    chunk = CLIENT_RING_SIZE - cli->head;
+    if (chunk > cli->len) {
+      chunk = cli->len;
+    }
+    n = send(cli->fd, cli->ring + cli->head, chunk, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    cli->head = (cli->head + n) % CLIENT_RING_SIZE;
+    cli->len -= n;
+  }
+  cli->head = 0;
+  return 0;
+}
+
+/*
+ * Send console output to the client, queueing what it can't take now.
+ * Return -1 if the client is gone, or lags behind by more than its ring.
+ */
+static int queueClient(mTermClient *cli, char *data, int nbytes) {
+  int queued = cli->len, tail, chunk, n;
+
+  if (queued == 0) {
+    n = send(cli->fd, data, nbytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return -1;
+      }
+      n = 0;
+    }
+    data += n;
+    nbytes -= n;
+  }
+  if (nbytes == 0) {
+    return 0;
+  }
+  if (nbytes > CLIENT_RING_SIZE - cli->len) {
+    return -1;
+  }
+
+  while (nbytes > 0) {
+    tail = (cli->head + cli->len) % CLIENT_RING_SIZE;
+    chunk = CLIENT_RING_SIZE - tail;
+    if (chunk > nbytes) {
+      chunk = nbytes;
+    }
+    memcpy(cli->ring + tail, data, chunk);
+    cli->len += chunk;
+    data += chunk;
+    nbytes -= chunk;
+  }
+  if (queued == 0 && watchClient(cli, EPOLL_CTL_MOD, 1) < 0) {
+    return -1;
+  }
+  return 0;
 }
 
 void sendBreak(int clientFd, int solFd, char *c) {
@@ -98,8 +227,20 @@ void sendBreak(int clientFd, int solFd, char *c) {
   tcsendbreak(solFd, 1);
 }
 
-static void processClient(fd_set* master, int clientFd , int solFd,
-                          bufStore *buf) {
+/* Number sent as the ascii digits of a tlv */
+static long parseTlvNumber(const char *data, int len) {
+  char num[BUF_SIZE + 1];
+
+  if (len > BUF_SIZE) {
+    len = BUF_SIZE;
+  }
+  memcpy(num, data, len);
+  num[len] = '\0';
+  return strtol(num, NULL, 10);
+}
+
+static void processClient(mTermClient *cli, int solFd, bufStore *buf) {
+  int clientFd = cli->fd;
   char data[SEND_SIZE];
   int nbytesHeader = 0, nbytesData = 0;
   TlvHeader header;
@@ -122,12 +263,12 @@ static void processClient(fd_set* master, int clientFd , int solFd,
     } else {
       syslog(LOG_ERR, "mTerm_server: Error on read fd=%d\n", clientFd);
     }
-    closeClient(master, clientFd);
+    closeClient(cli);
   } else if (nbytesHeader < sizeof(TlvHeader)) {
     // TODO: Potentially we should use a per-client buffer, for now close
     //  Client connection
     syslog(LOG_ERR, "mTerm_server: Error on read fd=%d socket_nbytes=%d\n", clientFd, nbytesHeader);
-    closeClient(master, clientFd);
+    closeClient(cli);
   } else if (header.length != nbytesData ) {
     syslog(LOG_ERR,"mTerm_server: data is not correct to receive nbytes=%d, length=%d",nbytesData, header.length);
     //syslog(LOG_ERR, "mTerm_server: Received %d bytes for fd=%d dropping message.\n",nbytes, clientFd);
@@ -149,9 +290,16 @@ static void processClient(fd_set* master, int clientFd , int solFd,
           bufferGetLines(buf->file, clientFd, atoi(vecData.iov_base), 0);
         }
         break;
+      case LOG_TAIL_KB:
+        bufferGetTail(buf, clientFd,
+                      (off_t)parseTlvNumber(data, nbytesData) * 1024);
+        break;
+      case LOG_SINCE:
+        bufferGetSince(buf, clientFd, (time_t)parseTlvNumber(data, nbytesData));
+        break;
       case 'x':
         syslog(LOG_INFO, "mTerm_server: Client socket %d closed\n", clientFd);
-        closeClient(master, clientFd);
+        closeClient(cli);
         break;
       case ASCII_CARAT:
         writeData(solFd, vecData.iov_base, nbytesData, "tty");
@@ -163,31 +311,33 @@ static void processClient(fd_set* master, int clientFd , int solFd,
   }
 }
 
-/* TODO: We should support non-blocking writes to clients, and buffer data if
-they don't read it fast enough. If we end up buffering too much data for any
-particular client then we should disconnect that client.
-*/
-static int processSol(fd_set* master, int serverfd, int fdmax,
-                      int solFd, bufStore *buf) {
+/*
+ * Console output is never blocked on a client: what a client can't take
+ * is queued in its ring, and a client whose ring overflows is dropped.
+ */
+static int processSol(int solFd, bufStore *buf) {
   char data[SEND_SIZE];
   int nbytes;
-  int currFd;
+  mTermClient *cli;
 
   nbytes = read(solFd, data, sizeof(data));
   if (nbytes > 0) {
-    for (currFd = 0; currFd <= fdmax; currFd++) {
-      if (FD_ISSET(currFd, master)) {
-        if ((currFd != serverfd) && (currFd != solFd)) {
-          if (send(currFd, data, nbytes, 0) == -1) {
-            syslog(LOG_ERR, "mTerm_server: Error on send fd=%d\n", currFd);
-            closeClient(master, currFd);
-            syslog(LOG_ERR, "mTerm_server: Terminated client fd=%d\n", currFd);
-          }
-        }
+    for (cli = clients; cli != NULL; cli = cli->next) {
+      if (cli->fd < 0) {
+        continue;
+      }
+      if (queueClient(cli, data, nbytes) < 0) {
+        syslog(LOG_ERR, "mTerm_server: Error on send fd=%d (lagging %d bytes)\n",
+               cli->fd, cli->len);
+        closeClient(cli);
+        syslog(LOG_ERR, "mTerm_server: Terminated client\n");
       }
     }
     writeToBuffer(buf, data, nbytes);
   } else if (nbytes < 0) {
+    if (errno == EINTR || errno == EAGAIN) {
+      return 1;
+    }
     syslog(LOG_ERR, "mTerm_server: Error on read fd=%d\n", solFd);
     return -1;
   }
@@ -195,11 +345,9 @@ static int processSol(fd_set* master, int serverfd, int fdmax,
 }
 
 static void connectServer(const char *stty, const char *dev) {
-  int fdmax, newfd;
-
-  fd_set master, read_fds;
-  FD_ZERO(&master);
-  FD_ZERO(&read_fds);
+  int newfd, nfds, i;
+  struct epoll_event ev = {0}, events[MAX_EVENTS];
+  mTermClient *cli;
 
   int serverfd;
   serverfd = createServerSocket(dev);
@@ -225,42 +373,79 @@ static void connectServer(const char *stty, const char *dev) {
     return;
   }
 
-  FD_SET(serverfd, &master);
-  FD_SET(tty_sol->fd,&master);
-  fdmax = (serverfd > tty_sol->fd) ? serverfd : tty_sol->fd;
+  /* The server socket and the tty are told apart from clients by data.ptr */
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) {
+    syslog(LOG_ERR, "mTerm_server: Cannot create epoll fd\n");
+    goto done;
+  }
+  ev.events = EPOLLIN;
+  ev.data.ptr = &serverfd;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serverfd, &ev) < 0) {
+    syslog(LOG_ERR, "mTerm_server: Cannot watch server socket\n");
+    goto done;
+  }
+  ev.data.ptr = &tty_sol->fd;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, tty_sol->fd, &ev) < 0) {
+    syslog(LOG_ERR, "mTerm_server: Cannot watch tty\n");
+    goto done;
+  }
 
   for(;;) {
-    read_fds = master;
-    if (select(fdmax + 1, &read_fds, NULL, NULL, NULL) == -1) {
-      syslog(LOG_ERR, "mTerm_server: Server socket: select error\n");
+    nfds = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+    if (nfds == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      syslog(LOG_ERR, "mTerm_server: Server socket: epoll error\n");
       break;
     }
-    if (FD_ISSET(serverfd, &read_fds)) {
-      newfd = acceptClient(serverfd);
-      if (newfd < 0) {
-        syslog(LOG_ERR, "mTerm_server: Error on accepting client\n");
-      } else {
-        FD_SET(newfd, &master);
-        if (newfd > fdmax) {
-          fdmax = newfd;
+    for (i = 0; i < nfds; i++) {
+      if (events[i].data.ptr == &serverfd) {
+        newfd = acceptClient(serverfd);
+        if (newfd < 0) {
+          syslog(LOG_ERR, "mTerm_server: Error on accepting client\n");
+        } else {
+          addClient(newfd);
         }
+        continue;
       }
-    }
-    if (FD_ISSET(tty_sol->fd, &read_fds)) {
-      if ( processSol(&master, serverfd, fdmax, tty_sol->fd, buf) < 0) {
-        break;
+      if (events[i].data.ptr == &tty_sol->fd) {
+        if (processSol(tty_sol->fd, buf) < 0) {
+          goto done;
+        }
+        continue;
       }
-    }
-    int i;
-    for(i = 0; i <= fdmax; i++) {
-      if (FD_ISSET(i, &read_fds)) {
-        if ((i == serverfd) || (i == tty_sol->fd)) {
+
+      cli = events[i].data.ptr;
+      if (cli->fd < 0) {
+        continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        if (flushClient(cli) < 0) {
+          syslog(LOG_ERR, "mTerm_server: Error on send fd=%d\n", cli->fd);
+          closeClient(cli);
           continue;
-        } else {
-          processClient(&master, i, tty_sol->fd, buf);
+        }
+        if (cli->len == 0) {
+          watchClient(cli, EPOLL_CTL_MOD, 0);
         }
       }
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        processClient(cli, tty_sol->fd, buf);
+      }
     }
+    reapClients();
+  }
+
+done:
+  for (cli = clients; cli != NULL; cli = cli->next) {
+    closeClient(cli);
+  }
+  reapClients();
+  if (epollFd >= 0) {
+    close(epollFd);
+    epollFd = -1;
   }
   closeTty(tty_sol);
   close(serverfd);
@@ -33,6 +33,7 @@
 #include <openbmc/obmc-mctp.h>
 #include <openbmc/ncsi.h>
 #include "decode.h"
+#include "stream.h"
 #include "mctp-util.h"
 
 #define DEFAULT_EID 0x8
@@ -40,16 +41,21 @@
 #define BCM_MFG_ID 0x3d110000
 #define MAX_PAYLOAD_SIZE 1024  // including Message Header and body
 
-#define COMMON_OPT_STR    "dh"
+#define COMMON_OPT_STR    "dhst:c:"
 
 #define noDEBUG
 
 static void default_mctp_util_usage(void) {
   printf("Usage: mctp-util [options] <bus#> <dst_addr> <dst_eid> <type> <cmd payload> \n");
+  printf("       mctp-util -s [-t <type>] [-c <cmd>] [<capture>]\n");
   printf("Sends MCTP data over SMbus \n");
   printf("Options\n");
   printf("       -h             this help\n");
   printf("       -d             decode response\n");
+  printf("       -s             decode a capture (stdin by default), a message per line:\n");
+  printf("                      [<seconds>] <eid> <tag> <type> <body...> in hex\n");
+  printf("       -t <type>      with -s, only the messages of MCTP type <type>\n");
+  printf("       -c <cmd>       with -s, only the messages of command <cmd>\n");
   printf("Command fields\n");
   printf("       <bus#>         I2C Bus number\n");
   printf("       <dst_addr>     destination slave address\n");
@@ -81,6 +87,10 @@ int main(int argc, char **argv)
   int decode_flag = 0;
   int minargc = 6;
   int argflag;
+  int stream_flag = 0;
+  int type_filter = STREAM_FILTER_ANY;
+  int cmd_filter = STREAM_FILTER_ANY;
+  FILE *in;
  /*
    * Handle util common options.
    * It ignores errors for other options and prefixes the option string
@@ -94,6 +104,15 @@ int main(int argc, char **argv)
             decode_flag = 1;
             minargc += 1;
             break;
+    case 's':
+            stream_flag = 1;
+            break;
+    case 't':
+            type_filter = (int)strtoul(optarg, NULL, 0);
+            break;
+    case 'c':
+            cmd_filter = (int)strtoul(optarg, NULL, 0);
+            break;
     case 'h':
             default_mctp_util_usage();
             return 0;
@@ -102,6 +121,20 @@ int main(int argc, char **argv)
     }
   }
 
+  if (stream_flag) {
+    if (optind >= argc) {
+      return stream_decode(stdin, type_filter, cmd_filter);
+    }
+    in = fopen(argv[optind], "r");
+    if (in == NULL) {
+      printf("Cannot open %s\n", argv[optind]);
+      return -1;
+    }
+    ret = stream_decode(in, type_filter, cmd_filter);
+    fclose(in);
+    return ret;
+  }
+
   if (argc < minargc) { // min params: mctp-util <bus> <dst_addr> <eid> <type> <data>
     printf("argc(%d) < minargc(%d)\n", argc, minargc);
     ret = -1;
@@ -0,0 +1,103 @@
+/*
+ * stream.cpp
+ *
+ * Copyright 2026-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <openbmc/mctp-decode.hpp>
+#include "stream.h"
+
+#define MAX_LINE_SIZE 4096
+#define MAX_MSG_SIZE  1024
+
+// Bytes of a capture line, its timestamp first if it has one
+static int parse_line(char *line, double *ts, uint8_t *buf, int size)
+{
+  char *tok, *end, *save = NULL;
+  int len = 0;
+
+  *ts = -1;
+  for (tok = strtok_r(line, " \t\r\n", &save); tok != NULL;
+       tok = strtok_r(NULL, " \t\r\n", &save)) {
+    if (len == 0 && *ts < 0 && strchr(tok, '.') != NULL) {
+      *ts = strtod(tok, &end);
+      if (*end != '\0')
+        return -1;
+      continue;
+    }
+    if (len >= size)
+      return -1;
+    unsigned long val = strtoul(tok, &end, 16);
+    if (*end != '\0' || val > 0xff)
+      return -1;
+    buf[len++] = (uint8_t)val;
+  }
+  return len;
+}
+
+int stream_decode(FILE *in, int type_filter, int cmd_filter)
+{
+  mctp_decode::latency_tracker tracker;
+  mctp_decode::message msg;
+  char line[MAX_LINE_SIZE];
+  uint8_t buf[MAX_MSG_SIZE];
+  unsigned lineno = 0, bad = 0;
+  double ts, latency;
+  int len;
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    lineno++;
+    if (line[0] == '#')
+      continue;
+    len = parse_line(line, &ts, buf, sizeof(buf));
+    if (len == 0)
+      continue;
+    if (len < 0) {
+      fprintf(stderr, "line %u: not a message\n", lineno);
+      bad++;
+      continue;
+    }
+
+    mctp_decode::decode(mctp_decode::bytes(buf, len), msg);
+    if (type_filter != STREAM_FILTER_ANY && msg.type != type_filter)
+      continue;
+    if (cmd_filter != STREAM_FILTER_ANY &&
+        (msg.st != mctp_decode::status::ok || msg.command != cmd_filter))
+      continue;
+
+    std::string s = mctp_decode::summary(msg);
+    if (ts >= 0 && msg.st == mctp_decode::status::ok &&
+        tracker.add(msg, ts, latency)) {
+      printf("%.6f %s latency %.3f ms\n", ts, s.c_str(), latency * 1000);
+    } else if (ts >= 0) {
+      printf("%.6f %s\n", ts, s.c_str());
+    } else {
+      printf("%s\n", s.c_str());
+    }
+  }
+
+  tracker.finish();
+  if (!tracker.get_stats().empty()) {
+    printf("\n");
+    tracker.print_stats(stdout);
+  }
+  return bad ? -1 : 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * stream.h
+ *
+ * Copyright 2026-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <stdio.h>
+
+#define STREAM_FILTER_ANY -1
+
+/*
+ * Decodes a capture, a message per line:
+ *   [<seconds>.<fraction>] <eid> <tag> <type> <body...>
+ * bytes in hex, as the raw responses are printed. Prints a summary of
+ * the messages of type_filter and cmd_filter (STREAM_FILTER_ANY for all),
+ * with the latency of the responses when the lines are timestamped,
+ * then the latencies of every command.
+ */
+int stream_decode(FILE *in, int type_filter, int cmd_filter);
+#endif /* _STREAM_H_ */
@@ -38,13 +38,14 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <mqueue.h>
-#include <semaphore.h>
 #include <poll.h>
 #include <pthread.h>
 #include <arpa/inet.h>
 #include <stddef.h>
 #include <openbmc/obmc-pal.h>
-#include <semaphore.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <openbmc/kv.h>
 #include <openbmc/ncsi.h>
@@ -67,17 +68,37 @@
 #ifndef MAX
 #define MAX(a, b) ((a) > (b)) ? (a) : (b)
 #endif
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
 /*
    Default config:
       - poll NIC status once every 60 seconds
+      - after an error, poll it every 5 seconds, backing off to 60 seconds
+        while the NIC is fine again
 */
 /* POLL nic status every N seconds */
 #define NIC_STATUS_SAMPLING_DELAY  60
+#define NIC_STATUS_ERR_DELAY  5
 
 #define NCSI_WAIT_REINIT 5
 
 #define RX_BUF_SIZE 20
-#define fillcnt_sem_path  "/fillsem"
+
+// sources of the events of the ncsid loop
+enum {
+  EV_STATUS,  // timer of the NIC status checks
+  EV_REINIT,  // timer of the NCSI interface re-init steps
+  EV_NL,      // netlink user socket, or libnl AEN socket
+  EV_RX,      // libnl rx buffer
+};
+
+// steps of the NCSI interface re-init
+enum {
+  REINIT_IDLE,
+  REINIT_CONFIG,
+  REINIT_AEN,
+};
 
 
 typedef struct _nl_usr_sk_t {
@@ -95,14 +116,14 @@ static nl_usr_sk_t gSock = { .fd = -1, .sock = 0 };
 // libnl rx buffer struct
 static struct {
   pthread_mutex_t rx_mutex;
-  sem_t *semfill;
+  int evfd;
   uint8_t start; // points to first data entry
   uint8_t end; // points to first empty buf
   uint8_t len;
   NCSI_NL_RSP_T *buf[RX_BUF_SIZE];
 } libnl_rx_buf = {
   .rx_mutex = PTHREAD_MUTEX_INITIALIZER,
-  .semfill = NULL,
+  .evfd = -1,
   .start = 0,
   .end = 0,
   .len = 0,
@@ -112,6 +133,11 @@ static struct {
 static NCSI_NL_RSP_T aenbuf;
 
 static struct timespec last_config_ts;
+static int status_tfd = -1;
+static int reinit_tfd = -1;
+static int status_delay = NIC_STATUS_SAMPLING_DELAY;
+static bool status_err = false;
+static int reinit_step = REINIT_IDLE;
 static NCSI_Get_Capabilities_Response gNicCapability = {0};
 static uint32_t vendor_IANA = 0;
 static uint32_t aen_enable_mask = AEN_ENABLE_DEFAULT;
@@ -154,9 +180,11 @@ static int (*send_cmd_and_get_resp)(nl_usr_sk_t *sk, uint8_t ncsi_cmd,
                       uint16_t payload_len, unsigned char *payload,
                       NCSI_NL_RSP_T *resp_buf);
 static int (*send_nl_data)(int socket_fd, generic_msg_t *gmsg);
-static void* (*ncsi_rx_handler)(void *args);
+static void  (*ncsi_rx_handler)(struct nl_sock *sk);
 static int   (*send_registration_msg)(nl_usr_sk_t *sk);
 
+static void nic_status_error(void);
+
 // ring buffer API for libnl
 int rx_buffer_add(NCSI_NL_RSP_T *pdata);
 int rx_buffer_get(NCSI_NL_RSP_T *dest);
@@ -962,6 +990,7 @@ process_NCSI_resp(NCSI_NL_RSP_T *buf)
   /* chekc for command completion before processing
      response payload */
   if (cmd_response_code != RESP_COMMAND_COMPLETED) {
+      nic_status_error();
       syslog(LOG_WARNING, "NCSI Cmd (0x%x) failed,"
              " Cmd Response 0x%x, Reason 0x%x",
              cmd, cmd_response_code, cmd_reason_code);
@@ -1029,133 +1058,155 @@ enable_aens(nl_usr_sk_t *sfd, uint32_t aen_enable_mask) {
   return;
 }
 
+// (Re-)arm a one-shot timer to expire in sec seconds
+static int
+arm_timer(int tfd, int sec) {
+  struct itimerspec its = {0};
+
+  its.it_value.tv_sec = sec;
+  if (sec == 0) {
+    its.it_value.tv_nsec = 1;
+  }
+  return timerfd_settime(tfd, 0, &its, NULL);
+}
+
+// Check the NIC status sooner after an error
+static void
+nic_status_error(void) {
+  status_err = true;
+  if (status_delay > NIC_STATUS_ERR_DELAY) {
+    status_delay = NIC_STATUS_ERR_DELAY;
+    arm_timer(status_tfd, status_delay);
+  }
+}
+
 static void
 handle_ncsi_if_reinit(int is_aen) {
   uint8_t delay_sec;
   char value[64];
   struct timespec ts;
 
+  nic_status_error();
   clock_gettime(CLOCK_MONOTONIC, &ts);  // to avoid re-initialize closely
-  if (((ts.tv_sec - last_config_ts.tv_sec) >= NIC_STATUS_SAMPLING_DELAY/2) ||
-      (last_config_ts.tv_sec == 0)) {
+  if ((reinit_step == REINIT_IDLE) &&
+      (((ts.tv_sec - last_config_ts.tv_sec) >= NIC_STATUS_SAMPLING_DELAY/2) ||
+       (last_config_ts.tv_sec == 0))) {
     // to skip tx during re-init
-    snprintf(value, sizeof(value), "%ld", ts.tv_sec + NCSI_WAIT_REINIT);
+    delay_sec = (is_aen) ? NCSI_RESET_TIMEOUT : 0;
+    snprintf(value, sizeof(value), "%ld",
+             ts.tv_sec + delay_sec + NCSI_WAIT_REINIT);
     if (kv_set("block_ncsi_xmit", value, 0, 0)) {
       syslog(LOG_WARNING, "failed to set block_ncsi_xmit");
     }
 
-    delay_sec = (is_aen) ? NCSI_RESET_TIMEOUT : 0;
-    handle_ncsi_config(delay_sec);
+    // Give NIC some time to finish its reset opeartion before BMC sends
+    // NCSI commands to re-initialize the interface
     last_config_ts.tv_sec = ts.tv_sec + delay_sec;
-
-    send_registration_msg(&gSock);
-    if (islibnl()) {
-      sleep(NCSI_WAIT_REINIT);
-    }
-    enable_aens(&gSock, aen_enable_mask);
+    reinit_step = REINIT_CONFIG;
+    arm_timer(reinit_tfd, delay_sec);
   }
 }
 
-// Thread to handle the incoming responses
-static void*
-ncsi_rx_handler_nl_usr(void *args) {
-  int sock_fd = gSock.fd;
-  struct msghdr msg;
-  struct iovec iov;
-  int msg_size = sizeof(NCSI_NL_RSP_T);
-  struct nlmsghdr *nlh = NULL;
-  int ret = 0;
-  /* msg response from kernel */
-  NCSI_NL_RSP_T *rcv_buf;
-  int is_aen;
-
-  memset(&msg, 0, sizeof(msg));
-  syslog(LOG_INFO, "rx: ncsi_rx_handler thread started");
-  nlh = (struct nlmsghdr *)malloc(NLMSG_SPACE(msg_size));
-  if (!nlh) {
-    syslog(LOG_ERR, "rx: Error, failed to allocate message buffer");
-    return NULL;
+// Next step of the NCSI interface re-init, once its timer expired
+static void
+ncsi_reinit_step(void) {
+  switch (reinit_step) {
+    case REINIT_CONFIG:
+      handle_ncsi_config(0);
+      send_registration_msg(&gSock);
+      if (islibnl()) {
+        reinit_step = REINIT_AEN;
+        arm_timer(reinit_tfd, NCSI_WAIT_REINIT);
+        break;
+      }
+      // fall through
+    case REINIT_AEN:
+      enable_aens(&gSock, aen_enable_mask);
+      reinit_step = REINIT_IDLE;
+      break;
+    default:
+      break;
   }
-  memset(nlh, 0, NLMSG_SPACE(msg_size));
-  nlh->nlmsg_len = NLMSG_SPACE(msg_size);
-  nlh->nlmsg_pid = getpid();
-  nlh->nlmsg_flags = 0;
+}
 
-  iov.iov_base = (void *)nlh;
-  iov.iov_len = nlh->nlmsg_len;
-  msg.msg_iov = &iov;
-  msg.msg_iovlen = 1;
+static void
+ncsi_handle_rx(NCSI_NL_RSP_T *rcv_buf) {
+  int ret, is_aen;
+
+  is_aen = is_aen_packet((AEN_Packet *)rcv_buf->msg_payload);
+  if (is_aen) {
+    // re-check the link soon after any AEN
+    nic_status_error();
+    ret = process_NCSI_AEN((AEN_Packet *)rcv_buf->msg_payload);
+  } else {
+    ret = process_NCSI_resp(rcv_buf);
+  }
 
-  // the last timestamp to call handle_ncsi_config() when processing NCSI_resp
-  last_config_ts.tv_sec = 0;
+  if (ret == NCSI_IF_REINIT) {
+    handle_ncsi_if_reinit(is_aen);
+  }
+}
 
-  while (1) {
-    /* Read message from kernel */
-    recvmsg(sock_fd, &msg, 0);
-    rcv_buf = (NCSI_NL_RSP_T *)NLMSG_DATA(nlh);
-    is_aen = is_aen_packet((AEN_Packet *)rcv_buf->msg_payload);
-    if (is_aen) {
-      ret = process_NCSI_AEN((AEN_Packet *)rcv_buf->msg_payload);
-    } else {
-      ret = process_NCSI_resp(rcv_buf);
-    }
+// Handle the incoming responses and AENs on the user socket
+static void
+ncsi_rx_handler_nl_usr(struct nl_sock *sk) {
+  static struct nlmsghdr *nlh = NULL;
+  static struct msghdr msg;
+  static struct iovec iov;
+  int msg_size = sizeof(NCSI_NL_RSP_T);
 
-    if (ret == NCSI_IF_REINIT) {
-      handle_ncsi_if_reinit(is_aen);
+  if (!nlh) {
+    nlh = (struct nlmsghdr *)calloc(1, NLMSG_SPACE(msg_size));
+    if (!nlh) {
+      syslog(LOG_ERR, "rx: Error, failed to allocate message buffer");
+      return;
     }
+    iov.iov_base = (void *)nlh;
+    iov.iov_len = NLMSG_SPACE(msg_size);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
   }
 
-  free(nlh);
-  pthread_exit(NULL);
+  /* Read messages from kernel */
+  while (recvmsg(gSock.fd, &msg, MSG_DONTWAIT) > 0) {
+    ncsi_handle_rx((NCSI_NL_RSP_T *)NLMSG_DATA(nlh));
+  }
 }
 
-static void*
-ncsi_rx_handler_libnl(void *args) {
-  int ret = 0;
-  int is_aen;
-  syslog(LOG_INFO, "%s thread started", __FUNCTION__);
-  NCSI_NL_RSP_T *rcv_buf = calloc(1, sizeof(NCSI_NL_RSP_T));
-  if (rcv_buf == NULL) {
-     syslog(LOG_INFO, "%s buf alloc failed", __FUNCTION__);
-     pthread_exit(NULL);
+// Handle the AENs on the libnl multicast socket
+static void
+ncsi_rx_handler_libnl(struct nl_sock *sk) {
+  int ret;
+
+  ret = nl_rcv_msg(sk);
+  if (ret < 0) {
+#if DEBUG
+    syslog(LOG_INFO, "%s: rc = %d\n", __FUNCTION__, ret);
+#endif
+    return;
   }
+#if DEBUG
+  syslog(LOG_INFO, "%s: AEN received\n", __FUNCTION__);
+#endif
+  ncsi_handle_rx(&aenbuf);
+}
 
-  // the last timestamp to call handle_ncsi_config() when processing NCSI_resp
-  last_config_ts.tv_sec = 0;
+// Handle the responses queued by send_nl_data_libnl()
+static void
+ncsi_rx_buffer_drain(NCSI_NL_RSP_T *rcv_buf) {
+  uint64_t cnt;
 
-  while (1) {
-    sem_wait(libnl_rx_buf.semfill);
-    ret = rx_buffer_get(rcv_buf);
-    if (ret != 0)
-      continue;
+  if (read(libnl_rx_buf.evfd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+    syslog(LOG_ERR, "%s: read failed, errno %d", __FUNCTION__, errno);
+  }
+  while (rx_buffer_get(rcv_buf) == 0) {
 #if DEBUG
     syslog(LOG_INFO, "%s rcv_buf->hdr.cmd 0x%x, hdr.len %d", __FUNCTION__, rcv_buf->hdr.cmd, rcv_buf->hdr.payload_length);
-    syslog(LOG_INFO, "%s data 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x 0x%x", __FUNCTION__,
-            rcv_buf->msg_payload[0],
-            rcv_buf->msg_payload[1],
-            rcv_buf->msg_payload[2],
-            rcv_buf->msg_payload[3],
-            rcv_buf->msg_payload[4],
-            rcv_buf->msg_payload[5],
-            rcv_buf->msg_payload[6],
-            rcv_buf->msg_payload[7]);
 #endif
-    is_aen = is_aen_packet((AEN_Packet *)rcv_buf->msg_payload);
-    if (is_aen) {
-      ret = process_NCSI_AEN((AEN_Packet *)rcv_buf->msg_payload);
-    } else {
-      ret = process_NCSI_resp(rcv_buf);
-    }
-
-    if (ret == NCSI_IF_REINIT) {
-      handle_ncsi_if_reinit(is_aen);
-    }
+    ncsi_handle_rx(rcv_buf);
   }
-  syslog(LOG_INFO, "%s exit", __FUNCTION__);
-  pthread_exit(NULL);
 }
 
-
 // Main PLDM monitoring function
 // For every sensor that needs monitoring,
 //   Generate PLDM-over-NC-SI sensor read commands, and sends it over netlink
@@ -1207,58 +1258,68 @@ static int pldm_monitoring(int sock_fd)
 }
 
 
-// Thread to send periodic NC-SI cmmands to check NIC status
-static void*
-ncsi_tx_handler(void *arg) {
+// Send the periodic NC-SI commands to check NIC status
+static void
+ncsi_check_status(generic_msg_t *lsts_msg, generic_msg_t *vid_msg) {
   int ret, sock_fd = gSock.fd;
-  generic_msg_t lsts_msg, vid_msg;
-
-  syslog(LOG_INFO, "ncsi_tx_handler thread started");
-  memset(&lsts_msg, 0, sizeof(lsts_msg));
-  memset(&vid_msg, 0, sizeof(vid_msg));
-  prepare_ncsi_req_msg(&lsts_msg, 0, NCSI_GET_LINK_STATUS, 0, NULL, 0);
-  prepare_ncsi_req_msg(&vid_msg, 0, NCSI_GET_VERSION_ID, 0, NULL, 0);
 
-  while (1) {
-    /* send "Get Link status" message to NIC  */
-    ret = send_nl_data(sock_fd, &lsts_msg);
-    if (ret < 0) {
-      syslog(LOG_ERR, "tx: failed to send lsts_msg, status ret = %d, errno=%d\n",
-             ret, errno);
-    }
-    /* send "Get Version ID" message to NIC  */
-    ret = send_nl_data(sock_fd, &vid_msg);
-    if (ret < 0) {
-      syslog(LOG_ERR, "tx: failed to send vid_msg, status ret = %d, errno=%d\n",
-             ret, errno);
-    }
-
-    if (gEnablePldmMonitoring) {
-      // read any PLDM sensors that's available
-      pldm_monitoring(sock_fd);
-    }
+  /* send "Get Link status" message to NIC  */
+  ret = send_nl_data(sock_fd, lsts_msg);
+  if (ret < 0) {
+    syslog(LOG_ERR, "tx: failed to send lsts_msg, status ret = %d, errno=%d\n",
+           ret, errno);
+    status_err = true;
+  }
+  /* send "Get Version ID" message to NIC  */
+  ret = send_nl_data(sock_fd, vid_msg);
+  if (ret < 0) {
+    syslog(LOG_ERR, "tx: failed to send vid_msg, status ret = %d, errno=%d\n",
+           ret, errno);
+    status_err = true;
+  }
 
-    ret = check_valid_mac_addr();
-    if (ret == NCSI_IF_REINIT) {
-      send_registration_msg(&gSock);
-      enable_aens(&gSock, aen_enable_mask);
-    }
+  if (gEnablePldmMonitoring) {
+    // read any PLDM sensors that's available
+    pldm_monitoring(sock_fd);
+  }
 
-    sleep(NIC_STATUS_SAMPLING_DELAY);
+  ret = check_valid_mac_addr();
+  if (ret == NCSI_IF_REINIT) {
+    status_err = true;
+    send_registration_msg(&gSock);
+    enable_aens(&gSock, aen_enable_mask);
   }
 
-  free_ncsi_req_msg(&lsts_msg);
-  free_ncsi_req_msg(&vid_msg);
-  pthread_exit(NULL);
+  // Back off to the default sampling delay while the NIC is fine
+  if (status_err) {
+    status_delay = NIC_STATUS_ERR_DELAY;
+  } else if (status_delay < NIC_STATUS_SAMPLING_DELAY) {
+    status_delay = MIN(status_delay * 2, NIC_STATUS_SAMPLING_DELAY);
+  }
+  status_err = false;
+  arm_timer(status_tfd, status_delay);
 }
 
+static int
+ncsi_epoll_add(int epfd, int fd, uint32_t src) {
+  struct epoll_event ev = {0};
 
-// Thread to setup netlink and receive AEN
+  ev.events = EPOLLIN;
+  ev.data.u32 = src;
+  return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Thread to setup netlink, and handle the responses, AENs and NIC status
+// checks in one event loop
 static void*
 ncsi_aen_handler(void *arg) {
-  pthread_t tid_rx;
-  pthread_t tid_tx;
-  int ret = 0;
+  struct epoll_event events[4];
+  struct nl_sock *sk = NULL;
+  generic_msg_t lsts_msg, vid_msg;
+  NCSI_NL_RSP_T *rcv_buf = NULL;
+  uint64_t cnt;
+  int epfd = -1, nl_fd = gSock.fd;
+  int ret = 0, i, n;
 
   syslog(LOG_INFO, "ncsid-v2 ncsi_aen_handler thread started\n");
 
@@ -1267,55 +1328,95 @@ ncsi_aen_handler(void *arg) {
     syslog(LOG_ERR, "init_nic_config failed, ret= %d\n", ret);
   }
 
-  if (pthread_create(&tid_rx, NULL, ncsi_rx_handler, NULL) != 0) {
-    syslog(LOG_ERR, "ncsi_aen_handler: pthread_create failed on ncsi_rx_handler, errno %d\n",
-           errno);
-    goto cleanup;
-  }
+  // enable platform-specific AENs
+  enable_aens(&gSock, aen_enable_mask);
+
+  memset(&lsts_msg, 0, sizeof(lsts_msg));
+  memset(&vid_msg, 0, sizeof(vid_msg));
+  prepare_ncsi_req_msg(&lsts_msg, 0, NCSI_GET_LINK_STATUS, 0, NULL, 0);
+  prepare_ncsi_req_msg(&vid_msg, 0, NCSI_GET_VERSION_ID, 0, NULL, 0);
 
-  if (pthread_create(&tid_tx, NULL, ncsi_tx_handler, NULL) != 0) {
-    syslog(LOG_ERR, "ncsi_aen_handler: pthread_create failed on ncsi_tx_handler, errno %d\n",
-           errno);
+  // the last timestamp to call handle_ncsi_config() when processing NCSI_resp
+  last_config_ts.tv_sec = 0;
+
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  status_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  reinit_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (epfd < 0 || status_tfd < 0 || reinit_tfd < 0 ||
+      ncsi_epoll_add(epfd, status_tfd, EV_STATUS) ||
+      ncsi_epoll_add(epfd, reinit_tfd, EV_REINIT)) {
+    syslog(LOG_ERR, "ncsi_aen_handler: error setup events, errno %d\n", errno);
     goto cleanup;
   }
 
-  // enable platform-specific AENs
-  enable_aens(&gSock, aen_enable_mask);
-
   if (islibnl()) {
-    struct nl_sock *sk;
+    rcv_buf = calloc(1, sizeof(NCSI_NL_RSP_T));
     ret = setup_ncsi_mc_socket(&sk, (void *)&aenbuf);
-    if (ret < 0) {
+    if (ret < 0 || rcv_buf == NULL) {
       syslog(LOG_ERR, "ncsi_aen_handler: error setup seocket\n");
       goto cleanup;
     }
+    nl_fd = libnl_get_fd(sk);
+    if (ncsi_epoll_add(epfd, libnl_rx_buf.evfd, EV_RX)) {
+      syslog(LOG_ERR, "ncsi_aen_handler: error setup rx buffer event\n");
+      goto cleanup;
+    }
+  }
+  if (nl_fd < 0 || ncsi_epoll_add(epfd, nl_fd, EV_NL)) {
+    syslog(LOG_ERR, "ncsi_aen_handler: error setup netlink event\n");
+    goto cleanup;
+  }
 
+  if (islibnl()) {
     // set flag to notice BMC ncsid is ready
     kv_set("flag_ncsid", "1", 0, 0);
+  }
 
-    while (1) {
-      ret = nl_rcv_msg(sk);
-      if (ret <0) {
-        syslog(LOG_ERR, "ncsi_aen_handler: rc = %d\n",ret);
-        // delay 30s before checking AENs again to prevent hugging CPU resources
-        //   on error
-        sleep(30);
+  // first NIC status check right away
+  arm_timer(status_tfd, 0);
+  while (1) {
+    n = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), -1);
+    if (n < 0) {
+      if (errno == EINTR)
         continue;
+      syslog(LOG_ERR, "ncsi_aen_handler: epoll_wait failed, errno %d\n", errno);
+      break;
+    }
+    for (i = 0; i < n; i++) {
+      switch (events[i].data.u32) {
+        case EV_STATUS:
+          if (read(status_tfd, &cnt, sizeof(cnt)) > 0) {
+            ncsi_check_status(&lsts_msg, &vid_msg);
+          }
+          break;
+        case EV_REINIT:
+          if (read(reinit_tfd, &cnt, sizeof(cnt)) > 0) {
+            ncsi_reinit_step();
+          }
+          break;
+        case EV_NL:
+          ncsi_rx_handler(sk);
+          break;
+        case EV_RX:
+          ncsi_rx_buffer_drain(rcv_buf);
+          break;
       }
-#if DEBUG
-      syslog(LOG_INFO, "ncsi_aen_handler: AEN received\n");
-#endif
-      ret = rx_buffer_add(&aenbuf);
     }
-    if (sk)
-      libnl_free_socket(sk);
   }
 
 cleanup:
-  if (tid_rx > 0)
-    pthread_join(tid_rx, NULL);
-  if (tid_tx > 0)
-    pthread_join(tid_tx, NULL);
+  if (sk)
+    libnl_free_socket(sk);
+  if (rcv_buf)
+    free(rcv_buf);
+  if (reinit_tfd >= 0)
+    close(reinit_tfd);
+  if (status_tfd >= 0)
+    close(status_tfd);
+  if (epfd >= 0)
+    close(epfd);
+  free_ncsi_req_msg(&lsts_msg);
+  free_ncsi_req_msg(&vid_msg);
   pthread_exit(NULL);
 }
 
@@ -1362,9 +1463,12 @@ int rx_buffer_add(NCSI_NL_RSP_T *pdata)
   if (libnl_rx_buf.len < RX_BUF_SIZE)
     libnl_rx_buf.len++;
 
-  // post semfill to wake up rx thread
-  sem_post(libnl_rx_buf.semfill);
   pthread_mutex_unlock(&libnl_rx_buf.rx_mutex);
+
+  // wake up the event loop
+  if (eventfd_write(libnl_rx_buf.evfd, 1) < 0) {
+    syslog(LOG_ERR, "%s: failed to post rx event\n", __FUNCTION__);
+  }
   return 0;
 }
 
@@ -1375,8 +1479,8 @@ int rx_buffer_cleanup(void)
   for (i = 0; i < RX_BUF_SIZE; ++i)
     if (libnl_rx_buf.buf[i])
       free(libnl_rx_buf.buf[i]);
-  if (libnl_rx_buf.semfill)
-    sem_close(libnl_rx_buf.semfill);
+  if (libnl_rx_buf.evfd >= 0)
+    close(libnl_rx_buf.evfd);
   pthread_mutex_destroy(&(libnl_rx_buf.rx_mutex));
   return 0;
 }
@@ -1396,23 +1500,9 @@ int setup_rx_buffer(void)
     }
   }
 
-  libnl_rx_buf.semfill = sem_open(fillcnt_sem_path, O_CREAT | O_EXCL, 0644, 0);
-  if (libnl_rx_buf.semfill == SEM_FAILED) {
-    if (errno == EEXIST) {
-      libnl_rx_buf.semfill = sem_open(fillcnt_sem_path, 0);
-      if (libnl_rx_buf.semfill == SEM_FAILED) {
-        syslog(LOG_ERR, "%s: failed retry semfill\n", __FUNCTION__);
-        ret = -1;
-        goto errout;
-      }
-    } else {
-      syslog(LOG_ERR, "%s: failed semfill\n", __FUNCTION__);
-      ret = -1;
-      goto errout;
-    }
-  }
-  if (sem_init(libnl_rx_buf.semfill, 0, 0) != 0) {
-    syslog(LOG_ERR, "%s: failed semfill init\n", __FUNCTION__);
+  libnl_rx_buf.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (libnl_rx_buf.evfd < 0) {
+    syslog(LOG_ERR, "%s: failed rx eventfd\n", __FUNCTION__);
     ret = -1;
     goto errout;
   }
@@ -42,6 +42,8 @@ struct oob_intf_t {
   int oi_ifidx;
   uint8_t oi_mac[6];
   struct rtnl_handle oi_rth;
+  /* link notifications, keeping the ll_map cache current */
+  struct rtnl_handle oi_mon;
 };
 
 #define TUN_DEVICE "/dev/net/tun"
@@ -133,10 +135,15 @@ oob_intf* oob_intf_create(const char *name, const uint8_t mac[6]) {
   strncpy(intf->oi_name, name, sizeof(intf->oi_name));
   intf->oi_name[sizeof(intf->oi_name) - 1] = '\0';
   intf->oi_fd = -1;
+  intf->oi_rth.fd = -1;
+  intf->oi_mon.fd = -1;
 
   rc = rtnl_open(&intf->oi_rth, 0);
   _CHECK_RC("Failed to open rth_handler");
 
+  rc = rtnl_open(&intf->oi_mon, RTMGRP_LINK);
+  _CHECK_RC("Failed to open the link monitor");
+
   rc = open(TUN_DEVICE, O_RDWR);
   _CHECK_RC("Failed to open %s", TUN_DEVICE);
   intf->oi_fd = rc;
@@ -170,6 +177,12 @@ oob_intf* oob_intf_create(const char *name, const uint8_t mac[6]) {
             " to fd ", intf->oi_fd);
 
   // TODO: if needed, we can adjust send buffer size, TUNSETSNDBUF
+
+  /*
+   * the tap link exists now, load the link cache. From here on the link
+   * state comes from the notifications on oi_mon, see oob_intf_update().
+   */
+  ll_init_map(&intf->oi_mon);
   intf->oi_ifidx = ll_name_to_index(intf->oi_name);
 
   /* now set the mac address */
@@ -191,6 +204,7 @@ oob_intf* oob_intf_create(const char *name, const uint8_t mac[6]) {
  err_out:
   if (intf) {
     rtnl_close(&intf->oi_rth);
+    rtnl_close(&intf->oi_mon);
     if (intf->oi_fd != -1) {
       close(intf->oi_fd);
     }
@@ -204,6 +218,34 @@ int oob_intf_get_fd(const oob_intf *intf) {
   return intf->oi_fd;
 }
 
+int oob_intf_get_mon_fd(const oob_intf *intf) {
+  return intf->oi_mon.fd;
+}
+
+int oob_intf_update(oob_intf *intf) {
+  bool was_up = oob_intf_is_up(intf);
+  int rc;
+
+  rc = ll_update_map(&intf->oi_mon);
+  if (rc < 0) {
+    rc = errno;
+    OBMC_ERROR(rc, "Failed to receive link notifications");
+    return -rc;
+  }
+
+  if (oob_intf_is_up(intf) != was_up) {
+    OBMC_INFO("Interface %s @ index %d is %s", intf->oi_name,
+              intf->oi_ifidx, was_up ? "down" : "up");
+  }
+
+  return 0;
+}
+
+bool oob_intf_is_up(const oob_intf *intf) {
+  /* unknown links report all flags set, so they are tried anyway */
+  return (ll_index_to_flags(intf->oi_ifidx) & IFF_UP) != 0;
+}
+
 int oob_intf_receive(const oob_intf *intf, char *buf, int len) {
   int rc;
   do {
@@ -18,6 +18,7 @@
 #ifndef INTF_H
 #define INTF_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct oob_intf_t oob_intf;
@@ -25,6 +26,14 @@ typedef struct oob_intf_t oob_intf;
 oob_intf* oob_intf_create(const char *name, const uint8_t mac[6]);
 int oob_intf_get_fd(const oob_intf *intf);
 
+/*
+ * The link state is cached from netlink notifications. Call
+ * oob_intf_update() when the fd of oob_intf_get_mon_fd() is readable.
+ */
+int oob_intf_get_mon_fd(const oob_intf *intf);
+int oob_intf_update(oob_intf *intf);
+bool oob_intf_is_up(const oob_intf *intf);
+
 int oob_intf_receive(const oob_intf *intf, char *buf, int len);
 int oob_intf_send(const oob_intf *intf, const char *buf, int len);
 
@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <sys/socket.h>
@@ -117,6 +118,7 @@ int ll_remember_index(const struct sockaddr_nl *who,
 			hlist_del(&im->name_hash);
 			h = namehash(ifname) & (IDXMAP_SIZE - 1);
 			hlist_add_head(&im->name_hash, &name_head[h]);
+			strcpy(im->name, ifname);
 		}
 
 		im->flags = ifi->ifi_flags;
@@ -223,3 +225,77 @@ void ll_init_map(struct rtnl_handle *rth)
 
 	initialized = 1;
 }
+
+static void ll_flush_map(void)
+{
+	struct hlist_node *n, *tmp;
+	int h;
+
+	for (h = 0; h < IDXMAP_SIZE; h++) {
+		hlist_for_each_safe(n, tmp, &idx_head[h]) {
+			struct ll_cache *im
+				= container_of(n, struct ll_cache, idx_hash);
+
+			hlist_del(&im->name_hash);
+			hlist_del(&im->idx_hash);
+			free(im);
+		}
+	}
+}
+
+/*
+ * Apply the link changes queued on <rth>, opened with the RTMGRP_LINK
+ * group and filled by ll_init_map(), without blocking. If the kernel
+ * dropped events, the cache is rebuilt from a new dump.
+ * Return the number of messages applied, or -1 on a receive error.
+ */
+int ll_update_map(struct rtnl_handle *rth)
+{
+	struct sockaddr_nl nladdr;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	char buf[8192];
+	struct nlmsghdr *h;
+	int status;
+	int count = 0;
+
+	iov.iov_base = buf;
+	while (1) {
+		iov.iov_len = sizeof(buf);
+		status = recvmsg(rth->fd, &msg, MSG_DONTWAIT);
+
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return count;
+			if (errno != ENOBUFS)
+				return -1;
+			/* events were lost, start over */
+			ll_flush_map();
+			if (rtnl_wilddump_request(rth, AF_UNSPEC, RTM_GETLINK) < 0)
+				return -1;
+			if (rtnl_dump_filter(rth, ll_remember_index, NULL) < 0)
+				return -1;
+			count++;
+			continue;
+		}
+		if (status == 0)
+			return -1;
+
+		/* only the kernel sends link notifications */
+		if (nladdr.nl_pid != 0)
+			continue;
+
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, status);
+		     h = NLMSG_NEXT(h, status)) {
+			ll_remember_index(&nladdr, h, NULL);
+			count++;
+		}
+	}
+}
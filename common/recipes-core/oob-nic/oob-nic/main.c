@@ -38,6 +38,8 @@ static void io_loop(oob_nic *nic, oob_intf *intf, const uint8_t mac[6]) {
 
   fd_set rfds;
   int fd = oob_intf_get_fd(intf);
+  int mon_fd = oob_intf_get_mon_fd(intf);
+  int max_fd = (fd > mon_fd) ? fd : mon_fd;
   struct timeval timeout;
   int rc;
   int n_fds;
@@ -53,14 +55,19 @@ static void io_loop(oob_nic *nic, oob_intf *intf, const uint8_t mac[6]) {
 
     FD_ZERO(&rfds);
     FD_SET(fd, &rfds);
+    FD_SET(mon_fd, &rfds);
 
-    n_fds = select(fd + 1, &rfds, NULL, NULL, &timeout);
+    n_fds = select(max_fd + 1, &rfds, NULL, NULL, &timeout);
     if (n_fds < 0) {
       rc = errno;
       OBMC_ERROR(rc, "Failed to select");
       continue;
     }
 
+    if (n_fds > 0 && FD_ISSET(mon_fd, &rfds)) {
+      oob_intf_update(intf);
+    }
+
     /*
      * no matter what, receive packet from nic first, as the nic
      * has small amount of memory. Without read, the sending could
@@ -76,7 +83,10 @@ static void io_loop(oob_nic *nic, oob_intf *intf, const uint8_t mac[6]) {
         no_rcv++;
         break;
       }
-      oob_intf_send(intf, buf, rc);
+      /* the tap refuses packets while down, drop them right here */
+      if (oob_intf_is_up(intf)) {
+        oob_intf_send(intf, buf, rc);
+      }
       no_rcv = 0;
     }
 
@@ -25,17 +25,37 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <peci.h>
 #include <linux/peci-ioctl.h>
 
 #define MAX_ARG_NUM 64
+#define MAX_BATCH_CMDS 4096
+
+enum {
+  BATCH_JSON = 0,
+  BATCH_BINARY,
+};
+
+// Command of a batch, and its result
+typedef struct {
+  uint8_t addr;
+  uint8_t tx_len;
+  uint8_t rx_len;
+  uint8_t tbuf[PECI_BUFFER_SIZE];
+  uint8_t rbuf[PECI_BUFFER_SIZE];
+  int status;  // 0, or the errno of a failed transfer
+  uint8_t retries;
+} batch_cmd_t;
 
 int __attribute__((weak)) pal_before_peci(void) { return 0; }
 int __attribute__((weak)) pal_after_peci(void) { return 0; }
 
 static int process_file(char *file_path);
+static int process_batch(const char *path, int format);
 
 static uint8_t retry_times = 0;
 static uint32_t retry_interval = 250;
@@ -52,6 +72,12 @@ print_usage_help(void) {
   printf("         Interval between retry, unit is ms. Default is 250\n");
   printf("       --file, -f <file>\n");
   printf("         Read commands from <file>\n");
+  printf("       --batch, -b <file>\n");
+  printf("         Run the commands of <file> (- for stdin), one\n");
+  printf("         \"<client addr> <Tx length> <Rx length> <data>\" per line,\n");
+  printf("         over a single open PECI device\n");
+  printf("       --format, -F <json|binary>\n");
+  printf("         Output of --batch. Default is json\n");
   printf("       --verbose, -v\n");
   printf("         Display verbose information\n");
   printf("       --help, -h\n");
@@ -64,13 +90,17 @@ process_command(int argc, char **argv) {
   uint8_t tbuf[PECI_BUFFER_SIZE], rbuf[PECI_BUFFER_SIZE];
   uint8_t addr, tx_len, rx_len;
   char file_path[256];
+  const char *batch_path = NULL;
+  int batch_format = BATCH_JSON;
   int i, opt, retry;
   int optind_long = 0;
-  static const char* optstring = "r:i:f:vh";
+  static const char* optstring = "r:i:f:b:F:vh";
   static const struct option long_options[] = {
     {"retry", required_argument, 0, 'r'},
     {"interval", required_argument, 0, 'i'},
     {"file", required_argument, 0, 'f'},
+    {"batch", required_argument, 0, 'b'},
+    {"format", required_argument, 0, 'F'},
     {"verbose", no_argument, 0, 'v'},
     {"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
@@ -88,6 +118,19 @@ process_command(int argc, char **argv) {
     case 'f':
       strncpy(file_path, optarg, sizeof(file_path) - 1);
       return process_file(file_path);
+    case 'b':
+      batch_path = optarg;
+      break;
+    case 'F':
+      if (!strcmp(optarg, "json")) {
+        batch_format = BATCH_JSON;
+      } else if (!strcmp(optarg, "binary")) {
+        batch_format = BATCH_BINARY;
+      } else {
+        printf("Unknown format %s\n", optarg);
+        goto err_exit;
+      }
+      break;
     case 'v':
       verbose = 1;
       break;
@@ -100,6 +143,10 @@ process_command(int argc, char **argv) {
     }
   }
 
+  if (batch_path) {
+    return process_batch(batch_path, batch_format);
+  }
+
   if (argc - optind < 3) {
     goto err_exit;
   }
@@ -214,6 +261,186 @@ process_file(char *path) {
   return final_ret;
 }
 
+// Parse "<addr> <tx len> <rx len> <data...>", 1 for a blank line
+static int
+parse_batch_line(char *line, batch_cmd_t *cmd) {
+  char *str, *next, *del = " \t\r\n";
+  unsigned long vals[3 + PECI_BUFFER_SIZE];
+  int n = 0;
+
+  for (str = strtok_r(line, del, &next); str && str[0] != '#';
+       str = strtok_r(NULL, del, &next)) {
+    if (n == 3 + PECI_BUFFER_SIZE) {
+      return -1;
+    }
+    vals[n++] = strtoul(str, NULL, 0);
+  }
+  if (n == 0) {
+    return 1;
+  }
+  if (n < 3 || vals[1] > PECI_BUFFER_SIZE || vals[2] > PECI_BUFFER_SIZE ||
+      n - 3 != (int)vals[1]) {
+    return -1;
+  }
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->addr = (uint8_t)vals[0];
+  cmd->tx_len = (uint8_t)vals[1];
+  cmd->rx_len = (uint8_t)vals[2];
+  for (n = 0; n < cmd->tx_len; n++) {
+    cmd->tbuf[n] = (uint8_t)vals[3 + n];
+  }
+  return 0;
+}
+
+static void
+batch_xfer(int fd, batch_cmd_t *cmd) {
+  struct peci_xfer_msg msg;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.addr = cmd->addr;
+  msg.tx_len = cmd->tx_len;
+  msg.rx_len = cmd->rx_len;
+  memcpy(msg.tx_buf, cmd->tbuf, cmd->tx_len);
+  if (ioctl(fd, PECI_IOC_XFER, &msg) < 0) {
+    cmd->status = errno;
+    return;
+  }
+  cmd->status = 0;
+  memcpy(cmd->rbuf, msg.rx_buf, cmd->rx_len);
+}
+
+// CC asking to retry the command later, see process_command()
+static int
+batch_needs_retry(const batch_cmd_t *cmd) {
+  return !cmd->status && cmd->rx_len > 0 &&
+         (cmd->rbuf[0] == 0x80 || cmd->rbuf[0] == 0x81);
+}
+
+static void
+batch_output(const batch_cmd_t *cmds, int count, int format) {
+  int i, j;
+
+  if (format == BATCH_BINARY) {
+    // Per command: status (errno, 0 on success), retries, rx length, rx data
+    for (i = 0; i < count; i++) {
+      uint8_t hdr[3] = {(uint8_t)cmds[i].status, cmds[i].retries,
+                        cmds[i].status ? 0 : cmds[i].rx_len};
+      fwrite(hdr, sizeof(hdr), 1, stdout);
+      fwrite(cmds[i].rbuf, 1, hdr[2], stdout);
+    }
+    return;
+  }
+
+  printf("[");
+  for (i = 0; i < count; i++) {
+    printf("%s\n {\"addr\": %u, \"tx\": \"", i ? "," : "", cmds[i].addr);
+    for (j = 0; j < cmds[i].tx_len; j++) {
+      printf("%02x", cmds[i].tbuf[j]);
+    }
+    if (cmds[i].status) {
+      printf("\", \"error\": \"%s\"", strerror(cmds[i].status));
+    } else {
+      printf("\", \"rx\": \"");
+      for (j = 0; j < cmds[i].rx_len; j++) {
+        printf("%02x", cmds[i].rbuf[j]);
+      }
+      printf("\"");
+    }
+    printf(", \"retries\": %u}", cmds[i].retries);
+  }
+  printf("\n]\n");
+}
+
+/*
+ * Runs every command of the file over one PECI fd, with the device lock
+ * taken once. Commands asking to be retried are retried together after
+ * the pass, one retry interval for all of them rather than one each.
+ */
+static int
+process_batch(const char *path, int format) {
+  FILE *fp = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  batch_cmd_t *cmds = NULL, *tmp;
+  int count = 0, size = 0, lineno = 0, fd, i, pending, ret = 0;
+  uint8_t round;
+  char buf[1024];
+
+  if (!fp) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return -1;
+  }
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+    lineno++;
+    if (count == size) {
+      if (size == MAX_BATCH_CMDS) {
+        fprintf(stderr, "More than %d commands\n", MAX_BATCH_CMDS);
+        ret = -1;
+        break;
+      }
+      size = size ? size * 2 : 64;
+      tmp = realloc(cmds, size * sizeof(*cmds));
+      if (!tmp) {
+        ret = -1;
+        break;
+      }
+      cmds = tmp;
+    }
+    i = parse_batch_line(buf, &cmds[count]);
+    if (i < 0) {
+      fprintf(stderr, "%s:%d: bad command\n", path, lineno);
+      ret = -1;
+      break;
+    }
+    if (i == 0) {
+      count++;
+    }
+  }
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  if (ret || count == 0) {
+    free(cmds);
+    return ret;
+  }
+
+  if (peci_Lock(&fd, PECI_WAIT_FOREVER) != PECI_CC_SUCCESS) {
+    perror("peci_Lock");
+    free(cmds);
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    batch_xfer(fd, &cmds[i]);
+  }
+  for (round = 0; round < retry_times; round++) {
+    pending = 0;
+    for (i = 0; i < count; i++) {
+      pending += batch_needs_retry(&cmds[i]);
+    }
+    if (!pending) {
+      break;
+    }
+    if (verbose) {
+      fprintf(stderr, "retrying %d commands...\n", pending);
+    }
+    usleep(retry_interval * 1000);
+    for (i = 0; i < count; i++) {
+      if (batch_needs_retry(&cmds[i])) {
+        cmds[i].retries++;
+        batch_xfer(fd, &cmds[i]);
+      }
+    }
+  }
+  peci_Unlock(fd);
+
+  batch_output(cmds, count, format);
+  for (i = 0; i < count; i++) {
+    if (cmds[i].status) {
+      ret = -1;
+    }
+  }
+  free(cmds);
+  return ret;
+}
+
 int
 main(int argc, char **argv) {
   int ret;
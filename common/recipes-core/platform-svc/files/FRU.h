@@ -107,6 +107,24 @@ class FRU : public Object {
       return hotPlugSupport_;
     }
 
+    /*
+     * Sets pfd to poll for a change of availability, see
+     * HotPlugDetectionMechanism::getEvent
+     */
+    bool getHotPlugEvent(struct pollfd & pfd) {
+      return isIntHPDetectionSupported() &&
+             hotPlugDetectionMechanism_->getEvent(pfd);
+    }
+
+    /*
+     * Consumes the polled event of getHotPlugEvent
+     */
+    void clearHotPlugEvent() {
+      if (isIntHPDetectionSupported()) {
+        hotPlugDetectionMechanism_->clearEvent();
+      }
+    }
+
     /*
      * Detect if fru is available or not and return availability status
      */
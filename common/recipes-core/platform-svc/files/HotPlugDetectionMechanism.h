@@ -19,6 +19,7 @@
  */
 
 #pragma once
+#include <poll.h>
 
 namespace openbmc {
 namespace qin {
@@ -27,10 +28,26 @@ namespace qin {
  */
 class HotPlugDetectionMechanism {
   public:
+    virtual ~HotPlugDetectionMechanism() {}
+
     /*
      * Detects availability of FRU and returns whether fru is available or not
      */
     virtual bool detectAvailability() = 0;
+
+    /*
+     * Sets pfd to the fd and events to poll for a possible change of
+     * availability. Returns false if changes can only be found by polling
+     * detectAvailability().
+     */
+    virtual bool getEvent(struct pollfd & pfd) {
+      return false;
+    }
+
+    /*
+     * Consumes the event polled from getEvent() before polling again
+     */
+    virtual void clearEvent() {}
 };
 } // namespace qin
 } // namespace openbmc
@@ -20,6 +20,10 @@
 
 #pragma once
 #include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 #include <glog/logging.h>
 #include "HotPlugDetectionMechanism.h"
 
@@ -30,6 +34,8 @@ class HotPlugDetectionViaPath : public HotPlugDetectionMechanism {
   private:
     std::string path_;                // Path of the file from which
                                       // status of FRU can be detected
+    int eventFd_{-1};                 // fd polled for changes of path_
+    bool sysfs_{false};               // sysfs attribute (e.g. gpio value)
 
   public:
     /*
@@ -37,6 +43,15 @@ class HotPlugDetectionViaPath : public HotPlugDetectionMechanism {
      */
     HotPlugDetectionViaPath(const std::string & path) : path_(path) {}
 
+    ~HotPlugDetectionViaPath() {
+      if (eventFd_ >= 0) {
+        close(eventFd_);
+      }
+    }
+
+    HotPlugDetectionViaPath(const HotPlugDetectionViaPath &) = delete;
+    HotPlugDetectionViaPath& operator=(const HotPlugDetectionViaPath &) = delete;
+
     /*
      * Detects availability of FRU by reading file at path_ and
      * returns whether fru is available
@@ -55,6 +70,67 @@ class HotPlugDetectionViaPath : public HotPlugDetectionMechanism {
       }
       return available;
     }
+
+    /*
+     * A sysfs attribute, such as the value of a gpio with its edge set,
+     * is polled for POLLPRI (sysfs_notify). Any other file is watched
+     * with inotify on its directory, so that it is still seen when
+     * created or replaced.
+     */
+    bool getEvent(struct pollfd & pfd) {
+      if (eventFd_ < 0 && !openEvent()) {
+        return false;
+      }
+      pfd.fd = eventFd_;
+      pfd.events = sysfs_ ? (POLLPRI | POLLERR) : POLLIN;
+      pfd.revents = 0;
+      return true;
+    }
+
+    void clearEvent() {
+      char buf[4096];
+      if (eventFd_ < 0) {
+        return;
+      }
+      if (sysfs_) {
+        // the attribute has to be read again to rearm POLLPRI
+        if (pread(eventFd_, buf, sizeof(buf), 0) < 0) {
+          LOG(ERROR) << "Could not read " << path_;
+        }
+      }
+      else {
+        while (read(eventFd_, buf, sizeof(buf)) > 0) {
+        }
+      }
+    }
+
+  private:
+    bool openEvent() {
+      if (path_.compare(0, 5, "/sys/") == 0) {
+        sysfs_ = true;
+        eventFd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (eventFd_ >= 0) {
+          clearEvent();
+        }
+      }
+      else {
+        size_t pos = path_.rfind('/');
+        std::string dir = pos == std::string::npos ? "." :
+                          pos == 0 ? "/" : path_.substr(0, pos);
+        eventFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (eventFd_ >= 0 &&
+            inotify_add_watch(eventFd_, dir.c_str(),
+                              IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE |
+                              IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+          close(eventFd_);
+          eventFd_ = -1;
+        }
+      }
+      if (eventFd_ < 0) {
+        LOG(WARNING) << "Could not watch " << path_ << ", polling it";
+      }
+      return eventFd_ >= 0;
+    }
 };
 } // namespace qin
 } // namespace openbmc
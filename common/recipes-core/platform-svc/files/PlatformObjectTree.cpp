@@ -373,6 +373,36 @@ void PlatformObjectTree::checkHotPlugSupportedFrusRec(const Object & obj) {
   }
 }
 
+int PlatformObjectTree::getHotPlugEventsRec(const Object & obj,
+                                            std::vector<struct pollfd> & pfds,
+                                            std::vector<FRU*> & frus) {
+  int nofPolledFrus = 0;
+
+  for (auto &it : obj.getChildMap()) {
+    FRU* fru;
+    if ((fru = dynamic_cast<FRU*>(it.second)) != nullptr) {
+      if (fru->isIntHPDetectionSupported()) {
+        struct pollfd pfd;
+        if (fru->getHotPlugEvent(pfd)) {
+          pfds.push_back(pfd);
+          frus.push_back(fru);
+        }
+        else {
+          nofPolledFrus++;
+        }
+      }
+
+      //Children of unavailable fru are not checked, as in
+      //checkHotPlugSupportedFrusRec
+      if (fru->isAvailable()) {
+        nofPolledFrus += getHotPlugEventsRec(*fru, pfds, frus);
+      }
+    }
+  }
+
+  return nofPolledFrus;
+}
+
 void PlatformObjectTree::changeInFruAvailabilityHandler(const FRU & fru) {
   bool isAvailable = fru.isAvailable();
 
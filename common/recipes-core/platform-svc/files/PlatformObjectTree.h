@@ -156,6 +156,20 @@ class PlatformObjectTree : public ObjectTree {
       checkHotPlugSupportedFrusRec(*getObject(platformServiceBasePath_));
     }
 
+    /*
+     * Collects the events to poll for a change in availability of the
+     * frus checked by checkHotPlugSupportedFrus, pfds[i] being the event
+     * of frus[i]. Returns the number of those frus without event, which
+     * need to be polled.
+     */
+    int getHotPlugEvents(std::vector<struct pollfd> & pfds,
+                         std::vector<FRU*> & frus) {
+      pfds.clear();
+      frus.clear();
+      return getHotPlugEventsRec(*getObject(platformServiceBasePath_),
+                                 pfds, frus);
+    }
+
     /*
      * Sets availability of fru at fruPath
      * Returns if operation is successful
@@ -200,6 +214,13 @@ class PlatformObjectTree : public ObjectTree {
      */
     void checkHotPlugSupportedFrusRec(const Object & obj);
 
+    /**
+     * Recursively collects the hotplug events of frus under obj subtree
+     */
+    int getHotPlugEventsRec(const Object & obj,
+                            std::vector<struct pollfd> & pfds,
+                            std::vector<FRU*> & frus);
+
     /**
      * Updates fru service and sensor service on change in fru availability
      */
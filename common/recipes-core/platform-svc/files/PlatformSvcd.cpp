@@ -19,9 +19,13 @@
  */
 
 #include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <fstream>
 #include <string>
 #include <thread>
+#include <vector>
+#include <poll.h>
 #include <glog/logging.h>
 #include <gflags/gflags.h>
 #include <gio/gio.h>
@@ -51,6 +55,11 @@ DEFINE_string(json, "",
 static const bool regDummy =
   ::gflags::RegisterFlagValidator(&FLAGS_json, &validateFilename);
 
+DEFINE_int32(hotplug_poll_interval, 5,
+             "Seconds between hotplug checks of frus without events");
+DEFINE_int32(hotplug_fallback_interval, 60,
+             "Seconds between hotplug checks if all frus have events");
+
 // implementation for handling DBus request messages
 static DBusObjectInterface objectInterface;
 
@@ -116,18 +125,33 @@ static void fruServiceOnNameVanished (GDBusConnection *connection,
 }
 
 /*
- * Monitors hotplug supported frus every 5 seconds
+ * Monitors hotplug supported frus on their events (gpio edge, inotify),
+ * polling the frus without event every hotplug_poll_interval seconds
  */
 static void hotPlugMonitor(PlatformObjectTree* platformTree) {
   LOG(INFO) << "hotPlugMonitor started";
 
   if (platformTree->getNofHPIntDetectSupportedFrus() > 0) {
+    std::vector<struct pollfd> pfds;
+    std::vector<FRU*> frus;
     while (true) {
       //Check for hot plug supported frus
       platformTree->checkHotPlugSupportedFrus();
 
-      //Sleep for 5 seconds
-      std::this_thread::sleep_for(std::chrono::seconds(5));
+      //Availability decides the frus to watch, collect them again
+      int nofPolledFrus = platformTree->getHotPlugEvents(pfds, frus);
+      int timeout = nofPolledFrus > 0 ? FLAGS_hotplug_poll_interval
+                                      : FLAGS_hotplug_fallback_interval;
+      int ret = poll(pfds.data(), pfds.size(), timeout * 1000);
+      if (ret < 0 && errno != EINTR) {
+        LOG(ERROR) << "poll of hotplug events failed: " << strerror(errno);
+        std::this_thread::sleep_for(std::chrono::seconds(timeout));
+      }
+      for (size_t i = 0; ret > 0 && i < pfds.size(); i++) {
+        if (pfds[i].revents) {
+          frus[i]->clearHotPlugEvent();
+        }
+      }
     }
   }
   else {
@@ -44,6 +44,27 @@ TEST(HotPlugDetectionMechanismTest, HotPlugDetectionViaPathTest) {
   ASSERT_FALSE(hpDetect.detectAvailability());
 }
 
+TEST(HotPlugDetectionMechanismTest, HotPlugDetectionViaPathEventTest) {
+  HotPlugDetectionFile file("/tmp/hpDetectViaPathEventTest");
+  HotPlugDetectionViaPath hpDetect(file.getFileName());
+  struct pollfd pfd;
+
+  //Regular file is watched with inotify
+  ASSERT_TRUE(hpDetect.getEvent(pfd));
+  ASSERT_GE(pfd.fd, 0);
+  ASSERT_EQ(poll(&pfd, 1, 0), 0);
+
+  //write fru status to file, the change should be polled
+  file.writeHotPlugStatusToFile(1);
+  ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+  ASSERT_TRUE(hpDetect.detectAvailability());
+
+  //no event after clearEvent
+  hpDetect.clearEvent();
+  ASSERT_TRUE(hpDetect.getEvent(pfd));
+  ASSERT_EQ(poll(&pfd, 1, 0), 0);
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
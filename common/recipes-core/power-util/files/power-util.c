@@ -27,6 +27,8 @@
 #include <getopt.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 #include <openbmc/kv.h>
 #include <openbmc/pal.h>
 
@@ -34,6 +36,9 @@
 #define POWER_OFF_STR       "off"
 
 #define MAX_RETRIES          10
+#define PWR_WAIT_MS          3000  // per retry, see wait_server_power()
+#define PWR_POLL_MS          100
+#define MAX_PWR_WORKERS      4
 
 #ifndef PWR_OPTION_LIST
 #define PWR_OPTION_LIST "status, graceful-shutdown, off, on, reset, cycle, " \
@@ -86,6 +91,63 @@ static const char *option_list[] = {
 };
 
 
+static uint64_t
+now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Poll until the server reports <state>, up to <timeout_ms>
+static int
+wait_server_power(uint8_t fru, uint8_t state, int timeout_ms, uint8_t *status) {
+  uint64_t deadline = now_ms() + timeout_ms;
+  int ret;
+
+  do {
+    usleep(PWR_POLL_MS * 1000);
+    ret = pal_get_server_power(fru, status);
+    if (ret >= 0 && *status == state) {
+      return 0;
+    }
+  } while (now_ms() < deadline);
+
+  return ret < 0 ? ret : -1;
+}
+
+static int
+wait_device_power(uint8_t fru, uint8_t dev_id, uint8_t state, int timeout_ms,
+                  uint8_t *status) {
+  uint64_t deadline = now_ms() + timeout_ms;
+  uint8_t type;
+  int ret;
+
+  do {
+    usleep(PWR_POLL_MS * 1000);
+    ret = pal_get_device_power(fru, dev_id, status, &type);
+    if (ret >= 0 && *status == state) {
+      return 0;
+    }
+  } while (now_ms() < deadline);
+
+  return ret < 0 ? ret : -1;
+}
+
+// Wait for the host side to come up after 12V is restored
+static void
+wait_server_12v_on(uint8_t fru, int timeout_ms) {
+  uint64_t deadline = now_ms() + timeout_ms;
+  uint8_t status;
+
+  do {
+    usleep(PWR_POLL_MS * 1000);
+    if (pal_get_server_power(fru, &status) >= 0 && status != SERVER_12V_OFF) {
+      return;
+    }
+  } while (now_ms() < deadline);
+}
+
 static void
 print_usage() {
   const char *fru_list = pal_server_list;
@@ -197,12 +259,12 @@ power_policy_control(uint8_t fru, char *last_ps, bool force) {
       last_ps = pwr_state;
     }
     if (!(strcmp(last_ps, "on"))) {
-      sleep(3);
+      wait_server_12v_on(fru, PWR_WAIT_MS);
       pal_set_server_power(fru, SERVER_POWER_ON);
     }
   }
   else if(power_policy == POWER_CFG_ON) {
-    sleep(3);
+    wait_server_12v_on(fru, PWR_WAIT_MS);
     pal_set_server_power(fru, SERVER_POWER_ON);
   }
 }
@@ -260,9 +322,8 @@ dev_power_util(uint8_t fru, char *dev_name, uint8_t dev_id ,uint8_t opt) {
       }
 
       for (retries = 0; retries < MAX_RETRIES; retries++) {
-         sleep(3);
-         ret = pal_get_device_power(fru, dev_id, &status, &type);
-         if ((ret >= 0) && (status == SERVER_POWER_ON)) {
+         ret = wait_device_power(fru, dev_id, SERVER_POWER_ON, PWR_WAIT_MS, &status);
+         if (ret == 0) {
            syslog(LOG_CRIT, "SERVER_POWER_ON successful for FRU: %u DEV: %s", fru, dev_name);
            break;
          }
@@ -417,9 +478,8 @@ power_util(uint8_t fru, uint8_t opt, bool force) {
       }
 
       for (retries = 0; retries < MAX_RETRIES; retries++) {
-         sleep(3);
-         ret = pal_get_server_power(fru, &status);
-         if ((ret >= 0) && (status == SERVER_POWER_ON)) {
+         ret = wait_server_power(fru, SERVER_POWER_ON, PWR_WAIT_MS, &status);
+         if (ret == 0) {
            syslog(LOG_CRIT, "SERVER_POWER_ON successful for FRU: %d", fru);
            break;
          }
@@ -590,6 +650,112 @@ rm_process_running_flag(uint8_t slot_id, uint8_t opt) {
   }
 }
 
+typedef struct {
+  uint8_t fru;
+  int ret;
+  uint64_t elapsed_ms;
+} pwr_job_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pwr_job_t *jobs;
+  int num_jobs;
+  int next;
+  uint8_t opt;
+  bool force;
+} pwr_pool_t;
+
+static void *
+pwr_worker(void *arg) {
+  pwr_pool_t *pool = (pwr_pool_t *)arg;
+  pwr_job_t *job;
+  uint64_t start;
+  uint8_t root = 0, lock_fru;
+
+  while (1) {
+    pthread_mutex_lock(&pool->lock);
+    job = pool->next < pool->num_jobs ? &pool->jobs[pool->next++] : NULL;
+    pthread_mutex_unlock(&pool->lock);
+    if (job == NULL) {
+      break;
+    }
+
+    lock_fru = pal_get_root_fru(job->fru, &root) == PAL_EOK ? root : job->fru;
+    if (add_process_running_flag(lock_fru, pool->opt) < 0) {
+      job->ret = -2;
+      continue;
+    }
+    start = now_ms();
+    job->ret = power_util(job->fru, pool->opt, pool->force);
+    job->elapsed_ms = now_ms() - start;
+    rm_process_running_flag(lock_fru, pool->opt);
+  }
+
+  return NULL;
+}
+
+/*
+ * Run <opt> on every present server FRU, at most MAX_PWR_WORKERS at a
+ * time. Each FRU still goes through power_util() start to end in its
+ * own worker, so its syslog and last power state updates keep their
+ * order; only different FRUs overlap.
+ */
+static int
+power_util_all(uint8_t opt, bool force) {
+  pwr_job_t jobs[MAX_NUM_FRUS];
+  pwr_pool_t pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .jobs = jobs,
+    .opt = opt,
+    .force = force,
+  };
+  pthread_t tid[MAX_PWR_WORKERS];
+  char name[64];
+  uint8_t status;
+  int fru, i, num_workers = 0, ret = 0;
+
+  for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
+    if (pal_is_slot_server(fru) != 1 ||
+        pal_is_fru_prsnt(fru, &status) < 0 || status == 0) {
+      continue;
+    }
+    memset(&jobs[pool.num_jobs], 0, sizeof(pwr_job_t));
+    jobs[pool.num_jobs++].fru = fru;
+  }
+  if (pool.num_jobs == 0) {
+    printf("No server is present\n");
+    return -1;
+  }
+
+  for (i = 0; i < pool.num_jobs && i < MAX_PWR_WORKERS; i++) {
+    if (pthread_create(&tid[i], NULL, pwr_worker, &pool)) {
+      break;
+    }
+    num_workers++;
+  }
+  if (num_workers == 0) {
+    pwr_worker(&pool);
+  }
+  for (i = 0; i < num_workers; i++) {
+    pthread_join(tid[i], NULL);
+  }
+
+  printf("\n%-16s %-20s %-12s %s\n", "FRU", "Action", "Result", "Time(ms)");
+  for (i = 0; i < pool.num_jobs; i++) {
+    if (pal_get_fru_name(jobs[i].fru, name)) {
+      snprintf(name, sizeof(name), "fru%u", jobs[i].fru);
+    }
+    printf("%-16s %-20s %-12s %llu\n", name, option_list[opt],
+        jobs[i].ret == -2 ? "BUSY" : jobs[i].ret < 0 ? "FAILED" : "OK",
+        (unsigned long long)jobs[i].elapsed_ms);
+    if (jobs[i].ret < 0 && ret == 0) {
+      ret = jobs[i].ret;
+    }
+  }
+
+  return ret;
+}
+
 int parse_args(int argc, char *argv[], bool *force) {
   int ret;
   int index;
@@ -633,6 +799,18 @@ main(int argc, char **argv) {
     exit(-1);
   }
 
+  // Fan "all" out to every server, unless a device is addressed
+  if (argc == optind + 2 && !strcmp(argv[optind], "all") &&
+      strstr(pal_server_list, "all") != NULL) {
+    option = argv[optind + 1];
+    if (get_power_opt(option, &opt) < 0 || opt == PWR_SLED_CYCLE) {
+      printf("Wrong option: %s\n", option);
+      print_usage();
+      exit(-1);
+    }
+    return power_util_all(opt, force);
+  }
+
   if (argc > optind + 1) {
     ret = pal_get_fru_id(argv[optind], &fru);
     if (ret < 0) {
@@ -47,7 +47,7 @@ print_usage(const char *name, const char psu_num) {
       printf("|");
     }
   }
-  printf("> --update <file_path>\n");
+  printf("|all> --update <file_path>\n");
 
   printf("Usage: %s <", name);
   for (i = 0; i < psu_num; i++)
@@ -83,6 +83,36 @@ char get_psu_id(const char *name, const char psu_num)
   return ret;
 }
 
+/* Update all the present PSUs, those of different buses concurrently */
+static int
+update_all_psus(const char *file_path, const char *vendor) {
+  uint8_t nums[PSU_NUM], prsnt = 0;
+  int rets[PSU_NUM];
+  int i, count = 0, ret;
+
+  for (i = 0; i < PSU_NUM; i++) {
+    if (is_psu_prsnt(i, &prsnt) == 0 && prsnt) {
+      nums[count++] = i;
+    }
+  }
+  if (count == 0) {
+    printf("No PSU is present!\n");
+    return 0;
+  }
+
+  ret = do_update_psus(nums, count, file_path, vendor, rets);
+  for (i = 0; i < count; i++) {
+    if (rets[i]) {
+      syslog(LOG_WARNING, "PSU%d update fail!", nums[i] + 1);
+      printf("PSU%d update fail!\n", nums[i] + 1);
+    } else {
+      syslog(LOG_WARNING, "PSU%d update success!", nums[i] + 1);
+    }
+  }
+
+  return ret;
+}
+
 int
 main(int argc, const char *argv[]) {
   uint8_t psu_slot = 0, prsnt = 0;
@@ -94,7 +124,14 @@ main(int argc, const char *argv[]) {
     return -1;
   }
 
-  psu_slot = get_psu_id(argv[1], PSU_NUM);
+  if (!strcmp(argv[1], "all")) {
+    if (strcmp(argv[2], "--update") || argv[3] == NULL) {
+      print_usage(argv[0], PSU_NUM);
+      return -1;
+    }
+  } else {
+    psu_slot = get_psu_id(argv[1], PSU_NUM);
+  }
   if (psu_slot < 0) {
     print_usage(argv[0], PSU_NUM);
     return -1;
@@ -111,6 +148,10 @@ main(int argc, const char *argv[]) {
     exit(EXIT_FAILURE);
   }
 
+  if (!strcmp(argv[1], "all")) {
+    return update_all_psus(argv[3], argv[4]);
+  }
+
   ret = is_psu_prsnt(psu_slot, &prsnt);
   if (ret) {
     printf("Get PSU%d present error!\n", psu_slot + 1);
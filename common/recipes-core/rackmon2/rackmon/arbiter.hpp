@@ -0,0 +1,125 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Priority classes of the commands sharing a bus, highest first.
+enum class CommandPriority {
+  CONTROL = 0, // Writes from the service (Power capping, ...)
+  INTERACTIVE, // Reads and raw commands from the service
+  MONITOR, // Monitoring of the known devices
+  SCAN, // Probing for new and dormant devices
+  NUM_PRIORITIES
+};
+
+// Priority of the commands issued by the current thread while the
+// scope is alive. Threads default to MONITOR.
+class CommandPriorityScope {
+  static inline thread_local CommandPriority current =
+      CommandPriority::MONITOR;
+  CommandPriority prev;
+
+ public:
+  explicit CommandPriorityScope(CommandPriority p) : prev(current) {
+    current = p;
+  }
+  ~CommandPriorityScope() {
+    current = prev;
+  }
+  CommandPriorityScope(const CommandPriorityScope&) = delete;
+  CommandPriorityScope& operator=(const CommandPriorityScope&) = delete;
+  static CommandPriority get() {
+    return current;
+  }
+};
+
+// Grants exclusive use of a bus, one transaction at a time. When it
+// is released, the bus goes to the highest priority waiter, and to
+// waiters of the same priority in the order they arrived. So a
+// control command waits for at most the transaction in flight, no
+// matter how many monitor or scan commands are queued.
+// The thread holding the bus can lock it again, so that it keeps the
+// bus across several commands (See Modbus::hold_bus).
+class BusArbiter {
+  static constexpr size_t num_priorities =
+      size_t(CommandPriority::NUM_PRIORITIES);
+  std::mutex m{};
+  std::condition_variable cv{};
+  bool busy = false;
+  // Holder of the bus, the number of its locks and their priority.
+  std::thread::id owner{};
+  size_t depth = 0;
+  size_t held_priority = 0;
+  // Tickets handed out and served, per priority.
+  std::array<uint64_t, num_priorities> next_ticket{};
+  std::array<uint64_t, num_priorities> serving{};
+
+  bool higher_waiting(size_t prio) const {
+    for (size_t p = 0; p < prio; p++) {
+      if (next_ticket[p] != serving[p])
+        return true;
+    }
+    return false;
+  }
+
+ public:
+  void lock(CommandPriority priority) {
+    size_t prio = size_t(priority);
+    std::unique_lock lk(m);
+    if (busy && owner == std::this_thread::get_id()) {
+      depth++;
+      return;
+    }
+    uint64_t ticket = next_ticket[prio]++;
+    cv.wait(lk, [&]() {
+      return !busy && serving[prio] == ticket && !higher_waiting(prio);
+    });
+    serving[prio]++;
+    busy = true;
+    owner = std::this_thread::get_id();
+    depth = 1;
+    held_priority = prio;
+  }
+  void lock() {
+    lock(CommandPriorityScope::get());
+  }
+  void unlock() {
+    {
+      std::unique_lock lk(m);
+      if (--depth > 0)
+        return;
+      busy = false;
+      owner = std::thread::id();
+    }
+    cv.notify_all();
+  }
+  // Called by the holder of the bus in between its commands: if
+  // commands of a higher priority are waiting, they go first and
+  // the bus is taken back after them.
+  void yield() {
+    size_t held_depth;
+    CommandPriority prio;
+    {
+      std::unique_lock lk(m);
+      if (!higher_waiting(held_priority))
+        return;
+      held_depth = depth;
+      prio = CommandPriority(held_priority);
+      busy = false;
+      owner = std::thread::id();
+      depth = 0;
+    }
+    cv.notify_all();
+    lock(prio);
+    std::unique_lock lk(m);
+    depth = held_depth;
+  }
+  // Number of commands waiting for the bus at the priority.
+  size_t waiting(CommandPriority priority) {
+    std::unique_lock lk(m);
+    size_t prio = size_t(priority);
+    return next_ticket[prio] - serving[prio];
+  }
+};
@@ -0,0 +1,351 @@
+// Benchmark of the monitor on a simulated RS485 bus. Every device on
+// the bus is a virtual PSU answering as per a real register map, with
+// the (configurable) timing and error behavior of the wire. Reports
+// the monitor pass time and its allocations, the full scan time and
+// the latency of service requests against a busy monitor.
+#include <CLI/CLI.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include "rackmon.hpp"
+
+using nlohmann::json;
+using namespace std::literals;
+using bench_clock = std::chrono::steady_clock;
+
+// Count of allocations, to report the allocations per monitor pass.
+static std::atomic<uint64_t> num_allocs = 0;
+
+void* operator new(size_t size) {
+  num_allocs++;
+  if (void* ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /* unused */) noexcept {
+  std::free(ptr);
+}
+
+struct SimBusConfig {
+  // Overrides the baudrate of the commands for the wire time, if set.
+  uint32_t baudrate = 0;
+  // Time a device takes to start responding once the request is sent.
+  int turnaround_us = 2000;
+  // Probability of a request going unanswered.
+  double drop_rate = 0.0;
+  // Probability of a response being corrupted on the wire.
+  double crc_error_rate = 0.0;
+  unsigned seed = 1;
+};
+
+// The devices on the bus and their register contents.
+class SimBus {
+  const SimBusConfig conf;
+  std::mutex m{};
+  std::mt19937 rng;
+  std::map<uint8_t, std::vector<uint16_t>> devices{};
+
+ public:
+  explicit SimBus(const SimBusConfig& c) : conf(c), rng(c.seed) {}
+  const SimBusConfig& config() const {
+    return conf;
+  }
+  void add_device(uint8_t addr) {
+    std::vector<uint16_t> regs(0x10000);
+    for (size_t i = 0; i < regs.size(); i++)
+      regs[i] = uint16_t(addr + i);
+    devices[addr] = std::move(regs);
+  }
+  bool chance(double rate) {
+    std::unique_lock lk(m);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < rate;
+  }
+  // Response of the device to a request, none if there is no device
+  // at the address, or it does not understand the request.
+  std::vector<uint8_t> respond(const uint8_t* req, size_t len);
+};
+
+// Frame built by the simulated devices.
+struct SimFrame : public Msg {
+  void seal() {
+    finalize();
+  }
+};
+
+std::vector<uint8_t> SimBus::respond(const uint8_t* req, size_t len) {
+  auto it = devices.find(req[0]);
+  if (it == devices.end() || len < 8)
+    return {};
+  std::vector<uint16_t>& regs = it->second;
+  uint16_t reg = (req[2] << 8) | req[3];
+  uint16_t val = (req[4] << 8) | req[5];
+  SimFrame resp;
+  resp << req[0] << req[1];
+  if (req[1] == 0x03) {
+    if (val == 0 || size_t(reg) + val > regs.size() ||
+        5 + 2 * size_t(val) > max_modbus_length)
+      return {};
+    resp << uint8_t(val * 2);
+    for (uint16_t i = 0; i < val; i++)
+      resp << regs[reg + i];
+  } else if (req[1] == 0x06) {
+    regs[reg] = val;
+    resp << reg << val;
+  } else if (req[1] == 0x10) {
+    for (uint16_t i = 0; i < val && size_t(8 + 2 * i) < len - 2; i++)
+      regs[reg + i] = (req[7 + 2 * i] << 8) | req[8 + 2 * i];
+    resp << reg << val;
+  } else {
+    return {};
+  }
+  resp.seal();
+  return std::vector<uint8_t>(resp.begin(), resp.end());
+}
+
+// UART of the simulated bus, every transfer takes as long as it
+// would on the wire.
+class SimUARTDevice : public UARTDevice {
+  SimBus& bus;
+  std::vector<uint8_t> pending{};
+
+  std::chrono::microseconds wire_time(size_t bytes) const {
+    uint32_t baud = bus.config().baudrate ? bus.config().baudrate : baudrate;
+    return std::chrono::microseconds(uint64_t(bytes) * 11 * 1000000 / baud);
+  }
+
+ protected:
+  void set_attribute(bool /* unused */, int /* unused */) override {}
+  void wait_write() override {}
+
+ public:
+  SimUARTDevice(SimBus& b, const std::string& dev, int baud)
+      : UARTDevice(dev, baud), bus(b) {}
+  void open() override {}
+  void close() override {}
+  void write(const uint8_t* buf, size_t len) override {
+    std::this_thread::sleep_for(wire_time(len));
+    pending.clear();
+    if (!bus.chance(bus.config().drop_rate))
+      pending = bus.respond(buf, len);
+  }
+  size_t read_frame(
+      uint8_t* buf,
+      size_t max_len,
+      int timeout_ms,
+      int /* unused */) override {
+    if (pending.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+      throw timeout_exception();
+    }
+    size_t len = std::min(pending.size(), max_len);
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(bus.config().turnaround_us) +
+        wire_time(len));
+    std::copy(pending.begin(), pending.begin() + len, buf);
+    if (bus.chance(bus.config().crc_error_rate))
+      buf[len - 1] ^= 0xff;
+    pending.clear();
+    return len;
+  }
+};
+
+class SimModbus : public Modbus {
+  SimBus& bus;
+
+ public:
+  explicit SimModbus(SimBus& b) : bus(b) {}
+  std::unique_ptr<UARTDevice> make_device(
+      const std::string& /* unused */,
+      const std::string& device_path,
+      uint32_t baud) override {
+    return std::make_unique<SimUARTDevice>(bus, device_path, baud);
+  }
+};
+
+class SimRackmon : public Rackmon {
+  SimBus& bus;
+
+ protected:
+  std::unique_ptr<Modbus> make_interface() override {
+    return std::make_unique<SimModbus>(bus);
+  }
+
+ public:
+  explicit SimRackmon(SimBus& b) : bus(b) {}
+};
+
+// Summary of a set of samples.
+struct Stats {
+  std::vector<double> samples{};
+  void add(double v) {
+    samples.push_back(v);
+  }
+  double percentile(double p) {
+    if (samples.empty())
+      return 0.0;
+    std::sort(samples.begin(), samples.end());
+    size_t idx = std::min(samples.size() - 1, size_t(p * samples.size()));
+    return samples[idx];
+  }
+  double mean() const {
+    double sum = 0.0;
+    for (double v : samples)
+      sum += v;
+    return samples.empty() ? 0.0 : sum / samples.size();
+  }
+};
+
+static double ms_since(bench_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(bench_clock::now() - start)
+      .count();
+}
+
+// Addresses of the first num_psus devices of the register maps.
+static std::vector<uint8_t> psu_addresses(
+    RegisterMapDatabase& db,
+    unsigned num_psus) {
+  std::vector<uint8_t> ret;
+  for (uint16_t addr = 0; addr <= 0xff && ret.size() < num_psus; addr++) {
+    try {
+      db.at(uint8_t(addr));
+      ret.push_back(uint8_t(addr));
+    } catch (std::out_of_range&) {
+      continue;
+    }
+  }
+  return ret;
+}
+
+static void bench_monitor(
+    const SimBusConfig& conf,
+    const std::string& regmap_dir,
+    unsigned num_psus,
+    unsigned passes) {
+  SimBus bus(conf);
+  RegisterMapDatabase db;
+  db.load(regmap_dir);
+  SimModbus iface(bus);
+  iface.initialize(R"({"device_path": "sim", "baudrate": 19200})"_json);
+  std::vector<std::unique_ptr<ModbusDevice>> devs;
+  for (uint8_t addr : psu_addresses(db, num_psus)) {
+    bus.add_device(addr);
+    devs.push_back(std::make_unique<ModbusDevice>(iface, addr, db.at(addr)));
+  }
+  Stats pass_ms, allocs;
+  for (unsigned pass = 0; pass < passes; pass++) {
+    uint64_t allocs_start = num_allocs;
+    auto start = bench_clock::now();
+    for (auto& dev : devs)
+      dev->monitor();
+    pass_ms.add(ms_since(start));
+    allocs.add(double(num_allocs - allocs_start));
+  }
+  std::cout << "monitor: " << devs.size() << " devices, " << passes
+            << " passes\n"
+            << "  pass time (ms): mean " << pass_ms.mean() << " max "
+            << pass_ms.percentile(1.0) << "\n"
+            << "  allocations per pass: mean " << allocs.mean() << " max "
+            << allocs.percentile(1.0) << std::endl;
+}
+
+static void bench_rackmon(
+    const SimBusConfig& conf,
+    const std::string& regmap_dir,
+    unsigned num_psus,
+    unsigned requests) {
+  const std::string conf_path = "./rackmon_bench.conf";
+  {
+    std::ofstream ofs(conf_path);
+    ofs << R"({"interfaces": [{"device_path": "sim", "baudrate": 19200}]})";
+  }
+  SimBus bus(conf);
+  SimRackmon mon(bus);
+  mon.load(conf_path, regmap_dir);
+  std::remove(conf_path.c_str());
+  RegisterMapDatabase db;
+  db.load(regmap_dir);
+  std::vector<uint8_t> addrs = psu_addresses(db, num_psus);
+  for (uint8_t addr : addrs)
+    bus.add_device(addr);
+
+  mon.start(1s);
+  json metrics;
+  do {
+    std::this_thread::sleep_for(10ms);
+    mon.get_metrics(metrics);
+  } while (metrics["scan"]["full_scans"] == 0);
+  // The daemon logs addresses in hex to the same stream.
+  std::cout << std::dec << "scan: found " << mon.list_devices().size()
+            << " of " << addrs.size() << " devices in "
+            << metrics["scan"]["last_full_scan_us"].get<int64_t>() / 1000
+            << " ms" << std::endl;
+
+  // The monitor threads keep the bus busy, measure how long service
+  // requests take to get through.
+  Stats reads, writes;
+  for (unsigned i = 0; i < requests && !addrs.empty(); i++) {
+    uint8_t addr = addrs[i % addrs.size()];
+    std::vector<uint16_t> regs(1);
+    auto req_start = bench_clock::now();
+    try {
+      mon.ReadHoldingRegisters(addr, 0, regs);
+      reads.add(ms_since(req_start));
+    } catch (std::exception&) {
+    }
+    req_start = bench_clock::now();
+    try {
+      mon.WriteSingleRegister(addr, 0x1000, uint16_t(i));
+      writes.add(ms_since(req_start));
+    } catch (std::exception&) {
+    }
+    std::this_thread::sleep_for(20ms);
+  }
+  mon.stop();
+  auto report = [](const char* name, Stats& st) {
+    std::cout << "  " << name << " (ms): p50 " << st.percentile(0.5)
+              << " p99 " << st.percentile(0.99) << " max "
+              << st.percentile(1.0) << " (" << st.samples.size()
+              << " requests)" << std::endl;
+  };
+  std::cout << std::dec << "service latency against a busy monitor:"
+            << std::endl;
+  report("reads", reads);
+  report("writes", writes);
+}
+
+int main(int argc, char* argv[]) {
+  CLI::App app("Rackmon simulated bus benchmark");
+  SimBusConfig conf{};
+  std::string regmap_dir = "/etc/rackmon.d";
+  unsigned num_psus = 6;
+  unsigned passes = 3;
+  unsigned requests = 50;
+  app.add_option("-d,--regmap-dir", regmap_dir, "Register map directory");
+  app.add_option("-n,--psus", num_psus, "Number of simulated PSUs");
+  app.add_option("-p,--passes", passes, "Number of monitor passes");
+  app.add_option("-r,--requests", requests, "Number of service requests");
+  app.add_option("-b,--baudrate", conf.baudrate, "Baudrate of the wire");
+  app.add_option(
+      "-t,--turnaround", conf.turnaround_us, "Device turnaround (us)");
+  app.add_option("--drop-rate", conf.drop_rate, "Unanswered requests (0-1)");
+  app.add_option("--crc-rate", conf.crc_error_rate, "Corrupt responses (0-1)");
+  app.add_option("--seed", conf.seed, "Seed of the simulated errors");
+  CLI11_PARSE(app, argc, argv);
+
+  bench_monitor(conf, regmap_dir, num_psus, passes);
+  bench_rackmon(conf, regmap_dir, num_psus, requests);
+  return 0;
+}
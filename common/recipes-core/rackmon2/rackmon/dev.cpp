@@ -4,6 +4,7 @@
 #include <sys/ioctl.h>
 #include <sys/select.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
@@ -45,35 +46,37 @@ void Device::ioctl(int32_t cmd, void* data) {
   }
 }
 
-void Device::wait_read(int timeout_ms) {
+bool Device::poll_read(int64_t timeout_us) {
   fd_set fdset;
   struct timeval timeout;
   struct timeval *timeout_ptr = nullptr;
   FD_ZERO(&fdset);
   FD_SET(dev_fd, &fdset);
-  if (timeout_ms > 0) {
-    timeout.tv_sec = 0;
-    timeout.tv_usec = timeout_ms * 1000;
+  if (timeout_us >= 0) {
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_usec = timeout_us % 1000000;
     timeout_ptr = &timeout;
   }
   int rc = select(dev_fd + 1, &fdset, NULL, NULL, timeout_ptr);
   if (rc == -1) {
     throw std::system_error(sys_error(), "select returned error for " + dev);
   }
-  if (rc == 0) {
+  return rc != 0;
+}
+
+void Device::wait_read(int timeout_ms) {
+  if (!poll_read(timeout_ms > 0 ? int64_t(timeout_ms) * 1000 : -1)) {
     throw timeout_exception();
   }
 }
 
 void Device::read(uint8_t* buf, size_t exact_len, int timeout_ms) {
-  uint8_t read_buf[16];
   std::memset(buf, 0, exact_len);
   size_t pos = 0;
   size_t iter;
-  // We are at minimum going with len/16 iterations.
-  // Add some upper bounds on this to make sure we do
-  // not loop here forever.
-  size_t max_iter = (1 + exact_len / sizeof(read_buf)) * 4;
+  // Reads usually return a FIFO worth (16 bytes) or more. Add some
+  // upper bounds on this to make sure we do not loop here forever.
+  size_t max_iter = (1 + exact_len / 16) * 4;
   for (pos = 0, iter = 0; pos < exact_len && iter < max_iter; iter++) {
     try {
       wait_read(timeout_ms);
@@ -81,16 +84,12 @@ void Device::read(uint8_t* buf, size_t exact_len, int timeout_ms) {
       // Print error and ignore/retry
       log_error << e.what() << std::endl;
     }
-    int read_size = ::read(dev_fd, read_buf, sizeof(read_buf));
+    int read_size = ::read(dev_fd, buf + pos, exact_len - pos);
     if (read_size < 0) {
       if (errno == EAGAIN)
         continue;
       throw std::system_error(sys_error(), "read response failure");
     }
-    if ((pos + read_size) > exact_len) {
-      throw std::overflow_error("Read overflowed excpected size");
-    }
-    std::memcpy(buf + pos, read_buf, read_size);
     pos += read_size;
   }
   if (pos != exact_len) {
@@ -98,3 +97,25 @@ void Device::read(uint8_t* buf, size_t exact_len, int timeout_ms) {
         "Aborted read after iterations: " + std::to_string(iter));
   }
 }
+
+size_t Device::read_frame(
+    uint8_t* buf,
+    size_t max_len,
+    int timeout_ms,
+    int frame_gap_us) {
+  size_t pos = 0;
+  wait_read(timeout_ms);
+  while (pos < max_len) {
+    int read_size = ::read(dev_fd, buf + pos, max_len - pos);
+    if (read_size < 0) {
+      if (errno != EAGAIN && errno != EINTR)
+        throw std::system_error(sys_error(), "read response failure");
+    } else if (read_size == 0) {
+      break;
+    }
+    pos += std::max(read_size, 0);
+    if (pos < max_len && !poll_read(frame_gap_us))
+      break;
+  }
+  return pos;
+}
@@ -11,6 +11,10 @@ class Device {
   const std::string dev;
   int dev_fd = -1;
 
+  // Wait for the device to be readable for up to timeout_us
+  // micro-seconds, forever if negative. Returns false on timeout.
+  bool poll_read(int64_t timeout_us);
+
  public:
   explicit Device(const std::string& device) : dev(device) {}
   virtual ~Device() {
@@ -23,4 +27,9 @@ class Device {
   virtual void wait_read(int timeout_ms);
   virtual void wait_write() {}
   virtual void read(uint8_t* buf, size_t exact_len, int timeout_ms);
+  // Read a frame of at most max_len bytes. Waits up to timeout_ms for
+  // the frame to start, the frame ends once max_len bytes are read or
+  // the line has been silent for frame_gap_us. Returns the frame length.
+  virtual size_t
+  read_frame(uint8_t* buf, size_t max_len, int timeout_ms, int frame_gap_us);
 };
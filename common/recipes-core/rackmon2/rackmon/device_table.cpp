@@ -0,0 +1,71 @@
+#include "device_table.hpp"
+#include <cstdio>
+#include <fstream>
+#include "log.hpp"
+
+#if (__GNUC__ < 8)
+#include <experimental/filesystem>
+namespace std {
+namespace filesystem = experimental::filesystem;
+}
+#else
+#include <filesystem>
+#endif
+
+using nlohmann::json;
+
+void to_json(json& j, const DeviceTableEntry& e) {
+  j["interface"] = e.interface;
+  j["addr"] = e.addr;
+  j["baudrate"] = e.baudrate;
+  j["type"] = e.type;
+}
+
+void from_json(const json& j, DeviceTableEntry& e) {
+  j.at("interface").get_to(e.interface);
+  j.at("addr").get_to(e.addr);
+  j.at("baudrate").get_to(e.baudrate);
+  j.at("type").get_to(e.type);
+}
+
+std::vector<DeviceTableEntry> DeviceTable::load() const {
+  std::ifstream ifs(path);
+  if (!ifs.is_open())
+    return {};
+  try {
+    json j;
+    ifs >> j;
+    if (j.value("version", 0) != version)
+      return {};
+    return j.at("devices").get<std::vector<DeviceTableEntry>>();
+  } catch (json::exception& e) {
+    log_error << "Ignoring corrupt device table " << path << ": " << e.what()
+              << std::endl;
+  }
+  return {};
+}
+
+void DeviceTable::save(const std::vector<DeviceTableEntry>& devices) const {
+  // Write to a temporary and rename, so a power cut never
+  // leaves a partially written table behind.
+  std::string tmp_path = path + ".tmp";
+  try {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+      std::filesystem::create_directories(parent);
+    json j;
+    j["version"] = version;
+    j["devices"] = devices;
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    ofs << j.dump(2);
+    ofs.close();
+    if (!ofs)
+      throw std::runtime_error("Write of " + tmp_path + " failed");
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+      throw std::system_error(
+          std::error_code(errno, std::generic_category()), "rename " + path);
+  } catch (std::exception& e) {
+    log_error << "Could not write device table: " << e.what() << std::endl;
+    std::remove(tmp_path.c_str());
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+// A device known to rackmond.
+struct DeviceTableEntry {
+  // Name (device path) of the interface the device was found on.
+  std::string interface{};
+  uint8_t addr = 0;
+  uint32_t baudrate = 0;
+  // Name of the register map of the device.
+  std::string type{};
+
+  bool operator==(const DeviceTableEntry& other) const {
+    return interface == other.interface && addr == other.addr &&
+        baudrate == other.baudrate && type == other.type;
+  }
+};
+void to_json(nlohmann::json& j, const DeviceTableEntry& e);
+void from_json(const nlohmann::json& j, DeviceTableEntry& e);
+
+// Table of the known devices, persisted so a restarted rackmond can
+// probe them first and resume monitoring without waiting for a full
+// scan. It is only a hint: every entry is probed before use.
+class DeviceTable {
+  const std::string path;
+
+ public:
+  static constexpr int version = 1;
+  explicit DeviceTable(const std::string& p) : path(p) {}
+
+  // Returns the persisted devices, none if the table is missing
+  // or corrupt.
+  std::vector<DeviceTableEntry> load() const;
+  // Persists the devices. Errors are logged rather than thrown, the
+  // worst outcome is a full scan on the next start.
+  void save(const std::vector<DeviceTableEntry>& devices) const;
+};
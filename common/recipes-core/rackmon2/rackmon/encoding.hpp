@@ -0,0 +1,58 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Encodings a client can request for the responses with the
+// optional "encoding" field of a request. The requests themselves
+// are always JSON. The binary encodings are much cheaper to
+// produce and parse for large data responses.
+enum class ResponseEncoding {
+  JSON,
+  CBOR,
+  MSGPACK,
+};
+
+// Returns the encoding requested by the request, JSON by default.
+inline ResponseEncoding get_response_encoding(const nlohmann::json& req) {
+  if (!req.contains("encoding"))
+    return ResponseEncoding::JSON;
+  std::string enc = req["encoding"];
+  if (enc == "json")
+    return ResponseEncoding::JSON;
+  if (enc == "cbor")
+    return ResponseEncoding::CBOR;
+  if (enc == "msgpack")
+    return ResponseEncoding::MSGPACK;
+  throw std::logic_error("Unsupported encoding: " + enc);
+}
+
+inline std::vector<uint8_t> encode_response(
+    const nlohmann::json& resp,
+    ResponseEncoding enc) {
+  switch (enc) {
+    case ResponseEncoding::CBOR:
+      return nlohmann::json::to_cbor(resp);
+    case ResponseEncoding::MSGPACK:
+      return nlohmann::json::to_msgpack(resp);
+    case ResponseEncoding::JSON:
+      break;
+  }
+  std::string s = resp.dump();
+  return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+inline nlohmann::json decode_response(
+    const std::vector<char>& buf,
+    ResponseEncoding enc) {
+  switch (enc) {
+    case ResponseEncoding::CBOR:
+      return nlohmann::json::from_cbor(buf);
+    case ResponseEncoding::MSGPACK:
+      return nlohmann::json::from_msgpack(buf);
+    case ResponseEncoding::JSON:
+      break;
+  }
+  return nlohmann::json::parse(buf);
+}
@@ -0,0 +1,292 @@
+#include "fw_update.hpp"
+#include <array>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include "log.hpp"
+
+using nlohmann::json;
+using namespace std::literals;
+
+void to_json(json& j, const FirmwareUpdateStatus& m) {
+  j["addr"] = m.addr;
+  j["vendor"] = m.vendor;
+  j["image_path"] = m.image_path;
+  j["state"] = m.state;
+  j["bytes_total"] = m.bytes_total;
+  j["bytes_sent"] = m.bytes_sent;
+  j["progress_percent"] =
+      m.bytes_total == 0 ? 0.0 : m.bytes_sent * 100.0 / m.bytes_total;
+  j["error"] = m.error;
+  j["start_time"] = m.start_time;
+  j["end_time"] = m.end_time;
+}
+
+HexImageReader::HexImageReader(const std::string& path) : ifs(path) {
+  if (!ifs.is_open())
+    throw std::runtime_error("Cannot open image " + path);
+}
+
+bool HexImageReader::next(uint32_t& addr, std::vector<uint8_t>& data) {
+  auto bad = [this](const std::string& what) {
+    return std::runtime_error(
+        "Bad image at line " + std::to_string(lineno) + ": " + what);
+  };
+  auto nibble = [&bad](char c) -> uint8_t {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    throw bad("not hex");
+  };
+  std::string line;
+  std::vector<uint8_t> rec;
+  while (!eof && std::getline(ifs, line)) {
+    lineno++;
+    while (!line.empty() && std::isspace(uint8_t(line.back())))
+      line.pop_back();
+    if (line.empty())
+      continue;
+    if (line[0] != ':' || line.size() < 11 || line.size() % 2 == 0)
+      throw bad("not a record");
+    rec.clear();
+    uint8_t sum = 0;
+    for (size_t i = 1; i < line.size(); i += 2) {
+      rec.push_back((nibble(line[i]) << 4) | nibble(line[i + 1]));
+      sum += rec.back();
+    }
+    if (sum != 0)
+      throw bad("checksum");
+    size_t len = rec[0];
+    if (rec.size() != len + 5)
+      throw bad("length");
+    uint16_t offset = (rec[1] << 8) | rec[2];
+    uint8_t type = rec[3];
+    switch (type) {
+      case 0x00: // Data
+        addr = base + offset;
+        data.assign(rec.begin() + 4, rec.begin() + 4 + len);
+        return true;
+      case 0x01: // End of file
+        eof = true;
+        break;
+      case 0x02: // Extended segment address
+      case 0x04: // Extended linear address
+        if (len != 2)
+          throw bad("length");
+        base = (rec[4] << 8) | rec[5];
+        base <<= type == 0x02 ? 4 : 16;
+        break;
+      case 0x03: // Start addresses, nothing to flash
+      case 0x05:
+        break;
+      default:
+        throw bad("record type " + std::to_string(type));
+    }
+  }
+  if (!eof)
+    throw bad("no end of file record");
+  return false;
+}
+
+size_t HexImageReader::data_size(const std::string& path) {
+  HexImageReader image(path);
+  uint32_t addr;
+  std::vector<uint8_t> data;
+  size_t size = 0;
+  while (image.next(addr, data))
+    size += data.size();
+  return size;
+}
+
+std::unique_ptr<FirmwareUpdater> make_firmware_updater(
+    const std::string& vendor,
+    ModbusDevice& dev,
+    FirmwareUpdater::StateCallback set_state,
+    FirmwareUpdater::ProgressCallback add_progress,
+    const std::atomic<bool>& abort) {
+  if (vendor == "delta")
+    return std::make_unique<DeltaFirmwareUpdater>(
+        dev, set_state, add_progress, abort);
+  throw std::logic_error("Unsupported firmware update vendor: " + vendor);
+}
+
+static std::string to_hex(const Msg& m) {
+  std::stringstream ss;
+  for (uint8_t b : m)
+    ss << std::hex << std::setw(2) << std::setfill('0') << int(b);
+  return ss.str();
+}
+
+Msg DeltaFirmwareUpdater::mei_command(
+    uint8_t func,
+    const std::vector<uint8_t>& data,
+    modbus_time timeout) {
+  Msg req, resp;
+  req << addr << uint8_t(0x2b) << uint8_t(mei_request) << func;
+  for (size_t i = 0; i < 7; i++)
+    req << uint8_t(i < data.size() ? data[i] : 0xff);
+  // addr, func, MEI type, 8 bytes of data, crc
+  resp.len = 13;
+  dev.command(req, resp, timeout);
+  return resp;
+}
+
+void DeltaFirmwareUpdater::mei_expect(
+    const Msg& resp,
+    const std::vector<uint8_t>& pfx,
+    const std::string& what) {
+  Msg exp;
+  exp << addr << uint8_t(0x2b) << uint8_t(mei_response);
+  for (size_t i = 0; i < 8; i++)
+    exp << uint8_t(i < pfx.size() ? pfx[i] : 0xff);
+  if (resp != exp)
+    throw std::runtime_error(what + " failed, response: " + to_hex(resp));
+}
+
+void DeltaFirmwareUpdater::reset() {
+  Msg resp;
+  try {
+    resp = mei_command(0x72, {}, 10s);
+  } catch (timeout_exception&) {
+    // The device may reset before it replies.
+    return;
+  }
+  mei_expect(resp, {0xb2}, "Reset");
+}
+
+void DeltaFirmwareUpdater::enter_bootloader() {
+  try {
+    mei_command(0xfb, {}, 4s);
+  } catch (timeout_exception&) {
+    // Expected, the device jumps to the bootloader.
+  }
+}
+
+uint32_t DeltaFirmwareUpdater::calc_key(uint32_t seed) {
+  for (int i = 0; i < 32; i++) {
+    if (seed & 1)
+      seed ^= 0xc758a5b6;
+    seed = (seed >> 1) & 0x7fffffff;
+  }
+  return seed ^ 0x06854137;
+}
+
+void DeltaFirmwareUpdater::unlock() {
+  mei_expect(mei_command(0x70, {}, 10s), {0xb0}, "Start programming");
+
+  Msg resp = mei_command(0x27, {}, 3s);
+  if (resp.len < 8 || resp.raw[0] != addr || resp.raw[1] != 0x2b ||
+      resp.raw[2] != mei_response || resp.raw[3] != 0x67)
+    throw std::runtime_error("Get seed failed, response: " + to_hex(resp));
+  uint32_t seed = (uint32_t(resp.raw[4]) << 24) | (resp.raw[5] << 16) |
+      (resp.raw[6] << 8) | resp.raw[7];
+  uint32_t key = calc_key(seed);
+  std::vector<uint8_t> key_b = {
+      uint8_t(key >> 24), uint8_t(key >> 16), uint8_t(key >> 8), uint8_t(key)};
+  mei_expect(mei_command(0x28, key_b, 3s), {0x68}, "Send key");
+}
+
+void DeltaFirmwareUpdater::erase() {
+  mei_expect(mei_command(0x65, {}, 30s), {0xa5}, "Erase flash");
+}
+
+void DeltaFirmwareUpdater::set_write_address(uint32_t flash_addr) {
+  std::vector<uint8_t> data = {
+      uint8_t(flash_addr >> 24),
+      uint8_t(flash_addr >> 16),
+      uint8_t(flash_addr >> 8),
+      uint8_t(flash_addr),
+      0xea};
+  mei_expect(
+      mei_command(0x61, data, 3s), {0xa1, 0xea}, "Set write address");
+}
+
+void DeltaFirmwareUpdater::write_block(const uint8_t* data) {
+  Msg req, resp, exp;
+  req << addr << uint8_t(0x2b) << uint8_t(0x65);
+  for (size_t i = 0; i < block_size; i++)
+    req << data[i];
+  resp.len = 13;
+  try {
+    dev.command(req, resp, 3s);
+  } catch (crc_exception&) {
+    // Other units on the bus sometimes answer (and collide with) the
+    // acknowledgement. It only tells the block was seen, so assume
+    // it was written, as the update otherwise never completes.
+    log_error << "DEV:0x" << std::hex << int(addr) << std::dec
+              << " corrupted block acknowledgement, continuing" << std::endl;
+    std::this_thread::sleep_for(1s);
+    return;
+  }
+  exp << addr << uint8_t(0x2b) << uint8_t(0x73) << uint8_t(0xf0)
+      << uint8_t(0xaa);
+  for (size_t i = 0; i < 6; i++)
+    exp << uint8_t(0xff);
+  if (resp != exp)
+    throw std::runtime_error("Write data failed, response: " + to_hex(resp));
+}
+
+void DeltaFirmwareUpdater::verify() {
+  mei_expect(mei_command(0x76, {}, 60s), {0xb6}, "Verify");
+}
+
+void DeltaFirmwareUpdater::run(const std::string& path) {
+  HexImageReader image(path);
+
+  // Gets the device to the top of the bootloader state machine if it
+  // was left there, and does nothing otherwise.
+  set_state("pre_handshake_reset");
+  reset();
+  std::this_thread::sleep_for(reset_delay);
+
+  set_state("bootloader_handshake");
+  enter_bootloader();
+  unlock();
+
+  set_state("erase_flash");
+  erase();
+
+  // Runs of contiguous records are written from their start address,
+  // their last block padded with 0xff.
+  set_state("flashing");
+  std::array<uint8_t, block_size> block;
+  size_t fill = 0;
+  bool started = false;
+  uint32_t next_addr = 0, rec_addr;
+  std::vector<uint8_t> data;
+  auto flush = [&]() {
+    if (fill == 0)
+      return;
+    std::fill(block.begin() + fill, block.end(), 0xff);
+    write_block(block.data());
+    add_progress(fill);
+    fill = 0;
+  };
+  while (image.next(rec_addr, data)) {
+    check_abort();
+    if (data.empty())
+      continue;
+    if (!started || rec_addr != next_addr) {
+      flush();
+      set_write_address(rec_addr);
+      started = true;
+    }
+    for (uint8_t b : data) {
+      block[fill++] = b;
+      if (fill == block_size)
+        flush();
+    }
+    next_addr = rec_addr + data.size();
+  }
+  flush();
+
+  set_state("verifying");
+  verify();
+
+  set_state("resetting");
+  reset();
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "modbus_device.hpp"
+
+// Progress of a firmware update, as reported to the clients.
+struct FirmwareUpdateStatus {
+  uint8_t addr = 0;
+  std::string vendor{};
+  std::string image_path{};
+  // Steps of the vendor sequence ("erase_flash", "flashing", ...),
+  // ends with "done" or "failed".
+  std::string state = "started";
+  size_t bytes_total = 0;
+  size_t bytes_sent = 0;
+  std::string error{};
+  time_t start_time = 0;
+  time_t end_time = 0;
+
+  bool in_progress() const {
+    return state != "done" && state != "failed";
+  }
+};
+void to_json(nlohmann::json& j, const FirmwareUpdateStatus& m);
+
+// Streams the data records of an Intel HEX image. Only the current
+// record is kept in memory. Throws std::runtime_error on a malformed
+// image.
+class HexImageReader {
+  std::ifstream ifs;
+  uint32_t base = 0;
+  size_t lineno = 0;
+  bool eof = false;
+
+ public:
+  explicit HexImageReader(const std::string& path);
+
+  // Next record of data, at addr. Returns false at the end.
+  bool next(uint32_t& addr, std::vector<uint8_t>& data);
+  // Number of data bytes in the image at path, without keeping it.
+  static size_t data_size(const std::string& path);
+};
+
+// Runs the update sequence of a vendor on a device, with the same
+// ModbusDevice::command() everything else uses. Each command takes
+// the bus for itself only, so other devices on the bus are monitored
+// in between the blocks.
+class FirmwareUpdater {
+ public:
+  using StateCallback = std::function<void(const std::string&)>;
+  using ProgressCallback = std::function<void(size_t)>;
+
+ protected:
+  ModbusDevice& dev;
+  uint8_t addr;
+  StateCallback set_state;
+  ProgressCallback add_progress;
+  const std::atomic<bool>& abort;
+
+  // Throws if the update was asked to stop.
+  void check_abort() const {
+    if (abort)
+      throw std::runtime_error("Firmware update aborted");
+  }
+
+ public:
+  // Time the device takes to come back from a reset.
+  modbus_time reset_delay = std::chrono::seconds(5);
+
+  FirmwareUpdater(
+      ModbusDevice& d,
+      StateCallback s,
+      ProgressCallback p,
+      const std::atomic<bool>& ab)
+      : dev(d),
+        addr(d.get_status().addr),
+        set_state(s),
+        add_progress(p),
+        abort(ab) {}
+  virtual ~FirmwareUpdater() {}
+
+  // Flash the image at path. Throws on failure.
+  virtual void run(const std::string& path) = 0;
+};
+
+// Returns the updater for the vendor, throws std::logic_error for
+// an unknown vendor.
+std::unique_ptr<FirmwareUpdater> make_firmware_updater(
+    const std::string& vendor,
+    ModbusDevice& dev,
+    FirmwareUpdater::StateCallback set_state,
+    FirmwareUpdater::ProgressCallback add_progress,
+    const std::atomic<bool>& abort);
+
+// Delta PSU bootloader: MEI (function 0x2B) commands, with the image
+// written in blocks of 8 bytes, each acknowledged by the device.
+class DeltaFirmwareUpdater : public FirmwareUpdater {
+  static constexpr uint8_t mei_request = 0x64;
+  static constexpr uint8_t mei_response = 0x71;
+  static constexpr size_t block_size = 8;
+
+  // Sends the MEI command with data (padded to 7 bytes) and returns
+  // the 11 byte response.
+  Msg mei_command(
+      uint8_t func,
+      const std::vector<uint8_t>& data,
+      modbus_time timeout);
+  // Throws unless the response is a MEI response starting with pfx.
+  void mei_expect(
+      const Msg& resp,
+      const std::vector<uint8_t>& pfx,
+      const std::string& what);
+
+  void reset();
+  void enter_bootloader();
+  void unlock();
+  void erase();
+  void set_write_address(uint32_t flash_addr);
+  void write_block(const uint8_t* data);
+  void verify();
+
+ public:
+  using FirmwareUpdater::FirmwareUpdater;
+  // Key of the seed challenge.
+  static uint32_t calc_key(uint32_t seed);
+  void run(const std::string& path) override;
+};
@@ -13,7 +13,8 @@
 
 #ifdef PROFILING
 #include <openbmc/profile.hpp>
-#define RACKMON_PROFILE_SCOPE(name, desc, os) openbmc::Profile name(desc, os)
+#define RACKMON_PROFILE_SCOPE(name, desc) \
+  openbmc::Profile name(desc, log_info)
 #else
-#define RACKMON_PROFILE_SCOPE(name, desc, os)
+#define RACKMON_PROFILE_SCOPE(name, desc)
 #endif
@@ -0,0 +1,95 @@
+#include "metrics.hpp"
+#include <algorithm>
+
+using nlohmann::json;
+
+void LatencyHistogram::record(metrics_time latency) {
+  auto it = std::lower_bound(
+      bucket_bounds_ms.begin(),
+      bucket_bounds_ms.end(),
+      latency,
+      [](uint32_t bound_ms, metrics_time val) {
+        return std::chrono::milliseconds(bound_ms) < val;
+      });
+  buckets[std::distance(bucket_bounds_ms.begin(), it)]++;
+  count++;
+  total += latency;
+  max = std::max(max, latency);
+}
+
+void to_json(json& j, const LatencyHistogram& h) {
+  j["count"] = h.count;
+  j["total_us"] = h.total.count();
+  j["max_us"] = h.max.count();
+  j["buckets"] = h.buckets;
+}
+
+void CommandMetrics::record(
+    CommandOutcome outcome,
+    metrics_time lat,
+    metrics_time busy,
+    size_t sent,
+    size_t received) {
+  latency.at(size_t(outcome)).record(lat);
+  busy_time += busy;
+  bytes_sent += sent;
+  bytes_received += received;
+}
+
+void to_json(json& j, const CommandMetrics& m) {
+  j["bytes_sent"] = m.bytes_sent;
+  j["bytes_received"] = m.bytes_received;
+  j["busy_us"] = m.busy_time.count();
+  j["latency"]["success"] = m.get(CommandOutcome::SUCCESS);
+  j["latency"]["crc_error"] = m.get(CommandOutcome::CRC_ERROR);
+  j["latency"]["timeout"] = m.get(CommandOutcome::TIMEOUT);
+  j["latency"]["error"] = m.get(CommandOutcome::ERROR);
+}
+
+void BusMetrics::record(
+    uint8_t addr,
+    CommandOutcome outcome,
+    metrics_time latency,
+    metrics_time busy,
+    size_t sent,
+    size_t received) {
+  std::unique_lock lk(mutex);
+  bus.record(outcome, latency, busy, sent, received);
+  devices[addr].record(outcome, latency, busy, sent, received);
+}
+
+CommandMetrics BusMetrics::get_bus() const {
+  std::unique_lock lk(mutex);
+  return bus;
+}
+
+CommandMetrics BusMetrics::get_device(uint8_t addr) const {
+  std::unique_lock lk(mutex);
+  return devices.at(addr);
+}
+
+float BusMetrics::get_utilization() const {
+  std::unique_lock lk(mutex);
+  auto elapsed = std::chrono::duration_cast<metrics_time>(
+      std::chrono::steady_clock::now() - start_time);
+  if (elapsed == metrics_time::zero())
+    return 0.0;
+  return 100.0 * bus.busy_time.count() / elapsed.count();
+}
+
+void to_json(json& j, const BusMetrics& m) {
+  float utilization = m.get_utilization();
+  std::unique_lock lk(m.mutex);
+  j["uptime_us"] = std::chrono::duration_cast<metrics_time>(
+                       std::chrono::steady_clock::now() - m.start_time)
+                       .count();
+  j["utilization_percent"] = utilization;
+  j["baudrate_changes"] = m.baudrate_changes;
+  j["commands"] = m.bus;
+  j["devices"] = json::array();
+  for (const auto& [addr, dev] : m.devices) {
+    json jdev = dev;
+    jdev["addr"] = addr;
+    j["devices"].push_back(jdev);
+  }
+}
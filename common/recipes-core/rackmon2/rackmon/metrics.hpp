@@ -0,0 +1,99 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+using metrics_time = std::chrono::microseconds;
+
+// Latency histogram with a fixed set of buckets, so the memory
+// used does not depend on the number of commands recorded.
+class LatencyHistogram {
+ public:
+  // Inclusive upper bound of each bucket in milliseconds. A last
+  // bucket, not listed here, collects the slower commands.
+  static constexpr std::array<uint32_t, 11> bucket_bounds_ms = {
+      1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000};
+
+ private:
+  std::array<uint64_t, bucket_bounds_ms.size() + 1> buckets{};
+  uint64_t count = 0;
+  metrics_time total = metrics_time::zero();
+  metrics_time max = metrics_time::zero();
+
+ public:
+  void record(metrics_time latency);
+  uint64_t get_count() const {
+    return count;
+  }
+  uint64_t get_bucket(size_t idx) const {
+    return buckets.at(idx);
+  }
+  metrics_time get_max() const {
+    return max;
+  }
+  friend void to_json(nlohmann::json& j, const LatencyHistogram& h);
+};
+
+enum class CommandOutcome { SUCCESS, CRC_ERROR, TIMEOUT, ERROR, NUM_OUTCOMES };
+
+// Metrics of the commands sent on a bus, or to a single device.
+struct CommandMetrics {
+  std::array<LatencyHistogram, size_t(CommandOutcome::NUM_OUTCOMES)>
+      latency{};
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_received = 0;
+  // Time the bus was held by these commands, this includes
+  // the settle time after the response.
+  metrics_time busy_time = metrics_time::zero();
+
+  void record(
+      CommandOutcome outcome,
+      metrics_time latency,
+      metrics_time busy,
+      size_t sent,
+      size_t received);
+  const LatencyHistogram& get(CommandOutcome outcome) const {
+    return latency.at(size_t(outcome));
+  }
+};
+void to_json(nlohmann::json& j, const CommandMetrics& m);
+
+// Metrics of a Modbus interface, overall and per device address.
+// Bounded by the 256 possible addresses on the bus.
+class BusMetrics {
+  mutable std::mutex mutex{};
+  std::chrono::steady_clock::time_point start_time =
+      std::chrono::steady_clock::now();
+  CommandMetrics bus{};
+  std::map<uint8_t, CommandMetrics> devices{};
+  // Number of times the UART was reconfigured to another baudrate.
+  uint64_t baudrate_changes = 0;
+
+ public:
+  void record(
+      uint8_t addr,
+      CommandOutcome outcome,
+      metrics_time latency,
+      metrics_time busy,
+      size_t sent,
+      size_t received);
+  void record_baudrate_change() {
+    std::unique_lock lk(mutex);
+    baudrate_changes++;
+  }
+  uint64_t get_baudrate_changes() const {
+    std::unique_lock lk(mutex);
+    return baudrate_changes;
+  }
+  // Returns the metrics of the bus as a whole.
+  CommandMetrics get_bus() const;
+  // Returns the metrics of a single device. Throws
+  // std::out_of_range if nothing was sent to the address.
+  CommandMetrics get_device(uint8_t addr) const;
+  // Percent of the time since the metrics were started the
+  // bus was busy executing commands.
+  float get_utilization() const;
+  friend void to_json(nlohmann::json& j, const BusMetrics& m);
+};
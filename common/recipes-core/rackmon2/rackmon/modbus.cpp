@@ -2,6 +2,7 @@
 #include <fstream>
 #include <thread>
 #include "log.hpp"
+#include "modbus_cmds.hpp"
 
 using nlohmann::json;
 
@@ -12,22 +13,64 @@ void Modbus::command(
     modbus_time timeout,
     modbus_time settle_time) {
   RACKMON_PROFILE_SCOPE(
-      modbus_command,
-      "modbus::" + std::to_string(int(req.addr)),
-      profile_store);
+      modbus_command, "modbus::" + std::to_string(int(req.addr)));
   if (timeout == modbus_time::zero())
     timeout = default_timeout;
   if (baud == 0)
     baud = default_baudrate;
   req.encode();
-  std::lock_guard<std::mutex> lck(mutex);
-  dev->set_baudrate(baud);
-  dev->write(req.raw.data(), req.len);
-  dev->read(resp.raw.data(), resp.len, timeout.count());
-  resp.decode();
+  std::lock_guard<BusArbiter> lck(arbiter);
+  auto start = std::chrono::steady_clock::now();
+  auto since_start = [&start]() {
+    return std::chrono::duration_cast<metrics_time>(
+        std::chrono::steady_clock::now() - start);
+  };
+  size_t received = 0;
+  auto record = [&](CommandOutcome outcome) {
+    metrics_time latency = since_start();
+    metrics.record(req.addr, outcome, latency, latency, req.len, received);
+  };
+  try {
+    if (dev->get_baudrate() != int(baud))
+      metrics.record_baudrate_change();
+    dev->set_baudrate(baud);
+    dev->write(req.raw.data(), req.len);
+    size_t expected = resp.len;
+    received = dev->read_frame(
+        resp.raw.data(), expected, timeout.count(), dev->frame_gap_us());
+    resp.len = received;
+    if (received < expected) {
+      // Devices reply with a short exception response
+      // (addr, func | 0x80, code, crc) to requests they reject.
+      resp.validate();
+      if (resp.len == 3 && (resp.raw[1] & 0x80) != 0)
+        throw modbus_exception(resp.raw[2]);
+      throw std::runtime_error(
+          "Short response: " + std::to_string(received) + " of " +
+          std::to_string(expected) + " bytes");
+    }
+    resp.decode();
+  } catch (timeout_exception&) {
+    record(CommandOutcome::TIMEOUT);
+    throw;
+  } catch (crc_exception&) {
+    record(CommandOutcome::CRC_ERROR);
+    throw;
+  } catch (...) {
+    record(CommandOutcome::ERROR);
+    throw;
+  }
+  metrics_time latency = since_start();
   if (settle_time != modbus_time::zero()) {
     std::this_thread::sleep_for(settle_time);
   }
+  metrics.record(
+      req.addr,
+      CommandOutcome::SUCCESS,
+      latency,
+      since_start(),
+      req.len,
+      received);
 }
 
 std::unique_ptr<UARTDevice> Modbus::make_device(
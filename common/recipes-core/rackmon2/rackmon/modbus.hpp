@@ -2,9 +2,9 @@
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include <memory>
-#include <mutex>
 #include <set>
-#include <sstream>
+#include "arbiter.hpp"
+#include "metrics.hpp"
 #include "msg.hpp"
 #include "uart.hpp"
 
@@ -12,23 +12,42 @@ using modbus_time = std::chrono::milliseconds;
 class Modbus {
   std::string device_path{};
   std::unique_ptr<UARTDevice> dev = nullptr;
-  std::mutex mutex{};
+  // Commands are granted the bus in the order of their priority.
+  // (See CommandPriorityScope)
+  BusArbiter arbiter{};
   std::set<uint8_t> ignored_addrs = {};
   uint32_t default_baudrate = 0;
   modbus_time default_timeout = modbus_time::zero();
   modbus_time min_delay = modbus_time::zero();
-  std::ostream& profile_store;
+  BusMetrics metrics{};
 
  public:
-  explicit Modbus(std::ostream& prof) : profile_store(prof) {}
+  Modbus() {}
   virtual ~Modbus() {}
 
   uint32_t get_default_baudrate() const {
     return default_baudrate;
   }
+  virtual modbus_time get_default_timeout() const {
+    return default_timeout;
+  }
   const std::string& name() const {
     return device_path;
   }
+  const BusMetrics& get_metrics() const {
+    return metrics;
+  }
+
+  // Keeps the bus for the commands of the calling thread until the
+  // lock is released, for a transfer split into many commands. The
+  // holder calls yield_bus() in between them to let commands of a
+  // higher priority through.
+  std::unique_lock<BusArbiter> hold_bus() {
+    return std::unique_lock<BusArbiter>(arbiter);
+  }
+  void yield_bus() {
+    arbiter.yield();
+  }
 
   virtual std::unique_ptr<UARTDevice> make_device(
       const std::string& device_type,
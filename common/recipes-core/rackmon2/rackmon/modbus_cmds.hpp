@@ -10,6 +10,15 @@ struct bad_resp_error : public std::runtime_error {
             std::to_string(exp) + " Got: " + std::to_string(val)) {}
 };
 
+// Exception response returned by the device instead
+// of the expected response.
+struct modbus_exception : public std::runtime_error {
+  uint8_t code;
+  explicit modbus_exception(uint8_t c)
+      : std::runtime_error("Modbus Exception Code: " + std::to_string(c)),
+        code(c) {}
+};
+
 //---------- Read Holding Registers -------
 
 struct ReadHoldingRegistersReq : public Msg {
@@ -98,6 +107,9 @@ struct WriteMultipleRegistersResp : public Msg {
 
 //---------- Read File Record ----------------
 struct FileRecord {
+  // Longest read of a record fitting in our Msg buffer
+  // (addr, func, bytes, len, type, crc + 2*N <= 253).
+  static constexpr uint16_t max_length = (max_modbus_length - 7) / 2;
   uint16_t file_num = 0;
   uint16_t record_num = 0;
   std::vector<uint16_t> data{};
@@ -1,50 +1,117 @@
 #include "modbus_device.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include "log.hpp"
+#include "value_provider.hpp"
 
 using nlohmann::json;
 
-ModbusDevice::ModbusDevice(Modbus& iface, uint8_t a, const RegisterMap& reg)
+ModbusDevice::ModbusDevice(
+    Modbus& iface,
+    uint8_t a,
+    const RegisterMap& reg,
+    uint32_t baud)
     : interface(iface), addr(a), register_map(reg) {
   info.addr = a;
-  info.baudrate = reg.default_baudrate;
+  info.baudrate = baud != 0 ? baud : reg.default_baudrate;
   for (auto& it : reg.register_descriptors) {
     info.register_list.emplace_back(it.second);
   }
+  read_plan = plan_register_spans(info.register_list, reg.max_read_hole);
+  publish_snapshot();
   for (const auto& sp : reg.special_handlers) {
     ModbusSpecialHandler hdl{};
     hdl.SpecialHandlerInfo::operator=(sp);
-    special_handlers.push_back(hdl);
+    special_handlers.push_back(std::move(hdl));
   }
 }
 
+metrics_time ResponseTimeEstimator::wire_time(size_t bytes, uint32_t baud) {
+  if (baud == 0)
+    return metrics_time::zero();
+  return metrics_time(uint64_t(bytes) * 11 * 1000000 / baud);
+}
+
+void ResponseTimeEstimator::sample(metrics_time rtt) {
+  rtt = std::max(rtt, metrics_time::zero());
+  if (!valid) {
+    srtt = rtt;
+    rttvar = rtt / 2;
+    valid = true;
+  } else {
+    metrics_time err = srtt > rtt ? srtt - rtt : rtt - srtt;
+    rttvar = (3 * rttvar + err) / 4;
+    srtt = (7 * srtt + rtt) / 8;
+  }
+  backoff = 0;
+}
+
+modbus_time ResponseTimeEstimator::timeout(
+    metrics_time wire,
+    modbus_time max,
+    bool with_backoff) const {
+  if (!valid || max == modbus_time::zero())
+    return max;
+  metrics_time rto = std::max(srtt + 4 * rttvar, min_timeout) + wire;
+  if (with_backoff)
+    rto *= 1 << backoff;
+  return std::min(std::chrono::ceil<modbus_time>(rto), max);
+}
+
 void ModbusDevice::command(
     Msg& req,
     Msg& resp,
     modbus_time timeout,
     modbus_time settle_time) {
+  auto record_failure = [this](uint32_t& counter) {
+    std::unique_lock lk(status_mutex);
+    counter++;
+    if (++info.num_consecutive_failures ==
+        ModbusDeviceStatus::max_consecutive_failures) {
+      // Most likely the device was reset (power cycled or replaced)
+      // which puts it back at the default baudrate.
+      info.baudrate = register_map.default_baudrate;
+      baud_negotiated = false;
+    }
+  };
+  // Explicit timeouts (Raw commands, firmware upgrades, ...) are
+  // honored as is, they may be waiting on slow operations.
+  bool adaptive = timeout == modbus_time::zero();
+  metrics_time wire = ResponseTimeEstimator::wire_time(resp.len, info.baudrate);
+  if (adaptive) {
+    std::unique_lock lk(status_mutex);
+    timeout = response_time.timeout(
+        wire,
+        interface.get_default_timeout(),
+        info.get_mode() == ModbusDeviceMode::ACTIVE);
+  }
+  auto start = std::chrono::steady_clock::now();
   try {
     interface.command(req, resp, info.baudrate, timeout, settle_time);
+    metrics_time elapsed = std::chrono::duration_cast<metrics_time>(
+        std::chrono::steady_clock::now() - start);
+    std::unique_lock lk(status_mutex);
     info.num_consecutive_failures = 0;
     info.last_active = std::time(0);
+    response_time.sample(elapsed - settle_time - wire);
   } catch (timeout_exception& e) {
-    info.timeouts++;
-    info.num_consecutive_failures++;
+    record_failure(info.timeouts);
+    if (adaptive) {
+      std::unique_lock lk(status_mutex);
+      response_time.timed_out();
+    }
     throw;
   } catch (crc_exception& e) {
-    info.crc_failures++;
-    info.num_consecutive_failures++;
+    record_failure(info.crc_failures);
     throw;
   } catch (std::runtime_error& e) {
-    info.misc_failures++;
-    info.num_consecutive_failures++;
+    record_failure(info.misc_failures);
     log_error << e.what() << std::endl;
     throw;
   } catch (...) {
     log_error << "Unknown exception" << std::endl;
-    info.misc_failures++;
-    info.num_consecutive_failures++;
+    record_failure(info.misc_failures);
     throw;
   }
 }
@@ -81,83 +148,278 @@ void ModbusDevice::ReadFileRecord(std::vector<FileRecord>& records) {
   command(req, resp);
 }
 
+void ModbusDevice::ReadFileRecords(
+    uint16_t file_num,
+    uint16_t start_record,
+    uint32_t count,
+    const std::function<void(const FileRecord&)>& cb) {
+  if (uint32_t(start_record) + count > 0x10000)
+    throw std::out_of_range("Record range past the end of the file");
+  std::vector<FileRecord> records(1);
+  FileRecord& rec = records[0];
+  rec.file_num = file_num;
+  auto bus = interface.hold_bus();
+  for (uint32_t done = 0; done < count;) {
+    if (done != 0)
+      interface.yield_bus();
+    uint32_t num = std::min<uint32_t>(count - done, FileRecord::max_length);
+    rec.record_num = start_record + done;
+    rec.data.assign(num, 0);
+    ReadFileRecord(records);
+    cb(rec);
+    done += num;
+  }
+}
+
+void ModbusDevice::set_baudrate(uint32_t baud) {
+  if (baud == info.baudrate)
+    return;
+  const BaudConfig& cfg = register_map.baud_config;
+  if (!cfg.is_set)
+    throw std::out_of_range("Unsupported baudrate change");
+  uint16_t value = cfg.baud_value_map.at(baud);
+  // The device acknowledges at the current baudrate.
+  WriteSingleRegisterReq req(addr, cfg.reg, value);
+  WriteSingleRegisterResp resp(addr, cfg.reg);
+  command(req, resp, baud_cmd_timeout);
+  std::unique_lock lk(status_mutex);
+  info.baudrate = baud;
+}
+
+void ModbusDevice::negotiate_baudrate() {
+  baud_negotiated = true;
+  uint32_t preferred = register_map.preferred_baudrate;
+  const BaudConfig& cfg = register_map.baud_config;
+  if (preferred == info.baudrate || !cfg.is_set ||
+      cfg.baud_value_map.count(preferred) == 0)
+    return;
+  try {
+    set_baudrate(preferred);
+    log_info << "DEV:0x" << std::hex << int(addr) << std::dec
+             << " switched to " << preferred << std::endl;
+  } catch (std::exception& e) {
+    log_error << "DEV:0x" << std::hex << int(addr) << std::dec
+              << " could not switch to " << preferred << ": " << e.what()
+              << std::endl;
+  }
+}
+
+void ModbusDevice::begin_update() {
+  updating = true;
+  try {
+    set_baudrate(register_map.default_baudrate);
+  } catch (std::exception& e) {
+    log_error << "DEV:0x" << std::hex << int(addr) << std::dec
+              << " could not switch back to its default baudrate: "
+              << e.what() << std::endl;
+  }
+}
+
+void ModbusDevice::end_update() {
+  {
+    std::unique_lock lk(status_mutex);
+    info.baudrate = register_map.default_baudrate;
+  }
+  baud_negotiated = false;
+  set_active();
+  updating = false;
+}
+
+std::vector<RegisterSpan> plan_register_spans(
+    const RegisterStoreList& stores,
+    uint16_t max_hole) {
+  std::vector<RegisterSpan> plan;
+  // Index of the last span created for each polling interval.
+  std::map<int32_t, size_t> open_spans;
+  for (size_t i = 0; i < stores.size(); i++) {
+    uint32_t begin = stores[i].reg_addr;
+    uint32_t end = begin + stores[i].desc.length;
+    int32_t interval = stores[i].desc.interval;
+    auto open_it = open_spans.find(interval);
+    if (open_it != open_spans.end()) {
+      RegisterSpan& span = plan[open_it->second];
+      uint32_t span_end = span.begin + span.length;
+      uint32_t new_end = std::max(end, span_end);
+      if (begin <= span_end + max_hole &&
+          new_end - span.begin <= RegisterSpan::max_length) {
+        span.length = new_end - span.begin;
+        span.stores.push_back(i);
+        continue;
+      }
+    }
+    RegisterSpan span;
+    span.begin = begin;
+    span.length = end - begin;
+    span.interval = interval;
+    span.stores.push_back(i);
+    open_spans[interval] = plan.size();
+    plan.push_back(std::move(span));
+  }
+  return plan;
+}
+
 void ModbusDevice::monitor() {
-  uint32_t timestamp = std::time(0);
+  time_t timestamp = std::time(0);
+  if (!baud_negotiated)
+    negotiate_baudrate();
   for (auto& h : special_handlers) {
     h.handle(*this);
   }
   std::unique_lock lk(register_list_mutex);
-  for (auto& h : info.register_list) {
-    uint16_t reg = h.reg_addr;
-    auto& v = h.front();
+  std::vector<uint16_t> span_regs;
+  for (auto& span : read_plan) {
+    if (!span.is_due(timestamp))
+      continue;
+    span_regs.resize(span.length);
     try {
-      ReadHoldingRegisters(reg, v.value);
-      v.timestamp = timestamp;
-      // If we dont care about changes or if we do
-      // and we notice that the value is different
-      // from the previous, increment store to
-      // point to the next.
-      if (!v.desc.changes_only || v != h.back()) {
-        ++h;
-      }
+      RACKMON_PROFILE_SCOPE(
+          read_span,
+          "span::" + std::to_string(int(addr)) + "::" +
+              std::to_string(span.begin) + "+" + std::to_string(span.length));
+      ReadHoldingRegisters(span.begin, span_regs);
     } catch (std::exception& e) {
-      log_info << "DEV:0x" << std::hex << int(addr) << " ReadReg 0x" << std::hex
-               << reg << ' ' << h.desc.name << " caught: " << e.what()
-               << std::endl;
+      log_info << "DEV:0x" << std::hex << int(addr) << " ReadRegs 0x"
+               << std::hex << span.begin << '+' << std::dec << span.length
+               << " caught: " << e.what() << std::endl;
       continue;
     }
+    span.last_read = timestamp;
+    // Scatter the span back into the individual register stores.
+    for (size_t idx : span.stores) {
+      RegisterStore& h = info.register_list[idx];
+      h.push(&span_regs[h.reg_addr - span.begin], timestamp);
+    }
   }
+  publish_snapshot();
 }
 
-ModbusDeviceFmtData ModbusDevice::get_fmt_data() {
-  std::unique_lock lk(register_list_mutex);
+const ModbusDeviceFmtData& ModbusDeviceSnapshot::get_fmt() const {
+  std::call_once(fmt_once, [this]() {
+    fmt.ModbusDeviceStatus::operator=(raw);
+    fmt.type = type;
+    for (const auto& reg : raw.register_list)
+      fmt.register_list.emplace_back(reg);
+  });
+  return fmt;
+}
+
+const ModbusDeviceValueData& ModbusDeviceSnapshot::get_value() const {
+  std::call_once(value_once, [this]() {
+    value.ModbusDeviceStatus::operator=(raw);
+    value.type = type;
+    for (const auto& reg : raw.register_list)
+      value.register_list.emplace_back(reg);
+  });
+  return value;
+}
+
+const json& ModbusDeviceSnapshot::get_raw_json() const {
+  std::call_once(raw_json_once, [this]() { raw_json = raw; });
+  return raw_json;
+}
+
+const json& ModbusDeviceSnapshot::get_fmt_json() const {
+  std::call_once(fmt_json_once, [this]() { fmt_json = get_fmt(); });
+  return fmt_json;
+}
+
+const json& ModbusDeviceSnapshot::get_value_json() const {
+  std::call_once(value_json_once, [this]() { value_json = get_value(); });
+  return value_json;
+}
+
+json ModbusDeviceSnapshot::get_raw_json(
+    const ModbusDeviceFilter& filter) const {
+  if (filter.selects_all_registers())
+    return get_raw_json();
+  json j;
+  to_json(j, static_cast<const ModbusDeviceStatus&>(raw));
+  j["now"] = std::time(0);
+  j["ranges"] = json::array();
+  for (const auto& reg : raw.register_list) {
+    if (!filter.contains(reg))
+      continue;
+    if (!filter.latest_only) {
+      j["ranges"].push_back(reg);
+      continue;
+    }
+    json& range = j["ranges"].emplace_back();
+    range["begin"] = reg.reg_addr;
+    range["readings"] = reg.readings(true);
+  }
+  return j;
+}
+
+json ModbusDeviceSnapshot::get_fmt_json(
+    const ModbusDeviceFilter& filter) const {
+  if (filter.selects_all_registers())
+    return get_fmt_json();
   ModbusDeviceFmtData data;
-  data.ModbusDeviceStatus::operator=(info);
-  data.type = register_map.name;
-  for (const auto& reg : info.register_list) {
-    std::string str = reg;
-    data.register_list.emplace_back(std::move(str));
+  data.ModbusDeviceStatus::operator=(raw);
+  data.type = type;
+  for (const auto& reg : raw.register_list) {
+    if (filter.contains(reg))
+      data.register_list.emplace_back(reg.to_string(filter.latest_only));
   }
   return data;
 }
 
-ModbusDeviceValueData ModbusDevice::get_value_data() {
-  std::unique_lock lk(register_list_mutex);
+json ModbusDeviceSnapshot::get_value_json(
+    const ModbusDeviceFilter& filter) const {
+  if (filter.selects_all_registers())
+    return get_value_json();
   ModbusDeviceValueData data;
-  data.ModbusDeviceStatus::operator=(info);
-  data.type = register_map.name;
-  for (const auto& reg : info.register_list) {
-    data.register_list.emplace_back(reg);
+  data.ModbusDeviceStatus::operator=(raw);
+  data.type = type;
+  for (const auto& reg : raw.register_list) {
+    if (filter.contains(reg))
+      data.register_list.emplace_back(
+          reg.to_value(filter.latest_only, filter.rollups));
   }
   return data;
 }
 
-static std::string command_output(const std::string& shell) {
-  std::array<char, 128> buffer;
-  std::string result;
-  std::unique_ptr<FILE, decltype(&pclose)> pipe(
-      popen(shell.c_str(), "r"), pclose);
-  if (!pipe) {
-    throw std::runtime_error("popen() failed!");
-  }
-  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-    result += buffer.data();
-  }
-  return result;
+void ModbusDevice::publish_snapshot() {
+  std::unique_lock lk(status_mutex);
+  auto snap = std::make_shared<ModbusDeviceSnapshot>(info, register_map.name);
+  lk.unlock();
+  std::atomic_store(
+      &snapshot, std::shared_ptr<const ModbusDeviceSnapshot>(std::move(snap)));
+}
+
+std::optional<std::string> ModbusSpecialHandler::get_value() {
+  if (info.provider)
+    return ValueProviderRegistry::instance().get(info.provider.value());
+  if (info.value)
+    return info.value.value();
+  if (shell_value.wait_for(std::chrono::seconds(0)) !=
+      std::future_status::ready)
+    return std::nullopt;
+  return shell_value.get();
 }
 
 void ModbusSpecialHandler::handle(ModbusDevice& dev) {
+  // The shell command runs on the executor ahead of the time it is
+  // needed, so it is ready by then (Or a pass later).
+  if (info.shell && !info.provider && !info.value && !shell_value.valid() &&
+      (period != -1 || !handled)) {
+    time_t when = handled ? last_handle_time + period + 1 - shell_lead_time : 0;
+    shell_value = ShellExecutor::instance().run_at(info.shell.value(), when);
+  }
   // Check if it is time to handle.
   if (!can_handle())
     return;
   std::string str_value{};
   WriteMultipleRegistersReq req(dev.addr, reg);
-  if (info.shell) {
-    str_value = command_output(info.shell.value());
-  } else if (info.value) {
-    str_value = info.value.value();
-  } else {
-    std::cerr << "NULL action ignored" << std::endl;
+  try {
+    std::optional<std::string> value = get_value();
+    if (!value)
+      return;
+    str_value = value.value();
+  } catch (std::exception& e) {
+    // Retried on the next pass.
+    log_error << "Error getting special handler value: " << e.what()
+              << std::endl;
     return;
   }
   if (info.interpret == RegisterValueType::INTEGER) {
@@ -194,6 +456,32 @@ void to_json(json& j, const ModbusDeviceStatus& m) {
   j["baudrate"] = m.baudrate;
 }
 
+bool ModbusDeviceFilter::contains(uint8_t addr, const std::string& type)
+    const {
+  return (addrs.empty() || addrs.count(addr)) &&
+      (types.empty() || types.count(type));
+}
+
+bool ModbusDeviceFilter::contains(const RegisterStore& reg) const {
+  if (reg_addrs.empty() && reg_names.empty())
+    return true;
+  return reg_addrs.count(reg.reg_addr) || reg_names.count(reg.desc.name);
+}
+
+void from_json(const json& j, ModbusDeviceFilter& f) {
+  f.addrs = j.value("devices", std::set<uint8_t>{});
+  f.types = j.value("types", std::set<std::string>{});
+  // Registers are selected by either their address or name.
+  for (const auto& reg : j.value("registers", json::array())) {
+    if (reg.is_string())
+      f.reg_names.insert(reg.get<std::string>());
+    else
+      f.reg_addrs.insert(reg.get<uint16_t>());
+  }
+  f.latest_only = j.value("latest", false);
+  f.rollups = j.value("rollups", false);
+}
+
 void to_json(json& j, const ModbusDeviceRawData& m) {
   const ModbusDeviceStatus& s = m;
   to_json(j, s);
@@ -1,6 +1,12 @@
+#pragma once
 #include <nlohmann/json.hpp>
 #include <ctime>
+#include <atomic>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include "modbus.hpp"
 #include "modbus_cmds.hpp"
 #include "regmap.hpp"
@@ -10,13 +16,19 @@ enum ModbusDeviceMode { ACTIVE = 0, DORMANT = 1 };
 class ModbusDevice;
 
 struct ModbusSpecialHandler : public SpecialHandlerInfo {
+  // How long ahead of being handled the shell command is run.
+  static constexpr time_t shell_lead_time = 2;
   time_t last_handle_time = 0;
   bool handled = false;
+  // Output of the shell command for the next handling.
+  std::future<std::string> shell_value{};
   bool can_handle() {
     if (period == -1)
       return !handled;
     return std::time(0) > (last_handle_time + period);
   }
+  // Value to write, nullopt when the shell command has not completed yet.
+  std::optional<std::string> get_value();
   void handle(ModbusDevice& dev);
 };
 
@@ -38,7 +50,7 @@ struct ModbusDeviceStatus {
 void to_json(nlohmann::json& j, const ModbusDeviceStatus& m);
 
 struct ModbusDeviceRawData : public ModbusDeviceStatus {
-  std::vector<RegisterStore> register_list{};
+  RegisterStoreList register_list{};
 };
 void to_json(nlohmann::json& j, const ModbusDeviceRawData& m);
 
@@ -54,19 +66,175 @@ struct ModbusDeviceValueData : public ModbusDeviceStatus {
 };
 void to_json(nlohmann::json& j, const ModbusDeviceValueData& m);
 
+// Selection of the monitored data returned by a data query. An
+// empty set does not filter on that attribute.
+struct ModbusDeviceFilter {
+  std::set<uint8_t> addrs{};
+  // Names of the register maps of the devices.
+  std::set<std::string> types{};
+  // Registers are selected if either their address or name matches.
+  std::set<uint16_t> reg_addrs{};
+  std::set<std::string> reg_names{};
+  // Only the last reading of every register, not the history.
+  bool latest_only = false;
+  // Add the aggregates of the registers keeping rollups (value data).
+  bool rollups = false;
+
+  bool selects_all_registers() const {
+    return reg_addrs.empty() && reg_names.empty() && !latest_only &&
+        !rollups;
+  }
+  bool contains(uint8_t addr, const std::string& type) const;
+  bool contains(const RegisterStore& reg) const;
+};
+void from_json(const nlohmann::json& j, ModbusDeviceFilter& f);
+
+// Estimate of the response time of a device, kept the way TCP keeps
+// its RTO (Jacobson/Karels smoothed RTT plus variance). The time the
+// response spends on the wire is excluded from the samples, so the
+// estimate holds for responses of any length.
+struct ResponseTimeEstimator {
+  // Lower bound of the estimated part, absorbs scheduling jitter.
+  static constexpr metrics_time min_timeout = std::chrono::milliseconds(20);
+  // Every consecutive timeout doubles the wait, up to 2^max_backoff.
+  static constexpr unsigned max_backoff = 3;
+  bool valid = false;
+  metrics_time srtt = metrics_time::zero();
+  metrics_time rttvar = metrics_time::zero();
+  unsigned backoff = 0;
+
+  // Time taken to transfer bytes at baud, with 11 bits per character.
+  static metrics_time wire_time(size_t bytes, uint32_t baud);
+  // Record the response time of a successful command.
+  void sample(metrics_time rtt);
+  // Record a command which timed out.
+  void timed_out() {
+    if (backoff < max_backoff)
+      backoff++;
+  }
+  // Timeout of a command whose response takes wire on the wire, never
+  // more than max. Without a sample, this is max. Probes of dormant
+  // devices skip the backoff so they fail fast.
+  modbus_time timeout(metrics_time wire, modbus_time max, bool with_backoff)
+      const;
+};
+
+// Immutable copy of the monitored data of a device. Published by
+// monitor() once per pass and shared by all readers without
+// locking. The formatted views are only rendered when (and the
+// first time) a reader asks for them.
+class ModbusDeviceSnapshot {
+  mutable std::once_flag fmt_once{};
+  mutable std::once_flag value_once{};
+  mutable std::once_flag raw_json_once{};
+  mutable std::once_flag fmt_json_once{};
+  mutable std::once_flag value_json_once{};
+  mutable ModbusDeviceFmtData fmt{};
+  mutable ModbusDeviceValueData value{};
+  // JSON renderings, "now" is the time of the rendering.
+  mutable nlohmann::json raw_json{};
+  mutable nlohmann::json fmt_json{};
+  mutable nlohmann::json value_json{};
+
+ public:
+  const ModbusDeviceRawData raw;
+  // Name of the register map of the device.
+  const std::string type;
+  ModbusDeviceSnapshot(const ModbusDeviceRawData& r, const std::string& t)
+      : raw(r), type(t) {}
+
+  const ModbusDeviceFmtData& get_fmt() const;
+  const ModbusDeviceValueData& get_value() const;
+  const nlohmann::json& get_raw_json() const;
+  const nlohmann::json& get_fmt_json() const;
+  const nlohmann::json& get_value_json() const;
+
+  // Renderings of only the registers selected by the filter. These
+  // are rendered on every call, unless all registers are selected.
+  nlohmann::json get_raw_json(const ModbusDeviceFilter& filter) const;
+  nlohmann::json get_fmt_json(const ModbusDeviceFilter& filter) const;
+  nlohmann::json get_value_json(const ModbusDeviceFilter& filter) const;
+};
+
+// A contiguous range of registers read in a single ReadHoldingRegisters
+// transaction by monitor(). Covers one or more register stores.
+struct RegisterSpan {
+  // Modbus limits a read to 125 registers, but our Msg buffer
+  // can only hold a response of 124 (addr, func, count, crc + 2*N <= 253).
+  static constexpr uint16_t max_length = (max_modbus_length - 5) / 2;
+  uint16_t begin = 0;
+  uint16_t length = 0;
+  // Polling interval shared by all the registers in the span.
+  // (See RegisterDescriptor::interval)
+  int32_t interval = 0;
+  // Time of the last successful read, 0 if never read.
+  time_t last_read = 0;
+  // Indexes into the register_list covered by this span.
+  std::vector<size_t> stores{};
+
+  // Returns true if the span needs to be read at time now.
+  bool is_due(time_t now) const {
+    return last_read == 0 || (interval >= 0 && now >= last_read + interval);
+  }
+};
+
+// Coalesces the (sorted by address) register stores into spans not
+// larger than RegisterSpan::max_length, merging neighbors separated by
+// at most max_hole unread registers. Only registers with the same
+// polling interval are merged into a span.
+std::vector<RegisterSpan> plan_register_spans(
+    const RegisterStoreList& stores,
+    uint16_t max_hole);
+
 class ModbusDevice {
   friend ModbusSpecialHandler;
   Modbus& interface;
   uint8_t addr;
   const RegisterMap& register_map;
   std::mutex register_list_mutex{};
+  // Protects the status (counters) part of info. This is never
+  // held across a Modbus transaction so status queries do not
+  // have to wait for the monitor.
+  mutable std::mutex status_mutex{};
   ModbusDeviceRawData info{};
+  // Protected by status_mutex.
+  ResponseTimeEstimator response_time{};
+  std::vector<RegisterSpan> read_plan{};
   std::vector<ModbusSpecialHandler> special_handlers{};
+  // Only accessed with std::atomic_load/std::atomic_store.
+  std::shared_ptr<const ModbusDeviceSnapshot> snapshot{};
+
+  // Set once the device was (tried to be) switched to the preferred
+  // baudrate. Cleared when the device goes dormant.
+  std::atomic<bool> baud_negotiated = false;
+
+  // Set while the firmware of the device is updated, the monitor
+  // leaves it alone.
+  std::atomic<bool> updating = false;
+
+  // Render and publish a new snapshot. Needs register_list_mutex.
+  void publish_snapshot();
+  // Switch to the preferred baudrate of the register map, if the
+  // device supports it.
+  void negotiate_baudrate();
 
  public:
-  ModbusDevice(Modbus& iface, uint8_t a, const RegisterMap& reg);
+  // Commands switching the baudrate take long to complete.
+  static constexpr modbus_time baud_cmd_timeout =
+      std::chrono::milliseconds(500);
+
+  // A device known to be at baud, the default baudrate of the
+  // register map otherwise.
+  ModbusDevice(
+      Modbus& iface,
+      uint8_t a,
+      const RegisterMap& reg,
+      uint32_t baud = 0);
   virtual ~ModbusDevice() {}
 
+  // Executes a command on the device. When timeout is zero, the
+  // timeout is derived from the response time of the device, capped
+  // by the default timeout of the interface.
   virtual void command(
       Msg& req,
       Msg& resp,
@@ -85,28 +253,78 @@ class ModbusDevice {
 
   void ReadFileRecord(std::vector<FileRecord>& records);
 
+  // Reads count records of a file from start_record on, split into
+  // reads of at most FileRecord::max_length records sent back to back
+  // on the held bus. Each read is passed to cb as it arrives, in order.
+  // Throws std::out_of_range if the range goes past the last record.
+  void ReadFileRecords(
+      uint16_t file_num,
+      uint16_t start_record,
+      uint32_t count,
+      const std::function<void(const FileRecord&)>& cb);
+
+  // Switch the device to baud. Throws std::out_of_range if the
+  // device cannot use it, or the Modbus errors of the command.
+  void set_baudrate(uint32_t baud);
+
   void monitor();
+
+  // Hands the device over to a firmware update. It is no longer
+  // monitored and goes back to its default baudrate, the one of the
+  // bootloader.
+  void begin_update();
+  // The update reset the device, monitor it again from scratch.
+  void end_update();
+  bool is_updating() const {
+    return updating;
+  }
+
+  Modbus& get_interface() {
+    return interface;
+  }
+  const RegisterMap& get_register_map() const {
+    return register_map;
+  }
+  const std::vector<RegisterSpan>& get_read_plan() const {
+    return read_plan;
+  }
   bool is_active() const {
     return info.get_mode() == ModbusDeviceMode::ACTIVE;
   }
   void set_active() {
+    std::unique_lock lk(register_list_mutex);
+    std::unique_lock slk(status_mutex);
     info.num_consecutive_failures = 0;
+    // The device could have been replaced while it was dormant,
+    // re-read everything including the read-once registers.
+    for (auto& span : read_plan)
+      span.last_read = 0;
   }
   time_t last_active() const {
     return info.last_active;
   }
+  // Returns the snapshot published by the last monitor pass.
+  // Never blocks on the monitor.
+  std::shared_ptr<const ModbusDeviceSnapshot> get_snapshot() const {
+    return std::atomic_load(&snapshot);
+  }
   // Simple func, returns a copy of the monitor
   // data.
-  ModbusDeviceRawData get_raw_data() {
-    std::unique_lock lk(register_list_mutex);
-    // Makes a deep copy.
-    return info;
+  ModbusDeviceRawData get_raw_data() const {
+    return get_snapshot()->raw;
   }
-  ModbusDeviceStatus get_status() {
-    std::unique_lock lk(register_list_mutex);
+  ModbusDeviceStatus get_status() const {
+    std::unique_lock lk(status_mutex);
     return info;
   }
-  ModbusDeviceFmtData get_fmt_data();
-
-  ModbusDeviceValueData get_value_data();
+  ResponseTimeEstimator get_response_time() const {
+    std::unique_lock lk(status_mutex);
+    return response_time;
+  }
+  ModbusDeviceFmtData get_fmt_data() const {
+    return get_snapshot()->get_fmt();
+  }
+  ModbusDeviceValueData get_value_data() const {
+    return get_snapshot()->get_value();
+  }
 };
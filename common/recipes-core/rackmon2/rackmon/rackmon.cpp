@@ -1,5 +1,6 @@
 #include "rackmon.hpp"
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include "log.hpp"
@@ -9,7 +10,9 @@ using namespace std::literals;
 
 void Rackmon::load(
     const std::string& conf_path,
-    const std::string& regmap_dir) {
+    const std::string& regmap_dir,
+    const std::string& regmap_cache_path,
+    const std::string& device_table_path) {
   // TODO: Catch parse exceptions and print a pretty
   // message on exactly which configuration fail
   // was bad/missing.
@@ -20,7 +23,9 @@ void Rackmon::load(
     interfaces.push_back(make_interface());
     interfaces.back()->initialize(iface_conf);
   }
-  regmap_db.load(regmap_dir);
+  regmap_db.load(regmap_dir, regmap_cache_path);
+  if (j.contains("shm_name"))
+    shm = std::make_unique<ShmPublisher>(j["shm_name"].get<std::string>());
 
   // Precomputing this makes our scan soooo much easier.
   // its 256 bytes wasted. but worth it.
@@ -33,17 +38,72 @@ void Rackmon::load(
     }
   }
   next_dev_it = possible_dev_addrs.begin();
+
+  if (!device_table_path.empty()) {
+    device_table = std::make_unique<DeviceTable>(device_table_path);
+    restore_devices = device_table->load();
+    saved_devices = restore_devices;
+  }
+}
+
+Rackmon::~Rackmon() {
+  fw_updates_abort = true;
+  for (auto& it : fw_updates) {
+    if (it.second.thread.joinable())
+      it.second.thread.join();
+  }
+  stop();
+  // Put the devices back at their default baudrate, where the next
+  // run of rackmond expects to find them.
+  std::unique_lock lock(devices_mutex);
+  for (auto& it : devices) {
+    if (!it.second->is_active())
+      continue;
+    try {
+      it.second->set_baudrate(it.second->get_register_map().default_baudrate);
+    } catch (std::exception& e) {
+      log_error << "Could not restore the baudrate of " << int(it.first)
+                << ": " << e.what() << std::endl;
+    }
+  }
+}
+
+modbus_time Rackmon::get_probe_timeout(const RegisterMap& rmap) {
+  // Response to a single register read.
+  metrics_time wire =
+      ResponseTimeEstimator::wire_time(7, rmap.default_baudrate);
+  modbus_time timeout = modbus_time::zero();
+  std::shared_lock lock(devices_mutex);
+  for (const auto& it : devices) {
+    if (&it.second->get_register_map() != &rmap || !it.second->is_active())
+      continue;
+    ResponseTimeEstimator est = it.second->get_response_time();
+    if (est.valid)
+      timeout = std::max(timeout, est.timeout(wire, probe_timeout, false));
+  }
+  return timeout == modbus_time::zero() ? probe_timeout : timeout;
 }
 
-bool Rackmon::probe(Modbus& iface, uint8_t addr) {
+bool Rackmon::probe(Modbus& iface, uint8_t addr, uint32_t baud) {
   const RegisterMap& rmap = regmap_db.at(addr);
+  if (baud == 0)
+    baud = rmap.default_baudrate;
   std::vector<uint16_t> v(1);
   try {
     ReadHoldingRegistersReq req(addr, rmap.probe_register, v.size());
     ReadHoldingRegistersResp resp(v);
-    iface.command(req, resp, rmap.default_baudrate, probe_timeout);
+    iface.command(req, resp, baud, get_probe_timeout(rmap));
     std::unique_lock lock(devices_mutex);
-    devices[addr] = std::make_unique<ModbusDevice>(iface, addr, rmap);
+    // Interfaces are scanned concurrently, keep the first one
+    // to find the address.
+    if (devices.find(addr) != devices.end()) {
+      log_error << std::hex << std::setw(2) << std::setfill('0') << "Found "
+                << int(addr) << " on " << iface.name()
+                << " which is already known on another interface"
+                << std::endl;
+      return false;
+    }
+    devices[addr] = std::make_unique<ModbusDevice>(iface, addr, rmap, baud);
     log_info << std::hex << std::setw(2) << std::setfill('0') << "Found "
              << int(addr) << " on " << iface.name() << std::endl;
     return true;
@@ -65,7 +125,7 @@ std::vector<uint8_t> Rackmon::inspect_dormant() {
   std::vector<uint8_t> ret{};
   std::shared_lock lock(devices_mutex);
   for (const auto& it : devices) {
-    if (it.second->is_active())
+    if (it.second->is_active() || it.second->is_updating())
       continue;
     // If its more than 300s since last activity, start probing it.
     // change to something larger if required.
@@ -93,12 +153,33 @@ void Rackmon::recover_dormant() {
   }
 }
 
-void Rackmon::monitor(void) {
-  std::shared_lock lock(devices_mutex);
-  for (const auto& dev_it : devices) {
-    if (!dev_it.second->is_active())
+void Rackmon::monitor(Modbus& iface) {
+  // Scan is the only writer of the device map and it never
+  // removes a device while the threads are running. So it is
+  // safe to release the lock while we are talking to the devices
+  // and not hold up probing (or other interfaces) on slow devices.
+  std::vector<ModbusDevice*> bus_devices;
+  {
+    std::shared_lock lock(devices_mutex);
+    for (const auto& dev_it : devices) {
+      if (&dev_it.second->get_interface() == &iface)
+        bus_devices.push_back(dev_it.second.get());
+    }
+  }
+  // Poll the devices at the same baudrate back to back, so the
+  // UART is reconfigured as few times as possible.
+  std::stable_sort(
+      bus_devices.begin(),
+      bus_devices.end(),
+      [](ModbusDevice* a, ModbusDevice* b) {
+        return a->get_status().baudrate < b->get_status().baudrate;
+      });
+  for (ModbusDevice* dev : bus_devices) {
+    if (!dev->is_active() || dev->is_updating())
       continue;
-    dev_it.second->monitor();
+    dev->monitor();
+    if (shm)
+      shm->publish(*dev->get_snapshot());
   }
   last_monitor_time = std::time(0);
 }
@@ -110,18 +191,39 @@ bool Rackmon::is_device_known(uint8_t addr) {
 
 void Rackmon::scan_all() {
   log_info << "Starting scan of all devices" << std::endl;
-  for (auto& addr : possible_dev_addrs) {
-    if (is_device_known(addr))
-      continue;
-    probe(addr);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> scanners;
+  for (auto& iface : interfaces) {
+    Modbus* bus = iface.get();
+    scanners.emplace_back([this, bus]() {
+      CommandPriorityScope prio(CommandPriority::SCAN);
+      for (uint8_t addr : possible_dev_addrs) {
+        if (is_device_known(addr))
+          continue;
+        probe(*bus, addr);
+      }
+    });
   }
+  for (auto& scanner : scanners)
+    scanner.join();
+  metrics_time duration = std::chrono::duration_cast<metrics_time>(
+      std::chrono::steady_clock::now() - start);
+  last_full_scan_duration = duration;
+  num_full_scans++;
+  log_info << std::dec << "Full scan took " << duration.count() / 1000
+           << "ms" << std::endl;
 }
 
 void Rackmon::scan() {
+  // Probes of absent devices mostly time out, never let them
+  // hold up monitoring.
+  CommandPriorityScope prio(CommandPriority::SCAN);
   // Circular iterator.
   if (force_scan.load()) {
     scan_all();
     force_scan = false;
+    save_device_table();
+    update_shm_layout();
     return;
   }
 
@@ -133,35 +235,120 @@ void Rackmon::scan() {
 
   // Try and recover dormant devices
   recover_dormant();
+  save_device_table();
+  update_shm_layout();
   if (++next_dev_it == possible_dev_addrs.end())
     next_dev_it = possible_dev_addrs.begin();
 }
 
+void Rackmon::restore() {
+  CommandPriorityScope prio(CommandPriority::SCAN);
+  for (const auto& entry : restore_devices) {
+    // The register maps could have changed since.
+    try {
+      if (regmap_db.at(entry.addr).name != entry.type)
+        continue;
+    } catch (std::out_of_range&) {
+      continue;
+    }
+    if (is_device_known(entry.addr))
+      continue;
+    for (auto& iface : interfaces) {
+      if (iface->name() != entry.interface)
+        continue;
+      // The device could still be at the baudrate it was switched to,
+      // if only rackmond restarted.
+      if (!probe(*iface, entry.addr) &&
+          entry.baudrate != regmap_db.at(entry.addr).default_baudrate)
+        probe(*iface, entry.addr, entry.baudrate);
+      break;
+    }
+  }
+  std::shared_lock lock(devices_mutex);
+  log_info << "Restored " << devices.size() << " of "
+           << restore_devices.size() << " known devices" << std::endl;
+}
+
+void Rackmon::save_device_table() {
+  if (!device_table)
+    return;
+  std::vector<DeviceTableEntry> table;
+  {
+    std::shared_lock lock(devices_mutex);
+    for (const auto& it : devices) {
+      DeviceTableEntry entry;
+      entry.interface = it.second->get_interface().name();
+      entry.addr = it.first;
+      entry.baudrate = it.second->get_status().baudrate;
+      entry.type = it.second->get_register_map().name;
+      table.push_back(entry);
+    }
+  }
+  if (table == saved_devices)
+    return;
+  device_table->save(table);
+  saved_devices = std::move(table);
+}
+
+void Rackmon::update_shm_layout() {
+  if (!shm)
+    return;
+  std::vector<std::shared_ptr<const ModbusDeviceSnapshot>> snaps;
+  {
+    std::shared_lock lock(devices_mutex);
+    // Devices are never removed, the same number is the same devices.
+    if (devices.size() == shm_num_devices)
+      return;
+    for (const auto& it : devices)
+      snaps.push_back(it.second->get_snapshot());
+  }
+  shm->set_devices(snaps);
+  shm_num_devices = snaps.size();
+}
+
 void Rackmon::start(poll_interval interval) {
   auto start_thread = [this](auto func, auto intr) {
     threads.emplace_back(
         std::make_unique<PollThread<Rackmon>>(func, this, intr));
     threads.back()->start();
   };
+  std::unique_lock lock(threads_mutex);
   if (threads.size() != 0)
     throw std::runtime_error("Already running");
+  if (!restored) {
+    restore();
+    restored = true;
+    update_shm_layout();
+  }
   start_thread(&Rackmon::scan, interval);
-  start_thread(&Rackmon::monitor, interval);
+  for (auto& iface : interfaces) {
+    Modbus* bus = iface.get();
+    start_thread([bus](Rackmon* self) { self->monitor(*bus); }, interval);
+  }
 }
 
 void Rackmon::stop() {
   // TODO We probably need a timer to ensure we
   // are not waiting here forever.
+  std::unique_lock lock(threads_mutex);
   while (threads.size() > 0) {
     threads.back()->stop();
     threads.pop_back();
   }
 }
 
+// Raw commands changing the state of the device are control commands.
+static bool is_write_cmd(const Msg& req) {
+  uint8_t func = req.len > 1 ? req.raw[1] : 0;
+  return func == 0x05 || func == 0x06 || func == 0x0f || func == 0x10;
+}
+
 void Rackmon::rawCmd(Msg& req, Msg& resp, modbus_time timeout) {
   uint8_t addr = req.addr;
-  RACKMON_PROFILE_SCOPE(
-      raw_cmd, "rawcmd::" + std::to_string(int(req.addr)), profile_store);
+  RACKMON_PROFILE_SCOPE(raw_cmd, "rawcmd::" + std::to_string(int(req.addr)));
+  CommandPriorityScope prio(
+      is_write_cmd(req) ? CommandPriority::CONTROL
+                        : CommandPriority::INTERACTIVE);
   std::shared_lock lock(devices_mutex);
   if (!devices.at(addr)->is_active()) {
     throw std::exception();
@@ -175,8 +362,8 @@ void Rackmon::ReadHoldingRegisters(
     uint8_t addr,
     uint16_t reg_off,
     std::vector<uint16_t>& regs) {
-  RACKMON_PROFILE_SCOPE(
-      raw_cmd, "readRegs::" + std::to_string(int(addr)), profile_store);
+  RACKMON_PROFILE_SCOPE(raw_cmd, "readRegs::" + std::to_string(int(addr)));
+  CommandPriorityScope prio(CommandPriority::INTERACTIVE);
   std::shared_lock lock(devices_mutex);
   if (!devices.at(addr)->is_active()) {
     throw std::exception();
@@ -188,8 +375,8 @@ void Rackmon::WriteSingleRegister(
     uint8_t addr,
     uint16_t reg_off,
     uint16_t value) {
-  RACKMON_PROFILE_SCOPE(
-      raw_cmd, "writeReg::" + std::to_string(int(addr)), profile_store);
+  RACKMON_PROFILE_SCOPE(raw_cmd, "writeReg::" + std::to_string(int(addr)));
+  CommandPriorityScope prio(CommandPriority::CONTROL);
   std::shared_lock lock(devices_mutex);
   if (!devices.at(addr)->is_active()) {
     throw std::exception();
@@ -201,8 +388,8 @@ void Rackmon::WriteMultipleRegisters(
     uint8_t addr,
     uint16_t reg_off,
     std::vector<uint16_t>& values) {
-  RACKMON_PROFILE_SCOPE(
-      raw_cmd, "writeRegs::" + std::to_string(int(addr)), profile_store);
+  RACKMON_PROFILE_SCOPE(raw_cmd, "writeRegs::" + std::to_string(int(addr)));
+  CommandPriorityScope prio(CommandPriority::CONTROL);
   std::shared_lock lock(devices_mutex);
   if (!devices.at(addr)->is_active()) {
     throw std::exception();
@@ -211,8 +398,8 @@ void Rackmon::WriteMultipleRegisters(
 }
 
 void Rackmon::ReadFileRecord(uint8_t addr, std::vector<FileRecord>& records) {
-  RACKMON_PROFILE_SCOPE(
-      raw_cmd, "ReadFile::" + std::to_string(int(addr)), profile_store);
+  RACKMON_PROFILE_SCOPE(raw_cmd, "ReadFile::" + std::to_string(int(addr)));
+  CommandPriorityScope prio(CommandPriority::INTERACTIVE);
   std::shared_lock lock(devices_mutex);
   if (!devices.at(addr)->is_active()) {
     throw std::exception();
@@ -220,6 +407,100 @@ void Rackmon::ReadFileRecord(uint8_t addr, std::vector<FileRecord>& records) {
   devices.at(addr)->ReadFileRecord(records);
 }
 
+void Rackmon::ReadFileRecords(
+    uint8_t addr,
+    uint16_t file_num,
+    uint16_t start_record,
+    uint32_t count,
+    const std::function<void(const FileRecord&)>& cb) {
+  RACKMON_PROFILE_SCOPE(raw_cmd, "ReadFiles::" + std::to_string(int(addr)));
+  CommandPriorityScope prio(CommandPriority::INTERACTIVE);
+  std::shared_lock lock(devices_mutex);
+  if (!devices.at(addr)->is_active()) {
+    throw std::exception();
+  }
+  devices.at(addr)->ReadFileRecords(file_num, start_record, count, cb);
+}
+
+void Rackmon::start_firmware_update(
+    uint8_t addr,
+    const std::string& vendor,
+    const std::string& image_path) {
+  ModbusDevice* dev = nullptr;
+  {
+    std::shared_lock lock(devices_mutex);
+    auto it = devices.find(addr);
+    if (it == devices.end())
+      throw std::logic_error("Unknown device: " + std::to_string(addr));
+    dev = it->second.get();
+  }
+  // Check the whole image before the device is touched.
+  size_t image_size = HexImageReader::data_size(image_path);
+
+  std::unique_lock lk(fw_updates_mutex);
+  auto job_it = fw_updates.find(addr);
+  if (job_it != fw_updates.end()) {
+    if (job_it->second.status.in_progress())
+      throw std::logic_error("Update already in progress");
+    job_it->second.thread.join();
+    fw_updates.erase(job_it);
+  }
+  // The job stays in the map (at the same place) till the next update
+  // of the device, which cannot start before this one is done.
+  auto set_state = [this, addr](const std::string& state) {
+    std::unique_lock lk(fw_updates_mutex);
+    fw_updates.at(addr).status.state = state;
+  };
+  auto add_progress = [this, addr](size_t bytes) {
+    std::unique_lock lk(fw_updates_mutex);
+    fw_updates.at(addr).status.bytes_sent += bytes;
+  };
+  std::unique_ptr<FirmwareUpdater> updater = make_firmware_updater(
+      vendor, *dev, set_state, add_progress, fw_updates_abort);
+
+  FirmwareUpdateJob& job = fw_updates[addr];
+  job.status.addr = addr;
+  job.status.vendor = vendor;
+  job.status.image_path = image_path;
+  job.status.bytes_total = image_size;
+  job.status.start_time = std::time(0);
+  log_info << "DEV:0x" << std::hex << int(addr) << std::dec
+           << " starting firmware update with " << image_path << std::endl;
+
+  dev->begin_update();
+  job.thread = std::thread(
+      [this, dev, addr, image_path, up = std::move(updater)]() {
+        // Same class as the raw commands of the update scripts.
+        CommandPriorityScope prio(CommandPriority::INTERACTIVE);
+        std::string error{};
+        try {
+          up->run(image_path);
+        } catch (std::exception& e) {
+          error = e.what();
+        }
+        dev->end_update();
+        std::unique_lock lk(fw_updates_mutex);
+        FirmwareUpdateStatus& status = fw_updates.at(addr).status;
+        status.state = error.empty() ? "done" : "failed";
+        status.error = error;
+        status.end_time = std::time(0);
+        if (error.empty())
+          log_info << "DEV:0x" << std::hex << int(addr) << std::dec
+                   << " firmware update done" << std::endl;
+        else
+          log_error << "DEV:0x" << std::hex << int(addr) << std::dec
+                    << " firmware update failed: " << error << std::endl;
+      });
+}
+
+std::vector<FirmwareUpdateStatus> Rackmon::get_firmware_update_status() {
+  std::unique_lock lk(fw_updates_mutex);
+  std::vector<FirmwareUpdateStatus> ret;
+  for (const auto& it : fw_updates)
+    ret.push_back(it.second.status);
+  return ret;
+}
+
 std::vector<ModbusDeviceStatus> Rackmon::list_devices() {
   std::shared_lock lock(devices_mutex);
   std::vector<ModbusDeviceStatus> ret;
@@ -257,8 +538,55 @@ void Rackmon::get_value_data(std::vector<ModbusDeviceValueData>& ret) {
       });
 }
 
-std::string Rackmon::get_profile_data() {
-  std::stringstream ss;
-  profile_store.swap(ss);
-  return ss.str();
+void Rackmon::get_data(
+    json& ret,
+    const ModbusDeviceFilter& filter,
+    json (ModbusDeviceSnapshot::*render)(const ModbusDeviceFilter&) const) {
+  std::vector<std::shared_ptr<const ModbusDeviceSnapshot>> snaps;
+  {
+    std::shared_lock lock(devices_mutex);
+    for (const auto& it : devices) {
+      if (filter.contains(it.first, it.second->get_register_map().name))
+        snaps.push_back(it.second->get_snapshot());
+    }
+  }
+  // Rendering can take a while, do it without holding up the scan.
+  ret = json::array();
+  for (const auto& snap : snaps)
+    ret.push_back(((*snap).*render)(filter));
+}
+
+void Rackmon::get_raw_data(json& ret, const ModbusDeviceFilter& filter) {
+  get_data(ret, filter, &ModbusDeviceSnapshot::get_raw_json);
+}
+
+void Rackmon::get_fmt_data(json& ret, const ModbusDeviceFilter& filter) {
+  get_data(ret, filter, &ModbusDeviceSnapshot::get_fmt_json);
+}
+
+void Rackmon::get_value_data(json& ret, const ModbusDeviceFilter& filter) {
+  get_data(ret, filter, &ModbusDeviceSnapshot::get_value_json);
+}
+
+void Rackmon::get_snapshots(
+    std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& ret) {
+  ret.clear();
+  std::shared_lock lock(devices_mutex);
+  std::transform(
+      devices.begin(), devices.end(), std::back_inserter(ret), [](auto& kv) {
+        return kv.second->get_snapshot();
+      });
+}
+
+void Rackmon::get_metrics(nlohmann::json& ret) {
+  ret = nlohmann::json::object();
+  ret["bucket_bounds_ms"] = LatencyHistogram::bucket_bounds_ms;
+  ret["scan"]["full_scans"] = num_full_scans.load();
+  ret["scan"]["last_full_scan_us"] = last_full_scan_duration.load().count();
+  ret["interfaces"] = nlohmann::json::array();
+  for (const auto& iface : interfaces) {
+    nlohmann::json j = iface->get_metrics();
+    j["device_path"] = iface->name();
+    ret["interfaces"].push_back(j);
+  }
 }
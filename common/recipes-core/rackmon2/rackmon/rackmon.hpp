@@ -2,14 +2,19 @@
 #include <atomic>
 #include <shared_mutex>
 #include <thread>
+#include "device_table.hpp"
+#include "fw_update.hpp"
 #include "modbus.hpp"
 #include "modbus_device.hpp"
 #include "pollthread.hpp"
+#include "shm_publisher.hpp"
 
 class Rackmon {
   static constexpr time_t dormant_min_inactive_time = 300;
   static constexpr modbus_time probe_timeout = std::chrono::milliseconds(50);
   std::vector<std::unique_ptr<PollThread<Rackmon>>> threads{};
+  // Serializes start/stop requests.
+  std::mutex threads_mutex{};
   // Has to be before defining active or dormant devices
   // to ensure users get destroyed before the interface.
   std::vector<std::unique_ptr<Modbus>> interfaces{};
@@ -17,8 +22,6 @@ class Rackmon {
 
   mutable std::shared_mutex devices_mutex{};
 
-  std::stringstream profile_store{};
-
   // These devices discovered on actively monitored busses
   std::map<uint8_t, std::unique_ptr<ModbusDevice>> devices{};
 
@@ -35,10 +38,42 @@ class Rackmon {
 
   // Timestamps of last scan
   time_t last_scan_time;
-  time_t last_monitor_time;
-
-  // Probe an interface for the presence of the address.
-  bool probe(Modbus& iface, uint8_t addr);
+  std::atomic<time_t> last_monitor_time = 0;
+
+  // Devices known to the previous run, probed at the first start.
+  std::unique_ptr<DeviceTable> device_table{};
+  std::vector<DeviceTableEntry> restore_devices{};
+  bool restored = false;
+  // Last persisted contents of the device table.
+  std::vector<DeviceTableEntry> saved_devices{};
+
+  // Shared memory export of the monitored data, if configured.
+  std::unique_ptr<ShmPublisher> shm{};
+  // Number of devices in the layout of the export.
+  size_t shm_num_devices = 0;
+
+  // Firmware updates started since rackmond started, finished ones
+  // included, each running on its own thread.
+  struct FirmwareUpdateJob {
+    FirmwareUpdateStatus status{};
+    std::thread thread{};
+  };
+  std::mutex fw_updates_mutex{};
+  std::map<uint8_t, FirmwareUpdateJob> fw_updates{};
+  // Asks the updates in progress to stop, on exit.
+  std::atomic<bool> fw_updates_abort = false;
+
+  // Metrics of the full scans.
+  std::atomic<uint32_t> num_full_scans = 0;
+  std::atomic<metrics_time> last_full_scan_duration = metrics_time::zero();
+
+  // Timeout to use when probing for a device of the register map.
+  // Devices of a kind respond alike, so once one of them is known
+  // probes for its siblings fail as fast as it would.
+  modbus_time get_probe_timeout(const RegisterMap& rmap);
+  // Probe an interface for the presence of the address, at baud
+  // or the default baudrate of the register map.
+  bool probe(Modbus& iface, uint8_t addr, uint32_t baud = 0);
   // Probe all interfaces for the presence of the address.
   void probe(uint8_t addr);
 
@@ -51,31 +86,57 @@ class Rackmon {
 
   bool is_device_known(uint8_t);
 
-  // Monitor loop. Blocks forever as long as req_stop is true.
-  void monitor();
+  // Monitor all active devices on an interface. Each interface
+  // is polled by its own thread, so a misbehaving device on one
+  // bus does not delay monitoring of devices on other busses.
+  void monitor(Modbus& iface);
 
   // Scan all possible devices. Skips active/dormant devices.
+  // The interfaces are scanned concurrently.
   void scan_all();
 
   // Scan loop. Blocks forever as long as req_stop is true.
   void scan();
 
+  // Probe the devices of the previous run.
+  void restore();
+  // Persist the device table, if it changed.
+  void save_device_table();
+  // Lay out the shared memory export again, if devices were found.
+  void update_shm_layout();
+
+  // Render the data of the devices selected by the filter.
+  void get_data(
+      nlohmann::json& ret,
+      const ModbusDeviceFilter& filter,
+      nlohmann::json (ModbusDeviceSnapshot::*render)(
+          const ModbusDeviceFilter&) const);
+
  protected:
   virtual std::unique_ptr<Modbus> make_interface() {
-    std::unique_ptr<Modbus> iface = std::make_unique<Modbus>(profile_store);
+    std::unique_ptr<Modbus> iface = std::make_unique<Modbus>();
     return std::move(iface);
   }
 
  public:
-  virtual ~Rackmon() {
-    stop();
-  }
+  virtual ~Rackmon();
 
   // Load configuration, preferable before starting, but can be
   // done at any time, but this is a one time only.
-  void load(const std::string& conf_path, const std::string& regmap_dir);
-
-  // Start the monitoring/scanning loops
+  // The register maps are loaded from the compiled cache at
+  // regmap_cache_path, if provided, when it is up to date. The
+  // known devices are persisted in device_table_path, if provided.
+  // The monitored data is exported in the shared memory object named
+  // by "shm_name" of the configuration, if set.
+  void load(
+      const std::string& conf_path,
+      const std::string& regmap_dir,
+      const std::string& regmap_cache_path = "",
+      const std::string& device_table_path = "");
+
+  // Start the monitoring/scanning loops. The first start probes the
+  // devices in the device table before starting the loops, so these
+  // are monitored right away while the full scan runs in the background.
   void start(poll_interval interval = std::chrono::minutes(3));
   // Stop the monitoring/scanning loops
   void stop();
@@ -106,6 +167,29 @@ class Rackmon {
   // Read File Record
   void ReadFileRecord(uint8_t addr, std::vector<FileRecord>& records);
 
+  // Read count records of a file from start_record on, passed to cb
+  // a read at a time (See ModbusDevice::ReadFileRecords)
+  void ReadFileRecords(
+      uint8_t addr,
+      uint16_t file_num,
+      uint16_t start_record,
+      uint32_t count,
+      const std::function<void(const FileRecord&)>& cb);
+
+  // Start updating the firmware of the device at addr with the image
+  // at image_path, using the update sequence of vendor. The update runs
+  // in the background, the rest of the devices are monitored as usual.
+  // Throws std::logic_error on a bad request (Unknown device or vendor,
+  // an update of the device already in progress) and
+  // std::runtime_error if the image cannot be read.
+  void start_firmware_update(
+      uint8_t addr,
+      const std::string& vendor,
+      const std::string& image_path);
+
+  // Progress of the firmware updates.
+  std::vector<FirmwareUpdateStatus> get_firmware_update_status();
+
   // Get status of devices
   std::vector<ModbusDeviceStatus> list_devices();
 
@@ -118,6 +202,19 @@ class Rackmon {
   // Get value data
   void get_value_data(std::vector<ModbusDeviceValueData>& ret);
 
-  // Get profile data
-  std::string get_profile_data();
+  // Get only the data selected by the filter, as a JSON array of
+  // devices. The devices and registers are selected before any of
+  // the data is copied or formatted.
+  void get_raw_data(nlohmann::json& ret, const ModbusDeviceFilter& filter);
+  void get_fmt_data(nlohmann::json& ret, const ModbusDeviceFilter& filter);
+  void get_value_data(nlohmann::json& ret, const ModbusDeviceFilter& filter);
+
+  // Get the latest published snapshot of every device. This
+  // does not contend with the monitor threads.
+  void get_snapshots(
+      std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& ret);
+
+  // Get the command latency, traffic and utilization metrics
+  // of every interface.
+  void get_metrics(nlohmann::json& ret);
 };
@@ -1,10 +1,22 @@
 #include <CLI/CLI.hpp>
 #include <nlohmann/json.hpp>
+#include <fstream>
+#include "encoding.hpp"
 #include "rackmon_svc_unix.hpp"
 
 using nlohmann::json;
 using namespace std::literals::string_literals;
 
+// Request CBOR encoded responses from rackmond.
+static bool use_cbor = false;
+
+static ResponseEncoding get_encoding(json& req) {
+  if (!use_cbor)
+    return ResponseEncoding::JSON;
+  req["encoding"] = "cbor";
+  return ResponseEncoding::CBOR;
+}
+
 static int send_recv(const char* str, size_t len, std::vector<char>& resp) {
   RackmonClient cli;
   cli.send(str, len);
@@ -12,6 +24,19 @@ static int send_recv(const char* str, size_t len, std::vector<char>& resp) {
   return 0;
 }
 
+static json do_request(json& req) {
+  ResponseEncoding resp_encoding = get_encoding(req);
+  std::string req_s = req.dump();
+  std::vector<char> resp;
+  send_recv(req_s.c_str(), req_s.length(), resp);
+  try {
+    return decode_response(resp, resp_encoding);
+  } catch (...) {
+    // Errors about the encoding itself are always in JSON.
+    return json::parse(resp);
+  }
+}
+
 static void print_json(json& j) {
   std::string status;
   json data = j["data"];
@@ -111,7 +136,8 @@ static void print_text(const std::string& req_s, json& j) {
   std::string status;
   j.at("status").get_to(status);
   if (status == "SUCCESS") {
-    if (req_s == "data" || req_s == "formatted_data" || req_s == "profile")
+    if (req_s == "data" || req_s == "formatted_data" || req_s == "metrics" ||
+        req_s == "firmware_update_status")
       print_nested(j["data"]);
     else if (req_s == "list")
       print_table(j["data"]);
@@ -136,10 +162,7 @@ do_raw_cmd(const std::string& req_s, int timeout, int resp_len, bool json_fmt) {
   req["response_length"] = resp_len;
   if (timeout != 0)
     req["timeout"] = timeout;
-  std::vector<char> resp;
-  std::string req_js = req.dump();
-  send_recv(req_js.c_str(), req_js.length(), resp);
-  json resp_j = json::parse(resp);
+  json resp_j = do_request(req);
   if (json_fmt)
     print_json(resp_j);
   else
@@ -149,16 +172,149 @@ do_raw_cmd(const std::string& req_s, int timeout, int resp_len, bool json_fmt) {
 static void do_cmd(const std::string& type, bool json_fmt) {
   json req;
   req["type"] = type;
-  std::string req_s = req.dump();
-  std::vector<char> resp;
-  send_recv(req_s.c_str(), req_s.length(), resp);
-  json resp_j = json::parse(resp);
+  json resp_j = do_request(req);
   if (json_fmt)
     print_json(resp_j);
   else
     print_text(type, resp_j);
 }
 
+// Data command, optionally filtered by rackmond.
+static void do_data_cmd(
+    const std::string& type,
+    const json& filter,
+    bool json_fmt) {
+  json req;
+  req["type"] = type;
+  if (!filter.empty())
+    req["filter"] = filter;
+  json resp_j = do_request(req);
+  if (json_fmt)
+    print_json(resp_j);
+  else
+    print_text(type, resp_j);
+}
+
+static void do_fw_update(
+    int addr,
+    const std::string& vendor,
+    const std::string& image_path,
+    bool json_fmt) {
+  json req;
+  req["type"] = "firmware_update";
+  req["addr"] = addr;
+  req["vendor"] = vendor;
+  req["image_path"] = image_path;
+  json resp_j = do_request(req);
+  if (json_fmt)
+    print_json(resp_j);
+  else
+    print_text("firmware_update", resp_j);
+}
+
+// Records are printed as hex words, or written big endian to out_path.
+static void do_read_file(
+    int addr,
+    int file_num,
+    int record_num,
+    int count,
+    const std::string& out_path,
+    bool json_fmt) {
+  json req;
+  req["type"] = "read_file_records";
+  req["addr"] = addr;
+  req["file_num"] = file_num;
+  req["record_num"] = record_num;
+  req["count"] = count;
+  json resp_j = do_request(req);
+  if (json_fmt) {
+    print_json(resp_j);
+    return;
+  }
+  if (resp_j["status"] != "SUCCESS") {
+    std::cerr << "FAILURE: " << resp_j["status"] << std::endl;
+    exit(1);
+  }
+  if (out_path.empty()) {
+    for (const uint16_t word : resp_j["data"])
+      std::cout << std::right << std::setfill('0') << std::setw(4) << std::hex
+                << word << ' ';
+    std::cout << std::endl;
+    return;
+  }
+  std::ofstream out(out_path, std::ios::binary);
+  for (const uint16_t word : resp_j["data"])
+    out.put(char(word >> 8)).put(char(word & 0xff));
+  if (!out) {
+    std::cerr << "Cannot write " << out_path << std::endl;
+    exit(1);
+  }
+}
+
+static json make_filter(
+    const std::vector<int>& devices,
+    const std::vector<std::string>& types,
+    const std::vector<std::string>& registers,
+    bool latest,
+    bool rollups) {
+  json filter = json::object();
+  if (!devices.empty())
+    filter["devices"] = devices;
+  if (!types.empty())
+    filter["types"] = types;
+  for (const auto& reg : registers) {
+    // Registers are given either by address or by name.
+    char* end = nullptr;
+    long reg_addr = strtol(reg.c_str(), &end, 0);
+    if (!reg.empty() && *end == '\0')
+      filter["registers"].push_back(reg_addr);
+    else
+      filter["registers"].push_back(reg);
+  }
+  if (latest)
+    filter["latest"] = true;
+  if (rollups)
+    filter["rollups"] = true;
+  return filter;
+}
+
+static void do_subscribe(
+    const std::vector<int>& devices,
+    const std::vector<int>& registers,
+    bool json_fmt) {
+  json req;
+  req["type"] = "subscribe";
+  if (!devices.empty())
+    req["devices"] = devices;
+  if (!registers.empty())
+    req["registers"] = registers;
+  ResponseEncoding resp_encoding = get_encoding(req);
+  std::string req_s = req.dump();
+  RackmonClient cli;
+  cli.send(req_s.c_str(), req_s.length());
+  std::vector<char> resp;
+  cli.recv(resp);
+  json ack = decode_response(resp, resp_encoding);
+  if (ack["status"] != "SUCCESS") {
+    std::cerr << "FAILURE: " << ack["status"] << std::endl;
+    exit(1);
+  }
+  // Block forever printing the registers as they change.
+  while (true) {
+    try {
+      cli.recv(resp);
+    } catch (std::exception& e) {
+      std::cerr << "Subscription ended: " << e.what() << std::endl;
+      break;
+    }
+    json update = decode_response(resp, resp_encoding);
+    if (json_fmt)
+      std::cout << update["data"].dump() << std::endl;
+    else
+      print_nested(update["data"]);
+  }
+}
+
 int main(int argc, char* argv[]) {
   CLI::App app("Rackmon CLI interface");
   app.failure_message(CLI::FailureMessage::help);
@@ -167,6 +323,7 @@ int main(int argc, char* argv[]) {
   // Allow flags/options to fallthrough from subcommands.
   app.fallthrough();
   app.add_flag("-j,--json", json_fmt, "JSON output instead of text");
+  app.add_flag("--cbor", use_cbor, "Request CBOR encoded responses");
 
   // Raw command
   int raw_cmd_timeout = 0;
@@ -200,15 +357,77 @@ int main(int argc, char* argv[]) {
       return "value_data";
     return "data";
   };
+  std::vector<int> data_devices{};
+  std::vector<std::string> data_types{};
+  std::vector<std::string> data_registers{};
+  bool data_latest = false;
+  bool data_rollups = false;
   auto data = app.add_subcommand("data", "Return detailed monitoring data");
-  data->callback([&]() { do_cmd(get_data_cmd(), json_fmt); });
+  data->callback([&]() {
+    json filter = make_filter(
+        data_devices, data_types, data_registers, data_latest, data_rollups);
+    do_data_cmd(get_data_cmd(), filter, json_fmt);
+  });
   data->add_flag(
       "-f,--format", format_data, "Formats the data as per the register map");
   data->add_flag("-v,--value", value_data, "Formats the data as values");
+  data->add_option("-d,--device", data_devices, "Only devices of this address");
+  data->add_option("-t,--type", data_types, "Only devices of this type");
+  data->add_option(
+      "-r,--register", data_registers, "Only registers of this address/name");
+  data->add_flag("-l,--latest", data_latest, "Only the latest readings");
+  data->add_flag(
+      "--rollups", data_rollups, "Add the rollups of the registers (-v)");
+
+  // Metrics
+  app.add_subcommand("metrics", "Print command latency and bus utilization")
+      ->callback([&]() { do_cmd("metrics", json_fmt); });
 
-  // Profile
-  app.add_subcommand("profile", "Print profiling data collected from last read")
-      ->callback([&]() { do_cmd("profile", json_fmt); });
+  // Subscribe to register changes
+  std::vector<int> sub_devices{};
+  std::vector<int> sub_registers{};
+  auto subscribe =
+      app.add_subcommand("subscribe", "Stream register values as they change");
+  subscribe->add_option(
+      "-d,--device", sub_devices, "Only devices of this address");
+  subscribe->add_option(
+      "-r,--register", sub_registers, "Only registers starting at this address");
+  subscribe->callback(
+      [&]() { do_subscribe(sub_devices, sub_registers, json_fmt); });
+
+  // Firmware update, progress with fw-status.
+  int fw_addr = 0;
+  std::string fw_vendor{};
+  std::string fw_image{};
+  auto fw_update =
+      app.add_subcommand("fw-update", "Start a firmware update of a device");
+  fw_update->add_option("addr", fw_addr, "Device address")->required();
+  fw_update->add_option("vendor", fw_vendor, "Vendor, ex: delta")->required();
+  fw_update->add_option("image", fw_image, "Path to the image (Intel HEX)")
+      ->required()
+      ->check(CLI::ExistingFile);
+  fw_update->callback(
+      [&]() { do_fw_update(fw_addr, fw_vendor, fw_image, json_fmt); });
+  app.add_subcommand("fw-status", "Progress of the firmware updates")
+      ->callback([&]() { do_cmd("firmware_update_status", json_fmt); });
+
+  // Ranged file record read, for vendor logs.
+  int file_addr = 0;
+  int file_num = 0;
+  int file_record = 0;
+  int file_count = 0;
+  std::string file_out{};
+  auto read_file =
+      app.add_subcommand("read-file", "Read a range of file records");
+  read_file->add_option("addr", file_addr, "Device address")->required();
+  read_file->add_option("file", file_num, "File number")->required();
+  read_file->add_option("record", file_record, "First record")->required();
+  read_file->add_option("count", file_count, "Number of records")->required();
+  read_file->add_option("-o,--output", file_out, "Write the records to file");
+  read_file->callback([&]() {
+    do_read_file(
+        file_addr, file_num, file_record, file_count, file_out, json_fmt);
+  });
 
   // Pause command
   app.add_subcommand("pause", "Pause monitoring")->callback([&]() {
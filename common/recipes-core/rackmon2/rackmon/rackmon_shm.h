@@ -0,0 +1,117 @@
+/*
+ * Shared memory export of the data monitored by rackmond.
+ *
+ * rackmond (when configured with "shm_name") publishes the register
+ * history of every known device in a POSIX shared memory object.
+ * Readers on the BMC get the readings without talking to the service:
+ * every device block is protected by a sequence lock, so readers never
+ * block rackmond (or each other) and simply retry a read which raced
+ * with an update.
+ *
+ * Readers should use the functions below rather than the layout, which
+ * is only valid for RACKMON_SHM_VERSION.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RACKMON_SHM_DEFAULT_NAME "/rackmon"
+#define RACKMON_SHM_MAGIC 0x4e4d4b52 /* "RKMN" */
+#define RACKMON_SHM_VERSION 1
+#define RACKMON_SHM_NAME_LEN 32
+#define RACKMON_SHM_MAX_DEVICES 256
+
+/*
+ * Layout: The header, followed by the device blocks. A device block
+ * is a struct rackmon_shm_device, its struct rackmon_shm_register(s),
+ * then the timestamps and the words of the readings of all of them.
+ * All offsets are in bytes.
+ */
+struct rackmon_shm_header {
+  uint32_t magic;
+  uint32_t version;
+  /* Odd while rackmond rewrites the layout (new devices). */
+  uint32_t layout_seq;
+  /* Bytes of the object in use. */
+  uint32_t size;
+  /* Offset of the block of the device at each address, 0 if none. */
+  uint32_t device_offset[RACKMON_SHM_MAX_DEVICES];
+};
+
+struct rackmon_shm_register {
+  uint16_t reg_addr;
+  /* Words of a reading. */
+  uint16_t length;
+  /* Number of readings kept. */
+  uint16_t keep;
+  /* Slot written next, i.e. the oldest reading. */
+  uint16_t next_slot;
+  /* Offsets from the device block of the keep timestamps and the
+   * keep * length words of the readings. A zero timestamp marks an
+   * empty slot. */
+  uint32_t timestamps_offset;
+  uint32_t words_offset;
+  char name[RACKMON_SHM_NAME_LEN];
+};
+
+struct rackmon_shm_device {
+  /* Odd while rackmond updates the block. */
+  uint32_t seq;
+  uint8_t addr;
+  /* 0: active, 1: dormant. */
+  uint8_t mode;
+  uint16_t num_registers;
+  uint32_t baudrate;
+  uint32_t crc_failures;
+  uint32_t timeouts;
+  uint32_t misc_failures;
+  int64_t last_active;
+  /* Name of the register map. */
+  char type[RACKMON_SHM_NAME_LEN];
+  /* Followed by num_registers struct rackmon_shm_register. */
+};
+
+/* Reader handle. Not to be shared between threads. */
+typedef struct rackmon_shm rackmon_shm_t;
+
+/* Opens the export, NULL (errno set) if rackmond does not publish
+ * one of this version. */
+rackmon_shm_t* rackmon_shm_open(const char* name);
+void rackmon_shm_close(rackmon_shm_t* shm);
+
+/* Writes the addresses of up to max devices to addrs, returns the
+ * number of devices or a negative errno. */
+int rackmon_shm_devices(rackmon_shm_t* shm, uint8_t* addrs, size_t max);
+
+/* Reads the latest reading of the register starting at reg_addr of
+ * the device at addr. Writes up to max_words words to value and the
+ * time of the reading to timestamp (if not NULL). Returns the length
+ * of the register in words, -ENOENT if there is no such device,
+ * register or reading, or -EAGAIN if rackmond kept updating it. */
+int rackmon_shm_read_latest(
+    rackmon_shm_t* shm,
+    uint8_t addr,
+    uint16_t reg_addr,
+    uint16_t* value,
+    size_t max_words,
+    uint32_t* timestamp);
+
+/* Same, but of up to max_readings of the history, oldest first.
+ * values holds max_readings * max_words words, a reading per
+ * max_words. Returns the number of readings or a negative errno. */
+int rackmon_shm_read_history(
+    rackmon_shm_t* shm,
+    uint8_t addr,
+    uint16_t reg_addr,
+    uint16_t* values,
+    size_t max_words,
+    uint32_t* timestamps,
+    size_t max_readings);
+
+#ifdef __cplusplus
+}
+#endif
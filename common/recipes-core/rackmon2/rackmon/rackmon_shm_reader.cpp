@@ -0,0 +1,218 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include "rackmon_shm.h"
+
+struct rackmon_shm {
+  int fd = -1;
+  const uint8_t* base = nullptr;
+  size_t mapped = 0;
+};
+
+// Readers give up after this many reads raced with an update.
+static constexpr int max_read_tries = 1000;
+
+static const rackmon_shm_header* header(const rackmon_shm_t* shm) {
+  return reinterpret_cast<const rackmon_shm_header*>(shm->base);
+}
+
+static uint32_t load_seq(const uint32_t* seq) {
+  return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+// Map all of the object, it grows as rackmond finds devices.
+static int remap(rackmon_shm_t* shm) {
+  struct stat st;
+  if (fstat(shm->fd, &st) != 0)
+    return -errno;
+  size_t size = st.st_size;
+  if (size < sizeof(rackmon_shm_header))
+    return -EAGAIN;
+  void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, shm->fd, 0);
+  if (base == MAP_FAILED)
+    return -errno;
+  if (shm->base != nullptr)
+    munmap(const_cast<uint8_t*>(shm->base), shm->mapped);
+  shm->base = static_cast<const uint8_t*>(base);
+  shm->mapped = size;
+  return 0;
+}
+
+extern "C" rackmon_shm_t* rackmon_shm_open(const char* name) {
+  rackmon_shm_t* shm = new rackmon_shm_t;
+  shm->fd = shm_open(name, O_RDONLY, 0);
+  int ret = shm->fd < 0 ? -errno : remap(shm);
+  if (ret == 0 &&
+      (header(shm)->magic != RACKMON_SHM_MAGIC ||
+       header(shm)->version != RACKMON_SHM_VERSION))
+    ret = -EPROTO;
+  if (ret != 0) {
+    rackmon_shm_close(shm);
+    errno = -ret;
+    return nullptr;
+  }
+  return shm;
+}
+
+extern "C" void rackmon_shm_close(rackmon_shm_t* shm) {
+  if (shm == nullptr)
+    return;
+  if (shm->base != nullptr)
+    munmap(const_cast<uint8_t*>(shm->base), shm->mapped);
+  if (shm->fd >= 0)
+    close(shm->fd);
+  delete shm;
+}
+
+// Runs read() on a consistent copy of the layout and of the block of
+// the device at addr (nullptr if there is none). read() returns the
+// result, but it is only returned if no update raced with it.
+template <typename Read>
+static int read_device(rackmon_shm_t* shm, uint8_t addr, Read read) {
+  for (int tries = 0; tries < max_read_tries; tries++) {
+    const rackmon_shm_header* hdr = header(shm);
+    uint32_t layout = load_seq(&hdr->layout_seq);
+    if (layout & 1)
+      continue;
+    if (hdr->size > shm->mapped) {
+      int ret = remap(shm);
+      if (ret != 0)
+        return ret;
+      continue;
+    }
+    uint32_t offset = hdr->device_offset[addr];
+    const rackmon_shm_device* dev = nullptr;
+    uint32_t seq = 0;
+    if (offset != 0 && offset + sizeof(rackmon_shm_device) <= shm->mapped) {
+      dev = reinterpret_cast<const rackmon_shm_device*>(shm->base + offset);
+      seq = load_seq(&dev->seq);
+      if (seq & 1)
+        continue;
+    }
+    int ret = read(dev, shm->mapped - offset);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (dev != nullptr && __atomic_load_n(&dev->seq, __ATOMIC_RELAXED) != seq)
+      continue;
+    if (__atomic_load_n(&hdr->layout_seq, __ATOMIC_RELAXED) != layout)
+      continue;
+    return ret;
+  }
+  return -EAGAIN;
+}
+
+// Returns the register of the device, nullptr if not found (or
+// the block is torn and does not fit in avail bytes).
+static const rackmon_shm_register*
+find_register(const rackmon_shm_device* dev, size_t avail, uint16_t reg) {
+  if (dev == nullptr)
+    return nullptr;
+  size_t num = dev->num_registers;
+  if (sizeof(*dev) + num * sizeof(rackmon_shm_register) > avail)
+    return nullptr;
+  const rackmon_shm_register* regs =
+      reinterpret_cast<const rackmon_shm_register*>(dev + 1);
+  for (size_t i = 0; i < num; i++) {
+    if (regs[i].reg_addr != reg)
+      continue;
+    size_t end = std::max(
+        regs[i].timestamps_offset + regs[i].keep * sizeof(uint32_t),
+        regs[i].words_offset +
+            size_t(regs[i].keep) * regs[i].length * sizeof(uint16_t));
+    return end <= avail ? &regs[i] : nullptr;
+  }
+  return nullptr;
+}
+
+// Copies a reading (slot) of the register.
+static void copy_reading(
+    const rackmon_shm_device* dev,
+    const rackmon_shm_register* reg,
+    size_t slot,
+    uint16_t* value,
+    size_t max_words,
+    uint32_t* timestamp) {
+  const uint8_t* block = reinterpret_cast<const uint8_t*>(dev);
+  const uint32_t* timestamps =
+      reinterpret_cast<const uint32_t*>(block + reg->timestamps_offset);
+  const uint16_t* words =
+      reinterpret_cast<const uint16_t*>(block + reg->words_offset);
+  std::memcpy(
+      value,
+      words + slot * reg->length,
+      std::min<size_t>(max_words, reg->length) * sizeof(uint16_t));
+  if (timestamp != nullptr)
+    *timestamp = timestamps[slot];
+}
+
+extern "C" int rackmon_shm_devices(
+    rackmon_shm_t* shm,
+    uint8_t* addrs,
+    size_t max) {
+  return read_device(
+      shm, 0, [&](const rackmon_shm_device* /* unused */, size_t) {
+        size_t num = 0;
+        for (size_t addr = 0; addr < RACKMON_SHM_MAX_DEVICES; addr++) {
+          if (header(shm)->device_offset[addr] == 0)
+            continue;
+          if (num < max)
+            addrs[num] = uint8_t(addr);
+          num++;
+        }
+        return int(num);
+      });
+}
+
+extern "C" int rackmon_shm_read_latest(
+    rackmon_shm_t* shm,
+    uint8_t addr,
+    uint16_t reg_addr,
+    uint16_t* value,
+    size_t max_words,
+    uint32_t* timestamp) {
+  return read_device(
+      shm, addr, [&](const rackmon_shm_device* dev, size_t avail) {
+        const rackmon_shm_register* reg = find_register(dev, avail, reg_addr);
+        if (reg == nullptr || reg->keep == 0)
+          return -ENOENT;
+        size_t slot = reg->next_slot == 0 ? reg->keep - 1 : reg->next_slot - 1;
+        uint32_t ts = 0;
+        copy_reading(dev, reg, slot, value, max_words, &ts);
+        if (ts == 0)
+          return -ENOENT;
+        if (timestamp != nullptr)
+          *timestamp = ts;
+        return int(reg->length);
+      });
+}
+
+extern "C" int rackmon_shm_read_history(
+    rackmon_shm_t* shm,
+    uint8_t addr,
+    uint16_t reg_addr,
+    uint16_t* values,
+    size_t max_words,
+    uint32_t* timestamps,
+    size_t max_readings) {
+  return read_device(
+      shm, addr, [&](const rackmon_shm_device* dev, size_t avail) {
+        const rackmon_shm_register* reg = find_register(dev, avail, reg_addr);
+        if (reg == nullptr)
+          return -ENOENT;
+        size_t num = 0;
+        // Oldest first, starting at the slot to be written next.
+        for (size_t i = 0; i < reg->keep && num < max_readings; i++) {
+          size_t slot = (reg->next_slot + i) % reg->keep;
+          uint32_t ts = 0;
+          copy_reading(
+              dev, reg, slot, values + num * max_words, max_words, &ts);
+          if (ts == 0)
+            continue;
+          timestamps[num++] = ts;
+        }
+        return int(num);
+      });
+}
@@ -84,10 +84,14 @@ void RackmonSock::send(const char* buf, size_t len) {
 bool RackmonSock::recvchunk(std::vector<char>& resp)
 {
   uint16_t recv_len;
-  if (::recv(sock, &recv_len, sizeof(recv_len), 0) < 0) {
+  int ret = ::recv(sock, &recv_len, sizeof(recv_len), MSG_WAITALL);
+  if (ret < 0) {
     throw std::system_error(
       std::error_code(errno, std::generic_category()), "recv header");
   }
+  if (ret != sizeof(recv_len)) {
+    throw std::runtime_error("Connection closed");
+  }
   // Received dummy, that was our last chunk!
   if (recv_len == 0)
     return false;
@@ -101,6 +105,9 @@ bool RackmonSock::recvchunk(std::vector<char>& resp)
       throw std::system_error(
         std::error_code(errno, std::generic_category()), "recv body");
     }
+    if (chunk_size == 0) {
+      throw std::runtime_error("Connection closed");
+    }
     received += (size_t)chunk_size;
     recv_buf += (size_t)chunk_size;
   }
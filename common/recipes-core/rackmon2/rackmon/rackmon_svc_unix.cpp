@@ -2,10 +2,17 @@
 #include <nlohmann/json.hpp>
 #include <poll.h>
 #include <unistd.h>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
 #include <iostream>
+#include <set>
 #include "log.hpp"
+#include "encoding.hpp"
+#include "pollthread.hpp"
 #include "rackmon.hpp"
+#include "subscription.hpp"
+#include "workerpool.hpp"
 
 using nlohmann::json;
 
@@ -13,6 +20,13 @@ class RackmonUNIXSocketService {
   // The configuration file paths.
   const std::string rackmon_configuration_path = "/etc/rackmon.conf";
   const std::string rackmon_regmap_dir_path = "/etc/rackmon.d";
+  // Compiled cache of the register maps, on persistent storage
+  // so it survives BMC reboots.
+  const std::string rackmon_regmap_cache_path =
+      "/mnt/data/rackmon/regmap.cache";
+  // Devices found by the previous run, probed first on a restart.
+  const std::string rackmon_device_table_path =
+      "/mnt/data/rackmon/devices.json";
   Rackmon rackmond{};
   // The pipe used for the signal handler to request
   // for the loops to exit.
@@ -24,6 +38,38 @@ class RackmonUNIXSocketService {
   // The socket we want to receive connections from.
   std::unique_ptr<RackmonService> sock = nullptr;
 
+  // Workers receiving requests and serving the read-only ones
+  // from the published snapshots.
+  static constexpr size_t num_service_workers = 4;
+  std::unique_ptr<WorkerPool> service_workers = nullptr;
+  // Workers executing requests which need the UART (or change
+  // the state of rackmond). Kept separate so read-only requests
+  // never have to queue behind a slow device.
+  static constexpr size_t num_command_workers = 2;
+  std::unique_ptr<WorkerPool> command_workers = nullptr;
+  // Time to wait for a client to send its request.
+  static constexpr time_t client_recv_timeout_sec = 10;
+
+  // Clients subscribed to register changes. Each keeps its
+  // connection open and is pushed the changed registers.
+  struct Subscriber {
+    std::shared_ptr<RackmonSock> sock;
+    RegisterSubscription subscription;
+    ResponseEncoding encoding = ResponseEncoding::JSON;
+  };
+  std::mutex subscribers_mutex{};
+  std::vector<Subscriber> subscribers{};
+  std::unique_ptr<PollThread<RackmonUNIXSocketService>> push_thread = nullptr;
+  static constexpr poll_interval push_interval = std::chrono::seconds(1);
+  // Time to wait on a subscriber which is not reading its pushes.
+  static constexpr time_t subscriber_send_timeout_sec = 1;
+
+  // Register a new subscriber on the given connection.
+  void handle_subscribe(const json& req, std::shared_ptr<RackmonSock> sock);
+  // Push the changed registers to every subscriber, called
+  // periodically by push_thread.
+  void push_changes();
+
   void register_exit_handler();
 
   // Handle commands with the JSON format.
@@ -34,10 +80,13 @@ class RackmonUNIXSocketService {
       std::vector<char>& req_buf,
       std::vector<char>& resp_buf);
   void handle_legacy_command(std::vector<char>& req_buf, RackmonSock& cli);
-  // Handle a connection from a client. Currently
-  // we can deal with one client at a time, but we
-  // could easily extend this to multiple with threading.
-  void handle_connection(std::unique_ptr<RackmonSock> sock);
+  // Returns true if the command can be served without
+  // waiting on the UART.
+  static bool is_readonly_command(const json& req);
+  // Handle a connection from a client. Runs on a service
+  // worker, read-only requests are handled right away while
+  // the others are queued to the command workers.
+  void handle_connection(std::shared_ptr<RackmonSock> sock);
 
  public:
   RackmonUNIXSocketService() {}
@@ -61,6 +110,14 @@ class RackmonUNIXSocketService {
 
 RackmonUNIXSocketService RackmonUNIXSocketService::svc;
 
+// Optional filter of the data commands, everything by default.
+static ModbusDeviceFilter get_filter(const json& req) {
+  ModbusDeviceFilter filter{};
+  if (req.contains("filter"))
+    req["filter"].get_to(filter);
+  return filter;
+}
+
 void RackmonUNIXSocketService::handle_json_command(
     const json& req,
     json& resp) {
@@ -77,26 +134,40 @@ void RackmonUNIXSocketService::handle_json_command(
     for (size_t i = 0; i < resp_m.len; i++) {
       resp["data"].push_back(int(resp_m.raw[i]));
     }
+  } else if (cmd == "read_file_records") {
+    resp["data"] = json::array();
+    json& data = resp["data"];
+    rackmond.ReadFileRecords(
+        req.at("addr").get<uint8_t>(),
+        req.at("file_num").get<uint16_t>(),
+        req.at("record_num").get<uint16_t>(),
+        req.at("count").get<uint32_t>(),
+        [&data](const FileRecord& rec) {
+          for (uint16_t word : rec.data)
+            data.push_back(word);
+        });
   } else if (cmd == "list") {
     resp["data"] = rackmond.list_devices();
   } else if (cmd == "data") {
-    std::vector<ModbusDeviceRawData> ret;
-    rackmond.get_raw_data(ret);
-    resp["data"] = ret;
+    rackmond.get_raw_data(resp["data"], get_filter(req));
   } else if (cmd == "pause") {
     rackmond.stop();
   } else if (cmd == "resume") {
     rackmond.start();
   } else if (cmd == "formatted_data") {
-    std::vector<ModbusDeviceFmtData> ret;
-    rackmond.get_fmt_data(ret);
-    resp["data"] = ret;
+    rackmond.get_fmt_data(resp["data"], get_filter(req));
   } else if (cmd == "value_data") {
-    std::vector<ModbusDeviceValueData> ret;
-    rackmond.get_value_data(ret);
-    resp["data"] = ret;
-  } else if (cmd == "profile") {
-    resp["data"] = rackmond.get_profile_data();
+    rackmond.get_value_data(resp["data"], get_filter(req));
+  } else if (cmd == "firmware_update") {
+    rackmond.start_firmware_update(
+        req.at("addr").get<uint8_t>(),
+        req.at("vendor").get<std::string>(),
+        req.at("image_path").get<std::string>());
+  } else if (cmd == "firmware_update_status") {
+    resp["data"] = rackmond.get_firmware_update_status();
+  } else if (cmd == "metrics" || cmd == "profile") {
+    // "profile" is kept as an alias for older clients.
+    rackmond.get_metrics(resp["data"]);
   } else {
     throw std::logic_error("UNKNOWN_CMD: " + cmd);
   }
@@ -110,6 +181,8 @@ void RackmonUNIXSocketService::handle_json_command(
     log_error << "ERROR Executing: " << req["type"] << e.what() << std::endl;
   };
   json resp;
+  // Errors about a bad encoding are reported in JSON.
+  ResponseEncoding enc = ResponseEncoding::JSON;
 
   // Handle the JSON command and this is where all the
   // exceptions we have been ignoring all the way from
@@ -117,6 +190,7 @@ void RackmonUNIXSocketService::handle_json_command(
   // each exception to an error code.
   // TODO: Work with rest-api to correctly define these.
   try {
+    enc = get_response_encoding(req);
     handle_json_command(req, resp);
   } catch (crc_exception& e) {
     resp["status"] = "CRC_ERROR";
@@ -141,9 +215,9 @@ void RackmonUNIXSocketService::handle_json_command(
     print_msg(e);
   }
 
-  std::string resp_s = resp.dump();
+  std::vector<uint8_t> resp_b = encode_response(resp, enc);
   try {
-    cli.send(resp_s.c_str(), resp_s.length());
+    cli.send(reinterpret_cast<const char*>(resp_b.data()), resp_b.size());
   } catch (std::exception& e) {
     log_error << "Unable to send response: " << e.what() << std::endl;
   }
@@ -248,17 +322,31 @@ void RackmonUNIXSocketService::initialize(
     int /*unused */,
     char** /* unused */) {
   log_info << "Loading configuration" << std::endl;
-  rackmond.load(rackmon_configuration_path, rackmon_regmap_dir_path);
+  rackmond.load(
+      rackmon_configuration_path,
+      rackmon_regmap_dir_path,
+      rackmon_regmap_cache_path,
+      rackmon_device_table_path);
   log_info << "Starting rackmon threads" << std::endl;
   rackmond.start();
   // rackmond.start();
   register_exit_handler();
   log_info << "Creating Rackmon UNIX service" << std::endl;
+  service_workers = std::make_unique<WorkerPool>(num_service_workers);
+  command_workers = std::make_unique<WorkerPool>(num_command_workers);
+  push_thread = std::make_unique<PollThread<RackmonUNIXSocketService>>(
+      &RackmonUNIXSocketService::push_changes, this, push_interval);
+  push_thread->start();
   sock = std::make_unique<RackmonService>();
 }
 
 void RackmonUNIXSocketService::deinitialize() {
   log_info << "Deinitializing... stopping rackmond" << std::endl;
+  // Service workers queue to the command workers, stop them first.
+  service_workers = nullptr;
+  command_workers = nullptr;
+  push_thread = nullptr;
+  subscribers.clear();
   rackmond.stop();
   sock = nullptr;
   if (backchannel_req != -1) {
@@ -271,8 +359,82 @@ void RackmonUNIXSocketService::deinitialize() {
   }
 }
 
+void RackmonUNIXSocketService::handle_subscribe(
+    const json& req,
+    std::shared_ptr<RackmonSock> sock) {
+  json resp;
+  Subscriber sub{sock, {}};
+  try {
+    req.get_to(sub.subscription);
+    sub.encoding = get_response_encoding(req);
+    resp["status"] = "SUCCESS";
+  } catch (std::exception& e) {
+    log_error << "Bad subscription request: " << e.what() << std::endl;
+    resp["status"] = "USER_ERROR";
+  }
+  struct timeval tv {
+    subscriber_send_timeout_sec, 0
+  };
+  if (setsockopt(
+          sock->get_sock(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0) {
+    log_error << "Failed to set subscriber send timeout" << std::endl;
+  }
+  std::string resp_s = resp.dump();
+  try {
+    sock->send(resp_s.c_str(), resp_s.length());
+  } catch (std::exception& e) {
+    log_error << "Unable to send response: " << e.what() << std::endl;
+    return;
+  }
+  if (resp["status"] != "SUCCESS")
+    return;
+  std::unique_lock lk(subscribers_mutex);
+  subscribers.push_back(std::move(sub));
+}
+
+void RackmonUNIXSocketService::push_changes() {
+  std::vector<std::shared_ptr<const ModbusDeviceSnapshot>> snaps;
+  rackmond.get_snapshots(snaps);
+  std::unique_lock lk(subscribers_mutex);
+  auto it = subscribers.begin();
+  while (it != subscribers.end()) {
+    std::vector<ModbusDeviceValueData> changes =
+        it->subscription.changes(snaps);
+    if (changes.empty()) {
+      ++it;
+      continue;
+    }
+    json update;
+    update["status"] = "SUCCESS";
+    update["data"] = changes;
+    std::vector<uint8_t> update_b = encode_response(update, it->encoding);
+    try {
+      it->sock->send(
+          reinterpret_cast<const char*>(update_b.data()), update_b.size());
+      ++it;
+    } catch (std::exception& e) {
+      log_info << "Dropping subscriber: " << e.what() << std::endl;
+      it = subscribers.erase(it);
+    }
+  }
+}
+
+bool RackmonUNIXSocketService::is_readonly_command(const json& req) {
+  static const std::set<std::string> readonly_cmds = {
+      "list",
+      "data",
+      "formatted_data",
+      "value_data",
+      "metrics",
+      "profile",
+      "firmware_update_status"};
+  auto type = req.find("type");
+  return type != req.end() && type->is_string() &&
+      readonly_cmds.count(type->get<std::string>()) != 0;
+}
+
 void RackmonUNIXSocketService::handle_connection(
-    std::unique_ptr<RackmonSock> sock) {
+    std::shared_ptr<RackmonSock> sock) {
   std::vector<char> buf;
 
   try {
@@ -289,10 +451,26 @@ void RackmonUNIXSocketService::handle_connection(
     is_json = false;
   }
 
-  if (is_json)
+  if (is_json && is_readonly_command(req)) {
     handle_json_command(req, *sock);
-  else
-    handle_legacy_command(buf, *sock);
+    return;
+  }
+  if (is_json && req.value("type", "") == "subscribe") {
+    handle_subscribe(req, sock);
+    return;
+  }
+  try {
+    if (is_json) {
+      command_workers->post(
+          [this, req, sock]() { handle_json_command(req, *sock); });
+    } else {
+      command_workers->post([this, buf, sock]() mutable {
+        handle_legacy_command(buf, *sock);
+      });
+    }
+  } catch (std::exception& e) {
+    log_error << "Unable to queue command: " << e.what() << std::endl;
+  }
 }
 
 void RackmonUNIXSocketService::do_loop() {
@@ -333,17 +511,35 @@ void RackmonUNIXSocketService::do_loop() {
         log_error << "Failed to accept new connection" << std::endl;
         continue;
       }
-      auto clisock = std::make_unique<RackmonSock>(clifd);
-      auto tid = std::thread(
-          &RackmonUNIXSocketService::handle_connection,
-          this,
-          std::move(clisock));
-      tid.detach();
+      // Do not let a stuck client hold up a worker forever.
+      struct timeval tv {
+        client_recv_timeout_sec, 0
+      };
+      if (setsockopt(clifd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) {
+        log_error << "Failed to set client receive timeout" << std::endl;
+      }
+      auto clisock = std::make_shared<RackmonSock>(clifd);
+      service_workers->post([this, clisock]() { handle_connection(clisock); });
     }
   }
 }
 
+#ifdef RACKMON_SYSLOG
+// Messages per second (and burst) to syslogd.
+static constexpr unsigned log_rate = 20;
+static constexpr unsigned log_burst = 100;
+#endif
+
 int main(int argc, char* argv[]) {
+#ifdef RACKMON_SYSLOG
+  // Register read failures of a whole bus must not stall the poll threads.
+  if (obmc_log_set_async(log_rate, log_burst) != 0) {
+    log_warn << "Synchronous logging: " << std::strerror(errno) << std::endl;
+  }
+#endif
+#ifdef PROFILING
+  openbmc::trace::startExporter("rackmond", std::chrono::seconds(10));
+#endif
   RackmonUNIXSocketService::svc.initialize(argc, argv);
   RackmonUNIXSocketService::svc.do_loop();
   RackmonUNIXSocketService::svc.deinitialize();
@@ -1,4 +1,6 @@
 #include "regmap.hpp"
+#include "regmap_cache.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -42,18 +44,36 @@ NLOHMANN_JSON_SERIALIZE_ENUM(
         {RegisterValueType::FLAGS, "flags"},
     })
 
+void from_json(const json& j, RollupDescriptor& r) {
+  j.at("period").get_to(r.period);
+  j.at("keep").get_to(r.keep);
+  if (r.period == 0 || r.keep == 0)
+    throw std::out_of_range("Invalid rollup: period and keep must be set");
+}
+void to_json(json& j, const RollupDescriptor& r) {
+  j["period"] = r.period;
+  j["keep"] = r.keep;
+}
+
 void from_json(const json& j, RegisterDescriptor& i) {
   j.at("begin").get_to(i.begin);
   j.at("length").get_to(i.length);
   j.at("name").get_to(i.name);
   i.keep = j.value("keep", 1);
   i.changes_only = j.value("changes_only", false);
+  i.interval = j.value("interval", 0);
+  if (i.interval < -1)
+    throw std::out_of_range("Invalid interval: " + std::to_string(i.interval));
   i.format = j.value("format", RegisterValueType::HEX);
   if (i.format == RegisterValueType::FLOAT) {
     j.at("precision").get_to(i.precision);
   } else if (i.format == RegisterValueType::FLAGS) {
     j.at("flags").get_to(i.flags);
   }
+  i.rollups = j.value("rollups", std::vector<RollupDescriptor>{});
+  if (!i.rollups.empty() && i.format != RegisterValueType::INTEGER &&
+      i.format != RegisterValueType::FLOAT)
+    throw std::out_of_range("Rollups of non-numeric register " + i.name);
 }
 void to_json(json& j, const RegisterDescriptor& i) {
   j["begin"] = i.begin;
@@ -61,12 +81,15 @@ void to_json(json& j, const RegisterDescriptor& i) {
   j["name"] = i.name;
   j["keep"] = i.keep;
   j["changes_only"] = i.changes_only;
+  j["interval"] = i.interval;
   j["format"] = i.format;
   if (i.format == RegisterValueType::FLOAT) {
     j["precision"] = i.precision;
   } else if (i.format == RegisterValueType::FLAGS) {
     j["flags"] = i.flags;
   }
+  if (!i.rollups.empty())
+    j["rollups"] = i.rollups;
 }
 
 void RegisterValue::make_string(const std::vector<uint16_t>& reg) {
@@ -292,7 +315,117 @@ void to_json(json& j, const Register& m) {
   j["data"] = data;
 }
 
-RegisterStore::operator std::string() const {
+// Numeric value of an INTEGER or FLOAT register, the way RegisterValue
+// interprets it but without materializing one.
+static float numeric_value(
+    const uint16_t* reg,
+    const RegisterDescriptor& desc) {
+  int32_t ival = std::accumulate(
+      reg, reg + desc.length, 0, [](int32_t ac, uint16_t v) {
+        return (ac << 16) + v;
+      });
+  if (desc.format == RegisterValueType::FLOAT)
+    return float(ival) / float(1 << desc.precision);
+  return float(ival);
+}
+
+void to_json(json& j, const RegisterRollup& m) {
+  j["time"] = m.timestamp;
+  j["count"] = m.count;
+  j["min"] = m.min;
+  j["max"] = m.max;
+  j["avg"] = m.avg();
+  j["last"] = m.last;
+}
+
+void to_json(json& j, const RegisterRollupValue& m) {
+  j["period"] = m.period;
+  j["rollups"] = m.rollups;
+}
+
+Register RegisterStore::get(size_t slot) const {
+  Register reg(desc);
+  const uint16_t* value = slot_value(slot);
+  std::copy(value, value + desc.length, reg.value.begin());
+  reg.timestamp = timestamps[slot];
+  return reg;
+}
+
+void RegisterStore::push(const uint16_t* value, uint32_t timestamp) {
+  uint16_t* slot = words + idx * desc.length;
+  std::copy(value, value + desc.length, slot);
+  timestamps[idx] = timestamp;
+  // If we dont care about changes or if we do
+  // and we notice that the value is different
+  // from the previous, increment store to
+  // point to the next.
+  size_t last = last_slot();
+  bool same = timestamps[last] != 0 && last != idx &&
+      std::equal(slot, slot + desc.length, slot_value(last));
+  if (!desc.changes_only || !same)
+    idx = (idx + 1) % desc.keep;
+  // Rollups aggregate every reading, changed or not.
+  if (!desc.rollups.empty())
+    update_rollups(value, timestamp);
+}
+
+void RegisterStore::update_rollups(const uint16_t* value, uint32_t timestamp) {
+  float val = numeric_value(value, desc);
+  RegisterRollup* tier_slots = rollups;
+  for (size_t t = 0; t < desc.rollups.size(); t++) {
+    const RollupDescriptor& tier = desc.rollups[t];
+    uint32_t period_start = timestamp - timestamp % tier.period;
+    RegisterRollup* cur = &tier_slots[rollup_idx[t]];
+    if (cur->count == 0 || cur->timestamp != period_start) {
+      // A new period, overwriting the oldest aggregate.
+      if (cur->count != 0)
+        rollup_idx[t] = (rollup_idx[t] + 1) % tier.keep;
+      cur = &tier_slots[rollup_idx[t]];
+      *cur = RegisterRollup{};
+      cur->timestamp = period_start;
+      cur->min = cur->max = val;
+    }
+    cur->count++;
+    cur->sum += val;
+    cur->min = std::min(cur->min, val);
+    cur->max = std::max(cur->max, val);
+    cur->last = val;
+    tier_slots += tier.keep;
+  }
+}
+
+void RegisterStore::push(const std::vector<uint16_t>& value, uint32_t ts) {
+  if (value.size() != desc.length)
+    throw std::out_of_range("Unexpected length of " + desc.name);
+  push(value.data(), ts);
+}
+
+Register RegisterStore::back() const {
+  return get(last_slot());
+}
+
+bool RegisterStore::back_equals(const Register& reg) const {
+  size_t last = last_slot();
+  const uint16_t* value = slot_value(last);
+  return timestamps[last] != 0 && reg && reg.value.size() == desc.length &&
+      std::equal(value, value + desc.length, reg.value.begin());
+}
+
+std::vector<Register> RegisterStore::readings(bool latest_only) const {
+  std::vector<Register> ret;
+  if (latest_only) {
+    if (timestamps[last_slot()] != 0)
+      ret.push_back(get(last_slot()));
+    return ret;
+  }
+  for (size_t slot = 0; slot < desc.keep; slot++) {
+    if (timestamps[slot] != 0)
+      ret.push_back(get(slot));
+  }
+  return ret;
+}
+
+std::string RegisterStore::to_string(bool latest_only) const {
   std::stringstream ss;
 
   // Format we are going for.
@@ -301,36 +434,128 @@ RegisterStore::operator std::string() const {
   stream_hex(ss, desc.begin, 4);
   ss << "> " << std::setfill(' ') << std::setw(32) << std::left << desc.name
      << " :";
-  for (const auto& v : history) {
-    if (v) {
-      if (desc.format != RegisterValueType::FLAGS)
-        ss << ' ';
-      else
-        ss << '\n';
-      ss << std::string(v);
-    }
+  for (const auto& v : readings(latest_only)) {
+    if (desc.format != RegisterValueType::FLAGS)
+      ss << ' ';
+    else
+      ss << '\n';
+    ss << std::string(v);
   }
   return ss.str();
 }
 
-RegisterStore::operator RegisterStoreValue() const {
-  RegisterStoreValue ret(reg_addr, desc.name);
-  for (const auto& reg : history) {
-    if (reg)
-      ret.history.emplace_back(reg);
+std::vector<RegisterRollupValue> RegisterStore::rollup_values() const {
+  std::vector<RegisterRollupValue> ret;
+  const RegisterRollup* tier_slots = rollups;
+  for (size_t t = 0; t < desc.rollups.size(); t++) {
+    const RollupDescriptor& tier = desc.rollups[t];
+    RegisterRollupValue& val = ret.emplace_back();
+    val.period = tier.period;
+    // Oldest first: The slot after the current one.
+    for (size_t i = 1; i <= tier.keep; i++) {
+      const RegisterRollup& r = tier_slots[(rollup_idx[t] + i) % tier.keep];
+      if (r.count != 0)
+        val.rollups.push_back(r);
+    }
+    tier_slots += tier.keep;
   }
   return ret;
 }
 
+RegisterStoreValue RegisterStore::to_value(bool latest_only, bool with_rollups)
+    const {
+  RegisterStoreValue ret(reg_addr, desc.name);
+  for (const auto& reg : readings(latest_only))
+    ret.history.emplace_back(reg);
+  if (with_rollups)
+    ret.rollups = rollup_values();
+  return ret;
+}
+
 void to_json(json& j, const RegisterStoreValue& m) {
   j["begin"] = m.reg_addr;
   j["name"] = m.name;
   j["readings"] = m.history;
+  if (!m.rollups.empty())
+    j["rollups"] = m.rollups;
 }
 
 void to_json(json& j, const RegisterStore& m) {
   j["begin"] = m.reg_addr;
-  j["readings"] = m.history;
+  j["readings"] = json::array();
+  for (size_t slot = 0; slot < m.desc.keep; slot++)
+    j["readings"].push_back(m.get(slot));
+}
+
+RegisterStoreList::RegisterStoreList(const RegisterStoreList& other)
+    : words(other.words),
+      timestamps(other.timestamps),
+      rollups(other.rollups),
+      stores(other.stores) {
+  bind();
+}
+
+RegisterStoreList::RegisterStoreList(RegisterStoreList&& other)
+    : words(std::move(other.words)),
+      timestamps(std::move(other.timestamps)),
+      rollups(std::move(other.rollups)),
+      stores(std::move(other.stores)) {
+  bind();
+}
+
+RegisterStoreList& RegisterStoreList::operator=(
+    const RegisterStoreList& other) {
+  if (this == &other)
+    return *this;
+  words = other.words;
+  timestamps = other.timestamps;
+  rollups = other.rollups;
+  // RegisterStore is not assignable (It refers to its descriptor).
+  stores.clear();
+  for (const auto& store : other.stores)
+    stores.push_back(store);
+  bind();
+  return *this;
+}
+
+RegisterStoreList& RegisterStoreList::operator=(RegisterStoreList&& other) {
+  words = std::move(other.words);
+  timestamps = std::move(other.timestamps);
+  rollups = std::move(other.rollups);
+  stores = std::move(other.stores);
+  bind();
+  return *this;
+}
+
+void RegisterStoreList::bind() {
+  for (auto& store : stores) {
+    store.words = words.data() + store.word_offset;
+    store.timestamps = timestamps.data() + store.slot_offset;
+    store.rollups = rollups.data() + store.rollup_offset;
+  }
+}
+
+void RegisterStoreList::emplace_back(const RegisterDescriptor& desc) {
+  if (desc.keep == 0)
+    throw std::out_of_range("Register " + desc.name + " keeps no history");
+  size_t rollup_slots = 0;
+  for (const auto& tier : desc.rollups) {
+    if (tier.period == 0 || tier.keep == 0)
+      throw std::out_of_range(
+          "Register " + desc.name + " has an empty rollup");
+    rollup_slots += tier.keep;
+  }
+  stores.emplace_back(desc, words.size(), timestamps.size(), rollups.size());
+  words.resize(words.size() + size_t(desc.keep) * desc.length);
+  timestamps.resize(timestamps.size() + desc.keep);
+  rollups.resize(rollups.size() + rollup_slots);
+  bind();
+}
+
+void to_json(json& j, const RegisterStoreList& m) {
+  j = json::array();
+  for (const auto& store : m)
+    j.push_back(store);
 }
 
 void from_json(const json& j, WriteActionInfo& action) {
@@ -343,7 +568,11 @@ void from_json(const json& j, WriteActionInfo& action) {
     action.value = j.at("value");
   else
     action.value = std::nullopt;
-  if (!action.shell && !action.value)
+  if (j.contains("provider"))
+    action.provider = j.at("provider");
+  else
+    action.provider = std::nullopt;
+  if (!action.shell && !action.value && !action.provider)
     throw std::runtime_error("Bad special handler");
 }
 
@@ -357,12 +586,21 @@ void from_json(const json& j, SpecialHandlerInfo& m) {
   j.at("info").get_to(m.info);
 }
 
+void from_json(const json& j, BaudConfig& m) {
+  j.at("reg").get_to(m.reg);
+  j.at("baud_value_map").get_to(m.baud_value_map);
+  m.is_set = true;
+}
+
 void from_json(const json& j, RegisterMap& m) {
   j.at("address_range").get_to(m.applicable_addresses);
   j.at("probe_register").get_to(m.probe_register);
   j.at("name").get_to(m.name);
   j.at("preferred_baudrate").get_to(m.preferred_baudrate);
   j.at("default_baudrate").get_to(m.default_baudrate);
+  m.max_read_hole = j.value("max_read_hole", 0);
+  if (j.contains("baud_config"))
+    j.at("baud_config").get_to(m.baud_config);
   std::vector<RegisterDescriptor> tmp;
   j.at("registers").get_to(tmp);
   for (auto& i : tmp) {
@@ -378,6 +616,7 @@ void to_json(json& j, const RegisterMap& m) {
   j["name"] = m.name;
   j["preferred_baudrate"] = m.preferred_baudrate;
   j["default_baudrate"] = m.preferred_baudrate;
+  j["max_read_hole"] = m.max_read_hole;
   j["registers"] = {};
   std::transform(
       m.register_descriptors.begin(),
@@ -404,7 +643,14 @@ void RegisterMapDatabase::load(const nlohmann::json& j) {
   regmaps.push_back(std::move(rmap));
 }
 
-void RegisterMapDatabase::load(const std::string& dir_s) {
+void RegisterMapDatabase::load(
+    const std::string& dir_s,
+    const std::string& cache_path) {
+  if (!cache_path.empty()) {
+    for (const auto& j : RegisterMapCache(cache_path).load(dir_s))
+      load(j);
+    return;
+  }
   for (auto const& dir_entry : std::filesystem::directory_iterator{dir_s}) {
     std::ifstream ifs(dir_entry.path().string());
     json j;
@@ -2,6 +2,7 @@
 
 #include <nlohmann/json.hpp>
 #include <map>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,14 @@ enum RegisterValueType {
   FLAGS,
 };
 
+// A tier of aggregates of the readings of a numeric register: The
+// readings of every period of 'period' seconds are summed up into
+// their min/max/avg/last, and those of the last 'keep' periods are kept.
+struct RollupDescriptor {
+  uint32_t period = 60;
+  uint16_t keep = 60;
+};
+
 // Fully describes a Register (Retrieved from register map JSON)
 struct RegisterDescriptor {
   using FlagDescType = std::tuple<uint8_t, std::string>;
@@ -55,6 +64,15 @@ struct RegisterDescriptor {
 
   // If the register stores flags, this provides the desc.
   FlagsDescType flags{};
+
+  // How often (in seconds) to read the register while monitoring.
+  // 0 reads it on every monitor pass, -1 reads it only once
+  // after the device is discovered (or recovered from dormancy).
+  int32_t interval = 0;
+
+  // Tiers of aggregates of the readings, kept on top of the 'keep'
+  // readings. Only for INTEGER and FLOAT registers.
+  std::vector<RollupDescriptor> rollups{};
 };
 
 struct RegisterValue {
@@ -129,11 +147,37 @@ struct Register {
 };
 void to_json(nlohmann::json& j, const Register& m);
 
+// Aggregate of the readings of a register over one period of a
+// rollup tier. The one of the current period grows as readings arrive.
+struct RegisterRollup {
+  // Start of the period.
+  uint32_t timestamp = 0;
+  // Number of readings, 0 if the slot was never used.
+  uint32_t count = 0;
+  float min = 0;
+  float max = 0;
+  float last = 0;
+  double sum = 0;
+  float avg() const {
+    return count == 0 ? 0 : float(sum / count);
+  }
+};
+void to_json(nlohmann::json& j, const RegisterRollup& m);
+
+// The aggregates of a rollup tier, oldest first.
+struct RegisterRollupValue {
+  uint32_t period = 0;
+  std::vector<RegisterRollup> rollups{};
+};
+void to_json(nlohmann::json& j, const RegisterRollupValue& m);
+
 // Container describing the register and its historical record.
 struct RegisterStoreValue {
   uint16_t reg_addr = 0;
   std::string name{};
   std::vector<RegisterValue> history{};
+  // Only filled in when asked for, see RegisterStore::to_value().
+  std::vector<RegisterRollupValue> rollups{};
   RegisterStoreValue(uint16_t reg, const std::string& n)
       : reg_addr(reg), name(n) {}
 };
@@ -141,44 +185,170 @@ void to_json(nlohmann::json& j, const RegisterStoreValue& m);
 
 // Container of values of a single register at multiple points in
 // time. (RegisterDescriptor::keep defines the size of the depth
-// of the historical record).
+// of the historical record). The readings are not stored in the
+// store, but in the rings of the RegisterStoreList owning it.
 struct RegisterStore {
   // Reference to the register descriptor
   const RegisterDescriptor& desc;
   // Address of the register.
   uint16_t reg_addr;
-  // History of the register contents to keep. This is utilized as
-  // a circular buffer with idx pointing to the current slot to
-  // write.
-  std::vector<Register> history;
-  int32_t idx = 0;
 
- public:
-  explicit RegisterStore(const RegisterDescriptor& d)
-      : desc(d), reg_addr(d.begin), history(d.keep, Register(d)) {}
+ private:
+  friend class RegisterStoreList;
+  // Offsets of our slots in the rings of the owning list.
+  size_t word_offset = 0;
+  size_t slot_offset = 0;
+  size_t rollup_offset = 0;
+  // Bound to the rings by the owning list.
+  uint16_t* words = nullptr;
+  uint32_t* timestamps = nullptr;
+  RegisterRollup* rollups = nullptr;
+  // History of the register contents to keep. The desc.keep slots
+  // are utilized as a circular buffer with idx pointing to the
+  // current slot to write.
+  uint16_t idx = 0;
+  // Same for the slots of every rollup tier (one after the other in
+  // the rollups ring), pointing to the aggregate of the current period.
+  std::vector<uint16_t> rollup_idx{};
 
-  // Returns a reference to the last written value (Back of the list)
-  Register& back() {
-    return idx == 0 ? history.back() : history[idx - 1];
-  }
-  // Returns the front (Next to write) reference
-  Register& front() {
-    return history[idx];
+  const uint16_t* slot_value(size_t slot) const {
+    return words + slot * desc.length;
   }
-  // Advances the front.
-  void operator++() {
-    idx = (idx + 1) % history.size();
+  size_t last_slot() const {
+    return idx == 0 ? desc.keep - 1 : idx - 1;
   }
+  // Returns a copy of the reading in the slot.
+  Register get(size_t slot) const;
+  // Adds the reading to the aggregates of the current periods.
+  void update_rollups(const uint16_t* value, uint32_t timestamp);
+
+ public:
+  RegisterStore(
+      const RegisterDescriptor& d,
+      size_t word_off,
+      size_t slot_off,
+      size_t rollup_off = 0)
+      : desc(d),
+        reg_addr(d.begin),
+        word_offset(word_off),
+        slot_offset(slot_off),
+        rollup_offset(rollup_off),
+        rollup_idx(d.rollups.size(), 0) {}
+
+  // Records a reading of desc.length words. Unless the value
+  // changed, changes_only registers keep overwriting this reading
+  // rather than advancing to the next slot.
+  void push(const uint16_t* value, uint32_t timestamp);
+  void push(const std::vector<uint16_t>& value, uint32_t timestamp);
+  // Returns a copy of the last written value (Back of the list)
+  Register back() const;
+  // Returns true if the last written value is valid and equals reg.
+  bool back_equals(const Register& reg) const;
+  // Returns the valid readings in the order of their slots. Only
+  // the last written one (if valid) when latest_only is set.
+  std::vector<Register> readings(bool latest_only = false) const;
+  // Returns a string formatted representation of the readings.
+  std::string to_string(bool latest_only = false) const;
+  // Returns the aggregates of every rollup tier.
+  std::vector<RegisterRollupValue> rollup_values() const;
+  // Returns the interpreted values of the readings, and the
+  // aggregates when with_rollups is set.
+  RegisterStoreValue to_value(
+      bool latest_only = false,
+      bool with_rollups = false) const;
   // Returns a string formatted representation of the historical record.
-  operator std::string() const;
+  operator std::string() const {
+    return to_string();
+  }
 
   // Returns the historical record of the values
-  operator RegisterStoreValue() const;
+  operator RegisterStoreValue() const {
+    return to_value();
+  }
+  // Offsets of our slots in the word and timestamp rings of the list.
+  size_t get_word_offset() const {
+    return word_offset;
+  }
+  size_t get_slot_offset() const {
+    return slot_offset;
+  }
+  // Slot written next, i.e. the oldest reading.
+  uint16_t next_slot() const {
+    return idx;
+  }
+  friend void to_json(nlohmann::json& j, const RegisterStore& m);
 };
 void to_json(nlohmann::json& j, const RegisterStore& m);
 
+// The register stores of a device and the rings holding their
+// readings: All the words in one, and all the timestamps in another
+// contiguous ring. So the history of a device takes two allocations
+// irrespective of the number of registers or their keep depth (three
+// when some registers keep rollups).
+class RegisterStoreList {
+  std::vector<uint16_t> words{};
+  std::vector<uint32_t> timestamps{};
+  std::vector<RegisterRollup> rollups{};
+  std::vector<RegisterStore> stores{};
+  // Points the stores to our rings.
+  void bind();
+
+ public:
+  RegisterStoreList() {}
+  RegisterStoreList(const RegisterStoreList& other);
+  RegisterStoreList(RegisterStoreList&& other);
+  RegisterStoreList& operator=(const RegisterStoreList& other);
+  RegisterStoreList& operator=(RegisterStoreList&& other);
+
+  // Adds a store for the register with desc.keep empty slots, and
+  // those of its rollup tiers.
+  void emplace_back(const RegisterDescriptor& desc);
+
+  size_t size() const {
+    return stores.size();
+  }
+  bool empty() const {
+    return stores.empty();
+  }
+  RegisterStore& operator[](size_t i) {
+    return stores[i];
+  }
+  const RegisterStore& operator[](size_t i) const {
+    return stores[i];
+  }
+  std::vector<RegisterStore>::iterator begin() {
+    return stores.begin();
+  }
+  std::vector<RegisterStore>::iterator end() {
+    return stores.end();
+  }
+  std::vector<RegisterStore>::const_iterator begin() const {
+    return stores.begin();
+  }
+  std::vector<RegisterStore>::const_iterator end() const {
+    return stores.end();
+  }
+  // The rings of readings, see RegisterStore::get_word_offset().
+  const std::vector<uint16_t>& get_words() const {
+    return words;
+  }
+  const std::vector<uint32_t>& get_timestamps() const {
+    return timestamps;
+  }
+  // Bytes used by the rings of readings.
+  size_t history_bytes() const {
+    return words.size() * sizeof(uint16_t) +
+        timestamps.size() * sizeof(uint32_t) +
+        rollups.size() * sizeof(RegisterRollup);
+  }
+};
+void to_json(nlohmann::json& j, const RegisterStoreList& m);
+
 struct WriteActionInfo {
   std::optional<std::string> shell{};
+  // Name of an in-process value provider (value_provider.hpp), preferred
+  // over shell.
+  std::optional<std::string> provider{};
   RegisterValueType interpret;
   std::optional<std::string> value{};
 };
@@ -195,6 +365,15 @@ struct SpecialHandlerInfo {
 };
 void from_json(const nlohmann::json& j, SpecialHandlerInfo& m);
 
+// Describes how to switch a device to another baudrate: Writing the
+// value of the baudrate in baud_value_map to the register reg.
+struct BaudConfig {
+  bool is_set = false;
+  uint16_t reg = 0;
+  std::map<uint32_t, uint16_t> baud_value_map{};
+};
+void from_json(const nlohmann::json& j, BaudConfig& m);
+
 // Container of an entire register map. This is the memory
 // representation of each JSON register map descriptors
 // at /etc/rackmon.d.
@@ -204,6 +383,12 @@ struct RegisterMap {
   uint8_t probe_register;
   uint32_t default_baudrate;
   uint32_t preferred_baudrate;
+  // Unset if the devices cannot switch from default_baudrate.
+  BaudConfig baud_config{};
+  // Largest gap (in registers) monitoring is allowed to read over
+  // when coalescing neighboring registers into a single
+  // ReadHoldingRegisters transaction. 0 merges only adjacent registers.
+  uint16_t max_read_hole = 0;
   std::vector<SpecialHandlerInfo> special_handlers;
   std::map<uint16_t, RegisterDescriptor> register_descriptors;
   const RegisterDescriptor& at(uint16_t reg) const {
@@ -222,8 +407,10 @@ struct RegisterMapDatabase {
   // Loads a configuration JSON into the DB.
   void load(const nlohmann::json& j);
 
-  // Loads all configuration files in a dir into the DB.
-  void load(const std::string& dir_s);
+  // Loads all configuration files in a dir into the DB. If a cache
+  // path is provided, they are loaded from the compiled cache at the
+  // path when it is up to date (See RegisterMapCache).
+  void load(const std::string& dir_s, const std::string& cache_path = "");
   // For debug purpose only.
   void print(std::ostream& os);
 };
@@ -232,6 +419,7 @@ struct RegisterMapDatabase {
 void from_json(const nlohmann::json& j, RegisterMap& m);
 void from_json(const nlohmann::json& j, addr_range& a);
 void from_json(const nlohmann::json& j, RegisterDescriptor& i);
+void from_json(const nlohmann::json& j, RollupDescriptor& r);
 
 void from_json(nlohmann::json& j, const RegisterMap& m);
 void from_json(nlohmann::json& j, const addr_range& a);
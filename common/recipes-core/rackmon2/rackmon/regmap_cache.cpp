@@ -0,0 +1,112 @@
+#include "regmap_cache.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "log.hpp"
+
+#if (__GNUC__ < 8)
+#include <experimental/filesystem>
+namespace std {
+namespace filesystem = experimental::filesystem;
+}
+#else
+#include <filesystem>
+#endif
+
+using nlohmann::json;
+
+json RegisterMapCache::sources(const std::string& dir) {
+  std::vector<std::string> files;
+  for (auto const& dir_entry : std::filesystem::directory_iterator{dir})
+    files.push_back(dir_entry.path().string());
+  // Directory order is not stable, the cache should not depend on it.
+  std::sort(files.begin(), files.end());
+  json ret = json::array();
+  for (const auto& file : files) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+      throw std::system_error(
+          std::error_code(errno, std::generic_category()), "stat " + file);
+    json src;
+    src["path"] = file;
+    src["size"] = int64_t(st.st_size);
+    src["mtime"] = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    ret.push_back(src);
+  }
+  return ret;
+}
+
+json RegisterMapCache::read() const {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  json ret = nullptr;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      const uint8_t* begin = static_cast<const uint8_t*>(addr);
+      try {
+        ret = json::from_cbor(begin, begin + st.st_size);
+      } catch (json::exception& e) {
+        log_error << "Ignoring corrupt register map cache " << path << ": "
+                  << e.what() << std::endl;
+        ret = nullptr;
+      }
+      munmap(addr, st.st_size);
+    }
+  }
+  close(fd);
+  return ret;
+}
+
+void RegisterMapCache::write(const json& cache) const {
+  // Write to a temporary and rename, so a reader (or a power cut)
+  // never sees a partially written cache.
+  std::string tmp_path = path + ".tmp";
+  try {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+      std::filesystem::create_directories(parent);
+    std::vector<uint8_t> data = json::to_cbor(cache);
+    std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    ofs.close();
+    if (!ofs)
+      throw std::runtime_error("Write of " + tmp_path + " failed");
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+      throw std::system_error(
+          std::error_code(errno, std::generic_category()), "rename " + path);
+  } catch (std::exception& e) {
+    log_error << "Could not write register map cache: " << e.what()
+              << std::endl;
+    std::remove(tmp_path.c_str());
+  }
+}
+
+json RegisterMapCache::load(const std::string& dir) const {
+  json srcs = sources(dir);
+  json cache = read();
+  if (cache.is_object() && cache.value("version", 0) == version &&
+      cache.value("sources", json()) == srcs && cache.contains("regmaps"))
+    return cache["regmaps"];
+
+  log_info << "Compiling register map cache " << path << std::endl;
+  json regmaps = json::array();
+  for (const auto& src : srcs) {
+    std::ifstream ifs(src["path"].get<std::string>());
+    json j;
+    ifs >> j;
+    regmaps.push_back(std::move(j));
+  }
+  cache = json::object();
+  cache["version"] = version;
+  cache["sources"] = std::move(srcs);
+  cache["regmaps"] = regmaps;
+  write(cache);
+  return regmaps;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <string>
+
+// Compiled (CBOR) cache of the register map JSONs in a directory.
+// The JSON files remain the source of truth: the cache records the
+// name, size and modification time of each of them and is recompiled
+// as soon as any of these do not match the directory.
+class RegisterMapCache {
+  const std::string path;
+
+  // Returns the description of the JSON files in dir the cache
+  // would be compiled from.
+  static nlohmann::json sources(const std::string& dir);
+  // Returns the contents of the cache, null if it is missing or corrupt.
+  nlohmann::json read() const;
+  // Writes the cache. Errors are logged rather than thrown, since
+  // the daemon can always run off the JSON files.
+  void write(const nlohmann::json& cache) const;
+
+ public:
+  static constexpr int version = 1;
+  explicit RegisterMapCache(const std::string& p) : path(p) {}
+
+  // Returns the register maps in dir, from the cache if it is up to
+  // date, parsing the JSON files (and recompiling the cache) otherwise.
+  nlohmann::json load(const std::string& dir) const;
+};
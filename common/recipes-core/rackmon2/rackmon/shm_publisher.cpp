@@ -0,0 +1,157 @@
+#include "shm_publisher.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <system_error>
+
+static std::system_error shm_error(const std::string& what) {
+  return std::system_error(std::error_code(errno, std::generic_category()), what);
+}
+
+static void copy_name(char* dst, const std::string& src) {
+  std::memset(dst, 0, RACKMON_SHM_NAME_LEN);
+  src.copy(dst, RACKMON_SHM_NAME_LEN - 1);
+}
+
+// Layout of the block of a device: The device, its registers, the
+// timestamp ring and the word ring.
+static size_t timestamps_base(const RegisterStoreList& list) {
+  return sizeof(rackmon_shm_device) +
+      list.size() * sizeof(rackmon_shm_register);
+}
+
+static size_t words_base(const RegisterStoreList& list) {
+  return timestamps_base(list) +
+      list.get_timestamps().size() * sizeof(uint32_t);
+}
+
+static size_t block_size(const RegisterStoreList& list) {
+  size_t size = words_base(list) + list.get_words().size() * sizeof(uint16_t);
+  // Keep the next block aligned.
+  return (size + 7) & ~size_t(7);
+}
+
+ShmPublisher::ShmPublisher(const std::string& n) : name(n) {
+  fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    throw shm_error("shm_open " + name);
+  try {
+    // Drop whatever a previous run left behind.
+    if (ftruncate(fd, 0) != 0)
+      throw shm_error("ftruncate " + name);
+    reserve(sizeof(rackmon_shm_header));
+  } catch (...) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw;
+  }
+  header()->magic = RACKMON_SHM_MAGIC;
+  header()->version = RACKMON_SHM_VERSION;
+  header()->size = sizeof(rackmon_shm_header);
+}
+
+ShmPublisher::~ShmPublisher() {
+  munmap(base, mapped);
+  close(fd);
+  shm_unlink(name.c_str());
+}
+
+void ShmPublisher::reserve(size_t size) {
+  if (size <= mapped)
+    return;
+  if (ftruncate(fd, size) != 0)
+    throw shm_error("ftruncate " + name);
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+    throw shm_error("mmap " + name);
+  if (base != nullptr)
+    munmap(base, mapped);
+  base = static_cast<uint8_t*>(addr);
+  mapped = size;
+}
+
+void ShmPublisher::write_device(
+    uint8_t* block,
+    const ModbusDeviceSnapshot& snap) {
+  rackmon_shm_device* dev = reinterpret_cast<rackmon_shm_device*>(block);
+  rackmon_shm_register* regs = reinterpret_cast<rackmon_shm_register*>(dev + 1);
+  const RegisterStoreList& list = snap.raw.register_list;
+  uint32_t seq = dev->seq;
+  __atomic_store_n(&dev->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  dev->mode = uint8_t(snap.raw.get_mode());
+  dev->baudrate = snap.raw.baudrate;
+  dev->crc_failures = snap.raw.crc_failures;
+  dev->timeouts = snap.raw.timeouts;
+  dev->misc_failures = snap.raw.misc_failures;
+  dev->last_active = snap.raw.last_active;
+  for (size_t i = 0; i < list.size(); i++)
+    regs[i].next_slot = list[i].next_slot();
+  std::memcpy(
+      block + timestamps_base(list),
+      list.get_timestamps().data(),
+      list.get_timestamps().size() * sizeof(uint32_t));
+  std::memcpy(
+      block + words_base(list),
+      list.get_words().data(),
+      list.get_words().size() * sizeof(uint16_t));
+  __atomic_store_n(&dev->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void ShmPublisher::set_devices(
+    const std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& devs) {
+  std::unique_lock lk(m);
+  uint32_t layout = header()->layout_seq;
+  __atomic_store_n(&header()->layout_seq, layout + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  size_t size = sizeof(rackmon_shm_header);
+  for (const auto& snap : devs)
+    size += block_size(snap->raw.register_list);
+  reserve(size);
+
+  std::memset(header()->device_offset, 0, sizeof(header()->device_offset));
+  ring_sizes.clear();
+  size_t offset = sizeof(rackmon_shm_header);
+  for (const auto& snap : devs) {
+    const RegisterStoreList& list = snap->raw.register_list;
+    uint8_t* block = base + offset;
+    std::memset(block, 0, block_size(list));
+    rackmon_shm_device* dev = reinterpret_cast<rackmon_shm_device*>(block);
+    dev->addr = snap->raw.addr;
+    dev->num_registers = uint16_t(list.size());
+    copy_name(dev->type, snap->type);
+    rackmon_shm_register* regs =
+        reinterpret_cast<rackmon_shm_register*>(dev + 1);
+    for (size_t i = 0; i < list.size(); i++) {
+      const RegisterDescriptor& desc = list[i].desc;
+      regs[i].reg_addr = list[i].reg_addr;
+      regs[i].length = desc.length;
+      regs[i].keep = desc.keep;
+      regs[i].timestamps_offset = uint32_t(
+          timestamps_base(list) + list[i].get_slot_offset() * sizeof(uint32_t));
+      regs[i].words_offset = uint32_t(
+          words_base(list) + list[i].get_word_offset() * sizeof(uint16_t));
+      copy_name(regs[i].name, desc.name);
+    }
+    write_device(block, *snap);
+    header()->device_offset[snap->raw.addr] = uint32_t(offset);
+    ring_sizes[snap->raw.addr] = {
+        list.get_timestamps().size(), list.get_words().size()};
+    offset += block_size(list);
+  }
+  header()->size = uint32_t(size);
+  __atomic_store_n(&header()->layout_seq, layout + 2, __ATOMIC_RELEASE);
+}
+
+void ShmPublisher::publish(const ModbusDeviceSnapshot& snap) {
+  std::unique_lock lk(m);
+  uint8_t addr = snap.raw.addr;
+  auto it = ring_sizes.find(addr);
+  const RegisterStoreList& list = snap.raw.register_list;
+  if (it == ring_sizes.end() ||
+      it->second.first != list.get_timestamps().size() ||
+      it->second.second != list.get_words().size())
+    return;
+  write_device(base + header()->device_offset[addr], snap);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "modbus_device.hpp"
+#include "rackmon_shm.h"
+
+// Writer of the shared memory export of the monitored data (See
+// rackmon_shm.h for the layout and the reader functions).
+class ShmPublisher {
+  const std::string name;
+  int fd = -1;
+  uint8_t* base = nullptr;
+  size_t mapped = 0;
+  // Serializes the monitor threads (of every interface).
+  std::mutex m{};
+  // Sizes of the rings in the block of every device, a snapshot
+  // not matching these is not published.
+  std::map<uint8_t, std::pair<size_t, size_t>> ring_sizes{};
+
+  rackmon_shm_header* header() {
+    return reinterpret_cast<rackmon_shm_header*>(base);
+  }
+  // Grow the object (and our mapping) to at least size bytes.
+  void reserve(size_t size);
+  // Copy the snapshot into its device block. Needs m.
+  void write_device(uint8_t* block, const ModbusDeviceSnapshot& snap);
+
+ public:
+  // Creates (or takes over) the shared memory object name. Throws
+  // std::system_error on failure.
+  explicit ShmPublisher(const std::string& name);
+  // Removes the object, readers keep their mapping of it.
+  ~ShmPublisher();
+  ShmPublisher(const ShmPublisher&) = delete;
+  ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+  // Rebuild the layout for these (all the known) devices.
+  void set_devices(
+      const std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& devs);
+  // Update the block of the device, if it is in the layout.
+  void publish(const ModbusDeviceSnapshot& snap);
+};
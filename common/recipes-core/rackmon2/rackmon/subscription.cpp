@@ -0,0 +1,45 @@
+#include "subscription.hpp"
+
+using nlohmann::json;
+
+std::vector<ModbusDeviceValueData> RegisterSubscription::changes(
+    const std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& snaps) {
+  std::vector<ModbusDeviceValueData> ret;
+  for (const auto& snap : snaps) {
+    const ModbusDeviceRawData& raw = snap->raw;
+    if (!addrs.empty() && addrs.count(raw.addr) == 0)
+      continue;
+    ModbusDeviceValueData data;
+    data.ModbusDeviceStatus::operator=(raw);
+    data.type = snap->type;
+    for (const auto& store : raw.register_list) {
+      if (!registers.empty() && registers.count(store.reg_addr) == 0)
+        continue;
+      // Same comparison used by changes_only registers while
+      // monitoring.
+      auto key = std::make_pair(raw.addr, store.reg_addr);
+      auto it = last_sent.find(key);
+      if (it != last_sent.end()) {
+        if (store.back_equals(it->second))
+          continue;
+        last_sent.erase(it);
+      }
+      Register latest = store.back();
+      if (!latest)
+        continue;
+      last_sent.emplace(key, latest);
+      RegisterStoreValue val(store.reg_addr, store.desc.name);
+      val.history.emplace_back(latest);
+      data.register_list.push_back(std::move(val));
+    }
+    if (!data.register_list.empty())
+      ret.push_back(std::move(data));
+  }
+  return ret;
+}
+
+void from_json(const json& j, RegisterSubscription& s) {
+  s = RegisterSubscription(
+      j.value("devices", std::set<uint8_t>{}),
+      j.value("registers", std::set<uint16_t>{}));
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+#include "modbus_device.hpp"
+
+// Tracks the registers last pushed to a subscriber and computes
+// what changed since from the published device snapshots.
+class RegisterSubscription {
+  // Devices and registers of interest. Empty implies all.
+  std::set<uint8_t> addrs{};
+  std::set<uint16_t> registers{};
+  // Last value pushed of each (device, register).
+  std::map<std::pair<uint8_t, uint16_t>, Register> last_sent{};
+
+ public:
+  RegisterSubscription() {}
+  RegisterSubscription(
+      const std::set<uint8_t>& a,
+      const std::set<uint16_t>& regs)
+      : addrs(a), registers(regs) {}
+
+  // Returns the latest value of the registers which changed since
+  // the previous call (All of them on the first call). Devices
+  // without any changes are omitted.
+  std::vector<ModbusDeviceValueData> changes(
+      const std::vector<std::shared_ptr<const ModbusDeviceSnapshot>>& snaps);
+};
+
+// Creates a subscription from a request of the form:
+// {"type": "subscribe", "devices": [161, 162], "registers": [104]}
+void from_json(const nlohmann::json& j, RegisterSubscription& s);
@@ -0,0 +1,88 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "arbiter.hpp"
+
+using namespace std::literals;
+using namespace testing;
+
+TEST(CommandPriorityScopeTest, Nesting) {
+  ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::MONITOR);
+  {
+    CommandPriorityScope scan(CommandPriority::SCAN);
+    ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::SCAN);
+    {
+      CommandPriorityScope ctrl(CommandPriority::CONTROL);
+      ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::CONTROL);
+    }
+    ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::SCAN);
+    // The priority is per thread.
+    std::thread([]() {
+      ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::MONITOR);
+    }).join();
+  }
+  ASSERT_EQ(CommandPriorityScope::get(), CommandPriority::MONITOR);
+}
+
+TEST(BusArbiterTest, PriorityOrder) {
+  BusArbiter arbiter;
+  std::mutex order_mutex;
+  std::vector<int> order;
+  std::vector<std::thread> threads;
+  auto waiter = [&](CommandPriority prio, int id) {
+    size_t queued = arbiter.waiting(prio);
+    threads.emplace_back([&, prio, id]() {
+      arbiter.lock(prio);
+      {
+        std::unique_lock lk(order_mutex);
+        order.push_back(id);
+      }
+      arbiter.unlock();
+    });
+    // Queue up one at a time to have a known arrival order.
+    while (arbiter.waiting(prio) == queued)
+      std::this_thread::sleep_for(1ms);
+  };
+  // Hold the bus while the others queue up.
+  arbiter.lock(CommandPriority::MONITOR);
+  waiter(CommandPriority::SCAN, 4);
+  waiter(CommandPriority::MONITOR, 2);
+  waiter(CommandPriority::MONITOR, 3);
+  waiter(CommandPriority::CONTROL, 0);
+  waiter(CommandPriority::INTERACTIVE, 1);
+  arbiter.unlock();
+  for (auto& t : threads)
+    t.join();
+  ASSERT_THAT(order, ElementsAre(0, 1, 2, 3, 4));
+}
+
+TEST(BusArbiterTest, HoldAndYield) {
+  BusArbiter arbiter;
+  std::atomic<bool> done = false;
+  arbiter.lock(CommandPriority::INTERACTIVE);
+  // The holder locks it again without waiting.
+  arbiter.lock(CommandPriority::INTERACTIVE);
+  arbiter.unlock();
+  // Nothing waiting, keep going.
+  arbiter.yield();
+  std::thread ctrl([&]() {
+    arbiter.lock(CommandPriority::CONTROL);
+    done = true;
+    arbiter.unlock();
+  });
+  while (arbiter.waiting(CommandPriority::CONTROL) == 0)
+    std::this_thread::sleep_for(1ms);
+  ASSERT_FALSE(done);
+  // The control command goes through and the bus comes back.
+  arbiter.yield();
+  ASSERT_TRUE(done);
+  ctrl.join();
+  arbiter.unlock();
+  // Released for good, others get it.
+  std::thread([&]() {
+    arbiter.lock(CommandPriority::SCAN);
+    arbiter.unlock();
+  }).join();
+}
@@ -37,6 +37,23 @@ TEST_F(DeviceTest, ReadTest) {
   ASSERT_EQ(buf, exp);
 }
 
+TEST_F(DeviceTest, ReadFrameTest) {
+  Device dev("./test.bin");
+  dev.open();
+  // The frame ends before the maximum length.
+  std::vector<uint8_t> buf(10);
+  ASSERT_EQ(dev.read_frame(buf.data(), buf.size(), 10, 1000), 4);
+  buf.resize(4);
+  std::vector<uint8_t> exp = {1, 2, 3, 4};
+  ASSERT_EQ(buf, exp);
+  dev.close();
+  dev.open();
+  // Or is cut at the maximum length.
+  std::vector<uint8_t> buf2(2);
+  ASSERT_EQ(dev.read_frame(buf2.data(), buf2.size(), 10, 1000), 2);
+  ASSERT_EQ(buf2, std::vector<uint8_t>({1, 2}));
+}
+
 TEST_F(DeviceTest, WriteTest) {
   Device dev("./test.bin");
   dev.open();
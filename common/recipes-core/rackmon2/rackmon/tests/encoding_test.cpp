@@ -0,0 +1,39 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "encoding.hpp"
+
+using namespace testing;
+using nlohmann::json;
+
+TEST(EncodingTest, RequestedEncoding) {
+  EXPECT_EQ(
+      get_response_encoding(R"({"type": "list"})"_json),
+      ResponseEncoding::JSON);
+  EXPECT_EQ(
+      get_response_encoding(R"({"type": "list", "encoding": "cbor"})"_json),
+      ResponseEncoding::CBOR);
+  EXPECT_EQ(
+      get_response_encoding(R"({"type": "list", "encoding": "msgpack"})"_json),
+      ResponseEncoding::MSGPACK);
+  EXPECT_THROW(
+      get_response_encoding(R"({"type": "list", "encoding": "xml"})"_json),
+      std::logic_error);
+}
+
+TEST(EncodingTest, RoundTrip) {
+  json resp = R"({
+    "status": "SUCCESS",
+    "data": [{"addr": 161, "ranges": [{"begin": 0, "readings": [1, 2]}]}]
+  })"_json;
+  for (auto enc : {ResponseEncoding::JSON,
+                   ResponseEncoding::CBOR,
+                   ResponseEncoding::MSGPACK}) {
+    std::vector<uint8_t> buf = encode_response(resp, enc);
+    std::vector<char> cbuf(buf.begin(), buf.end());
+    EXPECT_EQ(decode_response(cbuf, enc), resp);
+  }
+  // Binary encodings are smaller than the textual JSON.
+  EXPECT_LT(
+      encode_response(resp, ResponseEncoding::CBOR).size(),
+      encode_response(resp, ResponseEncoding::JSON).size());
+}
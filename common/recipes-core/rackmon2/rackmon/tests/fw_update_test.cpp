@@ -0,0 +1,197 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include "fw_update.hpp"
+
+using namespace std;
+using namespace testing;
+
+class HexImageTest : public ::testing::Test {
+ protected:
+  std::string path = "./test_fw_image.hex";
+  void make_image(const std::string& content) {
+    std::ofstream ofs(path);
+    ofs << content;
+  }
+  void TearDown() override {
+    unlink(path.c_str());
+  }
+  // 15 bytes of data above 0x10000, the first 12 contiguous.
+  const std::string basic_image =
+      ":020000040001F9\n"
+      ":0A0010000102030405060708090AAF\n"
+      ":02001A000B0CCD\r\n"
+      "\n"
+      ":03004000AABBCC8C\n"
+      ":00000001FF\n";
+};
+
+TEST_F(HexImageTest, Records) {
+  make_image(basic_image);
+  HexImageReader image(path);
+  uint32_t addr;
+  std::vector<uint8_t> data;
+  ASSERT_TRUE(image.next(addr, data));
+  ASSERT_EQ(addr, 0x10010);
+  ASSERT_EQ(data, std::vector<uint8_t>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+  ASSERT_TRUE(image.next(addr, data));
+  ASSERT_EQ(addr, 0x1001a);
+  ASSERT_EQ(data, std::vector<uint8_t>({11, 12}));
+  ASSERT_TRUE(image.next(addr, data));
+  ASSERT_EQ(addr, 0x10040);
+  ASSERT_EQ(data, std::vector<uint8_t>({0xaa, 0xbb, 0xcc}));
+  ASSERT_FALSE(image.next(addr, data));
+  ASSERT_EQ(HexImageReader::data_size(path), 15);
+}
+
+TEST_F(HexImageTest, BadImages) {
+  ASSERT_THROW(HexImageReader("./does_not_exist.hex"), std::runtime_error);
+  // Checksum
+  make_image(":0A0010000102030405060708090AAE\n:00000001FF\n");
+  ASSERT_THROW(HexImageReader::data_size(path), std::runtime_error);
+  // Not hex
+  make_image(":0A00100001020304050607080Z0AAF\n:00000001FF\n");
+  ASSERT_THROW(HexImageReader::data_size(path), std::runtime_error);
+  // Truncated
+  make_image(":020000040001F9\n:0A001000010203040506\n:00000001FF\n");
+  ASSERT_THROW(HexImageReader::data_size(path), std::runtime_error);
+  // No end of file record
+  make_image(":0A0010000102030405060708090AAF\n");
+  ASSERT_THROW(HexImageReader::data_size(path), std::runtime_error);
+}
+
+TEST(DeltaFirmwareUpdaterTest, Key) {
+  ASSERT_EQ(DeltaFirmwareUpdater::calc_key(0x12345678), 0x02eed9c8);
+  ASSERT_EQ(DeltaFirmwareUpdater::calc_key(0), 0x06854137);
+}
+
+// Emulates the Delta bootloader on the (decoded) messages.
+class FakeDeltaDevice : public ModbusDevice {
+ public:
+  static constexpr uint32_t seed = 0x12345678;
+  std::vector<uint8_t> funcs{};
+  std::map<uint32_t, uint8_t> flash{};
+  uint32_t write_addr = 0;
+  bool unlocked = false;
+
+  FakeDeltaDevice(Modbus& m, uint8_t addr, const RegisterMap& rmap)
+      : ModbusDevice(m, addr, rmap) {}
+
+  void command(Msg& req, Msg& resp, modbus_time, modbus_time) override {
+    ASSERT_EQ(req.raw[1], 0x2b);
+    std::vector<uint8_t> data;
+    if (req.raw[2] == 0x65) {
+      ASSERT_TRUE(unlocked);
+      for (size_t i = 3; i < req.len; i++)
+        flash[write_addr++] = req.raw[i];
+      data = {0x73, 0xf0, 0xaa};
+    } else {
+      ASSERT_EQ(req.raw[2], 0x64);
+      ASSERT_EQ(req.len, 11);
+      uint8_t func = req.raw[3];
+      funcs.push_back(func);
+      data = {0x71, uint8_t(func + 0x40)};
+      switch (func) {
+        case 0xfb:
+          throw timeout_exception();
+        case 0x27:
+          data.insert(data.end(), {0x12, 0x34, 0x56, 0x78});
+          break;
+        case 0x28: {
+          uint32_t key = DeltaFirmwareUpdater::calc_key(seed);
+          ASSERT_EQ(req.raw[4], uint8_t(key >> 24));
+          ASSERT_EQ(req.raw[7], uint8_t(key));
+          unlocked = true;
+          break;
+        }
+        case 0x61:
+          write_addr = (req.raw[4] << 24) | (req.raw[5] << 16) |
+              (req.raw[6] << 8) | req.raw[7];
+          data.push_back(0xea);
+          break;
+      }
+    }
+    resp.raw[0] = req.raw[0];
+    resp.raw[1] = 0x2b;
+    resp.len = 2;
+    for (uint8_t b : data)
+      resp.raw[resp.len++] = b;
+    while (resp.len < 11)
+      resp.raw[resp.len++] = 0xff;
+  }
+};
+
+TEST_F(HexImageTest, DeltaSequence) {
+  make_image(basic_image);
+  Modbus mock_modbus{};
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {
+        "begin": 0,
+        "length": 2,
+        "name": "MFG_MODEL"
+      }
+    ]
+  })"_json;
+  FakeDeltaDevice dev(mock_modbus, 0x6e, rmap);
+  std::vector<std::string> states;
+  size_t progress = 0;
+  std::atomic<bool> abort = false;
+  std::unique_ptr<FirmwareUpdater> updater = make_firmware_updater(
+      "delta",
+      dev,
+      [&states](const std::string& s) { states.push_back(s); },
+      [&progress](size_t n) { progress += n; },
+      abort);
+  updater->reset_delay = modbus_time::zero();
+  updater->run(path);
+
+  ASSERT_EQ(
+      states,
+      std::vector<std::string>(
+          {"pre_handshake_reset",
+           "bootloader_handshake",
+           "erase_flash",
+           "flashing",
+           "verifying",
+           "resetting"}));
+  ASSERT_EQ(
+      dev.funcs,
+      std::vector<uint8_t>(
+          {0x72, 0xfb, 0x70, 0x27, 0x28, 0x65, 0x61, 0x61, 0x76, 0x72}));
+  ASSERT_EQ(progress, 15);
+  // Blocks of 8 bytes, the last of each run padded.
+  ASSERT_EQ(dev.flash.size(), 24);
+  for (uint8_t i = 0; i < 12; i++)
+    ASSERT_EQ(dev.flash.at(0x10010 + i), i + 1);
+  for (uint32_t a = 0x1001c; a < 0x10020; a++)
+    ASSERT_EQ(dev.flash.at(a), 0xff);
+  ASSERT_EQ(dev.flash.at(0x10040), 0xaa);
+  ASSERT_EQ(dev.flash.at(0x10042), 0xcc);
+  ASSERT_EQ(dev.flash.at(0x10047), 0xff);
+}
+
+TEST_F(HexImageTest, UnknownVendor) {
+  Modbus mock_modbus{};
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": []
+  })"_json;
+  ModbusDevice dev(mock_modbus, 0x6e, rmap);
+  std::atomic<bool> abort = false;
+  ASSERT_THROW(
+      make_firmware_updater(
+          "acme", dev, [](const std::string&) {}, [](size_t) {}, abort),
+      std::logic_error);
+}
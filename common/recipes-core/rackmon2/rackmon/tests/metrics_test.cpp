@@ -0,0 +1,59 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "metrics.hpp"
+
+using namespace testing;
+using nlohmann::json;
+using namespace std::chrono_literals;
+
+TEST(LatencyHistogramTest, Buckets) {
+  LatencyHistogram h;
+  h.record(500us);
+  h.record(1ms);
+  h.record(1001us);
+  h.record(45ms);
+  h.record(10s);
+  EXPECT_EQ(h.get_count(), 5);
+  EXPECT_EQ(h.get_bucket(0), 2); // <= 1ms
+  EXPECT_EQ(h.get_bucket(1), 1); // <= 2ms
+  EXPECT_EQ(h.get_bucket(5), 1); // <= 50ms
+  EXPECT_EQ(h.get_bucket(LatencyHistogram::bucket_bounds_ms.size()), 1);
+  EXPECT_EQ(h.get_max(), 10s);
+
+  json j = h;
+  EXPECT_EQ(j["count"], 5);
+  EXPECT_EQ(j["max_us"], 10000000);
+  EXPECT_EQ(j["buckets"].size(), LatencyHistogram::bucket_bounds_ms.size() + 1);
+}
+
+TEST(BusMetricsTest, Record) {
+  BusMetrics m;
+  m.record(161, CommandOutcome::SUCCESS, 20ms, 25ms, 8, 25);
+  m.record(161, CommandOutcome::TIMEOUT, 300ms, 300ms, 8, 0);
+  m.record(162, CommandOutcome::CRC_ERROR, 20ms, 20ms, 8, 25);
+
+  CommandMetrics bus = m.get_bus();
+  EXPECT_EQ(bus.get(CommandOutcome::SUCCESS).get_count(), 1);
+  EXPECT_EQ(bus.get(CommandOutcome::TIMEOUT).get_count(), 1);
+  EXPECT_EQ(bus.get(CommandOutcome::CRC_ERROR).get_count(), 1);
+  EXPECT_EQ(bus.get(CommandOutcome::ERROR).get_count(), 0);
+  EXPECT_EQ(bus.bytes_sent, 24);
+  EXPECT_EQ(bus.bytes_received, 50);
+  EXPECT_EQ(bus.busy_time, 345ms);
+
+  CommandMetrics dev = m.get_device(161);
+  EXPECT_EQ(dev.get(CommandOutcome::CRC_ERROR).get_count(), 0);
+  EXPECT_EQ(dev.busy_time, 325ms);
+  EXPECT_THROW(m.get_device(163), std::out_of_range);
+
+  // More busy time was recorded than has elapsed.
+  EXPECT_GT(m.get_utilization(), 100.0);
+
+  json j = m;
+  EXPECT_EQ(j["commands"]["busy_us"], 345000);
+  EXPECT_EQ(j["commands"]["latency"]["timeout"]["count"], 1);
+  ASSERT_EQ(j["devices"].size(), 2);
+  EXPECT_EQ(j["devices"][0]["addr"], 161);
+  EXPECT_EQ(j["devices"][1]["addr"], 162);
+  EXPECT_EQ(j["devices"][1]["bytes_received"], 25);
+}
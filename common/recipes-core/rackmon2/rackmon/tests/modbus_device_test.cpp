@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include <thread>
 #include "modbus_device.hpp"
+#include "value_provider.hpp"
 
 using namespace std;
 using namespace testing;
@@ -10,7 +11,7 @@ using nlohmann::json;
 // Mocks the Modbus interface.
 class Mock2Modbus : public Modbus {
  public:
-  Mock2Modbus() : Modbus(std::cout) {}
+  Mock2Modbus() {}
   ~Mock2Modbus() {}
   MOCK_METHOD1(initialize, void(const nlohmann::json&));
   MOCK_METHOD5(command, void(Msg&, Msg&, uint32_t, modbus_time, modbus_time));
@@ -271,6 +272,45 @@ TEST_F(ModbusDeviceTest, ReadFileRecord) {
   ASSERT_EQ(records[1].data[1], 0x0040);
 }
 
+TEST_F(ModbusDeviceTest, ReadFileRecords) {
+  // Respond with the record number of every record read.
+  std::vector<std::pair<uint16_t, uint16_t>> reads;
+  EXPECT_CALL(get_modbus(), command(_, _, 19200, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([&reads](
+                                 Msg& req,
+                                 Msg& resp,
+                                 uint32_t,
+                                 modbus_time,
+                                 modbus_time) {
+        Encoder::encode(req);
+        uint16_t record = (req.raw[6] << 8) | req.raw[7];
+        uint16_t count = (req.raw[8] << 8) | req.raw[9];
+        reads.emplace_back(record, count);
+        resp.len = 0;
+        resp << uint8_t(0x32) << uint8_t(0x14) << uint8_t(2 + count * 2)
+             << uint8_t(1 + count * 2) << uint8_t(6);
+        for (uint16_t i = 0; i < count; i++)
+          resp << uint16_t(record + i);
+        Encoder::encode(resp);
+        Encoder::decode(resp);
+      }));
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+
+  std::vector<uint16_t> data;
+  dev.ReadFileRecords(3, 5, 130, [&data](const FileRecord& rec) {
+    ASSERT_EQ(rec.file_num, 3);
+    data.insert(data.end(), rec.data.begin(), rec.data.end());
+  });
+  ASSERT_THAT(reads, ElementsAre(Pair(5, 123), Pair(128, 7)));
+  ASSERT_EQ(data.size(), 130);
+  for (size_t i = 0; i < data.size(); i++)
+    ASSERT_EQ(data[i], 5 + i);
+  EXPECT_THROW(
+      dev.ReadFileRecords(3, 0xfff0, 0x20, [](const FileRecord&) {}),
+      std::out_of_range);
+}
+
 TEST_F(ModbusDeviceTest, DeviceStatus) {
   ModbusDevice dev(get_modbus(), 0x32, get_regmap());
   ModbusDeviceStatus status = dev.get_status();
@@ -499,6 +539,245 @@ TEST_F(ModbusDeviceTest, MonitorFmtData) {
   ASSERT_EQ(actual, exp1_out);
 }
 
+TEST(ModbusDeviceReadPlan, CoalesceSpans) {
+  Mock2Modbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "max_read_hole": 2,
+    "registers": [
+      {"begin": 0, "length": 2, "name": "A"},
+      {"begin": 2, "length": 1, "name": "B"},
+      {"begin": 5, "length": 1, "name": "C"},
+      {"begin": 9, "length": 1, "name": "D"},
+      {"begin": 10, "length": 124, "name": "E"}
+    ]
+  })"_json;
+  ModbusDevice dev(modbus, 0x32, rmap);
+  const std::vector<RegisterSpan>& plan = dev.get_read_plan();
+  ASSERT_EQ(plan.size(), 3);
+  ASSERT_EQ(plan[0].begin, 0);
+  ASSERT_EQ(plan[0].length, 6);
+  ASSERT_EQ(plan[0].stores, std::vector<size_t>({0, 1, 2}));
+  // Hole of 3 is too large to merge D into the first span.
+  ASSERT_EQ(plan[1].begin, 9);
+  ASSERT_EQ(plan[1].length, 1);
+  ASSERT_EQ(plan[1].stores, std::vector<size_t>({3}));
+  // Merging E into D would exceed the max span length.
+  ASSERT_EQ(plan[2].begin, 10);
+  ASSERT_EQ(plan[2].length, 124);
+  ASSERT_EQ(plan[2].stores, std::vector<size_t>({4}));
+}
+
+TEST(ModbusDeviceReadPlan, MonitorSpan) {
+  Mock2Modbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "max_read_hole": 1,
+    "registers": [
+      {"begin": 0, "length": 2, "format": "string", "name": "MFG_MODEL"},
+      {"begin": 3, "length": 1, "format": "integer", "name": "TEMP"}
+    ]
+  })"_json;
+  EXPECT_CALL(
+      modbus,
+      command(
+          // addr(1) = 0x32,
+          // func(1) = 0x03,
+          // reg_off(2) = 0x0000,
+          // reg_cnt(2) = 0x0004
+          encodeMsgContentEqual(0x320300000004_EM),
+          _,
+          19200,
+          modbus_time::zero(),
+          modbus_time::zero()))
+      .Times(1)
+      // addr(1) = 0x32,
+      // func(1) = 0x03,
+      // bytes(1) = 0x08,
+      // data(8) = 61626364 ffff 002a
+      .WillOnce(SetMsgDecode<1>(0x3203086162636400ff002a_EM));
+  ModbusDevice dev(modbus, 0x32, rmap);
+  dev.monitor();
+  ModbusDeviceValueData data = dev.get_value_data();
+  ASSERT_EQ(data.register_list.size(), 2);
+  ASSERT_EQ(data.register_list[0].history.size(), 1);
+  ASSERT_EQ(data.register_list[0].history[0].value.strValue, "abcd");
+  ASSERT_EQ(data.register_list[1].history.size(), 1);
+  ASSERT_EQ(data.register_list[1].history[0].value.intValue, 42);
+}
+
+TEST(ModbusDeviceReadPlan, IntervalTiers) {
+  Mock2Modbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {"begin": 0, "length": 2, "interval": -1, "name": "MFG_MODEL"},
+      {"begin": 2, "length": 1, "name": "TEMP"},
+      {"begin": 3, "length": 1, "interval": -1, "name": "FW_VERSION"},
+      {"begin": 4, "length": 1, "interval": 3600, "name": "MFG_DATE"}
+    ]
+  })"_json;
+  // Record the starting register of each read and respond
+  // with zeroes of the requested length.
+  std::vector<uint16_t> reads;
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillRepeatedly(
+          Invoke([&reads](
+                     Msg& req,
+                     Msg& resp,
+                     uint32_t,
+                     modbus_time,
+                     modbus_time) {
+            Encoder::encode(req);
+            uint16_t count = req.raw[5];
+            reads.push_back(req.raw[3]);
+            resp.len = 0;
+            resp << uint8_t(0x32) << uint8_t(0x3) << uint8_t(count * 2);
+            for (uint16_t i = 0; i < count; i++)
+              resp << uint16_t(0x3030);
+            Encoder::encode(resp);
+            Encoder::decode(resp);
+          }));
+  ModbusDevice dev(modbus, 0x32, rmap);
+  ASSERT_EQ(dev.get_read_plan().size(), 4);
+  dev.monitor();
+  // The once tier is split into two spans since TEMP is in between.
+  ASSERT_EQ(reads, std::vector<uint16_t>({0, 2, 3, 4}));
+  dev.monitor();
+  // Only TEMP is read in the second pass.
+  ASSERT_EQ(reads, std::vector<uint16_t>({0, 2, 3, 4, 2}));
+  ModbusDeviceValueData data = dev.get_value_data();
+  ASSERT_EQ(data.register_list.size(), 4);
+  ASSERT_EQ(data.register_list[1].history.size(), 1);
+  // Recovering from dormancy re-reads everything.
+  dev.set_active();
+  dev.monitor();
+  ASSERT_EQ(reads, std::vector<uint16_t>({0, 2, 3, 4, 2, 0, 2, 3, 4}));
+}
+
+TEST_F(ModbusDeviceTest, MonitorSnapshot) {
+  EXPECT_CALL(
+      get_modbus(),
+      command(
+          encodeMsgContentEqual(0x320300000002_EM),
+          _,
+          19200,
+          modbus_time::zero(),
+          modbus_time::zero()))
+      .Times(2)
+      .WillOnce(SetMsgDecode<1>(0x32030461626364_EM))
+      .WillOnce(SetMsgDecode<1>(0x32030462636465_EM));
+
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  // A snapshot is available even before the first pass.
+  auto empty = dev.get_snapshot();
+  ASSERT_NE(empty, nullptr);
+  ASSERT_EQ(empty->get_value().register_list.size(), 1);
+  ASSERT_EQ(empty->get_value().register_list[0].history.size(), 0);
+
+  dev.monitor();
+  auto first = dev.get_snapshot();
+  ASSERT_NE(first, empty);
+  ASSERT_EQ(first->get_value().register_list[0].history.size(), 1);
+  ASSERT_EQ(first->get_value_json()["ranges"][0]["readings"][0]["value"], "abcd");
+  ASSERT_EQ(first->get_fmt_json()["type"], "orv3_psu");
+
+  // Published snapshots are immutable, the next pass
+  // publishes a new one.
+  dev.monitor();
+  auto second = dev.get_snapshot();
+  ASSERT_EQ(first->get_value().register_list[0].history.size(), 1);
+  ASSERT_EQ(second->get_value().register_list[0].history.size(), 2);
+  ASSERT_EQ(second->get_raw_json()["ranges"][0]["readings"][1]["data"], "62636465");
+}
+
+TEST(ModbusDeviceFilterTest, FromJson) {
+  ModbusDeviceFilter all = nlohmann::json::object();
+  ASSERT_TRUE(all.selects_all_registers());
+  ASSERT_TRUE(all.contains(0x32, "orv3_psu"));
+
+  ModbusDeviceFilter f = R"({
+    "devices": [50, 51],
+    "types": ["orv3_psu"],
+    "registers": [4, "MFG_MODEL"],
+    "latest": true
+  })"_json;
+  ASSERT_FALSE(f.selects_all_registers());
+  ASSERT_EQ(f.addrs, std::set<uint8_t>({50, 51}));
+  ASSERT_EQ(f.reg_addrs, std::set<uint16_t>({4}));
+  ASSERT_EQ(f.reg_names, std::set<std::string>({"MFG_MODEL"}));
+  ASSERT_TRUE(f.latest_only);
+  ASSERT_FALSE(f.rollups);
+  ASSERT_TRUE(f.contains(0x32, "orv3_psu"));
+  ASSERT_FALSE(f.contains(0x34, "orv3_psu"));
+  ASSERT_FALSE(f.contains(0x32, "orv2_psu"));
+
+  ModbusDeviceFilter r = R"({"rollups": true})"_json;
+  ASSERT_TRUE(r.rollups);
+  ASSERT_FALSE(r.selects_all_registers());
+}
+
+TEST_F(ModbusDeviceTest, MonitorSnapshotFilter) {
+  EXPECT_CALL(
+      get_modbus(),
+      command(
+          encodeMsgContentEqual(0x320300000002_EM),
+          _,
+          19200,
+          modbus_time::zero(),
+          modbus_time::zero()))
+      .Times(2)
+      .WillOnce(SetMsgDecode<1>(0x32030461626364_EM))
+      .WillOnce(SetMsgDecode<1>(0x32030462636465_EM));
+
+  ModbusDevice dev(get_modbus(), 0x32, get_regmap());
+  dev.monitor();
+  dev.monitor();
+  auto snap = dev.get_snapshot();
+
+  // Without register selection, the cached rendering is returned.
+  ModbusDeviceFilter all{};
+  ASSERT_EQ(snap->get_value_json(all), snap->get_value_json());
+
+  ModbusDeviceFilter latest{};
+  latest.latest_only = true;
+  json v = snap->get_value_json(latest);
+  ASSERT_EQ(v["addr"], 0x32);
+  ASSERT_EQ(v["type"], "orv3_psu");
+  ASSERT_EQ(v["ranges"].size(), 1);
+  ASSERT_EQ(v["ranges"][0]["readings"].size(), 1);
+  ASSERT_EQ(v["ranges"][0]["readings"][0]["value"], "bcde");
+  json r = snap->get_raw_json(latest);
+  ASSERT_EQ(r["ranges"][0]["begin"], 0);
+  ASSERT_EQ(r["ranges"][0]["readings"].size(), 1);
+  ASSERT_EQ(r["ranges"][0]["readings"][0]["data"], "62636465");
+  json f = snap->get_fmt_json(latest);
+  ASSERT_EQ(f["ranges"].size(), 1);
+  ASSERT_NE(f["ranges"][0].get<std::string>().find("bcde"), std::string::npos);
+  ASSERT_EQ(f["ranges"][0].get<std::string>().find("abcd"), std::string::npos);
+
+  ModbusDeviceFilter by_name{};
+  by_name.reg_names = {"MFG_MODEL"};
+  ASSERT_EQ(
+      snap->get_value_json(by_name)["ranges"][0]["readings"].size(), 2);
+  ModbusDeviceFilter by_addr{};
+  by_addr.reg_addrs = {4};
+  ASSERT_EQ(snap->get_value_json(by_addr)["ranges"].size(), 0);
+  ASSERT_EQ(snap->get_raw_json(by_addr)["ranges"].size(), 0);
+}
+
 class MockModbusDevice : public ModbusDevice {
  public:
   MockModbusDevice(Modbus& m, uint8_t addr, const RegisterMap& rmap)
@@ -507,7 +786,7 @@ class MockModbusDevice : public ModbusDevice {
 };
 
 TEST(ModbusSpecialHandler, BasicHandlingStringValuePeriodic) {
-  Modbus mock_modbus{std::cout};
+  Modbus mock_modbus{};
   RegisterMap mock_rmap = R"({
     "name": "orv3_psu",
     "address_range": [110, 140],
@@ -563,7 +842,7 @@ TEST(ModbusSpecialHandler, BasicHandlingStringValuePeriodic) {
 }
 
 TEST(ModbusSpecialHandler, BasicHandlingIntegerOneShot) {
-  Modbus mock_modbus{std::cout};
+  Modbus mock_modbus{};
   RegisterMap mock_rmap = R"({
     "name": "orv3_psu",
     "address_range": [110, 140],
@@ -617,3 +896,244 @@ TEST(ModbusSpecialHandler, BasicHandlingIntegerOneShot) {
   std::this_thread::sleep_for(1s);
   special.handle(dev);
 }
+
+TEST(ModbusSpecialHandler, ProviderValue) {
+  Modbus mock_modbus{};
+  RegisterMap mock_rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {
+        "begin": 0,
+        "length": 2,
+        "name": "MFG_MODEL"
+      }
+    ]
+  })"_json;
+  MockModbusDevice dev(mock_modbus, 0x32, mock_rmap);
+  ValueProviderRegistry::instance().add(
+      "test_value", []() { return std::string("12345678"); });
+
+  EXPECT_CALL(
+      dev,
+      command(
+          encodeMsgContentEqual(0x3210000a00020400bc614e_EM), _, _, _))
+      .Times(1);
+  ModbusSpecialHandler special;
+  SpecialHandlerInfo& info = special;
+  info = R"({
+    "reg": 10,
+    "len": 2,
+    "period": -1,
+    "action": "write",
+    "info": {
+      "interpret": "integer",
+      "provider": "test_value"
+    }
+  })"_json;
+  // Provided in-process, written on the first pass.
+  special.handle(dev);
+  special.handle(dev);
+}
+
+TEST(ModbusSpecialHandler, UnknownProvider) {
+  Modbus mock_modbus{};
+  RegisterMap mock_rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": []
+  })"_json;
+  MockModbusDevice dev(mock_modbus, 0x32, mock_rmap);
+  EXPECT_CALL(dev, command(_, _, _, _)).Times(0);
+  ModbusSpecialHandler special;
+  SpecialHandlerInfo& info = special;
+  info = R"({
+    "reg": 10,
+    "len": 2,
+    "period": -1,
+    "action": "write",
+    "info": {
+      "interpret": "integer",
+      "provider": "does_not_exist"
+    }
+  })"_json;
+  special.handle(dev);
+  ASSERT_FALSE(special.handled);
+}
+
+TEST(ShellExecutorTest, RunAt) {
+  time_t now = std::time(nullptr);
+  std::future<std::string> later =
+      ShellExecutor::instance().run_at("echo later", now + 2);
+  std::future<std::string> now_f =
+      ShellExecutor::instance().run_at("echo now", now);
+  ASSERT_EQ(now_f.get(), "now\n");
+  ASSERT_EQ(later.wait_for(500ms), std::future_status::timeout);
+  ASSERT_EQ(later.get(), "later\n");
+  ASSERT_GE(std::time(nullptr), now + 2);
+}
+
+TEST(ResponseTimeEstimatorTest, Estimate) {
+  using namespace std::chrono_literals;
+  ResponseTimeEstimator est;
+  // Nothing known yet, wait for as long as allowed.
+  ASSERT_EQ(est.timeout(0us, 300ms, true), 300ms);
+  // 8 bytes at 19200 baud.
+  ASSERT_EQ(ResponseTimeEstimator::wire_time(8, 19200), 4583us);
+  est.sample(10ms);
+  ASSERT_EQ(est.srtt, 10ms);
+  ASSERT_EQ(est.rttvar, 5ms);
+  // srtt + 4 * rttvar + wire
+  ASSERT_EQ(est.timeout(5ms, 300ms, true), 35ms);
+  for (int i = 0; i < 20; i++)
+    est.sample(10ms);
+  // Stable responses converge to the minimum.
+  ASSERT_EQ(est.timeout(0us, 300ms, true), 20ms);
+  // Capped by the maximum.
+  ASSERT_EQ(est.timeout(0us, 15ms, true), 15ms);
+  // Back off on timeouts, but not for dormant probes.
+  est.timed_out();
+  ASSERT_EQ(est.timeout(0us, 300ms, true), 40ms);
+  ASSERT_EQ(est.timeout(0us, 300ms, false), 20ms);
+  for (int i = 0; i < 5; i++)
+    est.timed_out();
+  ASSERT_EQ(est.timeout(0us, 300ms, true), 160ms);
+  est.sample(10ms);
+  ASSERT_EQ(est.timeout(0us, 300ms, true), 20ms);
+}
+
+class TimeoutModbus : public Modbus {
+ public:
+  modbus_time get_default_timeout() const override {
+    return std::chrono::milliseconds(300);
+  }
+  MOCK_METHOD5(command, void(Msg&, Msg&, uint32_t, modbus_time, modbus_time));
+};
+
+TEST(ModbusDeviceTimeoutTest, AdaptiveTimeout) {
+  TimeoutModbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": []
+  })"_json;
+  std::vector<modbus_time> timeouts;
+  bool fail = false;
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillRepeatedly(Invoke([&](Msg&,
+                                 Msg&,
+                                 uint32_t,
+                                 modbus_time timeout,
+                                 modbus_time) {
+        timeouts.push_back(timeout);
+        if (fail)
+          throw timeout_exception();
+      }));
+  ModbusDevice dev(modbus, 0x32, rmap);
+  Msg req, resp;
+  dev.command(req, resp);
+  // Nothing is known about the device yet.
+  ASSERT_EQ(timeouts.back(), std::chrono::milliseconds(300));
+  for (int i = 0; i < 10; i++)
+    dev.command(req, resp);
+  ASSERT_EQ(timeouts.back(), std::chrono::milliseconds(20));
+  // Explicit timeouts are honored.
+  dev.command(req, resp, std::chrono::milliseconds(1000));
+  ASSERT_EQ(timeouts.back(), std::chrono::milliseconds(1000));
+
+  fail = true;
+  EXPECT_THROW(dev.command(req, resp), timeout_exception);
+  EXPECT_THROW(dev.command(req, resp), timeout_exception);
+  ASSERT_EQ(timeouts.back(), std::chrono::milliseconds(40));
+  for (int i = 0; i < 10; i++)
+    EXPECT_THROW(dev.command(req, resp), timeout_exception);
+  // Dormant devices are probed with the estimate without backoff.
+  ASSERT_FALSE(dev.is_active());
+  EXPECT_THROW(dev.command(req, resp), timeout_exception);
+  ASSERT_EQ(timeouts.back(), std::chrono::milliseconds(20));
+}
+
+TEST(ModbusDeviceBaudrateTest, Negotiate) {
+  Mock2Modbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv2_psu",
+    "address_range": [160, 191],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 115200,
+    "baud_config": {
+      "reg": 163,
+      "baud_value_map": [[19200, 1], [115200, 4]]
+    },
+    "registers": [
+      {
+        "begin": 0,
+        "length": 1,
+        "name": "MFG_MODEL"
+      }
+    ]
+  })"_json;
+  ASSERT_TRUE(rmap.baud_config.is_set);
+  ASSERT_EQ(rmap.baud_config.reg, 163);
+  ASSERT_EQ(rmap.baud_config.baud_value_map.at(115200), 4);
+
+  std::vector<std::pair<Msg, uint32_t>> cmds;
+  bool respond = true;
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillRepeatedly(Invoke([&](Msg& req,
+                                 Msg& resp,
+                                 uint32_t baud,
+                                 modbus_time /* unused */,
+                                 modbus_time /* unused */) {
+        Encoder::encode(req);
+        cmds.emplace_back(req, baud);
+        if (!respond)
+          throw timeout_exception();
+        if (req.raw[1] == 0x06)
+          resp = 0xa00600a30004_EM;
+        else
+          resp = 0xa003026162_EM;
+        Encoder::decode(resp);
+      }));
+
+  ModbusDevice dev(modbus, 0xa0, rmap);
+  ASSERT_EQ(dev.get_status().baudrate, 19200);
+  // The first pass switches the device to the preferred baudrate,
+  // the switch is acknowledged at the default baudrate.
+  dev.monitor();
+  ASSERT_EQ(cmds.size(), 2);
+  ASSERT_EQ(cmds[0].first, 0xa00600a30004_EM);
+  ASSERT_EQ(cmds[0].second, 19200);
+  ASSERT_EQ(cmds[1].second, 115200);
+  ASSERT_EQ(dev.get_status().baudrate, 115200);
+  // Only once.
+  dev.monitor();
+  ASSERT_EQ(cmds.size(), 3);
+
+  // A device gone dormant is expected back at the default baudrate.
+  respond = false;
+  std::vector<uint16_t> regs(1);
+  for (uint32_t i = 0; i < ModbusDeviceStatus::max_consecutive_failures; i++)
+    EXPECT_THROW(dev.ReadHoldingRegisters(0, regs), timeout_exception);
+  ASSERT_FALSE(dev.is_active());
+  ASSERT_EQ(dev.get_status().baudrate, 19200);
+
+  // And switched again once it recovers.
+  respond = true;
+  dev.set_active();
+  cmds.clear();
+  dev.monitor();
+  ASSERT_EQ(cmds.size(), 2);
+  ASSERT_EQ(cmds[0].second, 19200);
+  ASSERT_EQ(dev.get_status().baudrate, 115200);
+  EXPECT_THROW(dev.set_baudrate(38400), std::out_of_range);
+}
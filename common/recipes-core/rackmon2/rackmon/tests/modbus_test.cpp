@@ -1,6 +1,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "modbus.hpp"
+#include "modbus_cmds.hpp"
 
 using namespace std;
 using namespace testing;
@@ -16,12 +17,13 @@ class MockUARTDevice : public UARTDevice {
   MOCK_METHOD1(wait_read, void(int));
   MOCK_METHOD0(wait_write, void());
   MOCK_METHOD3(read, void(uint8_t*, size_t, int));
+  MOCK_METHOD4(read_frame, size_t(uint8_t*, size_t, int, int));
   MOCK_METHOD2(set_attribute, void(bool, int));
 };
 
 class MockModbus : public Modbus {
  public:
-  explicit MockModbus(std::stringstream& prof) : Modbus(prof) {}
+  MockModbus() {}
   MOCK_METHOD3(
       make_device,
       std::unique_ptr<UARTDevice>(
@@ -64,7 +66,10 @@ class ModbusTest : public ::testing::Test {
       uint8_t* exp_write,
       size_t exp_write_size,
       uint8_t* read_bytes,
-      size_t read_bytes_size) {
+      size_t read_bytes_size,
+      size_t exp_read_size = 0) {
+    if (exp_read_size == 0)
+      exp_read_size = read_bytes_size;
     std::unique_ptr<MockUARTDevice> ptr =
         std::make_unique<MockUARTDevice>("/dev/ttyUSB0", 19200);
     EXPECT_CALL(*ptr, open()).Times(1);
@@ -78,9 +83,11 @@ class ModbusTest : public ::testing::Test {
         write(writeBufferEqual(exp_write, exp_write_size), exp_write_size))
         .Times(1);
     // Another tricky, set the out read_bytes to the one we want to "mock".
-    EXPECT_CALL(*ptr, read(_, read_bytes_size, _))
+    EXPECT_CALL(*ptr, read_frame(_, exp_read_size, _, _))
         .Times(1)
-        .WillOnce(SetBufArgNPointeeTo<0>(read_bytes, read_bytes_size));
+        .WillOnce(DoAll(
+            SetBufArgNPointeeTo<0>(read_bytes, read_bytes_size),
+            Return(read_bytes_size)));
 
     std::unique_ptr<UARTDevice> ptr2 = std::move(ptr);
     return std::move(ptr2);
@@ -94,8 +101,7 @@ TEST_F(ModbusTest, BasicDefaultInitialization) {
   nlohmann::json conf;
   conf["device_path"] = "/dev/ttyUSB0";
   conf["baudrate"] = 19200;
-  std::stringstream ss;
-  MockModbus bus(ss);
+  MockModbus bus;
   EXPECT_CALL(bus, make_device("default", "/dev/ttyUSB0", 19200))
       .Times(1)
       .WillOnce(Return(ByMove(make_dev())));
@@ -111,8 +117,7 @@ TEST_F(ModbusTest, BasicExplicitTypeInitialization) {
     conf["device_path"] = "/dev/ttyUSB0";
     conf["device_type"] = type;
     conf["baudrate"] = 19200;
-    std::stringstream ss;
-    MockModbus bus(ss);
+    MockModbus bus;
     EXPECT_CALL(bus, make_device(type, "/dev/ttyUSB0", 19200))
         .Times(1)
         .WillOnce(Return(ByMove(make_dev())));
@@ -131,8 +136,7 @@ TEST_F(ModbusTest, Command) {
   uint8_t write_exp_buf[] = {0, 1, 2, 3, 4, 5, 6, 7, 0x46, 0x7a};
   // mocked response with its CRC.
   uint8_t resp_buf[] = {0, 1, 2, 3, 4, 5, 6, 0xa1, 0xc6};
-  std::stringstream ss;
-  MockModbus bus(ss);
+  MockModbus bus;
   EXPECT_CALL(bus, make_device("default", "/dev/ttyUSB0", 19200))
       .Times(1)
       .WillOnce(
@@ -144,6 +148,14 @@ TEST_F(ModbusTest, Command) {
   bus.command(req, resp, 115200, modbus_time::zero(), modbus_time::zero());
   Msg exp_resp = 0x00010203040506_M;
   ASSERT_EQ(resp, exp_resp);
+  CommandMetrics metrics = bus.get_metrics().get_bus();
+  EXPECT_EQ(metrics.get(CommandOutcome::SUCCESS).get_count(), 1);
+  EXPECT_EQ(metrics.bytes_sent, 10);
+  EXPECT_EQ(metrics.bytes_received, 9);
+  EXPECT_EQ(
+      bus.get_metrics().get_device(0).get(CommandOutcome::SUCCESS).get_count(),
+      1);
+  EXPECT_THROW(bus.get_metrics().get_device(1), std::out_of_range);
 }
 
 TEST_F(ModbusTest, CommandBadResp) {
@@ -156,8 +168,7 @@ TEST_F(ModbusTest, CommandBadResp) {
   // mocked response with its CRC.
   uint8_t resp_buf[] = {
       0, 1, 2, 3, 4, 5, 6, 0xa1, 0xc7}; // 0xa1c6 is correct CRC.
-  std::stringstream ss;
-  MockModbus bus(ss);
+  MockModbus bus;
   EXPECT_CALL(bus, make_device("default", "/dev/ttyUSB0", 19200))
       .Times(1)
       .WillOnce(
@@ -169,4 +180,37 @@ TEST_F(ModbusTest, CommandBadResp) {
   EXPECT_THROW(
       bus.command(req, resp, 115200, modbus_time::zero(), modbus_time::zero()),
       crc_exception);
+  CommandMetrics metrics = bus.get_metrics().get_bus();
+  EXPECT_EQ(metrics.get(CommandOutcome::SUCCESS).get_count(), 0);
+  EXPECT_EQ(metrics.get(CommandOutcome::CRC_ERROR).get_count(), 1);
+}
+
+TEST_F(ModbusTest, CommandExceptionResp) {
+  nlohmann::json conf;
+  conf["device_path"] = "/dev/ttyUSB0";
+  conf["baudrate"] = 19200;
+
+  // Written buffer 0-7 and its CRC16.
+  uint8_t write_exp_buf[] = {0, 1, 2, 3, 4, 5, 6, 7, 0x46, 0x7a};
+  // Exception response (Illegal data address) and its CRC, the
+  // frame ends well before the expected 9 bytes.
+  uint8_t resp_buf[] = {0, 0x83, 0x2, 0x91, 0x31};
+  MockModbus bus;
+  EXPECT_CALL(bus, make_device("default", "/dev/ttyUSB0", 19200))
+      .Times(1)
+      .WillOnce(Return(
+          ByMove(make_cmd_dev(115200, write_exp_buf, 10, resp_buf, 5, 9))));
+  bus.initialize(conf);
+  Msg req = 0x0001020304050607_M;
+  Msg resp;
+  resp.len = 9;
+  try {
+    bus.command(req, resp, 115200, modbus_time::zero(), modbus_time::zero());
+    FAIL() << "Expected a modbus_exception";
+  } catch (modbus_exception& e) {
+    ASSERT_EQ(e.code, 2);
+  }
+  CommandMetrics metrics = bus.get_metrics().get_bus();
+  EXPECT_EQ(metrics.get(CommandOutcome::ERROR).get_count(), 1);
+  EXPECT_EQ(metrics.bytes_received, 5);
 }
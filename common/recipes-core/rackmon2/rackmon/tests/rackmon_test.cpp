@@ -17,11 +17,7 @@ class FakeModbus : public Modbus {
 
  public:
   FakeModbus(uint8_t e, uint8_t mina, uint8_t maxa, uint32_t b)
-      : Modbus(std::cout),
-        exp_addr(e),
-        min_addr(mina),
-        max_addr(maxa),
-        baud(b) {}
+      : exp_addr(e), min_addr(mina), max_addr(maxa), baud(b) {}
   void command(
       Msg& req,
       Msg& resp,
@@ -69,7 +65,7 @@ class FakeModbus : public Modbus {
 class Mock3Modbus : public Modbus {
  public:
   Mock3Modbus(uint8_t e, uint8_t mina, uint8_t maxa, uint32_t b)
-      : Modbus(std::cout), fake_(e, mina, maxa, b) {
+      : fake_(e, mina, maxa, b) {
     ON_CALL(*this, command(_, _, _, _, _))
         .WillByDefault(Invoke([this](
                                   Msg& req,
@@ -257,4 +253,98 @@ TEST_F(RackmonTest, BasicScanFoundOneMon) {
   ASSERT_EQ(
       data[0].register_list[0].history[0].value.strValue, "abcdefghijklmnop");
   ASSERT_NEAR(data[0].register_list[0].history[0].timestamp, std::time(0), 10);
+
+  // Devices are selected by address and type.
+  ModbusDeviceFilter filter{};
+  json filtered;
+  filter.addrs = {161};
+  mon.get_value_data(filtered, filter);
+  ASSERT_EQ(filtered.size(), 1);
+  ASSERT_EQ(filtered[0]["addr"], 161);
+  filter.types = {"orv3_psu"};
+  mon.get_value_data(filtered, filter);
+  ASSERT_EQ(filtered.size(), 0);
+}
+
+TEST_F(RackmonTest, DeviceTable) {
+  const std::string table_path = "./test_rackmon_devices.json";
+  remove(table_path.c_str());
+  {
+    MockRackmon mon;
+    EXPECT_CALL(mon, make_interface())
+        .Times(1)
+        .WillOnce(Return(ByMove(make_modbus(161, 2))));
+    mon.load(r_conf, r_test_dir, "", table_path);
+    mon.start(1s);
+    std::this_thread::sleep_for(1s);
+    mon.stop();
+  }
+  // The device found by the full scan is persisted.
+  std::vector<DeviceTableEntry> table = DeviceTable(table_path).load();
+  ASSERT_EQ(table.size(), 1);
+  ASSERT_EQ(table[0].addr, 161);
+  ASSERT_EQ(table[0].baudrate, 19200);
+  ASSERT_EQ(table[0].type, "orv2_psu");
+
+  // On a restart it is probed before the loops are even started.
+  MockRackmon mon;
+  EXPECT_CALL(mon, make_interface())
+      .Times(1)
+      .WillOnce(Return(ByMove(make_modbus(161, 1))));
+  mon.load(r_conf, r_test_dir, "", table_path);
+  mon.start(1s);
+  std::vector<ModbusDeviceStatus> devs = mon.list_devices();
+  ASSERT_EQ(devs.size(), 1);
+  ASSERT_EQ(devs[0].addr, 161);
+  mon.stop();
+  remove(table_path.c_str());
+}
+
+TEST_F(RackmonTest, MonitorMultipleInterfaces) {
+  std::string rconf_s = R"({
+    "interfaces": [
+      {
+        "device_path": "/tmp/blah",
+        "baudrate": 19200
+      },
+      {
+        "device_path": "/tmp/blah",
+        "baudrate": 19200
+      }
+    ]
+  })";
+  std::ofstream ofs(r_conf);
+  ofs << rconf_s;
+  ofs.close();
+  MockRackmon mon;
+  // One device on each of the interfaces, each interface
+  // has its own monitoring thread.
+  EXPECT_CALL(mon, make_interface())
+      .Times(2)
+      .WillOnce(Return(ByMove(make_modbus(161, 2))))
+      .WillOnce(Return(ByMove(make_modbus(162, 2))));
+  mon.load(r_conf, r_test_dir);
+  mon.start(1s);
+  std::this_thread::sleep_for(1s);
+  std::vector<ModbusDeviceStatus> devs = mon.list_devices();
+  ASSERT_EQ(devs.size(), 2);
+  ASSERT_EQ(devs[0].addr, 161);
+  ASSERT_EQ(devs[1].addr, 162);
+  std::this_thread::sleep_for(1s);
+  mon.stop();
+  std::vector<ModbusDeviceValueData> data;
+  mon.get_value_data(data);
+  ASSERT_EQ(data.size(), 2);
+  for (const auto& dev_data : data) {
+    ASSERT_EQ(dev_data.register_list.size(), 1);
+    ASSERT_EQ(dev_data.register_list[0].history.size(), 1);
+    ASSERT_EQ(
+        dev_data.register_list[0].history[0].value.strValue,
+        "abcdefghijklmnop");
+  }
+  // Both interfaces were scanned by the initial full scan.
+  json metrics;
+  mon.get_metrics(metrics);
+  ASSERT_EQ(metrics["scan"]["full_scans"], 1);
+  ASSERT_EQ(metrics["interfaces"].size(), 2);
 }
@@ -66,28 +66,141 @@ TEST(RegisterTest, JSONTest) {
 TEST(RegisterStoreTest, BasicOperation) {
   RegisterDescriptor desc{
       0, 2, "HELLO", 5, false, RegisterValueType::STRING, 0};
-  RegisterStore reg(desc);
+  RegisterStoreList list;
+  list.emplace_back(desc);
+  RegisterStore& reg = list[0];
+  EXPECT_EQ(reg.back(), false);
   for (uint16_t i = 0; i < 5; i++) {
-    EXPECT_EQ(reg.front(), false);
-    reg.front().value = {0x0001, i};
-    reg.front().timestamp = i + 1;
-    ++reg;
-  }
-  for (uint16_t i = 0; i < 5; i++) {
-    EXPECT_EQ(reg.front(), true);
-    EXPECT_EQ(reg.front().value, std::vector<uint16_t>({0x0001, i}));
-    EXPECT_EQ(reg.front().timestamp, i + 1);
-    ++reg;
+    reg.push({0x0001, i}, i + 1);
     EXPECT_EQ(reg.back(), true);
     EXPECT_EQ(reg.back().value, std::vector<uint16_t>({0x0001, i}));
     EXPECT_EQ(reg.back().timestamp, i + 1);
   }
+  EXPECT_EQ(reg.readings().size(), 5);
+  // Once full, the oldest slot is overwritten.
+  reg.push({0x0002, 0}, 6);
+  std::vector<Register> readings = reg.readings();
+  ASSERT_EQ(readings.size(), 5);
+  EXPECT_EQ(readings[0].value, std::vector<uint16_t>({0x0002, 0}));
+  EXPECT_EQ(readings[1].value, std::vector<uint16_t>({0x0001, 1}));
+  EXPECT_EQ(reg.back().timestamp, 6);
+  EXPECT_THROW(reg.push({0x0001}, 7), std::out_of_range);
+}
+
+TEST(RegisterStoreTest, ChangesOnly) {
+  RegisterDescriptor desc{
+      0, 1, "HELLO", 3, true, RegisterValueType::INTEGER, 0};
+  RegisterStoreList list;
+  list.emplace_back(desc);
+  RegisterStore& reg = list[0];
+  reg.push({1}, 1);
+  reg.push({1}, 2);
+  reg.push({1}, 3);
+  // The unchanged value keeps getting written to the next slot.
+  EXPECT_EQ(reg.back().timestamp, 1);
+  EXPECT_TRUE(reg.back_equals(reg.back()));
+  reg.push({2}, 4);
+  EXPECT_EQ(reg.back().timestamp, 4);
+  EXPECT_EQ(reg.back().value, std::vector<uint16_t>({2}));
+  EXPECT_FALSE(reg.back_equals(reg.readings()[0]));
+}
+
+TEST(RegisterStoreTest, Rollups) {
+  RegisterDescriptor desc{
+      0, 1, "POWER", 2, true, RegisterValueType::FLOAT, 1};
+  desc.rollups = {{60, 2}, {900, 1}};
+  RegisterStoreList list;
+  list.emplace_back(desc);
+  EXPECT_EQ(list.history_bytes(), 2 * 2 + 2 * 4 + 3 * sizeof(RegisterRollup));
+  RegisterStore& reg = list[0];
+  EXPECT_EQ(reg.to_value(false, true).rollups.size(), 2);
+  EXPECT_EQ(reg.to_value(false, true).rollups[0].rollups.size(), 0);
+
+  // Unchanged values are still aggregated (0.5 precision).
+  reg.push({10}, 960);
+  reg.push({10}, 970);
+  reg.push({4}, 1010);
+  reg.push({8}, 1020);
+  std::vector<RegisterRollupValue> tiers = reg.rollup_values();
+  ASSERT_EQ(tiers.size(), 2);
+  EXPECT_EQ(tiers[0].period, 60);
+  ASSERT_EQ(tiers[0].rollups.size(), 2);
+  const RegisterRollup& first = tiers[0].rollups[0];
+  EXPECT_EQ(first.timestamp, 960);
+  EXPECT_EQ(first.count, 3);
+  EXPECT_FLOAT_EQ(first.min, 2.0);
+  EXPECT_FLOAT_EQ(first.max, 5.0);
+  EXPECT_FLOAT_EQ(first.avg(), 4.0);
+  EXPECT_FLOAT_EQ(first.last, 2.0);
+  EXPECT_EQ(tiers[0].rollups[1].timestamp, 1020);
+  EXPECT_EQ(tiers[0].rollups[1].count, 1);
+  ASSERT_EQ(tiers[1].rollups.size(), 1);
+  EXPECT_EQ(tiers[1].rollups[0].timestamp, 900);
+  EXPECT_EQ(tiers[1].rollups[0].count, 4);
+
+  // The oldest period is dropped, oldest first still.
+  reg.push({6}, 1085);
+  tiers = reg.rollup_values();
+  ASSERT_EQ(tiers[0].rollups.size(), 2);
+  EXPECT_EQ(tiers[0].rollups[0].timestamp, 1020);
+  EXPECT_EQ(tiers[0].rollups[1].timestamp, 1080);
+  EXPECT_FLOAT_EQ(tiers[0].rollups[1].last, 3.0);
+
+  // Copies carry their own aggregates.
+  RegisterStoreList copy = list;
+  list[0].push({2}, 1090);
+  EXPECT_EQ(copy[0].rollup_values()[0].rollups[1].count, 1);
+  EXPECT_EQ(list[0].rollup_values()[0].rollups[1].count, 2);
+
+  nlohmann::json j = reg.to_value(true, true);
+  ASSERT_EQ(j["rollups"].size(), 2);
+  EXPECT_EQ(j["rollups"][0]["period"], 60);
+  EXPECT_EQ(j["rollups"][0]["rollups"][1]["time"], 1080);
+  EXPECT_EQ(j["rollups"][0]["rollups"][1]["min"], 1.0);
+  EXPECT_EQ(j["rollups"][0]["rollups"][1]["max"], 3.0);
+  EXPECT_EQ(j["rollups"][0]["rollups"][1]["avg"], 2.0);
+  EXPECT_EQ(j["rollups"][0]["rollups"][1]["last"], 1.0);
+  EXPECT_FALSE(nlohmann::json(reg.to_value()).contains("rollups"));
+
+  desc.rollups = {{0, 1}};
+  EXPECT_THROW(list.emplace_back(desc), std::out_of_range);
+}
+
+TEST(RegisterStoreTest, ListStorage) {
+  RegisterDescriptor desc1{
+      0, 2, "HELLO", 5, false, RegisterValueType::STRING, 0};
+  RegisterDescriptor desc2{
+      2, 1, "WORLD", 2, false, RegisterValueType::INTEGER, 0};
+  RegisterStoreList list;
+  list.emplace_back(desc1);
+  list.emplace_back(desc2);
+  ASSERT_EQ(list.size(), 2);
+  // All the readings share the rings of the list.
+  EXPECT_EQ(list.history_bytes(), (5 * 2 + 2 * 1) * 2 + (5 + 2) * 4);
+  list[0].push({0x3031, 0x3233}, 1);
+  list[1].push({42}, 1);
+
+  // Copies are independent of the original.
+  RegisterStoreList copy = list;
+  list[1].push({43}, 2);
+  EXPECT_EQ(copy[1].back().value, std::vector<uint16_t>({42}));
+  EXPECT_EQ(list[1].back().value, std::vector<uint16_t>({43}));
+  EXPECT_EQ(copy[0].back().value, std::vector<uint16_t>({0x3031, 0x3233}));
+  copy = list;
+  EXPECT_EQ(copy[1].back().value, std::vector<uint16_t>({43}));
+
+  nlohmann::json j = copy;
+  ASSERT_EQ(j.size(), 2);
+  EXPECT_EQ(j[1]["begin"], 2);
+  EXPECT_EQ(j[1]["readings"].size(), 2);
 }
 
 TEST(RegisterStoreTest, DataRetrievalConversions) {
   RegisterDescriptor desc{
       0, 2, "HELLO", 2, false, RegisterValueType::STRING, 0};
-  RegisterStore reg(desc);
+  RegisterStoreList list;
+  list.emplace_back(desc);
+  RegisterStore& reg = list[0];
 
   std::string str = reg;
   RegisterStoreValue val = reg;
@@ -96,9 +209,7 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.name, "HELLO");
   EXPECT_EQ(val.history.size(), 0);
 
-  reg.front().value = std::vector<uint16_t>({0x3031, 0x3233}); // "0123"
-  reg.front().timestamp = 0x1234;
-  ++reg;
+  reg.push({0x3031, 0x3233}, 0x1234); // "0123"
   str = reg;
   val = reg;
   EXPECT_EQ(str, "  <0x0000> HELLO                            : 0123");
@@ -108,9 +219,7 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.history[0].type, RegisterValueType::STRING);
   EXPECT_EQ(val.history[0].value.strValue, "0123");
 
-  reg.front().value = std::vector<uint16_t>({0x3132, 0x3334}); // "1234"
-  reg.front().timestamp = 0x1234;
-  ++reg;
+  reg.push({0x3132, 0x3334}, 0x1234); // "1234"
   str = reg;
   val = reg;
   EXPECT_EQ(str, "  <0x0000> HELLO                            : 0123 1234");
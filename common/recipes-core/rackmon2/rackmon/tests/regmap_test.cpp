@@ -10,6 +10,7 @@ namespace filesystem = experimental::filesystem;
 #include <filesystem>
 #endif
 #include "regmap.hpp"
+#include "regmap_cache.hpp"
 
 using namespace std;
 using namespace testing;
@@ -48,7 +49,8 @@ TEST(RegisterMapTest, JSONCoversion) {
           "keep": 10,
           "format": "float",
           "precision": 6,
-          "name": "BBU Absolute State of Charge"
+          "name": "BBU Absolute State of Charge",
+          "rollups": [{"period": 60, "keep": 60}, {"period": 900, "keep": 96}]
       }
     ]
   })";
@@ -61,6 +63,7 @@ TEST(RegisterMapTest, JSONCoversion) {
   EXPECT_EQ(rmap.preferred_baudrate, 19200);
   EXPECT_EQ(rmap.name, "orv2_psu");
   EXPECT_EQ(rmap.register_descriptors.size(), 2);
+  EXPECT_EQ(rmap.max_read_hole, 0);
   EXPECT_EQ(rmap.special_handlers.size(), 0);
   EXPECT_EQ(rmap.at(0).begin, 0);
   EXPECT_EQ(rmap.at(0).length, 8);
@@ -68,6 +71,8 @@ TEST(RegisterMapTest, JSONCoversion) {
   EXPECT_EQ(rmap.at(0).name, "MFG_MODEL");
   EXPECT_EQ(rmap.at(0).keep, 1);
   EXPECT_EQ(rmap.at(0).changes_only, false);
+  EXPECT_EQ(rmap.at(0).interval, 0);
+  EXPECT_EQ(rmap.at(0).rollups.size(), 0);
   EXPECT_EQ(rmap.at(127).begin, 127);
   EXPECT_EQ(rmap.at(127).length, 1);
   EXPECT_EQ(rmap.at(127).format, RegisterValueType::FLOAT);
@@ -75,7 +80,14 @@ TEST(RegisterMapTest, JSONCoversion) {
   EXPECT_EQ(rmap.at(127).keep, 10);
   EXPECT_EQ(rmap.at(127).changes_only, false);
   EXPECT_EQ(rmap.at(127).precision, 6);
+  ASSERT_EQ(rmap.at(127).rollups.size(), 2);
+  EXPECT_EQ(rmap.at(127).rollups[1].period, 900);
+  EXPECT_EQ(rmap.at(127).rollups[1].keep, 96);
   EXPECT_THROW(rmap.at(42), std::out_of_range);
+
+  // Only numeric registers can be aggregated.
+  j["registers"][0]["rollups"] = R"([{"period": 60, "keep": 60}])"_json;
+  EXPECT_THROW(RegisterMap bad = j, std::out_of_range);
 }
 
 TEST(RegisterMapTest, JSONCoversionSpecial) {
@@ -132,6 +144,33 @@ TEST(RegisterMapTest, JSONCoversionSpecial) {
   EXPECT_TRUE(rmap.special_handlers[0].info.shell);
   EXPECT_FALSE(rmap.special_handlers[0].info.value);
   EXPECT_EQ(rmap.special_handlers[0].info.shell.value(), R"(date +%s)");
+  EXPECT_FALSE(rmap.special_handlers[0].info.provider);
+}
+
+TEST(RegisterMapTest, JSONCoversionSpecialProvider) {
+  SpecialHandlerInfo info = R"({
+    "reg": 298,
+    "len": 2,
+    "period": 3600,
+    "action": "write",
+    "info": {
+      "interpret": "integer",
+      "provider": "time_sync"
+    }
+  })"_json;
+  EXPECT_FALSE(info.info.shell);
+  EXPECT_FALSE(info.info.value);
+  EXPECT_EQ(info.info.provider.value(), "time_sync");
+  EXPECT_THROW(
+      {
+        SpecialHandlerInfo bad = R"({
+          "reg": 298,
+          "len": 2,
+          "action": "write",
+          "info": {"interpret": "integer"}
+        })"_json;
+      },
+      std::runtime_error);
 }
 
 class RegisterMapDatabaseTest : public ::testing::Test {
@@ -239,3 +278,48 @@ TEST_F(RegisterMapDatabaseTest, LoadAll) {
   EXPECT_THROW(db.at(159), std::out_of_range);
   EXPECT_THROW(db.at(192), std::out_of_range);
 }
+
+TEST_F(RegisterMapDatabaseTest, LoadCache) {
+  const std::string cache_path = "./test_regmap.cache";
+  remove(cache_path.c_str());
+  {
+    // First load compiles the cache.
+    RegisterMapDatabase db;
+    db.load(r_test_dir, cache_path);
+    EXPECT_EQ(db.at(110).name, "orv3_psu");
+    EXPECT_EQ(db.at(160).name, "orv2_psu");
+    EXPECT_TRUE(std::filesystem::exists(cache_path));
+  }
+  {
+    // Then it is used as long as the JSONs are untouched.
+    nlohmann::json cache = RegisterMapCache(cache_path).load(r_test_dir);
+    ASSERT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache[0]["name"], "orv2_psu");
+    EXPECT_EQ(cache[1]["name"], "orv3_psu");
+  }
+  {
+    // Changing a JSON recompiles the cache.
+    std::ofstream ofs2(r_test2);
+    ofs2 << nlohmann::json::parse(json2).dump(2) << "\n";
+    ofs2.close();
+    nlohmann::json j = nlohmann::json::parse(json1);
+    j["name"] = "orv2_psu2";
+    std::ofstream ofs1(r_test1);
+    ofs1 << j;
+    ofs1.close();
+    RegisterMapDatabase db;
+    db.load(r_test_dir, cache_path);
+    EXPECT_EQ(db.at(160).name, "orv2_psu2");
+  }
+  {
+    // A corrupt cache is ignored and rewritten.
+    std::ofstream ofs(cache_path, std::ios::trunc);
+    ofs << "garbage";
+    ofs.close();
+    RegisterMapDatabase db;
+    db.load(r_test_dir, cache_path);
+    EXPECT_EQ(db.at(160).name, "orv2_psu2");
+    EXPECT_EQ(db.at(110).name, "orv3_psu");
+  }
+  remove(cache_path.c_str());
+}
@@ -0,0 +1,93 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "rackmon_shm.h"
+#include "shm_publisher.hpp"
+
+using namespace testing;
+
+class ShmMockModbus : public Modbus {
+ public:
+  MOCK_METHOD5(command, void(Msg&, Msg&, uint32_t, modbus_time, modbus_time));
+};
+
+// Sets the response to the literal, already encoded, Msg.
+ACTION_P(SetShmResponse, msg) {
+  arg1 = msg;
+  Encoder::decode(arg1);
+}
+
+class ShmTest : public ::testing::Test {
+ protected:
+  const std::string name = "/rackmon_test_" + std::to_string(getpid());
+  ShmMockModbus modbus;
+  RegisterMap rmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {"begin": 0, "length": 2, "keep": 2, "format": "string",
+       "name": "MFG_MODEL"},
+      {"begin": 2, "length": 1, "format": "integer", "name": "TEMP"}
+    ]
+  })"_json;
+};
+
+TEST_F(ShmTest, OpenMissing) {
+  ASSERT_EQ(rackmon_shm_open(name.c_str()), nullptr);
+  ASSERT_EQ(errno, ENOENT);
+}
+
+TEST_F(ShmTest, PublishAndRead) {
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillOnce(SetShmResponse(0x3203066162636400aa_EM))
+      .WillOnce(SetShmResponse(0x3203066566676800bb_EM));
+  ModbusDevice dev(modbus, 0x32, rmap);
+  ShmPublisher pub(name);
+  rackmon_shm_t* shm = rackmon_shm_open(name.c_str());
+  ASSERT_NE(shm, nullptr);
+
+  uint8_t addrs[4];
+  ASSERT_EQ(rackmon_shm_devices(shm, addrs, 4), 0);
+  // The reader has to remap as the layout grows.
+  pub.set_devices({dev.get_snapshot()});
+  ASSERT_EQ(rackmon_shm_devices(shm, addrs, 4), 1);
+  ASSERT_EQ(addrs[0], 0x32);
+  uint16_t words[2] = {};
+  uint32_t ts = 0;
+  // No readings yet.
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x32, 0, words, 2, &ts), -ENOENT);
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x33, 0, words, 2, &ts), -ENOENT);
+
+  dev.monitor();
+  pub.publish(*dev.get_snapshot());
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x32, 0, words, 2, &ts), 2);
+  ASSERT_EQ(words[0], 0x6162);
+  ASSERT_EQ(words[1], 0x6364);
+  ASSERT_NE(ts, 0);
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x32, 2, words, 2, &ts), 1);
+  ASSERT_EQ(words[0], 0xaa);
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x32, 1, words, 2, &ts), -ENOENT);
+
+  dev.monitor();
+  pub.publish(*dev.get_snapshot());
+  uint16_t history[2][2] = {};
+  uint32_t timestamps[2] = {};
+  ASSERT_EQ(
+      rackmon_shm_read_history(shm, 0x32, 0, &history[0][0], 2, timestamps, 2),
+      2);
+  ASSERT_EQ(history[0][0], 0x6162);
+  ASSERT_EQ(history[1][0], 0x6566);
+  ASSERT_EQ(history[1][1], 0x6768);
+  ASSERT_LE(timestamps[0], timestamps[1]);
+  ASSERT_EQ(rackmon_shm_read_latest(shm, 0x32, 0, words, 2, &ts), 2);
+  ASSERT_EQ(words[0], 0x6566);
+  // Only one reading of TEMP is kept.
+  ASSERT_EQ(
+      rackmon_shm_read_history(shm, 0x32, 2, &history[0][0], 2, timestamps, 2),
+      1);
+  ASSERT_EQ(history[0][0], 0xbb);
+  rackmon_shm_close(shm);
+}
@@ -0,0 +1,90 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "subscription.hpp"
+
+using namespace std;
+using namespace testing;
+
+class SubModbus : public Modbus {
+ public:
+  SubModbus() {}
+  MOCK_METHOD5(command, void(Msg&, Msg&, uint32_t, modbus_time, modbus_time));
+};
+
+// Responds to a read of 2 registers with the given value.
+static auto respond(uint16_t a, uint16_t b) {
+  return Invoke(
+      [a, b](Msg& req, Msg& resp, uint32_t, modbus_time, modbus_time) {
+        resp.len = 0;
+        resp << req.addr << uint8_t(0x3) << uint8_t(4) << a << b;
+        Encoder::encode(resp);
+        Encoder::decode(resp);
+      });
+}
+
+class SubscriptionTest : public ::testing::Test {
+ protected:
+  SubModbus modbus;
+  RegisterMap regmap = R"({
+    "name": "orv3_psu",
+    "address_range": [110, 140],
+    "probe_register": 104,
+    "default_baudrate": 19200,
+    "preferred_baudrate": 19200,
+    "registers": [
+      {"begin": 0, "length": 2, "format": "string", "name": "MFG_MODEL"},
+      {"begin": 4, "length": 2, "format": "integer", "name": "POWER"}
+    ]
+  })"_json;
+};
+
+TEST_F(SubscriptionTest, OnlyChanges) {
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillOnce(respond(0x6162, 0x6364))
+      .WillOnce(respond(0, 10))
+      .WillOnce(respond(0x6162, 0x6364))
+      .WillOnce(respond(0, 20));
+  ModbusDevice dev(modbus, 0x32, regmap);
+  RegisterSubscription sub;
+
+  // Nothing read yet, nothing to push.
+  ASSERT_EQ(sub.changes({dev.get_snapshot()}).size(), 0);
+
+  dev.monitor();
+  auto c1 = sub.changes({dev.get_snapshot()});
+  ASSERT_EQ(c1.size(), 1);
+  ASSERT_EQ(c1[0].addr, 0x32);
+  ASSERT_EQ(c1[0].register_list.size(), 2);
+  ASSERT_EQ(c1[0].register_list[0].history[0].value.strValue, "abcd");
+  ASSERT_EQ(c1[0].register_list[1].history[0].value.intValue, 10);
+
+  // Nothing got read since the last push.
+  ASSERT_EQ(sub.changes({dev.get_snapshot()}).size(), 0);
+
+  // Only the changed register is pushed.
+  dev.monitor();
+  auto c2 = sub.changes({dev.get_snapshot()});
+  ASSERT_EQ(c2.size(), 1);
+  ASSERT_EQ(c2[0].register_list.size(), 1);
+  ASSERT_EQ(c2[0].register_list[0].name, "POWER");
+  ASSERT_EQ(c2[0].register_list[0].history[0].value.intValue, 20);
+}
+
+TEST_F(SubscriptionTest, Filter) {
+  EXPECT_CALL(modbus, command(_, _, _, _, _))
+      .WillOnce(respond(0x6162, 0x6364))
+      .WillOnce(respond(0, 10));
+  ModbusDevice dev(modbus, 0x32, regmap);
+  dev.monitor();
+
+  RegisterSubscription other_dev =
+      R"({"type": "subscribe", "devices": [51]})"_json;
+  ASSERT_EQ(other_dev.changes({dev.get_snapshot()}).size(), 0);
+
+  RegisterSubscription power =
+      R"({"type": "subscribe", "devices": [50], "registers": [4]})"_json;
+  auto c = power.changes({dev.get_snapshot()});
+  ASSERT_EQ(c.size(), 1);
+  ASSERT_EQ(c[0].register_list.size(), 1);
+  ASSERT_EQ(c[0].register_list[0].reg_addr, 4);
+}
@@ -0,0 +1,28 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include "workerpool.hpp"
+
+using namespace std::literals;
+using namespace testing;
+
+TEST(WorkerPoolTest, basic) {
+  std::atomic<int> done = 0;
+  WorkerPool pool(2);
+  for (int i = 0; i < 10; i++)
+    pool.post([&done]() { done++; });
+  // Stop waits for all the queued jobs to complete.
+  pool.stop();
+  ASSERT_EQ(done, 10);
+  EXPECT_THROW(pool.post([]() {}), std::runtime_error);
+}
+
+TEST(WorkerPoolTest, concurrent) {
+  std::atomic<int> done = 0;
+  WorkerPool pool(2);
+  // A slow job should not hold up the other worker.
+  pool.post([]() { std::this_thread::sleep_for(1s); });
+  pool.post([&done]() { done++; });
+  std::this_thread::sleep_for(100ms);
+  ASSERT_EQ(done, 1);
+}
@@ -32,6 +32,17 @@ const std::unordered_map<int, speed_t> speed_map = {
     {57600, B57600},
     {115200, B115200}};
 
+int UARTDevice::frame_gap_us() const {
+  // 8 data bits + start + parity + stop.
+  constexpr int bits_per_char = 11;
+  constexpr int rx_fifo_depth = 16;
+  if (baudrate <= 0)
+    return 0;
+  int char_us = bits_per_char * 1000000 / baudrate;
+  int t35_us = baudrate > 19200 ? 1750 : (char_us * 7) / 2;
+  return t35_us + rx_fifo_depth * char_us;
+}
+
 void UARTDevice::open() {
   Device::open();
   set_attribute(true, baudrate);
@@ -24,6 +24,12 @@ class UARTDevice : public Device {
   int get_baudrate() const {
     return baudrate;
   }
+  // Silence which marks the end of a received frame. This is the
+  // Modbus T3.5 (Fixed to 1.75ms above 19200 baud) plus the time to
+  // fill the receive FIFO, since the UART hands over the received
+  // characters only once the FIFO trigger level or its own receive
+  // timeout is hit.
+  int frame_gap_us() const;
   void set_baudrate(int baud) {
     if (baud == baudrate)
       return;
@@ -0,0 +1,101 @@
+#include "value_provider.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+ValueProviderRegistry::ValueProviderRegistry() {
+  add("time_sync", []() { return std::to_string(std::time(nullptr)); });
+  add("bmc_uptime", []() {
+    struct timespec ts {};
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return std::to_string(ts.tv_sec);
+  });
+}
+
+ValueProviderRegistry& ValueProviderRegistry::instance() {
+  static ValueProviderRegistry registry;
+  return registry;
+}
+
+void ValueProviderRegistry::add(const std::string& name, Provider provider) {
+  std::unique_lock lk(mutex);
+  providers[name] = provider;
+}
+
+bool ValueProviderRegistry::contains(const std::string& name) {
+  std::unique_lock lk(mutex);
+  return providers.count(name) != 0;
+}
+
+std::string ValueProviderRegistry::get(const std::string& name) {
+  std::unique_lock lk(mutex);
+  Provider provider = providers.at(name);
+  lk.unlock();
+  return provider();
+}
+
+ShellExecutor::~ShellExecutor() {
+  std::unique_lock lk(mutex);
+  stopping = true;
+  cv.notify_all();
+  lk.unlock();
+  if (tid.joinable())
+    tid.join();
+}
+
+ShellExecutor& ShellExecutor::instance() {
+  static ShellExecutor executor;
+  return executor;
+}
+
+std::string ShellExecutor::run(const std::string& shell) {
+  std::array<char, 128> buffer;
+  std::string result;
+  std::unique_ptr<FILE, decltype(&pclose)> pipe(
+      popen(shell.c_str(), "r"), pclose);
+  if (!pipe) {
+    throw std::runtime_error("popen() failed!");
+  }
+  while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
+    result += buffer.data();
+  }
+  return result;
+}
+
+void ShellExecutor::worker() {
+  std::unique_lock lk(mutex);
+  while (!stopping) {
+    if (jobs.empty()) {
+      cv.wait(lk);
+      continue;
+    }
+    auto it = jobs.begin();
+    if (it->first > std::time(nullptr)) {
+      cv.wait_until(lk, std::chrono::system_clock::from_time_t(it->first));
+      continue;
+    }
+    Job job = std::move(it->second);
+    jobs.erase(it);
+    lk.unlock();
+    try {
+      job.result.set_value(run(job.shell));
+    } catch (...) {
+      job.result.set_exception(std::current_exception());
+    }
+    lk.lock();
+  }
+}
+
+std::future<std::string> ShellExecutor::run_at(
+    const std::string& shell,
+    time_t when) {
+  std::unique_lock lk(mutex);
+  if (!tid.joinable())
+    tid = std::thread(&ShellExecutor::worker, this);
+  auto it = jobs.emplace(when, Job{shell, {}});
+  std::future<std::string> ret = it->second.result.get_future();
+  cv.notify_all();
+  return ret;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// In-process sources of the values special handlers write to the
+// devices, by name. Built-in:
+//   "time_sync": Seconds since the epoch (Same as `date +%s`).
+//   "bmc_uptime": Seconds since the BMC booted.
+class ValueProviderRegistry {
+ public:
+  using Provider = std::function<std::string()>;
+
+ private:
+  std::mutex mutex{};
+  std::map<std::string, Provider> providers{};
+
+ public:
+  ValueProviderRegistry();
+  static ValueProviderRegistry& instance();
+
+  // Adds (or replaces) the provider name.
+  void add(const std::string& name, Provider provider);
+  bool contains(const std::string& name);
+  // Current value of the provider, throws std::out_of_range for an
+  // unknown name.
+  std::string get(const std::string& name);
+};
+
+// Runs the shell commands of special handlers on a thread of its own,
+// so the monitor never forks. A command is scheduled ahead of the time
+// its value is needed, which the returned future has by then.
+class ShellExecutor {
+  struct Job {
+    std::string shell;
+    std::promise<std::string> result;
+  };
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::multimap<time_t, Job> jobs{};
+  std::thread tid{};
+  bool stopping = false;
+
+  void worker();
+
+ public:
+  ~ShellExecutor();
+  static ShellExecutor& instance();
+  static std::string run(const std::string& shell);
+
+  // Output of shell, run no earlier than when (Right away if it has
+  // passed).
+  std::future<std::string> run_at(const std::string& shell, time_t when);
+};
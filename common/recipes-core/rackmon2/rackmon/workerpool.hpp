@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Fixed number of threads executing posted jobs in FIFO order.
+class WorkerPool {
+  std::mutex m{};
+  std::condition_variable cv{};
+  std::deque<std::function<void()>> jobs{};
+  std::vector<std::thread> workers{};
+  bool stopping = false;
+
+  void worker() {
+    std::unique_lock lk(m);
+    while (true) {
+      cv.wait(lk, [this]() { return stopping || !jobs.empty(); });
+      if (jobs.empty())
+        break;
+      std::function<void()> job = std::move(jobs.front());
+      jobs.pop_front();
+      lk.unlock();
+      job();
+      lk.lock();
+    }
+  }
+
+ public:
+  explicit WorkerPool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++)
+      workers.emplace_back(&WorkerPool::worker, this);
+  }
+  ~WorkerPool() {
+    stop();
+  }
+  // Queue a job to be executed by the next free worker.
+  void post(std::function<void()> job) {
+    std::unique_lock lk(m);
+    if (stopping)
+      throw std::runtime_error("Worker pool stopped");
+    jobs.push_back(std::move(job));
+    cv.notify_one();
+  }
+  // Finish all queued jobs and join the workers.
+  void stop() {
+    {
+      std::unique_lock lk(m);
+      stopping = true;
+      cv.notify_all();
+    }
+    for (auto& w : workers) {
+      if (w.joinable())
+        w.join();
+    }
+    workers.clear();
+  }
+};
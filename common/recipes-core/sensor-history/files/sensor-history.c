@@ -18,99 +18,291 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
-#include <syslog.h>
-#include <unistd.h>
-#include <float.h>
+#include <strings.h>
 #include <time.h>
-#include <sys/file.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <errno.h>
+#include <getopt.h>
+#include <jansson.h>
+#include <openbmc/pal.h>
+#include <openbmc/pal_sensors.h>
 
 #define MAX_DATA_NUM    2000
+#define MAX_SET_SENSORS 1024
+#define DEFAULT_PERIOD  600
 
 typedef struct {
-  long log_time;
-  float value;
-} sensor_data_t;
+	int period;
+	bool json;
+	const char *filter;
+	int num;
+	sensor_set_history_t set[MAX_SET_SENSORS];
+} query_t;
 
-typedef struct {
-  int index;
-  sensor_data_t data[MAX_DATA_NUM];
-} sensor_shm_t;
+int history_print(uint8_t fru, uint8_t snr)
+{
+	static long log_time[MAX_DATA_NUM];
+	static float value[MAX_DATA_NUM];
+	int i, cnt;
+
+	cnt = sensor_read_history_samples(fru, snr, log_time, value, MAX_DATA_NUM);
+	if (cnt < 0) {
+		printf("history read failed\n");
+		return -1;
+	}
+	for (i = 0; i < cnt; i++) {
+		printf("%lu: %f\n", log_time[i], value[i]);
+	}
+	return 0;
+}
 
-int shm_print(const char *key)
+static int query_add(query_t *q, uint8_t fru, uint8_t snr)
 {
-	sensor_shm_t *snr_shm;
-	void *ptr;
-	int share_size = sizeof(sensor_shm_t);
-	int i, idx;
-	int fd = shm_open(key, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-	if (fd < 0) {
-		printf("shm open failed");
+	char name[64];
+
+	if (q->filter) {
+		if (pal_get_sensor_name(fru, snr, name) ||
+		    strcasestr(name, q->filter) == NULL)
+			return 0;
+	}
+	if (q->num >= MAX_SET_SENSORS) {
+		fprintf(stderr, "More than %d sensors\n", MAX_SET_SENSORS);
 		return -1;
 	}
-	if (flock(fd, LOCK_EX) < 0) {
-		printf("lock failed\n");
-		close(fd);
+	q->set[q->num].fru = fru;
+	q->set[q->num].hist.sensor_num = snr;
+	q->num++;
+	return 0;
+}
+
+/* Add the sensors of a FRU, all of them if snrs is NULL. */
+static int query_add_fru(query_t *q, uint8_t fru, const char *snrs)
+{
+	uint8_t *list;
+	char *end;
+	int i, cnt;
+
+	if (snrs == NULL) {
+		if (pal_get_fru_sensor_list(fru, &list, &cnt) || cnt <= 0)
+			return 0;
+		for (i = 0; i < cnt; i++) {
+			if (query_add(q, fru, list[i]))
+				return -1;
+		}
+		return 0;
+	}
+	while (*snrs) {
+		long snr = strtol(snrs, &end, 0);
+
+		if (end == snrs || snr < 0 || snr > 0xFF ||
+		    (*end != ',' && *end != '\0'))
+			return -1;
+		if (query_add(q, fru, snr))
+			return -1;
+		snrs = *end ? end + 1 : end;
+	}
+	return 0;
+}
+
+/* FRU[:SENSOR_ID[,SENSOR_ID...]], FRU may be "all". */
+static int query_add_arg(query_t *q, const char *arg)
+{
+	char fruname[32];
+	const char *snrs = strchr(arg, ':');
+	size_t len = snrs ? (size_t)(snrs - arg) : strlen(arg);
+	uint8_t fru;
+	int ret = 0;
+
+	if (len == 0 || len >= sizeof(fruname))
 		return -1;
+	memcpy(fruname, arg, len);
+	fruname[len] = '\0';
+	if (snrs)
+		snrs++;
+
+	if (!strcmp(fruname, "all")) {
+		for (fru = 1; fru <= MAX_NUM_FRUS; fru++)
+			ret |= query_add_fru(q, fru, snrs);
+		return ret;
 	}
-	if (ftruncate(fd, share_size) != 0) {
-		printf("truncate failed\n");
-		flock(fd, LOCK_UN);
-		close(fd);
+	if (!strcmp(fruname, AGGREGATE_SENSOR_FRU_NAME)) {
+		fru = AGGREGATE_SENSOR_FRU_ID;
+	} else if (pal_get_fru_id(fruname, &fru)) {
 		return -1;
 	}
-	ptr = mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-	if (ptr == MAP_FAILED) {
-		printf("map failed!\n");
-		flock(fd, LOCK_UN);
-		close(fd);
-	}
-	snr_shm = (sensor_shm_t *)ptr;
-	for (i = 0; i < MAX_DATA_NUM; i++) {
-		sensor_data_t *snr;
-		idx = (snr_shm->index - i - 1);
-		if (idx < 0)
-			idx += MAX_DATA_NUM;
-		snr = &snr_shm->data[idx];
-		if (snr->log_time == 0)
-			break;
-		printf("%lu: %f\n", snr->log_time, snr->value);
+	return query_add_fru(q, fru, snrs);
+}
+
+static json_t *history_json(const sensor_history_t *h)
+{
+	json_t *obj = json_object();
+
+	json_object_set_new(obj, "min", json_real(h->min));
+	json_object_set_new(obj, "avg", json_real(h->average));
+	json_object_set_new(obj, "max", json_real(h->max));
+	json_object_set_new(obj, "p50", json_real(h->p50));
+	json_object_set_new(obj, "p95", json_real(h->p95));
+	json_object_set_new(obj, "p99", json_real(h->p99));
+	return obj;
+}
+
+static void history_text(const char *label, const sensor_history_t *h)
+{
+	printf("%-48s min %.2f, avg %.2f, max %.2f, p50 %.2f, p95 %.2f, p99 %.2f\n",
+	       label, h->min, h->average, h->max, h->p50, h->p95, h->p99);
+}
+
+/* The history of the whole set is read in one pass over the FRU regions. */
+static int query_run(query_t *q)
+{
+	time_t now = time(NULL);
+	sensor_history_t agg;
+	json_t *root = NULL, *sensors = NULL, *obj;
+	char fruname[32], name[64], label[128];
+	int i, valid = 0;
+
+	memset(&agg, 0, sizeof(agg));
+	sensor_read_set_history(q->set, q->num, now - q->period, &agg);
+
+	if (q->json) {
+		root = json_object();
+		sensors = json_array();
+		json_object_set_new(root, "time", json_integer(now));
+		json_object_set_new(root, "period", json_integer(q->period));
+	}
+	for (i = 0; i < q->num; i++) {
+		sensor_set_history_t *s = &q->set[i];
+
+		if (s->hist.ret)
+			continue;
+		valid++;
+		if (s->fru == AGGREGATE_SENSOR_FRU_ID)
+			strcpy(fruname, AGGREGATE_SENSOR_FRU_NAME);
+		else if (pal_get_fru_name(s->fru, fruname))
+			snprintf(fruname, sizeof(fruname), "%u", s->fru);
+		if (pal_get_sensor_name(s->fru, s->hist.sensor_num, name))
+			snprintf(name, sizeof(name), "0x%02x", s->hist.sensor_num);
+		if (q->json) {
+			obj = history_json(&s->hist);
+			json_object_set_new(obj, "fru", json_string(fruname));
+			json_object_set_new(obj, "name", json_string(name));
+			json_object_set_new(obj, "id", json_integer(s->hist.sensor_num));
+			json_array_append_new(sensors, obj);
+		} else {
+			snprintf(label, sizeof(label), "%s %s (0x%02x)",
+				 fruname, name, s->hist.sensor_num);
+			history_text(label, &s->hist);
+		}
+	}
+
+	if (q->json) {
+		json_object_set_new(root, "sensors", sensors);
+		if (agg.ret == 0) {
+			obj = history_json(&agg);
+			json_object_set_new(obj, "count", json_integer(valid));
+			json_object_set_new(root, "aggregate", obj);
+		}
+		json_dumpf(root, stdout, JSON_INDENT(4) | JSON_REAL_PRECISION(6));
+		printf("\n");
+		json_decref(root);
+	} else if (agg.ret == 0) {
+		snprintf(label, sizeof(label), "aggregate (%d sensors)", valid);
+		history_text(label, &agg);
+	}
+	if (agg.ret) {
+		fprintf(stderr, "No history of the sensors\n");
+		return -1;
 	}
-	munmap(ptr, share_size);
-	flock(fd, LOCK_UN);
-	close(fd);
 	return 0;
 }
 
+static int query_main(int argc, char *argv[])
+{
+	static query_t q;
+	static const struct option opts[] = {
+		{"query", no_argument, NULL, 'q'},
+		{"period", required_argument, NULL, 'p'},
+		{"filter", required_argument, NULL, 'f'},
+		{"json", no_argument, NULL, 'j'},
+		{NULL, 0, NULL, 0},
+	};
+	int opt;
+
+	q.period = DEFAULT_PERIOD;
+	while ((opt = getopt_long(argc, argv, "qp:f:j", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'q':
+			break;
+		case 'p':
+			q.period = atoi(optarg);
+			if (q.period <= 0)
+				return -1;
+			break;
+		case 'f':
+			q.filter = optarg;
+			break;
+		case 'j':
+			q.json = true;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (optind >= argc)
+		return -1;
+	for (; optind < argc; optind++) {
+		if (query_add_arg(&q, argv[optind])) {
+			fprintf(stderr, "Invalid sensors: %s\n", argv[optind]);
+			return -1;
+		}
+	}
+	if (q.num == 0) {
+		fprintf(stderr, "No sensors\n");
+		return -1;
+	}
+	return query_run(&q);
+}
+
 void usage(const char *prog)
 {
   printf("%s FRU_NAME SENSOR_ID\n", prog);
   printf(" Example: %s mb 42\n", prog);
+  printf("%s --query [--period SECONDS] [--filter NAME] [--json] FRU[:SENSOR_ID[,SENSOR_ID...]]...\n", prog);
+  printf(" History of every sensor and their aggregate over the last SECONDS (default %d)\n", DEFAULT_PERIOD);
+  printf(" FRU may be all, a FRU without SENSOR_ID means all its sensors,\n");
+  printf(" NAME keeps the sensors with NAME in their name (case insensitive)\n");
+  printf(" Example: %s --query --period 600 --filter inlet --json all\n", prog);
 }
 
 int main(int argc, char *argv[])
 {
+	if (argc > 1 && !strcmp(argv[1], "--query")) {
+		if (query_main(argc, argv)) {
+			usage(argv[0]);
+			return -1;
+		}
+		return 0;
+	}
 	if (argc < 3) {
     usage(argv[0]);
 		return -1;
   }
-  const char *fru = argv[1];
+  uint8_t fru;
   int snr;
+  if (!strcmp(argv[1], AGGREGATE_SENSOR_FRU_NAME)) {
+    fru = AGGREGATE_SENSOR_FRU_ID;
+  } else if (pal_get_fru_id(argv[1], &fru)) {
+    usage(argv[0]);
+    return -1;
+  }
   if (!strncmp(argv[2], "0x", 2)) {
     snr = (int)strtol(argv[2], NULL, 16);
   } else {
     snr = atoi(argv[2]);
   }
-  char key[256];
-  snprintf(key, sizeof(key), "%s_sensor%d", fru, snr);
-	shm_print(key);
-	return 0;
+	return history_print(fru, snr) ? -1 : 0;
 }
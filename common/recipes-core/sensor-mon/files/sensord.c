@@ -28,6 +28,8 @@
 #include <math.h>
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <openbmc/ipmi.h>
@@ -36,10 +38,14 @@
 #include <openbmc/pal_sensors.h>
 #include <openbmc/aggregate-sensor.h>
 #include <openbmc/kv.h>
+#include <openbmc/log.h>
 
 #define MIN_POLL_INTERVAL 2
 #define STOP_PERIOD 10
 #define MAX_SENSOR_CHECK_RETRY 3
+/* Sensor failure messages per second (and burst) to syslogd */
+#define LOG_RATE 20
+#define LOG_BURST 100
 #define MAX_ASSERT_CHECK_RETRY 1
 #ifdef CONFIG_FBY3_CWC
 #define MAX_SENSORD_FRU MAX_NUM_FRUS+MAX_NUM_EXPS
@@ -49,9 +55,85 @@
 #define MAX_SENSORD_FRU MAX_NUM_FRUS
 #endif
 
+#define MAX_SENSORD_WORKERS 4
+
+#ifdef SENSOR_ADAPTIVE_POLL
+/* Slowest and fastest poll of a sensor (ms) in adaptive mode. */
+#ifndef SENSOR_ADAPTIVE_MAX_INTERVAL
+#define SENSOR_ADAPTIVE_MAX_INTERVAL 30000
+#endif
+#ifndef SENSOR_ADAPTIVE_MIN_INTERVAL
+#define SENSOR_ADAPTIVE_MIN_INTERVAL 500
+#endif
+/* Readings within hysteresis before the poll interval doubles. */
+#define SENSOR_ADAPTIVE_STABLE_READS 4
+/* Band below (above) a threshold, as a fraction of it, where the poll
+ * speeds up. */
+#define SENSOR_ADAPTIVE_NEAR 0.1
+#endif
+
+/* Job of a FRU that checks it (SDR updates, thresholds, firmware updates)
+ * and reads its discrete sensors, instead of a threshold sensor. */
+#define SCHED_FRU_CHECK -1
+
+typedef struct snr_chan snr_chan_t;
+
+/* A threshold sensor of a FRU (or its SCHED_FRU_CHECK). It is in one place
+ * at a time: the schedule, the held sensors of its FRU, the queue of its
+ * channel, the ready queue, or a worker. */
+typedef struct snr_job {
+  struct snr_job *next;
+  snr_chan_t *chan;
+  uint64_t due_ms;
+  uint8_t fru;
+  int snr_num;
+  uint8_t read_fail;
+#ifdef SENSOR_ADAPTIVE_POLL
+  uint8_t stable;
+  float last_val;
+#endif
+} snr_job_t;
+
+/* The sensors of a channel waiting for the one being read. */
+struct snr_chan {
+  uint16_t id;
+  bool busy;
+  snr_job_t *head, *tail;
+};
+
+/* Monitoring of a FRU. The FRU check (wrlock) excludes the reads of its
+ * sensors (rdlock). While the check fails the sensors are held; paused
+ * and held are under g_sched_lock. */
+typedef struct {
+  pthread_rwlock_t lock;
+  uint8_t *sensor_list, *discrete_list;
+  int sensor_cnt, discrete_cnt;
+  bool paused;
+  snr_job_t *held_head, *held_tail;
+} fru_mon_t;
+
 static thresh_sensor_t g_snr[MAX_SENSORD_FRU][MAX_SENSOR_NUM + 1] = {0};
 static thresh_sensor_t g_aggregate_snr[MAX_SENSOR_NUM + 1] = {0};
 
+static fru_mon_t g_fru_mon[MAX_SENSORD_FRU];
+/* The schedule (a min-heap of the jobs by due_ms), the channels and the
+ * ready queue. */
+static pthread_mutex_t g_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_sched_cond;
+static pthread_cond_t g_ready_cond = PTHREAD_COND_INITIALIZER;
+static snr_job_t **g_sched;
+static int g_sched_cnt;
+static snr_chan_t *g_chan;
+static int g_chan_cnt;
+static snr_job_t *g_ready_head, *g_ready_tail;
+/* Number of the sensors of every FRU in an asserted state (kept by
+ * snr_set_state()). The health monitor waits on g_health_cond till one of
+ * them goes from or to 0. */
+static pthread_mutex_t g_health_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_health_cond;
+static int g_fru_asserted[MAX_SENSORD_FRU + 1];
+static bool g_health_changed = true;
+
 static void
 print_usage() {
     printf("Usage: sensord <options>\n");
@@ -64,7 +146,7 @@ static void sensor_fail_assert_check(uint8_t *fail_cnt, uint8_t fru, int snr_num
   if (*fail_cnt < MAX_SENSOR_CHECK_RETRY) {
     (*fail_cnt)++;
     if (*fail_cnt == MAX_SENSOR_CHECK_RETRY)
-      syslog(LOG_ERR, "FRU: %d, num: 0x%X, snr:%-16s, read failed",
+      obmc_syslog(LOG_ERR, "FRU: %d, num: 0x%X, snr:%-16s, read failed",
           fru, snr_num, name);
   }
 #endif
@@ -74,7 +156,7 @@ static void sensor_fail_assert_clear(uint8_t *fail_cnt, uint8_t fru, int snr_num
 {
 #ifdef SENSOR_FAIL_DETECT
   if (*fail_cnt == MAX_SENSOR_CHECK_RETRY) {
-    syslog(LOG_ERR, "FRU: %d, num: 0x%X, snr:%-16s, read recovered",
+    obmc_syslog(LOG_ERR, "FRU: %d, num: 0x%X, snr:%-16s, read recovered",
         fru, snr_num, name);
   }
   *fail_cnt = 0;
@@ -102,6 +184,37 @@ get_struct_thresh_sensor(uint8_t fru) {
   return snr;
 }
 
+/* The FRU whose health the sensors of fru count towards, -1 for none */
+static int
+health_fru(uint8_t fru) {
+#ifdef CONFIG_FBY3_CWC
+  // The expansions count towards slot1
+  if (fru == MAX_NUM_FRUS + 2 || fru == MAX_NUM_FRUS + 3)
+    return FRU_SLOT1;
+#endif
+  return (fru >= 1 && fru <= MAX_SENSORD_FRU) ? fru : -1;
+}
+
+/*
+ * Sets the state of a sensor, counting the sensors of its FRU with a state.
+ * Wakes the health monitor when the FRU gets its first one or loses its
+ * last one.
+ */
+static void
+snr_set_state(uint8_t fru, thresh_sensor_t *snr, int state) {
+  int hfru = health_fru(fru);
+
+  pthread_mutex_lock(&g_health_lock);
+  if (hfru >= 0 && !snr->curr_state != !state) {
+    if (state ? g_fru_asserted[hfru]++ == 0 : --g_fru_asserted[hfru] == 0) {
+      g_health_changed = true;
+      pthread_cond_signal(&g_health_cond);
+    }
+  }
+  snr->curr_state = state;
+  pthread_mutex_unlock(&g_health_lock);
+}
+
 /* Initialize all thresh_sensor_t structs for all the Yosemite sensors */
 static int
 init_fru_snr_thresh(uint8_t fru) {
@@ -126,7 +239,7 @@ init_fru_snr_thresh(uint8_t fru) {
     return -1;
   }
 
-  ret = pal_get_fru_sensor_list(fruNb, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fruNb, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     return ret;
   }
@@ -314,7 +427,7 @@ check_thresh_deassert(uint8_t fru, uint8_t snr_num, uint8_t thresh,
   }
 
   if (curr_state) {
-    snr[snr_num].curr_state &= curr_state;
+    snr_set_state(fru, &snr[snr_num], snr[snr_num].curr_state & curr_state);
     pal_update_ts_sled();
     syslog(LOG_CRIT, "DEASSERT: %s threshold - settled - FRU: %d, num: 0x%X "
         "curr_val: %.2f %s, thresh_val: %.2f %s, snr: %-16s",thresh_name,
@@ -428,7 +541,7 @@ check_thresh_assert(uint8_t fru, uint8_t snr_num, uint8_t thresh,
 
   if (curr_state) {
     curr_state &= snr[snr_num].flag;
-    snr[snr_num].curr_state |= curr_state;
+    snr_set_state(fru, &snr[snr_num], snr[snr_num].curr_state | curr_state);
     pal_update_ts_sled();
     syslog(LOG_CRIT, "ASSERT: %s threshold - raised - FRU: %d, num: 0x%X"
         " curr_val: %.2f %s, thresh_val: %.2f %s, snr: %-16s", thresh_name,
@@ -465,6 +578,60 @@ reinit_snr_threshold(uint8_t fru, int mode) {
   return 0;
 }
 
+/*
+ * Reload the thresholds of the sensors listed in the reinit flag (one
+ * per line), or of all the sensors of the FRU if it has no list.
+ */
+static int
+thresh_reinit_sensors(uint8_t fru, const char *initpath) {
+  char busypath[80];
+  char buf[4 * 256 + 8];
+  char *line, *saveptr, *end;
+  uint8_t snrs[256];
+  thresh_sensor_t *snr;
+  int fd, len = -1, cnt = 0, i;
+  long num;
+#ifdef CONFIG_FBY3_CWC
+  uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+  uint8_t fruNb = fru;
+#endif
+
+  // Take the flag first, so a change meanwhile sets it again.
+  snprintf(busypath, sizeof(busypath), "%s.busy", initpath);
+  if (rename(initpath, busypath) != 0)
+    return reinit_snr_threshold(fru, SENSORD_MODE_TESTING);
+  fd = open(busypath, O_RDONLY);
+  if (fd >= 0) {
+    len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+  }
+  unlink(busypath);
+
+  snr = get_struct_thresh_sensor(fru);
+  if (snr == NULL || len <= 0 || len == sizeof(buf) - 1)
+    return reinit_snr_threshold(fru, SENSORD_MODE_TESTING);
+  buf[len] = '\0';
+  for (line = strtok_r(buf, "\n", &saveptr); line != NULL;
+       line = strtok_r(NULL, "\n", &saveptr)) {
+    num = strtol(line, &end, 0);
+    // "all", as any other line but a sensor number
+    if (end == line || *end != '\0' || num < 0 || num > 0xFF)
+      return reinit_snr_threshold(fru, SENSORD_MODE_TESTING);
+    snrs[cnt++] = num;
+  }
+
+  for (i = 0; i < cnt; i++) {
+    if (pal_get_thresh_from_file(fruNb, snrs[i], &snr[snrs[i]]) < 0) {
+      syslog(LOG_WARNING, "%s: Fail to get threshold of sensor 0x%x for fru%d",
+             __func__, snrs[i], fru);
+      continue;
+    }
+    pal_init_sensor_check(fruNb, snrs[i], (void *)&snr[snrs[i]]);
+  }
+  return 0;
+}
+
 static int
 thresh_reinit_chk(uint8_t fru) {
   int ret;
@@ -477,7 +644,7 @@ thresh_reinit_chk(uint8_t fru) {
   uint8_t fruNb = fru;
 #endif
 
-  ret = pal_get_fru_name(fruNb, fru_name);
+  ret = pal_get_fru_name_cached(fruNb, fru_name);
   if (ret < 0) {
     printf("%s: Fail to get fru%d name\n", __func__, fru);
     return -1;
@@ -493,28 +660,119 @@ thresh_reinit_chk(uint8_t fru) {
     }
   } else {
     // If THRESHOLD_BIN file exist and INIT_FLAG also exist, it means threshold-util --set is triggered.
-    // And snr info should be updated.
+    // And snr info should be updated, of the listed sensors only if the flag has a list.
     if (0 == access(initpath, F_OK))
-      ret = reinit_snr_threshold(fru, SENSORD_MODE_TESTING);
+      ret = thresh_reinit_sensors(fru, initpath);
   }
 
   return ret;
 }
 
+static uint64_t
+monotonic_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Earliest first, the FRU check before the sensors due with it. */
+static bool
+sched_before(const snr_job_t *a, const snr_job_t *b) {
+  if (a->due_ms != b->due_ms)
+    return a->due_ms < b->due_ms;
+  return a->snr_num < b->snr_num;
+}
+
+/* Add the job to the schedule, due at due_ms. */
+static void
+sched_push(snr_job_t *job, uint64_t due_ms) {
+  int i = g_sched_cnt++;
+
+  job->due_ms = due_ms;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!sched_before(job, g_sched[parent]))
+      break;
+    g_sched[i] = g_sched[parent];
+    i = parent;
+  }
+  g_sched[i] = job;
+}
+
+static snr_job_t *
+sched_pop(void) {
+  snr_job_t *top = g_sched[0];
+  snr_job_t *last = g_sched[--g_sched_cnt];
+  int i = 0, child;
+
+  while ((child = 2 * i + 1) < g_sched_cnt) {
+    if (child + 1 < g_sched_cnt && sched_before(g_sched[child + 1], g_sched[child]))
+      child++;
+    if (!sched_before(g_sched[child], last))
+      break;
+    g_sched[i] = g_sched[child];
+    i = child;
+  }
+  g_sched[i] = last;
+  return top;
+}
+
+/* Next time the sensor is due (interval in ms), after the one at due_ms.
+ * A late sensor is read right away rather than for every period it missed. */
+static uint64_t
+sched_next(uint64_t due_ms, uint32_t interval, uint64_t now) {
+  uint64_t next = due_ms + interval;
+
+  return next > now ? next : now;
+}
+
+static void
+job_append(snr_job_t **head, snr_job_t **tail, snr_job_t *job) {
+  job->next = NULL;
+  if (*tail)
+    (*tail)->next = job;
+  else
+    *head = job;
+  *tail = job;
+}
+
+static snr_job_t *
+job_take(snr_job_t **head, snr_job_t **tail) {
+  snr_job_t *job = *head;
+
+  *head = job->next;
+  if (*head == NULL)
+    *tail = NULL;
+  return job;
+}
+
+/* Hand the due job to the workers, or queue it behind the job being read
+ * on its channel. */
+static void
+job_dispatch(snr_job_t *job) {
+  snr_chan_t *chan = job->chan;
+
+  if (chan->busy) {
+    job_append(&chan->head, &chan->tail, job);
+    return;
+  }
+  chan->busy = true;
+  job_append(&g_ready_head, &g_ready_tail, job);
+  pthread_cond_signal(&g_ready_cond);
+}
+
 /*
- * Starts monitoring all the sensors on a fru for all the threshold/discrete values.
- * Each pthread runs this monitoring for a different fru.
+ * Checks a FRU, with its sensors held: firmware update, SDR update,
+ * threshold reinit. Then reads its discrete sensors.
+ * Returns the seconds to hold the sensors for, 0 if they are polled.
  */
-static void *
-snr_monitor(void *arg) {
-
-  uint8_t fru = (uint8_t)(uintptr_t)arg;
-  int i, ret, snr_num, sensor_cnt, discrete_cnt;
+static int
+fru_check(uint8_t fru) {
+  fru_mon_t *fm = &g_fru_mon[fru - 1];
+  thresh_sensor_t *snr = get_struct_thresh_sensor(fru);
+  int i, ret, snr_num;
   float curr_val;
-  uint8_t *sensor_list, *discrete_list;
-  thresh_sensor_t *snr;
-  uint32_t snr_poll_interval[MAX_SENSOR_NUM + 1] = {0};
-  uint8_t snr_read_fail[MAX_SENSOR_NUM + 1] = {0};
 #ifdef CONFIG_FBY3_CWC
   uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
   uint8_t slot = fru >= MAX_NUM_FRUS ? FRU_SLOT1 : fru;
@@ -523,224 +781,485 @@ snr_monitor(void *arg) {
   uint8_t slot = fru;
 #endif
 
-  ret = pal_get_fru_sensor_list(fruNb, &sensor_list, &sensor_cnt);
-  if (ret < 0) {
-    pthread_detach(pthread_self());
-    pthread_exit(NULL);
+  if (pal_is_fw_update_ongoing(slot)) {
+    return STOP_PERIOD;
   }
 
-  ret = pal_get_fru_discrete_list(fruNb, &discrete_list, &discrete_cnt);
-  if (ret < 0) {
-    pthread_detach(pthread_self());
-    pthread_exit(NULL);
+  if (pal_get_sdr_update_flag(fru)) {
+    /* A new SDR may come with a different sensor list */
+    pal_fru_cache_invalidate(fruNb);
+    if (init_fru_snr_thresh(fru) < 0 || pal_update_sensor_reading_sdr(fru) < 0) {
+      syslog(LOG_DEBUG, "%s : slot%u SDR update fail", __func__, fru);
+      return STOP_PERIOD;
+    } else {
+      syslog(LOG_DEBUG, "%s : slot%u SDR update successfully", __func__, fru);
+      pal_set_sdr_update_flag(fru,0);
+    }
   }
 
-  if ((sensor_cnt == 0) && (discrete_cnt == 0)) {
-    pthread_detach(pthread_self());
-    pthread_exit(NULL);
+  ret = thresh_reinit_chk(fru);
+  if (ret < 0)
+    syslog(LOG_ERR, "%s: Fail to reinit sensor threshold for fru%d",__func__,fru);
+
+  for (i = 0; i < fm->discrete_cnt; i++) {
+    snr_num = fm->discrete_list[i];
+    ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val);
+    if (!ret && (snr[snr_num].curr_state != (int) curr_val)) {
+      pal_sensor_discrete_check(fru, snr_num, snr[snr_num].name,
+          snr[snr_num].curr_state, (int) curr_val);
+      snr_set_state(fru, &snr[snr_num], (int) curr_val);
+    }
   }
 
-  snr = get_struct_thresh_sensor(fru);
-  if (snr == NULL) {
-    syslog(LOG_WARNING, "snr_monitor: get_struct_thresh_sensor failed");
-    exit(-1);
+#ifdef DYN_THRESH_FRU1
+  // Handle dynamic threshold changes for FRU1
+  if (fru == 1) {
+    init_fru_snr_thresh(1);
   }
+#endif
+  return 0;
+}
 
-  for (i = 0; i < discrete_cnt; i++) {
-    snr_num = discrete_list[i];
-    pal_get_sensor_name(fruNb, snr_num, snr[snr_num].name);
+#ifdef SENSOR_ADAPTIVE_POLL
+/*
+ * Adapts the poll interval (ms) of a sensor to its reading: shorter as it
+ * gets near a threshold, longer while it stays within hysteresis far from
+ * them. Asserted or failing sensors keep their interval.
+ */
+static uint32_t
+snr_adaptive_interval(snr_job_t *job, thresh_sensor_t *snr, float val,
+    bool valid, uint32_t interval) {
+  static const uint8_t upper[] = { UNC_THRESH, UCR_THRESH, UNR_THRESH };
+  static const uint8_t lower[] = { LNC_THRESH, LCR_THRESH, LNR_THRESH };
+  const float upper_val[] = { snr->unc_thresh, snr->ucr_thresh, snr->unr_thresh };
+  const float lower_val[] = { snr->lnc_thresh, snr->lcr_thresh, snr->lnr_thresh };
+  float hyst = snr->pos_hyst > snr->neg_hyst ? snr->pos_hyst : snr->neg_hyst;
+  float near = 1, d;
+  unsigned i, shift;
+
+  if (!valid) {
+    job->stable = 0;
+    return interval;
   }
 
-  // set flag to notice BMC sensord snr_monitor  is ready
-  kv_set("flag_sensord_monitor", "1", 0, 0);
-
-  while(1) {
-    if (pal_is_fw_update_ongoing(slot)) {
-      sleep(STOP_PERIOD);
-      continue;
+  // Distance to the closest threshold, relative to its band.
+  for (i = 0; i < sizeof(upper) / sizeof(upper[0]); i++) {
+    if (GETBIT(snr->flag, upper[i])) {
+      d = (upper_val[i] - val) / (SENSOR_ADAPTIVE_NEAR * fmaxf(fabsf(upper_val[i]), 1));
+      near = fminf(near, fmaxf(d, 0));
     }
-
-    if (pal_get_sdr_update_flag(fru)) {
-      if (init_fru_snr_thresh(fru) < 0 || pal_update_sensor_reading_sdr(fru) < 0) {
-        syslog(LOG_DEBUG, "%s : slot%u SDR update fail", __func__, fru);
-        sleep(STOP_PERIOD);
-        continue;
-      } else {
-        syslog(LOG_DEBUG, "%s : slot%u SDR update successfully", __func__, fru);
-        pal_set_sdr_update_flag(fru,0);
-      }
+    if (GETBIT(snr->flag, lower[i])) {
+      d = (val - lower_val[i]) / (SENSOR_ADAPTIVE_NEAR * fmaxf(fabsf(lower_val[i]), 1));
+      near = fminf(near, fmaxf(d, 0));
     }
+  }
 
-    ret = thresh_reinit_chk(fru);
-    if (ret < 0)
-      syslog(LOG_ERR, "%s: Fail to reinit sensor threshold for fru%d",__func__,fru);
+  if (job->stable && fabsf(val - job->last_val) <= hyst) {
+    if (job->stable < UINT8_MAX)
+      job->stable++;
+  } else {
+    job->stable = 1;
+    job->last_val = val;
+  }
 
-    for (i = 0; i < sensor_cnt; i++) {
-      snr_num = sensor_list[i];
-      curr_val = 0;
-      if (snr[snr_num].flag) {
-        // granular the sensor via assigning the poll_interval
-        if (snr_poll_interval[snr_num] > MIN_POLL_INTERVAL) {
-          snr_poll_interval[snr_num] -= MIN_POLL_INTERVAL;
-          continue;
-        }
-        snr_poll_interval[snr_num] = snr[snr_num].poll_interval;
-        if (!(ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val))) {
-          sensor_fail_assert_clear(&snr_read_fail[snr_num], fru, snr_num, snr[snr_num].name);
-          check_thresh_assert(fru, snr_num, UNC_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, UCR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, UNR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LNC_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LCR_THRESH, &curr_val);
-          check_thresh_assert(fru, snr_num, LNR_THRESH, &curr_val);
+  if (snr->curr_state) {
+    return interval;
+  }
+  if (near < 1) {
+    job->stable = 0;
+    interval *= near;
+    return interval > SENSOR_ADAPTIVE_MIN_INTERVAL ? interval : SENSOR_ADAPTIVE_MIN_INTERVAL;
+  }
+  shift = (job->stable - 1) / SENSOR_ADAPTIVE_STABLE_READS;
+  if (shift > 0) {
+    interval = shift < 16 ? interval << shift : UINT32_MAX;
+    if (interval > SENSOR_ADAPTIVE_MAX_INTERVAL)
+      interval = SENSOR_ADAPTIVE_MAX_INTERVAL;
+  }
+  return interval;
+}
+#endif
 
-          check_thresh_deassert(fru, snr_num, UNR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, UCR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, UNC_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LNR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LCR_THRESH, &curr_val);
-          check_thresh_deassert(fru, snr_num, LNC_THRESH, &curr_val);
-        } else {
-          sensor_fail_assert_check(&snr_read_fail[snr_num], fru, snr_num, snr[snr_num].name);
-        } /* pal_sensor_read return check */
-      } /* flag check */
-    } /* loop for all sensors */
+/*
+ * Reads a threshold sensor and checks it against its thresholds.
+ * Returns its poll interval in ms.
+ */
+static uint32_t
+snr_check(snr_job_t *job) {
+  uint8_t fru = job->fru;
+  uint8_t snr_num = job->snr_num;
+  thresh_sensor_t *snr = get_struct_thresh_sensor(fru);
+  float curr_val = 0;
+  int ret = -1;
+  uint32_t interval;
+#ifdef CONFIG_FBY3_CWC
+  uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+  uint8_t fruNb = fru;
+#endif
 
-    for (i = 0; i < discrete_cnt; i++) {
-      snr_num = discrete_list[i];
-      ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val);
-      if (!ret && (snr[snr_num].curr_state != (int) curr_val)) {
-        pal_sensor_discrete_check(fru, snr_num, snr[snr_num].name,
-            snr[snr_num].curr_state, (int) curr_val);
-        snr[snr_num].curr_state = (int) curr_val;
+  if (snr[snr_num].flag) {
+    if (!(ret = sensor_raw_read_helper(fruNb, snr_num, &curr_val))) {
+      sensor_fail_assert_clear(&job->read_fail, fru, snr_num, snr[snr_num].name);
+      check_thresh_assert(fru, snr_num, UNC_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, UCR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, UNR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LNC_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LCR_THRESH, &curr_val);
+      check_thresh_assert(fru, snr_num, LNR_THRESH, &curr_val);
+
+      check_thresh_deassert(fru, snr_num, UNR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, UCR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, UNC_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LNR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LCR_THRESH, &curr_val);
+      check_thresh_deassert(fru, snr_num, LNC_THRESH, &curr_val);
+    } else {
+      sensor_fail_assert_check(&job->read_fail, fru, snr_num, snr[snr_num].name);
+    } /* pal_sensor_read return check */
+  } /* flag check */
+  // poll_interval is re-read, it changes with the SDR.
+  interval = (snr[snr_num].poll_interval ? snr[snr_num].poll_interval : MIN_POLL_INTERVAL) * 1000;
+#ifdef SENSOR_ADAPTIVE_POLL
+  interval = snr_adaptive_interval(job, &snr[snr_num], curr_val, ret == 0, interval);
+#endif
+  return interval;
+}
+
+/*
+ * Worker of the sensor monitor: runs the ready jobs, one at a time per
+ * channel, then puts them back in the schedule.
+ */
+static void *
+snr_worker(void *unused) {
+  snr_job_t *job, *held;
+  fru_mon_t *fm;
+  uint32_t interval = 0;
+  int hold = 0;
+  uint64_t now;
+
+  pthread_mutex_lock(&g_sched_lock);
+  while (1) {
+    while (g_ready_head == NULL)
+      pthread_cond_wait(&g_ready_cond, &g_sched_lock);
+    job = job_take(&g_ready_head, &g_ready_tail);
+    pthread_mutex_unlock(&g_sched_lock);
+
+    fm = &g_fru_mon[job->fru - 1];
+    if (job->snr_num == SCHED_FRU_CHECK) {
+      pthread_rwlock_wrlock(&fm->lock);
+      hold = fru_check(job->fru);
+      pthread_rwlock_unlock(&fm->lock);
+    } else {
+      pthread_rwlock_rdlock(&fm->lock);
+      interval = snr_check(job);
+      pthread_rwlock_unlock(&fm->lock);
+    }
+    now = monotonic_ms();
+
+    pthread_mutex_lock(&g_sched_lock);
+    if (job->snr_num == SCHED_FRU_CHECK) {
+      fm->paused = hold != 0;
+      while (!fm->paused && fm->held_head) {
+        held = job_take(&fm->held_head, &fm->held_tail);
+        sched_push(held, now);
       }
+      sched_push(job, hold ? now + hold * 1000 :
+          sched_next(job->due_ms, MIN_POLL_INTERVAL * 1000, now));
+    } else {
+      sched_push(job, sched_next(job->due_ms, interval, now));
     }
+    pthread_cond_signal(&g_sched_cond);
 
-#ifdef DYN_THRESH_FRU1
-    // Handle dynamic threshold changes for FRU1
-    if (fru == 1) {
-      init_fru_snr_thresh(1);
+    if (job->chan->head) {
+      job_append(&g_ready_head, &g_ready_tail,
+          job_take(&job->chan->head, &job->chan->tail));
+    } else {
+      job->chan->busy = false;
     }
-#endif
+  }
+  return NULL;
+}
 
-    sleep(MIN_POLL_INTERVAL);
-  } /* while loop*/
-} /* function definition */
+/*
+ * Scheduler of the sensor monitor: hands the jobs to the workers when
+ * they are due, and holds the sensors of the FRUs whose check failed.
+ */
+static void *
+snr_scheduler(void *unused) {
+  struct timespec ts;
+  snr_job_t *job;
+  fru_mon_t *fm;
+  uint64_t now;
+
+  pthread_mutex_lock(&g_sched_lock);
+  while (1) {
+    if (g_sched_cnt == 0) {
+      pthread_cond_wait(&g_sched_cond, &g_sched_lock);
+      continue;
+    }
+    now = monotonic_ms();
+    if (g_sched[0]->due_ms > now) {
+      ts.tv_sec = g_sched[0]->due_ms / 1000;
+      ts.tv_nsec = (g_sched[0]->due_ms % 1000) * 1000000;
+      pthread_cond_timedwait(&g_sched_cond, &g_sched_lock, &ts);
+      continue;
+    }
 
+    job = sched_pop();
+    fm = &g_fru_mon[job->fru - 1];
+    if (job->snr_num != SCHED_FRU_CHECK && fm->paused) {
+      // Back in the schedule when the FRU check passes.
+      job_append(&fm->held_head, &fm->held_tail, job);
+      continue;
+    }
+    job_dispatch(job);
+  }
+  return NULL;
+}
+
+/* Sensor lists of a FRU to monitor. Returns -1 if there is none. */
+static int
+fru_mon_init(uint8_t fru) {
+  fru_mon_t *fm = &g_fru_mon[fru - 1];
+  thresh_sensor_t *snr;
+  int i;
 #ifdef CONFIG_FBY3_CWC
-static uint8_t
-get_exp_sensor_state() {
-  int num = 0;
-  uint8_t topExp = MAX_NUM_FRUS + 2, botExp = MAX_NUM_FRUS + 3;
-  uint8_t value = 0;
-  thresh_sensor_t *snr = get_struct_thresh_sensor(topExp);
+  uint8_t fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+  uint8_t fruNb = fru;
+#endif
 
-  for (num = 0; snr != NULL && num <= MAX_SENSOR_NUM; num++) {
-    value |= snr[num].curr_state;
+  if (pal_get_fru_sensor_list_cached(fruNb, &fm->sensor_list, &fm->sensor_cnt) < 0 ||
+      pal_get_fru_discrete_list(fruNb, &fm->discrete_list, &fm->discrete_cnt) < 0) {
+    return -1;
   }
-  
-  snr = get_struct_thresh_sensor(botExp);
-  for (num = 0; snr != NULL && num <= MAX_SENSOR_NUM; num++) {
-    value |= snr[num].curr_state;
+  if ((fm->sensor_cnt == 0) && (fm->discrete_cnt == 0)) {
+    return -1;
   }
 
-  return value;
+  snr = get_struct_thresh_sensor(fru);
+  if (snr == NULL) {
+    syslog(LOG_WARNING, "fru_mon_init: get_struct_thresh_sensor failed");
+    exit(-1);
+  }
+
+  for (i = 0; i < fm->discrete_cnt; i++) {
+    pal_get_sensor_name(fruNb, fm->discrete_list[i], snr[fm->discrete_list[i]].name);
+  }
+
+  pthread_rwlock_init(&fm->lock, NULL);
+  // The sensors wait for the first FRU check.
+  fm->paused = true;
+  return 0;
 }
-#endif
 
+static snr_chan_t *
+snr_chan_get(uint16_t id) {
+  int i;
+
+  for (i = 0; i < g_chan_cnt; i++) {
+    if (g_chan[i].id == id)
+      return &g_chan[i];
+  }
+  g_chan[g_chan_cnt].id = id;
+  return &g_chan[g_chan_cnt++];
+}
+
+/*
+ * Starts monitoring all the threshold/discrete sensors of the FRUs of
+ * fru_flag. Every sensor is read at its own poll_interval (seconds),
+ * every FRU is checked every MIN_POLL_INTERVAL. Sensors are read one at
+ * a time per access channel (see pal_get_sensor_channel()), and by up to
+ * MAX_SENSORD_WORKERS workers across the channels.
+ */
+static int
+snr_monitor_start(int fru_flag, pthread_t *scheduler) {
+  pthread_condattr_t attr;
+  pthread_t worker;
+  snr_job_t *jobs;
+  fru_mon_t *fm;
+  uint16_t channel;
+  uint8_t fru;
+  int i, cnt = 0, workers, started = 0;
+  uint64_t start;
+  uint8_t fruNb;
+
+  for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
+    if (GETBIT(fru_flag, fru))
+      cnt += g_fru_mon[fru - 1].sensor_cnt + 1;
+  }
+  if (cnt == 0)
+    return -1;
+
+  jobs = calloc(cnt, sizeof(*jobs));
+  g_sched = calloc(cnt, sizeof(*g_sched));
+  g_chan = calloc(cnt, sizeof(*g_chan));
+  if (jobs == NULL || g_sched == NULL || g_chan == NULL)
+    return -1;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_sched_cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  // The FRUs start a second apart.
+  start = monotonic_ms();
+  for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
+    if (!GETBIT(fru_flag, fru))
+      continue;
+    fm = &g_fru_mon[fru - 1];
 #ifdef CONFIG_FBY3_CWC
-static uint8_t
-clear_exp_sensor_state() {
-  int num = 0;
-  uint8_t topExp = MAX_NUM_FRUS + 2, botExp = MAX_NUM_FRUS + 3;
-  thresh_sensor_t *snr = get_struct_thresh_sensor(topExp);
+    fruNb = fru >= MAX_NUM_FRUS ? IDX_TO_NB(fru) : fru;
+#else
+    fruNb = fru;
+#endif
+    for (i = -1; i < fm->sensor_cnt; i++) {
+      if (i < 0 || pal_get_sensor_channel(fruNb, fm->sensor_list[i], &channel))
+        channel = SENSOR_CHANNEL(SENSOR_CHANNEL_FRU, fruNb);
+      jobs->fru = fru;
+      jobs->snr_num = i < 0 ? SCHED_FRU_CHECK : fm->sensor_list[i];
+      jobs->chan = snr_chan_get(channel);
+      sched_push(jobs++, start);
+    }
+    start += 1000;
+  }
 
-  for (num = 0; snr != NULL && num <= MAX_SENSOR_NUM; num++) {
-    snr[num].curr_state = 0;
+  workers = g_chan_cnt < MAX_SENSORD_WORKERS ? g_chan_cnt : MAX_SENSORD_WORKERS;
+  for (i = 0; i < workers; i++) {
+    if (pthread_create(&worker, NULL, snr_worker, NULL) != 0) {
+      syslog(LOG_WARNING, "pthread_create for sensor worker %d failed\n", i);
+      continue;
+    }
+    pthread_detach(worker);
+    started++;
   }
+  if (started == 0 || pthread_create(scheduler, NULL, snr_scheduler, NULL) != 0)
+    return -1;
+
+  // set flag to notice BMC sensord snr_monitor  is ready
+  kv_set("flag_sensord_monitor", "1", 0, 0);
+  return 0;
+}
+
+/*
+ * Clears the states of the sensors of a FRU (log-util clear), sensord
+ * asserts them again on their next reads.
+ */
+static void
+fru_clear_states(uint8_t fru) {
+  thresh_sensor_t *snr = get_struct_thresh_sensor(fru);
+  int num;
 
-  snr = get_struct_thresh_sensor(botExp);
   for (num = 0; snr != NULL && num <= MAX_SENSOR_NUM; num++) {
-    snr[num].curr_state = 0;
+    if (snr[num].curr_state)
+      snr_set_state(fru, &snr[num], 0);
   }
+}
 
-  return 0;
+#ifdef CONFIG_FBY3_CWC
+static void
+clear_exp_sensor_state() {
+  uint8_t topExp = MAX_NUM_FRUS + 2, botExp = MAX_NUM_FRUS + 3;
+
+  fru_clear_states(topExp);
+  fru_clear_states(botExp);
 }
 #endif
 
+/*
+ * Keeps the health of the FRUs in the kv store: bad while any of their
+ * sensors has a state. The kv is only written when the health changes,
+ * and read back while a FRU is bad (to find out log-util cleared it) or
+ * could not be read yet. Otherwise the monitor sleeps till a FRU gets its
+ * first or loses its last asserted sensor.
+ */
 static void *
 snr_health_monitor() {
 
   int fru;
-  thresh_sensor_t *snr;
   uint8_t value = 0;
-  int num;
   int ret = 0;
+  bool poll = false;
+  struct timespec ts;
+  int asserted[MAX_NUM_FRUS+1] = {0};
+  bool fru_health_known[MAX_NUM_FRUS+1] = {false};
   uint8_t fru_health_last_state[MAX_NUM_FRUS+1] = {0};
-  uint8_t fru_health_kv_state[MAX_NUM_FRUS+1] = {0};
+  uint8_t fru_health_kv_state = 0;
 
   // Initial fru health, default value is good.
-  for (num = 0; num<=MAX_NUM_FRUS; num++){
-      fru_health_last_state[num] = 1;
-      fru_health_kv_state[num] = 1;
+  for (fru = 0; fru <= MAX_NUM_FRUS; fru++) {
+    fru_health_last_state[fru] = FRU_STATUS_GOOD;
   }
 
   // set flag to notice BMC sensord snr_health_monitor is ready
   kv_set("flag_sensord_health", "1", 0, 0);
 
   while (1) {
+    pthread_mutex_lock(&g_health_lock);
+    g_health_changed = false;
     for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
+      asserted[fru] = g_fru_asserted[fru];
+    }
+    pthread_mutex_unlock(&g_health_lock);
 
-      value = 0;
+    poll = false;
+    for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
 
-      snr = get_struct_thresh_sensor(fru);
-      if (snr == NULL) {
-         syslog(LOG_WARNING, "snr_health_monitor: get_struct_thresh_sensor failed, fru %d", fru);
-         exit(-1);
-      }
+      value = (asserted[fru] > 0) ? FRU_STATUS_BAD : FRU_STATUS_GOOD;
 
-      // get current health status from kv_store
-      ret = pal_get_fru_health(fru, &fru_health_kv_state[fru]);
-      if (ret) {
-        // If the FRU is not ready, do not log error about errors in its health reporting
-        if (ret != ERR_SENSOR_NA)
-          syslog(LOG_ERR, " %s - kv get health status failed, fru %d",__func__, fru);
-        continue;
-      }
+      if (!fru_health_known[fru] || fru_health_last_state[fru] != FRU_STATUS_GOOD) {
+        poll = true;
 
-      for (num = 0; num <= MAX_SENSOR_NUM; num++) {
-        value |= snr[num].curr_state;
-      }
+        // get current health status from kv_store
+        ret = pal_get_fru_health(fru, &fru_health_kv_state);
+        if (ret) {
+          // If the FRU is not ready, do not log error about errors in its health reporting
+          if (ret != ERR_SENSOR_NA)
+            syslog(LOG_ERR, " %s - kv get health status failed, fru %d",__func__, fru);
+          continue;
+        }
 
+        if (!fru_health_known[fru]) {
+          // The kv may be left from a previous run, written below unless it agrees
+          fru_health_known[fru] = true;
+          fru_health_last_state[fru] = fru_health_kv_state;
+        } else if (fru_health_kv_state == FRU_STATUS_GOOD) {
+          // If log-util clear the fru, cleaning sensor status (After doing it, sensord will regenerate assert)
+          fru_clear_states(fru);
 #ifdef CONFIG_FBY3_CWC
-      if (fru == FRU_SLOT1 && pal_is_cwc() == PAL_EOK) {
-        value |= get_exp_sensor_state();
-      }
+          if (fru == FRU_SLOT1 && pal_is_cwc() == PAL_EOK) {
+            clear_exp_sensor_state();
+          }
 #endif
-
-      value = (value > 0) ? FRU_STATUS_BAD: FRU_STATUS_GOOD;
-
-      // If log-util clear the fru, cleaning sensor status (After doing it, sensord will regenerate assert)
-      if ( (fru_health_kv_state[fru] != fru_health_last_state[fru]) && (fru_health_kv_state[fru] == 1)) {
-        for (num = 0; num <= MAX_SENSOR_NUM; num++) {
-           snr[num].curr_state = 0;
+          fru_health_last_state[fru] = FRU_STATUS_GOOD;
+          value = FRU_STATUS_GOOD;
         }
-#ifdef CONFIG_FBY3_CWC
-        if (fru == FRU_SLOT1 && pal_is_cwc() == PAL_EOK) {
-          clear_exp_sensor_state();
-        }
-#endif
       }
 
-      // keep last status
-      fru_health_last_state[fru] = value;
-
-      // set value to kv_store
-      pal_set_sensor_health(fru, value);
-
+      // set value to kv_store on changes only
+      if (value != fru_health_last_state[fru]) {
+        pal_set_sensor_health(fru, value);
+        fru_health_last_state[fru] = value;
+        if (value != FRU_STATUS_GOOD)
+          poll = true;
+      }
     } /* for loop for frus */
-    sleep(MIN_POLL_INTERVAL);
+
+    pthread_mutex_lock(&g_health_lock);
+    if (poll) {
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      ts.tv_sec += MIN_POLL_INTERVAL;
+      while (!g_health_changed &&
+          pthread_cond_timedwait(&g_health_cond, &g_health_lock, &ts) != ETIMEDOUT);
+    } else {
+      while (!g_health_changed)
+        pthread_cond_wait(&g_health_cond, &g_health_lock);
+    }
+    pthread_mutex_unlock(&g_health_lock);
   } /* while loop */
+
+  return NULL;
 }
 
 static void *
@@ -810,14 +1329,15 @@ run_sensord(int argc, char **argv) {
   int ret, arg;
   uint8_t fru;
   int fru_flag = 0;
-  pthread_t thread_snr[MAX_SENSORD_FRU];
+  pthread_condattr_t attr;
+  pthread_t thread_sched;
   pthread_t sensor_health;
   pthread_t agg_sensor_mon;
 
   arg = 1;
   while(arg < argc) {
 
-    ret = pal_get_fru_id(argv[arg], &fru);
+    ret = pal_get_fru_id_cached(argv[arg], &fru);
     if (ret < 0) {
 #ifdef CONFIG_FBY3_CWC
       uint8_t expFru = 0;
@@ -836,26 +1356,28 @@ run_sensord(int argc, char **argv) {
   }
 
   ret = pal_sensor_monitor_initial();
+
+  // Signaled by the sensor workers, so ready before they start.
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_health_cond, &attr);
+  pthread_condattr_destroy(&attr);
+
   for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
 
     if (GETBIT(fru_flag, fru)) {
 
-      if (init_fru_snr_thresh(fru) < 0)
-        continue;
-
-      /* Threshold Sensors */
-      if (pthread_create(&thread_snr[fru-1], NULL, snr_monitor,
-          (void*)(uintptr_t)fru) < 0) {
-        syslog(LOG_WARNING, "pthread_create for Threshold Sensors for FRU %d failed\n", fru);
-#ifdef DEBUG
-      } else {
-        syslog(LOG_WARNING, "pthread_create for Threshold Sensors for FRU %d succeed\n", fru);
-#endif /* DEBUG */
-      }
-      sleep(1);
+      if (init_fru_snr_thresh(fru) < 0 || fru_mon_init(fru) < 0)
+        fru_flag = CLEARBIT(fru_flag, fru);
     }
   }
 
+  /* Threshold Sensors */
+  if (snr_monitor_start(fru_flag, &thread_sched) < 0) {
+    syslog(LOG_WARNING, "Starting the sensor monitor failed\n");
+    fru_flag = 0;
+  }
+
   /* Sensor Health */
   if (pthread_create(&sensor_health, NULL, snr_health_monitor, NULL) < 0) {
     syslog(LOG_WARNING, "pthread_create for sensor health failed\n");
@@ -870,11 +1392,8 @@ run_sensord(int argc, char **argv) {
 
   pthread_join(sensor_health, NULL);
 
-  for (fru = 1; fru <= MAX_SENSORD_FRU; fru++) {
-
-    if (GETBIT(fru_flag, fru))
-      pthread_join(thread_snr[fru-1], NULL);
-  }
+  if (fru_flag)
+    pthread_join(thread_sched, NULL);
   return 0;
 }
 
@@ -898,6 +1417,10 @@ main(int argc, char **argv) {
   } else {
 
     syslog(LOG_INFO, "sensord: daemon started");
+    /* A bus going away fails every sensor behind it at once */
+    if (obmc_log_set_async(LOG_RATE, LOG_BURST) != 0) {
+      syslog(LOG_WARNING, "sensord: synchronous logging, errno = %d", errno);
+    }
 
     rc = run_sensord(argc, argv);
     if (rc < 0) {
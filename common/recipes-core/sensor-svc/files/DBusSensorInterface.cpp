@@ -51,6 +51,11 @@ static const char* xml =
 "      <arg type='d' name='value' direction='out'/>"
 "      <arg type='s' name='unit' direction='out'/>"
 "    </method>"
+"    <property type='s' name='name' access='read'/>"
+"    <property type='y' name='id' access='read'/>"
+"    <property type='i' name='readStatus' access='read'/>"
+"    <property type='d' name='value' access='read'/>"
+"    <property type='s' name='unit' access='read'/>"
 "  </interface>"
 "</node>";
 
@@ -62,7 +67,7 @@ DBusSensorInterface::DBusSensorInterface() {
   }
   no_ = 0;
   name_ = info_->interfaces[no_]->name;
-  vtable_ = {methodCallBack, nullptr, nullptr, nullptr};
+  vtable_ = {methodCallBack, getProperty, nullptr, nullptr};
 }
 
 DBusSensorInterface::~DBusSensorInterface() {
@@ -79,11 +84,84 @@ void DBusSensorInterface::sensorRead(GDBusMethodInvocation* invocation,
                                         obj->getValue()));
 }
 
-void DBusSensorInterface::sensorRawRead(GDBusMethodInvocation* invocation,
+GVariant* DBusSensorInterface::newSensorProperty(Sensor*     sensor,
+                                                 const char* property) {
+  if (g_strcmp0(property, "name") == 0) {
+    return g_variant_new_string(sensor->getName().c_str());
+  }
+  else if (g_strcmp0(property, "id") == 0) {
+    return g_variant_new_byte(sensor->getId());
+  }
+  else if (g_strcmp0(property, "readStatus") == 0) {
+    return g_variant_new_int32(sensor->getLastReadStatus());
+  }
+  else if (g_strcmp0(property, "value") == 0) {
+    return g_variant_new_double(sensor->getValue());
+  }
+  else if (g_strcmp0(property, "unit") == 0) {
+    return g_variant_new_string(sensor->getUnit().c_str());
+  }
+  return nullptr;
+}
+
+GVariant* DBusSensorInterface::newSensorProperties(Sensor* sensor) {
+  static const char* properties[] =
+    {"name", "id", "readStatus", "value", "unit"};
+  GVariantBuilder builder;
+
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+  for (const char* property : properties) {
+    g_variant_builder_add(&builder, "{sv}", property,
+                          newSensorProperty(sensor, property));
+  }
+  return g_variant_builder_end(&builder);
+}
+
+void DBusSensorInterface::rawRead(GDBusConnection* connection,
+                                  const char*      objectPath,
+                                  Sensor*          sensor) {
+  ReadResult oldStatus = sensor->getLastReadStatus();
+  float oldValue = sensor->getValue();
+  ReadResult status = sensor->sensorRawRead();
+
+  if (status == oldStatus &&
+      (status != READING_SUCCESS || sensor->getValue() == oldValue)) {
+    return;
+  }
+
+  GVariantBuilder changed;
+  GError* error = nullptr;
+  g_variant_builder_init(&changed, G_VARIANT_TYPE("a{sv}"));
+  g_variant_builder_add(&changed, "{sv}", "readStatus",
+                        newSensorProperty(sensor, "readStatus"));
+  g_variant_builder_add(&changed, "{sv}", "value",
+                        newSensorProperty(sensor, "value"));
+  if (!g_dbus_connection_emit_signal(connection,
+                                     nullptr,
+                                     objectPath,
+                                     "org.freedesktop.DBus.Properties",
+                                     "PropertiesChanged",
+                                     g_variant_new("(sa{sv}as)",
+                                                   "org.openbmc.SensorObject",
+                                                   &changed,
+                                                   nullptr),
+                                     &error)) {
+    LOG(ERROR) << "PropertiesChanged of " << objectPath << " failed: "
+               << error->message;
+    g_error_free(error);
+  }
+}
+
+void DBusSensorInterface::sensorRawRead(GDBusConnection*       connection,
+                                        const char*            objectPath,
+                                        GDBusMethodInvocation* invocation,
                                         gpointer               arg) {
   Sensor* obj = static_cast<Sensor*>(arg);
   LOG(INFO) << "sensorRawRead of " << obj->getName();
-  obj->sensorRawRead();
+  // a polled sensor has a fresh reading, do not wait for the device
+  if (!obj->isPolled()) {
+    rawRead(connection, objectPath, obj);
+  }
   g_dbus_method_invocation_return_value(invocation,
                                         g_variant_new("(id)",
                                         obj->getLastReadStatus(),
@@ -129,7 +207,7 @@ void DBusSensorInterface::methodCallBack(
     sensorRead(invocation, arg);
   }
   else if (g_strcmp0(methodName, "sensorRawRead") == 0) {
-    sensorRawRead(invocation, arg);
+    sensorRawRead(connection, objectPath, invocation, arg);
   }
   else if (g_strcmp0(methodName, "getSensorObject") == 0) {
     getSensorObject(invocation, arg);
@@ -139,5 +217,23 @@ void DBusSensorInterface::methodCallBack(
   }
 }
 
+GVariant* DBusSensorInterface::getProperty(GDBusConnection* connection,
+                                           const char*      sender,
+                                           const char*      objectPath,
+                                           const char*      interfaceName,
+                                           const char*      propertyName,
+                                           GError**         error,
+                                           gpointer         arg) {
+  // arg should be a pointer to Sensor
+  DCHECK(arg != nullptr) << "Empty object passed to callback";
+
+  GVariant* value = newSensorProperty(static_cast<Sensor*>(arg), propertyName);
+  if (value == nullptr) {
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                "Unknown property %s", propertyName);
+  }
+  return value;
+}
+
 } // namespace qin
 } // namespace openbmc
@@ -21,6 +21,7 @@
 
 #pragma once
 #include <dbus-utils/DBusInterfaceBase.h>
+#include "Sensor.h"
 
 namespace openbmc {
 namespace qin {
@@ -54,6 +55,38 @@ class DBusSensorInterface: public DBusInterfaceBase {
                                GDBusMethodInvocation* invocation,
                                gpointer               arg);
 
+    /**
+     * Handles the Get and GetAll calls of org.freedesktop.DBus.Properties
+     * on the sensor: name, id, readStatus, value and unit.
+     */
+    static GVariant* getProperty(GDBusConnection* connection,
+                                 const char*      sender,
+                                 const char*      objectPath,
+                                 const char*      interfaceName,
+                                 const char*      propertyName,
+                                 GError**         error,
+                                 gpointer         arg);
+
+    /**
+     * Returns the floating value of the property of sensor,
+     * nullptr if there is no such property.
+     */
+    static GVariant* newSensorProperty(Sensor* sensor, const char* property);
+
+    /**
+     * Returns the floating a{sv} of all properties of sensor,
+     * as GetAll of org.freedesktop.DBus.Properties.
+     */
+    static GVariant* newSensorProperties(Sensor* sensor);
+
+    /**
+     * Reads the sensor, and emits PropertiesChanged at objectPath
+     * if its value or read status changed.
+     */
+    static void rawRead(GDBusConnection* connection,
+                        const char*      objectPath,
+                        Sensor*          sensor);
+
   private:
     /**
      * Callback for sensorRead method
@@ -73,7 +106,9 @@ class DBusSensorInterface: public DBusInterfaceBase {
      * Callback for sensorRawRead method
      * Invokes rawRead on sensor and returns value and read status
     */
-    static void sensorRawRead(GDBusMethodInvocation* invocation,
+    static void sensorRawRead(GDBusConnection*       connection,
+                              const char*            objectPath,
+                              GDBusMethodInvocation* invocation,
                               gpointer               arg);
 
     /**
@@ -19,6 +19,8 @@
  */
 
 #include <string>
+#include <chrono>
+#include <vector>
 #include <glog/logging.h>
 #include <gio/gio.h>
 #include <nlohmann/json.hpp>
@@ -56,6 +58,10 @@ static const char* xml =
   "    <method name='getSensorObjects'>"
   "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
   "    </method>"
+  "    <method name='getAllReadings'>"
+  "      <arg type='b' name='refresh' direction='in'/>"
+  "      <arg type='a{sa{sv}}' name='readings' direction='out'/>"
+  "    </method>"
   "    <method name='addFRU'>"
   "      <arg type='s' name='fruParentPath' direction='in'/>"
   "      <arg type='s' name='fruJsonString' direction='in'/>"
@@ -134,14 +140,20 @@ void DBusSensorServiceInterface::addSensors(GDBusMethodInvocation* invocation,
     status = FALSE;
   }
   else if (iter != NULL) {
+    std::vector<nlohmann::json> jSensors;
+    auto start = std::chrono::steady_clock::now();
+
     while (g_variant_iter_loop (iter, "&s", &sensorJsonString)) {
       LOG(INFO) << "Sensor :" << sensorJsonString;
 
       //Covert sensorJsonString to nlohmann::json jObject
-      //and add sensor to SensorTree
-      nlohmann::json jObject = nlohmann::json::parse(sensorJsonString);
-      SensorJsonParser::parseSensor(jObject, *sensorTree, frupath);
+      jSensors.push_back(nlohmann::json::parse(sensorJsonString));
     }
+
+    //The sensors are added to SensorTree after the reply, see
+    //SensorObjectTree::addPendingSensors()
+    sensorTree->addPendingSensors(frupath, std::move(jSensors),
+                                  std::chrono::steady_clock::now() - start);
   }
 
   g_variant_iter_free (iter);
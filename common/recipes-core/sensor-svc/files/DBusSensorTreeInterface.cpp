@@ -23,6 +23,7 @@
 #include <glog/logging.h>
 #include <gio/gio.h>
 #include "DBusSensorTreeInterface.h"
+#include "DBusSensorInterface.h"
 #include "FRU.h"
 #include "Sensor.h"
 
@@ -57,6 +58,10 @@ static const char* xml =
   "    <method name='getSensorObjects'>"
   "      <arg type='a(syids)' name='sensorlist' direction='out'/>"
   "    </method>"
+  "    <method name='getAllReadings'>"
+  "      <arg type='b' name='refresh' direction='in'/>"
+  "      <arg type='a{sa{sv}}' name='readings' direction='out'/>"
+  "    </method>"
   "  </interface>"
   "</node>";
 
@@ -361,6 +366,91 @@ void DBusSensorTreeInterface::getSensorObjects(
   g_variant_builder_unref(builder);
 }
 
+/**
+ * Recursively traverses through subtree under Object obj at path and
+ * adds the properties of all sensors to GVariantBuilder* builder,
+ * reading them first if refresh is set. The order is the one of
+ * addSensorObjects.
+ */
+static void addSensorReadings(GVariantBuilder*   builder,
+                              GDBusConnection*   connection,
+                              Object*            obj,
+                              const std::string& path,
+                              bool               refresh) {
+  for (auto &it : obj->getChildMap()) {
+    Sensor* sensor;
+    if ((sensor = dynamic_cast<Sensor*>(it.second)) != nullptr) {
+      std::string sensorPath = path + "/" + it.first;
+      if (refresh && !sensor->isPolled()) {
+        DBusSensorInterface::rawRead(connection, sensorPath.c_str(), sensor);
+      }
+      g_variant_builder_add(builder,
+                            "{s@a{sv}}",
+                            sensorPath.c_str(),
+                            DBusSensorInterface::newSensorProperties(sensor));
+    }
+  }
+
+  for (auto &it : obj->getChildMap()) {
+    if (dynamic_cast<FRU*>(it.second) != nullptr) {
+      //Recursively call on child FRU
+      addSensorReadings(builder, connection, it.second,
+                        path + "/" + it.first, refresh);
+    }
+  }
+}
+
+void DBusSensorTreeInterface::getAllReadings(
+                                           GDBusConnection*       connection,
+                                           GDBusMethodInvocation* invocation,
+                                           GVariant*              parameters,
+                                           gpointer               arg) {
+  Object* obj = static_cast<Object*>(arg);
+  gboolean refresh;
+  g_variant_get(parameters, "(b)", &refresh);
+  LOG(INFO) << "getAllReadings of " << obj->getName();
+
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sa{sv}}"));
+
+  addSensorReadings(&builder, connection, obj,
+                    getPathToCurrentObject(obj), refresh);
+
+  g_dbus_method_invocation_return_value(invocation,
+                                        g_variant_new("(a{sa{sv}})",
+                                                      &builder));
+}
+
+/**
+ * Recursively collects the FRUs of the subtree under Object obj
+ */
+static void getFRUsRec(Object* obj, std::vector<FRU*> &frus) {
+  for (auto &it : obj->getChildMap()) {
+    FRU* fru;
+    if ((fru = dynamic_cast<FRU*>(it.second)) != nullptr) {
+      frus.push_back(fru);
+      getFRUsRec(fru, frus);
+    }
+  }
+}
+
+/**
+ * Builds the sensors still queued under the FRUs of the subtree of
+ * Object obj, before they are looked up
+ */
+static void buildPendingSensors(Object* obj) {
+  std::vector<FRU*> frus;
+  FRU* fru;
+
+  if ((fru = dynamic_cast<FRU*>(obj)) != nullptr) {
+    frus.push_back(fru);
+  }
+  getFRUsRec(obj, frus);
+  for (FRU* it : frus) {
+    it->buildPendingSensors();
+  }
+}
+
 void DBusSensorTreeInterface::methodCallBack(
                           GDBusConnection*       connection,
                           const char*            sender,
@@ -373,6 +463,14 @@ void DBusSensorTreeInterface::methodCallBack(
   // arg should be a pointer to Object in object-tree
   DCHECK(arg != nullptr) << "Empty object passed to callback";
 
+  // Only the lookups of sensors need the sensors built, not those of FRUs
+  if (g_strcmp0(methodName, "getSensorPathByName") == 0 ||
+      g_strcmp0(methodName, "getSensorPathById") == 0 ||
+      g_strcmp0(methodName, "getSensorObjects") == 0 ||
+      g_strcmp0(methodName, "getAllReadings") == 0) {
+    buildPendingSensors(static_cast<Object*>(arg));
+  }
+
   if (g_strcmp0(methodName, "getSensorPathByName") == 0) {
     getSensorPathByName(invocation, parameters, arg);
   }
@@ -391,6 +489,9 @@ void DBusSensorTreeInterface::methodCallBack(
   else if (g_strcmp0(methodName, "getSensorObjects") == 0) {
     getSensorObjects(invocation, arg);
   }
+  else if (g_strcmp0(methodName, "getAllReadings") == 0) {
+    getAllReadings(connection, invocation, parameters, arg);
+  }
 }
 
 } // namespace qin
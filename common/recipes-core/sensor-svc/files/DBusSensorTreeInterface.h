@@ -107,6 +107,17 @@ class DBusSensorTreeInterface: public DBusInterfaceBase {
      */
     static void getSensorObjects(GDBusMethodInvocation* invocation,
                                  gpointer               arg);
+
+    /**
+     * Callback for getAllReadings method
+     * Returns the properties of all sensors under subtree by their paths,
+     * read first if refresh is set (emitting their PropertiesChanged),
+     * except the polled ones
+     */
+    static void getAllReadings(GDBusConnection*       connection,
+                               GDBusMethodInvocation* invocation,
+                               GVariant*              parameters,
+                               gpointer               arg);
 };
 
 } // namespace qin
@@ -20,6 +20,7 @@
 
 #pragma once
 #include <string>
+#include <functional>
 #include <object-tree/Object.h>
 
 namespace openbmc {
@@ -31,6 +32,7 @@ class FRU : public Object {
     uint8_t poweronFlag_ = 0;   // keeps track of time in seconds
                                 // elapsed after FRU power on
                                 // todo: rework on poweronFlag_
+    std::function<void()> pendingBuilder_; // builds the queued sensors
 
   public:
     using Object::Object; // inherit constructor
@@ -66,6 +68,24 @@ class FRU : public Object {
     * Checks if FRU is on
     */
     bool isFruOff();
+
+    /*
+    * Sets what builds the sensors queued under the FRU, see
+    * SensorObjectTree::addPendingSensors(); nullptr once they are built
+    */
+    void setPendingBuilder(std::function<void()> builder) {
+      pendingBuilder_ = std::move(builder);
+    }
+
+    /*
+    * Builds the sensors queued under the FRU, if any
+    */
+    void buildPendingSensors() {
+      if (pendingBuilder_) {
+        std::function<void()> builder = pendingBuilder_;
+        builder();
+      }
+    }
 };
 
 } // namespace qin
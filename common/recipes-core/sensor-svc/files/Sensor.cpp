@@ -53,6 +53,7 @@ uint8_t Sensor::getId(){
 }
 
 float Sensor::getValue() {
+  std::lock_guard<std::mutex> lock(valueMutex_);
   return value_;
 }
 
@@ -61,12 +62,15 @@ std::string Sensor::getUnit() {
 }
 
 ReadResult Sensor::getLastReadStatus() {
-  return sensorAccess_->getLastReadResult();
+  std::lock_guard<std::mutex> lock(valueMutex_);
+  return lastReadStatus_;
 }
 
 ReadResult Sensor::sensorRawRead(){
   float val;
   ReadResult readResult = sensorAccess_->sensorRawRead(this, &val);
+  std::lock_guard<std::mutex> lock(valueMutex_);
+  lastReadStatus_ = readResult;
   if (readResult == READING_SUCCESS){
     value_ = val;
   }
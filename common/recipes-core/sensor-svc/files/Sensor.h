@@ -23,6 +23,8 @@
 #include <cstdint>
 #include <stdlib.h>
 #include <stdio.h>
+#include <chrono>
+#include <mutex>
 #include <object-tree/Object.h>
 #include "SensorAccessMechanism.h"
 #include "FRU.h"
@@ -33,10 +35,14 @@ namespace qin {
 class Sensor : public Object{
   private:
     uint8_t id_ = 0xFF;                           // Sensor Id
-    float value_;                                 // Last Read Sensor Value
+    float value_ = 0;                             // Last Read Sensor Value
     std::string unit_;                            // Unit of Sensor
     std::unique_ptr<SensorAccessMechanism> sensorAccess_;
                                                   // sensorAccess mechanism
+    ReadResult lastReadStatus_ = READING_NA;      // status of value_
+    std::chrono::milliseconds pollInterval_{0};   // 0 if read on demand
+    mutable std::mutex valueMutex_;               // value_, lastReadStatus_
+                                                  // (poller vs dbus thread)
 
   public:
     /*
@@ -84,6 +90,28 @@ class Sensor : public Object{
      * sensorRaw
      */
     ReadResult sensorRawRead();
+
+    /*
+     * Returns the interval the SensorPoller reads the sensor at,
+     * 0 if it is read on demand
+     */
+    std::chrono::milliseconds getPollInterval() const {
+      return pollInterval_;
+    }
+
+    /*
+     * Sets the poll interval, see SensorObjectTree::setSensorPollInterval
+     */
+    void setPollInterval(std::chrono::milliseconds pollInterval) {
+      pollInterval_ = pollInterval;
+    }
+
+    /*
+     * Checks if the sensor is read in background by the SensorPoller
+     */
+    bool isPolled() const {
+      return pollInterval_.count() > 0;
+    }
 };
 
 } // namespace qin
@@ -32,5 +32,69 @@ void SensorAccessMechanism::rawRead(Sensor* s, float *value){
   readResult_ = READING_NA;
 }
 
+ReadResult SensorAccessMechanism::sensorRawRead(Sensor* s, float *value) {
+  std::unique_lock<std::mutex> lock(cacheMutex_);
+  if (cacheTtl_.count() == 0) {
+    lock.unlock();
+    return hardwareRead(s, value);
+  }
+
+  // share the read in flight
+  cacheCond_.wait(lock, [this] { return !readInFlight_; });
+  if (cacheValid_ &&
+      std::chrono::steady_clock::now() - cachedAt_ < cacheTtl_) {
+    *value = cachedValue_;
+    return readResult_;
+  }
+
+  readInFlight_ = true;
+  lock.unlock();
+  float val = 0;
+  ReadResult readResult = hardwareRead(s, &val);
+  lock.lock();
+
+  *value = cachedValue_ = val;
+  cachedAt_ = std::chrono::steady_clock::now();
+  cacheValid_ = true;
+  readInFlight_ = false;
+  cacheCond_.notify_all();
+  return readResult;
+}
+
+ReadResult SensorAccessMechanism::hardwareRead(Sensor* s, float *value) {
+  if (checkAccessConditions(s) == false) {
+    readResult_ = READING_NA;
+    return readResult_;
+  }
+
+  if (preRawRead(s, value)){
+    rawRead(s, value);
+  }
+  else {
+    readResult_ = READING_NA;
+  }
+
+  postRawRead(s, value);
+
+  if (readResult_ == READING_NA) {
+    *value = 0;
+  }
+
+  //Max retry logic
+  if (maxNofRetry_ > 0) {
+    if (readResult_ == READING_SUCCESS) {
+      maxNofRetry_ = 0;
+    }
+    else if (maxNofRetry_ > maxNofRetry_){
+      maxNofRetry_++;
+    }
+    else {
+      readResult_ =  READING_SKIP;
+    }
+  }
+
+  return readResult_;
+}
+
 } // namespace qin
 } // namespace openbmc
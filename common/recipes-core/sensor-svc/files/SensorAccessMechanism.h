@@ -20,6 +20,9 @@
 
 #pragma once
 #include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 namespace openbmc {
 namespace qin {
@@ -58,41 +61,12 @@ public:
     this->accessCondition_ = accessCondition;
   }
 
-  ReadResult sensorRawRead(Sensor* s, float *value) {
-
-    if (checkAccessConditions(s) == false) {
-      readResult_ = READING_NA;
-      return readResult_;
-    }
-
-    if (preRawRead(s, value)){
-      rawRead(s, value);
-    }
-    else {
-      readResult_ = READING_NA;
-    }
-
-    postRawRead(s, value);
-
-    if (readResult_ == READING_NA) {
-      *value = 0;
-    }
-
-    //Max retry logic
-    if (maxNofRetry_ > 0) {
-      if (readResult_ == READING_SUCCESS) {
-        maxNofRetry_ = 0;
-      }
-      else if (maxNofRetry_ > maxNofRetry_){
-        maxNofRetry_++;
-      }
-      else {
-        readResult_ =  READING_SKIP;
-      }
-    }
-
-    return readResult_;
-  }
+  /*
+   * Reads the sensor. With a cache TTL set, a reading younger than the TTL
+   * is returned instead, and readers arriving while the hardware is being
+   * read wait for that read rather than issuing their own.
+   */
+  ReadResult sensorRawRead(Sensor* s, float *value);
 
   ReadResult getLastReadResult() {
     return readResult_;
@@ -101,6 +75,26 @@ public:
   void setmaxNofRetry (uint8_t maxNofRetry) {
     this->maxNofRetry_ = maxNofRetry;
   }
+
+  /*
+   * Sets how long a reading is reused, 0 (default) to always read
+   */
+  void setCacheTtl(std::chrono::milliseconds cacheTtl) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    this->cacheTtl_ = cacheTtl;
+    this->cacheValid_ = false;
+  }
+
+private:
+  std::chrono::milliseconds cacheTtl_{0};
+  std::chrono::steady_clock::time_point cachedAt_;
+  float cachedValue_ = 0;
+  bool cacheValid_ = false;
+  bool readInFlight_ = false;
+  std::mutex cacheMutex_;
+  std::condition_variable cacheCond_;
+
+  ReadResult hardwareRead(Sensor* s, float *value);
 };
 
 } // namespace qin
@@ -191,11 +191,26 @@ void SensorJsonParser::parseSensor(const nlohmann::json &jObject,
       throw std::invalid_argument("Invalid sensor api");
     }
 
-    object = sensorTree.addSensor(name,
-                                  parentPath,
-                                  id,
-                                  unit,
-                                  std::move(upSensorAccess));
+    if (access.find("cacheTtlMs") != access.end()) {
+      // Reuse a reading for cacheTtlMs instead of reading the device again
+      const std::string &cacheTtl = access.at("cacheTtlMs");
+      upSensorAccess->setCacheTtl(
+          std::chrono::milliseconds(std::stoi(cacheTtl, nullptr, 0)));
+    }
+
+    Sensor* sensor = sensorTree.addSensor(name,
+                                          parentPath,
+                                          id,
+                                          unit,
+                                          std::move(upSensorAccess));
+    object = sensor;
+
+    if (sensor != nullptr && jObject.find("pollIntervalMs") != jObject.end()) {
+      // Read in background every pollIntervalMs
+      const std::string &pollInterval = jObject.at("pollIntervalMs");
+      sensorTree.setSensorPollInterval(sensor,
+          std::chrono::milliseconds(std::stoi(pollInterval, nullptr, 0)));
+    }
   }
 
   if (object == nullptr) {
@@ -23,6 +23,7 @@
 #include "DBusSensorInterface.h"
 #include "DBusSensorServiceInterface.h"
 #include "DBusSensorTreeInterface.h"
+#include "SensorJsonParser.h"
 #include "SensorObjectTree.h"
 
 namespace openbmc {
@@ -119,5 +120,124 @@ Sensor* SensorObjectTree::addSensor(const std::string &name,
   }
 }
 
+void SensorObjectTree::setSensorPollInterval(
+                                      Sensor*                   sensor,
+                                      std::chrono::milliseconds pollInterval) {
+  if (poller_ == nullptr) {
+    LOG(WARNING) << "No poller, sensor " << sensor->getName()
+                 << " is read on demand";
+    return;
+  }
+  poller_->removeSensor(sensor);
+  sensor->setPollInterval(pollInterval);
+  if (sensor->isPolled()) {
+    poller_->addSensor(sensor);
+  }
+}
+
+void SensorObjectTree::addPendingSensors(
+                              const std::string                   &fruPath,
+                              std::vector<nlohmann::json>         jSensors,
+                              std::chrono::steady_clock::duration parseTime) {
+  FRU* fru = getFRU(fruPath);
+  if (fru == nullptr) {
+    LOG(ERROR) << "FRU " << fruPath << " does not exist";
+    throw std::invalid_argument("Path not found");
+  }
+
+  auto result = pending_.insert(std::make_pair(fruPath, PendingSensors()));
+  PendingSensors &pending = result.first->second;
+  if (result.second) {
+    pending.queued = std::chrono::steady_clock::now();
+  }
+  pending.parseTime += parseTime;
+  for (auto &jSensor : jSensors) {
+    pending.jSensors.push_back(std::move(jSensor));
+  }
+  LOG(INFO) << "Queued " << pending.jSensors.size() << " sensors under "
+            << fruPath;
+
+  fru->setPendingBuilder([this, fruPath]() {
+    buildPendingSensors(fruPath);
+  });
+  if (pendingSource_ == 0) {
+    pendingSource_ = g_idle_add(buildPendingIdle, this);
+  }
+}
+
+void SensorObjectTree::buildPendingSensors(const std::string &fruPath) {
+  auto it = pending_.find(fruPath);
+  if (it != pending_.end()) {
+    buildPendingSensors(it, it->second.jSensors.size());
+  }
+}
+
+void SensorObjectTree::buildPendingSensors(
+                          std::map<std::string, PendingSensors>::iterator it,
+                          size_t max) {
+  const std::string fruPath = it->first;
+  PendingSensors &pending = it->second;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < max && !pending.jSensors.empty(); i++) {
+    nlohmann::json jSensor = std::move(pending.jSensors.front());
+    pending.jSensors.pop_front();
+    try {
+      SensorJsonParser::parseSensor(jSensor, *this, fruPath);
+      pending.built++;
+    } catch (const std::exception &e) {
+      LOG(ERROR) << "Sensor under " << fruPath << " not added: " << e.what();
+    }
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  pending.buildTime += now - start;
+  if (!pending.jSensors.empty()) {
+    return;
+  }
+
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  LOG(INFO) << "FRU " << fruPath << ": " << pending.built << " sensors, "
+            << "parsed in "
+            << duration_cast<milliseconds>(pending.parseTime).count()
+            << " ms, built in "
+            << duration_cast<milliseconds>(pending.buildTime).count()
+            << " ms, ready "
+            << duration_cast<milliseconds>(now - pending.queued).count()
+            << " ms after being queued";
+  pending_.erase(it);
+
+  FRU* fru = dynamic_cast<FRU*>(getObject(fruPath));
+  if (fru != nullptr) {
+    fru->setPendingBuilder(nullptr);
+  }
+}
+
+gboolean SensorObjectTree::buildPendingIdle(gpointer arg) {
+  SensorObjectTree* tree = static_cast<SensorObjectTree*>(arg);
+
+  if (!tree->pending_.empty()) {
+    tree->buildPendingSensors(tree->pending_.begin(), kPendingBatch);
+  }
+  if (tree->pending_.empty()) {
+    tree->pendingSource_ = 0;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void SensorObjectTree::deleteObjectByPath(const std::string &path) {
+  Object* object = getObject(path);
+  Sensor* sensor = dynamic_cast<Sensor*>(object);
+  if (sensor != nullptr && poller_ != nullptr) {
+    poller_->removeSensor(sensor);
+  }
+  if (dynamic_cast<FRU*>(object) != nullptr) {
+    pending_.erase(path);
+  }
+  ObjectTree::deleteObjectByPath(path);
+}
+
 } // namespace qin
 } // namespace openbmc
@@ -21,12 +21,18 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <vector>
+#include <nlohmann/json.hpp>
 #include <ipc-interface/Ipc.h>
 #include <object-tree/ObjectTree.h>
 #include <object-tree/Object.h>
 #include "FRU.h"
 #include "Sensor.h"
 #include "SensorService.h"
+#include "SensorPoller.h"
 #include <dbus-utils/DBusInterfaceBase.h>
 #include <dbus-utils/DBus.h>
 #include <cstdint>
@@ -44,6 +50,12 @@ class SensorObjectTree : public ObjectTree {
     // prevent compiler from mistaking addObject defined in base and derived
     using ObjectTree::addObject;
 
+    ~SensorObjectTree() {
+      if (pendingSource_ != 0) {
+        g_source_remove(pendingSource_);
+      }
+    }
+
     /**
      * Get the FRU with specified path.
      */
@@ -100,7 +112,71 @@ class SensorObjectTree : public ObjectTree {
                        const std::string &unit,
                        std::unique_ptr<SensorAccessMechanism> upSensorAccess);
 
+     /**
+      * Set the poller of the polled sensors, nullptr to read all sensors
+      * on demand. Sensors are added to the poller as their poll interval
+      * is set.
+      */
+     void setPoller(SensorPoller* poller) {
+       poller_ = poller;
+     }
+
+     /**
+      * Set the interval sensor is read at in background, 0 to read it on
+      * demand again.
+      */
+     void setSensorPollInterval(Sensor*                   sensor,
+                                std::chrono::milliseconds pollInterval);
+
+     /**
+      * Queue the Sensor declarations of jSensors under the FRU at fruPath
+      * instead of building them right away. They are built from the event
+      * loop in the background, or when the sensors of the FRU are first
+      * looked up (see FRU::buildPendingSensors()). parseTime is how long
+      * the declarations took to parse, for the log.
+      */
+     void addPendingSensors(const std::string                &fruPath,
+                            std::vector<nlohmann::json>      jSensors,
+                            std::chrono::steady_clock::duration parseTime);
+
+     /**
+      * Build all the pending sensors of the FRU at fruPath.
+      */
+     void buildPendingSensors(const std::string &fruPath);
+
+     /**
+      * Delete the object at path, it stops being polled if it is a Sensor.
+      */
+     void deleteObjectByPath(const std::string &path) override;
+
   private:
+    // Sensors queued under a FRU, and the timing of their FRU for the log
+    struct PendingSensors {
+      std::deque<nlohmann::json> jSensors;
+      size_t built = 0;
+      std::chrono::steady_clock::time_point queued;
+      std::chrono::steady_clock::duration parseTime{0};
+      std::chrono::steady_clock::duration buildTime{0};
+    };
+
+    // Sensors built per event loop iteration in the background
+    static constexpr size_t kPendingBatch = 8;
+
+    SensorPoller* poller_ = nullptr;  // reads the polled sensors
+    std::map<std::string, PendingSensors> pending_; // by FRU path
+    guint pendingSource_ = 0;         // idle source building pending_
+
+    /**
+     * Build up to max sensors of the FRU of it, and log its timing once
+     * they are all built, which erases it.
+     */
+    void buildPendingSensors(std::map<std::string, PendingSensors>::iterator it,
+                             size_t max);
+
+    /**
+     * Idle callback building the pending sensors kPendingBatch at a time.
+     */
+    static gboolean buildPendingIdle(gpointer arg);
 
     /**
      * Get the FRU from object.
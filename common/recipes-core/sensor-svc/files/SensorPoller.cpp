@@ -0,0 +1,123 @@
+/*
+ * SensorPoller.cpp
+ *
+ * Copyright 2017-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <glog/logging.h>
+#include "SensorPoller.h"
+
+namespace openbmc {
+namespace qin {
+
+void SensorPoller::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!workers_.empty()) {
+    return;
+  }
+  LOG(INFO) << "Starting " << numWorkers_ << " sensor poller threads";
+  stopping_ = false;
+  for (unsigned int i = 0; i < numWorkers_; i++) {
+    workers_.push_back(std::thread(&SensorPoller::worker, this));
+  }
+}
+
+void SensorPoller::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cond_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+}
+
+void SensorPoller::addSensor(Sensor* sensor) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.find(sensor) != entries_.end()) {
+    return;
+  }
+  LOG(INFO) << "Polling sensor " << sensor->getName() << " every "
+            << sensor->getPollInterval().count() << " ms";
+  Entry &entry = entries_[sensor];
+  entry.slot = schedule_.insert(std::make_pair(Clock::now(), sensor));
+  cond_.notify_all();
+}
+
+void SensorPoller::removeSensor(Sensor* sensor) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(sensor);
+  if (it == entries_.end()) {
+    return;
+  }
+  if (!it->second.busy) {
+    schedule_.erase(it->second.slot);
+    entries_.erase(it);
+    return;
+  }
+  // the worker reading it erases the entry
+  it->second.removed = true;
+  cond_.wait(lock, [this, sensor] {
+    return entries_.find(sensor) == entries_.end();
+  });
+}
+
+void SensorPoller::worker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (schedule_.empty()) {
+      cond_.wait(lock);
+      continue;
+    }
+    Schedule::iterator next = schedule_.begin();
+    if (next->first > Clock::now()) {
+      cond_.wait_until(lock, next->first);
+      continue;
+    }
+
+    Sensor* sensor = next->second;
+    Clock::time_point due = next->first;
+    schedule_.erase(next);
+    entries_[sensor].busy = true;
+
+    lock.unlock();
+    readFunc_(sensor);
+    lock.lock();
+
+    Entry &entry = entries_[sensor];
+    entry.busy = false;
+    if (entry.removed) {
+      entries_.erase(sensor);
+      cond_.notify_all();
+      continue;
+    }
+    // keep the period, but do not catch up reads missed by a slow device
+    Clock::time_point now = Clock::now();
+    due += sensor->getPollInterval();
+    if (due < now) {
+      due = now + sensor->getPollInterval();
+    }
+    entry.slot = schedule_.insert(std::make_pair(due, sensor));
+    // another worker may be waiting for a later read
+    cond_.notify_all();
+  }
+}
+
+} // namespace qin
+} // namespace openbmc
@@ -0,0 +1,102 @@
+/*
+ * SensorPoller.h: reads the polled sensors in background threads
+ *
+ * Copyright 2017-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Sensor.h"
+
+namespace openbmc {
+namespace qin {
+
+/**
+ * Worker threads reading every added sensor at its poll interval, so that
+ * slow devices are not read in the dbus event loop. A sensor is read by
+ * one worker at a time.
+ */
+class SensorPoller {
+  public:
+    typedef std::chrono::steady_clock Clock;
+    // Reads the sensor and publishes the reading
+    typedef std::function<void(Sensor*)> ReadFunc;
+
+    /*
+     * Constructor, readFunc is called from the worker threads
+     */
+    SensorPoller(unsigned int numWorkers, ReadFunc readFunc)
+      : numWorkers_(numWorkers), readFunc_(readFunc) {}
+
+    SensorPoller(const SensorPoller &) = delete;
+    SensorPoller& operator=(const SensorPoller &) = delete;
+
+    ~SensorPoller() {
+      stop();
+    }
+
+    /*
+     * Starts the worker threads
+     */
+    void start();
+
+    /*
+     * Stops and joins the worker threads, after their reads in progress
+     */
+    void stop();
+
+    /*
+     * Polls sensor at its poll interval, first right away
+     */
+    void addSensor(Sensor* sensor);
+
+    /*
+     * Stops polling sensor. Waits for its read in progress, so that the
+     * sensor can be deleted on return.
+     */
+    void removeSensor(Sensor* sensor);
+
+  private:
+    typedef std::multimap<Clock::time_point, Sensor*> Schedule;
+
+    struct Entry {
+      Schedule::iterator slot;  // in schedule_, unless busy
+      bool busy = false;        // being read by a worker
+      bool removed = false;     // removeSensor() waiting for the read
+    };
+
+    unsigned int numWorkers_;
+    ReadFunc readFunc_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    Schedule schedule_;                          // next read of sensors
+    std::unordered_map<Sensor*, Entry> entries_; // all polled sensors
+    bool stopping_ = false;
+
+    void worker();
+};
+
+} // namespace qin
+} // namespace openbmc
@@ -18,6 +18,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <chrono>
 #include <cstdio>
 #include <fstream>
 #include <memory>
@@ -30,8 +31,12 @@
 #include <dbus-utils/dbus-interface/DBusObjectInterface.h>
 #include "SensorObjectTree.h"
 #include "SensorJsonParser.h"
+#include "SensorPoller.h"
+#include "DBusSensorInterface.h"
 using namespace openbmc::qin;
 
+DEFINE_int32(poll_threads, 2, "Threads reading the polled sensors");
+
 // implementation for handling DBus request messages
 static DBusObjectInterface objectInterface;
 
@@ -51,6 +56,7 @@ void sensordSvcdOnDbusNameLost() {
 int main (int argc, char* argv[]) {
   ::google::InitGoogleLogging(argv[0]);
   ::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  auto start = std::chrono::steady_clock::now();
 
   const std::string dbusName = "org.openbmc.SensorService";
   LOG(INFO) << "Registering for DBus name \""<< dbusName <<"\" with interface "
@@ -76,12 +82,31 @@ int main (int argc, char* argv[]) {
   LOG(INFO) << "Creating sensor tree";
   SensorObjectTree sensorTree(sDbus, "org");
 
+  // Polled sensors are read off the event loop, and their changes
+  // published as PropertiesChanged
+  GDBusConnection* connection = dbus.getConnection();
+  SensorPoller poller(FLAGS_poll_threads, [connection](Sensor* sensor) {
+    DBusSensorInterface::rawRead(connection,
+                                 sensor->getObjectPath().c_str(),
+                                 sensor);
+  });
+  sensorTree.setPoller(&poller);
+  poller.start();
+
   sensorTree.addObject("openbmc","/org");
   sensorTree.addSensorService("SensorService", "/org/openbmc");
+  // Sensors added later are built in the background, each FRU logging
+  // its own timing
+  LOG(INFO) << "Sensor service published in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start).count()
+            << " ms";
 
   LOG(INFO) << "Main thread joining the event loop thread";
   t.join();
 
+  poller.stop();
+
   LOG(INFO) << "Quitting the event loop";
   g_main_loop_quit(loop);
   g_main_loop_unref(loop);
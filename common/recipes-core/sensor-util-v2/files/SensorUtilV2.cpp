@@ -50,9 +50,12 @@ static void checkDBusErrorAndExit(GError* error) {
 //Helper function to get DBus Proxy
 static GDBusProxy* getDBusProxy(const char* path, const char* interface) {
   GError* error = nullptr;
+  // Only methods are called, do not fetch properties nor watch signals
   GDBusProxy* proxy = g_dbus_proxy_new_for_bus_sync(
                       G_BUS_TYPE_SYSTEM,
-                      G_DBUS_PROXY_FLAGS_NONE,
+                      (GDBusProxyFlags)
+                      (G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS),
                       nullptr,
                       SENSOR_SVC_DBUS_NAME,
                       path,
@@ -150,30 +153,91 @@ static int parseSensorNumber(const char* strValue) {
   return sensorNum;
 }
 
+/*
+ * Print a sensor line
+ */
+static void printSensorLine(const gchar* name, guchar id, gint ret,
+                            gdouble sensorValue, const gchar* unit) {
+  cout << std::left;
+  cout << std::setw(45) << name;
+  cout << "0x" << std::hex << std::setw(5) << (int)id << std::dec;
+  if (ret != 0){
+    cout << "NA" << std::endl;
+  }
+  else {
+    cout << std::fixed << std::setprecision(2) << std::setw(10) << sensorValue;
+    cout << unit << std::endl;
+  }
+}
+
 /*
  * Print Sensor Object
  */
 static void printSensorObject(GVariant* sensorObject) {
   const gchar* name;
-  gchar id;
+  guchar id;
   gint ret;
   gdouble sensorValue;
   const gchar* unit;
 
   //decode sensor object
-  g_variant_get(sensorObject, "(syids)", &name, &id, &ret ,&sensorValue, &unit);
+  g_variant_get(sensorObject, "(&syid&s)", &name, &id, &ret, &sensorValue,
+                &unit);
+  printSensorLine(name, id, ret, sensorValue, unit);
+}
 
-  //print SensorObject
-  cout << std::left;
-  cout << std::setw(45) << name;
-  cout << "0x" << std::hex << std::setw(5) << (int)id << std::dec;
-  if (ret != 0){
-    cout << "NA" << std::endl;
+/*
+ * Print the sensor properties (a{sv}) as returned by getAllReadings
+ */
+static void printSensorReading(GVariant* properties) {
+  const gchar* name = "";
+  guchar id = 0xFF;
+  gint ret = -1;
+  gdouble sensorValue = 0;
+  const gchar* unit = "";
+
+  g_variant_lookup(properties, "name", "&s", &name);
+  g_variant_lookup(properties, "id", "y", &id);
+  g_variant_lookup(properties, "readStatus", "i", &ret);
+  g_variant_lookup(properties, "value", "d", &sensorValue);
+  g_variant_lookup(properties, "unit", "&s", &unit);
+  printSensorLine(name, id, ret, sensorValue, unit);
+}
+
+/*
+ * Print all sensors under the FRU of proxy with a single getAllReadings
+ * call. Returns false if sensor-svc does not support it.
+ */
+static bool printAllReadings(GDBusProxy* proxy) {
+  GError* error = nullptr;
+  GVariantIter* iter = nullptr;
+  const gchar* sensorPath;
+  GVariant* properties;
+
+  GVariant* response = g_dbus_proxy_call_sync(
+      proxy,
+      "getAllReadings",
+      g_variant_new("(b)", FALSE),
+      G_DBUS_CALL_FLAGS_NONE,
+      -1,
+      nullptr,
+      &error);
+
+  if (error != nullptr &&
+      g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD)) {
+    g_error_free(error);
+    return false;
   }
-  else {
-    cout << std::fixed << std::setprecision(2) << std::setw(10) << sensorValue;
-    cout << unit << std::endl;
+  checkDBusErrorAndExit(error);
+
+  g_variant_get(response, "(a{sa{sv}})", &iter);
+  while (g_variant_iter_next(iter, "{&s@a{sv}}", &sensorPath, &properties)) {
+    printSensorReading(properties);
+    g_variant_unref(properties);
   }
+  g_variant_iter_free(iter);
+  g_variant_unref(response);
+  return true;
 }
 
 /*
@@ -275,8 +339,11 @@ int main(int argc, char const* argv[]) {
 
   checkDBusErrorAndExit(error);
 
-  if (sensorNum == -1){
-    // Sensor number not given by user, print all sensors under fru
+  if (sensorNum == -1 && printAllReadings(proxy)) {
+    // Sensor number not given by user, all sensors under fru printed
+  }
+  else if (sensorNum == -1){
+    // Older sensor-svc without getAllReadings
     // Get all sensor objects under given fru
     GVariant* response;
     const gchar* sensorPath;
@@ -106,6 +106,12 @@ const char *sensor_status[] = {
     STATUS_UNR
 };
 
+/* --perf, --perf-clear */
+enum {
+  PERF_SHOW = 1,
+  PERF_CLEAR,
+};
+
 static void
 print_usage() {
   const char *fru_list = pal_fru_list;
@@ -124,6 +130,8 @@ print_usage() {
   printf("         --history <period>[m/h/d] show max, min and average values of last <period> minutes/hours/days\n");
   printf("              example --history 4d means history of 4 days\n");
   printf("         --history-clear           clear history values\n");
+  printf("         --perf                    show read latency of the sensors (by sensord), slowest total first\n");
+  printf("         --perf-clear              clear read latency statistics\n");
   printf("         --force                   read the sensor directly from the h/w (not cache).Ensure sensord is killed before executing this command\n");
   printf("         --json                    JSON representation\n");
   printf("         --filter <sensor name with slot name>  filtered by <sensor name with slot name> for fscd usage.\n");
@@ -185,7 +193,7 @@ get_fru_name(uint8_t fru, char *name)
   if (fru == AGGREGATE_SENSOR_FRU_ID) {
     strcpy(name, "aggregate");
   } else {
-    ret = pal_get_fru_name(fru, name);
+    ret = pal_get_fru_name_cached(fru, name);
   }
   return ret;
 }
@@ -415,6 +423,7 @@ get_sensor_reading(void *sensor_data) {
   bool filter = sensor_info->filter;
   char filter_sensor_name[64] = {0};
   json_t *fru_sensor_obj = sensor_info->fru_sensor_obj;
+  sensor_cache_entry_t *cached = NULL;
 
   pthread_detach(pthread_self());
   //Allow this thread to be killed at any time
@@ -424,6 +433,18 @@ get_sensor_reading(void *sensor_data) {
     alter_to_fsc_style_sensor_name(sensor_info->filter_list[i]);
   }
 
+  /* Read all the cached values of the FRU at once. */
+  if (!sensor_info->force && sensor_info->sensor_num == SENSOR_ALL &&
+      sensor_info->sensor_cnt > 0) {
+    cached = (sensor_cache_entry_t *)calloc(sensor_info->sensor_cnt, sizeof(*cached));
+    if (cached != NULL) {
+      for (i = 0; i < sensor_info->sensor_cnt; i++) {
+        cached[i].sensor_num = sensor_info->sensor_list[i];
+      }
+      sensor_cache_read_fru(sensor_info->fru, cached, sensor_info->sensor_cnt);
+    }
+  }
+
   for (i = 0; i < sensor_info->sensor_cnt; i++) {
     snr_num = sensor_info->sensor_list[i];
     /* If calculation is for a single sensor, ignore all others. */
@@ -442,6 +463,7 @@ get_sensor_reading(void *sensor_data) {
       if (ret == ERR_SENSOR_NA) {
         get_fru_name(sensor_info->fru, fruname);
         printf("%s SDR is missing!\n", fruname);
+        free(cached);
 
         //modify the flag to true if we get the sensor reading
         done_flag = true;
@@ -476,6 +498,9 @@ get_sensor_reading(void *sensor_data) {
     if ((false == pal_sensor_is_cached(sensor_info->fru, snr_num)) || (true == sensor_info->force)) {
       usleep(50);
       ret = sensor_raw_read(sensor_info->fru, snr_num, &fvalue);
+    } else if (cached != NULL) {
+      ret = cached[i].ret;
+      fvalue = cached[i].value;
     } else {
       ret = sensor_cache_read(sensor_info->fru, snr_num, &fvalue);
     }
@@ -525,6 +550,8 @@ get_sensor_reading(void *sensor_data) {
     }
   }
 
+  free(cached);
+
   //if the mutex is already locked, the calling thread shall block until the mutex becomes available
   //wait for the mutex is released and then get the sensor reading
   pthread_mutex_lock(&timer);
@@ -603,6 +630,77 @@ static void clear_sensor_history(uint8_t fru, uint8_t *sensor_list, int sensor_c
   }
 }
 
+/* Upper bound (us) of the latency of the q-quantile of the reads. */
+static uint32_t
+perf_quantile_us(const sensor_perf_t *perf, double q) {
+  uint64_t rank = (uint64_t)(q * (perf->reads - 1)), seen = 0;
+  uint64_t bound;
+  int b;
+
+  for (b = 0; b < SENSOR_PERF_BUCKETS - 1; b++) {
+    seen += perf->hist[b];
+    if (seen > rank) {
+      break;
+    }
+  }
+  bound = SENSOR_PERF_MIN_US << b;
+  if (b == SENSOR_PERF_BUCKETS - 1 || bound > perf->max_us) {
+    return perf->max_us;
+  }
+  return bound;
+}
+
+typedef struct {
+  uint8_t snr_num;
+  sensor_perf_t perf;
+} snr_perf_t;
+
+static int
+perf_cmp(const void *a, const void *b) {
+  uint64_t x = ((const snr_perf_t *)a)->perf.total_us;
+  uint64_t y = ((const snr_perf_t *)b)->perf.total_us;
+
+  return (x < y) - (x > y);
+}
+
+static void
+get_sensor_perf(uint8_t fru, uint8_t *sensor_list, int sensor_cnt, int num, bool clear) {
+  snr_perf_t perfs[MAX_SENSOR_NUM + 1];
+  uint64_t total_us = 0;
+  thresh_sensor_t thresh;
+  int i, cnt = 0;
+
+  for (i = 0; i < sensor_cnt && cnt <= MAX_SENSOR_NUM; i++) {
+    uint8_t snr_num = sensor_list[i];
+    if (num != SENSOR_ALL && snr_num != num) {
+      continue;
+    }
+    if (clear) {
+      sensor_clear_perf(fru, snr_num);
+    } else if (sensor_read_perf(fru, snr_num, &perfs[cnt].perf) == 0) {
+      perfs[cnt].snr_num = snr_num;
+      total_us += perfs[cnt++].perf.total_us;
+    }
+  }
+  qsort(perfs, cnt, sizeof(perfs[0]), perf_cmp);
+
+  for (i = 0; i < cnt; i++) {
+    sensor_perf_t *p = &perfs[i].perf;
+    uint8_t snr_num = perfs[i].snr_num;
+
+    if ((fru == AGGREGATE_SENSOR_FRU_ID ? aggregate_sensor_threshold(snr_num, &thresh) :
+         sdr_get_snr_thresh(fru, snr_num, &thresh)) < 0) {
+      strcpy(thresh.name, "NA");
+    }
+    printf("%-18s (0x%X) reads = %u, failed = %u, slow = %u, avg = %.2f ms, "
+        "p50 <= %.2f ms, p99 <= %.2f ms, max = %.2f ms, time = %.1f%%\n",
+        thresh.name, snr_num, p->reads, p->failures, p->slow,
+        p->total_us / 1000.0 / p->reads, perf_quantile_us(p, 0.50) / 1000.0,
+        perf_quantile_us(p, 0.99) / 1000.0, p->max_us / 1000.0,
+        total_us ? 100.0 * p->total_us / total_us : 0.0);
+  }
+}
+
 void get_sensor_reading_timer(struct timespec *timeout, get_sensor_reading_struct *sensor_data)
 {
   struct timespec abs_time;
@@ -683,7 +781,7 @@ void get_sensor_reading_timer(struct timespec *timeout, get_sensor_reading_struc
 }
 
 static int
-print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool threshold, bool force, bool json, bool history_clear, bool filter, char** filter_list, int filter_len,long period, json_t *fru_sensor_obj) {
+print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool threshold, bool force, bool json, bool history_clear, bool filter, char** filter_list, int filter_len,long period, json_t *fru_sensor_obj, int perf) {
   int ret;
   uint8_t status;
   int sensor_cnt;
@@ -758,7 +856,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
       return ret;
     }
 
-    ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+    ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
     if (ret < 0) {
       if (json == 0)
         printf("%s get sensor list failed!\n", fruname);
@@ -770,13 +868,16 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
     return 0;
   }
 
-  if (pal_get_fru_capability(fru, &caps) == PAL_EOK) {
+  if (pal_get_fru_capability_cached(fru, &caps) == PAL_EOK) {
     if (caps & FRU_CAPABILITY_SENSOR_SLAVE) {
       pal_get_root_fru(fru, &root);
     }
   }
 
-  if (history_clear) {
+  if (perf) {
+    get_sensor_perf(((caps & FRU_CAPABILITY_SENSOR_SLAVE) && root > 0) ? root : fru,
+        sensor_list, sensor_cnt, sensor_num, perf == PERF_CLEAR);
+  } else if (history_clear) {
     if ((caps & FRU_CAPABILITY_SENSOR_SLAVE) && root > 0) {
       clear_sensor_history(root, sensor_list, sensor_cnt, sensor_num);
     } else {
@@ -810,7 +911,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
 
   //Print Empty Line to separate frus,
   //only when sensor_cnt greater than 0, not history-clear, and sensor_num is not specified
-  if ( (sensor_cnt > 0) && (!history_clear) && (sensor_num == SENSOR_ALL) ){
+  if ( (sensor_cnt > 0) && (!history_clear) && (perf != PERF_CLEAR) && (sensor_num == SENSOR_ALL) ){
     if (json == 0)
       printf("\n");
   }
@@ -819,7 +920,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
   if (pal_is_exp() == PAL_EOK && pal_get_exp_fru_list(expList, &len) == PAL_EOK) {
     for (i = 0; i < len; ++i) {
       char name[16] = {0};
-      if (pal_get_fru_capability(expList[i], &caps) == PAL_EOK &&
+      if (pal_get_fru_capability_cached(expList[i], &caps) == PAL_EOK &&
           (caps & FRU_CAPABILITY_SENSOR_SLAVE)) {
         continue;
       }
@@ -827,7 +928,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
         if (pal_get_exp_arg_name(expList[i], name) == PAL_EOK) {
           printf("%s:\n", name);
         }
-        ret |= print_sensor(expList[i], sensor_num, allow_absent, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+        ret |= print_sensor(expList[i], sensor_num, allow_absent, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj, perf);
       }
     }
   }
@@ -836,7 +937,7 @@ print_sensor(uint8_t fru, int sensor_num, bool allow_absent, bool history, bool
 }
 
 int parse_args(int argc, char *argv[], char *fruname,
-    bool *history_clear, bool *history, bool *threshold, bool *force, bool *json, bool *filter, long *period, int *snr)
+    bool *history_clear, bool *history, bool *threshold, bool *force, bool *json, bool *filter, long *period, int *snr, int *perf)
 {
   int ret;
   int num, options = 0;
@@ -849,6 +950,8 @@ int parse_args(int argc, char *argv[], char *fruname,
     {"force", no_argument, 0, 'f'},
     {"json", no_argument, 0, 'j'},
     {"filter", no_argument, 0, 'i'},
+    {"perf", no_argument, 0, 'p'},
+    {"perf-clear", no_argument, 0, 'P'},
     {0,0,0,0},
   };
 
@@ -861,12 +964,21 @@ int parse_args(int argc, char *argv[], char *fruname,
   *filter = false;
   *period = 60;
   *snr = -1;
+  *perf = 0;
 
   while(-1 != (ret = getopt_long(argc, argv, "ch:t", long_opts, &index))) {
     switch(ret) {
       case 'f':
         *force = true;
         break;
+      case 'p':
+        *perf = PERF_SHOW;
+        options |= (1 << 5);
+        break;
+      case 'P':
+        *perf = PERF_CLEAR;
+        options |= (1 << 6);
+        break;
       case 'i':
         *filter = true;
         options |= (1 << 4);
@@ -923,7 +1035,7 @@ int parse_args(int argc, char *argv[], char *fruname,
     }
   }
 
-  num = (int)*threshold + (int)*history_clear + (int)*history + (int)*json + (int)*filter;
+  num = (int)*threshold + (int)*history_clear + (int)*history + (int)*json + (int)*filter + (int)(*perf != 0);
   if ((num > 1) && (options != 0x0A)) {  // threshold + json
     return -1;
   }
@@ -944,6 +1056,7 @@ main(int argc, char **argv) {
   bool json;
   bool filter;
   long period;
+  int perf;
   char fruname[32];
   int filter_len = argc - 3;
   char ** filter_list = argv + 3;
@@ -951,7 +1064,7 @@ main(int argc, char **argv) {
 
   if (parse_args(argc, argv, fruname,
         &history_clear, &history,
-        &threshold, &force, &json, &filter, &period, &num)) {
+        &threshold, &force, &json, &filter, &period, &num, &perf)) {
     print_usage();
     exit(-1);
   }
@@ -959,12 +1072,12 @@ main(int argc, char **argv) {
   if (!strcmp(fruname, AGGREGATE_SENSOR_FRU_NAME)) {
     fru = AGGREGATE_SENSOR_FRU_ID;
   } else {
-    ret = pal_get_fru_id(fruname, &fru);
+    ret = pal_get_fru_id_cached(fruname, &fru);
     if (ret < 0) {
       print_usage();
       return ret;
     }
-    if (history_clear || history) {
+    if (history_clear || history || perf) {
       //Check if the input FRU is exist in sensor history list
       if (NULL == strstr(pal_fru_list_sensor_history_t, fruname)) {
         print_usage();
@@ -975,14 +1088,14 @@ main(int argc, char **argv) {
 
   if (fru == 0) {
     for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
-      ret |= print_sensor(fru, num, true, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+      ret |= print_sensor(fru, num, true, history, threshold, force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj, perf);
     }
-    ret |= print_sensor(AGGREGATE_SENSOR_FRU_ID, num, true, history, threshold, false, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+    ret |= print_sensor(AGGREGATE_SENSOR_FRU_ID, num, true, history, threshold, false, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj, perf);
   } else if (pal_get_pair_fru(fru, &pair_fru)) {
-    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
-    ret = print_sensor(pair_fru, num, false, history, threshold, pair_fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len ,period, fru_sensor_obj);
+    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj, perf);
+    ret = print_sensor(pair_fru, num, false, history, threshold, pair_fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len ,period, fru_sensor_obj, perf);
   } else {
-    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj);
+    ret = print_sensor(fru, num, false, history, threshold, fru == AGGREGATE_SENSOR_FRU_ID ? false : force, json, history_clear, filter, filter_list, filter_len, period, fru_sensor_obj, perf);
   }
 
   if (json) {
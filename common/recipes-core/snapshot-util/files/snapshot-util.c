@@ -18,13 +18,22 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <syslog.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <libgen.h>
+#include <time.h>
+#include <zlib.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <openbmc/pal.h>
 
 #define MAX_FRU_NAME_LEN  64
@@ -47,10 +56,13 @@
 // extra pw to prevent accidental clear of RMA data
 #define CLEAR_PW      "571932"
 
-#define TMP_SS_PATH   "/tmp/_snapshot"
-#define TMP_LOG_FILE  TMP_SS_PATH"/log.txt"
-#define TMP_POST_FILE TMP_SS_PATH"/postcode.txt"
-#define TMP_TARBALL   TMP_SS_PATH"/ss.tgz"
+/*
+ * Collectors run concurrently, at most MAX_JOBS at a time, and their
+ * output goes straight into the compressed tarball in memory.
+ */
+#define MAX_JOBS          4
+#define MAX_COLLECT_SIZE  (16 * 1024)  // per collector, before compression
+#define TAR_BLOCK_SIZE    512
 
 #define OEM_REC_TYPE 0xFA
 
@@ -82,6 +94,18 @@ typedef struct _info_rec {
   uint16_t size;
 } info_rec;
 
+typedef struct _collector {
+  char name[100];       // member name in the tarball
+  char cmd[256];        // shell command, or empty for <data> as is
+  int timeout;          // seconds
+  char *data;
+  size_t len;
+  pid_t pid;
+  int fd;
+  struct timespec deadline;
+  bool done;
+} collector;
+
 static info_rec m_info_rec[MAX_REC_NUM] = {
   {0x0400, 0x0C00},
   {0x1000, 0x0C00},
@@ -242,52 +266,312 @@ is_ih_exist(uint8_t slot_id, uint8_t info_type, uint8_t idx, uint16_t *checksum,
   return 0;
 }
 
+static void
+collector_append(collector *c, const char *buf, size_t len) {
+  char *data;
+
+  if (c->len + len > MAX_COLLECT_SIZE) {
+    len = MAX_COLLECT_SIZE - c->len;
+  }
+  if (len == 0) {
+    return;
+  }
+  data = realloc(c->data, c->len + len);
+  if (data == NULL) {
+    return;
+  }
+  memcpy(data + c->len, buf, len);
+  c->data = data;
+  c->len += len;
+}
+
+static int
+collector_start(collector *c) {
+  int pipefd[2];
+
+  if (pipe2(pipefd, O_CLOEXEC)) {
+    return -1;
+  }
+
+  c->pid = fork();
+  if (c->pid < 0) {
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return -1;
+  }
+  if (c->pid == 0) {
+    int null_fd = open("/dev/null", O_RDWR);
+
+    // own process group, so a timeout kills the whole pipeline
+    setpgid(0, 0);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(pipefd[1], STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    execl("/bin/sh", "sh", "-c", c->cmd, (char *)NULL);
+    _exit(127);
+  }
+
+  close(pipefd[1]);
+  c->fd = pipefd[0];
+  clock_gettime(CLOCK_MONOTONIC, &c->deadline);
+  c->deadline.tv_sec += c->timeout;
+  return 0;
+}
+
+static void
+collector_finish(collector *c, bool timed_out) {
+  char note[64];
+  int status;
+
+  close(c->fd);
+  c->fd = -1;
+  if (timed_out) {
+    kill(-c->pid, SIGKILL);
+    kill(c->pid, SIGKILL);
+    syslog(LOG_WARNING, "%s: \"%s\" timed out after %d s",
+           __func__, c->cmd, c->timeout);
+    snprintf(note, sizeof(note), "\n<timed out after %d s>\n", c->timeout);
+    collector_append(c, note, strlen(note));
+  }
+  waitpid(c->pid, &status, 0);
+  c->done = true;
+}
+
+static int
+ms_until(const struct timespec *deadline) {
+  struct timespec now;
+  long ms;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ms = (deadline->tv_sec - now.tv_sec) * 1000 +
+       (deadline->tv_nsec - now.tv_nsec) / 1000000;
+  return ms > 0 ? (int)ms : 0;
+}
+
+/*
+ * Run the collectors with a command, at most MAX_JOBS at a time, and
+ * read their output until they exit or reach their timeout.
+ */
+static void
+run_collectors(collector *cols, int num) {
+  struct pollfd pfds[MAX_JOBS];
+  collector *running[MAX_JOBS];
+  char buf[1024];
+  int next = 0, nrun = 0, i, timeout;
+  ssize_t len;
+
+  while (next < num || nrun > 0) {
+    while (next < num && nrun < MAX_JOBS) {
+      collector *c = &cols[next++];
+
+      if (c->done) {
+        continue;
+      }
+      if (collector_start(c)) {
+        syslog(LOG_WARNING, "%s: failed to start \"%s\": %s",
+               __func__, c->cmd, strerror(errno));
+        c->done = true;
+        continue;
+      }
+      running[nrun++] = c;
+    }
+    if (nrun == 0) {
+      break;
+    }
+
+    timeout = -1;
+    for (i = 0; i < nrun; i++) {
+      int ms = ms_until(&running[i]->deadline);
+
+      pfds[i].fd = running[i]->fd;
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+      if (timeout < 0 || ms < timeout) {
+        timeout = ms;
+      }
+    }
+    if (poll(pfds, nrun, timeout) < 0 && errno != EINTR) {
+      timeout = 0;  // give up on all of them
+    }
+
+    for (i = nrun - 1; i >= 0; i--) {
+      collector *c = running[i];
+      bool finished = false;
+
+      if (pfds[i].revents) {
+        len = read(c->fd, buf, sizeof(buf));
+        if (len > 0) {
+          collector_append(c, buf, len);
+        } else if (len == 0 || errno != EINTR) {
+          collector_finish(c, false);
+          finished = true;
+        }
+      }
+      if (!finished && ms_until(&c->deadline) == 0) {
+        collector_finish(c, true);
+        finished = true;
+      }
+      if (finished) {
+        running[i] = running[--nrun];
+      }
+    }
+  }
+}
+
+static int
+tar_append(uint8_t **tar, size_t *tar_len, const char *name,
+           const char *data, size_t len) {
+  size_t padded = (len + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+  unsigned int sum = 0;
+  uint8_t *hdr, *buf;
+  int i;
+
+  buf = realloc(*tar, *tar_len + TAR_BLOCK_SIZE + padded);
+  if (buf == NULL) {
+    return -1;
+  }
+  *tar = buf;
+  hdr = buf + *tar_len;
+  memset(hdr, 0, TAR_BLOCK_SIZE + padded);
+
+  // ustar header, same as "tar czf ss.tgz ./*" created
+  snprintf((char *)hdr, 100, "./%s", name);
+  snprintf((char *)hdr + 100, 8, "%07o", 0644);
+  snprintf((char *)hdr + 108, 8, "%07o", 0);
+  snprintf((char *)hdr + 116, 8, "%07o", 0);
+  snprintf((char *)hdr + 124, 12, "%011zo", len);
+  snprintf((char *)hdr + 136, 12, "%011lo", (unsigned long)time(NULL));
+  memset(hdr + 148, ' ', 8);
+  hdr[156] = '0';
+  memcpy(hdr + 257, "ustar", 6);
+  memcpy(hdr + 263, "00", 2);
+  for (i = 0; i < TAR_BLOCK_SIZE; i++) {
+    sum += hdr[i];
+  }
+  snprintf((char *)hdr + 148, 8, "%06o", sum);
+
+  if (len) {
+    memcpy(hdr + TAR_BLOCK_SIZE, data, len);
+  }
+  *tar_len += TAR_BLOCK_SIZE + padded;
+  return 0;
+}
+
+/*
+ * Pack the collected data as a gzip compressed tarball, in memory.
+ */
 static int
-util_create_default_reason(char *buf_data) {
-  FILE *f = fopen(DEFAULT_REASON_FILE_NAME, "w");
-  if (f == NULL) {
-      printf("Error creating default reason file!\n");
+pack_snapshot(collector *cols, int num, uint8_t **out, int *out_len) {
+  uint8_t *tar = NULL, *gz;
+  size_t tar_len = 0;
+  z_stream zs;
+  uLong bound;
+  int i, ret;
+
+  for (i = 0; i < num; i++) {
+    if (tar_append(&tar, &tar_len, cols[i].name, cols[i].data, cols[i].len)) {
+      free(tar);
       return -1;
+    }
   }
 
-  // store at most MAX_REASON_DESC characters to file
-  fprintf(f, "%.*s\n", MAX_REASON_DESC, buf_data);
+  // end of archive: two zero blocks
+  gz = realloc(tar, tar_len + 2 * TAR_BLOCK_SIZE);
+  if (gz == NULL) {
+    free(tar);
+    return -1;
+  }
+  tar = gz;
+  memset(tar + tar_len, 0, 2 * TAR_BLOCK_SIZE);
+  tar_len += 2 * TAR_BLOCK_SIZE;
 
-  fclose(f);
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    free(tar);
+    return -1;
+  }
+  bound = deflateBound(&zs, tar_len);
+  gz = malloc(bound);
+  if (gz == NULL) {
+    deflateEnd(&zs);
+    free(tar);
+    return -1;
+  }
+  zs.next_in = tar;
+  zs.avail_in = tar_len;
+  zs.next_out = gz;
+  zs.avail_out = bound;
+  ret = deflate(&zs, Z_FINISH);
+  *out_len = bound - zs.avail_out;
+  deflateEnd(&zs);
+  free(tar);
+  if (ret != Z_STREAM_END) {
+    free(gz);
+    return -1;
+  }
+
+  *out = gz;
   return 0;
 }
 
+static int
+read_reason_file(const char *path, collector *c) {
+  char buf[256];
+  size_t len;
+  FILE *fp;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    printf("unable to get the %s fp %s\n", path, strerror(errno));
+    return -1;
+  }
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    collector_append(c, buf, len);
+  }
+  fclose(fp);
+  return 0;
+}
 
 static int
 util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
   uint8_t wbuf[64], rbuf[64], ih_buf[IH_SIZE], ih_offs, idx, max_idx;
   uint16_t sum;
-  char cmd[256], *magic_tag;
-  int ret, fsize, offset, len, i;
+  char *magic_tag, path[256];
+  int ret, fsize, offset, len, i, j, num_cols = 0;
   info_hdr *ih = (info_hdr *)ih_buf;
   struct stat st = {0};
-  FILE *fp;
-  char *reason_file = cmdline_opt;
+  uint8_t *tgz = NULL;
   char fru_name[MAX_FRU_NAME_LEN] = {0};
+  collector cols[6];
+  collector *c;
 
   memset(fru_name, 0, sizeof(fru_name));
+  memset(cols, 0, sizeof(cols));
 
   // check if user specified a file containing "reason string"
+  c = &cols[num_cols++];
   if (stat(cmdline_opt, &st) != 0) {
-    // file doesn't exist, treat it as stdin and create a file instead
+    // file doesn't exist, treat it as stdin
     printf("Reason file doesn't exist, assume stdin\n");
-    ret = util_create_default_reason(reason_file);
-    if (!ret) {
-      reason_file = DEFAULT_REASON_FILE_NAME;
-    } else {
-      return ret;
-    }
-  }
-
-  if (st.st_size > MAX_REASON_DESC) {
-    printf("%s is too large\n", reason_file);
+    snprintf(path, sizeof(path), "%s", DEFAULT_REASON_FILE_NAME);
+    snprintf(c->name, sizeof(c->name), "%s", basename(path));
+    // store at most MAX_REASON_DESC characters
+    len = strnlen(cmdline_opt, MAX_REASON_DESC);
+    collector_append(c, cmdline_opt, len);
+    collector_append(c, "\n", 1);
+  } else if (st.st_size > MAX_REASON_DESC) {
+    printf("%s is too large\n", cmdline_opt);
     return -1;
+  } else {
+    snprintf(path, sizeof(path), "%s", cmdline_opt);
+    snprintf(c->name, sizeof(c->name), "%s", basename(path));
+    if (read_reason_file(cmdline_opt, c)) {
+      ret = -1;
+      goto exit;
+    }
   }
+  c->done = true;
 
   max_idx = (info_type == TYPE_MFG) ? MAX_MFI_NUM : MAX_RI_NUM;
   for (idx = 0; idx < max_idx; idx++) {
@@ -296,41 +580,49 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
   }
   if (idx >= max_idx) {
     printf("all Info areas are occupied\n");
-    return -1;
+    ret = -1;
+    goto exit;
   }
 
-  snprintf(cmd, sizeof(cmd), "rm -rf %s", TMP_SS_PATH);
-  log_system(cmd);
-  mkdir(TMP_SS_PATH, 0755);
-
-  snprintf(cmd, sizeof(cmd), "cp %s %s/", reason_file, TMP_SS_PATH);
-  log_system(cmd);
-
   if (pal_get_fru_name(slot_id, fru_name) < 0) {
     syslog(LOG_ERR, "%s: failed to get fru name", __func__);
-    return -1;
+    ret = -1;
+    goto exit;
   }
 
-  printf("Getting logs...\n");
-  snprintf(cmd, sizeof(cmd), "/usr/local/bin/log-util all --print | /usr/bin/tail -n 50 > %s",
-           TMP_LOG_FILE);
-  log_system(cmd);
+  c = &cols[num_cols++];
+  snprintf(c->name, sizeof(c->name), "log.txt");
+  snprintf(c->cmd, sizeof(c->cmd),
+           "/usr/local/bin/log-util all --print | /usr/bin/tail -n 50");
+  c->timeout = 30;
 
-  printf("Getting POST codes...\n");
-  snprintf(cmd, sizeof(cmd), "/usr/local/bin/bios-util %s --postcode get > %s", fru_name, TMP_POST_FILE);
-  log_system(cmd);
+  c = &cols[num_cols++];
+  snprintf(c->name, sizeof(c->name), "postcode.txt");
+  snprintf(c->cmd, sizeof(c->cmd),
+           "/usr/local/bin/bios-util %s --postcode get", fru_name);
+  c->timeout = 30;
 
-  if (chdir(TMP_SS_PATH)) {
-    syslog(LOG_WARNING, "chdir failed, dir path: %s", TMP_SS_PATH);
-    return -1;
+  // latest samples of the healthd metrics ring, if enabled
+  if (access("/tmp/healthd_metrics", R_OK) == 0) {
+    c = &cols[num_cols++];
+    snprintf(c->name, sizeof(c->name), "health.txt");
+    snprintf(c->cmd, sizeof(c->cmd),
+             "/usr/local/bin/healthd --metrics | /usr/bin/tail -n 10");
+    c->timeout = 10;
   }
-  snprintf(cmd, sizeof(cmd), "tar czf %s ./*", TMP_TARBALL);
-  log_system(cmd);
 
-  fp = fopen(TMP_TARBALL, "rb");
-  if (fp == NULL) {
-    printf("unable to get the %s fp %s\n", TMP_TARBALL, strerror(errno));
-    return errno;
+  c = &cols[num_cols++];
+  snprintf(c->name, sizeof(c->name), "dmesg.txt");
+  snprintf(c->cmd, sizeof(c->cmd), "/bin/dmesg | /usr/bin/tail -n 20");
+  c->timeout = 10;
+
+  printf("Getting logs, POST codes and BMC state...\n");
+  run_collectors(cols, num_cols);
+
+  if (pack_snapshot(cols, num_cols, &tgz, &fsize)) {
+    printf("unable to pack the snapshot\n");
+    ret = -1;
+    goto exit;
   }
 
   if (info_type == TYPE_MFG) {
@@ -340,37 +632,34 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
     magic_tag = RIH_MAGIC_TAG;
   }
 
-  fseek(fp, 0L, SEEK_END);
-  fsize = ftell(fp);
   printf("File Size: %d\n", fsize);
   if ((fsize + IH_SIZE) > m_info_rec[idx].size) {
     printf("file is too large\n");
-    fclose(fp);
-    return -1;
+    ret = -1;
+    goto exit;
   }
   printf("Storing to EEPROM...\n");
 
   sum = 0;
-  rewind(fp);
   offset = m_info_rec[idx].offset + IH_SIZE;
-  while ((len = fread(&wbuf[2], 1, BLOCK_SIZE, fp)) > 0) {
+  for (i = 0; i < fsize; i += len) {
+    len = (fsize - i > BLOCK_SIZE) ? BLOCK_SIZE : fsize - i;
     wbuf[0] = (offset >> 8) & 0xFF;
     wbuf[1] = offset & 0xFF;
+    memcpy(&wbuf[2], &tgz[i], len);
     ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2+len, rbuf, 0);
     if (ret != 0) {
       printf("write failed 0x%x, len = %d\n", offset, len);
-      fclose(fp);
-      return ret;
+      goto exit;
     }
 
-    for (i = 0; i < len; i++) {
-      sum += wbuf[i+2];
+    for (j = 0; j < len; j++) {
+      sum += wbuf[j+2];
     }
 
     offset += len;
     msleep(10);
   }
-  fclose(fp);
 
   memset(ih_buf, 0x00, IH_SIZE);
   memcpy(ih->magic_tag, magic_tag, 8);
@@ -393,16 +682,21 @@ util_store_snapshot(uint8_t slot_id, uint8_t info_type, char *cmdline_opt) {
     ret = bic_master_write_read(slot_id, EEPROM_BUS, EEPROM_ADDR, wbuf, 2+len, rbuf, 0);
     if (ret != 0) {
       printf("write failed 0x%x, len = %d\n", offset, len);
-      fclose(fp);
-      return ret;
+      goto exit;
     }
 
     offset += len;
     ih_offs += len;
     fsize -= len;
   }
+  ret = 0;
 
-  return 0;
+exit:
+  free(tgz);
+  for (i = 0; i < num_cols; i++) {
+    free(cols[i].data);
+  }
+  return ret;
 }
 
 static int
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <openbmc/pal.h>
 #include <openbmc/sdr.h>
+#include <jansson.h>
 
 enum {
   UCR = 0x01,
@@ -42,6 +43,7 @@ static void
 print_usage_help(void) {
   printf("Usage: threshold-util [fru] <--set> <snr_num> [thresh_type] <threshold_value>\n");
   printf("       threshold-util [fru] <--clear>\n");
+  printf("       threshold-util <--apply> <json_file|->\n");
   if (pal_is_exp() == PAL_EOK) {
     printf("Usage: threshold-util [slot1-2U-top|slot1-2U-bot] <--set> <snr_num> [thresh_type] <threshold_value>\n");
     printf("       threshold-util [slot1-2U-top|slot1-2U-bot] <--clear>\n");
@@ -49,6 +51,7 @@ print_usage_help(void) {
   printf("       [fru]           : %s\n", pal_fru_list);
   printf("       <snr_num>    : 0xXX\n");
   printf("       [thresh_type]   : UCR, UNC, UNR, LCR, LNC, LNR\n");
+  printf("       <json_file>     : {\"fru\": {\"0xXX\": {\"thresh_type\": threshold_value, ...}, ...}, ...}\n");
 }
 
 static int
@@ -85,6 +88,117 @@ is_fru_valid(uint8_t fru) {
   return 0;
 }
 
+static int
+get_thresh_type(const char *str) {
+  static const char *names[] = {"UCR", "UNC", "UNR", "LCR", "LNC", "LNR"};
+  int i;
+
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (!strcmp(str, names[i]))
+      return UCR + i;
+  }
+  return -1;
+}
+
+/* Changes of a FRU from its JSON object, returns their count or -1. */
+static int
+parse_fru_thresh(uint8_t fru, json_t *sensors, thresh_modify_t *mods, int max) {
+  const char *snr_key, *type_key;
+  json_t *threshs, *value;
+  char *end;
+  long snr_num;
+  int type, cnt = 0;
+
+  if (!json_is_object(sensors))
+    return -1;
+  json_object_foreach(sensors, snr_key, threshs) {
+    errno = 0;
+    snr_num = strtol(snr_key, &end, 0);
+    if (errno || *end || snr_num < 0 || snr_num > 0xFF || !json_is_object(threshs)) {
+      printf("Invalid sensor %s for fru%d\n", snr_key, fru);
+      return -1;
+    }
+    if (!pal_is_sensor_existing(fru, snr_num)) {
+      printf("Could not find sensor 0x%lx for fru%d\n", snr_num, fru);
+      return -1;
+    }
+    json_object_foreach(threshs, type_key, value) {
+      type = get_thresh_type(type_key);
+      if (type < 0 || !json_is_number(value)) {
+        printf("Invalid threshold %s of sensor 0x%lx for fru%d\n", type_key, snr_num, fru);
+        return -1;
+      }
+      if (cnt >= max) {
+        printf("Too many thresholds for fru%d\n", fru);
+        return -1;
+      }
+      mods[cnt].snr_num = snr_num;
+      mods[cnt].thresh_type = type;
+      mods[cnt].value = json_number_value(value);
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+/*
+ * Apply the thresholds of a JSON file: all of them are checked first,
+ * then the changes of every FRU are written at once, so sensord reloads
+ * each FRU once, and only its changed sensors.
+ */
+static int
+apply_thresh_file(const char *path) {
+  static thresh_modify_t mods[MAX_NUM_FRUS + 1][256 * 6];
+  int mods_cnt[MAX_NUM_FRUS + 1] = {0};
+  const char *fru_key;
+  json_t *root, *sensors;
+  json_error_t error;
+  uint8_t fru;
+  int ret = 0, cnt;
+
+  if (!strcmp(path, "-"))
+    root = json_loadf(stdin, 0, &error);
+  else
+    root = json_load_file(path, 0, &error);
+  if (root == NULL || !json_is_object(root)) {
+    printf("Invalid JSON %s: %s (line %d)\n", path, root ? "not an object" : error.text,
+           root ? 0 : error.line);
+    json_decref(root);
+    return -1;
+  }
+
+  json_object_foreach(root, fru_key, sensors) {
+    if (pal_get_fru_id((char *)fru_key, &fru) < 0 || fru == FRU_ALL ||
+        fru > MAX_NUM_FRUS || is_fru_valid(fru) < 0) {
+      printf("Invalid fru %s\n", fru_key);
+      ret = -1;
+      break;
+    }
+    cnt = parse_fru_thresh(fru, sensors, mods[fru] + mods_cnt[fru],
+                           sizeof(mods[fru]) / sizeof(mods[fru][0]) - mods_cnt[fru]);
+    if (cnt < 0) {
+      ret = -1;
+      break;
+    }
+    mods_cnt[fru] += cnt;
+  }
+  json_decref(root);
+  if (ret < 0)
+    return ret;
+
+  for (fru = 1; fru <= MAX_NUM_FRUS; fru++) {
+    if (mods_cnt[fru] == 0)
+      continue;
+    if (pal_sensor_thresh_modify_list(fru, mods[fru], mods_cnt[fru]) < 0) {
+      printf("Fail to set %d thresholds for fru%d\n", mods_cnt[fru], fru);
+      ret = -1;
+    } else {
+      printf("Set %d thresholds for fru%d\n", mods_cnt[fru], fru);
+    }
+  }
+  return ret;
+}
+
 static int
 clear_thresh_value_setting(uint8_t fru) {
   int ret = -1;
@@ -108,7 +222,7 @@ clear_thresh_value_setting(uint8_t fru) {
 
   memset(fpath, 0, sizeof(fpath));
   sprintf(fpath, THRESHOLD_RE_FLAG, fruname);
-  sprintf(cmd,"touch %s",fpath);
+  sprintf(cmd,"echo all >> %s",fpath);
   if (system(cmd) != 0) {
       syslog(LOG_WARNING, "[%s] %s failed\n", __func__, cmd);
       return -ENOTSUP;
@@ -128,6 +242,13 @@ main(int argc, char **argv) {
   int ret = -1;
   char *end = NULL;
 
+  if ((argc == 3) && !strcmp(argv[1], "--apply")) {
+    ret = apply_thresh_file(argv[2]);
+    if (ret < 0)
+      print_usage_help();
+    return ret;
+  }
+
   // Check for border conditions
   if ((argc != 3) && (argc != 6)) {
     print_usage_help();
@@ -62,6 +62,19 @@ typedef struct {
   size_t value_map_size;
   value_map_element_type value_map[MAX_CONDITIONALS];
   int default_expression_idx; /* -1 == invalid */
+  /* Last value of cond_key and the formula it mapped to, -1 == none */
+  char last_cond_value[MAX_VALUE_LEN];
+  int last_f_idx;
+  /* Cached sensors the formulas depend on, and their cache generation
+   * when memo_value was computed */
+  size_t num_inputs;
+  struct sensor_src **inputs;
+  uint32_t *input_gen;
+  /* Last value computed, valid while none of the inputs changed */
+  bool memo_valid;
+  int memo_f_idx;
+  float memo_value;
+  time_t memo_time;
 } aggregate_sensor_t;
 
 extern size_t g_sensors_count;
@@ -195,6 +195,9 @@ static variable_type *load_variables(json_t *obj, size_t *count)
     /* Successful parse. free the string, reset the redo count and
      * begin parsing of the next expression variable */
     free(str_expression);
+    if (expression_compile(vars[i].state)) {
+      DEBUG("Compiling expression of %s failed!\n", vars[i].name);
+    }
     redo_count = 0;
     i++;
   }
@@ -204,6 +207,30 @@ bail:
   return NULL;
 }
 
+/* Record the cached sensors among vars as the inputs of snr */
+static int load_inputs(aggregate_sensor_t *snr, variable_type *vars, size_t num_vars)
+{
+  size_t i;
+
+  snr->num_inputs = 0;
+  snr->inputs = calloc(num_vars, sizeof(struct sensor_src *));
+  snr->input_gen = calloc(num_vars, sizeof(uint32_t));
+  if (!snr->inputs || !snr->input_gen) {
+    free(snr->inputs);
+    free(snr->input_gen);
+    snr->inputs = NULL;
+    snr->input_gen = NULL;
+    return -1;
+  }
+  for (i = 0; i < num_vars; i++) {
+    if (vars[i].value == get_sensor_value) {
+      snr->inputs[snr->num_inputs++] = (struct sensor_src *)vars[i].state;
+    }
+  }
+  snr->memo_valid = false;
+  return 0;
+}
+
 /* Parse SENSORS[X]::composition if it is of type
  * "linear_expression". */
 static int load_linear_eq(aggregate_sensor_t *snr, json_t *obj)
@@ -218,6 +245,11 @@ static int load_linear_eq(aggregate_sensor_t *snr, json_t *obj)
   if (!vars) {
     return -1;
   }
+  if (load_inputs(snr, vars, num_vars)) {
+    DEBUG("Allocation failure");
+    cleanup_vars(vars, num_vars);
+    return -1;
+  }
   snr->num_expressions = 1;
   snr->expressions = calloc(1, sizeof(expression_type *));
   if (!snr->expressions) {
@@ -241,6 +273,10 @@ static int load_linear_eq(aggregate_sensor_t *snr, json_t *obj)
   free(vars);
   return 0;
 bail_linear_exp:
+  free(snr->inputs);
+  free(snr->input_gen);
+  snr->inputs = NULL;
+  snr->input_gen = NULL;
   cleanup_vars(vars, num_vars);
   return -1;
 }
@@ -261,6 +297,11 @@ static int load_linear_cond_eq(aggregate_sensor_t *snr, json_t *obj)
   if (!vars) {
     return -1;
   }
+  if (load_inputs(snr, vars, num_vars)) {
+    DEBUG("Allocation failure");
+    cleanup_vars(vars, num_vars);
+    return -1;
+  }
 
   snr->conditional = true;
 
@@ -369,6 +410,10 @@ bail_exp_parse:
   }
   free(snr->expressions);
 bail_linear_exp:
+  free(snr->inputs);
+  free(snr->input_gen);
+  snr->inputs = NULL;
+  snr->input_gen = NULL;
   cleanup_vars(vars, num_vars);
   return -1;
 }
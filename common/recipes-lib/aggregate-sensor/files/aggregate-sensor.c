@@ -23,6 +23,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <time.h>
 #include <openbmc/obmc-pal.h>
 #include <openbmc/pal_sensors.h>
 #include <openbmc/kv.h>
@@ -88,12 +89,40 @@ int get_key(cond_key_type type, const char *cond_key, char *cond_value)
 }
 
 
+/* Refresh the cache generations of the inputs of snr. Returns 0 if
+ * none changed since the last call, 1 if some did and -1 if some
+ * are not tracked (so a value cannot be memoized). */
+static int inputs_changed(aggregate_sensor_t *snr)
+{
+  uint32_t gen;
+  size_t i;
+  int ret = 0;
+
+  for (i = 0; i < snr->num_inputs; i++) {
+    if (sensor_cache_generation(snr->inputs[i]->fru, snr->inputs[i]->id, &gen)) {
+      return -1;
+    }
+    if (gen != snr->input_gen[i]) {
+      snr->input_gen[i] = gen;
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
 int
 aggregate_sensor_read(size_t index, float *value)
+{
+  return aggregate_sensor_read_ts(index, value, NULL);
+}
+
+int
+aggregate_sensor_read_ts(size_t index, float *value, time_t *timestamp)
 {
   char cond_value[MAX_VALUE_LEN] = {0};
   size_t i;
   int f_idx = -1;
+  int changed, ret;
   aggregate_sensor_t *snr;
   if (index >= g_sensors_count) {
     return -1;
@@ -104,11 +133,21 @@ aggregate_sensor_read(size_t index, float *value)
   snr = &g_sensors[index];
   if (snr->conditional) {
     if (!get_key(snr->cond_type, snr->cond_key, cond_value)) {
-      for (i = 0; i < snr->value_map_size; i++) {
-        if (!strncmp(snr->value_map[i].condition_value, cond_value,
-            sizeof(snr->value_map[i].condition_value))) {
-          f_idx = snr->value_map[i].formula_index;
-          break;
+      /* The key rarely changes, look it up only when it does */
+      if (snr->last_f_idx != -1 &&
+          !strncmp(snr->last_cond_value, cond_value, sizeof(cond_value))) {
+        f_idx = snr->last_f_idx;
+      } else {
+        for (i = 0; i < snr->value_map_size; i++) {
+          if (!strncmp(snr->value_map[i].condition_value, cond_value,
+              sizeof(snr->value_map[i].condition_value))) {
+            f_idx = snr->value_map[i].formula_index;
+            break;
+          }
+        }
+        if (f_idx != -1) {
+          memcpy(snr->last_cond_value, cond_value, sizeof(cond_value));
+          snr->last_f_idx = f_idx;
         }
       }
     }
@@ -121,7 +160,24 @@ aggregate_sensor_read(size_t index, float *value)
   } else {
     f_idx = 0;
   }
-  return expression_evaluate(snr->expressions[f_idx], value);
+
+  changed = inputs_changed(snr);
+  if (changed == 0 && snr->memo_valid && snr->memo_f_idx == f_idx) {
+    *value = snr->memo_value;
+    if (timestamp) {
+      *timestamp = snr->memo_time;
+    }
+    return 0;
+  }
+  ret = expression_evaluate(snr->expressions[f_idx], value);
+  snr->memo_valid = ret == 0 && changed >= 0;
+  snr->memo_f_idx = f_idx;
+  snr->memo_value = *value;
+  snr->memo_time = time(NULL);
+  if (timestamp) {
+    *timestamp = snr->memo_time;
+  }
+  return ret;
 }
 
 int
@@ -158,10 +214,28 @@ aggregate_sensor_units(size_t index, char *units)
 int
 aggregate_sensor_init(const char *conf_file_path)
 {
+  size_t i, j;
+  int ret;
+
   if (!conf_file_path) {
     conf_file_path = DEFAULT_CONF_FILE_PATH;
   }
-  return load_aggregate_conf(conf_file_path);
+  ret = load_aggregate_conf(conf_file_path);
+  if (ret) {
+    return ret;
+  }
+  /* Compile the formulas, they are evaluated as parsed if that fails */
+  for (i = 0; i < g_sensors_count; i++) {
+    aggregate_sensor_t *snr = &g_sensors[i];
+    snr->last_f_idx = -1;
+    for (j = 0; j < snr->num_expressions; j++) {
+      if (expression_compile(snr->expressions[j])) {
+        syslog(LOG_WARNING, "%s: Compiling expression %zu failed",
+            snr->sensor.name, j);
+      }
+    }
+  }
+  return 0;
 }
 
 void
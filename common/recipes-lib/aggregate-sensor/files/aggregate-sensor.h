@@ -27,10 +27,14 @@ extern "C"{
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
 #include <openbmc/sdr.h>
 
 int aggregate_sensor_count(size_t *count);
 int aggregate_sensor_read(size_t index, float *value);
+/* As aggregate_sensor_read() also returning the time the value was
+ * computed at, earlier than now if none of its inputs changed since. */
+int aggregate_sensor_read_ts(size_t index, float *value, time_t *timestamp);
 int aggregate_sensor_threshold(size_t index, thresh_sensor_t *thresh);
 int aggregate_sensor_name(size_t index, char *name);
 int aggregate_sensor_units(size_t index, char *units);
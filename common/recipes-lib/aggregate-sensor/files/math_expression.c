@@ -17,6 +17,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
@@ -47,6 +48,29 @@ typedef enum {
   OP_POWER /* L / R */
 } operator_type;
 
+/* Limits of a compiled program, larger expressions are evaluated
+ * by walking the tree. */
+#define PROGRAM_MAX_VARS  32
+#define PROGRAM_MAX_STACK 32
+
+/* Instructions: INSN_CONST and INSN_VAR push a value, the
+ * operators pop R and L and push the result */
+#define INSN_CONST  0xfe
+#define INSN_VAR    0xff
+
+typedef struct {
+  uint8_t op; /* INSN_* or operator_type */
+  uint8_t idx; /* Variable index of INSN_VAR */
+  float constant; /* Value of INSN_CONST */
+} program_insn_type;
+
+typedef struct {
+  size_t num_insns;
+  program_insn_type *insns;
+  size_t num_vars;
+  variable_type vars[PROGRAM_MAX_VARS];
+} program_type;
+
 struct expression_type_s {
   operator_type type;
   expression_term_type *left_exp_term;
@@ -54,6 +78,7 @@ struct expression_type_s {
   expression_term_type *right_exp_term;
   expression_type      *right_exp_group;
   expression_type      *parent;
+  program_type         *program;
 };
 
 static operator_type get_operator(char *str)
@@ -239,10 +264,200 @@ free_bail:
   return NULL;
 }
 
+static float apply_operator(operator_type op, float l_val, float r_val)
+{
+  switch(op) {
+    case OP_ADD:
+      return l_val + r_val;
+    case OP_SUBTRACT:
+      return l_val - r_val;
+    case OP_MULTIPLY:
+      return l_val * r_val;
+    case OP_DIVIDE:
+      return l_val / r_val;
+    case OP_POWER:
+      return powf(l_val, r_val);
+    default:
+      assert(0);
+  }
+  return 0;
+}
+
+/* Append an instruction, depth is that of the stack before it */
+static int program_emit(program_type *prog, size_t max_insns,
+    program_insn_type *insn, int depth)
+{
+  if (prog->num_insns >= max_insns || depth >= PROGRAM_MAX_STACK) {
+    return -1;
+  }
+  prog->insns[prog->num_insns++] = *insn;
+  return 0;
+}
+
+static int program_emit_term(program_type *prog, size_t max_insns,
+    expression_term_type *term, int depth)
+{
+  program_insn_type insn = {0};
+  size_t i;
+
+  if (term->type == TERM_CONSTANT) {
+    insn.op = INSN_CONST;
+    insn.constant = term->term.constant;
+    return program_emit(prog, max_insns, &insn, depth);
+  }
+  /* Variables are copies, the name identifies them */
+  for (i = 0; i < prog->num_vars; i++) {
+    if (!strncmp(prog->vars[i].name, term->term.var.name,
+          sizeof(prog->vars[i].name))) {
+      break;
+    }
+  }
+  if (i == prog->num_vars) {
+    if (prog->num_vars >= PROGRAM_MAX_VARS) {
+      return -1;
+    }
+    prog->vars[prog->num_vars++] = term->term.var;
+  }
+  insn.op = INSN_VAR;
+  insn.idx = (uint8_t)i;
+  return program_emit(prog, max_insns, &insn, depth);
+}
+
+/* Emit the postfix form of exp, folding an operator on two constants
+ * into one constant. depth is that of the stack before exp. */
+static int program_emit_expression(program_type *prog, size_t max_insns,
+    expression_type *exp, int depth)
+{
+  program_insn_type insn = {0};
+  program_insn_type *l, *r;
+  int ret;
+
+  if (!exp->left_exp_term && !exp->left_exp_group) {
+    return -1;
+  }
+  ret = exp->left_exp_term ?
+    program_emit_term(prog, max_insns, exp->left_exp_term, depth) :
+    program_emit_expression(prog, max_insns, exp->left_exp_group, depth);
+  if (ret) {
+    return ret;
+  }
+  if (!exp->right_exp_term && !exp->right_exp_group) {
+    return 0;
+  }
+  ret = exp->right_exp_term ?
+    program_emit_term(prog, max_insns, exp->right_exp_term, depth + 1) :
+    program_emit_expression(prog, max_insns, exp->right_exp_group, depth + 1);
+  if (ret) {
+    return ret;
+  }
+  if (exp->type == OP_INVALID) {
+    return -1;
+  }
+
+  /* A constant operand leaves a single INSN_CONST behind, so
+   * two of them at the end are the operands of this one */
+  l = &prog->insns[prog->num_insns - 2];
+  r = &prog->insns[prog->num_insns - 1];
+  if (l->op == INSN_CONST && r->op == INSN_CONST) {
+    l->constant = apply_operator(exp->type, l->constant, r->constant);
+    prog->num_insns--;
+    return 0;
+  }
+  insn.op = (uint8_t)exp->type;
+  return program_emit(prog, max_insns, &insn, depth + 1);
+}
+
+static size_t expression_size(expression_type *exp)
+{
+  size_t size = 1;
+
+  if (exp->left_exp_term)
+    size++;
+  else if (exp->left_exp_group)
+    size += expression_size(exp->left_exp_group);
+  if (exp->right_exp_term)
+    size++;
+  else if (exp->right_exp_group)
+    size += expression_size(exp->right_exp_group);
+  return size;
+}
+
+int expression_compile(expression_type *exp)
+{
+  program_type *prog;
+  size_t max_insns;
+
+  if (!exp) {
+    return -1;
+  }
+  if (exp->program) {
+    return 0;
+  }
+
+  max_insns = expression_size(exp);
+  prog = calloc(1, sizeof(program_type));
+  if (!prog) {
+    return -1;
+  }
+  prog->insns = calloc(max_insns, sizeof(program_insn_type));
+  if (!prog->insns) {
+    free(prog);
+    return -1;
+  }
+  if (program_emit_expression(prog, max_insns, exp, 0)) {
+    free(prog->insns);
+    free(prog);
+    return -1;
+  }
+  exp->program = prog;
+  return 0;
+}
+
+static int program_evaluate(program_type *prog, float *value)
+{
+  float stack[PROGRAM_MAX_STACK];
+  float vals[PROGRAM_MAX_VARS];
+  uint32_t read = 0;
+  size_t i;
+  int sp = 0;
+  int ret;
+
+  for (i = 0; i < prog->num_insns; i++) {
+    program_insn_type *insn = &prog->insns[i];
+
+    switch (insn->op) {
+      case INSN_CONST:
+        stack[sp++] = insn->constant;
+        break;
+      case INSN_VAR:
+        if (!(read & (1U << insn->idx))) {
+          variable_type *var = &prog->vars[insn->idx];
+          ret = var->value(var->state, &vals[insn->idx]);
+          if (ret) {
+            return ret;
+          }
+          read |= 1U << insn->idx;
+        }
+        stack[sp++] = vals[insn->idx];
+        break;
+      default:
+        sp--;
+        stack[sp - 1] = apply_operator(insn->op, stack[sp - 1], stack[sp]);
+        break;
+    }
+  }
+  assert(sp == 1);
+  *value = stack[0];
+  return 0;
+}
+
 int expression_evaluate(expression_type *exp, float *value)
 {
   float l_val, r_val;
   int ret;
+  if (exp->program) {
+    return program_evaluate(exp->program, value);
+  }
   assert(exp->left_exp_term || exp->left_exp_group);
   ret = exp->left_exp_term ? expression_term_evaluate(exp->left_exp_term, &l_val) :
     expression_evaluate(exp->left_exp_group, &l_val);
@@ -264,25 +479,7 @@ int expression_evaluate(expression_type *exp, float *value)
     return ret;
   }
 
-  switch(exp->type) {
-    case OP_ADD:
-      *value = l_val + r_val;
-      break;
-    case OP_SUBTRACT:
-      *value = l_val - r_val;
-      break;
-    case OP_MULTIPLY:
-      *value = l_val * r_val;
-      break;
-    case OP_DIVIDE:
-      *value = l_val / r_val;
-      break;
-    case OP_POWER:
-      *value = powf(l_val, r_val);
-      break;
-    default:
-      assert(0);
-  }
+  *value = apply_operator(exp->type, l_val, r_val);
   return 0;
 }
 
@@ -299,6 +496,10 @@ void expression_destroy(expression_type *exp)
     free(exp->right_exp_term);
   else if (exp->right_exp_group)
     expression_destroy(exp->right_exp_group);
+  if (exp->program) {
+    free(exp->program->insns);
+    free(exp->program);
+  }
   free(exp);
 }
 
@@ -395,6 +596,10 @@ int main(int argc, char *argv[])
   printf("\n");
   rc = expression_evaluate(op, &ret);
   printf("= (ret=%d) %4.3f\n", rc, ret);
+  rc = expression_compile(op);
+  printf("Compiled (ret=%d)\n", rc);
+  rc = expression_evaluate(op, &ret);
+  printf("= (ret=%d) %4.3f\n", rc, ret);
   expression_destroy(op);
   return 0;
 }
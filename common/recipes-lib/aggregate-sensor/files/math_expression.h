@@ -63,6 +63,13 @@ expression_type *expression_parse(const char *str, variable_type *vars, size_t n
  * provided in 'vars' in expression_parse might be made */
 int expression_evaluate(expression_type *op, float *value);
 
+/* Compile the expression into a flat postfix program with all the
+ * constant sub-expressions folded, which is then used by
+ * expression_evaluate(). Every variable is read at most once per
+ * evaluation. On failure, the expression is left to be evaluated
+ * as parsed. 0 on success, negative error otherwise. */
+int expression_compile(expression_type *exp);
+
 /* Destroy the object created in expression_parse */
 void expression_destroy(expression_type *exp);
 
@@ -31,6 +31,7 @@
 
 DEFINE_MOCK_FUNC(int, kv_get, const char *, char *, size_t *, unsigned int);
 DEFINE_MOCK_FUNC(int, sensor_cache_read, uint8_t, uint8_t, float *);
+DEFINE_MOCK_FUNC(int, sensor_cache_generation, uint8_t, uint8_t, uint32_t *);
 
 static void init_sensors(const char *json_file, size_t exp_sensors)
 {
@@ -42,6 +43,8 @@ static void init_sensors(const char *json_file, size_t exp_sensors)
   ret = aggregate_sensor_count(&cnt);
   ASSERT(ret == 0, "Getting count succeeds");
   ASSERT(cnt == exp_sensors, "Expected sensors");
+  // Cache generations not tracked, values are never memoized.
+  MOCK_RETURN(sensor_cache_generation, -1);
 }
 
 DEFINE_TEST(test_bad_source_exp)
@@ -224,6 +227,17 @@ DEFINE_TEST(test_cond_lexp)
   ASSERT_CALL_COUNT(kv_get, 1, 1, "kv get called once");
   ASSERT_CALL_COUNT(sensor_cache_read, 1, 2, "sensor_cache_read called at least once");
   ASSERT_EQ_FLT(val, 96.0, "Correct value returned");
+  // The key changing after a successful read selects the formula again.
+  MOCK(kv_get, mocked_kv_get2);
+  MOCK(sensor_cache_read, mocked_snr_read1);
+  ret = aggregate_sensor_read(0, &val);
+  ASSERT_EQ(ret, 0, "agg-read success");
+  ASSERT_EQ_FLT(val, 96.0, "Correct value returned");
+  MOCK(kv_get, mocked_kv_get1);
+  MOCK_RETURN(sensor_cache_read, 0);
+  ret = aggregate_sensor_read(0, &val);
+  ASSERT_NEQ(ret, 0, "Agg-sensor should fail once the key changes to an unknown value");
+  ASSERT_CALL_COUNT(sensor_cache_read, 0, 0, "sensor read never called");
 }
 
 DEFINE_TEST(test_lexp_source_exp)
@@ -259,6 +273,59 @@ DEFINE_TEST(test_lexp_source_exp)
   ASSERT_CALL_COUNT(sensor_cache_read, 1, 2, "cache read called at least once");
 }
 
+DEFINE_TEST(test_memo)
+{
+  float val;
+  int ret;
+  time_t ts;
+  static uint32_t gen2 = 0;
+
+  init_sensors("./test_lexp.json", 1);
+
+  int mocked_gen(uint8_t fru, uint8_t snr, uint32_t *gen) {
+    *gen = snr == 2 ? gen2 : 0;
+    return 0;
+  }
+  int mocked_read1(uint8_t fru, uint8_t snr, float *value) {
+    *value = snr == 1 ? 1.0 : 2.0;
+    return 0;
+  }
+  MOCK(sensor_cache_generation, mocked_gen);
+  MOCK(sensor_cache_read, mocked_read1);
+  ret = aggregate_sensor_read_ts(0, &val, &ts);
+  ASSERT_EQ(ret, 0, "sensor read succeeded");
+  ASSERT_EQ_FLT(val, 5.0, "Sensor read returned correct value");
+  ASSERT_CALL_COUNT(sensor_cache_read, 2, 2, "sensor read called exactly twice");
+  ASSERT(ts != 0, "Timestamp of the value returned");
+
+  // Inputs not written since, the value is memoized.
+  MOCK(sensor_cache_read, mocked_read1);
+  ret = aggregate_sensor_read(0, &val);
+  ASSERT_EQ(ret, 0, "sensor read succeeded");
+  ASSERT_EQ_FLT(val, 5.0, "Memoized value returned");
+  ASSERT_CALL_COUNT(sensor_cache_read, 0, 0, "sensor read never called");
+
+  int mocked_read2(uint8_t fru, uint8_t snr, float *value) {
+    *value = snr == 1 ? 1.0 : 3.0;
+    return 0;
+  }
+  // An input written, the value is computed again.
+  gen2++;
+  MOCK(sensor_cache_read, mocked_read2);
+  ret = aggregate_sensor_read(0, &val);
+  ASSERT_EQ(ret, 0, "sensor read succeeded");
+  /* 2.0*1.0 + 3.0*3.0 - 3.0 = 8.0 */
+  ASSERT_EQ_FLT(val, 8.0, "New value returned");
+  ASSERT_CALL_COUNT(sensor_cache_read, 2, 2, "sensor read called exactly twice");
+
+  // Untracked inputs are read every time.
+  MOCK_RETURN(sensor_cache_generation, -1);
+  MOCK(sensor_cache_read, mocked_read2);
+  ret = aggregate_sensor_read(0, &val);
+  ASSERT_EQ(ret, 0, "sensor read succeeded");
+  ASSERT_CALL_COUNT(sensor_cache_read, 2, 2, "sensor read called exactly twice");
+}
+
 int main(int argc, char *argv[])
 {
   if (chdir(dirname(argv[0])) != 0) {
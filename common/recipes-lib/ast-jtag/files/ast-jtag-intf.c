@@ -78,3 +78,9 @@ int ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio)
 {
   return jtag_ops->tdo_xfer(enddr, len, tdio);
 }
+
+int ast_jtag_bulk_xfer(unsigned char type, unsigned char direction, unsigned char end,
+                       unsigned int len, unsigned int *tdio)
+{
+  return jtag_ops->bulk_xfer(type, direction, end, len, tdio);
+}
@@ -11,6 +11,7 @@ struct jtag_ops {
   int (*sir_xfer)(unsigned char,unsigned int, unsigned int);
   int (*tdo_xfer)(unsigned char, unsigned int, unsigned int*);
   int (*tdi_xfer)(unsigned char, unsigned int, unsigned int*);
+  int (*bulk_xfer)(unsigned char, unsigned char, unsigned char, unsigned int, unsigned int*);
 };
 
 #endif
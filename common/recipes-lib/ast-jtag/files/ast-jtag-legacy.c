@@ -251,6 +251,34 @@ static int _ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned in
 	return 0;
 }
 
+/* The legacy driver shifts at most 32 IR bits and 65535 DR bits, one way. */
+static int _ast_jtag_bulk_xfer(unsigned char type, unsigned char direction,
+                               unsigned char end, unsigned int len, unsigned int *tdio)
+{
+	if (tdio == NULL || len == 0) {
+		return -1;
+	}
+
+	if (type == JTAG_SIR_XFER) {
+		if (direction != JTAG_WRITE_XFER) {
+			return -1;
+		}
+		return _ast_jtag_sir_xfer(end, len, tdio[0]);
+	}
+
+	if (len > 0xffff) {
+		return -1;
+	}
+	switch (direction) {
+		case JTAG_WRITE_XFER:
+			return _ast_jtag_tdi_xfer(end, len, tdio);
+		case JTAG_READ_XFER:
+			return _ast_jtag_tdo_xfer(end, len, tdio);
+		default:
+			return -1;
+	}
+}
+
 struct jtag_ops astjtag_ops = {
   _ast_jtag_open,
   _ast_jtag_close,
@@ -260,6 +288,7 @@ struct jtag_ops astjtag_ops = {
   _ast_jtag_run_test_idle,
   _ast_jtag_sir_xfer,
   _ast_jtag_tdo_xfer,
-  _ast_jtag_tdi_xfer
+  _ast_jtag_tdi_xfer,
+  _ast_jtag_bulk_xfer
 };
 
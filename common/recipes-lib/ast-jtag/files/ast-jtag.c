@@ -225,6 +225,39 @@ static int _ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned in
   return retval;
 }
 
+/**
+ * ast_jtag_bulk_xfer
+ *
+ * @type: JTAG_SIR_XFER or JTAG_SDR_XFER
+ * @direction: JTAG_READ_XFER, JTAG_WRITE_XFER or JTAG_READ_WRITE_XFER
+ * @end: end state
+ * @len: data length in bit, not limited to a word
+ * @tdio: data array of (len + 31) / 32 words, TDO replaces TDI on reads
+ */
+static int _ast_jtag_bulk_xfer(unsigned char type, unsigned char direction,
+                               unsigned char end, unsigned int len, unsigned int *tdio)
+{
+  int retval = 0;
+  struct jtag_xfer xfer;
+
+  if (tdio == NULL || len == 0 || jtag_fd == -1) {
+    return -1;
+  }
+
+  xfer.type = type;
+  xfer.direction = direction;
+  xfer.endstate = end;
+  xfer.length = len;
+  xfer.tdio = (unsigned long int)tdio;
+
+  retval = ioctl(jtag_fd, JTAG_IOCXFER, &xfer);
+  if (retval == -1) {
+    perror("ioctl JTAG bulk xfer fail!\n");
+  }
+
+  return retval;
+}
+
 struct jtag_ops jtag0_ops = {
   _ast_jtag_open,
   _ast_jtag_close,
@@ -234,6 +267,7 @@ struct jtag_ops jtag0_ops = {
   _ast_jtag_run_test_idle,
   _ast_jtag_sir_xfer,
   _ast_jtag_tdo_xfer,
-  _ast_jtag_tdi_xfer
+  _ast_jtag_tdi_xfer,
+  _ast_jtag_bulk_xfer
 };
 
@@ -17,5 +17,7 @@ int ast_jtag_run_test_idle(unsigned char reset, unsigned char end, unsigned char
 int ast_jtag_sir_xfer(unsigned char endir, unsigned int len, unsigned int tdi);
 int ast_jtag_tdo_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio);
 int ast_jtag_tdi_xfer(unsigned char enddr, unsigned int len, unsigned int *tdio);
+int ast_jtag_bulk_xfer(unsigned char type, unsigned char direction, unsigned char end,
+                       unsigned int len, unsigned int *tdio);
 
 #endif /* __AST_JTAG_H__ */
@@ -2,20 +2,22 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #include <openbmc/ast-jtag.h>
 #include "cpld.h"
 #include "lattice.h"
 
-#define MAX_RETRY 4000
 #define LATTICE_COL_SIZE 128
+#define LATTICE_ROW_WORDS (LATTICE_COL_SIZE / 32)
+//BUSY/status polling: deadline and interval between reads
+#define LATTICE_STATUS_TIMEOUT_MS 4000
+#define LATTICE_POLL_US 50
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
 typedef struct
 {
   unsigned long int QF;
-  unsigned int *CF;
   unsigned int CF_Line;
-  unsigned int *UFM;
   unsigned int UFM_Line;
   unsigned int Version;
   unsigned int CheckSum;
@@ -24,6 +26,14 @@ typedef struct
 
 } CPLDInfo;
 
+/*
+ * Consumer of the fuse rows streamed by LCMXO2Family_JED_File_Parser():
+ * line is the index of the row in the CF or UFM, row its 128 bits.
+ * A non-zero return stops the parsing.
+ */
+typedef int (*lattice_row_fn)(CPLDInfo *dev_info, int is_ufm, unsigned int line,
+                              unsigned int *row);
+
 //#define CPLD_DEBUG //enable debug message
 //#define VERBOSE_DEBUG //enable detail debug message
 
@@ -133,206 +143,136 @@ ShiftData(char *data, unsigned int *result, int len)
   return ret;
 }
 
+static long long
+lattice_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*poll BUSY or the status register until clear or LATTICE_STATUS_TIMEOUT_MS*/
 static unsigned int
 LCMXO2Family_Check_Device_Status(int mode)
 {
-  int RETRY = MAX_RETRY;
   unsigned int buf[4] = {0};
+  unsigned int ins, len, shift, mask;
+  long long deadline;
 
   switch (mode)
   {
     case CHECK_BUSY:
-//      ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-      do
-      {
-	ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_CHECK_BUSY);
-	usleep(1000);
-
-	buf[0] = 0x0;
-
-	ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 8, &buf[0]);
-
-	buf[0] = (buf[0] >> 7) & 0x1;
-
-	if (buf[0] == 0x0)
-	{
-	  break;
-	}
-	RETRY--;
-
-      } while ( RETRY );
+      ins = LCMXO2_LSC_CHECK_BUSY;
+      len = 8;
+      shift = 7;
+      mask = 0x1;
       break;
 
     case CHECK_STATUS:
-//      ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-      do
-      {
-	ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_READ_STATUS);
-	usleep(1000);
-
-	buf[0] = 0x0;
-
-	ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, 32, &buf[0]);
-
-	buf[0] = (buf[0] >> 12) & 0x3;
-
-	if (buf[0] == 0x0)
-	{
-	  break;
-	}
-	RETRY--;
-      } while ( RETRY );
+      ins = LCMXO2_LSC_READ_STATUS;
+      len = 32;
+      shift = 12;
+      mask = 0x3;
       break;
 
     default:
-      break;
-
+      return 0;
   }
 
-  return buf[0];
-}
-
-/*write cf data*/
-static int
-LCMXO2Family_SendCFdata(CPLDInfo *dev_info)
-{
-  int ret = 0;
-  int CurrentAddr = 0;
-  int i;
-  unsigned status;
-
-  for (i = 0; i < dev_info->CF_Line; i++)
+  deadline = lattice_now_us() + LATTICE_STATUS_TIMEOUT_MS * 1000LL;
+  for (;;)
   {
-    printf("Writing Data: %d/%u (%.2f%%) \r",(i+1), dev_info->CF_Line, (((i+1)/(float)dev_info->CF_Line)*100));
-
-    CurrentAddr = (i * LATTICE_COL_SIZE) / 32;
+    ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, ins);
 
-    //RUNTEST    IDLE    15 TCK    1.00E-003 SEC;
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
+    buf[0] = 0x0;
 
-    //set page to program page
-    ast_jtag_sir_xfer(JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
+    ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, len, &buf[0]);
 
-    //send data
-    ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &dev_info->CF[CurrentAddr]);
+    buf[0] = (buf[0] >> shift) & mask;
 
-    //usleep(1000);
-
-    status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
-    if (status != 0)
+    if (buf[0] == 0x0 || lattice_now_us() >= deadline)
     {
-      printf("[%s]Write CF Error, status = %x\n", __func__, status);
-      ret = -1;
       break;
     }
+    usleep(LATTICE_POLL_US);
   }
 
-  printf("\n");
-
-  return ret;
+  return buf[0];
 }
 
-/*write ufm data if need*/
+/*program one row right as it is parsed, the UFM after the CF*/
 static int
-LCMXO2Family_SendUFMdata(CPLDInfo *dev_info)
+LCMXO2Family_Program_Row(CPLDInfo *dev_info, int is_ufm, unsigned int line,
+                         unsigned int *row)
 {
-  int ret = 0;
-  int CurrentAddr = 0;
-  int i;
   unsigned int status;
 
-  for (i = 0; i < dev_info->UFM_Line; i++)
+  if (!is_ufm)
   {
-    CurrentAddr = (i * LATTICE_COL_SIZE) / 32;
-
-    //RUNTEST    IDLE    15 TCK    1.00E-003 SEC;
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-
-    //set page to program page
-    ast_jtag_sir_xfer(JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
+    printf("Writing Data: %u/%u (%.2f%%) \r", (line+1), dev_info->CF_Line, (((line+1)/(float)dev_info->CF_Line)*100));
+  }
+  else if (line == 0)
+  {
+    printf("\n");
+    //program UFM
+    ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDR_UFM);
+  }
 
-    //send data
-    ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, &dev_info->UFM[CurrentAddr]);
+  //set page to program page
+  ast_jtag_sir_xfer(JTAG_STATE_PAUSEIR, LATTICE_INS_LENGTH, LCMXO2_LSC_PROG_INCR_NV);
 
-    //usleep(1000);
-
-    status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
-    if (status != 0)
-    {
-      printf("[%s]Write UFM Error, status = %x\n", __func__, status);
-      ret = -1;
-      break;
-    }
+  //send data
+  ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, row);
 
+  status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
+  if (status != 0)
+  {
+    printf("[%s]Write %s Error, status = %x\n", __func__, is_ufm ? "UFM" : "CF", status);
+    return -1;
   }
 
-  return ret;
+  return 0;
 }
 
-/*check the size of cf and ufm*/
+/*read back one row and compare it with the one parsed*/
 static int
-LCMXO2Family_Get_Update_Data_Size(FILE *jed_fd, int *cf_size, int *ufm_size)
+LCMXO2Family_Verify_Row(CPLDInfo *dev_info, int is_ufm, unsigned int line,
+                        unsigned int *row)
 {
-  const char TAG_CF_START[] = "L000";
-  int ReadLineSize = LATTICE_COL_SIZE;
-  char tmp_buf[ReadLineSize];
-  unsigned int CFStart = 0;
-  unsigned int UFMStart = 0;
-  const char TAG_UFM[] = "NOTE TAG DATA";
-  int ret = 0;
+  unsigned int buff[LATTICE_ROW_WORDS] = {0};
 
-  while( NULL != fgets(tmp_buf, ReadLineSize, jed_fd) )
+  //only the CF is verified
+  if (is_ufm)
   {
-    if ( startWith(tmp_buf, TAG_CF_START/*"L000"*/) )
-    {
-      CFStart = 1;
-    }
-    else if ( startWith(tmp_buf, TAG_UFM/*"NOTE TAG DATA"*/) )
-    {
-      UFMStart = 1;
-    }
-
-    if ( CFStart )
-    {
-      if ( !startWith(tmp_buf, TAG_CF_START/*"L000"*/) && strlen(tmp_buf) != 1 )
-      {
-        if ( startWith(tmp_buf,"0") || startWith(tmp_buf,"1") )
-        {
-          (*cf_size)++;
-        }
-        else
-        {
-           CFStart = 0;
-        }
-      }
-    }
-    else if ( UFMStart )
-    {
-      if ( !startWith(tmp_buf, TAG_UFM/*"NOTE TAG DATA"*/) && !startWith(tmp_buf, "L") && strlen(tmp_buf) != 1 )
-      {
-        if ( startWith(tmp_buf,"0") || startWith(tmp_buf,"1") )
-        {
-          (*ufm_size)++;
-        }
-        else
-        {
-          UFMStart = 0;
-        }
-      }
-    }
+    return 0;
   }
 
-  //cf must greater than 0
-  if ( !(*cf_size) )
+  printf("Verify Data: %u/%u (%.2f%%) \r", (line+1), dev_info->CF_Line, (((line+1)/(float)dev_info->CF_Line)*100));
+
+  ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, buff);
+
+  if (memcmp(buff, row, sizeof(buff)))
   {
-    ret = -1;
+#ifdef CPLD_DEBUG
+    printf("\nPage#%u (%x %x %x %x) did not match with CF (%x %x %x %x)\n",
+           line, buff[0], buff[1], buff[2], buff[3],
+           row[0], row[1], row[2], row[3]);
+#endif
+    return -1;
   }
 
-  return ret;
+  return 0;
 }
 
+/*
+ * Parse the JED file, passing every CF and UFM row to row_fn (if any) as
+ * it is read, so that no fuse map is held in memory. Sets the CF/UFM line
+ * counts, QF, version, features and checksum of dev_info; the checksum
+ * is checked once the whole file went through.
+ */
 static int
-LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int ufm_size)
+LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, lattice_row_fn row_fn)
 {
   /**TAG Information**/
   const char TAG_QF[] = "QF";
@@ -346,6 +286,9 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
   int ReadLineSize = LATTICE_COL_SIZE + 2;//the len of 128 only contain data size, '\n' need to be considered, too.
   char tmp_buf[ReadLineSize];
   char data_buf[LATTICE_COL_SIZE];
+  unsigned int row[LATTICE_ROW_WORDS];
+  unsigned int cf_line = 0;
+  unsigned int ufm_line = 0;
   unsigned int CFStart = 0;
   unsigned int UFMStart = 0;
   unsigned int ROWStart = 0;
@@ -353,25 +296,10 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
   unsigned int ChkSUMStart = 0;
   unsigned int JED_CheckSum = 0;
   int copy_size;
-  int current_addr=0;
   int i;
   int ret = 0;
-  int cf_size_used = (cf_size * LATTICE_COL_SIZE) / 8; // unit: bytes
-  int ufm_size_used = (ufm_size * LATTICE_COL_SIZE) / 8; // unit: bytes
 
-  dev_info->CF = (unsigned int*)malloc( cf_size_used );
-  memset(dev_info->CF, 0, cf_size_used);
-
-  if ( ufm_size_used )
-  {
-    dev_info->UFM = (unsigned int*)malloc( ufm_size_used );
-    memset(dev_info->UFM, 0, ufm_size_used);
-  }
-
-  dev_info->CF_Line=0;
-  dev_info->UFM_Line=0;
-
-  while( NULL != fgets(tmp_buf, ReadLineSize, jed_fd) )
+  while( ret == 0 && NULL != fgets(tmp_buf, ReadLineSize, jed_fd) )
   {
     if ( startWith(tmp_buf, TAG_QF/*"QF"*/) )
     {
@@ -432,32 +360,35 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
       {
         if ( startWith(tmp_buf,"0") || startWith(tmp_buf,"1") )
         {
-          current_addr = (dev_info->CF_Line * LATTICE_COL_SIZE) / 32;
-
           memset(data_buf, 0, sizeof(data_buf));
+          memset(row, 0, sizeof(row));
 
           memcpy(data_buf, tmp_buf, LATTICE_COL_SIZE);
 
           /*convert string to byte data*/
-          ShiftData(data_buf, &dev_info->CF[current_addr], LATTICE_COL_SIZE);
+          ShiftData(data_buf, row, LATTICE_COL_SIZE);
 #ifdef VERBOSE_DEBUG
-          printf("[%u]%x %x %x %x\n",dev_info->CF_Line, dev_info->CF[current_addr],dev_info->CF[current_addr+1],dev_info->CF[current_addr+2],dev_info->CF[current_addr+3]);
+          printf("[%u]%x %x %x %x\n", cf_line, row[0], row[1], row[2], row[3]);
 #endif
           //each data has 128bits(4*unsigned int), so the for-loop need to be run 4 times
-          for ( i = 0; i < sizeof(unsigned int); i++ )
+          for ( i = 0; i < LATTICE_ROW_WORDS; i++ )
           {
-            JED_CheckSum += (dev_info->CF[current_addr+i]>>24) & 0xff;
-            JED_CheckSum += (dev_info->CF[current_addr+i]>>16) & 0xff;
-            JED_CheckSum += (dev_info->CF[current_addr+i]>>8)  & 0xff;
-            JED_CheckSum += (dev_info->CF[current_addr+i])     & 0xff;
+            JED_CheckSum += (row[i]>>24) & 0xff;
+            JED_CheckSum += (row[i]>>16) & 0xff;
+            JED_CheckSum += (row[i]>>8)  & 0xff;
+            JED_CheckSum += (row[i])     & 0xff;
           }
 
-            dev_info->CF_Line++;
+          if ( row_fn )
+          {
+            ret = row_fn(dev_info, 0, cf_line, row);
+          }
+          cf_line++;
         }
         else
         {
 #ifdef CPLD_DEBUG
-          printf("[%s]CF Line: %u\n", __func__, dev_info->CF_Line);
+          printf("[%s]CF Line: %u\n", __func__, cf_line);
 #endif
           CFStart = 0;
         }
@@ -534,22 +465,25 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
       {
         if ( startWith(tmp_buf,"0") || startWith(tmp_buf,"1") )
         {
-          current_addr = (dev_info->UFM_Line * LATTICE_COL_SIZE) / 32;
-
           memset(data_buf, 0, sizeof(data_buf));
+          memset(row, 0, sizeof(row));
 
           memcpy(data_buf, tmp_buf, LATTICE_COL_SIZE);
 
-          ShiftData(data_buf, &dev_info->UFM[current_addr], LATTICE_COL_SIZE);
+          ShiftData(data_buf, row, LATTICE_COL_SIZE);
 #ifdef VERBOSE_DEBUG
-          printf("%x %x %x %x\n",dev_info->UFM[current_addr],dev_info->UFM[current_addr+1],dev_info->UFM[current_addr+2],dev_info->UFM[current_addr+3]);
+          printf("%x %x %x %x\n", row[0], row[1], row[2], row[3]);
 #endif
-          dev_info->UFM_Line++;
+          if ( row_fn )
+          {
+            ret = row_fn(dev_info, 1, ufm_line, row);
+          }
+          ufm_line++;
         }
         else
         {
 #ifdef CPLD_DEBUG
-          printf("[%s]UFM Line: %u\n", __func__, dev_info->UFM_Line);
+          printf("[%s]UFM Line: %u\n", __func__, ufm_line);
 #endif
           UFMStart = 0;
         }
@@ -557,9 +491,23 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
     }
   }
 
+  if ( ret != 0 )
+  {
+    return ret;
+  }
+
+  dev_info->CF_Line = cf_line;
+  dev_info->UFM_Line = ufm_line;
+
   JED_CheckSum = JED_CheckSum & 0xffff;
 
-  if ( dev_info->CheckSum != JED_CheckSum || dev_info->CheckSum == 0)
+  //cf must greater than 0
+  if ( dev_info->CF_Line == 0 )
+  {
+    printf("[%s] JED File has no CF data\n", __func__);
+    ret = -1;
+  }
+  else if ( dev_info->CheckSum != JED_CheckSum || dev_info->CheckSum == 0)
   {
     printf("[%s] JED File CheckSum Error\n", __func__);
     ret = -1;
@@ -574,12 +522,10 @@ LCMXO2Family_JED_File_Parser(FILE *jed_fd, CPLDInfo *dev_info, int cf_size, int
 }
 
 static int
-LCMXO2Family_cpld_verify(CPLDInfo *dev_info)
+LCMXO2Family_cpld_verify(FILE *jed_fd, CPLDInfo *dev_info)
 {
-  int i;
-  int result;
-  int current_addr = 0;
   unsigned int buff[4] = {0};
+  unsigned int status;
   int ret = 0;
 
 //  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
@@ -587,41 +533,27 @@ LCMXO2Family_cpld_verify(CPLDInfo *dev_info)
 
   buff[0] = 0x04;
   ast_jtag_tdi_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, &buff[0]);
-  usleep(1000);
+
+  status = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
+  if (status != 0)
+  {
+    printf("[%s] Device Busy, status = %x\n", __func__, status);
+    return -1;
+  }
 
 //  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
   ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_READ_INCR_NV);
+  //the first page is fetched on READ_INCR_NV, which polling BUSY would replace
   usleep(1000);
 
 #ifdef CPLD_DEBUG
   printf("[%s] dev_info->CF_Line: %u\n", __func__, dev_info->CF_Line);
 #endif
 
-  for(i = 0; i < dev_info->CF_Line; i++)
-  {
-    printf("Verify Data: %d/%u (%.2f%%) \r",(i+1), dev_info->CF_Line, (((i+1)/(float)dev_info->CF_Line)*100));
-
-    current_addr = (i * LATTICE_COL_SIZE) / 32;
-
-    memset(buff, 0, sizeof(buff));
-
-    ast_jtag_tdo_xfer(JTAG_STATE_TLRESET, LATTICE_COL_SIZE, buff);
-
-    result = memcmp(buff, &dev_info->CF[current_addr], sizeof(unsigned int));
-
-    if (result)
-    {
-
-#ifdef CPLD_DEBUG
-      printf("\nPage#%d (%x %x %x %x) did not match with CF (%x %x %x %x)\n",
-	     i, buff[0], buff[1], buff[2], buff[3],
-	     dev_info->CF[current_addr], dev_info->CF[current_addr+1],
-	     dev_info->CF[current_addr+2], dev_info->CF[current_addr+3]);
-#endif
-      ret = -1;
-      break;
-    }
-  }
+  //the rows are compared as they are parsed again
+  fseek(jed_fd, 0, SEEK_SET);
+  ret = LCMXO2Family_JED_File_Parser(jed_fd, dev_info, LCMXO2Family_Verify_Row);
+  ret = ret ? -1 : 0;
 
   printf("\n");
 
@@ -826,7 +758,7 @@ LCMXO2Family_cpld_Erase(int erase_type)
 }
 
 static int
-LCMXO2Family_cpld_program(CPLDInfo *dev_info)
+LCMXO2Family_cpld_program(FILE *jed_fd, CPLDInfo *dev_info)
 {
   int ret = 0;
   unsigned int dr_data[4] = {0};
@@ -843,25 +775,16 @@ LCMXO2Family_cpld_program(CPLDInfo *dev_info)
   printf("[%s] INIT_ADDRESS(0x46) \n", __func__);
 #endif
 
-  ret = LCMXO2Family_SendCFdata(dev_info);
-  if (ret < 0)
+  //the rows go to the device as they are parsed
+  fseek(jed_fd, 0, SEEK_SET);
+  ret = LCMXO2Family_JED_File_Parser(jed_fd, dev_info, LCMXO2Family_Program_Row);
+  printf("\n");
+  if (ret != 0)
   {
+    ret = -1;
     goto error_exit;
   }
 
-  if (dev_info->UFM_Line)
-  {
-//    ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
-    //program UFM
-    ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_LSC_INIT_ADDR_UFM);
-
-    ret = LCMXO2Family_SendUFMdata(dev_info);
-    if (ret < 0)
-    {
-      goto error_exit;
-    }
-  }
-
 #ifdef CPLD_DEBUG
   printf("[%s] Update CPLD done \n", __func__);
 #endif
@@ -891,7 +814,14 @@ LCMXO2Family_cpld_program(CPLDInfo *dev_info)
 
 //  ast_jtag_run_test_idle(0, JTAG_STATE_TLRESET, 3);
   ast_jtag_sir_xfer(JTAG_STATE_TLRESET, LATTICE_INS_LENGTH, LCMXO2_ISC_PROGRAM_USERCOD);
-  usleep(2000);
+
+  dr_data[0] = LCMXO2Family_Check_Device_Status(CHECK_BUSY);
+  if (dr_data[0] != 0)
+  {
+    printf("[%s] Device Busy, status = %x\n", __func__, dr_data[0]);
+    ret = -1;
+    goto error_exit;
+  }
 
 #ifdef CPLD_DEBUG
   printf("[%s] PROGRAM USERCODE(0xC2)\n", __func__);
@@ -958,8 +888,6 @@ int
 LCMXO2Family_cpld_update(FILE *jed_fd, char* key, char is_signed)
 {
   CPLDInfo dev_info = {0};
-  int cf_size = 0;
-  int ufm_size = 0;
   int erase_type = 0;
   int ret;
 
@@ -977,19 +905,8 @@ LCMXO2Family_cpld_update(FILE *jed_fd, char* key, char is_signed)
   //set file pointer to the beginning
   fseek(jed_fd, 0, SEEK_SET);
 
-  //get update data size
-  ret = LCMXO2Family_Get_Update_Data_Size(jed_fd, &cf_size, &ufm_size);
-  if ( ret < 0 )
-  {
-    printf("[%s] Update Data Size Error!\n", __func__);
-    goto error_exit;
-  }
-
-  //set file pointer to the beginning
-  fseek(jed_fd, 0, SEEK_SET);
-
-  //parse info from JED file and calculate checksum
-  ret = LCMXO2Family_JED_File_Parser(jed_fd, &dev_info, cf_size, ufm_size);
+  //parse info from JED file and calculate checksum, before anything is erased
+  ret = LCMXO2Family_JED_File_Parser(jed_fd, &dev_info, NULL);
   if ( ret < 0 )
   {
     printf("[%s] JED file CheckSum Error!\n", __func__);
@@ -1019,14 +936,14 @@ LCMXO2Family_cpld_update(FILE *jed_fd, char* key, char is_signed)
     goto error_exit;
   }
 
-  ret = LCMXO2Family_cpld_program(&dev_info);
+  ret = LCMXO2Family_cpld_program(jed_fd, &dev_info);
   if ( ret < 0 )
   {
     printf("[%s] Program failed!\n", __func__);
     goto error_exit;
   }
 
-  ret = LCMXO2Family_cpld_verify(&dev_info);
+  ret = LCMXO2Family_cpld_verify(jed_fd, &dev_info);
   if ( ret < 0 )
   {
     printf("[%s] Verify Failed!\n", __func__);
@@ -1041,16 +958,6 @@ LCMXO2Family_cpld_update(FILE *jed_fd, char* key, char is_signed)
   }
 
 error_exit:
-  if ( NULL != dev_info.CF )
-  {
-    free(dev_info.CF);
-  }
-
-  if ( NULL != dev_info.UFM )
-  {
-    free(dev_info.UFM);
-  }
-
   return ret;
 }
 
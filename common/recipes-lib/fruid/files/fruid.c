@@ -22,6 +22,10 @@
 #include <string.h>
 #include <syslog.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "fruid.h"
 #include <stdbool.h>
 
@@ -1177,6 +1181,265 @@ int fruid_parse_eeprom(const uint8_t * eeprom, int eeprom_len, fruid_info_t * fr
   return ret;
 }
 
+/* Fields of fruid_lazy_t, by the enum in fruid.h */
+#define FRUID_NUM_FIELDS  (PCD6 + 1)
+/* Unreferenced binaries kept decoded */
+#define FRUID_CACHE_SIZE  16
+
+enum {
+  AREA_UNKNOWN = 0,
+  AREA_VALID,
+  AREA_INVALID,
+};
+
+struct fruid_lazy_t {
+  struct fruid_lazy_t *next;
+  int refcnt;
+  bool stale;
+  dev_t dev;
+  ino_t ino;
+  struct timespec mtime;
+  off_t size;
+  uint8_t *eeprom;
+  fruid_header_t header;
+  uint8_t area_state[FRUID_OFFSET_AREA_MULTIRECORD];
+  bool decoded[FRUID_NUM_FIELDS];
+  char *field[FRUID_NUM_FIELDS];
+};
+
+static struct fruid_lazy_t *g_fruid_cache = NULL;
+static pthread_mutex_t g_fruid_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void fruid_lazy_free(fruid_lazy_t *fru)
+{
+  int i;
+
+  for (i = 0; i < FRUID_NUM_FIELDS; i++) {
+    free(fru->field[i]);
+  }
+  free(fru->eeprom);
+  free(fru);
+}
+
+/* Drop the stale and the least recently used unreferenced binaries
+ * beyond FRUID_CACHE_SIZE. Called with g_fruid_cache_lock held. */
+static void fruid_cache_trim(void)
+{
+  struct fruid_lazy_t **pp = &g_fruid_cache, *fru;
+  int cnt = 0;
+
+  while ((fru = *pp) != NULL) {
+    if (fru->refcnt == 0 && (fru->stale || ++cnt > FRUID_CACHE_SIZE)) {
+      *pp = fru->next;
+      fruid_lazy_free(fru);
+    } else {
+      pp = &fru->next;
+    }
+  }
+}
+
+static fruid_lazy_t * fruid_lazy_load(const char *bin, struct stat *st)
+{
+  fruid_lazy_t *fru;
+  ssize_t len;
+  int fd;
+
+  if (st->st_size < (off_t)sizeof(fruid_header_t)) {
+    syslog(LOG_WARNING, "fruid: file %s is too short", bin);
+    return NULL;
+  }
+  fru = calloc(1, sizeof(*fru));
+  if (!fru) {
+    return NULL;
+  }
+  fru->eeprom = malloc(st->st_size);
+  fd = open(bin, O_RDONLY);
+  if (!fru->eeprom || fd < 0) {
+    goto bail;
+  }
+  len = read(fd, fru->eeprom, st->st_size);
+  close(fd);
+  fd = -1;
+  if (len != st->st_size || parse_fruid_header(fru->eeprom, &fru->header)) {
+    goto bail;
+  }
+  fru->dev = st->st_dev;
+  fru->ino = st->st_ino;
+  fru->mtime = st->st_mtim;
+  fru->size = st->st_size;
+  return fru;
+bail:
+  if (fd >= 0) {
+    close(fd);
+  }
+  fruid_lazy_free(fru);
+  return NULL;
+}
+
+fruid_lazy_t * fruid_open(const char * bin)
+{
+  fruid_lazy_t *fru;
+  struct stat st;
+
+  if (stat(bin, &st)) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&g_fruid_cache_lock);
+  for (fru = g_fruid_cache; fru != NULL; fru = fru->next) {
+    if (fru->stale || fru->dev != st.st_dev || fru->ino != st.st_ino) {
+      continue;
+    }
+    if (fru->size == st.st_size &&
+        fru->mtime.tv_sec == st.st_mtim.tv_sec &&
+        fru->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+      break;
+    }
+    /* Rewritten since, decode it again */
+    fru->stale = true;
+  }
+  if (fru == NULL) {
+    fru = fruid_lazy_load(bin, &st);
+    if (fru != NULL) {
+      fru->next = g_fruid_cache;
+      g_fruid_cache = fru;
+    }
+  }
+  if (fru != NULL) {
+    fru->refcnt++;
+  }
+  fruid_cache_trim();
+  pthread_mutex_unlock(&g_fruid_cache_lock);
+  return fru;
+}
+
+void fruid_close(fruid_lazy_t * fru)
+{
+  struct fruid_lazy_t **pp;
+
+  if (!fru) {
+    return;
+  }
+  pthread_mutex_lock(&g_fruid_cache_lock);
+  fru->refcnt--;
+  /* Most recently used first */
+  for (pp = &g_fruid_cache; *pp != NULL; pp = &(*pp)->next) {
+    if (*pp == fru) {
+      *pp = fru->next;
+      fru->next = g_fruid_cache;
+      g_fruid_cache = fru;
+      break;
+    }
+  }
+  fruid_cache_trim();
+  pthread_mutex_unlock(&g_fruid_cache_lock);
+}
+
+/* Start of the area of the binary, NULL if absent or it fails the
+ * checks of its parse_fruid_area_*() */
+static uint8_t * fruid_lazy_area(fruid_lazy_t *fru, int area)
+{
+  uint8_t offset = 0, area_len;
+  uint8_t *p;
+
+  switch (area) {
+    case FRUID_OFFSET_AREA_CHASSIS:
+      offset = fru->header.offset_area.chassis;
+      break;
+    case FRUID_OFFSET_AREA_BOARD:
+      offset = fru->header.offset_area.board;
+      break;
+    case FRUID_OFFSET_AREA_PRODUCT:
+      offset = fru->header.offset_area.product;
+      break;
+  }
+  if (!offset || offset * FRUID_OFFSET_MULTIPLIER + 2 > fru->size) {
+    return NULL;
+  }
+  p = fru->eeprom + offset * FRUID_OFFSET_MULTIPLIER;
+  if (fru->area_state[area] == AREA_UNKNOWN) {
+    /* As wide as the area_len of fruid_area_*_t */
+    area_len = p[1] * FRUID_AREA_LEN_MULTIPLIER;
+    fru->area_state[area] = AREA_INVALID;
+    if (p[0] == FRUID_FORMAT_VER && area_len > 0 &&
+        p + area_len <= fru->eeprom + fru->size &&
+        verify_chksum(p, area_len, p[area_len - 1]) == 0) {
+      fru->area_state[area] = AREA_VALID;
+    }
+  }
+  return fru->area_state[area] == AREA_VALID ? p : NULL;
+}
+
+static char * fruid_lazy_decode(fruid_lazy_t *fru, int field)
+{
+  int area, pos, fixed, start, i;
+  uint8_t *p, *end;
+
+  if (field >= CPN && field <= CCD6) {
+    area = FRUID_OFFSET_AREA_CHASSIS;
+    pos = field - CPN;
+    /* format, length, type */
+    start = 3;
+    fixed = 2;
+  } else if (field >= BMD && field <= BCD6) {
+    area = FRUID_OFFSET_AREA_BOARD;
+    pos = field - BM;
+    /* format, length, language, manufacturing time */
+    start = 6;
+    fixed = 5;
+  } else if (field >= PM && field <= PCD6) {
+    area = FRUID_OFFSET_AREA_PRODUCT;
+    pos = field - PM;
+    /* format, length, language */
+    start = 3;
+    fixed = 7;
+  } else {
+    return NULL;
+  }
+
+  p = fruid_lazy_area(fru, area);
+  if (!p) {
+    return NULL;
+  }
+  if (field == BMD) {
+    return calculate_time(&p[3]);
+  }
+
+  end = p + (uint8_t)(p[1] * FRUID_AREA_LEN_MULTIPLIER);
+  p += start;
+  for (i = 0; ; i++) {
+    /* The custom fields end at NO_MORE_DATA_BYTE */
+    if (p >= end || (i >= fixed && *p == NO_MORE_DATA_BYTE)) {
+      return NULL;
+    }
+    if (i == pos) {
+      break;
+    }
+    p += FIELD_LEN(*p) + 1;
+  }
+  if (p + FIELD_LEN(*p) + 1 > end) {
+    return NULL;
+  }
+  return _fruid_area_field_read(p);
+}
+
+const char * fruid_get_field(fruid_lazy_t * fru, int field)
+{
+  const char *value;
+
+  if (!fru || field < 0 || field >= FRUID_NUM_FIELDS) {
+    return NULL;
+  }
+  pthread_mutex_lock(&g_fruid_cache_lock);
+  if (!fru->decoded[field]) {
+    fru->field[field] = fruid_lazy_decode(fru, field);
+    fru->decoded[field] = true;
+  }
+  value = fru->field[field];
+  pthread_mutex_unlock(&g_fruid_cache_lock);
+  return value;
+}
+
 static
 char *extract_content(const char *content) {
   int i = 0, j = 0;
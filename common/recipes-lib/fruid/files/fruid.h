@@ -420,6 +420,19 @@ enum {
 int fruid_parse(const char * bin, fruid_info_t * fruid);
 int fruid_parse_eeprom(const uint8_t * eeprom, int eeprom_len, fruid_info_t * fruid);
 void free_fruid_info(fruid_info_t * fruid);
+
+/* Lazily decoded FRUID binary, see fruid_open() */
+typedef struct fruid_lazy_t fruid_lazy_t;
+
+/* Read the FRUID binary and verify its common header, without decoding
+ * any area. Opens of a file unchanged since (by inode, mtime and size)
+ * share it and the fields decoded so far. NULL on error. */
+fruid_lazy_t * fruid_open(const char * bin);
+/* The decoded field (CPN ... PCD6 above), as in fruid_info_t. Only its
+ * area is verified. NULL if the area or field is absent or invalid.
+ * Valid until fruid_close(). */
+const char * fruid_get_field(fruid_lazy_t * fru, int field);
+void fruid_close(fruid_lazy_t * fru);
 int fruid_modify(const char * cur_bin, const char * new_bin, const char * field, const char * content);
 
 #ifdef __cplusplus
@@ -27,6 +27,9 @@
 #include <errno.h>
 #include <assert.h>
 #include <libgen.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <linux/limits.h>
@@ -35,6 +38,11 @@
 
 #define GPIO_SHADOW_PATH_MAX 128
 
+/*
+ * Default number of threads running the handlers of gpio_poll().
+ */
+#define GPIOPOLL_NUM_WORKERS	4
+
 /*
  * Global variables.
  */
@@ -241,6 +249,290 @@ static void gpio_desc_free(gpio_desc_t *gdesc)
 		free(gdesc);
 }
 
+/*
+ * Descriptors opened by the *_by_shadow() functions are cached (up to
+ * GPIO_DESC_CACHE_MAX, least recently used first out) and shared by all
+ * the threads of the process. The shadow symlink is checked on every
+ * use, so a pin unexported (or exported again) by another process is
+ * opened again; gpio_unexport() drops the descriptor at once.
+ */
+#define GPIO_DESC_CACHE_MAX	32
+
+struct gpio_desc_cache {
+	struct gpio_desc_cache *next;
+	gpio_desc_t *desc;
+};
+
+static pthread_mutex_t g_desc_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct gpio_desc_cache *g_desc_cache = NULL;
+
+/* Drop the descriptor of the shadow path, called with g_desc_lock held. */
+static void gpio_desc_cache_drop(const char *shadow_path)
+{
+	struct gpio_desc_cache **pp, *entry;
+
+	for (pp = &g_desc_cache; *pp != NULL; pp = &(*pp)->next) {
+		entry = *pp;
+		if (strcmp(entry->desc->shadow_path, shadow_path) == 0) {
+			*pp = entry->next;
+			gpio_close(entry->desc);
+			free(entry);
+			return;
+		}
+	}
+}
+
+/*
+ * Get the descriptor of the shadow, called with g_desc_lock held. The
+ * descriptor found (or opened) is moved to the head of the cache.
+ */
+static gpio_desc_t* gpio_desc_cache_get(const char *shadow)
+{
+	int pin_num, count = 0;
+	struct gpio_desc_cache **pp, *entry;
+	char shadow_path[GPIO_SHADOW_PATH_MAX];
+
+	gpio_shadow_abspath(shadow_path, sizeof(shadow_path), shadow);
+	for (pp = &g_desc_cache; *pp != NULL; pp = &(*pp)->next) {
+		entry = *pp;
+		count++;
+		if (strcmp(entry->desc->shadow_path, shadow_path) != 0)
+			continue;
+
+		pin_num = path_islink(shadow_path) ?
+			  gpio_shadow_to_num(shadow_path) : -1;
+		if (pin_num != entry->desc->pin_num) {
+			GLOG_DEBUG("shadow <%s> is remapped\n", shadow_path);
+			gpio_desc_cache_drop(shadow_path);
+			count--;
+			break;
+		}
+		*pp = entry->next;
+		entry->next = g_desc_cache;
+		g_desc_cache = entry;
+		return entry->desc;
+	}
+
+	entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	entry->desc = gpio_open_by_shadow(shadow);
+	if (entry->desc == NULL) {
+		free(entry);
+		return NULL;
+	}
+
+	/* Evict the least recently used descriptor */
+	if (count >= GPIO_DESC_CACHE_MAX) {
+		for (pp = &g_desc_cache; (*pp)->next != NULL; pp = &(*pp)->next)
+			;
+		gpio_close((*pp)->desc);
+		free(*pp);
+		*pp = NULL;
+	}
+	entry->next = g_desc_cache;
+	g_desc_cache = entry;
+	return entry->desc;
+}
+
+/*
+ * The pins of a shadow list are cached by gpio_get_value_by_shadow_list()
+ * and gpio_set_value_by_shadow_list(): as one chardev line set when the
+ * pins can be requested (so they are read/written at once), or as the
+ * opened gpio descriptors otherwise (the pins are exported through
+ * sysfs).
+ */
+#define GPIO_LIST_CACHE_MAX	8
+
+struct gpio_list_cache {
+	struct gpio_list_cache *next;
+	size_t num;
+	char **shadows;
+	gpio_lines_t *lines;
+	gpio_desc_t **descs;
+};
+
+static pthread_mutex_t g_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct gpio_list_cache *g_list_cache = NULL;
+
+static void gpio_list_free(struct gpio_list_cache *entry)
+{
+	size_t i;
+
+	gpio_chardev_release_lines(entry->lines);
+	for (i = 0; i < entry->num; i++) {
+		if (entry->descs && entry->descs[i])
+			gpio_close(entry->descs[i]);
+		if (entry->shadows && entry->shadows[i])
+			free(entry->shadows[i]);
+	}
+	free(entry->descs);
+	free(entry->shadows);
+	free(entry);
+}
+
+/*
+ * Open the pins of the shadow list: the descriptors of the pins are
+ * closed once the chardev lines are requested, unless "keep_descs" is
+ * set (a gpio group waits for the edges of its pins on them).
+ */
+static struct gpio_list_cache* gpio_list_open(const char *const *shadows,
+					      size_t num, bool keep_descs)
+{
+	size_t i;
+	int pin_nums[sizeof(unsigned int) * 8];
+	struct gpio_list_cache *entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return NULL;
+	entry->num = num;
+	entry->shadows = calloc(num, sizeof(entry->shadows[0]));
+	entry->descs = calloc(num, sizeof(entry->descs[0]));
+	if (entry->shadows == NULL || entry->descs == NULL)
+		goto error;
+
+	for (i = 0; i < num; i++) {
+		entry->shadows[i] = strdup(shadows[i]);
+		entry->descs[i] = gpio_open_by_shadow(shadows[i]);
+		if (entry->shadows[i] == NULL || entry->descs[i] == NULL)
+			goto error;
+		pin_nums[i] = entry->descs[i]->pin_num;
+	}
+
+	entry->lines = gpio_chardev_request_lines(pin_nums, num);
+	if (entry->lines != NULL && !keep_descs) {
+		for (i = 0; i < num; i++) {
+			gpio_close(entry->descs[i]);
+			entry->descs[i] = NULL;
+		}
+	}
+	return entry;
+
+error:
+	gpio_list_free(entry);
+	return NULL;
+}
+
+/*
+ * Look up the shadow list in the cache, called with g_list_lock held.
+ * The entry found (or opened) is moved to the head of the cache.
+ */
+static struct gpio_list_cache* gpio_list_lookup(const char *const *shadows,
+						size_t num)
+{
+	size_t i, count = 0;
+	struct gpio_list_cache **pp, *entry;
+
+	for (pp = &g_list_cache; *pp != NULL; pp = &(*pp)->next) {
+		entry = *pp;
+		count++;
+		if (entry->num != num)
+			continue;
+		for (i = 0; i < num; i++) {
+			if (strcmp(entry->shadows[i], shadows[i]) != 0)
+				break;
+		}
+		if (i == num) {
+			*pp = entry->next;
+			entry->next = g_list_cache;
+			g_list_cache = entry;
+			return entry;
+		}
+	}
+
+	entry = gpio_list_open(shadows, num, false);
+	if (entry == NULL)
+		return NULL;
+
+	/* Evict the least recently used entry */
+	if (count >= GPIO_LIST_CACHE_MAX) {
+		for (pp = &g_list_cache; (*pp)->next != NULL; pp = &(*pp)->next)
+			;
+		gpio_list_free(*pp);
+		*pp = NULL;
+	}
+	entry->next = g_list_cache;
+	g_list_cache = entry;
+	return entry;
+}
+
+/* Drop the head of the cache, called with g_list_lock held. */
+static void gpio_list_drop(void)
+{
+	struct gpio_list_cache *entry = g_list_cache;
+
+	g_list_cache = entry->next;
+	gpio_list_free(entry);
+}
+
+/* Drop the cached lists with the shadow. */
+static void gpio_list_cache_drop(const char *shadow)
+{
+	size_t i;
+	struct gpio_list_cache **pp, *entry;
+
+	pthread_mutex_lock(&g_list_lock);
+	for (pp = &g_list_cache; *pp != NULL; ) {
+		entry = *pp;
+		for (i = 0; i < entry->num; i++) {
+			if (strcmp(entry->shadows[i], shadow) == 0)
+				break;
+		}
+		if (i < entry->num) {
+			*pp = entry->next;
+			gpio_list_free(entry);
+		} else {
+			pp = &entry->next;
+		}
+	}
+	pthread_mutex_unlock(&g_list_lock);
+}
+
+static int gpio_list_get(struct gpio_list_cache *entry, unsigned int *mask)
+{
+	size_t i;
+	gpio_value_t value;
+
+	if (entry->lines != NULL)
+		return gpio_chardev_get_lines(entry->lines, mask);
+
+	*mask = 0;
+	for (i = 0; i < entry->num; i++) {
+		if (gpio_get_value(entry->descs[i], &value))
+			return -1;
+		*mask |= (value == GPIO_VALUE_HIGH ? 1 : 0) << i;
+	}
+	return 0;
+}
+
+static int gpio_list_set(struct gpio_list_cache *entry, unsigned int mask)
+{
+	size_t i;
+	gpio_value_t value;
+
+	if (entry->lines != NULL)
+		return gpio_chardev_set_lines(entry->lines, mask);
+
+	for (i = 0; i < entry->num; i++) {
+		value = (mask & (1 << i)) ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+		if (gpio_set_value(entry->descs[i], value))
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * A gpio group is a shadow list opened for the caller instead of the
+ * cache, with an epoll fd (created by the first wait) on its pins.
+ */
+struct gpio_group {
+	struct gpio_list_cache *list;
+	int epoll_fd;
+};
+
 /*
  * Public functions to export/unexport control of gpio pins to userspace.
  */
@@ -326,6 +618,11 @@ int gpio_unexport(const char *shadow)
 		return -1;
 	}
 
+	pthread_mutex_lock(&g_desc_lock);
+	gpio_desc_cache_drop(shadow_path);
+	pthread_mutex_unlock(&g_desc_lock);
+	gpio_list_cache_drop(shadow);
+
 	return GPIO_OPS()->unexport_pin(pin_num, shadow_path);
 }
 
@@ -519,42 +816,55 @@ int gpio_set_init_value(gpio_desc_t *gdesc, gpio_value_t value)
 gpio_value_t gpio_get_value_by_shadow(const char *shadow)
 {
   gpio_value_t value = GPIO_VALUE_INVALID;
-  gpio_desc_t *desc = gpio_open_by_shadow(shadow);
-  if (!desc) {
+  gpio_desc_t *desc;
+
+  if (shadow == NULL) {
+    errno = EINVAL;
     return GPIO_VALUE_INVALID;
   }
-  if (gpio_get_value(desc, &value)) {
+  pthread_mutex_lock(&g_desc_lock);
+  desc = gpio_desc_cache_get(shadow);
+  if (desc && gpio_get_value(desc, &value)) {
     value = GPIO_VALUE_INVALID;
   }
-  gpio_close(desc);
+  pthread_mutex_unlock(&g_desc_lock);
   return value;
 }
 
 int gpio_set_value_by_shadow(const char *shadow, gpio_value_t value)
 {
-  gpio_desc_t *desc = gpio_open_by_shadow(shadow);
-  if (!desc) {
+  gpio_desc_t *desc;
+  int rc = -1;
+
+  if (shadow == NULL) {
+    errno = EINVAL;
     return -1;
   }
-  if (gpio_set_value(desc, value)) {
-    return -1;
+  pthread_mutex_lock(&g_desc_lock);
+  desc = gpio_desc_cache_get(shadow);
+  if (desc) {
+    rc = gpio_set_value(desc, value);
   }
-  gpio_close(desc);
-  return 0;
+  pthread_mutex_unlock(&g_desc_lock);
+  return rc;
 }
 
 int gpio_set_init_value_by_shadow(const char *shadow, gpio_value_t value)
 {
-	gpio_desc_t *desc = gpio_open_by_shadow(shadow);
-	if (!desc) {
+	gpio_desc_t *desc;
+	int rc = -1;
+
+	if (shadow == NULL) {
+		errno = EINVAL;
 		return -1;
 	}
-	if (gpio_set_init_value(desc, value)) {
-		gpio_close(desc);
-		return -1;
+	pthread_mutex_lock(&g_desc_lock);
+	desc = gpio_desc_cache_get(shadow);
+	if (desc) {
+		rc = gpio_set_init_value(desc, value);
 	}
-	gpio_close(desc);
-	return 0;
+	pthread_mutex_unlock(&g_desc_lock);
+	return rc;
 }
 
 gpiopoll_desc_t* gpio_poll_open(struct gpiopoll_config *config,
@@ -572,6 +882,15 @@ gpiopoll_desc_t* gpio_poll_open(struct gpiopoll_config *config,
 	if (!ret->pins) {
 		goto err_pins_alloc_bail;
 	}
+	ret->queue = calloc(num_config, sizeof(ret->queue[0]));
+	if (!ret->queue) {
+		goto err_queue_alloc_bail;
+	}
+	pthread_mutex_init(&ret->lock, NULL);
+	pthread_cond_init(&ret->cond, NULL);
+	ret->num_workers = GPIOPOLL_NUM_WORKERS;
+	ret->epoll_fd = -1;
+	ret->stop_fd = -1;
 	for (i = 0; i < num_config; i++) {
 		gpiopoll_pin_t *desc = &ret->pins[i];
 		desc->handler_started = false;
@@ -613,12 +932,35 @@ err_bail:
 		if (desc->gpio)
 			gpio_close(desc->gpio);
 	}
+	pthread_cond_destroy(&ret->cond);
+	pthread_mutex_destroy(&ret->lock);
+	free(ret->queue);
+err_queue_alloc_bail:
 	free(ret->pins);
 err_pins_alloc_bail:
 	free(ret);
 	return NULL;
 }
 
+/* Wake up the epoll thread of gpio_poll(). */
+static void gpiopoll_wakeup(gpiopoll_desc_t *gpdesc)
+{
+	uint64_t one = 1;
+
+	if (gpdesc->stop_fd >= 0 &&
+	    write(gpdesc->stop_fd, &one, sizeof(one)) < 0) {
+		GLOG_DEBUG("Wakeup event already pending\n");
+	}
+}
+
+/* Stop the epoll engine, called with gpdesc->lock held. */
+static void gpiopoll_stop(gpiopoll_desc_t *gpdesc)
+{
+	gpdesc->stop = true;
+	pthread_cond_broadcast(&gpdesc->cond);
+	gpiopoll_wakeup(gpdesc);
+}
+
 int gpio_poll_close(gpiopoll_desc_t *gpdesc)
 {
 	int i;
@@ -627,6 +969,26 @@ int gpio_poll_close(gpiopoll_desc_t *gpdesc)
 		return -1;
 	}
 
+	/*
+	 * Stop the epoll engine, and wait for gpio_poll() to return
+	 * before the pins are released. A handler cannot wait for that.
+	 */
+	pthread_mutex_lock(&gpdesc->lock);
+	if (gpdesc->running) {
+		gpiopoll_stop(gpdesc);
+		for (i = 0; i < gpdesc->num_started; i++) {
+			if (pthread_equal(gpdesc->workers[i], pthread_self())) {
+				pthread_mutex_unlock(&gpdesc->lock);
+				GLOG_ERR("gpio_poll_close() called from a handler\n");
+				return -1;
+			}
+		}
+		while (gpdesc->running) {
+			pthread_cond_wait(&gpdesc->cond, &gpdesc->lock);
+		}
+	}
+	pthread_mutex_unlock(&gpdesc->lock);
+
 	for (i = 0; i < gpdesc->num_pins; i++) {
 		gpiopoll_pin_t *desc = &gpdesc->pins[i];
 		if (desc->handler_started) {
@@ -642,11 +1004,32 @@ int gpio_poll_close(gpiopoll_desc_t *gpdesc)
 				 desc->cfg.shadow, strerror(errno));
 		}
 	}
+	pthread_cond_destroy(&gpdesc->cond);
+	pthread_mutex_destroy(&gpdesc->lock);
+	free(gpdesc->queue);
 	free(gpdesc->pins);
 	free(gpdesc);
 	return 0;
 }
 
+int gpio_poll_set_num_workers(gpiopoll_desc_t *gpdesc, int num_workers)
+{
+	if (!gpdesc || num_workers <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	pthread_mutex_lock(&gpdesc->lock);
+	if (gpdesc->running) {
+		pthread_mutex_unlock(&gpdesc->lock);
+		errno = EBUSY;
+		return -1;
+	}
+	gpdesc->num_workers = num_workers;
+	pthread_mutex_unlock(&gpdesc->lock);
+	return 0;
+}
+
 static void *gpio_poll_handler(void *priv)
 {
 	gpiopoll_pin_t *desc = (gpiopoll_pin_t *)priv;
@@ -672,14 +1055,14 @@ static void *gpio_poll_handler(void *priv)
 	return NULL;
 }
 
-int gpio_poll(gpiopoll_desc_t *gpdesc, int timeout)
+/*
+ * Run every pin in a thread of its own, for the backends without
+ * get_pin_poll_fd().
+ */
+static int gpio_poll_threads(gpiopoll_desc_t *gpdesc, int timeout)
 {
 	int i;
 
-	if (!gpdesc || !gpdesc->pins) {
-		return -1;
-	}
-
 	for (i = 0; i < gpdesc->num_pins; i++) {
 		int rc;
 		gpiopoll_pin_t *desc = &gpdesc->pins[i];
@@ -716,6 +1099,308 @@ int gpio_poll(gpiopoll_desc_t *gpdesc, int timeout)
 	return 0;
 }
 
+static uint64_t gpiopoll_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Stop watching a pin, called with gpdesc->lock held. */
+static void gpiopoll_unwatch(gpiopoll_desc_t *gpdesc, gpiopoll_pin_t *desc)
+{
+	uint32_t events;
+	int fd;
+
+	if (!desc->watched) {
+		return;
+	}
+	fd = GPIO_OPS()->get_pin_poll_fd(desc->gpio, &events);
+	if (fd >= 0) {
+		epoll_ctl(gpdesc->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+	}
+	desc->watched = false;
+	gpdesc->num_watched--;
+}
+
+/* (Re-)arm the fd of a pin for its next event. */
+static int gpiopoll_arm(gpiopoll_desc_t *gpdesc, gpiopoll_pin_t *desc, int op)
+{
+	struct epoll_event ev = {0};
+	uint32_t events;
+	int fd;
+
+	fd = GPIO_OPS()->get_pin_poll_fd(desc->gpio, &events);
+	if (fd < 0) {
+		return -1;
+	}
+	ev.events = events | EPOLLONESHOT;
+	ev.data.ptr = desc;
+	return epoll_ctl(gpdesc->epoll_fd, op, fd, &ev);
+}
+
+static void *gpiopoll_worker(void *priv)
+{
+	gpiopoll_desc_t *gpdesc = (gpiopoll_desc_t *)priv;
+	gpiopoll_pin_t *desc;
+	int rc;
+
+	pthread_mutex_lock(&gpdesc->lock);
+	while (1) {
+		while (!gpdesc->stop && gpdesc->queue_len == 0) {
+			pthread_cond_wait(&gpdesc->cond, &gpdesc->lock);
+		}
+		if (gpdesc->stop) {
+			break;
+		}
+		desc = gpdesc->queue[gpdesc->queue_head];
+		gpdesc->queue_head = (gpdesc->queue_head + 1) % gpdesc->num_pins;
+		gpdesc->queue_len--;
+		pthread_mutex_unlock(&gpdesc->lock);
+
+		desc->last_value = desc->curr_value;
+		rc = gpio_get_value(desc->gpio, &desc->curr_value);
+		if (rc) {
+			GLOG_ERR("Getting current value failed for GPIO: %s <%s>\n",
+				 desc->cfg.shadow, strerror(errno));
+		} else {
+			desc->cfg.handler(desc, desc->last_value, desc->curr_value);
+		}
+
+		pthread_mutex_lock(&gpdesc->lock);
+		desc->busy = false;
+		desc->deadline_ms = gpiopoll_now_ms() + desc->timeout;
+		if (rc == 0 && gpiopoll_arm(gpdesc, desc, EPOLL_CTL_MOD) != 0) {
+			GLOG_ERR("Re-arm failed for GPIO: %s <%s>\n",
+				 desc->cfg.shadow, strerror(errno));
+			rc = -1;
+		}
+		if (rc) {
+			gpiopoll_unwatch(gpdesc, desc);
+			gpiopoll_wakeup(gpdesc);
+		}
+	}
+	pthread_mutex_unlock(&gpdesc->lock);
+	return NULL;
+}
+
+/*
+ * Milliseconds the epoll thread may wait before a pin times out, or -1.
+ * A busy pin times out at the earliest "timeout" from now.
+ */
+static int gpiopoll_wait_ms(gpiopoll_desc_t *gpdesc, int timeout)
+{
+	uint64_t now = gpiopoll_now_ms(), next = UINT64_MAX;
+	int i;
+
+	if (timeout < 0) {
+		return -1;
+	}
+	for (i = 0; i < gpdesc->num_pins; i++) {
+		gpiopoll_pin_t *desc = &gpdesc->pins[i];
+		uint64_t deadline;
+
+		if (!desc->watched) {
+			continue;
+		}
+		deadline = desc->busy ? now + timeout : desc->deadline_ms;
+		if (deadline < next) {
+			next = deadline;
+		}
+	}
+	if (next == UINT64_MAX) {
+		return -1;
+	}
+	return next > now ? (int)(next - now) : 0;
+}
+
+static void gpiopoll_expire(gpiopoll_desc_t *gpdesc, int timeout)
+{
+	uint64_t now = gpiopoll_now_ms();
+	int i;
+
+	if (timeout < 0) {
+		return;
+	}
+	for (i = 0; i < gpdesc->num_pins; i++) {
+		gpiopoll_pin_t *desc = &gpdesc->pins[i];
+
+		if (desc->watched && !desc->busy && desc->deadline_ms <= now) {
+			GLOG_ERR("Wait failed with rc=%d for GPIO: %s <%s>\n",
+				 -ETIMEDOUT, desc->cfg.shadow, strerror(ETIMEDOUT));
+			gpiopoll_unwatch(gpdesc, desc);
+		}
+	}
+}
+
+static int gpiopoll_start(gpiopoll_desc_t *gpdesc, int timeout)
+{
+	struct epoll_event ev = {0};
+	uint64_t now = gpiopoll_now_ms();
+	int i, num, rc;
+
+	gpdesc->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (gpdesc->epoll_fd < 0) {
+		GLOG_ERR("epoll_create1() failed <%s>\n", strerror(errno));
+		return -1;
+	}
+	gpdesc->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (gpdesc->stop_fd < 0 ||
+	    epoll_ctl(gpdesc->epoll_fd, EPOLL_CTL_ADD, gpdesc->stop_fd, &ev)) {
+		GLOG_ERR("Setup of stop event failed <%s>\n", strerror(errno));
+		return -1;
+	}
+
+	gpdesc->stop = false;
+	gpdesc->num_watched = 0;
+	gpdesc->queue_head = 0;
+	gpdesc->queue_len = 0;
+	for (i = 0; i < gpdesc->num_pins; i++) {
+		gpiopoll_pin_t *desc = &gpdesc->pins[i];
+
+		desc->timeout = timeout;
+		desc->busy = false;
+		desc->deadline_ms = now + timeout;
+		if (gpiopoll_arm(gpdesc, desc, EPOLL_CTL_ADD)) {
+			GLOG_ERR("Watch failed for GPIO: %s <%s>\n",
+				 desc->cfg.shadow, strerror(errno));
+			continue;
+		}
+		desc->watched = true;
+		gpdesc->num_watched++;
+	}
+
+	num = gpdesc->num_workers < gpdesc->num_pins ?
+	      gpdesc->num_workers : gpdesc->num_pins;
+	gpdesc->workers = calloc(num, sizeof(gpdesc->workers[0]));
+	if (!gpdesc->workers) {
+		return -1;
+	}
+	for (i = 0; i < num; i++) {
+		rc = pthread_create(&gpdesc->workers[i], NULL,
+				    gpiopoll_worker, gpdesc);
+		if (rc) {
+			GLOG_ERR("Create of handler thread failed <%s>\n",
+				 strerror(rc));
+			break;
+		}
+		gpdesc->num_started++;
+	}
+	return gpdesc->num_started > 0 ? 0 : -1;
+}
+
+static void gpiopoll_finish(gpiopoll_desc_t *gpdesc)
+{
+	int i;
+
+	pthread_mutex_lock(&gpdesc->lock);
+	gpdesc->stop = true;
+	pthread_cond_broadcast(&gpdesc->cond);
+	pthread_mutex_unlock(&gpdesc->lock);
+	for (i = 0; i < gpdesc->num_started; i++) {
+		pthread_join(gpdesc->workers[i], NULL);
+	}
+
+	pthread_mutex_lock(&gpdesc->lock);
+	for (i = 0; i < gpdesc->num_pins; i++) {
+		gpiopoll_unwatch(gpdesc, &gpdesc->pins[i]);
+	}
+	free(gpdesc->workers);
+	gpdesc->workers = NULL;
+	gpdesc->num_started = 0;
+	if (gpdesc->stop_fd >= 0) {
+		close(gpdesc->stop_fd);
+		gpdesc->stop_fd = -1;
+	}
+	if (gpdesc->epoll_fd >= 0) {
+		close(gpdesc->epoll_fd);
+		gpdesc->epoll_fd = -1;
+	}
+	gpdesc->running = false;
+	pthread_cond_broadcast(&gpdesc->cond);
+	pthread_mutex_unlock(&gpdesc->lock);
+}
+
+int gpio_poll(gpiopoll_desc_t *gpdesc, int timeout)
+{
+	struct epoll_event events[16];
+	int i, n, wait_ms, ret = 0;
+
+	if (!gpdesc || !gpdesc->pins) {
+		return -1;
+	}
+	if (gpdesc->num_pins == 0) {
+		return 0;
+	}
+	if (GPIO_OPS()->get_pin_poll_fd == NULL) {
+		return gpio_poll_threads(gpdesc, timeout);
+	}
+
+	pthread_mutex_lock(&gpdesc->lock);
+	if (gpdesc->running) {
+		pthread_mutex_unlock(&gpdesc->lock);
+		GLOG_ERR("gpio_poll() is already running\n");
+		return -1;
+	}
+	gpdesc->running = true;
+	if (gpiopoll_start(gpdesc, timeout)) {
+		pthread_mutex_unlock(&gpdesc->lock);
+		gpiopoll_finish(gpdesc);
+		return -1;
+	}
+
+	/*
+	 * The fd of a pin is armed with EPOLLONESHOT: once it fires, the
+	 * pin is queued to the workers, and its fd is re-armed after the
+	 * handler returns.
+	 */
+	while (!gpdesc->stop && gpdesc->num_watched > 0) {
+		wait_ms = gpiopoll_wait_ms(gpdesc, timeout);
+		pthread_mutex_unlock(&gpdesc->lock);
+		n = epoll_wait(gpdesc->epoll_fd, events, ARRAY_SIZE(events),
+			       wait_ms);
+		pthread_mutex_lock(&gpdesc->lock);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			GLOG_ERR("epoll_wait() returned error: %s\n",
+				 strerror(errno));
+			ret = -1;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			gpiopoll_pin_t *desc = events[i].data.ptr;
+			uint64_t cnt;
+			int tail;
+
+			if (desc == NULL) {
+				if (read(gpdesc->stop_fd, &cnt, sizeof(cnt)) < 0) {
+					GLOG_DEBUG("Wakeup event already read\n");
+				}
+				continue;
+			}
+			if (!desc->watched || desc->busy) {
+				continue;
+			}
+			desc->busy = true;
+			tail = (gpdesc->queue_head + gpdesc->queue_len) %
+			       gpdesc->num_pins;
+			gpdesc->queue[tail] = desc;
+			gpdesc->queue_len++;
+			pthread_cond_broadcast(&gpdesc->cond);
+		}
+		gpiopoll_expire(gpdesc, timeout);
+	}
+	pthread_mutex_unlock(&gpdesc->lock);
+
+	gpiopoll_finish(gpdesc);
+	return ret;
+}
+
 const struct gpiopoll_config *gpio_poll_get_config(gpiopoll_pin_t *gpdesc)
 {
 	if (!gpdesc) {
@@ -734,37 +1419,226 @@ gpio_desc_t *gpio_poll_get_descriptor(gpiopoll_pin_t *gpdesc)
 
 int gpio_get_value_by_shadow_list(const char *const *shadows, size_t num, unsigned int *mask)
 {
-  size_t i;
+  struct gpio_list_cache *entry;
+  int rc = -1, retry;
 
   if (num > sizeof(*mask) * 8 || !shadows || !mask) {
     errno = EINVAL;
     return -1;
   }
-  *mask = 0;
+  if (num == 0) {
+    *mask = 0;
+    return 0;
+  }
 
-  for (i = 0; i < num; i++) {
-    gpio_value_t value = gpio_get_value_by_shadow(shadows[i]);
-    if (value == GPIO_VALUE_INVALID) {
-      return -1;
+  /* A cached entry fails once its pins are unexported: reopen it. */
+  pthread_mutex_lock(&g_list_lock);
+  for (retry = 0; retry < 2; retry++) {
+    entry = gpio_list_lookup(shadows, num);
+    if (!entry) {
+      break;
     }
-    *mask |= (value == GPIO_VALUE_HIGH ? 1 : 0) << i;
+    rc = gpio_list_get(entry, mask);
+    if (rc == 0) {
+      break;
+    }
+    gpio_list_drop();
   }
-  return 0;
+  pthread_mutex_unlock(&g_list_lock);
+  return rc;
 }
 
 int gpio_set_value_by_shadow_list(const char *const *shadows, size_t num, unsigned int mask)
 {
-  size_t i;
+  struct gpio_list_cache *entry;
+  int rc = -1, retry;
 
   if (num > sizeof(mask) * 8 || !shadows) {
     errno = EINVAL;
     return -1;
   }
-  for (i = 0; i < num; i++) {
-    gpio_value_t value = (mask & (1 << i)) ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
-    if (gpio_set_value_by_shadow(shadows[i], value)) {
-      return -1;
+  if (num == 0) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&g_list_lock);
+  for (retry = 0; retry < 2; retry++) {
+    entry = gpio_list_lookup(shadows, num);
+    if (!entry) {
+      break;
     }
+    rc = gpio_list_set(entry, mask);
+    if (rc == 0) {
+      break;
+    }
+    gpio_list_drop();
   }
-  return 0;
+  pthread_mutex_unlock(&g_list_lock);
+  return rc;
+}
+
+gpio_group_t* gpio_group_open(const char *const *shadows, size_t num)
+{
+	gpio_group_t *group;
+
+	if (shadows == NULL || num == 0 || num > sizeof(unsigned int) * 8) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	group = malloc(sizeof(*group));
+	if (group == NULL)
+		return NULL;
+	group->epoll_fd = -1;
+	group->list = gpio_list_open(shadows, num, true);
+	if (group->list == NULL) {
+		free(group);
+		return NULL;
+	}
+	return group;
+}
+
+int gpio_group_close(gpio_group_t *group)
+{
+	if (group == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (group->epoll_fd >= 0)
+		close(group->epoll_fd);
+	gpio_list_free(group->list);
+	free(group);
+	return 0;
+}
+
+int gpio_group_get_values(gpio_group_t *group, unsigned int *mask)
+{
+	if (group == NULL || mask == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	return gpio_list_get(group->list, mask);
+}
+
+int gpio_group_set_values(gpio_group_t *group, unsigned int mask)
+{
+	if (group == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	return gpio_list_set(group->list, mask);
+}
+
+int gpio_group_set_edge(gpio_group_t *group, gpio_edge_t edge)
+{
+	size_t i;
+
+	if (group == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < group->list->num; i++) {
+		if (gpio_set_edge(group->list->descs[i], edge) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Add the poll fds of the pins to the epoll fd of the group, after a
+ * first read of the values (which opens the value fds and acknowledges
+ * the edges so far).
+ */
+static int gpio_group_epoll_setup(gpio_group_t *group)
+{
+	size_t i;
+	int fd;
+	uint32_t events;
+	gpio_value_t value;
+	struct epoll_event ev;
+
+	if (GPIO_OPS()->get_pin_poll_fd == NULL) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	group->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (group->epoll_fd < 0) {
+		GLOG_ERR("failed to create epoll fd: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < group->list->num; i++) {
+		gpio_desc_t *gdesc = group->list->descs[i];
+
+		if (gpio_get_value(gdesc, &value) != 0)
+			goto error;
+		fd = GPIO_OPS()->get_pin_poll_fd(gdesc, &events);
+		if (fd < 0)
+			goto error;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = events;
+		ev.data.u32 = i;
+		if (epoll_ctl(group->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			GLOG_ERR("failed to watch gpio %d: %s\n",
+				 gdesc->pin_num, strerror(errno));
+			goto error;
+		}
+	}
+	return 0;
+
+error:
+	close(group->epoll_fd);
+	group->epoll_fd = -1;
+	return -1;
+}
+
+int gpio_group_get_poll_fd(gpio_group_t *group)
+{
+	if (group == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (group->epoll_fd < 0 && gpio_group_epoll_setup(group) != 0)
+		return -1;
+	return group->epoll_fd;
+}
+
+int gpio_group_wait_edges(gpio_group_t *group, int timeout,
+			  unsigned int *events)
+{
+	int i, rc;
+	gpio_value_t value;
+	struct epoll_event evs[sizeof(unsigned int) * 8];
+
+	if (group == NULL || events == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*events = 0;
+	if (group->epoll_fd < 0 && gpio_group_epoll_setup(group) != 0)
+		return -1;
+
+	do {
+		rc = epoll_wait(group->epoll_fd, evs, group->list->num,
+				timeout);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0) {
+		GLOG_ERR("epoll_wait() returned error: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* Reading the values acknowledges the edges */
+	for (i = 0; i < rc; i++) {
+		uint32_t pin = evs[i].data.u32;
+
+		if (gpio_get_value(group->list->descs[pin], &value) != 0)
+			return -1;
+		*events |= 1U << pin;
+	}
+	return 0;
 }
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2019-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Multi-line handles of the gpio chardev interface: all the lines of a
+ * gpio chip in the set are requested by one GPIO_GET_LINEHANDLE_IOCTL,
+ * and their values are read or written together by one ioctl, so a
+ * set of lines of a chip changes at once.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "gpio_int.h"
+
+/*
+ * gpio chardev files.
+ */
+#ifdef __TEST__
+#define GPIO_CHARDEV_ROOT		"/tmp/test/dev"
+#else
+#define GPIO_CHARDEV_ROOT		"/dev"
+#endif
+
+#define GPIO_CHARDEV_CONSUMER		"libgpio-ctrl"
+
+struct gpio_line_handle {
+	int fd;
+	int num_lines;
+	/* Bit of every line in the mask of the set */
+	int bits[GPIOHANDLES_MAX];
+};
+
+struct gpio_lines {
+	int num_handles;
+	struct gpio_line_handle handles[];
+};
+
+static gpiochip_desc_t* gchardev_pin_to_chip(gpiochip_desc_t **chips,
+					     int num_chips, int pin_num)
+{
+	int i;
+
+	for (i = 0; i < num_chips; i++) {
+		if (pin_num >= chips[i]->base &&
+		    pin_num < chips[i]->base + chips[i]->ngpio)
+			return chips[i];
+	}
+
+	return NULL;
+}
+
+static int gchardev_request(gpiochip_desc_t *chip,
+			    struct gpiohandle_request *req)
+{
+	int fd;
+	char pathname[PATH_MAX];
+
+	snprintf(pathname, sizeof(pathname), "%s/%s",
+		 GPIO_CHARDEV_ROOT, chip->chardev_name);
+	fd = open(pathname, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		GLOG_DEBUG("failed to open <%s>: %s\n",
+			   pathname, strerror(errno));
+		return -1;
+	}
+
+	/*
+	 * The lines keep their direction: only output lines can be set.
+	 */
+	req->flags = 0;
+	snprintf(req->consumer_label, sizeof(req->consumer_label),
+		 "%s", GPIO_CHARDEV_CONSUMER);
+	if (ioctl(fd, GPIO_GET_LINEHANDLE_IOCTL, req) < 0) {
+		GLOG_DEBUG("failed to request %u lines of <%s>: %s\n",
+			   req->lines, pathname, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	close(fd);
+	return req->fd;
+}
+
+/*
+ * Request the pins (up to the bits of an unsigned int) through the
+ * chardev interface: bit <i> of the masks is pin_nums[i].
+ *
+ * Return:
+ *   The lines, or NULL on failures: if the chips have no chardev, or
+ *   a pin is busy (e.g. exported through sysfs).
+ */
+gpio_lines_t* gpio_chardev_request_lines(const int *pin_nums, size_t num)
+{
+	int i, j, num_chips;
+	gpio_lines_t *lines;
+	gpiochip_desc_t *chips[GPIO_CHIP_MAX];
+	gpiochip_desc_t *pin_chips[sizeof(unsigned int) * 8];
+	bool requested[sizeof(unsigned int) * 8] = {false};
+
+	if (pin_nums == NULL || num == 0 || num > ARRAY_SIZE(pin_chips)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	num_chips = gpiochip_list(chips, ARRAY_SIZE(chips));
+	if (num_chips < 0)
+		return NULL;
+	if (num_chips > ARRAY_SIZE(chips))
+		num_chips = ARRAY_SIZE(chips);
+
+	for (i = 0; i < num; i++) {
+		pin_chips[i] = gchardev_pin_to_chip(chips, num_chips,
+						    pin_nums[i]);
+		if (pin_chips[i] == NULL ||
+		    pin_chips[i]->chardev_name[0] == '\0') {
+			errno = ENODEV;
+			return NULL;
+		}
+	}
+
+	/* At most one handle per pin */
+	lines = calloc(1, sizeof(*lines) + num * sizeof(lines->handles[0]));
+	if (lines == NULL)
+		return NULL;
+
+	for (i = 0; i < num; i++) {
+		struct gpiohandle_request req;
+		struct gpio_line_handle *handle;
+
+		if (requested[i])
+			continue;
+
+		/*
+		 * All the pins of the chip of pin <i> go into one handle.
+		 */
+		memset(&req, 0, sizeof(req));
+		handle = &lines->handles[lines->num_handles];
+		for (j = i; j < num; j++) {
+			if (pin_chips[j] != pin_chips[i])
+				continue;
+			req.lineoffsets[req.lines] =
+				pin_nums[j] - pin_chips[i]->base;
+			handle->bits[req.lines] = j;
+			req.lines++;
+			requested[j] = true;
+		}
+
+		handle->fd = gchardev_request(pin_chips[i], &req);
+		if (handle->fd < 0) {
+			gpio_chardev_release_lines(lines);
+			return NULL;
+		}
+		handle->num_lines = req.lines;
+		lines->num_handles++;
+	}
+
+	return lines;
+}
+
+void gpio_chardev_release_lines(gpio_lines_t *lines)
+{
+	int i;
+
+	if (lines == NULL)
+		return;
+
+	for (i = 0; i < lines->num_handles; i++)
+		close(lines->handles[i].fd);
+	free(lines);
+}
+
+int gpio_chardev_get_lines(gpio_lines_t *lines, unsigned int *mask)
+{
+	int i, j;
+	struct gpiohandle_data data;
+
+	if (lines == NULL || mask == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*mask = 0;
+	for (i = 0; i < lines->num_handles; i++) {
+		struct gpio_line_handle *handle = &lines->handles[i];
+
+		memset(&data, 0, sizeof(data));
+		if (ioctl(handle->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL,
+			  &data) < 0) {
+			GLOG_ERR("failed to get values of %d lines: %s\n",
+				 handle->num_lines, strerror(errno));
+			return -1;
+		}
+		for (j = 0; j < handle->num_lines; j++) {
+			if (data.values[j])
+				*mask |= 1U << handle->bits[j];
+		}
+	}
+
+	return 0;
+}
+
+int gpio_chardev_set_lines(gpio_lines_t *lines, unsigned int mask)
+{
+	int i, j;
+	struct gpiohandle_data data;
+
+	if (lines == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < lines->num_handles; i++) {
+		struct gpio_line_handle *handle = &lines->handles[i];
+
+		memset(&data, 0, sizeof(data));
+		for (j = 0; j < handle->num_lines; j++)
+			data.values[j] = (mask >> handle->bits[j]) & 1;
+		if (ioctl(handle->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL,
+			  &data) < 0) {
+			GLOG_ERR("failed to set values of %d lines: %s\n",
+				 handle->num_lines, strerror(errno));
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <syslog.h>
 #include <pthread.h>
@@ -96,6 +97,7 @@ struct gpiochip_desc {
 	int ngpio;
 	char dev_name[NAME_MAX];
 	char chip_type[NAME_MAX];
+	char chardev_name[NAME_MAX];	/* "gpiochipN", or empty */
 
 	struct gpiochip_ops *ops;
 };
@@ -109,11 +111,40 @@ struct gpiopoll_pin_desc {
 	pthread_t    tid;
 	gpio_desc_t  *gpio;
 	int          timeout;
+
+	/*
+	 * State of the pin in the epoll engine, protected by the lock of
+	 * gpiopoll_desc: "watched" until the pin fails or times out, and
+	 * "busy" while it is queued or its handler is running (the fd is
+	 * re-armed only after that, so events of a pin are in order).
+	 */
+	bool         watched;
+	bool         busy;
+	uint64_t     deadline_ms;
 };
 
 struct gpiopoll_desc {
 	int num_pins;
 	gpiopoll_pin_t *pins;
+
+	/*
+	 * The epoll engine of gpio_poll(): the calling thread waits on
+	 * the fds of all the pins and queues the pins with an event to
+	 * "num_workers" threads which run the handlers.
+	 */
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	int             num_workers;
+	pthread_t       *workers;
+	int             num_started;
+	int             epoll_fd;
+	int             stop_fd;
+	bool            running;
+	bool            stop;
+	int             num_watched;
+	gpiopoll_pin_t  **queue;
+	int             queue_head;
+	int             queue_len;
 };
 
 /*
@@ -147,12 +178,30 @@ struct gpio_backend_ops {
 	int (*set_pin_init_value)(gpio_desc_t *gdesc, gpio_value_t value);
 	int (*poll_pin)(gpio_desc_t *gdesc, int timeout);
 
+	/*
+	 * (optional) Function to get the fd signalling the edges of a
+	 * pin, with the events it is waited for, for the epoll engine.
+	 * Reading the value of the pin acknowledges the event.
+	 */
+	int (*get_pin_poll_fd)(gpio_desc_t *gdesc, uint32_t *events);
+
 	/*
 	 * Function to enumerate gpio chips.
 	 */
 	int (*chip_enumerate)(gpiochip_desc_t *chips, size_t size);
 };
 
+/*
+ * A set of gpio pins requested at once through the chardev interface:
+ * their values are read or written by one ioctl per gpio chip.
+ */
+typedef struct gpio_lines gpio_lines_t;
+
+gpio_lines_t* gpio_chardev_request_lines(const int *pin_nums, size_t num);
+void gpio_chardev_release_lines(gpio_lines_t *lines);
+int gpio_chardev_get_lines(gpio_lines_t *lines, unsigned int *mask);
+int gpio_chardev_set_lines(gpio_lines_t *lines, unsigned int mask);
+
 /*
  * Global variables.
  */
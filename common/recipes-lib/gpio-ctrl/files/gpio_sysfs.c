@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <dirent.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <linux/limits.h>
@@ -455,6 +456,34 @@ static char* gsysfs_chip_read_device(char *buf,
 	return buf;
 }
 
+/*
+ * Find the chardev of the gpio chip: the gpio device "gpiochipN" is a
+ * child of the device the sysfs chip links to.
+ */
+static char* gsysfs_chip_read_chardev(char *buf,
+				      size_t size,
+				      const char *chip_dir)
+{
+	DIR *dirp;
+	struct dirent *dent;
+	char dev_path[GPIO_SYSFS_PATH_SIZE];
+
+	path_join(dev_path, sizeof(dev_path), chip_dir, "device", NULL);
+	dirp = opendir(dev_path);
+	if (dirp == NULL)
+		return NULL;
+
+	while ((dent = readdir(dirp)) != NULL) {
+		if (str_startswith(dent->d_name, "gpiochip")) {
+			snprintf(buf, size, "%s", dent->d_name);
+			closedir(dirp);
+			return buf;
+		}
+	}
+	closedir(dirp);
+	return NULL;
+}
+
 static int gsysfs_chip_read_base(const char *chip_dir)
 {
 	int fd;
@@ -599,6 +628,9 @@ static int sysfs_gpiochip_enumerate(gpiochip_desc_t *chips, size_t size)
 		GLOG_DEBUG("found gpiochip <%s>, base=%d, ngpio=%d\n",
 			   dev_name, base, ngpio);
 		chip_desc_init(&chips[i], base, ngpio, dev_name);
+		gsysfs_chip_read_chardev(chips[i].chardev_name,
+					 sizeof(chips[i].chardev_name),
+					 chip_dir);
 		if (strcmp(dev_name, GPIO_SYSFS_ASPEED_DEVICE) == 0)
 			found_aspeed_chip = true;
 		if (++i >= size)
@@ -648,6 +680,19 @@ static int sysfs_gpio_poll(gpio_desc_t *gdesc, int timeout)
 	return 0;
 }
 
+static int sysfs_gpio_get_poll_fd(gpio_desc_t *gdesc, uint32_t *events)
+{
+	assert(IS_VALID_GPIO_DESC(gdesc));
+	assert(events != NULL);
+
+	if (GPIO_VALUE_FD(gdesc) < 0) {
+		errno = EBADF;
+		return -1;
+	}
+	*events = EPOLLPRI;
+	return GPIO_VALUE_FD(gdesc);
+}
+
 struct gpio_backend_ops gpio_sysfs_ops = {
 	.export_pin = sysfs_gpio_export,
 	.unexport_pin = sysfs_gpio_unexport,
@@ -663,6 +708,7 @@ struct gpio_backend_ops gpio_sysfs_ops = {
 	.set_pin_edge = sysfs_gpio_set_edge,
 	.set_pin_init_value = sysfs_gpio_set_init_value,
 	.poll_pin = sysfs_gpio_poll,
+	.get_pin_poll_fd = sysfs_gpio_get_poll_fd,
 
 	.chip_enumerate = sysfs_gpiochip_enumerate,
 };
@@ -16,9 +16,15 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #include <cstdlib>
+#include <atomic>
 #include <exception>
+#include <map>
+#include <thread>
+#include <fcntl.h>
+#include <sys/epoll.h>
 #include <gtest/gtest.h>
 #include "libgpio.hpp"
+#include "gpio_int.h"
 
 using namespace std;
 using namespace testing;
@@ -65,3 +71,181 @@ TEST_F(GPIOTest, setValue) {
   x.set_edge(GPIO_EDGE_BOTH);
   ASSERT_EQ(x.get_edge(), GPIO_EDGE_BOTH);
 }
+
+TEST_F(GPIOTest, shadowCache) {
+  ASSERT_EQ(gpio_get_value_by_shadow("TEST1"), GPIO_VALUE_LOW);
+  ASSERT_EQ(gpio_set_value_by_shadow("TEST1", GPIO_VALUE_HIGH), 0);
+  ASSERT_EQ(system("grep -q 1 /tmp/test/gpio123/value"), 0);
+  ASSERT_EQ(system("echo 0 > /tmp/test/gpio123/value"), 0);
+  ASSERT_EQ(gpio_get_value_by_shadow("TEST1"), GPIO_VALUE_LOW);
+
+  // the shadow is remapped to another pin
+  ASSERT_EQ(system("mkdir /tmp/test/gpio124"), 0);
+  ASSERT_EQ(system("echo 1 > /tmp/test/gpio124/value"), 0);
+  ASSERT_EQ(system("ln -sfn /tmp/test/gpio124 /tmp/gpionames/TEST1"), 0);
+  ASSERT_EQ(gpio_get_value_by_shadow("TEST1"), GPIO_VALUE_HIGH);
+
+  ASSERT_EQ(system("rm /tmp/gpionames/TEST1"), 0);
+  ASSERT_EQ(gpio_get_value_by_shadow("TEST1"), GPIO_VALUE_INVALID);
+}
+
+TEST_F(GPIOTest, shadowList) {
+  const char *shadows[] = {"TEST1", "TEST2"};
+  unsigned int mask = 0xff;
+  ASSERT_EQ(system("mkdir /tmp/test/gpio124"), 0);
+  ASSERT_EQ(system("echo 1 > /tmp/test/gpio124/value"), 0);
+  ASSERT_EQ(system("ln -s /tmp/test/gpio124 /tmp/gpionames/TEST2"), 0);
+
+  ASSERT_EQ(gpio_get_value_by_shadow_list(shadows, 2, &mask), 0);
+  ASSERT_EQ(mask, 2u);
+  // the cached pins are read again
+  ASSERT_EQ(system("echo 1 > /tmp/test/gpio123/value"), 0);
+  ASSERT_EQ(gpio_get_value_by_shadow_list(shadows, 2, &mask), 0);
+  ASSERT_EQ(mask, 3u);
+  ASSERT_EQ(gpio_set_value_by_shadow_list(shadows, 2, 0x2), 0);
+  ASSERT_EQ(gpio_get_value_by_shadow_list(shadows, 2, &mask), 0);
+  ASSERT_EQ(mask, 2u);
+  ASSERT_EQ(gpio_get_value_by_shadow_list(shadows + 1, 1, &mask), 0);
+  ASSERT_EQ(mask, 1u);
+
+  const char *missing[] = {"TEST1", "TEST3"};
+  ASSERT_EQ(gpio_get_value_by_shadow_list(missing, 2, &mask), -1);
+}
+
+TEST_F(GPIOTest, group) {
+  ASSERT_EQ(system("mkdir /tmp/test/gpio124"), 0);
+  ASSERT_EQ(system("echo 1 > /tmp/test/gpio124/value"), 0);
+  ASSERT_EQ(system("echo in > /tmp/test/gpio124/direction"), 0);
+  ASSERT_EQ(system("ln -s /tmp/test/gpio124 /tmp/gpionames/TEST2"), 0);
+
+  GPIOGroup group({"TEST1", "TEST2"});
+  ASSERT_EQ(group.size(), 2u);
+  ASSERT_EQ(group.get_values(), 2u);
+  // the pins stay opened after the shadows are gone
+  ASSERT_EQ(system("rm /tmp/gpionames/TEST1"), 0);
+  ASSERT_EQ(system("echo 1 > /tmp/test/gpio123/value"), 0);
+  ASSERT_EQ(group.get_values(), 3u);
+  group.set_values(0x1);
+  ASSERT_EQ(group.get_values(), 1u);
+
+  ASSERT_THROW(GPIOGroup({"TEST2", "TEST3"}), std::system_error);
+}
+
+// The poll fd of a pin is a pipe, every byte written into it is the value
+// of an edge of the pin.
+static std::map<int, int> g_pipe_rd;
+static std::map<int, gpio_value_t> g_pipe_val;
+
+static int pipe_get_poll_fd(gpio_desc_t *gdesc, uint32_t *events) {
+  *events = EPOLLIN;
+  return g_pipe_rd[gdesc->pin_num];
+}
+
+static int pipe_get_value(gpio_desc_t *gdesc, gpio_value_t *value) {
+  char c;
+  if (read(g_pipe_rd[gdesc->pin_num], &c, 1) == 1) {
+    g_pipe_val[gdesc->pin_num] = c == '1' ? GPIO_VALUE_HIGH : GPIO_VALUE_LOW;
+  }
+  *value = g_pipe_val[gdesc->pin_num];
+  return 0;
+}
+
+static std::atomic<int> g_events[2];
+static std::atomic<int> g_errors;
+static std::atomic<bool> g_busy[2];
+
+static void pipe_handler(gpiopoll_pin_t *gp, gpio_value_t last, gpio_value_t curr) {
+  int idx = atoi(gpio_poll_get_config(gp)->description);
+  if (g_busy[idx].exchange(true) || last == curr) {
+    g_errors++;
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+  g_events[idx]++;
+  g_busy[idx] = false;
+}
+
+TEST_F(GPIOTest, pollInOrder) {
+  const int kEdges = 200;
+  int fds[2][2];
+  struct gpiopoll_config cfg[2] = {
+    {"TEST1", "0", GPIO_EDGE_BOTH, pipe_handler, NULL},
+    {"TEST2", "1", GPIO_EDGE_BOTH, pipe_handler, NULL},
+  };
+  ASSERT_EQ(system("mkdir /tmp/test/gpio124"), 0);
+  ASSERT_EQ(system("echo 0 > /tmp/test/gpio124/value"), 0);
+  ASSERT_EQ(system("echo in > /tmp/test/gpio124/direction"), 0);
+  ASSERT_EQ(system("echo none > /tmp/test/gpio124/edge"), 0);
+  ASSERT_EQ(system("ln -s /tmp/test/gpio124 /tmp/gpionames/TEST2"), 0);
+
+  struct gpio_backend_ops saved = gpio_sysfs_ops;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(pipe2(fds[i], O_NONBLOCK), 0);
+    g_pipe_rd[123 + i] = fds[i][0];
+    g_pipe_val[123 + i] = GPIO_VALUE_LOW;
+    g_events[i] = 0;
+    g_busy[i] = false;
+  }
+  g_errors = 0;
+  gpio_sysfs_ops.get_pin_poll_fd = pipe_get_poll_fd;
+  gpio_sysfs_ops.get_pin_value = pipe_get_value;
+
+  gpiopoll_desc_t *desc = gpio_poll_open(cfg, 2);
+  ASSERT_NE(desc, nullptr);
+  std::thread writer([&]() {
+    for (int e = 0; e < kEdges; e++) {
+      for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(write(fds[i][1], e % 2 ? "0" : "1", 1), 1);
+      }
+    }
+  });
+  // returns once no pin had an edge for 500ms
+  ASSERT_EQ(gpio_poll(desc, 500), 0);
+  writer.join();
+  ASSERT_EQ(gpio_poll_close(desc), 0);
+  gpio_sysfs_ops = saved;
+
+  ASSERT_EQ(g_errors, 0);
+  ASSERT_EQ(g_events[0], kEdges);
+  ASSERT_EQ(g_events[1], kEdges);
+  for (int i = 0; i < 2; i++) {
+    close(fds[i][0]);
+    close(fds[i][1]);
+  }
+}
+
+TEST_F(GPIOTest, groupWaitEdges) {
+  int fds[2][2];
+  ASSERT_EQ(system("mkdir /tmp/test/gpio124"), 0);
+  ASSERT_EQ(system("echo 0 > /tmp/test/gpio124/value"), 0);
+  ASSERT_EQ(system("echo in > /tmp/test/gpio124/direction"), 0);
+  ASSERT_EQ(system("echo none > /tmp/test/gpio124/edge"), 0);
+  ASSERT_EQ(system("ln -s /tmp/test/gpio124 /tmp/gpionames/TEST2"), 0);
+
+  struct gpio_backend_ops saved = gpio_sysfs_ops;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(pipe2(fds[i], O_NONBLOCK), 0);
+    g_pipe_rd[123 + i] = fds[i][0];
+    g_pipe_val[123 + i] = GPIO_VALUE_LOW;
+  }
+  gpio_sysfs_ops.get_pin_poll_fd = pipe_get_poll_fd;
+  gpio_sysfs_ops.get_pin_value = pipe_get_value;
+  {
+    GPIOGroup group({"TEST1", "TEST2"});
+    group.set_edge(GPIO_EDGE_BOTH);
+    ASSERT_EQ(group.wait_edges(10), 0u);
+    ASSERT_EQ(write(fds[1][1], "1", 1), 1);
+    ASSERT_EQ(group.wait_edges(500), 2u);
+    // the edge was acknowledged by the wait
+    ASSERT_EQ(group.wait_edges(10), 0u);
+    ASSERT_EQ(group.get_values(), 2u);
+    ASSERT_EQ(write(fds[0][1], "1", 1), 1);
+    ASSERT_EQ(write(fds[1][1], "0", 1), 1);
+    ASSERT_EQ(group.wait_edges(500), 3u);
+    ASSERT_EQ(group.get_values(), 1u);
+  }
+  gpio_sysfs_ops = saved;
+  for (int i = 0; i < 2; i++) {
+    close(fds[i][0]);
+    close(fds[i][1]);
+  }
+}
@@ -198,6 +198,8 @@ int gpio_get_edge(gpio_desc_t *gdesc, gpio_edge_t *edge);
 int gpio_set_edge(gpio_desc_t *gdesc, gpio_edge_t edge);
 
 /* Get GPIO value given the shadow name of the gpio-pin.
+ * The *_by_shadow functions keep the pins they open in a descriptor
+ * cache for the process, dropped by gpio_unexport().
  *
  * Return:
  * GPIO_VALUE_INVALID on failure,
@@ -237,6 +239,52 @@ int gpio_get_value_by_shadow_list(const char * const *shadows, size_t num, unsig
 int gpio_set_value_by_shadow_list(const char * const *shadows, size_t num, unsigned int mask);
 
 
+/*
+ * A group of gpio pins opened once from their shadow names (up to the
+ * bits of an unsigned int), and owned by the caller until
+ * gpio_group_close(). Bit <i> of the masks is shadows[i]. The values
+ * are read or written at once, by one ioctl per gpio chip, when the
+ * pins can be requested through the chardev interface (pin by pin
+ * otherwise).
+ *
+ * Return:
+ *   The opaque group, or NULL on failures.
+ */
+typedef struct gpio_group gpio_group_t;
+gpio_group_t* gpio_group_open(const char * const *shadows, size_t num);
+
+/*
+ * Functions to release a gpio group, and to get/set the values or set
+ * the edge of all its pins.
+ *
+ * Return:
+ *   0 for success, or -1 on failures.
+ */
+int gpio_group_close(gpio_group_t *group);
+int gpio_group_get_values(gpio_group_t *group, unsigned int *mask);
+int gpio_group_set_values(gpio_group_t *group, unsigned int mask);
+int gpio_group_set_edge(gpio_group_t *group, gpio_edge_t edge);
+
+/*
+ * Wait up to "timeout" milliseconds (-1 for no limit) for edges of the
+ * pins of the group, as set by gpio_group_set_edge(). The pins with an
+ * edge are returned in "events", 0 if the wait timed out.
+ *
+ * Return:
+ *   0 for success, or -1 on failures.
+ */
+int gpio_group_wait_edges(gpio_group_t *group, int timeout,
+			  unsigned int *events);
+
+/*
+ * The fd which gets readable when gpio_group_wait_edges() has edges to
+ * return, for the caller's own poll/epoll loop. It is owned by the group.
+ *
+ * Return:
+ *   The fd, or -1 on failures.
+ */
+int gpio_group_get_poll_fd(gpio_group_t *group);
+
 /*
  * Sets the gpio pin to output with given initial value atomically.
  *
@@ -282,6 +330,17 @@ int gpio_poll_close(gpiopoll_desc_t *gpdesc);
  */
 int gpio_poll(gpiopoll_desc_t *gpdesc, int timeout);
 
+/*
+ * Function to set the number of threads gpio_poll() runs the handlers
+ * in (4 by default, at most one per pin). The events of a pin are
+ * handled in order, one at a time, but a handler blocking for long
+ * delays the handlers of other pins once all the threads are busy.
+ *
+ * Return:
+ *   0 for success, and -1 on failures (or if gpio_poll() is running).
+ */
+int gpio_poll_set_num_workers(gpiopoll_desc_t *gpdesc, int num_workers);
+
 /* 
  * Function to retrieve the configuration of the GPIO pin described
  * by the poll descriptor. Typical use would be to call from the
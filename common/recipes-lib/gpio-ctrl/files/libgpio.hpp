@@ -1,7 +1,9 @@
 #ifndef _LIBGPIO_HPP_
 #define _LIBGPIO_HPP_
 #include <iostream>
+#include <string>
 #include <system_error>
+#include <vector>
 
 #ifdef __TEST__
 #include "libgpio.h"
@@ -91,4 +93,64 @@ class GPIO {
     }
   }
 };
+
+// A set of GPIOs opened once by their shadow names, held until the group
+// is destroyed. Bit <i> of the value masks is the i-th shadow; the values
+// are read (or set) at once, not line by line.
+class GPIOGroup {
+ protected:
+  std::vector<std::string> shadows;
+  gpio_group_t* group = nullptr;
+
+ public:
+  GPIOGroup(const std::vector<std::string>& _shadows) : shadows(_shadows) {
+    std::vector<const char*> names;
+    for (auto& shadow : shadows) {
+      names.push_back(shadow.c_str());
+    }
+    group = gpio_group_open(names.data(), names.size());
+    if (!group) {
+      throw std::system_error(errno, std::system_category());
+    }
+  }
+  GPIOGroup(const GPIOGroup&) = delete;
+  GPIOGroup& operator=(const GPIOGroup&) = delete;
+  virtual ~GPIOGroup() {
+    gpio_group_close(group);
+  }
+
+  size_t size() const {
+    return shadows.size();
+  }
+  const std::vector<std::string>& get_shadows() const {
+    return shadows;
+  }
+
+  virtual unsigned int get_values() {
+    unsigned int mask = 0;
+    if (gpio_group_get_values(group, &mask) != 0) {
+      throw std::system_error(errno, std::system_category());
+    }
+    return mask;
+  }
+  virtual void set_values(unsigned int mask) {
+    if (gpio_group_set_values(group, mask) != 0) {
+      throw std::system_error(errno, std::system_category());
+    }
+  }
+  virtual void set_edge(gpio_edge_t val) {
+    if (gpio_group_set_edge(group, val) != 0) {
+      throw std::system_error(errno, std::system_category());
+    }
+  }
+  // Wait for edges of the GPIOs (see set_edge()) for up to timeout ms, -1
+  // for no limit. Returns the mask of the GPIOs with an edge, 0 on timeout.
+  virtual unsigned int wait_edges(int timeout = -1) {
+    unsigned int events = 0;
+    if (gpio_group_wait_edges(group, timeout, &events) != 0) {
+      throw std::system_error(errno, std::system_category());
+    }
+    return events;
+  }
+};
 #endif
@@ -24,6 +24,10 @@
 
 #define NANOSEC_IN_SEC (1000 * 1000 * 1000)
 #define HR_NANOSLEEP_THRESHOLD_DEFAULT (1 * 1000 * 1000) // 1ms
+#define HR_NANOSLEEP_SLACK_DEFAULT (100 * 1000) // 100us
+#define HR_NANOSLEEP_SLACK_MAX (2 * 1000 * 1000) // 2ms
+#define HR_NANOSLEEP_CALIBRATE_NS (50 * 1000) // 50us
+#define HR_NANOSLEEP_CALIBRATE_ROUNDS 32
 
 /*
  * Before adding the high resolution timer support, either spin or nanosleep()
@@ -67,4 +71,76 @@ static int hr_nanosleep(uint64_t ns) {
   return hr_nanosleep_threshold(ns, HR_NANOSLEEP_THRESHOLD_DEFAULT);
 }
 
+/*
+ * Hybrid sleep: nanosleep() until the deadline is within the slack, which
+ * is how late nanosleep() may wake up, then spin on CLOCK_MONOTONIC_RAW for
+ * the rest. Most of the interval is spent asleep, and the wakeup is as
+ * precise as the spin. CLOCK_MONOTONIC_RAW is not slewed by NTP, so the
+ * interval is not stretched or shrunk by a time adjustment.
+ *
+ * The slack is per process (per translation unit, as the header is all
+ * there is), HR_NANOSLEEP_SLACK_DEFAULT until hr_nanosleep_calibrate()
+ * measures it.
+ */
+static inline uint64_t *hr_nanosleep_slack(void) {
+  static uint64_t slack_ns = HR_NANOSLEEP_SLACK_DEFAULT;
+  return &slack_ns;
+}
+
+// Current CLOCK_MONOTONIC_RAW time in ns
+static inline uint64_t hr_clock_raw_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (uint64_t)ts.tv_sec * NANOSEC_IN_SEC + ts.tv_nsec;
+}
+
+/*
+ * Sets the slack to the worst nanosleep() overshoot over a few short
+ * sleeps, and returns it. Takes a few ms; call it once at startup, after
+ * the process got its scheduling policy and priority.
+ */
+static inline uint64_t hr_nanosleep_calibrate(void) {
+  struct timespec req = {0, HR_NANOSLEEP_CALIBRATE_NS};
+  uint64_t worst = 0;
+  int i;
+
+  for (i = 0; i < HR_NANOSLEEP_CALIBRATE_ROUNDS; i++) {
+    uint64_t start = hr_clock_raw_ns(), late;
+    if (nanosleep(&req, NULL) != 0) {
+      continue;
+    }
+    late = hr_clock_raw_ns() - start;
+    late = late > HR_NANOSLEEP_CALIBRATE_NS ?
+      late - HR_NANOSLEEP_CALIBRATE_NS : 0;
+    worst = late > worst ? late : worst;
+  }
+  *hr_nanosleep_slack() =
+    worst < HR_NANOSLEEP_SLACK_MAX ? worst : HR_NANOSLEEP_SLACK_MAX;
+  return *hr_nanosleep_slack();
+}
+
+// Sleep until <deadline_ns> of CLOCK_MONOTONIC_RAW (see hr_clock_raw_ns())
+static inline int hr_nanosleep_until(uint64_t deadline_ns) {
+  uint64_t slack = *hr_nanosleep_slack(), now;
+
+  while ((now = hr_clock_raw_ns()) < deadline_ns) {
+    uint64_t left = deadline_ns - now;
+    if (left > slack) {
+      // An interrupted sleep just goes around the loop again
+      struct timespec req;
+      left -= slack;
+      req.tv_sec = left / NANOSEC_IN_SEC;
+      req.tv_nsec = left % NANOSEC_IN_SEC;
+      if (nanosleep(&req, NULL) != 0 && errno != EINTR) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+static inline int hr_nanosleep_hybrid(uint64_t ns) {
+  return hr_nanosleep_until(hr_clock_raw_ns() + ns);
+}
+
 #endif
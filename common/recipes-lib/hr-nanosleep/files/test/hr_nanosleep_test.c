@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <openbmc/hr_nanosleep.h>
@@ -71,6 +72,70 @@ void test_hr_nanosleep(int n, int low, int high) {
          min, max, total / n);
 }
 
+static int plain_nanosleep(uint64_t ns) {
+  struct timespec req = {ns / NANOSEC_IN_SEC, ns % NANOSEC_IN_SEC};
+  return nanosleep(&req, NULL);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint64_t cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * NANOSEC_IN_SEC + ts.tv_nsec;
+}
+
+/*
+ * Overshoot of a sleep function over n sleeps of <ns>, measured against
+ * CLOCK_MONOTONIC_RAW, and the CPU time it used per sleep.
+ */
+static void bench_sleep(const char *name, int (*sleep_fn)(uint64_t),
+                        uint64_t ns, int n) {
+  uint64_t *late = calloc(n, sizeof(*late));
+  uint64_t total = 0, cpu;
+  int i;
+
+  assert(late != NULL);
+  cpu = cpu_ns();
+  for (i = 0; i < n; i++) {
+    uint64_t start = hr_clock_raw_ns(), slept;
+    sleep_fn(ns);
+    slept = hr_clock_raw_ns() - start;
+    late[i] = slept > ns ? slept - ns : 0;
+    total += late[i];
+  }
+  cpu = cpu_ns() - cpu;
+  qsort(late, n, sizeof(*late), cmp_u64);
+  printf("%-20s %8lluns: late min=%lluns avg=%lluns p99=%lluns max=%lluns "
+         "cpu=%lluns\n", name, (unsigned long long)ns,
+         (unsigned long long)late[0], (unsigned long long)(total / n),
+         (unsigned long long)late[n * 99 / 100],
+         (unsigned long long)late[n - 1], (unsigned long long)(cpu / n));
+  free(late);
+}
+
+/*
+ * Benchmark of nanosleep(), hr_nanosleep() and hr_nanosleep_hybrid(),
+ * for comparing the overshoot and CPU use of each across SoCs.
+ */
+static void bench(int n) {
+  static const uint64_t intervals[] = {
+    10 * 1000, 50 * 1000, 100 * 1000, 500 * 1000, 1000 * 1000, 5000 * 1000,
+  };
+  size_t i;
+
+  printf("\nCalibrated hybrid slack: %lluns\n",
+         (unsigned long long)hr_nanosleep_calibrate());
+  for (i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+    bench_sleep("nanosleep", plain_nanosleep, intervals[i], n);
+    bench_sleep("hr_nanosleep", hr_nanosleep, intervals[i], n);
+    bench_sleep("hr_nanosleep_hybrid", hr_nanosleep_hybrid, intervals[i], n);
+  }
+}
+
 int main(int argc, const char *argv[])
 {
   int n;
@@ -78,6 +143,11 @@ int main(int argc, const char *argv[])
   uint64_t diff;
   struct timespec start, end;
 
+  if (argc > 1 && !strcmp(argv[1], "--bench")) {
+    bench(argc > 2 ? atoi(argv[2]) : 200);
+    return 0;
+  }
+
   srandom(clock());
 
   /* First, call clock_gettime() N times */
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2018-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Round trip benchmark of the IPC layer: an echo service in the process
+ * is exercised over a sweep of payload size, client concurrency and
+ * max_active (the workers of a pool service). */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ipc.h"
+
+#define MAX_PAYLOAD 4096
+#define MAX_LIST 8
+#define POOL_QUEUE 256
+#define TIMEOUT 5
+
+static const char *svc_names[] = {"thread", "pool"};
+static const char *cli_names[] = {"oneshot", "cached"};
+static const char *step_names[IPC_TRACE_NUM] = {
+  "connect", "send", "remote", "recv", "handle",
+};
+
+typedef struct {
+  const char *endpoint;
+  int cached;
+  size_t size;
+  int num_req;
+  uint32_t *rtt_us;
+  int errors;
+} bench_cli_t;
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static int echo_handle_req(client_t *cli)
+{
+  uint8_t buf[MAX_PAYLOAD];
+  size_t len = sizeof(buf);
+
+  if (ipc_recv_req(cli, buf, &len, TIMEOUT)) {
+    return -1;
+  }
+  return ipc_send_resp(cli, buf, len);
+}
+
+static void *bench_client(void *param)
+{
+  bench_cli_t *bc = (bench_cli_t *)param;
+  uint8_t req[MAX_PAYLOAD], resp[MAX_PAYLOAD];
+  size_t resp_len;
+  uint64_t start;
+  int i, rc;
+
+  memset(req, 0x5a, bc->size);
+  for (i = 0; i < bc->num_req; i++) {
+    resp_len = sizeof(resp);
+    start = now_us();
+    if (bc->cached) {
+      rc = ipc_send_req_cached(bc->endpoint, req, bc->size, resp, &resp_len, TIMEOUT);
+    } else {
+      rc = ipc_send_req(bc->endpoint, req, bc->size, resp, &resp_len, TIMEOUT);
+    }
+    bc->rtt_us[i] = (uint32_t)(now_us() - start);
+    if (rc || resp_len != bc->size) {
+      bc->errors++;
+    }
+  }
+  if (bc->cached) {
+    ipc_close_cached();
+  }
+  return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int run(int id, int svc_mode, int cli_mode, int max_active,
+               size_t size, int conc, int num_req, int trace)
+{
+  char endpoint[MAX_ENDPOINT_LEN];
+  bench_cli_t bc[conc];
+  pthread_t tid[conc];
+  uint32_t *rtt;
+  uint64_t start, elapsed;
+  int i, total = conc * num_req, errors = 0, rc;
+
+  snprintf(endpoint, sizeof(endpoint), "ipc_bench_%d", id);
+  if (svc_mode) {
+    rc = ipc_start_svc_pool(endpoint, echo_handle_req, max_active, POOL_QUEUE, NULL, NULL);
+  } else {
+    rc = ipc_start_svc(endpoint, echo_handle_req, max_active, NULL, NULL);
+  }
+  if (rc) {
+    fprintf(stderr, "failed to start %s\n", endpoint);
+    return -1;
+  }
+  usleep(100 * 1000);
+
+  rtt = calloc(total, sizeof(*rtt));
+  if (!rtt) {
+    return -1;
+  }
+  ipc_trace_reset();
+  start = now_us();
+  for (i = 0; i < conc; i++) {
+    bc[i] = (bench_cli_t){endpoint, cli_mode, size, num_req, rtt + i * num_req, 0};
+    pthread_create(&tid[i], NULL, bench_client, &bc[i]);
+  }
+  for (i = 0; i < conc; i++) {
+    pthread_join(tid[i], NULL);
+    errors += bc[i].errors;
+  }
+  elapsed = now_us() - start;
+
+  qsort(rtt, total, sizeof(*rtt), cmp_u32);
+  printf("%-6s %-7s %6d %6zu %4d %9.0f %7u %7u %7u %7u %6d\n",
+    svc_names[svc_mode], cli_names[cli_mode], max_active, size, conc,
+    elapsed ? total * 1e6 / elapsed : 0.0,
+    rtt[total / 2], rtt[total * 90 / 100], rtt[total * 99 / 100],
+    rtt[total - 1], errors);
+  free(rtt);
+
+  if (trace) {
+    ipc_trace_t tr;
+    if (ipc_trace_get(endpoint, &tr) == 0) {
+      for (i = 0; i < IPC_TRACE_NUM; i++) {
+        if (tr.stat[i].count) {
+          printf("    %-8s avg %6llu us  max %7u us  (%llu)\n", step_names[i],
+            (unsigned long long)(tr.stat[i].total_us / tr.stat[i].count),
+            tr.stat[i].max_us, (unsigned long long)tr.stat[i].count);
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static int parse_list(const char *arg, int *list, int max)
+{
+  char *str = strdup(arg), *tok, *save = NULL;
+  int num = 0;
+
+  for (tok = strtok_r(str, ",", &save); tok && num < max;
+       tok = strtok_r(NULL, ",", &save)) {
+    list[num++] = atoi(tok);
+  }
+  free(str);
+  return num;
+}
+
+static void usage(const char *prog)
+{
+  printf("Usage: %s [-n requests] [-s sizes] [-c clients] [-a max_active] [-t]\n"
+         "  -n  requests per client thread (default 200)\n"
+         "  -s  payload sizes, comma separated (default 16,256,4096)\n"
+         "  -c  client threads (default 1,4,16)\n"
+         "  -a  max_active, or workers of a pool service (default 1,4,16)\n"
+         "  -m  service modes: thread, pool or both (default both)\n"
+         "  -t  report the time of every step of a request\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+  int sizes[MAX_LIST] = {16, 256, MAX_PAYLOAD};
+  int concs[MAX_LIST] = {1, 4, 16};
+  int actives[MAX_LIST] = {1, 4, 16};
+  int num_sizes = 3, num_concs = 3, num_actives = 3;
+  int num_req = 200, trace = 0, svc_first = 0, svc_last = 1;
+  int opt, m, c, a, s, p, id = 0;
+
+  while ((opt = getopt(argc, argv, "n:s:c:a:m:th")) != -1) {
+    switch (opt) {
+      case 'n':
+        num_req = atoi(optarg);
+        break;
+      case 's':
+        num_sizes = parse_list(optarg, sizes, MAX_LIST);
+        break;
+      case 'c':
+        num_concs = parse_list(optarg, concs, MAX_LIST);
+        break;
+      case 'a':
+        num_actives = parse_list(optarg, actives, MAX_LIST);
+        break;
+      case 'm':
+        if (!strcmp(optarg, "thread")) {
+          svc_last = 0;
+        } else if (!strcmp(optarg, "pool")) {
+          svc_first = 1;
+        }
+        break;
+      case 't':
+        trace = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : -1;
+    }
+  }
+  if (num_req <= 0) {
+    usage(argv[0]);
+    return -1;
+  }
+  for (s = 0; s < num_sizes; s++) {
+    if (sizes[s] <= 0 || sizes[s] > MAX_PAYLOAD) {
+      fprintf(stderr, "payload size must be 1 - %d\n", MAX_PAYLOAD);
+      return -1;
+    }
+  }
+  for (c = 0; c < num_concs; c++) {
+    if (concs[c] <= 0) {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  for (a = 0; a < num_actives; a++) {
+    if (actives[a] <= 0) {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  ipc_trace_enable(trace);
+
+  printf("%-6s %-7s %6s %6s %4s %9s %7s %7s %7s %7s %6s\n",
+    "svc", "client", "active", "size", "conc", "req/s",
+    "p50us", "p90us", "p99us", "maxus", "errors");
+  for (m = svc_first; m <= svc_last; m++) {
+    for (p = 0; p < 2; p++) {
+      for (a = 0; a < num_actives; a++) {
+        for (s = 0; s < num_sizes; s++) {
+          for (c = 0; c < num_concs; c++) {
+            if (run(id++, m, p, actives[a], sizes[s], concs[c], num_req, trace)) {
+              return -1;
+            }
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
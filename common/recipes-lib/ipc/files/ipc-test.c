@@ -5,6 +5,7 @@
 #include "ipc.h"
 
 char *svc_cookie = "test_cookie";
+int mux_reqs = 0;
 
 int test_handle_req(client_t *cli)
 {
@@ -16,6 +17,8 @@ int test_handle_req(client_t *cli)
 
   assert(strcmp(cli->endpoint, "test_svc") == 0);
   assert(cli->svc_cookie == svc_cookie);
+  if (cli->mux)
+    mux_reqs++;
   if (ipc_recv_req(cli, req, &len, 1) != 0) {
     assert(0);
     return -1;
@@ -32,6 +35,21 @@ int test_handle_req(client_t *cli)
   return 0;
 }
 
+int test_pool_handle_req(client_t *cli)
+{
+  uint8_t req[32] = {0};
+  size_t len = 32;
+
+  assert(cli->svc_cookie == svc_cookie);
+  if (ipc_recv_req(cli, req, &len, 1) != 0) {
+    assert(0);
+    return -1;
+  }
+  if (req[0] == 0xff)
+    sleep(1);
+  return ipc_send_resp(cli, req, len);
+}
+
 int main(int argc, char *argv[])
 {
   int rc;
@@ -55,5 +73,107 @@ int main(int argc, char *argv[])
     assert(memcmp(req, resp, 4) == 0);
   }
   printf("PASSED: Multiple request\n");
+
+  for (int i = 0; i < 10; i++) {
+    memset(resp, 0, sizeof(resp));
+    resp_len = 32;
+    rc = ipc_send_req_cached("test_svc", req, 4, resp, &resp_len, 1);
+    assert(rc == 0);
+    assert(resp_len == 4);
+    assert(memcmp(req, resp, 4) == 0);
+  }
+  assert(mux_reqs == 10);
+  printf("PASSED: Multiple request over a cached connection\n");
+
+  uint32_t ids[3];
+  for (int i = 0; i < 3; i++) {
+    rc = ipc_submit_req("test_svc", req, 4, &ids[i]);
+    assert(rc == 0);
+  }
+  for (int i = 2; i >= 0; i--) {
+    memset(resp, 0, sizeof(resp));
+    resp_len = 32;
+    rc = ipc_wait_resp("test_svc", ids[i], resp, &resp_len, 1);
+    assert(rc == 0);
+    assert(memcmp(req, resp, 4) == 0);
+  }
+  resp_len = 32;
+  rc = ipc_wait_resp("test_svc", ids[0], resp, &resp_len, 1);
+  assert(rc != 0);
+  printf("PASSED: Pipelined requests\n");
+
+  for (int i = 0; i < 3; i++) {
+    rc = ipc_submit_req("test_svc", req, 4, &ids[i]);
+    assert(rc == 0);
+  }
+  assert(ipc_cached_fd("test_svc") >= 0);
+  int seen = 0;
+  for (int i = 0; i < 3; i++) {
+    uint32_t id;
+    memset(resp, 0, sizeof(resp));
+    resp_len = 32;
+    rc = ipc_wait_any("test_svc", &id, resp, &resp_len, 1);
+    assert(rc == 0 && resp_len == 4 && memcmp(req, resp, 4) == 0);
+    for (int j = 0; j < 3; j++) {
+      if (ids[j] == id) {
+        seen |= 1 << j;
+      }
+    }
+  }
+  assert(seen == 7);
+  assert(ipc_resp_ready("test_svc") < 0);
+  printf("PASSED: Requests completed in any order\n");
+
+  ipc_close_cached();
+  unlink("/tmp/test_svc.mux");
+  memset(resp, 0, sizeof(resp));
+  resp_len = 32;
+  rc = ipc_send_req_cached("test_svc", req, 4, resp, &resp_len, 1);
+  assert(rc == 0);
+  assert(memcmp(req, resp, 4) == 0);
+  assert(mux_reqs == 16);
+  printf("PASSED: Fallback to one-shot connections\n");
+
+  ipc_svc_stats_t stats;
+  rc = ipc_start_svc_pool("test_pool", test_pool_handle_req, 1, 2, svc_cookie, NULL);
+  assert(rc == 0);
+  sleep(1);
+  for (int i = 0; i < 10; i++) {
+    memset(resp, 0, sizeof(resp));
+    resp_len = 32;
+    rc = ipc_send_req("test_pool", req, 4, resp, &resp_len, 1);
+    assert(rc == 0);
+    assert(resp_len == 4 && memcmp(req, resp, 4) == 0);
+    memset(resp, 0, sizeof(resp));
+    resp_len = 32;
+    rc = ipc_send_req_cached("test_pool", req, 4, resp, &resp_len, 1);
+    assert(rc == 0);
+    assert(resp_len == 4 && memcmp(req, resp, 4) == 0);
+  }
+  rc = ipc_svc_stats("test_pool", &stats);
+  assert(rc == 0);
+  assert(stats.workers == 1 && stats.queued == 20 && stats.rejected == 0);
+  printf("PASSED: Worker pool requests\n");
+
+  uint8_t slow_req[4] = {0xff};
+  int served = 0;
+  uint32_t slow_ids[6];
+  for (int i = 0; i < 6; i++) {
+    rc = ipc_submit_req("test_pool", slow_req, 4, &slow_ids[i]);
+    assert(rc == 0);
+  }
+  for (int i = 0; i < 6; i++) {
+    resp_len = 32;
+    rc = ipc_wait_resp("test_pool", slow_ids[i], resp, &resp_len, 5);
+    assert(rc == 0);
+    if (resp_len == 4)
+      served++;
+  }
+  rc = ipc_svc_stats("test_pool", &stats);
+  assert(rc == 0);
+  assert(served >= 2 && served + stats.rejected == 6);
+  assert(stats.queue_depth == 0 && stats.max_queue_depth == 2);
+  assert(stats.wait_us_max >= 900000);
+  printf("PASSED: Worker pool backpressure\n");
   return 0;
 }
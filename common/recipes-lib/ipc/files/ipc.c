@@ -23,10 +23,16 @@
 #include <pthread.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
 #include <sys/un.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "ipc.h"
 
@@ -56,6 +62,18 @@
 #define WAIT_CLIENT_RETRIES 5
 #define ACCEPT_RECOVER_RETRIES 5
 
+/* Persistent connections are served at /tmp/<endpoint>.mux, every
+ * request and response in a frame of a header and the message */
+#define MUX_SOCK_FMT "/tmp/%s.mux"
+#define MUX_MAX_MSG_LEN (1024 * 1024)
+/* Seconds before retrying a service without persistent connections */
+#define MUX_RECHECK_TIME 30
+
+#define POOL_MAX_EVENTS 16
+
+#define TRACE_MAX_ENDPOINTS 32
+#define POOL_REJECT_LOG_TIME 60
+
 #define SAVE_ERRNO_RUN(exp)  \
   do {                       \
     int saved_errno = errno; \
@@ -70,8 +88,61 @@ struct service_s {
   pthread_cond_t  cond;
   int             num_active;
   int             active_limit;
+  /* Handlers of requests over persistent connections, limited apart as
+   * svc_thread() keeps one of num_active while waiting for a client */
+  int             num_mux_active;
+  /* Set for ipc_start_svc_pool() */
+  struct svc_pool_s *pool;
+};
+
+typedef struct {
+  uint32_t id;
+  uint32_t len;
+} mux_hdr_t;
+
+/* A persistent connection, served by a reader thread dispatching its
+ * requests, and shared by the handlers writing their responses */
+typedef struct {
+  int fd;
+  int refs;
+  pthread_mutex_t lock;
+  service_t *svc;
+} mux_conn_t;
+
+struct mux_req_s {
+  mux_conn_t *conn;
+  uint32_t id;
+  bool responded;
+  size_t len;
+  uint8_t data[];
 };
 
+/* A response received ahead of the one waited for, or a request to a
+ * service without persistent connections, sent when waited for */
+typedef struct mux_pending_s {
+  struct mux_pending_s *next;
+  uint32_t id;
+  bool unsent;
+  size_t len;
+  uint8_t data[];
+} mux_pending_t;
+
+/* Connection of a client thread to an endpoint */
+typedef struct mux_client_s {
+  struct mux_client_s *next;
+  char endpoint[MAX_ENDPOINT_LEN];
+  int fd;
+  /* Requests since the connection, and those still in flight */
+  uint32_t first_id;
+  uint32_t next_id;
+  int inflight;
+  time_t recheck;
+  mux_pending_t *pending;
+} mux_client_t;
+
+static pthread_key_t mux_clients_key;
+static pthread_once_t mux_clients_once = PTHREAD_ONCE_INIT;
+
 static void set_sock_timeout(int sock, int timeout)
 {
   if (timeout >= 0) {
@@ -84,12 +155,155 @@ static void set_sock_timeout(int sock, int timeout)
   }
 }
 
+static time_t mono_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+static uint64_t mono_time_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Trace counters of the endpoints used by the process */
+typedef struct {
+  char endpoint[MAX_ENDPOINT_LEN];
+  ipc_trace_t trace;
+} trace_entry_t;
+
+static trace_entry_t g_trace[TRACE_MAX_ENDPOINTS];
+static int g_trace_num = 0;
+static int g_trace_on = 0;
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+
+static void trace_report(void)
+{
+  static const char *names[IPC_TRACE_NUM] = {
+    "connect", "send", "remote", "recv", "handle",
+  };
+  ipc_trace_stat_t *st;
+  int i, j;
+
+  pthread_mutex_lock(&g_trace_lock);
+  for (i = 0; i < g_trace_num; i++) {
+    for (j = 0; j < IPC_TRACE_NUM; j++) {
+      st = &g_trace[i].trace.stat[j];
+      if (st->count == 0) {
+        continue;
+      }
+      fprintf(stderr, "ipc %s %s: %llu calls, %llu failed, avg %llu us, max %u us\n",
+        g_trace[i].endpoint, names[j], (unsigned long long)st->count,
+        (unsigned long long)st->errors,
+        (unsigned long long)(st->total_us / st->count), st->max_us);
+    }
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+static void trace_init(void)
+{
+  const char *env = getenv("IPC_TRACE");
+
+  if (env && *env && strcmp(env, "0")) {
+    g_trace_on = 1;
+    atexit(trace_report);
+  }
+}
+
+/* Start time of a traced step, 0 if not tracing */
+static uint64_t trace_start(void)
+{
+  pthread_once(&g_trace_once, trace_init);
+  return __atomic_load_n(&g_trace_on, __ATOMIC_RELAXED) ? mono_time_us() : 0;
+}
+
+static void trace_add(const char *endpoint, int step, uint64_t start, bool ok)
+{
+  ipc_trace_stat_t *st;
+  uint64_t us;
+  int i;
+
+  if (!start) {
+    return;
+  }
+  us = mono_time_us() - start;
+  pthread_mutex_lock(&g_trace_lock);
+  for (i = 0; i < g_trace_num; i++) {
+    if (!strcmp(g_trace[i].endpoint, endpoint)) {
+      break;
+    }
+  }
+  if (i == g_trace_num) {
+    if (g_trace_num == TRACE_MAX_ENDPOINTS) {
+      pthread_mutex_unlock(&g_trace_lock);
+      return;
+    }
+    strncpy(g_trace[i].endpoint, endpoint, MAX_ENDPOINT_LEN - 1);
+    g_trace_num++;
+  }
+  st = &g_trace[i].trace.stat[step];
+  st->count++;
+  if (!ok) {
+    st->errors++;
+  }
+  st->total_us += us;
+  if (us > st->max_us) {
+    st->max_us = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+void ipc_trace_enable(int enable)
+{
+  pthread_once(&g_trace_once, trace_init);
+  __atomic_store_n(&g_trace_on, enable ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+int ipc_trace_get(const char *endpoint, ipc_trace_t *trace)
+{
+  int i, ret = -1;
+
+  if (!endpoint || !trace) {
+    errno = EINVAL;
+    return -1;
+  }
+  pthread_mutex_lock(&g_trace_lock);
+  for (i = 0; i < g_trace_num; i++) {
+    if (!strcmp(g_trace[i].endpoint, endpoint)) {
+      *trace = g_trace[i].trace;
+      ret = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+  if (ret) {
+    errno = ENOENT;
+  }
+  return ret;
+}
+
+void ipc_trace_reset(void)
+{
+  pthread_mutex_lock(&g_trace_lock);
+  memset(g_trace, 0, sizeof(g_trace));
+  g_trace_num = 0;
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
 int ipc_send_req(const char *endpoint, uint8_t *req, size_t req_len,
                  uint8_t *resp, size_t *resp_len, int timeout)
 {
   struct sockaddr_un remote;
   int len, retry = 0, sockfd;
   size_t max_resp;
+  uint64_t t;
 
   if (!req || !req_len || !resp || !resp_len || !*resp_len) {
     DEBUG("%s(%s) bad parameters passed", __func__, endpoint);
@@ -109,27 +323,43 @@ int ipc_send_req(const char *endpoint, uint8_t *req, size_t req_len,
   sprintf(remote.sun_path, "/tmp/%s", endpoint);
   len = strlen(remote.sun_path) + sizeof(remote.sun_family);
 
+  t = trace_start();
   if (connect(sockfd, (struct sockaddr *)&remote, len) == -1) {
     DEBUG("%s(%s) failed to connect (%s)", __func__, endpoint, strerror(errno));
+    SAVE_ERRNO_RUN(trace_add(endpoint, IPC_TRACE_CONNECT, t, false));
     goto error;
   }
-  
+  trace_add(endpoint, IPC_TRACE_CONNECT, t, true);
+
+  t = trace_start();
   if (send(sockfd, req, req_len, MSG_NOSIGNAL) != req_len) {
     DEBUG("%s(%s) failed to send (%s)", __func__, endpoint, strerror(errno));
+    SAVE_ERRNO_RUN(trace_add(endpoint, IPC_TRACE_SEND, t, false));
     goto error;
   }
+  trace_add(endpoint, IPC_TRACE_SEND, t, true);
 
+  t = trace_start();
+  if (t) {
+    /* Apart from recv(), while the service handles the request */
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    poll(&pfd, 1, timeout > 0 ? timeout * 1000 : -1);
+    trace_add(endpoint, IPC_TRACE_REMOTE, t, true);
+    t = trace_start();
+  }
   max_resp = *resp_len;
   while ((len = recv(sockfd, resp, max_resp, 0)) < 0) {
     if ((errno != EINTR) ||
         (retry++ >= MAX_RETRIES)) {
       DEBUG("%s(%s) failed to recv (%s)", __func__, endpoint, strerror(errno));
+      SAVE_ERRNO_RUN(trace_add(endpoint, IPC_TRACE_RECV, t, false));
       goto error;
     }
     DEBUG("%s(%s) recv interrupted (%s)", __func__, endpoint, strerror(errno));
     usleep(20 * 1000);
   }
   *resp_len = len;
+  trace_add(endpoint, IPC_TRACE_RECV, t, true);
 
   close(sockfd);
   return 0;
@@ -139,216 +369,1308 @@ error:
   return -1;
 }
 
-int ipc_recv_req(client_t *cli, uint8_t *req, size_t *req_len, int timeout)
+/* Read or write exactly len bytes, 0 on success */
+static int sock_xfer(int sock, void *buf, size_t len, bool out)
 {
-  int r;
-  int ret = -1;
-  int max = (int)*req_len;
-  if (!cli || !req || !req_len || !*req_len) {
-    return -1;
-  }
+  uint8_t *p = buf;
+  int retry = 0;
+  ssize_t n;
 
-  set_sock_timeout(cli->fd, timeout);
-  
-  for (r = 0; r < MAX_RETRIES; r++) {
-    int rx_len = recv(cli->fd, req, max, 0);
-    if (rx_len >= 0) {
-      ret = 0;
-      *req_len = rx_len;
-      break;
+  while (len > 0) {
+    if (out) {
+      n = send(sock, p, len, MSG_NOSIGNAL);
+    } else {
+      n = recv(sock, p, len, 0);
     }
-    if (rx_len < 0 && errno != EINTR) {
-      DEBUG("%s(%s) failed to recv (%s)", __func__, cli->endpoint, strerror(errno));
-      break;
+    if (n == 0) {
+      errno = EPIPE;
+      return -1;
     }
-    usleep(20 * 1000);
+    if (n < 0) {
+      if (errno != EINTR || retry++ >= MAX_RETRIES) {
+        return -1;
+      }
+      continue;
+    }
+    p += n;
+    len -= n;
   }
-  return ret;
+  return 0;
 }
 
-static void cli_done(client_t *cli)
+/* Send a framed message in one piece, 0 on success */
+static int mux_send(int sock, uint32_t id, const uint8_t *msg, size_t len)
 {
-  service_t *svc = cli->svc;
-  cli->svc = NULL;
-  if (svc) {
-    close(cli->fd);
-    free(cli);
-    pthread_mutex_lock(&svc->mutex);
-    svc->num_active--;
-    pthread_cond_signal(&svc->cond);
-    pthread_mutex_unlock(&svc->mutex);
+  mux_hdr_t hdr = {id, (uint32_t)len};
+  struct iovec iov[2] = {
+    {&hdr, sizeof(hdr)},
+    {(void *)msg, len},
+  };
+  struct msghdr mh = {0};
+  size_t total = sizeof(hdr) + len, sent = 0;
+  ssize_t n;
+  int retry = 0;
+
+  mh.msg_iov = iov;
+  mh.msg_iovlen = 2;
+  while ((n = sendmsg(sock, &mh, MSG_NOSIGNAL)) < 0) {
+    if (errno != EINTR || retry++ >= MAX_RETRIES) {
+      return -1;
+    }
+  }
+  sent = n;
+  if (sent < total) {
+    /* Rest of a large message */
+    if (sent < sizeof(hdr)) {
+      if (sock_xfer(sock, (uint8_t *)&hdr + sent, sizeof(hdr) - sent, true)) {
+        return -1;
+      }
+      sent = sizeof(hdr);
+    }
+    return sock_xfer(sock, (uint8_t *)msg + (sent - sizeof(hdr)),
+                     total - sent, true);
   }
+  return 0;
 }
 
-int ipc_send_resp(client_t *cli, uint8_t *resp, size_t resp_len)
+static void mux_client_reset(mux_client_t *mc)
 {
-  int ret = 0;
-  if (!cli || !resp || !resp_len) {
-    return -1;
-  }
-  if (send(cli->fd, resp, resp_len, MSG_NOSIGNAL) < 0) {
-    DEBUG("%s(%s) failed to recv (%s)", __func__, cli->endpoint, strerror(errno));
-    ret = -1;
-  } else {
-    cli_done(cli);
+  if (mc->fd >= 0) {
+    close(mc->fd);
+    mc->fd = -1;
   }
-  return ret;
+  mc->inflight = 0;
 }
 
-static void *conn_handler(void *param)
+static void mux_clients_free(void *param)
 {
-  client_t *cli = (client_t *)param;
-  ipc_handle_req_t handle_req = cli->svc->handle_req;
-  if(handle_req(cli)) {
-    cli_done(cli);
+  mux_client_t *mc = param, *next;
+  mux_pending_t *p, *pnext;
+
+  for (; mc != NULL; mc = next) {
+    next = mc->next;
+    mux_client_reset(mc);
+    for (p = mc->pending; p != NULL; p = pnext) {
+      pnext = p->next;
+      free(p);
+    }
+    free(mc);
   }
-  pthread_exit(NULL);
-  return NULL;
 }
 
-static client_t *get_client(service_t *svc)
+/* The connections are not to be shared with a forked child */
+static void mux_clients_atfork(void)
 {
-  client_t *cli = NULL;
-  struct timespec ts;
-  struct timeval tp;
-  int rc;
+  mux_clients_free(pthread_getspecific(mux_clients_key));
+  pthread_setspecific(mux_clients_key, NULL);
+}
 
-  gettimeofday(&tp, NULL);
-  ts.tv_sec = tp.tv_sec + CLIENT_TIMEOUT + 1;
-  ts.tv_nsec = 0;
+static void mux_clients_init(void)
+{
+  pthread_key_create(&mux_clients_key, mux_clients_free);
+  pthread_atfork(NULL, NULL, mux_clients_atfork);
+}
 
-  pthread_mutex_lock(&svc->mutex);
-  while (svc->num_active >= svc->active_limit) {
-    rc = pthread_cond_timedwait(&svc->cond, &svc->mutex, &ts);
-    if (rc == ETIMEDOUT) {
-      break;
+static mux_client_t *mux_client_get(const char *endpoint, bool create)
+{
+  mux_client_t *mc;
+
+  pthread_once(&mux_clients_once, mux_clients_init);
+  for (mc = pthread_getspecific(mux_clients_key); mc != NULL; mc = mc->next) {
+    if (!strcmp(mc->endpoint, endpoint)) {
+      return mc;
     }
   }
-  if (rc != ETIMEDOUT) {
-    cli = calloc(1, sizeof(*cli));
-    if (cli) {
-      svc->num_active++;
-      memcpy(cli, &svc->base_cli, sizeof(*cli));
-    }
+  if (!create || strlen(endpoint) >= MAX_ENDPOINT_LEN - 1) {
+    errno = EINVAL;
+    return NULL;
   }
-  pthread_mutex_unlock(&svc->mutex);
-  return cli;
+  mc = calloc(1, sizeof(*mc));
+  if (!mc) {
+    return NULL;
+  }
+  strcpy(mc->endpoint, endpoint);
+  mc->fd = -1;
+  mc->next = pthread_getspecific(mux_clients_key);
+  pthread_setspecific(mux_clients_key, mc);
+  return mc;
 }
 
-static void *svc_thread(void *param)
+/* Connect if not connected. Returns 1 if the service does not take
+ * persistent connections, 0 if connected. */
+static int mux_client_connect(mux_client_t *mc)
 {
-  service_t *svc = (service_t *)param;
-  client_t *base_cli = &svc->base_cli;
-  struct sockaddr_un local, remote;
-  int sock, conn;
-  pthread_attr_t attr;
+  struct sockaddr_un remote;
+  uint64_t t;
   int len;
-  int cli_retries = WAIT_CLIENT_RETRIES;
-  int acc_retries = ACCEPT_RECOVER_RETRIES;
 
-  pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-  pthread_attr_setstacksize(&attr, STACK_SIZE);
-
-  if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
-    DEBUG("%s(%s) failed to create socket (%s)", __func__, base_cli->endpoint, strerror(errno));
-    goto bail;
+  if (mc->fd >= 0) {
+    return 0;
   }
-
-  local.sun_family = AF_UNIX;
-  sprintf(local.sun_path, "/tmp/%s", base_cli->endpoint);
-  unlink(local.sun_path);
-  len = strlen(local.sun_path) + sizeof(local.sun_family);
-  if (bind(sock, (struct sockaddr *)&local, len) == -1) {
-    DEBUG("%s(%s) failed to bind (%s)", __func__, base_cli->endpoint, strerror(errno));
-    goto close_bail;
+  if (mc->recheck && mono_time() < mc->recheck) {
+    return 1;
+  }
+  if ((mc->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+    DEBUG("%s(%s) failed to create socket (%s)", __func__, mc->endpoint, strerror(errno));
+    return -1;
   }
+  remote.sun_family = AF_UNIX;
+  sprintf(remote.sun_path, MUX_SOCK_FMT, mc->endpoint);
+  len = strlen(remote.sun_path) + sizeof(remote.sun_family);
+  t = trace_start();
+  if (connect(mc->fd, (struct sockaddr *)&remote, len) == -1) {
+    DEBUG("%s(%s) failed to connect (%s)", __func__, mc->endpoint, strerror(errno));
+    SAVE_ERRNO_RUN(mux_client_reset(mc));
+    /* Not a failure of the service, as it falls back */
+    SAVE_ERRNO_RUN(trace_add(mc->endpoint, IPC_TRACE_CONNECT, t,
+      errno == ENOENT || errno == ECONNREFUSED));
+    if (errno == ENOENT || errno == ECONNREFUSED) {
+      mc->recheck = mono_time() + MUX_RECHECK_TIME;
+      return 1;
+    }
+    return -1;
+  }
+  trace_add(mc->endpoint, IPC_TRACE_CONNECT, t, true);
+  mc->recheck = 0;
+  mc->first_id = mc->next_id;
+  return 0;
+}
 
-  if (listen(sock, 5) == -1) {
-    DEBUG("%s(%s) failed to listen (%s)", __func__, base_cli->endpoint, strerror(errno));
-    goto close_bail;
+static int mux_pending_add(mux_client_t *mc, uint32_t id, bool unsent,
+                           const uint8_t *data, size_t len)
+{
+  mux_pending_t *p = malloc(sizeof(*p) + len);
+
+  if (!p) {
+    return -1;
   }
+  p->id = id;
+  p->unsent = unsent;
+  p->len = len;
+  memcpy(p->data, data, len);
+  p->next = mc->pending;
+  mc->pending = p;
+  return 0;
+}
 
-  while (1) {
-    socklen_t t = sizeof(remote);
-    pthread_t tid;
-    client_t *cli = get_client(svc);
-    if (!cli) {
-      if (--cli_retries <= 0) {
-        CRITICAL("%s(%s) outstanding clients %d exceeded limit %d",
-          __func__, base_cli->endpoint, svc->num_active, svc->active_limit);
-        break;
-      }
-      ERROR("%s(%s) outstanding clients %d exceeded limit %d retrying in 5 seconds",
-        __func__, base_cli->endpoint, svc->num_active, svc->active_limit);
-      sleep(5);
-      continue;
-    }
-    cli_retries = WAIT_CLIENT_RETRIES;
+static mux_pending_t *mux_pending_take(mux_client_t *mc, uint32_t id)
+{
+  mux_pending_t **pp, *p;
 
-    while (--acc_retries > 0 && (conn = accept(sock, (struct sockaddr *)&remote, &t)) < 0) {
-      ERROR("%s(%s) failed to accept (%s) retrying in 5 seconds", __func__, base_cli->endpoint, strerror(errno));
-      sleep(5);
-      continue;
-    }
-    if (acc_retries <= 0 || conn < 0) {
-      CRITICAL("%s(%s) failed to accept (%s) retrying in 5 seconds", __func__, base_cli->endpoint, strerror(errno));
-      cli_done(cli);
-      break;
-    }
-    acc_retries = ACCEPT_RECOVER_RETRIES;
-    cli->fd = conn;
-    if (pthread_create(&tid, &attr, conn_handler, (void *)cli)) {
-      CRITICAL("%s(%s) failed to create thread (%s)", __func__, base_cli->endpoint, strerror(errno));
-      cli_done(cli);
+  for (pp = &mc->pending; (p = *pp) != NULL; pp = &p->next) {
+    if (p->id == id) {
+      *pp = p->next;
+      return p;
     }
   }
-close_bail:
-  close(sock);
-bail:
-  pthread_exit(NULL);
   return NULL;
 }
 
-int ipc_start_svc(const char *endpoint, ipc_handle_req_t handle_req, int max_active, void *svc_cookie, pthread_t *waiter)
+int ipc_submit_req(const char *endpoint, uint8_t *req, size_t req_len, uint32_t *id)
 {
-  pthread_t tid;
-  pthread_attr_t attr;
-  int ret = 0;
-  service_t *svc;
+  mux_client_t *mc;
+  bool reused;
+  uint64_t t;
+  int ret;
 
-  if (strlen(endpoint) >= MAX_ENDPOINT_LEN - 1) {
+  if (!req || !req_len || req_len > MUX_MAX_MSG_LEN || !id) {
+    DEBUG("%s(%s) bad parameters passed", __func__, endpoint);
+    errno = EINVAL;
     return -1;
   }
-
-  svc = calloc(1, sizeof(*svc));
-  if (!svc) {
+  mc = mux_client_get(endpoint, true);
+  if (!mc) {
     return -1;
   }
 
-  strcpy(svc->base_cli.endpoint, endpoint);
-  svc->base_cli.svc_cookie = svc_cookie;
-  svc->base_cli.fd = -1;
-  svc->handle_req = handle_req;
-  pthread_mutex_init(&svc->mutex, NULL);
-  pthread_cond_init(&svc->cond, NULL);
-  svc->base_cli.svc = svc;
-  svc->num_active = 0;
-  svc->active_limit = max_active;
-
-  pthread_attr_init(&attr);
-  if (!waiter)
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-
-  if (pthread_create(&tid, &attr, svc_thread, svc)) {
-      DEBUG("%s(%s) failed to start thread (%s)", __func__, endpoint, strerror(errno));
-      free(svc);
-      ret = -1;
+  reused = mc->fd >= 0;
+  ret = mux_client_connect(mc);
+  if (ret < 0) {
+    return -1;
+  }
+  *id = mc->next_id++;
+  if (ret > 0) {
+    /* Sent by ipc_send_req() when waited for */
+    return mux_pending_add(mc, *id, true, req, req_len);
+  }
+
+  while (1) {
+    t = trace_start();
+    if (mux_send(mc->fd, *id, req, req_len) == 0) {
+      break;
+    }
+    DEBUG("%s(%s) failed to send (%s)", __func__, endpoint, strerror(errno));
+    SAVE_ERRNO_RUN(trace_add(endpoint, IPC_TRACE_SEND, t, false));
+    SAVE_ERRNO_RUN(mux_client_reset(mc));
+    /* Nothing was taken from a connection the service has closed since,
+     * so the request can go over a new one */
+    if (!reused || errno != EPIPE) {
+      return -1;
+    }
+    reused = false;
+    ret = mux_client_connect(mc);
+    if (ret < 0) {
+      return -1;
+    }
+    if (ret > 0) {
+      return mux_pending_add(mc, *id, true, req, req_len);
+    }
+    mc->first_id = *id;
+  }
+  trace_add(endpoint, IPC_TRACE_SEND, t, true);
+  mc->inflight++;
+  return 0;
+}
+
+/* Read the body of a response of len bytes, truncated to max_resp as
+ * recv() would. Drops the connection on failure. */
+static int mux_recv_body(mux_client_t *mc, size_t len, uint8_t *resp,
+                         size_t max_resp, size_t *resp_len)
+{
+  uint64_t t;
+  int ret;
+
+  *resp_len = len < max_resp ? len : max_resp;
+  t = trace_start();
+  if (sock_xfer(mc->fd, resp, *resp_len, false)) {
+    SAVE_ERRNO_RUN(trace_add(mc->endpoint, IPC_TRACE_RECV, t, false));
+    goto error;
+  }
+  trace_add(mc->endpoint, IPC_TRACE_RECV, t, true);
+  for (len -= *resp_len; len > 0; len -= ret) {
+    uint8_t drop[64];
+    ret = len < sizeof(drop) ? len : sizeof(drop);
+    if (sock_xfer(mc->fd, drop, ret, false)) {
+      goto error;
+    }
+  }
+  return 0;
+
+error:
+  DEBUG("%s(%s) failed to recv (%s)", __func__, mc->endpoint, strerror(errno));
+  SAVE_ERRNO_RUN(mux_client_reset(mc));
+  return -1;
+}
+
+/* Read the header of the next response. Drops the connection on failure. */
+static int mux_recv_hdr(mux_client_t *mc, mux_hdr_t *hdr, int timeout)
+{
+  uint64_t t;
+
+  set_sock_timeout(mc->fd, timeout);
+  t = trace_start();
+  if (sock_xfer(mc->fd, hdr, sizeof(*hdr), false) ||
+      hdr->len > MUX_MAX_MSG_LEN) {
+    SAVE_ERRNO_RUN(trace_add(mc->endpoint, IPC_TRACE_REMOTE, t, false));
+    DEBUG("%s(%s) failed to recv (%s)", __func__, mc->endpoint, strerror(errno));
+    SAVE_ERRNO_RUN(mux_client_reset(mc));
+    return -1;
+  }
+  trace_add(mc->endpoint, IPC_TRACE_REMOTE, t, true);
+  mc->inflight--;
+  return 0;
+}
+
+/* Complete a request from its pending entry, and free it */
+static int mux_pending_complete(const char *endpoint, mux_pending_t *p,
+                                uint8_t *resp, size_t *resp_len, int timeout)
+{
+  int ret;
+
+  if (p->unsent) {
+    ret = ipc_send_req(endpoint, p->data, p->len, resp, resp_len, timeout);
+  } else {
+    *resp_len = p->len < *resp_len ? p->len : *resp_len;
+    memcpy(resp, p->data, *resp_len);
+    ret = 0;
+  }
+  free(p);
+  return ret;
+}
+
+int ipc_wait_resp(const char *endpoint, uint32_t id, uint8_t *resp, size_t *resp_len, int timeout)
+{
+  mux_client_t *mc;
+  mux_pending_t *p;
+  mux_hdr_t hdr;
+  size_t len, max_resp;
+  uint8_t *buf;
+
+  if (!resp || !resp_len || !*resp_len) {
+    DEBUG("%s(%s) bad parameters passed", __func__, endpoint);
+    errno = EINVAL;
+    return -1;
+  }
+  mc = mux_client_get(endpoint, false);
+  if (!mc) {
+    return -1;
+  }
+  max_resp = *resp_len;
+
+  while ((p = mux_pending_take(mc, id)) == NULL) {
+    if (mc->fd < 0 || mc->inflight == 0 ||
+        (uint32_t)(id - mc->first_id) >= (uint32_t)(mc->next_id - mc->first_id)) {
+      /* Lost with an earlier connection, or never sent */
+      errno = mc->fd < 0 ? EPIPE : EINVAL;
+      return -1;
+    }
+    if (mux_recv_hdr(mc, &hdr, timeout)) {
+      return -1;
+    }
+    len = hdr.len;
+    if (hdr.id == id) {
+      return mux_recv_body(mc, len, resp, max_resp, resp_len);
+    }
+    buf = malloc(len ? len : 1);
+    if (!buf || sock_xfer(mc->fd, buf, len, false) ||
+        mux_pending_add(mc, hdr.id, false, buf, len)) {
+      DEBUG("%s(%s) failed to recv (%s)", __func__, endpoint, strerror(errno));
+      SAVE_ERRNO_RUN(free(buf));
+      SAVE_ERRNO_RUN(mux_client_reset(mc));
+      return -1;
+    }
+    free(buf);
+  }
+  return mux_pending_complete(endpoint, p, resp, resp_len, timeout);
+}
+
+int ipc_wait_any(const char *endpoint, uint32_t *id, uint8_t *resp, size_t *resp_len, int timeout)
+{
+  mux_client_t *mc;
+  mux_pending_t *p;
+  mux_hdr_t hdr;
+
+  if (!id || !resp || !resp_len || !*resp_len) {
+    DEBUG("%s(%s) bad parameters passed", __func__, endpoint);
+    errno = EINVAL;
+    return -1;
+  }
+  mc = mux_client_get(endpoint, false);
+  if (!mc) {
+    return -1;
+  }
+  if ((p = mc->pending) != NULL) {
+    mc->pending = p->next;
+    *id = p->id;
+    return mux_pending_complete(endpoint, p, resp, resp_len, timeout);
+  }
+  if (mc->fd < 0 || mc->inflight == 0) {
+    errno = mc->fd < 0 ? EPIPE : EINVAL;
+    return -1;
+  }
+  if (mux_recv_hdr(mc, &hdr, timeout)) {
+    return -1;
+  }
+  *id = hdr.id;
+  return mux_recv_body(mc, hdr.len, resp, *resp_len, resp_len);
+}
+
+int ipc_resp_ready(const char *endpoint)
+{
+  mux_client_t *mc = mux_client_get(endpoint, false);
+  struct pollfd pfd;
+
+  if (!mc) {
+    return -1;
+  }
+  if (mc->pending != NULL) {
+    return 1;
+  }
+  if (mc->fd < 0 || mc->inflight == 0) {
+    errno = mc->fd < 0 ? EPIPE : EINVAL;
+    return -1;
+  }
+  pfd.fd = mc->fd;
+  pfd.events = POLLIN;
+  return poll(&pfd, 1, 0) > 0;
+}
+
+int ipc_cached_fd(const char *endpoint)
+{
+  mux_client_t *mc = mux_client_get(endpoint, false);
+
+  return mc ? mc->fd : -1;
+}
+
+int ipc_send_req_cached(const char *endpoint, uint8_t *req, size_t req_len,
+                        uint8_t *resp, size_t *resp_len, int timeout)
+{
+  uint32_t id;
+
+  if (!resp || !resp_len || !*resp_len) {
+    DEBUG("%s(%s) bad parameters passed", __func__, endpoint);
+    errno = EINVAL;
+    return -1;
+  }
+  if (ipc_submit_req(endpoint, req, req_len, &id)) {
+    return -1;
+  }
+  return ipc_wait_resp(endpoint, id, resp, resp_len, timeout);
+}
+
+void ipc_close_cached(void)
+{
+  pthread_once(&mux_clients_once, mux_clients_init);
+  mux_clients_atfork();
+}
+
+int ipc_recv_req(client_t *cli, uint8_t *req, size_t *req_len, int timeout)
+{
+  int r;
+  int ret = -1;
+  int max = (int)*req_len;
+  if (!cli || !req || !req_len || !*req_len) {
+    return -1;
+  }
+
+  if (cli->mux) {
+    /* Already read by the connection */
+    *req_len = cli->mux->len < *req_len ? cli->mux->len : *req_len;
+    memcpy(req, cli->mux->data, *req_len);
+    cli->trace_start = trace_start();
+    return 0;
+  }
+
+  set_sock_timeout(cli->fd, timeout);
+  
+  for (r = 0; r < MAX_RETRIES; r++) {
+    int rx_len = recv(cli->fd, req, max, 0);
+    if (rx_len >= 0) {
+      ret = 0;
+      *req_len = rx_len;
+      cli->trace_start = trace_start();
+      break;
+    }
+    if (rx_len < 0 && errno != EINTR) {
+      DEBUG("%s(%s) failed to recv (%s)", __func__, cli->endpoint, strerror(errno));
+      break;
+    }
+    usleep(20 * 1000);
+  }
+  return ret;
+}
+
+static void mux_conn_put(mux_conn_t *conn)
+{
+  int refs;
+
+  pthread_mutex_lock(&conn->lock);
+  refs = --conn->refs;
+  pthread_mutex_unlock(&conn->lock);
+  if (refs == 0) {
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->lock);
+    free(conn);
+  }
+}
+
+static int mux_respond(struct mux_req_s *req, uint8_t *resp, size_t resp_len)
+{
+  mux_conn_t *conn = req->conn;
+  int ret;
+
+  req->responded = true;
+  pthread_mutex_lock(&conn->lock);
+  ret = mux_send(conn->fd, req->id, resp, resp_len);
+  if (ret) {
+    /* The stream is out of sync, end the connection */
+    SAVE_ERRNO_RUN(shutdown(conn->fd, SHUT_RDWR));
+  }
+  pthread_mutex_unlock(&conn->lock);
+  return ret;
+}
+
+static void cli_done(client_t *cli)
+{
+  service_t *svc = cli->svc;
+  struct mux_req_s *mux = cli->mux;
+  cli->svc = NULL;
+  if (svc) {
+    /* Handled without a response */
+    trace_add(cli->endpoint, IPC_TRACE_HANDLE, cli->trace_start, false);
+    if (mux) {
+      /* An empty response, as the close of a one-shot connection */
+      if (!mux->responded) {
+        mux_respond(mux, NULL, 0);
+      }
+      mux_conn_put(mux->conn);
+      free(mux);
+    } else {
+      close(cli->fd);
+    }
+    free(cli);
+    pthread_mutex_lock(&svc->mutex);
+    if (mux) {
+      svc->num_mux_active--;
+    } else {
+      svc->num_active--;
+    }
+    pthread_cond_broadcast(&svc->cond);
+    pthread_mutex_unlock(&svc->mutex);
+  }
+}
+
+int ipc_send_resp(client_t *cli, uint8_t *resp, size_t resp_len)
+{
+  int ret = 0;
+  if (!cli || !resp || !resp_len) {
+    return -1;
+  }
+  trace_add(cli->endpoint, IPC_TRACE_HANDLE, cli->trace_start, true);
+  cli->trace_start = 0;
+  if (cli->mux) {
+    if (mux_respond(cli->mux, resp, resp_len)) {
+      DEBUG("%s(%s) failed to send (%s)", __func__, cli->endpoint, strerror(errno));
+      ret = -1;
+    } else {
+      cli_done(cli);
+    }
+  } else if (send(cli->fd, resp, resp_len, MSG_NOSIGNAL) < 0) {
+    DEBUG("%s(%s) failed to recv (%s)", __func__, cli->endpoint, strerror(errno));
+    ret = -1;
+  } else {
+    cli_done(cli);
+  }
+  return ret;
+}
+
+static void *conn_handler(void *param)
+{
+  client_t *cli = (client_t *)param;
+  ipc_handle_req_t handle_req = cli->svc->handle_req;
+  if(handle_req(cli)) {
+    cli_done(cli);
+  }
+  pthread_exit(NULL);
+  return NULL;
+}
+
+static client_t *get_client(service_t *svc, int *num_active)
+{
+  client_t *cli = NULL;
+  struct timespec ts;
+  struct timeval tp;
+  int rc = 0;
+
+  gettimeofday(&tp, NULL);
+  ts.tv_sec = tp.tv_sec + CLIENT_TIMEOUT + 1;
+  ts.tv_nsec = 0;
+
+  pthread_mutex_lock(&svc->mutex);
+  while (*num_active >= svc->active_limit) {
+    rc = pthread_cond_timedwait(&svc->cond, &svc->mutex, &ts);
+    if (rc == ETIMEDOUT) {
+      break;
+    }
+  }
+  if (rc != ETIMEDOUT) {
+    cli = calloc(1, sizeof(*cli));
+    if (cli) {
+      (*num_active)++;
+      memcpy(cli, &svc->base_cli, sizeof(*cli));
+    }
+  }
+  pthread_mutex_unlock(&svc->mutex);
+  return cli;
+}
+
+static int svc_listen(service_t *svc, const char *fmt)
+{
+  client_t *base_cli = &svc->base_cli;
+  struct sockaddr_un local;
+  int sock, len;
+
+  if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    DEBUG("%s(%s) failed to create socket (%s)", __func__, base_cli->endpoint, strerror(errno));
+    return -1;
+  }
+
+  local.sun_family = AF_UNIX;
+  sprintf(local.sun_path, fmt, base_cli->endpoint);
+  unlink(local.sun_path);
+  len = strlen(local.sun_path) + sizeof(local.sun_family);
+  if (bind(sock, (struct sockaddr *)&local, len) == -1) {
+    DEBUG("%s(%s) failed to bind (%s)", __func__, base_cli->endpoint, strerror(errno));
+    goto close_bail;
+  }
+
+  if (listen(sock, 5) == -1) {
+    DEBUG("%s(%s) failed to listen (%s)", __func__, base_cli->endpoint, strerror(errno));
+    goto close_bail;
+  }
+  return sock;
+
+close_bail:
+  SAVE_ERRNO_RUN(close(sock));
+  return -1;
+}
+
+static void *svc_thread(void *param)
+{
+  service_t *svc = (service_t *)param;
+  client_t *base_cli = &svc->base_cli;
+  struct sockaddr_un remote;
+  int sock, conn;
+  pthread_attr_t attr;
+  int cli_retries = WAIT_CLIENT_RETRIES;
+  int acc_retries = ACCEPT_RECOVER_RETRIES;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&attr, STACK_SIZE);
+
+  if ((sock = svc_listen(svc, "/tmp/%s")) < 0) {
+    goto bail;
+  }
+
+  while (1) {
+    socklen_t t = sizeof(remote);
+    pthread_t tid;
+    client_t *cli = get_client(svc, &svc->num_active);
+    if (!cli) {
+      if (--cli_retries <= 0) {
+        CRITICAL("%s(%s) outstanding clients %d exceeded limit %d",
+          __func__, base_cli->endpoint, svc->num_active, svc->active_limit);
+        break;
+      }
+      ERROR("%s(%s) outstanding clients %d exceeded limit %d retrying in 5 seconds",
+        __func__, base_cli->endpoint, svc->num_active, svc->active_limit);
+      sleep(5);
+      continue;
+    }
+    cli_retries = WAIT_CLIENT_RETRIES;
+
+    while (--acc_retries > 0 && (conn = accept(sock, (struct sockaddr *)&remote, &t)) < 0) {
+      ERROR("%s(%s) failed to accept (%s) retrying in 5 seconds", __func__, base_cli->endpoint, strerror(errno));
+      sleep(5);
+      continue;
+    }
+    if (acc_retries <= 0 || conn < 0) {
+      CRITICAL("%s(%s) failed to accept (%s) retrying in 5 seconds", __func__, base_cli->endpoint, strerror(errno));
+      cli_done(cli);
+      break;
+    }
+    acc_retries = ACCEPT_RECOVER_RETRIES;
+    cli->fd = conn;
+    if (pthread_create(&tid, &attr, conn_handler, (void *)cli)) {
+      CRITICAL("%s(%s) failed to create thread (%s)", __func__, base_cli->endpoint, strerror(errno));
+      cli_done(cli);
+    }
+  }
+  close(sock);
+bail:
+  pthread_exit(NULL);
+  return NULL;
+}
+
+/* Dispatch the requests of a persistent connection as they come, each
+ * to a handler thread as for a one-shot connection */
+static void *mux_conn_thread(void *param)
+{
+  mux_conn_t *conn = (mux_conn_t *)param;
+  service_t *svc = conn->svc;
+  struct mux_req_s *req;
+  pthread_attr_t attr;
+  pthread_t tid;
+  client_t *cli;
+  mux_hdr_t hdr;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&attr, STACK_SIZE);
+
+  while (sock_xfer(conn->fd, &hdr, sizeof(hdr), false) == 0) {
+    if (hdr.len > MUX_MAX_MSG_LEN) {
+      ERROR("%s(%s) request too long (%u)", __func__, svc->base_cli.endpoint, hdr.len);
+      break;
+    }
+    req = calloc(1, sizeof(*req) + hdr.len);
+    if (!req) {
+      break;
+    }
+    req->conn = conn;
+    req->id = hdr.id;
+    req->len = hdr.len;
+    if (sock_xfer(conn->fd, req->data, req->len, false)) {
+      free(req);
+      break;
+    }
+    pthread_mutex_lock(&conn->lock);
+    conn->refs++;
+    pthread_mutex_unlock(&conn->lock);
+
+    cli = get_client(svc, &svc->num_mux_active);
+    if (!cli) {
+      ERROR("%s(%s) outstanding clients %d exceeded limit %d",
+        __func__, svc->base_cli.endpoint, svc->num_mux_active, svc->active_limit);
+      mux_respond(req, NULL, 0);
+      mux_conn_put(conn);
+      free(req);
+      continue;
+    }
+    cli->fd = conn->fd;
+    cli->mux = req;
+    if (pthread_create(&tid, &attr, conn_handler, (void *)cli)) {
+      CRITICAL("%s(%s) failed to create thread (%s)", __func__, svc->base_cli.endpoint, strerror(errno));
+      cli_done(cli);
+    }
+  }
+  pthread_attr_destroy(&attr);
+  mux_conn_put(conn);
+  pthread_exit(NULL);
+  return NULL;
+}
+
+static void *mux_svc_thread(void *param)
+{
+  service_t *svc = (service_t *)param;
+  client_t *base_cli = &svc->base_cli;
+  int acc_retries = ACCEPT_RECOVER_RETRIES;
+  pthread_attr_t attr;
+  mux_conn_t *conn;
+  pthread_t tid;
+  int sock, fd;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&attr, STACK_SIZE);
+
+  if ((sock = svc_listen(svc, MUX_SOCK_FMT)) < 0) {
+    goto bail;
+  }
+
+  while (1) {
+    while (--acc_retries > 0 && (fd = accept(sock, NULL, NULL)) < 0) {
+      ERROR("%s(%s) failed to accept (%s) retrying in 5 seconds", __func__, base_cli->endpoint, strerror(errno));
+      sleep(5);
+    }
+    if (acc_retries <= 0 || fd < 0) {
+      CRITICAL("%s(%s) failed to accept (%s)", __func__, base_cli->endpoint, strerror(errno));
+      break;
+    }
+    acc_retries = ACCEPT_RECOVER_RETRIES;
+
+    conn = calloc(1, sizeof(*conn));
+    if (!conn) {
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->refs = 1;
+    conn->svc = svc;
+    pthread_mutex_init(&conn->lock, NULL);
+    if (pthread_create(&tid, &attr, mux_conn_thread, (void *)conn)) {
+      CRITICAL("%s(%s) failed to create thread (%s)", __func__, base_cli->endpoint, strerror(errno));
+      mux_conn_put(conn);
+    }
+  }
+  close(sock);
+bail:
+  pthread_attr_destroy(&attr);
+  pthread_exit(NULL);
+  return NULL;
+}
+
+static service_t *svc_alloc(const char *endpoint, ipc_handle_req_t handle_req, int max_active, void *svc_cookie)
+{
+  service_t *svc;
+
+  if (strlen(endpoint) >= MAX_ENDPOINT_LEN - 1) {
+    return NULL;
+  }
+
+  svc = calloc(1, sizeof(*svc));
+  if (!svc) {
+    return NULL;
+  }
+
+  strcpy(svc->base_cli.endpoint, endpoint);
+  svc->base_cli.svc_cookie = svc_cookie;
+  svc->base_cli.fd = -1;
+  svc->handle_req = handle_req;
+  pthread_mutex_init(&svc->mutex, NULL);
+  pthread_cond_init(&svc->cond, NULL);
+  svc->base_cli.svc = svc;
+  svc->num_active = 0;
+  svc->active_limit = max_active;
+  return svc;
+}
+
+int ipc_start_svc(const char *endpoint, ipc_handle_req_t handle_req, int max_active, void *svc_cookie, pthread_t *waiter)
+{
+  pthread_t tid;
+  pthread_attr_t attr;
+  int ret = 0;
+  service_t *svc;
+
+  svc = svc_alloc(endpoint, handle_req, max_active, svc_cookie);
+  if (!svc) {
+    return -1;
+  }
+
+  pthread_attr_init(&attr);
+  if (!waiter)
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  if (pthread_create(&tid, &attr, svc_thread, svc)) {
+      DEBUG("%s(%s) failed to start thread (%s)", __func__, endpoint, strerror(errno));
+      free(svc);
+      ret = -1;
   }
   pthread_attr_destroy(&attr);
 
+  /* Clients fall back to one-shot connections without it */
+  if (ret == 0) {
+    pthread_t mux_tid;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&mux_tid, &attr, mux_svc_thread, svc)) {
+      DEBUG("%s(%s) failed to start thread (%s)", __func__, endpoint, strerror(errno));
+    }
+    pthread_attr_destroy(&attr);
+  }
+
   if (waiter)
     *waiter = tid;
 
   return ret;
 }
+
+/* ipc_start_svc_pool(): the sockets are watched by svc_pool_thread(),
+ * which queues every complete request for the workers */
+enum {
+  POOL_LISTEN,
+  POOL_MUX_LISTEN,
+  POOL_ONESHOT,
+  POOL_MUX,
+};
+
+typedef struct pool_conn_s {
+  int type;
+  int fd;
+  /* POOL_ONESHOT: dropped if the request does not come in time */
+  time_t deadline;
+  struct pool_conn_s *prev, *next;
+  /* POOL_MUX: the frame being read */
+  mux_conn_t *mux;
+  mux_hdr_t hdr;
+  size_t got;
+  struct mux_req_s *req;
+} pool_conn_t;
+
+typedef struct {
+  client_t *cli;
+  uint64_t time_us;
+} pool_item_t;
+
+struct svc_pool_s {
+  struct svc_pool_s *next;
+  char endpoint[MAX_ENDPOINT_LEN];
+  int epfd;
+  pool_conn_t *oneshot;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pool_item_t *queue;
+  uint32_t head;
+  uint32_t max_queue;
+  time_t reject_log;
+  ipc_svc_stats_t stats;
+};
+
+static struct svc_pool_s *g_pools = NULL;
+static pthread_mutex_t g_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static client_t *pool_client(service_t *svc, int *num_active)
+{
+  client_t *cli = calloc(1, sizeof(*cli));
+
+  if (cli) {
+    memcpy(cli, &svc->base_cli, sizeof(*cli));
+    pthread_mutex_lock(&svc->mutex);
+    (*num_active)++;
+    pthread_mutex_unlock(&svc->mutex);
+  }
+  return cli;
+}
+
+/* Queue a request, or reject it as a failed handler would */
+static void pool_enqueue(service_t *svc, client_t *cli)
+{
+  struct svc_pool_s *pool = svc->pool;
+  ipc_svc_stats_t *st = &pool->stats;
+
+  pthread_mutex_lock(&pool->lock);
+  if (st->queue_depth >= pool->max_queue) {
+    st->rejected++;
+    pthread_mutex_unlock(&pool->lock);
+    /* At most once in POOL_REJECT_LOG_TIME */
+    if (mono_time() >= pool->reject_log) {
+      pool->reject_log = mono_time() + POOL_REJECT_LOG_TIME;
+      ERROR("%s(%s) queue of %u full, %llu requests rejected so far",
+        __func__, cli->endpoint, pool->max_queue, (unsigned long long)st->rejected);
+    }
+    cli_done(cli);
+    return;
+  }
+  pool->queue[(pool->head + st->queue_depth) % pool->max_queue] =
+    (pool_item_t){cli, mono_time_us()};
+  st->queue_depth++;
+  st->queued++;
+  if (st->queue_depth > st->max_queue_depth) {
+    st->max_queue_depth = st->queue_depth;
+  }
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_worker(void *param)
+{
+  service_t *svc = (service_t *)param;
+  struct svc_pool_s *pool = svc->pool;
+  ipc_svc_stats_t *st = &pool->stats;
+  pool_item_t item;
+  uint64_t wait_us;
+
+  while (1) {
+    pthread_mutex_lock(&pool->lock);
+    while (st->queue_depth == 0) {
+      pthread_cond_wait(&pool->cond, &pool->lock);
+    }
+    item = pool->queue[pool->head];
+    pool->head = (pool->head + 1) % pool->max_queue;
+    st->queue_depth--;
+    wait_us = mono_time_us() - item.time_us;
+    st->wait_us_total += wait_us;
+    if (wait_us > st->wait_us_max) {
+      st->wait_us_max = wait_us > UINT32_MAX ? UINT32_MAX : (uint32_t)wait_us;
+    }
+    st->busy++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (svc->handle_req(item.cli)) {
+      cli_done(item.cli);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    st->busy--;
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return NULL;
+}
+
+static pool_conn_t *pool_watch(struct svc_pool_s *pool, int type, int fd)
+{
+  struct epoll_event ev = {0};
+  pool_conn_t *pc = calloc(1, sizeof(*pc));
+
+  if (!pc) {
+    return NULL;
+  }
+  pc->type = type;
+  pc->fd = fd;
+  ev.events = EPOLLIN;
+  ev.data.ptr = pc;
+  if (epoll_ctl(pool->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+    free(pc);
+    return NULL;
+  }
+  if (type == POOL_ONESHOT) {
+    pc->deadline = mono_time() + CLIENT_TIMEOUT;
+    pc->next = pool->oneshot;
+    if (pool->oneshot) {
+      pool->oneshot->prev = pc;
+    }
+    pool->oneshot = pc;
+  }
+  return pc;
+}
+
+/* Stop watching the connection, keeping its socket open */
+static void pool_unwatch(struct svc_pool_s *pool, pool_conn_t *pc)
+{
+  epoll_ctl(pool->epfd, EPOLL_CTL_DEL, pc->fd, NULL);
+  if (pc->type == POOL_ONESHOT) {
+    if (pc->prev) {
+      pc->prev->next = pc->next;
+    } else {
+      pool->oneshot = pc->next;
+    }
+    if (pc->next) {
+      pc->next->prev = pc->prev;
+    }
+  }
+  if (pc->type == POOL_MUX) {
+    free(pc->req);
+    mux_conn_put(pc->mux);
+  }
+  free(pc);
+}
+
+static void pool_accept(service_t *svc, pool_conn_t *listener)
+{
+  struct svc_pool_s *pool = svc->pool;
+  mux_conn_t *conn;
+  pool_conn_t *pc;
+  int fd;
+
+  while ((fd = accept(listener->fd, NULL, NULL)) >= 0) {
+    if (listener->type == POOL_LISTEN) {
+      if (!pool_watch(pool, POOL_ONESHOT, fd)) {
+        close(fd);
+      }
+      continue;
+    }
+    conn = calloc(1, sizeof(*conn));
+    if (!conn) {
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->refs = 1;
+    conn->svc = svc;
+    pthread_mutex_init(&conn->lock, NULL);
+    pc = pool_watch(pool, POOL_MUX, fd);
+    if (!pc) {
+      mux_conn_put(conn);
+      continue;
+    }
+    pc->mux = conn;
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    ERROR("%s(%s) failed to accept (%s)", __func__, svc->base_cli.endpoint, strerror(errno));
+  }
+}
+
+/* Read what has come of the requests of a persistent connection,
+ * 0 while it stays open */
+static int pool_read_mux(service_t *svc, pool_conn_t *pc)
+{
+  client_t *cli;
+  uint8_t *dst;
+  size_t want;
+  ssize_t n;
+
+  while (1) {
+    if (pc->got < sizeof(pc->hdr)) {
+      dst = (uint8_t *)&pc->hdr + pc->got;
+      want = sizeof(pc->hdr) - pc->got;
+    } else {
+      dst = pc->req->data + (pc->got - sizeof(pc->hdr));
+      want = sizeof(pc->hdr) + pc->req->len - pc->got;
+    }
+    if (want > 0) {
+      n = recv(pc->fd, dst, want, MSG_DONTWAIT);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+      }
+      if (n <= 0) {
+        return -1;
+      }
+      pc->got += n;
+      if ((size_t)n < want) {
+        continue;
+      }
+    }
+    if (pc->got == sizeof(pc->hdr) && !pc->req) {
+      if (pc->hdr.len > MUX_MAX_MSG_LEN) {
+        ERROR("%s(%s) request too long (%u)", __func__, svc->base_cli.endpoint, pc->hdr.len);
+        return -1;
+      }
+      pc->req = calloc(1, sizeof(*pc->req) + pc->hdr.len);
+      if (!pc->req) {
+        return -1;
+      }
+      pc->req->conn = pc->mux;
+      pc->req->id = pc->hdr.id;
+      pc->req->len = pc->hdr.len;
+      if (pc->req->len > 0) {
+        continue;
+      }
+    }
+
+    /* A complete request */
+    cli = pool_client(svc, &svc->num_mux_active);
+    if (!cli) {
+      return -1;
+    }
+    pthread_mutex_lock(&pc->mux->lock);
+    pc->mux->refs++;
+    pthread_mutex_unlock(&pc->mux->lock);
+    cli->fd = pc->fd;
+    cli->mux = pc->req;
+    pc->req = NULL;
+    pc->got = 0;
+    pool_enqueue(svc, cli);
+  }
+}
+
+static void *svc_pool_thread(void *param)
+{
+  service_t *svc = (service_t *)param;
+  struct svc_pool_s *pool = svc->pool;
+  struct epoll_event events[POOL_MAX_EVENTS];
+  pool_conn_t *pc, *next;
+  client_t *cli;
+  time_t now;
+  int i, n;
+
+  while (1) {
+    n = epoll_wait(pool->epfd, events, POOL_MAX_EVENTS, 1000);
+    if (n < 0 && errno != EINTR) {
+      CRITICAL("%s(%s) failed to wait (%s)", __func__, svc->base_cli.endpoint, strerror(errno));
+      break;
+    }
+    for (i = 0; i < n; i++) {
+      pc = events[i].data.ptr;
+      switch (pc->type) {
+        case POOL_LISTEN:
+        case POOL_MUX_LISTEN:
+          pool_accept(svc, pc);
+          break;
+        case POOL_ONESHOT:
+          /* Its request has come, handled as by conn_handler() */
+          cli = pool_client(svc, &svc->num_active);
+          if (!cli) {
+            close(pc->fd);
+          } else {
+            cli->fd = pc->fd;
+            pool_enqueue(svc, cli);
+          }
+          pool_unwatch(pool, pc);
+          break;
+        case POOL_MUX:
+          if (pool_read_mux(svc, pc)) {
+            pool_unwatch(pool, pc);
+          }
+          break;
+      }
+    }
+
+    now = mono_time();
+    for (pc = pool->oneshot; pc != NULL; pc = next) {
+      next = pc->next;
+      if (now >= pc->deadline) {
+        close(pc->fd);
+        pool_unwatch(pool, pc);
+      }
+    }
+  }
+  pthread_exit(NULL);
+  return NULL;
+}
+
+int ipc_start_svc_pool(const char *endpoint, ipc_handle_req_t handle_req,
+                       int num_workers, int max_queue, void *svc_cookie,
+                       pthread_t *waiter)
+{
+  const char *fmts[] = {"/tmp/%s", MUX_SOCK_FMT};
+  const int types[] = {POOL_LISTEN, POOL_MUX_LISTEN};
+  struct svc_pool_s *pool = NULL;
+  pthread_attr_t attr;
+  pthread_t tid;
+  service_t *svc;
+  int i, sock;
+
+  if (num_workers <= 0 || max_queue <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  svc = svc_alloc(endpoint, handle_req, num_workers, svc_cookie);
+  if (!svc) {
+    return -1;
+  }
+  pool = calloc(1, sizeof(*pool));
+  if (!pool) {
+    goto bail;
+  }
+  pool->queue = calloc(max_queue, sizeof(pool_item_t));
+  pool->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (!pool->queue || pool->epfd < 0) {
+    goto bail;
+  }
+  pool->max_queue = max_queue;
+  pool->stats.workers = num_workers;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+  svc->pool = pool;
+
+  for (i = 0; i < 2; i++) {
+    sock = svc_listen(svc, fmts[i]);
+    if (sock < 0) {
+      goto bail;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+    if (!pool_watch(pool, types[i], sock)) {
+      close(sock);
+      goto bail;
+    }
+  }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&attr, STACK_SIZE);
+  for (i = 0; i < num_workers; i++) {
+    if (pthread_create(&tid, &attr, pool_worker, svc)) {
+      DEBUG("%s(%s) failed to start worker (%s)", __func__, endpoint, strerror(errno));
+      pthread_attr_destroy(&attr);
+      /* The workers started wait on the queue for good */
+      return -1;
+    }
+  }
+  pthread_attr_destroy(&attr);
+
+  pthread_attr_init(&attr);
+  if (!waiter)
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&tid, &attr, svc_pool_thread, svc)) {
+    DEBUG("%s(%s) failed to start thread (%s)", __func__, endpoint, strerror(errno));
+    pthread_attr_destroy(&attr);
+    return -1;
+  }
+  pthread_attr_destroy(&attr);
+  if (waiter)
+    *waiter = tid;
+
+  pthread_mutex_lock(&g_pools_lock);
+  strcpy(pool->endpoint, endpoint);
+  pool->next = g_pools;
+  g_pools = pool;
+  pthread_mutex_unlock(&g_pools_lock);
+  return 0;
+
+bail:
+  if (pool) {
+    if (pool->epfd >= 0) {
+      close(pool->epfd);
+    }
+    free(pool->queue);
+    free(pool);
+  }
+  free(svc);
+  return -1;
+}
+
+int ipc_svc_stats(const char *endpoint, ipc_svc_stats_t *stats)
+{
+  struct svc_pool_s *pool;
+
+  if (!endpoint || !stats) {
+    errno = EINVAL;
+    return -1;
+  }
+  pthread_mutex_lock(&g_pools_lock);
+  for (pool = g_pools; pool != NULL; pool = pool->next) {
+    if (!strcmp(pool->endpoint, endpoint)) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_pools_lock);
+  if (!pool) {
+    errno = ENOENT;
+    return -1;
+  }
+  pthread_mutex_lock(&pool->lock);
+  *stats = pool->stats;
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
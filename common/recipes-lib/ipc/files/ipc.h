@@ -14,11 +14,17 @@ typedef int (*ipc_handle_req_t)(client_t *cli);
 struct service_s;
 typedef struct service_s service_t;
 
+struct mux_req_s;
+
 struct client_s {
   char endpoint[MAX_ENDPOINT_LEN];
   void *svc_cookie;
   int fd;
   service_t *svc;
+  /* Request read from a persistent connection, NULL otherwise */
+  struct mux_req_s *mux;
+  /* Request received, when tracing */
+  uint64_t trace_start;
 };
 
 int ipc_send_req(const char *endpoint, uint8_t *req, size_t req_len, uint8_t *resp, size_t *resp_len, int timeout);
@@ -26,4 +32,80 @@ int ipc_recv_req(client_t *cli, uint8_t *req, size_t *req_len, int timeout);
 int ipc_send_resp(client_t *cli, uint8_t *resp, size_t resp_len);
 int ipc_start_svc(const char *endpoint, ipc_handle_req_t handle_req, int max_active, void *cookie, pthread_t *waiter);
 
+/* As ipc_send_req(), over a connection to the endpoint which the calling
+ * thread keeps open for its next requests. Falls back to ipc_send_req()
+ * when the service does not take persistent connections. */
+int ipc_send_req_cached(const char *endpoint, uint8_t *req, size_t req_len, uint8_t *resp, size_t *resp_len, int timeout);
+/* Send a request over the cached connection without waiting for its
+ * response. Several can be in flight, their responses are collected by
+ * id with ipc_wait_resp() in any order. A failure or timeout of the wait
+ * drops the connection, and with it the other requests in flight. */
+int ipc_submit_req(const char *endpoint, uint8_t *req, size_t req_len, uint32_t *id);
+int ipc_wait_resp(const char *endpoint, uint32_t id, uint8_t *resp, size_t *resp_len, int timeout);
+/* As ipc_wait_resp(), for whichever request in flight completes first,
+ * with its id returned in *id. */
+int ipc_wait_any(const char *endpoint, uint32_t *id, uint8_t *resp, size_t *resp_len, int timeout);
+/* 1 if ipc_wait_any() would not block, 0 if it would, -1 with nothing
+ * in flight. */
+int ipc_resp_ready(const char *endpoint);
+/* Cached connection of the calling thread to poll for responses, or -1.
+ * A response may also be ready without the fd being readable, see
+ * ipc_resp_ready(). */
+int ipc_cached_fd(const char *endpoint);
+/* Close the connections cached by the calling thread */
+void ipc_close_cached(void);
+
+/* Backpressure of a service of ipc_start_svc_pool() */
+typedef struct {
+  uint32_t workers;
+  /* Workers running a handler */
+  uint32_t busy;
+  /* Requests queued now, and at most so far */
+  uint32_t queue_depth;
+  uint32_t max_queue_depth;
+  /* Requests queued, and rejected with a full queue */
+  uint64_t queued;
+  uint64_t rejected;
+  /* Time the requests waited for a worker */
+  uint64_t wait_us_total;
+  uint32_t wait_us_max;
+} ipc_svc_stats_t;
+
+/* As ipc_start_svc(), with one thread watching the connections by epoll
+ * and queueing their requests for a fixed pool of num_workers handler
+ * threads. A request coming with max_queue queued is rejected, as if its
+ * handler failed. */
+int ipc_start_svc_pool(const char *endpoint, ipc_handle_req_t handle_req, int num_workers, int max_queue, void *cookie, pthread_t *waiter);
+int ipc_svc_stats(const char *endpoint, ipc_svc_stats_t *stats);
+
+/* Steps of a request, for ipc_trace_get() */
+enum {
+  IPC_TRACE_CONNECT = 0,
+  IPC_TRACE_SEND,
+  /* Waiting for the service to respond */
+  IPC_TRACE_REMOTE,
+  IPC_TRACE_RECV,
+  /* At the service, from ipc_recv_req() to the response */
+  IPC_TRACE_HANDLE,
+  IPC_TRACE_NUM,
+};
+
+typedef struct {
+  uint64_t count;
+  uint64_t errors;
+  uint64_t total_us;
+  uint32_t max_us;
+} ipc_trace_stat_t;
+
+typedef struct {
+  ipc_trace_stat_t stat[IPC_TRACE_NUM];
+} ipc_trace_t;
+
+/* Time the steps of the requests of every endpoint used by the process.
+ * Also enabled by a non-zero IPC_TRACE in the environment, which reports
+ * them on stderr at exit. */
+void ipc_trace_enable(int enable);
+int ipc_trace_get(const char *endpoint, ipc_trace_t *trace);
+void ipc_trace_reset(void);
+
 #endif
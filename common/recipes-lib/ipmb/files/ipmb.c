@@ -29,6 +29,8 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <unistd.h>
@@ -101,8 +103,8 @@ lib_ipmb_handle(unsigned char bus_id,
 
   sprintf(sock_path, "%s_%d", SOCK_PATH_IPMB, bus_id);
 
-  if (ipc_send_req(sock_path, request, (size_t)req_len, response,
-                   &resp_len, TIMEOUT_IPMB) != 0) {
+  if (ipc_send_req_cached(sock_path, request, (size_t)req_len, response,
+                          &resp_len, TIMEOUT_IPMB) != 0) {
     return -1;
   }
 
@@ -114,6 +116,119 @@ lib_ipmb_handle(unsigned char bus_id,
   return 0;
 }
 
+int
+lib_ipmb_handle_batch(unsigned char bus_id, ipmb_batch_req_t *reqs,
+                      int count) {
+  unsigned char *req, *res, *p, *end;
+  size_t req_len = sizeof(ipmb_batch_hdr_t), res_len;
+  ipmb_batch_hdr_t hdr = {IPMB_BATCH_MAGIC, (uint8_t)count};
+  ipmb_batch_res_t r;
+  char sock_path[64];
+  uint16_t len;
+  int i, ret = -1;
+
+  if (!reqs || count <= 0 || count > IPMB_BATCH_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (i = 0; i < count; i++) {
+    reqs[i].res_len = 0;
+    reqs[i].latency_us = 0;
+    req_len += sizeof(len) + reqs[i].req_len;
+  }
+  if (req_len > MAX_IPMB_REQ_LEN) {
+    errno = E2BIG;
+    return -1;
+  }
+  res_len = sizeof(hdr) + count * (sizeof(r) + UCHAR_MAX);
+  req = malloc(req_len);
+  res = malloc(res_len);
+  if (!req || !res) {
+    goto out;
+  }
+
+  memcpy(req, &hdr, sizeof(hdr));
+  p = req + sizeof(hdr);
+  for (i = 0; i < count; i++) {
+    len = (uint16_t)reqs[i].req_len;
+    memcpy(p, &len, sizeof(len));
+    memcpy(p + sizeof(len), reqs[i].request, len);
+    p += sizeof(len) + len;
+  }
+
+  sprintf(sock_path, "%s_%d", SOCK_PATH_IPMB, bus_id);
+  if (ipc_send_req_cached(sock_path, req, req_len, res, &res_len,
+                          TIMEOUT_IPMB) != 0) {
+    goto out;
+  }
+  if (res_len < sizeof(hdr) || memcmp(res, &hdr, sizeof(hdr))) {
+    errno = EBADMSG;
+    goto out;
+  }
+
+  p = res + sizeof(hdr);
+  end = res + res_len;
+  for (i = 0; i < count; i++) {
+    if (p + sizeof(r) > end) {
+      break;
+    }
+    memcpy(&r, p, sizeof(r));
+    p += sizeof(r);
+    if (p + r.len > end) {
+      break;
+    }
+    memcpy(reqs[i].response, p, r.len);
+    reqs[i].res_len = r.len;
+    reqs[i].latency_us = r.latency_us;
+    p += r.len;
+  }
+  if (i < count) {
+    syslog(LOG_ERR, "%s: truncated batch response from bus %u\n",
+           __func__, bus_id);
+    errno = EBADMSG;
+    goto out;
+  }
+  ret = 0;
+
+out:
+  free(req);
+  free(res);
+  return ret;
+}
+
+int
+lib_ipmb_get_stats(uint8_t bus_id, ipmb_stats_t *stats)
+{
+  char shm_name[64];
+  ipmb_stats_t *shm;
+  uint32_t *dst, *src;
+  size_t i;
+  int fd;
+
+  if (!stats) {
+    errno = EINVAL;
+    return -1;
+  }
+  snprintf(shm_name, sizeof(shm_name), "%s_%d", IPMB_STATS_SHM, bus_id);
+  fd = shm_open(shm_name, O_RDONLY, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shm == MAP_FAILED) {
+    return -1;
+  }
+  /* Updated one by one while ipmbd runs */
+  dst = (uint32_t *)stats;
+  src = (uint32_t *)shm;
+  for (i = 0; i < sizeof(*stats) / sizeof(uint32_t); i++) {
+    dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+  }
+  munmap(shm, sizeof(*shm));
+  return 0;
+}
+
 int
 ipmb_send_buf (unsigned char bus_id, unsigned char tlen)
 {
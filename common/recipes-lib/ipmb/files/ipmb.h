@@ -76,6 +76,75 @@ typedef struct _ipmb_res_t {
 int lib_ipmb_handle(unsigned char bus_id,
                     unsigned char *request, unsigned int req_len,
                     unsigned char *response, unsigned char *res_len);
+
+/*
+ * Batch of requests to the ipmbd of a bus in one exchange. The message
+ * is an ipmb_batch_hdr_t, then each request as a 16-bit length and its
+ * bytes. The response is the same header, then each response as an
+ * ipmb_batch_res_t and its bytes, in the order of the requests. The
+ * magic is no valid slave address, so a batch is told apart from a
+ * plain request.
+ */
+#define IPMB_BATCH_MAGIC 0xFF
+#define IPMB_BATCH_MAX 16
+
+#pragma pack(push, 1)
+typedef struct {
+  uint8_t magic;
+  uint8_t count;
+} ipmb_batch_hdr_t;
+
+typedef struct {
+  /* From the request going out on the bus to its response, 0 for none */
+  uint32_t latency_us;
+  uint8_t len;
+} ipmb_batch_res_t;
+#pragma pack(pop)
+
+typedef struct {
+  unsigned char *request;
+  unsigned int req_len;
+  /* Holds MAX_IPMB_RES_LEN as for lib_ipmb_handle() */
+  unsigned char *response;
+  /* Set by lib_ipmb_handle_batch(), res_len 0 for a failed request */
+  unsigned char res_len;
+  uint32_t latency_us;
+} ipmb_batch_req_t;
+
+/* Send up to IPMB_BATCH_MAX requests to the bus together. ipmbd sends
+ * them all before waiting for the first response. Returns 0 when the
+ * exchange with ipmbd went through, the requests failing on their own,
+ * -1 otherwise. */
+int lib_ipmb_handle_batch(unsigned char bus_id, ipmb_batch_req_t *reqs,
+                          int count);
+
+/* Counters of the requests through the ipmbd of a bus, kept in shm by
+ * the daemon. 32 bits wide and wrapping, except the gauges. */
+#define IPMB_STATS_SHM "/ipmbd_stats"
+#define IPMB_LATENCY_BUCKETS 12
+typedef struct {
+  /* Requests waiting for a response now, and at most so far */
+  uint32_t inflight;
+  uint32_t max_inflight;
+  uint32_t requests;
+  uint32_t responses;
+  /* No response in TIMEOUT_IPMB */
+  uint32_t timeouts;
+  /* Responses no request was waiting for */
+  uint32_t late;
+  /* Retried and failed i2c writes */
+  uint32_t retries;
+  uint32_t write_errors;
+  /* Requests rejected for the lack of a free seq# */
+  uint32_t no_seq;
+  uint32_t latency_ms_total;
+  uint32_t latency_us_max;
+  /* Responses in under 1ms << b, the last bucket the slower ones too */
+  uint32_t latency_hist[IPMB_LATENCY_BUCKETS];
+} ipmb_stats_t;
+
+/* Read the counters of the ipmbd of the bus */
+int lib_ipmb_get_stats(uint8_t bus_id, ipmb_stats_t *stats);
 int
 lib_ipmb_send_request(uint8_t ipmi_cmd, uint8_t netfn,
               uint8_t *txbuf, uint8_t txlen, 
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <stdbool.h>
 #include <syslog.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -44,7 +45,175 @@ lib_ipmi_handle(unsigned char *request, unsigned char req_len,
   size_t resp_len = MAX_IPMI_RES_LEN;
 
   *res_len = 0;
-  if (ipc_send_req(SOCK_PATH_IPMI, request, (size_t)req_len, response, &resp_len, TIMEOUT_IPMI + 1) == 0) {
+  if (ipc_send_req_cached(SOCK_PATH_IPMI, request, (size_t)req_len, response, &resp_len, TIMEOUT_IPMI + 1) == 0) {
     *res_len = (unsigned short)resp_len;
   }
 }
+
+typedef struct {
+  uint32_t id;
+  lib_ipmi_cb_t cb;
+  void *arg;
+} lib_ipmi_async_t;
+
+struct lib_ipmi_queue_s {
+  char endpoint[MAX_ENDPOINT_LEN];
+  lib_ipmi_async_t *reqs;
+  int count;
+  int size;
+};
+
+lib_ipmi_queue_t *
+lib_ipmi_queue_create(const char *endpoint) {
+  lib_ipmi_queue_t *q;
+
+  if (endpoint == NULL) {
+    endpoint = SOCK_PATH_IPMI;
+  }
+  if (strlen(endpoint) >= MAX_ENDPOINT_LEN) {
+    errno = EINVAL;
+    return NULL;
+  }
+  q = calloc(1, sizeof(*q));
+  if (q != NULL) {
+    strcpy(q->endpoint, endpoint);
+  }
+  return q;
+}
+
+void
+lib_ipmi_queue_destroy(lib_ipmi_queue_t *q) {
+  if (q == NULL) {
+    return;
+  }
+  lib_ipmi_queue_drain(q);
+  free(q->reqs);
+  free(q);
+}
+
+int
+lib_ipmi_submit(lib_ipmi_queue_t *q, unsigned char *request,
+                unsigned char req_len, lib_ipmi_cb_t cb, void *arg) {
+  uint32_t id;
+
+  if (q == NULL || request == NULL || cb == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (q->count == q->size) {
+    int size = q->size ? q->size * 2 : 16;
+    lib_ipmi_async_t *reqs = realloc(q->reqs, size * sizeof(*reqs));
+    if (reqs == NULL) {
+      return -1;
+    }
+    q->reqs = reqs;
+    q->size = size;
+  }
+  if (ipc_submit_req(q->endpoint, request, (size_t)req_len, &id)) {
+    syslog(LOG_WARNING, "%s: submit to %s failed: %s", __func__,
+           q->endpoint, strerror(errno));
+    return -1;
+  }
+  q->reqs[q->count++] = (lib_ipmi_async_t){id, cb, arg};
+  return 0;
+}
+
+int
+lib_ipmi_queue_pending(lib_ipmi_queue_t *q) {
+  return q ? q->count : 0;
+}
+
+int
+lib_ipmi_queue_fd(lib_ipmi_queue_t *q) {
+  return q ? ipc_cached_fd(q->endpoint) : -1;
+}
+
+/* Remove the request of an id from the queue, false if not queued */
+static bool
+queue_take(lib_ipmi_queue_t *q, uint32_t id, lib_ipmi_async_t *req) {
+  int i;
+
+  for (i = 0; i < q->count; i++) {
+    if (q->reqs[i].id == id) {
+      *req = q->reqs[i];
+      memmove(&q->reqs[i], &q->reqs[i + 1], (q->count - i - 1) * sizeof(*req));
+      q->count--;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Complete the requests left after the connection failed. Those sent
+ * over it are lost, and fail without waiting. */
+static int
+queue_fail(lib_ipmi_queue_t *q) {
+  unsigned char response[MAX_IPMI_RES_LEN];
+  lib_ipmi_async_t req;
+  size_t resp_len;
+  int done = 0;
+
+  while (q->count > 0) {
+    req = q->reqs[0];
+    queue_take(q, req.id, &req);
+    resp_len = sizeof(response);
+    if (ipc_wait_resp(q->endpoint, req.id, response, &resp_len, TIMEOUT_IPMI + 1)) {
+      resp_len = 0;
+    }
+    req.cb(req.arg, response, (unsigned short)resp_len);
+    done++;
+  }
+  return done;
+}
+
+int
+lib_ipmi_queue_process(lib_ipmi_queue_t *q, int timeout) {
+  unsigned char response[MAX_IPMI_RES_LEN];
+  lib_ipmi_async_t req;
+  size_t resp_len;
+  uint32_t id;
+  int done = 0, ready;
+
+  if (q == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  while (q->count > 0) {
+    ready = ipc_resp_ready(q->endpoint);
+    if (ready < 0) {
+      return done + queue_fail(q);
+    }
+    if (!ready && (done > 0 || timeout <= 0)) {
+      break;
+    }
+    resp_len = sizeof(response);
+    if (ipc_wait_any(q->endpoint, &id, response, &resp_len, timeout > 0 ? timeout : 1)) {
+      syslog(LOG_WARNING, "%s: response from %s failed: %s", __func__,
+             q->endpoint, strerror(errno));
+      return done + queue_fail(q);
+    }
+    if (!queue_take(q, id, &req)) {
+      /* Submitted by other code of the thread with ipc_submit_req() */
+      syslog(LOG_WARNING, "%s: dropped response %u from %s", __func__,
+             id, q->endpoint);
+      continue;
+    }
+    req.cb(req.arg, response, (unsigned short)resp_len);
+    done++;
+  }
+  return done;
+}
+
+int
+lib_ipmi_queue_drain(lib_ipmi_queue_t *q) {
+  int done = 0, ret;
+
+  while (lib_ipmi_queue_pending(q) > 0) {
+    ret = lib_ipmi_queue_process(q, TIMEOUT_IPMI + 1);
+    if (ret < 0) {
+      return -1;
+    }
+    done += ret;
+  }
+  return done;
+}
@@ -394,6 +394,12 @@ enum
   CMD_TRANSPORT_GET_SOL_CONFIG = 0x22,
 };
 
+// DCMI Command Codes (DCMI/Table 6-1)
+enum
+{
+  CMD_DCMI_GET_POWER_READING = 0x02,
+};
+
 // NM Command Codes (Intel NM spec)
 enum
 {
@@ -572,6 +578,7 @@ enum
   CC_INVALID_CMD = 0xC1,
   CC_INVALID_LENGTH = 0xC7,
   CC_PARAM_OUT_OF_RANGE = 0xC9,
+  CC_NOT_PRESENT = 0xCB,
   CC_INVALID_DATA_FIELD = 0xCC,
   CC_CAN_NOT_RESPOND = 0xCE,
   CC_NOT_SUPP_IN_CURR_STATE = 0xD5,
@@ -697,6 +704,34 @@ enum USB_CDC_CTRL_STATUS {
 void lib_ipmi_handle(unsigned char *request, unsigned char req_len,
                  unsigned char *response, unsigned short *res_len);
 
+/*
+ * Asynchronous requests: many can be submitted to a queue, and go out
+ * at once over a persistent connection to the service. Each completes
+ * through its callback, with res_len 0 on a failure as lib_ipmi_handle().
+ * Callbacks run from lib_ipmi_queue_process(), in the order responses
+ * arrive. A queue is used by the thread which created it only.
+ */
+typedef void (*lib_ipmi_cb_t)(void *arg, unsigned char *response,
+                              unsigned short res_len);
+typedef struct lib_ipmi_queue_s lib_ipmi_queue_t;
+
+/* Queue of requests to an endpoint, SOCK_PATH_IPMI (ipmid) for NULL */
+lib_ipmi_queue_t *lib_ipmi_queue_create(const char *endpoint);
+/* Completes the requests in flight, then frees the queue */
+void lib_ipmi_queue_destroy(lib_ipmi_queue_t *q);
+int lib_ipmi_submit(lib_ipmi_queue_t *q, unsigned char *request,
+                    unsigned char req_len, lib_ipmi_cb_t cb, void *arg);
+/* Requests submitted and not completed yet */
+int lib_ipmi_queue_pending(lib_ipmi_queue_t *q);
+/* fd to poll for POLLIN before lib_ipmi_queue_process(q, 0), or -1 */
+int lib_ipmi_queue_fd(lib_ipmi_queue_t *q);
+/* Complete the requests whose responses are in. With a timeout (in
+ * seconds as TIMEOUT_IPMI), wait for at least one. Returns the number
+ * completed. */
+int lib_ipmi_queue_process(lib_ipmi_queue_t *q, int timeout);
+/* Complete every request in flight */
+int lib_ipmi_queue_drain(lib_ipmi_queue_t *q);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,241 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+
+// Benchmark of the kv store. Readers and writers run concurrently on a
+// set of keys of a region, then the keys are deleted one by one. Reports
+// the throughput (keys/s) and the p50/p99 latency of every operation, a
+// batch counting as one, for every mode of access (plain, cached gets,
+// batches) asked for. The backends are those the library is built with.
+//
+// The keys are "bench/<n>" of the real stores: the persist region is on
+// flash, so keep its runs short.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kv.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+  std::vector<kv::region> regions{kv::region::temp, kv::region::persist};
+  std::vector<std::string> modes{"plain"};
+  unsigned readers = 4;
+  unsigned writers = 1;
+  unsigned keys = 64;
+  unsigned batch = 8;
+  double seconds = 2.0;
+};
+
+// Latencies (us) of the operations of a kind, and their count of keys.
+struct OpStats {
+  std::vector<double> latency_us{};
+  uint64_t keys = 0;
+
+  void merge(const OpStats& other) {
+    latency_us.insert(
+        latency_us.end(), other.latency_us.begin(), other.latency_us.end());
+    keys += other.keys;
+  }
+};
+
+static double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) {
+    return 0.0;
+  }
+  size_t idx = std::min(v.size() - 1, size_t(p * v.size()));
+  std::nth_element(v.begin(), v.begin() + idx, v.end());
+  return v[idx];
+}
+
+static void report(const char* region, const std::string& mode,
+                   const char* op, OpStats& s, double seconds) {
+  printf("%-8s %-8s %-4s %10.0f %10.1f %10.1f\n", region, mode.c_str(), op,
+      s.keys / seconds, percentile(s.latency_us, 0.50),
+      percentile(s.latency_us, 0.99));
+}
+
+template <typename F>
+static double time_us(F&& f) {
+  auto start = bench_clock::now();
+  f();
+  std::chrono::duration<double, std::micro> d = bench_clock::now() - start;
+  return d.count();
+}
+
+static std::string key_name(unsigned n) {
+  return "bench/" + std::to_string(n);
+}
+
+static void run(const BenchConfig& conf, kv::region r,
+                const std::string& mode) {
+  const char* rname = r == kv::region::persist ? "persist" : "temp";
+  bool batched = mode == "batched";
+  kv::enable_cache(mode == "cached");
+
+  for (unsigned n = 0; n < conf.keys; n++) {
+    kv::set(key_name(n), "0", r);
+  }
+
+  std::atomic<bool> done = false;
+  std::vector<OpStats> gets(conf.readers), sets(conf.writers);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < conf.readers; t++) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      std::vector<std::string> keys(conf.batch);
+      auto& s = gets[t];
+      while (!done) {
+        if (batched) {
+          for (auto& k : keys) {
+            k = key_name(rng() % conf.keys);
+          }
+          s.latency_us.push_back(time_us([&] { kv::get_many(keys, r); }));
+          s.keys += keys.size();
+        } else {
+          auto k = key_name(rng() % conf.keys);
+          s.latency_us.push_back(time_us([&] { kv::try_get(k, r); }));
+          s.keys++;
+        }
+      }
+    });
+  }
+  for (unsigned t = 0; t < conf.writers; t++) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(1000 + t);
+      std::vector<std::pair<std::string, std::string>> values(conf.batch);
+      auto& s = sets[t];
+      while (!done) {
+        // A new value every time, as sensor readings would be.
+        if (batched) {
+          for (auto& [k, v] : values) {
+            k = key_name(rng() % conf.keys);
+            v = std::to_string(rng());
+          }
+          s.latency_us.push_back(time_us([&] { kv::set_many(values, r); }));
+          s.keys += values.size();
+        } else {
+          auto k = key_name(rng() % conf.keys);
+          auto v = std::to_string(rng());
+          s.latency_us.push_back(time_us([&] { kv::set(k, v, r); }));
+          s.keys++;
+        }
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(conf.seconds));
+  done = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  OpStats get_stats, set_stats, del_stats;
+  for (auto& s : gets) {
+    get_stats.merge(s);
+  }
+  for (auto& s : sets) {
+    set_stats.merge(s);
+  }
+  double del_us = 0.0;
+  for (unsigned n = 0; n < conf.keys; n++) {
+    double us = time_us([&] { kv::del(key_name(n), r); });
+    del_stats.latency_us.push_back(us);
+    del_stats.keys++;
+    del_us += us;
+  }
+
+  report(rname, mode, "get", get_stats, conf.seconds);
+  report(rname, mode, "set", set_stats, conf.seconds);
+  report(rname, mode, "del", del_stats, del_us / 1e6);
+  kv::enable_cache(false);
+}
+
+static void usage(const char* exe) {
+  std::cout << exe << " [options]\n"
+      "    --region <temp|persist|all>   region(s) to use (all)\n"
+      "    --mode <plain|cached|batched|all>\n"
+      "                                  access mode(s) to compare (plain)\n"
+      "    --readers <n>                 reader threads (4)\n"
+      "    --writers <n>                 writer threads (1)\n"
+      "    --keys <n>                    keys written and read (64)\n"
+      "    --batch <n>                   keys per batch (8)\n"
+      "    --seconds <s>                 time of every run (2)\n";
+}
+
+int main(int argc, const char** argv) {
+  BenchConfig conf;
+  for (int i = 1; i < argc; i++) {
+    std::string opt = argv[i];
+    if (opt == "--help" || i + 1 >= argc) {
+      usage(argv[0]);
+      return opt == "--help" ? 0 : 1;
+    }
+    std::string arg = argv[++i];
+    try {
+      if (opt == "--region") {
+        conf.regions.clear();
+        if (arg == "temp" || arg == "all") {
+          conf.regions.push_back(kv::region::temp);
+        }
+        if (arg == "persist" || arg == "all") {
+          conf.regions.push_back(kv::region::persist);
+        }
+      } else if (opt == "--mode") {
+        conf.modes = arg == "all" ?
+            std::vector<std::string>{"plain", "cached", "batched"} :
+            std::vector<std::string>{arg};
+      } else if (opt == "--readers") {
+        conf.readers = std::stoul(arg);
+      } else if (opt == "--writers") {
+        conf.writers = std::stoul(arg);
+      } else if (opt == "--keys") {
+        conf.keys = std::stoul(arg);
+      } else if (opt == "--batch") {
+        conf.batch = std::stoul(arg);
+      } else if (opt == "--seconds") {
+        conf.seconds = std::stod(arg);
+      } else {
+        usage(argv[0]);
+        return 1;
+      }
+    } catch (std::exception&) {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  for (auto& mode : conf.modes) {
+    if (mode != "plain" && mode != "cached" && mode != "batched") {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (conf.regions.empty() || conf.keys == 0 || conf.batch == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+#ifdef KV_SHM_TEMP
+  printf("temp backend: shm\n");
+#else
+  printf("temp backend: files\n");
+#endif
+#ifdef KV_PERSIST_JOURNAL
+  printf("persist journal: on\n");
+#else
+  printf("persist journal: off\n");
+#endif
+  printf("%-8s %-8s %-4s %10s %10s %10s\n",
+      "region", "mode", "op", "keys/s", "p50(us)", "p99(us)");
+  for (auto r : conf.regions) {
+    for (auto& mode : conf.modes) {
+      run(conf, r, mode);
+    }
+  }
+  return 0;
+}
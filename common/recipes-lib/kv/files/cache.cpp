@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <array>
+#include <cerrno>
+
+#include "cache.hpp"
+#include "log.hpp"
+
+namespace kv
+{
+
+// Any of these on a directory entry invalidates the cached key.
+static constexpr uint32_t watch_mask =
+    IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+Cache& Cache::instance() {
+  static Cache cache;
+  return cache;
+}
+
+Cache::~Cache() {
+  if (fd >= 0 && owner == getpid()) {
+    close(fd);
+  }
+}
+
+bool Cache::init() {
+  if (fd >= 0 && owner == getpid()) {
+    return true;
+  }
+  // Drop the queue of the parent without touching it.
+  if (fd >= 0) {
+    close(fd);
+  }
+  values.clear();
+  watches.clear();
+  dirs.clear();
+  owner = getpid();
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    KV_WARN("kv: cache disabled, inotify_init1 failed: %d", errno);
+    on = false;
+    return false;
+  }
+  return true;
+}
+
+void Cache::enable(bool en) {
+  std::lock_guard<std::mutex> lk(m);
+  on = en;
+  if (!on) {
+    if (fd >= 0 && owner == getpid()) {
+      close(fd);
+    }
+    fd = -1;
+    values.clear();
+    watches.clear();
+    dirs.clear();
+  }
+}
+
+void Cache::drop_dir(const std::string& dir) {
+  for (auto it = values.begin(); it != values.end();) {
+    if (FileHandle::path(it->first).parent_path() == dir) {
+      it = values.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Cache::drain() {
+  alignas(struct inotify_event) std::array<char, 4096> buf;
+  for (;;) {
+    ssize_t len = ::read(fd, buf.data(), buf.size());
+    if (len <= 0) {
+      // EAGAIN: Nothing changed since the last lookup.
+      return;
+    }
+    for (ssize_t off = 0; off < len;) {
+      auto ev = reinterpret_cast<const struct inotify_event*>(&buf[off]);
+      off += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        values.clear();
+        continue;
+      }
+      auto w = watches.find(ev->wd);
+      if (w == watches.end()) {
+        continue;
+      }
+      if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+        drop_dir(w->second);
+        if (ev->mask & IN_IGNORED) {
+          dirs.erase(w->second);
+          watches.erase(w);
+        }
+        continue;
+      }
+      if (ev->len > 0) {
+        values.erase((FileHandle::path(w->second) / ev->name).string());
+      }
+    }
+  }
+}
+
+std::optional<std::string> Cache::get(const FileHandle::path& p) {
+  std::lock_guard<std::mutex> lk(m);
+  if (!on || !init()) {
+    return std::nullopt;
+  }
+  drain();
+  auto it = values.find(p.string());
+  if (it == values.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void Cache::put(const FileHandle::path& p, const std::string& value) {
+  std::lock_guard<std::mutex> lk(m);
+  if (!on || !init()) {
+    return;
+  }
+  // Our own write is in the queue as well, apply it first.
+  drain();
+
+  auto dir = p.parent_path().string();
+  if (dirs.find(dir) == dirs.end()) {
+    int wd = inotify_add_watch(fd, dir.c_str(), watch_mask);
+    if (wd < 0) {
+      KV_DEBUG("kv: not caching %s, inotify_add_watch failed: %d",
+          p.c_str(), errno);
+      return;
+    }
+    dirs[dir] = wd;
+    watches[wd] = dir;
+  }
+  values[p.string()] = value;
+}
+
+} // namespace kv
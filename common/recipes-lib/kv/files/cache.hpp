@@ -0,0 +1,64 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+#include "fileops.hpp"
+
+namespace kv
+{
+
+/* Per-process cache of the key files, read by kv::get().
+ *
+ * Entries are invalidated through an inotify watch on the directory of
+ * every cached key, so a modification by any process is seen by the
+ * next lookup. Lookups only drain the (non-blocking) inotify queue,
+ * rather than opening, locking and reading the file.
+ *
+ * Entries are only filled while the key file is locked, after draining
+ * the queue, so a concurrent kv::set() cannot be missed.
+ */
+class Cache
+{
+  public:
+    static Cache& instance();
+
+    void enable(bool en);
+    bool enabled() const { return on; }
+
+    // Value of the key file at path, if cached and unchanged.
+    std::optional<std::string> get(const FileHandle::path& p);
+    // Record the contents of the (locked) key file at path.
+    void put(const FileHandle::path& p, const std::string& value);
+
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+  private:
+    Cache() {};
+    ~Cache();
+
+    // (Re)open the inotify queue, needs the lock.
+    bool init();
+    // Apply the pending inotify events, needs the lock.
+    void drain();
+    void drop_dir(const std::string& dir);
+
+    std::mutex m{};
+    std::atomic<bool> on = false;
+    int fd = -1;
+    // A forked child would share (and steal from) our inotify queue.
+    pid_t owner = 0;
+    std::unordered_map<std::string, std::string> values{};
+    std::unordered_map<int, std::string> watches{};
+    std::unordered_map<std::string, int> dirs{};
+};
+
+} // namespace kv
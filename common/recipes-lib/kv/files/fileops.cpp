@@ -34,13 +34,19 @@ static void create_dir(const FileHandle::path& dir) {
 }
 
 
-static FileHandle::path get_key_path(const std::string& key, region r) {
-  FileHandle::path p = r == region::persist ? kv_store : cache_store;
+FileHandle::path FileHandle::store_path(region r) {
+  return r == region::persist ? kv_store : cache_store;
+}
+
+FileHandle::path FileHandle::key_path(const std::string& key, region r) {
+  return store_path(r) / key;
+}
 
-  auto key_path = p / key;
+static FileHandle::path get_key_path(const std::string& key, region r) {
+  auto key_path = FileHandle::key_path(key, r);
   create_dir(key_path.parent_path());
 
-  return p / key;
+  return key_path;
 }
 
 
@@ -65,6 +71,29 @@ void FileHandle::open_and_lock(const std::string& key, region r) {
         std::error_code(errno, std::system_category()));
   }
 
+  lock();
+}
+
+bool FileHandle::open_existing(const std::string& key, region r) {
+  fpath = FileHandle::key_path(key, r);
+
+  fp = fopen(fpath.c_str(), "r");
+  present = (fp != nullptr);
+  if (!fp) {
+    // The key, or its directory, was never set.
+    if (errno == ENOENT) {
+      return false;
+    }
+    throw fs::filesystem_error(
+        "kv: error opening file", fpath,
+        std::error_code(errno, std::system_category()));
+  }
+
+  lock();
+  return true;
+}
+
+void FileHandle::lock() {
   if (flock(fileno(fp), LOCK_EX) != 0) {
     throw fs::filesystem_error(
         "kv: error calling flock", fpath,
@@ -129,6 +158,14 @@ void FileHandle::write(std::string value) {
   }
 }
 
+void FileHandle::sync() {
+  if (0 != fsync(fileno(fp))) {
+    throw fs::filesystem_error(
+        "kv: error calling fsync", fpath,
+        std::error_code(errno, std::system_category()));
+  }
+}
+
 void FileHandle::remove(const std::string& key, region r)
 {
   //If a file is passed as key and it exists, remove it.
@@ -157,4 +194,26 @@ void FileHandle::remove(const std::string& key, region r)
   }
 }
 
+std::vector<std::string> FileHandle::list(const std::string& prefix, region r)
+{
+  std::vector<std::string> keys;
+  auto p = store_path(r);
+  // Only the directory of the prefix can hold its keys.
+  auto dir = p / FileHandle::path(prefix).parent_path();
+  std::error_code ec;
+  if (!fs::is_directory(dir, ec)) {
+    return keys;
+  }
+  for (auto& entry : fs::recursive_directory_iterator(dir)) {
+    if (!fs::is_regular_file(entry)) {
+      continue;
+    }
+    auto key = entry.path().string().substr(p.string().length() + 1);
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      keys.push_back(std::move(key));
+    }
+  }
+  return keys;
+}
+
 } // namespace kv
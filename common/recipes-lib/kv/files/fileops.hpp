@@ -14,6 +14,7 @@ namespace std
 #include <filesystem>
 #endif
 #include <string>
+#include <vector>
 #include <sys/file.h>
 
 #include "kv.hpp"
@@ -42,10 +43,21 @@ class FileHandle
 
     template <access>
     void open_and_lock(const std::string& key, region r);
+    // Open and lock the key file for reading, returns false rather than
+    // throwing if the key does not exist.
+    bool open_existing(const std::string& key, region r);
 
     std::string read();
     void write(std::string value);
     static void remove(const std::string& key, region r);
+    // Keys of the files of the region starting with prefix.
+    static std::vector<std::string> list(const std::string& prefix, region r);
+    // Path of the key file, without creating its directory.
+    static path key_path(const std::string& key, region r);
+    // Directory of the key files of the region.
+    static path store_path(region r);
+    // Flush the written value to the storage.
+    void sync();
 
     FileHandle(const FileHandle&) = delete;
     FileHandle(FileHandle&&) = delete;
@@ -56,8 +68,12 @@ class FileHandle
 
     bool was_present() const { return present; }
 
+    const path& file_path() const { return fpath; }
+
   private:
 
+    void lock();
+
     FILE* fp = nullptr;
     path fpath = {};
     bool present = false;
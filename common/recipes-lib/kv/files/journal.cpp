@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#include "journal.hpp"
+#include "log.hpp"
+
+namespace kv
+{
+
+constexpr uint32_t journal_magic = 0x4b564a31; // "KVJ1"
+
+struct JournalHeader {
+  uint32_t magic;
+  // Bumped by every compaction.
+  uint32_t generation;
+};
+
+// Followed by the key and the value.
+struct JournalRecord {
+  // Of the lengths, the key and the value.
+  uint32_t crc;
+  uint16_t key_len;
+  uint16_t value_len;
+};
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t len) {
+  auto p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t record_crc(const JournalRecord& rec, const char* data) {
+  uint32_t crc = crc32(0, &rec.key_len, sizeof(rec.key_len));
+  crc = crc32(crc, &rec.value_len, sizeof(rec.value_len));
+  return crc32(crc, data, rec.key_len + rec.value_len);
+}
+
+static std::system_error journal_error(const std::string& what) {
+  return std::system_error(errno, std::generic_category(), "kv journal: " + what);
+}
+
+class Journal::Lock
+{
+  public:
+    Lock(Journal& j, int op) : journal(j), lk(j.m) {
+      while (flock(journal.fd, op) != 0) {
+        if (errno != EINTR) {
+          throw journal_error("flock");
+        }
+      }
+    }
+    ~Lock() { flock(journal.fd, LOCK_UN); }
+
+  private:
+    Journal& journal;
+    std::lock_guard<std::mutex> lk;
+};
+
+Journal* Journal::persist() {
+  static Journal* journal = []() -> Journal* {
+    try {
+      auto p = FileHandle::store_path(region::persist);
+      return new Journal(p.string() + ".journal");
+    } catch (std::exception& e) {
+      KV_WARN("kv: persist journal unavailable: %s", e.what());
+      return nullptr;
+    }
+  }();
+  return journal;
+}
+
+Journal::Journal(const FileHandle::path& p) : path(p) {
+  std::filesystem::create_directories(path.parent_path());
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw journal_error("open " + path.string());
+  }
+  // The compaction thread could hold our lock in a fork, and is not
+  // carried over to the child.
+  pthread_atfork(
+      [] { persist()->m.lock(); },
+      [] { persist()->m.unlock(); },
+      [] {
+        persist()->m.unlock();
+        persist()->compaction_pending = false;
+      });
+}
+
+off_t Journal::refresh() {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw journal_error("fstat");
+  }
+  JournalHeader hdr{};
+  if (st.st_size >= off_t(sizeof(hdr)) &&
+      pread(fd, &hdr, sizeof(hdr), 0) != ssize_t(sizeof(hdr))) {
+    throw journal_error("read");
+  }
+  if (hdr.magic != journal_magic) {
+    // Not yet written.
+    hdr.generation = 0;
+  }
+  if (hdr.generation != generation || st.st_size < offset ||
+      offset < off_t(sizeof(hdr))) {
+    index.clear();
+    generation = hdr.generation;
+    offset = sizeof(hdr);
+  }
+  if (st.st_size <= offset) {
+    return offset;
+  }
+
+  std::vector<char> buf(st.st_size - offset);
+  ssize_t len = pread(fd, buf.data(), buf.size(), offset);
+  if (len < 0) {
+    throw journal_error("read");
+  }
+  size_t pos = 0;
+  while (pos + sizeof(JournalRecord) <= size_t(len)) {
+    JournalRecord rec;
+    memcpy(&rec, &buf[pos], sizeof(rec));
+    const char* data = &buf[pos + sizeof(rec)];
+    size_t rec_len = sizeof(rec) + rec.key_len + rec.value_len;
+    // A torn record ends the journal.
+    if (pos + rec_len > size_t(len) || record_crc(rec, data) != rec.crc) {
+      break;
+    }
+    index[std::string{data, data + rec.key_len}] =
+        std::string{data + rec.key_len, data + rec.key_len + rec.value_len};
+    pos += rec_len;
+  }
+  offset += pos;
+  return offset;
+}
+
+std::optional<std::string> Journal::get(const std::string& key) {
+  Lock lk(*this, LOCK_SH);
+  refresh();
+  auto it = index.find(key);
+  if (it == index.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::vector<std::string> Journal::keys(const std::string& prefix) {
+  Lock lk(*this, LOCK_SH);
+  refresh();
+  std::vector<std::string> found;
+  for (auto& entry : index) {
+    if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+      found.push_back(entry.first);
+    }
+  }
+  return found;
+}
+
+std::vector<int> Journal::set(
+    const std::vector<std::pair<std::string, std::string>>& values,
+    bool require_create) {
+  std::vector<int> errors(values.size());
+  Lock lk(*this, LOCK_EX);
+
+  off_t end = refresh();
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw journal_error("fstat");
+  }
+  if (st.st_size < off_t(sizeof(JournalHeader))) {
+    JournalHeader hdr{journal_magic, generation};
+    if (pwrite(fd, &hdr, sizeof(hdr), 0) != ssize_t(sizeof(hdr))) {
+      throw journal_error("write");
+    }
+  } else if (st.st_size > end && ftruncate(fd, end) != 0) {
+    // Drop the torn record of a writer which crashed.
+    throw journal_error("ftruncate");
+  }
+
+  std::string buf;
+  auto prev_index = index;
+  for (size_t i = 0; i < values.size(); i++) {
+    auto& [key, value] = values[i];
+    if (key.size() > UINT16_MAX || value.size() > UINT16_MAX) {
+      errors[i] = E2BIG;
+      continue;
+    }
+
+    std::optional<std::string> current;
+    if (auto it = index.find(key); it != index.end()) {
+      current = it->second;
+    } else {
+      try {
+        FileHandle fp;
+        fp.open_and_lock<FileHandle::access::read>(key, region::persist);
+        current = fp.read();
+      } catch (std::filesystem::filesystem_error& e) {
+        if (e.code().value() != ENOENT) {
+          errors[i] = e.code().value();
+          continue;
+        }
+      }
+    }
+    if (current && require_create) {
+      errors[i] = EEXIST;
+      continue;
+    }
+    // Save on flash writes, as for the files.
+    if (current == value) {
+      continue;
+    }
+
+    JournalRecord rec{0, uint16_t(key.size()), uint16_t(value.size())};
+    std::string data = key + value;
+    rec.crc = record_crc(rec, data.data());
+    buf.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    buf.append(data);
+    index[key] = value;
+  }
+  if (buf.empty()) {
+    return errors;
+  }
+
+  if (pwrite(fd, buf.data(), buf.size(), offset) != ssize_t(buf.size())) {
+    auto err = journal_error("write");
+    index = std::move(prev_index);
+    if (ftruncate(fd, offset) != 0) {
+      KV_WARN("kv journal: could not drop a partial record: %d", errno);
+    }
+    throw err;
+  }
+  offset += buf.size();
+
+  if (size_t(offset) >= max_size) {
+    compact_locked();
+  } else {
+    schedule_compaction();
+  }
+  return errors;
+}
+
+void Journal::compact_locked() {
+  for (auto& [key, value] : index) {
+    FileHandle fp;
+    fp.open_and_lock<FileHandle::access::write>(key, region::persist);
+    if (!fp.was_present() || fp.read() != value) {
+      fp.write(value);
+    }
+    fp.sync();
+  }
+
+  // The files are on flash, the records can go.
+  JournalHeader hdr{journal_magic, generation + 1};
+  if (ftruncate(fd, sizeof(hdr)) != 0 ||
+      pwrite(fd, &hdr, sizeof(hdr), 0) != ssize_t(sizeof(hdr))) {
+    throw journal_error("truncate");
+  }
+  fsync(fd);
+  index.clear();
+  generation = hdr.generation;
+  offset = sizeof(hdr);
+}
+
+void Journal::compact() {
+  Lock lk(*this, LOCK_EX);
+  refresh();
+  if (!index.empty()) {
+    compact_locked();
+  }
+}
+
+void Journal::schedule_compaction() {
+  if (compaction_pending.exchange(true)) {
+    return;
+  }
+  // If we exit first, the next writer compacts.
+  std::thread([this] {
+    std::this_thread::sleep_for(std::chrono::seconds(compact_delay_s));
+    compaction_pending = false;
+    try {
+      compact();
+    } catch (std::exception& e) {
+      KV_WARN("kv journal: compaction failed: %s", e.what());
+    }
+  }).detach();
+}
+
+} // namespace kv
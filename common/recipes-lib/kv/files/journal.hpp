@@ -0,0 +1,85 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+#include "fileops.hpp"
+
+namespace kv
+{
+
+/* Write-coalescing journal of the persist region
+ * (meson -Dpersist-journal=true).
+ *
+ * kv::set() appends a checksummed record to a journal next to the key
+ * files, rather than rewriting the key file. The journal is compacted
+ * into the key files a few seconds after the first record (or at once
+ * when it grows too large), so a burst of writes to a key costs a single
+ * write of its file. Lookups check the journal first, so get() sees
+ * every completed set() of any process.
+ *
+ * Crash consistency: A record torn by a crash fails its checksum and is
+ * dropped with everything after it. Compaction syncs the key files
+ * before the journal is emptied, and bumps the generation in the header
+ * of the journal so readers drop their index.
+ *
+ * The journal is locked with flock, shared by readers and exclusively
+ * by writers. It is always locked before the key files.
+ */
+class Journal
+{
+  public:
+    // Records appended before a compaction is forced.
+    static constexpr size_t max_size = 64 * 1024;
+    // Time to coalesce writes before compacting.
+    static constexpr unsigned compact_delay_s = 5;
+
+    // The journal of the persist region, nullptr if not used.
+    static Journal* persist();
+
+    // Value of the key, if it is journaled (not yet in its file).
+    std::optional<std::string> get(const std::string& key);
+    // Journal the values, a key of require_create fails with EEXIST if
+    // it already exists. Returns the errno of every value.
+    std::vector<int> set(
+        const std::vector<std::pair<std::string, std::string>>& values,
+        bool require_create);
+    // Journaled keys starting with prefix.
+    std::vector<std::string> keys(const std::string& prefix);
+    // Write all the journaled values to their files.
+    void compact();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+  private:
+    explicit Journal(const FileHandle::path& p);
+
+    // Bring the index up to date with the file, needs the flock. Returns
+    // the end of the valid records.
+    off_t refresh();
+    void compact_locked();
+    // Compact later on a thread of ours, unless one is pending.
+    void schedule_compaction();
+
+    class Lock;
+    const FileHandle::path path;
+    int fd = -1;
+    std::mutex m{};
+    // Latest journaled value of every key, up to offset of generation.
+    std::unordered_map<std::string, std::string> index{};
+    uint32_t generation = 0;
+    off_t offset = 0;
+    std::atomic<bool> compaction_pending = false;
+};
+
+} // namespace kv
@@ -11,6 +11,8 @@ void usage(const char* exe_name) {
          "        set <key> <value> <type|>*\n"
          "    del:\n"
          "        del <key> <type|>*\n"
+         "    list:\n"
+         "        list <prefix> <type|>*\n"
          "\n"
          "    valid types:\n"
          "        persistent - use the persistent kv store.\n"
@@ -87,6 +89,28 @@ int cmd_del(int argc, const char** argv) {
   return 0;
 }
 
+/** Handle 'list' subcommand. */
+int cmd_list(int argc, const char** argv) {
+  if (argc <= pos_key) {
+    // Not enough args.
+    usage(argv[pos_exe]);
+    return 1;
+  }
+
+  // Parse flags
+  auto r = region(argc <= pos_get_flag ? "" : argv[pos_get_flag]);
+
+  try {
+    for (auto& key : kv::list(argv[pos_key], r)) {
+      std::cout << key << "\n";
+    }
+  } catch (std::exception& e) {
+    std::cerr << argv[pos_key] << " Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
 /** Handle 'set' subcommand. */
 int cmd_set(int argc, const char** argv) {
   if (argc < pos_set_value) {
@@ -119,6 +143,8 @@ int main(int argc, const char** argv) {
       return cmd_del(argc, argv);
     } else if (std::string("set") == argv[pos_cmd]) {
       return cmd_set(argc, argv);
+    } else if (std::string("list") == argv[pos_cmd]) {
+      return cmd_list(argc, argv);
     } else if (std::string("help") == argv[pos_cmd]) {
       usage(argv[pos_exe]);
       return 0;
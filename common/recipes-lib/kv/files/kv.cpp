@@ -5,9 +5,17 @@
 #include <syslog.h>
 #include <limits>
 #include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <system_error>
 
 #include "kv.hpp"
+#include "cache.hpp"
 #include "fileops.hpp"
+#include "journal.hpp"
+#include "shm_store.hpp"
+#include "watch.hpp"
 #include "log.hpp"
 
 using namespace kv;
@@ -83,7 +91,13 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags) {
 
   try {
     auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
-    auto result = kv::get(key, r);
+    auto found = kv::try_get(key, r);
+    if (!found) {
+      // Too many callers look up keys not created yet to log these.
+      errno = ENOENT;
+      return -1;
+    }
+    auto& result = *found;
     auto bytes = result.size();
 
     // result is required to be less than or equal to 'MAX_VALUE_LEN' and
@@ -123,6 +137,183 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags) {
   return 0;
 }
 
+/*
+*  get the values of count keys, holding the locks of all of them.
+*  Every entry gets the length and error (0 or errno) of its own key.
+*
+*  return 0 if all keys were read, else -1 with errno of the first failure.
+*/
+int kv_get_many(struct kv_get_entry *entries, size_t count, unsigned int flags)
+{
+  if (entries == nullptr && count != 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::vector<std::string> keys;
+  std::vector<size_t> idx;
+  for (size_t i = 0; i < count; i++) {
+    entries[i].error = 0;
+    if (entries[i].key == nullptr || entries[i].value == nullptr) {
+      entries[i].error = EINVAL;
+      continue;
+    }
+    keys.push_back(entries[i].key);
+    idx.push_back(i);
+  }
+
+  try {
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    auto results = kv::get_many(keys, r);
+    for (size_t i = 0; i < results.size(); i++) {
+      auto& e = entries[idx[i]];
+      e.error = results[i].error;
+      if (e.error != 0) {
+        continue;
+      }
+      auto& value = results[i].value;
+      std::copy(std::begin(value), std::end(value), e.value);
+      e.len = value.size();
+      if (e.len < max_len)
+        e.value[e.len] = '\0';
+    }
+  } catch (std::exception& e) {
+    KV_WARN("kv_get_many: %s", e.what());
+    errno = EIO;
+    return -1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].error != 0) {
+      errno = entries[i].error;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+*  set the values of count keys, holding the locks of all of them.
+*  A len of 0 implies the value is a string, as for kv_set.
+*
+*  return 0 if all keys were written, else -1 with errno of the first
+*  failure. Every entry gets the error (0 or errno) of its own key.
+*/
+int kv_set_many(struct kv_set_entry *entries, size_t count, unsigned int flags)
+{
+  if (entries == nullptr && count != 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::vector<std::pair<std::string, std::string>> values;
+  std::vector<size_t> idx;
+  for (size_t i = 0; i < count; i++) {
+    auto& e = entries[i];
+    e.error = 0;
+    if (e.key == nullptr || e.value == nullptr) {
+      e.error = EINVAL;
+      continue;
+    }
+    size_t len = e.len;
+    if (len == 0) {
+      /* See kv_set on string lengths. */
+      len = strnlen(e.value, MAX_VALUE_LEN);
+      if (len >= MAX_VALUE_LEN) {
+        e.error = E2BIG;
+        continue;
+      }
+    }
+    if (len > MAX_VALUE_LEN) {
+      e.error = E2BIG;
+      continue;
+    }
+    values.emplace_back(e.key, std::string{e.value, e.value + len});
+    idx.push_back(i);
+  }
+
+  try {
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    auto errors = kv::set_many(values, r, flags & KV_FCREATE);
+    for (size_t i = 0; i < errors.size(); i++) {
+      entries[idx[i]].error = errors[i];
+    }
+  } catch (std::exception& e) {
+    KV_WARN("kv_set_many: %s", e.what());
+    errno = EIO;
+    return -1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].error != 0) {
+      errno = entries[i].error;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int kv_list(const char *prefix, void (*cb)(const char *key, void *arg),
+            void *arg, unsigned int flags)
+{
+  if (prefix == nullptr || cb == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    for (auto& key : kv::list(prefix, r)) {
+      cb(key.c_str(), arg);
+    }
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_list: %s", e.what());
+    return -1;
+  }
+  return 0;
+}
+
+struct kv_watch {
+  std::unique_ptr<kv::watcher> w;
+};
+
+kv_watch_t *kv_watch(const char *prefix,
+                     void (*cb)(const char *key, void *arg), void *arg,
+                     unsigned int flags)
+{
+  if (prefix == nullptr || cb == nullptr) {
+    errno = EINVAL;
+    return nullptr;
+  }
+
+  try {
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    auto handle = new kv_watch_t;
+    handle->w = kv::watch(
+        prefix, [cb, arg](const std::string& key) { cb(key.c_str(), arg); },
+        r);
+    return handle;
+  } catch (std::system_error& e) {
+    errno = e.code().value();
+    KV_WARN("kv_watch: %s", e.what());
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_watch: %s", e.what());
+  }
+  return nullptr;
+}
+
+void kv_unwatch(kv_watch_t *w)
+{
+  delete w;
+}
+
+void kv_enable_cache(int enable)
+{
+  kv::enable_cache(enable != 0);
+}
+
 int kv_del(const char *key, unsigned int flags)
 {
   if (key == nullptr)
@@ -145,14 +336,58 @@ int kv_del(const char *key, unsigned int flags)
 
 namespace kv {
 
-void set(const std::string& key, const std::string& value,
-         region r, bool require_create)
+// The shared memory store backing the region, if any.
+static ShmStore* shm_store(region r)
 {
+#ifdef KV_SHM_TEMP
+  return r == region::temp ? ShmStore::temp() : nullptr;
+#else
+  (void)r;
+  return nullptr;
+#endif
+}
 
-  FileHandle fp;
-  fp.open_and_lock<FileHandle::access::write>(key, r);
+// The journal of the region, if any.
+static Journal* journal(region r)
+{
+#ifdef KV_PERSIST_JOURNAL
+  return r == region::persist ? Journal::persist() : nullptr;
+#else
+  (void)r;
+  return nullptr;
+#endif
+}
+
+// Journaled files change without the cache being told.
+static bool cacheable(region r)
+{
+  return Cache::instance().enabled() && !shm_store(r) && !journal(r);
+}
 
+// Store the value in the shm store, returns false if it is left to the
+// file. The files are still checked for require_create, as keys could
+// be in either.
+static bool shm_set(ShmStore& shm, const std::string& key,
+                    const std::string& value, region r, bool require_create)
+{
+  if (require_create &&
+      (shm.contains(key) ||
+       std::filesystem::exists(FileHandle::key_path(key, r)))) {
+    throw key_already_exists("kv_set: key " + key + " already exists");
+  }
+  if (ShmStore::fits(key, value) && shm.set(key, value)) {
+    return true;
+  }
+  // The slot would shadow the file.
+  shm.erase(key);
+  return false;
+}
 
+// Write the value to the locked key file.
+static void set_locked(FileHandle& fp, const std::string& key,
+                       const std::string& value, region r,
+                       bool require_create)
+{
   if (fp.was_present() && require_create) {
     throw key_already_exists("kv_set: key " + key + " already exists");
   }
@@ -160,24 +395,259 @@ void set(const std::string& key, const std::string& value,
   // Check if we are writing the same value. If so, exit early
   // to save on number of times flash is updated.
   if (fp.was_present() && r == region::persist && (fp.read() == value)) {
+    Cache::instance().put(fp.file_path(), value);
     return;
   }
 
   fp.write(value);
+  Cache::instance().put(fp.file_path(), value);
 }
 
-std::string get(const std::string& key, region r)
+void set(const std::string& key, const std::string& value,
+         region r, bool require_create)
+{
+  if (auto shm = shm_store(r)) {
+    if (shm_set(*shm, key, value, r, require_create)) {
+      return;
+    }
+  }
+  if (auto j = journal(r)) {
+    int err = j->set({{key, value}}, require_create).front();
+    if (err == EEXIST) {
+      throw key_already_exists("kv_set: key " + key + " already exists");
+    }
+    if (err != 0) {
+      throw std::system_error(err, std::generic_category(), "kv_set: " + key);
+    }
+    return;
+  }
+
+  FileHandle fp;
+  fp.open_and_lock<FileHandle::access::write>(key, r);
+
+  set_locked(fp, key, value, r, require_create);
+}
+
+std::optional<std::string> try_get(const std::string& key, region r)
 {
+  auto& cache = Cache::instance();
+  if (auto shm = shm_store(r)) {
+    if (auto value = shm->get(key)) {
+      return *value;
+    }
+  } else if (auto j = journal(r)) {
+    if (auto value = j->get(key)) {
+      return *value;
+    }
+  } else if (cacheable(r)) {
+    if (auto value = cache.get(FileHandle::key_path(key, r))) {
+      return *value;
+    }
+  }
+
   FileHandle fp;
-  fp.open_and_lock<FileHandle::access::read>(key, r);
+  if (!fp.open_existing(key, r)) {
+    return std::nullopt;
+  }
 
-  return fp.read();
+  auto value = fp.read();
+  cache.put(fp.file_path(), value);
+  return value;
+}
+
+std::string get(const std::string& key, region r)
+{
+  if (auto value = try_get(key, r)) {
+    return *value;
+  }
+  throw std::filesystem::filesystem_error(
+      "kv: error opening file", FileHandle::key_path(key, r),
+      std::error_code(ENOENT, std::system_category()));
+}
+
+std::vector<std::string> list(const std::string& prefix, region r)
+{
+  auto files = FileHandle::list(prefix, r);
+  std::set<std::string> keys(files.begin(), files.end());
+  if (auto shm = shm_store(r)) {
+    auto found = shm->keys(prefix);
+    keys.insert(found.begin(), found.end());
+  }
+  if (auto j = journal(r)) {
+    auto found = j->keys(prefix);
+    keys.insert(found.begin(), found.end());
+  }
+  return {keys.begin(), keys.end()};
+}
+
+std::unique_ptr<watcher> watch(const std::string& prefix, watch_callback cb,
+                               region r)
+{
+  return std::make_unique<Watch>(prefix, std::move(cb), r);
 }
 
 void del(const std::string& key, region r)
 {
+  if (auto shm = shm_store(r)) {
+    bool removed = shm->remove(key);
+    try {
+      FileHandle::remove(key, r);
+    } catch (key_does_not_exist& e) {
+      if (!removed) {
+        throw;
+      }
+    }
+    return;
+  }
+  if (auto j = journal(r)) {
+    // Deletes are rare, the journal goes to the files first.
+    j->compact();
+  }
   FileHandle::remove(key, r);
 }
 
+void enable_cache(bool enable)
+{
+  Cache::instance().enable(enable);
+}
+
+// Run the operation on a key of a batch, returns the errno of its failure.
+template <typename F>
+static int batch_op(F&& op)
+{
+  try {
+    op();
+  } catch (std::filesystem::filesystem_error& e) {
+    return e.code().value();
+  } catch (key_already_exists& e) {
+    return EEXIST;
+  } catch (std::exception& e) {
+    KV_WARN("kv: %s", e.what());
+    return EIO;
+  }
+  return 0;
+}
+
+std::vector<batch_result> get_many(const std::vector<std::string>& keys,
+                                   region r)
+{
+  std::vector<batch_result> results(keys.size());
+  auto& cache = Cache::instance();
+  auto shm = shm_store(r);
+  auto j = journal(r);
+
+  // The files of the keys not cached, by path. These are locked in order,
+  // so concurrent batches cannot deadlock.
+  std::map<FileHandle::path, std::vector<size_t>> pending;
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto p = FileHandle::key_path(keys[i], r);
+    if (shm) {
+      if (auto value = shm->get(keys[i])) {
+        results[i].value = std::move(*value);
+        continue;
+      }
+    } else if (j) {
+      std::optional<std::string> value;
+      results[i].error = batch_op([&] { value = j->get(keys[i]); });
+      if (value || results[i].error != 0) {
+        results[i].value = value.value_or("");
+        continue;
+      }
+    } else if (cacheable(r)) {
+      if (auto value = cache.get(p)) {
+        results[i].value = std::move(*value);
+        continue;
+      }
+    }
+    pending[p].push_back(i);
+  }
+
+  std::list<FileHandle> files;
+  for (auto& [p, idx] : pending) {
+    auto& fp = files.emplace_back();
+    bool found = true;
+    int err = batch_op([&] { found = fp.open_existing(keys[idx.front()], r); });
+    if (!found) {
+      err = ENOENT;
+    }
+    for (auto i : idx) {
+      results[i].error = err;
+    }
+  }
+
+  auto fp = files.begin();
+  for (auto& [p, idx] : pending) {
+    auto& file = *fp++;
+    if (!file) {
+      continue;
+    }
+    std::string value;
+    int err = batch_op([&] {
+      value = file.read();
+      cache.put(file.file_path(), value);
+    });
+    for (auto i : idx) {
+      results[i].value = value;
+      results[i].error = err;
+    }
+  }
+  return results;
+}
+
+std::vector<int> set_many(
+    const std::vector<std::pair<std::string, std::string>>& values,
+    region r, bool require_create)
+{
+  if (auto j = journal(r)) {
+    // All of the batch goes in one append.
+    return j->set(values, require_create);
+  }
+
+  std::vector<int> errors(values.size());
+  auto shm = shm_store(r);
+
+  // As in get_many, lock the files in order. Repeated keys are written in
+  // the order given, so the last value wins.
+  std::map<FileHandle::path, std::vector<size_t>> pending;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (shm) {
+      bool stored = false;
+      errors[i] = batch_op([&] {
+        stored = shm_set(*shm, values[i].first, values[i].second, r,
+                         require_create);
+      });
+      if (stored || errors[i] != 0) {
+        continue;
+      }
+    }
+    pending[FileHandle::key_path(values[i].first, r)].push_back(i);
+  }
+
+  std::list<FileHandle> files;
+  for (auto& [p, idx] : pending) {
+    auto& fp = files.emplace_back();
+    int err = batch_op([&] {
+      fp.open_and_lock<FileHandle::access::write>(values[idx.front()].first, r);
+    });
+    for (auto i : idx) {
+      errors[i] = err;
+    }
+  }
+
+  auto fp = files.begin();
+  for (auto& [p, idx] : pending) {
+    auto& file = *fp++;
+    if (!file) {
+      continue;
+    }
+    for (auto i : idx) {
+      errors[i] = batch_op([&] {
+        set_locked(file, values[i].first, values[i].second, r, require_create);
+      });
+    }
+  }
+  return errors;
+}
+
 
 } // namespace kv
@@ -30,6 +30,44 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags);
 int kv_set(const char *key, const char *value, size_t len, unsigned int flags);
 int kv_del(const char *key, unsigned int flags);
 
+/* A key of a batch. value holds MAX_VALUE_LEN bytes for kv_get_many,
+ * len is as for kv_get / kv_set. error is set to 0 or the errno of
+ * the key. */
+struct kv_get_entry {
+  const char *key;
+  char *value;
+  size_t len;
+  int error;
+};
+
+struct kv_set_entry {
+  const char *key;
+  const char *value;
+  size_t len;
+  int error;
+};
+
+/* Get or set count keys, with the locks of all of them taken together.
+ * Returns 0, or -1 (errno of the first failed entry) if any key failed. */
+int kv_get_many(struct kv_get_entry *entries, size_t count, unsigned int flags);
+int kv_set_many(struct kv_set_entry *entries, size_t count, unsigned int flags);
+
+/* Call cb with every key starting with prefix (see kv::list).
+ * Returns 0, or -1 with errno set. */
+int kv_list(const char *prefix, void (*cb)(const char *key, void *arg),
+    void *arg, unsigned int flags);
+
+/* Call cb, from a thread of the library, with the key of every set or
+ * delete of a key starting with prefix (see kv::watch), until
+ * kv_unwatch(). Returns NULL with errno set on failure. */
+typedef struct kv_watch kv_watch_t;
+kv_watch_t *kv_watch(const char *prefix,
+    void (*cb)(const char *key, void *arg), void *arg, unsigned int flags);
+void kv_unwatch(kv_watch_t *w);
+
+/* Opt-in per-process cache of kv_get() (see kv::enable_cache). */
+void kv_enable_cache(int enable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,8 +3,13 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2020-present Facebook. All Rights Reserved.
  */
+#include <functional>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 #include "kv.h"
 
 namespace kv {
@@ -17,6 +22,48 @@ void set(const std::string& key, const std::string& value,
     region r = region::temp, bool require_create = false);
 void del(const std::string& key, region r = region::temp);
 
+// As get(), but a missing key is returned as nullopt rather than thrown.
+std::optional<std::string> try_get(const std::string& key,
+    region r = region::temp);
+
+// Keys starting with prefix, sorted. Keys in subdirectories are listed
+// with their path, e.g. "fru1/serial" for the prefix "fru1/".
+std::vector<std::string> list(const std::string& prefix,
+    region r = region::temp);
+
+// Called with the key of every set or delete of a watched key.
+using watch_callback = std::function<void(const std::string& key)>;
+
+// A watch, which stops when destroyed.
+class watcher {
+  public:
+    virtual ~watcher() = default;
+};
+
+// Call cb, from a thread of the watch, for changes to the keys starting
+// with prefix. Throws std::system_error if inotify is unavailable.
+std::unique_ptr<watcher> watch(const std::string& prefix, watch_callback cb,
+    region r = region::temp);
+
+// Result of a key of a batch: error is 0, or the errno of its failure.
+struct batch_result {
+    std::string value;
+    int error = 0;
+};
+
+// Get or set a batch of keys. The files of all the keys are locked
+// together, so the batch is consistent against other writers.
+std::vector<batch_result> get_many(const std::vector<std::string>& keys,
+    region r = region::temp);
+std::vector<int> set_many(
+    const std::vector<std::pair<std::string, std::string>>& values,
+    region r = region::temp, bool require_create = false);
+
+// Cache the values returned by get() in this process. Changes by any
+// process are seen by the next get(), which otherwise only costs a
+// (non-blocking) read of an inotify queue.
+void enable_cache(bool enable = true);
+
 struct key_already_exists : public std::logic_error {
     using logic_error::logic_error;
 };
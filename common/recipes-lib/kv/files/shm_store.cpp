@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <sched.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <regex>
+#include <system_error>
+
+#include "shm_store.hpp"
+#include "log.hpp"
+
+namespace kv
+{
+
+#ifndef __TEST__
+constexpr auto temp_segment = "/kv_temp";
+#else
+constexpr auto temp_segment = "/kv_temp_test";
+#endif
+
+constexpr uint32_t shm_magic = 0x4b565453; // "KVTS"
+constexpr uint32_t shm_version = 1;
+// Readers retrying this many times assume the writer died.
+constexpr int max_read_tries = 1000;
+
+enum slot_state : uint8_t { slot_empty = 0, slot_used, slot_deleted };
+
+struct ShmStore::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+  uint32_t slot_size;
+};
+
+struct ShmStore::Slot {
+  // Odd while a writer updates the slot.
+  uint32_t seq;
+  uint32_t hash;
+  uint8_t state;
+  uint8_t key_len;
+  uint16_t value_len;
+  char key[max_key_len];
+  char value[max_value_len];
+};
+
+class ShmStore::WriteLock
+{
+  public:
+    explicit WriteLock(ShmStore& s) : store(s), lk(s.m) {
+      while (flock(store.fd, LOCK_EX) != 0 && errno == EINTR) {
+      }
+    }
+    ~WriteLock() { flock(store.fd, LOCK_UN); }
+
+  private:
+    ShmStore& store;
+    std::lock_guard<std::mutex> lk;
+};
+
+// FNV-1a
+static uint32_t key_hash(const std::string& key) {
+  uint32_t h = 2166136261u;
+  for (unsigned char c : key) {
+    h = (h ^ c) * 16777619u;
+  }
+  return h;
+}
+
+static bool key_equals(const ShmStore::Slot& s, const std::string& key) {
+  return s.key_len == key.size() && memcmp(s.key, key.data(), s.key_len) == 0;
+}
+
+ShmStore* ShmStore::temp() {
+  static ShmStore* store = []() -> ShmStore* {
+    try {
+      return new ShmStore(temp_segment);
+    } catch (std::exception& e) {
+      KV_WARN("kv: shm temp store unavailable, using files: %s", e.what());
+      return nullptr;
+    }
+  }();
+  return store;
+}
+
+ShmStore::ShmStore(const char* name) {
+  constexpr size_t size = sizeof(Header) + num_slots * sizeof(Slot);
+  auto fail = [&](const char* what) {
+    int err = errno;
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::system_error(err, std::generic_category(), what);
+  };
+
+  fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    fail("shm_open");
+  }
+  // The first process to get here sizes and formats the segment.
+  if (flock(fd, LOCK_EX) != 0) {
+    fail("flock");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    fail("fstat");
+  }
+  bool fresh = st.st_size == 0;
+  if (fresh && ftruncate(fd, size) != 0) {
+    fail("ftruncate");
+  }
+  void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    fail("mmap");
+  }
+  header = static_cast<Header*>(addr);
+  slots = reinterpret_cast<Slot*>(header + 1);
+  if (fresh) {
+    header->num_slots = num_slots;
+    header->slot_size = sizeof(Slot);
+    header->version = shm_version;
+    header->magic = shm_magic;
+  }
+  bool valid = header->magic == shm_magic && header->version == shm_version &&
+      header->num_slots == num_slots && header->slot_size == sizeof(Slot);
+  flock(fd, LOCK_UN);
+  if (!valid) {
+    munmap(addr, size);
+    errno = EPROTO;
+    fail("incompatible segment");
+  }
+}
+
+void ShmStore::read_slot(size_t idx, Slot& copy) {
+  Slot& slot = slots[idx];
+  for (;;) {
+    for (int tries = 0; tries < max_read_tries; tries++) {
+      uint32_t seq = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+      if (seq & 1) {
+        sched_yield();
+        continue;
+      }
+      memcpy(&copy, &slot, sizeof(Slot));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot.seq, __ATOMIC_RELAXED) == seq) {
+        return;
+      }
+    }
+    // A live writer is done by the time we get the lock.
+    WriteLock lk(*this);
+    uint32_t seq = __atomic_load_n(&slot.seq, __ATOMIC_RELAXED);
+    if (seq & 1) {
+      KV_WARN("kv: repairing slot %zu of the shm temp store", idx);
+      slot.state = slot_deleted;
+      __atomic_store_n(&slot.seq, seq + 1, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+void ShmStore::write_slot(Slot& slot, const Slot& value) {
+  uint32_t seq = slot.seq;
+  __atomic_store_n(&slot.seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(reinterpret_cast<char*>(&slot) + sizeof(slot.seq),
+         reinterpret_cast<const char*>(&value) + sizeof(value.seq),
+         sizeof(Slot) - sizeof(slot.seq));
+  __atomic_store_n(&slot.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+size_t ShmStore::find(const std::string& key, uint32_t hash) {
+  for (size_t n = 0; n < num_slots; n++) {
+    size_t idx = (hash + n) % num_slots;
+    const Slot& slot = slots[idx];
+    if (slot.state == slot_empty) {
+      break;
+    }
+    if (slot.state == slot_used && slot.hash == hash && key_equals(slot, key)) {
+      return idx;
+    }
+  }
+  return num_slots;
+}
+
+std::optional<std::string> ShmStore::get(const std::string& key) {
+  if (key.size() > max_key_len) {
+    return std::nullopt;
+  }
+  uint32_t hash = key_hash(key);
+  Slot copy;
+  for (size_t n = 0; n < num_slots; n++) {
+    read_slot((hash + n) % num_slots, copy);
+    if (copy.state == slot_empty) {
+      break;
+    }
+    if (copy.state == slot_used && copy.hash == hash && key_equals(copy, key)) {
+      return std::string{copy.value, copy.value + copy.value_len};
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<std::string> ShmStore::keys(const std::string& prefix) {
+  std::vector<std::string> found;
+  Slot copy;
+  for (size_t i = 0; i < num_slots; i++) {
+    read_slot(i, copy);
+    if (copy.state != slot_used) {
+      continue;
+    }
+    std::string key{copy.key, copy.key + copy.key_len};
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      found.push_back(std::move(key));
+    }
+  }
+  return found;
+}
+
+bool ShmStore::set(const std::string& key, const std::string& value) {
+  uint32_t hash = key_hash(key);
+  Slot entry{};
+  entry.hash = hash;
+  entry.state = slot_used;
+  entry.key_len = uint8_t(key.size());
+  entry.value_len = uint16_t(value.size());
+  memcpy(entry.key, key.data(), key.size());
+  memcpy(entry.value, value.data(), value.size());
+
+  WriteLock lk(*this);
+  size_t idx = find(key, hash);
+  if (idx == num_slots) {
+    // The first free slot of the chain of the key.
+    for (size_t n = 0; n < num_slots && idx == num_slots; n++) {
+      size_t i = (hash + n) % num_slots;
+      if (slots[i].state != slot_used) {
+        idx = i;
+      }
+    }
+  }
+  if (idx == num_slots) {
+    return false;
+  }
+  write_slot(slots[idx], entry);
+  return true;
+}
+
+void ShmStore::erase(const std::string& key) {
+  Slot tombstone{};
+  tombstone.state = slot_deleted;
+
+  WriteLock lk(*this);
+  size_t idx = find(key, key_hash(key));
+  if (idx != num_slots) {
+    write_slot(slots[idx], tombstone);
+  }
+}
+
+bool ShmStore::remove(const std::string& key) {
+  Slot tombstone{};
+  tombstone.state = slot_deleted;
+
+  WriteLock lk(*this);
+  size_t idx = find(key, key_hash(key));
+  if (idx != num_slots) {
+    write_slot(slots[idx], tombstone);
+    return true;
+  }
+  std::regex search(key);
+  bool removed = false;
+  for (size_t i = 0; i < num_slots; i++) {
+    Slot& slot = slots[i];
+    if (slot.state != slot_used) {
+      continue;
+    }
+    if (std::regex_match(std::string{slot.key, slot.key + slot.key_len},
+                         search)) {
+      write_slot(slot, tombstone);
+      removed = true;
+    }
+  }
+  return removed;
+}
+
+} // namespace kv
@@ -0,0 +1,78 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "kv.hpp"
+
+namespace kv
+{
+
+/* Shared memory backend of the temp region (meson -Dtemp-backend=shm).
+ *
+ * A fixed-size open addressing hash table of keys and (small) values in
+ * a POSIX shared memory segment. Every slot has a sequence counter:
+ * readers copy a slot without any lock and retry if a writer updated it
+ * meanwhile, so readers never block writers (or each other). Writers of
+ * all the processes are serialized by a flock of the segment.
+ *
+ * Keys or values too large for a slot, or keys which do not fit in a
+ * full table, are left to the files of the region.
+ */
+class ShmStore
+{
+  public:
+    static constexpr size_t num_slots = 2048;
+    static constexpr size_t max_key_len = MAX_KEY_LEN;
+    static constexpr size_t max_value_len = 64;
+
+    // The store of the temp region, nullptr if the segment is unusable.
+    static ShmStore* temp();
+
+    static bool fits(const std::string& key, const std::string& value) {
+      return key.size() <= max_key_len && value.size() <= max_value_len;
+    }
+
+    std::optional<std::string> get(const std::string& key);
+    bool contains(const std::string& key) { return get(key).has_value(); }
+    // Store the (fitting) value, returns false if the table is full.
+    bool set(const std::string& key, const std::string& value);
+    // Keys starting with prefix.
+    std::vector<std::string> keys(const std::string& prefix);
+    // Remove the key, if present.
+    void erase(const std::string& key);
+    // Remove the key or, as FileHandle::remove, the keys matching
+    // the regex. Returns false if no key was removed.
+    bool remove(const std::string& key);
+
+    ShmStore(const ShmStore&) = delete;
+    ShmStore& operator=(const ShmStore&) = delete;
+
+    struct Header;
+    struct Slot;
+
+  private:
+    explicit ShmStore(const char* name);
+
+    // Copy the slot when it is not being updated. A slot left torn by a
+    // writer which died is repaired.
+    void read_slot(size_t idx, Slot& copy);
+    void write_slot(Slot& slot, const Slot& value);
+    // Index of the slot holding the key, or num_slots. Needs the lock.
+    size_t find(const std::string& key, uint32_t hash);
+
+    // Exclusive access, against the other threads and processes.
+    class WriteLock;
+    std::mutex m{};
+    int fd = -1;
+    Header* header = nullptr;
+    Slot* slots = nullptr;
+};
+
+} // namespace kv
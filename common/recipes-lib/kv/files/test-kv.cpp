@@ -4,14 +4,38 @@
 
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
 #include <unistd.h>
+#include <sys/mman.h>
 #include "kv.hpp"
 
+#ifdef KV_SHM_TEMP
+// Small temp keys are not files with the shm backend.
+#define TEMP_FILE_CREATED(path) true
+#else
+#define TEMP_FILE_CREATED(path) (access(path, F_OK) == 0)
+#endif
+
+#ifdef KV_PERSIST_JOURNAL
+// Persist keys are written to their files by the compaction.
+#define PERSIST_FILE_CREATED(path) true
+#else
+#define PERSIST_FILE_CREATED(path) (access(path, F_OK) == 0)
+#endif
+
 int main(int argc, char *argv[])
 {
   char value[MAX_VALUE_LEN*2];
   size_t len;
 
+#ifdef KV_SHM_TEMP
+  // Start from an empty store.
+  shm_unlink("/kv_temp_test");
+#endif
+
   assert(kv_get("test1", value, NULL, KV_FPERSIST) != 0);
   printf("SUCCESS: Non-existent file results in error.\n");
   assert(kv_del("test1", KV_FPERSIST) != 0);
@@ -19,7 +43,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test1", "val", 0, KV_FPERSIST) == 0);
   printf("SUCCESS: Creating persist key func call\n");
-  assert(access("./test/persist/test1", F_OK) == 0);
+  assert(PERSIST_FILE_CREATED("./test/persist/test1"));
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test1", value, NULL, KV_FPERSIST) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -34,7 +58,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test1", "val", 0, 0) == 0);
   printf("SUCCESS: Creating non-persist key func call\n");
-  assert(access("./test/tmp/test1", F_OK) == 0);
+  assert(TEMP_FILE_CREATED("./test/tmp/test1"));
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test1", value, NULL, 0) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -43,7 +67,7 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test3/test", "test3-1234", 0, 0) == 0);
   printf("SUCCESS: Creating non-persist key in subdirectory\n");
-  assert(access("./test/tmp/test3/test", F_OK) == 0);
+  assert(TEMP_FILE_CREATED("./test/tmp/test3/test"));
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test3/test", value, NULL, 0) == 0);
   printf("SUCCESS: Read of key succeeded!\n");
@@ -122,6 +146,171 @@ int main(int argc, char *argv[])
     printf("SUCCESS: Read and write using C++ interface.\n");
   }
 
+#ifndef KV_PERSIST_JOURNAL
+  {
+    constexpr auto key = "test6/cached";
+    kv::enable_cache();
+
+    kv::set(key, "one", kv::region::persist);
+    assert(kv::get(key, kv::region::persist) == "one");
+    assert(kv::get(key, kv::region::persist) == "one");
+    printf("SUCCESS: Read cached key.\n");
+
+    // Writes from other processes (or without the library) are seen.
+    assert(system("printf two > ./test/persist/test6/cached") == 0);
+    assert(kv::get(key, kv::region::persist) == "two");
+    printf("SUCCESS: Cached key revalidated after an external write.\n");
+
+    kv::set(key, "three", kv::region::persist);
+    assert(kv::get(key, kv::region::persist) == "three");
+    printf("SUCCESS: Cached key updated by set.\n");
+
+    assert(kv_del(key, KV_FPERSIST) == 0);
+    assert(kv_get(key, value, NULL, KV_FPERSIST) != 0);
+    assert(errno == ENOENT);
+    printf("SUCCESS: Cached key removed by del.\n");
+
+    kv::enable_cache(false);
+  }
+#endif
+
+  {
+    struct kv_set_entry sets[] = {
+      { "batch/a", "1", 0, 0 },
+      { "batch/b", "22", 0, 0 },
+      { "batch/a", "333", 0, 0 },
+    };
+    assert(kv_set_many(sets, 3, 0) == 0);
+    printf("SUCCESS: Batch set of keys.\n");
+
+    char va[MAX_VALUE_LEN], vb[MAX_VALUE_LEN], vc[MAX_VALUE_LEN];
+    struct kv_get_entry gets[] = {
+      { "batch/a", va, 0, 0 },
+      { "batch/missing", vc, 0, 0 },
+      { "batch/b", vb, 0, 0 },
+    };
+    errno = 0;
+    assert(kv_get_many(gets, 3, 0) != 0);
+    assert(errno == ENOENT);
+    assert(gets[0].error == 0 && gets[0].len == 3 && strcmp(va, "333") == 0);
+    assert(gets[1].error == ENOENT);
+    assert(gets[2].error == 0 && strcmp(vb, "22") == 0);
+    printf("SUCCESS: Batch get of keys with per-key results.\n");
+
+    auto errors = kv::set_many({{"batch/a", "x"}, {"batch/c", "y"}},
+        kv::region::temp, true);
+    assert(errors[0] == EEXIST && errors[1] == 0);
+    auto results = kv::get_many({"batch/a", "batch/c"});
+    assert(results[0].value == "333" && results[1].value == "y");
+    printf("SUCCESS: Batch set with create only creates new keys.\n");
+  }
+
+  {
+    kv::set("list/a", "1");
+    kv::set("list/sub/b", "2", kv::region::temp);
+    kv::set("lister", "3");
+    assert((kv::list("list/") ==
+            std::vector<std::string>{"list/a", "list/sub/b"}));
+    assert(kv::list("list").size() == 3);
+    assert(kv::list("none/").empty());
+    printf("SUCCESS: Listed keys by prefix.\n");
+
+    assert(!kv::try_get("list/missing"));
+    assert(kv::try_get("list/a") == "1");
+    printf("SUCCESS: Missing key lookup without exception.\n");
+  }
+
+  {
+    std::mutex m;
+    std::condition_variable cv;
+    std::set<std::string> seen;
+    auto changed = [&](const std::string& key) {
+      return [&, key] { return seen.count(key) != 0; };
+    };
+    auto w = kv::watch("watched/", [&](const std::string& key) {
+      std::lock_guard<std::mutex> lk(m);
+      seen.insert(key);
+      cv.notify_all();
+    });
+
+    // Too large for the shm backend, so these are files.
+    std::string v(100, 'w');
+    kv::set("watched/x", v);
+    kv::set("watched/new/y", v);
+    kv::set("unwatched", v);
+    std::unique_lock<std::mutex> lk(m);
+    assert(cv.wait_for(lk, std::chrono::seconds(5), changed("watched/x")));
+    assert(cv.wait_for(lk, std::chrono::seconds(5),
+                       changed("watched/new/y")));
+    printf("SUCCESS: Watch reported set keys.\n");
+
+    seen.clear();
+    lk.unlock();
+    kv::del("watched/x");
+    lk.lock();
+    assert(cv.wait_for(lk, std::chrono::seconds(5), changed("watched/x")));
+    assert(seen.count("unwatched") == 0);
+    printf("SUCCESS: Watch reported deleted key.\n");
+    lk.unlock();
+  }
+
+#ifdef KV_PERSIST_JOURNAL
+  {
+    constexpr auto key = "test9";
+    kv::set(key, "first", kv::region::persist);
+    assert(access("./test/persist/test9", F_OK) != 0);
+    assert(kv::get(key, kv::region::persist) == "first");
+    printf("SUCCESS: Persist write is journaled.\n");
+
+    // A crashed writer leaves a torn record behind.
+    assert(system("printf torn >> ./test/persist.journal") == 0);
+    assert(kv::get(key, kv::region::persist) == "first");
+    kv::set(key, "second", kv::region::persist);
+    assert(kv::get(key, kv::region::persist) == "second");
+    printf("SUCCESS: Torn journal record is dropped.\n");
+
+    // Fill the journal up to a compaction.
+    std::string v(200, 'v');
+    for (int i = 0; i < 400; i++) {
+      v[0] = 'a' + i % 26;
+      kv::set(key, v, kv::region::persist);
+    }
+    assert(access("./test/persist/test9", F_OK) == 0);
+    assert(kv::get(key, kv::region::persist) == v);
+    printf("SUCCESS: Journal compacted to the key files.\n");
+
+    assert(kv_del(key, KV_FPERSIST) == 0);
+    assert(kv_get(key, value, NULL, KV_FPERSIST) != 0);
+    printf("SUCCESS: Delete of journaled key.\n");
+  }
+#endif
+
+#ifdef KV_SHM_TEMP
+  {
+    std::string big(kv::max_len, 'b');
+    kv::set("test7", "small");
+    assert(access("./test/tmp/test7", F_OK) != 0);
+    kv::set("test7", big);
+    assert(access("./test/tmp/test7", F_OK) == 0);
+    assert(kv::get("test7") == big);
+    printf("SUCCESS: Oversized temp value falls back to a file.\n");
+
+    kv::set("test7", "small");
+    assert(kv::get("test7") == "small");
+    kv::del("test7");
+    assert(kv_get("test7", value, NULL, 0) != 0);
+    printf("SUCCESS: Deleted temp key from both backends.\n");
+
+    kv::set("test8_1", "1");
+    kv::set("test8_2", "2");
+    kv::del("test8_.*");
+    assert(kv_get("test8_1", value, NULL, 0) != 0);
+    assert(kv_get("test8_2", value, NULL, 0) != 0);
+    printf("SUCCESS: Deleted shm temp keys by regex.\n");
+  }
+  shm_unlink("/kv_temp_test");
+#endif
+
   assert(system("rm -rf ./test") == 0);
 
   return 0;
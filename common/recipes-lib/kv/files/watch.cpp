@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <poll.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <system_error>
+
+#include "watch.hpp"
+#include "log.hpp"
+
+namespace fs = std::filesystem;
+
+namespace kv
+{
+
+static constexpr uint32_t watch_mask =
+    IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+    IN_ONLYDIR;
+
+static bool has_prefix(const std::string& s, const std::string& prefix) {
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+Watch::Watch(const std::string& p, watch_callback c, region reg)
+    : prefix(p), cb(std::move(c)), root(FileHandle::store_path(reg)) {
+  fs::create_directories(root);
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "inotify_init1");
+  }
+  stop_fd = eventfd(0, EFD_CLOEXEC);
+  if (stop_fd < 0) {
+    int err = errno;
+    close(fd);
+    throw std::system_error(err, std::generic_category(), "eventfd");
+  }
+  add_tree("", false);
+  thread = std::thread([this] { run(); });
+}
+
+Watch::~Watch() {
+  uint64_t one = 1;
+  if (::write(stop_fd, &one, sizeof(one)) != sizeof(one)) {
+    KV_WARN("kv: could not stop the watch of %s: %d", prefix.c_str(), errno);
+  }
+  if (thread.joinable()) {
+    thread.join();
+  }
+  close(stop_fd);
+  close(fd);
+}
+
+bool Watch::relevant(const std::string& dir) const {
+  if (dir.empty()) {
+    return true;
+  }
+  // Either the prefix is below the directory, or the directory is below
+  // the prefix.
+  auto d = dir + "/";
+  auto n = std::min(d.size(), prefix.size());
+  return d.compare(0, n, prefix, 0, n) == 0;
+}
+
+void Watch::add_tree(const std::string& dir, bool report_keys) {
+  auto p = dir.empty() ? root : root / dir;
+  int wd = inotify_add_watch(fd, p.c_str(), watch_mask);
+  if (wd < 0) {
+    // Removed meanwhile, or out of watches.
+    KV_DEBUG("kv: could not watch %s: %d", p.c_str(), errno);
+    return;
+  }
+  dirs[wd] = dir;
+
+  std::error_code ec;
+  for (auto& entry : fs::directory_iterator(p, ec)) {
+    auto key = entry.path().string().substr(root.string().length() + 1);
+    if (entry.is_directory(ec)) {
+      if (relevant(key)) {
+        add_tree(key, report_keys);
+      }
+    } else if (report_keys) {
+      report(key);
+    }
+  }
+}
+
+void Watch::report(const std::string& key) {
+  if (!has_prefix(key, prefix)) {
+    return;
+  }
+  try {
+    cb(key);
+  } catch (std::exception& e) {
+    KV_WARN("kv: watch callback of %s failed: %s", key.c_str(), e.what());
+  }
+}
+
+void Watch::run() {
+  alignas(struct inotify_event) std::array<char, 4096> buf;
+  std::array<struct pollfd, 2> fds = {{
+    { fd, POLLIN, 0 },
+    { stop_fd, POLLIN, 0 },
+  }};
+
+  for (;;) {
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      KV_WARN("kv: watch of %s stopped, poll failed: %d",
+          prefix.c_str(), errno);
+      return;
+    }
+    if (fds[1].revents) {
+      return;
+    }
+
+    ssize_t len;
+    while ((len = ::read(fd, buf.data(), buf.size())) > 0) {
+      for (ssize_t pos = 0; pos < len;) {
+        auto ev = reinterpret_cast<struct inotify_event*>(&buf[pos]);
+        pos += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+          // Events were lost, report every key.
+          add_tree("", true);
+          continue;
+        }
+        auto it = dirs.find(ev->wd);
+        if (it == dirs.end()) {
+          continue;
+        }
+        if (ev->mask & IN_IGNORED) {
+          dirs.erase(it);
+          continue;
+        }
+        if (ev->len == 0) {
+          continue;
+        }
+
+        std::string name = ev->name;
+        auto key = it->second.empty() ? name : it->second + "/" + name;
+        if (ev->mask & IN_ISDIR) {
+          if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && relevant(key)) {
+            add_tree(key, true);
+          }
+        } else if (ev->mask & (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM |
+                               IN_MOVED_TO)) {
+          report(key);
+        }
+      }
+    }
+  }
+}
+
+} // namespace kv
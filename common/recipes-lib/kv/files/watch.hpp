@@ -0,0 +1,54 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "fileops.hpp"
+
+namespace kv
+{
+
+/* Watch of the keys of a region starting with a prefix, see kv::watch().
+ *
+ * An inotify watch is kept on every directory of the region which can
+ * hold such keys, directories created later included. A thread of the
+ * watch reads the events and calls back with the key of every file
+ * written, deleted or renamed.
+ *
+ * Only the key files are watched: keys held by the shm temp backend are
+ * not reported, and journaled persist keys are reported once compacted.
+ */
+class Watch : public watcher
+{
+  public:
+    Watch(const std::string& prefix, watch_callback cb, region r);
+    // Stops the thread, so it must not be called from the callback.
+    ~Watch() override;
+
+    Watch(const Watch&) = delete;
+    Watch& operator=(const Watch&) = delete;
+
+  private:
+    // Could the directory (relative to the region) hold watched keys.
+    bool relevant(const std::string& dir) const;
+    // Watch the directory and those below it. Keys already in a directory
+    // created since the parent was watched are reported.
+    void add_tree(const std::string& dir, bool report_keys);
+    void report(const std::string& key);
+    void run();
+
+    const std::string prefix;
+    const watch_callback cb;
+    const FileHandle::path root;
+    int fd = -1;
+    // Written to stop the thread.
+    int stop_fd = -1;
+    std::unordered_map<int, std::string> dirs{};
+    std::thread thread{};
+};
+
+} // namespace kv
@@ -27,6 +27,10 @@
 #include <time.h>
 #include <assert.h>
 #include <syslog.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <linux/limits.h>
@@ -75,6 +79,68 @@ static struct obmclog_desc my_ldesc = {
         .log_devices = LOG_DEV_STD_STREAM,
 };
 
+/*
+ * Asynchronous syslog, see obmc_log_set_async(): every thread formats
+ * its messages into a ring of its own, which only that thread fills and
+ * only the drain thread empties, so neither side takes a lock. The drain
+ * thread passes them to syslog(), folding consecutive copies of the same
+ * message and rate limiting the rest.
+ */
+#define ASYNC_RING_SIZE		32	/* messages, a power of 2 */
+#define ASYNC_POLL_MS		1000
+/* Repeats of a message are reported at least that often. */
+#define ASYNC_REPEAT_SEC	10
+/* Drops are reported at most that often. */
+#define ASYNC_REPORT_SEC	60
+
+struct async_msg {
+	int prio;
+	char text[LOG_BUF_MAX_SIZE];
+};
+
+struct async_ring {
+	uint32_t head;		/* next message, by the thread */
+	uint32_t tail;		/* next message, by the drain thread */
+	uint32_t dropped;	/* ring found full, by the thread */
+	uint32_t dropped_seen;	/* the part in async.stats */
+	int dead;		/* the thread exited */
+	struct async_ring *next;
+	struct async_msg msgs[ASYNC_RING_SIZE];
+};
+
+static struct {
+	/* Held to change the list of rings and the stats. */
+	pthread_mutex_t lock;
+	struct async_ring *rings;
+	pthread_once_t key_once;
+	pthread_key_t key;
+	pthread_t thread;
+	int efd;
+	int running;
+
+	/* Token bucket of the rate limit, rate 0 for none. */
+	unsigned rate;
+	unsigned burst;
+	double tokens;
+	struct timespec refill;
+
+	/* The last message, and the copies of it not written yet. */
+	int last_prio;
+	char last[LOG_BUF_MAX_SIZE];
+	unsigned repeats;
+	time_t repeat_since;
+
+	struct obmc_log_stats stats;
+	struct obmc_log_stats reported;
+	time_t report_time;
+} async = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.key_once = PTHREAD_ONCE_INIT,
+	.efd = -1,
+};
+
+static __thread struct async_ring *my_ring;
+
 int obmc_log_init(const char *ident, int min_prio, int options)
 {
 	if (ident == NULL || !IS_VALID_LOG_PRIO(min_prio)) {
@@ -168,7 +234,7 @@ int obmc_log_by_prio(int prio, const char *fmt, ...)
 	if (LOG_DEVICE_IS_SET(&my_ldesc, LOG_DEV_SYSLOG)) {
 		int sprio = LOG_MAKEPRI(my_ldesc.syslog_facility, prio);
 		va_copy(dup_vargs, vargs);
-		vsyslog(sprio, fmt, dup_vargs);
+		obmc_vsyslog(sprio, fmt, dup_vargs);
 		va_end(dup_vargs);
 	}
 
@@ -298,6 +364,273 @@ void obmc_log_unset_std_stream(void)
 	LOG_DEVICE_UNSET(&my_ldesc, LOG_DEV_STD_STREAM);
 }
 
+static void async_ring_release(void *arg)
+{
+	struct async_ring *ring = arg;
+
+	/* The drain thread frees it once it is empty. */
+	__atomic_store_n(&ring->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void async_key_create(void)
+{
+	pthread_key_create(&async.key, async_ring_release);
+}
+
+/* Ring of the calling thread, created on its first message. */
+static struct async_ring *async_get_ring(void)
+{
+	struct async_ring *ring = my_ring;
+
+	if (ring != NULL)
+		return ring;
+
+	pthread_once(&async.key_once, async_key_create);
+	ring = calloc(1, sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+	pthread_setspecific(async.key, ring);
+
+	pthread_mutex_lock(&async.lock);
+	ring->next = async.rings;
+	async.rings = ring;
+	pthread_mutex_unlock(&async.lock);
+	my_ring = ring;
+	return ring;
+}
+
+void obmc_vsyslog(int prio, const char *fmt, va_list vargs)
+{
+	struct async_ring *ring;
+	struct async_msg *msg;
+	uint32_t head, tail;
+	uint64_t one = 1;
+
+	if (!__atomic_load_n(&async.running, __ATOMIC_ACQUIRE) ||
+	    (ring = async_get_ring()) == NULL) {
+		vsyslog(prio, fmt, vargs);
+		return;
+	}
+
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= ASYNC_RING_SIZE) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	msg = &ring->msgs[head % ASYNC_RING_SIZE];
+	msg->prio = prio;
+	vsnprintf(msg->text, sizeof(msg->text), fmt, vargs);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	/* The drain thread may be waiting for it. */
+	if (head == tail && write(async.efd, &one, sizeof(one)) < 0) {
+		/* It polls anyway */
+	}
+}
+
+void obmc_syslog(int prio, const char *fmt, ...)
+{
+	va_list vargs;
+
+	va_start(vargs, fmt);
+	obmc_vsyslog(prio, fmt, vargs);
+	va_end(vargs);
+}
+
+static void async_flush_repeats(void)
+{
+	if (async.repeats > 0) {
+		syslog(async.last_prio, "message repeated %u times: [%s]",
+		       async.repeats, async.last);
+		async.repeats = 0;
+	}
+}
+
+/* Whether the rate limit lets a message through now. */
+static int async_rate_ok(int prio)
+{
+	struct timespec now;
+	double elapsed;
+
+	/* Critical messages are never held back. */
+	if (async.rate == 0 || LOG_PRI(prio) <= LOG_CRIT)
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = (now.tv_sec - async.refill.tv_sec) +
+		  (now.tv_nsec - async.refill.tv_nsec) / 1e9;
+	async.refill = now;
+	async.tokens += elapsed * async.rate;
+	if (async.tokens > async.burst)
+		async.tokens = async.burst;
+	if (async.tokens < 1)
+		return 0;
+	async.tokens -= 1;
+	return 1;
+}
+
+static void async_write(const struct async_msg *msg)
+{
+	time_t now = time(NULL);
+	int written = 0, repeated = 0, limited = 0;
+
+	if (msg->prio == async.last_prio && strcmp(msg->text, async.last) == 0) {
+		if (async.repeats++ == 0)
+			async.repeat_since = now;
+		repeated = 1;
+	} else {
+		async_flush_repeats();
+		if (async_rate_ok(msg->prio)) {
+			syslog(msg->prio, "%s", msg->text);
+			written = 1;
+		} else {
+			limited = 1;
+		}
+		async.last_prio = msg->prio;
+		strcpy(async.last, msg->text);
+	}
+
+	pthread_mutex_lock(&async.lock);
+	async.stats.queued++;
+	async.stats.written += written;
+	async.stats.repeated += repeated;
+	async.stats.rate_limited += limited;
+	pthread_mutex_unlock(&async.lock);
+}
+
+static void async_drain(void)
+{
+	struct async_ring *ring, *next, **prev;
+	uint32_t head, dropped;
+
+	/*
+	 * New rings are only added at the head of the list, and only this
+	 * thread removes them, so the list is walked unlocked.
+	 */
+	pthread_mutex_lock(&async.lock);
+	ring = async.rings;
+	pthread_mutex_unlock(&async.lock);
+	for (; ring != NULL; ring = next) {
+		next = ring->next;
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		while (ring->tail != head) {
+			async_write(&ring->msgs[ring->tail % ASYNC_RING_SIZE]);
+			__atomic_store_n(&ring->tail, ring->tail + 1,
+					 __ATOMIC_RELEASE);
+		}
+
+		pthread_mutex_lock(&async.lock);
+		dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+		async.stats.dropped += dropped - ring->dropped_seen;
+		ring->dropped_seen = dropped;
+		if (__atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE) &&
+		    ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+			for (prev = &async.rings; *prev != ring;
+			     prev = &(*prev)->next)
+				;
+			*prev = next;
+			free(ring);
+		}
+		pthread_mutex_unlock(&async.lock);
+	}
+}
+
+/* Log what was dropped lately, so that a storm leaves a trace. */
+static void async_report(void)
+{
+	time_t now = time(NULL);
+	uint64_t dropped, limited;
+
+	if (async.repeats > 0 && now - async.repeat_since >= ASYNC_REPEAT_SEC)
+		async_flush_repeats();
+	if (now - async.report_time < ASYNC_REPORT_SEC)
+		return;
+
+	pthread_mutex_lock(&async.lock);
+	dropped = async.stats.dropped - async.reported.dropped;
+	limited = async.stats.rate_limited - async.reported.rate_limited;
+	async.reported = async.stats;
+	pthread_mutex_unlock(&async.lock);
+	async.report_time = now;
+	if (dropped > 0 || limited > 0)
+		syslog(LOG_WARNING, "%llu log messages dropped, "
+		       "%llu rate limited",
+		       (unsigned long long)dropped,
+		       (unsigned long long)limited);
+}
+
+static void *async_main(void *arg)
+{
+	struct pollfd pfd = { .fd = async.efd, .events = POLLIN };
+	uint64_t cnt;
+
+	while (__atomic_load_n(&async.running, __ATOMIC_ACQUIRE)) {
+		if (poll(&pfd, 1, ASYNC_POLL_MS) > 0 &&
+		    read(async.efd, &cnt, sizeof(cnt)) < 0) {
+			/* Nothing to read, spurious wakeup */
+		}
+		async_drain();
+		async_report();
+	}
+	async_drain();
+	async_flush_repeats();
+	return NULL;
+}
+
+int obmc_log_set_async(unsigned rate, unsigned burst)
+{
+	if (__atomic_load_n(&async.running, __ATOMIC_ACQUIRE)) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	async.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (async.efd < 0)
+		return -1;
+	async.rate = rate;
+	async.burst = burst > 0 ? burst : 1;
+	async.tokens = async.burst;
+	clock_gettime(CLOCK_MONOTONIC, &async.refill);
+	async.report_time = time(NULL);
+
+	__atomic_store_n(&async.running, 1, __ATOMIC_RELEASE);
+	errno = pthread_create(&async.thread, NULL, async_main, NULL);
+	if (errno != 0) {
+		__atomic_store_n(&async.running, 0, __ATOMIC_RELEASE);
+		close(async.efd);
+		async.efd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+void obmc_log_unset_async(void)
+{
+	uint64_t one = 1;
+
+	if (!__atomic_load_n(&async.running, __ATOMIC_ACQUIRE))
+		return;
+
+	/*
+	 * Messages queued from now on are still drained before the thread
+	 * exits; the rings of the live threads are kept for a restart.
+	 */
+	__atomic_store_n(&async.running, 0, __ATOMIC_RELEASE);
+	if (write(async.efd, &one, sizeof(one)) < 0) {
+		/* It polls anyway */
+	}
+	pthread_join(async.thread, NULL);
+	close(async.efd);
+	async.efd = -1;
+}
+
+void obmc_log_get_stats(struct obmc_log_stats *stats)
+{
+	pthread_mutex_lock(&async.lock);
+	*stats = async.stats;
+	pthread_mutex_unlock(&async.lock);
+}
 
 #ifdef OBMC_LOG_UNITTEST
 
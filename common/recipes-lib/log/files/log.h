@@ -23,6 +23,8 @@ extern "C" {
 #endif
 
 #include <unistd.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -142,6 +144,50 @@ extern int obmc_log_set_std_stream(void);
  */
 extern void obmc_log_unset_std_stream(void);
 
+/*
+ * Hand syslog messages (of obmc_syslog() and obmc_log_by_prio()) to a
+ * background thread instead of writing them to /dev/log in the caller,
+ * which blocks whenever syslogd lags. Every thread queues into a ring
+ * of its own without taking a lock; a message is dropped (and counted)
+ * when the ring of its thread is full.
+ *
+ * Consecutive copies of a message are folded into one "message repeated"
+ * line. Other messages are limited to <rate> per second with bursts of
+ * <burst>, except those of LOG_CRIT and above; <rate> 0 for no limit.
+ * Dropped and rate limited messages are summed up in syslog once a
+ * minute.
+ *
+ * Returns:
+ *     0 for success, and -1 on failures.
+ */
+extern int obmc_log_set_async(unsigned rate, unsigned burst);
+
+/*
+ * Write the queued messages and go back to synchronous syslog. It's
+ * no-op if obmc_log_set_async() was never called.
+ */
+extern void obmc_log_unset_async(void);
+
+/*
+ * syslog() replacements, asynchronous after obmc_log_set_async() and the
+ * same as syslog() otherwise. They do not need obmc_log_init().
+ */
+extern void obmc_syslog(int prio, const char *fmt, ...)
+	__attribute__ ((__format__ (__printf__, 2, 3)));
+extern void obmc_vsyslog(int prio, const char *fmt, va_list vargs);
+
+/*
+ * Counters of the asynchronous syslog.
+ */
+struct obmc_log_stats {
+	uint64_t queued;	/* taken from the rings */
+	uint64_t written;	/* to syslogd */
+	uint64_t dropped;	/* the ring of the thread was full */
+	uint64_t rate_limited;
+	uint64_t repeated;	/* folded into "message repeated" */
+};
+extern void obmc_log_get_stats(struct obmc_log_stats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
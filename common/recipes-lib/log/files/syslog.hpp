@@ -2,6 +2,7 @@
 #define _SYSLOG_HPP_
 #include <syslog.h>
 #include <iostream>
+#include <openbmc/log.h>
 
 namespace openbmc {
 
@@ -12,7 +13,7 @@ class SysLogBuf : public std::basic_streambuf<char, std::char_traits<char>> {
  protected:
   int sync() {
     if (buffer_.length()) {
-      syslog(priority_, "%s", buffer_.c_str());
+      obmc_syslog(priority_, "%s", buffer_.c_str());
       buffer_.erase();
     }
     return 0;
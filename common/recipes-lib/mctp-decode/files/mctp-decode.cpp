@@ -0,0 +1,380 @@
+/*
+ * mctp-decode.cpp
+ *
+ * Copyright 2026-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "mctp-decode.hpp"
+
+namespace mctp_decode {
+
+#define MIN_MCTP_CTRL_LEN 2  // Byte1: IID, Byte2: Cmd (Byte3: Completion Code)
+#define MIN_PLDM_LEN 3       // Byte1: IID, Byte2: Type, Byte3: Cmd (Byte4: Completion Code)
+#define MIN_SPDM_LEN 2       // Byte1: Version, Byte2: Request/Response Code
+#define NCSI_RESP_CODES_LEN 4 // response code, reason code
+#define NCSI_RESP_BIT 0x80
+#define NCSI_REASON_UNKNOWN_CMD_TYPE 0x7FFF
+
+// NC-SI response code string
+static const char* ncsi_resp_string[] = {
+    "COMMAND_COMPLETED",
+    "COMMAND_FAILED",
+    "COMMAND_UNAVAILABLE",
+    "COMMAND_UNSUPPORTED",
+};
+
+// NC-SI reason code string
+static const char* ncsi_reason_string[] = {
+    "NO_ERROR",
+    "INTF_INIT_REQD",
+    "PARAM_INVALID",
+    "CHANNEL_NOT_RDY",
+    "PKG_NOT_RDY",
+    "INVALID_PAYLOAD_LEN",
+    "INFO_NOT_AVAIL",
+    "UNKNOWN_CMD_TYPE",
+};
+
+static uint16_t be16(bytes b, size_t off) {
+  return (uint16_t(b[off]) << 8) | b[off + 1];
+}
+
+// Rq[7], D[6], IID[4:0] of control and PLDM messages
+static void decode_rq_iid(uint8_t byte, message& msg) {
+  msg.request = (byte & 0x80) != 0;
+  msg.iid = byte & 0x1f;
+}
+
+static status decode_control(bytes body, message& msg) {
+  if (body.size() < MIN_MCTP_CTRL_LEN) {
+    return status::too_short;
+  }
+  decode_rq_iid(body[0], msg);
+  msg.command = body[1];
+  size_t hdr_len = MIN_MCTP_CTRL_LEN;
+  if (!msg.request) {
+    if (body.size() < hdr_len + 1) {
+      return status::too_short;
+    }
+    msg.has_cc = true;
+    msg.cc = body[hdr_len++];
+  }
+  msg.header = body.sub(0, hdr_len);
+  msg.data = body.sub(hdr_len);
+  return status::ok;
+}
+
+static status decode_pldm(bytes body, message& msg) {
+  if (body.size() < MIN_PLDM_LEN) {
+    return status::too_short;
+  }
+  decode_rq_iid(body[0], msg);
+  msg.pldm_type = body[1] & 0x3f;
+  msg.command = body[2];
+  size_t hdr_len = MIN_PLDM_LEN;
+  if (!msg.request) {
+    if (body.size() < hdr_len + 1) {
+      return status::too_short;
+    }
+    msg.has_cc = true;
+    msg.cc = body[hdr_len++];
+  }
+  msg.header = body.sub(0, hdr_len);
+  msg.data = body.sub(hdr_len);
+  return status::ok;
+}
+
+static status decode_ncsi(bytes body, message& msg) {
+  if (body.size() < MCTP_DECODE_NCSI_HDR_LEN) {
+    return status::too_short;
+  }
+  msg.iid = body[3];
+  msg.request = (body[4] & NCSI_RESP_BIT) == 0;
+  msg.command = body[4] & ~NCSI_RESP_BIT;
+  size_t hdr_len = MCTP_DECODE_NCSI_HDR_LEN;
+  if (!msg.request) {
+    if (body.size() < hdr_len + NCSI_RESP_CODES_LEN) {
+      return status::too_short;
+    }
+    msg.has_cc = true;
+    msg.cc = be16(body, hdr_len);
+    msg.reason = be16(body, hdr_len + 2);
+    hdr_len += NCSI_RESP_CODES_LEN;
+  }
+  msg.header = body.sub(0, hdr_len);
+  msg.data = body.sub(hdr_len);
+  return status::ok;
+}
+
+static status decode_spdm(bytes body, message& msg) {
+  if (body.size() < MIN_SPDM_LEN) {
+    return status::too_short;
+  }
+  // Request codes are 0x80 and up, their response codes the same less 0x80
+  msg.request = (body[1] & 0x80) != 0;
+  msg.command = body[1] & 0x7f;
+  msg.header = body.sub(0, MIN_SPDM_LEN);
+  msg.data = body.sub(MIN_SPDM_LEN);
+  return status::ok;
+}
+
+status decode(bytes raw, message& msg) {
+  msg = message();
+  msg.raw = raw;
+  if (raw.size() < MCTP_DECODE_TRANSPORT_LEN) {
+    msg.data = raw;
+    return msg.st = status::too_short;
+  }
+  msg.eid = raw[0];
+  msg.tag = raw[1];
+  msg.type = raw[2] & 0x7f;
+
+  bytes body = raw.sub(MCTP_DECODE_TRANSPORT_LEN);
+  switch (msg.type) {
+    case TYPE_CONTROL:
+      msg.st = decode_control(body, msg);
+      break;
+    case TYPE_PLDM:
+      msg.st = decode_pldm(body, msg);
+      break;
+    case TYPE_NCSI:
+      msg.st = decode_ncsi(body, msg);
+      break;
+    case TYPE_SPDM:
+      msg.st = decode_spdm(body, msg);
+      break;
+    default:
+      msg.st = status::unknown_type;
+      break;
+  }
+  if (msg.st != status::ok) {
+    msg.header = bytes();
+    msg.data = body;
+    msg.has_cc = false;
+  }
+  return msg.st;
+}
+
+const char* type_name(uint8_t type) {
+  switch (type) {
+    case TYPE_CONTROL:
+      return "MCTP control";
+    case TYPE_PLDM:
+      return "PLDM";
+    case TYPE_NCSI:
+      return "NC-SI";
+    case TYPE_ETHERNET:
+      return "Ethernet";
+    case TYPE_NVME:
+      return "NVMe-MI";
+    case TYPE_SPDM:
+      return "SPDM";
+    default:
+      return "unknown";
+  }
+}
+
+const char* ncsi_response_name(uint16_t code) {
+  if (code >= sizeof(ncsi_resp_string) / sizeof(ncsi_resp_string[0])) {
+    return "unknown_response";
+  }
+  return ncsi_resp_string[code];
+}
+
+const char* ncsi_reason_name(uint16_t code) {
+  if (code == NCSI_REASON_UNKNOWN_CMD_TYPE) {
+    return "UNKNOWN_CMD_TYPE";
+  }
+  if (code >= sizeof(ncsi_reason_string) / sizeof(ncsi_reason_string[0])) {
+    return "unknown_reason";
+  }
+  return ncsi_reason_string[code];
+}
+
+static void print_bytes(FILE* fp, bytes b) {
+  for (uint8_t byte : b) {
+    fprintf(fp, "%02x ", byte);
+  }
+  fprintf(fp, "\n");
+}
+
+void print(FILE* fp, const message& msg) {
+  const char* kind = msg.request ? "request" : "response";
+
+  if (msg.raw.size() < MCTP_DECODE_TRANSPORT_LEN) {
+    fprintf(fp, "Invalid MCTP msg length (%zu)\n", msg.raw.size());
+    return;
+  }
+  fprintf(fp, "\nMCTP transport header: src_eid(%02x) tag(%02x)\n", msg.eid,
+          msg.tag);
+  fprintf(fp, "MCTP header:           msg_type(%02x)\n\n", msg.type);
+
+  if (msg.st == status::unknown_type) {
+    fprintf(fp, "unknown MCTP type %x\n", msg.type);
+    return;
+  }
+  if (msg.st == status::too_short) {
+    fprintf(fp, "Invalid %s msg length (%zu)\n", type_name(msg.type),
+            msg.raw.size() - MCTP_DECODE_TRANSPORT_LEN);
+    return;
+  }
+
+  const bytes& hdr = msg.header;
+  switch (msg.type) {
+    case TYPE_CONTROL:
+      fprintf(fp, "MCTP control message\n");
+      fprintf(fp, "  Rq[7],D[6],IID[4:0]: %02x\n", hdr[0]);
+      fprintf(fp, "  Command Code:        %02x\n", msg.command);
+      if (msg.has_cc) {
+        fprintf(fp, "  Completion Code:     %02x\n", msg.cc);
+      }
+      fprintf(fp, "  %s data:%*s", kind, msg.request ? 8 : 7, "");
+      break;
+    case TYPE_PLDM:
+      fprintf(fp, "PLDM message\n");
+      fprintf(fp, "  Rq[7],D[6],IID[4:0]:  %02x\n", hdr[0]);
+      fprintf(fp, "  Hdr[7:6],Type[5:0]:   %02x\n", hdr[1]);
+      fprintf(fp, "  PLDM Command Code:    %02x\n", msg.command);
+      if (msg.has_cc) {
+        fprintf(fp, "  PLDM Completion Code: %02x\n", msg.cc);
+      }
+      fprintf(fp, "  %s data:%*s", kind, msg.request ? 9 : 8, "");
+      break;
+    case TYPE_NCSI:
+      fprintf(fp, "NCSI control message\n");
+      fprintf(fp, "  NCSI header:\n");
+      fprintf(fp,
+              "    MC ID(%02x), Header Revision(%02x), Rsv(%02x), IID(%02x), "
+              "Packet Type(%02x), Channel(%02x), Payload Length(%02x)\n",
+              hdr[0], hdr[1], hdr[2], hdr[3], hdr[4], hdr[5], be16(hdr, 6));
+      if (msg.has_cc) {
+        fprintf(fp, "  Response: %s(0x%04x)\n", ncsi_response_name(msg.cc),
+                msg.cc);
+        fprintf(fp, "  Reason:   %s(0x%04x)\n", ncsi_reason_name(msg.reason),
+                msg.reason);
+      }
+      fprintf(fp, "  Payload       : ");
+      break;
+    case TYPE_SPDM:
+      fprintf(fp, "SPDM message\n");
+      fprintf(fp, "  SPDM Version:       %02x\n", hdr[0]);
+      fprintf(fp, "  Req/Rsp Code:       %02x\n", hdr[1]);
+      fprintf(fp, "  %s data:%*s", kind, msg.request ? 7 : 6, "");
+      break;
+  }
+  print_bytes(fp, msg.data);
+}
+
+std::string summary(const message& msg) {
+  char buf[128];
+  int len;
+
+  if (msg.st == status::unknown_type) {
+    snprintf(buf, sizeof(buf), "eid %02x type %02x (%s) len %zu", msg.eid,
+             msg.type, type_name(msg.type), msg.raw.size());
+    return buf;
+  }
+  if (msg.st == status::too_short) {
+    snprintf(buf, sizeof(buf), "eid %02x %s too short (%zu)", msg.eid,
+             type_name(msg.type), msg.raw.size());
+    return buf;
+  }
+  len = snprintf(buf, sizeof(buf), "eid %02x %s ", msg.eid,
+                 type_name(msg.type));
+  if (msg.type == TYPE_PLDM) {
+    len += snprintf(buf + len, sizeof(buf) - len, "type %02x ",
+                    msg.pldm_type);
+  }
+  len += snprintf(buf + len, sizeof(buf) - len, "cmd %02x %s", msg.command,
+                  msg.request ? "req" : "rsp");
+  if (msg.type != TYPE_SPDM) {
+    len += snprintf(buf + len, sizeof(buf) - len, " iid %02x", msg.iid);
+  }
+  if (msg.has_cc && msg.type == TYPE_NCSI) {
+    len += snprintf(buf + len, sizeof(buf) - len, " resp %04x reason %04x",
+                    msg.cc, msg.reason);
+  } else if (msg.has_cc) {
+    len += snprintf(buf + len, sizeof(buf) - len, " cc %02x", msg.cc);
+  }
+  snprintf(buf + len, sizeof(buf) - len, " len %zu", msg.data.size());
+  return buf;
+}
+
+bool latency_tracker::add(const message& msg, double ts, double& latency) {
+  if (msg.st != status::ok) {
+    return false;
+  }
+  uint64_t key = pending_key(msg);
+  if (msg.request) {
+    // A request sent again before a response: the first one went unanswered
+    auto res = pending_.emplace(key, ts);
+    if (!res.second) {
+      stats_[command_key(msg)].unanswered++;
+      res.first->second = ts;
+    }
+    return false;
+  }
+
+  auto it = pending_.find(key);
+  if (it == pending_.end()) {
+    return false;
+  }
+  latency = ts - it->second;
+  pending_.erase(it);
+
+  stats& s = stats_[command_key(msg)];
+  if (s.count == 0 || latency < s.min) {
+    s.min = latency;
+  }
+  if (s.count == 0 || latency > s.max) {
+    s.max = latency;
+  }
+  s.total += latency;
+  s.count++;
+  return true;
+}
+
+void latency_tracker::finish() {
+  for (auto& it : pending_) {
+    stats_[uint32_t(it.first >> 8)].unanswered++;
+  }
+  pending_.clear();
+}
+
+void latency_tracker::print_stats(FILE* fp) const {
+  fprintf(fp, "%-14s %-5s %-4s %8s %10s %10s %10s %10s\n", "type", "ptype",
+          "cmd", "count", "unanswered", "min(ms)", "avg(ms)", "max(ms)");
+  for (auto& it : stats_) {
+    const stats& s = it.second;
+    uint8_t type = it.first >> 16;
+    char ptype[8] = "-";
+    if (type == TYPE_PLDM) {
+      snprintf(ptype, sizeof(ptype), "%02x", (it.first >> 8) & 0xff);
+    }
+    fprintf(fp, "%-14s %-5s %02x   %8llu %10llu", type_name(type), ptype,
+            it.first & 0xff, (unsigned long long)s.count,
+            (unsigned long long)s.unanswered);
+    if (s.count > 0) {
+      fprintf(fp, " %10.3f %10.3f %10.3f\n", s.min * 1000,
+              s.total / s.count * 1000, s.max * 1000);
+    } else {
+      fprintf(fp, " %10s %10s %10s\n", "-", "-", "-");
+    }
+  }
+}
+
+} // namespace mctp_decode
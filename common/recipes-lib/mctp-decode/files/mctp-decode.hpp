@@ -0,0 +1,175 @@
+/*
+ * mctp-decode.hpp
+ *
+ * Copyright 2026-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Decoder of MCTP messages (control, PLDM, NC-SI, SPDM) as they are sent
+ * and received through libobmc-mctp: "<eid> <tag> <type> <body>". The
+ * decoded message points into the bytes decoded, nothing is copied.
+ */
+namespace mctp_decode {
+
+// Bytes of a message, not owned
+class bytes {
+ public:
+  constexpr bytes() = default;
+  constexpr bytes(const uint8_t* data, size_t size)
+      : data_(data), size_(size) {}
+
+  const uint8_t* data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  uint8_t operator[](size_t i) const {
+    return data_[i];
+  }
+  const uint8_t* begin() const {
+    return data_;
+  }
+  const uint8_t* end() const {
+    return data_ + size_;
+  }
+
+  // At most len bytes from off, none past the end
+  bytes sub(size_t off, size_t len = SIZE_MAX) const {
+    if (off >= size_) {
+      return bytes();
+    }
+    return bytes(data_ + off, (len < size_ - off) ? len : size_ - off);
+  }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// MCTP message types (DSP0239)
+enum : uint8_t {
+  TYPE_CONTROL = 0x0,
+  TYPE_PLDM = 0x1,
+  TYPE_NCSI = 0x2,
+  TYPE_ETHERNET = 0x3,
+  TYPE_NVME = 0x4,
+  TYPE_SPDM = 0x5,
+};
+
+#define MCTP_DECODE_TRANSPORT_LEN 3 // EID, tag, message type
+#define MCTP_DECODE_NCSI_HDR_LEN 16
+
+enum class status {
+  ok,
+  too_short,    // shorter than the header of its type
+  unknown_type, // only the transport header is decoded
+};
+
+struct message {
+  uint8_t eid = 0;       // of the other endpoint
+  uint8_t tag = 0;       // TO[3], tag[2:0]
+  uint8_t type = 0;      // integrity check bit masked
+  bool request = false;
+  uint8_t iid = 0;       // instance id, but for SPDM
+  uint8_t pldm_type = 0; // PLDM only
+  uint8_t command = 0;   // NC-SI: packet type, SPDM: request/response code
+  bool has_cc = false;   // a response with its completion code
+  uint16_t cc = 0;       // NC-SI: response code
+  uint16_t reason = 0;   // NC-SI only
+  bytes header;          // message header, completion code(s) included
+  bytes data;            // past the header
+  bytes raw;
+  status st = status::too_short;
+};
+
+/*
+ * Decodes raw into msg. A message too short for its header, or of a type
+ * without a decoder, keeps the fields of the transport header and all
+ * of its body in data.
+ */
+status decode(bytes raw, message& msg);
+
+const char* type_name(uint8_t type);
+const char* ncsi_response_name(uint16_t code);
+const char* ncsi_reason_name(uint16_t code);
+
+// Prints the fields of msg, a line for every one of them
+void print(FILE* fp, const message& msg);
+
+// One line summary of msg: type, command, instance id, completion code
+std::string summary(const message& msg);
+
+/*
+ * Pairs the responses of a stream of messages with their requests, by
+ * endpoint, type, command and instance id, and keeps the latencies of
+ * every command.
+ */
+class latency_tracker {
+ public:
+  struct stats {
+    uint64_t count = 0;      // responses paired
+    uint64_t unanswered = 0; // requests without a response
+    double min = 0;
+    double max = 0;
+    double total = 0;
+  };
+
+  // Command of the stats: type, PLDM type, command
+  static uint32_t command_key(const message& msg) {
+    return (uint32_t(msg.type) << 16) | (uint32_t(msg.pldm_type) << 8) |
+           msg.command;
+  }
+
+  /*
+   * Adds msg seen at time ts (seconds). Returns true with the latency
+   * (seconds) for a response to a pending request.
+   */
+  bool add(const message& msg, double ts, double& latency);
+
+  // Counts the requests still pending as unanswered
+  void finish();
+
+  const std::map<uint32_t, stats>& get_stats() const {
+    return stats_;
+  }
+
+  // A line per command: count, unanswered, min/avg/max latency in ms
+  void print_stats(FILE* fp) const;
+
+ private:
+  static uint64_t pending_key(const message& msg) {
+    return (uint64_t(msg.eid) << 40) | (uint64_t(command_key(msg)) << 8) |
+           msg.iid;
+  }
+
+  std::unordered_map<uint64_t, double> pending_;
+  std::map<uint32_t, stats> stats_;
+};
+
+} // namespace mctp_decode
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <gtest/gtest.h>
+#include "../mctp-decode.hpp"
+
+using namespace mctp_decode;
+
+TEST(MctpDecodeTest, PldmRequestResponse) {
+  // GetTID request, and its response with TID 1
+  const uint8_t req[] = {0x08, 0x08, 0x01, 0x85, 0x00, 0x02};
+  const uint8_t rsp[] = {0x08, 0x00, 0x01, 0x05, 0x00, 0x02, 0x00, 0x01};
+  message msg;
+
+  ASSERT_EQ(decode(bytes(req, sizeof(req)), msg), status::ok);
+  EXPECT_TRUE(msg.request);
+  EXPECT_EQ(msg.iid, 5);
+  EXPECT_EQ(msg.pldm_type, 0);
+  EXPECT_EQ(msg.command, 2);
+  EXPECT_FALSE(msg.has_cc);
+  EXPECT_TRUE(msg.data.empty());
+
+  ASSERT_EQ(decode(bytes(rsp, sizeof(rsp)), msg), status::ok);
+  EXPECT_FALSE(msg.request);
+  EXPECT_TRUE(msg.has_cc);
+  EXPECT_EQ(msg.cc, 0);
+  // The data is a view of the response
+  EXPECT_EQ(msg.data.data(), rsp + 7);
+  EXPECT_EQ(msg.data.size(), 1);
+  EXPECT_EQ(summary(msg), "eid 08 PLDM type 00 cmd 02 rsp iid 05 cc 00 len 1");
+}
+
+TEST(MctpDecodeTest, NcsiResponse) {
+  uint8_t rsp[MCTP_DECODE_TRANSPORT_LEN + MCTP_DECODE_NCSI_HDR_LEN + 6] = {
+      0x08, 0x00, 0x02};
+  uint8_t* ncsi = rsp + MCTP_DECODE_TRANSPORT_LEN;
+  ncsi[3] = 0x11;              // IID
+  ncsi[4] = 0x50 | 0x80;       // OEM command response
+  ncsi[16] = 0x00;             // COMMAND_FAILED
+  ncsi[17] = 0x01;
+  ncsi[18] = 0x7f;             // UNKNOWN_CMD_TYPE
+  ncsi[19] = 0xff;
+  message msg;
+
+  ASSERT_EQ(decode(bytes(rsp, sizeof(rsp)), msg), status::ok);
+  EXPECT_FALSE(msg.request);
+  EXPECT_EQ(msg.iid, 0x11);
+  EXPECT_EQ(msg.command, 0x50);
+  EXPECT_EQ(msg.cc, 1);
+  EXPECT_EQ(msg.reason, 0x7fff);
+  EXPECT_STREQ(ncsi_response_name(msg.cc), "COMMAND_FAILED");
+  EXPECT_STREQ(ncsi_reason_name(msg.reason), "UNKNOWN_CMD_TYPE");
+  EXPECT_EQ(msg.data.size(), 2);
+}
+
+TEST(MctpDecodeTest, ShortAndUnknown) {
+  const uint8_t ctrl[] = {0x08, 0x00, 0x00, 0x01, 0x02};
+  const uint8_t nvme[] = {0x08, 0x00, 0x84, 0x01, 0x02};
+  message msg;
+
+  // A control response without its completion code
+  EXPECT_EQ(decode(bytes(ctrl, sizeof(ctrl)), msg), status::too_short);
+  EXPECT_EQ(msg.data.size(), 2);
+  EXPECT_EQ(decode(bytes(ctrl, 2), msg), status::too_short);
+
+  // Integrity check bit masked
+  EXPECT_EQ(decode(bytes(nvme, sizeof(nvme)), msg), status::unknown_type);
+  EXPECT_EQ(msg.type, TYPE_NVME);
+  EXPECT_EQ(msg.data.size(), 2);
+}
+
+TEST(MctpDecodeTest, LatencyPairing) {
+  const uint8_t req[] = {0x08, 0x08, 0x01, 0x85, 0x00, 0x02};
+  const uint8_t rsp[] = {0x08, 0x00, 0x01, 0x05, 0x00, 0x02, 0x00, 0x01};
+  const uint8_t other[] = {0x08, 0x00, 0x01, 0x06, 0x00, 0x02, 0x00, 0x01};
+  latency_tracker tracker;
+  message msg;
+  double latency = 0;
+
+  decode(bytes(req, sizeof(req)), msg);
+  EXPECT_FALSE(tracker.add(msg, 1.0, latency));
+  // Another instance id is not the response
+  decode(bytes(other, sizeof(other)), msg);
+  EXPECT_FALSE(tracker.add(msg, 1.001, latency));
+  decode(bytes(rsp, sizeof(rsp)), msg);
+  ASSERT_TRUE(tracker.add(msg, 1.004, latency));
+  EXPECT_NEAR(latency, 0.004, 1e-9);
+  // Answered already
+  EXPECT_FALSE(tracker.add(msg, 1.005, latency));
+
+  decode(bytes(req, sizeof(req)), msg);
+  tracker.add(msg, 2.0, latency);
+  tracker.add(msg, 3.0, latency);
+  tracker.finish();
+
+  auto& stats = tracker.get_stats();
+  ASSERT_EQ(stats.size(), 1);
+  auto& s = stats.at(latency_tracker::command_key(msg));
+  EXPECT_EQ(s.count, 1);
+  EXPECT_EQ(s.unanswered, 2);
+  EXPECT_NEAR(s.max, 0.004, 1e-9);
+}
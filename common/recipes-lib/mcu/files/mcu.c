@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
@@ -47,6 +48,12 @@
 
 #define IPMB_WRITE_COUNT_MAX 224
 
+// The bootloader answers 0x00 in place of the ack/nack till a command is done
+#define MCU_ACK_NOT_READY 0x00
+#define MCU_ACK_POLL_MS 2
+#define MCU_DOWNLOAD_TIMEOUT_MS 3000
+#define MCU_CMD_TIMEOUT_MS 500
+
 #define CMD_OEM_GET_BOOTLOADER_VER 0x40
 
 #define EN_UPDATE_IF_I2C 0x01
@@ -135,6 +142,55 @@ mcu_get_fw_ver(uint8_t bus, uint8_t addr, uint8_t comp, uint8_t *ver) {
   return ret;
 }
 
+static long long
+mcu_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Reads the rcount bytes response of the last command, polling till the
+// bootloader has it or timeout_ms passed
+static int
+mcu_poll_ack(int ifd, uint8_t addr, uint8_t *rbuf, uint8_t rcount, int timeout_ms) {
+  long long deadline = mcu_now_ms() + timeout_ms;
+  int rc;
+
+  while (1) {
+    rc = i2c_rdwr_msg_transfer(ifd, addr, NULL, 0, rbuf, rcount);
+    if ((!rc && rbuf[1] != MCU_ACK_NOT_READY) || mcu_now_ms() >= deadline) {
+      return rc;
+    }
+    msleep(MCU_ACK_POLL_MS);
+  }
+}
+
+// Sends the command in tbuf and reads its rcount bytes response. With
+// *combined, the response is read in the same I2C_RDWR transaction and
+// only polled for if it was not ready yet. A failed combined transaction
+// turns *combined off: the command went out if its response comes.
+static int
+mcu_cmd_ack(int ifd, uint8_t addr, uint8_t *tbuf, uint8_t tcount,
+            uint8_t *rbuf, uint8_t rcount, int timeout_ms, bool *combined) {
+  memset(rbuf, 0, rcount);
+  if (combined && *combined) {
+    if (!i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount)) {
+      if (rbuf[1] != MCU_ACK_NOT_READY) {
+        return 0;
+      }
+    } else {
+      syslog(LOG_WARNING, "%s: combined write/read not supported on addr 0x%02x",
+             __func__, addr);
+      *combined = false;
+    }
+  } else if (i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, 0)) {
+    return -1;
+  }
+
+  return mcu_poll_ack(ifd, addr, rbuf, rcount, timeout_ms);
+}
+
 static int
 mcu_enable_update(uint8_t bus, uint8_t addr) {
   uint8_t tbuf[8] = {0x15, 0xA0, 0x00};
@@ -165,6 +221,8 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
   FILE *fp;
   struct stat buf;
   struct rlimit mqlim;
+  bool combined = true;
+  long long start_ms, elapsed_ms;
 
   fd = open(path, O_RDONLY, 0666);
   if (fd < 0) {
@@ -285,22 +343,12 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
     tbuf[1] += tbuf[i];
   }
 
+  // The flash is erased before the ack, don't read in the same transaction
   tcount = CMD_DOWNLOAD_SIZE;
-  rcount = 0;
-  rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
-  if (rc) {
-    printf("i2c_rdwr_msg_transfer failed download\n");
-    goto error_exit;
-  }
-
-  // Delay for download command process
-  msleep(500);
-
-  tcount = 0;
   rcount = 2;
-  rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
+  rc = mcu_cmd_ack(ifd, addr, tbuf, tcount, rbuf, rcount, MCU_DOWNLOAD_TIMEOUT_MS, NULL);
   if (rc) {
-    printf("i2c_rdwr_msg_transfer failed download ack\n");
+    printf("i2c_rdwr_msg_transfer failed download\n");
     goto error_exit;
   }
 
@@ -310,6 +358,7 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
   }
 
   // Loop to send all the image data
+  start_ms = mcu_now_ms();
   while (1) {
     // Get Status
     tbuf[0] = CMD_STATUS_SIZE;
@@ -317,18 +366,10 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
     tbuf[2] = MCU_CMD_STATUS;
 
     tcount = CMD_STATUS_SIZE;
-    rcount = 0;
-    rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
-    if (rc) {
-      printf("i2c_rdwr_msg_transfer failed get status\n");
-      goto error_exit;
-    }
-
-    tcount = 0;
     rcount = 5;
-    rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
+    rc = mcu_cmd_ack(ifd, addr, tbuf, tcount, rbuf, rcount, MCU_CMD_TIMEOUT_MS, &combined);
     if (rc) {
-      printf("i2c_rdwr_msg_transfer failed get status ack\n");
+      printf("i2c_rdwr_msg_transfer failed get status\n");
       goto error_exit;
     }
 
@@ -385,19 +426,10 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
     }
 
     tcount = tbuf[0];
-    rcount = 0;
-    rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
-    if (rc) {
-      printf("i2c_rdwr_msg_transfer failed send data\n");
-      goto error_exit;
-    }
-
-    msleep(10);
-    tcount = 0;
     rcount = 2;
-    rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
+    rc = mcu_cmd_ack(ifd, addr, tbuf, tcount, rbuf, rcount, MCU_CMD_TIMEOUT_MS, &combined);
     if (rc) {
-      printf("i2c_rdwr_msg_transfer failed send data ack\n");
+      printf("i2c_rdwr_msg_transfer failed send data\n");
       goto error_exit;
     }
 
@@ -407,6 +439,12 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
     }
   }
 
+  elapsed_ms = mcu_now_ms() - start_ms;
+  printf("\rupdated fw: 100 %%, %u bytes in %lld ms (%lld bytes/s)\n", offset, elapsed_ms,
+         elapsed_ms ? offset * 1000LL / elapsed_ms : (long long)offset);
+  syslog(LOG_INFO, "%s: bus %d addr 0x%02x, %u bytes in %lld ms", __func__, bus, addr,
+         offset, elapsed_ms);
+
   // Run the new image
   tbuf[0] = CMD_RUN_SIZE;
   tbuf[1] = MCU_CMD_RUN; //checksum
@@ -421,18 +459,10 @@ mcu_update_firmware(uint8_t bus, uint8_t addr, const char *path, const char *key
   }
 
   tcount = CMD_RUN_SIZE;
-  rcount = 0;
-  rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
-  if (rc) {
-    printf("i2c_rdwr_msg_transfer failed for run\n");
-    goto error_exit;
-  }
-
-  tcount = 0;
   rcount = 2;
-  rc = i2c_rdwr_msg_transfer(ifd, addr, tbuf, tcount, rbuf, rcount);
+  rc = mcu_cmd_ack(ifd, addr, tbuf, tcount, rbuf, rcount, MCU_CMD_TIMEOUT_MS, NULL);
   if (rc) {
-    printf("i2c_rdwr_msg_transfer failed run ack\n");
+    printf("i2c_rdwr_msg_transfer failed for run\n");
     goto error_exit;
   }
 
@@ -2,6 +2,7 @@
 #define _PROFILING_HPP_
 #include <chrono>
 #include <iostream>
+#include "trace.hpp"
 
 namespace openbmc {
 
@@ -11,10 +12,12 @@ class Profile {
   std::chrono::time_point<std::chrono::high_resolution_clock> start =
       std::chrono::high_resolution_clock::now();
   std::ostream& dump;
+  // The scope is also traced, see trace.hpp
+  trace::Scope scope;
 
  public:
   explicit Profile(const std::string& desc, std::ostream& os = std::cout)
-      : descriptor(desc), dump(os) {}
+      : descriptor(desc), dump(os), scope(desc) {}
   ~Profile() {
     auto stop = std::chrono::high_resolution_clock::now();
     auto dur = std::chrono::duration_cast<milli>(stop - start);
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../trace.hpp"
+
+using namespace std::literals;
+using namespace openbmc::trace;
+
+static const ShmScope* findScope(const std::vector<ShmScope>& scopes,
+                                 const std::string& name) {
+  for (auto& s : scopes) {
+    if (name == s.name) {
+      return &s;
+    }
+  }
+  return nullptr;
+}
+
+TEST(TraceTest, Bucket) {
+  ASSERT_EQ(bucketOf(0), 0);
+  ASSERT_EQ(bucketOf(1), 0);
+  ASSERT_EQ(bucketOf(2), 1);
+  ASSERT_EQ(bucketOf(1023), 9);
+  ASSERT_EQ(bucketOf(1024), 10);
+  ASSERT_EQ(bucketOf(UINT64_MAX), kBuckets - 1);
+}
+
+TEST(TraceTest, ScopeId) {
+  uint32_t id = scopeId("test::same");
+  ASSERT_EQ(scopeId("test::same"), id);
+  ASSERT_NE(scopeId("test::other"), id);
+}
+
+TEST(TraceTest, Histogram) {
+  reset();
+  for (int i = 0; i < 3; i++) {
+    TRACE_SCOPE("test::sleep");
+    std::this_thread::sleep_for(2ms);
+  }
+  std::vector<ShmScope> scopes;
+  std::vector<ShmEvent> events;
+  Registry::get().snapshot(scopes, events);
+  const ShmScope* s = findScope(scopes, "test::sleep");
+  ASSERT_NE(s, nullptr);
+  ASSERT_EQ(s->count, 3);
+  ASSERT_GE(s->totalNs, 6000000);
+  ASSERT_GE(s->maxNs, 2000000);
+  uint64_t sum = 0;
+  for (auto b : s->buckets) {
+    sum += b;
+  }
+  ASSERT_EQ(sum, 3);
+  // 2 ms is in [2^20, 2^21) ns at best
+  ASSERT_EQ(s->buckets[0], 0);
+}
+
+TEST(TraceTest, Nesting) {
+  reset();
+  {
+    TRACE_SCOPE("test::outer");
+    { TRACE_SCOPE("test::inner"); }
+  }
+  std::vector<ShmScope> scopes;
+  std::vector<ShmEvent> events;
+  Registry::get().snapshot(scopes, events);
+  ASSERT_EQ(events.size(), 2);
+  // inner completes first
+  ASSERT_STREQ(scopes[events[0].scope].name, "test::inner");
+  ASSERT_EQ(events[0].depth, 1);
+  ASSERT_STREQ(scopes[events[1].scope].name, "test::outer");
+  ASSERT_EQ(events[1].depth, 0);
+  ASSERT_GE(events[0].startNs, events[1].startNs);
+  ASSERT_LE(events[0].durNs, events[1].durNs);
+}
+
+TEST(TraceTest, Threads) {
+  reset();
+  std::vector<std::thread> threads;
+  std::atomic<int> done{0};
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&done]() {
+      for (int i = 0; i < 1000; i++) {
+        TRACE_SCOPE("test::thread");
+      }
+      // keep the ring until all the threads are done
+      done++;
+      while (done < 4) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::vector<ShmScope> scopes;
+  std::vector<ShmEvent> events;
+  Registry::get().snapshot(scopes, events);
+  const ShmScope* s = findScope(scopes, "test::thread");
+  ASSERT_NE(s, nullptr);
+  ASSERT_EQ(s->count, 4000);
+  // every thread keeps its last kRingSize events
+  ASSERT_EQ(events.size(), 4 * kRingSize);
+}
+
+TEST(TraceTest, Disabled) {
+  reset();
+  setEnabled(false);
+  { TRACE_SCOPE("test::disabled"); }
+  setEnabled(true);
+  std::vector<ShmScope> scopes;
+  std::vector<ShmEvent> events;
+  Registry::get().snapshot(scopes, events);
+  const ShmScope* s = findScope(scopes, "test::disabled");
+  ASSERT_NE(s, nullptr);
+  ASSERT_EQ(s->count, 0);
+  ASSERT_EQ(events.size(), 0);
+}
+
+TEST(TraceTest, Export) {
+  reset();
+  { TRACE_SCOPE("test::export"); }
+  std::string name = "test-" + std::to_string(getpid());
+  ASSERT_EQ(exportShm(name), 0);
+
+  FILE* fp = fopen(shmPath(name).c_str(), "r");
+  ASSERT_NE(fp, nullptr);
+  ShmHeader hdr;
+  ASSERT_EQ(fread(&hdr, sizeof(hdr), 1, fp), 1);
+  fclose(fp);
+  unlink(shmPath(name).c_str());
+  ASSERT_EQ(hdr.magic, kShmMagic);
+  ASSERT_EQ(hdr.version, kShmVersion);
+  ASSERT_EQ(hdr.pid, uint32_t(getpid()));
+  ASSERT_EQ(hdr.numEvents, 1);
+  ASSERT_GE(hdr.numScopes, 1);
+}
@@ -0,0 +1,392 @@
+#ifndef _TRACE_HPP_
+#define _TRACE_HPP_
+/*--------------------------------------------------------
+ * FACILITY: TRACE
+ * DESCRIPTION: Low overhead scope tracing, cheap enough to
+ * stay enabled in production.
+ *
+ * - Every named scope has a latency histogram with log2
+ *   buckets of nanoseconds (bucket i counts durations in
+ *   [2^i, 2^(i+1)) ns), updated with relaxed atomics.
+ * - Every thread records its scopes (start, duration and
+ *   nesting depth) in its own ring of kRingSize events,
+ *   written without locks by the thread only.
+ * - exportShm() writes a snapshot of the histograms and of
+ *   the rings to /dev/shm/obmc-trace-<name>, which trace-util
+ *   dumps or converts to Chrome trace JSON.
+ *
+ * EXAMPLE:
+ * void poll() {
+ *   TRACE_SCOPE("modbus::poll");
+ *   ...
+ * }
+ * openbmc::trace::startExporter("rackmond", std::chrono::seconds(10));
+ *
+ * A scope name is registered once (with a lock), the scope
+ * itself only takes two clock reads and a few atomic adds.
+ */
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace openbmc {
+namespace trace {
+
+constexpr size_t kNameLen = 48;
+constexpr size_t kBuckets = 40; // 2^40 ns is about 18 minutes
+constexpr size_t kMaxScopes = 128;
+constexpr size_t kMaxThreads = 16;
+constexpr size_t kRingSize = 256;
+constexpr uint32_t kInvalidScope = UINT32_MAX;
+
+/*
+ * Layout of the exported snapshot: a ShmHeader, numScopes ShmScope
+ * and numEvents ShmEvent.
+ */
+constexpr uint32_t kShmMagic = 0x54524345; // "TRCE"
+constexpr uint32_t kShmVersion = 1;
+constexpr const char* kShmDir = "/dev/shm";
+constexpr const char* kShmPrefix = "obmc-trace-";
+
+struct ShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pid;
+  uint32_t numScopes;
+  uint32_t numEvents;
+  uint32_t reserved;
+  uint64_t exportNs;
+};
+
+struct ShmScope {
+  char name[kNameLen];
+  uint64_t count;
+  uint64_t totalNs;
+  uint64_t maxNs;
+  uint64_t buckets[kBuckets];
+};
+
+struct ShmEvent {
+  uint32_t scope;
+  uint32_t tid;
+  uint32_t depth;
+  uint32_t reserved;
+  uint64_t startNs;
+  uint64_t durNs;
+};
+
+// CLOCK_MONOTONIC in nanoseconds
+inline uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+inline size_t bucketOf(uint64_t ns) {
+  if (ns == 0) {
+    return 0;
+  }
+  size_t b = 63 - __builtin_clzll(ns);
+  return b < kBuckets ? b : kBuckets - 1;
+}
+
+struct Histogram {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> totalNs{0};
+  std::atomic<uint64_t> maxNs{0};
+  std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+
+  void record(uint64_t ns) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(ns, std::memory_order_relaxed);
+    buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = maxNs.load(std::memory_order_relaxed);
+    while (ns > max &&
+           !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+struct Event {
+  uint32_t scope;
+  uint32_t tid; // a ring is reused once its thread exits
+  uint32_t depth;
+  uint64_t startNs;
+  uint64_t durNs;
+};
+
+// Ring of the events of a thread, written by the thread only.
+struct ThreadRing {
+  uint32_t tid = 0;
+  uint32_t depth = 0;
+  std::atomic<bool> inUse{false};
+  std::atomic<uint64_t> head{0}; // number of events written
+  std::array<Event, kRingSize> events{};
+
+  void push(uint32_t scope, uint32_t d, uint64_t start, uint64_t dur) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    events[h % kRingSize] = {scope, tid, d, start, dur};
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+class Registry {
+  std::mutex lock_{};
+  std::unordered_map<std::string, uint32_t> ids_{};
+  std::vector<std::string> names_{};
+  std::array<Histogram, kMaxScopes> hists_{};
+  std::array<ThreadRing, kMaxThreads> rings_{};
+  std::atomic<bool> enabled_{true};
+
+  struct RingHolder {
+    ThreadRing* ring = nullptr;
+    ~RingHolder() {
+      if (ring != nullptr) {
+        ring->inUse.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  ThreadRing* claimRing() {
+    for (auto& ring : rings_) {
+      bool expected = false;
+      if (ring.inUse.compare_exchange_strong(expected, true)) {
+        ring.tid = uint32_t(syscall(SYS_gettid));
+        ring.depth = 0;
+        return &ring;
+      }
+    }
+    return nullptr;
+  }
+
+ public:
+  static Registry& get() {
+    static Registry registry;
+    return registry;
+  }
+
+  bool enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  void setEnabled(bool enable) {
+    enabled_.store(enable, std::memory_order_relaxed);
+  }
+
+  // ID of a scope name (truncated to kNameLen - 1), or kInvalidScope
+  // once kMaxScopes names are registered.
+  uint32_t scopeId(const std::string& name) {
+    std::string key = name.substr(0, kNameLen - 1);
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = ids_.find(key);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    if (names_.size() >= kMaxScopes) {
+      return kInvalidScope;
+    }
+    uint32_t id = uint32_t(names_.size());
+    names_.push_back(key);
+    ids_.emplace(key, id);
+    return id;
+  }
+
+  // Ring of the calling thread, or nullptr when all are used.
+  ThreadRing* ring() {
+    static thread_local RingHolder holder;
+    if (holder.ring == nullptr) {
+      holder.ring = claimRing();
+    }
+    return holder.ring;
+  }
+
+  void record(uint32_t id, uint32_t depth, uint64_t start, uint64_t dur) {
+    if (id >= kMaxScopes) {
+      return;
+    }
+    hists_[id].record(dur);
+    if (ThreadRing* r = ring()) {
+      r->push(id, depth, start, dur);
+    }
+  }
+
+  // Copy the histograms and the events of all the threads.
+  void snapshot(std::vector<ShmScope>& scopes, std::vector<ShmEvent>& events) {
+    size_t numNames;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      numNames = names_.size();
+      scopes.assign(numNames, ShmScope{});
+      for (size_t i = 0; i < numNames; i++) {
+        snprintf(scopes[i].name, kNameLen, "%s", names_[i].c_str());
+      }
+    }
+    for (size_t i = 0; i < numNames; i++) {
+      auto& h = hists_[i];
+      scopes[i].count = h.count.load(std::memory_order_relaxed);
+      scopes[i].totalNs = h.totalNs.load(std::memory_order_relaxed);
+      scopes[i].maxNs = h.maxNs.load(std::memory_order_relaxed);
+      for (size_t b = 0; b < kBuckets; b++) {
+        scopes[i].buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+      }
+    }
+
+    events.clear();
+    for (auto& r : rings_) {
+      uint64_t head = r.head.load(std::memory_order_acquire);
+      uint64_t first = head > kRingSize ? head - kRingSize : 0;
+      size_t start = events.size();
+      for (uint64_t i = first; i < head; i++) {
+        const Event& e = r.events[i % kRingSize];
+        if (e.scope < numNames) {
+          events.push_back({e.scope, e.tid, e.depth, 0, e.startNs, e.durNs});
+        }
+      }
+      // Drop the events the thread overwrote while they were copied.
+      uint64_t after = r.head.load(std::memory_order_acquire);
+      if (after - first > kRingSize) {
+        size_t lost = std::min<uint64_t>(after - first - kRingSize,
+                                         events.size() - start);
+        events.erase(events.begin() + start, events.begin() + start + lost);
+      }
+    }
+  }
+
+  void reset() {
+    for (auto& h : hists_) {
+      h.count = 0;
+      h.totalNs = 0;
+      h.maxNs = 0;
+      for (auto& b : h.buckets) {
+        b = 0;
+      }
+    }
+    for (auto& r : rings_) {
+      r.head.store(0, std::memory_order_release);
+    }
+  }
+};
+
+inline uint32_t scopeId(const std::string& name) {
+  return Registry::get().scopeId(name);
+}
+
+inline void setEnabled(bool enable) {
+  Registry::get().setEnabled(enable);
+}
+
+inline void reset() {
+  Registry::get().reset();
+}
+
+// RAII scope: records its duration on destruction.
+class Scope {
+  uint32_t id_;
+  uint32_t depth_ = 0;
+  uint64_t start_ = 0;
+  ThreadRing* ring_ = nullptr;
+
+ public:
+  explicit Scope(uint32_t id) : id_(id) {
+    Registry& reg = Registry::get();
+    if (id_ == kInvalidScope || !reg.enabled()) {
+      id_ = kInvalidScope;
+      return;
+    }
+    ring_ = reg.ring();
+    if (ring_ != nullptr) {
+      depth_ = ring_->depth++;
+    }
+    start_ = nowNs();
+  }
+  explicit Scope(const std::string& name) : Scope(scopeId(name)) {}
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+  ~Scope() {
+    if (id_ == kInvalidScope) {
+      return;
+    }
+    uint64_t dur = nowNs() - start_;
+    if (ring_ != nullptr) {
+      ring_->depth--;
+    }
+    Registry::get().record(id_, depth_, start_, dur);
+  }
+};
+
+inline std::string shmPath(const std::string& name) {
+  return std::string(kShmDir) + "/" + kShmPrefix + name;
+}
+
+/*
+ * Write a snapshot to /dev/shm/obmc-trace-<name>. The file is replaced
+ * atomically, so a reader never sees a partial snapshot.
+ *
+ * Return 0 for success, -1 on failures.
+ */
+inline int exportShm(const std::string& name) {
+  std::vector<ShmScope> scopes;
+  std::vector<ShmEvent> events;
+  Registry::get().snapshot(scopes, events);
+
+  ShmHeader hdr{};
+  hdr.magic = kShmMagic;
+  hdr.version = kShmVersion;
+  hdr.pid = uint32_t(getpid());
+  hdr.numScopes = uint32_t(scopes.size());
+  hdr.numEvents = uint32_t(events.size());
+  hdr.exportNs = nowNs();
+
+  std::string path = shmPath(name);
+  std::string tmp = path + ".tmp";
+  FILE* fp = fopen(tmp.c_str(), "w");
+  if (fp == nullptr) {
+    return -1;
+  }
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+      fwrite(scopes.data(), sizeof(ShmScope), scopes.size(), fp) ==
+          scopes.size() &&
+      fwrite(events.data(), sizeof(ShmEvent), events.size(), fp) ==
+          events.size();
+  if (fclose(fp) != 0 || !ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+// Export every <period> from a detached thread, for daemons.
+inline void startExporter(const std::string& name,
+                          std::chrono::seconds period) {
+  std::thread([name, period]() {
+    while (true) {
+      std::this_thread::sleep_for(period);
+      exportShm(name);
+    }
+  }).detach();
+}
+
+} // namespace trace
+} // namespace openbmc
+
+#define _TRACE_CONCAT2(a, b) a##b
+#define _TRACE_CONCAT(a, b) _TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name)                                   \
+  static const uint32_t _TRACE_CONCAT(_trace_id_, __LINE__) = \
+      openbmc::trace::scopeId(name);                        \
+  openbmc::trace::Scope _TRACE_CONCAT(_trace_scope_, __LINE__)( \
+      _TRACE_CONCAT(_trace_id_, __LINE__))
+
+#endif
@@ -24,6 +24,9 @@
 #include <errno.h>
 #include <syslog.h>
 #include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <net/if.h>
 #include <openbmc/ncsi.h>
 #include <netlink/genl/genl.h>
@@ -41,6 +44,42 @@
 
 #define RECVMSG_TIMEOUT 3
 
+// Genl IDs of NCSI, resolved once per process (a failure is not kept, the
+// driver may come later).
+static pthread_mutex_t ncsi_ids_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ncsi_family_id = -1;
+static int ncsi_aen_group_id = -1;
+
+static int ncsi_resolve_ids(struct nl_sock *sk, int *family, int *aen_group)
+{
+	int rc = 0;
+
+	pthread_mutex_lock(&ncsi_ids_lock);
+	if (ncsi_family_id < 0) {
+		ncsi_family_id = genl_ctrl_resolve(sk, "NCSI");
+		if (ncsi_family_id < 0) {
+			syslog(LOG_ERR, "Could not resolve NCSI\n");
+			rc = ncsi_family_id;
+			ncsi_family_id = -1;
+		}
+	}
+	if (!rc && aen_group && ncsi_aen_group_id < 0) {
+		ncsi_aen_group_id = genl_ctrl_resolve_grp(sk, "NCSI", NCSI_GENL_AEN_MCGROUP);
+		if (ncsi_aen_group_id < 0) {
+			syslog(LOG_ERR, "Could not resolve AEN MC group. err %d\n", ncsi_aen_group_id);
+			rc = ncsi_aen_group_id;
+			ncsi_aen_group_id = -1;
+		}
+	}
+	if (!rc) {
+		*family = ncsi_family_id;
+		if (aen_group)
+			*aen_group = ncsi_aen_group_id;
+	}
+	pthread_mutex_unlock(&ncsi_ids_lock);
+	return rc;
+}
+
 
 // re-used from
 // https://github.com/sammj/ncsi-netlink
@@ -125,18 +164,9 @@ int setup_ncsi_mc_socket(struct nl_sock **sk, unsigned char *dst)
 		goto err;
 	}
 
-	id = genl_ctrl_resolve(*sk, "NCSI");
-	if (id < 0) {
-		syslog(LOG_ERR, "Could not resolve NCSI\n");
-		goto err;
-	}
-
-	// resolve AEN MC group and add to socket
-	mcgroup = genl_ctrl_resolve_grp(*sk, "NCSI", NCSI_GENL_AEN_MCGROUP);
-    if (mcgroup < 0) {
-        syslog(LOG_ERR, "Could not resolve AEN MC group. err %d\n", mcgroup);
+	// resolve NCSI and its AEN MC group, add the group to socket
+	if (ncsi_resolve_ids(*sk, &id, &mcgroup))
 		goto err;
-	}
 
     rc = nl_socket_add_memberships(*sk, mcgroup, 0);
     if (rc) {
@@ -176,12 +206,9 @@ int setup_ncsi_message(struct ncsi_msg *msg, int cmd, int flags)
 		goto out;
 	}
 
-	id = genl_ctrl_resolve(msg->sk, "NCSI");
-	if (id < 0) {
-		syslog(LOG_ERR, "Could not resolve NCSI\n");
-		rc = id;
+	rc = ncsi_resolve_ids(msg->sk, &id, NULL);
+	if (rc)
 		goto out;
-	}
 
 	msg->msg = nlmsg_alloc();
 	if (!msg->msg) {
@@ -210,13 +237,13 @@ out:
 }
 
 
-static int send_cb(struct nl_msg *msg, void *arg)
+// Copies the NC-SI response of msg into rsp
+static int ncsi_parse_rsp(struct nl_msg *msg, NCSI_NL_RSP_T *rsp)
 {
 	struct nlmsghdr *hdr = nlmsg_hdr(msg);
 	struct nlattr *tb[NCSI_ATTR_MAX + 1] = {0};
 	int rc, data_len, len;
 	char *ncsi_rsp;
-	struct ncsi_msg *ncsi_msg = (struct ncsi_msg *)arg;
 
 	static struct nla_policy ncsi_genl_policy[NCSI_ATTR_MAX + 1] = {
 		[NCSI_ATTR_IFINDEX] =      { .type = NLA_U32 },
@@ -229,7 +256,6 @@ static int send_cb(struct nl_msg *msg, void *arg)
 		[NCSI_ATTR_CHANNEL_MASK] = { .type = NLA_U32 },
 	};
 
-	DBG_PRINT("%s called\n", __FUNCTION__);
 	rc = genlmsg_parse(hdr, 0, tb, NCSI_ATTR_MAX, ncsi_genl_policy);
 	DBG_PRINT("%s rc = %d\n", __FUNCTION__, rc);
 	if (rc) {
@@ -238,6 +264,7 @@ static int send_cb(struct nl_msg *msg, void *arg)
 	}
 
 	if (!tb[NCSI_ATTR_DATA]) {
+		// The kernel answers a timed out command without data
 		syslog(LOG_ERR, "null data attribute\n");
 		errno = EFAULT;
 		return -1;
@@ -252,26 +279,25 @@ static int send_cb(struct nl_msg *msg, void *arg)
 
 	/* len includes payload + checksum + FCS */
 	len = data_len - sizeof(CTRL_MSG_HDR_t);
-	if (len > sizeof(ncsi_msg->rsp->msg_payload)) {
-		len = sizeof(ncsi_msg->rsp->msg_payload);
+	if (len > sizeof(rsp->msg_payload)) {
+		len = sizeof(rsp->msg_payload);
 	}
 
 	ncsi_rsp = nla_data(tb[NCSI_ATTR_DATA]);
 	// parse the first 16 bytes of NCSI response (the header area) to get
 	//  payload length
 	CTRL_MSG_HDR_t *pNcsiHdr = (CTRL_MSG_HDR_t *)(void*)(ncsi_rsp);
-	ncsi_msg->rsp->hdr.payload_length = ntohs(pNcsiHdr->Payload_Length);
+	rsp->hdr.payload_length = ntohs(pNcsiHdr->Payload_Length);
 
 	// copy NC-SI response, skip NCSI header bytes
-	memcpy(ncsi_msg->rsp->msg_payload, (void*)(ncsi_rsp + sizeof(CTRL_MSG_HDR_t)),
+	memcpy(rsp->msg_payload, (void*)(ncsi_rsp + sizeof(CTRL_MSG_HDR_t)),
 	       len);
 
 #ifdef DEBUG_LIBNL
 	int i = 0;
 	DBG_PRINT("%s, data len %d\n", __FUNCTION__, data_len);
-  DBG_PRINT("%s, NCSI Response len %d\n", __FUNCTION__, ncsi_msg->rsp->hdr.payload_length);
+  DBG_PRINT("%s, NCSI Response len %d\n", __FUNCTION__, rsp->hdr.payload_length);
 	DBG_PRINT("payload:\n");
-	ncsi_rsp = nla_data(tb[NCSI_ATTR_DATA]);
 
 	for (i = 0; i < data_len; ++i) {
 		DBG_PRINT("0x%x ", *(ncsi_rsp+i));
@@ -279,106 +305,262 @@ static int send_cb(struct nl_msg *msg, void *arg)
 	DBG_PRINT("\n");
 #endif
 
-	// indicating callback has been completed
-	ncsi_msg->ret = 0;
 	return 0;
 }
 
-
-int run_command_send(int ifindex, NCSI_NL_MSG_T *nl_msg, NCSI_NL_RSP_T *rsp)
+// A command waiting for its response
+struct ncsi_nl_pending {
+	struct ncsi_nl_pending *next;
+	uint32_t seq;
+	NCSI_NL_RSP_T *rsp;
+	int done;
+	int err;
+};
+
+// One socket for all the commands of the process. The commands are sent
+// under lock, and one of the waiting threads at a time receives for all
+// of them (the responses are matched by sequence number), so any number
+// of commands, to any package/channel, may be outstanding.
+struct ncsi_nl_ctx {
+	struct nl_sock *sk;
+	int family;
+	pid_t pid;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int receiving;
+	struct ncsi_nl_pending *pending;
+};
+
+// Pending command seq, called with ctx->lock held
+static struct ncsi_nl_pending *ctx_find_pending(struct ncsi_nl_ctx *ctx, uint32_t seq)
 {
-	struct ncsi_msg msg;
-	struct ncsi_pkt_hdr *hdr = {0};
-	int rc = 0;
-	int payload_len = nl_msg->payload_length;
-	int package = (nl_msg->channel_id & 0xE0) >> 5;
-	uint8_t *pData, *pCtrlPktPayload;
-	struct timeval tv = {RECVMSG_TIMEOUT, 0};
-
-	// allocate a  contiguous buffer space to hold ncsi message
-	//  (header + Control Packet payload)
-	pData = calloc(1, sizeof(struct ncsi_pkt_hdr) + payload_len);
-	if (!pData) {
-		syslog(LOG_ERR, "Failed to allocate buffer for control packet, %m\n");
-		goto out;
-	}
-	// prepare buffer to be copied to netlink msg
-	hdr = (struct ncsi_pkt_hdr *)pData;
-	pCtrlPktPayload = pData + sizeof(struct ncsi_pkt_hdr);
-	memcpy(pCtrlPktPayload, nl_msg->msg_payload, payload_len);
+	struct ncsi_nl_pending *p;
 
-	rc = setup_ncsi_message(&msg, NCSI_CMD_SEND_CMD, 0);
-	if (rc)
-		return -1;
+	for (p = ctx->pending; p; p = p->next) {
+		if (p->seq == seq && !p->done)
+			return p;
+	}
+	return NULL;
+}
 
-	nl_msg->channel_id &= 0x1F;
-	DBG_PRINT("send cmd, ifindex %d, package %d, channel %d, cmd 0x%x\n",
-			ifindex, package, nl_msg->channel_id, nl_msg->cmd);
+static int ctx_valid_cb(struct nl_msg *msg, void *arg)
+{
+	struct ncsi_nl_ctx *ctx = (struct ncsi_nl_ctx *)arg;
+	struct ncsi_nl_pending *p;
+
+	pthread_mutex_lock(&ctx->lock);
+	p = ctx_find_pending(ctx, nlmsg_hdr(msg)->nlmsg_seq);
+	if (p) {
+		p->err = ncsi_parse_rsp(msg, p->rsp) ? -1 : 0;
+		p->done = 1;
+		pthread_cond_broadcast(&ctx->cond);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return NL_OK;
+}
 
-	msg.rsp = rsp;
-	msg.rsp->hdr.cmd = nl_msg->cmd;
+static int ctx_err_cb(struct sockaddr_nl *nla, struct nlmsgerr *err, void *arg)
+{
+	struct ncsi_nl_ctx *ctx = (struct ncsi_nl_ctx *)arg;
+	struct ncsi_nl_pending *p;
+
+	pthread_mutex_lock(&ctx->lock);
+	p = ctx_find_pending(ctx, err->msg.nlmsg_seq);
+	if (p && err->error) {
+		syslog(LOG_ERR, "NC-SI command failed, %s\n", strerror(-err->error));
+		p->err = err->error;
+		p->done = 1;
+		pthread_cond_broadcast(&ctx->cond);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return NL_SKIP;
+}
 
-	rc = nla_put_u32(msg.msg, NCSI_ATTR_IFINDEX, ifindex);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add ifindex, %m\n");
-		goto out;
+ncsi_nl_ctx_t *ncsi_nl_ctx_open(void)
+{
+	struct ncsi_nl_ctx *ctx;
+	pthread_condattr_t attr;
+	struct timeval tv = {1, 0};
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		syslog(LOG_ERR, "Failed to allocate NC-SI netlink context\n");
+		return NULL;
 	}
+	ctx->sk = nl_socket_alloc();
+	if (!ctx->sk) {
+		syslog(LOG_ERR, "Could not alloc socket\n");
+		free(ctx);
+		return NULL;
+	}
+	if (genl_connect(ctx->sk)) {
+		syslog(LOG_ERR, "genl_connect() failed\n");
+		goto err;
+	}
+	if (ncsi_resolve_ids(ctx->sk, &ctx->family, NULL))
+		goto err;
 
-	if (package >= 0) {
-		rc = nla_put_u32(msg.msg, NCSI_ATTR_PACKAGE_ID, package);
-		if (rc) {
-			syslog(LOG_ERR, "Failed to add package id, %m\n");
-			goto out;
-		}
+	// Responses come in any order, they are matched in ctx_valid_cb
+	nl_socket_disable_seq_check(ctx->sk);
+	if (nl_socket_modify_cb(ctx->sk, NL_CB_VALID, NL_CB_CUSTOM, ctx_valid_cb, ctx) ||
+	    nl_socket_modify_err_cb(ctx->sk, NL_CB_CUSTOM, ctx_err_cb, ctx)) {
+		syslog(LOG_ERR, "Failed to modify callback function\n");
+		goto err;
+	}
+	// The receiving thread gets back to check its deadline
+	if (setsockopt(nl_socket_get_fd(ctx->sk), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
+		syslog(LOG_ERR, "Failed to set SO_RCVTIMEO for receiving message");
 	}
 
-	rc = nla_put_u32(msg.msg, NCSI_ATTR_CHANNEL_ID, nl_msg->channel_id);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add channel, %m\n");
+	pthread_mutex_init(&ctx->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ctx->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	ctx->pid = getpid();
+	return ctx;
+
+err:
+	nl_socket_free(ctx->sk);
+	free(ctx);
+	return NULL;
+}
+
+void ncsi_nl_ctx_close(ncsi_nl_ctx_t *ctx)
+{
+	if (!ctx)
+		return;
+	nl_socket_free(ctx->sk);
+	pthread_cond_destroy(&ctx->cond);
+	pthread_mutex_destroy(&ctx->lock);
+	free(ctx);
+}
+
+static struct nl_msg *ncsi_build_send_cmd(int family, int ifindex, NCSI_NL_MSG_T *nl_msg)
+{
+	struct nl_msg *msg;
+	struct nlattr *attr;
+	struct ncsi_pkt_hdr *hdr;
+	int payload_len = nl_msg->payload_length;
+	int package = (nl_msg->channel_id & 0xE0) >> 5;
+	int channel = nl_msg->channel_id & 0x1F;
+	uint8_t *pData;
+
+	msg = nlmsg_alloc();
+	if (!msg) {
+		syslog(LOG_ERR, "Failed to allocate message\n");
+		return NULL;
+	}
+	if (!genlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, family, 0, 0,
+			 NCSI_CMD_SEND_CMD, 0)) {
+		syslog(LOG_ERR, "Failed to create header\n");
+		goto err;
 	}
 
+	DBG_PRINT("send cmd, ifindex %d, package %d, channel %d, cmd 0x%x\n",
+			ifindex, package, channel, nl_msg->cmd);
 
-	hdr->type = nl_msg->cmd;
-	hdr->length = htons(payload_len);  // NC-SI command payload length
-	rc = nla_put(msg.msg, NCSI_ATTR_DATA,
-		sizeof(struct ncsi_pkt_hdr) + payload_len, (void *)pData);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to add opcode, %m\n");
+	if (nla_put_u32(msg, NCSI_ATTR_IFINDEX, ifindex) ||
+	    nla_put_u32(msg, NCSI_ATTR_PACKAGE_ID, package) ||
+	    nla_put_u32(msg, NCSI_ATTR_CHANNEL_ID, channel)) {
+		syslog(LOG_ERR, "Failed to add ifindex/package/channel, %m\n");
+		goto err;
 	}
-	nl_socket_disable_seq_check(msg.sk);
-	rc = nl_socket_modify_cb(msg.sk, NL_CB_VALID, NL_CB_CUSTOM, send_cb, &msg);
-	if (rc) {
-		syslog(LOG_ERR, "Failed to modify callback function, %m\n");
-		goto out;
+
+	// the ncsi message (header + Control Packet payload) is built
+	// in place in the netlink msg
+	attr = nla_reserve(msg, NCSI_ATTR_DATA,
+			   sizeof(struct ncsi_pkt_hdr) + payload_len);
+	if (!attr) {
+		syslog(LOG_ERR, "Failed to add opcode, %m\n");
+		goto err;
 	}
+	pData = nla_data(attr);
+	memset(pData, 0, sizeof(struct ncsi_pkt_hdr));
+	hdr = (struct ncsi_pkt_hdr *)pData;
+	hdr->type = nl_msg->cmd;
+	hdr->length = htons(payload_len);  // NC-SI command payload length
+	memcpy(pData + sizeof(struct ncsi_pkt_hdr), nl_msg->msg_payload, payload_len);
+	return msg;
+
+err:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+int ncsi_nl_ctx_send_cmd(ncsi_nl_ctx_t *ctx, int ifindex, NCSI_NL_MSG_T *nl_msg,
+			 NCSI_NL_RSP_T *rsp)
+{
+	struct ncsi_nl_pending p = {0};
+	struct ncsi_nl_pending **pp;
+	struct nl_msg *msg;
+	struct timespec now, deadline, wait;
+	int rc;
+
+	msg = ncsi_build_send_cmd(ctx->family, ifindex, nl_msg);
+	if (!msg)
+		return -1;
+	p.rsp = rsp;
+	rsp->hdr.cmd = nl_msg->cmd;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += RECVMSG_TIMEOUT;
 
-	rc = nl_send_auto(msg.sk, msg.msg);
+	pthread_mutex_lock(&ctx->lock);
+	rc = nl_send_auto(ctx->sk, msg);
 	if (rc < 0) {
-		syslog(LOG_ERR, "Failed to send message, %m\n");
-		goto out;
+		pthread_mutex_unlock(&ctx->lock);
+		syslog(LOG_ERR, "Failed to send message, %s\n", nl_geterror(rc));
+		nlmsg_free(msg);
+		return -1;
 	}
-
-	while (msg.ret == 1) {
-		if (setsockopt(nl_socket_get_fd(msg.sk), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
-			syslog(LOG_ERR, "Failed to set SO_RCVTIMEO for receiving message");
+	p.seq = nlmsg_hdr(msg)->nlmsg_seq;
+	nlmsg_free(msg);
+	p.next = ctx->pending;
+	ctx->pending = &p;
+
+	while (!p.done) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec > deadline.tv_sec ||
+		    (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) {
+			syslog(LOG_ERR, "Timed out waiting for the NC-SI response, cmd 0x%x\n",
+			       nl_msg->cmd);
+			p.err = -1;
+			break;
 		}
-		rc = nl_recvmsgs_default(msg.sk);
-		DBG_PRINT("%s, rc = %d\n", __FUNCTION__, rc);
-		if (rc) {
-			syslog(LOG_ERR, "Failed to receive message, rc=%d %m\n", rc);
-			goto out;
+		if (!ctx->receiving) {
+			// Receive for everyone till our response is in
+			ctx->receiving = 1;
+			pthread_mutex_unlock(&ctx->lock);
+			rc = nl_recvmsgs_default(ctx->sk);
+			pthread_mutex_lock(&ctx->lock);
+			ctx->receiving = 0;
+			pthread_cond_broadcast(&ctx->cond);
+			if (rc && rc != -NLE_AGAIN) {
+				DBG_PRINT("%s, rc = %d\n", __FUNCTION__, rc);
+				syslog(LOG_ERR, "Failed to receive message, rc=%d %s\n", rc,
+				       nl_geterror(rc));
+			}
+		} else {
+			// Another thread receives, wake up when it is done or
+			// our response came, at the latest after a second
+			wait = now;
+			wait.tv_sec += 1;
+			pthread_cond_timedwait(&ctx->cond, &ctx->lock, &wait);
 		}
 	}
 
-out:
-	free_ncsi_msg(&msg);
-	if (pData)
-		free(pData);
-	return rc;
+	for (pp = &ctx->pending; *pp; pp = &(*pp)->next) {
+		if (*pp == &p) {
+			*pp = p.next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return p.err ? -1 : 0;
 }
 
-// Sending data to kernel via netlink libnl
-NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg)
+NCSI_NL_RSP_T *ncsi_nl_ctx_send(ncsi_nl_ctx_t *ctx, NCSI_NL_MSG_T *nl_msg)
 {
   NCSI_NL_RSP_T *ret_buf = NULL;
   unsigned int ifindex = 0;  // network interface (e.g. eth0)'s ifindex
@@ -392,17 +574,54 @@ NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg)
 
   ret_buf = calloc(1, sizeof(NCSI_NL_RSP_T));
   if (!ret_buf) {
-    syslog(LOG_ERR, "Failed to allocate rspbuf %d  %m\n", sizeof(NCSI_NL_RSP_T));
+    syslog(LOG_ERR, "Failed to allocate rspbuf %zu  %m\n", sizeof(NCSI_NL_RSP_T));
     return NULL;
   }
 
-  if (run_command_send(ifindex, nl_msg, ret_buf)) {
-	syslog(LOG_ERR, "run cmd send failed");
+  if (ncsi_nl_ctx_send_cmd(ctx, ifindex, nl_msg, ret_buf)) {
+    syslog(LOG_ERR, "run cmd send failed");
     free(ret_buf);
     return NULL;
-  } else {
-    return ret_buf;
   }
+  return ret_buf;
+}
+
+// Context of send_nl_msg_libnl(), opened on first use. A forked child opens
+// its own rather than sharing the socket of the parent.
+static pthread_mutex_t default_ctx_lock = PTHREAD_MUTEX_INITIALIZER;
+static ncsi_nl_ctx_t *default_ctx = NULL;
+
+static ncsi_nl_ctx_t *ncsi_nl_default_ctx(void)
+{
+	ncsi_nl_ctx_t *ctx;
+
+	pthread_mutex_lock(&default_ctx_lock);
+	if (default_ctx && default_ctx->pid != getpid())
+		default_ctx = NULL;
+	if (!default_ctx)
+		default_ctx = ncsi_nl_ctx_open();
+	ctx = default_ctx;
+	pthread_mutex_unlock(&default_ctx_lock);
+	return ctx;
+}
+
+int run_command_send(int ifindex, NCSI_NL_MSG_T *nl_msg, NCSI_NL_RSP_T *rsp)
+{
+	ncsi_nl_ctx_t *ctx = ncsi_nl_default_ctx();
+
+	if (!ctx)
+		return -1;
+	return ncsi_nl_ctx_send_cmd(ctx, ifindex, nl_msg, rsp);
+}
+
+// Sending data to kernel via netlink libnl
+NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg)
+{
+  ncsi_nl_ctx_t *ctx = ncsi_nl_default_ctx();
+
+  if (!ctx)
+    return NULL;
+  return ncsi_nl_ctx_send(ctx, nl_msg);
 }
 
 // wrapper for rcv msg
@@ -411,6 +630,15 @@ int nl_rcv_msg(struct nl_sock *sk)
   return nl_recvmsgs_default(sk);
 }
 
+// fd of the socket to wait on for messages: the socket is set
+// non-blocking, so nl_rcv_msg() returns when there's nothing to read
+int libnl_get_fd(struct nl_sock *sk)
+{
+  if (!sk || nl_socket_set_nonblocking(sk) < 0)
+    return -1;
+  return nl_socket_get_fd(sk);
+}
+
 // wrapper for freeing socket
 int libnl_free_socket(struct nl_sock *sk)
 {
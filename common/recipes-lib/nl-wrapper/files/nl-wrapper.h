@@ -83,11 +83,21 @@ struct ncsi_msg {
 };
 
 
+// Persistent NC-SI netlink socket, safe to share between threads, with any
+// number of commands outstanding on it.
+typedef struct ncsi_nl_ctx ncsi_nl_ctx_t;
+
 // APIs
+ncsi_nl_ctx_t *ncsi_nl_ctx_open(void);
+void ncsi_nl_ctx_close(ncsi_nl_ctx_t *ctx);
+// Response to nl_msg, to be freed by the caller, NULL on failure
+NCSI_NL_RSP_T *ncsi_nl_ctx_send(ncsi_nl_ctx_t *ctx, NCSI_NL_MSG_T *nl_msg);
+// Same as ncsi_nl_ctx_send() on a context the process opens on first use
 NCSI_NL_RSP_T * send_nl_msg_libnl(NCSI_NL_MSG_T *nl_msg);
 int setup_ncsi_mc_socket(struct nl_sock **sk, unsigned char *dst);
 int islibnl(void);
 int nl_rcv_msg(struct nl_sock *sk);
+int libnl_get_fd(struct nl_sock *sk);
 int libnl_free_socket(struct nl_sock *sk);
 #ifdef __cplusplus
 } // extern "C"
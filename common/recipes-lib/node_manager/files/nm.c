@@ -8,6 +8,8 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <pthread.h>
 #include <openbmc/ipmb.h>
 #include "nm.h"
 
@@ -109,21 +111,15 @@ cmd_NM_send_pmbus_raw(NM_RW_INFO info, uint8_t *rbuf, uint8_t *wbuf, uint8_t wr_
   return ret;
 }
 
-int
-cmd_NM_pmbus_standard_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdata) {
-  uint8_t tbuf[64] = {0x00};
-  uint8_t tlen = 0;
-  uint8_t rlen = 0;
-  int ret = 0;
+// Builds the Send Raw PMBus request of a standard read word in tbuf,
+// returns its length
+static uint8_t
+nm_pmbus_standard_read_req(NM_RW_INFO *info, uint8_t *buf, uint8_t *tbuf) {
   ipmb_req_t *req;
   NM_PMBUS_STANDAR_DEV dev;
 
-#ifdef DEBUG
-  syslog(LOG_DEBUG, "%s\n", __func__);
-#endif
-
   req = (ipmb_req_t*)tbuf;
-  set_NM_head(&info, NETFN_NM_REQ, req, CMD_NM_SEND_RAW_PMBUS);
+  set_NM_head(info, NETFN_NM_REQ, req, CMD_NM_SEND_RAW_PMBUS);
 
   dev.psu_cmd = buf[0];
   dev.psu_addr = buf[1];
@@ -138,7 +134,105 @@ cmd_NM_pmbus_standard_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdata) {
   req->data[7] = 0x01;
   req->data[8] = 0x02;
   req->data[9] = dev.psu_cmd;
-  tlen = 10 + MIN_IPMB_REQ_LEN;
+  return 10 + MIN_IPMB_REQ_LEN;
+}
+
+// Same as nm_pmbus_standard_read_req() for an extended read word
+static uint8_t
+nm_pmbus_extend_read_req(NM_RW_INFO *info, uint8_t *buf, uint8_t *tbuf) {
+  ipmb_req_t *req;
+  NM_PMBUS_EXTEND_DEV dev;
+
+  req = (ipmb_req_t*)tbuf;
+  set_NM_head(info, NETFN_NM_REQ, req, CMD_NM_SEND_RAW_PMBUS);
+
+  dev.psu_cmd = buf[0];
+  dev.psu_addr = buf[1];
+  dev.mux_addr = buf[2];
+  dev.mux_ch = buf[3];
+  dev.sensor_bus = buf[4];
+
+  req->data[0] = 0x57;
+  req->data[1] = 0x01;
+  req->data[2] = 0x00;
+  req->data[3] = SMBUS_EXTENDED_READ_WORD;
+  req->data[4] = dev.sensor_bus;
+  req->data[5] = dev.psu_addr;
+  req->data[6] = dev.mux_addr;
+  req->data[7] = dev.mux_ch;
+  req->data[8] = EXTENDED_MUX_ENABLE;
+  req->data[9] = TRANS_PROTOCOL_PMBUS;
+  req->data[10] = 1;
+  req->data[11] = 2;
+  req->data[12] = dev.psu_cmd;
+  return 13 + MIN_IPMB_REQ_LEN;
+}
+
+// The ME takes one SMBus transaction per Send Raw PMBus, so the reads go
+// to ipmbd as one batch: all the requests are on the bus before the
+// first response is waited for. Falls back to one request at a time
+// if the batch exchange fails.
+static int
+nm_pmbus_read_words(NM_RW_INFO *info, NM_PMBUS_READ *reads, int count,
+                    uint8_t (*build)(NM_RW_INFO*, uint8_t*, uint8_t*)) {
+  uint8_t tbufs[IPMB_BATCH_MAX][64];
+  ipmb_batch_req_t batch[IPMB_BATCH_MAX];
+  int i, n, done;
+
+  for (done = 0; done < count; done += n) {
+    n = count - done;
+    if (n > IPMB_BATCH_MAX)
+      n = IPMB_BATCH_MAX;
+
+    memset(batch, 0, sizeof(batch));
+    for (i = 0; i < n; i++) {
+      memset(tbufs[i], 0, sizeof(tbufs[i]));
+      batch[i].request = tbufs[i];
+      batch[i].req_len = build(info, reads[done + i].dev, tbufs[i]);
+      batch[i].response = reads[done + i].rdata;
+    }
+
+    if (lib_ipmb_handle_batch(info->bus, batch, n) == 0) {
+      for (i = 0; i < n; i++)
+        reads[done + i].rlen = batch[i].res_len;
+      continue;
+    }
+    for (i = 0; i < n; i++) {
+      reads[done + i].rlen = 0;
+      lib_ipmb_handle(info->bus, tbufs[i], batch[i].req_len,
+                      reads[done + i].rdata, &reads[done + i].rlen);
+    }
+  }
+
+  for (i = 0; i < count; i++) {
+    if (reads[i].rlen != 0)
+      return 0;
+  }
+  return -1;
+}
+
+int
+cmd_NM_pmbus_standard_read_words(NM_RW_INFO info, NM_PMBUS_READ *reads, int count) {
+  return nm_pmbus_read_words(&info, reads, count, nm_pmbus_standard_read_req);
+}
+
+int
+cmd_NM_pmbus_extend_read_words(NM_RW_INFO info, NM_PMBUS_READ *reads, int count) {
+  return nm_pmbus_read_words(&info, reads, count, nm_pmbus_extend_read_req);
+}
+
+int
+cmd_NM_pmbus_standard_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdata) {
+  uint8_t tbuf[64] = {0x00};
+  uint8_t tlen = 0;
+  uint8_t rlen = 0;
+  int ret = 0;
+
+#ifdef DEBUG
+  syslog(LOG_DEBUG, "%s\n", __func__);
+#endif
+
+  tlen = nm_pmbus_standard_read_req(&info, buf, tbuf);
 
 
   // Invoke IPMB library handler
@@ -214,37 +308,12 @@ cmd_NM_pmbus_extend_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdata) {
   uint8_t tlen = 0;
   uint8_t rlen = 0;
   int ret = 0;
-  ipmb_req_t *req;
-  NM_PMBUS_EXTEND_DEV dev;
 
 #ifdef DEBUG
   syslog(LOG_DEBUG, "%s\n", __func__);
 #endif
 
-  req = (ipmb_req_t*)tbuf;
-  set_NM_head(&info, NETFN_NM_REQ, req, CMD_NM_SEND_RAW_PMBUS);
-
-  dev.psu_cmd = buf[0];
-  dev.psu_addr = buf[1];
-  dev.mux_addr = buf[2];
-  dev.mux_ch = buf[3];
-  dev.sensor_bus = buf[4];
-
-  req->data[0] = 0x57;
-  req->data[1] = 0x01;
-  req->data[2] = 0x00;
-  req->data[3] = SMBUS_EXTENDED_READ_WORD;
-  req->data[4] = dev.sensor_bus;
-  req->data[5] = dev.psu_addr;
-  req->data[6] = dev.mux_addr;
-  req->data[7] = dev.mux_ch;
-  req->data[8] = EXTENDED_MUX_ENABLE;
-  req->data[9] = TRANS_PROTOCOL_PMBUS;
-  req->data[10] = 1;
-  req->data[11] = 2;
-  req->data[12] = dev.psu_cmd;
-
-  tlen = 13 + MIN_IPMB_REQ_LEN;
+  tlen = nm_pmbus_extend_read_req(&info, buf, tbuf);
 
   // Invoke IPMB library handler
   lib_ipmb_handle(info.bus, tbuf, tlen, rdata, &rlen);
@@ -416,6 +485,91 @@ cmd_NM_cpu_err_num_get(NM_RW_INFO info, bool is_caterr)
   return cpu_num;
 }
 
+// Power readings are polled every second by several consumers while the
+// ME only refreshes its statistics about as often, so a response is
+// served again for NM_STATS_CACHE_TTL_MS to the same (mode, domain, policy)
+#define NM_STATS_CACHE_TTL_MS 500
+#define NM_STATS_CACHE_SIZE   8
+#define NM_STATS_CACHE_LEN    64
+
+typedef struct {
+  uint8_t bus;
+  uint8_t nm_addr;
+  uint8_t mode;
+  uint8_t domain;
+  uint8_t policy;
+  uint8_t len;
+  uint8_t data[NM_STATS_CACHE_LEN];
+  long long ts_ms;
+} nm_stats_cache_t;
+
+static nm_stats_cache_t nm_stats_cache[NM_STATS_CACHE_SIZE];
+static int nm_stats_cache_next = 0;
+static pthread_mutex_t nm_stats_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long
+nm_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static nm_stats_cache_t *
+nm_stats_cache_find(NM_RW_INFO *info, uint8_t mode, uint8_t domain, uint8_t policy) {
+  int i;
+  nm_stats_cache_t *c;
+
+  for (i = 0; i < NM_STATS_CACHE_SIZE; i++) {
+    c = &nm_stats_cache[i];
+    if (c->len && c->bus == info->bus && c->nm_addr == info->nm_addr &&
+        c->mode == mode && c->domain == domain && c->policy == policy)
+      return c;
+  }
+  return NULL;
+}
+
+static bool
+nm_stats_cache_get(NM_RW_INFO *info, uint8_t mode, uint8_t domain,
+                   uint8_t policy, uint8_t *rbuf) {
+  nm_stats_cache_t *c;
+  bool hit = false;
+
+  pthread_mutex_lock(&nm_stats_cache_mutex);
+  c = nm_stats_cache_find(info, mode, domain, policy);
+  if (c && (nm_now_ms() - c->ts_ms) < NM_STATS_CACHE_TTL_MS) {
+    memcpy(rbuf, c->data, c->len);
+    hit = true;
+  }
+  pthread_mutex_unlock(&nm_stats_cache_mutex);
+  return hit;
+}
+
+static void
+nm_stats_cache_put(NM_RW_INFO *info, uint8_t mode, uint8_t domain,
+                   uint8_t policy, uint8_t *rbuf, uint8_t rlen) {
+  nm_stats_cache_t *c;
+
+  if (rlen > NM_STATS_CACHE_LEN)
+    return;
+
+  pthread_mutex_lock(&nm_stats_cache_mutex);
+  c = nm_stats_cache_find(info, mode, domain, policy);
+  if (!c) {
+    c = &nm_stats_cache[nm_stats_cache_next];
+    nm_stats_cache_next = (nm_stats_cache_next + 1) % NM_STATS_CACHE_SIZE;
+  }
+  c->bus = info->bus;
+  c->nm_addr = info->nm_addr;
+  c->mode = mode;
+  c->domain = domain;
+  c->policy = policy;
+  c->len = rlen;
+  memcpy(c->data, rbuf, rlen);
+  c->ts_ms = nm_now_ms();
+  pthread_mutex_unlock(&nm_stats_cache_mutex);
+}
+
 int
 cmd_NM_get_nm_statistics(NM_RW_INFO info, uint8_t mode, uint8_t domain,
                          uint8_t policy, uint8_t *rbuf) {
@@ -429,6 +583,9 @@ cmd_NM_get_nm_statistics(NM_RW_INFO info, uint8_t mode, uint8_t domain,
   syslog(LOG_DEBUG, "%s\n", __func__);
 #endif
 
+  if (nm_stats_cache_get(&info, mode, domain, policy, rbuf))
+    return 0;
+
   req = (ipmb_req_t*)tbuf;
   set_NM_head(&info, NETFN_NM_REQ, req, CMD_NM_GET_NODE_MANAGER_STATISTICS);
 
@@ -450,6 +607,7 @@ cmd_NM_get_nm_statistics(NM_RW_INFO info, uint8_t mode, uint8_t domain,
     return -1;
   }
 
+  nm_stats_cache_put(&info, mode, domain, policy, rbuf, rlen);
   return ret;
 }
 
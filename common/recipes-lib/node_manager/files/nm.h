@@ -80,6 +80,15 @@ typedef struct __attribute__((__packed__)) {
   uint8_t sensor_bus;
 } NM_PMBUS_EXTEND_DEV;
 
+// One register of a cmd_NM_pmbus_*_read_words() batch. dev points to an
+// NM_PMBUS_STANDAR_DEV or NM_PMBUS_EXTEND_DEV, rdata holds
+// MAX_IPMB_RES_LEN and rlen is 0 when the read failed
+typedef struct {
+  uint8_t *dev;
+  uint8_t *rdata;
+  uint8_t rlen;
+} NM_PMBUS_READ;
+
 #if 0
 typedef struct __attribute__((__packed__)) {
   uint8_t flags;
@@ -109,6 +118,8 @@ int cmd_NM_pmbus_standard_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdat
 int cmd_NM_pmbus_standard_write_word(NM_RW_INFO info, uint8_t* buf, uint8_t *wdata);
 int cmd_NM_pmbus_extend_read_word(NM_RW_INFO info, uint8_t* buf, uint8_t *rdata);
 int cmd_NM_pmbus_extend_write_word(NM_RW_INFO info, uint8_t* buf, uint8_t *wdata);
+int cmd_NM_pmbus_standard_read_words(NM_RW_INFO info, NM_PMBUS_READ *reads, int count);
+int cmd_NM_pmbus_extend_read_words(NM_RW_INFO info, NM_PMBUS_READ *reads, int count);
 int cmd_NM_sensor_reading(NM_RW_INFO info, uint8_t snr_num, uint8_t* rbuf, uint8_t* rlen);
 int cmd_NM_cpu_err_num_get(NM_RW_INFO info, bool is_caterr);
 int cmd_NM_get_dev_id(NM_RW_INFO* info, ipmi_dev_id_t *dev_id);
@@ -18,6 +18,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <syslog.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -40,13 +44,24 @@ msleep(int msec) {
   }
 }
 
-/* Read a byte from NVMe-MI 0x6A. Need to give a bus and a byte address for reading. */
-int
-nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
+/*
+ * The i2c bus devices of NVMe-MI reads stay open (with I2C_SLAVE set to
+ * the NVMe-MI address) for the life of the process: a drive sweep does
+ * not open, ioctl and close the bus for every field.
+ */
+#define NVME_BUS_CACHE_SIZE 16
+#define NVME_BUS_PATH_MAX 32
+
+static struct {
+  char path[NVME_BUS_PATH_MAX];
+  int fd;
+} nvme_bus_cache[NVME_BUS_CACHE_SIZE];
+static int nvme_bus_cached = 0;
+static pthread_mutex_t nvme_bus_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+nvme_bus_open(const char *i2c_bus_device) {
   int dev;
-  int ret;
-  int32_t res;
-  int retry = 0;
 
   dev = open(i2c_bus_device, O_RDWR);
   if (dev < 0) {
@@ -54,13 +69,75 @@ nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
     return -1;
   }
 
-  ret = ioctl(dev, I2C_SLAVE, I2C_NVME_INTF_ADDR);
-  if (ret < 0) {
+  if (ioctl(dev, I2C_SLAVE, I2C_NVME_INTF_ADDR) < 0) {
     syslog(LOG_DEBUG, "%s(): ioctl() assigning i2c addr failed", __func__);
     close(dev);
     return -1;
   }
 
+  return dev;
+}
+
+/* Get the cached fd of a bus device, *cached is false if it must be closed. */
+static int
+nvme_bus_get(const char *i2c_bus_device, bool *cached) {
+  int i, dev;
+
+  pthread_mutex_lock(&nvme_bus_lock);
+  for (i = 0; i < nvme_bus_cached; i++) {
+    if (!strcmp(nvme_bus_cache[i].path, i2c_bus_device)) {
+      dev = nvme_bus_cache[i].fd;
+      pthread_mutex_unlock(&nvme_bus_lock);
+      *cached = true;
+      return dev;
+    }
+  }
+
+  dev = nvme_bus_open(i2c_bus_device);
+  *cached = false;
+  if (dev >= 0 && nvme_bus_cached < NVME_BUS_CACHE_SIZE &&
+      strlen(i2c_bus_device) < NVME_BUS_PATH_MAX) {
+    snprintf(nvme_bus_cache[nvme_bus_cached].path, NVME_BUS_PATH_MAX,
+             "%s", i2c_bus_device);
+    nvme_bus_cache[nvme_bus_cached].fd = dev;
+    nvme_bus_cached++;
+    *cached = true;
+  }
+  pthread_mutex_unlock(&nvme_bus_lock);
+
+  return dev;
+}
+
+static void
+nvme_bus_put(int dev, bool cached) {
+  if (!cached)
+    close(dev);
+}
+
+void
+nvme_bus_cache_flush(void) {
+  int i;
+
+  pthread_mutex_lock(&nvme_bus_lock);
+  for (i = 0; i < nvme_bus_cached; i++)
+    close(nvme_bus_cache[i].fd);
+  nvme_bus_cached = 0;
+  pthread_mutex_unlock(&nvme_bus_lock);
+}
+
+/* Read a byte from NVMe-MI 0x6A. Need to give a bus and a byte address for reading. */
+int
+nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
+  int dev;
+  int32_t res;
+  int retry = 0;
+  bool cached;
+
+  dev = nvme_bus_get(i2c_bus_device, &cached);
+  if (dev < 0) {
+    return -1;
+  }
+
   res = i2c_smbus_read_byte_data(dev, item);
   retry = 0;
   while ((retry < 5) && (res < 0)) {
@@ -72,16 +149,14 @@ nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
       break;
   }
 
+  nvme_bus_put(dev, cached);
   if (res < 0) {
     syslog(LOG_DEBUG, "%s(): i2c_smbus_read_byte_data failed", __func__);
-    close(dev);
     return -1;
   }
 
   *value = (uint8_t) res;
 
-  close(dev);
-
   return 0;
 }
 
@@ -89,20 +164,12 @@ nvme_read_byte(const char *i2c_bus_device, uint8_t item, uint8_t *value) {
 int
 nvme_read_word(const char *i2c_bus_device, uint8_t item, uint16_t *value) {
   int dev;
-  int ret;
   int32_t res;
   int retry = 0;
+  bool cached;
 
-  dev = open(i2c_bus_device, O_RDWR);
+  dev = nvme_bus_get(i2c_bus_device, &cached);
   if (dev < 0) {
-    syslog(LOG_DEBUG, "%s(): open() failed", __func__);
-    return -1;
-  }
-
-  ret = ioctl(dev, I2C_SLAVE, I2C_NVME_INTF_ADDR);
-  if (ret < 0) {
-    syslog(LOG_DEBUG, "%s(): ioctl() assigning i2c addr failed", __func__);
-    close(dev);
     return -1;
   }
 
@@ -117,19 +184,153 @@ nvme_read_word(const char *i2c_bus_device, uint8_t item, uint16_t *value) {
       break;
   }
 
+  nvme_bus_put(dev, cached);
   if (res < 0) {
     syslog(LOG_DEBUG, "%s(): i2c_smbus_read_byte_data failed", __func__);
-    close(dev);
     return -1;
   }
 
   *value = (uint16_t) res;
 
-  close(dev);
+  return 0;
+}
+
+/*
+ * Read <len> bytes of the NVMe-MI management data from <offset>, in one
+ * I2C write-read transfer. Need to give a bus for reading.
+ */
+int
+nvme_mgmt_read(const char *i2c_bus_device, uint8_t offset, uint8_t *buf, uint8_t len) {
+  int dev;
+  int res;
+  int retry = 0;
+  bool cached;
+
+  if (!buf || len == 0) {
+    syslog(LOG_ERR, "%s(): invalid parameter", __func__);
+    return -1;
+  }
+
+  dev = nvme_bus_get(i2c_bus_device, &cached);
+  if (dev < 0) {
+    return -1;
+  }
+
+  res = i2c_rdwr_msg_transfer(dev, I2C_NVME_INTF_ADDR << 1, &offset, 1, buf, len);
+  while ((retry < 5) && (res < 0)) {
+    msleep(100);
+    res = i2c_rdwr_msg_transfer(dev, I2C_NVME_INTF_ADDR << 1, &offset, 1, buf, len);
+    if (res < 0)
+      retry++;
+    else
+      break;
+  }
+
+  nvme_bus_put(dev, cached);
+  if (res < 0) {
+    syslog(LOG_DEBUG, "%s(): i2c_rdwr_msg_transfer offset=%d len=%d failed",
+           __func__, offset, len);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Fill <ssd> from the management data read from offset 0: the basic
+ * management fields need NVME_BASIC_MGMT_SIZE bytes, and the GPv2 areas
+ * are filled if <len> is at least NVME_MGMT_DATA_SIZE.
+ */
+int
+nvme_ssd_data_parse(const uint8_t *buf, size_t len, ssd_data *ssd) {
+  if (!buf || !ssd || len < NVME_BASIC_MGMT_SIZE) {
+    syslog(LOG_ERR, "%s(): invalid parameter", __func__);
+    return -1;
+  }
+
+  ssd->sflgs = buf[NVME_SFLGS_REG];
+  ssd->warning = buf[NVME_WARNING_REG];
+  ssd->temp = buf[NVME_TEMP_REG];
+  ssd->pdlu = buf[NVME_PDLU_REG];
+  ssd->vendor = (buf[NVME_VENDOR_REG] << 8) | buf[NVME_VENDOR_REG + 1];
+  memcpy(ssd->serial_num, &buf[NVME_SERIAL_NUM_REG], SERIAL_NUM_SIZE);
+  if (len < NVME_MGMT_DATA_SIZE)
+    return 0;
+
+  buf += NVME_MODULE_ID_AREA;
+  ssd->block_len_module_id_area = buf[0];
+  ssd->fb_defined = buf[1];
+  memcpy(ssd->part_num, &buf[2], PART_NUM_SIZE);
+  ssd->meff = buf[42];
+  ssd->ffi_0 = buf[43];
+
+  buf += NVME_STORAGE_AREA - NVME_MODULE_ID_AREA;
+  ssd->ssd_ver = buf[1];
+  ssd->ssd_capacity = (buf[2] << 8) | buf[3];
+  ssd->ssd_pwr = buf[4];
+  ssd->ssd_sinfo_0 = buf[5];
+
+  buf += NVME_MODULE_STAT_AREA - NVME_STORAGE_AREA;
+  ssd->block_len_module_stat_area = buf[0];
+  ssd->module_helath = buf[1];
+  ssd->lower_theshold = buf[2];
+  ssd->upper_threshold = buf[3];
+  ssd->power_state = buf[4];
+  ssd->i2c_freq = buf[5];
+  ssd->tdp_level = buf[6];
+
+  buf += NVME_VER_AREA - NVME_MODULE_STAT_AREA;
+  ssd->block_len_ver_area = buf[0];
+  ssd->asic_version = buf[1];
+  ssd->fw_major_ver = buf[2];
+  ssd->fw_minor_ver = buf[3];
+
+  buf += NVME_MON_AREA - NVME_VER_AREA;
+  ssd->block_len_mon_area = buf[0];
+  ssd->asic_core_vol1 = (buf[1] << 8) | buf[2];
+  ssd->asic_core_vol2 = (buf[3] << 8) | buf[4];
+  ssd->power_rail_vol1 = (buf[5] << 8) | buf[6];
+  ssd->power_rail_vol2 = (buf[7] << 8) | buf[8];
+
+  buf += NVME_ERR_RET_AREA - NVME_MON_AREA;
+  ssd->block_len_err_ret_area = buf[0];
+  ssd->asic_error_type = buf[1];
+  ssd->module_error_type = buf[2];
+  ssd->warning_flag = buf[3];
+  ssd->interrupt_flag = buf[4];
+  ssd->max_asic_temp = buf[5];
+  ssd->total_int_mem_err_count = buf[6];
+  ssd->total_ext_mem_err_count = buf[7];
+  ssd->smbus_err = buf[8];
 
   return 0;
 }
 
+/*
+ * Read the basic management data structure in one transfer, and the
+ * GPv2 areas (vpd) in a second one. Need to give a bus for reading.
+ */
+int
+nvme_ssd_data_read(const char *i2c_bus_device, ssd_data *ssd, bool vpd) {
+  uint8_t buf[NVME_MGMT_DATA_SIZE] = {0};
+
+  if (!ssd) {
+    syslog(LOG_ERR, "%s(): invalid parameter (null)", __func__);
+    return -1;
+  }
+
+  if (nvme_mgmt_read(i2c_bus_device, 0, buf, NVME_BASIC_MGMT_SIZE) < 0) {
+    return -1;
+  }
+  if (vpd && nvme_mgmt_read(i2c_bus_device, NVME_BASIC_MGMT_SIZE,
+                            &buf[NVME_BASIC_MGMT_SIZE],
+                            NVME_MGMT_DATA_SIZE - NVME_BASIC_MGMT_SIZE) < 0) {
+    return -1;
+  }
+
+  return nvme_ssd_data_parse(buf, vpd ? NVME_MGMT_DATA_SIZE : NVME_BASIC_MGMT_SIZE, ssd);
+}
+
 /* Read NVMe-MI Status Flags. Need to give a bus for reading. */
 int
 nvme_sflgs_read(const char *i2c_bus_device, uint8_t *value) {
@@ -211,20 +412,16 @@ nvme_vendor_read(const char *i2c_bus_device, uint16_t *value) {
 int
 nvme_serial_num_read(const char *i2c_bus_device, uint8_t *value, int size) {
   int ret;
-  uint8_t reg = NVME_SERIAL_NUM_REG;
-  int count;
 
   if(size != SERIAL_NUM_SIZE) {
     syslog(LOG_DEBUG, "%s(): the array size is wrong", __func__);
     return -1;
   }
 
-  for(count = 0; count < SERIAL_NUM_SIZE; count++) {
-    ret = nvme_read_byte(i2c_bus_device, reg + count, value + count);
-    if(ret < 0) {
-      syslog(LOG_DEBUG, "%s(): nvme_read_byte failed", __func__);
-      return -1;
-    }
+  ret = nvme_mgmt_read(i2c_bus_device, NVME_SERIAL_NUM_REG, value, SERIAL_NUM_SIZE);
+  if(ret < 0) {
+    syslog(LOG_DEBUG, "%s(): nvme_mgmt_read failed", __func__);
+    return -1;
   }
   return 0;
 }
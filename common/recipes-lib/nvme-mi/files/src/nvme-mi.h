@@ -18,6 +18,10 @@
 #ifndef __NVME_MI_H__
 #define __NVME_MI_H__
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
 #define I2C_NVME_INTF_ADDR 0x6A
 
 #define NVME_SFLGS_REG 0x01
@@ -30,6 +34,17 @@
 #define PART_KEY_SIZE 40
 #define PART_NUM_SIZE 40
 
+/* NVMe-MI management data: basic management data structure at offset 0,
+   followed by the GPv2 M.2 areas */
+#define NVME_BASIC_MGMT_SIZE 32
+#define NVME_MODULE_ID_AREA 32
+#define NVME_STORAGE_AREA 87
+#define NVME_MODULE_STAT_AREA 96
+#define NVME_VER_AREA 104
+#define NVME_MON_AREA 112
+#define NVME_ERR_RET_AREA 122
+#define NVME_MGMT_DATA_SIZE (NVME_ERR_RET_AREA + 9)
+
 /* NVMe-MI Temperature Definition Code */
 #define TEMP_HIGHER_THAN_127 0x7F
 #define TEPM_LOWER_THAN_n60 0xC4
@@ -169,6 +184,7 @@ enum {
   VALID
 };
 
+void nvme_bus_cache_flush(void);
 int nvme_read_byte(const char *i2c_bus, uint8_t item, uint8_t *value);
 int nvme_read_word(const char *i2c_bus, uint8_t item, uint16_t *value);
 int nvme_sflgs_read(const char *i2c_bus, uint8_t *value);
@@ -177,6 +193,9 @@ int nvme_temp_read(const char *i2c_bus, uint8_t *value);
 int nvme_pdlu_read(const char *i2c_bus, uint8_t *value);
 int nvme_vendor_read(const char *i2c_bus, uint16_t *value);
 int nvme_serial_num_read(const char *i2c_bus, uint8_t *value, int size);
+int nvme_mgmt_read(const char *i2c_bus, uint8_t offset, uint8_t *buf, uint8_t len);
+int nvme_ssd_data_parse(const uint8_t *buf, size_t len, ssd_data *ssd);
+int nvme_ssd_data_read(const char *i2c_bus, ssd_data *ssd, bool vpd);
 
 int check_nvme_fileds_valid(uint8_t block_len, t_key_value_pair *tmp_decoding);
 int nvme_sflgs_decode(uint8_t value, t_status_flags *status_flag_decoding);
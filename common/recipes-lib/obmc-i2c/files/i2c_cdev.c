@@ -26,7 +26,11 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <linux/i2c.h>
@@ -80,15 +84,165 @@ int i2c_cdev_slave_close(int fd)
 	return close(fd);
 }
 
-int i2c_rdwr_msg_transfer(int file, __u8 addr, __u8 *tbuf, 
-			  __u8 tcount, __u8 *rbuf, __u8 rcount)
+/*
+ * Bus counters, in shared memory for all the processes.
+ */
+#define I2C_BUS_STATS_SHM	"obmc_i2c_bus_stats"
+#define I2C_CDEV_MAJOR		89
+
+static i2c_bus_stats_t *bus_stats = NULL;
+static pthread_once_t bus_stats_once = PTHREAD_ONCE_INIT;
+
+static void i2c_bus_stats_map(void)
+{
+	int fd;
+	void *ptr;
+	struct stat st;
+	size_t size = sizeof(i2c_bus_stats_t) * I2C_BUS_STATS_MAX;
+
+	fd = shm_open(I2C_BUS_STATS_SHM, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return;
+
+	if (fstat(fd, &st) != 0 ||
+	    ((size_t)st.st_size < size && ftruncate(fd, size) != 0)) {
+		close(fd);
+		return;
+	}
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ptr != MAP_FAILED)
+		bus_stats = ptr;
+}
+
+static i2c_bus_stats_t* i2c_bus_stats_slot(int bus)
+{
+	if (bus < 0 || bus >= I2C_BUS_STATS_MAX)
+		return NULL;
+
+	pthread_once(&bus_stats_once, i2c_bus_stats_map);
+	return bus_stats ? &bus_stats[bus] : NULL;
+}
+
+/* Bus number of an i2c master character device, or -1. */
+static int i2c_cdev_fd_to_bus(int file)
+{
+	struct stat st;
+
+	if (fstat(file, &st) != 0 || !S_ISCHR(st.st_mode) ||
+	    major(st.st_rdev) != I2C_CDEV_MAJOR)
+		return -1;
+
+	return minor(st.st_rdev);
+}
+
+static uint64_t i2c_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void i2c_bus_stats_record(int bus, int nmsgs, int err, uint64_t us)
+{
+	uint32_t old, usec, carry;
+	i2c_bus_stats_t *stats = i2c_bus_stats_slot(bus);
+
+	if (stats == NULL)
+		return;
+
+	__atomic_fetch_add(&stats->transactions, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->msgs, nmsgs, __ATOMIC_RELAXED);
+	if (err == ENXIO || err == EREMOTEIO)
+		__atomic_fetch_add(&stats->naks, 1, __ATOMIC_RELAXED);
+	else if (err == ETIMEDOUT)
+		__atomic_fetch_add(&stats->timeouts, 1, __ATOMIC_RELAXED);
+	else if (err != 0)
+		__atomic_fetch_add(&stats->errors, 1, __ATOMIC_RELAXED);
+
+	/* Keep busy_usec under a second, the carry goes to busy_sec */
+	old = __atomic_load_n(&stats->busy_usec, __ATOMIC_RELAXED);
+	do {
+		usec = (uint32_t)((old + us) % 1000000);
+		carry = (uint32_t)((old + us) / 1000000);
+	} while (!__atomic_compare_exchange_n(&stats->busy_usec, &old, usec,
+					      0, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+	if (carry)
+		__atomic_fetch_add(&stats->busy_sec, carry, __ATOMIC_RELAXED);
+}
+
+int i2c_bus_stats_get(int bus, i2c_bus_stats_t *stats)
+{
+	i2c_bus_stats_t *slot;
+
+	if (stats == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	slot = i2c_bus_stats_slot(bus);
+	if (slot == NULL) {
+		errno = (bus < 0 || bus >= I2C_BUS_STATS_MAX) ? EINVAL : ENOMEM;
+		return -1;
+	}
+
+	stats->transactions = __atomic_load_n(&slot->transactions, __ATOMIC_RELAXED);
+	stats->msgs = __atomic_load_n(&slot->msgs, __ATOMIC_RELAXED);
+	stats->naks = __atomic_load_n(&slot->naks, __ATOMIC_RELAXED);
+	stats->timeouts = __atomic_load_n(&slot->timeouts, __ATOMIC_RELAXED);
+	stats->errors = __atomic_load_n(&slot->errors, __ATOMIC_RELAXED);
+	stats->busy_sec = __atomic_load_n(&slot->busy_sec, __ATOMIC_RELAXED);
+	stats->busy_usec = __atomic_load_n(&slot->busy_usec, __ATOMIC_RELAXED);
+	return 0;
+}
+
+int i2c_bus_stats_clear(int bus)
+{
+	i2c_bus_stats_t *slot = i2c_bus_stats_slot(bus);
+
+	if (slot == NULL) {
+		errno = (bus < 0 || bus >= I2C_BUS_STATS_MAX) ? EINVAL : ENOMEM;
+		return -1;
+	}
+
+	__atomic_store_n(&slot->transactions, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->msgs, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->naks, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->timeouts, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->errors, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->busy_sec, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->busy_usec, 0, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/* Issue one I2C_RDWR ioctl, and account it to the bus of <file>. */
+static int i2c_rdwr_ioctl(int file, struct i2c_msg *msgs, int nmsgs)
 {
 	struct i2c_rdwr_ioctl_data data;
-	struct i2c_msg msg[2];
-	int n_msg = 0;
-	int rc;
+	uint64_t start;
+	int rc, err = 0;
 
-	memset(&msg, 0, sizeof(msg));
+	data.msgs = msgs;
+	data.nmsgs = nmsgs;
+
+	start = i2c_now_us();
+	rc = ioctl(file, I2C_RDWR, &data);
+	if (rc < 0)
+		err = errno;
+	i2c_bus_stats_record(i2c_cdev_fd_to_bus(file), nmsgs, err,
+			     i2c_now_us() - start);
+	errno = err;
+	return rc < 0 ? -1 : 0;
+}
+
+/* Add the messages of a transaction, return their number. */
+static int i2c_xfer_msgs(struct i2c_msg *msg, __u8 addr, __u8 *tbuf,
+			 __u8 tcount, __u8 *rbuf, __u8 rcount)
+{
+	int n_msg = 0;
 
 	if (tcount) {
 		msg[n_msg].addr = addr >> 1;
@@ -106,13 +260,67 @@ int i2c_rdwr_msg_transfer(int file, __u8 addr, __u8 *tbuf,
 		n_msg++;
 	}
 
-	data.msgs = msg;
-	data.nmsgs = n_msg;
+	return n_msg;
+}
 
-	rc = ioctl(file, I2C_RDWR, &data);
-	if (rc < 0) {
+int i2c_rdwr_msg_transfer(int file, __u8 addr, __u8 *tbuf,
+			  __u8 tcount, __u8 *rbuf, __u8 rcount)
+{
+	struct i2c_msg msg[2];
+	int n_msg;
+
+	memset(&msg, 0, sizeof(msg));
+	n_msg = i2c_xfer_msgs(msg, addr, tbuf, tcount, rbuf, rcount);
+
+	if (i2c_rdwr_ioctl(file, msg, n_msg) < 0) {
 		// syslog(LOG_ERR, "Failed to do raw io");
 		return -1;
 	}
 	return 0;
 }
+
+int i2c_rdwr_batch_transfer(int file, i2c_xfer_t *xfers, size_t num)
+{
+	struct i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+	size_t i, first, last;
+	int n_msg, ret = 0;
+
+	if (xfers == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (first = 0; first < num; first = last) {
+		memset(&msgs, 0, sizeof(msgs));
+		n_msg = 0;
+		for (last = first; last < num; last++) {
+			i2c_xfer_t *x = &xfers[last];
+
+			if (n_msg + (x->tcount ? 1 : 0) + (x->rcount ? 1 : 0) >
+			    I2C_RDWR_IOCTL_MAX_MSGS)
+				break;
+			n_msg += i2c_xfer_msgs(&msgs[n_msg], x->addr, x->tbuf,
+					       x->tcount, x->rbuf, x->rcount);
+			x->status = 0;
+		}
+
+		if (n_msg == 0 || i2c_rdwr_ioctl(file, msgs, n_msg) == 0)
+			continue;
+
+		/*
+		 * The combined transfer failed: issue the transactions
+		 * one by one to find the failing ones.
+		 */
+		for (i = first; i < last; i++) {
+			i2c_xfer_t *x = &xfers[i];
+
+			if (i2c_rdwr_msg_transfer(file, x->addr, x->tbuf,
+						  x->tcount, x->rbuf,
+						  x->rcount) != 0) {
+				x->status = -errno;
+				ret = -1;
+			}
+		}
+	}
+	return ret;
+}
@@ -90,6 +90,58 @@ int i2c_cdev_slave_close(int fd);
 int i2c_rdwr_msg_transfer(int file, __u8 addr, __u8 *tbuf,
 			  __u8 tcount, __u8 *rbuf, __u8 rcount);
 
+/*
+ * A transaction of i2c_rdwr_batch_transfer(): as the arguments of
+ * i2c_rdwr_msg_transfer() (8-bit address), "status" is set to 0 or to
+ * -errno of the transaction.
+ */
+typedef struct {
+	__u8 addr;
+	__u8 *tbuf;
+	__u8 tcount;
+	__u8 *rbuf;
+	__u8 rcount;
+	int status;
+} i2c_xfer_t;
+
+/*
+ * Issue independent transactions to devices of the bus of <file> with
+ * as few I2C_RDWR ioctls as possible: the messages of all transactions
+ * (up to I2C_RDWR_IOCTL_MAX_MSGS) go into one ioctl, separated by
+ * repeated starts. If a combined ioctl fails, its transactions are
+ * issued one by one to find the failing ones, so they must be safe to
+ * issue again (e.g. register reads).
+ *
+ * Return:
+ *   0 if all the transactions succeeded, or -1 (see their "status").
+ */
+int i2c_rdwr_batch_transfer(int file, i2c_xfer_t *xfers, size_t num);
+
+/*
+ * Counters of the I2C_RDWR transactions issued by this library on a bus,
+ * shared by all the processes. They wrap around.
+ */
+#define I2C_BUS_STATS_MAX	64
+
+typedef struct {
+	uint32_t transactions;	/* I2C_RDWR ioctls */
+	uint32_t msgs;		/* messages of the transactions */
+	uint32_t naks;		/* failed with ENXIO or EREMOTEIO */
+	uint32_t timeouts;	/* failed with ETIMEDOUT */
+	uint32_t errors;	/* failed otherwise */
+	uint32_t busy_sec;	/* time in the transactions */
+	uint32_t busy_usec;
+} i2c_bus_stats_t;
+
+/*
+ * Read or reset the counters of a bus.
+ *
+ * Return:
+ *   0 for success, and -1 on failures.
+ */
+int i2c_bus_stats_get(int bus, i2c_bus_stats_t *stats);
+int i2c_bus_stats_clear(int bus);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -78,6 +78,8 @@ struct i2c_mslave_handle {
 
 	int (*ms_poll)(i2c_mslave_t *ms, int timeout);
 	int (*ms_read)(i2c_mslave_t *ms, void *buf, size_t size);
+
+	i2c_mslave_stats_t stats;
 };
 
 static char* mslave_mqueue_abspath(char *path, size_t size,
@@ -136,10 +138,14 @@ static int mslave_legacy_read(i2c_mslave_t *ms, void *buf, size_t size)
 
 	assert(IS_VALID_MSLAVE_HANDLE(ms));
 
+	/*
+	 * The driver may return up to I2C_MSLAVE_MAX_MSG_SIZE bytes: read
+	 * in place when the buffer can take that much.
+	 */
 	msg.addr = ms->addr;
 	msg.flags = 0; /* 0 for read */
 	msg.len = I2C_MSLAVE_MAX_MSG_SIZE;
-	msg.buf = msg_buf;
+	msg.buf = size >= I2C_MSLAVE_MAX_MSG_SIZE ? buf : msg_buf;
 	if (ioctl(ms->fd, I2C_SLAVE_RDWR, &data) < 0)
 		return -1;
 
@@ -149,7 +155,7 @@ static int mslave_legacy_read(i2c_mslave_t *ms, void *buf, size_t size)
 	} else {
 		size = msg.len;
 	}
-	if (size > 0)
+	if (size > 0 && msg.buf != buf)
 		memcpy(buf, msg.buf, size);
 
 	return size;
@@ -293,13 +299,72 @@ int i2c_mslave_close(i2c_mslave_t *ms)
 
 int i2c_mslave_read(i2c_mslave_t *ms, void *buf, size_t size)
 {
+	int ret;
+
 	if (!IS_VALID_MSLAVE_HANDLE(ms) || buf == NULL) {
 		errno = EINVAL;
 		return -1;
 	}
 
 	assert(ms->ms_read != NULL);
-	return ms->ms_read(ms, buf, size);
+	ret = ms->ms_read(ms, buf, size);
+	if (ret > 0)
+		ms->stats.msgs++;
+	return ret;
+}
+
+int i2c_mslave_read_batch(i2c_mslave_t *ms, void *bufs[], size_t lens[],
+			  size_t max)
+{
+	size_t n = 0, seen = 0;
+	int ret;
+
+	if (!IS_VALID_MSLAVE_HANDLE(ms) || bufs == NULL || lens == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	assert(ms->ms_read != NULL);
+	while (n < max) {
+		ret = ms->ms_read(ms, bufs[n], lens[n]);
+		if (ret < 0 && errno == EOVERFLOW) {
+			/* mqueue backend: the message is gone, go on. */
+			ms->stats.dropped++;
+			seen++;
+			continue;
+		}
+		if (ret < 0) {
+			if (n == 0 && seen == 0)
+				return -1;
+			break;
+		}
+		if (ret == 0)
+			break;
+		lens[n++] = ret;
+		seen++;
+	}
+
+	if (seen > 0) {
+		ms->stats.wakeups++;
+		ms->stats.msgs += n;
+		if (seen > ms->stats.max_batch)
+			ms->stats.max_batch = seen;
+		if (seen >= I2C_MSLAVE_MQUEUE_DEPTH &&
+		    ms->ms_poll == mslave_mqueue_poll)
+			ms->stats.queue_full++;
+	}
+	return n;
+}
+
+int i2c_mslave_get_stats(i2c_mslave_t *ms, i2c_mslave_stats_t *stats)
+{
+	if (!IS_VALID_MSLAVE_HANDLE(ms) || stats == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*stats = ms->stats;
+	return 0;
 }
 
 int i2c_mslave_poll(i2c_mslave_t *ms, int timeout)
@@ -312,3 +377,11 @@ int i2c_mslave_poll(i2c_mslave_t *ms, int timeout)
 	assert(ms->ms_poll != NULL);
 	return ms->ms_poll(ms, timeout);
 }
+
+bool i2c_mslave_poll_signaled(i2c_mslave_t *ms)
+{
+	if (!IS_VALID_MSLAVE_HANDLE(ms))
+		return false;
+
+	return ms->ms_poll == mslave_mqueue_poll;
+}
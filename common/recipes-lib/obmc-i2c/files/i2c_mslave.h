@@ -58,6 +58,41 @@ int i2c_mslave_close(i2c_mslave_t *ms);
  */
 int i2c_mslave_read(i2c_mslave_t *ms, void *buf, size_t size);
 
+/*
+ * read all the messages queued for the i2c master (acting as slave), up
+ * to <max>: message i goes to bufs[i], of lens[i] bytes, and lens[i] is
+ * set to its length. To be called once i2c_mslave_poll() signals data,
+ * so a burst is handled with one wakeup. A message too big for its
+ * buffer is dropped (and counted).
+ *
+ * Return:
+ *   number of messages returned (0 if none was queued), or -1 on
+ *   failures.
+ */
+int i2c_mslave_read_batch(i2c_mslave_t *ms, void *bufs[], size_t lens[],
+			  size_t max);
+
+/*
+ * Receive counters of the handle. The mqueue backend keeps the last
+ * I2C_MSLAVE_MQUEUE_DEPTH messages and drops the oldest ones beyond,
+ * so a drain finding that many means messages may have been lost.
+ */
+#define I2C_MSLAVE_MQUEUE_DEPTH	32
+
+typedef struct {
+	uint32_t wakeups;	/* i2c_mslave_read_batch() with messages */
+	uint32_t msgs;		/* messages received */
+	uint32_t max_batch;	/* most messages drained at once */
+	uint32_t queue_full;	/* drains finding the kernel queue full */
+	uint32_t dropped;	/* messages too big for the buffer */
+} i2c_mslave_stats_t;
+
+/*
+ * Return:
+ *   0 for success, and -1 on failures.
+ */
+int i2c_mslave_get_stats(i2c_mslave_t *ms, i2c_mslave_stats_t *stats);
+
 /*
  * function to test if the i2c master (acting as slave) has data
  * available.
@@ -69,6 +104,16 @@ int i2c_mslave_read(i2c_mslave_t *ms, void *buf, size_t size);
  */
 int i2c_mslave_poll(i2c_mslave_t *ms, int timeout);
 
+/*
+ * test if i2c_mslave_poll() returns as soon as data is available, so
+ * it can wait with an infinite timeout. It is the case for the mqueue
+ * backend, but the kernel 4.1 driver does not wake up the poller.
+ *
+ * Return:
+ *   true if data is signaled, false if it has to be polled for.
+ */
+bool i2c_mslave_poll_signaled(i2c_mslave_t *ms);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
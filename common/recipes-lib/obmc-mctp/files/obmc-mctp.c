@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <pthread.h>
 #include <libmctp-alloc.h>
 #include <libmctp-log.h>
 #include "obmc-mctp.h"
@@ -32,8 +33,31 @@
 //#define DEBUG
 #define SYSFS_SLAVE_QUEUE "/sys/bus/i2c/devices/%d-10%02x/slave-mqueue"
 
+// Bindings kept open by the pool of a process
+#define MCTP_POOL_SIZE 8
+
+/*
+ * Parameters of the binding the next mctp_smbus_send_data() transmits
+ * on. Every binding has its own, this points at the one last set up or
+ * taken from the pool.
+ */
 struct mctp_smbus_pkt_private *smbus_extra_params = NULL;
 
+struct mctp_pool_entry {
+  struct obmc_mctp_binding *binding;
+  uint8_t bus;
+  uint8_t src_addr;
+  uint8_t dst_addr;
+  uint8_t src_eid;
+  int pkt_size;
+  int refs;
+  unsigned long last_use;
+};
+
+static struct mctp_pool_entry mctp_pool[MCTP_POOL_SIZE];
+static unsigned long mctp_pool_clock = 0;
+static pthread_mutex_t mctp_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 // TODO:
 //      Migrate this library to C++ if BMC need to support MCTP over PCIe
 
@@ -63,11 +87,10 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t src_addr, ui
   int fd;
   char dev[64] = {0};
   char slave_queue[64] = {0};
-  struct mctp *mctp;
   struct mctp_binding_smbus *smbus;
   struct obmc_mctp_binding *mctp_binding;
 
-  mctp_binding = (struct obmc_mctp_binding *)malloc(sizeof(struct obmc_mctp_binding));
+  mctp_binding = (struct obmc_mctp_binding *)calloc(1, sizeof(struct obmc_mctp_binding));
   if (mctp_binding == NULL) {
     syslog(LOG_ERR, "%s: out of memory", __func__);
     return NULL;
@@ -77,19 +100,22 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t src_addr, ui
     pkt_size = MCTP_PAYLOAD_SIZE + MCTP_HEADER_SIZE;
   mctp_smbus_set_pkt_size(pkt_size);
 
-  mctp = mctp_init();
-  smbus = mctp_smbus_init();
-  if (mctp == NULL || smbus == NULL || mctp_smbus_register_bus(smbus, mctp, src_eid) < 0) {
+  mctp_binding->mctp = mctp_init();
+  mctp_binding->prot = smbus = mctp_smbus_init();
+  if (mctp_binding->mctp == NULL || smbus == NULL ||
+      mctp_smbus_register_bus(smbus, mctp_binding->mctp, src_eid) < 0) {
     syslog(LOG_ERR, "%s: MCTP init failed", __func__);
     goto bail;
   }
 
-  smbus_extra_params = (struct mctp_smbus_pkt_private *)
-                       malloc(sizeof(struct mctp_smbus_pkt_private));
-  if (smbus_extra_params == NULL) {
+  mctp_binding->params = (struct mctp_smbus_pkt_private *)
+                         calloc(1, sizeof(struct mctp_smbus_pkt_private));
+  if (mctp_binding->params == NULL) {
     syslog(LOG_ERR, "%s: out of memory", __func__);
     goto bail;
   }
+  mctp_binding->params->fd = -1;
+  pthread_mutex_init(&mctp_binding->lock, NULL);
 
   snprintf(dev, sizeof(dev), "/dev/i2c-%d", bus);
   fd = open(dev, O_RDWR);
@@ -97,10 +123,10 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t src_addr, ui
     syslog(LOG_ERR, "%s: open %s failed", __func__, dev);
     goto bail;
   }
-  smbus_extra_params->mux_hold_timeout = 0;
-  smbus_extra_params->mux_flags = 0;
-  smbus_extra_params->fd = fd;
-  smbus_extra_params->slave_addr = dst_addr;
+  mctp_binding->params->mux_hold_timeout = 0;
+  mctp_binding->params->mux_flags = 0;
+  mctp_binding->params->fd = fd;
+  mctp_binding->params->slave_addr = dst_addr;
 
   snprintf(slave_queue, sizeof(slave_queue), SYSFS_SLAVE_QUEUE, bus, src_addr);
   fd = open(slave_queue, O_RDONLY);
@@ -115,8 +141,7 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t src_addr, ui
   mctp_set_tracing_enabled(true);
 #endif
 
-  mctp_binding->mctp = mctp;
-  mctp_binding->prot = (void *)smbus;
+  smbus_extra_params = mctp_binding->params;
   return mctp_binding;
 bail:
   obmc_mctp_smbus_free(mctp_binding);
@@ -125,10 +150,138 @@ bail:
 
 void obmc_mctp_smbus_free(struct obmc_mctp_binding* binding)
 {
-  mctp_smbus_free(binding->prot);
-  mctp_destroy(binding->mctp);
+  if (binding == NULL)
+    return;
+
+  if (binding->prot)
+    mctp_smbus_free(binding->prot);
+  if (binding->mctp)
+    mctp_destroy(binding->mctp);
+  if (binding->params) {
+    if (binding->params->fd >= 0)
+      close(binding->params->fd);
+    if (smbus_extra_params == binding->params)
+      smbus_extra_params = NULL;
+    free(binding->params);
+  }
   free(binding);
-  free(smbus_extra_params);
+}
+
+/*
+ * Take a binding of (bus, src_addr, dst_addr, src_eid, pkt_size) from the
+ * pool of the process, set up on the first get. Messages of any EID and
+ * tag go over it until obmc_mctp_smbus_put(); a binding nobody holds is
+ * kept open for the next get, and only closed when the pool is full.
+ */
+struct obmc_mctp_binding* obmc_mctp_smbus_get(uint8_t bus, uint8_t src_addr, uint8_t dst_addr, uint8_t src_eid,
+                                              int pkt_size)
+{
+  struct mctp_pool_entry *entry = NULL;
+  struct obmc_mctp_binding *binding = NULL;
+  int i;
+
+  if (pkt_size < MCTP_PAYLOAD_SIZE + MCTP_HEADER_SIZE)
+    pkt_size = MCTP_PAYLOAD_SIZE + MCTP_HEADER_SIZE;
+
+  pthread_mutex_lock(&mctp_pool_mutex);
+  for (i = 0; i < MCTP_POOL_SIZE; i++) {
+    struct mctp_pool_entry *e = &mctp_pool[i];
+
+    if (e->binding && e->bus == bus && e->src_addr == src_addr &&
+        e->dst_addr == dst_addr && e->src_eid == src_eid &&
+        e->pkt_size == pkt_size) {
+      entry = e;
+      break;
+    }
+  }
+
+  if (entry == NULL) {
+    // A free slot, else the least recently used binding nobody holds
+    for (i = 0; i < MCTP_POOL_SIZE; i++) {
+      struct mctp_pool_entry *e = &mctp_pool[i];
+
+      if (e->binding == NULL) {
+        entry = e;
+        break;
+      }
+      if (e->refs == 0 && (entry == NULL || e->last_use < entry->last_use))
+        entry = e;
+    }
+    if (entry == NULL) {
+      pthread_mutex_unlock(&mctp_pool_mutex);
+      // All in use, the caller gets a binding of its own
+      return obmc_mctp_smbus_init(bus, src_addr, dst_addr, src_eid, pkt_size);
+    }
+    if (entry->binding) {
+      obmc_mctp_smbus_free(entry->binding);
+      entry->binding = NULL;
+    }
+
+    binding = obmc_mctp_smbus_init(bus, src_addr, dst_addr, src_eid, pkt_size);
+    if (binding == NULL) {
+      pthread_mutex_unlock(&mctp_pool_mutex);
+      return NULL;
+    }
+    entry->binding = binding;
+    entry->bus = bus;
+    entry->src_addr = src_addr;
+    entry->dst_addr = dst_addr;
+    entry->src_eid = src_eid;
+    entry->pkt_size = pkt_size;
+    entry->refs = 0;
+  }
+
+  entry->refs++;
+  entry->last_use = ++mctp_pool_clock;
+  binding = entry->binding;
+  // The packet size and TX parameters of libmctp are per process
+  mctp_smbus_set_pkt_size(pkt_size);
+  smbus_extra_params = binding->params;
+  pthread_mutex_unlock(&mctp_pool_mutex);
+
+  return binding;
+}
+
+void obmc_mctp_smbus_put(struct obmc_mctp_binding* binding)
+{
+  int i;
+
+  if (binding == NULL)
+    return;
+
+  pthread_mutex_lock(&mctp_pool_mutex);
+  for (i = 0; i < MCTP_POOL_SIZE; i++) {
+    if (mctp_pool[i].binding == binding) {
+      if (mctp_pool[i].refs > 0)
+        mctp_pool[i].refs--;
+      pthread_mutex_unlock(&mctp_pool_mutex);
+      return;
+    }
+  }
+  pthread_mutex_unlock(&mctp_pool_mutex);
+
+  // Not pooled, set up when the pool was full
+  obmc_mctp_smbus_free(binding);
+}
+
+// Close the bindings nobody holds
+void obmc_mctp_pool_flush(void)
+{
+  int i;
+
+  pthread_mutex_lock(&mctp_pool_mutex);
+  for (i = 0; i < MCTP_POOL_SIZE; i++) {
+    if (mctp_pool[i].binding && mctp_pool[i].refs == 0) {
+      obmc_mctp_smbus_free(mctp_pool[i].binding);
+      mctp_pool[i].binding = NULL;
+    }
+  }
+  pthread_mutex_unlock(&mctp_pool_mutex);
+}
+
+static void __attribute__((destructor)) mctp_pool_exit(void)
+{
+  obmc_mctp_pool_flush();
 }
 
 int mctp_smbus_send_data(struct mctp* mctp, uint8_t dst, uint8_t flag_tag,
@@ -405,78 +558,96 @@ int obmc_mctp_get_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
   return 0;
 }
 
+// One request/response exchange on a binding, which transmits on its own parameters
+static int obmc_mctp_xfer(struct obmc_mctp_binding *binding, uint8_t dst_eid, uint8_t tag,
+                          bool spdm, uint8_t *tbuf, int tlen, uint8_t *rbuf, int *rlen)
+{
+  struct mctp_binding_smbus *smbus = (struct mctp_binding_smbus *)binding->prot;
+  int ret;
+
+  pthread_mutex_lock(&binding->lock);
+  if (mctp_message_tx(binding->mctp, dst_eid, tbuf, tlen, true, tag, binding->params) < 0) {
+    syslog(LOG_ERR, "%s: MCTP TX error", __func__);
+    ret = -1;
+    goto bail;
+  }
+
+  if (spdm)
+    ret = mctp_smbus_recv_spdm_data_raw(binding->mctp, dst_eid, smbus, rbuf, -1);
+  else
+    ret = mctp_smbus_recv_data_timeout_raw(binding->mctp, dst_eid, smbus, rbuf, -1);
+  if (ret >= 0) {
+    *rlen = ret;
+    ret = 0;
+  }
+bail:
+  pthread_mutex_unlock(&binding->lock);
+  return ret;
+}
+
 int send_mctp_cmd(uint8_t bus, uint16_t src_addr, uint8_t dst_addr, uint8_t src_eid, uint8_t dst_eid,
                   uint8_t *tbuf, int tlen, uint8_t *rbuf, int *rlen)
 {
   int ret = -1;
-  uint8_t tag = 0;
   struct obmc_mctp_binding *mctp_binding;
-  struct mctp_binding_smbus *smbus;
 
-  mctp_binding = obmc_mctp_smbus_init(bus, src_addr, dst_addr, src_eid, NCSI_MAX_PAYLOAD);
+  mctp_binding = obmc_mctp_smbus_get(bus, src_addr, dst_addr, src_eid, NCSI_MAX_PAYLOAD);
   if (mctp_binding == NULL) {
     syslog(LOG_ERR, "%s: Error: mctp binding failed", __func__);
     return -1;
   }
-  smbus = (struct mctp_binding_smbus *)mctp_binding->prot;
-
-  tag |= MCTP_HDR_FLAG_TO;
-  ret = mctp_smbus_send_data(mctp_binding->mctp, dst_eid, tag, smbus, tbuf, tlen);
-  if (ret < 0) {
-    syslog(LOG_ERR, "error: %s send failed\n", __func__);
-    goto bail;
-  }
 
-  //ret = mctp_smbus_recv_data(mctp_binding->mctp, dst_eid, smbus, rbuf);
-  ret = mctp_smbus_recv_data_timeout_raw(mctp_binding->mctp, dst_eid, smbus, rbuf, -1);
-  if (ret < 0) {
+  ret = obmc_mctp_xfer(mctp_binding, dst_eid, 0, false, tbuf, tlen, rbuf, rlen);
+  if (ret < 0)
     printf("%s: error getting response\n", __func__);
-    goto bail;
-  } else {
-    *rlen = ret;
-    ret = 0;
-  }
 
-bail:
-  obmc_mctp_smbus_free(mctp_binding);
+  obmc_mctp_smbus_put(mctp_binding);
   return ret;
 }
 
 int send_spdm_cmd(uint8_t bus, uint16_t addr, uint8_t src_eid, uint8_t dst_eid,
                   uint8_t *tbuf, int tlen, uint8_t *rbuf, int *rlen)
 {
-  int ret = -1;
-  uint8_t tag = 0;
-  struct obmc_mctp_binding *mctp_binding;
-  struct mctp_binding_smbus *smbus;
+  struct obmc_mctp_msg msg = {tbuf, tlen, rbuf, 0};
+  int ret;
 
+  ret = send_spdm_cmds(bus, addr, src_eid, dst_eid, &msg, 1);
+  if (ret < 1)
+    return -1;
+  *rlen = msg.rlen;
+  return 0;
+}
 
-  mctp_binding = obmc_mctp_smbus_init(bus, addr, NIC_SLAVE_ADDR, src_eid, SPDM_MAX_PAYLOAD);
+/*
+ * Send the requests of a multi-message SPDM exchange in order over one
+ * binding, every one with the next message tag.
+ * Return the number of requests answered, stopping at the first failure.
+ */
+int send_spdm_cmds(uint8_t bus, uint16_t addr, uint8_t src_eid, uint8_t dst_eid,
+                   struct obmc_mctp_msg *msgs, int num)
+{
+  static uint8_t next_tag = 0;
+  struct obmc_mctp_binding *mctp_binding;
+  uint8_t tag;
+  int i;
+
+  mctp_binding = obmc_mctp_smbus_get(bus, addr, NIC_SLAVE_ADDR, src_eid, SPDM_MAX_PAYLOAD);
   if (mctp_binding == NULL) {
     syslog(LOG_ERR, "%s: Error: mctp binding failed", __func__);
     return -1;
   }
-  smbus = (struct mctp_binding_smbus *)mctp_binding->prot;
-
-  tag |= MCTP_HDR_FLAG_TO;
-  ret = mctp_smbus_send_data(mctp_binding->mctp, dst_eid, tag, smbus, tbuf, tlen);
-  if (ret < 0) {
-    printf("error: %s send failed\n", __func__);
-    goto bail;
-  }
 
-  ret = mctp_smbus_recv_spdm_data_raw(mctp_binding->mctp, dst_eid, smbus, rbuf, -1);
-  if (ret < 0) {
-    syslog(LOG_ERR, "%s: error getting response\n", __func__);
-    goto bail;
-  } else {
-    *rlen = ret;
-    ret = 0;
+  for (i = 0; i < num; i++) {
+    tag = __atomic_fetch_add(&next_tag, 1, __ATOMIC_RELAXED) & MCTP_HDR_TAG_MASK;
+    if (obmc_mctp_xfer(mctp_binding, dst_eid, tag, true, msgs[i].tbuf, msgs[i].tlen,
+                       msgs[i].rbuf, &msgs[i].rlen) < 0) {
+      syslog(LOG_ERR, "%s: error getting response %d of %d\n", __func__, i + 1, num);
+      break;
+    }
   }
 
-bail:
-  obmc_mctp_smbus_free(mctp_binding);
-  return ret;
+  obmc_mctp_smbus_put(mctp_binding);
+  return i;
 }
 
 static void pldmReq_to_mctpReq(struct mctp_pldm_req *req, pldm_cmd_req *pldmReq)
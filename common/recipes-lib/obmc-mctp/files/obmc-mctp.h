@@ -23,6 +23,7 @@
 extern "C" {
 #endif
 
+#include <pthread.h>
 #include <libmctp-smbus.h>
 #include <openbmc/ncsi.h>
 #include <openbmc/pldm.h>
@@ -116,6 +117,16 @@ struct mctp_pldm_rsp {
 struct obmc_mctp_binding {
   struct mctp *mctp;
   void *prot;
+  struct mctp_smbus_pkt_private *params;
+  pthread_mutex_t lock;  // one exchange at a time
+};
+
+// A request and its response of send_spdm_cmds()
+struct obmc_mctp_msg {
+  uint8_t *tbuf;
+  int tlen;
+  uint8_t *rbuf;
+  int rlen;
 };
 
 struct obmc_mctp_hdr {
@@ -150,6 +161,12 @@ struct obmc_mctp_binding* obmc_mctp_smbus_init(uint8_t bus, uint8_t src_addr, ui
                                                int pkt_size);
 void obmc_mctp_smbus_free(struct obmc_mctp_binding* binding);
 
+// Shared bindings, kept open by the process between commands
+struct obmc_mctp_binding* obmc_mctp_smbus_get(uint8_t bus, uint8_t src_addr, uint8_t dst_addr, uint8_t src_eid,
+                                              int pkt_size);
+void obmc_mctp_smbus_put(struct obmc_mctp_binding* binding);
+void obmc_mctp_pool_flush(void);
+
 // Debugging
 int mctp_smbus_send_data(struct mctp* mctp, uint8_t dst, uint8_t flag_tag,
                          struct mctp_binding_smbus *smbus,
@@ -180,6 +197,9 @@ int send_mctp_cmd(uint8_t bus, uint16_t src_addr, uint8_t dst_addr, uint8_t src_
 int send_spdm_cmd(uint8_t bus, uint16_t addr, uint8_t src_eid, uint8_t dst_eid,
                   uint8_t *tbuf, int tlen, uint8_t *rbuf, int *rlen);
 
+int send_spdm_cmds(uint8_t bus, uint16_t addr, uint8_t src_eid, uint8_t dst_eid,
+                   struct obmc_mctp_msg *msgs, int num);
+
 int obmc_mctp_get_tid(struct obmc_mctp_binding *binding, uint8_t dst_eid,
                       uint8_t tag, uint8_t iid,
                       uint8_t *tid);
@@ -29,6 +29,7 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <time.h>
 
 #define MMC_EXTCSD_SIZE		512
 
@@ -140,6 +141,57 @@ int mmc_extcsd_write_byte(mmc_dev_t *mmc, uint8_t index, uint8_t value);
 int mmc_read_report_wd(mmc_dev_t *mmc, mmc_extcsd_t *extcsd);
 int mmc_read_report_sk(mmc_dev_t *mmc, mmc_extcsd_t *extcsd);
 
+/*
+ * Health snapshot of an eMMC device, published by emmcd in
+ * MMC_HEALTH_SNAPSHOT_DIR/<mmcblk#>, so consumers don't need to issue
+ * SEND_EXT_CSD for data which changes over hours.
+ */
+#define MMC_HEALTH_SNAPSHOT_DIR		"/dev/shm/obmc-mmc"
+#define MMC_HEALTH_SNAPSHOT_MAGIC	0x4d4d4348	/* "MMCH" */
+#define MMC_HEALTH_SNAPSHOT_VERSION	1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+
+	int64_t extcsd_time;	/* time() <extcsd> was read, 0 if never */
+	mmc_extcsd_t extcsd;
+
+	/*
+	 * Writes from /sys/block/<mmcblk#>/stat: totals since boot, and
+	 * over the last <window_seconds> before <stat_time>.
+	 */
+	int64_t stat_time;	/* 0 if never sampled */
+	uint64_t write_ios;
+	uint64_t write_sectors;
+	uint64_t window_write_ios;
+	uint64_t window_write_sectors;
+	uint32_t window_seconds;
+	uint32_t reserved;
+} mmc_health_snapshot_t;
+
+/*
+ * mmc_health_snapshot_write() atomically replaces the snapshot of the
+ * given device (for example "/dev/mmcblk0"), and mmc_health_snapshot_read()
+ * reads it back.
+ *
+ * Both functions return 0 for success, and -1 on failures (ENOENT if no
+ * snapshot was published, EPROTO for a snapshot of another version).
+ */
+int mmc_health_snapshot_write(const char *device,
+			      const mmc_health_snapshot_t *snap);
+int mmc_health_snapshot_read(const char *device, mmc_health_snapshot_t *snap);
+
+/*
+ * mmc_extcsd_read_cached() returns the EXT_CSD of the published snapshot
+ * if it is at most <max_age> seconds old, and reads EXT_CSD from the
+ * device otherwise.
+ *
+ * Returns 0 for success, and -1 on failures.
+ */
+int mmc_extcsd_read_cached(mmc_dev_t *mmc, mmc_extcsd_t *extcsd,
+			   unsigned int max_age);
+
 /*
  * Below helper functions are used to convert a value to string.
  *
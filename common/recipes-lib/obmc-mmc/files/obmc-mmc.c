@@ -348,6 +348,110 @@ int mmc_extcsd_write_byte(mmc_dev_t *mmc, uint8_t index, uint8_t value)
 	return mmc_ioc_issue_cmd(mmc->cdev_fd, &idata);
 }
 
+static void mmc_health_snapshot_path(const char *device, char *path,
+				     size_t size)
+{
+	char pathname[PATH_MAX];
+
+	snprintf(pathname, sizeof(pathname), "%s", device);
+	snprintf(path, size, "%s/%s", MMC_HEALTH_SNAPSHOT_DIR,
+		 basename(pathname));
+}
+
+int mmc_health_snapshot_write(const char *device,
+			      const mmc_health_snapshot_t *snap)
+{
+	int fd, saved_errno;
+	ssize_t ret;
+	char path[PATH_MAX], tmp_path[PATH_MAX];
+	mmc_health_snapshot_t data;
+
+	if (device == NULL || device[0] == '\0' || snap == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(&data, snap, sizeof(data));
+	data.magic = MMC_HEALTH_SNAPSHOT_MAGIC;
+	data.version = MMC_HEALTH_SNAPSHOT_VERSION;
+
+	if (mkdir(MMC_HEALTH_SNAPSHOT_DIR, 0755) != 0 && errno != EEXIST)
+		return -1;
+	mmc_health_snapshot_path(device, path, sizeof(path));
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	/*
+	 * Readers never see a partial snapshot: it is renamed into place.
+	 */
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, &data, sizeof(data));
+	saved_errno = errno;
+	close(fd);
+	if (ret != sizeof(data)) {
+		unlink(tmp_path);
+		errno = ret < 0 ? saved_errno : EIO;
+		return -1;
+	}
+
+	return rename(tmp_path, path);
+}
+
+int mmc_health_snapshot_read(const char *device, mmc_health_snapshot_t *snap)
+{
+	int fd, saved_errno;
+	ssize_t ret;
+	char path[PATH_MAX];
+
+	if (device == NULL || device[0] == '\0' || snap == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	mmc_health_snapshot_path(device, path, sizeof(path));
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	ret = read(fd, snap, sizeof(*snap));
+	saved_errno = errno;
+	close(fd);
+	if (ret < 0) {
+		errno = saved_errno;
+		return -1;
+	}
+
+	if (ret != sizeof(*snap) ||
+	    snap->magic != MMC_HEALTH_SNAPSHOT_MAGIC ||
+	    snap->version != MMC_HEALTH_SNAPSHOT_VERSION) {
+		errno = EPROTO;
+		return -1;
+	}
+
+	return 0;
+}
+
+int mmc_extcsd_read_cached(mmc_dev_t *mmc, mmc_extcsd_t *extcsd,
+			   unsigned int max_age)
+{
+	time_t now = time(NULL);
+	mmc_health_snapshot_t snap;
+
+	if (!IS_VALID_MMC_DESC(mmc) || extcsd == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (mmc_health_snapshot_read(mmc->cdev_path, &snap) == 0 &&
+	    snap.extcsd_time != 0 && snap.extcsd_time <= now &&
+	    now - snap.extcsd_time <= max_age) {
+		memcpy(extcsd, &snap.extcsd, sizeof(*extcsd));
+		return 0;
+	}
+
+	return mmc_extcsd_read(mmc, extcsd);
+}
+
 /*
  * Read vendor specific device report from WD iNAND 7250.
  */
@@ -6,6 +6,8 @@ import typing as t
 clibobmc_mmc = ctypes.CDLL("libobmc-mmc.so.0.1")
 
 MMC_EXTCSD_SIZE = 512  # from mmc_int.h
+MMC_HEALTH_SNAPSHOT_MAGIC = 0x4D4D4348  # from mmc_int.h
+MMC_HEALTH_SNAPSHOT_VERSION = 1
 
 
 class LibObmcMmcException(Exception):
@@ -48,6 +50,27 @@ class mmc_extcsd_t(ctypes.Structure):
     _fields_ = [("raw", ctypes.c_uint8 * MMC_EXTCSD_SIZE)]
 
 
+class mmc_health_snapshot_t(ctypes.Structure):
+    """
+    From mmc_int.h
+    Health snapshot of an eMMC device, published by emmcd.
+    """
+
+    _fields_ = [
+        ("magic", ctypes.c_uint32),
+        ("version", ctypes.c_uint32),
+        ("extcsd_time", ctypes.c_int64),
+        ("extcsd", mmc_extcsd_t),
+        ("stat_time", ctypes.c_int64),
+        ("write_ios", ctypes.c_uint64),
+        ("write_sectors", ctypes.c_uint64),
+        ("window_write_ios", ctypes.c_uint64),
+        ("window_write_sectors", ctypes.c_uint64),
+        ("window_seconds", ctypes.c_uint32),
+        ("reserved", ctypes.c_uint32),
+    ]
+
+
 class mmc_cid_t(ctypes.Structure):
     """
     From mmc_int.h
@@ -108,6 +131,30 @@ def mmc_extcsd_read(mmc: mmc_dev_t) -> mmc_extcsd_t:
     return extcsd
 
 
+def mmc_extcsd_read_cached(mmc: mmc_dev_t, max_age: int) -> mmc_extcsd_t:
+    extcsd = mmc_extcsd_t()
+
+    ret = clibobmc_mmc.mmc_extcsd_read_cached(
+        ctypes.pointer(mmc), ctypes.pointer(extcsd), ctypes.c_uint(max_age)
+    )
+    if ret != 0:
+        raise LibObmcMmcException("mmc_extcsd_read_cached() returned " + str(ret))
+
+    return extcsd
+
+
+def mmc_health_snapshot_read(dev_path: str) -> mmc_health_snapshot_t:
+    snap = mmc_health_snapshot_t()
+
+    ret = clibobmc_mmc.mmc_health_snapshot_read(
+        dev_path.encode("utf-8"), ctypes.pointer(snap)
+    )
+    if ret != 0:
+        raise LibObmcMmcException("mmc_health_snapshot_read() returned " + str(ret))
+
+    return snap
+
+
 ## Utils
 def list_devices() -> t.List[str]:
     return glob.glob("/dev/mmcblk[0-9]")
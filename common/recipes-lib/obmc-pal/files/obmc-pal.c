@@ -29,6 +29,9 @@
 #include <time.h>
 #include <sys/reboot.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include <openbmc/kv.h>
 #include <openbmc/ipmi.h>
 #include <openbmc/ipmb.h>
@@ -806,6 +809,243 @@ pal_get_dev_capability(uint8_t fru, uint8_t dev, unsigned int *caps)
   return 0;
 }
 
+/*
+ * Per process memo of the static FRU metadata above, for the callers that
+ * resolve it on every poll (sensord, ipmid, sensor-util, fw-util): on some
+ * platforms each lookup compares strings, reads a presence GPIO or a kv.
+ *
+ * Only successful lookups are kept. An entry is valid as long as the
+ * generation of its FRU in FRU_CACHE_SHM has not moved; a hot-plug or a
+ * presence/SDR change calls pal_fru_cache_invalidate(), which bumps it for
+ * every process. Without the shm segment the cache only follows the
+ * invalidations of its own process.
+ */
+#define FRU_CACHE_SHM "/pal_fru_cache"
+#define FRU_CACHE_NUM 256
+#define FRU_CACHE_NAME_LEN 32
+#define FRU_CACHE_IDS 32
+
+enum {
+  FRU_CACHE_NAME = 1 << 0,
+  FRU_CACHE_SENSORS = 1 << 1,
+  FRU_CACHE_CAPS = 1 << 2,
+};
+
+typedef struct {
+  /* Generation of every FRU, the last one of all of them */
+  uint32_t gen[FRU_CACHE_NUM + 1];
+} fru_cache_shm_t;
+
+typedef struct {
+  uint32_t gen;
+  uint8_t valid;
+  char name[FRU_CACHE_NAME_LEN];
+  uint8_t *sensor_list;
+  int sensor_cnt;
+  unsigned int caps;
+} fru_cache_t;
+
+typedef struct {
+  uint32_t gen;
+  uint8_t fru;
+  char str[FRU_CACHE_NAME_LEN];
+} fru_id_cache_t;
+
+static pthread_mutex_t fru_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static fru_cache_shm_t *fru_cache_shm;
+static fru_cache_shm_t fru_cache_local;
+static fru_cache_t fru_cache[FRU_CACHE_NUM];
+static fru_id_cache_t fru_id_cache[FRU_CACHE_IDS];
+static int fru_id_cache_cnt;
+
+static fru_cache_shm_t *
+fru_cache_gens(void)
+{
+  static bool tried;
+  void *ptr;
+  int fd;
+
+  if (fru_cache_shm != NULL || tried)
+    return fru_cache_shm != NULL ? fru_cache_shm : &fru_cache_local;
+  tried = true;
+
+  fd = shm_open(FRU_CACHE_SHM, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    syslog(LOG_INFO, "%s: shm_open failed, errno = %d", __func__, errno);
+    return &fru_cache_local;
+  }
+  /* A new segment reads as zeroes, the same as the local generations */
+  if (ftruncate(fd, sizeof(fru_cache_shm_t)) == 0) {
+    ptr = mmap(NULL, sizeof(fru_cache_shm_t), PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+    if (ptr != MAP_FAILED)
+      fru_cache_shm = ptr;
+  }
+  close(fd);
+  return fru_cache_shm != NULL ? fru_cache_shm : &fru_cache_local;
+}
+
+/* Both counters only grow, so their sum changes with either of them */
+static uint32_t
+fru_cache_gen(uint8_t fru)
+{
+  fru_cache_shm_t *g = fru_cache_gens();
+
+  return __atomic_load_n(&g->gen[fru], __ATOMIC_ACQUIRE) +
+         __atomic_load_n(&g->gen[FRU_CACHE_NUM], __ATOMIC_ACQUIRE);
+}
+
+/* Called with fru_cache_mutex held */
+static fru_cache_t *
+fru_cache_get(uint8_t fru)
+{
+  fru_cache_t *c = &fru_cache[fru];
+  uint32_t gen = fru_cache_gen(fru);
+
+  if (c->gen != gen) {
+    c->gen = gen;
+    c->valid = 0;
+  }
+  return c;
+}
+
+void
+pal_fru_cache_invalidate(int fru)
+{
+  fru_cache_shm_t *g;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  g = fru_cache_gens();
+  if (fru < 0 || fru >= FRU_CACHE_NUM)
+    fru = FRU_CACHE_NUM;
+  __atomic_add_fetch(&g->gen[fru], 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&fru_cache_mutex);
+}
+
+int
+pal_get_fru_name_cached(uint8_t fru, char *name)
+{
+  fru_cache_t *c;
+  int ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  if (c->valid & FRU_CACHE_NAME) {
+    strcpy(name, c->name);
+    pthread_mutex_unlock(&fru_cache_mutex);
+    return PAL_EOK;
+  }
+  pthread_mutex_unlock(&fru_cache_mutex);
+
+  /* The PAL may sleep or take locks of its own, call it unlocked */
+  ret = pal_get_fru_name(fru, name);
+  if (ret != PAL_EOK || strlen(name) >= FRU_CACHE_NAME_LEN)
+    return ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  strcpy(c->name, name);
+  c->valid |= FRU_CACHE_NAME;
+  pthread_mutex_unlock(&fru_cache_mutex);
+  return ret;
+}
+
+int
+pal_get_fru_sensor_list_cached(uint8_t fru, uint8_t **sensor_list, int *cnt)
+{
+  fru_cache_t *c;
+  int ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  if (c->valid & FRU_CACHE_SENSORS) {
+    *sensor_list = c->sensor_list;
+    *cnt = c->sensor_cnt;
+    pthread_mutex_unlock(&fru_cache_mutex);
+    return 0;
+  }
+  pthread_mutex_unlock(&fru_cache_mutex);
+
+  ret = pal_get_fru_sensor_list(fru, sensor_list, cnt);
+  if (ret < 0)
+    return ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  c->sensor_list = *sensor_list;
+  c->sensor_cnt = *cnt;
+  c->valid |= FRU_CACHE_SENSORS;
+  pthread_mutex_unlock(&fru_cache_mutex);
+  return ret;
+}
+
+int
+pal_get_fru_capability_cached(uint8_t fru, unsigned int *caps)
+{
+  fru_cache_t *c;
+  int ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  if (c->valid & FRU_CACHE_CAPS) {
+    *caps = c->caps;
+    pthread_mutex_unlock(&fru_cache_mutex);
+    return PAL_EOK;
+  }
+  pthread_mutex_unlock(&fru_cache_mutex);
+
+  ret = pal_get_fru_capability(fru, caps);
+  if (ret != PAL_EOK)
+    return ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  c = fru_cache_get(fru);
+  c->caps = *caps;
+  c->valid |= FRU_CACHE_CAPS;
+  pthread_mutex_unlock(&fru_cache_mutex);
+  return ret;
+}
+
+int
+pal_get_fru_id_cached(char *str, uint8_t *fru)
+{
+  fru_id_cache_t *e;
+  int i, ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  for (i = 0; i < fru_id_cache_cnt; i++) {
+    e = &fru_id_cache[i];
+    if (strcmp(e->str, str) == 0 && e->gen == fru_cache_gen(e->fru)) {
+      *fru = e->fru;
+      pthread_mutex_unlock(&fru_cache_mutex);
+      return PAL_EOK;
+    }
+  }
+  pthread_mutex_unlock(&fru_cache_mutex);
+
+  ret = pal_get_fru_id(str, fru);
+  if (ret != PAL_EOK || strlen(str) >= FRU_CACHE_NAME_LEN)
+    return ret;
+
+  pthread_mutex_lock(&fru_cache_mutex);
+  for (i = 0; i < fru_id_cache_cnt; i++) {
+    if (strcmp(fru_id_cache[i].str, str) == 0)
+      break;
+  }
+  if (i == fru_id_cache_cnt) {
+    /* Full: the stale entries are not worth tracking, start over */
+    if (i == FRU_CACHE_IDS)
+      i = fru_id_cache_cnt = 0;
+    fru_id_cache_cnt++;
+  }
+  e = &fru_id_cache[i];
+  strcpy(e->str, str);
+  e->fru = *fru;
+  e->gen = fru_cache_gen(*fru);
+  pthread_mutex_unlock(&fru_cache_mutex);
+  return ret;
+}
+
 int __attribute__((weak))
 pal_get_dev_fruid_name(uint8_t fru, uint8_t dev, char *name)
 {
@@ -1781,6 +2021,13 @@ pal_handle_dcmi(uint8_t fru, uint8_t *tbuf, uint8_t tlen, uint8_t *rbuf, uint8_t
   return PAL_EOK;
 }
 
+// Sensor of the FRU whose history ipmid serves DCMI Get Power Reading from
+int __attribute__((weak))
+pal_get_dcmi_power_sensor(uint8_t fru, uint8_t *snr_num)
+{
+  return PAL_ENOTSUP;
+}
+
 int __attribute__((weak))
 pal_is_fru_ready(uint8_t fru, uint8_t *status)
 {
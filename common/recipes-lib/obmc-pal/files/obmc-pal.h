@@ -71,6 +71,17 @@ typedef struct {
 
 } thresh_sensor_t;
 
+/* Access channel of a sensor, see pal_get_sensor_channel(). sensord reads
+ * the sensors of a channel one at a time, and channels in parallel. */
+enum {
+  SENSOR_CHANNEL_FRU = 0,
+  SENSOR_CHANNEL_I2C,
+  SENSOR_CHANNEL_BIC,
+  SENSOR_CHANNEL_PECI,
+  SENSOR_CHANNEL_NVME_MI,
+};
+#define SENSOR_CHANNEL(type, id) ((uint16_t)(((type) << 8) | ((id) & 0xff)))
+
 typedef struct _sensor_info_t {
   bool valid;
   sdr_full_t sdr;
@@ -406,7 +417,10 @@ int pal_slotid_to_fruid(int slotid);
 int pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt);
 int pal_get_sensor_poll_interval(uint8_t fru, uint8_t sensor_num, uint32_t *value);
 int pal_alter_sensor_poll_interval(uint8_t fru, uint8_t sensor_num, uint32_t *value);
+/* Path of the SDR file of the FRU, as refreshed by the BIC or the host */
+int pal_sensor_sdr_path(uint8_t fru, char *path);
 bool pal_sensor_is_source_host(uint8_t fru, uint8_t sensor_num);
+int pal_get_sensor_channel(uint8_t fru, uint8_t sensor_num, uint16_t *channel);
 bool pal_is_host_snr_available(uint8_t fru, uint8_t sensor_id);
 int pal_correct_sensor_reading_from_cache(uint8_t fru, uint8_t sensor_id, float *value);
 int pal_get_fru_discrete_list(uint8_t fru, uint8_t **sensor_list, int *cnt);
@@ -453,6 +467,7 @@ int pal_fan_recovered_handle(int fan_num);
 void pal_inform_bic_mode(uint8_t fru, uint8_t mode);
 void pal_update_ts_sled(void);
 int pal_handle_dcmi(uint8_t fru, uint8_t *tbuf, uint8_t tlen, uint8_t *rbuf, uint8_t *rlen);
+int pal_get_dcmi_power_sensor(uint8_t fru, uint8_t *snr_num);
 int pal_is_fru_ready(uint8_t fru, uint8_t *status);
 int pal_is_slot_server(uint8_t fru);
 int pal_is_slot_support_update(uint8_t fru);
@@ -499,6 +514,16 @@ int pal_bypass_dev_card(uint8_t slot, uint8_t *req_data, uint8_t req_len, uint8_
 void pal_set_def_restart_cause(uint8_t slot);
 int pal_compare_fru_data(char *fru_out, char *fru_in, int cmp_size);
 int pal_sensor_thresh_modify(uint8_t fru,  uint8_t sensor_num, uint8_t thresh_type, float value);
+/* A threshold change of pal_sensor_thresh_modify_list() */
+typedef struct {
+  uint8_t snr_num;
+  uint8_t thresh_type;
+  float value;
+} thresh_modify_t;
+/* Apply cnt threshold changes to the sensors of a FRU at once, in order:
+ * none is applied if one is invalid. sensord then reloads the thresholds
+ * of the changed sensors only. */
+int pal_sensor_thresh_modify_list(uint8_t fru, const thresh_modify_t *mods, int cnt);
 int pal_get_all_thresh_from_file(uint8_t fru, thresh_sensor_t *sinfo, int mode);
 int pal_copy_all_thresh_to_file(uint8_t fru, thresh_sensor_t *sinfo);
 int pal_get_thresh_from_file(uint8_t fru, uint8_t snr_num, thresh_sensor_t *sinfo);
@@ -559,6 +584,17 @@ int pal_get_fru_type_list(fru_type_t fru_type, const char ***fru_list, uint8_t*
 int pal_get_fw_ver(uint8_t slot, uint8_t *req_data, uint8_t *res_data, uint8_t *res_len);
 int pal_get_fru_capability(uint8_t fru, unsigned int *caps);
 int pal_get_dev_capability(uint8_t fru, uint8_t dev, unsigned int *caps);
+/*
+ * Memoized pal_get_fru_name()/_sensor_list()/_id()/_capability(), valid
+ * until pal_fru_cache_invalidate() of the FRU (any process) or of all the
+ * FRUs (fru < 0, e.g. FRU_CACHE_ALL).
+ */
+#define FRU_CACHE_ALL (-1)
+int pal_get_fru_name_cached(uint8_t fru, char *name);
+int pal_get_fru_sensor_list_cached(uint8_t fru, uint8_t **sensor_list, int *cnt);
+int pal_get_fru_id_cached(char *fru_str, uint8_t *fru);
+int pal_get_fru_capability_cached(uint8_t fru, unsigned int *caps);
+void pal_fru_cache_invalidate(int fru);
 bool pal_is_aggregate_snr_valid(uint8_t snr_num);
 int pal_set_ioc_fw_recovery(uint8_t *ioc_recovery_setting, uint8_t req_len, uint8_t *res_data, uint8_t *res_len);
 int pal_get_ioc_fw_recovery(uint8_t ioc_recovery_component, uint8_t *res_data, uint8_t *res_len);
@@ -17,6 +17,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -24,6 +25,7 @@
 #include <syslog.h>
 #include <unistd.h>
 #include <float.h>
+#include <math.h>
 #include <time.h>
 #include <sys/file.h>
 #include <sys/types.h>
@@ -31,6 +33,8 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <openbmc/kv.h>
 #include "obmc-pal.h"
 #include "obmc_pal_sensors.h"
@@ -49,29 +53,116 @@
 
 #define CACHE_READ_RETRY 5
 
+/* The history of all the sensors of a FRU is a single shm segment: a
+ * header, then a slot per sensor (in the order of their first sample).
+ * A slot holds the fine and coarse history of the sensor as arrays of
+ * every field, so a scan of the timestamps (then of the values) reads
+ * contiguous memory.
+ *
+ * Every history has a sequence lock, odd while a writer updates it.
+ * Readers retry if it changed meanwhile. Slots are only ever added, under
+ * a flock of the segment: processes remap when a slot is beyond their
+ * mapping.
+ */
+#define SENSOR_HISTORY_MAGIC    0x53484953 /* "SHIS" */
+#define SENSOR_HISTORY_VERSION  6
+#define MAX_FRU_SENSORS         256
+#define MAX_HISTORY_FRUS        256
+/* Spins on an odd sequence before the writer is assumed dead. */
+#define SHM_LOCK_SPINS  10000
+#define SHM_READ_TRIES  100
+
+/* Every coarse entry has a quantile sketch of its samples (as DDSketch):
+ * bins of exponentially growing width, so the percentiles are within
+ * SKETCH_ALPHA of the sample values. A window of SKETCH_BINS bins is
+ * kept, samples below it count in its lowest bin, so the accuracy of
+ * the upper percentiles wins. Samples at or below SKETCH_MIN_VALUE
+ * count as 0.
+ */
+#define SKETCH_BINS       32
+#define SKETCH_ALPHA      0.025
+#define SKETCH_GAMMA      ((1 + SKETCH_ALPHA) / (1 - SKETCH_ALPHA))
+#define SKETCH_MIN_VALUE  1e-3
+/* Bins of the sketch merged over the entries of a query. */
+#define SKETCH_MERGED_BINS 1024
+
+/* The fine and coarse histories also keep the min, max and total of
+ * every HIST_BLOCK entries of their ring as the leaves of a segment tree
+ * of n blocks: node n + b is block b, node i merges nodes 2i and 2i + 1.
+ * The min, average and max of a window are then read from its (partial)
+ * end blocks and O(log n) nodes. A block is rebuilt from its entries on
+ * every write, so a block entirely in a window holds just its samples.
+ */
+#define HIST_BLOCK          8
+#define HIST_BLOCKS(len)    (((len) + HIST_BLOCK - 1) / HIST_BLOCK)
+#define FINE_BLOCKS         HIST_BLOCKS(MAX_DATA_NUM)
+#define COARSE_BLOCKS       HIST_BLOCKS(MAX_COARSE_DATA_NUM)
+
+typedef struct {
+  float min;
+  float max;
+  double total;
+} hist_node_t;
+
 typedef struct {
-  long log_time;
-  float value;
-} sensor_data_t;
+  uint32_t seq;
+  int32_t index;
+  uint32_t log_time[MAX_DATA_NUM];
+  float value[MAX_DATA_NUM];
+  hist_node_t tree[2 * FINE_BLOCKS];
+} sensor_fine_hist_t;
 
 typedef struct {
-  int index;
-  sensor_data_t data[MAX_DATA_NUM];
-} sensor_shm_t;
+  uint32_t seq;
+  int32_t index;
+  uint32_t log_time[MAX_COARSE_DATA_NUM];
+  float sum[MAX_COARSE_DATA_NUM];
+  float count[MAX_COARSE_DATA_NUM];
+  float avg[MAX_COARSE_DATA_NUM];
+  float max[MAX_COARSE_DATA_NUM];
+  float min[MAX_COARSE_DATA_NUM];
+  /* Sketch index of the first bin, samples counted as 0, bins. */
+  int16_t sketch_offset[MAX_COARSE_DATA_NUM];
+  uint16_t sketch_zero[MAX_COARSE_DATA_NUM];
+  uint16_t sketch[MAX_COARSE_DATA_NUM][SKETCH_BINS];
+  /* Over the min, max and avg of the entries. */
+  hist_node_t tree[2 * COARSE_BLOCKS];
+} sensor_coarse_hist_t;
 
 typedef struct {
-  long log_time;
-  float sum;
-  float count;
-  float avg;
-  float max;
-  float min;
-} sensor_coarse_data_t;
+  /* Time of the last sensor_cache_write(), available or not. */
+  uint32_t last_update;
+  /* Count of sensor_cache_write(), see sensor_cache_generation(). */
+  uint32_t generation;
+  sensor_fine_hist_t fine;
+  sensor_coarse_hist_t coarse;
+  /* Reads by sensor_raw_read(). */
+  uint32_t perf_seq;
+  sensor_perf_t perf;
+} sensor_hist_slot_t;
 
 typedef struct {
-  int index;
-  sensor_coarse_data_t data[MAX_COARSE_DATA_NUM];
-} sensor_coarse_shm_t;
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t num_slots;
+  /* Slot + 1 of every sensor, 0 if it has none yet. */
+  uint16_t slot_of[MAX_FRU_SENSORS];
+} sensor_hist_header_t;
+
+#define HIST_SLOTS_OFFSET ((sizeof(sensor_hist_header_t) + 63) & ~(size_t)63)
+#define HIST_SIZE(n) (HIST_SLOTS_OFFSET + (n) * sizeof(sensor_hist_slot_t))
+
+/* Mapping of the history of a FRU in this process. */
+typedef struct {
+  int fd;
+  sensor_hist_header_t *hdr;
+  size_t size;
+} sensor_hist_map_t;
+
+static sensor_hist_map_t hist_maps[MAX_HISTORY_FRUS];
+/* Held shared while a slot is used, exclusively to (re)map. */
+static pthread_rwlock_t hist_maps_lock = PTHREAD_RWLOCK_INITIALIZER;
 
 static int
 sensor_key_get(uint8_t fru, uint8_t sensor_num, char *key)
@@ -81,7 +172,7 @@ sensor_key_get(uint8_t fru, uint8_t sensor_num, char *key)
   if (fru == AGGREGATE_SENSOR_FRU_ID) {
     strcpy(fruname, AGGREGATE_SENSOR_FRU_NAME);
   } else {
-    if (pal_get_fru_name(fru, fruname))
+    if (pal_get_fru_name_cached(fru, fruname))
       return -1;
   }
   sprintf(key, "%s_sensor%d", fruname, sensor_num);
@@ -89,143 +180,416 @@ sensor_key_get(uint8_t fru, uint8_t sensor_num, char *key)
 }
 
 static int
-sensor_coarse_key_get(uint8_t fru, uint8_t sensor_num, char *key)
+sensor_history_key_get(uint8_t fru, char *key)
 {
-  int ret = sensor_key_get(fru, sensor_num, key);
-  if (ret) {
-    return ret;
+  char fruname[32];
+
+  if (fru == AGGREGATE_SENSOR_FRU_ID) {
+    strcpy(fruname, AGGREGATE_SENSOR_FRU_NAME);
+  } else {
+    if (pal_get_fru_name_cached(fru, fruname))
+      return -1;
   }
-  strcat(key, "_coarse");
+  sprintf(key, "%s_sensor_history", fruname);
   return 0;
 }
 
+static void
+sensor_shm_write_lock(uint32_t *seq)
+{
+  uint32_t last = __atomic_load_n(seq, __ATOMIC_RELAXED);
+  int spins = 0;
+
+  for (;;) {
+    uint32_t s = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    if (s != last) {
+      last = s;
+      spins = 0;
+    }
+    /* Take it when even, or from a writer which died holding it. */
+    if (!(s & 1) || ++spins > SHM_LOCK_SPINS) {
+      uint32_t next = (s & 1) ? s + 2 : s + 1;
+      if (__atomic_compare_exchange_n(seq, &s, next, false,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        if (spins > SHM_LOCK_SPINS)
+          syslog(LOG_WARNING, "%s: took over a stale history lock", __FUNCTION__);
+        /* The odd sequence is seen before any of the updates. */
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        return;
+      }
+      continue;
+    }
+    sched_yield();
+  }
+}
+
+static void
+sensor_shm_write_unlock(uint32_t *seq)
+{
+  __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1,
+                   __ATOMIC_RELEASE);
+}
+
+/* Sequence to check the read against, waiting (for a while) for a
+ * writer to be done. */
+static uint32_t
+sensor_shm_read_begin(uint32_t *seq)
+{
+  uint32_t s;
+  int spins = 0;
+
+  while (((s = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1) &&
+         ++spins < SHM_LOCK_SPINS) {
+    sched_yield();
+  }
+  return s;
+}
+
+/* Whether the history was updated since read_begin. */
+static bool
+sensor_shm_read_retry(uint32_t *seq, uint32_t start)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (start & 1) || __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+}
+
+/* Open (creating it if asked) and map the history of the FRU, or remap
+ * it to the slots added since. Needs hist_maps_lock exclusively. */
 static int
-cache_set_coarse_history(char *key, float value) {
-  int fd;
-  int share_size = sizeof(sensor_coarse_shm_t);
+sensor_hist_map(uint8_t fru, bool create)
+{
+  sensor_hist_map_t *m = &hist_maps[fru];
+  char key[MAX_KEY_LEN] = {0};
+  struct stat st;
   void *ptr;
-  sensor_coarse_shm_t *snr_shm;
-  long current_time;
   int ret = ERR_FAILURE;
 
-  fd = shm_open(key, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return -1;
+  if (m->hdr == NULL) {
+    if (sensor_history_key_get(fru, key))
+      return ERR_UNKNOWN_FRU;
+    m->fd = shm_open(key, O_RDWR | (create ? O_CREAT : 0), S_IRUSR | S_IWUSR);
+    if (m->fd < 0) {
+      DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
+      return ERR_FAILURE;
+    }
   }
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
+  if (flock(m->fd, LOCK_EX) < 0) {
+    syslog(LOG_INFO, "%s: file-lock fru %u failed errno = %d\n", __FUNCTION__, fru, errno);
     goto close_bail;
   }
-
-  if (ftruncate(fd, share_size) != 0) {
-    syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+  if (fstat(m->fd, &st) != 0) {
+    goto unlock_bail;
+  }
+  if ((size_t)st.st_size < HIST_SLOTS_OFFSET) {
+    /* Format it, the header is filled in below. */
+    if (ftruncate(m->fd, HIST_SLOTS_OFFSET) != 0) {
+      syslog(LOG_INFO, "%s: truncate fru %u failed errno = %d\n", __FUNCTION__, fru, errno);
+      goto unlock_bail;
+    }
+    st.st_size = HIST_SLOTS_OFFSET;
   }
 
-  ptr = mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (m->hdr != NULL) {
+    munmap(m->hdr, m->size);
+    m->hdr = NULL;
+  }
+  ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
   if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
+    syslog(LOG_INFO, "%s: mmap fru %u failed, errno = %d", __FUNCTION__, fru, errno);
     goto unlock_bail;
   }
+  m->hdr = ptr;
+  m->size = st.st_size;
 
-  snr_shm = (sensor_coarse_shm_t *)ptr;
-  current_time = time(NULL);
-  if (snr_shm->data[snr_shm->index].log_time == 0) {
-    sensor_coarse_data_t *s = &snr_shm->data[snr_shm->index];
-    s->log_time = current_time;
-    s->avg = s->sum = s->max = s->min = value;
-    s->count = 1;
-  } else {
-    sensor_coarse_data_t *s = &snr_shm->data[snr_shm->index];
-    /* If the log was started less than an hour ago, then 
-     * continue to log to this entry */
-    if (difftime(current_time, s->log_time) < COARSE_THRESHOLD) {
-      s->sum += value;
-      s->count += 1;
-      if (value > s->max)
-        s->max = value;
-      if (value < s->min)
-        s->min = value;
-      s->avg = s->sum / s->count;
-    } else {
-      /* Start logging to the next entry */
-      snr_shm->index = (snr_shm->index + 1) % MAX_COARSE_DATA_NUM;
-      s = &snr_shm->data[snr_shm->index];
-      memset(s, 0, sizeof(*s));
-      s->log_time = current_time;
-      s->avg = s->sum = s->max = s->min = value;
-      s->count = 1;
-    }
+  if (m->hdr->magic != SENSOR_HISTORY_MAGIC) {
+    m->hdr->version = SENSOR_HISTORY_VERSION;
+    m->hdr->slot_size = sizeof(sensor_hist_slot_t);
+    m->hdr->num_slots = 0;
+    m->hdr->magic = SENSOR_HISTORY_MAGIC;
   }
-
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
+  if (m->hdr->version != SENSOR_HISTORY_VERSION ||
+      m->hdr->slot_size != sizeof(sensor_hist_slot_t)) {
+    syslog(LOG_WARNING, "%s: unknown history layout of fru %u", __FUNCTION__, fru);
+    munmap(m->hdr, m->size);
+    m->hdr = NULL;
     goto unlock_bail;
   }
   ret = 0;
 
 unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
-  }
+  flock(m->fd, LOCK_UN);
 close_bail:
-  close(fd);
+  if (m->hdr == NULL) {
+    close(m->fd);
+    m->fd = -1;
+  }
   return ret;
 }
 
+/* Give the sensor a slot in the history of the FRU. Needs hist_maps_lock
+ * exclusively, and the FRU mapped. */
 static int
-cache_set_history(char *key, float value) {
-
-  int fd;
-  int share_size = sizeof(sensor_shm_t);
-  void *ptr;
-  sensor_shm_t *snr_shm;
+sensor_hist_add_slot(uint8_t fru, uint8_t sensor_num)
+{
+  sensor_hist_map_t *m = &hist_maps[fru];
+  uint32_t n;
   int ret = ERR_FAILURE;
 
-  fd = shm_open(key, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return -1;
+  if (flock(m->fd, LOCK_EX) < 0) {
+    return ERR_FAILURE;
   }
+  /* Unless another process just did. */
+  if (m->hdr->slot_of[sensor_num] == 0) {
+    n = m->hdr->num_slots;
+    if (ftruncate(m->fd, HIST_SIZE(n + 1)) != 0) {
+      syslog(LOG_INFO, "%s: truncate fru %u failed errno = %d\n", __FUNCTION__, fru, errno);
+      goto unlock_bail;
+    }
+    m->hdr->num_slots = n + 1;
+    m->hdr->slot_of[sensor_num] = n + 1;
+  }
+  ret = 0;
+unlock_bail:
+  flock(m->fd, LOCK_UN);
+  return ret;
+}
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+/* Slot of the sensor, with hist_maps_lock held shared until
+ * sensor_hist_put(). Creates the history when asked. */
+static sensor_hist_slot_t *
+sensor_hist_get(uint8_t fru, uint8_t sensor_num, bool create)
+{
+  sensor_hist_map_t *m = &hist_maps[fru];
+  uint16_t slot;
+
+  for (;;) {
+    pthread_rwlock_rdlock(&hist_maps_lock);
+    if (m->hdr != NULL && (slot = m->hdr->slot_of[sensor_num]) != 0 &&
+        HIST_SIZE(slot) <= m->size) {
+      return (sensor_hist_slot_t *)((char *)m->hdr + HIST_SIZE(slot - 1));
+    }
+    pthread_rwlock_unlock(&hist_maps_lock);
+
+    pthread_rwlock_wrlock(&hist_maps_lock);
+    if (m->hdr == NULL || m->hdr->slot_of[sensor_num] == 0 ||
+        HIST_SIZE(m->hdr->slot_of[sensor_num]) > m->size) {
+      if (sensor_hist_map(fru, create) ||
+          (m->hdr->slot_of[sensor_num] == 0 &&
+           (!create || sensor_hist_add_slot(fru, sensor_num) ||
+            sensor_hist_map(fru, create)))) {
+        pthread_rwlock_unlock(&hist_maps_lock);
+        return NULL;
+      }
+    }
+    pthread_rwlock_unlock(&hist_maps_lock);
   }
+}
 
-  if (ftruncate(fd, share_size) != 0) {
-    syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
+static void
+sensor_hist_put(void)
+{
+  pthread_rwlock_unlock(&hist_maps_lock);
+}
+
+static void
+hist_node_reset(hist_node_t *node)
+{
+  node->min = FLT_MAX;
+  node->max = -FLT_MAX;
+  node->total = 0;
+}
+
+static void
+hist_node_add(hist_node_t *node, float min, float max, double total)
+{
+  if (min < node->min)
+    node->min = min;
+  if (max > node->max)
+    node->max = max;
+  node->total += total;
+}
+
+/* Rebuild the block of entry i of a ring of len entries, then the nodes
+ * above it. val is what the totals add up. */
+static void
+hist_tree_update(hist_node_t *tree, int len, int i,
+    const float *min, const float *max, const float *val)
+{
+  int n = HIST_BLOCKS(len), b = i / HIST_BLOCK;
+  int from = b * HIST_BLOCK, to = from + HIST_BLOCK, k;
+  hist_node_t *node = &tree[n + b];
+
+  if (to > len)
+    to = len;
+  hist_node_reset(node);
+  for (k = from; k < to; k++) {
+    hist_node_add(node, min[k], max[k], val[k]);
+  }
+  for (k = (n + b) / 2; k >= 1; k /= 2) {
+    node = &tree[k];
+    *node = tree[2 * k];
+    hist_node_add(node, tree[2 * k + 1].min, tree[2 * k + 1].max,
+        tree[2 * k + 1].total);
   }
+}
 
-  ptr = mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+/* Add the entries [from, to) of a ring of len entries to agg. */
+static void
+hist_tree_query(const hist_node_t *tree, int len, int from, int to,
+    const float *min, const float *max, const float *val, hist_node_t *agg)
+{
+  int n = HIST_BLOCKS(len);
+  int l = HIST_BLOCKS(from), r = to == len ? n : to / HIST_BLOCK;
+  int k;
+
+  if (l >= r) {
+    for (k = from; k < to; k++) {
+      hist_node_add(agg, min[k], max[k], val[k]);
+    }
+    return;
+  }
+  for (k = from; k < l * HIST_BLOCK; k++) {
+    hist_node_add(agg, min[k], max[k], val[k]);
+  }
+  for (k = r * HIST_BLOCK; k < to; k++) {
+    hist_node_add(agg, min[k], max[k], val[k]);
+  }
+  for (l += n, r += n; l < r; l /= 2, r /= 2) {
+    if (l & 1) {
+      hist_node_add(agg, tree[l].min, tree[l].max, tree[l].total);
+      l++;
+    }
+    if (r & 1) {
+      r--;
+      hist_node_add(agg, tree[r].min, tree[r].max, tree[r].total);
+    }
   }
+}
 
-  snr_shm = (sensor_shm_t *)ptr;
-  snr_shm->data[snr_shm->index].log_time = time(NULL);
-  snr_shm->data[snr_shm->index].value = value;
-  snr_shm->index = (snr_shm->index + 1) % MAX_DATA_NUM;
+static int
+sketch_index(float value)
+{
+  return (int)ceil(log(value) / log(SKETCH_GAMMA));
+}
 
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+static void
+sketch_count(uint16_t *bin, uint32_t n)
+{
+  *bin = (*bin + n > UINT16_MAX) ? UINT16_MAX : *bin + n;
+}
+
+static void
+sketch_add(sensor_coarse_hist_t *c, int i, float value)
+{
+  uint16_t *bins = c->sketch[i];
+  uint32_t total = 0;
+  int idx, k, j, shift;
+
+  if (!(value > SKETCH_MIN_VALUE)) {
+    sketch_count(&c->sketch_zero[i], 1);
+    return;
+  }
+  idx = sketch_index(value);
+  for (k = 0; k < SKETCH_BINS; k++) {
+    total += bins[k];
+  }
+  if (total == 0) {
+    /* Center the window on the first sample. */
+    c->sketch_offset[i] = idx - SKETCH_BINS / 2;
+  }
+
+  k = idx - c->sketch_offset[i];
+  if (k >= SKETCH_BINS) {
+    /* Slide the window up, folding the lowest bins into the first. */
+    shift = k - (SKETCH_BINS - 1);
+    for (j = 1; j < SKETCH_BINS; j++) {
+      uint16_t n = bins[j];
+      bins[j] = 0;
+      sketch_count(&bins[j > shift ? j - shift : 0], n);
+    }
+    c->sketch_offset[i] += shift;
+    k = SKETCH_BINS - 1;
+  } else if (k < 0) {
+    k = 0;
   }
-  ret = 0;
+  sketch_count(&bins[k], 1);
+}
 
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
+static void
+sketch_reset(sensor_coarse_hist_t *c, int i)
+{
+  c->sketch_offset[i] = 0;
+  c->sketch_zero[i] = 0;
+  memset(c->sketch[i], 0, sizeof(c->sketch[i]));
+}
+
+static void
+sensor_set_coarse_history(sensor_coarse_hist_t *c, float value) {
+  long current_time = time(NULL);
+  int i;
+
+  sensor_shm_write_lock(&c->seq);
+  if (c->index < 0 || c->index >= MAX_COARSE_DATA_NUM) {
+    c->index = 0;
+  }
+  i = c->index;
+  /* If the log was started less than an hour ago, then
+   * continue to log to this entry */
+  if (c->log_time[i] != 0 &&
+      difftime(current_time, c->log_time[i]) < COARSE_THRESHOLD) {
+    c->sum[i] += value;
+    c->count[i] += 1;
+    if (value > c->max[i])
+      c->max[i] = value;
+    if (value < c->min[i])
+      c->min[i] = value;
+    c->avg[i] = c->sum[i] / c->count[i];
+    sketch_add(c, i, value);
+  } else {
+    if (c->log_time[i] != 0) {
+      /* Start logging to the next entry */
+      i = c->index = (c->index + 1) % MAX_COARSE_DATA_NUM;
+    }
+    c->log_time[i] = current_time;
+    c->avg[i] = c->sum[i] = c->max[i] = c->min[i] = value;
+    c->count[i] = 1;
+    sketch_reset(c, i);
+    sketch_add(c, i, value);
+  }
+  hist_tree_update(c->tree, MAX_COARSE_DATA_NUM, i, c->min, c->max, c->avg);
+  sensor_shm_write_unlock(&c->seq);
+}
+
+static void
+sensor_set_fine_history(sensor_fine_hist_t *f, float value) {
+  sensor_shm_write_lock(&f->seq);
+  if (f->index < 0 || f->index >= MAX_DATA_NUM) {
+    f->index = 0;
+  }
+  f->log_time[f->index] = time(NULL);
+  f->value[f->index] = value;
+  hist_tree_update(f->tree, MAX_DATA_NUM, f->index, f->value, f->value,
+      f->value);
+  f->index = (f->index + 1) % MAX_DATA_NUM;
+  sensor_shm_write_unlock(&f->seq);
+}
+
+static int
+sensor_set_history(uint8_t fru, uint8_t sensor_num, bool available, float value) {
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, true);
+
+  if (slot == NULL) {
+    return -1;
   }
-close_bail:
-  close(fd);
-  return ret;
+  __atomic_store_n(&slot->last_update, (uint32_t)time(NULL), __ATOMIC_RELAXED);
+  __atomic_add_fetch(&slot->generation, 1, __ATOMIC_RELEASE);
+  if (available) {
+    sensor_set_fine_history(&slot->fine, value);
+    sensor_set_coarse_history(&slot->coarse, value);
+  }
+  sensor_hist_put();
+  return 0;
 }
 
 int __attribute__((weak))
@@ -280,273 +644,705 @@ sensor_cache_write(uint8_t fru, uint8_t sensor_num, bool available, float value)
     DEBUG_STR("sensor_cache_write: cache_set %s failed.\n", key);
     return ERR_FAILURE;
   }
-  if (available) {
-    cache_set_history(key, value);
-    if (sensor_coarse_key_get(fru, sensor_num, key) == 0) {
-      cache_set_coarse_history(key, value);
+  sensor_set_history(fru, sensor_num, available, value);
+  return 0;
+}
+
+int
+sensor_cache_read_fru(uint8_t fru, sensor_cache_entry_t *entries, int cnt)
+{
+  sensor_hist_slot_t *slot;
+  int i, ret = 0;
+#ifndef DBUS_SENSOR_SVC
+  struct kv_get_entry *kv;
+  char (*keys)[MAX_KEY_LEN];
+  char (*str)[MAX_VALUE_LEN];
+
+  if (cnt <= 0) {
+    return 0;
+  }
+  kv = calloc(cnt, sizeof(*kv));
+  keys = calloc(cnt, sizeof(*keys));
+  str = calloc(cnt, sizeof(*str));
+  if (kv == NULL || keys == NULL || str == NULL) {
+    free(kv);
+    free(keys);
+    free(str);
+    return ERR_FAILURE;
+  }
+
+  for (i = 0; i < cnt; i++) {
+    if (sensor_key_get(fru, entries[i].sensor_num, keys[i])) {
+      free(kv);
+      free(keys);
+      free(str);
+      return ERR_UNKNOWN_FRU;
+    }
+    kv[i].key = keys[i];
+    kv[i].value = str[i];
+  }
+  /* The keys are read under their locks, so (unlike kv_get in
+   * sensor_cache_read) there is no partial write to retry on. */
+  kv_get_many(kv, cnt, 0);
+#endif
+
+  for (i = 0; i < cnt; i++) {
+    sensor_cache_entry_t *e = &entries[i];
+#ifndef DBUS_SENSOR_SVC
+    if (kv[i].error) {
+      DEBUG_STR("%s: cache_get %s failed.\n", __FUNCTION__, keys[i]);
+      e->ret = ERR_SENSOR_NA;
+    } else if (0 == strcmp(str[i], "NA")) {
+      e->ret = ERR_SENSOR_NA;
+    } else {
+      e->value = atof(str[i]);
+      e->ret = 0;
     }
+#else
+    e->ret = sensor_svc_read(fru, e->sensor_num, &e->value);
+#endif
+    if (e->ret && !ret) {
+      ret = e->ret;
+    }
+
+    e->timestamp = 0;
+    slot = sensor_hist_get(fru, e->sensor_num, false);
+    if (slot != NULL) {
+      e->timestamp = __atomic_load_n(&slot->last_update, __ATOMIC_RELAXED);
+      sensor_hist_put();
+    }
+  }
+
+#ifndef DBUS_SENSOR_SVC
+  free(kv);
+  free(keys);
+  free(str);
+#endif
+  return ret;
+}
+
+int
+sensor_cache_generation(uint8_t fru, uint8_t sensor_num, uint32_t *gen)
+{
+#ifndef DBUS_SENSOR_SVC
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, false);
+
+  if (slot == NULL) {
+    return ERR_SENSOR_NA;
   }
+  *gen = __atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE);
+  sensor_hist_put();
   return 0;
+#else
+  /* The service keeps the cache */
+  return ERR_SENSOR_NA;
+#endif
+}
+
+static uint64_t
+monotonic_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+sensor_perf_record(uint8_t fru, uint8_t sensor_num, uint64_t us, int ret)
+{
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, true);
+  sensor_perf_t *p;
+  int b;
+
+  if (slot == NULL) {
+    return;
+  }
+  p = &slot->perf;
+  for (b = 0; b < SENSOR_PERF_BUCKETS - 1 && us >= (SENSOR_PERF_MIN_US << b); b++);
+  sensor_shm_write_lock(&slot->perf_seq);
+  p->hist[b]++;
+  p->reads++;
+  p->total_us += us;
+  if (ret && ret != ERR_SENSOR_NA) {
+    p->failures++;
+  }
+  if (us >= SENSOR_SLOW_READ_US) {
+    p->slow++;
+  }
+  if (us > p->max_us) {
+    p->max_us = us > UINT32_MAX ? UINT32_MAX : us;
+  }
+  sensor_shm_write_unlock(&slot->perf_seq);
+  sensor_hist_put();
 }
 
 int sensor_raw_read(uint8_t fru, uint8_t sensor_num, float *value)
 {
+  uint64_t start = monotonic_us();
 #ifdef DBUS_SENSOR_SVC
   int ret = sensor_svc_raw_read(fru, sensor_num, value);
 #else
   int ret = pal_sensor_read_raw(fru, sensor_num, value);
 #endif
+  uint64_t us = monotonic_us() - start;
 
   if (!ret)
     sensor_cache_write(fru, sensor_num, true, *value);
   else if (ret == ERR_SENSOR_NA)
     sensor_cache_write(fru, sensor_num, false, 0.0);
+  sensor_perf_record(fru, sensor_num, us, ret);
   return ret;
 }
 
-static int
-sensor_read_short_history(uint8_t fru, uint8_t sensor_num, float *min,
-    float *average, float *max, int start_time)
+int
+sensor_read_perf(uint8_t fru, uint8_t sensor_num, sensor_perf_t *perf)
 {
-  char key[MAX_KEY_LEN] = {0};
-  int fd;
-  int share_size = sizeof(sensor_shm_t);
-  void *ptr;
-  sensor_shm_t *snr_shm;
-  int16_t read_index;
-  uint16_t count = 0;
-  float read_val;
-  double total = 0;
-  int ret = ERR_FAILURE;
-
-  if (sensor_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, false);
+  uint32_t start;
+  int tries = 0;
 
-  fd = shm_open(key, O_RDONLY, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return ERR_FAILURE;
+  if (slot == NULL) {
+    return ERR_SENSOR_NA;
   }
+  do {
+    start = sensor_shm_read_begin(&slot->perf_seq);
+    *perf = slot->perf;
+  } while (sensor_shm_read_retry(&slot->perf_seq, start) && ++tries < SHM_READ_TRIES);
+  sensor_hist_put();
+  return perf->reads ? 0 : ERR_SENSOR_NA;
+}
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
-  }
+int
+sensor_clear_perf(uint8_t fru, uint8_t sensor_num)
+{
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, false);
 
-  ptr = mmap(NULL, share_size, PROT_READ, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+  if (slot == NULL) {
+    return 0;
   }
+  sensor_shm_write_lock(&slot->perf_seq);
+  memset(&slot->perf, 0, sizeof(slot->perf));
+  sensor_shm_write_unlock(&slot->perf_seq);
+  sensor_hist_put();
+  return 0;
+}
+
+/* The n entries of a ring of len entries ending before end, as (up to
+ * two) ranges [from, to) in ascending order. Returns the ranges. */
+static int
+ring_ranges(int end, int n, int len, int from[2], int to[2])
+{
+  if (n <= end) {
+    from[0] = end - n;
+    to[0] = end;
+    return 1;
+  }
+  from[0] = 0;
+  to[0] = end;
+  from[1] = len - (n - end);
+  to[1] = len;
+  return 2;
+}
 
-  snr_shm = (sensor_shm_t *)ptr;
-  read_index = snr_shm->index - 1;
-  if (read_index < 0) {
-    read_index += MAX_DATA_NUM;
+/* Count of the newest entries of a ring of len entries ending before
+ * end, logged since start_time. The log times grow along the ring (and
+ * unused entries are 0), so it is a bisection. */
+static int
+ring_window(const uint32_t *log_time, int end, int len, int start_time)
+{
+  int lo = 0, hi = len, mid;
+  uint32_t t;
+
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    /* The oldest of the mid newest. */
+    t = log_time[(end - mid + len) % len];
+    if (t != 0 && t >= (uint32_t)start_time) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
   }
+  return lo;
+}
+
+/* Percentiles of sensor_history_t, as p50, p95, p99. */
+#define HIST_PERCENTILES 3
+static const double hist_quantiles[HIST_PERCENTILES] = { 0.50, 0.95, 0.99 };
 
-  read_val = snr_shm->data[read_index].value;
-  *min = read_val;
-  *max = read_val;
+static int
+float_cmp(const void *a, const void *b)
+{
+  float x = *(const float *)a, y = *(const float *)b;
 
-  while ((snr_shm->data[read_index].log_time >= start_time) && (count < MAX_DATA_NUM)) {
-    read_val = snr_shm->data[read_index].value;
-    if (read_val > *max)
-      *max = read_val;
-    if (read_val < *min)
-      *min = read_val;
+  return (x > y) - (x < y);
+}
 
-    total += read_val;
-    count++;
-    if ((--read_index) < 0) {
-      read_index += MAX_DATA_NUM;
+/* Min, total and max of the fine samples since start_time, the samples
+ * into values (MAX_DATA_NUM of them at most), returns their count. */
+static int
+sensor_scan_fine_history(sensor_fine_hist_t *f, int start_time,
+    float *values, float *min, double *total, float *max)
+{
+  int from[2], to[2];
+  int end, count, nr, r, i, n;
+  uint32_t start;
+  int tries = 0;
+
+  do {
+    start = sensor_shm_read_begin(&f->seq);
+    end = f->index;
+    if (end < 0 || end >= MAX_DATA_NUM) {
+      end = 0;
     }
-  }
+    count = ring_window(f->log_time, end, MAX_DATA_NUM, start_time);
+    *min = FLT_MAX;
+    *max = -FLT_MAX;
+    *total = 0;
+    n = 0;
+    nr = ring_ranges(end, count, MAX_DATA_NUM, from, to);
+    for (r = 0; r < nr; r++) {
+      for (i = from[r]; i < to[r]; i++) {
+        float v = f->value[i];
+        if (v > *max)
+          *max = v;
+        if (v < *min)
+          *min = v;
+        *total += v;
+        values[n++] = v;
+      }
+    }
+  } while (sensor_shm_read_retry(&f->seq, start) && ++tries < SHM_READ_TRIES);
 
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
-  }
+  return count;
+}
 
-  /* If none found in history, just return the cached value */
-  if (!count) {
-    float read_value;
-    ret = sensor_cache_read(fru, sensor_num, &read_value);
-    if (ret)
-      return ret;
-    total = *min = *max = read_value;
-    count = 1;
-  }
+/* Percentiles of n samples, by nearest rank. Sorts the samples. */
+static void
+values_percentiles(float *values, int n, float *pct)
+{
+  int i;
 
-  *average = total / count;
-  ret = 0;
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
+  if (n <= 0) {
+    return;
+  }
+  qsort(values, n, sizeof(values[0]), float_cmp);
+  for (i = 0; i < HIST_PERCENTILES; i++) {
+    pct[i] = values[(int)ceil(hist_quantiles[i] * n) - 1];
   }
-close_bail:
-  close(fd);
-  return ret;
 }
 
-static int
-sensor_read_long_history(uint8_t fru, uint8_t sensor_num, float *min,
-    float *average, float *max, int start_time)
+/* Value of a sketch index: the middle of its bin, relatively. */
+static float
+sketch_value(int idx)
 {
-  char key[MAX_KEY_LEN] = {0};
-  int fd;
-  int share_size = sizeof(sensor_coarse_shm_t);
-  void *ptr;
-  sensor_coarse_shm_t *snr_shm;
-  sensor_coarse_data_t *s;
-  int16_t read_index;
-  uint16_t count = 0;
-  double total = 0;
-  int ret = ERR_FAILURE;
+  return 2 * pow(SKETCH_GAMMA, idx) / (SKETCH_GAMMA + 1);
+}
 
-  if (sensor_coarse_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
+/* Bin of a value in a merged sketch. */
+static int
+sketch_merged_bin(int idx)
+{
+  int m = idx + SKETCH_MERGED_BINS / 2;
 
-  fd = shm_open(key, O_RDONLY, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
-    DEBUG_STR("%s: shm_open %s failed, errno = %d", __FUNCTION__, key, errno);
-    return ERR_FAILURE;
+  if (m < 0) {
+    return 0;
   }
+  return m < SKETCH_MERGED_BINS ? m : SKETCH_MERGED_BINS - 1;
+}
 
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    goto close_bail;
-  }
+/* As sensor_scan_fine_history, of the coarse entries (their averages
+ * for the total), their sketches merged into merged[SKETCH_MERGED_BINS]
+ * (index 0 in the middle), with the samples counted as 0 in zero. */
+static int
+sensor_scan_coarse_history(sensor_coarse_hist_t *c, int start_time,
+    uint32_t *merged, uint64_t *zero, float *min, double *total, float *max)
+{
+  int from[2], to[2];
+  int end, count, nr, r, i, k;
+  uint32_t start;
+  int tries = 0;
+
+  do {
+    start = sensor_shm_read_begin(&c->seq);
+    /* The current entry is included. */
+    end = c->index + 1;
+    if (end <= 0 || end > MAX_COARSE_DATA_NUM) {
+      end = 1;
+    }
+    count = ring_window(c->log_time, end, MAX_COARSE_DATA_NUM, start_time);
+    *min = FLT_MAX;
+    *max = -FLT_MAX;
+    *total = 0;
+    memset(merged, 0, SKETCH_MERGED_BINS * sizeof(merged[0]));
+    *zero = 0;
+    nr = ring_ranges(end, count, MAX_COARSE_DATA_NUM, from, to);
+    for (r = 0; r < nr; r++) {
+      for (i = from[r]; i < to[r]; i++) {
+        if (c->max[i] > *max)
+          *max = c->max[i];
+        if (c->min[i] < *min)
+          *min = c->min[i];
+        *total += c->avg[i];
+        *zero += c->sketch_zero[i];
+        for (k = 0; k < SKETCH_BINS; k++) {
+          merged[sketch_merged_bin(c->sketch_offset[i] + k)] +=
+            c->sketch[i][k];
+        }
+      }
+    }
+  } while (sensor_shm_read_retry(&c->seq, start) && ++tries < SHM_READ_TRIES);
 
-  ptr = mmap(NULL, share_size, PROT_READ, MAP_SHARED, fd, 0);
-  if (ptr == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+  return count;
+}
+
+/* Percentiles of a merged sketch, bounded by min and max. */
+static void
+sketch_percentiles(const uint32_t *merged, uint64_t zero,
+    float min, float max, float *pct)
+{
+  uint64_t samples = zero, rank, seen;
+  int m, q;
+
+  for (m = 0; m < SKETCH_MERGED_BINS; m++) {
+    samples += merged[m];
   }
+  for (q = 0; q < HIST_PERCENTILES && samples > 0; q++) {
+    float v = 0;
 
-  snr_shm = (sensor_coarse_shm_t *)ptr;
-  read_index = snr_shm->index;
-  total = 0;
-  *max = -FLT_MAX;
-  *min = FLT_MAX;
-  while (count < MAX_COARSE_DATA_NUM) {
-    s = &snr_shm->data[read_index];
-    if (s->log_time < start_time) {
-      break;
+    rank = (uint64_t)(hist_quantiles[q] * (samples - 1));
+    seen = zero;
+    for (m = 0; seen <= rank && m < SKETCH_MERGED_BINS; m++) {
+      seen += merged[m];
     }
-    if (s->max > *max)
-      *max = s->max;
-    if (s->min < *min)
-      *min = s->min;
-    total += s->avg;
-    count++;
-    if ((--read_index) < 0) {
-      read_index += MAX_COARSE_DATA_NUM;
+    if (m > 0 && seen > zero) {
+      v = sketch_value(m - 1 - SKETCH_MERGED_BINS / 2);
     }
+    /* The bins are relative, the bounds of the range are exact. */
+    if (v > max)
+      v = max;
+    if (v < min)
+      v = min;
+    pct[q] = v;
   }
-  if (munmap(ptr, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, key, errno);
-    goto unlock_bail;
+}
+
+/* History of a sensor since start_time into h, leaving its samples in
+ * values (fine) or its sketch in merged and zero (coarse) for the
+ * aggregates of sensor_read_set_history(). Returns h->ret, the count
+ * of samples (or coarse entries) in count and their total in total. */
+static int
+sensor_scan_history(uint8_t fru, sensor_history_t *h, bool coarse,
+    int start_time, float *values, uint32_t *merged, uint64_t *zero,
+    int *count, double *total)
+{
+  sensor_hist_slot_t *slot;
+  float pct[HIST_PERCENTILES];
+
+  memset(pct, 0, sizeof(pct));
+  *count = 0;
+  *total = 0;
+  slot = sensor_hist_get(fru, h->sensor_num, false);
+  if (slot == NULL) {
+    h->ret = ERR_FAILURE;
+    return h->ret;
+  }
+  if (coarse) {
+    *count = sensor_scan_coarse_history(&slot->coarse, start_time,
+        merged, zero, &h->min, total, &h->max);
+  } else {
+    *count = sensor_scan_fine_history(&slot->fine, start_time,
+        values, &h->min, total, &h->max);
   }
+  sensor_hist_put();
 
   /* If none found in history, just return the cached value */
-  if (!count) {
+  if (!*count) {
     float read_value;
-    ret = sensor_cache_read(fru, sensor_num, &read_value);
-    if (ret)
-      return ret;
-    total = *min = *max = read_value;
-    count = 1;
+    h->ret = sensor_cache_read(fru, h->sensor_num, &read_value);
+    if (h->ret) {
+      return h->ret;
+    }
+    *total = h->min = h->max = read_value;
+    pct[0] = pct[1] = pct[2] = read_value;
+    *count = 1;
+    if (coarse) {
+      memset(merged, 0, SKETCH_MERGED_BINS * sizeof(merged[0]));
+      *zero = 0;
+      if (read_value > SKETCH_MIN_VALUE) {
+        merged[sketch_merged_bin(sketch_index(read_value))] = 1;
+      } else {
+        *zero = 1;
+      }
+    } else {
+      values[0] = read_value;
+    }
+  } else if (coarse) {
+    sketch_percentiles(merged, *zero, h->min, h->max, pct);
+  } else {
+    values_percentiles(values, *count, pct);
   }
+  h->average = *total / *count;
+  h->p50 = pct[0];
+  h->p95 = pct[1];
+  h->p99 = pct[2];
+  h->ret = 0;
+  return 0;
+}
 
-  *average = total / count;
-  ret = 0;
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, key, errno);
-    ret = -1;
+/* Min, total and max of the fine samples (or coarse entries) since
+ * start_time from the block trees, returns their count. */
+static int
+sensor_window_history(sensor_hist_slot_t *slot, bool coarse, int start_time,
+    hist_node_t *agg)
+{
+  sensor_fine_hist_t *f = &slot->fine;
+  sensor_coarse_hist_t *c = &slot->coarse;
+  uint32_t *seq = coarse ? &c->seq : &f->seq;
+  int from[2], to[2];
+  int end, count, nr, r;
+  uint32_t start;
+  int tries = 0;
+
+  do {
+    start = sensor_shm_read_begin(seq);
+    hist_node_reset(agg);
+    if (coarse) {
+      /* The current entry is included. */
+      end = c->index + 1;
+      if (end <= 0 || end > MAX_COARSE_DATA_NUM) {
+        end = 1;
+      }
+      count = ring_window(c->log_time, end, MAX_COARSE_DATA_NUM, start_time);
+      nr = ring_ranges(end, count, MAX_COARSE_DATA_NUM, from, to);
+      for (r = 0; r < nr; r++) {
+        hist_tree_query(c->tree, MAX_COARSE_DATA_NUM, from[r], to[r],
+            c->min, c->max, c->avg, agg);
+      }
+    } else {
+      end = f->index;
+      if (end < 0 || end >= MAX_DATA_NUM) {
+        end = 0;
+      }
+      count = ring_window(f->log_time, end, MAX_DATA_NUM, start_time);
+      nr = ring_ranges(end, count, MAX_DATA_NUM, from, to);
+      for (r = 0; r < nr; r++) {
+        hist_tree_query(f->tree, MAX_DATA_NUM, from[r], to[r],
+            f->value, f->value, f->value, agg);
+      }
+    }
+  } while (sensor_shm_read_retry(seq, start) && ++tries < SHM_READ_TRIES);
+
+  return count;
+}
+
+int
+sensor_read_set_history_window(sensor_set_history_t *set, int cnt,
+    int start_time)
+{
+  bool coarse = difftime(time(NULL), start_time) > COARSE_THRESHOLD;
+  sensor_hist_slot_t *slot;
+  hist_node_t agg;
+  float read_value;
+  int i, count;
+  int ret = 0;
+
+  for (i = 0; i < cnt; i++) {
+    sensor_history_t *h = &set[i].hist;
+
+    h->p50 = h->p95 = h->p99 = 0;
+    slot = sensor_hist_get(set[i].fru, h->sensor_num, false);
+    if (slot == NULL) {
+      h->ret = ret = ERR_FAILURE;
+      continue;
+    }
+    count = sensor_window_history(slot, coarse, start_time, &agg);
+    sensor_hist_put();
+
+    if (count) {
+      h->min = agg.min;
+      h->max = agg.max;
+      h->average = agg.total / count;
+      h->ret = 0;
+    } else {
+      /* If none found in history, just return the cached value */
+      h->ret = sensor_cache_read(set[i].fru, h->sensor_num, &read_value);
+      if (h->ret) {
+        ret = h->ret;
+        continue;
+      }
+      h->min = h->average = h->max = read_value;
+    }
   }
-close_bail:
-  close(fd);
   return ret;
 }
 
 int
-sensor_read_history(uint8_t fru, uint8_t sensor_num, float *min, float *average, float *max, int start_time)
+sensor_read_fru_history(uint8_t fru, sensor_history_t *hist, int cnt,
+    int start_time)
 {
   long current_time = time(NULL);
-  
   /* If requested start is greater than the coarse threshold (mostly an hour),
    * then go through the coarse stats to compute the max,min avg. else use the
    * fine grained data to get the values */
-  if (difftime(current_time, start_time) > COARSE_THRESHOLD) {
-    return sensor_read_long_history(fru, sensor_num, min, average, max, start_time);
+  bool coarse = difftime(current_time, start_time) > COARSE_THRESHOLD;
+  float values[MAX_DATA_NUM];
+  uint32_t merged[SKETCH_MERGED_BINS];
+  uint64_t zero;
+  double total;
+  int i, count;
+  int ret = 0;
+
+  for (i = 0; i < cnt; i++) {
+    if (sensor_scan_history(fru, &hist[i], coarse, start_time,
+          values, merged, &zero, &count, &total)) {
+      ret = hist[i].ret;
+    }
   }
-  return sensor_read_short_history(fru, sensor_num, min, average, max, start_time);
+  return ret;
 }
 
-static int sensor_clear_history_helper(char *shm_name, int share_size)
+int
+sensor_read_set_history(sensor_set_history_t *set, int cnt, int start_time,
+    sensor_history_t *agg)
 {
-  int fd;
-  long *shm;
-  int ret = ERR_FAILURE;
-
-  fd = shm_open(shm_name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
-  if (fd < 0) {
+  bool coarse = difftime(time(NULL), start_time) > COARSE_THRESHOLD;
+  float *values = NULL;
+  uint32_t merged[SKETCH_MERGED_BINS], agg_merged[SKETCH_MERGED_BINS];
+  uint64_t zero, agg_zero = 0;
+  double total, agg_total = 0;
+  float pct[HIST_PERCENTILES];
+  int i, m, count, agg_count = 0, num_values = 0;
+  int ret = 0;
+
+  if (set == NULL || agg == NULL || cnt <= 0) {
     return ERR_FAILURE;
   }
-  if (flock(fd, LOCK_EX) < 0) {
-    syslog(LOG_INFO, "%s: file-lock %s failed errno = %d\n", __FUNCTION__, shm_name, errno);
-    goto close_bail;
+  /* Fine queries keep the samples of every sensor for the percentiles
+   * of the set. */
+  if (!coarse) {
+    values = malloc((size_t)cnt * MAX_DATA_NUM * sizeof(values[0]));
+    if (values == NULL) {
+      return ERR_FAILURE;
+    }
   }
+  memset(agg_merged, 0, sizeof(agg_merged));
+  agg->min = FLT_MAX;
+  agg->max = -FLT_MAX;
 
-  if (ftruncate(fd, share_size) != 0) {
-    syslog(LOG_INFO, "%s: truncate %s failed errno = %d\n", __FUNCTION__, shm_name, errno);
-    goto close_bail;
-  }
+  for (i = 0; i < cnt; i++) {
+    sensor_history_t *h = &set[i].hist;
 
-  shm = (long *)mmap(NULL, share_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  if (shm == MAP_FAILED) {
-    syslog(LOG_INFO, "%s: mmap %s failed, errno = %d", __FUNCTION__, shm_name, errno);
-    goto unlock_bail;
+    if (sensor_scan_history(set[i].fru, h, coarse, start_time,
+          values + num_values, merged, &zero, &count, &total)) {
+      ret = h->ret;
+      continue;
+    }
+    if (h->min < agg->min)
+      agg->min = h->min;
+    if (h->max > agg->max)
+      agg->max = h->max;
+    agg_total += total;
+    agg_count += count;
+    if (coarse) {
+      for (m = 0; m < SKETCH_MERGED_BINS; m++) {
+        agg_merged[m] += merged[m];
+      }
+      agg_zero += zero;
+    } else {
+      num_values += count;
+    }
   }
 
-  memset(shm, 0, share_size);
-  if (munmap(shm, share_size) != 0) {
-    syslog(LOG_INFO, "%s: munmap %s failed, errno = %d", __FUNCTION__, shm_name, errno);
-    goto unlock_bail;
-  }
-  ret = 0;
-unlock_bail:
-  if (flock(fd, LOCK_UN) < 0) {
-    syslog(LOG_INFO, "%s: file-unlock %s failed errno = %d\n", __FUNCTION__, shm_name, errno);
-    ret = -1;
+  memset(pct, 0, sizeof(pct));
+  if (agg_count == 0) {
+    agg->ret = ret ? ret : ERR_SENSOR_NA;
+  } else {
+    if (coarse) {
+      sketch_percentiles(agg_merged, agg_zero, agg->min, agg->max, pct);
+    } else {
+      values_percentiles(values, num_values, pct);
+    }
+    agg->average = agg_total / agg_count;
+    agg->ret = 0;
   }
-close_bail:
-  close(fd);
+  agg->p50 = pct[0];
+  agg->p95 = pct[1];
+  agg->p99 = pct[2];
+  free(values);
   return ret;
 }
 
-int sensor_clear_history(uint8_t fru, uint8_t sensor_num)
+int
+sensor_read_history(uint8_t fru, uint8_t sensor_num, float *min, float *average, float *max, int start_time)
 {
-  char key[MAX_KEY_LEN] = {0};
-  int ret1, ret2;
+  sensor_set_history_t s = { .fru = fru, .hist.sensor_num = sensor_num };
+  int ret = sensor_read_set_history_window(&s, 1, start_time);
 
-  if (sensor_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
+  if (ret)
+    return ret;
+  *min = s.hist.min;
+  *average = s.hist.average;
+  *max = s.hist.max;
+  return 0;
+}
 
-  ret1 = sensor_clear_history_helper(key, sizeof(sensor_shm_t));
-  if (ret1) {
-    syslog(LOG_INFO, "Clearing history failed: %d\n", ret1);
+int
+sensor_read_history_samples(uint8_t fru, uint8_t sensor_num,
+    long *log_time, float *value, int max)
+{
+  sensor_hist_slot_t *slot;
+  sensor_fine_hist_t *f;
+  uint32_t start;
+  int tries = 0;
+  int count, i;
+
+  slot = sensor_hist_get(fru, sensor_num, false);
+  if (slot == NULL) {
+    return ERR_FAILURE;
   }
-  if (sensor_coarse_key_get(fru, sensor_num, key))
-    return ERR_UNKNOWN_FRU;
-  ret2 = sensor_clear_history_helper(key, sizeof(sensor_coarse_shm_t));
-  if (ret2) {
-    syslog(LOG_INFO, "Clearing coarse history failed: %d\n", ret2);
+  f = &slot->fine;
+  do {
+    start = sensor_shm_read_begin(&f->seq);
+    i = f->index;
+    if (i < 0 || i >= MAX_DATA_NUM) {
+      i = 0;
+    }
+    for (count = 0; count < max && count < MAX_DATA_NUM; count++) {
+      i = i ? i - 1 : MAX_DATA_NUM - 1;
+      if (f->log_time[i] == 0) {
+        break;
+      }
+      log_time[count] = f->log_time[i];
+      value[count] = f->value[i];
+    }
+  } while (sensor_shm_read_retry(&f->seq, start) && ++tries < SHM_READ_TRIES);
+  sensor_hist_put();
+  return count;
+}
+
+int sensor_clear_history(uint8_t fru, uint8_t sensor_num)
+{
+  sensor_hist_slot_t *slot = sensor_hist_get(fru, sensor_num, true);
+  sensor_fine_hist_t *f;
+  sensor_coarse_hist_t *c;
+
+  if (slot == NULL) {
+    syslog(LOG_INFO, "Clearing history failed: %d\n", ERR_FAILURE);
+    return ERR_FAILURE;
   }
-  return ret1 || ret2 ? ERR_FAILURE : 0;
+  f = &slot->fine;
+  c = &slot->coarse;
+
+  sensor_shm_write_lock(&f->seq);
+  memset(&f->index, 0, sizeof(*f) - offsetof(sensor_fine_hist_t, index));
+  sensor_shm_write_unlock(&f->seq);
+  sensor_shm_write_lock(&c->seq);
+  memset(&c->index, 0, sizeof(*c) - offsetof(sensor_coarse_hist_t, index));
+  sensor_shm_write_unlock(&c->seq);
+  sensor_hist_put();
+  return 0;
 }
 
 int __attribute__((weak))
@@ -586,6 +1382,14 @@ pal_alter_sensor_poll_interval(uint8_t fru, uint8_t sensor_num, uint32_t *value)
   return PAL_EOK;
 }
 
+/* By default the sensors of a FRU share one channel. */
+int __attribute__((weak))
+pal_get_sensor_channel(uint8_t fru, uint8_t sensor_num, uint16_t *channel)
+{
+  *channel = SENSOR_CHANNEL(SENSOR_CHANNEL_FRU, fru);
+  return PAL_EOK;
+}
+
 int __attribute__((weak))
 pal_get_fru_discrete_list(uint8_t fru, uint8_t **sensor_list, int *cnt)
 {
@@ -654,7 +1458,7 @@ pal_is_sensor_existing(uint8_t fru, uint8_t snr_num) {
   int sensor_cnt;
   uint8_t *sensor_list;
 
-  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     printf("%s: Fail to get fru%d sensor list\n",__func__, fru);
     return false;
@@ -679,13 +1483,13 @@ pal_copy_all_thresh_to_file(uint8_t fru, thresh_sensor_t *sinfo) {
   char fpath[128] = {0};
   int i;
 
-  ret = pal_get_fru_name(fru, fru_name);
+  ret = pal_get_fru_name_cached(fru, fru_name);
   if (ret < 0) {
     printf("%s: Fail to get fru%d name\n",__func__,fru);
     return ret;
   }
 
-  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     return ret;
   }
@@ -717,6 +1521,12 @@ pal_sensor_sdr_init(uint8_t fru, void *sinfo)
   return -1;
 }
 
+int __attribute__((weak))
+pal_sensor_sdr_path(uint8_t fru, char *path)
+{
+  return -1;
+}
+
 int __attribute__((weak))
 pal_get_all_thresh_from_file(uint8_t fru, thresh_sensor_t *sinfo, int mode) {
   int fd;
@@ -732,7 +1542,7 @@ pal_get_all_thresh_from_file(uint8_t fru, thresh_sensor_t *sinfo, int mode) {
   char cmd[256] = {0};
   int curr_state = 0;
 
-  ret = pal_get_fru_name(fru, fru_name);
+  ret = pal_get_fru_name_cached(fru, fru_name);
   if (ret)
     printf("%s: Fail to get fru%d name\n",__func__,fru);
 
@@ -748,7 +1558,7 @@ pal_get_all_thresh_from_file(uint8_t fru, thresh_sensor_t *sinfo, int mode) {
       break;
   }
 
-  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     return ret;
   }
@@ -814,12 +1624,12 @@ pal_get_thresh_from_file(uint8_t fru, uint8_t snr_num, thresh_sensor_t *sinfo) {
   char fpath[64] = {0};
   int curr_state;
 
-  ret = pal_get_fru_name(fru, fru_name);
+  ret = pal_get_fru_name_cached(fru, fru_name);
   if (ret < 0)
     printf("%s: Fail to get fru%d name\n",__func__,fru);
 
   sprintf(fpath, THRESHOLD_BIN, fru_name);
-  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     return ret;
   }
@@ -863,14 +1673,14 @@ pal_copy_thresh_to_file(uint8_t fru, uint8_t snr_num, thresh_sensor_t *sinfo) {
   uint8_t *sensor_list;
   char fpath[64] = {0};
 
-  ret = pal_get_fru_name(fru, fru_name);
+  ret = pal_get_fru_name_cached(fru, fru_name);
   if (ret < 0) {
     printf("%s: Fail to get fru%d name\n",__func__,fru);
     return ret;
   }
 
   sprintf(fpath, THRESHOLD_BIN, fru_name);
-  ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+  ret = pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
     return ret;
   }
@@ -899,125 +1709,224 @@ pal_copy_thresh_to_file(uint8_t fru, uint8_t snr_num, thresh_sensor_t *sinfo) {
   return 0;
 }
 
-int __attribute__((weak))
-pal_sensor_thresh_modify(uint8_t fru,  uint8_t sensor_num, uint8_t thresh_type, float value) {
-  int ret = -1;
-  thresh_sensor_t snr;
-  char fru_name[16];
-  char fpath[128] = {0};
-  char initpath[128] = {0};
-  char cmd[512] = {0};
-
-  ret = pal_get_fru_name(fru, fru_name);
-  if (ret < 0) {
-    printf("%s: Fail to get fru%d name\n",__func__,fru);
-    return ret;
-  }
-
-  memset(fpath, 0, sizeof(fpath));
-  sprintf(fpath, THRESHOLD_BIN, fru_name);
-  memset(initpath, 0, sizeof(initpath));
-  sprintf(initpath, INIT_THRESHOLD_BIN, fru_name);
-  if (0 != access(fpath, F_OK)) {
-    sprintf(cmd,"cp -rf %s %s", initpath, fpath);
-    if (system(cmd) != 0) {
-      syslog(LOG_ERR, "%s failed", cmd);
-    }
-  }
-
-  ret = pal_get_thresh_from_file(fru, sensor_num, &snr);
-  if (ret < 0) {
-    syslog(LOG_ERR, "%s: Fail to get %s sensor threshold file\n",__func__,fru_name);
-    return ret;
-  }
-
+/* Set a threshold of snr to value, if it stays ordered with the others. */
+static int
+thresh_set(thresh_sensor_t *snr, uint8_t thresh_type, float value) {
   switch (thresh_type) {
     case UCR_THRESH:
-      if (((snr.flag & GETMASK(UNR_THRESH)) && (value > snr.unr_thresh)) ||
-          ((snr.flag & GETMASK(UNC_THRESH)) && (value < snr.unc_thresh)) ||
-          ((snr.flag & GETMASK(LNC_THRESH)) && (value < snr.lnc_thresh)) ||
-          ((snr.flag & GETMASK(LCR_THRESH)) && (value < snr.lcr_thresh)) ||
-          ((snr.flag & GETMASK(LNR_THRESH)) && (value < snr.lnr_thresh))) {
+      if (((snr->flag & GETMASK(UNR_THRESH)) && (value > snr->unr_thresh)) ||
+          ((snr->flag & GETMASK(UNC_THRESH)) && (value < snr->unc_thresh)) ||
+          ((snr->flag & GETMASK(LNC_THRESH)) && (value < snr->lnc_thresh)) ||
+          ((snr->flag & GETMASK(LCR_THRESH)) && (value < snr->lcr_thresh)) ||
+          ((snr->flag & GETMASK(LNR_THRESH)) && (value < snr->lnr_thresh))) {
         return -1;
       }
-      snr.ucr_thresh = value;
-      snr.flag |= SETMASK(UCR_THRESH);
+      snr->ucr_thresh = value;
+      snr->flag |= SETMASK(UCR_THRESH);
       break;
     case UNC_THRESH:
-      if (((snr.flag & GETMASK(UNR_THRESH)) && (value > snr.unr_thresh)) ||
-          ((snr.flag & GETMASK(UCR_THRESH)) && (value > snr.ucr_thresh)) ||
-          ((snr.flag & GETMASK(LNC_THRESH)) && (value < snr.lnc_thresh)) ||
-          ((snr.flag & GETMASK(LCR_THRESH)) && (value < snr.lcr_thresh)) ||
-          ((snr.flag & GETMASK(LNR_THRESH)) && (value < snr.lnr_thresh))) {
+      if (((snr->flag & GETMASK(UNR_THRESH)) && (value > snr->unr_thresh)) ||
+          ((snr->flag & GETMASK(UCR_THRESH)) && (value > snr->ucr_thresh)) ||
+          ((snr->flag & GETMASK(LNC_THRESH)) && (value < snr->lnc_thresh)) ||
+          ((snr->flag & GETMASK(LCR_THRESH)) && (value < snr->lcr_thresh)) ||
+          ((snr->flag & GETMASK(LNR_THRESH)) && (value < snr->lnr_thresh))) {
         return -1;
       }
-      snr.unc_thresh = value;
-      snr.flag |= SETMASK(UNC_THRESH);
+      snr->unc_thresh = value;
+      snr->flag |= SETMASK(UNC_THRESH);
       break;
     case UNR_THRESH:
-      if (((snr.flag & GETMASK(UCR_THRESH)) && (value < snr.ucr_thresh)) ||
-          ((snr.flag & GETMASK(UNC_THRESH)) && (value < snr.unc_thresh)) ||
-          ((snr.flag & GETMASK(LNC_THRESH)) && (value < snr.lnc_thresh)) ||
-          ((snr.flag & GETMASK(LCR_THRESH)) && (value < snr.lcr_thresh)) ||
-          ((snr.flag & GETMASK(LNR_THRESH)) && (value < snr.lnr_thresh))) {
+      if (((snr->flag & GETMASK(UCR_THRESH)) && (value < snr->ucr_thresh)) ||
+          ((snr->flag & GETMASK(UNC_THRESH)) && (value < snr->unc_thresh)) ||
+          ((snr->flag & GETMASK(LNC_THRESH)) && (value < snr->lnc_thresh)) ||
+          ((snr->flag & GETMASK(LCR_THRESH)) && (value < snr->lcr_thresh)) ||
+          ((snr->flag & GETMASK(LNR_THRESH)) && (value < snr->lnr_thresh))) {
         return -1;
       }
-      snr.unr_thresh = value;
-      snr.flag |= SETMASK(UNR_THRESH);
+      snr->unr_thresh = value;
+      snr->flag |= SETMASK(UNR_THRESH);
       break;
     case LCR_THRESH:
-      if (((snr.flag & GETMASK(LNR_THRESH)) && (value < snr.lnr_thresh)) ||
-          ((snr.flag & GETMASK(LNC_THRESH)) && (value > snr.lnc_thresh)) ||
-          ((snr.flag & GETMASK(UNC_THRESH)) && (value > snr.unc_thresh)) ||
-          ((snr.flag & GETMASK(UCR_THRESH)) && (value > snr.ucr_thresh)) ||
-          ((snr.flag & GETMASK(UNR_THRESH)) && (value > snr.unr_thresh))) {
+      if (((snr->flag & GETMASK(LNR_THRESH)) && (value < snr->lnr_thresh)) ||
+          ((snr->flag & GETMASK(LNC_THRESH)) && (value > snr->lnc_thresh)) ||
+          ((snr->flag & GETMASK(UNC_THRESH)) && (value > snr->unc_thresh)) ||
+          ((snr->flag & GETMASK(UCR_THRESH)) && (value > snr->ucr_thresh)) ||
+          ((snr->flag & GETMASK(UNR_THRESH)) && (value > snr->unr_thresh))) {
         return -1;
       }
-      snr.lcr_thresh = value;
-      snr.flag |= SETMASK(LCR_THRESH);
+      snr->lcr_thresh = value;
+      snr->flag |= SETMASK(LCR_THRESH);
       break;
     case LNC_THRESH:
-      if (((snr.flag & GETMASK(LNR_THRESH)) && (value < snr.lnr_thresh)) ||
-          ((snr.flag & GETMASK(LCR_THRESH)) && (value < snr.lcr_thresh)) ||
-          ((snr.flag & GETMASK(UNC_THRESH)) && (value > snr.unc_thresh)) ||
-          ((snr.flag & GETMASK(UCR_THRESH)) && (value > snr.ucr_thresh)) ||
-          ((snr.flag & GETMASK(UNR_THRESH)) && (value > snr.unr_thresh))) {
+      if (((snr->flag & GETMASK(LNR_THRESH)) && (value < snr->lnr_thresh)) ||
+          ((snr->flag & GETMASK(LCR_THRESH)) && (value < snr->lcr_thresh)) ||
+          ((snr->flag & GETMASK(UNC_THRESH)) && (value > snr->unc_thresh)) ||
+          ((snr->flag & GETMASK(UCR_THRESH)) && (value > snr->ucr_thresh)) ||
+          ((snr->flag & GETMASK(UNR_THRESH)) && (value > snr->unr_thresh))) {
         return -1;
       }
-      snr.lnc_thresh = value;
-      snr.flag |= SETMASK(LNC_THRESH);
+      snr->lnc_thresh = value;
+      snr->flag |= SETMASK(LNC_THRESH);
       break;
     case LNR_THRESH:
-      if (((snr.flag & GETMASK(LCR_THRESH)) && (value > snr.lcr_thresh)) ||
-          ((snr.flag & GETMASK(LNC_THRESH)) && (value > snr.lnc_thresh)) ||
-          ((snr.flag & GETMASK(UNC_THRESH)) && (value > snr.unc_thresh)) ||
-          ((snr.flag & GETMASK(UCR_THRESH)) && (value > snr.ucr_thresh)) ||
-          ((snr.flag & GETMASK(UNR_THRESH)) && (value > snr.unr_thresh))) {
+      if (((snr->flag & GETMASK(LCR_THRESH)) && (value > snr->lcr_thresh)) ||
+          ((snr->flag & GETMASK(LNC_THRESH)) && (value > snr->lnc_thresh)) ||
+          ((snr->flag & GETMASK(UNC_THRESH)) && (value > snr->unc_thresh)) ||
+          ((snr->flag & GETMASK(UCR_THRESH)) && (value > snr->ucr_thresh)) ||
+          ((snr->flag & GETMASK(UNR_THRESH)) && (value > snr->unr_thresh))) {
         return -1;
       }
-      snr.lnr_thresh = value;
-      snr.flag |= SETMASK(LNR_THRESH);
+      snr->lnr_thresh = value;
+      snr->flag |= SETMASK(LNR_THRESH);
       break;
     default:
       syslog(LOG_WARNING, "%s Incorrect sensor threshold type",__func__);
       return -1;
   }
 
-  ret = pal_copy_thresh_to_file(fru, sensor_num, &snr);
-  if (ret < 0) {
+  return 0;
+}
+
+/* Ask sensord to reload the thresholds of the sensors of a FRU: a line
+ * per sensor appended to its reinit flag, "all" for all of them (as an
+ * empty flag). */
+static int
+thresh_reinit_notify(const char *fru_name, const uint8_t *snrs, int cnt) {
+  char fpath[128];
+  char buf[4 * 256 + 8];
+  int fd, i, len = 0;
+  ssize_t rc;
+
+  if (cnt < 0) {
+    len = sprintf(buf, "all\n");
+  } else {
+    for (i = 0; i < cnt && len < (int)sizeof(buf) - 5; i++) {
+      len += sprintf(buf + len, "%u\n", snrs[i]);
+    }
+  }
+  snprintf(fpath, sizeof(fpath), THRESHOLD_RE_FLAG, fru_name);
+  fd = open(fpath, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    syslog(LOG_ERR, "%s: open failed for %s, errno : %d %s\n", __func__, fpath, errno, strerror(errno));
+    return -1;
+  }
+  /* One write, so the lines of concurrent writers do not mix. */
+  rc = write(fd, buf, len);
+  close(fd);
+  return rc == len ? 0 : -1;
+}
+
+int __attribute__((weak))
+pal_sensor_thresh_modify_list(uint8_t fru, const thresh_modify_t *mods, int cnt) {
+  thresh_sensor_t *snrs = NULL;
+  uint8_t changed[256];
+  bool is_changed[256] = {false};
+  uint8_t *sensor_list;
+  char fru_name[16];
+  char fpath[128], tmppath[136];
+  const char *src;
+  bool fresh;
+  int sensor_cnt, num_changed = 0;
+  int fd = -1, ret = -1;
+  int i, j;
+  size_t size;
+
+  if (mods == NULL || cnt <= 0) {
+    return -1;
+  }
+  if (pal_get_fru_name_cached(fru, fru_name) < 0) {
+    printf("%s: Fail to get fru%d name\n",__func__,fru);
+    return -1;
+  }
+  if (pal_get_fru_sensor_list_cached(fru, &sensor_list, &sensor_cnt) < 0 ||
+      sensor_list == NULL || sensor_cnt <= 0) {
+    return -1;
+  }
+
+  /* The overrides start from the initial thresholds. */
+  snprintf(fpath, sizeof(fpath), THRESHOLD_BIN, fru_name);
+  fresh = access(fpath, F_OK) != 0;
+  if (fresh) {
+    snprintf(tmppath, sizeof(tmppath), INIT_THRESHOLD_BIN, fru_name);
+    src = tmppath;
+  } else {
+    src = fpath;
+  }
+  size = sensor_cnt * sizeof(thresh_sensor_t);
+  snrs = calloc(sensor_cnt, sizeof(thresh_sensor_t));
+  if (snrs == NULL) {
+    return -1;
+  }
+  fd = open(src, O_RDONLY);
+  if (fd < 0) {
+    syslog(LOG_ERR, "%s: open failed for %s, errno : %d %s\n", __func__, src, errno, strerror(errno));
+    goto bail;
+  }
+  if (read(fd, snrs, size) != (ssize_t)size) {
+    syslog(LOG_ERR, "%s: short threshold file %s\n", __func__, src);
+    goto bail;
+  }
+  close(fd);
+  fd = -1;
+
+  /* All or none: nothing is written if a threshold is invalid. */
+  for (i = 0; i < cnt; i++) {
+    for (j = 0; j < sensor_cnt && sensor_list[j] != mods[i].snr_num; j++)
+      ;
+    if (j == sensor_cnt) {
+      syslog(LOG_WARNING, "%s: no sensor 0x%x for %s", __func__, mods[i].snr_num, fru_name);
+      goto bail;
+    }
+    if (thresh_set(&snrs[j], mods[i].thresh_type, mods[i].value) < 0) {
+      syslog(LOG_WARNING, "%s: invalid threshold %u = %.2f of sensor 0x%x for %s",
+             __func__, mods[i].thresh_type, mods[i].value, mods[i].snr_num, fru_name);
+      goto bail;
+    }
+    if (!is_changed[mods[i].snr_num]) {
+      is_changed[mods[i].snr_num] = true;
+      changed[num_changed++] = mods[i].snr_num;
+    }
+  }
+
+  snprintf(tmppath, sizeof(tmppath), "%s.tmp", fpath);
+  fd = open(tmppath, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    syslog(LOG_ERR, "%s: open failed for %s, errno : %d %s\n", __func__, tmppath, errno, strerror(errno));
+    goto bail;
+  }
+  if (write(fd, snrs, size) != (ssize_t)size || close(fd) != 0) {
+    fd = -1;
+    unlink(tmppath);
     printf("fail to set threshold file for %s\n", fru_name);
-    return ret;
+    goto bail;
+  }
+  fd = -1;
+  if (rename(tmppath, fpath) != 0) {
+    unlink(tmppath);
+    goto bail;
   }
 
-  // Create reinit file
-  memset(fpath, 0, sizeof(fpath));
-  sprintf(fpath, THRESHOLD_RE_FLAG, fru_name);
-  sprintf(cmd,"touch %s",fpath);
-  if (system(cmd) != 0) {
-    syslog(LOG_ERR, "%s failed", cmd);
+  /* A file copied from the initial thresholds drops older overrides,
+   * so sensord reloads all the sensors then. */
+  ret = thresh_reinit_notify(fru_name, changed, fresh ? -1 : num_changed);
+
+bail:
+  if (fd >= 0) {
+    close(fd);
   }
+  free(snrs);
+  return ret;
+}
 
-  return 0;
+int __attribute__((weak))
+pal_sensor_thresh_modify(uint8_t fru,  uint8_t sensor_num, uint8_t thresh_type, float value) {
+  thresh_modify_t mod = {
+    .snr_num = sensor_num,
+    .thresh_type = thresh_type,
+    .value = value,
+  };
+
+  return pal_sensor_thresh_modify_list(fru, &mod, 1);
 }
 
 void __attribute__((weak))
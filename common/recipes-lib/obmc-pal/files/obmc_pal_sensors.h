@@ -80,16 +80,105 @@ typedef struct {
 /* Read a cached value of the given sensor */
 int sensor_cache_read(uint8_t fru, uint8_t sensor_num, float *value);
 
+/* Cached value of a sensor of a FRU, see sensor_cache_read_fru() */
+typedef struct {
+  uint8_t sensor_num;
+  /* 0, or as sensor_cache_read() (ERR_SENSOR_NA if not available) */
+  int ret;
+  float value;
+  /* Time of the last write into the cache, 0 if unknown */
+  long timestamp;
+} sensor_cache_entry_t;
+
+/* Read the cached values of cnt sensors (sensor_num of every entry) of
+ * a FRU at once. Returns 0 or the error of a failed entry. */
+int sensor_cache_read_fru(uint8_t fru, sensor_cache_entry_t *entries, int cnt);
+
 /* Writes the cache explicitly */
 int sensor_cache_write(uint8_t fru, uint8_t sensor_num, bool available, float value);
 
+/* Generation of the cached value of the sensor, which changes on every
+ * sensor_cache_write(). The value read after it is at least as new.
+ * Returns ERR_SENSOR_NA if the sensor was never written (or the cache
+ * is not local). */
+int sensor_cache_generation(uint8_t fru, uint8_t sensor_num, uint32_t *gen);
+
 /* Read the sensor history */
 int sensor_read_history(uint8_t fru, uint8_t sensor_num, float *min,
                float *average, float *max, int start_time);
 
+/* History of a sensor of a FRU, see sensor_read_fru_history() */
+typedef struct {
+  uint8_t sensor_num;
+  int ret;
+  float min;
+  float average;
+  float max;
+  /* Median and upper percentiles: exact over the last hour, within
+   * 2.5% over coarse (longer) ranges. */
+  float p50;
+  float p95;
+  float p99;
+} sensor_history_t;
+
+/* Read the history of cnt sensors (sensor_num of every entry) of a FRU.
+ * ret of every entry is as for sensor_read_history(), returns 0 or the
+ * error of a failed entry. */
+int sensor_read_fru_history(uint8_t fru, sensor_history_t *hist, int cnt,
+               int start_time);
+
+/* A sensor of a set, see sensor_read_set_history() */
+typedef struct {
+  uint8_t fru;
+  /* sensor_num as input */
+  sensor_history_t hist;
+} sensor_set_history_t;
+
+/* Read the history of cnt sensors of any FRUs in one pass, each entry as
+ * by sensor_read_fru_history(), and the aggregate of their samples into
+ * agg: min, max, average and percentiles over all the sensors (agg->ret
+ * is ERR_SENSOR_NA when none has samples). Returns 0 or the error of a
+ * failed entry. */
+int sensor_read_set_history(sensor_set_history_t *set, int cnt,
+               int start_time, sensor_history_t *agg);
+
+/* Read the min, average and max of cnt sensors of any FRUs, as by
+ * sensor_read_history(): each in O(log n) of the history, without the
+ * percentiles (left 0). Returns 0 or the error of a failed entry. */
+int sensor_read_set_history_window(sensor_set_history_t *set, int cnt,
+               int start_time);
+
+/* Read the latest (up to max) samples of the sensor, newest first.
+ * Returns their count, or a negative error. */
+int sensor_read_history_samples(uint8_t fru, uint8_t sensor_num,
+               long *log_time, float *value, int max);
+
 /* Clear the sensor history */
 int sensor_clear_history(uint8_t fru, uint8_t sensor_num);
 
+/* Read latency of a sensor by sensor_raw_read(), see sensor_read_perf().
+ * hist[b] counts the reads under SENSOR_PERF_MIN_US << b, the last one
+ * the slower ones too. ERR_SENSOR_NA is not a failure. Reads of at least
+ * SENSOR_SLOW_READ_US are counted slow. */
+#define SENSOR_PERF_BUCKETS  16
+#define SENSOR_PERF_MIN_US   64ULL
+#define SENSOR_SLOW_READ_US  1000000
+typedef struct {
+  uint32_t reads;
+  uint32_t failures;
+  uint32_t slow;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t hist[SENSOR_PERF_BUCKETS];
+} sensor_perf_t;
+
+/* Read the latency statistics of the sensor since the history was
+ * created. Returns ERR_SENSOR_NA if it was never read. */
+int sensor_read_perf(uint8_t fru, uint8_t sensor_num, sensor_perf_t *perf);
+
+/* Reset the latency statistics of the sensor */
+int sensor_clear_perf(uint8_t fru, uint8_t sensor_num);
+
 /* Read sensor directly from the hardware. Note, this function does not
  * protect the caller from other readers. The caller should ensure
  * exclusivity. The simplest method being limiting all calls to this
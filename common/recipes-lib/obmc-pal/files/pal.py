@@ -276,6 +276,45 @@ def sensor_read_history(fru_id: int, snr_num: int, start_time: int) -> SensorHis
     return SensorHistory(min_val.value, max_val.value, avg_val.value)
 
 
+class _SensorHistory(ctypes.Structure):
+    _fields_ = [
+        ("sensor_num", ctypes.c_uint8),
+        ("ret", ctypes.c_int),
+        ("min", ctypes.c_float),
+        ("average", ctypes.c_float),
+        ("max", ctypes.c_float),
+        ("p50", ctypes.c_float),
+        ("p95", ctypes.c_float),
+        ("p99", ctypes.c_float),
+    ]
+
+
+class _SensorSetHistory(ctypes.Structure):
+    _fields_ = [("fru", ctypes.c_uint8), ("hist", _SensorHistory)]
+
+
+def sensor_read_set_history_window(
+    sensors: List[Tuple[int, int]], start_time: int
+) -> Dict[Tuple[int, int], SensorHistory]:
+    """
+    History of many (fru_id, snr_num) at once, as sensor_read_history().
+    Sensors without a history are left out.
+    """
+    entries = (_SensorSetHistory * len(sensors))()
+    for i, (fru_id, snr_num) in enumerate(sensors):
+        entries[i].fru = fru_id
+        entries[i].hist.sensor_num = snr_num
+    libpal.sensor_read_set_history_window(entries, len(sensors), start_time)
+
+    histories = {}
+    for (fru_id, snr_num), entry in zip(sensors, entries):
+        if entry.hist.ret == 0:
+            histories[(fru_id, snr_num)] = SensorHistory(
+                entry.hist.min, entry.hist.max, entry.hist.average
+            )
+    return histories
+
+
 def pal_get_pwm_cnt() -> int:
     """get pwm count"""
     return libpal.pal_get_pwm_cnt()
@@ -32,6 +32,16 @@
  */
 #define PMBUS_PAGE_INVALID	(0x1F + 1)
 
+/*
+ * Reads of a page combined by one i2c_rdwr_batch_transfer() call.
+ */
+#define PMBUS_READ_BATCH	16
+
+/*
+ * "status" of the reads not issued yet by pmbus_read_regs().
+ */
+#define PMBUS_READ_PENDING	1
+
 /*
  * The opaque structure to represent a pmbus device.
  */
@@ -86,8 +96,13 @@ int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page)
 		return -1;
 	}
 
+	if (pmdev->cur_page == page)
+		return 0;
+
 	if (i2c_smbus_write_byte_data(pmdev->device_fd,
 				      PMBUS_PAGE, page) != 0) {
+		/* The write may or may not have reached the device. */
+		pmdev->cur_page = PMBUS_PAGE_INVALID;
 		return -1;
 	}
 
@@ -100,15 +115,150 @@ int pmbus_write_byte_data(pmbus_dev_t *pmdev,
 			  uint8_t reg,
 			  uint8_t value)
 {
-	if (!IS_VALID_PMBUS_DEV(pmdev)) {
+	if (pmbus_set_page(pmdev, page) != 0)
+		return -1;
+
+	if (reg == PMBUS_PAGE)
+		return pmbus_set_page(pmdev, value);
+
+	return i2c_smbus_write_byte_data(pmdev->device_fd, reg, value);
+}
+
+int pmbus_read_byte_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg)
+{
+	if (pmbus_set_page(pmdev, page) != 0)
+		return -1;
+
+	return i2c_smbus_read_byte_data(pmdev->device_fd, reg);
+}
+
+int pmbus_read_word_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg)
+{
+	if (pmbus_set_page(pmdev, page) != 0)
+		return -1;
+
+	return i2c_smbus_read_word_data(pmdev->device_fd, reg);
+}
+
+int pmbus_read_block_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg,
+			  uint8_t *buf, size_t size)
+{
+	uint8_t block[I2C_SMBUS_BLOCK_MAX];
+	int len;
+
+	if (buf == NULL) {
 		errno = EINVAL;
 		return -1;
 	}
+	if (pmbus_set_page(pmdev, page) != 0)
+		return -1;
+
+	len = i2c_smbus_read_block_data(pmdev->device_fd, reg, block);
+	if (len < 0)
+		return -1;
+
+	if (len > size)
+		len = size;
+	memcpy(buf, block, len);
+	return len;
+}
+
+/*
+ * Issue the pending reads of <page> in batches of PMBUS_READ_BATCH.
+ */
+static int pmbus_read_page_regs(pmbus_dev_t *pmdev, uint8_t page,
+				pmbus_reg_read_t *reads, size_t num)
+{
+	i2c_xfer_t xfers[PMBUS_READ_BATCH];
+	pmbus_reg_read_t *batch[PMBUS_READ_BATCH];
+	size_t i, j, n_xfer;
+	int ret = 0;
+
+	if (pmbus_set_page(pmdev, page) != 0) {
+		for (i = 0; i < num; i++) {
+			if (reads[i].status == PMBUS_READ_PENDING &&
+			    reads[i].page == page)
+				reads[i].status = -errno;
+		}
+		return -1;
+	}
+
+	for (i = 0; i < num; ) {
+		n_xfer = 0;
+		for (; i < num && n_xfer < PMBUS_READ_BATCH; i++) {
+			pmbus_reg_read_t *rd = &reads[i];
+
+			if (rd->status != PMBUS_READ_PENDING ||
+			    rd->page != page)
+				continue;
+
+			memset(&xfers[n_xfer], 0, sizeof(xfers[n_xfer]));
+			xfers[n_xfer].addr = pmdev->addr << 1;
+			xfers[n_xfer].tbuf = &rd->reg;
+			xfers[n_xfer].tcount = 1;
+			xfers[n_xfer].rbuf = rd->buf;
+			xfers[n_xfer].rcount = rd->len;
+			batch[n_xfer++] = rd;
+		}
+		if (n_xfer == 0)
+			break;
+
+		if (i2c_rdwr_batch_transfer(pmdev->device_fd, xfers,
+					    n_xfer) != 0)
+			ret = -1;
+		for (j = 0; j < n_xfer; j++)
+			batch[j]->status = xfers[j].status;
+	}
 
-	if ((pmdev->cur_page != page) &&
-	    (pmbus_set_page(pmdev, page) != 0)) {
+	return ret;
+}
+
+int pmbus_read_regs(pmbus_dev_t *pmdev, pmbus_reg_read_t *reads, size_t num)
+{
+	size_t i;
+	int page, ret = 0;
+
+	if (!IS_VALID_PMBUS_DEV(pmdev) || reads == NULL) {
+		errno = EINVAL;
 		return -1;
 	}
 
-	return i2c_smbus_write_byte_data(pmdev->device_fd, reg, value);
+	for (i = 0; i < num; i++) {
+		if (reads[i].buf == NULL || reads[i].len == 0) {
+			errno = EINVAL;
+			return -1;
+		}
+		reads[i].status = PMBUS_READ_PENDING;
+	}
+
+	/*
+	 * The reads of the current page go first, then the pages follow
+	 * the order of their first read.
+	 */
+	while (1) {
+		page = -1;
+		for (i = 0; i < num; i++) {
+			if (reads[i].status != PMBUS_READ_PENDING)
+				continue;
+			if (reads[i].page == pmdev->cur_page) {
+				page = reads[i].page;
+				break;
+			}
+			if (page < 0)
+				page = reads[i].page;
+		}
+		if (page < 0)
+			break;
+
+		if (pmbus_read_page_regs(pmdev, page, reads, num) != 0)
+			ret = -1;
+	}
+
+	for (i = 0; i < num; i++) {
+		if (reads[i].status != 0) {
+			errno = -reads[i].status;
+			break;
+		}
+	}
+	return ret;
 }
@@ -74,7 +74,9 @@ pmbus_dev_t* pmbus_device_open(int bus, uint16_t addr, int flags);
 void pmbus_device_close(pmbus_dev_t *pmdev);
 
 /*
- * Update the page of given pmbus device.
+ * Update the page of given pmbus device. The page last set through the
+ * device is remembered, and the PAGE write is skipped if the device is
+ * already on <page>.
  *
  * Return:
  *   0 for success, and -1 on failures. errno is set in case of failures.
@@ -90,6 +92,53 @@ int pmbus_set_page(pmbus_dev_t *pmdev, uint8_t page);
 int pmbus_write_byte_data(pmbus_dev_t *pmdev, uint8_t page,
 			  uint8_t reg, uint8_t value);
 
+/*
+ * Read a byte/word register of the given page.
+ *
+ * Return:
+ *   the value of the register for success, and -1 on failures. errno is
+ *   set in case of failures.
+ */
+int pmbus_read_byte_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg);
+int pmbus_read_word_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg);
+
+/*
+ * Read a block register of the given page into <buf> (without the byte
+ * count), up to <size> bytes.
+ *
+ * Return:
+ *   the number of bytes read for success, and -1 on failures. errno is
+ *   set in case of failures.
+ */
+int pmbus_read_block_data(pmbus_dev_t *pmdev, uint8_t page, uint8_t reg,
+			  uint8_t *buf, size_t size);
+
+/*
+ * A register read of pmbus_read_regs(): <len> bytes of register <reg>
+ * of page <page> are stored in <buf>, least significant byte first, i.e.
+ * 1 for a byte, 2 for a word, or the byte count plus the data of a
+ * block register of a known length. "status" is set to 0 or to -errno.
+ */
+typedef struct {
+	uint8_t page;
+	uint8_t reg;
+	uint8_t len;
+	uint8_t *buf;
+	int status;
+} pmbus_reg_read_t;
+
+/*
+ * Read a set of registers of the given device, e.g. the telemetry of all
+ * its rails. The reads are grouped by page, so PAGE is written once per
+ * page (starting with the current page), and the reads of a page are
+ * issued as combined I2C_RDWR transfers.
+ *
+ * Return:
+ *   0 if all the reads succeeded, or -1 (see their "status"). errno is
+ *   set in case of failures.
+ */
+int pmbus_read_regs(pmbus_dev_t *pmdev, pmbus_reg_read_t *reads, size_t num);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -17,6 +17,9 @@
  */
 
 #include <syslog.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include "sensorlist.hpp"
 
 #ifndef SENSOR_CONF
@@ -121,6 +124,96 @@ extern "C" int sensors_read_adc(const char *label, float *value)
   return sensors_read("ast_adc-isa-0000", label, value);
 }
 
+extern "C" int sensors_resolve(const char *chip, const char *label)
+{
+  if (!chip || !label) {
+    errno = EINVAL;
+    return -1;
+  }
+  try {
+    return sensors.resolve(chip, label);
+  } catch (std::out_of_range &e) {
+    syslog(LOG_ERR, "Resolve(%s:%s): Out of range exception: %s\n", chip, label, e.what());
+  } catch (...) {
+    syslog(LOG_CRIT, "Resolve(%s:%s) Unknown error", chip, label);
+  }
+  errno = ENOENT;
+  return -1;
+}
+
+// Read a resolved sensor, with the error code of a failed read in err
+static int read_id(int id, float *value, int &err)
+{
+  err = 0;
+  try {
+    *value = sensors.handle(id).read();
+    return 0;
+  } catch (std::out_of_range &e) {
+    err = ENOENT;
+    syslog(LOG_ERR, "Read(%d): Out of range exception: %s\n", id, e.what());
+  } catch (std::system_error &e) {
+    err = e.code().value();
+    syslog(LOG_ERR, "Read(%s:%s): System error: %s - %s\n",
+        sensors.handle_chip_name(id).c_str(), sensors.handle_label(id).c_str(),
+        e.code().message().c_str(), e.what());
+  } catch (...) {
+    err = EIO;
+    syslog(LOG_CRIT, "Read(%d) Unknown error", id);
+  }
+  return -1;
+}
+
+extern "C" int sensors_read_id(int id, float *value)
+{
+  int err;
+  if (!value) {
+    errno = EINVAL;
+    return -1;
+  }
+  return read_id(id, value, err);
+}
+
+extern "C" int sensors_read_batch(const int *ids, float *values, int cnt)
+{
+  int ret = 0;
+  if (!ids || !values || cnt < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  // In order of chip, keeping the order of the ids within a chip
+  std::vector<std::pair<SensorChip *, int>> order;
+  order.reserve(cnt);
+  for (int i = 0; i < cnt; i++) {
+    SensorChip *chip = nullptr;
+    try {
+      chip = &sensors.handle_chip(ids[i]);
+    } catch (...) {
+      values[i] = NAN;
+      ret = -1;
+      continue;
+    }
+    order.emplace_back(chip, i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+      [](const std::pair<SensorChip *, int> &a, const std::pair<SensorChip *, int> &b) {
+        return a.first < b.first;
+      });
+
+  SensorChip *gone = nullptr;
+  for (auto &o : order) {
+    int err = 0, i = o.second;
+    if (o.first == gone || read_id(ids[i], &values[i], err)) {
+      values[i] = NAN;
+      ret = -1;
+      if (err == ENODEV || err == ENXIO) {
+        gone = o.first;
+      }
+    }
+  }
+  return ret;
+}
+
 extern "C" void sensors_reinit()
 {
   sensors.re_enumerate(SENSOR_CONF);
@@ -56,6 +56,18 @@ int sensors_write_pwmfan(const int pwm_id, float value);
 // Read ADC value
 int sensors_read_adc(const char *label, float *value);
 
+// Resolve a chip's sensor once, for sensors_read_id()/sensors_read_batch().
+// Returns its id (stays valid across sensors_reinit()), or -1.
+int sensors_resolve(const char *chip, const char *label);
+
+// Read a sensor by its id
+int sensors_read_id(int id, float *value);
+
+// Read cnt sensors by their ids, chip by chip. The values of the ones
+// which failed are NAN, and once a chip is gone (ENODEV/ENXIO) its other
+// sensors are not attempted. Returns 0, or -1 if any failed.
+int sensors_read_batch(const int *ids, float *values, int cnt);
+
 // Re-initialize SensorList
 void sensors_reinit();
 
@@ -17,8 +17,12 @@
  */
 #include <cmath>
 #include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "sensor.hpp"
+#include "sensorcache.hpp"
 #include <cstring>
+#include <cstdlib>
 
 using namespace std;
 
@@ -77,38 +81,120 @@ void Sensor::write(float value)
   }
 }
 
+void Sensor::save(CachedSensor &c)
+{
+  if (feature == nullptr || subfeature == nullptr) {
+    throw system_error(ENOTSUP, std::generic_category(), "Sensor feature not supported");
+  }
+  c.kind = CachedSensor::SYSFS;
+  c.feature = feature->name;
+  c.label = label;
+  c.attr = subfeature->name;
+  c.scale = sensor_type_scaling(subfeature->type);
+  c.compute = (subfeature->flags & SENSORS_COMPUTE_MAPPING) != 0;
+}
+
+SysfsAttr::~SysfsAttr()
+{
+  if (fd >= 0)
+    close(fd);
+}
+
+void SysfsAttr::set_path(const string &_path)
+{
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+  path = _path;
+}
+
+int SysfsAttr::get_fd()
+{
+  if (fd < 0) {
+    fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0 && errno == EACCES)
+      fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw system_error(errno, std::generic_category(), path + " open failed");
+  }
+  return fd;
+}
+
+void SysfsAttr::read_buf(char *buf, size_t size)
+{
+  ssize_t len = pread(get_fd(), buf, size - 1, 0);
+  if (len < 0 && errno == ENODEV) {
+    set_path(path);
+    len = pread(get_fd(), buf, size - 1, 0);
+  }
+  if (len < 0)
+    throw system_error(errno, std::generic_category(), path + " read failed");
+  buf[len] = '\0';
+}
+
+int SysfsAttr::read(int base)
+{
+  char buf[32];
+  read_buf(buf, sizeof(buf));
+  char *end;
+  errno = 0;
+  long val = strtol(buf, &end, base);
+  if (end == buf || errno)
+    throw system_error(EIO, std::generic_category(), path + " bad value");
+  return int(val);
+}
+
+double SysfsAttr::read_value()
+{
+  char buf[32];
+  read_buf(buf, sizeof(buf));
+  char *end;
+  errno = 0;
+  double val = strtod(buf, &end);
+  if (end == buf || errno)
+    throw system_error(EIO, std::generic_category(), path + " bad value");
+  return val;
+}
+
+void SysfsAttr::write(int val)
+{
+  char buf[16];
+  int len = snprintf(buf, sizeof(buf), "%d\n", val);
+  ssize_t rc = pwrite(get_fd(), buf, len, 0);
+  if (rc < 0 && errno == ENODEV) {
+    set_path(path);
+    rc = pwrite(get_fd(), buf, len, 0);
+  }
+  if (rc < 0)
+    throw system_error(errno, std::generic_category(), path + " write failed");
+}
+
 void PWMSensor::initialize()
 {
-  path = string(chip->path) + "/" + name;
+  pwm.set_path(string(chip->path) + "/" + name);
 }
 
 float PWMSensor::read()
 {
-  InFile file;
-  file.open(path);
-  int val;
-  file >> val;
-  file.close();
-  return ceil(float(val) * 100.0 / 255.0);
+  return ceil(float(pwm.read()) * 100.0 / 255.0);
 }
 
 void PWMSensor::write(float value)
 {
-  OutFile file;
-  int val = int(value * 255.0 / 100.0);
-  file.open(path);
-  file << val << endl;
-  file.close();
+  pwm.write(int(value * 255.0 / 100.0));
+}
+
+void PWMSensor::save(CachedSensor &c)
+{
+  c.kind = CachedSensor::PWM;
+  c.feature = name;
+  c.label = label;
 }
 
 int LegacyPWMSensor::unit_max()
 {
-  InFile file;
-  file.open(unit_path);
-  int unit;
-  file >> unit;
-  file.close();
-  return unit + 1;
+  return unit.read() + 1;
 }
 
 void LegacyPWMSensor::initialize()
@@ -118,27 +204,19 @@ void LegacyPWMSensor::initialize()
   label = "pwm" + to_string(index);
 
   string base(chip->path);
-  en_path = base + "/" + name + "_en";
-  type_path = base + "/" + name + "_type";
-  falling_path = base + "/" + name + "_falling";
-  rising_path = base + "/" + name + "_rising";
-  unit_path = base + "/pwm_type_m_unit";
+  en.set_path(base + "/" + name + "_en");
+  type.set_path(base + "/" + name + "_type");
+  falling.set_path(base + "/" + name + "_falling");
+  rising.set_path(base + "/" + name + "_rising");
+  unit.set_path(base + "/pwm_type_m_unit");
 }
 
 float LegacyPWMSensor::read()
 {
-  InFile file;
-  file.open(en_path);
-  int en;
-  file >> en;
-  file.close();
-  if (!en) {
+  if (!en.read()) {
     return 0.0;
   }
-  int val;
-  file.open(falling_path);
-  file >> std::hex >> val;
-  file.close();
+  int val = falling.read(16);
   if (val == 0)
     return 100.0;
   int max = unit_max();
@@ -147,32 +225,25 @@ float LegacyPWMSensor::read()
 
 void LegacyPWMSensor::write(float val)
 {
-  OutFile file;
   int max = unit_max();
   int value = (int(val) * max) / 100;
   if (value == 0) {
-    file.open(en_path);
-    file << 0 << endl;
-    file.close();
+    en.write(0);
     return;
   }
   if (value == max) {
     value = 0;
   }
 
-  file.open(type_path);
-  file << 0 << endl;
-  file.close();
-
-  file.open(rising_path);
-  file << 0 << endl;
-  file.close();
-
-  file.open(falling_path);
-  file << value << endl;
-  file.close();
+  type.write(0);
+  rising.write(0);
+  falling.write(value);
+  en.write(1);
+}
 
-  file.open(en_path);
-  file << 1 << endl;
-  file.close();
+void LegacyPWMSensor::save(CachedSensor &c)
+{
+  c.kind = CachedSensor::LEGACY_PWM;
+  c.feature = name;
+  c.label = label;
 }
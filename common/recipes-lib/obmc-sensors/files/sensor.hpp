@@ -22,6 +22,8 @@
 #include <system_error>
 #include <sensors/sensors.h>
 
+struct CachedSensor;
+
 // ofstream which throws by default
 class OutFile : public std::ofstream {
   public:
@@ -38,6 +40,26 @@ class InFile : public std::ifstream {
     }
 };
 
+// Integer sysfs attribute, kept open from its first access. Accesses
+// throw system_error as InFile/OutFile; the attribute is re-opened if
+// its device went away (ENODEV) and came back.
+class SysfsAttr {
+  std::string path;
+  int fd = -1;
+  int get_fd();
+  void read_buf(char *buf, size_t size);
+  public:
+    SysfsAttr() {}
+    SysfsAttr(const SysfsAttr &) = delete;
+    SysfsAttr &operator=(const SysfsAttr &) = delete;
+    ~SysfsAttr();
+
+    void set_path(const std::string &_path);
+    int read(int base = 10);
+    double read_value();
+    void write(int val);
+};
+
 // Sensor capable of reading/writing sensor values.
 // Not all sensors might support writing.
 class Sensor {
@@ -63,16 +85,19 @@ class Sensor {
 
     // Writes a value to the sensor
     virtual void write(float val);
+
+    // Record of the sensor for SensorCache
+    virtual void save(CachedSensor &c);
 };
 
 // Sensor capable of reading/writing PWM from fanchips on
 // 4.18 kernels and above
 class PWMSensor : public Sensor {
   protected:
-  std::string path;
+  SysfsAttr pwm;
   public:
     PWMSensor(const sensors_chip_name *fanchip, const std::string &_name)
-      : Sensor(fanchip, nullptr, nullptr), path() {name = _name; label = _name;}
+      : Sensor(fanchip, nullptr, nullptr), pwm() {name = _name; label = _name;}
     virtual ~PWMSensor() {}
 
     // Initialize a sensor.
@@ -83,21 +108,23 @@ class PWMSensor : public Sensor {
 
     // Write a PWM value
     virtual void write(float val);
+
+    virtual void save(CachedSensor &c);
 };
 
 // Sensor capable of reading/writing PWM from fanchips on
 // 4.1 kernels and below
 class LegacyPWMSensor : public Sensor {
-  std::string en_path;
-  std::string rising_path;
-  std::string falling_path;
-  std::string type_path;
-  std::string unit_path;
+  SysfsAttr en;
+  SysfsAttr rising;
+  SysfsAttr falling;
+  SysfsAttr type;
+  SysfsAttr unit;
   int unit_max();
   public:
     LegacyPWMSensor(const sensors_chip_name *fanchip, const std::string &_name)
-      : Sensor(fanchip, nullptr, nullptr), en_path(),
-      rising_path(), falling_path(), type_path(), unit_path() {name = _name;}
+      : Sensor(fanchip, nullptr, nullptr), en(),
+      rising(), falling(), type(), unit() {name = _name;}
     virtual ~LegacyPWMSensor() {}
 
     // Initialize a sensor.
@@ -108,6 +135,8 @@ class LegacyPWMSensor : public Sensor {
 
     // Write a PWM value
     virtual void write(float val);
+
+    virtual void save(CachedSensor &c);
 };
 
 #endif
@@ -0,0 +1,673 @@
+/*
+ * Copyright 2019-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sensorcache.hpp"
+
+using namespace std;
+
+#define CACHE_DIR "/tmp"
+#define CACHE_MAGIC "obmc-sensors-cache 1"
+#define DEFAULT_CONFIG_FILE "/etc/sensors3.conf"
+#define ALT_CONFIG_FILE "/etc/sensors.conf"
+#define DEFAULT_CONFIG_DIR "/etc/sensors.d"
+#define HWMON_DIR "/sys/class/hwmon"
+
+static uint64_t fnv1a(const string &s)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static string hex64(uint64_t v)
+{
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+  return buf;
+}
+
+// Sorted entries of a directory, without the hidden ones
+static vector<string> list_dir(const string &dir)
+{
+  vector<string> names;
+  DIR *d = opendir(dir.c_str());
+  if (d == nullptr) {
+    return names;
+  }
+  struct dirent *ent;
+  while ((ent = readdir(d)) != nullptr) {
+    if (ent->d_name[0] != '.') {
+      names.push_back(ent->d_name);
+    }
+  }
+  closedir(d);
+  sort(names.begin(), names.end());
+  return names;
+}
+
+double sensor_type_scaling(sensors_subfeature_type type)
+{
+  switch (type & 0xFF80) {
+    case SENSORS_SUBFEATURE_IN_INPUT:
+    case SENSORS_SUBFEATURE_TEMP_INPUT:
+    case SENSORS_SUBFEATURE_CURR_INPUT:
+    case SENSORS_SUBFEATURE_HUMIDITY_INPUT:
+      return 1000;
+    case SENSORS_SUBFEATURE_FAN_INPUT:
+      return 1;
+    case SENSORS_SUBFEATURE_POWER_AVERAGE:
+    case SENSORS_SUBFEATURE_ENERGY_INPUT:
+      return 1000000;
+  }
+  switch (type) {
+    case SENSORS_SUBFEATURE_POWER_AVERAGE_INTERVAL:
+    case SENSORS_SUBFEATURE_VID:
+    case SENSORS_SUBFEATURE_TEMP_OFFSET:
+      return 1000;
+    default:
+      return 1;
+  }
+}
+
+void SensorExpr::skip_space()
+{
+  while (isspace((unsigned char)*text)) {
+    text++;
+  }
+}
+
+void SensorExpr::push(char code, double val, int change)
+{
+  ops.push_back(Op{code, val});
+  depth += change;
+  max_seen = max(max_seen, depth);
+}
+
+// sum := product (('+' | '-') product)*
+bool SensorExpr::parse_sum()
+{
+  if (!parse_product()) {
+    return false;
+  }
+  for (;;) {
+    skip_space();
+    char op = *text;
+    if (op != '+' && op != '-') {
+      return true;
+    }
+    text++;
+    if (!parse_product()) {
+      return false;
+    }
+    push(op, 0, -1);
+  }
+}
+
+// product := unary (('*' | '/') unary)*
+bool SensorExpr::parse_product()
+{
+  if (!parse_unary()) {
+    return false;
+  }
+  for (;;) {
+    skip_space();
+    char op = *text;
+    if (op != '*' && op != '/') {
+      return true;
+    }
+    text++;
+    if (!parse_unary()) {
+      return false;
+    }
+    push(op, 0, -1);
+  }
+}
+
+// unary := ('-' | '^' | '`') unary | '@' | number | '(' sum ')'
+bool SensorExpr::parse_unary()
+{
+  skip_space();
+  char c = *text;
+  if (c == '-' || c == '^' || c == '`') {
+    text++;
+    if (!parse_unary()) {
+      return false;
+    }
+    push(c == '-' ? 'n' : c, 0, 0);
+    return true;
+  }
+  if (c == '@') {
+    text++;
+    push('@', 0, 1);
+    return true;
+  }
+  if (c == '(') {
+    text++;
+    if (!parse_sum()) {
+      return false;
+    }
+    skip_space();
+    if (*text != ')') {
+      return false;
+    }
+    text++;
+    return true;
+  }
+  if (isdigit((unsigned char)c) || c == '.') {
+    char *end;
+    double val = strtod(text, &end);
+    text = end;
+    push('c', val, 1);
+    return true;
+  }
+  // Feature names and anything else
+  return false;
+}
+
+bool SensorExpr::compile(const string &expr)
+{
+  ops.clear();
+  depth = max_seen = 0;
+  text = expr.c_str();
+  bool ok = parse_sum();
+  if (ok) {
+    skip_space();
+    ok = *text == '\0' && max_seen <= max_depth;
+  }
+  text = nullptr;
+  if (!ok) {
+    ops.clear();
+  }
+  return ok;
+}
+
+double SensorExpr::eval(double raw) const
+{
+  double stack[max_depth];
+  int sp = 0;
+  for (auto &op : ops) {
+    switch (op.code) {
+      case '@': stack[sp++] = raw; break;
+      case 'c': stack[sp++] = op.val; break;
+      case 'n': stack[sp - 1] = -stack[sp - 1]; break;
+      case '^': stack[sp - 1] = exp(stack[sp - 1]); break;
+      case '`': stack[sp - 1] = log(stack[sp - 1]); break;
+      case '+': sp--; stack[sp - 1] += stack[sp]; break;
+      case '-': sp--; stack[sp - 1] -= stack[sp]; break;
+      case '*': sp--; stack[sp - 1] *= stack[sp]; break;
+      case '/': sp--; stack[sp - 1] /= stack[sp]; break;
+    }
+  }
+  return stack[0];
+}
+
+CachedChipName::CachedChipName(const CachedChip &c) : prefix(c.prefix), path(c.path)
+{
+  memset(&chip, 0, sizeof(chip));
+  chip.prefix = const_cast<char *>(prefix.c_str());
+  chip.path = const_cast<char *>(path.c_str());
+  chip.bus.type = short(c.bus_type);
+  chip.bus.nr = short(c.bus_nr);
+  chip.addr = c.addr;
+}
+
+CachedSysfsSensor::CachedSysfsSensor(const sensors_chip_name *_chip, const CachedSensor &c)
+  : Sensor(_chip, nullptr, nullptr), attr(), attr_name(c.attr), scale(c.scale)
+{
+  name = c.feature;
+  label = c.label;
+  if ((!c.from_expr.empty() && !from.compile(c.from_expr)) ||
+      (!c.to_expr.empty() && !to.compile(c.to_expr))) {
+    throw system_error(EINVAL, std::generic_category(), "Bad cached expression");
+  }
+}
+
+void CachedSysfsSensor::initialize()
+{
+  attr.set_path(string(chip->path) + "/" + attr_name);
+}
+
+float CachedSysfsSensor::read()
+{
+  double value;
+  try {
+    value = attr.read_value() / scale;
+  } catch (system_error &e) {
+    char cname[128];
+    sensors_snprintf_chip_name(cname, sizeof(cname), chip);
+    // Same as Sensor::read(), 0 rpm times out in the ASPEED tacho driver.
+    if (strcmp(cname, "aspeed_tach-isa-0000") != 0) {
+      throw;
+    }
+    value = 0;
+  }
+  if (!from.empty()) {
+    value = from.eval(value);
+  }
+  return float(value);
+}
+
+void CachedSysfsSensor::write(float val)
+{
+  double value = val;
+  if (!to.empty()) {
+    value = to.eval(value);
+  }
+  attr.write(int(value * scale));
+}
+
+SensorCache::SensorCache(const char *conf_file)
+{
+  struct stat st;
+
+  if (conf_file != nullptr) {
+    path = CACHE_DIR "/obmc-sensors-" + hex64(fnv1a(conf_file)) + ".cache";
+    conf_files.push_back(conf_file);
+  } else {
+    path = CACHE_DIR "/obmc-sensors.cache";
+    if (stat(DEFAULT_CONFIG_FILE, &st) == 0) {
+      conf_files.push_back(DEFAULT_CONFIG_FILE);
+    } else if (stat(ALT_CONFIG_FILE, &st) == 0) {
+      conf_files.push_back(ALT_CONFIG_FILE);
+    }
+    for (auto &name : list_dir(DEFAULT_CONFIG_DIR)) {
+      if (name.size() > 5 && name.compare(name.size() - 5, 5, ".conf") == 0) {
+        conf_files.push_back(DEFAULT_CONFIG_DIR "/" + name);
+      }
+    }
+  }
+
+  // What libsensors builds its chips from: the configuration and the
+  // hwmon devices with their parent devices.
+  ostringstream k;
+  for (auto &f : conf_files) {
+    if (stat(f.c_str(), &st) != 0) {
+      continue;
+    }
+    k << "conf " << f << ' ' << st.st_size << ' ' << st.st_mtim.tv_sec << '.'
+      << st.st_mtim.tv_nsec << '\n';
+  }
+  for (auto &name : list_dir(HWMON_DIR)) {
+    char target[256];
+    string dev = string(HWMON_DIR "/") + name;
+    ssize_t len = readlink(dev.c_str(), target, sizeof(target) - 1);
+    target[len < 0 ? 0 : len] = '\0';
+    k << "hwmon " << name << ' ' << target << '\n';
+  }
+  key = hex64(fnv1a(k.str()));
+}
+
+// Fields of a tab separated line
+static vector<string> split_fields(const char *p, const char *end)
+{
+  vector<string> fields;
+  const char *start = p;
+  for (; p <= end; p++) {
+    if (p == end || *p == '\t') {
+      fields.emplace_back(start, p - start);
+      start = p + 1;
+    }
+  }
+  return fields;
+}
+
+bool SensorCache::load(vector<CachedChip> &chips)
+{
+  struct stat st;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const char *p = (const char *)map, *end = p + size;
+  bool ok = true;
+  int line = 0;
+  chips.clear();
+  while (ok && p < end) {
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    if (nl == nullptr) {
+      ok = false;
+      break;
+    }
+    vector<string> f = split_fields(p, nl);
+    p = nl + 1;
+    if (line++ == 0) {
+      ok = f.size() == 2 && f[0] == CACHE_MAGIC && f[1] == key;
+    } else if (f[0] == "C" && f.size() == 7) {
+      chips.emplace_back();
+      CachedChip &c = chips.back();
+      c.name = f[1];
+      c.prefix = f[2];
+      c.path = f[3];
+      c.bus_type = atoi(f[4].c_str());
+      c.bus_nr = atoi(f[5].c_str());
+      c.addr = atoi(f[6].c_str());
+    } else if (f[0] == "S" && f.size() == 9 && !chips.empty()) {
+      chips.back().sensors.emplace_back();
+      CachedSensor &s = chips.back().sensors.back();
+      s.kind = atoi(f[1].c_str());
+      s.feature = f[2];
+      s.label = f[3];
+      s.attr = f[4];
+      s.scale = strtod(f[5].c_str(), nullptr);
+      s.compute = f[6] == "1";
+      s.from_expr = f[7];
+      s.to_expr = f[8];
+      ok = s.scale != 0;
+    } else {
+      ok = false;
+    }
+  }
+  munmap(map, size);
+  if (!ok || line == 0) {
+    chips.clear();
+    return false;
+  }
+  return true;
+}
+
+// Statement of a configuration file, as its words
+static vector<string> conf_words(const string &line)
+{
+  vector<string> words;
+  size_t i = 0;
+  while (i < line.size()) {
+    char c = line[i];
+    if (isspace((unsigned char)c)) {
+      i++;
+    } else if (c == '#') {
+      break;
+    } else if (c == '"') {
+      string w;
+      for (i++; i < line.size() && line[i] != '"'; i++) {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+          i++;
+        }
+        w += line[i];
+      }
+      words.push_back(w);
+      i++;
+    } else {
+      size_t start = i;
+      while (i < line.size() && !isspace((unsigned char)line[i]) && line[i] != '#') {
+        i++;
+      }
+      words.push_back(line.substr(start, i - start));
+    }
+  }
+  return words;
+}
+
+// Chip name pattern of a "chip" statement. A part set to -1 matches any.
+struct ChipPattern {
+  string prefix;
+  int bus_type;
+  int bus_nr;
+  int addr;
+};
+
+static int parse_num(const string &s, int base)
+{
+  if (s == "*") {
+    return -1;
+  }
+  char *end;
+  long v = strtol(s.c_str(), &end, base);
+  return (*end != '\0' || s.empty()) ? -2 : int(v);
+}
+
+// Parse a chip name pattern, false if it has an unsupported bus type.
+static bool parse_pattern(const string &name, ChipPattern &p)
+{
+  vector<string> parts;
+  stringstream ss(name);
+  string part;
+  while (getline(ss, part, '-')) {
+    parts.push_back(part);
+  }
+  if (parts.empty()) {
+    return false;
+  }
+  p.prefix = parts[0];
+  p.bus_type = p.bus_nr = p.addr = -1;
+  if (parts.size() == 1 || (parts.size() == 2 && parts[1] == "*")) {
+    return true;
+  }
+  static const map<string, int> numbered = {
+    {"i2c", SENSORS_BUS_TYPE_I2C}, {"spi", SENSORS_BUS_TYPE_SPI},
+    {"hid", SENSORS_BUS_TYPE_HID},
+  };
+  static const map<string, int> unnumbered = {
+    {"isa", SENSORS_BUS_TYPE_ISA}, {"pci", SENSORS_BUS_TYPE_PCI},
+    {"virtual", SENSORS_BUS_TYPE_VIRTUAL}, {"acpi", SENSORS_BUS_TYPE_ACPI},
+  };
+  if (numbered.count(parts[1]) && parts.size() == 4) {
+    p.bus_type = numbered.at(parts[1]);
+    p.bus_nr = parse_num(parts[2], 10);
+    p.addr = parse_num(parts[3], 16);
+  } else if (unnumbered.count(parts[1]) && parts.size() == 3) {
+    p.bus_type = unnumbered.at(parts[1]);
+    p.addr = parse_num(parts[2], 16);
+  } else {
+    return false;
+  }
+  return p.bus_nr != -2 && p.addr != -2;
+}
+
+static bool pattern_match(const ChipPattern &p, const CachedChip &c)
+{
+  return (p.prefix == "*" || p.prefix == c.prefix) &&
+    (p.bus_type == -1 || p.bus_type == c.bus_type) &&
+    (p.bus_nr == -1 || p.bus_nr == c.bus_nr) &&
+    (p.addr == -1 || p.addr == c.addr);
+}
+
+// I2C bus numbers by adapter name, for the "bus" statements
+static map<string, int> i2c_adapters()
+{
+  map<string, int> adapters;
+  string dir = "/sys/class/i2c-adapter";
+  vector<string> names = list_dir(dir);
+  if (names.empty()) {
+    dir = "/sys/bus/i2c/devices";
+    names = list_dir(dir);
+  }
+  for (auto &n : names) {
+    if (n.compare(0, 4, "i2c-") != 0) {
+      continue;
+    }
+    ifstream f(dir + "/" + n + "/name");
+    string adapter;
+    if (getline(f, adapter)) {
+      adapters[adapter] = atoi(n.c_str() + 4);
+    }
+  }
+  return adapters;
+}
+
+// Feature compute statement of a configuration file
+struct ComputeStmt {
+  vector<ChipPattern> chips;
+  string feature;
+  string from;
+  string to;
+};
+
+bool SensorCache::add_computes(vector<CachedChip> &chips)
+{
+  map<string, int> adapters;
+  bool have_adapters = false;
+  map<int, string> busses;  // configured bus number to adapter name
+
+  for (auto &conf : conf_files) {
+    ifstream f(conf);
+    string line, stmt;
+    vector<ChipPattern> current;
+    vector<ComputeStmt> computes;
+    bool remap = false;
+
+    while (getline(f, line)) {
+      if (!line.empty() && line.back() == '\\') {
+        stmt += line.substr(0, line.size() - 1);
+        continue;
+      }
+      stmt += line;
+      vector<string> w = conf_words(stmt);
+      string text;
+      text.swap(stmt);
+      if (w.empty()) {
+        continue;
+      }
+      if (w[0] == "chip") {
+        current.clear();
+        for (size_t i = 1; i < w.size(); i++) {
+          ChipPattern p;
+          if (!parse_pattern(w[i], p)) {
+            return false;
+          }
+          remap |= p.bus_type == SENSORS_BUS_TYPE_I2C && p.bus_nr >= 0;
+          current.push_back(p);
+        }
+      } else if (w[0] == "bus" && w.size() >= 3) {
+        if (w[1].compare(0, 4, "i2c-") != 0) {
+          return false;
+        }
+        busses[atoi(w[1].c_str() + 4)] = w[2];
+      } else if (w[0] == "compute" && w.size() >= 3) {
+        // The expressions are the rest of the statement
+        size_t pos = text.find(w[1], text.find("compute") + 7) + w[1].size();
+        string exprs = text.substr(pos);
+        exprs = exprs.substr(0, exprs.find('#'));
+        size_t comma = exprs.find(',');
+        if (comma == string::npos) {
+          return false;
+        }
+        ComputeStmt c{current, w[1], exprs.substr(0, comma), exprs.substr(comma + 1)};
+        for (auto *e : {&c.from, &c.to}) {
+          replace(e->begin(), e->end(), '\t', ' ');
+          e->erase(0, e->find_first_not_of(' '));
+          e->erase(e->find_last_not_of(' ') + 1);
+        }
+        computes.push_back(c);
+      }
+    }
+
+    // As in libsensors, the bus numbers of a file's chip statements are
+    // those of the adapters named by its bus statements.
+    if (remap && !have_adapters) {
+      adapters = i2c_adapters();
+      have_adapters = true;
+    }
+    for (auto &c : computes) {
+      for (auto &p : c.chips) {
+        if (p.bus_type != SENSORS_BUS_TYPE_I2C || p.bus_nr < 0) {
+          continue;
+        }
+        auto b = busses.find(p.bus_nr);
+        auto a = b == busses.end() ? adapters.end() : adapters.find(b->second);
+        p.bus_nr = a == adapters.end() ? -3 : a->second;
+      }
+      for (auto &chip : chips) {
+        if (none_of(c.chips.begin(), c.chips.end(),
+              [&](const ChipPattern &p) { return pattern_match(p, chip); })) {
+          continue;
+        }
+        for (auto &s : chip.sensors) {
+          if (s.kind != CachedSensor::SYSFS || !s.compute || s.feature != c.feature) {
+            continue;
+          }
+          SensorExpr from, to;
+          if (!from.compile(c.from) || !to.compile(c.to)) {
+            return false;
+          }
+          // Later statements take precedence
+          s.from_expr = c.from;
+          s.to_expr = c.to;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void SensorCache::save(vector<CachedChip> &chips)
+{
+  if (!add_computes(chips)) {
+    return;
+  }
+
+  ostringstream out;
+  out << CACHE_MAGIC << '\t' << key << '\n';
+  out.precision(17);
+  for (auto &c : chips) {
+    out << "C\t" << c.name << '\t' << c.prefix << '\t' << c.path << '\t'
+      << c.bus_type << '\t' << c.bus_nr << '\t' << c.addr << '\n';
+    for (auto &s : c.sensors) {
+      out << "S\t" << s.kind << '\t' << s.feature << '\t' << s.label << '\t'
+        << s.attr << '\t' << s.scale << '\t' << (s.compute ? 1 : 0) << '\t'
+        << s.from_expr << '\t' << s.to_expr << '\n';
+    }
+  }
+  string data = out.str();
+
+  // A name, label or path with a tab or a newline would not load back
+  size_t records = 1, fields = 2;
+  for (auto &c : chips) {
+    records += 1 + c.sensors.size();
+    fields += 7 + 9 * c.sensors.size();
+  }
+  if (size_t(count(data.begin(), data.end(), '\n')) != records ||
+      size_t(count(data.begin(), data.end(), '\t')) + records != fields) {
+    return;
+  }
+
+  string tmp = path + "." + to_string(getpid());
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  bool ok = ::write(fd, data.data(), data.size()) == ssize_t(data.size());
+  close(fd);
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+  }
+}
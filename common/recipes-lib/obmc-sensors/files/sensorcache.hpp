@@ -0,0 +1,126 @@
+/*
+ * Copyright 2019-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#ifndef _SENSORCACHE_HPP_
+#define _SENSORCACHE_HPP_
+#include <memory>
+#include <string>
+#include <vector>
+#include "sensor.hpp"
+
+// Compiled "compute" expression of sensors.conf: @ is the raw value,
+// ^ and ` are exp and ln. Expressions referencing other features are
+// not supported.
+class SensorExpr {
+  struct Op {
+    char code;
+    double val;
+  };
+  static const int max_depth = 16;
+  std::vector<Op> ops;
+  const char *text = nullptr;
+  int depth = 0;
+  int max_seen = 0;
+  bool parse_sum();
+  bool parse_product();
+  bool parse_unary();
+  void skip_space();
+  void push(char code, double val, int change);
+  public:
+    // Compile <expr>, false on errors or an unsupported expression.
+    bool compile(const std::string &expr);
+    bool empty() const {return ops.empty();}
+    double eval(double raw) const;
+};
+
+// Sensor as built from libsensors, enough to recreate it without it.
+struct CachedSensor {
+  enum Kind {SYSFS, PWM, LEGACY_PWM};
+  int kind = SYSFS;
+  std::string feature;    // feature name, or the PWM attribute base
+  std::string label;
+  std::string attr;       // sysfs attribute of SYSFS sensors
+  double scale = 1;       // sysfs unit per sensor unit
+  bool compute = false;   // the feature's compute expressions apply
+  std::string from_expr;  // compute expressions, empty for none
+  std::string to_expr;
+};
+
+struct CachedChip {
+  std::string name;
+  std::string prefix;
+  std::string path;
+  int bus_type = 0;
+  int bus_nr = 0;
+  int addr = 0;
+  std::vector<CachedSensor> sensors;
+};
+
+// sensors_chip_name of a chip restored from the cache
+struct CachedChipName {
+  sensors_chip_name chip;
+  std::string prefix;
+  std::string path;
+  CachedChipName(const CachedChip &c);
+  CachedChipName(const CachedChipName &) = delete;
+  CachedChipName &operator=(const CachedChipName &) = delete;
+};
+
+// sysfs sensor restored from the cache. Reads and writes the attribute
+// directly, with the scaling and compute expressions of libsensors.
+class CachedSysfsSensor : public Sensor {
+  SysfsAttr attr;
+  std::string attr_name;
+  double scale;
+  SensorExpr from;
+  SensorExpr to;
+  public:
+    CachedSysfsSensor(const sensors_chip_name *_chip, const CachedSensor &c);
+    virtual ~CachedSysfsSensor() {}
+
+    virtual void initialize();
+    virtual float read();
+    virtual void write(float val);
+};
+
+// Chips and sensors of a SensorList, saved after a libsensors build so
+// the next process can skip sensors_init(), which parses the whole
+// configuration and walks every hwmon device in sysfs. The cache is
+// keyed by the configuration files (path, size, mtime) and the hwmon
+// devices present, so it goes stale on a configuration change or a
+// hwmon device being added or removed.
+class SensorCache {
+  std::string path;
+  std::string key;
+  std::vector<std::string> conf_files;
+  bool add_computes(std::vector<CachedChip> &chips);
+  public:
+    // Cache of the given configuration file (nullptr for the default)
+    SensorCache(const char *conf_file);
+
+    // Load the chips if the cache is current, false otherwise.
+    bool load(std::vector<CachedChip> &chips);
+
+    // Add the compute expressions of the configuration to <chips> and
+    // save them. Nothing is saved when an expression is not supported.
+    void save(std::vector<CachedChip> &chips);
+};
+
+// Scaling of the sysfs value of a subfeature type, as in libsensors
+double sensor_type_scaling(sensors_subfeature_type type);
+
+#endif
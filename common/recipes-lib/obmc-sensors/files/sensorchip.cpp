@@ -20,6 +20,7 @@
 #include <regex>
 #include <vector>
 #include "sensorchip.hpp"
+#include "sensorcache.hpp"
 
 // TODO We are currently in C++14 mode. When distribution is upgraded
 // to a compiler which supports C++17, switch to using std::filesystem
@@ -79,6 +80,36 @@ void SensorChip::enumerate()
   }
 }
 
+void SensorChip::save(CachedChip &c)
+{
+  c.name = name;
+  c.prefix = chip->prefix;
+  c.path = chip->path;
+  c.bus_type = chip->bus.type;
+  c.bus_nr = chip->bus.nr;
+  c.addr = chip->addr;
+  c.sensors.clear();
+  for (auto &it : *this) {
+    c.sensors.emplace_back();
+    it.second->save(c.sensors.back());
+  }
+}
+
+void SensorChip::restore(const CachedChip &c)
+{
+  for (auto &cs : c.sensors) {
+    unique_ptr<Sensor> snr;
+    if (cs.kind == CachedSensor::PWM) {
+      snr.reset(new PWMSensor(chip, cs.feature));
+    } else if (cs.kind == CachedSensor::LEGACY_PWM) {
+      snr.reset(new LegacyPWMSensor(chip, cs.feature));
+    } else {
+      snr.reset(new CachedSysfsSensor(chip, cs));
+    }
+    addsensor(move(snr));
+  }
+}
+
 unique_ptr<Sensor> FanSensorChip::make_sensor(const sensors_chip_name *chip, const std::string &name)
 {
   return unique_ptr<PWMSensor>(new PWMSensor(chip, name));
@@ -22,6 +22,8 @@
 #include <string>
 #include "sensor.hpp"
 
+struct CachedChip;
+
 // Collection of sensors grouped in a single "chip". Provides efficient
 // lookup of sensors within a chip.
 class SensorChip : public std::map<std::string, std::unique_ptr<Sensor>> {
@@ -43,6 +45,12 @@ class SensorChip : public std::map<std::string, std::unique_ptr<Sensor>> {
 
     // Enumerate sensors in this chip
     virtual void enumerate();
+
+    // Record of the chip and its sensors for SensorCache
+    void save(CachedChip &c);
+
+    // Add the sensors of a record from SensorCache, in place of enumerate()
+    void restore(const CachedChip &c);
 };
 
 // Collection of sensors in a Fan chip (Works for 4.18 and above kernels).
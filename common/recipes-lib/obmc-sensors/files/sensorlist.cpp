@@ -68,15 +68,56 @@ void SensorList::enumerate()
 
 void SensorList::re_enumerate(const char *conf_file)
 {
+  for (auto &h : handles) {
+    h.c = nullptr;
+    h.snr = nullptr;
+  }
   sensors_cleanup();
   this->clear();
+  cached_names.clear();
 
   _sensor_list_build(conf_file);
 }
 
+void SensorList::restore(const vector<CachedChip> &chips)
+{
+  for (auto &c : chips) {
+    cached_names.emplace_back(new CachedChipName(c));
+    (*this)[c.name] = make_chip(&cached_names.back()->chip, c.name);
+    (*this)[c.name]->restore(c);
+  }
+}
+
+// Run a build step with the errors logged, true if it completed.
+template <typename F>
+static bool build_step(const char *what, F step)
+{
+  try {
+    step();
+    return true;
+  } catch (std::out_of_range &e) {
+    syslog(LOG_ERR, "%s: Out of range exception: %s\n", what, e.what());
+  } catch (std::system_error &e) {
+    syslog(LOG_ERR, "%s: System error: %s - %s\n", what, e.code().message().c_str(), e.what());
+  } catch (...) {
+    syslog(LOG_CRIT, "%s: Unknown error", what);
+  }
+  return false;
+}
+
 void SensorList::_sensor_list_build(const char* conf_file)
 {
   FILE *f = NULL;
+  SensorCache cache(conf_file);
+  vector<CachedChip> chips;
+
+  if (cache.load(chips)) {
+    if (build_step("Cache", [&] { restore(chips); })) {
+      return;
+    }
+    this->clear();
+    cached_names.clear();
+  }
 
   if (conf_file != NULL) {
     f = fopen(conf_file, "r");
@@ -85,13 +126,47 @@ void SensorList::_sensor_list_build(const char* conf_file)
   if (f != NULL) {
     fclose(f);
   }
-  try {
-    enumerate();
-  } catch (std::out_of_range &e) {
-    syslog(LOG_ERR, "Initialization: Out of range exception: %s\n", e.what());
-  } catch (std::system_error &e) {
-    syslog(LOG_ERR, "Initialization: System error: %s - %s\n", e.code().message().c_str(), e.what());
-  } catch (...) {
-    syslog(LOG_CRIT, "Initialization: Unknown error");
+  if (!build_step("Initialization", [&] { enumerate(); })) {
+    return;
+  }
+  build_step("Cache save", [&] {
+    chips.clear();
+    for (auto &it : *this) {
+      chips.emplace_back();
+      it.second->save(chips.back());
+    }
+    cache.save(chips);
+  });
+}
+
+int SensorList::resolve(const string &chip, const string &label)
+{
+  string key = chip + ":" + label;
+  auto it = handle_ids.find(key);
+  if (it != handle_ids.end()) {
+    return it->second;
+  }
+  SensorChip *c = this->at(chip).get();
+  Sensor *snr = c->at(label).get();
+  int id = int(handles.size());
+  handles.push_back(Handle{chip, label, c, snr});
+  handle_ids[key] = id;
+  return id;
+}
+
+Sensor &SensorList::handle(int id)
+{
+  Handle &h = handles.at(id);
+  if (h.snr == nullptr) {
+    SensorChip *c = this->at(h.chip).get();
+    h.snr = c->at(h.label).get();
+    h.c = c;
   }
+  return *h.snr;
+}
+
+SensorChip &SensorList::handle_chip(int id)
+{
+  handle(id);
+  return *handles[id].c;
 }
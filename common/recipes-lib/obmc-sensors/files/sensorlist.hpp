@@ -17,12 +17,27 @@
  */
 #ifndef _SENSORLIST_HPP_
 #define _SENSORLIST_HPP_
+#include <unordered_map>
+#include <vector>
 #include "sensorchip.hpp"
+#include "sensorcache.hpp"
 
 // Collection of sensor-chips. Provides efficient look-up of sensor chips.
 class SensorList : public std::map<std::string, std::unique_ptr<SensorChip>> {
   private:
+    // Sensor resolved by resolve(), looked up again after re_enumerate()
+    struct Handle {
+      std::string chip;
+      std::string label;
+      SensorChip *c;
+      Sensor *snr;
+    };
+    std::vector<Handle> handles;
+    std::unordered_map<std::string, int> handle_ids;
+    // Chip names of a list restored from SensorCache
+    std::vector<std::unique_ptr<CachedChipName>> cached_names;
     void _sensor_list_build(const char* conf_file = nullptr);
+    void restore(const std::vector<CachedChip> &chips);
   protected:
     // Allocates a chip object
     virtual std::unique_ptr<SensorChip> make_chip(const sensors_chip_name *chip, const std::string &name);
@@ -33,8 +48,19 @@ class SensorList : public std::map<std::string, std::unique_ptr<SensorChip>> {
     // enumerate all sensor chips.
     void enumerate();
 
-    // re_enumerate all sensor chips.
+    // re_enumerate all sensor chips. Handles stay valid.
     void re_enumerate(const char *conf_file = nullptr);
+
+    // Id of the sensor for handle(), throws out_of_range if not present.
+    int resolve(const std::string &chip, const std::string &label);
+
+    // Sensor of an id from resolve(), and its chip. Throw out_of_range
+    // for unknown ids, or sensors gone after re_enumerate().
+    Sensor &handle(int id);
+    SensorChip &handle_chip(int id);
+    // Names the id was resolved from
+    const std::string &handle_chip_name(int id) {return handles.at(id).chip;}
+    const std::string &handle_label(int id) {return handles.at(id).label;}
 };
 
 #endif
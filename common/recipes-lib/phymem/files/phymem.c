@@ -19,6 +19,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <syslog.h>
 #include <sys/mman.h>
@@ -67,66 +70,212 @@ int phymem_close(void *map_base, size_t length)
 	return ret;
 }
 
-int phymem_read(off_t addr, size_t offset, memLength length, void *value)
+struct phymem_window {
+	off_t base;		/* physical address of the window */
+	size_t length;
+	void *map_base;		/* mapping of the pages of the window */
+	size_t mapped_size;
+	char *vir_base;		/* virtual address of "base" */
+};
+
+phymem_t *phymem_map(off_t base, size_t length)
 {
-	void *vir_addr = NULL, *map_base = NULL;
-	size_t mapped_size = 0, page_size = 0;
-	int ret = 0;
+	phymem_t *win;
 
-	page_size = getpagesize();
-	map_base = phymem_open(addr, page_size, &mapped_size);
-	if (map_base == MAP_FAILED) {
+	if (length == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	win = malloc(sizeof(*win));
+	if (win == NULL) {
+		return NULL;
+	}
+
+	win->map_base = phymem_open(base, length, &win->mapped_size);
+	if (win->map_base == MAP_FAILED) {
+		free(win);
+		return NULL;
+	}
+	win->base = base;
+	win->length = length;
+	win->vir_base = (char *)win->map_base +
+			(base & (off_t)(getpagesize() - 1));
+	return win;
+}
+
+void phymem_unmap(phymem_t *win)
+{
+	if (win != NULL) {
+		phymem_close(win->map_base, win->mapped_size);
+		free(win);
+	}
+}
+
+static int phymem_win_check(phymem_t *win, size_t offset, memLength length,
+			    size_t count)
+{
+	size_t size = (length == M_BYTE) ? 1 : ((length == M_WORD) ? 2 : 4);
+
+	if (win == NULL || (offset & (size - 1)) != 0 ||
+	    count > (win->length / size) ||
+	    offset > win->length - count * size) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+int phymem_win_read(phymem_t *win, size_t offset, memLength length,
+		    void *buf, size_t count)
+{
+	volatile char *vir_addr;
+	size_t i;
+
+	if (buf == NULL || phymem_win_check(win, offset, length, count) < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	vir_addr = win->vir_base + offset;
+
+	for (i = 0; i < count; i++) {
+		switch (length) {
+		case M_BYTE:
+			((uint8_t *)buf)[i] = ((volatile uint8_t *)vir_addr)[i];
+			break;
+		case M_WORD:
+			((uint16_t *)buf)[i] = ((volatile uint16_t *)vir_addr)[i];
+			break;
+		case M_DWORD:
+		default:
+			((uint32_t *)buf)[i] = ((volatile uint32_t *)vir_addr)[i];
+			break;
+		}
+	}
+	return 0;
+}
+
+int phymem_win_write(phymem_t *win, size_t offset, memLength length,
+		     const void *buf, size_t count)
+{
+	volatile char *vir_addr;
+	size_t i;
+
+	if (buf == NULL || phymem_win_check(win, offset, length, count) < 0) {
+		errno = EINVAL;
 		return -1;
 	}
-	vir_addr = (char*)map_base + offset;
-
-	switch (length) {
-	case M_BYTE:
-		*(uint8_t *)value = *(volatile uint8_t*)vir_addr;
-		break;
-	case M_WORD:
-		*(uint16_t *)value = *(volatile uint16_t*)vir_addr;
-		break;
-	case M_DWORD:
-		*(uint32_t *)value = *(volatile uint32_t*)vir_addr;
-		break;
-	default:
-		*(uint32_t *)value = *(volatile uint32_t*)vir_addr;
-		break;
-	}
-	ret = phymem_close(map_base, mapped_size);
+	vir_addr = win->vir_base + offset;
+
+	for (i = 0; i < count; i++) {
+		switch (length) {
+		case M_BYTE:
+			((volatile uint8_t *)vir_addr)[i] = ((const uint8_t *)buf)[i];
+			break;
+		case M_WORD:
+			((volatile uint16_t *)vir_addr)[i] = ((const uint16_t *)buf)[i];
+			break;
+		case M_DWORD:
+		default:
+			((volatile uint32_t *)vir_addr)[i] = ((const uint32_t *)buf)[i];
+			break;
+		}
+	}
+	return 0;
+}
+
+/*
+ * The address based accessors below keep the pages they used mapped:
+ * register dumps read many registers of the same few pages (SCU, LPC,
+ * GPIO...), so the least recently used of PHYMEM_CACHE_SIZE pages is
+ * unmapped only when another page is needed.
+ */
+#define PHYMEM_CACHE_SIZE	4
+
+static struct {
+	phymem_t *win;
+	unsigned long last_used;
+} phymem_cache[PHYMEM_CACHE_SIZE];
+static unsigned long phymem_cache_clock;
+static pthread_mutex_t phymem_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Get the cached window of the page of <phys>, called with the lock held. */
+static phymem_t *phymem_cache_get(off_t phys)
+{
+	off_t page_base = phys & ~(off_t)(getpagesize() - 1);
+	int i, victim = 0;
+
+	for (i = 0; i < PHYMEM_CACHE_SIZE; i++) {
+		phymem_t *win = phymem_cache[i].win;
+
+		if (win != NULL && win->base == page_base) {
+			phymem_cache[i].last_used = ++phymem_cache_clock;
+			return win;
+		}
+		if (phymem_cache[i].last_used <
+		    phymem_cache[victim].last_used) {
+			victim = i;
+		}
+	}
+
+	phymem_unmap(phymem_cache[victim].win);
+	phymem_cache[victim].win = phymem_map(page_base, getpagesize());
+	phymem_cache[victim].last_used = ++phymem_cache_clock;
+	return phymem_cache[victim].win;
+}
+
+void phymem_cache_flush(void)
+{
+	int i;
+
+	pthread_mutex_lock(&phymem_cache_lock);
+	for (i = 0; i < PHYMEM_CACHE_SIZE; i++) {
+		phymem_unmap(phymem_cache[i].win);
+		phymem_cache[i].win = NULL;
+		phymem_cache[i].last_used = 0;
+	}
+	pthread_mutex_unlock(&phymem_cache_lock);
+}
+
+static int phymem_access(off_t addr, size_t offset, memLength length,
+			 void *value, bool write)
+{
+	off_t phys = addr + offset;
+	phymem_t *win;
+	int ret = -1;
+
+	pthread_mutex_lock(&phymem_cache_lock);
+	win = phymem_cache_get(phys);
+	if (win != NULL) {
+		if (write) {
+			ret = phymem_win_write(win, phys - win->base, length,
+					       value, 1);
+		} else {
+			ret = phymem_win_read(win, phys - win->base, length,
+					      value, 1);
+		}
+	}
+	pthread_mutex_unlock(&phymem_cache_lock);
 	return ret;
 }
 
+int phymem_read(off_t addr, size_t offset, memLength length, void *value)
+{
+	return phymem_access(addr, offset, length, value, false);
+}
+
 int phymem_write(off_t addr, size_t offset, memLength length, uint32_t value)
 {
-	void *vir_addr = NULL, *map_base = NULL;
-	size_t mapped_size = 0, page_size = 0;
-	int ret = 0;
+	uint8_t byte = value;
+	uint16_t word = value;
+	void *ptr = &value;
 
-	page_size = getpagesize();
-	map_base = phymem_open(addr, page_size, &mapped_size);
-	if (map_base == MAP_FAILED) {
-                return -1;
-        }
-	vir_addr = (char*)map_base + offset;
-
-	switch (length) {
-	case M_BYTE:
-		*(volatile uint8_t*)vir_addr = (uint8_t)value;
-		break;
-	case M_WORD:
-		*(volatile uint16_t*)vir_addr = (uint16_t)value;
-		break;
-	case M_DWORD:
-		*(volatile uint32_t*)vir_addr = (uint32_t)value;
-		break;
-	default:
-		*(volatile uint32_t*)vir_addr = (uint32_t)value;
-		break;
-	}
-	ret = phymem_close(map_base, mapped_size);
-	return ret;
+	if (length == M_BYTE) {
+		ptr = &byte;
+	} else if (length == M_WORD) {
+		ptr = &word;
+	}
+	return phymem_access(addr, offset, length, ptr, true);
 }
 
 int phymem_get_byte(off_t addr, size_t offset, uint8_t *value)
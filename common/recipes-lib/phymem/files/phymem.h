@@ -2,6 +2,7 @@
 #define PHYMEM_H
 
 #include <sys/types.h>
+#include <stdint.h>
 
 typedef enum memLength {
 	M_BYTE,
@@ -26,4 +27,32 @@ int phymem_set_dword(off_t addr, size_t offset, uint32_t value);
 int phymem_dword_clear_bit(off_t base, size_t offset, uint8_t bit);
 int phymem_dword_set_bit(off_t base, size_t offset, uint8_t bit);
 
+/*
+ * The accessors above keep a few recently used pages mapped. Unmap them,
+ * e.g. before a long sleep of a daemon.
+ */
+void phymem_cache_flush(void);
+
+/*
+ * A mapped window of <length> bytes of physical memory from <base>, for
+ * tools which access many registers of a block: the window is mapped
+ * once by phymem_map(), and stays mapped until phymem_unmap().
+ */
+typedef struct phymem_window phymem_t;
+
+phymem_t *phymem_map(off_t base, size_t length);
+void phymem_unmap(phymem_t *win);
+
+/*
+ * Read or write <count> bytes/words/dwords (by <length>) from <offset>
+ * of the window, which must be aligned to their size. ASPEED BMC only
+ * supports 4 bytes align writing.
+ *
+ * Return 0 for success, or -1 with errno set.
+ */
+int phymem_win_read(phymem_t *win, size_t offset, memLength length,
+		    void *buf, size_t count);
+int phymem_win_write(phymem_t *win, size_t offset, memLength length,
+		     const void *buf, size_t count);
+
 #endif
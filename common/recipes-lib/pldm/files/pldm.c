@@ -29,6 +29,7 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <openbmc/ncsi.h>
@@ -499,7 +500,8 @@ void printComponentImgInfo(pldm_fw_pkg_hdr_t *pFwPkgHdr, int index)
 
 // Given a PLDM Firmware package, this function will
 //  1. allocate a pldm_fw_pkg_hdr_t structure representing this package,
-//  2. read PLDM firmware package to RAM
+//  2. map PLDM firmware package to RAM: the component images are sent
+//     straight from the mapping, with no file I/O per data request
 //  3. initialize header info area of pldm_fw_pkg_hdr_t
 //  4. returns
 //       1. pointer to the struct,
@@ -508,18 +510,23 @@ void printComponentImgInfo(pldm_fw_pkg_hdr_t *pFwPkgHdr, int index)
 int
 init_pkg_hdr_info(char *path, pldm_fw_pkg_hdr_t** pFwPkgHdr, int *pOffset)
 {
-  FILE *fp;
-  int rcnt, size;
+  int fd, size;
   struct stat buf;
+  void *map;
 
   // Open the file exclusively for read
-  fp = fopen(path, "r");
-  if (!fp) {
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
     printf("ERROR: invalid file path :%s!\n", path);
     return -1;
   }
 
-  stat(path, &buf);
+  if (fstat(fd, &buf) < 0 ||
+      buf.st_size < offsetof(pldm_fw_pkg_hdr_info_t, versionString)) {
+    printf("ERROR: invalid file :%s!\n", path);
+    close(fd);
+    return -1;
+  }
   size = buf.st_size;
   printf("size of file is %d bytes\n", size);
 
@@ -527,28 +534,20 @@ init_pkg_hdr_info(char *path, pldm_fw_pkg_hdr_t** pFwPkgHdr, int *pOffset)
   *pFwPkgHdr = (pldm_fw_pkg_hdr_t *)calloc(1, sizeof(pldm_fw_pkg_hdr_t));
   if (!(*pFwPkgHdr)) {
     printf("ERROR: pFwPkgHdr malloc failed, size %zu\n", sizeof(pldm_fw_pkg_hdr_t));
-    fclose(fp);
-    return -1;
-  }
-
-  // allocate actual buffer to store fw package header
-  (*pFwPkgHdr)->rawHdrBuf = (unsigned char *)calloc(1, size);
-  if (!(*pFwPkgHdr)->rawHdrBuf) {
-    printf("ERROR: rawHdrBuf malloc failed, size %d\n", size);
-    fclose(fp);
+    close(fd);
     return -1;
   }
 
-  // Move the file pointer to the start and read the entire package header
-  fseek(fp, 0, SEEK_SET);
-  rcnt = fread((*pFwPkgHdr)->rawHdrBuf, 1, size, fp);
-  if (rcnt < size) {
-    printf("ERROR: rawHdrBuf read, rcnt(%d) < %d", rcnt,
-           size);
-    fclose(fp);
+  // map the entire package, and have it read ahead of the data requests
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("ERROR: rawHdrBuf mmap failed, size %d\n", size);
     return -1;
   }
-  fclose(fp);
+  madvise(map, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+  (*pFwPkgHdr)->rawHdrBuf = (unsigned char *)map;
+  (*pFwPkgHdr)->rawHdrSize = size;
 
 
   (*pFwPkgHdr)->phdrInfo = (pldm_fw_pkg_hdr_info_t *)(*pFwPkgHdr)->rawHdrBuf;
@@ -686,6 +685,15 @@ init_component_img_info(pldm_fw_pkg_hdr_t* pFwPkgHdr, int *pOffset)
     //  version size
     *pOffset += offsetof(pldm_component_img_info_t, versionString) +
              pFwPkgHdr->pCompImgInfo[i]->versionStringLength;
+
+    // the data requests are served from the image, so it must be in the package
+    if (((uint64_t)pFwPkgHdr->pCompImgInfo[i]->locationOffset +
+         pFwPkgHdr->pCompImgInfo[i]->size) > pFwPkgHdr->rawHdrSize) {
+      printf("ERROR: component %d (offset 0x%x, size 0x%x) exceeds package\n",
+             i, pFwPkgHdr->pCompImgInfo[i]->locationOffset,
+             pFwPkgHdr->pCompImgInfo[i]->size);
+      return -1;
+    }
   }
 
   return 0;
@@ -717,7 +725,7 @@ free_pldm_pkg_data(pldm_fw_pkg_hdr_t **pFwPkgHdr)
     free((*pFwPkgHdr)->pCompImgInfo);
   }
   if ((*pFwPkgHdr)->rawHdrBuf) {
-    free((*pFwPkgHdr)->rawHdrBuf);
+    munmap((*pFwPkgHdr)->rawHdrBuf, (*pFwPkgHdr)->rawHdrSize);
   }
   free(*pFwPkgHdr);
   return;
@@ -731,7 +739,7 @@ pldm_parse_fw_pkg(char *path) {
   int offset = 0;
 
   // firmware package header
-  pldm_fw_pkg_hdr_t *pFwPkgHdr;
+  pldm_fw_pkg_hdr_t *pFwPkgHdr = NULL;
 
   // initialize pFwPkgHdr access pointer as fw package header contains
   // multiple variable size fields
@@ -788,16 +796,29 @@ int handlePldmReqFwData(pldm_fw_pkg_hdr_t *pkgHdr, pldm_cmd_req *pCmd, pldm_resp
   int numPaddingNeeded = pReqDataCmd->length > compBytesLeft ?
                    (pReqDataCmd->length - compBytesLeft) : 0;
 
+  memcpy(pldmRes->common, pCmd->common, PLDM_COMMON_REQ_LEN);
+  // clear Req bit in PLDM response header
+  pldmRes->common[PLDM_IID_OFFSET] &= PLDM_RESP_MASK;
+  pldmRes->resp_size = PLDM_COMMON_RES_LEN;
+
+  // the NIC must not read past the image, nor past the response buffer
+  if (pReqDataCmd->offset > componentSize) {
+    printf("\n%s offset 0x%x out of range\n", __FUNCTION__, pReqDataCmd->offset);
+    pldmRes->common[PLDM_CC_OFFSET] = CC_DATA_OUT_OF_RANGE;
+    return 0;
+  }
+  if (pReqDataCmd->length > sizeof(pldmRes->response)) {
+    printf("\n%s length 0x%x too long\n", __FUNCTION__, pReqDataCmd->length);
+    pldmRes->common[PLDM_CC_OFFSET] = CC_INVALID_TRANSFER_LENTH;
+    return 0;
+  }
+
 
   printf("\r%s offset = 0x%x, length = 0x%x, compBytesLeft=%d, numPadding=%d",
          __FUNCTION__, pReqDataCmd->offset, pReqDataCmd->length, compBytesLeft,
          numPaddingNeeded);
   fflush(stdout);
 
-  memcpy(pldmRes->common, pCmd->common, PLDM_COMMON_REQ_LEN);
-  // clear Req bit in PLDM response header
-  pldmRes->common[PLDM_IID_OFFSET] &= PLDM_RESP_MASK;
-  // hard code success for now, need to check length in the future
   pldmRes->common[PLDM_CC_OFFSET] = CC_SUCCESS;
 
 
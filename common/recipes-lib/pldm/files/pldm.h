@@ -22,6 +22,10 @@
 #include "pldm_base.h"
 #include "pldm_fw_update.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // PLDM types, defined in DMTF DSP0245 v1.2.0
 typedef enum pldm_type {
   PLDM_TYPE_MSG_CTRL_AND_DISCOVERY       = 0,
@@ -85,4 +89,23 @@ int ncsiDecodePldmType(NCSI_Response_Packet *ncsi_resp);
 int ncsiDecodePldmCmd(NCSI_Response_Packet *ncsi_resp);
 unsigned char *get_pldm_response_payload(unsigned char *buf);
 
+// NC-SI transport and options of ncsi_pldm_update_fw()
+typedef struct {
+  // sends a NC-SI command, returns the malloc'ed response or NULL
+  NCSI_NL_RSP_T *(*send_nl_msg)(NCSI_NL_MSG_T *nl_msg);
+  int pldm_bufsize;   // max transfer size requested from the NIC
+  int reply_delay_ms; // wait after each reply to the NIC
+  // called after each FW data request, with the bytes sent so far
+  void (*progress)(void *arg, uint64_t done, uint64_t total);
+  void *arg;
+} pldm_ncsi_update_t;
+
+// Updates the NIC on channel <ch> with the PLDM package <path>, and
+// activates the new firmware. Returns 0 on success.
+int ncsi_pldm_update_fw(char *path, uint8_t ch, const pldm_ncsi_update_t *upd);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif
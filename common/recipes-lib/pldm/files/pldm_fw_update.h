@@ -224,6 +224,9 @@ typedef struct {
 
   // package header checksum area
   uint32_t pkgHdrChksum;
+
+  // size of the whole package, mapped at rawHdrBuf
+  uint32_t rawHdrSize;
 } __attribute__((packed)) pldm_fw_pkg_hdr_t;
 
 #define PLDM_MAX_XFER_SIZE (MAX_PLDM_MSG_SIZE - PLDM_COMMON_RES_LEN)
@@ -0,0 +1,386 @@
+/*
+ *
+ * Copyright 2018-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <openbmc/ncsi.h>
+#include <openbmc/kv.h>
+#include "pldm_base.h"
+#include "pldm_fw_update.h"
+#include "pldm.h"
+
+// PLDM firmware update of a NIC over NC-SI, shared by ncsi-util and fw-util
+
+#define MAX_SEND_NL_MSG_RETRY 3
+#define SLEEP_TIME_MS               200  // max wait time per loop in ms
+#define MIN_SLEEP_TIME_MS           1    // first wait time of an idle loop
+
+enum {
+  STATE_IDLE=0,
+  STATE_LEARN_COMPONENTS,
+  STATE_READY_XFER,
+  STATE_DOWNLOAD,
+  STATE_VERIFY,
+  STATE_APPLY,
+  STATE_ACTIVATE,
+};
+
+static void msleep(int msec)
+{
+  usleep(msec * 1000);
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void print_pldm_resp_raw(NCSI_NL_RSP_T *nl_resp)
+{
+  int i;
+  printf("PLDM Payload\n");
+  for (i = 8; i < nl_resp->hdr.payload_length; ++i)
+    printf("0x%x ", nl_resp->msg_payload[i]);
+  printf("\n");
+}
+
+static void print_pldm_cmd_status(NCSI_NL_RSP_T *nl_resp)
+{
+  if (nl_resp->hdr.cmd == NCSI_PLDM_REQUEST) {
+    printf("PLDM Completion Code = 0x%x (%s)\n",
+        ncsiDecodePldmCompCode(nl_resp),
+        pldm_fw_cmd_cc_to_name(ncsiDecodePldmCompCode(nl_resp)));
+  }
+}
+
+// sends nl_msg containing PLDM command across NCSI interface and
+//  and returns the completion code, or -1 if error occurs
+static int sendPldmCmdAndCheckResp(const pldm_ncsi_update_t *upd,
+                                   NCSI_NL_MSG_T *nl_msg)
+{
+  NCSI_NL_RSP_T *nl_resp;
+  int ret = 0;
+
+  if (!nl_msg)
+    return -1;
+
+  nl_resp = upd->send_nl_msg(nl_msg);
+
+  if (!nl_resp) {
+    return -1;
+  }
+
+  print_pldm_cmd_status(nl_resp);
+  ret = ncsiDecodePldmCompCode(nl_resp);
+
+  free(nl_resp);
+
+  return ret;
+}
+
+static NCSI_NL_RSP_T * send_nl_msg_retry(const pldm_ncsi_update_t *upd,
+                                         NCSI_NL_MSG_T *nl_msg)
+{
+  int retry = 0;
+  NCSI_NL_RSP_T *nl_resp = NULL;
+
+  while (retry <= MAX_SEND_NL_MSG_RETRY) {
+    nl_resp = upd->send_nl_msg(nl_msg);
+    if (nl_resp != NULL) {
+      break;
+    }
+    retry++;
+  }
+
+  return nl_resp;
+}
+
+int ncsi_pldm_update_fw(char *path, uint8_t ch, const pldm_ncsi_update_t *upd)
+{
+  NCSI_NL_MSG_T *nl_msg = NULL;
+  NCSI_NL_RSP_T *nl_resp = NULL;
+  pldm_fw_pkg_hdr_t *pkgHdr = NULL;
+  pldm_cmd_req pldmReq = {0};
+  pldm_response *pldmRes = NULL;
+  int pldmCmdStatus = 0;
+  int i = 0, j = 0;
+  int ret = 0;
+  int waitcycle = 0;
+  int waitTOsec = 0;
+  int currnet_state = -1, previous_state = -1;
+  char value[64];
+  struct timespec ts;
+  uint64_t xferTotal = 0;
+#define MAX_WAIT_CYCLE 1000
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  snprintf(value, sizeof(value), "%ld", ts.tv_sec + 600);
+  kv_set("block_ncsi_xmit", value, 0, 0);
+
+  nl_msg = calloc(1, sizeof(NCSI_NL_MSG_T));
+  if (!nl_msg) {
+    printf("%s, Error: failed nl_msg buffer allocation(%zu)\n",
+           __FUNCTION__, sizeof(NCSI_NL_MSG_T));
+    ret = -1;
+    goto free_exit;
+  }
+  memset(nl_msg, 0, sizeof(NCSI_NL_MSG_T));
+
+  pldmRes = calloc(1, sizeof(pldm_response));
+  if (!pldmRes) {
+    printf("%s, Error: failed pldmRes buffer allocation(%zu)\n",
+           __FUNCTION__, sizeof(pldm_response));
+    ret = -1;
+    goto free_exit;
+  }
+
+
+  pkgHdr = pldm_parse_fw_pkg(path);
+  if (!pkgHdr) {
+    ret = -1;
+    goto free_exit;
+  }
+
+  for (i=0; i<pkgHdr->componentImageCnt; ++i) {
+    xferTotal += pkgHdr->pCompImgInfo[i]->size;
+  }
+
+  pldmCreateReqUpdateCmd(pkgHdr, &pldmReq, upd->pldm_bufsize);
+  printf("\n01 PldmRequestUpdateOp: payload_size=%d\n", pldmReq.payload_size);
+  ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                       &(pldmReq.common[0]));
+  if (ret) {
+    goto free_exit;
+  }
+
+  if (sendPldmCmdAndCheckResp(upd, nl_msg) != CC_SUCCESS) {
+    ret = -1;
+    goto free_exit;
+  }
+
+  for (i=0; i<pkgHdr->componentImageCnt; ++i) {
+    memset(&pldmReq, 0, sizeof(pldm_cmd_req));
+    pldmCreatePassComponentTblCmd(pkgHdr, i, &pldmReq);
+    printf("\n02 PldmPassComponentTableOp[%d]: payload_size=%d\n", i,
+            pldmReq.payload_size);
+    ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                         &(pldmReq.common[0]));
+    if (ret) {
+      goto free_exit;
+    }
+    if (sendPldmCmdAndCheckResp(upd, nl_msg) != CC_SUCCESS) {
+      ret = -1;
+      goto free_exit;
+    }
+  }
+
+
+
+  for (i=0; i<pkgHdr->componentImageCnt; ++i) {
+    memset(&pldmReq, 0, sizeof(pldm_cmd_req));
+    pldmCreateUpdateComponentCmd(pkgHdr, i, &pldmReq);
+    printf("\n03 PldmUpdateComponentOp[%d]: payload_size=%d\n", i,
+            pldmReq.payload_size);
+    ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                         &(pldmReq.common[0]));
+    if (ret) {
+      goto free_exit;
+    }
+    if (sendPldmCmdAndCheckResp(upd, nl_msg) != CC_SUCCESS) {
+      ret = -1;
+      goto free_exit;
+    }
+  }
+
+  // FW data transfer
+  //  The NIC asks for the data, so the next request is polled for: right
+  //  after a reply, with a short wait that backs off to SLEEP_TIME_MS
+  //  while the NIC is busy.
+  int loopCount = 0;
+  int idleMs = 0, sleepMs = MIN_SLEEP_TIME_MS;
+  int pldmCmd = 0;
+  uint64_t xferStart = now_us(), reqStart, rtt;
+  uint64_t xferBytes = 0, rttTotal = 0, rttMax = 0;
+  uint32_t xferReqs = 0;
+  setPldmTimeout(CMD_UPDATE_COMPONENT, &waitTOsec);
+  while (idleMs < (waitTOsec * 1000)) {
+//    printf("\n04 QueryPendingNcPldmRequestOp, loop=%d\n", loopCount);
+    reqStart = now_us();
+    ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_QUERY_PENDING_NC_PLDM_REQ, 0, NULL);
+    if (ret) {
+      goto free_exit;
+    }
+    nl_resp = send_nl_msg_retry(upd, nl_msg);
+    if (!nl_resp) {
+      ret = -1;
+      goto free_exit;
+    }
+    print_pldm_cmd_status(nl_resp);
+
+    pldmCmd = ncsiGetPldmCmd(nl_resp, &pldmReq);
+    free(nl_resp);
+    nl_resp = NULL;
+    if (pldmCmd == -1) {
+  //    printf("No pending command, idle %d ms\n", idleMs);
+      msleep(sleepMs); // wait some time and try again
+      idleMs += sleepMs;
+      sleepMs *= 2;
+      if (sleepMs > SLEEP_TIME_MS)
+        sleepMs = SLEEP_TIME_MS;
+      continue;
+    } else {
+      idleMs = 0;
+      sleepMs = MIN_SLEEP_TIME_MS;
+    }
+
+    if ( (pldmCmd == CMD_REQUEST_FIRMWARE_DATA) ||
+         (pldmCmd == CMD_TRANSFER_COMPLETE) ||
+         (pldmCmd == CMD_VERIFY_COMPLETE) ||
+         (pldmCmd == CMD_APPLY_COMPLETE)) {
+      setPldmTimeout(pldmCmd, &waitTOsec);
+      loopCount++;
+      waitcycle = 0;
+      pldmCmdStatus = pldmFwUpdateCmdHandler(pkgHdr, &pldmReq, pldmRes);
+      ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_SEND_NC_PLDM_REPLY,
+                                 pldmRes->resp_size, pldmRes->common);
+      if (ret) {
+        goto free_exit;
+      }
+      nl_resp = send_nl_msg_retry(upd, nl_msg);
+      if (!nl_resp) {
+        ret = -1;
+        goto free_exit;
+      }
+      //print_ncsi_resp(nl_resp);
+      free(nl_resp);
+      nl_resp = NULL;
+      if (pldmCmd == CMD_REQUEST_FIRMWARE_DATA) {
+        rtt = now_us() - reqStart;
+        rttTotal += rtt;
+        if (rtt > rttMax)
+          rttMax = rtt;
+        xferBytes += ((PLDM_RequestFWData_t *)pldmReq.payload)->length;
+        xferReqs++;
+        if (upd->progress)
+          upd->progress(upd->arg, xferBytes, xferTotal);
+      }
+      if ((pldmCmd == CMD_APPLY_COMPLETE) || (pldmCmdStatus == -1))
+        break;
+      if (upd->reply_delay_ms)
+        msleep(upd->reply_delay_ms);
+    } else {
+      printf("unknown PLDM cmd 0x%x\n", pldmCmd);
+      waitcycle++;
+      if (waitcycle >= MAX_WAIT_CYCLE) {
+        printf("max wait cycle exceeded, exit\n");
+        break;
+      }
+    }
+  }
+
+  if (xferReqs) {
+    double secs = (now_us() - xferStart) / 1e6;
+    printf("\nFW data: %llu bytes in %.1f s (%.0f bytes/s), %u requests, "
+           "RTT avg %llu us, max %llu us\n",
+           (unsigned long long)xferBytes, secs, secs > 0 ? xferBytes / secs : 0,
+           xferReqs, (unsigned long long)(rttTotal / xferReqs),
+           (unsigned long long)rttMax);
+  }
+
+  // only activate FW if update loop exists with good status
+  if (!pldmCmdStatus && (pldmCmd == CMD_APPLY_COMPLETE)) {
+    // update successful,  activate FW
+    memset(&pldmReq, 0, sizeof(pldm_cmd_req));
+    pldmCreateActivateFirmwareCmd(&pldmReq);
+    printf("\n05 PldmActivateFirmwareOp\n");
+    ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                         &(pldmReq.common[0]));
+    if (ret) {
+      goto free_exit;
+    }
+    if (sendPldmCmdAndCheckResp(upd, nl_msg) != CC_SUCCESS) {
+      for (j=0; j<5; j++) {
+        sleep(2);
+        memset(&pldmReq, 0, sizeof(pldm_cmd_req));
+        pldmCreateGetStatusCmd(&pldmReq);
+        ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                            &(pldmReq.common[0]));
+        if (ret) {
+          printf("\nPldmGetStatus fail ret=%d\n",ret);
+          goto free_exit;
+        }
+        nl_resp = upd->send_nl_msg(nl_msg);
+        if (!nl_resp) {
+          printf("\nPldmGetStatus send_nl_msg fail\n");
+          ret = -1;
+          goto free_exit;
+        }
+        print_pldm_cmd_status(nl_resp);
+        print_pldm_resp_raw(nl_resp);
+        currnet_state = nl_resp->msg_payload[8];
+        previous_state = nl_resp->msg_payload[9];
+        free(nl_resp);
+        nl_resp = NULL;
+        if (currnet_state == STATE_IDLE && previous_state == STATE_ACTIVATE) {
+          ret = 0;
+          break;
+        } else {
+          ret = -1;
+        }
+      }
+    }
+  } else {
+    printf("PLDM cmd (%d) failed (status %d), abort update\n",
+      pldmCmd, pldmCmdStatus);
+
+    // send abort update cmd
+    memset(&pldmReq, 0, sizeof(pldm_cmd_req));
+    pldmCreateCancelUpdateCmd(&pldmReq);
+    ret = create_ncsi_ctrl_pkt(nl_msg, ch, NCSI_PLDM_REQUEST, pldmReq.payload_size,
+                              &(pldmReq.common[0]));
+    if (ret) {
+      ret = -1;
+      goto free_exit;
+    }
+    // ignore the return status and exit since this is on the error path
+    sendPldmCmdAndCheckResp(upd, nl_msg);
+    ret = -1;
+  }
+
+free_exit:
+  if (pkgHdr)
+    free_pldm_pkg_data(&pkgHdr);
+  if (nl_resp)
+    free(nl_resp);
+
+  if (pldmRes)
+    free(pldmRes);
+
+  if (nl_msg)
+    free(nl_msg);
+
+  kv_set("block_ncsi_xmit", "0", 0, 0);
+  return ret;
+}
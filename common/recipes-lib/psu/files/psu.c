@@ -18,6 +18,8 @@
 
 #include <signal.h>
 #include <limits.h>
+#include <pthread.h>
+#include <time.h>
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/fruid.h>
 #include <openbmc/log.h>
@@ -25,9 +27,25 @@
 #include "psu.h"
 #include "psu-platform.h"
 
-static delta_hdr_t delta_hdr;
-static murata_hdr_t murata_hdr;
-static murata2k_hdr_t murata2k_hdr;
+/* Per thread, PSUs of different buses are updated concurrently */
+static __thread delta_hdr_t delta_hdr;
+static __thread murata_hdr_t murata_hdr;
+static __thread murata2k_hdr_t murata2k_hdr;
+
+/* Longest step of the backoff while a bootloader is busy */
+#define PSU_BUSY_MAX_MS 32
+
+/* Status of BOOT_FLAG in boot mode */
+#define DELTA_XFER_ERROR 0x20
+
+typedef struct {
+  uint8_t bus;
+  const uint8_t *nums;
+  int count;
+  const char *file_path;
+  const char *vendor;
+  int *rets;
+} psu_bus_update_t;
 
 pmbus_info_t pmbus[] = {
   {"MFR_ID", 0x99},
@@ -172,6 +190,55 @@ check_file_line_cnt(const char *file_path) {
   return cnt;
 }
 
+static int64_t
+psu_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Write a block to the bootloader, and wait until it is ready for the
+ * next: after settle_ms, BOOT_FLAG is read with backoff until the PSU
+ * acks it (a busy bootloader NAKs), for at most max_ms in all. A write
+ * NAKed while busy is sent again. err_mask bits set in BOOT_FLAG fail
+ * the transfer.
+ */
+static int
+psu_block_write(uint8_t num, uint8_t cmd, uint8_t len, uint8_t *block,
+                int settle_ms, int max_ms, uint8_t err_mask) {
+  int64_t deadline = psu_now_ms() + max_ms;
+  int delay = 1;
+  int rc;
+
+  while (i2c_smbus_write_block_data(psu[num].fd, cmd, len, block) < 0) {
+    if (psu_now_ms() >= deadline) {
+      OBMC_ERROR(errno, "PSU%d write of 0x%02x failed", num + 1, cmd);
+      return -1;
+    }
+    msleep(delay);
+    delay = delay < PSU_BUSY_MAX_MS ? delay * 2 : PSU_BUSY_MAX_MS;
+  }
+
+  msleep(settle_ms);
+  delay = 1;
+  while ((rc = i2c_smbus_read_byte_data(psu[num].fd, BOOT_FLAG)) < 0) {
+    if (psu_now_ms() >= deadline) {
+      OBMC_WARN("PSU%d busy after 0x%02x for %d ms\n", num + 1, cmd, max_ms);
+      return -1;
+    }
+    msleep(delay);
+    delay = delay < PSU_BUSY_MAX_MS ? delay * 2 : PSU_BUSY_MAX_MS;
+  }
+
+  if (rc & err_mask) {
+    printf("-- FW transmission error --\n");
+    return -1;
+  }
+  return 0;
+}
+
 static int
 check_psu_status(uint8_t num, uint8_t reg) {
   uint8_t byte;
@@ -378,12 +445,13 @@ delta_fw_transmit(uint8_t num, const char *path) {
     if (block[1] < block_size) {
       memcpy(&fw_buf[0], &fw_data[byte_index], 16);
       memcpy(&block[3], &fw_buf, 16);
-      i2c_smbus_write_block_data(psu[num].fd, DATA_TO_RAM,
-                                      19, block);
       if (delta_hdr.uc == 0x10) {
-        msleep(25);
-      } else if (delta_hdr.uc == 0x20) {
-        msleep(5);
+        ret = psu_block_write(num, DATA_TO_RAM, 19, block, 5, 100, DELTA_XFER_ERROR);
+      } else {
+        ret = psu_block_write(num, DATA_TO_RAM, 19, block, 1, 20, DELTA_XFER_ERROR);
+      }
+      if (ret < 0) {
+        goto exit;
       }
 
       block[1]++;
@@ -392,19 +460,13 @@ delta_fw_transmit(uint8_t num, const char *path) {
       byte_index = byte_index + 16;
       printf("-- (%d/%d) (%d%%/100%%) --\r",
                   block_total, fw_block, (100 * block_total) / fw_block);
-#ifdef DEBUG
-      if (delta_boot_flag(num, BOOT_MODE, READ) & 0x20) {
-        printf("-- FW transmission error --\n");
-        ret = -1;
-        goto exit;
-      }
-#endif
     } else {
       block[1] = (page_num_lo & 0xff);
       block[2] = ((page_num_lo >> 8) & 0xff);
-      i2c_smbus_write_block_data(psu[num].fd, DATA_TO_FLASH,
-                                      3, block);
-      msleep(90);
+      ret = psu_block_write(num, DATA_TO_FLASH, 3, block, 20, 360, DELTA_XFER_ERROR);
+      if (ret < 0) {
+        goto exit;
+      }
       if (page_num_lo == page_num_max) {
         printf("\n");
         goto exit;
@@ -1136,12 +1198,13 @@ murata2k_fw_transmit(uint8_t num, const char *path) {
     if (block[1] < block_size) {
       memcpy(&fw_buf[0], &fw_data[byte_index], MURATA2K_BYTE_PER_BLK);
       memcpy(&block[3], &fw_buf, MURATA2K_BYTE_PER_BLK);
-      i2c_smbus_write_block_data(psu[num].fd, DATA_TO_RAM,
-                                 sizeof(block), block);
       if (murata2k_hdr.uc == 0x10) {
-        msleep(60);
-      } else if (murata2k_hdr.uc == 0x20) {
-        msleep(10);
+        ret = psu_block_write(num, DATA_TO_RAM, sizeof(block), block, 10, 240, 0);
+      } else {
+        ret = psu_block_write(num, DATA_TO_RAM, sizeof(block), block, 2, 40, 0);
+      }
+      if (ret < 0) {
+        goto exit;
       }
 
       block[1]++;
@@ -1155,8 +1218,10 @@ murata2k_fw_transmit(uint8_t num, const char *path) {
     } else {
       block[1] = (page_num_lo & 0xff);
       block[2] = ((page_num_lo >> 8) & 0xff);
-      i2c_smbus_write_block_data(psu[num].fd, DATA_TO_FLASH, 3, block);
-      msleep(90);
+      ret = psu_block_write(num, DATA_TO_FLASH, 3, block, 20, 360, 0);
+      if (ret < 0) {
+        goto exit;
+      }
       if (page_num_lo == page_num_max) {
         OBMC_INFO("\n");
         goto exit;
@@ -1250,16 +1315,11 @@ get_mfr_model(uint8_t num, uint8_t *block) {
   return 0;
 }
 
-int
-do_update_psu(uint8_t num, const char *file_path, const char *vendor) {
+static int
+update_psu(uint8_t num, const char *file_path, const char *vendor) {
   int ret = -1;
   uint8_t block[I2C_SMBUS_BLOCK_MAX + 1] = {0};
 
-  signal(SIGHUP, exithandler);
-  signal(SIGINT, exithandler);
-  signal(SIGTERM, exithandler);
-  signal(SIGQUIT, exithandler);
-
   psu[num].fd = i2c_open(psu[num].bus, psu[num].pmbus_addr);
   g_fd = psu[num].fd;
   if (psu[num].fd < 0) {
@@ -1329,8 +1389,97 @@ update_exit:
     sensord_operation(num, START);
   }
   close(psu[num].fd);
+
+  return ret;
+}
+
+static void
+update_exit_handlers(void) {
+  signal(SIGHUP, exithandler);
+  signal(SIGINT, exithandler);
+  signal(SIGTERM, exithandler);
+  signal(SIGQUIT, exithandler);
+}
+
+int
+do_update_psu(uint8_t num, const char *file_path, const char *vendor) {
+  int ret;
+
+  update_exit_handlers();
+  ret = update_psu(num, file_path, vendor);
+  run_command("rm /var/run/psu-util.pid");
+
+  return ret;
+}
+
+static void *
+update_psu_bus(void *arg) {
+  psu_bus_update_t *bus_update = (psu_bus_update_t *)arg;
+  int i;
+
+  /* The PSUs of a bus are updated one by one */
+  for (i = 0; i < bus_update->count; i++) {
+    if (psu[bus_update->nums[i]].bus == bus_update->bus) {
+      printf("-- PSU%d --\n", bus_update->nums[i] + 1);
+      bus_update->rets[i] = update_psu(bus_update->nums[i],
+                                       bus_update->file_path,
+                                       bus_update->vendor);
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Update the PSUs nums[] with the same image, the PSUs of different buses
+ * concurrently. rets[i] is the do_update_psu() result of nums[i].
+ * Returns 0 if all the updates succeeded, otherwise -1.
+ */
+int
+do_update_psus(const uint8_t *nums, int count, const char *file_path,
+               const char *vendor, int *rets) {
+  psu_bus_update_t bus_updates[count];
+  pthread_t tids[count];
+  int i, j, num_bus = 0, started, ret = 0;
+
+  if (count <= 0) {
+    return -1;
+  }
+
+  update_exit_handlers();
+  for (i = 0; i < count; i++) {
+    rets[i] = -1;
+    for (j = 0; j < num_bus; j++) {
+      if (bus_updates[j].bus == psu[nums[i]].bus) {
+        break;
+      }
+    }
+    if (j == num_bus) {
+      bus_updates[num_bus++] = (psu_bus_update_t){
+        psu[nums[i]].bus, nums, count, file_path, vendor, rets};
+    }
+  }
+
+  for (started = 0; started < num_bus; started++) {
+    if (pthread_create(&tids[started], NULL, update_psu_bus,
+                       &bus_updates[started])) {
+      break;
+    }
+  }
+  /* The buses no thread was started for */
+  for (i = started; i < num_bus; i++) {
+    update_psu_bus(&bus_updates[i]);
+  }
+  for (i = 0; i < started; i++) {
+    pthread_join(tids[i], NULL);
+  }
   run_command("rm /var/run/psu-util.pid");
 
+  for (i = 0; i < count; i++) {
+    if (rets[i]) {
+      ret = -1;
+    }
+  }
   return ret;
 }
 
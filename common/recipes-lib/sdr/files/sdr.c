@@ -29,6 +29,9 @@
 #include <syslog.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "sdr.h"
 
 #define FIELD_RATE_UNIT(x)  ((x & (0x07 << 3)) >> 3)
@@ -47,6 +50,37 @@
 
 #define MAX_NAME_LEN        16
 
+/* The SDRs of a FRU, as given by pal_sensor_sdr_init(), are parsed once
+ * into a table file which every process maps read-only. A table is
+ * replaced (by rename) when rebuilt, on a change of the SDR file of
+ * the FRU or by sdr_cache_invalidate(). Readers remap on a change of
+ * the inode.
+ */
+#define SDR_TABLE_PATH      "/tmp/sdr_table_fru%d"
+#define SDR_TABLE_MAGIC     0x53445254 /* "SDRT" */
+#define SDR_TABLE_VERSION   1
+#define MAX_SDR_TABLES      256
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation;
+  /* 0 if invalidated: rebuild before use */
+  uint32_t valid;
+  /* SDR file the table was built from, 0 if unknown */
+  int64_t src_mtime_ns;
+  int64_t src_size;
+  sensor_info_t sinfo[MAX_SENSOR_NUM + 1];
+} sdr_table_t;
+
+typedef struct {
+  const sdr_table_t *tbl;
+  ino_t ino;
+} sdr_table_map_t;
+
+static sdr_table_map_t g_tables[MAX_SDR_TABLES];
+static pthread_mutex_t g_tables_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Array for BCD Plus definition. */
 const char bcd_plus_array[] = "0123456789 -.XXX";
 
@@ -211,6 +245,161 @@ _sdr_get_sensor_units(sdr_full_t *sdr, uint8_t *op, uint8_t *modifier,
   return 0;
 }
 
+/* Modification time and size of the SDR file of the FRU, 0 if unknown */
+static void
+sdr_src_stat(uint8_t fru, int64_t *mtime_ns, int64_t *size) {
+  char path[64] = {0};
+  struct stat st;
+
+  *mtime_ns = *size = 0;
+  if (pal_sensor_sdr_path(fru, path) == 0 && stat(path, &st) == 0) {
+    *mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    *size = st.st_size;
+  }
+}
+
+/* Map the current table of the FRU, if changed since it was mapped.
+ * Called with g_tables_lock held. */
+static void
+sdr_table_map(uint8_t fru) {
+  sdr_table_map_t *m = &g_tables[fru];
+  char path[64];
+  struct stat st;
+  void *tbl;
+  int fd;
+
+  sprintf(path, SDR_TABLE_PATH, fru);
+  if (stat(path, &st) == 0 && m->tbl != NULL && st.st_ino == m->ino) {
+    return;
+  }
+  if (m->tbl != NULL) {
+    munmap((void *)m->tbl, sizeof(sdr_table_t));
+    m->tbl = NULL;
+  }
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  if (fstat(fd, &st) == 0 && st.st_size == sizeof(sdr_table_t)) {
+    tbl = mmap(NULL, sizeof(sdr_table_t), PROT_READ, MAP_SHARED, fd, 0);
+    if (tbl != MAP_FAILED) {
+      if (((sdr_table_t *)tbl)->magic == SDR_TABLE_MAGIC &&
+          ((sdr_table_t *)tbl)->version == SDR_TABLE_VERSION) {
+        m->tbl = tbl;
+        m->ino = st.st_ino;
+      } else {
+        munmap(tbl, sizeof(sdr_table_t));
+      }
+    }
+  }
+  close(fd);
+}
+
+/* Replace the table of the FRU by tbl. Called with g_tables_lock held. */
+static int
+sdr_table_publish(uint8_t fru, sdr_table_t *tbl) {
+  const sdr_table_t *old = g_tables[fru].tbl;
+  char path[64], tmp[80];
+  ssize_t len;
+  int fd;
+
+  tbl->magic = SDR_TABLE_MAGIC;
+  tbl->version = SDR_TABLE_VERSION;
+  tbl->generation = old != NULL ? old->generation + 1 : 1;
+
+  sprintf(path, SDR_TABLE_PATH, fru);
+  snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+  fd = mkstemp(tmp);
+  if (fd < 0) {
+    return -1;
+  }
+  fchmod(fd, 0644);
+  len = write(fd, tbl, sizeof(sdr_table_t));
+  close(fd);
+  if (len != sizeof(sdr_table_t) || rename(tmp, path)) {
+    unlink(tmp);
+    return -1;
+  }
+  sdr_table_map(fru);
+  return 0;
+}
+
+/* The SDR of a sensor of the FRU, from its table, rebuilt if stale.
+ * Returns as pal_sensor_sdr_init() */
+static int
+sdr_table_read(uint8_t fru, uint8_t snr_num, sensor_info_t *info) {
+  const sdr_table_t *cur;
+  sdr_table_t *tbl;
+  int64_t mtime_ns, size;
+  int ret;
+
+  sdr_src_stat(fru, &mtime_ns, &size);
+
+  pthread_mutex_lock(&g_tables_lock);
+  sdr_table_map(fru);
+  cur = g_tables[fru].tbl;
+  if (cur != NULL && cur->valid &&
+      cur->src_mtime_ns == mtime_ns && cur->src_size == size) {
+    *info = cur->sinfo[snr_num];
+    pthread_mutex_unlock(&g_tables_lock);
+    return 0;
+  }
+
+  tbl = calloc(1, sizeof(sdr_table_t));
+  if (tbl == NULL) {
+    pthread_mutex_unlock(&g_tables_lock);
+    return -1;
+  }
+  ret = pal_sensor_sdr_init(fru, tbl->sinfo);
+  if (ret >= 0) {
+    tbl->valid = 1;
+    tbl->src_mtime_ns = mtime_ns;
+    tbl->src_size = size;
+    if (sdr_table_publish(fru, tbl)) {
+      syslog(LOG_WARNING, "%s: Fail to store the SDR table of fru%d", __func__, fru);
+    }
+    *info = tbl->sinfo[snr_num];
+  }
+  pthread_mutex_unlock(&g_tables_lock);
+  free(tbl);
+  return ret;
+}
+
+int
+sdr_cache_generation(uint8_t fru, uint32_t *gen) {
+  int ret = -1;
+
+  pthread_mutex_lock(&g_tables_lock);
+  sdr_table_map(fru);
+  if (g_tables[fru].tbl != NULL) {
+    *gen = g_tables[fru].tbl->generation;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&g_tables_lock);
+  return ret;
+}
+
+int
+sdr_cache_invalidate(uint8_t fru) {
+  sdr_table_t *tbl;
+  int ret = 0;
+
+  pthread_mutex_lock(&g_tables_lock);
+  sdr_table_map(fru);
+  if (g_tables[fru].tbl != NULL && g_tables[fru].tbl->valid) {
+    tbl = calloc(1, sizeof(sdr_table_t));
+    if (tbl == NULL) {
+      ret = -1;
+    } else {
+      /* Keep the generation counting up across the rebuild */
+      ret = sdr_table_publish(fru, tbl);
+      free(tbl);
+    }
+  }
+  pthread_mutex_unlock(&g_tables_lock);
+  return ret;
+}
+
 int
 sdr_get_sensor_units(uint8_t fru, uint8_t snr_num, char *units) {
 
@@ -218,13 +407,12 @@ sdr_get_sensor_units(uint8_t fru, uint8_t snr_num, char *units) {
   uint8_t op;
   uint8_t modifier;
   sdr_full_t *sdr;
+  sensor_info_t sinfo;
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
-
-  if (pal_sensor_sdr_init(fru, sinfo) < 0) {
+  if (sdr_table_read(fru, snr_num, &sinfo) < 0) {
     sdr = NULL;
   } else {
-    sdr = &sinfo[snr_num].sdr;
+    sdr = &sinfo.sdr;
   }
 
   if (sdr != NULL) {
@@ -337,13 +525,12 @@ sdr_get_sensor_name(uint8_t fru, uint8_t snr_num, char *name) {
 
   int ret = 0;
   sdr_full_t *sdr;
+  sensor_info_t sinfo;
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
-
-  if (pal_sensor_sdr_init(fru, sinfo) < 0) {
+  if (sdr_table_read(fru, snr_num, &sinfo) < 0) {
     sdr = NULL;
   } else {
-    sdr = &sinfo[snr_num].sdr;
+    sdr = &sinfo.sdr;
   }
 
   if (sdr != NULL) {
@@ -569,9 +756,9 @@ sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
   char initflag[64] = {0};
   char fru_name[16];
 
-  sensor_info_t sinfo[MAX_SENSOR_NUM + 1] = {0};
+  sensor_info_t sinfo;
 
-  ret = pal_sensor_sdr_init(fru, sinfo);
+  ret = sdr_table_read(fru, snr_num, &sinfo);
 
   while (ret == ERR_NOT_READY) {
 
@@ -584,13 +771,13 @@ sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr) {
     syslog(LOG_INFO, "sdr_get_snr_thresh: fru: %d, ret: %d cnt: %d", fru, ret, cnt++);
 #endif /* DEBUG */
     msleep(50);
-    ret = pal_sensor_sdr_init(fru, sinfo);
+    ret = sdr_table_read(fru, snr_num, &sinfo);
   }
 
   if (ret < 0) {
     sdr = NULL;
   } else {
-    sdr = &sinfo[snr_num].sdr;
+    sdr = &sinfo.sdr;
   }
 
   /* Set all the threshold options set in the flag */
@@ -40,6 +40,13 @@ int sdr_get_sensor_name(uint8_t fru, uint8_t snr_num, char *name);
 int sdr_get_sensor_units(uint8_t fru, uint8_t snr_num, char *units);
 int sdr_get_snr_thresh(uint8_t fru, uint8_t snr_num, thresh_sensor_t *snr);
 
+/* The SDRs of a FRU are parsed once into a table shared by all the
+ * processes. Its generation changes whenever it is rebuilt: on a change
+ * of the SDR file of the FRU (see pal_sensor_sdr_path), or after
+ * sdr_cache_invalidate() which the SDR refreshers may call. */
+int sdr_cache_generation(uint8_t fru, uint32_t *gen);
+int sdr_cache_invalidate(uint8_t fru);
+
 #define FORMAT_CONV(X) ((int)(X*100 + 0.5)*0.01)  //take the second decimal place
 
 #ifdef __cplusplus
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
 #ifndef __TEST__
 #include <syslog.h>
 #endif
@@ -50,6 +51,10 @@
 
 #define MAX_NUM_CONDITIONS 32
 #define MAX_NUM_TABLES     32
+#define MAX_NUM_FRUS       256
+#define MAX_NUM_SENSORS    256
+/* Cells of the dense form of a table, see build_cells() */
+#define MAX_NUM_CELLS      1024
 
 typedef struct {
   char cond_value[MAX_VALUE_LEN];
@@ -65,6 +70,16 @@ typedef struct {
   char name[32];
   size_t num;
   correction_element_t *corr_table;
+  /* The table as a step function: sorted distinct cond_values and
+   * the correction from each on, see build_steps() */
+  size_t num_steps;
+  float *step_start;
+  float *step_corr;
+  /* Correction per cell_width wide cell from step_start[0], when
+   * the cond_values are whole numbers (see build_cells()) */
+  size_t num_cells;
+  float cell_width;
+  float *cell_corr;
 } correction_table_t;
 
 typedef enum {
@@ -83,10 +98,15 @@ typedef struct {
   char    cond_key[MAX_KEY_LEN];
   size_t  value_map_size;
   value_map_element_t value_map[MAX_NUM_CONDITIONS];
+  /* Last value of cond_key and its table, -1 == none */
+  char    last_value[MAX_VALUE_LEN];
+  int     last_table;
 } sensor_correction_t;
 
 static sensor_correction_t *g_sensors = NULL;
 static size_t g_sensors_count = 0;
+/* Correction of a sensor by FRU then sensor ID, NULL if it has none */
+static sensor_correction_t **g_index[MAX_NUM_FRUS];
 
 static int get_table(value_map_element_t *value_map, size_t num, char *value, size_t *idx)
 {
@@ -103,13 +123,168 @@ static int get_table(value_map_element_t *value_map, size_t num, char *value, si
 
 static sensor_correction_t *get_correction(uint8_t fru, uint8_t sensor_id)
 {
+  if (!g_index[fru]) {
+    return NULL;
+  }
+  return g_index[fru][sensor_id];
+}
+
+static int build_index(void)
+{
+  size_t i;
+
+  for (i = 0; i < g_sensors_count; i++) {
+    sensor_correction_t *snr = &g_sensors[i];
+    if (!g_index[snr->fru]) {
+      g_index[snr->fru] = calloc(MAX_NUM_SENSORS, sizeof(sensor_correction_t *));
+      if (!g_index[snr->fru]) {
+        return -1;
+      }
+    }
+    /* The first one wins, as with a search of g_sensors */
+    if (!g_index[snr->fru][snr->id]) {
+      g_index[snr->fru][snr->id] = snr;
+    }
+  }
+  return 0;
+}
+
+static void free_index(void)
+{
+  size_t i;
+
+  for (i = 0; i < MAX_NUM_FRUS; i++) {
+    free(g_index[i]);
+    g_index[i] = NULL;
+  }
+}
+
+/* Correction of the table for cond_value as found by a scan of the
+ * table in order: that of the last entry before the first one above
+ * cond_value. The first entry is taken for values below it. */
+static float scan_table(correction_table_t *tbl, float cond_value)
+{
+  float correction = tbl->corr_table[0].correction;
   size_t i;
-  for(i = 0; i < g_sensors_count; i++) {
-    if (g_sensors[i].fru == fru && g_sensors[i].id == sensor_id) {
-      return &g_sensors[i];
+
+  for (i = 0; i < tbl->num; i++) {
+    if (cond_value < tbl->corr_table[i].cond_value) {
+      break;
+    }
+    correction = tbl->corr_table[i].correction;
+  }
+  return correction;
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+  float x = *(const float *)a, y = *(const float *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* The scan only changes its result at a cond_value of the table, so it
+ * is the same from one distinct cond_value up to the next. */
+static int build_steps(correction_table_t *tbl)
+{
+  size_t i, n = 0;
+
+  tbl->step_start = calloc(tbl->num, sizeof(float));
+  tbl->step_corr = calloc(tbl->num, sizeof(float));
+  if (!tbl->step_start || !tbl->step_corr) {
+    return -1;
+  }
+  for (i = 0; i < tbl->num; i++) {
+    tbl->step_start[i] = tbl->corr_table[i].cond_value;
+  }
+  qsort(tbl->step_start, tbl->num, sizeof(float), cmp_float);
+  for (i = 0; i < tbl->num; i++) {
+    if (n == 0 || tbl->step_start[i] != tbl->step_start[n - 1]) {
+      tbl->step_start[n++] = tbl->step_start[i];
+    }
+  }
+  tbl->num_steps = n;
+  for (i = 0; i < n; i++) {
+    tbl->step_corr[i] = scan_table(tbl, tbl->step_start[i]);
+  }
+  return 0;
+}
+
+static long gcd(long a, long b)
+{
+  while (b) {
+    long t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/* With whole cond_values, every step starts at a multiple of their
+ * greatest common distance from the first one. So the steps are
+ * cells of that width, the cell of a value being one division away. */
+static int build_cells(correction_table_t *tbl)
+{
+  long width = 0, cells, k;
+  size_t i, j;
+
+  tbl->num_cells = 0;
+  if (tbl->num_steps < 2) {
+    return 0;
+  }
+  for (i = 0; i < tbl->num_steps; i++) {
+    float v = tbl->step_start[i];
+    if (v != floorf(v) || fabsf(v) > (1 << 24)) {
+      return 0;
+    }
+    width = gcd((long)(v - tbl->step_start[0]), width);
+  }
+  cells = (long)(tbl->step_start[tbl->num_steps - 1] - tbl->step_start[0]) / width;
+  if (cells > MAX_NUM_CELLS) {
+    return 0;
+  }
+  tbl->cell_corr = calloc(cells, sizeof(float));
+  if (!tbl->cell_corr) {
+    return -1;
+  }
+  for (k = 0, j = 0; k < cells; k++) {
+    while (j + 1 < tbl->num_steps &&
+        (long)(tbl->step_start[j + 1] - tbl->step_start[0]) <= k * width) {
+      j++;
+    }
+    tbl->cell_corr[k] = tbl->step_corr[j];
+  }
+  tbl->num_cells = cells;
+  tbl->cell_width = width;
+  return 0;
+}
+
+static float table_correction(correction_table_t *tbl, float cond_value)
+{
+  size_t lo, hi;
+
+  if (cond_value < tbl->step_start[0]) {
+    return tbl->corr_table[0].correction;
+  }
+  if (!(cond_value < tbl->step_start[tbl->num_steps - 1])) {
+    /* Including NaN, which is never below an entry */
+    return tbl->step_corr[tbl->num_steps - 1];
+  }
+  if (tbl->num_cells) {
+    size_t k = (size_t)(((double)cond_value - tbl->step_start[0]) / tbl->cell_width);
+    return tbl->cell_corr[k < tbl->num_cells ? k : tbl->num_cells - 1];
+  }
+  /* Last step starting at or below cond_value */
+  lo = 0;
+  hi = tbl->num_steps - 1;
+  while (lo + 1 < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (cond_value < tbl->step_start[mid]) {
+      hi = mid;
+    } else {
+      lo = mid;
     }
   }
-  return NULL;
+  return tbl->step_corr[lo];
 }
 
 static int load_table(json_t *obj, correction_table_t *tbl)
@@ -145,6 +320,13 @@ static int load_table(json_t *obj, correction_table_t *tbl)
     tbl->corr_table[i].cond_value = get_float(cond_value_o);
     tbl->corr_table[i].correction = get_float(correction_o);
   }
+  if (build_steps(tbl) || build_cells(tbl)) {
+    DEBUG("Allocation failure!\n");
+    free(tbl->corr_table);
+    free(tbl->step_start);
+    free(tbl->step_corr);
+    return -1;
+  }
   return 0;
 }
 
@@ -306,6 +488,7 @@ int sensor_correction_init(const char *file)
   json_error_t error;
   size_t i;
 
+  free_index();
   conf = json_load_file(file, 0, &error);
   if (!conf) {
     return -1;
@@ -342,10 +525,16 @@ int sensor_correction_init(const char *file)
       DEBUG("Loading sensor correction for sensor %zu failed!\n", i);
       goto bail;
     }
+    g_sensors[i].last_table = -1;
+  }
+  if (build_index()) {
+    DEBUG("Allocation failure!\n");
+    goto bail;
   }
   json_decref(conf);
   return 0;
 bail:
+  free_index();
   free(g_sensors);
   json_decref(conf);
   g_sensors = NULL;
@@ -357,9 +546,6 @@ int sensor_correction_apply(uint8_t fru, uint8_t sensor_id, float cond_value, fl
 {
   char value[MAX_VALUE_LEN] = {0};
   size_t table_idx = 0;
-  correction_table_t *table;
-  size_t i;
-  float correction;
   unsigned int flags;
 
   sensor_correction_t *snr = get_correction(fru, sensor_id);
@@ -369,19 +555,19 @@ int sensor_correction_apply(uint8_t fru, uint8_t sensor_id, float cond_value, fl
     return 0;
   }
   flags = snr->cond_key_type == KEY_PERSISTENT ? KV_FPERSIST : 0;
-  if (kv_get(snr->cond_key, value, NULL, flags) ||
-      get_table(snr->value_map, snr->value_map_size, value, &table_idx)) {
+  if (kv_get(snr->cond_key, value, NULL, flags)) {
     table_idx = snr->default_table;
+  } else if (snr->last_table != -1 && !strcmp(value, snr->last_value)) {
+    /* The key rarely changes, look it up only when it does */
+    table_idx = snr->last_table;
+  } else if (get_table(snr->value_map, snr->value_map_size, value, &table_idx)) {
+    table_idx = snr->default_table;
+  } else {
+    strcpy(snr->last_value, value);
+    snr->last_table = (int)table_idx;
   }
-  table = &snr->tables[table_idx];
-  correction = table->corr_table[0].correction;
-  for (i = 0; i < table->num; i++) {
-    if (cond_value < table->corr_table[i].cond_value) {
-      break;
-    }
-    correction = table->corr_table[i].correction;
-  }
-  *sensor_reading = *sensor_reading - correction;
+  *sensor_reading = *sensor_reading -
+    table_correction(&snr->tables[table_idx], cond_value);
   return 0;
 }
 
@@ -360,8 +360,6 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
       break;
     }
 
-    msleep(500);
-
     tbuf[0] = VR_REG_PAGE;
     tbuf[1] = VR_PXE_PAGE_60;
     if ((ret = i2c_io(fd, addr, tbuf, 2, rbuf, 0))) {
@@ -369,14 +367,9 @@ program_pxe(uint8_t bus, uint8_t addr, struct pxe_config *config, bool force) {
       break;
     }
 
-    tbuf[0] = 0x01;
-    if ((ret = i2c_io(fd, addr, tbuf, 1, rbuf, 2))) {
-      syslog(LOG_WARNING, "%s: read register 0x%02X failed", __func__, tbuf[0]);
-      break;
-    }
-    if ((rbuf[0] & 0x01)) {
-      syslog(LOG_WARNING, "%s: unexpected status, reg%02X=%02X", __func__, tbuf[0], rbuf[0]);
-      ret = -1;
+    // wait for the upload to finish
+    if ((ret = vr_poll_reg(fd, addr, 0x01, 2, 0x01, 0x00, VR_PXE_NVM_TIMEOUT))) {
+      syslog(LOG_WARNING, "%s: upload did not complete", __func__);
       break;
     }
 
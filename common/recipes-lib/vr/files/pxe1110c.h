@@ -16,6 +16,7 @@
 #define VR_PXE_REG_CRC_H 0x3E  // page 0x6F
 
 #define VR_PXE_TOTAL_RW_SIZE 2040
+#define VR_PXE_NVM_TIMEOUT 1000  // ms
 
 struct pxe_config {
   uint8_t addr;
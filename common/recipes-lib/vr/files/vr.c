@@ -18,17 +18,54 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <syslog.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/obmc-pal.h>
+#include <openbmc/kv.h>
 #include "vr.h"
 
+#define VR_POLL_MIN_MS 1
+#define VR_POLL_MAX_MS 32
+
 struct vr_info *dev_list = NULL;
 int dev_list_count = 0;
 void *plat_configs = NULL;
 
+// Bytes moved by i2c_io() of the update running on this thread
+static __thread uint32_t xfer_bytes = 0;
+
+// Version string of a VR, cached until vr_fw_update() runs on it
+#define VR_VER_KEY "vr_%u_%02xh_ver_str"
+
+struct vr_job {
+  struct vr_info *info;
+  const char *path;
+  void *configs;
+  int ret;
+};
+
+struct vr_bus_jobs {
+  uint8_t bus;
+  struct vr_job *jobs;
+  int num;
+  void (*run)(struct vr_job*);
+};
+
+int i2c_io(int fd, uint8_t addr, uint8_t *tbuf, uint8_t tcnt, uint8_t *rbuf, uint8_t rcnt);
+
+static long
+vr_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
 int vr_device_register(struct vr_info *info, int count)
 {
   dev_list = info;
@@ -53,46 +90,183 @@ void vr_remove()
   vr_device_unregister();
 }
 
+static void
+vr_cache_invalidate(struct vr_info *info) {
+  char key[MAX_KEY_LEN];
+
+  snprintf(key, sizeof(key), VR_VER_KEY, info->bus, info->addr);
+  kv_del(key, 0);
+
+  // the caches of the drivers
+  snprintf(key, sizeof(key), "vr_%02xh_crc", info->addr);
+  kv_del(key, 0);
+  snprintf(key, sizeof(key), "vr_%02xh_ver", info->addr);
+  kv_del(key, 0);
+}
+
+static int
+vr_get_version(struct vr_info *info, char *ver_str) {
+  char key[MAX_KEY_LEN], value[MAX_VALUE_LEN] = {0};
+
+  snprintf(key, sizeof(key), VR_VER_KEY, info->bus, info->addr);
+  if (kv_get(key, value, NULL, 0) == 0) {
+    snprintf(ver_str, MAX_VER_STR_LEN, "%s", value);
+    return VR_STATUS_SUCCESS;
+  }
+
+  if (!info->ops || !info->ops->get_fw_ver) {
+    return VR_STATUS_FAILURE;
+  }
+
+  if (info->ops->get_fw_ver(info, ver_str) < 0) {
+    syslog(LOG_WARNING, "%s: get VR %s version failed", __func__, info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  kv_set(key, ver_str, 0, 0);
+  return VR_STATUS_SUCCESS;
+}
+
+/*
+ * Run the jobs, one thread per bus: the jobs of a bus run one by one
+ * in order.
+ */
+static void
+vr_run_by_bus(struct vr_job *jobs, int num, void (*run)(struct vr_job*));
+
 int vr_fw_version(int index, const char *vr_name, char *ver_str)
 {
   struct vr_info *info = dev_list;
   int i;
 
-  do {
-    if (index >= 0) {
-      if (index >= dev_list_count) {
-        break;
-      }
+  if (index >= 0) {
+    if (index >= dev_list_count) {
+      return VR_STATUS_FAILURE;
+    }
 
-      info += index;
-    } else {
-      if (!vr_name) {
-        break;
-      }
+    info += index;
+  } else {
+    if (!vr_name) {
+      return VR_STATUS_FAILURE;
+    }
 
-      for (i = 0; i < dev_list_count; i++, info++) {
-        if (!strcmp(info->dev_name, vr_name))
-          break;
-      }
-      if (i >= dev_list_count) {
-        syslog(LOG_WARNING, "%s: device %s not found", __func__, vr_name);
+    for (i = 0; i < dev_list_count; i++, info++) {
+      if (!strcmp(info->dev_name, vr_name))
         break;
-      }
     }
+    if (i >= dev_list_count) {
+      syslog(LOG_WARNING, "%s: device %s not found", __func__, vr_name);
+      return VR_STATUS_FAILURE;
+    }
+  }
 
-    if (!info->ops->get_fw_ver) {
-      break;
+  return vr_get_version(info, ver_str);
+}
+
+static void
+vr_version_job(struct vr_job *job) {
+  char ver[MAX_VER_STR_LEN];
+
+  job->ret = vr_get_version(job->info, ver);
+}
+
+/*
+ * Read the versions of all the VRs into the cache, the VRs of different
+ * buses concurrently, so that the vr_fw_version() of each is a lookup.
+ * Return the number of VRs whose version could not be read.
+ */
+int vr_fw_version_all(void)
+{
+  struct vr_job *jobs;
+  int i, failed = 0;
+
+  if (dev_list_count <= 0) {
+    return 0;
+  }
+
+  jobs = calloc(dev_list_count, sizeof(*jobs));
+  if (jobs == NULL) {
+    return dev_list_count;
+  }
+
+  for (i = 0; i < dev_list_count; i++) {
+    jobs[i].info = &dev_list[i];
+    jobs[i].ret = VR_STATUS_FAILURE;
+  }
+  vr_run_by_bus(jobs, dev_list_count, vr_version_job);
+
+  for (i = 0; i < dev_list_count; i++) {
+    if (jobs[i].ret < 0) {
+      failed++;
     }
+  }
+  free(jobs);
 
-    if (info->ops->get_fw_ver(info, ver_str) < 0) {
-      syslog(LOG_WARNING, "%s: get VR %s version failed", __func__, info->dev_name);
-      break;
+  return failed;
+}
+
+/*
+ * Update a VR with the configs of path, parsed into *configs on the first
+ * call. With any, a file not for the device is VR_STATUS_SKIP.
+ */
+static int
+vr_update_dev(struct vr_info *info, const char *path, bool force, void **configs, bool any) {
+  long start, elapsed;
+  int ret;
+
+  if (!info->ops ||
+      !info->ops->parse_file ||
+      !info->ops->fw_update) {
+    syslog(LOG_WARNING, "%s: incomplete ops: %s", __func__, info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  if (*configs == NULL) {
+    if (info->ops->validate_file &&
+        info->ops->validate_file(info, path) < 0) {
+      if (any) {
+        return VR_STATUS_SKIP;
+      }
+      syslog(LOG_WARNING, "%s: validate file failed", __func__);
+      return VR_STATUS_FAILURE;
     }
 
-    return VR_STATUS_SUCCESS;
-  } while (0);
+    if ((*configs = info->ops->parse_file(info, path)) == NULL) {
+      if (any) {
+        return VR_STATUS_SKIP;
+      }
+      syslog(LOG_WARNING, "%s: parse file failed", __func__);
+      return VR_STATUS_FAILURE;
+    }
+  }
 
-  return VR_STATUS_FAILURE;
+  info->force = force;
+  xfer_bytes = 0;
+  start = vr_now_ms();
+  ret = info->ops->fw_update(info, *configs);
+  if (any && (ret == VR_STATUS_SKIP)) {
+    return VR_STATUS_SKIP;
+  }
+  // the version read before is stale, even after a failed update
+  vr_cache_invalidate(info);
+  if (ret < 0) {
+    syslog(LOG_WARNING, "%s: update VR %s failed", __func__, info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  elapsed = vr_now_ms() - start;
+  if (xfer_bytes) {
+    printf("%s: %u bytes in %ld ms, %ld bytes/s\n", info->dev_name, xfer_bytes,
+           elapsed, elapsed > 0 ? xfer_bytes * 1000L / elapsed : (long)xfer_bytes);
+  }
+
+  if (info->ops->fw_verify &&
+      info->ops->fw_verify(info, *configs) < 0) {
+    syslog(LOG_WARNING, "%s: verify VR %s failed", __func__, info->dev_name);
+    return VR_STATUS_FAILURE;
+  }
+
+  return VR_STATUS_SUCCESS;
 }
 
 int vr_fw_update(const char *vr_name, const char *path, bool force)
@@ -102,48 +276,11 @@ int vr_fw_update(const char *vr_name, const char *path, bool force)
 
   for (i = 0; i < dev_list_count; i++, info++) {
     if (!vr_name || !strcmp(info->dev_name, vr_name)) {  // traverse all for unspecified vr_name
-      if (!info->ops ||
-          !info->ops->parse_file ||
-          !info->ops->fw_update) {
-        syslog(LOG_WARNING, "%s: incomplete ops: %s", __func__, info->dev_name);
-        break;
-      }
-
-      if (plat_configs == NULL) {
-        if (info->ops->validate_file &&
-            info->ops->validate_file(info, path) < 0) {
-          if (!vr_name) {
-            continue;
-          }
-          syslog(LOG_WARNING, "%s: validate file failed", __func__);
-          break;
-        }
-
-        if ((plat_configs = info->ops->parse_file(info, path)) == NULL) {
-          if (!vr_name) {
-            continue;
-          }
-          syslog(LOG_WARNING, "%s: parse file failed", __func__);
-          break;
-        }
-      }
-
-      info->force = force;
-      if ((ret = info->ops->fw_update(info, plat_configs)) < 0) {
-        if (!vr_name && (ret == VR_STATUS_SKIP)) {
-          continue;
-        }
-        syslog(LOG_WARNING, "%s: update VR %s failed", __func__, info->dev_name);
-        break;
-      }
-
-      if (info->ops->fw_verify &&
-          info->ops->fw_verify(info, plat_configs) < 0) {
-        syslog(LOG_WARNING, "%s: verify VR %s failed", __func__, info->dev_name);
-        break;
+      ret = vr_update_dev(info, path, force, &plat_configs, !vr_name);
+      if (ret == VR_STATUS_SKIP) {
+        continue;
       }
-
-      return VR_STATUS_SUCCESS;
+      return ret;
     }
   }
 
@@ -175,9 +312,165 @@ int i2c_io(int fd, uint8_t addr, uint8_t *tbuf, uint8_t tcnt, uint8_t *rbuf, uin
       continue;
     }
 
+    xfer_bytes += tcnt + rcnt;
     msleep(1);  // delay between transactions
     break;
   }
 
   return ret;
 }
+
+/*
+ * Read reg of the VR until (rbuf[0] & mask) == value, e.g. a busy bit
+ * cleared. The reads are 1 ms apart at first, backing off to 32 ms, for
+ * at most timeout_ms.
+ * Return 0 when the value is reached, otherwise -1.
+ */
+int vr_poll_reg(int fd, uint8_t addr, uint8_t reg, uint8_t rcnt,
+                uint8_t mask, uint8_t value, int timeout_ms)
+{
+  long deadline = vr_now_ms() + timeout_ms;
+  int delay = VR_POLL_MIN_MS;
+  uint8_t tbuf[1], rbuf[4] = {0};
+
+  if (rcnt < 1 || rcnt > sizeof(rbuf)) {
+    return -1;
+  }
+
+  while (1) {
+    tbuf[0] = reg;
+    if (!i2c_io(fd, addr, tbuf, 1, rbuf, rcnt) && ((rbuf[0] & mask) == value)) {
+      return 0;
+    }
+
+    if (vr_now_ms() >= deadline) {
+      syslog(LOG_WARNING, "%s: dev 0x%x reg%02X=%02X timed out", __func__, addr, reg, rbuf[0]);
+      return -1;
+    }
+
+    msleep(delay);
+    if (delay < VR_POLL_MAX_MS) {
+      delay <<= 1;
+    }
+  }
+}
+
+static void *
+vr_bus_run(void *arg) {
+  struct vr_bus_jobs *bus_jobs = (struct vr_bus_jobs *)arg;
+  int i;
+
+  for (i = 0; i < bus_jobs->num; i++) {
+    if (bus_jobs->jobs[i].info->bus == bus_jobs->bus) {
+      bus_jobs->run(&bus_jobs->jobs[i]);
+    }
+  }
+
+  return NULL;
+}
+
+static void
+vr_run_by_bus(struct vr_job *jobs, int num, void (*run)(struct vr_job*)) {
+  struct vr_bus_jobs *bus_jobs;
+  pthread_t *tids;
+  int i, j, num_bus = 0;
+
+  bus_jobs = calloc(num, sizeof(*bus_jobs));
+  tids = calloc(num, sizeof(*tids));
+  if (!bus_jobs || !tids) {
+    free(bus_jobs);
+    free(tids);
+    for (i = 0; i < num; i++) {
+      run(&jobs[i]);
+    }
+    return;
+  }
+
+  for (i = 0; i < num; i++) {
+    for (j = 0; j < num_bus; j++) {
+      if (bus_jobs[j].bus == jobs[i].info->bus)
+        break;
+    }
+    if (j == num_bus) {
+      bus_jobs[num_bus].bus = jobs[i].info->bus;
+      bus_jobs[num_bus].jobs = jobs;
+      bus_jobs[num_bus].num = num;
+      bus_jobs[num_bus].run = run;
+      num_bus++;
+    }
+  }
+
+  // A single bus runs on this thread
+  for (i = 0; num_bus > 1 && i < num_bus; i++) {
+    if (pthread_create(&tids[i], NULL, vr_bus_run, &bus_jobs[i])) {
+      break;
+    }
+  }
+  for (j = i; j < num_bus; j++) {
+    vr_bus_run(&bus_jobs[j]);
+  }
+  while (--i >= 0) {
+    pthread_join(tids[i], NULL);
+  }
+
+  free(tids);
+  free(bus_jobs);
+}
+
+static void
+vr_update_job(struct vr_job *job) {
+  job->ret = vr_update_dev(job->info, job->path, job->info->force, &job->configs, false);
+}
+
+/*
+ * Update the VRs vr_names[i] with the files paths[i]. The VRs of
+ * different buses are updated concurrently.
+ * Return 0 if all the updates succeeded, otherwise -1.
+ */
+int vr_fw_update_multi(const char **vr_names, const char **paths, int num, bool force)
+{
+  struct vr_job *jobs;
+  int i, j, ret = VR_STATUS_SUCCESS;
+
+  if (num <= 0) {
+    return VR_STATUS_FAILURE;
+  }
+
+  jobs = calloc(num, sizeof(*jobs));
+  if (jobs == NULL) {
+    return VR_STATUS_FAILURE;
+  }
+
+  for (i = 0; i < num; i++) {
+    for (j = 0; j < dev_list_count; j++) {
+      if (!strcmp(dev_list[j].dev_name, vr_names[i]))
+        break;
+    }
+    if (j >= dev_list_count) {
+      syslog(LOG_WARNING, "%s: device %s not found", __func__, vr_names[i]);
+      free(jobs);
+      return VR_STATUS_FAILURE;
+    }
+    jobs[i].info = &dev_list[j];
+    jobs[i].info->force = force;
+    jobs[i].path = paths[i];
+    jobs[i].ret = VR_STATUS_FAILURE;
+  }
+
+  vr_run_by_bus(jobs, num, vr_update_job);
+
+  for (i = 0; i < num; i++) {
+    if (jobs[i].ret < 0) {
+      ret = VR_STATUS_FAILURE;
+    }
+    if (jobs[i].configs) {
+      if (jobs[i].info->ops->free_configs)
+        jobs[i].info->ops->free_configs(jobs[i].configs);
+      else
+        free(jobs[i].configs);
+    }
+  }
+  free(jobs);
+
+  return ret;
+}
@@ -76,6 +76,13 @@ struct vr_ops {
    * 	Retrun -1 if failed, otherwise 0.
    */
   int (*fw_verify)(struct vr_info*, void*);
+
+  /*
+   * free_configs: (Optional)
+   *	This function shall free the configuration returned by parse_file,
+   *	which is freed by free() if not set.
+   */
+  void (*free_configs)(void*);
 };
 
 struct vr_info {
@@ -96,7 +103,10 @@ void vr_device_unregister(void);
 int vr_probe(void);
 void vr_remove(void);
 int vr_fw_version(int, const char*, char*);
+int vr_fw_version_all(void);
 int vr_fw_update(const char*, const char*, bool);
+int vr_fw_update_multi(const char**, const char**, int, bool);
+int vr_poll_reg(int, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, int);
 
 extern int plat_vr_init(void);
 extern void plat_vr_exit(void);
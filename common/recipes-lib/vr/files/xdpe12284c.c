@@ -392,8 +392,6 @@ program_xdpe(uint8_t bus, uint8_t addr, struct xdpe_config *config, bool force)
       break;
     }
 
-    msleep(500);
-
     tbuf[0] = VR_REG_PAGE;
     tbuf[1] = VR_XDPE_PAGE_60;
     if ((ret = i2c_io(fd, addr, tbuf, 2, rbuf, 0))) {
@@ -401,14 +399,9 @@ program_xdpe(uint8_t bus, uint8_t addr, struct xdpe_config *config, bool force)
       break;
     }
 
-    tbuf[0] = 0x01;
-    if ((ret = i2c_io(fd, addr, tbuf, 1, rbuf, 2))) {
-      syslog(LOG_WARNING, "%s: read register 0x%02X failed", __func__, tbuf[0]);
-      break;
-    }
-    if ((rbuf[0] & 0x01)) {
-      syslog(LOG_WARNING, "%s: unexpected status, reg%02X=%02X", __func__, tbuf[0], rbuf[0]);
-      ret = -1;
+    // wait for the upload to finish
+    if ((ret = vr_poll_reg(fd, addr, 0x01, 2, 0x01, 0x00, VR_XDPE_NVM_TIMEOUT))) {
+      syslog(LOG_WARNING, "%s: upload did not complete", __func__);
       break;
     }
 
@@ -17,6 +17,7 @@
 #define VR_XDPE_REG_NEXT_MEM 0x65  // page 0x62
 
 #define VR_XDPE_TOTAL_RW_SIZE 1080
+#define VR_XDPE_NVM_TIMEOUT 1000  // ms
 
 struct xdpe_config {
   uint8_t addr;
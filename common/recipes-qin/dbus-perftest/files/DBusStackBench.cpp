@@ -0,0 +1,263 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Benchmark of the dbus-utils / object-tree stack: an ObjectTree of
+// --objects objects with --attrs attributes each is registered through
+// DBus, then client threads, each on its own bus connection, measure the
+// latency of the org.openbmc.Object methods.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <gio/gio.h>
+#include <object-tree/ObjectTree.h>
+#include <object-tree/Object.h>
+#include <dbus-utils/DBus.h>
+#include <dbus-utils/dbus-interface/DBusObjectInterface.h>
+using namespace openbmc::qin;
+
+DEFINE_string(dbus_name, "org.openbmc.DBusStackBench",
+              "DBus name the benchmark tree is registered at");
+DEFINE_int32(objects, 100, "Number of objects in the tree");
+DEFINE_int32(attrs, 8, "Number of attributes of every object");
+DEFINE_string(clients, "1,4", "Client threads to run, comma separated");
+DEFINE_int32(iterations, 200, "Calls of every method per client thread");
+
+static const char* kInterface = "org.openbmc.Object";
+
+// implementation for handling DBus request messages
+static DBusObjectInterface objectInterface;
+
+struct Method {
+  const char* label;
+  const char* interface;  // nullptr for kInterface
+  const char* name;
+  bool onRoot;            // called on the root rather than on the objects
+  bool hasAttr;           // takes (s) the attribute name
+  bool hasValue;          // takes (ss) the attribute name and a value
+};
+
+static const Method kMethods[] = {
+  {"get",        nullptr, "getAttrValue",   false, true,  false},
+  {"read",       nullptr, "readAttrValue",  false, true,  false},
+  {"set",        nullptr, "setAttrValue",   false, true,  true},
+  {"write",      nullptr, "writeAttrValue", false, true,  true},
+  {"introspect", "org.freedesktop.DBus.Introspectable", "Introspect",
+                                            false, false, false},
+  {"dumpobj",    nullptr, "dumpByObject",   false, false, false},
+  {"dumptree",   nullptr, "dumpTree",       true,  false, false},
+};
+
+// event handler for DBus request messages
+static void eventLoop(GMainLoop* loop) {
+  g_main_loop_run(loop);
+}
+
+// resident memory of the process in kB
+static long getRssKb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return std::stol(line.substr(6));
+    }
+  }
+  return 0;
+}
+
+static std::string objectPath(int i) {
+  return "/org/bench/obj" + std::to_string(i);
+}
+
+static std::string attrName(int i) {
+  return "attr" + std::to_string(i);
+}
+
+struct Client {
+  const Method* method;
+  std::vector<uint32_t> latencyUs;
+  int errors = 0;
+};
+
+static void runClient(Client* client, GDBusConnection* conn, unsigned seed) {
+  const Method* m = client->method;
+  for (int i = 0; i < FLAGS_iterations; i++) {
+    int obj = (seed + i) % FLAGS_objects;
+    std::string path = m->onRoot ? "/org" : objectPath(obj);
+    std::string attr = attrName((seed + i) % FLAGS_attrs);
+    GVariant* param = nullptr;
+    if (m->hasValue) {
+      param = g_variant_new("(ss)", attr.c_str(), std::to_string(i).c_str());
+    } else if (m->hasAttr) {
+      param = g_variant_new("(s)", attr.c_str());
+    }
+
+    GError* error = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    GVariant* resp = g_dbus_connection_call_sync(
+        conn, FLAGS_dbus_name.c_str(), path.c_str(),
+        m->interface ? m->interface : kInterface, m->name, param,
+        nullptr, G_DBUS_CALL_FLAGS_NONE, -1, nullptr, &error);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    client->latencyUs.push_back(
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    if (resp != nullptr) {
+      g_variant_unref(resp);
+    } else {
+      client->errors++;
+      g_error_free(error);
+    }
+  }
+}
+
+static GDBusConnection* newConnection() {
+  GError* error = nullptr;
+  gchar* address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SYSTEM,
+                                                   nullptr, &error);
+  if (address == nullptr) {
+    LOG(ERROR) << "No system bus: " << error->message;
+    g_error_free(error);
+    return nullptr;
+  }
+  GDBusConnection* conn = g_dbus_connection_new_for_address_sync(
+      address,
+      (GDBusConnectionFlags)
+      (G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+      nullptr, nullptr, &error);
+  g_free(address);
+  if (conn == nullptr) {
+    LOG(ERROR) << "Cannot connect to the system bus: " << error->message;
+    g_error_free(error);
+  }
+  return conn;
+}
+
+static void runMethod(const Method &m, int numClients,
+                      std::vector<GDBusConnection*> &conns) {
+  std::vector<Client> clients(numClients);
+  std::vector<std::thread> threads;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int c = 0; c < numClients; c++) {
+    clients[c].method = &m;
+    threads.push_back(std::thread(runClient, &clients[c], conns[c],
+                                  c * 7919u));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start).count();
+
+  std::vector<uint32_t> all;
+  int errors = 0;
+  for (auto &client : clients) {
+    all.insert(all.end(), client.latencyUs.begin(), client.latencyUs.end());
+    errors += client.errors;
+  }
+  std::sort(all.begin(), all.end());
+  size_t n = all.size();
+  printf("%-10s %4d %9.0f %7u %7u %7u %7u %6d\n",
+    m.label, numClients, elapsed > 0 ? n / elapsed : 0.0,
+    all[n / 2], all[n * 90 / 100], all[n * 99 / 100], all[n - 1], errors);
+}
+
+static void parseList(const std::string &arg, std::vector<int> &list) {
+  std::stringstream ss(arg);
+  std::string tok;
+  while (std::getline(ss, tok, ',')) {
+    list.push_back(std::stoi(tok));
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ::google::InitGoogleLogging(argv[0]);
+  ::gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::vector<int> numClients;
+  parseList(FLAGS_clients, numClients);
+  int maxClients = 0;
+  for (int c : numClients) {
+    maxClients = std::max(maxClients, c);
+  }
+  if (FLAGS_objects <= 0 || FLAGS_attrs <= 0 || FLAGS_iterations <= 0 ||
+      maxClients <= 0) {
+    printf("--objects, --attrs, --iterations and --clients must be > 0\n");
+    return -1;
+  }
+
+  std::shared_ptr<DBus> sDbus(new DBus(FLAGS_dbus_name, &objectInterface));
+  sDbus->registerConnection();
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  std::thread t(eventLoop, loop);
+  sDbus->waitForConnection();
+
+  ObjectTree tree(sDbus, "org");
+  long rssBefore = getRssKb();
+  auto start = std::chrono::steady_clock::now();
+  tree.addObject("bench", "/org");
+  for (int i = 0; i < FLAGS_objects; i++) {
+    Object* obj = tree.addObject("obj" + std::to_string(i), "/org/bench");
+    for (int a = 0; a < FLAGS_attrs; a++) {
+      obj->addAttribute(attrName(a))->setValue(std::to_string(a));
+    }
+  }
+  double regMs = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start).count();
+  long rssAfter = getRssKb();
+  printf("%d objects x %d attributes registered in %.1f ms, "
+         "%.2f kB per object\n", FLAGS_objects, FLAGS_attrs, regMs,
+         (double)(rssAfter - rssBefore) / FLAGS_objects);
+
+  std::vector<GDBusConnection*> conns;
+  for (int c = 0; c < maxClients; c++) {
+    GDBusConnection* conn = newConnection();
+    if (conn == nullptr) {
+      return -1;
+    }
+    conns.push_back(conn);
+  }
+
+  printf("%-10s %4s %9s %7s %7s %7s %7s %6s\n", "method", "conc",
+         "calls/s", "p50us", "p90us", "p99us", "maxus", "errors");
+  for (const Method &m : kMethods) {
+    for (int c : numClients) {
+      runMethod(m, c, conns);
+    }
+  }
+  printf("peak rss %ld kB\n", getRssKb());
+
+  for (auto conn : conns) {
+    g_dbus_connection_close_sync(conn, nullptr, nullptr);
+    g_object_unref(conn);
+  }
+  g_main_loop_quit(loop);
+  t.join();
+  g_main_loop_unref(loop);
+  sDbus->unregisterConnection();
+  return 0;
+}
@@ -16,11 +16,13 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <string>
 #include <regex>
 #include <memory>
+#include <vector>
 #include <system_error>
 #include <stdexcept>
 #include <mutex>
@@ -38,6 +40,75 @@ std::regex DBus::dbusNameRegex =
 
 std::regex DBus::pathRegex = std::regex("^(\/[A-Za-z0-9_\\-]+)+$");
 
+static const char* objectManagerXml =
+  "<node>"
+  "  <interface name='org.freedesktop.DBus.ObjectManager'>"
+  "    <method name='GetManagedObjects'>"
+  "      <arg type='a{oa{sa{sv}}}' name='objects' direction='out'/>"
+  "    </method>"
+  "    <signal name='InterfacesAdded'>"
+  "      <arg type='o' name='object_path'/>"
+  "      <arg type='a{sa{sv}}' name='interfaces_and_properties'/>"
+  "    </signal>"
+  "    <signal name='InterfacesRemoved'>"
+  "      <arg type='o' name='object_path'/>"
+  "      <arg type='as' name='interfaces'/>"
+  "    </signal>"
+  "  </interface>"
+  "</node>";
+
+// Introspection data of the ObjectManager interface, parsed once
+static GDBusInterfaceInfo* getObjectManagerInfo() {
+  static GDBusNodeInfo* info =
+    g_dbus_node_info_new_for_xml(objectManagerXml, nullptr);
+  return info->interfaces[0];
+}
+
+const GDBusSubtreeVTable DBus::subtreeVtable_ = {
+  DBus::onSubtreeEnumerate,
+  DBus::onSubtreeIntrospect,
+  DBus::onSubtreeDispatch
+};
+
+const GDBusInterfaceVTable DBus::objectManagerVtable_ = {
+  DBus::onObjectManagerCall, nullptr, nullptr
+};
+
+/**
+ * The properties of the interface of the object at path, read through the
+ * get_property callback of the interface's vtable.
+ *
+ * @return floating GVariant of type a{sv}
+ */
+static GVariant* getInterfaceProperties(GDBusConnection    *connection,
+                                        const std::string  &path,
+                                        GDBusInterfaceInfo *info,
+                                        const GDBusInterfaceVTable *vtable,
+                                        void*               userData) {
+  GVariantBuilder props;
+  g_variant_builder_init(&props, G_VARIANT_TYPE("a{sv}"));
+  for (int i = 0;
+       vtable->get_property != nullptr && info->properties != nullptr &&
+       info->properties[i] != nullptr;
+       i++) {
+    GDBusPropertyInfo* prop = info->properties[i];
+    if (!(prop->flags & G_DBUS_PROPERTY_INFO_FLAGS_READABLE)) {
+      continue;
+    }
+    GError* error = nullptr;
+    GVariant* value = vtable->get_property(connection, nullptr, path.c_str(),
+                                           info->name, prop->name,
+                                           &error, userData);
+    if (value == nullptr) {
+      g_clear_error(&error);
+      continue;
+    }
+    g_variant_builder_add(&props, "{sv}", prop->name, value);
+    g_variant_unref(value);
+  }
+  return g_variant_builder_end(&props);
+}
+
 DBus::DBus(const std::string &name,
            DBusInterfaceBase* interface) {
   if (interface != nullptr) {
@@ -87,6 +158,7 @@ void DBus::unregisterConnection() {
   g_bus_unown_name(id_);
   id_ = 0;
   connection_ = nullptr;
+  subtreeIds_.clear();
   LOG(INFO) << "DBus name " << name_ << " released";
 }
 
@@ -103,6 +175,20 @@ bool DBus::isObjectRegistered(const std::string &path,
   return object->containInterface(interface.getName());
 }
 
+void DBus::registerSubtree(const std::string &path) {
+  std::lock_guard<std::mutex> lock(m_);
+  LOG(INFO) << "Serving objects at path " << path << " with subtrees";
+  if (!isPathAllowed(path)) {
+    throw std::invalid_argument("Path does not match regex");
+  }
+  if (id_ > 0) {
+    LOG(ERROR) << "Subtree at path " << path << " to be registered after "
+      << "DBus name " << name_ << " has been acquired";
+    throw std::runtime_error("Subtree registration after connection");
+  }
+  subtreePath_ = path;
+}
+
 void DBus::registerObject(const std::string &path,
                           DBusInterfaceBase &interface,
                           void* userData) {
@@ -127,6 +213,16 @@ void DBus::registerObject(const std::string &path,
     }
   }
 
+  if (isInSubtree(path)) {
+    // served by the subtree of its parent, nothing to register of its own
+    object->addInterface(interface, userData);
+    if (connection_ != nullptr) {
+      registerObjectSubtree(path);
+      emitInterfaceChange(*object, interface, userData, true);
+    }
+    return;
+  }
+
   if (connection_ != nullptr) {
     LOG(INFO) << "DBus connection good. Registering object at path " << path
       << " with interface " << interface.getName();
@@ -230,6 +326,10 @@ void DBus::unregisterObjectInterface(DBusObject              &object,
     throw std::runtime_error("Object unregistration failed");
   }
 
+  if (id == 0 && connection_ != nullptr && isInSubtree(object.getPath())) {
+    emitInterfaceChange(object, interface, nullptr, false);
+  }
+
   std::string path = object.getPath();
   if (id > 0) {
     // set id to 0 needed before removing the interface
@@ -257,8 +357,15 @@ void DBus::onNameAcquired(GDBusConnection *connection,
 
     LOG(INFO) << "Registering objects with interfaces";
     dbus->connection_ = connection;
+    if (!dbus->subtreePath_.empty()) {
+      dbus->registerObjectSubtree(dbus->subtreePath_);
+    }
     for (auto i = oMap.begin(); i != oMap.end(); i++) {
       DBusObject* object = i->second.get();
+      if (dbus->isInSubtree(object->getPath())) {
+        dbus->registerObjectSubtree(object->getPath());
+        continue;
+      }
       const DBusObject::InterfaceMap &iMap = object->getInterfaceMap();
       for (auto j = iMap.begin(); j != iMap.end(); j++) {
         try {
@@ -291,6 +398,7 @@ void DBus::onNameLost(GDBusConnection *connection,
 
   LOG(INFO) << "Resetting id for each object";
   dbus->connection_ = nullptr;
+  dbus->subtreeIds_.clear();
   for (auto i = oMap.begin(); i != oMap.end(); i++) {
     DBusObject* object = i->second.get();
     const DBusObject::InterfaceMap &iMap = object->getInterfaceMap();
@@ -310,5 +418,225 @@ void DBus::onNameLost(GDBusConnection *connection,
   }
 }
 
+void DBus::registerObjectSubtree(const std::string &path) {
+  DCHECK(connection_ != nullptr) << "No Connection when registering subtree "
+    << "for object " << path;
+
+  // the subtree path object is the root node of its own subtree
+  const std::string subtree =
+    path == subtreePath_ ? path : path.substr(0, path.rfind('/'));
+  if (subtreeIds_.find(subtree) != subtreeIds_.end()) {
+    return;
+  }
+
+  GError* error = nullptr;
+  unsigned int id = g_dbus_connection_register_subtree(
+              connection_,
+              subtree.c_str(),
+              &subtreeVtable_,
+              // the nodes are checked in dispatch instead of enumerating
+              // all the children on every call
+              G_DBUS_SUBTREE_FLAGS_DISPATCH_TO_UNENUMERATED_NODES,
+              this,      // throw as a parameter to callback
+              nullptr,   // arg_free_func
+              &error);   // GError**
+  if (id == 0) {
+    LOG(ERROR) << "Subtree registration failed at path " << subtree
+      << ": " << error->message;
+    g_error_free(error);
+    return;
+  }
+  subtreeIds_.insert(std::make_pair(subtree, id));
+  LOG(INFO) << "Subtree at path " << subtree << " registered with id " << id;
+}
+
+void DBus::unregisterSubtrees() {
+  if (connection_ != nullptr) {
+    for (auto &it : subtreeIds_) {
+      g_dbus_connection_unregister_subtree(connection_, it.second);
+    }
+  }
+  subtreeIds_.clear();
+}
+
+void DBus::emitInterfaceChange(const DBusObject &object,
+                               DBusInterfaceBase &interface,
+                               void* userData,
+                               bool added) const {
+  const std::string &path = object.getPath();
+  if (path == subtreePath_) {
+    // the ObjectManager only reports the objects below it
+    return;
+  }
+
+  GVariant* params;
+  if (added) {
+    GVariantBuilder ifaces;
+    g_variant_builder_init(&ifaces, G_VARIANT_TYPE("a{sa{sv}}"));
+    g_variant_builder_add(&ifaces, "{s@a{sv}}", interface.getName().c_str(),
+        getInterfaceProperties(connection_, path,
+                               interface.getInfo()->interfaces[interface.getNo()],
+                               interface.getVtable(), userData));
+    params = g_variant_new("(o@a{sa{sv}})", path.c_str(),
+                           g_variant_builder_end(&ifaces));
+  } else {
+    GVariantBuilder ifaces;
+    g_variant_builder_init(&ifaces, G_VARIANT_TYPE("as"));
+    g_variant_builder_add(&ifaces, "s", interface.getName().c_str());
+    params = g_variant_new("(o@as)", path.c_str(),
+                           g_variant_builder_end(&ifaces));
+  }
+  g_dbus_connection_emit_signal(connection_, nullptr, subtreePath_.c_str(),
+                                getObjectManagerInfo()->name,
+                                added ? "InterfacesAdded" : "InterfacesRemoved",
+                                params, nullptr);
+}
+
+// Full path of the node of a subtree callback; node is null for the root
+static std::string getNodePath(const gchar* objectPath, const gchar* node) {
+  std::string path(objectPath);
+  if (node != nullptr) {
+    path += "/";
+    path += node;
+  }
+  return path;
+}
+
+gchar** DBus::onSubtreeEnumerate(GDBusConnection *connection,
+                                 const gchar     *sender,
+                                 const gchar     *objectPath,
+                                 gpointer         arg) {
+  DBus* dbus = static_cast<DBus*>(arg);
+  const std::string prefix = std::string(objectPath) + "/";
+  GPtrArray* nodes = g_ptr_array_new();
+  {
+    std::lock_guard<std::mutex> lock(dbus->m_);
+    for (auto &it : dbus->objectMap_) {
+      const std::string &path = it.first;
+      if (path.compare(0, prefix.size(), prefix) == 0 &&
+          path.find('/', prefix.size()) == std::string::npos) {
+        g_ptr_array_add(nodes, g_strdup(path.c_str() + prefix.size()));
+      }
+    }
+  }
+  g_ptr_array_add(nodes, nullptr);
+  return reinterpret_cast<gchar**>(g_ptr_array_free(nodes, FALSE));
+}
+
+GDBusInterfaceInfo** DBus::onSubtreeIntrospect(GDBusConnection *connection,
+                                               const gchar     *sender,
+                                               const gchar     *objectPath,
+                                               const gchar     *node,
+                                               gpointer         arg) {
+  DBus* dbus = static_cast<DBus*>(arg);
+  const std::string path = getNodePath(objectPath, node);
+  GPtrArray* infos = g_ptr_array_new();
+  {
+    std::lock_guard<std::mutex> lock(dbus->m_);
+    DBusObject* object = dbus->getMutableDBusObject(path);
+    if (object != nullptr) {
+      // infos are shared by all objects of an interface, only ref'ed here
+      for (auto &it : object->getInterfaceMap()) {
+        DBusInterfaceBase &interface = it.second.get()->interface;
+        g_ptr_array_add(infos, g_dbus_interface_info_ref(
+              interface.getInfo()->interfaces[interface.getNo()]));
+      }
+    }
+  }
+  if (path == dbus->subtreePath_) {
+    g_ptr_array_add(infos, g_dbus_interface_info_ref(getObjectManagerInfo()));
+  }
+  g_ptr_array_add(infos, nullptr);
+  return reinterpret_cast<GDBusInterfaceInfo**>(g_ptr_array_free(infos, FALSE));
+}
+
+const GDBusInterfaceVTable* DBus::onSubtreeDispatch(
+                                  GDBusConnection *connection,
+                                  const gchar     *sender,
+                                  const gchar     *objectPath,
+                                  const gchar     *interfaceName,
+                                  const gchar     *node,
+                                  gpointer        *outUserData,
+                                  gpointer         arg) {
+  DBus* dbus = static_cast<DBus*>(arg);
+  const std::string path = getNodePath(objectPath, node);
+  if (path == dbus->subtreePath_ &&
+      g_strcmp0(interfaceName, getObjectManagerInfo()->name) == 0) {
+    *outUserData = dbus;
+    return &objectManagerVtable_;
+  }
+
+  std::lock_guard<std::mutex> lock(dbus->m_);
+  DBusObject* object = dbus->getMutableDBusObject(path);
+  if (object == nullptr) {
+    return nullptr;
+  }
+  DBusInterfaceBase* interface = object->getInterface(interfaceName);
+  if (interface == nullptr) {
+    return nullptr;
+  }
+  *outUserData = object->getUserData(interfaceName);
+  return interface->getVtable();
+}
+
+void DBus::onObjectManagerCall(GDBusConnection       *connection,
+                               const gchar           *sender,
+                               const gchar           *objectPath,
+                               const gchar           *interfaceName,
+                               const gchar           *methodName,
+                               GVariant              *parameters,
+                               GDBusMethodInvocation *invocation,
+                               gpointer               arg) {
+  struct ManagedInterface {
+    std::string                 path;
+    GDBusInterfaceInfo*         info;
+    const GDBusInterfaceVTable* vtable;
+    void*                       userData;
+  };
+
+  DBus* dbus = static_cast<DBus*>(arg);
+  LOG(INFO) << "Dumping the managed objects at path " << objectPath;
+  const std::string prefix = dbus->subtreePath_ + "/";
+  std::vector<ManagedInterface> ifaces;
+  {
+    std::lock_guard<std::mutex> lock(dbus->m_);
+    for (auto &it : dbus->objectMap_) {
+      if (it.first.compare(0, prefix.size(), prefix) != 0) {
+        continue;
+      }
+      for (auto &jt : it.second.get()->getInterfaceMap()) {
+        DBusInterfaceBase &interface = jt.second.get()->interface;
+        ifaces.push_back({it.first,
+                          interface.getInfo()->interfaces[interface.getNo()],
+                          interface.getVtable(),
+                          jt.second.get()->userData});
+      }
+    }
+  }
+
+  // properties are read without the lock, the callbacks are the interfaces'
+  std::sort(ifaces.begin(), ifaces.end(),
+            [](const ManagedInterface &a, const ManagedInterface &b) {
+              return a.path < b.path;
+            });
+  GVariantBuilder objects;
+  g_variant_builder_init(&objects, G_VARIANT_TYPE("a{oa{sa{sv}}}"));
+  for (size_t i = 0; i < ifaces.size();) {
+    GVariantBuilder props;
+    g_variant_builder_init(&props, G_VARIANT_TYPE("a{sa{sv}}"));
+    size_t j = i;
+    for (; j < ifaces.size() && ifaces[j].path == ifaces[i].path; j++) {
+      g_variant_builder_add(&props, "{s@a{sv}}", ifaces[j].info->name,
+          getInterfaceProperties(connection, ifaces[j].path, ifaces[j].info,
+                                 ifaces[j].vtable, ifaces[j].userData));
+    }
+    g_variant_builder_add(&objects, "{o@a{sa{sv}}}", ifaces[i].path.c_str(),
+                          g_variant_builder_end(&props));
+    i = j;
+  }
+  g_dbus_method_invocation_return_value(invocation,
+      g_variant_new("(@a{oa{sa{sv}}})", g_variant_builder_end(&objects)));
+}
+
 } // namespace qin
 } // namespace openbmc
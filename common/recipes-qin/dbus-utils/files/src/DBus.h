@@ -54,6 +54,10 @@ class DBus : public Ipc {
     // in the constructor nor when registering an object
     DBusDefaultInterface            defaultInterface_;
     DBusInterfaceBase*              interface_{&defaultInterface_};
+    // objects at and below this path are served by subtrees; empty if none
+    std::string                     subtreePath_;
+    // subtree registration ids by the path they are registered at
+    std::unordered_map<std::string, unsigned int> subtreeIds_;
 
   public:
     // default regex for matching DBus name
@@ -82,6 +86,10 @@ class DBus : public Ipc {
         for (auto it = objectMap_.begin(); it != objectMap_.end(); it++) {
           unregisterObject(it->first);
         }
+        {
+          std::lock_guard<std::mutex> lock(m_);
+          unregisterSubtrees();
+        }
         g_bus_unown_name(id_);
       }
     }
@@ -100,6 +108,15 @@ class DBus : public Ipc {
       return connection_ != nullptr;
     }
 
+    /**
+     * Get the connection to the dbus daemon, nullptr if not connected.
+     * E.g. to emit signals from other threads.
+     */
+    GDBusConnection* getConnection() const {
+      std::lock_guard<std::mutex> lock(m_);
+      return connection_;
+    }
+
     DBusInterfaceBase& getDefaultInterface() const {
       return *interface_;
     }
@@ -164,6 +181,24 @@ class DBus : public Ipc {
     bool isObjectRegistered(const std::string &path,
                             DBusInterfaceBase &interface) const;
 
+    /**
+     * Serve the objects at and below path with dbus subtrees instead of
+     * registering every object with every interface. The objects and
+     * their interfaces are resolved from the object map when a call comes
+     * in, and path gets the org.freedesktop.DBus.ObjectManager interface.
+     * GDBus subtrees are one level deep, so a subtree is registered for
+     * each path having child objects.
+     *
+     * @param path prefix of the objects served by subtrees
+     * @throw invalid_argument if path does not match regex
+     * @throw runtime_error if called after registerConnection()
+     */
+    void registerSubtree(const std::string &path);
+
+    const std::string& getSubtreePath() const {
+      return subtreePath_;
+    }
+
     /**
      * Register the dbus object path with the interface.
      *
@@ -214,6 +249,9 @@ class DBus : public Ipc {
     void unregisterObject(const std::string &path) override;
 
   private:
+    static const GDBusSubtreeVTable   subtreeVtable_;
+    static const GDBusInterfaceVTable objectManagerVtable_;
+
     DBusObject* getMutableDBusObject(const std::string &path) const {
       DBusObjectMap::const_iterator it;
       if ((it = objectMap_.find(path)) == objectMap_.end()) {
@@ -243,6 +281,74 @@ class DBus : public Ipc {
     void unregisterObjectInterface(DBusObject &object,
                                    DBusInterfaceBase &interface);
 
+    bool isInSubtree(const std::string &path) const {
+      return !subtreePath_.empty() &&
+             (path == subtreePath_ ||
+              path.compare(0, subtreePath_.size() + 1, subtreePath_ + "/") == 0);
+    }
+
+    /**
+     * Register the subtree serving the object at path, i.e. the one of its
+     * parent, if not registered yet. It is assumed that the connection is
+     * good and that path is in the subtree.
+     *
+     * @param path of the object
+     */
+    void registerObjectSubtree(const std::string &path);
+
+    /**
+     * Unregister all the subtrees from the connection.
+     */
+    void unregisterSubtrees();
+
+    /**
+     * Emit ObjectManager InterfacesAdded or InterfacesRemoved for the
+     * interface of the object in the subtree.
+     */
+    void emitInterfaceChange(const DBusObject &object,
+                             DBusInterfaceBase &interface,
+                             void* userData,
+                             bool added) const;
+
+    /**
+     * Subtree callbacks: list the child nodes of a path, the interfaces of
+     * a node, and the vtable and user data of a node's interface.
+     * The DBus instance is passed in arg.
+     */
+    static gchar** onSubtreeEnumerate(GDBusConnection *connection,
+                                      const gchar     *sender,
+                                      const gchar     *objectPath,
+                                      gpointer         arg);
+
+    static GDBusInterfaceInfo** onSubtreeIntrospect(
+                                      GDBusConnection *connection,
+                                      const gchar     *sender,
+                                      const gchar     *objectPath,
+                                      const gchar     *node,
+                                      gpointer         arg);
+
+    static const GDBusInterfaceVTable* onSubtreeDispatch(
+                                      GDBusConnection *connection,
+                                      const gchar     *sender,
+                                      const gchar     *objectPath,
+                                      const gchar     *interfaceName,
+                                      const gchar     *node,
+                                      gpointer        *outUserData,
+                                      gpointer         arg);
+
+    /**
+     * Method call handler of ObjectManager GetManagedObjects on the
+     * subtree path. The DBus instance is passed in arg.
+     */
+    static void onObjectManagerCall(GDBusConnection       *connection,
+                                    const gchar           *sender,
+                                    const gchar           *objectPath,
+                                    const gchar           *interfaceName,
+                                    const gchar           *methodName,
+                                    GVariant              *parameters,
+                                    GDBusMethodInvocation *invocation,
+                                    gpointer               arg);
+
     /**
      * Event handler on bus acquired. Objects are registered here.
      * Note that this needs to be static.
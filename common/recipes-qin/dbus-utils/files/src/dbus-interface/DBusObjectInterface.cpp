@@ -18,6 +18,7 @@
 
 #include <ctime>
 #include <string>
+#include <sstream>
 #include <stdexcept>
 #include <system_error>
 #include <glog/logging.h>
@@ -68,6 +69,10 @@ const char* DBusObjectInterface::xml =
   "    <method name='dumpTree'>"
   "      <arg type='s' name='json string' direction='out'/>"
   "    </method>"
+  "    <signal name='alarm'>"
+  "      <arg type='s' name='attribute name'/>"
+  "      <arg type='s' name='attribute value'/>"
+  "    </signal>"
   "  </interface>"
   "</node>";
 
@@ -165,6 +170,7 @@ void DBusObjectInterface::readAttrValue(GDBusMethodInvocation* invocation,
                                           G_IO_ERROR,
                                           G_IO_ERROR_FAILED,
                                           e.what());
+    return;
   }
 
   g_dbus_method_invocation_return_value(invocation,
@@ -222,6 +228,149 @@ void DBusObjectInterface::writeAttrValue(GDBusMethodInvocation* invocation,
   g_dbus_method_invocation_return_value(invocation, nullptr);
 }
 
+// Native GVariant of a typed value
+static GVariant* newTypedVariant(const AttrValue &value) {
+  switch (value.getType()) {
+    case AttrValue::INT:
+      return g_variant_new_int64(value.getInt());
+    case AttrValue::DOUBLE:
+      return g_variant_new_double(value.getDouble());
+    case AttrValue::BOOL:
+      return g_variant_new_boolean(value.getBool());
+    default:
+      return g_variant_new_string(value.str().c_str());
+  }
+}
+
+void DBusObjectInterface::getAttrTypedValue(GDBusMethodInvocation* invocation,
+                                            GVariant*              gvparam,
+                                            gpointer               arg) {
+  const char* name;
+  g_variant_get(gvparam, "(&s)", &name);
+  LOG(INFO) << "Getting typed value of Attribute \"" << name << "\"";
+
+  Object* obj = static_cast<Object*>(arg);
+  Attribute* attr = obj->getAttribute(name);
+  if (attr == nullptr) {
+    errorAttrNotFound(invocation, name);
+    return;
+  }
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new("(v)", newTypedVariant(attr->getTypedValue())));
+}
+
+void DBusObjectInterface::readAttrTypedValue(GDBusMethodInvocation* invocation,
+                                             GVariant*              gvparam,
+                                             gpointer               arg) {
+  const char* name;
+  g_variant_get(gvparam, "(&s)", &name);
+  LOG(INFO) << "Reading typed value of Attribute \"" << name << "\"";
+
+  Object* obj = static_cast<Object*>(arg);
+  Attribute* attr = obj->getAttribute(name);
+  if (attr == nullptr) {
+    errorAttrNotFound(invocation, name);
+    return;
+  }
+
+  GVariant* value;
+  try {
+    value = newTypedVariant(obj->readAttrTypedValue(name));
+  } catch (const std::system_error &e) {
+    g_dbus_method_invocation_return_error(invocation,
+                                          G_IO_ERROR,
+                                          G_IO_ERROR_FAILED,
+                                          e.what());
+    return;
+  }
+
+  g_dbus_method_invocation_return_value(invocation,
+                                        g_variant_new("(v)", value));
+}
+
+bool DBusObjectInterface::getTypedParam(GDBusMethodInvocation* invocation,
+                                        GVariant*              gvparam,
+                                        Object*                obj,
+                                        const char**           name,
+                                        AttrValue&             value) {
+  GVariant* gvalue;
+  g_variant_get(gvparam, "(&sv)", name, &gvalue);
+  if (obj->getAttribute(*name) == nullptr) {
+    g_variant_unref(gvalue);
+    errorAttrNotFound(invocation, *name);
+    return false;
+  }
+
+  bool ok = true;
+  if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_INT64)) {
+    value = AttrValue(int64_t(g_variant_get_int64(gvalue)));
+  } else if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_INT32)) {
+    value = AttrValue(int64_t(g_variant_get_int32(gvalue)));
+  } else if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_UINT32)) {
+    value = AttrValue(int64_t(g_variant_get_uint32(gvalue)));
+  } else if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_DOUBLE)) {
+    value = AttrValue(double(g_variant_get_double(gvalue)));
+  } else if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_BOOLEAN)) {
+    value = AttrValue(bool(g_variant_get_boolean(gvalue)));
+  } else if (g_variant_is_of_type(gvalue, G_VARIANT_TYPE_STRING)) {
+    value = AttrValue(std::string(g_variant_get_string(gvalue, nullptr)));
+  } else {
+    LOG(ERROR) << "Attribute \"" << *name << "\" value of type "
+      << g_variant_get_type_string(gvalue);
+    g_dbus_method_invocation_return_error(invocation,
+                                          G_IO_ERROR,
+                                          G_IO_ERROR_INVALID_ARGUMENT,
+                                          "Unsupported value type");
+    ok = false;
+  }
+  g_variant_unref(gvalue);
+  return ok;
+}
+
+void DBusObjectInterface::setAttrTypedValue(GDBusMethodInvocation* invocation,
+                                            GVariant*              gvparam,
+                                            gpointer               arg) {
+  const char* name;
+  AttrValue value;
+  Object* obj = static_cast<Object*>(arg);
+  if (!getTypedParam(invocation, gvparam, obj, &name, value)) {
+    return;
+  }
+  LOG(INFO) << "Setting typed value \"" << value.str() << "\" to Attribute \""
+    << name << "\"";
+  obj->getAttribute(name)->setTypedValue(value);
+
+  LOG(INFO) << "Setting Attribute value successful";
+  g_dbus_method_invocation_return_value(invocation, nullptr);
+}
+
+void DBusObjectInterface::writeAttrTypedValue(
+                                         GDBusMethodInvocation* invocation,
+                                         GVariant*              gvparam,
+                                         gpointer               arg) {
+  const char* name;
+  AttrValue value;
+  Object* obj = static_cast<Object*>(arg);
+  if (!getTypedParam(invocation, gvparam, obj, &name, value)) {
+    return;
+  }
+  LOG(INFO) << "Writing typed value \"" << value.str() << "\" to Attribute \""
+    << name << "\"";
+
+  try {
+    obj->writeAttrTypedValue(name, value);
+  } catch (const std::system_error &e) {
+    g_dbus_method_invocation_return_error(invocation,
+                                          G_IO_ERROR,
+                                          G_IO_ERROR_FAILED,
+                                          e.what());
+    return;
+  }
+
+  LOG(INFO) << "Writing Attribute value successful";
+  g_dbus_method_invocation_return_value(invocation, nullptr);
+}
+
 void DBusObjectInterface::dumpByObject(GDBusMethodInvocation* invocation,
                                        gpointer               arg) {
   Object* obj = static_cast<Object*>(arg);
@@ -238,7 +387,9 @@ void DBusObjectInterface::dumpRecursiveByObject(
   Object* obj = static_cast<Object*>(arg);
   LOG(INFO) << "Dumpping the object \"" << obj->getName()
     << "\" recursively into json string";
-  const std::string objDump = obj->dumpToJsonRecursive().dump();
+  std::ostringstream ss;
+  obj->dumpToStream(ss);
+  const std::string objDump = ss.str();
   g_dbus_method_invocation_return_value(invocation,
                                         g_variant_new("(s)", objDump.c_str()));
 }
@@ -251,7 +402,9 @@ void DBusObjectInterface::dumpTree(GDBusMethodInvocation* invocation,
   }
   LOG(INFO) << "Dumpping the object tree starting at root " << root->getName()
     << " into json string";
-  const std::string treeDump = root->dumpToJsonRecursive().dump();
+  std::ostringstream ss;
+  root->dumpToStream(ss);
+  const std::string treeDump = ss.str();
   g_dbus_method_invocation_return_value(invocation,
                                         g_variant_new("(s)", treeDump.c_str()));
 }
@@ -284,6 +437,14 @@ void DBusObjectInterface::methodCallBack(
     setAttrValue(invocation, parameters, arg);
   } else if (g_strcmp0(methodName, "writeAttrValue") == 0) {
     writeAttrValue(invocation, parameters, arg);
+  } else if (g_strcmp0(methodName, "getAttrTypedValue") == 0) {
+    getAttrTypedValue(invocation, parameters, arg);
+  } else if (g_strcmp0(methodName, "readAttrTypedValue") == 0) {
+    readAttrTypedValue(invocation, parameters, arg);
+  } else if (g_strcmp0(methodName, "setAttrTypedValue") == 0) {
+    setAttrTypedValue(invocation, parameters, arg);
+  } else if (g_strcmp0(methodName, "writeAttrTypedValue") == 0) {
+    writeAttrTypedValue(invocation, parameters, arg);
   } else if (g_strcmp0(methodName, "dumpByObject") == 0) {
     dumpByObject(invocation, arg);
   } else if (g_strcmp0(methodName, "dumpRecursiveByObject") == 0) {
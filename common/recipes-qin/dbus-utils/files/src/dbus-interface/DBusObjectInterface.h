@@ -20,6 +20,7 @@
 #include <string>
 #include <glog/logging.h>
 #include <gio/gio.h>
+#include <object-tree/Object.h>
 #include "../DBusInterfaceBase.h"
 
 namespace openbmc {
@@ -131,6 +132,57 @@ class DBusObjectInterface: public DBusInterfaceBase {
                                GVariant*              gvparam,
                                gpointer               arg);
 
+    /**
+     * As getAttrValue, with the value as typed: a variant of an int64
+     * (x), double (d), boolean (b) or string (s).
+     *
+     * @param invocation stands for the identity of the message
+     * @param gvparam should be a GVariant containing a string
+     *        of attr name
+     * @param arg is the pointer to the specified object
+     */
+    static void getAttrTypedValue(GDBusMethodInvocation* invocation,
+                                  GVariant*              gvparam,
+                                  gpointer               arg);
+
+    /**
+     * As readAttrValue, with the value as typed (see getAttrTypedValue).
+     *
+     * @param invocation stands for the identity of the message
+     * @param gvparam should be a GVariant containing a string of
+     *        attr name
+     * @param arg is the pointer to the specified object
+     */
+    static void readAttrTypedValue(GDBusMethodInvocation* invocation,
+                                   GVariant*              gvparam,
+                                   gpointer               arg);
+
+    /**
+     * As setAttrValue, with the value as a variant of an integer, double,
+     * boolean or string. Send GIO_ERROR_INVALID_ARGUMENT to DBus for
+     * the other types.
+     *
+     * @param invocation stands for the identity of the message
+     * @param gvparam should be a GVariant containing in order a string of
+     *        attr name and a variant of value to be set
+     * @param arg is the pointer to the specified object
+     */
+    static void setAttrTypedValue(GDBusMethodInvocation* invocation,
+                                  GVariant*              gvparam,
+                                  gpointer               arg);
+
+    /**
+     * As writeAttrValue, with the value as in setAttrTypedValue.
+     *
+     * @param invocation stands for the identity of the message
+     * @param gvparam should be a GVariant containing in order a string of
+     *        attr name and a variant of value to be set
+     * @param arg is the pointer to the specified object
+     */
+    static void writeAttrTypedValue(GDBusMethodInvocation* invocation,
+                                    GVariant*              gvparam,
+                                    gpointer               arg);
+
     /**
      * Dump the object into a string of JSON.
      *
@@ -176,6 +228,24 @@ class DBusObjectInterface: public DBusInterfaceBase {
 
   private:
 
+    /**
+     * Helper function for reading the typed value from the parameters of
+     * setAttrTypedValue and writeAttrTypedValue. Sends the DBus error if
+     * the attribute or the type is wrong.
+     *
+     * @param invocation to pass the dbus error message
+     * @param gvparam with the attr name and value
+     * @param obj of the attribute
+     * @param name of the attribute, set
+     * @param value of the attribute, set
+     * @return false if an error was sent
+     */
+    static bool getTypedParam(GDBusMethodInvocation* invocation,
+                              GVariant*              gvparam,
+                              Object*                obj,
+                              const char**           name,
+                              AttrValue&             value);
+
     /**
      * Helper function for sending an error to the DBus when the
      * attribute is not found with the specified name.
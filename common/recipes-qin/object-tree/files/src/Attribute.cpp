@@ -16,6 +16,11 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <glog/logging.h>
@@ -39,11 +44,103 @@ std::unordered_map<std::string, const unsigned int> Attribute::stringModesMap =
     {"RW", RW}
   };
 
+const std::string& AttrValue::str() const {
+  if (!strValid_) {
+    char buf[32];
+    switch (type_) {
+      case INT:
+        snprintf(buf, sizeof(buf), "%" PRId64, int_);
+        break;
+      case DOUBLE:
+        snprintf(buf, sizeof(buf), "%.15g", double_);
+        if (strtod(buf, nullptr) != double_) {
+          snprintf(buf, sizeof(buf), "%.17g", double_);
+        }
+        break;
+      case BOOL:
+        snprintf(buf, sizeof(buf), "%d", bool_ ? 1 : 0);
+        break;
+      default:
+        buf[0] = '\0';
+        break;
+    }
+    str_ = buf;
+    strValid_ = true;
+  }
+  return str_;
+}
+
+int64_t AttrValue::getInt() const {
+  switch (type_) {
+    case INT:
+      return int_;
+    case DOUBLE:
+      return int64_t(double_);
+    case BOOL:
+      return bool_;
+    default:
+      break;
+  }
+  if (str_ == "true" || str_ == "false") {
+    return str_ == "true";
+  }
+  char* end;
+  errno = 0;
+  long long value = strtoll(str_.c_str(), &end, 0);
+  if (str_.empty() || *end != '\0' || errno) {
+    throw std::invalid_argument("Not an integer: " + str_);
+  }
+  return value;
+}
+
+double AttrValue::getDouble() const {
+  switch (type_) {
+    case INT:
+      return double(int_);
+    case DOUBLE:
+      return double_;
+    case BOOL:
+      return bool_;
+    default:
+      break;
+  }
+  char* end;
+  double value = strtod(str_.c_str(), &end);
+  if (str_.empty() || *end != '\0') {
+    throw std::invalid_argument("Not a number: " + str_);
+  }
+  return value;
+}
+
+bool AttrValue::getBool() const {
+  if (type_ == DOUBLE) {
+    return double_ != 0;
+  }
+  return getInt() != 0;
+}
+
+AttrValue AttrValue::fromText(const std::string &text) {
+  size_t i = (!text.empty() && text[0] == '-') ? 1 : 0;
+  bool integer = i < text.size() && text.size() - i <= 18 &&
+                 (text[i] != '0' || text.size() == i + 1) &&
+                 !(i == 1 && text == "-0");
+  for (size_t j = i; integer && j < text.size(); j++) {
+    integer = text[j] >= '0' && text[j] <= '9';
+  }
+  if (!integer) {
+    return AttrValue(text);
+  }
+  AttrValue value(int64_t(strtoll(text.c_str(), nullptr, 10)));
+  value.str_ = text;
+  value.strValid_ = true;
+  return value;
+}
+
 nlohmann::json Attribute::dumpToJson() const {
   LOG(INFO) << "Dumpping the info for Attribute \"" << name_ << "\"";
   nlohmann::json dump;
   dump["name"] = name_;
-  dump["value"] = value_;
+  dump["value"] = value_.str();
   dump["modes"] = modesStringMap.at(modes_);
   return dump;
 }
@@ -17,6 +17,7 @@
  */
 
 #pragma once
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <nlohmann/json.hpp>
@@ -24,6 +25,66 @@
 namespace openbmc {
 namespace qin {
 
+/**
+ * Value of an attribute: a string, or an int64, double or bool kept as
+ * such. The text of a typed value is only made when asked for by str().
+ */
+class AttrValue {
+  public:
+    enum Type {STRING, INT, DOUBLE, BOOL};
+
+  private:
+    Type type_;
+    union {
+      int64_t int_;
+      double  double_;
+      bool    bool_;
+    };
+    // the value if STRING, else its text if strValid_
+    mutable std::string str_;
+    mutable bool        strValid_;
+
+  public:
+    AttrValue() : type_(STRING), int_(0), strValid_(true) {}
+    explicit AttrValue(const std::string &value)
+        : type_(STRING), int_(0), str_(value), strValid_(true) {}
+    explicit AttrValue(int64_t value)
+        : type_(INT), int_(value), strValid_(false) {}
+    explicit AttrValue(double value)
+        : type_(DOUBLE), double_(value), strValid_(false) {}
+    explicit AttrValue(bool value)
+        : type_(BOOL), bool_(value), strValid_(false) {}
+
+    Type getType() const {
+      return type_;
+    }
+
+    /**
+     * Text of the value: bools are "1" or "0", doubles the shortest text
+     * which reads back as the same value.
+     */
+    const std::string& str() const;
+
+    /**
+     * The value as the given type, converted if of another. Strings are
+     * parsed as a whole; "true" and "false" are bools too.
+     *
+     * @throw std::invalid_argument if a string cannot be converted
+     */
+    int64_t getInt() const;
+    double getDouble() const;
+    bool getBool() const;
+
+    /**
+     * Value of the text read from a device: an INT (keeping the text) if
+     * it is an integer written as str() would write it, a STRING
+     * otherwise.
+     *
+     * @param text to be kept
+     */
+    static AttrValue fromText(const std::string &text);
+};
+
 /**
  * Attribute for object
  */
@@ -38,7 +99,7 @@ class Attribute {
 
   protected:
     std::string name_;
-    std::string value_{""};
+    AttrValue   value_;
     Modes       modes_{RO};
 
   public:
@@ -56,6 +117,10 @@ class Attribute {
     }
 
     const std::string& getValue() const {
+      return value_.str();
+    }
+
+    const AttrValue& getTypedValue() const {
       return value_;
     }
 
@@ -64,9 +129,25 @@ class Attribute {
     }
 
     void setValue(const std::string &value) {
+      value_ = AttrValue(value);
+    }
+
+    void setTypedValue(const AttrValue &value) {
       value_ = value;
     }
 
+    void setInt(int64_t value) {
+      value_ = AttrValue(value);
+    }
+
+    void setDouble(double value) {
+      value_ = AttrValue(value);
+    }
+
+    void setBool(bool value) {
+      value_ = AttrValue(value);
+    }
+
     /**
      *  Set the modes of the attribute. glog error if
      *  the input is NULL or is not "RO" || "WO" || "RW"
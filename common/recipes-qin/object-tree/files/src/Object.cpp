@@ -17,6 +17,7 @@
  */
 
 #include <string>
+#include <sstream>
 #include <stdexcept>
 #include <unordered_map>
 #include <memory>
@@ -41,6 +42,12 @@ const std::string& Object::readAttrValue(const std::string &name) const {
   return attr->getValue();
 }
 
+const AttrValue& Object::readAttrTypedValue(const std::string &name) const {
+  LOG(INFO) << "Reading the typed value of Attribute \"" << name << "\"";
+  Attribute* attr = getReadableAttribute(name);
+  return attr->getTypedValue();
+}
+
 void Object::writeAttrValue(const std::string &name,
                             const std::string &value) {
   LOG(INFO) << "Writing the value of Attribute \"" << name << "\"";
@@ -48,6 +55,13 @@ void Object::writeAttrValue(const std::string &name,
   attr->setValue(value);
 }
 
+void Object::writeAttrTypedValue(const std::string &name,
+                                 const AttrValue   &value) {
+  LOG(INFO) << "Writing the typed value of Attribute \"" << name << "\"";
+  Attribute* attr = getWritableAttribute(name);
+  attr->setTypedValue(value);
+}
+
 Attribute* Object::addAttribute(const std::string &name) {
   LOG(INFO) << "Adding Attribute \"" << name << "\" to object \"" << name_
     << "\"";
@@ -113,40 +127,80 @@ std::string Object::getObjectPath() const {
 
 nlohmann::json Object::dumpToJson() const {
   LOG(INFO) << "Dump object with name " << name_ << " into json";
-  nlohmann::json dump = Object::dump();
-  for (auto cit = childMap_.begin(); cit != childMap_.end(); cit++) {
-    dump["childObjectNames"].push_back(cit->first);
-  }
-  dump["childObjectCount"] = getChildCount();
-  return dump;
+  std::stringstream ss;
+  dumpToStream(ss, 0);
+  return nlohmann::json::parse(ss);
 }
 
 nlohmann::json Object::dumpToJsonRecursive() const {
   LOG(INFO) << "Dump object with name " << name_ << " into json";
-  nlohmann::json dump = Object::dump();
-  for (auto cit = childMap_.begin(); cit != childMap_.end(); cit++) {
-    dump["childObjects"].push_back(cit->second->dumpToJsonRecursive());
+  std::stringstream ss;
+  dumpToStream(ss, -1);
+  return nlohmann::json::parse(ss);
+}
+
+void Object::dumpToStream(std::ostream &os, int depth) const {
+  os << '{';
+  dumpInfoToStream(os);
+  if (!childMap_.empty()) {
+    bool first = true;
+    if (depth == 0) {
+      os << ",\"childObjectNames\":[";
+      for (auto &it : childMap_) {
+        os << (first ? "" : ",") << nlohmann::json(it.first).dump();
+        first = false;
+      }
+    } else {
+      os << ",\"childObjects\":[";
+      for (auto &it : childMap_) {
+        os << (first ? "" : ",");
+        it.second->dumpToStream(os, depth - 1);
+        first = false;
+      }
+    }
+    os << ']';
   }
-  dump["childObjectCount"] = getChildCount();
-  return dump;
+  os << ",\"childObjectCount\":" << getChildCount() << '}';
 }
 
-nlohmann::json Object::dump() const {
-  nlohmann::json dump;
-  dump["objectName"] = name_;
-  dump["objectType"] = "Generic";
+void Object::dumpInfoToStream(std::ostream &os) const {
+  // The entries of the object itself are few, only the attributes and
+  // children are written one by one
+  nlohmann::json info;
+  info["objectName"] = name_;
+  info["objectType"] = "Generic";
   if (parent_ == nullptr) {
-    dump["parentName"] = nullptr;
+    info["parentName"] = nullptr;
   } else {
-    dump["parentName"] = parent_->getName();
+    info["parentName"] = parent_->getName();
+  }
+  addDumpInfo(info);
+
+  bool first = true;
+  for (auto it = info.begin(); it != info.end(); it++) {
+    os << (first ? "" : ",") << nlohmann::json(it.key()).dump() << ':'
+       << it.value().dump();
+    first = false;
   }
 
-  for (auto &it : attrMap_) {
-    Attribute* attr = it.second.get();
-    dump["attributes"].push_back(attr->dumpToJson());
+  if (!attrMap_.empty()) {
+    os << ",\"attributes\":[";
+    first = true;
+    for (auto &it : attrMap_) {
+      os << (first ? "" : ",") << it.second->dumpToJson().dump();
+      first = false;
+    }
+    os << ']';
   }
-  dump["attrCount"] = getAttrCount();
-  return dump;
+  os << ",\"attrCount\":" << getAttrCount();
+}
+
+nlohmann::json Object::dump() const {
+  std::stringstream ss;
+  ss << '{';
+  dumpInfoToStream(ss);
+  ss << '}';
+  return nlohmann::json::parse(ss);
 }
 
 } // namespace qin
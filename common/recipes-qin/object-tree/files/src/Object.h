@@ -18,6 +18,7 @@
 
 #pragma once
 #include <string>
+#include <ostream>
 #include <system_error>
 #include <memory>
 #include <nlohmann/json.hpp>
@@ -125,6 +126,17 @@ class Object {
      */
     virtual const std::string& readAttrValue(const std::string &name) const;
 
+    /**
+     * Read attribute value of the given name as typed, without making
+     * the text of it.
+     *
+     * @param name of the attribute to be read
+     * @return value of the attribute
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no read modes
+     */
+    virtual const AttrValue& readAttrTypedValue(const std::string &name) const;
+
     /**
      * Write attribute value of the given name. It is a write function
      * instead of set just to match the modes in Attribute.
@@ -137,6 +149,17 @@ class Object {
     virtual void writeAttrValue(const std::string &name,
                                 const std::string &value);
 
+    /**
+     * Write typed attribute value of the given name.
+     *
+     * @param name of the attribute to be written
+     * @param value to be written to attribute
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no write modes
+     */
+    virtual void writeAttrTypedValue(const std::string &name,
+                                     const AttrValue   &value);
+
     /**
      * Add attribute to the object.
      *
@@ -214,6 +237,17 @@ class Object {
      */
     virtual nlohmann::json dumpToJsonRecursive() const;
 
+    /**
+     * Write the object info into the stream as json, entry by entry, without
+     * building the json of the subtree first. dumpToJson() and
+     * dumpToJsonRecursive() are the depth 0 and depth -1 cases.
+     *
+     * @param os stream to write the json text to
+     * @param depth levels of child objects dumped in full; deeper ones only
+     *        have their names in childObjectNames. Negative for no limit.
+     */
+    virtual void dumpToStream(std::ostream &os, int depth = -1) const;
+
     /**
      * Get object path from root.
      *
@@ -282,8 +316,24 @@ class Object {
     }
 
     /**
-     * Dump the object info into json format. This is a helper function for
-     * dumpToJson() and dumpToJsonIterative(). All the info is dumpped
+     * Add the entries of the derived classes to the object info, e.g.
+     * change the objectType. Called on the few entries of the object
+     * itself, never on the attributes or child objects.
+     *
+     * @param dump to be added with the object entries
+     */
+    virtual void addDumpInfo(nlohmann::json &dump) const {}
+
+    /**
+     * Write the entries of dump() into the stream, without the enclosing
+     * braces.
+     *
+     * @param os stream to write the json text to
+     */
+    void dumpInfoToStream(std::ostream &os) const;
+
+    /**
+     * Dump the object info into json format. All the info is dumpped
      * except the info regarding the child objects.
      *
      * @return nlohmann json object with the following entries.
@@ -27,6 +27,8 @@
 namespace openbmc {
 namespace qin {
 
+const ObjectTree::PathId ObjectTree::kNoPath;
+
 ObjectTree::ObjectTree(const std::shared_ptr<Ipc> &ipc,
                        const std::string          &rootName) {
   if (ipc == nullptr) {
@@ -86,10 +88,33 @@ void ObjectTree::deleteObjectByPath(const std::string &path) {
     LOG(ERROR) << "Failed to delete the object at \"" << path << "\"";
     throw std::invalid_argument("Error deleting object");
   }
+  PathId id = getPathId(path);
+  objectsById_[id] = nullptr;
+  objectPaths_.erase(it->second.get());
   objectMap_.erase(it);
   ipc_.get()->unregisterObject(path);
 }
 
+const std::string& ObjectTree::getObjectPath(const Object* object) const {
+  std::unordered_map<const Object*, PathId>::const_iterator it;
+  if ((it = objectPaths_.find(object)) == objectPaths_.end()) {
+    LOG(ERROR) << "Object is not in the tree";
+    throw std::invalid_argument("Object not found");
+  }
+  return *paths_[it->second];
+}
+
+ObjectTree::PathId ObjectTree::internPath(const std::string &path) {
+  std::pair<std::unordered_map<std::string, PathId>::iterator, bool> ins =
+      pathIds_.insert(std::make_pair(path, PathId(paths_.size())));
+  if (ins.second) {
+    // keys of an unordered_map stay put on rehash
+    paths_.push_back(&ins.first->first);
+    objectsById_.push_back(nullptr);
+  }
+  return ins.first->second;
+}
+
 Object* ObjectTree::getParent(const std::string &parentPath,
                               const std::string &name) const {
   Object* parent = getObject(parentPath);
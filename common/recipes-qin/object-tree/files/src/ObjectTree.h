@@ -17,8 +17,10 @@
  */
 
 #pragma once
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <ipc-interface/Ipc.h>
 #include "Object.h"
@@ -38,12 +40,21 @@ namespace qin {
 class ObjectTree {
   public:
     typedef std::unordered_map<std::string, std::unique_ptr<Object>> ObjectMap;
+    // Interned object path; ids are not reused, a path added again gets
+    // its old id back
+    typedef uint32_t PathId;
+    static const PathId kNoPath = UINT32_MAX;
 
   protected:
     std::shared_ptr<Ipc>  ipc_;        // pointer to the ipc interface
     Object*               root_;       // pointer to the root object
     ObjectMap             objectMap_;  // path to *object map of all objects
 
+    std::unordered_map<std::string, PathId>   pathIds_;     // interned paths
+    std::vector<const std::string*>           paths_;       // id to path
+    std::vector<Object*>                      objectsById_; // id to object
+    std::unordered_map<const Object*, PathId> objectPaths_; // object to id
+
   public:
     /**
      * Constructor. Root object will be added.
@@ -99,6 +110,39 @@ class ObjectTree {
       return getObject(path) != nullptr;
     }
 
+    /**
+     * Get the interned id of path.
+     *
+     * @param path of the object
+     * @return kNoPath if no object was ever added at path; id otherwise
+     */
+    PathId getPathId(const std::string &path) const {
+      std::unordered_map<std::string, PathId>::const_iterator it;
+      if ((it = pathIds_.find(path)) == pathIds_.end()) {
+        return kNoPath;
+      }
+      return it->second;
+    }
+
+    /**
+     * Get the object by the id of its path.
+     *
+     * @param id from getPathId()
+     * @return nullptr if not found; Object* otherwise
+     */
+    Object* getObject(PathId id) const {
+      return id < objectsById_.size() ? objectsById_[id] : nullptr;
+    }
+
+    /**
+     * Get the path of an object of the tree, as cached when added.
+     *
+     * @param object in the tree
+     * @throw std::invalid_argument if object is not in the tree
+     * @return path of the object
+     */
+    const std::string& getObjectPath(const Object* object) const;
+
     /**
      * Add an object to the objectMap_ with parent path specified.
      *
@@ -199,10 +243,21 @@ class ObjectTree {
                             const std::string       &path) {
       Object* object = upObj.get();
       objectMap_.insert(std::make_pair(path, std::move(upObj)));
+      PathId id = internPath(path);
+      objectsById_[id] = object;
+      objectPaths_[object] = id;
       ipc_->registerObject(path, object);
       return object;
     }
 
+    /**
+     * Get the id of path, interning it if new.
+     *
+     * @param path to be interned
+     * @return id of path
+     */
+    PathId internPath(const std::string &path);
+
     /**
      * Get a new path from parentPath and specified name through ipc_.
      *
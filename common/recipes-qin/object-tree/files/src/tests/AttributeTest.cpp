@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <string>
+#include <stdexcept>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include "../Attribute.h"
@@ -57,6 +58,46 @@ TEST_F(AttributeTest, SetValue) {
   EXPECT_STREQ(a_->getValue().c_str(), "1991");
 }
 
+TEST_F(AttributeTest, TypedValue) {
+  a_->setInt(-42);
+  EXPECT_EQ(a_->getTypedValue().getType(), AttrValue::INT);
+  EXPECT_EQ(a_->getTypedValue().getInt(), -42);
+  EXPECT_STREQ(a_->getValue().c_str(), "-42");
+
+  a_->setDouble(0.1);
+  EXPECT_EQ(a_->getTypedValue().getType(), AttrValue::DOUBLE);
+  EXPECT_DOUBLE_EQ(a_->getTypedValue().getDouble(), 0.1);
+  EXPECT_STREQ(a_->getValue().c_str(), "0.1");
+
+  a_->setBool(true);
+  EXPECT_TRUE(a_->getTypedValue().getBool());
+  EXPECT_STREQ(a_->getValue().c_str(), "1");
+
+  // strings convert when asked to
+  a_->setValue("1991");
+  EXPECT_EQ(a_->getTypedValue().getType(), AttrValue::STRING);
+  EXPECT_EQ(a_->getTypedValue().getInt(), 1991);
+  EXPECT_DOUBLE_EQ(a_->getTypedValue().getDouble(), 1991.0);
+  a_->setValue("false");
+  EXPECT_FALSE(a_->getTypedValue().getBool());
+  a_->setValue("12 C");
+  EXPECT_THROW(a_->getTypedValue().getInt(), std::invalid_argument);
+}
+
+TEST(AttrValueTest, FromText) {
+  EXPECT_EQ(AttrValue::fromText("35000").getType(), AttrValue::INT);
+  EXPECT_EQ(AttrValue::fromText("35000").getInt(), 35000);
+  EXPECT_EQ(AttrValue::fromText("-5").getInt(), -5);
+  EXPECT_EQ(AttrValue::fromText("0").getType(), AttrValue::INT);
+  // kept as written, which an INT would not be
+  for (const char *text : {"", "-", "-0", "007", "+5", "1.5", "0x10", "5\n",
+                           "1234567890123456789"}) {
+    AttrValue value = AttrValue::fromText(text);
+    EXPECT_EQ(value.getType(), AttrValue::STRING) << text;
+    EXPECT_STREQ(value.str().c_str(), text);
+  }
+}
+
 TEST_F(AttributeTest, SetModes) {
   EXPECT_EQ(a_->getModes(), Attribute::RO);
 
@@ -17,6 +17,7 @@
  */
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <stdexcept>
 #include <system_error>
@@ -159,6 +160,32 @@ TEST_F(ObjectTest, DumpToJson) {
   std::cout << obj_->dumpToJsonRecursive().dump(2) << std::endl;
 }
 
+TEST_F(ObjectTest, DumpToStream) {
+  Object child1("child1", obj_);
+  Object child2("child2", obj_);
+  Object grandChild("grandChild", &child1);
+  obj_->addAttribute("temp1_input");
+  child1.addAttribute("fan1_input");
+
+  std::stringstream ss;
+  obj_->dumpToStream(ss, 1);
+  nlohmann::json objectInfo = nlohmann::json::parse(ss);
+
+  EXPECT_EQ(objectInfo.at("childObjectCount"), 2);
+  EXPECT_EQ(objectInfo.at("attributes").size(), 1);
+  EXPECT_EQ(objectInfo.count("childObjectNames"), 0);
+  for (auto &child : objectInfo.at("childObjects")) {
+    // The depth left stops at the children, only names below them
+    EXPECT_EQ(child.count("childObjects"), 0);
+    EXPECT_EQ(child.at("parentName"), "root");
+  }
+  EXPECT_EQ(obj_->dumpToJsonRecursive().at("childObjects").size(), 2);
+
+  std::stringstream full;
+  obj_->dumpToStream(full);
+  EXPECT_EQ(nlohmann::json::parse(full), obj_->dumpToJsonRecursive());
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
@@ -145,6 +145,28 @@ TEST_F(ObjectTreeTest, AddObjectByUniquePtr) {
   EXPECT_ANY_THROW(objTree_->addObject(std::move(uObj), "/org"));
 }
 
+TEST_F(ObjectTreeTest, PathId) {
+  EXPECT_EQ(objTree_->getPathId("/org/openbmc"), ObjectTree::kNoPath);
+  EXPECT_TRUE(objTree_->getObject(ObjectTree::kNoPath) == nullptr);
+
+  Object* obj = objTree_->addObject("openbmc", "/org");
+  ObjectTree::PathId id = objTree_->getPathId("/org/openbmc");
+  ASSERT_NE(id, ObjectTree::kNoPath);
+  EXPECT_NE(id, objTree_->getPathId("/org"));
+  EXPECT_TRUE(objTree_->getObject(id) == obj);
+  EXPECT_STREQ(objTree_->getObjectPath(obj).c_str(), "/org/openbmc");
+  EXPECT_STREQ(objTree_->getObjectPath(objTree_->getRoot()).c_str(), "/org");
+
+  objTree_->deleteObjectByPath("/org/openbmc");
+  EXPECT_TRUE(objTree_->getObject(id) == nullptr);
+  EXPECT_THROW(objTree_->getObjectPath(obj), std::invalid_argument);
+
+  // the interned path keeps its id
+  obj = objTree_->addObject("openbmc", "/org");
+  EXPECT_EQ(objTree_->getPathId("/org/openbmc"), id);
+  EXPECT_TRUE(objTree_->getObject(id) == obj);
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
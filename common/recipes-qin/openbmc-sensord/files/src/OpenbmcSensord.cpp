@@ -28,6 +28,7 @@
 #include <dbus-utils/dbus-interface/DBusObjectInterface.h>
 #include "SensorObjectTree.h"
 #include "SensorJsonParser.h"
+#include "SensorAlarmWatcher.h"
 using namespace openbmc::qin;
 
 // validator for the json filename
@@ -48,6 +49,16 @@ DEFINE_string(json, "",
 static const bool regDummy =
   ::gflags::RegisterFlagValidator(&FLAGS_json, &validateFilename);
 
+// sensor tree served by dbus subtrees instead of an object per sensor
+DEFINE_bool(dbus_subtree, true,
+            "Serve the sensor tree under \"/org\" with DBus subtrees and "
+            "ObjectManager instead of registering every object");
+
+// hwmon alarms signaled as they go off instead of on the next read
+DEFINE_bool(watch_alarms, true,
+            "Watch the *_alarm attributes of the sysfs sensors and emit the "
+            "\"alarm\" signal on their objects when they change");
+
 // implementation for handling DBus request messages
 static DBusObjectInterface objectInterface;
 
@@ -71,6 +82,10 @@ int main (int argc, char* argv[]) {
   GMainLoop *loop;
   std::thread t;
 
+  if (FLAGS_dbus_subtree) {
+    dbus.registerSubtree("/org");
+  }
+
   LOG(INFO) << "Connecting the sensord to the system DBus daemon";
   dbus.registerConnection();
 
@@ -86,6 +101,12 @@ int main (int argc, char* argv[]) {
   LOG(INFO) << "Parsing \"" << FLAGS_json << "\" into the sensor tree";
   SensorJsonParser::parse(FLAGS_json, sensorTree, "/org/openbmc");
 
+  SensorAlarmWatcher alarmWatcher(sDbus, objectInterface.getName());
+  if (FLAGS_watch_alarms) {
+    LOG(INFO) << "Watching the sensor alarms";
+    alarmWatcher.watch(sensorTree);
+  }
+
   LOG(INFO) << "Main thread joining the event loop thread";
   t.join();
 
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <system_error>
+#include <glib-unix.h>
+#include <glog/logging.h>
+#include "SensorAlarmWatcher.h"
+#include "SensorSysfsApi.h"
+
+namespace openbmc {
+namespace qin {
+
+static const std::string kAlarmSuffix = "_alarm";
+
+static bool isAlarm(const SensorAttribute &attr) {
+  const std::string &addr = attr.getAddr();
+  return attr.isReadable() && addr.size() > kAlarmSuffix.size() &&
+         addr.compare(addr.size() - kAlarmSuffix.size(), kAlarmSuffix.size(),
+                      kAlarmSuffix) == 0;
+}
+
+// Reads the first line of the alarm file, which also rearms its poll
+static bool readAlarm(int fd, std::string &value) {
+  char buf[64];
+  ssize_t len = pread(fd, buf, sizeof(buf), 0);
+  if (len < 0) {
+    return false;
+  }
+  const char *nl = static_cast<const char*>(memchr(buf, '\n', len));
+  value.assign(buf, nl ? nl - buf : len);
+  return true;
+}
+
+SensorAlarmWatcher::~SensorAlarmWatcher() {
+  for (auto &alarm : alarms_) {
+    if (alarm->sourceId != 0) {
+      g_source_remove(alarm->sourceId);
+    }
+    close(alarm->fd);
+  }
+}
+
+size_t SensorAlarmWatcher::watch(const SensorObjectTree &tree) {
+  std::vector<Object*> objects{tree.getRoot()};
+  while (!objects.empty()) {
+    Object* object = objects.back();
+    objects.pop_back();
+    SensorDevice* device = dynamic_cast<SensorDevice*>(object);
+    if (device != nullptr) {
+      watchDevice(*device);
+      continue;
+    }
+    for (auto &it : object->getChildMap()) {
+      objects.push_back(it.second);
+    }
+  }
+  LOG(INFO) << "Watching " << alarms_.size() << " sensor alarms";
+  return alarms_.size();
+}
+
+void SensorAlarmWatcher::watchDevice(SensorDevice &device) {
+  const SensorSysfsApi* api =
+      dynamic_cast<const SensorSysfsApi*>(device.getSensorApi());
+  if (api == nullptr) {
+    return;
+  }
+  for (auto &it : device.getChildMap()) {
+    SensorObject* object = dynamic_cast<SensorObject*>(it.second);
+    if (object == nullptr) {
+      continue;
+    }
+    for (auto &attrIt : object->getAttrMap()) {
+      SensorAttribute* attr = static_cast<SensorAttribute*>(attrIt.second.get());
+      if (!isAlarm(*attr)) {
+        continue;
+      }
+      std::string path = api->getFsPath() + "/" + attr->getAddr();
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      std::string value;
+      if (fd < 0 || !readAlarm(fd, value)) {
+        LOG(WARNING) << "Alarm " << path << " cannot be watched: "
+          << strerror(errno);
+        if (fd >= 0) {
+          close(fd);
+        }
+        continue;
+      }
+      attr->setTypedValue(AttrValue::fromText(value));
+
+      std::unique_ptr<Alarm> alarm(new Alarm{this, &device, object, attr,
+          object->getObjectPath(), fd, 0});
+      alarm->sourceId = g_unix_fd_add(fd,
+          static_cast<GIOCondition>(G_IO_PRI | G_IO_ERR), onAlarm,
+          alarm.get());
+      LOG(INFO) << "Watching alarm " << path << " of " << alarm->path;
+      alarms_.push_back(std::move(alarm));
+    }
+  }
+}
+
+bool SensorAlarmWatcher::handleAlarm(Alarm &alarm) {
+  std::string value;
+  if (!readAlarm(alarm.fd, value)) {
+    LOG(ERROR) << "Alarm " << alarm.attr->getAddr() << " of " << alarm.path
+      << " cannot be read: " << strerror(errno);
+    return false;
+  }
+  LOG(INFO) << "Alarm " << alarm.attr->getName() << " of " << alarm.path
+    << " is " << value;
+  alarm.attr->setTypedValue(AttrValue::fromText(value));
+
+  // The excursion may be gone by the next read: read the sensor now
+  std::vector<SensorAttribute*> attrs;
+  for (auto &it : alarm.object->getAttrMap()) {
+    SensorAttribute* attr = static_cast<SensorAttribute*>(it.second.get());
+    if (attr != alarm.attr && attr->isReadable() && attr->isAccessible()) {
+      attrs.push_back(attr);
+    }
+  }
+  try {
+    if (!attrs.empty()) {
+      alarm.device->getSensorApi()->readValues(*alarm.object, attrs);
+    }
+  } catch (const std::system_error &e) {
+    LOG(ERROR) << "Sensor " << alarm.path << " cannot be read: " << e.what();
+  }
+
+  GDBusConnection* connection = dbus_->getConnection();
+  if (connection == nullptr) {
+    return true;
+  }
+  GError* error = nullptr;
+  if (!g_dbus_connection_emit_signal(connection, nullptr,
+          alarm.path.c_str(), interface_.c_str(), "alarm",
+          g_variant_new("(ss)", alarm.attr->getName().c_str(), value.c_str()),
+          &error)) {
+    LOG(ERROR) << "Alarm signal of " << alarm.path << " cannot be emitted: "
+      << error->message;
+    g_error_free(error);
+  }
+  return true;
+}
+
+gboolean SensorAlarmWatcher::onAlarm(gint         fd,
+                                     GIOCondition condition,
+                                     gpointer     arg) {
+  Alarm* alarm = static_cast<Alarm*>(arg);
+  if (!alarm->watcher->handleAlarm(*alarm)) {
+    alarm->sourceId = 0;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+} // namespace qin
+} // namespace openbmc
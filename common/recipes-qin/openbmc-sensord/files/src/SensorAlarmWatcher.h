@@ -0,0 +1,112 @@
+/*
+ * Copyright 2014-present Facebook. All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+
+#pragma once
+#include <string>
+#include <memory>
+#include <vector>
+#include <glib.h>
+#include <dbus-utils/DBus.h>
+#include <object-tree/Object.h>
+#include "SensorObjectTree.h"
+#include "SensorDevice.h"
+#include "SensorObject.h"
+#include "SensorAttribute.h"
+
+namespace openbmc {
+namespace qin {
+
+/**
+ * Watcher of the hwmon alarm attributes (addr ending with "_alarm", e.g.
+ * curr1_crit_alarm) of the SensorObjects read through sysfs. The drivers
+ * sysfs_notify() them when they change: the sensor is then read at once,
+ * and the "alarm" signal is emitted on its DBus object, without waiting
+ * for the next read of a client.
+ *
+ * The alarm files are polled for POLLPRI from the default GLib main
+ * context, the one dispatching the DBus requests which read the same
+ * attributes.
+ */
+class SensorAlarmWatcher {
+  private:
+    struct Alarm {
+      SensorAlarmWatcher *watcher;
+      SensorDevice       *device;
+      SensorObject       *object;
+      SensorAttribute    *attr;
+      std::string        path;      // DBus object path of object
+      int                fd;
+      guint              sourceId;
+    };
+
+    std::shared_ptr<DBus>               dbus_;
+    std::string                         interface_;
+    std::vector<std::unique_ptr<Alarm>> alarms_;
+
+    /**
+     * Adds the alarm attributes of the SensorObjects of device.
+     */
+    void watchDevice(SensorDevice &device);
+
+    /**
+     * Reads the alarm and the other attributes of its sensor, and emits
+     * the alarm signal.
+     *
+     * @return false if the alarm cannot be read anymore
+     */
+    bool handleAlarm(Alarm &alarm);
+
+    /**
+     * GLib callback of the alarm fds; the Alarm is passed in arg.
+     */
+    static gboolean onAlarm(gint fd, GIOCondition condition, gpointer arg);
+
+  public:
+    /**
+     * Constructor
+     *
+     * @param dbus to emit the alarm signals on
+     * @param interface of the signals, the one of the sensor objects
+     */
+    SensorAlarmWatcher(const std::shared_ptr<DBus> &dbus,
+                       const std::string           &interface)
+        : dbus_(dbus), interface_(interface) {}
+
+    SensorAlarmWatcher(const SensorAlarmWatcher &) = delete;
+    SensorAlarmWatcher& operator=(const SensorAlarmWatcher &) = delete;
+
+    ~SensorAlarmWatcher();
+
+    /**
+     * Starts watching the alarm attributes of the sensor objects of all
+     * the sysfs SensorDevices of tree. Attributes whose file cannot be
+     * opened are skipped.
+     *
+     * @param tree of the sensor devices
+     * @return number of the alarms watched
+     */
+    size_t watch(const SensorObjectTree &tree);
+
+    size_t getAlarmCount() const {
+      return alarms_.size();
+    }
+};
+
+} // namespace qin
+} // namespace openbmc
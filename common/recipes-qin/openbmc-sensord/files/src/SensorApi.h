@@ -18,6 +18,7 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <object-tree/Object.h>
 #include "SensorAttribute.h"
@@ -32,6 +33,8 @@ namespace qin {
  */
 class SensorApi {
   public:
+    virtual ~SensorApi() {}
+
     /**
      * Reads value from the path specified by object and attr.
      * It's dummy here. The derived class should implement this function.
@@ -43,6 +46,22 @@ class SensorApi {
     virtual const std::string readValue(const Object          &object,
                                         const SensorAttribute &attr) const = 0;
 
+    /**
+     * Reads the values of attrs, all of object, and sets them in the
+     * attributes. Reads them one by one through readValue() here; the
+     * derived class may read them in one pass.
+     *
+     * @param object of the attributes to be read
+     * @param attrs to be read
+     */
+    virtual void readValues(const Object                        &object,
+                            const std::vector<SensorAttribute*> &attrs)
+        const {
+      for (auto attr : attrs) {
+        attr->setTypedValue(AttrValue::fromText(readValue(object, *attr)));
+      }
+    }
+
     /**
      * Writes value to the path specified by object and attr.
      * It's dummy here. The derived class should implement this function.
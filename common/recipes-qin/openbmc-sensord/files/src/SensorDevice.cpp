@@ -17,10 +17,12 @@
  */
 
 #include <string>
+#include <vector>
 #include <system_error>
 #include <glog/logging.h>
 #include <object-tree/Attribute.h>
 #include "SensorDevice.h"
+#include "SensorObject.h"
 #include "SensorApi.h"
 #include "SensorAttribute.h"
 
@@ -46,10 +48,20 @@ const std::string& SensorDevice::readAttrValue(const Object    &object,
     << attr.getName() << "\" value of Object \"" << object.getName() << "\"";
   DCHECK(attr.isReadable()) << "SensorAttribute \"" << attr.getName()
     << "\" is not readable";
-  attr.setValue(sensorApi_.get()->readValue(object, attr));
+  attr.setTypedValue(
+      AttrValue::fromText(sensorApi_.get()->readValue(object, attr)));
   return attr.getValue();
 }
 
+const AttrValue& SensorDevice::readAttrTypedValue(
+                                   const std::string &name) const {
+  LOG(INFO) << "Reading the typed value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getReadableAttribute(name));
+  readAttrValue(*this, *attr);
+  return attr->getTypedValue();
+}
+
 const std::string& SensorDevice::readAttrValue(
                                    const std::string &name) const {
   LOG(INFO) << "Reading the value of Attribute \"" << name << "\"";
@@ -58,6 +70,29 @@ const std::string& SensorDevice::readAttrValue(
   return readAttrValue(*this, *attr);
 }
 
+void SensorDevice::readAttrValues() {
+  LOG(INFO) << "SensorDevice \"" << name_ << "\" reading all Attributes";
+  std::vector<const Object*> objects{this};
+  for (auto &it : childMap_) {
+    if (dynamic_cast<const SensorObject*>(it.second) != nullptr) {
+      objects.push_back(it.second);
+    }
+  }
+  std::vector<SensorAttribute*> attrs;
+  for (auto object : objects) {
+    attrs.clear();
+    for (auto &it : object->getAttrMap()) {
+      SensorAttribute* attr = static_cast<SensorAttribute*>(it.second.get());
+      if (attr->isReadable() && attr->isAccessible()) {
+        attrs.push_back(attr);
+      }
+    }
+    if (!attrs.empty()) {
+      sensorApi_.get()->readValues(*object, attrs);
+    }
+  }
+}
+
 void SensorDevice::writeAttrValue(const Object      &object,
                                   SensorAttribute   &attr,
                                   const std::string &value) {
@@ -80,6 +115,27 @@ void SensorDevice::writeAttrValue(const std::string &name,
   writeAttrValue(*this, *attr, value);
 }
 
+void SensorDevice::writeAttrTypedValue(const Object      &object,
+                                       SensorAttribute   &attr,
+                                       const AttrValue   &value) {
+  LOG(INFO) << "SensorDevice \"" << name_ << "\" writing Attribute " << "\""
+    << attr.getName() << "\" typed value \"" << value.str()
+    << "\" of Object \"" << object.getName() << "\"";
+  DCHECK(attr.isWritable()) << "SensorAttribute \"" << attr.getName()
+    << "\" is not writable";
+  if (attr.isAccessible()) {
+    sensorApi_.get()->writeValue(object, attr, value.str());
+  }
+  attr.setTypedValue(value);
+}
+
+void SensorDevice::writeAttrTypedValue(const std::string &name,
+                                       const AttrValue   &value) {
+  LOG(INFO) << "Writing the typed value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getWritableAttribute(name));
+  writeAttrTypedValue(*this, *attr, value);
+}
 
 } // namepsace openbmc
 } // namespace qin
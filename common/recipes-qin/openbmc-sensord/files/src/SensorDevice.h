@@ -98,6 +98,27 @@ class SensorDevice : public Object {
      */
     const std::string& readAttrValue(const std::string &name) const override;
 
+    /**
+     * Read the typed value of Attribute name through sensorApi_. Integer
+     * values read are kept as INT next to their text.
+     *
+     * @param name of the attribute to be read
+     * @return value of the attribute
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no read modes
+     */
+    const AttrValue& readAttrTypedValue(const std::string &name)
+        const override;
+
+    /**
+     * Read the values of all readable and accessible SensorAttributes of
+     * the device and of its SensorObjects, in one batch through
+     * sensorApi_ per object.
+     *
+     * @throw std::system_error if an attribute cannot be read
+     */
+    void readAttrValues();
+
     /**
      * Write the value of specified SensorAttribute through sensorApi_.
      * It is assumed that the attr can be accessed through sensorApi_.
@@ -123,34 +144,29 @@ class SensorDevice : public Object {
                         const std::string &value) override;
 
     /**
-     * Dump the sensor object info into json format. It calls the
-     * Object::dumpToJson() but adds the access method and changes
-     * the objectType to "SensorApi".
+     * Write the typed value of specified SensorAttribute through
+     * sensorApi_, as its text.
      *
-     * @return nlohmann::json object with entries specified in
-     *         Object::dumpToJson() plus the "access" entry for SensorApi.
+     * @param the object to be associated with the writing
+     * @param attribute to be written
+     * @param value to be written to attribute through sensorApi_
+     * @throw std::system_error EPERM if attr has no write modes
      */
-    nlohmann::json dumpToJson() const override {
-      LOG(INFO) << "Dumping SensorDevice into json";
-      nlohmann::json dump = Object::dumpToJson();
-      addDumpInfo(dump);
-      return dump;
-    }
+    void writeAttrTypedValue(const Object      &object,
+                             SensorAttribute   &attr,
+                             const AttrValue   &value);
 
     /**
-     * Dump the sensor object info iteratively into json format. It calls the
-     * Object::dumpToJsonIterative() but adds the access method and changes
-     * the objectType to "SensorApi".
+     * Write the typed value of Attribute with specified name through
+     * sensorApi_.
      *
-     * @return nlohmann::json object with entries specified in
-     *         Object::dumpToJson() plus the "access" entry for SensorApi.
+     * @param name of attribute to be written
+     * @param value to be written to attribute through sensorApi_
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no write modes
      */
-    nlohmann::json dumpToJsonRecursive() const override {
-      LOG(INFO) << "Dumping SensorDevice recursively into json";
-      nlohmann::json dump = Object::dumpToJsonRecursive();
-      addDumpInfo(dump);
-      return dump;
-    }
+    void writeAttrTypedValue(const std::string &name,
+                             const AttrValue   &value) override;
 
   protected:
 
@@ -159,7 +175,7 @@ class SensorDevice : public Object {
      *
      * @param dump to be added with type and access entries
      */
-    void addDumpInfo(nlohmann::json &dump) const {
+    void addDumpInfo(nlohmann::json &dump) const override {
       dump["objectType"] = "SensorDevice";
       dump["access"] = sensorApi_.get()->dumpToJson();
     }
@@ -47,6 +47,15 @@ const std::string& SensorObject::readAttrValue(const std::string &name)
   return static_cast<SensorDevice*>(parent_)->readAttrValue(*this, *attr);
 }
 
+const AttrValue& SensorObject::readAttrTypedValue(const std::string &name)
+    const {
+  LOG(INFO) << "Reading the typed value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getReadableAttribute(name));
+  static_cast<SensorDevice*>(parent_)->readAttrValue(*this, *attr);
+  return attr->getTypedValue();
+}
+
 void SensorObject::writeAttrValue(const std::string &name,
                                   const std::string &value) {
   LOG(INFO) << "Writing the value of Attribute \"" << name << "\"";
@@ -55,5 +64,13 @@ void SensorObject::writeAttrValue(const std::string &name,
   static_cast<SensorDevice*>(parent_)->writeAttrValue(*this, *attr, value);
 }
 
+void SensorObject::writeAttrTypedValue(const std::string &name,
+                                       const AttrValue   &value) {
+  LOG(INFO) << "Writing the typed value of Attribute \"" << name << "\"";
+  SensorAttribute* attr =
+      static_cast<SensorAttribute*>(getWritableAttribute(name));
+  static_cast<SensorDevice*>(parent_)->writeAttrTypedValue(*this, *attr, value);
+}
+
 } // namespace qin
 } // namepsace openbmc
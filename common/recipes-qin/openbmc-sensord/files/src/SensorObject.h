@@ -64,6 +64,18 @@ class SensorObject : public Object {
     virtual const std::string& readAttrValue(const std::string &name)
         const override;
 
+    /**
+     * Read the typed value of Attribute name through sensorApi_.
+     * Will call the readAttrValue function from SensorDevice.
+     *
+     * @param name of the attribute to be read
+     * @return value of the attribute
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no read modes
+     */
+    virtual const AttrValue& readAttrTypedValue(const std::string &name)
+        const override;
+
     /**
      * Write the value of Attribute name with type through sensorApi_.
      * Will call the writeAttrValue function from SensorDevice.
@@ -77,43 +89,26 @@ class SensorObject : public Object {
                                 const std::string &value) override;
 
     /**
-     * Dump the sensor object info into json format. It calls the
-     * Object::dumpToJson() but adds the access method and changes
-     * the objectType to "SensorApi".
+     * Write the typed value of Attribute name through sensorApi_.
+     * Will call the writeAttrTypedValue function from SensorDevice.
      *
-     * @return nlohmann::json object with entries specified in
-     *         Object::dumpToJson() plus the "access" entry for SensorApi.
-     */
-    virtual nlohmann::json dumpToJson() const override {
-      LOG(INFO) << "Dumping SensorObject into json";
-      nlohmann::json dump = Object::dumpToJson();
-      addDumpInfo(dump);
-      return dump;
-    }
-
-    /**
-     * Dump the sensor object info iteratively into json format. It calls the
-     * Object::dumpToJsonIterative() but adds the access method and changes
-     * the objectType to "SensorApi".
-     *
-     * @return nlohmann::json object with entries specified in
-     *         Object::dumpToJson() plus the "access" entry for SensorApi.
+     * @param name of attribute to be written
+     * @param value to be written to attribute through sensorApi_
+     * @throw std::invalid_argument if name not found
+     * @throw std::system_error EPERM if attr has no write modes
      */
-    virtual nlohmann::json dumpToJsonRecursive() const override {
-      LOG(INFO) << "Dumping SensorObject recursively into json";
-      nlohmann::json dump = Object::dumpToJsonRecursive();
-      addDumpInfo(dump);
-      return dump;
-    }
+    virtual void writeAttrTypedValue(const std::string &name,
+                                     const AttrValue   &value) override;
 
   protected:
 
     /**
-     * A helper function to add the object type entry to dump.
+     * A helper function to add the object type entry to dump. Object calls
+     * it on every dump of the object, recursive or not.
      *
      * @param dump to be added with type enty
      */
-    virtual void addDumpInfo(nlohmann::json &dump) const {
+    virtual void addDumpInfo(nlohmann::json &dump) const override {
       dump["objectType"] = "SensorObject";
     }
 };
@@ -28,13 +28,13 @@ namespace qin {
 
 Object* SensorObjectTree::addObject(std::unique_ptr<Object> upObj,
                                     const std::string       &parentPath) {
-  bool isSensorObject = false;
-  try {
-    getSensorObject(upObj.get());
-    isSensorObject = true;
+  SensorObject* sObject = dynamic_cast<SensorObject*>(upObj.get());
+  SensorDevice* sDevice = dynamic_cast<SensorDevice*>(upObj.get());
+  bool isSensorObject = sObject != nullptr;
+  if (isSensorObject) {
     LOG(INFO) << "Object \"" << upObj.get()->getName()
       << "\" is of SensorObject type";
-  } catch (...) {
+  } else {
     LOG(INFO) << "Object \"" << upObj.get()->getName()
       << "\" is NOT of SensorObject type.";
   }
@@ -48,7 +48,9 @@ Object* SensorObjectTree::addObject(std::unique_ptr<Object> upObj,
       throw std::invalid_argument("Invalid parent type");
     }
   }
-  return ObjectTree::addObject(std::move(upObj), parentPath);
+  Object* object = ObjectTree::addObject(std::move(upObj), parentPath);
+  setTyped(getObjectPath(object), sDevice, sObject);
+  return object;
 }
 
 SensorDevice* SensorObjectTree::addSensorDevice(
@@ -61,8 +63,10 @@ SensorDevice* SensorObjectTree::addSensorDevice(
   Object* parent = getParent(parentPath, name);
   std::unique_ptr<SensorDevice> upDev(
       new SensorDevice(name, std::move(uSensorApi), parent));
-  return static_cast<SensorDevice*>(addObjectByPath(std::move(upDev), path));
-
+  SensorDevice* sDevice =
+      static_cast<SensorDevice*>(addObjectByPath(std::move(upDev), path));
+  setTyped(path, sDevice, nullptr);
+  return sDevice;
 }
 
 SensorObject* SensorObjectTree::addSensorObject(const std::string &name,
@@ -72,7 +76,31 @@ SensorObject* SensorObjectTree::addSensorObject(const std::string &name,
   const std::string path = getPath(parentPath, name);
   SensorDevice* parent = getSensorDevice(getParent(parentPath, name));
   std::unique_ptr<SensorObject> upObj(new SensorObject(name, parent));
-  return static_cast<SensorObject*>(addObjectByPath(std::move(upObj), path));
+  SensorObject* sObject =
+      static_cast<SensorObject*>(addObjectByPath(std::move(upObj), path));
+  setTyped(path, nullptr, sObject);
+  return sObject;
+}
+
+void SensorObjectTree::deleteObjectByPath(const std::string &path) {
+  PathId id = getPathId(path);
+  ObjectTree::deleteObjectByPath(path); // throw if it cannot be deleted
+  if (id < devices_.size()) {
+    devices_[id] = nullptr;
+    sensorObjects_[id] = nullptr;
+  }
+}
+
+void SensorObjectTree::setTyped(const std::string &path,
+                                SensorDevice      *sDevice,
+                                SensorObject      *sObject) {
+  PathId id = getPathId(path);
+  if (id >= devices_.size()) {
+    devices_.resize(id + 1, nullptr);
+    sensorObjects_.resize(id + 1, nullptr);
+  }
+  devices_[id] = sDevice;
+  sensorObjects_[id] = sObject;
 }
 
 } // namespace qin
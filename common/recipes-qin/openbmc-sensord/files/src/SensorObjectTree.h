@@ -18,6 +18,7 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <memory>
 #include <ipc-interface/Ipc.h>
 #include <object-tree/ObjectTree.h>
@@ -48,11 +49,15 @@ class SensorObjectTree : public ObjectTree {
      * @return nullptr if not found; SensorDevice pointer otherwise
      */
     SensorDevice* getSensorDevice(const std::string &path) const {
-      Object* object = getObject(path);
-      if (object == nullptr) {
+      PathId id = getPathId(path);
+      if (getObject(id) == nullptr) {
         return nullptr;
       }
-      return getSensorDevice(object);
+      if (id >= devices_.size() || devices_[id] == nullptr) {
+        LOG(ERROR) << "Object is not of SensorDevice type";
+        throw std::invalid_argument("Invalid cast to SensorDevice");
+      }
+      return devices_[id];
     }
 
     /**
@@ -64,11 +69,15 @@ class SensorObjectTree : public ObjectTree {
      * @return nullptr if not found; SensorObject pointer otherwise
      */
     SensorObject* getSensorObject(const std::string &path) const {
-      Object* object = getObject(path);
-      if (object == nullptr) {
+      PathId id = getPathId(path);
+      if (getObject(id) == nullptr) {
         return nullptr;
       }
-      return getSensorObject(object);
+      if (id >= sensorObjects_.size() || sensorObjects_[id] == nullptr) {
+        LOG(ERROR) << "Object is not of SensorObject type";
+        throw std::invalid_argument("Invalid cast to SensorObject");
+      }
+      return sensorObjects_[id];
     }
 
     /**
@@ -127,7 +136,31 @@ class SensorObjectTree : public ObjectTree {
     SensorObject* addSensorObject(const std::string &name,
                                   const std::string &parentPath);
 
+    /**
+     * Delete the object at path, and its entry in the typed tables.
+     *
+     * @param path of the object to be deleted
+     * @throw std::invalid_argument if path not found or the object
+     *        has children
+     */
+    void deleteObjectByPath(const std::string &path) override;
+
   private:
+    // Typed views of the objects, indexed by PathId. The type of an object
+    // is resolved once when it is added, so lookups by path need no cast.
+    std::vector<SensorDevice*> devices_;
+    std::vector<SensorObject*> sensorObjects_;
+
+    /**
+     * Record the added object in the typed table of its type.
+     *
+     * @param path of the object
+     * @param sDevice if object is a SensorDevice; nullptr otherwise
+     * @param sObject if object is a SensorObject; nullptr otherwise
+     */
+    void setTyped(const std::string &path,
+                  SensorDevice      *sDevice,
+                  SensorObject      *sObject);
 
     /**
      * Get the SensorDevice from object.
@@ -144,22 +177,6 @@ class SensorObjectTree : public ObjectTree {
       }
       return sDevice;
     }
-
-    /**
-     * Get the SensorObject from object.
-     *
-     * @param object to be transformed
-     * @throw std::invalid_argument if the object is not of SensorObject type
-     * @return pointer to SensorObject
-     */
-    SensorObject* getSensorObject(Object* object) const {
-      SensorObject* sObject = nullptr;
-      if ((sObject = dynamic_cast<SensorObject*>(object)) == nullptr) {
-        LOG(ERROR) << "Object is not of SensorObject type";
-        throw std::invalid_argument("Invalid cast to SensorObject");
-      }
-      return sObject;
-    }
 };
 
 } // namespace qin
@@ -17,11 +17,13 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <string>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <system_error>
 #include <stdexcept>
-#include <fstream>
 #include <glog/logging.h>
 #include "SensorAttribute.h"
 #include "SensorSysfsApi.h"
@@ -30,36 +32,105 @@
 namespace openbmc {
 namespace qin {
 
+SensorSysfsApi::~SensorSysfsApi() {
+  for (auto &it : files_) {
+    if (it.second.rfd >= 0) {
+      close(it.second.rfd);
+    }
+    if (it.second.wfd >= 0) {
+      close(it.second.wfd);
+    }
+  }
+}
+
+int SensorSysfsApi::getFd(const std::string &addr, bool write) const {
+  auto it = files_.find(addr);
+  if (it == files_.end()) {
+    it = files_.insert(std::make_pair(addr, AttrFile{-1, -1, false})).first;
+  }
+  int &fd = write ? it->second.wfd : it->second.rfd;
+  if (fd < 0) {
+    std::string path = fsPath_ + std::string("/") + addr;
+    LOG(INFO) << "Opening path " << path;
+    fd = open(path.c_str(), (write ? O_WRONLY : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+      LOG(ERROR) << "Path " << path << " cannot be opened";
+      throw std::system_error(errno, std::system_category(), strerror(errno));
+    }
+    struct stat st;
+    it->second.regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  }
+  return fd;
+}
+
+void SensorSysfsApi::closeFds(const std::string &addr) const {
+  auto it = files_.find(addr);
+  if (it == files_.end()) {
+    return;
+  }
+  if (it->second.rfd >= 0) {
+    close(it->second.rfd);
+  }
+  if (it->second.wfd >= 0) {
+    close(it->second.wfd);
+  }
+  files_.erase(it);
+}
+
+size_t SensorSysfsApi::readLine(const std::string &addr, char *buf) const {
+  ssize_t len = pread(getFd(addr, false), buf, kMaxValueSize, 0);
+  if (len < 0 && (errno == ENODEV || errno == ESTALE)) {
+    closeFds(addr);
+    len = pread(getFd(addr, false), buf, kMaxValueSize, 0);
+  }
+  if (len < 0) {
+    LOG(ERROR) << "Path " << fsPath_ << "/" << addr << " cannot be read";
+    throw std::system_error(errno, std::system_category(), strerror(errno));
+  }
+  const char *nl = static_cast<const char*>(memchr(buf, '\n', len));
+  return nl ? nl - buf : len;
+}
+
 const std::string SensorSysfsApi::readValue(const Object          &object,
                                             const SensorAttribute &attr)
     const {
-  std::string path = fsPath_ + std::string("/") + attr.getAddr();
-  std::fstream fs;
-  LOG(INFO) << "Reading value from path " << path;
-  fs.open(path, std::fstream::in);
-  if (!fs.is_open()) {
-    LOG(ERROR) << "Path " << path << " cannot be opened";
-    throw std::system_error(errno, std::system_category(), strerror(errno));
+  char buf[kMaxValueSize];
+  LOG(INFO) << "Reading value from path " << fsPath_ << "/" << attr.getAddr();
+  return std::string(buf, readLine(attr.getAddr(), buf));
+}
+
+void SensorSysfsApi::readValues(const Object                        &object,
+                                const std::vector<SensorAttribute*> &attrs)
+    const {
+  alignas(kMaxValueSize) char buf[kMaxValueSize];
+  LOG(INFO) << "Reading " << attrs.size() << " values from path " << fsPath_;
+  for (auto attr : attrs) {
+    attr->setTypedValue(AttrValue::fromText(
+        std::string(buf, readLine(attr->getAddr(), buf))));
   }
-  std::string str;
-  std::getline(fs, str);
-  fs.close();
-  return str;
 }
 
 void SensorSysfsApi::writeValue(const Object          &object,
                                 const SensorAttribute &attr,
                                 const std::string     &value) {
-  std::string path = fsPath_ + std::string("/") + attr.getAddr();
-  std::fstream fs;
-  LOG(INFO) << "Writing value " << value <<" to path " << path;
-  fs.open(path, std::fstream::out);
-  if (!fs.is_open()) {
-    LOG(ERROR) << "Path " << path << " cannot be opened";
+  const std::string &addr = attr.getAddr();
+  LOG(INFO) << "Writing value " << value << " to path " << fsPath_ << "/"
+    << addr;
+  int fd = getFd(addr, true);
+  ssize_t len = pwrite(fd, value.data(), value.size(), 0);
+  if (len < 0 && (errno == ENODEV || errno == ESTALE)) {
+    closeFds(addr);
+    fd = getFd(addr, true);
+    len = pwrite(fd, value.data(), value.size(), 0);
+  }
+  if (len < 0) {
+    LOG(ERROR) << "Path " << fsPath_ << "/" << addr << " cannot be written";
+    throw std::system_error(errno, std::system_category(), strerror(errno));
+  }
+  // What a reopened (truncated) file would hold
+  if (files_[addr].regular && ftruncate(fd, value.size()) != 0) {
     throw std::system_error(errno, std::system_category(), strerror(errno));
   }
-  fs << value;
-  fs.close();
 }
 
 } // namespace qin
@@ -19,7 +19,8 @@
 #pragma once
 #include <string>
 #include <stdexcept>
-#include <fstream>
+#include <unordered_map>
+#include <vector>
 #include <glog/logging.h>
 #include <object-tree/Object.h>
 #include "SensorAttribute.h"
@@ -30,17 +31,55 @@ namespace qin {
 
 /**
  * Sensor API for reading and writing value of the attribute from the
- * SensorObject path.
+ * SensorObject path. The attribute files are kept open from their first
+ * access and read (written) at offset 0.
  */
 class SensorSysfsApi : public SensorApi {
   private:
+    // Largest value read, a page as sysfs
+    static const size_t kMaxValueSize = 4096;
+
+    struct AttrFile {
+      int rfd;
+      int wfd;
+      bool regular; // not sysfs, truncated on writes
+    };
+
     std::string fsPath_;
+    mutable std::unordered_map<std::string, AttrFile> files_;
+
+    /**
+     * Gets the fd of the attribute file addr to be read (written),
+     * opening it if not yet.
+     *
+     * @throw std::system_error errno if the file cannot be opened
+     */
+    int getFd(const std::string &addr, bool write) const;
+
+    /**
+     * Closes the fds of the attribute file addr, which are opened again
+     * on the next access (the device went away and came back).
+     */
+    void closeFds(const std::string &addr) const;
+
+    /**
+     * Reads the first line of the attribute file addr into buf.
+     *
+     * @throw std::system_error errno if the file cannot be read
+     * @return length of the line
+     */
+    size_t readLine(const std::string &addr, char *buf) const;
 
   public:
     SensorSysfsApi(const std::string &fsPath) {
       fsPath_ = fsPath;
     }
 
+    SensorSysfsApi(const SensorSysfsApi &) = delete;
+    SensorSysfsApi& operator=(const SensorSysfsApi &) = delete;
+
+    ~SensorSysfsApi();
+
     const std::string& getFsPath() const {
       return fsPath_;
     }
@@ -58,6 +97,18 @@ class SensorSysfsApi : public SensorApi {
     const std::string readValue(const Object          &object,
                                 const SensorAttribute &attr) const override;
 
+    /**
+     * Reads the values of attrs in one pass over their open files,
+     * through a single page aligned buffer.
+     *
+     * @param object of the attributes to be read
+     * @param attrs to be read
+     * @throw errno if a file cannot be opened
+     */
+    void readValues(const Object                        &object,
+                    const std::vector<SensorAttribute*> &attrs)
+        const override;
+
     /**
      * Writes value to the path specified by object and attr. The path
      * will be constructed from fsPath_ and addr in attribute.
@@ -20,6 +20,9 @@
 #include <system_error>
 #include <stdexcept>
 #include <memory>
+#include <fstream>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <gio/gio.h>
@@ -113,6 +116,49 @@ TEST_F(ReadWriteTest, Dump) {
   EXPECT_STREQ(api.c_str(), "sysfs");
 }
 
+TEST(SensorDeviceObjectTest, BatchRead) {
+  const std::string fsPath = "./batch-read-test";
+  mkdir(fsPath.c_str(), 0755);
+  std::ofstream(fsPath + "/temp1_input") << "35000\n";
+  std::ofstream(fsPath + "/temp1_max") << "90000\n";
+  std::ofstream(fsPath + "/name") << "tmp75\n";
+
+  std::unique_ptr<SensorSysfsApi> uSysfsApi(new SensorSysfsApi(fsPath));
+  SensorDevice sDevice("sensor1", std::move(uSysfsApi));
+  sDevice.addAttribute("name")->setAddr("name");
+  SensorObject sObject("temp", &sDevice);
+  sObject.addAttribute("1_input")->setAddr("temp1_input");
+  SensorAttribute* attrMax = sObject.addAttribute("1_max");
+  attrMax->setAddr("temp1_max");
+  attrMax->setModes(Attribute::RW);
+  sObject.addAttribute("label"); // not accessible
+
+  ASSERT_NO_THROW(sDevice.readAttrValues());
+  EXPECT_STREQ(sDevice.getAttribute("name")->getValue().c_str(), "tmp75");
+  EXPECT_STREQ(sObject.getAttribute("1_input")->getValue().c_str(), "35000");
+  EXPECT_STREQ(attrMax->getValue().c_str(), "90000");
+  EXPECT_STREQ(sObject.getAttribute("label")->getValue().c_str(), "");
+  // integers are kept typed
+  EXPECT_EQ(attrMax->getTypedValue().getType(), AttrValue::INT);
+  EXPECT_EQ(attrMax->getTypedValue().getInt(), 90000);
+  EXPECT_EQ(sDevice.getAttribute("name")->getTypedValue().getType(),
+            AttrValue::STRING);
+
+  // read again through the open files
+  std::ofstream(fsPath + "/temp1_input") << "36000\n";
+  ASSERT_NO_THROW(sObject.writeAttrValue("1_max", "8000"));
+  sDevice.readAttrValues();
+  EXPECT_STREQ(sObject.getAttribute("1_input")->getValue().c_str(), "36000");
+  EXPECT_STREQ(sObject.readAttrValue("1_max").c_str(), "8000");
+  ASSERT_NO_THROW(sObject.writeAttrTypedValue("1_max", AttrValue(int64_t(85000))));
+  EXPECT_EQ(sObject.readAttrTypedValue("1_max").getInt(), 85000);
+
+  unlink((fsPath + "/temp1_input").c_str());
+  unlink((fsPath + "/temp1_max").c_str());
+  unlink((fsPath + "/name").c_str());
+  rmdir(fsPath.c_str());
+}
+
 int main (int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   ::google::InitGoogleLogging(argv[0]);
@@ -5,6 +5,9 @@ import typing as t
 import obmc_mmc
 from aiohttp.log import server_logger
 
+# emmcd refreshes the EXT_CSD snapshot at least every 10 hours
+EXTCSD_MAX_AGE = 86400
+
 
 async def get_mmc_info() -> t.Dict[str, t.Dict[str, t.Union[int, str]]]:
     """
@@ -29,7 +32,7 @@ def _get_dev_info(dev_path: str) -> t.Dict[str, t.Union[int, str]]:
     try:
         with obmc_mmc.mmc_dev(dev_path) as mmc:
             # Currently only exposes extcsd metrics, but can be extended later on
-            extcsd = obmc_mmc.mmc_extcsd_read(mmc)
+            extcsd = obmc_mmc.mmc_extcsd_read_cached(mmc, EXTCSD_MAX_AGE)
             cid = obmc_mmc.mmc_cid_read(mmc)
 
             lte = obmc_mmc.extcsd_life_time_estimate(extcsd)
@@ -31,7 +31,7 @@ class TestRestMMC(AioHTTPTestCase):
                 return_value=obmc_mmc.mmc_cid_t.from_buffer_copy(EXAMPLE_CID),
             ),
             unittest.mock.patch(
-                "obmc_mmc.mmc_extcsd_read",
+                "obmc_mmc.mmc_extcsd_read_cached",
                 autospec=True,
                 return_value=obmc_mmc.mmc_extcsd_t(raw=(ctypes.c_uint8 * 512)()),
             ),
@@ -70,7 +70,7 @@ class TestRestMMC(AioHTTPTestCase):
 
         obmc_mmc.mmc_dev.assert_called_once_with("<dev_path>")
         obmc_mmc.extcsd_life_time_estimate.assert_called_once_with(
-            obmc_mmc.mmc_extcsd_read.return_value
+            obmc_mmc.mmc_extcsd_read_cached.return_value
         )
 
     def test_get_dev_info_suppress_exceptions(self):
@@ -210,6 +210,103 @@ int check_cpld_busy(unsigned int options, int seconds)
     return -1;
 }
 
+/*
+ * Wait for the busy flag to clear, polling every poll_us microseconds.
+ */
+static int wait_cpld_ready(int poll_us, int seconds)
+{
+    unsigned int status = 0;
+    int ret;
+    int counter = seconds*(1000*1000/poll_us);
+
+    while(counter--){
+        ret = write_onebyte_instruction(JTAG_STATE_IDLE, LSC_CHECK_BUSY);
+        if(ret < 0){
+            return -1;
+        }
+
+        status = 0;
+        ret = read_data_register(JTAG_STATE_IDLE, &status, 8);
+        if(ret < 0){
+            return -1;
+        }
+
+        if((status&CPLD_BUSY_FLAG_BIT) == 0){
+            return 0;
+        }
+        usleep(poll_us);
+    }
+    printf("%s(%d) - wait cpld ready timeout 0x%08x\n", __FILE__, __LINE__, status);
+    return -1;
+}
+
+/*
+ * Program the pages of the configuration flash back to back: each page
+ * is one LSC_PROG_INCR_NV and one SDR of the whole page, and the next
+ * page follows as soon as the busy flag clears rather than after fixed
+ * delays (a page programs in well under a millisecond).
+ */
+static int stream_cfg_pages(int bytes_per_page, int used_pages,
+                            unsigned int *page_buffer, progress_func_t progress)
+{
+    int rc = 0;
+    int row;
+    int i;
+    int words_per_page = bytes_per_page/sizeof(unsigned int);
+
+    for (row = 0 ; row < used_pages; row++){
+        enum jtag_endstate endstate;
+        rc = jtag_get_status(global_jtag_object, &endstate);
+        if(rc < 0 || endstate != JTAG_STATE_IDLE){
+            rc = -1;
+            break;
+        }
+
+        for (i = 0; i < words_per_page; i++) {
+            page_buffer[i] = jedec_get_long(row*words_per_page+i);
+        }
+
+        rc = write_onebyte_instruction(JTAG_STATE_PAUSEIR, LSC_PROG_INCR_NV);
+        if(rc < 0){
+            printf("%s(%d) - failed to write instruction LSC_PROG_INCR_NV\n",  __FUNCTION__, __LINE__);
+            break;
+        }
+
+        rc = write_data_register(JTAG_STATE_IDLE, page_buffer, bytes_per_page*BITS_OF_ONE_BYTE);
+        if(rc < 0){
+            printf("%s(%d) - failed to write data to cpld\n",  __FUNCTION__, __LINE__);
+            break;
+        }
+
+        run_test_idle(0, JTAG_STATE_IDLE, 2);
+
+        rc = wait_cpld_ready(CPLD_PAGE_POLL_US, CPLD_BUSY_CHECK_TIMEOUT);
+        if(rc < 0){
+            printf("%s(%d) - failed to check cpld busy due to timeout\n",  __FUNCTION__, __LINE__);
+            break;
+        }
+
+        for (i = 0; i < 10; i++) {
+            page_buffer[0] = 0;
+            read_data_register(JTAG_STATE_IDLE, page_buffer, 1);
+            if (page_buffer[0] == 0) break;
+            usleep(3000);
+        }
+
+        if (page_buffer[0] != 0){
+            printf("Prgram failure row %d: failure data [%08x] \n", row, page_buffer[0]);
+            rc = -1;
+            break;
+        } else {
+            if(NULL != progress){
+                progress((row*100)/used_pages);
+            }
+        }
+    }
+
+    return rc;
+}
+
 cpld_device_t *scan_cpld_device()
 {
     unsigned int tempId;
@@ -362,8 +459,6 @@ int erase_cpld(unsigned char option, int num_of_loops)
 int program_configuration(int bytes_per_page, int num_of_pages, progress_func_t progress)
 {
     int rc = 0;
-    int row;
-    int i;
     unsigned int *page_buffer;
     int used_pages = 0;
 
@@ -397,58 +492,8 @@ int program_configuration(int bytes_per_page, int num_of_pages, progress_func_t
         printf("%s(%d) - failed to write opcode\n",  __FUNCTION__, __LINE__);
         goto end_of_func;
     }
-    
-    for (row = 0 ; row < used_pages; row++){
-        enum jtag_endstate endstate;
-        rc = jtag_get_status(global_jtag_object, &endstate);
-        if(endstate != JTAG_STATE_IDLE){
-            rc = -1;
-            break;
-        }
-        usleep(1000);
-
-        for (i = 0; i < bytes_per_page/sizeof(unsigned int); i++) {
-            page_buffer[i] = jedec_get_long(row*bytes_per_page/sizeof(unsigned int)+i);
-        }
-
-        rc = write_onebyte_instruction(JTAG_STATE_PAUSEIR, LSC_PROG_INCR_NV);
-        if(rc < 0){
-            printf("%s(%d) - failed to write instruction LSC_PROG_INCR_NV\n",  __FUNCTION__, __LINE__);
-            goto end_of_func;
-        }
-
-        rc = write_data_register(JTAG_STATE_IDLE, page_buffer, bytes_per_page*BITS_OF_ONE_BYTE);
-        if(rc < 0){
-            printf("%s(%d) - failed to write data to cpld\n",  __FUNCTION__, __LINE__);
-            goto end_of_func;
-        }
-        
-        run_test_idle(0, JTAG_STATE_IDLE, 2);
-        usleep(1000);
-
-        rc = check_cpld_busy(CPLD_BUSY_FLAG_BIT, CPLD_BUSY_CHECK_TIMEOUT);
-        if(rc < 0){
-            printf("%s(%d) - failed to check cpld busy due to timeout\n",  __FUNCTION__, __LINE__);
-            goto end_of_func;
-        }
 
-        for (i = 0; i < 10; i++) {
-            usleep(3000);
-            page_buffer[0] = 0;
-            read_data_register(JTAG_STATE_IDLE, page_buffer, 1);
-            if (page_buffer[0] == 0) break;
-        }
-
-        if (page_buffer[0] != 0){
-            printf("Prgram failure row %d: failure data [%08x] \n", row, page_buffer[0]);
-            rc = -1;
-            break;
-        } else {
-            if(NULL != progress){
-                progress((row*100)/used_pages);
-            }
-        }
-    }
+    rc = stream_cfg_pages(bytes_per_page, used_pages, page_buffer, progress);
 
 end_of_func:
     if(page_buffer) free(page_buffer);
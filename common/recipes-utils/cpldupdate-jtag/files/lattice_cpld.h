@@ -87,6 +87,7 @@ command is issued, or a power cycle event occurs */
 
 #define CPLD_ERASE_TIMEOUT      10
 #define CPLD_BUSY_CHECK_TIMEOUT 3
+#define CPLD_PAGE_POLL_US       100
 
 typedef struct {
     const char      *name;
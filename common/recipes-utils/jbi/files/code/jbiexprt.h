@@ -174,6 +174,21 @@ int jbi_jtag_io
 	int read_tdo
 );
 
+int jbi_jtag_bulk_state
+(
+	int reset,
+	int state,
+	long cycles
+);
+
+int jbi_jtag_bulk_scan
+(
+	int ir,
+	int count,
+	unsigned char *tdi,
+	unsigned char *tdo
+);
+
 void jbi_message
 (
 	char *message_text
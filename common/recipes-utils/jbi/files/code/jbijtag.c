@@ -513,18 +513,21 @@ void jbi_jtag_reset_idle(void)
 {
 	int i;
 
-	/*
-	*	Go to Test Logic Reset (no matter what the starting state may be)
-	*/
-	for (i = 0; i < 5; ++i)
+	if (jbi_jtag_bulk_state(1, IDLE, 0) == 0)
 	{
-		jbi_jtag_io(TMS_HIGH, TDI_LOW, IGNORE_TDO);
-	}
+		/*
+		*	Go to Test Logic Reset (no matter what the starting state may be)
+		*/
+		for (i = 0; i < 5; ++i)
+		{
+			jbi_jtag_io(TMS_HIGH, TDI_LOW, IGNORE_TDO);
+		}
 
-	/*
-	*	Now step to Run Test / Idle
-	*/
-	jbi_jtag_io(TMS_LOW, TDI_LOW, IGNORE_TDO);
+		/*
+		*	Now step to Run Test / Idle
+		*/
+		jbi_jtag_io(TMS_LOW, TDI_LOW, IGNORE_TDO);
+	}
 
 	jbi_jtag_state = IDLE;
 }
@@ -550,6 +553,20 @@ JBI_RETURN_TYPE jbi_goto_jtag_state
 		jbi_jtag_reset_idle();
 	}
 
+	/*
+	*	The JTAG controller moves the TAP itself when it does the scans
+	*/
+	count = jbi_jtag_bulk_state(0, state, (jbi_jtag_state == state) ? 1 : 0);
+	if (count != 0)
+	{
+		if (count < 0)
+		{
+			return (JBIC_IO_ERROR);
+		}
+		jbi_jtag_state = state;
+		return (JBIC_SUCCESS);
+	}
+
 	if (jbi_jtag_state == state)
 	{
 		/*
@@ -641,9 +658,21 @@ JBI_RETURN_TYPE jbi_do_wait_cycles
 		*/
 		tms = (wait_state == RESET) ? TMS_HIGH : TMS_LOW;
 
-		for (count = 0L; count < cycles; count++)
+		switch (jbi_jtag_bulk_state(0, wait_state, cycles))
 		{
-			jbi_jtag_io(tms, TDI_LOW, IGNORE_TDO);
+		case 0:
+			for (count = 0L; count < cycles; count++)
+			{
+				jbi_jtag_io(tms, TDI_LOW, IGNORE_TDO);
+			}
+			break;
+
+		case 1:
+			break;
+
+		default:
+			status = JBIC_IO_ERROR;
+			break;
 		}
 	}
 
@@ -770,6 +799,19 @@ int jbi_jtag_drscan
 	int tdo_bit = 0;
 	int status = 1;
 
+	/*
+	*	The whole scan in one transfer of the JTAG controller, which
+	*	moves from the start state itself
+	*/
+	if ((start_state >= 0) && (start_state <= 2))
+	{
+		i = jbi_jtag_bulk_scan(0, count, tdi, tdo);
+		if (i != 0)
+		{
+			return (i > 0);
+		}
+	}
+
 	/*
 	*	First go to DRSHIFT state
 	*/
@@ -842,6 +884,19 @@ int jbi_jtag_irscan
 	int tdo_bit = 0;
 	int status = 1;
 
+	/*
+	*	The whole scan in one transfer of the JTAG controller, which
+	*	moves from the start state itself
+	*/
+	if ((start_state >= 0) && (start_state <= 2))
+	{
+		i = jbi_jtag_bulk_scan(1, count, tdi, tdo);
+		if (i != 0)
+		{
+			return (i > 0);
+		}
+	}
+
 	/*
 	*	First go to IRSHIFT state
 	*/
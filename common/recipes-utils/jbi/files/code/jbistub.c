@@ -84,6 +84,7 @@ typedef unsigned long DWORD;
 #include <openbmc/log.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <openbmc/ast-jtag.h>
 #endif
 
 #if PORT == DOS
@@ -170,6 +171,11 @@ static int g_sysfs_tdi_fd = -1;
 static int g_sysfs_tdo_fd = -1;
 
 static int (*jtag_io_func)(int, int, int);
+
+/* scans and TAP moves done by the JTAG controller through libast-jtag */
+static int g_bulk = 0;
+static unsigned char *g_bulk_buf;
+static unsigned int g_bulk_buf_size;
 #endif
 
 #if defined(USE_STATIC_MEMORY)
@@ -269,14 +275,7 @@ BOOL verbose = FALSE;
 #define JTAG_SYSFS_TMS JTAG_SYSFS_DIR "tms"
 #define JTAG_SYSFS_TCK JTAG_SYSFS_DIR "tck"
 
-#define __JTAG_IOCTL_MAGIC 0xb2
-#define JTAG_IOCBITBANG _IOW(__JTAG_IOCTL_MAGIC, 6, unsigned int)
-
-struct tck_bitbang {
-  unsigned char tms;
-  unsigned char tdi;
-  unsigned char tdo;
-} __attribute__((__packed__));
+/* JTAG_IOCBITBANG and struct tck_bitbang come with <openbmc/ast-jtag.h> */
 
 static void jtag_swio_write(int fd, int value) {
   if (lseek(fd, 0, SEEK_SET) < 0) {
@@ -499,6 +498,94 @@ static int jbi_jtag_gpio(int tms, int tdi, int read_tdo)
   return tdo;
 }
 
+static int initialize_jtag_bulk(void)
+{
+  ast_jtag_set_mode(JTAG_XFER_HW_MODE);
+  if (ast_jtag_open()) {
+    fprintf(stderr, "%s: ast_jtag_open() failed\n", __func__);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * The bulk engine leaves the TAP to the JTAG controller driver, which
+ * tracks its state: once it is in use, every TAP move has to go through
+ * it as well, so jbijtag.c asks here before clocking TMS itself.
+ *
+ * Return: 1 if done, 0 if the bulk engine is not in use, -1 on failure.
+ */
+int jbi_jtag_bulk_state(int reset, int state, long cycles)
+{
+  unsigned char tck;
+
+  if (!g_bulk) {
+    return 0;
+  }
+  OBMC_DEBUG("bulk state reset=%d state=%d cycles=%ld", reset, state, cycles);
+  if (!jtag_hardware_initialized) {
+    if (initialize_jtag_bulk()) {
+      return -1;
+    }
+    jtag_hardware_initialized = TRUE;
+  }
+
+  do {
+    tck = (cycles > 0xff) ? 0xff : (unsigned char) cycles;
+    if (ast_jtag_run_test_idle(reset, state, tck) < 0) {
+      return -1;
+    }
+    reset = 0;
+    cycles -= tck;
+  } while (cycles > 0);
+
+  return 1;
+}
+
+/*
+ * Shift a whole IR or DR scan with one transfer of the JTAG controller,
+ * from the current pause or idle state into IRPAUSE or DRPAUSE.
+ *
+ * Return: 1 if done, 0 if the bulk engine is not in use, -1 on failure.
+ */
+int jbi_jtag_bulk_scan(int ir, int count, unsigned char *tdi,
+                       unsigned char *tdo)
+{
+  unsigned int size = ((count + 31) / 32) * 4;
+
+  if (!g_bulk) {
+    return 0;
+  }
+  if (!jtag_hardware_initialized || count <= 0) {
+    return -1;
+  }
+
+  /* the driver returns TDO in the buffer, keep the caller's TDI intact */
+  if (size > g_bulk_buf_size) {
+    unsigned char *buf = realloc(g_bulk_buf, size);
+    if (buf == NULL) {
+      return -1;
+    }
+    g_bulk_buf = buf;
+    g_bulk_buf_size = size;
+  }
+  memset(g_bulk_buf, 0, size);
+  memcpy(g_bulk_buf, tdi, (count + 7) / 8);
+
+  if (ast_jtag_bulk_xfer(ir ? JTAG_SIR_XFER : JTAG_SDR_XFER,
+                         tdo ? JTAG_READ_WRITE_XFER : JTAG_WRITE_XFER,
+                         ir ? JTAG_STATE_PAUSEIR : JTAG_STATE_PAUSEDR,
+                         count, (unsigned int *) g_bulk_buf) < 0) {
+    return -1;
+  }
+  if (tdo != NULL) {
+    memcpy(tdo, g_bulk_buf, (count + 7) / 8);
+  }
+
+  OBMC_DEBUG("bulk %s scan of %d bits", ir ? "IR" : "DR", count);
+  return 1;
+}
+
 int jbi_jtag_io(int tms, int tdi, int read_tdo)
 {
   return jtag_io_func(tms, tdi, read_tdo);
@@ -506,6 +593,17 @@ int jbi_jtag_io(int tms, int tdi, int read_tdo)
 
 #else
 
+int jbi_jtag_bulk_state(int reset, int state, long cycles)
+{
+	return 0;
+}
+
+int jbi_jtag_bulk_scan(int ir, int count, unsigned char *tdi,
+	unsigned char *tdo)
+{
+	return 0;
+}
+
 int jbi_jtag_io(int tms, int tdi, int read_tdo)
 {
 	int data = 0;
@@ -1279,6 +1377,10 @@ int main(int argc, char **argv)
 				g_swio = 1;
 				jtag_io_func = jbi_jtag_swio;
 				break;
+
+			case 'B':				/* use the JTAG controller for whole scans */
+				g_bulk = 1;
+				break;
 #else
 			case 'S':				/* set serial port address */
 				serial_port_name = &argv[arg][2];
@@ -1380,6 +1482,7 @@ int main(int argc, char **argv)
 		fprintf(stderr, "    -gs<clock>  : GPIO directory for TMS\n");
 		fprintf(stderr, "    -gi<clock>  : GPIO directory for TDI\n");
 		fprintf(stderr, "    -go<clock>  : GPIO directory for TDO\n");
+		fprintf(stderr, "    -b          : shift whole IR/DR scans with the JTAG controller\n");
 #else
 		fprintf(stderr, "    -s<port>    : serial port name (for BitBlaster)\n");
 #endif
@@ -2152,6 +2255,11 @@ void close_jtag_hardware()
 			close(g_sysfs_tdi_fd);
 		if (g_jtag_dev >= 0)
 			close(g_jtag_dev);
+		if (g_bulk)
+			ast_jtag_close();
+		free(g_bulk_buf);
+		g_bulk_buf = NULL;
+		g_bulk_buf_size = 0;
 #endif
 	}
 }
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2021-present Facebook. All Rights Reserved.
+ *
+ * This is the source file of the scope trace utility.
+ * Run "trace-util -h" on openbmc for usage information.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Reads the snapshots exported by openbmc::trace (trace.hpp) from
+ * /dev/shm/obmc-trace-<name>.
+ */
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <openbmc/trace.hpp>
+
+using namespace openbmc::trace;
+
+struct Snapshot {
+  ShmHeader hdr{};
+  std::vector<ShmScope> scopes{};
+  std::vector<ShmEvent> events{};
+};
+
+static int load(const std::string& name, Snapshot& snap) {
+  std::string path = shmPath(name);
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) {
+    fprintf(stderr, "Cannot open %s: %s\n", path.c_str(), strerror(errno));
+    return -1;
+  }
+  int ret = -1;
+  if (fread(&snap.hdr, sizeof(snap.hdr), 1, fp) != 1 ||
+      snap.hdr.magic != kShmMagic || snap.hdr.version != kShmVersion ||
+      snap.hdr.numScopes > kMaxScopes) {
+    fprintf(stderr, "Invalid trace in %s\n", path.c_str());
+  } else {
+    snap.scopes.resize(snap.hdr.numScopes);
+    snap.events.resize(snap.hdr.numEvents);
+    if (fread(snap.scopes.data(), sizeof(ShmScope), snap.scopes.size(), fp) !=
+            snap.scopes.size() ||
+        fread(snap.events.data(), sizeof(ShmEvent), snap.events.size(), fp) !=
+            snap.events.size()) {
+      fprintf(stderr, "Truncated trace in %s\n", path.c_str());
+    } else {
+      ret = 0;
+    }
+  }
+  fclose(fp);
+  return ret;
+}
+
+// Upper bound of the bucket holding the <pct> percentile, in ns.
+static uint64_t percentile(const ShmScope& s, unsigned pct) {
+  uint64_t target = (s.count * pct + 99) / 100, seen = 0;
+  for (size_t b = 0; b < kBuckets; b++) {
+    seen += s.buckets[b];
+    if (seen >= target) {
+      return std::min<uint64_t>(s.maxNs, (2ULL << b) - 1);
+    }
+  }
+  return s.maxNs;
+}
+
+static std::string fmtNs(uint64_t ns) {
+  char buf[32];
+  if (ns >= 1000000000ULL) {
+    snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+  } else if (ns >= 1000000ULL) {
+    snprintf(buf, sizeof(buf), "%.2fms", ns / 1e6);
+  } else if (ns >= 1000ULL) {
+    snprintf(buf, sizeof(buf), "%.2fus", ns / 1e3);
+  } else {
+    snprintf(buf, sizeof(buf), "%lluns", (unsigned long long)ns);
+  }
+  return buf;
+}
+
+static int do_list() {
+  DIR* dir = opendir(kShmDir);
+  if (dir == nullptr) {
+    fprintf(stderr, "Cannot open %s: %s\n", kShmDir, strerror(errno));
+    return -1;
+  }
+  size_t plen = strlen(kShmPrefix);
+  while (struct dirent* ent = readdir(dir)) {
+    std::string file = ent->d_name;
+    if (file.compare(0, plen, kShmPrefix) != 0 ||
+        file.find(".tmp") != std::string::npos) {
+      continue;
+    }
+    Snapshot snap;
+    std::string name = file.substr(plen);
+    if (load(name, snap) == 0) {
+      printf(
+          "%-24s pid %-6u %u scopes, %u events\n",
+          name.c_str(),
+          snap.hdr.pid,
+          snap.hdr.numScopes,
+          snap.hdr.numEvents);
+    }
+  }
+  closedir(dir);
+  return 0;
+}
+
+static int do_dump(const std::string& name) {
+  Snapshot snap;
+  if (load(name, snap) != 0) {
+    return -1;
+  }
+  printf(
+      "%-40s %10s %10s %10s %10s %10s %10s\n",
+      "SCOPE", "COUNT", "AVG", "P50", "P90", "P99", "MAX");
+  for (auto& s : snap.scopes) {
+    if (s.count == 0) {
+      continue;
+    }
+    printf(
+        "%-40s %10llu %10s %10s %10s %10s %10s\n",
+        s.name,
+        (unsigned long long)s.count,
+        fmtNs(s.totalNs / s.count).c_str(),
+        fmtNs(percentile(s, 50)).c_str(),
+        fmtNs(percentile(s, 90)).c_str(),
+        fmtNs(percentile(s, 99)).c_str(),
+        fmtNs(s.maxNs).c_str());
+  }
+  return 0;
+}
+
+static std::string jsonEscape(const char* str) {
+  std::string out;
+  for (; *str != '\0'; str++) {
+    unsigned char c = *str;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+// Chrome trace event format: load in chrome://tracing or Perfetto.
+static int do_chrome(const std::string& name, const char* out) {
+  Snapshot snap;
+  if (load(name, snap) != 0) {
+    return -1;
+  }
+  FILE* fp = out != nullptr ? fopen(out, "w") : stdout;
+  if (fp == nullptr) {
+    fprintf(stderr, "Cannot open %s: %s\n", out, strerror(errno));
+    return -1;
+  }
+  fprintf(fp, "{\"traceEvents\":[");
+  bool first = true;
+  for (auto& e : snap.events) {
+    if (e.scope >= snap.scopes.size()) {
+      continue;
+    }
+    fprintf(
+        fp,
+        "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+        "\"pid\":%u,\"tid\":%u,\"args\":{\"depth\":%u}}",
+        first ? "" : ",",
+        jsonEscape(snap.scopes[e.scope].name).c_str(),
+        e.startNs / 1e3,
+        e.durNs / 1e3,
+        snap.hdr.pid,
+        e.tid,
+        e.depth);
+    first = false;
+  }
+  fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  if (out != nullptr && fclose(fp) != 0) {
+    fprintf(stderr, "Cannot write %s: %s\n", out, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+static void usage(const char* prog) {
+  printf("Usage: %s <command> [args]\n", prog);
+  printf("  list                   list the exported traces\n");
+  printf("  dump <name>            latency histograms of the scopes\n");
+  printf("  chrome <name> [file]   recent scopes as Chrome trace JSON\n");
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    usage(argv[0]);
+    return -1;
+  }
+  std::string cmd = argv[1];
+  if (cmd == "list") {
+    return do_list();
+  } else if (cmd == "dump" && argc == 3) {
+    return do_dump(argv[2]);
+  } else if (cmd == "chrome" && (argc == 3 || argc == 4)) {
+    return do_chrome(argv[2], argc == 4 ? argv[3] : nullptr);
+  }
+  usage(argv[0]);
+  return cmd == "-h" ? 0 : -1;
+}
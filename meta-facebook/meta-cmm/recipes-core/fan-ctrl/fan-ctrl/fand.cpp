@@ -58,15 +58,15 @@
 #include <signal.h>
 #include <syslog.h>
 #include <dirent.h>
-#ifdef CONFIG_GALAXY100
 #include <fcntl.h>
-#endif
 
 #include <openbmc/watchdog.h>
 #include <openbmc/obmc-i2c.h>
 #include <openbmc/misc-utils.h>
 #include <openbmc/obmc-pmbus.h>
 
+#include "fan_pid.h"
+
 /* Sensor definitions */
 #define INTERNAL_TEMPS(x) (x)
 #define EXTERNAL_TEMPS(x) (x)
@@ -141,6 +141,19 @@
 
 #define PATH_CACHE_SIZE 256
 
+/*
+ * The control loop reads the temperatures and sets the fans every
+ * control interval (-i), the fan speeds are checked every
+ * FAN_CHECK_INTERVAL_MS, once they had that long to settle.
+ */
+#define CONTROL_INTERVAL_MS 5000
+#define CONTROL_INTERVAL_MIN_MS 1000
+#define FAN_CHECK_INTERVAL_MS 5000
+/* Fan checks are not delayed longer by speed changes. */
+#define FAN_CHECK_MAX_DELAY_MS 30000
+
+#define SYSFS_FD_CACHE_SIZE 64
+
 #define log_error(fmt, args...) \
   syslog(LOG_ERR, "%s" fmt ": %s", __func__, ##args, strerror(errno))
 #define log_warn(fmt, args...) \
@@ -562,27 +575,105 @@ close_dir_out:
   return rc;
 }
 
-// Functions for reading from sysfs stub
-static int read_sysfs_raw_internal(const char *device, char *value, int log)
+/*
+ * sysfs attributes stay open once used: they are read again with pread()
+ * at offset 0, which makes the kernel generate the value again.
+ */
+struct sysfs_fd {
+  char path[PATH_CACHE_SIZE];
+  int flags;
+  int fd;
+};
+
+static struct sysfs_fd sysfs_fds[SYSFS_FD_CACHE_SIZE];
+static int sysfs_fds_used;
+static int sysfs_fds_next; /* evicted next once all are used */
+
+static struct sysfs_fd *sysfs_fd_get(const char *path, int flags)
 {
-  FILE *fp;
-  int rc, err;
+  struct sysfs_fd *entry;
+  int i, fd;
+
+  for (i = 0; i < sysfs_fds_used; i++) {
+    entry = &sysfs_fds[i];
+    if (entry->fd >= 0 && entry->flags == flags &&
+        !strcmp(entry->path, path))
+      return entry;
+  }
 
-  fp = fopen(device, "r");
-  if (!fp) {
-    if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to open device %s for read: %s",
-             device, strerror(err));
-      errno = err;
-    }
+  fd = open(path, flags | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (sysfs_fds_used < SYSFS_FD_CACHE_SIZE) {
+    entry = &sysfs_fds[sysfs_fds_used++];
+  } else {
+    entry = &sysfs_fds[sysfs_fds_next];
+    sysfs_fds_next = (sysfs_fds_next + 1) % SYSFS_FD_CACHE_SIZE;
+    close(entry->fd);
+  }
+  snprintf(entry->path, sizeof(entry->path), "%s", path);
+  entry->flags = flags;
+  entry->fd = fd;
+  return entry;
+}
+
+/* Close a stale fd (e.g. of a removed device), it is opened again next. */
+static void sysfs_fd_drop(struct sysfs_fd *entry)
+{
+  int err = errno;
+
+  close(entry->fd);
+  entry->fd = -1;
+  entry->path[0] = '\0';
+  errno = err;
+}
+
+/* Read the attribute into buf, returns its length or -1. */
+static int sysfs_pread(const char *path, char *buf, size_t size)
+{
+  struct sysfs_fd *entry;
+  ssize_t n = -1;
+  int tries;
+
+  for (tries = 0; tries < 2 && n < 0; tries++) {
+    entry = sysfs_fd_get(path, O_RDONLY);
+    if (entry == NULL)
+      return -1;
+    n = pread(entry->fd, buf, size - 1, 0);
+    if (n < 0)
+      sysfs_fd_drop(entry);
+  }
+  if (n < 0)
     return -1;
+  buf[n] = '\0';
+  return n;
+}
+
+static int sysfs_pwrite(const char *path, const char *buf, size_t len)
+{
+  struct sysfs_fd *entry;
+  ssize_t n = -1;
+  int tries;
+
+  for (tries = 0; tries < 2 && n < 0; tries++) {
+    entry = sysfs_fd_get(path, O_WRONLY);
+    if (entry == NULL)
+      return -1;
+    n = pwrite(entry->fd, buf, len, 0);
+    if (n < 0)
+      sysfs_fd_drop(entry);
   }
+  return n < 0 ? -1 : 0;
+}
 
-  rc = fscanf(fp, "%s", value);
-  fclose(fp);
+// Functions for reading from sysfs stub
+static int read_sysfs_raw_internal(const char *device, char *value, int log)
+{
+  char buf[PATH_CACHE_SIZE];
+  char *start, *end;
+  int err;
 
-  if (rc != 1) {
+  if (sysfs_pread(device, buf, sizeof(buf)) < 0) {
     if (log) {
       err = errno;
       syslog(LOG_INFO, "failed to read device %s: %s",
@@ -592,6 +683,20 @@ static int read_sysfs_raw_internal(const char *device, char *value, int log)
     return -1;
   }
 
+  /* The first word, as fscanf("%s") */
+  for (start = buf; *start == ' ' || *start == '\t' || *start == '\n'; start++)
+    ;
+  for (end = start; *end != '\0' && *end != ' ' && *end != '\t' &&
+       *end != '\n'; end++)
+    ;
+  if (end == start) {
+    if (log)
+      syslog(LOG_INFO, "failed to read device %s: empty", device);
+    errno = ENODATA;
+    return -1;
+  }
+  *end = '\0';
+  strcpy(value, start);
   return 0;
 }
 
@@ -616,9 +721,9 @@ static int read_sysfs_int(char *sysfs_path, int *buffer)
   {
     if (strstr(readBuf, "0x") ||
         strstr(readBuf, "0X"))
-      sscanf(readBuf, "%x", buffer);
+      *buffer = (int)strtoul(readBuf, NULL, 16);
     else
-      sscanf(readBuf, "%d", buffer);
+      *buffer = (int)strtol(readBuf, NULL, 10);
   }
   return rc;
 }
@@ -626,29 +731,15 @@ static int read_sysfs_int(char *sysfs_path, int *buffer)
 // Functions for writing to system stub
 static int write_sysfs_raw_internal(const char *device, char *value, int log)
 {
-  FILE *fp;
-  int rc, err;
+  int err;
 
-  fp = fopen(device, "w");
-  if (!fp) {
+  if (sysfs_pwrite(device, value, strlen(value)) < 0) {
     if (log) {
       err = errno;
-      syslog(LOG_INFO, "failed to open device %s for write : %s",
+      syslog(LOG_INFO, "failed to write to device %s: %s",
              device, strerror(err));
       errno = err;
     }
-    return err;
-  }
-
-  rc = fputs(value, fp);
-  fclose(fp);
-
-  if (rc < 0) {
-    if (log) {
-      err = errno;
-      syslog(LOG_INFO, "failed to write to device %s", device);
-      errno = err;
-    }
     return -1;
   }
 
@@ -1329,13 +1420,19 @@ void usage() {
   fprintf(stderr,
           "fand [-v] [-l <low-pct>] [-m <medium-pct>] "
           "[-h <high-pct>]\n"
-          "\t[-b <temp-bottom>] [-t <temp-top>] [-r <report-temp>]\n\n"
+          "\t[-b <temp-bottom>] [-t <temp-top>] [-r <report-temp>] "
+          "[-i <interval-ms>]\n"
+          "\t[-p <setpoint>[,<kp>,<ki>,<kd>,<feed-forward>]]\n\n"
           "\tlow-pct defaults to %d%% fan\n"
           "\tmedium-pct defaults to %d%% fan\n"
           "\thigh-pct defaults to %d%% fan\n"
           "\ttemp-bottom defaults to %dC\n"
           "\ttemp-top defaults to %dC\n"
-          "\treport-temp defaults to every %d measurements\n\n"
+          "\treport-temp defaults to every %d measurements\n"
+          "\tinterval-ms defaults to %d ms (at least %d ms)\n"
+          "\t-p controls the fans by PID to the critical temp setpoint,\n"
+          "\t   instead of the step tables (defaults %.2f, %.2f, %.2f, "
+          "%d%%..%d%%)\n\n"
           "fand compensates for uServer temperature reading %d degrees low\n"
           "kill with SIGUSR1 to stop watchdog\n",
           fan_low,
@@ -1344,6 +1441,13 @@ void usage() {
           EXTERNAL_TEMPS(temp_bottom),
           EXTERNAL_TEMPS(temp_top),
           report_temp,
+          CONTROL_INTERVAL_MS,
+          CONTROL_INTERVAL_MIN_MS,
+          FAN_PID_KP,
+          FAN_PID_KI,
+          FAN_PID_KD,
+          fan_low,
+          fan_high,
           EXTERNAL_TEMPS(USERVER_TEMP_FUDGE));
   exit(1);
 }
@@ -1438,6 +1542,11 @@ int main(int argc, char **argv) {
 
   int fan_bad[FANS];
   int fan;
+  int interval_ms = CONTROL_INTERVAL_MS;
+  int since_check_ms = 0;
+  int since_change_ms = 0;
+  struct fan_pid pid;
+  const char *pid_arg = NULL;
 
   int sysfs_rc = 0;
   int sysfs_value = 0;
@@ -1454,7 +1563,7 @@ int main(int argc, char **argv) {
   // Start writing to syslog as early as possible for diag purposes.
   openlog("fand", LOG_CONS, LOG_DAEMON);
 
-  while ((opt = getopt(argc, argv, "l:m:h:b:t:r:v")) != -1) {
+  while ((opt = getopt(argc, argv, "l:m:h:b:t:r:i:p:v")) != -1) {
     switch (opt) {
     case 'l':
       fan_low = atoi(optarg);
@@ -1474,6 +1583,14 @@ int main(int argc, char **argv) {
     case 'r':
       report_temp = atoi(optarg);
       break;
+    case 'i':
+      interval_ms = atoi(optarg);
+      if (interval_ms < CONTROL_INTERVAL_MIN_MS)
+        interval_ms = CONTROL_INTERVAL_MIN_MS;
+      break;
+    case 'p':
+      pid_arg = optarg;
+      break;
     case 'v':
       verbose = true;
       break;
@@ -1487,6 +1604,12 @@ int main(int argc, char **argv) {
     usage();
   }
 
+  /* The limits are known once -l/-h are parsed */
+  fan_pid_init(&pid, 0, fan_low, fan_high);
+  if (pid_arg != NULL && fan_pid_parse(&pid, pid_arg) != 0) {
+    usage();
+  }
+
   if (temp_bottom > temp_top) {
     fprintf(stderr,
             "Should temp-bottom (%d) be higher than "
@@ -1573,25 +1696,30 @@ int main(int argc, char **argv) {
     }
 
     /*
-     * Calculate change needed -- we should eventually
-     * do something more sophisticated, like PID.
+     * Calculate change needed: by PID to the setpoint with -p,
+     * otherwise by the raising/falling step tables.
      *
      * We should use the intake temperature to adjust this
      * as well.
      */
 
-    /* Other systems use a simpler built-in table to determine fan speed. */
-    raising_pwm = calculate_raising_fan_pwm(critical_temp);
-    falling_pwm = calculate_falling_fan_pwm(critical_temp);
-    if(old_temp <= critical_temp) {
-      /*raising*/
-      if(raising_pwm >= fan_speed) {
-        fan_speed = raising_pwm;
-      }
+    if (pid_arg != NULL) {
+      fan_speed = fan_pid_update(&pid, critical_temp, interval_ms / 1000.0f,
+                                 fan_speed);
     } else {
-      /*falling*/
-      if(falling_pwm <= fan_speed ) {
-        fan_speed = falling_pwm;
+      /* Other systems use a simpler built-in table to determine fan speed. */
+      raising_pwm = calculate_raising_fan_pwm(critical_temp);
+      falling_pwm = calculate_falling_fan_pwm(critical_temp);
+      if(old_temp <= critical_temp) {
+        /*raising*/
+        if(raising_pwm >= fan_speed) {
+          fan_speed = raising_pwm;
+        }
+      } else {
+        /*falling*/
+        if(falling_pwm <= fan_speed ) {
+          fan_speed = falling_pwm;
+        }
       }
     }
     old_temp = critical_temp;
@@ -1611,6 +1739,7 @@ int main(int argc, char **argv) {
       for (fan = 0; fan < total_fans; fan++) {
         write_fan_speed(fan + fan_offset, fan_speed);
       }
+      since_change_ms = 0;
     }
     /*
      * Wait for some change.  Typical I2C temperature sensors
@@ -1621,7 +1750,16 @@ int main(int argc, char **argv) {
      * before measuring them.
      */
 
-    sleep(5);
+    usleep(interval_ms * 1000);
+    since_check_ms += interval_ms;
+    since_change_ms += interval_ms;
+    if (since_check_ms < FAN_CHECK_INTERVAL_MS ||
+        (since_change_ms < FAN_CHECK_INTERVAL_MS &&
+         since_check_ms < FAN_CHECK_MAX_DELAY_MS)) {
+      kick_watchdog();
+      continue;
+    }
+    since_check_ms = 0;
     galaxy100_lc_present_detect();
     galaxy100_scm_present_detect();
 
@@ -1709,13 +1847,14 @@ int main(int argc, char **argv) {
 #endif
         fan_failed += not_present * 3;
         if(fan_failed > 0 && fan_failed <= 3) {
-          if(fan_speed == GALAXY100_FAN_LOW) {
+          /* PID speeds fall between the steps: use the next step up */
+          if(fan_speed <= GALAXY100_FAN_LOW) {
             failed_speed = galaxy100_fan_failed_control[fan_failed - 1].low_level;
-          } else if(fan_speed == GALAXY100_FAN_MEDIUM) {
+          } else if(fan_speed <= GALAXY100_FAN_MEDIUM) {
             failed_speed = galaxy100_fan_failed_control[fan_failed - 1].mid_level;
-          } else if(fan_speed == GALAXY100_FAN_HIGH) {
+          } else if(fan_speed <= GALAXY100_FAN_HIGH) {
             failed_speed = galaxy100_fan_failed_control[fan_failed - 1].high_level;
-          } else if(fan_speed == GALAXY100_FAN_MAX) {
+          } else {
             failed_speed = galaxy100_fan_failed_control[fan_failed - 1].alarm_level;
           }
         } else {
@@ -1724,6 +1863,7 @@ int main(int argc, char **argv) {
         for (fan = 0; fan < total_fans; fan++) {
           write_fan_speed(fan + fan_offset, failed_speed);
         }
+        since_change_ms = 0;
       }
 
       /*
@@ -1738,6 +1878,7 @@ int main(int argc, char **argv) {
       for (fan = 0; fan < total_fans; fan++) {
         write_fan_speed(fan + fan_offset, fan_speed);
       }
+      since_change_ms = 0;
     }
     /* Suppress multiple warnings for similar number of fan failures. */
     prev_fans_bad = fan_failure;
@@ -21,7 +21,10 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <syslog.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <openbmc/libgpio.h>
+#include <openbmc/obmc-i2c.h>
 #include "asic.h"
 #include "amd.h"
 #include "nvidia.h"
@@ -35,6 +38,7 @@ struct asic_ops {
   int (*set_power_limit)(uint8_t, unsigned int);
   int (*get_power_limit)(uint8_t, unsigned int*);
   int (*show_ver)(uint8_t, char*);
+  int (*read_telemetry)(uint8_t, struct asic_telemetry*);
 } ops[MFR_MAX_NUM] = {
   [GPU_AMD] = {
     .get_gpu_id = amd_get_id,
@@ -44,7 +48,8 @@ struct asic_ops {
     .read_pwcs = amd_read_pwcs,
     .set_power_limit = NULL,
     .get_power_limit = NULL,
-    .show_ver = NULL
+    .show_ver = NULL,
+    .read_telemetry = NULL
   },
   [GPU_NVIDIA] = {
     .get_gpu_id = nv_get_id,
@@ -54,10 +59,48 @@ struct asic_ops {
     .read_pwcs = nv_read_pwcs,
     .set_power_limit = nv_set_power_limit,
     .get_power_limit = nv_get_power_limit,
-    .show_ver = nv_show_vbios_ver
+    .show_ver = nv_show_vbios_ver,
+    .read_telemetry = nv_read_telemetry
   }
 };
 
+#define ASIC_SLOT_MAX 8
+
+static struct {
+  pthread_mutex_t lock;
+  int fd;
+  uint8_t addr;
+} slots[ASIC_SLOT_MAX] = {
+  [0 ... ASIC_SLOT_MAX-1] = {PTHREAD_MUTEX_INITIALIZER, -1, 0}
+};
+
+int asic_slot_get(uint8_t slot, uint8_t addr)
+{
+  if (slot >= ASIC_SLOT_MAX)
+    return -1;
+
+  pthread_mutex_lock(&slots[slot].lock);
+  if (slots[slot].fd >= 0 && slots[slot].addr != addr) {
+    close(slots[slot].fd);
+    slots[slot].fd = -1;
+  }
+  if (slots[slot].fd < 0) {
+    slots[slot].fd = i2c_cdev_slave_open((int)slot + 20, addr, 0);
+    slots[slot].addr = addr;
+  }
+  if (slots[slot].fd < 0) {
+    pthread_mutex_unlock(&slots[slot].lock);
+    return -1;
+  }
+  return slots[slot].fd;
+}
+
+void asic_slot_put(uint8_t slot)
+{
+  if (slot < ASIC_SLOT_MAX)
+    pthread_mutex_unlock(&slots[slot].lock);
+}
+
 uint8_t asic_get_vendor_id(uint8_t slot)
 {
   static uint8_t vendor_id[8] = {
@@ -182,6 +225,31 @@ int asic_get_power_limit(uint8_t slot, unsigned int *value)
   return ops[vendor].get_power_limit(slot, value);
 }
 
+int asic_read_telemetry(uint8_t slot, struct asic_telemetry *telem)
+{
+  uint8_t vendor = asic_get_vendor_id(slot);
+
+  if (vendor == GPU_UNKNOWN)
+    return ASIC_NOTSUP;
+  if (ops[vendor].read_telemetry)
+    return ops[vendor].read_telemetry(slot, telem);
+
+  // One sensor at a time otherwise
+  telem->valid = 0;
+  if (asic_read_gpu_temp(slot, &telem->gpu_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_GPU_TEMP;
+  if (asic_read_board_temp(slot, &telem->board_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_BOARD_TEMP;
+  if (asic_read_mem_temp(slot, &telem->mem_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_MEM_TEMP;
+  if (asic_read_pwcs(slot, &telem->pwcs) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_PWCS;
+  if (asic_get_power_limit(slot, &telem->power_limit) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_POWER_LIMIT;
+
+  return telem->valid ? ASIC_SUCCESS : ASIC_ERROR;
+}
+
 int asic_show_version(uint8_t slot, char *ver)
 {
   uint8_t vendor = asic_get_vendor_id(slot);
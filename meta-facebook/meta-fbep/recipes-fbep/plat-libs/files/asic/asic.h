@@ -45,6 +45,22 @@ enum {
   ASIC_NOTSUP = -2
 };
 
+// Fields of struct asic_telemetry that were read
+#define ASIC_TELEM_GPU_TEMP     (1 << 0)
+#define ASIC_TELEM_BOARD_TEMP   (1 << 1)
+#define ASIC_TELEM_MEM_TEMP     (1 << 2)
+#define ASIC_TELEM_PWCS         (1 << 3)
+#define ASIC_TELEM_POWER_LIMIT  (1 << 4)
+
+struct asic_telemetry {
+  uint32_t valid;            // ASIC_TELEM_*
+  float gpu_temp;
+  float board_temp;
+  float mem_temp;
+  float pwcs;
+  unsigned int power_limit;  // W
+};
+
 uint8_t asic_get_vendor_id(uint8_t);
 int asic_read_gpu_temp(uint8_t, float*);
 int asic_read_board_temp(uint8_t, float*);
@@ -54,6 +70,15 @@ bool is_asic_prsnt(uint8_t);
 int asic_set_power_limit(uint8_t, unsigned int);
 int asic_get_power_limit(uint8_t, unsigned int*);
 int asic_show_version(uint8_t, char*);
+// All the sensors of the slot at once, ASIC_SUCCESS if any was read
+int asic_read_telemetry(uint8_t, struct asic_telemetry*);
+
+// For the vendor modules: the fd of the slot for the device at the 7-bit
+// address, kept open by the process. The slot is locked till
+// asic_slot_put(), so a message-box session is not interleaved with
+// another thread's. Returns -1 (slot not locked) on failures.
+int asic_slot_get(uint8_t, uint8_t);
+void asic_slot_put(uint8_t);
 
 #ifdef __cplusplus
 } // extern "C"
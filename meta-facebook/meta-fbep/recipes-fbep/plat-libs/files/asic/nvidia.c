@@ -20,13 +20,23 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
 #include <openbmc/obmc-i2c.h>
 #include "asic.h"
 
 #define SMBPBI_MAX_RETRY 5
 
+// A command is polled for till its status is final, the retries of a
+// failed command are spaced out
+#define SMBPBI_STATUS_TIMEOUT_US 250000
+#define SMBPBI_STATUS_POLL_US    2000
+#define SMBPBI_RETRY_DELAY_US    50000
+
 #define SMBPBI_STATUS_MASK      0x1F
 
+#define SMBPBI_STATUS_NULL      0x00
+
 #define SMBPBI_STATUS_ACCEPTED  0x1C
 #define SMBPBI_STATUS_INACTIVE  0x1D
 #define SMBPBI_STATUS_READY     0x1E
@@ -80,7 +90,20 @@
 
 static int nv_open_slot(uint8_t slot)
 {
-  return i2c_cdev_slave_open((int)slot + 20, NV_GPU_ADDR, 0);
+  return asic_slot_get(slot, NV_GPU_ADDR);
+}
+
+static void nv_close_slot(uint8_t slot)
+{
+  asic_slot_put(slot);
+}
+
+static long long nv_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 static int nv_msgbox_write_reg(int fd, uint8_t opcode, uint8_t arg1, uint8_t arg2)
@@ -133,26 +156,31 @@ static uint8_t nv_get_status(int fd)
 {
   uint8_t buf[4] = {0};
 
-  usleep(50000);
   if (nv_msgbox_read_reg(fd, buf) < 0)
     return SMBPBI_STATUS_INACTIVE;
 
   return buf[3] & SMBPBI_STATUS_MASK; // reg[28:24]
 }
 
+// Polls the status of the command just written till it is done, failed
+// (error status) or SMBPBI_STATUS_TIMEOUT_US passed
 static int nv_check_status(int fd, uint8_t opcode)
 {
-  int retry = SMBPBI_MAX_RETRY;
+  long long deadline = nv_now_us() + SMBPBI_STATUS_TIMEOUT_US;
   uint8_t status;
 
-  while (retry--) {
+  do {
     status = nv_get_status(fd);
-    if (status != SMBPBI_STATUS_SUCCESS &&
-        (opcode != SMBPBI_ASYNC_REQUEST || status != SMBPBI_STATUS_ACCEPTED)) {
-      continue;
+    if (status == SMBPBI_STATUS_SUCCESS ||
+        (opcode == SMBPBI_ASYNC_REQUEST && status == SMBPBI_STATUS_ACCEPTED)) {
+      return 0;
     }
-    return 0;
-  }
+    // Anything below ACCEPTED but NULL (not processed yet) is an error code
+    if (status != SMBPBI_STATUS_NULL && status < SMBPBI_STATUS_ACCEPTED)
+      return -1;
+    usleep(SMBPBI_STATUS_POLL_US);
+  } while (nv_now_us() < deadline);
+
   return -1;
 }
 
@@ -160,9 +188,12 @@ static int nv_msgbox_cmd(int fd, uint8_t opcode, uint8_t arg1, uint8_t arg2,
                          uint8_t* data_in, uint8_t* data_out)
 {
   int retry = SMBPBI_MAX_RETRY;
+  bool first = true;
 
   while (retry--) {
-    usleep(50000);
+    if (!first)
+      usleep(SMBPBI_RETRY_DELAY_US);
+    first = false;
     if (data_in && nv_msgbox_write_data(fd, data_in) < 0)
       continue;
     if (nv_msgbox_write_reg(fd, opcode, arg1, arg2) < 0)
@@ -202,113 +233,76 @@ uint8_t nv_get_id(uint8_t slot)
   if (ret == NVIDIA_ID)
     id = GPU_NVIDIA;
 
-  close(fd);
+  nv_close_slot(slot);
   return id;
 }
 
-static float nv_read_temp(uint8_t slot, uint8_t sensor, float *temp)
+static uint32_t nv_temp_cap(uint8_t sensor)
 {
-  int fd, value;
-  uint32_t cap_mask;
-  uint8_t buf[4] = {0};
-
   switch (sensor) {
     case SMBPBI_GPU0_TEMP:
-      cap_mask = SMBPBI_CAP_GPU0_TEMP;
-      break;
+      return SMBPBI_CAP_GPU0_TEMP;
     case SMBPBI_BOARD_TEMP:
-      cap_mask = SMBPBI_CAP_BOARD_TEMP;
-      break;
+      return SMBPBI_CAP_BOARD_TEMP;
     case SMBPBI_MEM_TEMP:
-      cap_mask = SMBPBI_CAP_MEM_TEMP;
-      break;
-    default:
-      return ASIC_ERROR;
+      return SMBPBI_CAP_MEM_TEMP;
   };
+  return 0;
+}
 
-  fd = nv_open_slot(slot);
-  if (fd < 0)
-    return ASIC_ERROR;
+// Reads of an open session, with the capabilities (page 0) read by the caller
+static int nv_session_read_temp(int fd, uint32_t cap, uint8_t sensor, float *temp)
+{
+  int value;
+  uint32_t cap_mask = nv_temp_cap(sensor);
+  uint8_t buf[4] = {0};
 
-  if (!(nv_get_cap(fd, 0) & cap_mask))
-    goto err;
+  if (!cap_mask || !(cap & cap_mask))
+    return ASIC_ERROR;
 
   if (nv_msgbox_cmd(fd, SMBPBI_GET_TEMPERATURE, sensor, 0x0, NULL, buf) < 0)
-    goto err;
+    return ASIC_ERROR;
 
-  close(fd);
   memcpy(&value, buf, sizeof(value));
   value = value >> 8;  // Remove fractional bits(7:0 all zero)
   *temp = (float)value;
 
   return ASIC_SUCCESS;
-
-err:
-  close(fd);
-  return ASIC_ERROR;
-}
-
-int nv_read_gpu_temp(uint8_t slot, float *value)
-{
-  return nv_read_temp(slot, SMBPBI_GPU0_TEMP, value);
-}
-
-int nv_read_board_temp(uint8_t slot, float *value)
-{
-  return nv_read_temp(slot, SMBPBI_BOARD_TEMP, value);
 }
 
-int nv_read_mem_temp(uint8_t slot, float *value)
+static int nv_session_read_pwcs(int fd, uint32_t cap, float *pwcs)
 {
-  return nv_read_temp(slot, SMBPBI_MEM_TEMP, value);
-}
-
-int nv_read_pwcs(uint8_t slot, float *pwcs)
-{
-  int fd = nv_open_slot(slot);
   uint8_t buf[4] = {0};
   uint32_t value;
 
-  if (fd < 0)
+  if (!(cap & SMBPBI_CAP_PWCS))
     return ASIC_ERROR;
 
-  if (!(nv_get_cap(fd, 0) & SMBPBI_CAP_PWCS))
-    goto err;
-
   if (nv_msgbox_cmd(fd, SMBPBI_GET_POWER, SMBPBI_TOTAL_PWCS, 0x0, NULL, buf) < 0)
-    goto err;
+    return ASIC_ERROR;
 
-  close(fd);
   memcpy(&value, buf, 4);
 
   *pwcs = (float)value / 1000; // mW -> W
   return ASIC_SUCCESS;
-
-err:
-  close(fd);
-  return ASIC_ERROR;
 }
 
-int nv_get_power_limit(uint8_t slot, unsigned int *watt)
+static int nv_session_get_power_limit(int fd, unsigned int *watt)
 {
-  int fd, retry = SMBPBI_MAX_RETRY;
+  int retry = SMBPBI_MAX_RETRY;
   uint8_t rbuf[4];
   uint8_t async_id;
   uint8_t offset = 0x1;
 
-  fd = nv_open_slot(slot);
-  if (fd < 0)
-    return ASIC_ERROR;
-
   // Request GPU to write data into scratch memory at offset 0x0
   if (nv_msgbox_cmd(fd, SMBPBI_ASYNC_REQUEST, SMBPBI_GET_POWER_LIMIT, offset, NULL, rbuf) < 0)
-    goto err;
+    return ASIC_ERROR;
 
   async_id = rbuf[0];
   // Retry if needed
   while (retry--) {
     if (nv_msgbox_cmd(fd, SMBPBI_ASYNC_REQUEST, SMBPBI_ASYNC_POLLREQ, async_id, NULL, rbuf) < 0)
-      goto err;
+      return ASIC_ERROR;
     if (rbuf[0] == ASYNC_STATUS_MORE_PROC || rbuf[0] == ASYNC_STATUS_TIMEOUT ||
         rbuf[0] == ASYNC_STATUS_NOT_READY || rbuf[0] == ASYNC_STATUS_IN_RESET ||
         rbuf[0] == ASYNC_STATUS_BUSY_RETRY ) {
@@ -316,21 +310,99 @@ int nv_get_power_limit(uint8_t slot, unsigned int *watt)
     }
     if (rbuf[0] == ASYNC_STATUS_SUCCESS) {
       if (nv_msgbox_cmd(fd, SMBPBI_READ_SCRMEM, offset, 0x0, NULL, rbuf) < 0)
-        goto err;
+        return ASIC_ERROR;
 
       memcpy(watt, rbuf, 4);
       *watt /= 1000;
-      close(fd);
       return ASIC_SUCCESS;
     }
     break;
   }
 
-err:
-  close(fd);
   return ASIC_ERROR;
 }
 
+static int nv_read_temp(uint8_t slot, uint8_t sensor, float *temp)
+{
+  int fd, ret;
+
+  fd = nv_open_slot(slot);
+  if (fd < 0)
+    return ASIC_ERROR;
+
+  ret = nv_session_read_temp(fd, nv_get_cap(fd, 0), sensor, temp);
+  nv_close_slot(slot);
+  return ret;
+}
+
+int nv_read_gpu_temp(uint8_t slot, float *value)
+{
+  return nv_read_temp(slot, SMBPBI_GPU0_TEMP, value);
+}
+
+int nv_read_board_temp(uint8_t slot, float *value)
+{
+  return nv_read_temp(slot, SMBPBI_BOARD_TEMP, value);
+}
+
+int nv_read_mem_temp(uint8_t slot, float *value)
+{
+  return nv_read_temp(slot, SMBPBI_MEM_TEMP, value);
+}
+
+int nv_read_pwcs(uint8_t slot, float *pwcs)
+{
+  int fd, ret;
+
+  fd = nv_open_slot(slot);
+  if (fd < 0)
+    return ASIC_ERROR;
+
+  ret = nv_session_read_pwcs(fd, nv_get_cap(fd, 0), pwcs);
+  nv_close_slot(slot);
+  return ret;
+}
+
+// Everything of the slot in one session: the capabilities are read once
+int nv_read_telemetry(uint8_t slot, struct asic_telemetry *telem)
+{
+  int fd;
+  uint32_t cap;
+
+  fd = nv_open_slot(slot);
+  if (fd < 0)
+    return ASIC_ERROR;
+
+  telem->valid = 0;
+  cap = nv_get_cap(fd, 0);
+  if (nv_session_read_temp(fd, cap, SMBPBI_GPU0_TEMP, &telem->gpu_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_GPU_TEMP;
+  if (nv_session_read_temp(fd, cap, SMBPBI_BOARD_TEMP, &telem->board_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_BOARD_TEMP;
+  if (nv_session_read_temp(fd, cap, SMBPBI_MEM_TEMP, &telem->mem_temp) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_MEM_TEMP;
+  if (nv_session_read_pwcs(fd, cap, &telem->pwcs) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_PWCS;
+  if (nv_session_get_power_limit(fd, &telem->power_limit) == ASIC_SUCCESS)
+    telem->valid |= ASIC_TELEM_POWER_LIMIT;
+
+  nv_close_slot(slot);
+  return telem->valid ? ASIC_SUCCESS : ASIC_ERROR;
+}
+
+int nv_get_power_limit(uint8_t slot, unsigned int *watt)
+{
+  int fd, ret;
+
+  fd = nv_open_slot(slot);
+  if (fd < 0)
+    return ASIC_ERROR;
+
+  ret = nv_session_get_power_limit(fd, watt);
+  nv_close_slot(slot);
+  return ret;
+}
+
 int nv_set_power_limit(uint8_t slot, unsigned int watt)
 {
   int fd, retry = SMBPBI_MAX_RETRY;
@@ -373,14 +445,14 @@ int nv_set_power_limit(uint8_t slot, unsigned int watt)
       continue;
     }
     if (rbuf[0] == ASYNC_STATUS_SUCCESS) {
-      close(fd);
+      nv_close_slot(slot);
       return ASIC_SUCCESS;
     }
     break;
   }
 
 err:
-  close(fd);
+  nv_close_slot(slot);
   return ASIC_ERROR;
 }
 
@@ -398,7 +470,7 @@ int nv_show_vbios_ver(uint8_t slot, char *ver)
   // Add retry as workaround here
   while (retry--) {
     if (!(nv_get_cap(fd, 1) & SMBPBI_CAP_FW_VER))
-      continue;
+      usleep(SMBPBI_RETRY_DELAY_US);
     else
       break;
   }
@@ -411,10 +483,10 @@ int nv_show_vbios_ver(uint8_t slot, char *ver)
   }
 
   memcpy(ver, buf, 14);
-  close(fd);
+  nv_close_slot(slot);
   return ASIC_SUCCESS;
 
 err:
-  close(fd);
+  nv_close_slot(slot);
   return ASIC_ERROR;
 }
@@ -33,6 +33,7 @@ int nv_read_pwcs(uint8_t, float*);
 int nv_set_power_limit(uint8_t, unsigned int);
 int nv_get_power_limit(uint8_t, unsigned int*);
 int nv_show_vbios_ver(uint8_t, char*);
+int nv_read_telemetry(uint8_t, struct asic_telemetry*);
 
 #ifdef __cplusplus
 } // extern "C"
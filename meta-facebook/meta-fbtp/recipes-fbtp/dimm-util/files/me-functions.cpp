@@ -161,10 +161,12 @@ util_set_EE_page(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t page_num)
   return ret;
 }
 
-// read 1 byte off SPD bus,
-// input:  cpu/dimm/addr_msb/addr_lsb/offset
+// read 1, 2 or 4 bytes off SPD bus,
+// input:  cpu/dimm/addr_msb/addr_lsb/offset/len
+// returns the number of bytes read into buf
 int
-util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
+util_read_spd(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset,
+              uint8_t len, uint8_t *buf)
 {
 // 7 bytes IPMB header + 3 bytes INTEL ID + 1 byte payload + 1 byte checksum
   constexpr size_t min_resp_len = (7 + INTEL_ID_LEN + 1 + 1 /* payload*/);
@@ -175,9 +177,15 @@ util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
   uint8_t rlen = 0;
   int addr_msb = 0;
   int addr_lsb = 0;
+  uint8_t read_len;
 
   ipmb_req_t *req = (ipmb_req_t*)tbuf;;
 
+  if (len == 0)
+    return -1;
+  // ME reads a byte, a word or a dword (read length 0, 1, 3)
+  read_len = (len >= 4) ? 4 : ((len >= 2) ? 2 : 1);
+
   // calculate DIMM msb_addr
   //   msb_addr is 0 for dimms 0-3,  1 for 4-7
   if (dimm >= (MAX_DIMM_NUM_FBTP/2))
@@ -207,7 +215,7 @@ util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
   tbuf[tlen++] = addr_msb;
   tbuf[tlen++] = addr_lsb;
   tbuf[tlen++] = offset;
-  tbuf[tlen++] = 0;
+  tbuf[tlen++] = read_len - 1;
 
   // Invoke IPMB library handler
   lib_ipmb_handle(ME_BUS_ADDR, tbuf, tlen+1, rbuf, &rlen);
@@ -220,13 +228,25 @@ util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
   DBG_PRINT("\n");
 #endif
 
-  if (rlen < min_resp_len) {
+  if (rlen < min_resp_len - 1 + read_len) {
     return -1;
   }
 
-  // actual SPD payload will be last byte following all IANA header and
-  //  completion codes
-  return rbuf[min_resp_len - 2];
+  // actual SPD payload follows all IANA header and completion codes
+  memcpy(buf, &rbuf[min_resp_len - 2], read_len);
+  return read_len;
+}
+
+// read 1 byte off SPD bus,
+// input:  cpu/dimm/addr_msb/addr_lsb/offset
+int
+util_read_spd_byte(uint8_t fru_id, uint8_t cpu, uint8_t dimm, uint8_t offset)
+{
+  uint8_t value;
+
+  if (util_read_spd(fru_id, cpu, dimm, offset, 1, &value) != 1)
+    return -1;
+  return value;
 }
 
 int
@@ -460,39 +460,9 @@ read_gp_nvme_data(uint8_t slot_id, uint8_t drv_num, uint8_t cmd) {
     printf("Glacier Point %u Drive%d\n", slot_id, drv_num);
 
     do {
-      ret = nvme_sflgs_read(device, &ssd.sflgs);
+      ret = nvme_ssd_data_read(device, &ssd, false);
       if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_sflgs_read failed", __func__);
-        break;
-      }
-
-      ret = nvme_smart_warning_read(device, &ssd.warning);
-      if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_smart_warning_read failed", __func__);
-        break;
-      }
-
-      ret = nvme_temp_read(device, &ssd.temp);
-      if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_temp_read failed", __func__);
-        break;
-      }
-
-      ret = nvme_pdlu_read(device, &ssd.pdlu);
-      if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_pdlu_read failed", __func__);
-        break;
-      }
-
-      ret = nvme_vendor_read(device, &ssd.vendor);
-      if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_vendor_read failed", __func__);
-        break;
-      }
-
-      ret = nvme_serial_num_read(device, ssd.serial_num, MAX_SERIAL_NUM);
-      if (ret != 0) {
-        syslog(LOG_DEBUG, "%s(): nvme_serial_num_read failed", __func__);
+        syslog(LOG_DEBUG, "%s(): nvme_ssd_data_read failed", __func__);
         break;
       }
 
@@ -505,13 +475,8 @@ read_gp_nvme_data(uint8_t slot_id, uint8_t drv_num, uint8_t cmd) {
   else if (cmd == CMD_DRIVE_HEALTH) {
     memset(&ssd, 0x00, sizeof(ssd_data));
 
-    if (nvme_sflgs_read(device, &ssd.sflgs)) {
-      syslog(LOG_DEBUG, "%s(): nvme_sflgs_read failed", __func__);
-      return -1;
-    }
-
-    if (nvme_smart_warning_read(device, &ssd.warning)) {
-      syslog(LOG_DEBUG, "%s(): nvme_smart_warning_read failed", __func__);
+    if (nvme_ssd_data_read(device, &ssd, false)) {
+      syslog(LOG_DEBUG, "%s(): nvme_ssd_data_read failed", __func__);
       return -1;
     }
 
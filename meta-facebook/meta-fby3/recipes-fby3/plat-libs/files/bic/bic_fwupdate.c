@@ -1118,12 +1118,13 @@ exit:
 static int
 update_fw_bic_bootloader(uint8_t slot_id, uint8_t comp, uint8_t intf, int fd, int file_size) {
   uint8_t bytes_per_read = IPMB_MAX_SEND;
-  uint8_t buf[256] = {0};
-  uint16_t buf_size = sizeof(buf);
-  uint16_t read_bytes = 0;
+  uint8_t *buf = NULL;
   uint32_t offset = 0;
   uint32_t last_offset = 0;
   uint32_t dsize = 0;
+  uint32_t count, last_count, segment;
+  ssize_t read_bytes = 0;
+  int window;
   int ret = -1, retry = IPMB_BIC_RETRY;
   uint8_t self_test_result[2] = {0};
   uint8_t bmc_location = 0;
@@ -1145,29 +1146,62 @@ update_fw_bic_bootloader(uint8_t slot_id, uint8_t comp, uint8_t intf, int fd, in
     bytes_per_read -= IPMB_BRIDGE_OVERHEAD;
   }
 
-  printf("Update BIC bootloader\n");
-  while (1) {
-    memset(buf, 0, buf_size);
-    read_bytes = read(fd, buf, bytes_per_read);
-    if ( read_bytes <= 0 ) {
-      //no more bytes can be read
+  if (file_size <= 0) {
+    return -1;
+  }
+  buf = malloc(file_size);
+  if (buf == NULL) {
+    printf("Failed to allocate memory\n");
+    return -1;
+  }
+  while (offset < file_size) {
+    read_bytes = read(fd, buf + offset, file_size - offset);
+    if ((read_bytes < 0) && (errno == EINTR)) {
+      continue;
+    }
+    if (read_bytes <= 0) {
       break;
     }
+    offset += read_bytes;
+  }
+  if (offset < file_size) {
+    printf("Failed to read the image\n");
+    free(buf);
+    return -1;
+  }
+
+  // The chunks go with up to <window> of them in flight, in segments of
+  // 5% for the progress; the last chunk is sent after all the others
+  window = get_image_data_window();
+  last_count = (file_size - 1) % bytes_per_read + 1;
+  segment = (dsize / bytes_per_read + 1) * bytes_per_read;
+  offset = 0;
 
-    if ((offset + read_bytes) >= file_size) {
-      comp |= 0x80;
+  printf("Update BIC bootloader\n");
+  while (1) {
+    if (offset + last_count < file_size) {
+      count = file_size - last_count - offset;
+      if (count > segment) {
+        count = segment;
+      }
+      ret = send_image_data_window_via_bic(slot_id, comp, intf, offset, count, bytes_per_read, 0x0, buf + offset, window);
+    } else {
+      count = last_count;
+      ret = send_image_data_via_bic(slot_id, comp | 0x80, intf, offset, count, 0x0, buf + offset);
     }
-    ret = send_image_data_via_bic(slot_id, comp, intf, offset, read_bytes, 0x0, buf);
     if (ret != BIC_STATUS_SUCCESS)
       break;
 
-    offset += read_bytes;
+    offset += count;
     if ((last_offset + dsize) <= offset) {
       printf("updated bic bootloader: %d %%\n", (offset/dsize)*5);
       fflush(stdout);
       last_offset += dsize;
     }
+    if (offset >= file_size)
+      break;
   }
+  free(buf);
 
   // Wait for warm reset finished
   sleep(3);
@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -390,6 +391,121 @@ send_image_data_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t of
   return ret;
 }
 
+
+/*
+ * Image chunks sent by send_image_data_window_via_bic(): the BIC answers
+ * every chunk on its own, so several chunks are kept in flight through
+ * ipmbd by one sender thread each. A chunk that fails is retried alone by
+ * send_image_data_via_bic() while the others go on.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  uint8_t slot_id;
+  uint8_t comp;
+  uint8_t intf;
+  uint32_t offset;
+  uint32_t len;
+  uint16_t chunk_len;
+  uint32_t image_len;
+  uint8_t *buf;
+  uint32_t next;  // position in buf of the next chunk to send
+  int ret;
+} image_window_t;
+
+static void *
+image_window_sender(void *arg) {
+  image_window_t *w = (image_window_t *)arg;
+  uint32_t pos, count;
+  int ret;
+
+  while (1) {
+    pthread_mutex_lock(&w->lock);
+    if (w->ret != BIC_STATUS_SUCCESS || w->next >= w->len) {
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    pos = w->next;
+    count = w->len - pos;
+    if (count > w->chunk_len) {
+      count = w->chunk_len;
+    }
+    w->next += count;
+    pthread_mutex_unlock(&w->lock);
+
+    ret = send_image_data_via_bic(w->slot_id, w->comp, w->intf, w->offset + pos, count, w->image_len, w->buf + pos);
+    if (ret != BIC_STATUS_SUCCESS) {
+      pthread_mutex_lock(&w->lock);
+      if (w->ret == BIC_STATUS_SUCCESS) {
+        w->ret = ret;
+      }
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+  }
+  return NULL;
+}
+
+int
+get_image_data_window(void) {
+  const char *env = getenv("FW_UTIL_IPMB_WINDOW");
+  int window = IMAGE_DATA_WINDOW;
+
+  if (env != NULL) {
+    window = atoi(env);
+  }
+  if (window < 1) {
+    window = 1;
+  } else if (window > IMAGE_DATA_WINDOW_MAX) {
+    window = IMAGE_DATA_WINDOW_MAX;
+  }
+  return window;
+}
+
+int
+send_image_data_window_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint16_t chunk_len, uint32_t image_len, uint8_t *buf, int window)
+{
+  image_window_t w = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .slot_id = slot_id,
+    .comp = comp,
+    .intf = intf,
+    .offset = offset,
+    .len = len,
+    .chunk_len = chunk_len,
+    .image_len = image_len,
+    .buf = buf,
+    .next = 0,
+    .ret = BIC_STATUS_SUCCESS,
+  };
+  pthread_t tid[IMAGE_DATA_WINDOW_MAX];
+  int i, num = 0;
+
+  if (chunk_len == 0) {
+    return BIC_STATUS_FAILURE;
+  }
+  if (window > IMAGE_DATA_WINDOW_MAX) {
+    window = IMAGE_DATA_WINDOW_MAX;
+  }
+  if (window > (len + chunk_len - 1) / chunk_len) {
+    window = (len + chunk_len - 1) / chunk_len;
+  }
+
+  // The calling thread is one of the senders, the stop-and-wait one
+  // with a window of 1.
+  for (i = 1; i < window; i++) {
+    if (pthread_create(&tid[num], NULL, image_window_sender, &w) != 0) {
+      syslog(LOG_WARNING, "%s() sending with %d chunks in flight", __func__, num + 1);
+      break;
+    }
+    num++;
+  }
+  image_window_sender(&w);
+  for (i = 0; i < num; i++) {
+    pthread_join(tid[i], NULL);
+  }
+
+  return w.ret;
+}
 int
 open_and_get_size(char *path, int *file_size) {
   struct stat finfo;
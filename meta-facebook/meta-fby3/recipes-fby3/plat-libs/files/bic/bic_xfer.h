@@ -34,6 +34,10 @@ extern "C" {
 #define MIN_IPMB_BYPASS_LEN 6
 extern const uint32_t IANA_ID;
 
+//Image chunks in flight of a windowed update, FW_UTIL_IPMB_WINDOW overrides
+#define IMAGE_DATA_WINDOW 4
+#define IMAGE_DATA_WINDOW_MAX 16
+
 enum {
   BIC_CMD_OEM_SET_AMBER_LED           = 0x39,
   BIC_CMD_OEM_GET_AMBER_LED_STATUS    = 0x3A,
@@ -103,6 +107,8 @@ int bic_me_xmit(uint8_t slot_id, uint8_t *txbuf, uint8_t txlen, uint8_t *rxbuf,
 int bic_set_fan_auto_mode(uint8_t crtl, uint8_t *status);
 int _set_fw_update_ongoing(uint8_t slot_id, uint16_t tmout);
 int send_image_data_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint16_t len, uint32_t image_len, uint8_t *buf);
+int get_image_data_window(void);
+int send_image_data_window_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint16_t chunk_len, uint32_t image_len, uint8_t *buf, int window);
 int open_and_get_size(char *path, int *file_size);
 #ifdef __cplusplus
 } // extern "C"
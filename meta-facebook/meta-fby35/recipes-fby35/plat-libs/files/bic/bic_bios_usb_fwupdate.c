@@ -26,8 +26,9 @@
 #include <syslog.h>
 #include <unistd.h>
 #include <sys/time.h>
-#include <openssl/sha.h>
+#include <pthread.h>
 #include "bic_bios_fwupdate.h"
+#include "bic_fw_dedup.h"
 
 #define USB_PKT_SIZE 0x200
 #define USB_DAT_SIZE (USB_PKT_SIZE - USB_PKT_HDR_SIZE)
@@ -35,12 +36,9 @@
 #define USB_DAT_SIZE_BIG (USB_PKT_SIZE_BIG - USB_PKT_HDR_SIZE)
 #define BIOS_PKT_SIZE (64 * 1024)
 #define SIZE_IANA_ID 3
-#define BIOS_VERIFY_PKT_SIZE (32*1024)
 #define BIOS_VER_REGION_SIZE (4*1024*1024)
 #define BIOS_UPDATE_BLK_SIZE (64*1024)
 #define BIOS_UPDATE_IMG_SIZE (32*1024*1024)
-#define SIMPLE_DIGEST_LENGTH 4
-#define STRONG_DIGEST_LENGTH SHA256_DIGEST_LENGTH
 
 int interface_ref = 0;
 int alt_interface,interface_number;
@@ -330,217 +328,339 @@ error_exit:
   return -1;
 }
 
+// Read a block of data from file, padded to 64K with 0xff.
 static int
-calc_checksum_simple(const uint8_t *buf, size_t len, uint8_t *out) {
-  uint32_t cs = 0;
-  while (len-- > 0) {
-    cs += *buf++;
+read_bios_block(int fd, uint8_t *file_buf, size_t *num_bytes) {
+  size_t file_buf_num_bytes = 0;
+
+  while (file_buf_num_bytes < BIOS_UPDATE_BLK_SIZE) {
+    size_t num_to_read = BIOS_UPDATE_BLK_SIZE - file_buf_num_bytes;
+    ssize_t num_read = read(fd, file_buf + file_buf_num_bytes, num_to_read);
+    if (num_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "read error: %d\n", errno);
+      return -1;
+    }
+    if (num_read == 0) {
+      break;
+    }
+    file_buf_num_bytes += num_read;
+  }
+  for (size_t i = file_buf_num_bytes; i < BIOS_UPDATE_BLK_SIZE; i++) {
+    file_buf[i] = '\xff';
   }
-  *((uint32_t *) out) = cs;
+  *num_bytes = file_buf_num_bytes;
   return 0;
 }
 
+// Send a block, file_buf must have USB_PKT_HDR_SIZE bytes of room before it.
 static int
-calc_checksum_sha256(const void *buf, size_t len, uint8_t *out) {
-  SHA256_CTX ctx = {0};
-  memset(out, 0, STRONG_DIGEST_LENGTH);
-  if (SHA256_Init(&ctx) != 1) return -1;
-  if (SHA256_Update(&ctx, buf, len) != 1) return -2;
-  if (SHA256_Final(out, &ctx) != 1) return -3;
-  return 0;
-}
+send_bios_block(usb_dev* udev, uint8_t *file_buf, size_t file_buf_num_bytes,
+                size_t write_offset, bool big_pkt) {
+  uint8_t resp[USB_PKT_SIZE];
+  uint8_t saved[USB_PKT_HDR_SIZE];
+  size_t file_buf_pos = 0;
+  int rc;
 
-static bool
-bic_have_checksum_sha256(uint8_t slot_id) {
-  uint8_t cs[STRONG_DIGEST_LENGTH];
-  return (bic_get_fw_cksum_sha256(slot_id, UPDATE_BIOS, 0, BIOS_UPDATE_BLK_SIZE, cs) == 0);
-}
+  while (file_buf_pos < file_buf_num_bytes) {
+    size_t count = file_buf_num_bytes - file_buf_pos;
+    // 4K USB packets and SHA256 checksums were added together,
+    // so if we have SHA256 checksum, we can use big packets as well.
+    size_t limit = (big_pkt ? USB_DAT_SIZE_BIG : USB_DAT_SIZE);
+    if (count > limit) count = limit;
+    // The header goes over the tail of the previous packet, which is put
+    // back afterwards so that the block can be sent again on retries.
+    bic_usb_packet *pkt = (bic_usb_packet *) (file_buf + file_buf_pos - sizeof(bic_usb_packet));
+    memcpy(saved, pkt, sizeof(saved));
+    pkt->netfn = NETFN_OEM_1S_REQ << 2;
+    pkt->cmd = CMD_OEM_1S_UPDATE_FW;
+    pkt->iana[0] = 0x9c;
+    pkt->iana[1] = 0x9c;
+    pkt->iana[2] = 0x0;
+    pkt->target = UPDATE_BIOS;
+    pkt->offset = write_offset + file_buf_pos;
+    pkt->length = count;
+    udev->epaddr = USB_INPUT_PORT;
+    rc = send_bic_usb_packet(udev, pkt);
+    memcpy(pkt, saved, sizeof(saved));
+    if (rc < 0) {
+      fprintf(stderr, "failed to write %zu bytes @ %zu: %d\n", count, write_offset, rc);
+      return -1;
+    }
 
-static int
-get_block_checksum(uint8_t slot_id, size_t offset, int cs_len, uint8_t *out) {
-  int rc;
-  if (cs_len == STRONG_DIGEST_LENGTH) {
-    rc = bic_get_fw_cksum_sha256(slot_id, UPDATE_BIOS, offset, BIOS_UPDATE_BLK_SIZE, out);
-  } else {
-    rc = bic_get_fw_cksum(slot_id, UPDATE_BIOS, offset, BIOS_VERIFY_PKT_SIZE, out);
-    if (rc == 0) {
-      rc = bic_get_fw_cksum(slot_id, UPDATE_BIOS, offset + BIOS_VERIFY_PKT_SIZE,
-                            BIOS_VERIFY_PKT_SIZE, out + SIMPLE_DIGEST_LENGTH);
+    udev->epaddr = USB_OUTPUT_PORT;
+    rc = receive_bic_usb_packet(udev, (bic_usb_packet *) resp);
+    if (rc < 0) {
+      fprintf(stderr, "Return code : %d\n", rc);
+      return -1;
     }
+
+    file_buf_pos += count;
   }
-  return rc;
+  return 0;
 }
 
-int
-bic_update_fw_usb(uint8_t slot_id, uint8_t comp, int fd, usb_dev* udev)
-{
-  int ret = -1, rc = 0;
-  uint8_t *buf = NULL;
-  size_t write_offset = 0;
+typedef struct {
+  int fd;
+  usb_dev* udev;
+  bic_fw_dedup_t dd;
+  int num_blocks_written;
+  int num_blocks_skipped;
+} bios_update_ctx;
+
+static void
+print_bios_update_progress(int num_blocks_written, int num_blocks_skipped) {
+  fprintf(stderr, "\r%d blocks (%d written, %d skipped)...",
+      num_blocks_written + num_blocks_skipped,
+      num_blocks_written, num_blocks_skipped);
+  fflush(stderr);
+}
 
-  const char *what = NULL;
-  if (comp == FW_BIOS) {
-    what = "BIOS";
-    write_offset = 0;
-  } else {
-    fprintf(stderr, "ERROR: not supported component [comp:%u]!\n", comp);
-    goto out;
-  }
-  const char *dedup_env = getenv("FW_UTIL_DEDUP");
-  const char *verify_env = getenv("FW_UTIL_VERIFY");
-  bool dedup = (dedup_env != NULL ? (*dedup_env == '1' || *dedup_env == '2') : true);
-  bool verify = (verify_env != NULL ? (*verify_env == '1') : true);
-  verify = false;
+static int
+bios_update_serial(bios_update_ctx *ctx) {
+  uint8_t *buf, *file_buf;
+  uint8_t fcs[BIC_FW_DIGEST_MAX];
+  size_t write_offset = 0, file_buf_num_bytes;
+  int attempts, ret = -1;
 
   buf = malloc(USB_PKT_HDR_SIZE + BIOS_UPDATE_BLK_SIZE);
   if (buf == NULL) {
     fprintf(stderr, "failed to allocate memory\n");
-    goto out;
+    return -1;
   }
+  file_buf = buf + USB_PKT_HDR_SIZE;
 
-  int num_blocks_written = 0, num_blocks_skipped = 0;
-  uint8_t fcs[STRONG_DIGEST_LENGTH], cs[STRONG_DIGEST_LENGTH];
-  int cs_len = STRONG_DIGEST_LENGTH;
-  if (!bic_have_checksum_sha256(slot_id)) {
-    if (dedup && !(dedup_env != NULL && *dedup_env == '2')) {
-      fprintf(stderr, "Strong checksum function is not available, disabling "
-              "deduplication.\n");
-      dedup = false;
-    }
-    cs_len = SIMPLE_DIGEST_LENGTH * 2;
-  }
-  fprintf(stderr, "Updating %s, dedup is %s, verification is %s.\n",
-          what, (dedup ? "on" : "off"), (verify ? "on" : "off"));
-  int attempts = NUM_ATTEMPTS;
-  size_t file_buf_num_bytes = 0;
-  while (attempts > 0) {
-    uint8_t *file_buf = buf + USB_PKT_HDR_SIZE;
-    size_t file_buf_pos = 0;
-    bool send_packet_fail = false;
-    fprintf(stderr, "\r%d blocks (%d written, %d skipped)...",
-        num_blocks_written + num_blocks_skipped,
-        num_blocks_written, num_blocks_skipped);
-    fflush(stderr);
-    // Read a block of data from file.
-    while (file_buf_num_bytes < BIOS_UPDATE_BLK_SIZE) {
-      size_t num_to_read = BIOS_UPDATE_BLK_SIZE - file_buf_num_bytes;
-      ssize_t num_read = read(fd, file_buf, num_to_read);
-      if (num_read < 0) {
-        if (errno == EINTR) {
-          continue;
-        }
-        fprintf(stderr, "read error: %d\n", errno);
-        goto out;
-      }
-      if (num_read == 0) {
-        break;
-      }
-      file_buf_num_bytes += num_read;
+  while (true) {
+    print_bios_update_progress(ctx->num_blocks_written, ctx->num_blocks_skipped);
+    if (read_bios_block(ctx->fd, file_buf, &file_buf_num_bytes) != 0) {
+      goto out;
     }
     // Finished.
     if (file_buf_num_bytes == 0) {
       break;
     }
-    // Pad to 64K with 0xff, if needed.
-    for (size_t i = file_buf_num_bytes; i < BIOS_UPDATE_BLK_SIZE; i++) {
-      file_buf[i] = '\xff';
-    }
     // Check if we need to write this block at all.
-    if (dedup || verify) {
-      if (cs_len == STRONG_DIGEST_LENGTH) {
-        rc = calc_checksum_sha256(file_buf, BIOS_UPDATE_BLK_SIZE, fcs);
-      } else {
-        rc = calc_checksum_simple(file_buf, BIOS_VERIFY_PKT_SIZE, fcs);
-        if (rc == 0) {
-          rc = calc_checksum_simple(file_buf + BIOS_VERIFY_PKT_SIZE,
-                                    BIOS_VERIFY_PKT_SIZE, fcs + SIMPLE_DIGEST_LENGTH);
-        }
-      }
-      if (rc != 0) {
-        fprintf(stderr, "calc_checksum error: %d (cs_len %d)\n", rc, cs_len);
+    if (ctx->dd.dedup || ctx->dd.verify) {
+      if (bic_fw_block_digest(&ctx->dd, file_buf, BIOS_UPDATE_BLK_SIZE, fcs) != 0) {
         goto out;
       }
     }
-    if (dedup) {
-      rc = get_block_checksum(slot_id, write_offset, cs_len, cs);
-      if (rc == 0 && memcmp(cs, fcs, cs_len) == 0) {
-        write_offset += BIOS_UPDATE_BLK_SIZE;
-        file_buf_num_bytes = 0;
-        num_blocks_skipped++;
-        attempts = NUM_ATTEMPTS;
+    if (bic_fw_block_unchanged(&ctx->dd, write_offset, BIOS_UPDATE_BLK_SIZE, fcs)) {
+      write_offset += BIOS_UPDATE_BLK_SIZE;
+      ctx->num_blocks_skipped++;
+      continue;
+    }
+    for (attempts = NUM_ATTEMPTS; attempts > 0; attempts--) {
+      if (send_bios_block(ctx->udev, file_buf, file_buf_num_bytes,
+                          write_offset, ctx->dd.strong) != 0) {
         continue;
       }
-    }
-    while (file_buf_pos < file_buf_num_bytes) {
-      size_t count = file_buf_num_bytes - file_buf_pos;
-      // 4K USB packets and SHA256 checksums were added together,
-      // so if we have SHA256 checksum, we can use big packets as well.
-      size_t limit = (cs_len == STRONG_DIGEST_LENGTH ? USB_DAT_SIZE_BIG : USB_DAT_SIZE);
-      if (count > limit) count = limit;
-      bic_usb_packet *pkt = (bic_usb_packet *) (file_buf + file_buf_pos - sizeof(bic_usb_packet));
-      pkt->netfn = NETFN_OEM_1S_REQ << 2;
-      pkt->cmd = CMD_OEM_1S_UPDATE_FW;
-      pkt->iana[0] = 0x9c;
-      pkt->iana[1] = 0x9c;
-      pkt->iana[2] = 0x0;
-      pkt->target = UPDATE_BIOS;
-      pkt->offset = write_offset + file_buf_pos;
-      pkt->length = count;
-      udev->epaddr = USB_INPUT_PORT;
-      rc = send_bic_usb_packet(udev, pkt);
-      if (rc < 0) {
-        fprintf(stderr, "failed to write %zu bytes @ %zu: %d\n", count, write_offset, rc);
-        send_packet_fail = true;
-        break;  //prevent the endless while loop.
+      // Verify written data.
+      if (bic_fw_block_verify(&ctx->dd, write_offset, BIOS_UPDATE_BLK_SIZE, fcs) != 0) {
+        continue;
       }
+      break;
+    }
+    if (attempts == 0) {
+      fprintf(stderr, "failed.\n");
+      goto out;
+    }
+    write_offset += BIOS_UPDATE_BLK_SIZE;
+    ctx->num_blocks_written++;
+  }
+  ret = 0;
 
-      udev->epaddr = USB_OUTPUT_PORT;
-      rc = receive_bic_usb_packet(udev, pkt);
-      if (rc < 0) {
-        fprintf(stderr, "Return code : %d\n", rc);
-        send_packet_fail = true;
-        break;  //prevent the endless while loop.
-      }
+out:
+  free(buf);
+  return ret;
+}
 
-      file_buf_pos += count;
+/*
+ * Pipelined update: a reader thread reads, hashes and dedups the blocks
+ * ahead into BIOS_PIPELINE_DEPTH buffers while the blocks read before
+ * are sent over USB.
+ */
+#define BIOS_PIPELINE_DEPTH 2
+
+typedef struct {
+  uint8_t *buf;
+  size_t num_bytes;
+  size_t write_offset;
+  uint8_t fcs[BIC_FW_DIGEST_MAX];
+} bios_block;
+
+typedef struct {
+  bios_update_ctx *ctx;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bios_block blocks[BIOS_PIPELINE_DEPTH];
+  int head;     // the next block to send
+  int count;    // blocks ready to send
+  bool eof;
+  bool error;
+  bool stop;
+} bios_pipeline;
+
+static void *
+bios_pipeline_reader(void *arg) {
+  bios_pipeline *p = (bios_pipeline *) arg;
+  bios_update_ctx *ctx = p->ctx;
+  size_t write_offset = 0;
+  bios_block *blk;
+  bool skip;
+  int rc;
+
+  pthread_mutex_lock(&p->lock);
+  while (!p->stop) {
+    if (p->count == BIOS_PIPELINE_DEPTH) {
+      pthread_cond_wait(&p->cond, &p->lock);
+      continue;
+    }
+    // The sender only uses the blocks from head to head + count - 1.
+    blk = &p->blocks[(p->head + p->count) % BIOS_PIPELINE_DEPTH];
+    pthread_mutex_unlock(&p->lock);
+
+    skip = false;
+    blk->write_offset = write_offset;
+    rc = read_bios_block(ctx->fd, blk->buf + USB_PKT_HDR_SIZE, &blk->num_bytes);
+    if (rc == 0 && blk->num_bytes > 0 && (ctx->dd.dedup || ctx->dd.verify)) {
+      rc = bic_fw_block_digest(&ctx->dd, blk->buf + USB_PKT_HDR_SIZE, BIOS_UPDATE_BLK_SIZE, blk->fcs);
+    }
+    if (rc == 0 && blk->num_bytes > 0) {
+      skip = bic_fw_block_unchanged(&ctx->dd, write_offset, BIOS_UPDATE_BLK_SIZE, blk->fcs);
     }
 
-    if (send_packet_fail) {
-      attempts--;
+    pthread_mutex_lock(&p->lock);
+    if (rc != 0) {
+      p->error = true;
+      break;
+    }
+    if (blk->num_bytes == 0) {
+      p->eof = true;
+      break;
+    }
+    write_offset += BIOS_UPDATE_BLK_SIZE;
+    if (skip) {
+      ctx->num_blocks_skipped++;
       continue;
     }
+    p->count++;
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+static int
+bios_update_pipelined(bios_update_ctx *ctx) {
+  bios_pipeline p = {
+    .ctx = ctx,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+  };
+  pthread_t tid;
+  bios_block *blk;
+  int i, rc, attempts, ret = -1;
+
+  for (i = 0; i < BIOS_PIPELINE_DEPTH; i++) {
+    p.blocks[i].buf = malloc(USB_PKT_HDR_SIZE + BIOS_UPDATE_BLK_SIZE);
+    if (p.blocks[i].buf == NULL) {
+      fprintf(stderr, "failed to allocate memory\n");
+      goto out;
+    }
+  }
+  rc = pthread_create(&tid, NULL, bios_pipeline_reader, &p);
+  if (rc != 0) {
+    fprintf(stderr, "failed to create reader thread: %d\n", rc);
+    goto out;
+  }
+
+  pthread_mutex_lock(&p.lock);
+  while (true) {
+    print_bios_update_progress(ctx->num_blocks_written, ctx->num_blocks_skipped);
+    while (p.count == 0 && !p.eof && !p.error) {
+      pthread_cond_wait(&p.cond, &p.lock);
+    }
+    if (p.error) {
+      break;
+    }
+    // Finished.
+    if (p.count == 0) {
+      ret = 0;
+      break;
+    }
+    blk = &p.blocks[p.head];
+    pthread_mutex_unlock(&p.lock);
 
-    // Verify written data.
-    if (verify) {
-      rc = get_block_checksum(slot_id, write_offset, cs_len, cs);
-      if (rc != 0) {
-        fprintf(stderr, "get_block_checksum @ %zu failed (cs_len %d)\n", write_offset, cs_len);
-        attempts--;
+    for (attempts = NUM_ATTEMPTS; attempts > 0; attempts--) {
+      if (send_bios_block(ctx->udev, blk->buf + USB_PKT_HDR_SIZE, blk->num_bytes,
+                          blk->write_offset, ctx->dd.strong) != 0) {
         continue;
       }
-      if (memcmp(cs, fcs, cs_len) != 0) {
-        fprintf(stderr, "Data checksum mismatch @ %zu (cs_len %d, 0x%016llx vs 0x%016llx)\n",
-            write_offset, cs_len, *((uint64_t *) cs), *((uint64_t *) fcs));
-        attempts--;
+      // Verify written data.
+      if (bic_fw_block_verify(&ctx->dd, blk->write_offset, BIOS_UPDATE_BLK_SIZE, blk->fcs) != 0) {
         continue;
       }
+      break;
     }
-    write_offset += BIOS_UPDATE_BLK_SIZE;
-    file_buf_num_bytes = 0;
-    num_blocks_written++;
-    attempts = NUM_ATTEMPTS;
-  }
-  if (attempts == 0) {
-    fprintf(stderr, "failed.\n");
-    goto out;
+
+    pthread_mutex_lock(&p.lock);
+    if (attempts == 0) {
+      fprintf(stderr, "failed.\n");
+      break;
+    }
+    p.head = (p.head + 1) % BIOS_PIPELINE_DEPTH;
+    p.count--;
+    ctx->num_blocks_written++;
+    pthread_cond_broadcast(&p.cond);
   }
+  p.stop = true;
+  pthread_cond_broadcast(&p.cond);
+  pthread_mutex_unlock(&p.lock);
+  pthread_join(tid, NULL);
 
-  fprintf(stderr, "finished.\n");
+out:
+  for (i = 0; i < BIOS_PIPELINE_DEPTH; i++) {
+    free(p.blocks[i].buf);
+  }
+  return ret;
+}
 
-  ret = 0;
+int
+bic_update_fw_usb(uint8_t slot_id, uint8_t comp, int fd, usb_dev* udev)
+{
+  int ret = -1;
+  bios_update_ctx ctx = {
+    .fd = fd,
+    .udev = udev,
+  };
 
-out:
-  free(buf);
+  const char *what = NULL;
+  if (comp == FW_BIOS) {
+    what = "BIOS";
+  } else {
+    fprintf(stderr, "ERROR: not supported component [comp:%u]!\n", comp);
+    return -1;
+  }
+  const char *pipeline_env = getenv("FW_UTIL_PIPELINE");
+  bool pipeline = (pipeline_env != NULL ? (*pipeline_env != '0') : true);
+  bic_fw_dedup_init(&ctx.dd, slot_id, UPDATE_BIOS, true, true);
+  ctx.dd.verify = false;
+  fprintf(stderr, "Updating %s, dedup is %s, verification is %s, pipeline is %s.\n",
+          what, (ctx.dd.dedup ? "on" : "off"), (ctx.dd.verify ? "on" : "off"),
+          (pipeline ? "on" : "off"));
+
+  if (pipeline) {
+    ret = bios_update_pipelined(&ctx);
+  } else {
+    ret = bios_update_serial(&ctx);
+  }
+  if (ret == 0) {
+    fprintf(stderr, "finished.\n");
+  }
   return ret;
 }
 
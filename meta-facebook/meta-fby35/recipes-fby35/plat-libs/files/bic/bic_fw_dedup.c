@@ -0,0 +1,160 @@
+/*
+ *
+ * Copyright 2015-present Facebook. All Rights Reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "bic_fw_dedup.h"
+#include "bic_bios_fwupdate.h"
+
+static int
+calc_checksum_simple(const uint8_t *buf, size_t len, uint8_t *out) {
+  uint32_t cs = 0;
+  while (len-- > 0) {
+    cs += *buf++;
+  }
+  memcpy(out, &cs, sizeof(cs));
+  return 0;
+}
+
+static int
+calc_checksum_sha256(const void *buf, size_t len, uint8_t *out) {
+  SHA256_CTX ctx = {0};
+  memset(out, 0, BIC_FW_STRONG_DIGEST_LENGTH);
+  if (SHA256_Init(&ctx) != 1) return -1;
+  if (SHA256_Update(&ctx, buf, len) != 1) return -2;
+  if (SHA256_Final(out, &ctx) != 1) return -3;
+  return 0;
+}
+
+static int
+get_block_checksum(const bic_fw_dedup_t *d, uint32_t offset, uint32_t len, uint8_t *out) {
+  uint32_t pos, count;
+  int rc;
+
+  if (d->strong) {
+    return bic_get_fw_cksum_sha256(d->slot_id, d->target, offset, len, out);
+  }
+  for (pos = 0; pos < len; pos += count) {
+    count = len - pos;
+    if (count > BIC_FW_SIMPLE_CKSUM_SIZE) {
+      count = BIC_FW_SIMPLE_CKSUM_SIZE;
+    }
+    rc = bic_get_fw_cksum(d->slot_id, d->target, offset + pos, count, out);
+    if (rc != 0) {
+      return rc;
+    }
+    out += BIC_FW_SIMPLE_DIGEST_LENGTH;
+  }
+  return 0;
+}
+
+void
+bic_fw_dedup_init(bic_fw_dedup_t *d, uint8_t slot_id, uint8_t target, bool dedup, bool verify) {
+  const char *dedup_env = getenv("FW_UTIL_DEDUP");
+  const char *verify_env = getenv("FW_UTIL_VERIFY");
+  uint8_t cs[BIC_FW_DIGEST_MAX];
+
+  d->slot_id = slot_id;
+  d->target = target;
+  d->dedup = (dedup_env != NULL ? (*dedup_env == '1' || *dedup_env == '2') : dedup);
+  d->verify = (verify_env != NULL ? (*verify_env == '1') : verify);
+
+  d->strong = (bic_get_fw_cksum_sha256(slot_id, target, 0, BIC_FW_DEDUP_BLK_MAX, cs) == 0);
+  if (d->strong) {
+    return;
+  }
+  if (bic_get_fw_cksum(slot_id, target, 0, BIC_FW_SIMPLE_CKSUM_SIZE, cs) != 0) {
+    d->dedup = false;
+    d->verify = false;
+    return;
+  }
+  if (d->dedup && !(dedup_env != NULL && *dedup_env == '2')) {
+    fprintf(stderr, "Strong checksum function is not available, disabling "
+            "deduplication.\n");
+    d->dedup = false;
+  }
+}
+
+int
+bic_fw_digest_len(const bic_fw_dedup_t *d, uint32_t len) {
+  if (d->strong) {
+    return BIC_FW_STRONG_DIGEST_LENGTH;
+  }
+  return (len + BIC_FW_SIMPLE_CKSUM_SIZE - 1) / BIC_FW_SIMPLE_CKSUM_SIZE * BIC_FW_SIMPLE_DIGEST_LENGTH;
+}
+
+int
+bic_fw_block_digest(const bic_fw_dedup_t *d, const uint8_t *buf, uint32_t len, uint8_t *digest) {
+  uint32_t pos, count;
+  int rc = 0;
+
+  if (len > BIC_FW_DEDUP_BLK_MAX) {
+    return -1;
+  }
+  if (d->strong) {
+    rc = calc_checksum_sha256(buf, len, digest);
+  } else {
+    for (pos = 0; pos < len && rc == 0; pos += count) {
+      count = len - pos;
+      if (count > BIC_FW_SIMPLE_CKSUM_SIZE) {
+        count = BIC_FW_SIMPLE_CKSUM_SIZE;
+      }
+      rc = calc_checksum_simple(buf + pos, count, digest);
+      digest += BIC_FW_SIMPLE_DIGEST_LENGTH;
+    }
+  }
+  if (rc != 0) {
+    fprintf(stderr, "calc_checksum error: %d (cs_len %d)\n", rc, bic_fw_digest_len(d, len));
+  }
+  return rc;
+}
+
+bool
+bic_fw_block_unchanged(const bic_fw_dedup_t *d, uint32_t offset, uint32_t len, const uint8_t *digest) {
+  uint8_t cs[BIC_FW_DIGEST_MAX];
+
+  if (!d->dedup || len > BIC_FW_DEDUP_BLK_MAX) {
+    return false;
+  }
+  return (get_block_checksum(d, offset, len, cs) == 0 &&
+          memcmp(cs, digest, bic_fw_digest_len(d, len)) == 0);
+}
+
+int
+bic_fw_block_verify(const bic_fw_dedup_t *d, uint32_t offset, uint32_t len, const uint8_t *digest) {
+  uint8_t cs[BIC_FW_DIGEST_MAX];
+  int cs_len = bic_fw_digest_len(d, len);
+
+  if (!d->verify) {
+    return 0;
+  }
+  if (len > BIC_FW_DEDUP_BLK_MAX || get_block_checksum(d, offset, len, cs) != 0) {
+    fprintf(stderr, "get_block_checksum @ %u failed (cs_len %d)\n", offset, cs_len);
+    return -1;
+  }
+  if (memcmp(cs, digest, cs_len) != 0) {
+    fprintf(stderr, "Data checksum mismatch @ %u (cs_len %d, 0x%016llx vs 0x%016llx)\n",
+        offset, cs_len, *((unsigned long long *) cs), *((unsigned long long *) digest));
+    return -1;
+  }
+  return 0;
+}
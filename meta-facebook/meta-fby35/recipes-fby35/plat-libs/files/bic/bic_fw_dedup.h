@@ -0,0 +1,74 @@
+/*
+ *
+ * Copyright 2015-present Facebook. All Rights Reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __BIC_FW_DEDUP_H__
+#define __BIC_FW_DEDUP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Dedup and verification of the blocks of a firmware update, when the BIC
+ * can read back the checksum of the flash of the component: a block whose
+ * checksum matches is not written again, and a written block can be
+ * checked against the image.
+ */
+
+// Largest block the checksums are taken of
+#define BIC_FW_DEDUP_BLK_MAX (64*1024)
+// The simple checksum of a block is 4 bytes for every 32K of it
+#define BIC_FW_SIMPLE_CKSUM_SIZE (32*1024)
+#define BIC_FW_SIMPLE_DIGEST_LENGTH 4
+#define BIC_FW_STRONG_DIGEST_LENGTH 32
+#define BIC_FW_DIGEST_MAX BIC_FW_STRONG_DIGEST_LENGTH
+
+typedef struct {
+  uint8_t slot_id;
+  uint8_t target;   // UPDATE_* component passed to the checksum commands
+  bool strong;      // SHA256 rather than the simple checksum
+  bool dedup;
+  bool verify;
+} bic_fw_dedup_t;
+
+/*
+ * Probe the checksum commands of the BIC for target. dedup and verify are
+ * the defaults of the component, FW_UTIL_DEDUP and FW_UTIL_VERIFY override
+ * them; both are turned off if the BIC has no checksum of target.
+ * Dedup with the simple checksum only goes with FW_UTIL_DEDUP=2.
+ */
+void bic_fw_dedup_init(bic_fw_dedup_t *d, uint8_t slot_id, uint8_t target, bool dedup, bool verify);
+// Length of the digest of a block of len bytes
+int bic_fw_digest_len(const bic_fw_dedup_t *d, uint32_t len);
+// Digest of a block of the image, for the checks below
+int bic_fw_block_digest(const bic_fw_dedup_t *d, const uint8_t *buf, uint32_t len, uint8_t *digest);
+// Whether the flash at offset already holds the block of digest
+bool bic_fw_block_unchanged(const bic_fw_dedup_t *d, uint32_t offset, uint32_t len, const uint8_t *digest);
+// Check the written block at offset against digest, 0 if it matches
+int bic_fw_block_verify(const bic_fw_dedup_t *d, uint32_t offset, uint32_t len, const uint8_t *digest);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* __BIC_FW_DEDUP_H__ */
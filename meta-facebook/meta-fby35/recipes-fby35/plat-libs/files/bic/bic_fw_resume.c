@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright 2015-present Facebook. All Rights Reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <openssl/sha.h>
+#include "bic_fw_resume.h"
+#include "bic_ipmi.h"
+
+#define BIC_FW_RESUME_MAGIC 0x4b434642  // "BFCK"
+#define BIC_FW_RESUME_READ_SIZE (64*1024)
+
+// The checkpoint file
+typedef struct {
+  uint32_t magic;
+  uint8_t slot_id;
+  uint8_t target;
+  uint16_t rsvd;
+  uint32_t image_len;
+  uint32_t offset;
+  uint8_t image_hash[BIC_FW_RESUME_HASH_LENGTH];
+  uint8_t bic_ver[BIC_FW_RESUME_VER_LENGTH];
+} __attribute__((packed)) bic_fw_ckpt_t;
+
+static void
+get_ckpt_path(const bic_fw_resume_t *r, char *path, size_t size) {
+  snprintf(path, size, BIC_FW_RESUME_PATH, r->slot_id, r->target);
+}
+
+static int
+hash_image(int fd, uint32_t image_len, uint8_t *out) {
+  SHA256_CTX ctx = {0};
+  uint8_t *buf;
+  uint32_t pos = 0;
+  ssize_t num_read;
+  int rc = -1;
+
+  buf = malloc(BIC_FW_RESUME_READ_SIZE);
+  if (buf == NULL || SHA256_Init(&ctx) != 1) {
+    goto exit;
+  }
+  while (pos < image_len) {
+    num_read = pread(fd, buf, BIC_FW_RESUME_READ_SIZE, pos);
+    if (num_read <= 0) {
+      goto exit;
+    }
+    if (num_read > image_len - pos) {
+      num_read = image_len - pos;
+    }
+    if (SHA256_Update(&ctx, buf, num_read) != 1) {
+      goto exit;
+    }
+    pos += num_read;
+  }
+  if (SHA256_Final(out, &ctx) == 1) {
+    rc = 0;
+  }
+
+exit:
+  free(buf);
+  return rc;
+}
+
+void
+bic_fw_resume_init(bic_fw_resume_t *r, uint8_t slot_id, uint8_t target, uint8_t fw_comp, int fd, uint32_t image_len) {
+  const char *env = getenv("FW_UTIL_RESUME");
+  char path[64];
+  bic_fw_ckpt_t ckpt;
+  uint8_t ver[32] = {0};
+  int ckpt_fd;
+
+  memset(r, 0, sizeof(*r));
+  r->slot_id = slot_id;
+  r->target = target;
+  r->image_len = image_len;
+  if (env != NULL && *env == '0') {
+    return;
+  }
+  if (hash_image(fd, image_len, r->image_hash) != 0) {
+    syslog(LOG_WARNING, "%s() slot%u: cannot hash the image, no checkpoints", __func__, slot_id);
+    return;
+  }
+  if (bic_get_fw_ver(slot_id, fw_comp, ver) != 0) {
+    syslog(LOG_WARNING, "%s() slot%u: cannot get the BIC version, no checkpoints", __func__, slot_id);
+    return;
+  }
+  memcpy(r->bic_ver, ver, sizeof(r->bic_ver));
+  r->enabled = true;
+
+  get_ckpt_path(r, path, sizeof(path));
+  ckpt_fd = open(path, O_RDONLY);
+  if (ckpt_fd < 0) {
+    return;
+  }
+  if (read(ckpt_fd, &ckpt, sizeof(ckpt)) == sizeof(ckpt) &&
+      ckpt.magic == BIC_FW_RESUME_MAGIC &&
+      ckpt.slot_id == slot_id && ckpt.target == target &&
+      ckpt.image_len == image_len && ckpt.offset < image_len &&
+      memcmp(ckpt.image_hash, r->image_hash, sizeof(ckpt.image_hash)) == 0 &&
+      memcmp(ckpt.bic_ver, r->bic_ver, sizeof(ckpt.bic_ver)) == 0) {
+    r->offset = ckpt.offset;
+  }
+  close(ckpt_fd);
+}
+
+int
+bic_fw_resume_save(bic_fw_resume_t *r, uint32_t offset) {
+  char path[64], tmp_path[72];
+  bic_fw_ckpt_t ckpt = {
+    .magic = BIC_FW_RESUME_MAGIC,
+    .slot_id = r->slot_id,
+    .target = r->target,
+    .image_len = r->image_len,
+    .offset = offset,
+  };
+  int fd, rc = -1;
+
+  if (!r->enabled) {
+    return 0;
+  }
+  memcpy(ckpt.image_hash, r->image_hash, sizeof(ckpt.image_hash));
+  memcpy(ckpt.bic_ver, r->bic_ver, sizeof(ckpt.bic_ver));
+
+  // Replaced in one go, a checkpoint is never half written
+  get_ckpt_path(r, path, sizeof(path));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  if (write(fd, &ckpt, sizeof(ckpt)) == sizeof(ckpt)) {
+    rc = 0;
+  }
+  close(fd);
+  if (rc == 0 && rename(tmp_path, path) != 0) {
+    rc = -1;
+  }
+  if (rc != 0) {
+    unlink(tmp_path);
+    return rc;
+  }
+  r->offset = offset;
+  return 0;
+}
+
+void
+bic_fw_resume_clear(const bic_fw_resume_t *r) {
+  char path[64];
+
+  get_ckpt_path(r, path, sizeof(path));
+  unlink(path);
+}
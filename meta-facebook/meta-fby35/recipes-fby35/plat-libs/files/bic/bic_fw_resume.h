@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright 2015-present Facebook. All Rights Reserved.
+ *
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __BIC_FW_RESUME_H__
+#define __BIC_FW_RESUME_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Checkpoints of the firmware updates through the BIC: the offset up to
+ * which the image was acknowledged is kept in a file of the slot and
+ * target, with the SHA256 of the image and the version the BIC reported.
+ * An update failing half way leaves its checkpoint; the next update of
+ * the same image to the same BIC goes on from there rather than from
+ * offset 0. FW_UTIL_RESUME=0 turns the checkpoints off.
+ */
+
+#define BIC_FW_RESUME_PATH "/tmp/bic_fw_slot%u_%02x.ckpt"
+#define BIC_FW_RESUME_HASH_LENGTH 32
+#define BIC_FW_RESUME_VER_LENGTH 8
+
+typedef struct {
+  uint8_t slot_id;
+  uint8_t target;   // UPDATE_* component of the update
+  bool enabled;
+  uint32_t image_len;
+  uint8_t image_hash[BIC_FW_RESUME_HASH_LENGTH];
+  uint8_t bic_ver[BIC_FW_RESUME_VER_LENGTH];
+  uint32_t offset;  // to resume from, 0 without a matching checkpoint
+} bic_fw_resume_t;
+
+/*
+ * Hash the image of fd (its file offset is kept) and read the version of
+ * the BIC (fw_comp), then look for the checkpoint of the same update.
+ * The checkpoints are off if either of them cannot be had.
+ */
+void bic_fw_resume_init(bic_fw_resume_t *r, uint8_t slot_id, uint8_t target, uint8_t fw_comp, int fd, uint32_t image_len);
+// Record that the image is acknowledged up to offset
+int bic_fw_resume_save(bic_fw_resume_t *r, uint32_t offset);
+// Drop the checkpoint, once the update is done
+void bic_fw_resume_clear(const bic_fw_resume_t *r);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* __BIC_FW_RESUME_H__ */
@@ -35,6 +35,8 @@
 #include "bic_ipmi.h"
 #include "bic_xfer.h"
 #include "bic_bios_fwupdate.h"
+#include "bic_fw_dedup.h"
+#include "bic_fw_resume.h"
 #include "bic_cpld_altera_fwupdate.h"
 #include "bic_cpld_lattice_fwupdate.h"
 #include "bic_m2_fwupdate.h"
@@ -85,43 +87,6 @@ enum {
   I2C_1M
 };
 
-// Update firmware for various components
-static int
-_update_fw(uint8_t slot_id, uint8_t target, uint32_t offset, uint16_t len, uint8_t *buf) {
-  uint8_t tbuf[256] = {0x9c, 0x9c, 0x00}; // IANA ID
-  uint8_t rbuf[16] = {0x00};
-  uint8_t tlen = 0;
-  uint8_t rlen = 0;
-  int ret;
-  int retries = 3;
-
-  // Fill the component for which firmware is requested
-  tbuf[3] = target;
-
-  tbuf[4] = (offset) & 0xFF;
-  tbuf[5] = (offset >> 8) & 0xFF;
-  tbuf[6] = (offset >> 16) & 0xFF;
-  tbuf[7] = (offset >> 24) & 0xFF;
-
-  tbuf[8] = len & 0xFF;
-  tbuf[9] = (len >> 8) & 0xFF;
-
-  memcpy(&tbuf[10], buf, len);
-
-  tlen = len + 10;
-
-bic_send:
-  ret = bic_ipmb_wrapper(slot_id, NETFN_OEM_1S_REQ, CMD_OEM_1S_UPDATE_FW, tbuf, tlen, rbuf, &rlen);
-  if ((ret) && (retries--)) {
-    sleep(1);
-    printf("_update_fw: slot: %d, target %d, offset: %u, len: %d retrying..\
-           \n",    slot_id, target, offset, len);
-    goto bic_send;
-  }
-
-  return ret;
-}
-
 #ifdef DEBUG
 static void print_data(const char *name, uint8_t netfn, uint8_t cmd, uint8_t *buf, uint8_t len) {
   int i;
@@ -513,70 +478,126 @@ static int
 update_bic(uint8_t slot_id, int fd, int file_size) {
   struct timeval start, end;
   int ret = -1, rc;
+  int window;
   uint32_t dsize, last_offset;
-  uint32_t offset, boundary;
-  volatile uint16_t read_count;
-  uint8_t buf[256] = {0};
-  uint8_t target;
-  ssize_t count;
+  uint32_t offset, count, last_count, num;
+  uint32_t num_skipped = 0;
+  uint8_t *buf;
+  uint8_t digest[BIC_FW_DIGEST_MAX];
+  ssize_t num_read;
+  bic_fw_dedup_t dd;
+  bic_fw_resume_t resume;
+  image_data_pace_t pace;
 
   printf("updating fw on slot %d:\n", slot_id);
+  bic_fw_dedup_init(&dd, slot_id, UPDATE_BIC, true, false);
+  printf("dedup is %s, verification is %s\n", (dd.dedup ? "on" : "off"), (dd.verify ? "on" : "off"));
+
+  buf = malloc(PKT_SIZE);
+  if (buf == NULL) {
+    printf("failed to allocate memory\n");
+    return -1;
+  }
+  window = get_image_data_window();
+  image_data_pace_init(&pace, AST_BIC_IPMB_WRITE_COUNT_MAX, window);
 
-  // Write chunks of binary data in a loop
+  // Write binary data in blocks of 64K, the chunks of a block are sent
+  // with up to <window> of them in flight
   dsize = file_size/100;
   last_offset = 0;
   offset = 0;
-  boundary = PKT_SIZE;
-  target = UPDATE_BIC;
+
+  // Go on from the checkpoint of a failed update of this image
+  bic_fw_resume_init(&resume, slot_id, UPDATE_BIC, FW_BIC, fd, file_size);
+  if (resume.offset > 0 && (resume.offset % PKT_SIZE) == 0 &&
+      lseek(fd, resume.offset, SEEK_SET) == resume.offset) {
+    printf("resuming from offset %u\n", resume.offset);
+    syslog(LOG_WARNING, "%s() slot%d: resuming the update from offset %u", __func__, slot_id, resume.offset);
+    offset = resume.offset;
+    last_offset = offset;
+  }
   gettimeofday(&start, NULL);
-  while (1) {
-    // send packets in blocks of 64K
-    if ((offset + AST_BIC_IPMB_WRITE_COUNT_MAX) < boundary) {
-      read_count = AST_BIC_IPMB_WRITE_COUNT_MAX;
-    } else {
-      read_count = boundary - offset;
+  while (offset < file_size) {
+    count = PKT_SIZE - (offset % PKT_SIZE);
+    if (count > file_size - offset) {
+      count = file_size - offset;
     }
 
     // Read from file
-    count = read(fd, buf, read_count);
-    if ((count < 0) && (errno == EINTR)) {
-      continue;
+    for (num = 0; num < count; num += num_read) {
+      num_read = read(fd, buf + num, count - num);
+      if ((num_read < 0) && (errno == EINTR)) {
+        num_read = 0;
+        continue;
+      }
+      if (num_read <= 0) {
+        break;
+      }
     }
-    if (count <= 0 || count > read_count) {
-      break;
+    if (num < count) {
+      goto error_exit;
     }
 
+    // The last chunk of the image is sent after all the others
+    last_count = 0;
     if ((offset + count) >= file_size) {
-      target |= 0x80;
+      last_count = (count - 1) % AST_BIC_IPMB_WRITE_COUNT_MAX + 1;
+    }
+    // Skip the blocks the BIC already has, but the last one
+    rc = 0;
+    if ((dd.dedup || dd.verify) && last_count == 0) {
+      rc = bic_fw_block_digest(&dd, buf, count, digest);
+      if (rc == 0 && bic_fw_block_unchanged(&dd, offset, count, digest)) {
+        num_skipped++;
+        goto next_block;
+      }
     }
     // Send data to Bridge-IC
-    rc = _update_fw(slot_id, target, offset, count, buf);
+    if (rc == 0) {
+      rc = send_image_data_paced_via_bic(slot_id, UPDATE_BIC, NONE_INTF, offset, count - last_count,
+                                         0, buf, &pace);
+    }
+    if (rc == 0 && last_count == 0) {
+      rc = bic_fw_block_verify(&dd, offset, count, digest);
+    }
+    if (rc == 0 && last_count > 0) {
+      rc = send_image_data_via_bic(slot_id, UPDATE_BIC | 0x80, NONE_INTF, offset + count - last_count,
+                                   last_count, 0, buf + count - last_count);
+    }
     if (rc) {
+      if (resume.enabled && resume.offset > 0) {
+        printf("\nupdate failed at offset %u, run it again to resume from offset %u\n", offset, resume.offset);
+      }
       goto error_exit;
     }
 
+next_block:
+
     // Update counter
     offset += count;
-    if (offset >= boundary) {
-      boundary += PKT_SIZE;
+    if (last_count == 0) {
+      bic_fw_resume_save(&resume, offset);
     }
     if ((last_offset + dsize) <= offset) {
       _set_fw_update_ongoing(slot_id, 60);
       printf("\rupdated bic: %u %%", offset/dsize);
       fflush(stdout);
-      last_offset += dsize;
+      last_offset = offset;
     }
   }
   printf("\n");
 
   gettimeofday(&end, NULL);
   printf("Elapsed time:  %d   sec.\n", (int)(end.tv_sec - start.tv_sec));
-  if (offset >= file_size) {
-    ret = 0;
+  if (num_skipped > 0) {
+    printf("%u unchanged blocks skipped\n", num_skipped);
   }
+  bic_fw_resume_clear(&resume);
+  ret = 0;
 
 error_exit:
   printf("\n");
+  free(buf);
 
   return ret;
 }
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/file.h>
@@ -37,6 +38,7 @@
 
 //FRU
 #define FRUID_READ_COUNT_MAX 0x20
+#define FRUID_READ_COUNT_MAX_USB 0xF0
 #define FRUID_WRITE_COUNT_MAX 0x20
 #define FRUID_SIZE 256
 
@@ -154,6 +156,76 @@ bic_get_sensor_reading(uint8_t slot_id, uint8_t sensor_num, snr_reading_ret *sen
   return ret;
 }
 
+#define SNR_READ_WORKERS 4
+
+typedef struct {
+  uint8_t slot_id;
+  uint8_t intf;
+  const uint8_t *sensor_nums;
+  snr_reading_ret *sensors;
+  int *rets;
+  int cnt;
+  int next;
+  pthread_mutex_t lock;
+} snr_bulk_read_t;
+
+static void *
+bic_sensor_reader(void *arg) {
+  snr_bulk_read_t *br = (snr_bulk_read_t *)arg;
+  int i;
+
+  while (1) {
+    pthread_mutex_lock(&br->lock);
+    i = br->next++;
+    pthread_mutex_unlock(&br->lock);
+    if (i >= br->cnt) {
+      break;
+    }
+    br->rets[i] = bic_get_sensor_reading(br->slot_id, br->sensor_nums[i], &br->sensors[i], br->intf);
+  }
+
+  return NULL;
+}
+
+// Read the sensors of sensor_nums behind the same interface. The BIC has
+// no command to read several sensors, so up to SNR_READ_WORKERS requests
+// are kept in flight through ipmbd. rets[i] is the result of sensors[i].
+int
+bic_get_sensor_readings(uint8_t slot_id, const uint8_t *sensor_nums, int cnt, snr_reading_ret *sensors, int *rets, uint8_t intf) {
+  snr_bulk_read_t br = {0};
+  pthread_t tid[SNR_READ_WORKERS - 1];
+  int i, num_threads = 0;
+
+  if (sensor_nums == NULL || sensors == NULL || rets == NULL || cnt <= 0) {
+    return BIC_STATUS_FAILURE;
+  }
+
+  // The first reading settles the command the slot supports.
+  rets[0] = bic_get_sensor_reading(slot_id, sensor_nums[0], &sensors[0], intf);
+  br.slot_id = slot_id;
+  br.intf = intf;
+  br.sensor_nums = sensor_nums;
+  br.sensors = sensors;
+  br.rets = rets;
+  br.cnt = cnt;
+  br.next = 1;
+  pthread_mutex_init(&br.lock, NULL);
+
+  for (i = 0; i < SNR_READ_WORKERS - 1 && i < cnt - 2; i++) {
+    if (pthread_create(&tid[num_threads], NULL, bic_sensor_reader, &br) != 0) {
+      break;
+    }
+    num_threads++;
+  }
+  bic_sensor_reader(&br);
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  pthread_mutex_destroy(&br.lock);
+
+  return BIC_STATUS_SUCCESS;
+}
+
 // APP - Get Device ID
 // Netfn: 0x06, Cmd: 0x01
 int
@@ -289,6 +361,7 @@ bic_read_fruid(uint8_t slot_id, uint8_t fru_id, const char *path, int *fru_size,
   uint32_t nread;
   uint32_t offset;
   uint8_t count;
+  uint8_t count_max = FRUID_READ_COUNT_MAX;
   uint8_t rbuf[MAX_IPMB_RES_LEN] = {0};
   uint8_t rlen = 0;
   int fd;
@@ -322,16 +395,26 @@ bic_read_fruid(uint8_t slot_id, uint8_t fru_id, const char *path, int *fru_size,
   if (*fru_size == 0)
      goto error_exit;
 
+  // Bigger chunks when they go over USB
+  if (intf == NONE_INTF && bic_usb_xfer_ready(slot_id)) {
+    count_max = FRUID_READ_COUNT_MAX_USB;
+  }
+
   // Read chunks of FRUID binary data in a loop
   offset = 0;
   while (nread > 0) {
-    if (nread > FRUID_READ_COUNT_MAX) {
-      count = FRUID_READ_COUNT_MAX;
+    if (nread > count_max) {
+      count = count_max;
     } else {
       count = nread;
     }
 
     ret = _read_fruid(slot_id, fru_id, offset, count, rbuf, &rlen, intf);
+    if (ret && count_max != FRUID_READ_COUNT_MAX) {
+      // USB went away, IPMB takes the small chunks only
+      count_max = FRUID_READ_COUNT_MAX;
+      continue;
+    }
     if (ret) {
       syslog(LOG_ERR, "bic_read_fruid: ipmb_wrapper fails\n");
       goto error_exit;
@@ -92,6 +92,7 @@ int bic_get_vr_ver(uint8_t slot_id, uint8_t intf, uint8_t bus, uint8_t addr, cha
 int bic_get_vr_ver_cache(uint8_t slot_id, uint8_t intf, uint8_t bus, uint8_t addr, char *ver_str);
 int bic_get_exp_cpld_ver(uint8_t slot_id, uint8_t comp, uint8_t *ver, uint8_t bus, uint8_t addr, uint8_t intf);
 int bic_get_sensor_reading(uint8_t slot_id, uint8_t sensor_num, snr_reading_ret *sensor, uint8_t intf);
+int bic_get_sensor_readings(uint8_t slot_id, const uint8_t *sensor_nums, int cnt, snr_reading_ret *sensors, int *rets, uint8_t intf);
 int bic_is_m2_exp_prsnt(uint8_t slot_id);
 int me_recovery(uint8_t slot_id, uint8_t command);
 int me_reset(uint8_t slot_id);
@@ -28,6 +28,8 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <openbmc/kv.h>
@@ -162,6 +164,214 @@ bic_ipmb_send(uint8_t slot_id, uint8_t netfn, uint8_t cmd, uint8_t *tbuf, uint8_
   return ret;
 }
 
+// USB transport to the server BIC, on the bulk endpoints of the BIOS
+// update. A request goes out as [netfn << 2, cmd, data...] on
+// USB_INPUT_PORT, and its response comes back as [netfn << 2, cmd, cc,
+// data...] on USB_OUTPUT_PORT.
+#define BIC_USB_XFER_INTF      1
+#define BIC_USB_XFER_TIMEOUT   500  // ms
+#define BIC_USB_XFER_PROBE_SEC 30   // before looking for an absent device again
+#define BIC_USB_XFER_BUF_SIZE  0x1000
+
+typedef struct {
+  pthread_mutex_t mutex;
+  libusb_context *ctx;
+  libusb_device_handle *handle;
+  bool unsupported;  // the BIC only takes the BIOS update over USB
+  time_t next_probe;
+} bic_usb_xfer_t;
+
+static bic_usb_xfer_t usb_xfer[FRU_SLOT4 + 1] = {
+  [0 ... FRU_SLOT4] = { .mutex = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static libusb_device_handle *
+bic_usb_xfer_open(uint8_t slot_id, libusb_context *ctx) {
+  libusb_device **devs;
+  libusb_device_handle *handle = NULL;
+  struct libusb_device_descriptor desc;
+  uint8_t path[8];
+  uint8_t bmc_location = 0;
+  ssize_t cnt, i;
+
+  if (fby35_common_get_bmc_location(&bmc_location) < 0) {
+    return NULL;
+  }
+
+  cnt = libusb_get_device_list(ctx, &devs);
+  if (cnt < 0) {
+    return NULL;
+  }
+
+  for (i = 0; i < cnt; i++) {
+    if (libusb_get_device_descriptor(devs[i], &desc) < 0 ||
+        desc.idVendor != SB_USB_VENDOR_ID || desc.idProduct != SB_USB_PRODUCT_ID) {
+      continue;
+    }
+
+    // The BICs of all the slots are behind the hub of the baseboard BMC
+    if ((bmc_location == BB_BMC) || (bmc_location == DVT_BB_BMC)) {
+      if (libusb_get_port_numbers(devs[i], path, sizeof(path)) < 2 || path[1] != slot_id) {
+        continue;
+      }
+    }
+
+    if (libusb_open(devs[i], &handle) < 0) {
+      handle = NULL;
+    }
+    break;
+  }
+  libusb_free_device_list(devs, 1);
+
+  if (handle != NULL) {
+    libusb_set_auto_detach_kernel_driver(handle, 1);
+  }
+  return handle;
+}
+
+// Open the device if not yet, looking again for an absent one every
+// BIC_USB_XFER_PROBE_SEC. Called with ux->mutex held.
+static bool
+bic_usb_xfer_probe(bic_usb_xfer_t *ux, uint8_t slot_id) {
+  struct timespec ts;
+
+  if (ux->unsupported) {
+    return false;
+  }
+  if (ux->handle != NULL) {
+    return true;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  if (ts.tv_sec < ux->next_probe) {
+    return false;
+  }
+  ux->next_probe = ts.tv_sec + BIC_USB_XFER_PROBE_SEC;
+
+  // A context of our own, libusb_exit(NULL) of the fw updates leaves it be
+  if (ux->ctx == NULL && libusb_init(&ux->ctx) < 0) {
+    ux->ctx = NULL;
+    return false;
+  }
+  ux->handle = bic_usb_xfer_open(slot_id, ux->ctx);
+  return ux->handle != NULL;
+}
+
+static void
+bic_usb_xfer_close(bic_usb_xfer_t *ux) {
+  struct timespec ts;
+
+  libusb_close(ux->handle);
+  ux->handle = NULL;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ux->next_probe = ts.tv_sec + BIC_USB_XFER_PROBE_SEC;
+}
+
+// Send an IPMI request to the server BIC over USB. *rxlen is the size of
+// rxbuf on input. Fails without sending anything when the BIC has no USB,
+// or its firmware does not serve IPMI over it, so the caller can go on
+// over IPMB.
+int
+bic_usb_ipmb_xfer(uint8_t slot_id, uint8_t netfn, uint8_t cmd, uint8_t *txbuf, uint16_t txlen, uint8_t *rxbuf, uint16_t *rxlen) {
+  bic_usb_xfer_t *ux;
+  uint8_t tbuf[BIC_USB_XFER_BUF_SIZE];
+  uint8_t rbuf[BIC_USB_XFER_BUF_SIZE];
+  int transferred = 0;
+  int received = 0;
+  int ret = BIC_STATUS_FAILURE;
+  int rc;
+
+  if (slot_id < FRU_SLOT1 || slot_id > FRU_SLOT4 || txlen > sizeof(tbuf) - 2) {
+    return BIC_STATUS_FAILURE;
+  }
+
+  ux = &usb_xfer[slot_id];
+  pthread_mutex_lock(&ux->mutex);
+  if (!bic_usb_xfer_probe(ux, slot_id)) {
+    goto exit;
+  }
+
+  // Claimed for the transfer only, so that fw-util can take it for an update
+  rc = libusb_claim_interface(ux->handle, BIC_USB_XFER_INTF);
+  if (rc < 0) {
+    if (rc == LIBUSB_ERROR_NO_DEVICE) {
+      bic_usb_xfer_close(ux);
+    }
+    goto exit;
+  }
+
+  tbuf[0] = netfn << 2;
+  tbuf[1] = cmd;
+  if (txlen) {
+    memcpy(&tbuf[2], txbuf, txlen);
+  }
+
+  rc = libusb_bulk_transfer(ux->handle, USB_INPUT_PORT, tbuf, txlen + 2, &transferred, BIC_USB_XFER_TIMEOUT);
+  if (rc == 0 && transferred == txlen + 2) {
+    rc = libusb_bulk_transfer(ux->handle, USB_OUTPUT_PORT, rbuf, sizeof(rbuf), &received, BIC_USB_XFER_TIMEOUT);
+  } else if (rc == 0) {
+    rc = LIBUSB_ERROR_IO;
+  }
+  libusb_release_interface(ux->handle, BIC_USB_XFER_INTF);
+
+  if (rc < 0) {
+    // Gone, or hung after a BIC reset: IPMB until the next probe
+    syslog(LOG_WARNING, "%s: slot%d netfn: 0x%02X cmd: 0x%02X, USB transfer failed (%s), using IPMB", __func__, slot_id, netfn, cmd, libusb_error_name(rc));
+    bic_usb_xfer_close(ux);
+    goto exit;
+  }
+
+  if (received < 3 || (rbuf[0] >> 2) != (netfn | 0x01) || rbuf[1] != cmd ||
+      rbuf[2] == CC_INVALID_CMD) {
+    syslog(LOG_WARNING, "%s: slot%d netfn: 0x%02X cmd: 0x%02X, not served over USB, using IPMB", __func__, slot_id, netfn, cmd);
+    ux->unsupported = true;
+    goto exit;
+  }
+
+  if (rbuf[2] != CC_SUCCESS || received - 3 > *rxlen) {
+    goto exit;
+  }
+
+  *rxlen = received - 3;
+  memcpy(rxbuf, &rbuf[3], *rxlen);
+  ret = BIC_STATUS_SUCCESS;
+
+exit:
+  pthread_mutex_unlock(&ux->mutex);
+  return ret;
+}
+
+// Whether the responses of the request are worth the USB: reads of more
+// than BIC_USB_XFER_THRESHOLD bytes, which are slow at IPMB speed
+static bool
+bic_usb_xfer_wanted(uint8_t netfn, uint8_t cmd, uint8_t *txbuf, uint16_t txlen) {
+  switch ((netfn << 8) | cmd) {
+    case (NETFN_STORAGE_REQ << 8) | CMD_STORAGE_READ_FRUID_DATA:
+      return txlen >= 4 && txbuf[3] > BIC_USB_XFER_THRESHOLD;
+    case (NETFN_STORAGE_REQ << 8) | CMD_STORAGE_GET_SDR:
+      return txlen >= sizeof(ipmi_sel_sdr_req_t) &&
+             ((ipmi_sel_sdr_req_t *)txbuf)->nbytes > BIC_USB_XFER_THRESHOLD;
+    case (NETFN_OEM_1S_REQ << 8) | CMD_OEM_1S_GET_POST_BUF:
+      return true;
+  }
+  return false;
+}
+
+// Whether reads of the slot can go over USB, to size them
+bool
+bic_usb_xfer_ready(uint8_t slot_id) {
+  bool ready;
+
+  if (slot_id < FRU_SLOT1 || slot_id > FRU_SLOT4) {
+    return false;
+  }
+
+  pthread_mutex_lock(&usb_xfer[slot_id].mutex);
+  ready = bic_usb_xfer_probe(&usb_xfer[slot_id], slot_id);
+  pthread_mutex_unlock(&usb_xfer[slot_id].mutex);
+  return ready;
+}
+
 int bic_ipmb_wrapper(uint8_t slot_id, uint8_t netfn, uint8_t cmd,
                      uint8_t *txbuf, uint16_t txlen, uint8_t *rxbuf, uint8_t *rxlen) {
   ipmb_req_t *req;
@@ -192,6 +402,15 @@ int bic_ipmb_wrapper(uint8_t slot_id, uint8_t netfn, uint8_t cmd,
 
   bus_id = (uint8_t) ret;
 
+  // Large responses over USB when the BIC has it, IPMB otherwise
+  if (bic_usb_xfer_wanted(netfn, cmd, txbuf, txlen)) {
+    uint16_t ulen = 0xFF;
+    if (bic_usb_ipmb_xfer(slot_id, netfn, cmd, txbuf, txlen, rxbuf, &ulen) == BIC_STATUS_SUCCESS) {
+      *rxlen = ulen;
+      return BIC_STATUS_SUCCESS;
+    }
+  }
+
   req = (ipmb_req_t*)tbuf;
 
   req->res_slave_addr = BRIDGE_SLAVE_ADDR << 1;
@@ -371,6 +590,173 @@ send_image_data_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t of
   return ret;
 }
 
+
+/*
+ * Image chunks sent by send_image_data_window_via_bic(): the BIC answers
+ * every chunk on its own, so several chunks are kept in flight through
+ * ipmbd by one sender thread each. A chunk that fails is retried alone by
+ * send_image_data_via_bic() while the others go on.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  uint8_t slot_id;
+  uint8_t comp;
+  uint8_t intf;
+  uint32_t offset;
+  uint32_t len;
+  uint16_t chunk_len;
+  uint32_t image_len;
+  uint8_t *buf;
+  uint32_t next;  // position in buf of the next chunk to send
+  int ret;
+} image_window_t;
+
+static void *
+image_window_sender(void *arg) {
+  image_window_t *w = (image_window_t *)arg;
+  uint32_t pos, count;
+  int ret;
+
+  while (1) {
+    pthread_mutex_lock(&w->lock);
+    if (w->ret != BIC_STATUS_SUCCESS || w->next >= w->len) {
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    pos = w->next;
+    count = w->len - pos;
+    if (count > w->chunk_len) {
+      count = w->chunk_len;
+    }
+    w->next += count;
+    pthread_mutex_unlock(&w->lock);
+
+    ret = send_image_data_via_bic(w->slot_id, w->comp, w->intf, w->offset + pos, count, w->image_len, w->buf + pos);
+    if (ret != BIC_STATUS_SUCCESS) {
+      pthread_mutex_lock(&w->lock);
+      if (w->ret == BIC_STATUS_SUCCESS) {
+        w->ret = ret;
+      }
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+  }
+  return NULL;
+}
+
+int
+get_image_data_window(void) {
+  const char *env = getenv("FW_UTIL_IPMB_WINDOW");
+  int window = IMAGE_DATA_WINDOW;
+
+  if (env != NULL) {
+    window = atoi(env);
+  }
+  if (window < 1) {
+    window = 1;
+  } else if (window > IMAGE_DATA_WINDOW_MAX) {
+    window = IMAGE_DATA_WINDOW_MAX;
+  }
+  return window;
+}
+
+int
+send_image_data_window_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint16_t chunk_len, uint32_t image_len, uint8_t *buf, int window)
+{
+  image_window_t w = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .slot_id = slot_id,
+    .comp = comp,
+    .intf = intf,
+    .offset = offset,
+    .len = len,
+    .chunk_len = chunk_len,
+    .image_len = image_len,
+    .buf = buf,
+    .next = 0,
+    .ret = BIC_STATUS_SUCCESS,
+  };
+  pthread_t tid[IMAGE_DATA_WINDOW_MAX];
+  int i, num = 0;
+
+  if (chunk_len == 0) {
+    return BIC_STATUS_FAILURE;
+  }
+  if (window > IMAGE_DATA_WINDOW_MAX) {
+    window = IMAGE_DATA_WINDOW_MAX;
+  }
+  if (window > (len + chunk_len - 1) / chunk_len) {
+    window = (len + chunk_len - 1) / chunk_len;
+  }
+
+  // The calling thread is one of the senders, the stop-and-wait one
+  // with a window of 1.
+  for (i = 1; i < window; i++) {
+    if (pthread_create(&tid[num], NULL, image_window_sender, &w) != 0) {
+      syslog(LOG_WARNING, "%s() sending with %d chunks in flight", __func__, num + 1);
+      break;
+    }
+    num++;
+  }
+  image_window_sender(&w);
+  for (i = 0; i < num; i++) {
+    pthread_join(tid[i], NULL);
+  }
+
+  return w.ret;
+}
+
+void
+image_data_pace_init(image_data_pace_t *pace, uint16_t chunk_max, int window) {
+  pace->chunk_len = chunk_max;
+  pace->chunk_max = chunk_max;
+  pace->window = window;
+  pace->window_max = window;
+  pace->good = 0;
+}
+
+/*
+ * Sends a block as send_image_data_window_via_bic() does, at the pace of
+ * the update. A block that fails is sent again (the BIC writes every
+ * chunk at its offset) backing off: one chunk in flight first, then
+ * chunks of half the length down to IMAGE_DATA_CHUNK_MIN. The pace is
+ * stepped back up every IMAGE_DATA_PACE_GROW blocks sent fine.
+ */
+int
+send_image_data_paced_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint32_t image_len, uint8_t *buf, image_data_pace_t *pace)
+{
+  int ret;
+
+  while (1) {
+    ret = send_image_data_window_via_bic(slot_id, comp, intf, offset, len, pace->chunk_len, image_len, buf, pace->window);
+    if (ret == BIC_STATUS_SUCCESS) {
+      if (++pace->good >= IMAGE_DATA_PACE_GROW) {
+        pace->good = 0;
+        if (pace->chunk_len < pace->chunk_max) {
+          pace->chunk_len = (pace->chunk_len * 2 < pace->chunk_max) ? pace->chunk_len * 2 : pace->chunk_max;
+        } else {
+          pace->window = pace->window_max;
+        }
+      }
+      return ret;
+    }
+    if (ret == BIC_STATUS_NOT_SUPP_IN_CURR_STATE ||
+        (pace->window <= 1 && pace->chunk_len <= IMAGE_DATA_CHUNK_MIN)) {
+      return ret;
+    }
+
+    pace->good = 0;
+    if (pace->window > 1) {
+      pace->window = 1;
+    } else {
+      pace->chunk_len = (pace->chunk_len / 2 > IMAGE_DATA_CHUNK_MIN) ? pace->chunk_len / 2 : IMAGE_DATA_CHUNK_MIN;
+    }
+    printf("%s() slot: %d, target: %d, offset: %u, resending with %u bytes chunks, %d in flight\n",
+           __func__, slot_id, comp, offset, pace->chunk_len, pace->window);
+    syslog(LOG_WARNING, "%s() slot %d: block at %u failed, resending with %u bytes chunks, %d in flight",
+           __func__, slot_id, offset, pace->chunk_len, pace->window);
+  }
+}
 int
 open_and_get_size(char *path, int *file_size) {
   struct stat finfo;
@@ -25,6 +25,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <openbmc/ipmb.h>
 #include <openbmc/ipmi.h>
 #include <facebook/fby35_common.h>
@@ -34,6 +35,17 @@ extern "C" {
 #define MIN_IPMB_BYPASS_LEN 6
 extern const uint32_t IANA_ID;
 
+//Image chunks in flight of a windowed update, FW_UTIL_IPMB_WINDOW overrides
+#define IMAGE_DATA_WINDOW 4
+#define IMAGE_DATA_WINDOW_MAX 16
+//Smallest chunk a failing block is sent again with, and the blocks to send
+//fine before the pace of a paced update is stepped up again
+#define IMAGE_DATA_CHUNK_MIN 32
+#define IMAGE_DATA_PACE_GROW 4
+
+//Responses expected above this go over the USB of the BIC, when it has it
+#define BIC_USB_XFER_THRESHOLD 32
+
 enum {
   BIC_CMD_OEM_SET_AMBER_LED     = 0x39,
   BIC_CMD_OEM_GET_SET_GPIO      = 0x41,
@@ -64,6 +76,16 @@ enum {
   NONE_INTF     = 0xff,
 };
 
+//Pace of the blocks of send_image_data_paced_via_bic(), kept across the
+//blocks of an update
+typedef struct {
+  uint16_t chunk_len;
+  uint16_t chunk_max;
+  int window;
+  int window_max;
+  int good;  // blocks sent fine since the last change of pace
+} image_data_pace_t;
+
 //It is used to check the signed image of CPLD/BIC
 enum {
   BICDL  = 0x01,
@@ -81,11 +103,17 @@ int i2c_open(uint8_t bus_id, uint8_t addr_7bit);
 int i2c_io(int fd, uint8_t *tbuf, uint8_t tcount, uint8_t *rbuf, uint8_t rcount);
 int is_bic_ready(uint8_t slot_id, uint8_t intf);
 int bic_ipmb_send(uint8_t slot_id, uint8_t netfn, uint8_t cmd, uint8_t *tbuf, uint8_t tlen, uint8_t *rbuf, uint8_t *rlen, uint8_t intf);
+int bic_usb_ipmb_xfer(uint8_t slot_id, uint8_t netfn, uint8_t cmd, uint8_t *txbuf, uint16_t txlen, uint8_t *rxbuf, uint16_t *rxlen);
+bool bic_usb_xfer_ready(uint8_t slot_id);
 int bic_ipmb_wrapper(uint8_t slot_id, uint8_t netfn, uint8_t cmd, uint8_t *txbuf, uint16_t txlen, uint8_t *rxbuf, uint8_t *rxlen);
 int bic_me_xmit(uint8_t slot_id, uint8_t *txbuf, uint8_t txlen, uint8_t *rxbuf, uint8_t *rxlen);
 int bic_set_fan_auto_mode(uint8_t crtl, uint8_t *status);
 int _set_fw_update_ongoing(uint8_t slot_id, uint16_t tmout);
 int send_image_data_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint16_t len, uint32_t image_len, uint8_t *buf);
+int get_image_data_window(void);
+int send_image_data_window_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint16_t chunk_len, uint32_t image_len, uint8_t *buf, int window);
+void image_data_pace_init(image_data_pace_t *pace, uint16_t chunk_max, int window);
+int send_image_data_paced_via_bic(uint8_t slot_id, uint8_t comp, uint8_t intf, uint32_t offset, uint32_t len, uint32_t image_len, uint8_t *buf, image_data_pace_t *pace);
 int open_and_get_size(char *path, int *file_size);
 #ifdef __cplusplus
 } // extern "C"
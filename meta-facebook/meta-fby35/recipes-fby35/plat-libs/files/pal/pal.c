@@ -30,6 +30,7 @@
 #include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <openbmc/kv.h>
@@ -2343,17 +2344,93 @@ pal_post_display(uint8_t uart_select, uint8_t postcode) {
   return ret;
 }
 
+// Debug card state of pal_post_handle(), which runs for every POST code.
+// The presence is read again past POST_PRSNT_CACHE_MS and the UART
+// select when front-paneld changes it in kv, or past POST_UART_CACHE_MS
+// should the change not be seen.
+#define POST_PRSNT_CACHE_MS 500
+#define POST_UART_CACHE_MS 1000
+// Codes coming faster than this are not shown but the latest one
+#define POST_DISPLAY_MIN_MS 20
+#define POST_PENDING (1U << 16)
+
+static uint8_t post_prsnt;
+static uint8_t post_uart_select;
+static int64_t post_prsnt_expire;  // ms of CLOCK_MONOTONIC
+static int64_t post_uart_expire;
+// Code waiting for the display thread, POST_PENDING | uart_select << 8 | code
+static uint32_t post_pending;
+static pthread_mutex_t post_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t post_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t post_once = PTHREAD_ONCE_INIT;
+static bool post_thread_running;
+
+static int64_t
+post_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+post_uart_select_changed(const char *key, void *arg) {
+  __atomic_store_n(&post_uart_expire, 0, __ATOMIC_RELEASE);
+}
+
+// Shows the latest pending code, the ones replaced meanwhile are dropped
+static void *
+post_display_thread(void *arg) {
+  uint32_t pending;
+
+  pthread_detach(pthread_self());
+  while (1) {
+    pthread_mutex_lock(&post_mutex);
+    while (!(__atomic_load_n(&post_pending, __ATOMIC_ACQUIRE) & POST_PENDING)) {
+      pthread_cond_wait(&post_cond, &post_mutex);
+    }
+    pthread_mutex_unlock(&post_mutex);
+
+    pending = __atomic_exchange_n(&post_pending, 0, __ATOMIC_ACQ_REL);
+    pal_post_display((pending >> 8) & 0xFF, pending & 0xFF);
+    msleep(POST_DISPLAY_MIN_MS);
+  }
+
+  return NULL;
+}
+
+static void
+post_init(void) {
+  pthread_t tid;
+
+  if (kv_watch("debug_card_uart_select", post_uart_select_changed, NULL, 0) == NULL) {
+    syslog(LOG_WARNING, "%s: cannot watch debug_card_uart_select, polling it", __func__);
+  }
+  post_thread_running = (pthread_create(&tid, NULL, post_display_thread, NULL) == 0);
+}
+
 // Handle the received post code, display it on debug card
 int
 pal_post_handle(uint8_t slot, uint8_t postcode) {
   uint8_t prsnt = 0;
   uint8_t uart_select = 0;
+  uint32_t prev;
+  int64_t now;
   int ret = -1;
 
+  pthread_once(&post_once, post_init);
+  now = post_now_ms();
+
   // Check for debug card presence
-  ret = pal_is_debug_card_prsnt(&prsnt);
-  if (ret) {
-    return ret;
+  if (now < __atomic_load_n(&post_prsnt_expire, __ATOMIC_ACQUIRE)) {
+    prsnt = __atomic_load_n(&post_prsnt, __ATOMIC_RELAXED);
+  } else {
+    ret = pal_is_debug_card_prsnt(&prsnt);
+    if (ret) {
+      return ret;
+    }
+    __atomic_store_n(&post_prsnt, prsnt, __ATOMIC_RELAXED);
+    __atomic_store_n(&post_prsnt_expire, now + POST_PRSNT_CACHE_MS, __ATOMIC_RELEASE);
   }
 
   // No debug card  present, return
@@ -2362,9 +2439,17 @@ pal_post_handle(uint8_t slot, uint8_t postcode) {
   }
 
   // Get the UART SELECT from kv, avoid large access CPLD in a short time
-  ret = pal_get_uart_select_from_kv(&uart_select);
-  if (ret) {
-    return ret;
+  if (now < __atomic_load_n(&post_uart_expire, __ATOMIC_ACQUIRE)) {
+    uart_select = __atomic_load_n(&post_uart_select, __ATOMIC_RELAXED);
+  } else {
+    // Expired before reading, so that a change meanwhile is read again
+    __atomic_store_n(&post_uart_expire, now + POST_UART_CACHE_MS, __ATOMIC_RELEASE);
+    ret = pal_get_uart_select_from_kv(&uart_select);
+    if (ret) {
+      __atomic_store_n(&post_uart_expire, 0, __ATOMIC_RELEASE);
+      return ret;
+    }
+    __atomic_store_n(&post_uart_select, uart_select, __ATOMIC_RELAXED);
   }
 
   // If the give server is not selected, return
@@ -2372,10 +2457,21 @@ pal_post_handle(uint8_t slot, uint8_t postcode) {
     return 0;
   }
 
-  // Display the post code in the debug card
-  ret = pal_post_display(uart_select, postcode);
+  if (!post_thread_running) {
+    return pal_post_display(uart_select, postcode);
+  }
 
-  return ret;
+  // Display the post code in the debug card, waking up the display
+  // thread unless it has a code pending already
+  prev = __atomic_exchange_n(&post_pending, POST_PENDING | (uart_select << 8) | postcode,
+                             __ATOMIC_ACQ_REL);
+  if (!(prev & POST_PENDING)) {
+    pthread_mutex_lock(&post_mutex);
+    pthread_cond_signal(&post_cond);
+    pthread_mutex_unlock(&post_mutex);
+  }
+
+  return 0;
 }
 
 static int
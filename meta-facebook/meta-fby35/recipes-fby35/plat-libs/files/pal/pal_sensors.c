@@ -9,6 +9,8 @@
 #include <sys/file.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <pthread.h>
 #include <openbmc/kv.h>
 #include <openbmc/libgpio.h>
 #include <openbmc/obmc-i2c.h>
@@ -63,6 +65,7 @@ static int pal_sdr_init(uint8_t fru);
 static sensor_info_t g_sinfo[MAX_NUM_FRUS][MAX_SENSOR_NUM + 1] = {0};
 static bool sdr_init_done[MAX_NUM_FRUS] = {false};
 static uint8_t bic_dynamic_sensor_list[4][MAX_SENSOR_NUM + 1] = {0};
+static int bic_dynamic_sensor_cnt[4] = {0};
 static uint8_t bic_dynamic_skip_sensor_list[4][MAX_SENSOR_NUM + 1] = {0};
 
 int pwr_off_flag[MAX_NODES] = {0};
@@ -1067,6 +1070,7 @@ pal_get_fru_sensor_list(uint8_t fru, uint8_t **sensor_list, int *cnt) {
 
     *sensor_list = (uint8_t *) bic_dynamic_sensor_list[fru-1];
     *cnt = current_cnt;
+    bic_dynamic_sensor_cnt[fru-1] = current_cnt;
     break;
   default:
     if (fru > MAX_NUM_FRUS)
@@ -1978,11 +1982,123 @@ skip_bic_sensor_list(uint8_t fru, uint8_t sensor_num, const uint8_t bmc_location
   return PAL_EOK;
 }
 
+// The BIC interface a sensor is read through, or -1 if it is not present.
+static int
+get_bic_sensor_intf(uint8_t sensor_num, const uint8_t bmc_location, const uint8_t config_status, uint8_t *intf) {
+  if (sensor_num <= 0x42) { //server board
+    *intf = NONE_INTF;
+  } else if ( (sensor_num >= 0x50 && sensor_num <= 0x7F) && (bmc_location != NIC_BMC) && //1OU
+       ((config_status & PRESENT_1OU) == PRESENT_1OU) ) {
+    *intf = FEXP_BIC_INTF;
+  } else if ( ((sensor_num >= 0x80 && sensor_num <= 0xCE) ||     //2OU
+               (sensor_num >= 0x49 && sensor_num <= 0x4D)) &&    //Many sensors are defined in GPv3.
+              ((config_status & PRESENT_2OU) == PRESENT_2OU) ) { //The range from 0x80 to 0xCE is not enough for adding new sensors.
+                                                                 //So, we take 0x49 ~ 0x4D here
+    *intf = REXP_BIC_INTF;
+  } else if ( (sensor_num >= 0xD1 && sensor_num <= 0xEC) ) { //BB
+    *intf = BB_BIC_INTF;
+  } else {
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Snapshot of the BIC sensors of a slot: the first read of a sweep fetches
+ * all the sensors of the slot with bic_get_sensor_readings(), and the rest
+ * of the sweep is served from it. A reading is handed out once, and not
+ * after BIC_SNR_SNAPSHOT_MAX_AGE_MS.
+ */
+#define BIC_SNR_SNAPSHOT_MAX_AGE_MS 1000
+
+typedef struct {
+  pthread_mutex_t lock;
+  uint64_t ts_ms;
+  bool fresh[MAX_SENSOR_NUM + 1];
+  int ret[MAX_SENSOR_NUM + 1];
+  snr_reading_ret reading[MAX_SENSOR_NUM + 1];
+} bic_snr_snapshot_t;
+
+static bic_snr_snapshot_t bic_snr_snapshot[MAX_NODES] = {
+  [0 ... MAX_NODES-1] = { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static uint64_t
+snapshot_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+bic_snr_snapshot_refresh(uint8_t fru, uint8_t power_status, const uint8_t bmc_location, const uint8_t config_status) {
+  static const uint8_t intf_list[] = {NONE_INTF, FEXP_BIC_INTF, REXP_BIC_INTF, BB_BIC_INTF};
+  bic_snr_snapshot_t *snap = &bic_snr_snapshot[fru-1];
+  uint8_t *list = bic_dynamic_sensor_list[fru-1];
+  uint8_t nums[MAX_SENSOR_NUM + 1];
+  snr_reading_ret readings[MAX_SENSOR_NUM + 1];
+  int rets[MAX_SENSOR_NUM + 1];
+  uint8_t intf = 0;
+  int i, j, cnt;
+
+  memset(snap->fresh, 0, sizeof(snap->fresh));
+  for (i = 0; i < ARRAY_SIZE(intf_list); i++) {
+    cnt = 0;
+    for (j = 0; j < bic_dynamic_sensor_cnt[fru-1]; j++) {
+      if (get_bic_sensor_intf(list[j], bmc_location, config_status, &intf) < 0 || intf != intf_list[i]) {
+        continue;
+      }
+      // not read while the server is off
+      if (power_status != SERVER_POWER_ON && skip_bic_sensor_list(fru, list[j], bmc_location, config_status) < 0) {
+        continue;
+      }
+      nums[cnt++] = list[j];
+    }
+    if (cnt == 0) {
+      continue;
+    }
+
+    bic_get_sensor_readings(fru, nums, cnt, readings, rets, intf_list[i]);
+    for (j = 0; j < cnt; j++) {
+      snap->reading[nums[j]] = readings[j];
+      snap->ret[nums[j]] = rets[j];
+      snap->fresh[nums[j]] = true;
+    }
+  }
+  snap->ts_ms = snapshot_now_ms();
+}
+
+static int
+bic_snr_snapshot_read(uint8_t fru, uint8_t sensor_num, snr_reading_ret *sensor, uint8_t intf,
+                      uint8_t power_status, const uint8_t bmc_location, const uint8_t config_status) {
+  bic_snr_snapshot_t *snap = &bic_snr_snapshot[fru-1];
+  int ret = 0;
+
+  pthread_mutex_lock(&snap->lock);
+  if (!snap->fresh[sensor_num] || (snapshot_now_ms() - snap->ts_ms) > BIC_SNR_SNAPSHOT_MAX_AGE_MS) {
+    bic_snr_snapshot_refresh(fru, power_status, bmc_location, config_status);
+  }
+  if (snap->fresh[sensor_num]) {
+    *sensor = snap->reading[sensor_num];
+    ret = snap->ret[sensor_num];
+    snap->fresh[sensor_num] = false;
+  } else {
+    // not in the sensor list of the slot
+    ret = bic_get_sensor_reading(fru, sensor_num, sensor, intf);
+  }
+  pthread_mutex_unlock(&snap->lock);
+
+  return ret;
+}
+
 static int
 pal_bic_sensor_read_raw(uint8_t fru, uint8_t sensor_num, float *value, uint8_t bmc_location, const uint8_t config_status) {
 #define BIC_SENSOR_READ_NA 0x20
   int ret = 0;
   uint8_t power_status = 0;
+  uint8_t intf = 0;
   snr_reading_ret sensor = {0};
   sdr_full_t *sdr = NULL;
   char path[128];
@@ -2021,21 +2137,10 @@ pal_bic_sensor_read_raw(uint8_t fru, uint8_t sensor_num, float *value, uint8_t b
   }
 
   //check snr number first. If it not holds, it will move on
-  if (sensor_num <= 0x42) { //server board
-    ret = bic_get_sensor_reading(fru, sensor_num, &sensor, NONE_INTF);
-  } else if ( (sensor_num >= 0x50 && sensor_num <= 0x7F) && (bmc_location != NIC_BMC) && //1OU
-       ((config_status & PRESENT_1OU) == PRESENT_1OU) ) {
-    ret = bic_get_sensor_reading(fru, sensor_num, &sensor, FEXP_BIC_INTF);
-  } else if ( ((sensor_num >= 0x80 && sensor_num <= 0xCE) ||     //2OU
-               (sensor_num >= 0x49 && sensor_num <= 0x4D)) &&    //Many sensors are defined in GPv3.
-              ((config_status & PRESENT_2OU) == PRESENT_2OU) ) { //The range from 0x80 to 0xCE is not enough for adding new sensors.
-                                                                 //So, we take 0x49 ~ 0x4D here
-    ret = bic_get_sensor_reading(fru, sensor_num, &sensor, REXP_BIC_INTF);
-  } else if ( (sensor_num >= 0xD1 && sensor_num <= 0xEC) ) { //BB
-    ret = bic_get_sensor_reading(fru, sensor_num, &sensor, BB_BIC_INTF);
-  } else {
+  if (get_bic_sensor_intf(sensor_num, bmc_location, config_status, &intf) < 0) {
     return READING_NA;
   }
+  ret = bic_snr_snapshot_read(fru, sensor_num, &sensor, intf, power_status, bmc_location, config_status);
 
   if ( ret < 0 ) {
     syslog(LOG_WARNING, "%s() Failed to run bic_get_sensor_reading(). fru: %x, snr#0x%x", __func__, fru, sensor_num);
@@ -131,25 +131,43 @@ fruid_cache_init(void) {
 }
 
 void
-sensor_timestamp_init(void) {
-  // Initialize SCC and DPB sensor timestamp to 0
+sensor_snapshot_init(void) {
+  // Version 0: No SCC and DPB sensor snapshot yet
   char key[MAX_KEY_LEN] = {0};
   int ret = 0;
 
-  snprintf(key, sizeof(key), "dpb_sensor_timestamp");
-  ret = pal_set_cached_value(key, "0");
+  snprintf(key, sizeof(key), DPB_SENSOR_SNAPSHOT_KEY);
+  ret = pal_set_cached_value(key, "0 0");
   if (ret != 0) {
     syslog(LOG_CRIT, "%s, failed to init %s, ret: %d", __func__, key, ret);
   }
 
   memset(key, 0, sizeof(key));
-  snprintf(key, sizeof(key), "scc_sensor_timestamp");
-  ret = pal_set_cached_value(key, "0");
+  snprintf(key, sizeof(key), SCC_SENSOR_SNAPSHOT_KEY);
+  ret = pal_set_cached_value(key, "0 0");
   if (ret != 0) {
     syslog(LOG_CRIT, "%s, failed to init %s, ret: %d", __func__, key, ret);
   }
 }
 
+// The only bulk reader of SCC and DPB sensors: All the readers
+// (sensord, sensor-util, ...) get them from the published snapshot,
+// so there is one bulk read per period however many they are.
+void
+sensor_snapshot_poll(void) {
+  int i = 0;
+  uint32_t version[ARRAY_SIZE(expander_fruid_list)] = {0};
+
+  while (1) {
+    for (i = 0; i < ARRAY_SIZE(expander_fruid_list); i++) {
+      if (pal_exp_sensor_poll(expander_fruid_list[i], version[i] + 1) == 0) {
+        version[i]++;
+      }
+    }
+    sleep(EXP_SENSOR_WAIT_TIME);
+  }
+}
+
 void
 sensor_threshold_init(void) {
   int i = 0, ret = 0;
@@ -182,9 +200,10 @@ main (int argc, char * const argv[])
   }
 
   if (strcmp(argv[1], "--booting") == 0) {
-    sensor_timestamp_init();
+    sensor_snapshot_init();
     fruid_cache_init();
     sensor_threshold_init();
+    sensor_snapshot_poll();
 
   } else if (strcmp(argv[1], "--update_fan") == 0) {
     if (strcmp(argv[2], "fan0") == 0) {
@@ -17,13 +17,14 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <syslog.h>
 #include <string.h>
-#include <pthread.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <sys/file.h>
 #include <sys/types.h>
@@ -31,15 +32,19 @@
 #include <sys/un.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <openbmc/kv.h>
 #include <openbmc/pal.h>
-#include <openbmc/kv.h>
+#include <openbmc/libgpio.h>
 #include <facebook/fbgc_common.h>
 #include <facebook/fbgc_gpio.h>
 
 #define LED_INTERVAL_DEFAULT              500 //millisecond
 #define MONITOR_FRU_HEALTH_INTERVAL       1 //second
 #define SYNC_SYSTEM_STATUS_LED_INTERVAL   1 //second
+#define SYNC_ID_LED_INTERVAL              1 //second
 #define DBG_CARD_SHOW_ERR_INTERVAL        1 //second
 #define DBG_CARD_UPDATE_ERR_INTERVAL      5 //second
 #define MONITOR_HB_HEALTH_INTERVAL        5 //second
@@ -50,391 +55,660 @@
 #define HEARTBEAT_TIMEOUT                 180 // second = 3 mins
 #define MAX_NUM_CHECK_HB_HEALTH           4
 
-// Thread to handle LED state of the SLED
-static void *
-led_sync_handler() {
-  int ret = 0, ret2 = 0;
-  char identify[MAX_VALUE_LEN] = {0};
-  char interval[MAX_VALUE_LEN] = {0};
+#define MAX_NUM_DBG_CARD_GPIOS            5
+
+// Handlers of the front panel, in the order they run when due together:
+// FRU health sets the error codes that the status LED then shows.
+enum {
+  TASK_LED_SYNC = 0,
+  TASK_FRU_HEALTH,
+  TASK_SYSTEM_STATUS_LED,
+  TASK_DBG_CARD_ERR_CODE,
+  TASK_HB_HEALTH,
+  TASK_E1S_LED_SYNC,
+  MAX_NUM_TASKS,
+};
+
+#define TASK_BIT(task)                    (1U << (task))
+
+// A handler run by the event loop of main(): init() returns < 0 when the
+// handler does not apply to this system, run() returns the milliseconds
+// until its next run.
+struct front_task {
+  const char *name;
+  int (*init)(void);
+  int (*run)(void);
+  bool enabled;
+  int64_t next_ms;
+};
+
+// GPIOs whose edges make the debug card handler run at once
+static const uint8_t dbg_card_gpio_list[MAX_NUM_DBG_CARD_GPIOS] = {
+  GPIO_DEBUG_CARD_PRSNT_N,
+  GPIO_BMC_FPGA_UART_SEL0_R,
+  GPIO_BMC_FPGA_UART_SEL1_R,
+  GPIO_BMC_FPGA_UART_SEL2_R,
+  GPIO_BMC_FPGA_UART_SEL3_R,
+};
+
+// eventfd to wake the event loop, and the tasks it has to run now
+static int wake_fd = -1;
+static unsigned int wake_tasks_pending = 0;
+static bool dbg_card_changed = false;
+
+static int64_t
+monotonic_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Make tasks due now, from any thread
+static void
+wake_tasks(unsigned int tasks) {
+  uint64_t one = 1;
+
+  __atomic_fetch_or(&wake_tasks_pending, tasks, __ATOMIC_SEQ_CST);
+  if (write(wake_fd, &one, sizeof(one)) < 0) {
+    syslog(LOG_WARNING, "%s(): failed to wake the event loop: %s", __func__, strerror(errno));
+  }
+}
+
+static bool
+key_has_suffix(const char *key, const char *suffix) {
+  size_t key_len = strlen(key), suffix_len = strlen(suffix);
+
+  return (key_len >= suffix_len) && (strcmp(key + key_len - suffix_len, suffix) == 0);
+}
+
+// Called from a kv thread for every change of the persistent keys
+static void
+persist_key_changed(const char *key, void *arg) {
+  unsigned int tasks = 0;
+
+  if (key_has_suffix(key, "_sensor_health")) {
+    tasks |= TASK_BIT(TASK_FRU_HEALTH) | TASK_BIT(TASK_SYSTEM_STATUS_LED);
+  } else if (strncmp(key, "system_identify_", strlen("system_identify_")) == 0) {
+    tasks |= TASK_BIT(TASK_LED_SYNC);
+  } else if (strcmp(key, "heartbeat_health") == 0) {
+    tasks |= TASK_BIT(TASK_HB_HEALTH);
+  }
+
+  if (tasks != 0) {
+    wake_tasks(tasks);
+  }
+}
+
+// Called from a kv thread for changes of the temporary keys it watches
+static void
+temp_key_changed(const char *key, void *arg) {
+  wake_tasks((unsigned int)(uintptr_t)arg);
+}
 
+static int
+led_sync_init(void) {
   // set flag to notice BMC front-paneld led_sync_handler is ready
   kv_set("flag_front_led_sync", STR_VALUE_1, 0, 0);
+  return 0;
+}
 
-  while (1) {
-    // Handle Slot IDENTIFY condition
-    memset(identify, 0x0, sizeof(identify));
-    memset(interval, 0x0, sizeof(interval));
-    
-    ret = pal_get_key_value("system_identify_server", identify);
-    ret2 = pal_get_key_value("system_identify_led_interval", interval);
-    
-    if ((ret == 0) && (strcmp(identify, "on") == 0)) {
-      // Start blinking the ID LED
-      pal_set_id_led(FRU_UIC, LED_ON);
-      
-      if ((ret2 == 0) && (strcmp(interval, "default") == 0)) {
-        msleep(LED_INTERVAL_DEFAULT);
-      } else if (ret2 == 0) {
-        sleep(atoi(interval));
-      }
-      
-      pal_set_id_led(FRU_UIC, LED_OFF);
+// Handle LED state of the SLED
+static int
+led_sync_handler(void) {
+  static bool id_led_on = false;
+  int ret = 0, ret2 = 0, interval_ms = 0;
+  char identify[MAX_VALUE_LEN] = {0};
+  char interval[MAX_VALUE_LEN] = {0};
 
-      if ((ret2 == 0) && (strcmp(interval, "default") == 0)) {
-        msleep(LED_INTERVAL_DEFAULT);
-      } else if (ret2 == 0) {
-        sleep(atoi(interval));
-      }
-      continue;
-    } else if ((ret == 0) && (strcmp(identify, "off") == 0)) {
-      pal_set_id_led(FRU_UIC, LED_ON);
+  // Handle Slot IDENTIFY condition
+  ret = pal_get_key_value("system_identify_server", identify);
+  ret2 = pal_get_key_value("system_identify_led_interval", interval);
+
+  if ((ret == 0) && (strcmp(identify, "on") == 0)) {
+    // Blink the ID LED: one step per interval
+    id_led_on = !id_led_on;
+    pal_set_id_led(FRU_UIC, id_led_on ? LED_ON : LED_OFF);
+
+    if ((ret2 == 0) && (strcmp(interval, "default") != 0)) {
+      interval_ms = atoi(interval) * 1000;
     }
-    sleep(1);
+    return (interval_ms > 0) ? interval_ms : LED_INTERVAL_DEFAULT;
+  } else if ((ret == 0) && (strcmp(identify, "off") == 0)) {
+    pal_set_id_led(FRU_UIC, LED_ON);
+    id_led_on = false;
   }
 
-  return NULL;
+  return SYNC_ID_LED_INTERVAL * 1000;
+}
+
+static int
+system_status_led_init(void) {
+  // set flag to notice BMC front-paneld system_status_led_handler is ready
+  kv_set("flag_front_sys_status_led", STR_VALUE_1, 0, 0);
+  return 0;
 }
 
-// Thread to handle different case of system status LED
+// Handle different case of system status LED
 // Define on OpenBMC spec. "3.2.4 Status/Fault LED"
-static void *
-system_status_led_handler() {
-  int ret = 0, blink_count = 1, i = 0;
+static int
+system_status_led_handler(void) {
+  static int blink_count = 1;
+  int ret = 0, i = 0;
   uint8_t server_power_status = SERVER_12V_OFF;
   uint8_t error[MAX_NUM_ERR_CODES] = {0}, error_count = 0;
   bool is_bmc_fault = false;
   char value[MAX_VALUE_LEN] = {0};
 
-  // set flag to notice BMC front-paneld system_status_led_handler is ready
-  kv_set("flag_front_sys_status_led", STR_VALUE_1, 0, 0);
+  // Get flag to check if status LED is setting by fpc-util
+  ret = kv_get("flag_fpc_status", value, NULL, 0);
+  if ((ret == 0) && (strcmp(value, STR_VALUE_1) == 0)) {
+    return SYNC_SYSTEM_STATUS_LED_INTERVAL * 1000;
+  }
 
-  while(1) {
-    // Get flag to check if status LED is setting by fpc-util
-    ret = kv_get("flag_fpc_status", value, NULL, 0);
-    if ((ret == 0) && (strcmp(value, STR_VALUE_1) == 0)) {
-      sleep(SYNC_SYSTEM_STATUS_LED_INTERVAL);
-      continue;
-    }
+  ret = pal_get_server_power(FRU_SERVER, &server_power_status);
+  if (ret < 0) {
+    //if can't get server power status, keep system status LED solid yellow
+    syslog(LOG_WARNING, "%s(): failed to get server power status", __func__);
 
-    ret = pal_get_server_power(FRU_SERVER, &server_power_status);
+    ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
     if (ret < 0) {
-      //if can't get server power status, keep system status LED solid yellow
-      syslog(LOG_WARNING, "%s(): failed to get server power status", __func__);
-      
-      ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
-      if (ret < 0) {
-        syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
+      syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
+    }
+
+  } else {
+    ret = pal_get_error_code(error, &error_count);
+
+    // When server power on
+    if (server_power_status == SERVER_POWER_ON) {
+      if ((error_count == 0) && (ret == 0)) {
+        // Solid Blue: BMC, server, and Expander have no fault
+        ret = pal_set_status_led(FRU_UIC, STATUS_LED_BLUE);
+        if (ret < 0) {
+          syslog(LOG_WARNING, "%s(): failed to set server status LED to solid blue", __func__);
+        }
+      } else {
+        // Solid Yellow: BMC, server, or Expander have fault
+        ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
+        if (ret < 0) {
+          syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
+        }
       }
-      
+
+    // When server power off: only check BMC has error or not
     } else {
-      ret = pal_get_error_code(error, &error_count);
-      
-      // When server power on
-      if (server_power_status == SERVER_POWER_ON) {
-        if ((error_count == 0) && (ret == 0)) {
-          // Solid Blue: BMC, server, and Expander have no fault
-          ret = pal_set_status_led(FRU_UIC, STATUS_LED_BLUE);
-          if (ret < 0) {
-            syslog(LOG_WARNING, "%s(): failed to set server status LED to solid blue", __func__);
-          }
-        } else {
-          // Solid Yellow: BMC, server, or Expander have fault
+      // Check BMC fault
+      for (i = 0; i < error_count; i++) {
+        if (error[i] >= MAX_NUM_EXP_ERR_CODES ) {
+          is_bmc_fault = true;
+          break;
+        }
+      }
+
+      // Blinking Yellow: BMC have no fault
+      if ((is_bmc_fault == false) && (ret == 0)){
+        if (blink_count > 0) {
           ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
-          if (ret < 0) {
-            syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
-          }
+        } else {
+          ret = pal_set_status_led(FRU_UIC, STATUS_LED_OFF);
         }
-      
-      // When server power off: only check BMC has error or not
+        blink_count = blink_count * -1;
+
+      // Solid Yellow: BMC have fault
       } else {
-        // Check BMC fault
-        for (i = 0; i < error_count; i++) {
-          if (error[i] >= MAX_NUM_EXP_ERR_CODES ) {
-            is_bmc_fault = true;
-            break;
-          } else {
-            is_bmc_fault = false;
-          }
-        }
-        
-        // Blinking Yellow: BMC have no fault
-        if ((is_bmc_fault == false) && (ret == 0)){
-          if (blink_count > 0) {
-            ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
-          } else {
-            ret = pal_set_status_led(FRU_UIC, STATUS_LED_OFF);
-          }
-          blink_count = blink_count * -1;
-        
-        // Solid Yellow: BMC have fault
-        } else {
-          ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
-          if (ret < 0) {
-            syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
-          }
+        ret = pal_set_status_led(FRU_UIC, STATUS_LED_YELLOW);
+        if (ret < 0) {
+          syslog(LOG_WARNING, "%s(): failed to set server status LED to solid yellow", __func__);
         }
       }
     }
-    
-    sleep(SYNC_SYSTEM_STATUS_LED_INTERVAL);
-  } // end while loop 
-  
-  return NULL;
+  }
+
+  return SYNC_SYSTEM_STATUS_LED_INTERVAL * 1000;
 }
 
-// Thread to handle fru health
-static void *
-fru_health_handler() {
+static int
+fru_health_init(void) {
+  // set flag to notice BMC front-paneld fru_health_handler is ready
+  kv_set("flag_front_health", STR_VALUE_1, 0, 0);
+  return 0;
+}
+
+// Handle fru health
+static int
+fru_health_handler(void) {
   uint8_t health = FRU_STATUS_GOOD;
   uint8_t fru_list[MAX_NUM_CHECK_FRU_HEALTH] = {FRU_SERVER, FRU_UIC, FRU_DPB, FRU_SCC, FRU_NIC};
   uint8_t health_error_code_list[MAX_NUM_CHECK_FRU_HEALTH] = {
-       ERR_CODE_SERVER_HEALTH, ERR_CODE_UIC_HEALTH, ERR_CODE_DPB_HEALTH, 
+       ERR_CODE_SERVER_HEALTH, ERR_CODE_UIC_HEALTH, ERR_CODE_DPB_HEALTH,
        ERR_CODE_SCC_HEALTH, ERR_CODE_NIC_HEALTH};
   int i = 0, ret = 0;
 
-  // set flag to notice BMC front-paneld fru_health_handler is ready
-  kv_set("flag_front_health", STR_VALUE_1, 0, 0);
+  for (i = 0; i < sizeof(fru_list); i++) {
+    ret = pal_get_fru_health(fru_list[i], &health);
+    if (ret < 0) {
+      health = FRU_STATUS_BAD;
+    }
 
-  while(1) {
-    // fru health
-    for (i = 0; i < sizeof(fru_list); i++) {
-      ret = pal_get_fru_health(fru_list[i], &health);
-      if (ret < 0) {
-        health = FRU_STATUS_BAD;
-      }
-      
-      if (health == FRU_STATUS_GOOD) {
-        pal_set_error_code(health_error_code_list[i], ERR_CODE_DISABLE);
-      } else if (health == FRU_STATUS_BAD) {
-        pal_set_error_code(health_error_code_list[i], ERR_CODE_ENABLE);
-      }
-    } // end for loop
-    sleep(MONITOR_FRU_HEALTH_INTERVAL);
-  } // end while loop 
-  
-  return NULL;
+    if (health == FRU_STATUS_GOOD) {
+      pal_set_error_code(health_error_code_list[i], ERR_CODE_DISABLE);
+    } else if (health == FRU_STATUS_BAD) {
+      pal_set_error_code(health_error_code_list[i], ERR_CODE_ENABLE);
+    }
+  } // end for loop
+
+  return MONITOR_FRU_HEALTH_INTERVAL * 1000;
 }
 
-// Thread to show error code on debug card
-static void *
-dbg_card_show_error_code() {
+static int
+dbg_card_show_error_code_init(void) {
+  // set flag to notice BMC front-paneld dbg_card_show_error_code is ready
+  kv_set("flag_front_err_code", STR_VALUE_1, 0, 0);
+  return 0;
+}
+
+// Show error code on debug card
+static int
+dbg_card_show_error_code(void) {
+  static uint8_t error[MAX_NUM_ERR_CODES] = {0};
+  static uint8_t cur_error_count = 0, pre_error_count = 0;
+  static int poll_error_timer = 0, error_index = 0;
   uint8_t dbg_present = 0;
   uint8_t uart_sel = 0;
-  uint8_t error[MAX_NUM_ERR_CODES] = {0}, error_code = 0;
-  uint8_t cur_error_count = 0, pre_error_count = 0;
+  uint8_t error_code = 0;
   int ret = 0;
-  int poll_error_timer = 0, error_index = 0;
-  
-  // set flag to notice BMC front-paneld dbg_card_show_error_code is ready
-  kv_set("flag_front_err_code", STR_VALUE_1, 0, 0);
 
-  while(1) {
-    ret = pal_is_debug_card_present(&dbg_present);
-    if ((ret == 0) && (dbg_present == FRU_PRESENT)) {
-      
-      ret = pal_get_debug_card_uart_sel(&uart_sel);
-      if ((ret == 0) && (uart_sel == DEBUG_UART_SEL_BMC)) {
-        
-        // update error code
-        if (poll_error_timer == 0) {
-          memset(error, 0, sizeof(error));
-          ret = pal_get_error_code(error, &cur_error_count);
-        }
-        
-        if (cur_error_count == 0) {
-          error_code = 0;
+  // the card was just plugged in or switched: show from a fresh error list
+  if (dbg_card_changed) {
+    dbg_card_changed = false;
+    poll_error_timer = 0;
+    error_index = 0;
+  }
 
-        } else {
-          // if the new error count is smaller, showing the error code start from scratch
-          if (cur_error_count < pre_error_count) {
-            error_index = 0;
-          }
-          pre_error_count = cur_error_count;
-          
-          error_code = error[error_index];
-          // Expander error code (1~100) need to change
-          // ex: decimal 99 change to hexadecimal 0x99
-          if (error_code < MAX_NUM_EXP_ERR_CODES) {
-            error_code = error_code/10*16+error_code%10;
-          }
-        }
-        
-        // show error code on debug card
-        pal_post_display(error_code);
-        
-        error_index++;
-        if (error_index >= cur_error_count) {
+  ret = pal_is_debug_card_present(&dbg_present);
+  if ((ret == 0) && (dbg_present == FRU_PRESENT)) {
+
+    ret = pal_get_debug_card_uart_sel(&uart_sel);
+    if ((ret == 0) && (uart_sel == DEBUG_UART_SEL_BMC)) {
+
+      // update error code
+      if (poll_error_timer == 0) {
+        memset(error, 0, sizeof(error));
+        ret = pal_get_error_code(error, &cur_error_count);
+      }
+
+      if (cur_error_count == 0) {
+        error_code = 0;
+
+      } else {
+        // if the new error count is smaller, showing the error code start from scratch
+        if (cur_error_count < pre_error_count) {
           error_index = 0;
         }
-        
-        poll_error_timer++;
-        if (poll_error_timer > DBG_CARD_UPDATE_ERR_INTERVAL) {
-          poll_error_timer = 0;
+        pre_error_count = cur_error_count;
+
+        error_code = error[error_index];
+        // Expander error code (1~100) need to change
+        // ex: decimal 99 change to hexadecimal 0x99
+        if (error_code < MAX_NUM_EXP_ERR_CODES) {
+          error_code = error_code/10*16+error_code%10;
         }
+      }
+
+      // show error code on debug card
+      pal_post_display(error_code);
+
+      error_index++;
+      if (error_index >= cur_error_count) {
+        error_index = 0;
+      }
 
+      poll_error_timer++;
+      if (poll_error_timer > DBG_CARD_UPDATE_ERR_INTERVAL) {
+        poll_error_timer = 0;
       }
+
     }
+  }
 
-    sleep(DBG_CARD_SHOW_ERR_INTERVAL);
-  } // while loop end
+  return DBG_CARD_SHOW_ERR_INTERVAL * 1000;
+}
 
-  pthread_exit(NULL);
+static int
+heartbeat_health_init(void) {
+  // set flag to notice BMC front-paneld heartbeat_health_handler is ready
+  kv_set("flag_front_hb", STR_VALUE_1, 0, 0);
+  return 0;
 }
 
-// Thread to handle heartbeat health
-static void *
-heartbeat_health_handler() {
+// Handle heartbeat health
+static int
+heartbeat_health_handler(void) {
   // 0: BMC remote hb  1: scc local hb  2: scc remote hb
-  uint8_t hb_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_REMOTE_BMC, HEARTBEAT_LOCAL_SCC, HEARTBEAT_REMOTE_SCC, HEARTBEAT_BIC};
-  uint8_t cur_hb_status_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL};
-  uint8_t pre_hb_status_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL};
-  int hb_timer[MAX_NUM_CHECK_HB_HEALTH] = {0, 0, 0, 0};
-  uint8_t hb_error_code_list[MAX_NUM_CHECK_HB_HEALTH] = {
+  static const uint8_t hb_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_REMOTE_BMC, HEARTBEAT_LOCAL_SCC, HEARTBEAT_REMOTE_SCC, HEARTBEAT_BIC};
+  static uint8_t pre_hb_status_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL};
+  // milliseconds without heartbeat
+  static int64_t hb_timer[MAX_NUM_CHECK_HB_HEALTH] = {0, 0, 0, 0};
+  static const uint8_t hb_error_code_list[MAX_NUM_CHECK_HB_HEALTH] = {
     ERR_CODE_BMC_REMOTE_HB_HEALTH, ERR_CODE_SCC_LOCAL_HB_HEALTH, ERR_CODE_SCC_REMOTE_HB_HEALTH, ERR_CODE_BIC_HB_HEALTH};
-  char* log_desc_list[MAX_NUM_CHECK_HB_HEALTH] = {"BMC remote", "SCC local", "SCC remote", "BIC"};
+  static const char* log_desc_list[MAX_NUM_CHECK_HB_HEALTH] = {"BMC remote", "SCC local", "SCC remote", "BIC"};
+  static int hb_health_last_state = HEARTBEAT_NORMAL;
+  static int64_t last_run_ms = 0;
+  uint8_t cur_hb_status_list[MAX_NUM_CHECK_HB_HEALTH] = {HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL, HEARTBEAT_NORMAL};
   uint8_t chassis_type = 0;
   char val[MAX_VALUE_LEN] = {0};
   int ret = 0, i = 0;
-  int hb_health_kv_state = HEARTBEAT_NORMAL, hb_health_last_state = HEARTBEAT_NORMAL;
-  
-  // set flag to notice BMC front-paneld heartbeat_health_handler is ready
-  kv_set("flag_front_hb", STR_VALUE_1, 0, 0);
+  int hb_health_kv_state = HEARTBEAT_NORMAL;
+  int64_t now_ms = monotonic_ms(), elapsed_ms = 0;
 
-  while(1) {
-    // Get kv value
-    memset(val, 0, sizeof(val));
-    ret = pal_get_key_value("heartbeat_health", val);
-    if (ret < 0) {
-      syslog(LOG_ERR, "%s(): fail to get key: heartbeat_health value", __func__);
-    }
-    hb_health_kv_state = atoi(val);
-  
-    ret = fbgc_common_get_chassis_type(&chassis_type);
-    if (ret < 0) {
-      syslog(LOG_WARNING, "%s(): failed to get chassis type", __func__);
+  // runs early on kv changes: count the time actually gone by
+  elapsed_ms = (last_run_ms == 0) ? (MONITOR_HB_HEALTH_INTERVAL * 1000) : (now_ms - last_run_ms);
+  last_run_ms = now_ms;
+
+  // Get kv value
+  ret = pal_get_key_value("heartbeat_health", val);
+  if (ret < 0) {
+    syslog(LOG_ERR, "%s(): fail to get key: heartbeat_health value", __func__);
+  }
+  hb_health_kv_state = atoi(val);
+
+  ret = fbgc_common_get_chassis_type(&chassis_type);
+  if (ret < 0) {
+    syslog(LOG_WARNING, "%s(): failed to get chassis type", __func__);
+  }
+
+  for (i = 0; i < MAX_NUM_CHECK_HB_HEALTH; i++) {
+    // Type 5 detect: BMC_RMT, SCC_LOC, BIC
+    // Type 7 detect: SCC_LOC, SCC_RMT, BIC
+    // Unknown type detect: SCC_LOC, BIC
+    if (((ret == 0) && (chassis_type == CHASSIS_TYPE5) && (hb_list[i] != HEARTBEAT_REMOTE_SCC))
+       || ((ret == 0) && (chassis_type == CHASSIS_TYPE7) && (hb_list[i] != HEARTBEAT_REMOTE_BMC))
+       || (hb_list[i] == HEARTBEAT_LOCAL_SCC)
+       || (hb_list[i] == HEARTBEAT_BIC)) {
+
+      // Get and check HB value
+      if (pal_is_heartbeat_ok(hb_list[i]) == true) {
+        hb_timer[i] = 0;
+      } else {
+        hb_timer[i] += elapsed_ms;
+      }
+
+      // Timeout detect: no response continuous 3 mins
+      if (hb_timer[i] > HEARTBEAT_TIMEOUT * 1000) {
+        hb_timer[i] = HEARTBEAT_TIMEOUT * 1000;
+        cur_hb_status_list[i] = HEARTBEAT_ABNORMAL;
+      } else {
+        cur_hb_status_list[i] = HEARTBEAT_NORMAL;
+      }
+
+      // Status chagne: set error code enable/disable and key value
+      if ((cur_hb_status_list[i] == HEARTBEAT_ABNORMAL) && (pre_hb_status_list[i] == HEARTBEAT_NORMAL)) {
+        syslog(LOG_CRIT, "%s heartbeat is abnormal", log_desc_list[i]);
+
+        pal_set_error_code(hb_error_code_list[i], ERR_CODE_ENABLE);
+
+        memset(val, 0, sizeof(val));
+        snprintf(val, sizeof(val), "%d", HEARTBEAT_ABNORMAL);
+        ret = pal_set_key_value("heartbeat_health", val);
+        if (ret < 0) {
+          syslog(LOG_ERR, "%s(): %s abnormal and fail to set key: heartbeat_health value: %s", __func__, log_desc_list[i], val);
+        }
+
+      } else if ((cur_hb_status_list[i] == HEARTBEAT_NORMAL) && (pre_hb_status_list[i] == HEARTBEAT_ABNORMAL)) {
+        pal_set_error_code(hb_error_code_list[i], ERR_CODE_DISABLE);
+      }
+
+      // Update heartbeat status
+      pre_hb_status_list[i] = cur_hb_status_list[i];
     }
+  } // for loop end
 
+  // if log-util clear all
+  // clean heartbeat timer and will regenerate assert
+  if ((hb_health_kv_state != hb_health_last_state) && (hb_health_kv_state == HEARTBEAT_NORMAL)) {
     for (i = 0; i < MAX_NUM_CHECK_HB_HEALTH; i++) {
-      // Type 5 detect: BMC_RMT, SCC_LOC, BIC
-      // Type 7 detect: SCC_LOC, SCC_RMT, BIC
-      // Unknown type detect: SCC_LOC, BIC
-      if (((ret == 0) && (chassis_type == CHASSIS_TYPE5) && (hb_list[i] != HEARTBEAT_REMOTE_SCC))
-         || ((ret == 0) && (chassis_type == CHASSIS_TYPE7) && (hb_list[i] != HEARTBEAT_REMOTE_BMC))
-         || (hb_list[i] == HEARTBEAT_LOCAL_SCC)
-         || (hb_list[i] == HEARTBEAT_BIC)) {
-         
-        // Get and check HB value
-        if (pal_is_heartbeat_ok(hb_list[i]) == true) {
-          hb_timer[i] = 0;
-        } else {
-          hb_timer[i] += MONITOR_HB_HEALTH_INTERVAL;
-        }
-        
-        // Timeout detect: no response continuous 3 mins
-        if (hb_timer[i] > HEARTBEAT_TIMEOUT) {
-          hb_timer[i] = HEARTBEAT_TIMEOUT;
-          cur_hb_status_list[i] = HEARTBEAT_ABNORMAL;
-        } else {
-          cur_hb_status_list[i] = HEARTBEAT_NORMAL;
-        }
-        
-        // Status chagne: set error code enable/disable and key value 
-        if ((cur_hb_status_list[i] == HEARTBEAT_ABNORMAL) && (pre_hb_status_list[i] == HEARTBEAT_NORMAL)) {
-          syslog(LOG_CRIT, "%s heartbeat is abnormal", log_desc_list[i]);
-          
-          pal_set_error_code(hb_error_code_list[i], ERR_CODE_ENABLE);
-          
-          memset(val, 0, sizeof(val));
-          snprintf(val, sizeof(val), "%d", HEARTBEAT_ABNORMAL);
-          ret = pal_set_key_value("heartbeat_health", val);
-          if (ret < 0) {
-            syslog(LOG_ERR, "%s(): %s abnormal and fail to set key: heartbeat_health value: %s", __func__, log_desc_list[i], val);
-          }
-          
-        } else if ((cur_hb_status_list[i] == HEARTBEAT_NORMAL) && (pre_hb_status_list[i] == HEARTBEAT_ABNORMAL)) {
-          pal_set_error_code(hb_error_code_list[i], ERR_CODE_DISABLE);
+      hb_timer[i] = 0;
+    }
+  }
+  hb_health_last_state = hb_health_kv_state;
+
+  return MONITOR_HB_HEALTH_INTERVAL * 1000;
+}
+
+static int
+e1s_led_sync_init(void) {
+  uint8_t chassis_type = 0;
+
+  if ((fbgc_common_get_chassis_type(&chassis_type) < 0) || (chassis_type != CHASSIS_TYPE5)) {
+    return -1;
+  }
+
+  // set default
+  kv_set("e1s0_led_status", "off", 0, 0);
+  kv_set("e1s1_led_status", "off", 0, 0);
+  return 0;
+}
+
+static int
+e1s_led_sync_handler(void) {
+  static const char *key_list[E1S_IOCM_SLOT_NUM] = {"e1s0_led_status", "e1s1_led_status"};
+  static const e1s_led_id id_list[E1S_IOCM_SLOT_NUM] = {ID_E1S0_LED, ID_E1S1_LED};
+  static enum LED_HIGH_ACTIVE blinking_list[E1S_IOCM_SLOT_NUM] = {LED_ON, LED_ON};
+  char val[MAX_VALUE_LEN] = {0};
+  int ret = 0, i = 0;
+
+  for (i = 0; i < E1S_IOCM_SLOT_NUM; i++) {
+    if (kv_get(key_list[i], val, NULL, 0) == 0) {
+      if (strcmp(val, "on") == 0) {
+        ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], LED_ON);
+
+      } else if (strcmp(val, "off") == 0) {
+        ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], LED_OFF);
+
+      } else if (strcmp(val, "blinking") == 0) {
+        ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], blinking_list[i]);
+
+        if (blinking_list[i] == LED_ON) {
+          blinking_list[i] = LED_OFF;
+        } else if (blinking_list[i] == LED_OFF) {
+          blinking_list[i] = LED_ON;
         }
-        
-        // Update heartbeat status
-        pre_hb_status_list[i] = cur_hb_status_list[i];
       }
-    } // for loop end
-    
-    // if log-util clear all
-    // clean heartbeat timer and will regenerate assert
-    if ((hb_health_kv_state != hb_health_last_state) && (hb_health_kv_state == HEARTBEAT_NORMAL)) {
-      for (i = 0; i < MAX_NUM_CHECK_HB_HEALTH; i++) {
-        hb_timer[i] = 0;
+
+      if (ret < 0) {
+        syslog(LOG_ERR, "%s(): Failed to set E1.S%d LED status due to pal_set_e1s_led() failed", __func__, i);
       }
+
+    } else {
+      syslog(LOG_ERR, "%s(): Failed to get %s due to kv_get() failed", __func__, key_list[i]);
     }
-    hb_health_last_state = hb_health_kv_state;
-    
-    sleep(MONITOR_HB_HEALTH_INTERVAL);
-  } // while loop end
-  
-  return NULL;
+  } // for loop end
+
+  return SYNC_E1S_STATUS_LED_INTERVAL * 1000;
 }
 
-static void *
-e1s_led_sync_handler() {
-  char val[MAX_VALUE_LEN] = {0};
-  int ret = 0, i = 0;
-  char *key_list[E1S_IOCM_SLOT_NUM] = {"e1s0_led_status", "e1s1_led_status"};
-  e1s_led_id id_list[E1S_IOCM_SLOT_NUM] = {ID_E1S0_LED, ID_E1S1_LED};
-  enum LED_HIGH_ACTIVE blinking_list[E1S_IOCM_SLOT_NUM] = {LED_ON, LED_ON};
-  
-  // set default
-  kv_set(key_list[0], "off", 0, 0);
-  kv_set(key_list[1], "off", 0, 0);
-  
-  while(1) {
-    for (i = 0; i < E1S_IOCM_SLOT_NUM; i++) {
-      if (kv_get(key_list[i], val, NULL, 0) == 0) {
-        if (strcmp(val, "on") == 0) {
-          ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], LED_ON);
-          
-        } else if (strcmp(val, "off") == 0) {
-          ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], LED_OFF);
-          
-        } else if (strcmp(val, "blinking") == 0) {
-          ret = pal_set_e1s_led(FRU_E1S_IOCM, id_list[i], blinking_list[i]);
-          
-          if (blinking_list[i] == LED_ON) {
-            blinking_list[i] = LED_OFF;
-          } else if (blinking_list[i] == LED_OFF) {
-            blinking_list[i] = LED_ON;
-          }
+static struct front_task front_tasks[MAX_NUM_TASKS] = {
+  [TASK_LED_SYNC] = {"led sync", led_sync_init, led_sync_handler},
+  [TASK_FRU_HEALTH] = {"fru health", fru_health_init, fru_health_handler},
+  [TASK_SYSTEM_STATUS_LED] = {"system status LED", system_status_led_init, system_status_led_handler},
+  [TASK_DBG_CARD_ERR_CODE] = {"debug card error code", dbg_card_show_error_code_init, dbg_card_show_error_code},
+  [TASK_HB_HEALTH] = {"heartbeat health", heartbeat_health_init, heartbeat_health_handler},
+  [TASK_E1S_LED_SYNC] = {"E1.S status LED", e1s_led_sync_init, e1s_led_sync_handler},
+};
+
+// Debug card presence and UART selection GPIOs, with edges on both ways
+static gpio_group_t *
+dbg_card_gpio_open(void) {
+  const char *shadows[MAX_NUM_DBG_CARD_GPIOS];
+  gpio_group_t *group = NULL;
+  int i = 0;
+
+  for (i = 0; i < MAX_NUM_DBG_CARD_GPIOS; i++) {
+    shadows[i] = fbgc_get_gpio_name(dbg_card_gpio_list[i]);
+  }
+
+  group = gpio_group_open(shadows, MAX_NUM_DBG_CARD_GPIOS);
+  if (group == NULL) {
+    return NULL;
+  }
+  if (gpio_group_set_edge(group, GPIO_EDGE_BOTH) < 0) {
+    gpio_group_close(group);
+    return NULL;
+  }
+  return group;
+}
+
+static int
+epoll_add_fd(int epoll_fd, int fd) {
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Run the due tasks, sleeping until the next one is due, a watched kv
+// key changes or a debug card GPIO has an edge
+static int
+run_front_tasks(void) {
+  struct epoll_event events[3];
+  struct itimerspec its;
+  kv_watch_t *persist_watch = NULL, *fpc_watch = NULL, *e1s_watch = NULL;
+  gpio_group_t *dbg_gpios = NULL;
+  unsigned int gpio_events = 0, tasks = 0;
+  int epoll_fd = -1, timer_fd = -1, gpio_fd = -1;
+  int ret = -1, i = 0, n = 0, delay = 0;
+  int64_t now_ms = 0, next_ms = 0;
+  uint64_t count = 0;
+
+  wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if ((wake_fd < 0) || (timer_fd < 0) || (epoll_fd < 0) ||
+      (epoll_add_fd(epoll_fd, wake_fd) < 0) || (epoll_add_fd(epoll_fd, timer_fd) < 0)) {
+    syslog(LOG_ERR, "%s(): failed to set up the event loop: %s", __func__, strerror(errno));
+    goto exit;
+  }
+
+  now_ms = monotonic_ms();
+  for (i = 0; i < MAX_NUM_TASKS; i++) {
+    front_tasks[i].enabled = (front_tasks[i].init == NULL) || (front_tasks[i].init() == 0);
+    front_tasks[i].next_ms = now_ms;
+  }
+
+  // Without the watches the tasks still run at their intervals
+  persist_watch = kv_watch("", persist_key_changed, NULL, KV_FPERSIST);
+  fpc_watch = kv_watch("flag_fpc_status", temp_key_changed,
+                       (void *)(uintptr_t)TASK_BIT(TASK_SYSTEM_STATUS_LED), 0);
+  if (front_tasks[TASK_E1S_LED_SYNC].enabled) {
+    e1s_watch = kv_watch("e1s", temp_key_changed,
+                         (void *)(uintptr_t)TASK_BIT(TASK_E1S_LED_SYNC), 0);
+  }
+  if ((persist_watch == NULL) || (fpc_watch == NULL) ||
+      (front_tasks[TASK_E1S_LED_SYNC].enabled && (e1s_watch == NULL))) {
+    syslog(LOG_WARNING, "%s(): failed to watch kv changes, polling them", __func__);
+  }
+
+  dbg_gpios = dbg_card_gpio_open();
+  if (dbg_gpios != NULL) {
+    gpio_fd = gpio_group_get_poll_fd(dbg_gpios);
+  }
+  if ((gpio_fd < 0) || (epoll_add_fd(epoll_fd, gpio_fd) < 0)) {
+    syslog(LOG_WARNING, "%s(): failed to watch debug card GPIOs, polling them", __func__);
+    gpio_fd = -1;
+  }
+
+  while (1) {
+    now_ms = monotonic_ms();
+    next_ms = INT64_MAX;
+    for (i = 0; i < MAX_NUM_TASKS; i++) {
+      if (!front_tasks[i].enabled) {
+        continue;
+      }
+      if (front_tasks[i].next_ms <= now_ms) {
+        delay = front_tasks[i].run();
+        now_ms = monotonic_ms();
+        front_tasks[i].next_ms = now_ms + delay;
+      }
+      if (front_tasks[i].next_ms < next_ms) {
+        next_ms = front_tasks[i].next_ms;
+      }
+    }
+
+    // Sleep until the earliest task is due (nsec + 1: 0 disarms)
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = next_ms / 1000;
+    its.it_value.tv_nsec = (next_ms % 1000) * 1000000 + 1;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+      syslog(LOG_ERR, "%s(): failed to arm the timer: %s", __func__, strerror(errno));
+      goto exit;
+    }
+
+    n = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      syslog(LOG_ERR, "%s(): epoll_wait failed: %s", __func__, strerror(errno));
+      goto exit;
+    }
+
+    tasks = 0;
+    for (i = 0; i < n; i++) {
+      if (events[i].data.fd == timer_fd) {
+        if (read(timer_fd, &count, sizeof(count)) < 0) {
+          continue;
         }
-        
-        if (ret < 0) {
-          syslog(LOG_ERR, "%s(): Failed to set E1.S%d LED status due to pal_set_e1s_led() failed", __func__, i);
+      } else if (events[i].data.fd == wake_fd) {
+        if (read(wake_fd, &count, sizeof(count)) < 0) {
+          continue;
         }
-        
-      } else {
-        syslog(LOG_ERR, "%s(): Failed to get %s due to kv_get() failed", __func__, key_list[i]);
+        tasks |= __atomic_exchange_n(&wake_tasks_pending, 0, __ATOMIC_SEQ_CST);
+      } else if (events[i].data.fd == gpio_fd) {
+        if ((gpio_group_wait_edges(dbg_gpios, 0, &gpio_events) == 0) && (gpio_events != 0)) {
+          dbg_card_changed = true;
+          tasks |= TASK_BIT(TASK_DBG_CARD_ERR_CODE);
+        }
+      }
+    }
+
+    now_ms = monotonic_ms();
+    for (i = 0; i < MAX_NUM_TASKS; i++) {
+      if (tasks & TASK_BIT(i)) {
+        front_tasks[i].next_ms = now_ms;
       }
-    } // for loop end
-    
-    sleep(SYNC_E1S_STATUS_LED_INTERVAL);
-  } // while loop end
-  
-  pthread_exit(NULL);
+    }
+  }
+
+exit:
+  if (persist_watch != NULL) {
+    kv_unwatch(persist_watch);
+  }
+  if (fpc_watch != NULL) {
+    kv_unwatch(fpc_watch);
+  }
+  if (e1s_watch != NULL) {
+    kv_unwatch(e1s_watch);
+  }
+  if (dbg_gpios != NULL) {
+    gpio_group_close(dbg_gpios);
+  }
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+  }
+  if (timer_fd >= 0) {
+    close(timer_fd);
+  }
+  if (wake_fd >= 0) {
+    close(wake_fd);
+  }
+  return ret;
 }
 
 int
 main (int argc, char * const argv[]) {
-  pthread_t tid_sync_led = 0;
-  pthread_t tid_monitor_fru_health = 0;
-  pthread_t tid_sync_system_status_led = 0;
-  pthread_t tid_dbg_card_error_code = 0;
-  pthread_t tid_monitor_heartbeat_health = 0;
-  pthread_t tid_sync_e1s_led = 0;
   int ret = 0, pid_file = 0;
-  int ret_sync_led = 0, ret_monitor_fru = 0, ret_sync_system_status_led = 0;
-  int ret_dbg_card_error_code = 0;
-  int ret_heartbeat = 0;
-  int ret_sync_e1s_led = 0;
-  uint8_t chassis_type = 0;
 
   pid_file = open("/var/run/front-paneld.pid", O_CREAT | O_RDWR, 0666);
   if (pid_file < 0) {
@@ -453,59 +727,7 @@ main (int argc, char * const argv[]) {
     openlog("front-paneld", LOG_CONS, LOG_DAEMON);
   }
 
-  if (pthread_create(&tid_sync_led, NULL, led_sync_handler, NULL) < 0) {
-    syslog(LOG_WARNING, "pthread_create for led sync error\n");
-    ret_sync_led = -1;
-  }
-
-  if (pthread_create(&tid_monitor_fru_health, NULL, fru_health_handler, NULL) < 0) {
-    syslog(LOG_WARNING, "fail to create thread to monitor fru health\n");
-    ret_monitor_fru = -1;
-  }
-
-  if (pthread_create(&tid_sync_system_status_led, NULL, system_status_led_handler, NULL) < 0) {
-    syslog(LOG_WARNING, "fail to create thread to sync system status LED\n");
-    ret_sync_system_status_led = -1;
-  }
-  
-  if (pthread_create(&tid_dbg_card_error_code, NULL, dbg_card_show_error_code, NULL) < 0) {
-    syslog(LOG_WARNING, "fail to creat thread for show error code on debug card\n");
-    ret_dbg_card_error_code = -1;
-  }
-
-  if (pthread_create(&tid_monitor_heartbeat_health, NULL, heartbeat_health_handler, NULL) < 0) {
-    syslog(LOG_WARNING, "fail to create thread to monitor heartbeat health\n");
-    ret_heartbeat = -1;
-  }
-  
-  ret = fbgc_common_get_chassis_type(&chassis_type);
-  if ((ret == 0) && (chassis_type == CHASSIS_TYPE5)) {
-    if (pthread_create(&tid_sync_e1s_led, NULL, e1s_led_sync_handler, NULL) < 0) {
-      syslog(LOG_WARNING, "fail to create thread to sync E1.S status LED\n");
-      ret_sync_e1s_led = -1;
-    }
-  } else {
-    ret_sync_e1s_led = -1;
-  }
-    
-  if (ret_sync_led == 0) {
-    pthread_join(tid_sync_led, NULL);
-  }
-  if (ret_monitor_fru == 0) {
-    pthread_join(tid_monitor_fru_health, NULL);
-  }
-  if (ret_sync_system_status_led == 0) {
-    pthread_join(tid_sync_system_status_led, NULL);
-  }
-  if (ret_dbg_card_error_code == 0) {
-    pthread_join(tid_dbg_card_error_code, NULL);
-  }
-  if (ret_heartbeat == 0) {
-    pthread_join(tid_monitor_heartbeat_health, NULL);
-  }
-  if (ret_sync_e1s_led == 0) {
-    pthread_join(tid_sync_e1s_led, NULL);
-  }
+  ret = run_front_tasks();
 
 err:
   flock(pid_file, LOCK_UN);
@@ -35,9 +35,6 @@ static int set_e1s_sensor_name(char *sensor_name, char side);
 static void apply_inlet_correction(float *value, inlet_corr_t *ict, size_t ict_cnt);
 static int read_dpb_vol_wrapper(uint8_t id, float *value);
 
-static bool is_dpb_sensor_cached = false;
-static bool is_scc_sensor_cached = false;
-
 static sensor_info_t g_sinfo[MAX_SENSOR_NUM + 1] = {0};
 static bool is_sdr_init[FRU_CNT] = {false};
 
@@ -1676,41 +1673,33 @@ sensor_num_to_index(uint8_t *sensor_list, int list_cnt, uint8_t sensor_num) {
   return -1;
 }
 
-static int
-expander_sensor_check(uint8_t fru, uint8_t sensor_num) {
-  int ret = 0, remain = 0, sensor_cnt = 0, index = 0;
-  uint8_t *sensor_list = NULL;
-  int read_cnt = 1; // default is single sensor reading
-  int timestamp = 0, current_time = 0;
-  char key[MAX_KEY_LEN] = {0};
-  char cvalue[MAX_VALUE_LEN] = {0};
-  char tstr[MAX_VALUE_LEN] = {0};
-  struct timespec ts = {0};
-
+static const char *
+exp_sensor_snapshot_key(uint8_t fru) {
   switch(fru) {
     case FRU_DPB:
-      snprintf(key, sizeof(key), "dpb_sensor_timestamp");
-      break;
+      return DPB_SENSOR_SNAPSHOT_KEY;
     case FRU_SCC:
-      snprintf(key, sizeof(key), "scc_sensor_timestamp");
-      break;
+      return SCC_SENSOR_SNAPSHOT_KEY;
     default:
-      syslog(LOG_ERR, "%s() Invalid FRU%u \n", __func__, fru);
-      return -1;
+      return NULL;
   }
+}
 
-  // Get sensor timestamp
-  ret = pal_get_cached_value(key, cvalue);
-  if (ret < 0) {
-    syslog(LOG_WARNING, "%s() Failed to get FRU%u sensor timestamp", __func__, fru);
-    return ret;
-  }
-  timestamp = atoi(cvalue);
+// Bulk read of all the sensors of the FRU from expander, run by exp-cached
+// once per EXP_SENSOR_WAIT_TIME. The snapshot key ("<version> <timestamp>")
+// is published only after every sensor of the FRU was cached.
+int
+pal_exp_sensor_poll(uint8_t fru, uint32_t version) {
+  int ret = 0, remain = 0, sensor_cnt = 0, read_cnt = 0, index = 0;
+  uint8_t *sensor_list = NULL;
+  const char *key = exp_sensor_snapshot_key(fru);
+  char str[MAX_VALUE_LEN] = {0};
+  struct timespec ts = {0};
 
-  // Get current timestamp
-  clock_gettime(CLOCK_REALTIME, &ts);
-  snprintf(tstr, sizeof(tstr), "%ld", ts.tv_sec);
-  current_time = atoi(tstr);
+  if (key == NULL) {
+    syslog(LOG_ERR, "%s() Invalid FRU%u \n", __func__, fru);
+    return -1;
+  }
 
   ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
   if (ret < 0) {
@@ -1718,67 +1707,78 @@ expander_sensor_check(uint8_t fru, uint8_t sensor_num) {
     return ret;
   }
 
-  index = sensor_num_to_index(sensor_list, sensor_cnt, sensor_num);
-  if (index < 0) {
-    syslog(LOG_ERR, "%s() index failed \n", __func__);
+  remain = sensor_cnt;
+  while (remain > 0) {
+    read_cnt = (remain > MAX_EXP_IPMB_SENSOR_COUNT) ? MAX_EXP_IPMB_SENSOR_COUNT : remain;
+    ret = exp_read_sensor_wrapper(fru, sensor_list, read_cnt, index);
+    if (ret < 0) {
+      syslog(LOG_ERR, "%s() wrapper ret%d \n", __func__, ret);
+      return ret;
+    }
+    remain -= read_cnt;
+    index += read_cnt;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  snprintf(str, sizeof(str), "%u %ld", version, ts.tv_sec);
+  ret = pal_set_cached_value((char *)key, str);
+  if (ret < 0) {
+    syslog(LOG_WARNING, "%s() Failed to set FRU%u sensor snapshot", __func__, fru);
+  }
+  return ret;
+}
+
+// The sensors of DPB/SCC are cached by exp-cached, readers only check that
+// its snapshot is current.
+static int
+expander_sensor_check(uint8_t fru, uint8_t sensor_num) {
+  int ret = 0, sensor_cnt = 0, index = 0;
+  uint8_t *sensor_list = NULL;
+  const char *key = exp_sensor_snapshot_key(fru);
+  char cvalue[MAX_VALUE_LEN] = {0};
+  unsigned int version = 0;
+  long timestamp = 0;
+  struct timespec ts = {0};
+
+  if (key == NULL) {
+    syslog(LOG_ERR, "%s() Invalid FRU%u \n", __func__, fru);
     return -1;
   }
 
   // Read DPB_HSC_PWR from expander directly
   if ((fru == FRU_DPB) && (sensor_num == DPB_HSC_PWR)) {
-    ret = exp_read_sensor_wrapper(fru, sensor_list, read_cnt, index);
+    ret = pal_get_fru_sensor_list(fru, &sensor_list, &sensor_cnt);
+    if (ret < 0) {
+      syslog(LOG_ERR, "%s() get list failed \n", __func__);
+      return ret;
+    }
+
+    index = sensor_num_to_index(sensor_list, sensor_cnt, sensor_num);
+    if (index < 0) {
+      syslog(LOG_ERR, "%s() index failed \n", __func__);
+      return -1;
+    }
+
+    ret = exp_read_sensor_wrapper(fru, sensor_list, 1, index);
     if (ret < 0) {
       syslog(LOG_ERR, "%s() wrapper ret%d \n", __func__, ret);
     }
     return ret;
   }
 
-  if (abs(current_time - timestamp) > EXP_SENSOR_WAIT_TIME) {
-    if ( (fru == FRU_DPB && sensor_num == dpb_sensor_list[0]) || (fru == FRU_SCC && sensor_num == scc_sensor_list[0]) ) {
-      remain = sensor_cnt;
-
-      // read all sensors
-      while (remain > 0) {
-        read_cnt = (remain > MAX_EXP_IPMB_SENSOR_COUNT) ? MAX_EXP_IPMB_SENSOR_COUNT : remain;
-        ret = exp_read_sensor_wrapper(fru, sensor_list, read_cnt, index);
-        if (ret < 0) {
-          syslog(LOG_ERR, "%s() wrapper ret%d \n", __func__, ret);
-          break;
-        }
-        remain -= read_cnt;
-        index += read_cnt;
-      };
-
-      // Update timestamp only after all sensors updated
-      memset(tstr, 0, sizeof(tstr));
-      clock_gettime(CLOCK_REALTIME, &ts);
-      snprintf(tstr, sizeof(tstr), "%ld", ts.tv_sec);
-
-      ret = pal_set_cached_value(key, tstr);
-      if (ret < 0) {
-        syslog(LOG_WARNING, "%s() Failed to set FRU%u sensor timestamp", __func__, fru);
-        return ret;
-      }
+  // Version 0 is not published yet
+  if ((pal_get_cached_value((char *)key, cvalue) < 0) ||
+      (sscanf(cvalue, "%u %ld", &version, &timestamp) != 2) || (version == 0)) {
+    return ERR_SENSOR_NA;
+  }
 
-      if (fru == FRU_DPB) {
-        is_dpb_sensor_cached = true;
-      } else {
-        is_scc_sensor_cached = true;
-      }
-    }
-    else {
-      if ( (fru == FRU_DPB && is_dpb_sensor_cached == true) || (fru == FRU_SCC && is_scc_sensor_cached == true) ) {
-        return 0;
-      }
-      // read single sensor
-      ret = exp_read_sensor_wrapper(fru, sensor_list, read_cnt, index);
-      if (ret < 0) {
-        syslog(LOG_ERR, "%s() wrapper ret%d \n", __func__, ret);
-      }
-    }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  if ((ts.tv_sec - timestamp) > EXP_SENSOR_SNAPSHOT_STALE) {
+    syslog(LOG_WARNING, "%s() FRU%u sensor snapshot %u is stale", __func__, fru, version);
+    return ERR_SENSOR_NA;
   }
 
-  return ret;
+  return 0;
 }
 
 static int
@@ -13,6 +13,11 @@
 #define MAX_EXP_IPMB_THRESH_COUNT    20
 #define MAX_EXP_IPMB_SENSOR_COUNT    40
 #define EXP_SENSOR_WAIT_TIME         5      // 5 seconds
+// exp-cached polls every EXP_SENSOR_WAIT_TIME, a snapshot older than this
+// means it is not polling anymore.
+#define EXP_SENSOR_SNAPSHOT_STALE    (EXP_SENSOR_WAIT_TIME * 3)
+#define DPB_SENSOR_SNAPSHOT_KEY      "dpb_sensor_snapshot"
+#define SCC_SENSOR_SNAPSHOT_KEY      "scc_sensor_snapshot"
 
 #define MAX_GET_RPM_RETRY            15
 #define MAX_NIC_TEMP_RETRY           5      // 10 seconds
@@ -453,5 +458,6 @@ int get_current_dir(const char *device, char *dir_name);
 int pal_sensor_monitor_initial(void);
 bool is_e1s_iocm_i2c_enabled(uint8_t id);
 int pal_exp_sensor_threshold_init(uint8_t fru);
+int pal_exp_sensor_poll(uint8_t fru, uint32_t version);
 
 #endif
@@ -50,6 +50,7 @@
 #include <dirent.h>
 #include <assert.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <linux/limits.h>
 #include <linux/version.h>
 #include <facebook/wedge_eeprom.h>
@@ -59,6 +60,8 @@
 #include <openbmc/misc-utils.h>
 #include <openbmc/obmc-i2c.h>
 
+#include "fan_pid.h"
+
 #ifndef BITS_PER_BYTE
 #define BITS_PER_BYTE 8
 #endif
@@ -69,6 +72,19 @@
 
 #define HWMON_SYSFS_DIR "/sys/class/hwmon"
 
+/*
+ * The control loop reads the temperatures and sets the fans every
+ * control interval (-i), the fan speeds are checked every
+ * FAN_CHECK_INTERVAL_MS, once they had that long to settle.
+ */
+#define CONTROL_INTERVAL_MS 5000
+#define CONTROL_INTERVAL_MIN_MS 1000
+#define FAN_CHECK_INTERVAL_MS 5000
+/* Fan checks are not delayed longer by speed changes. */
+#define FAN_CHECK_MAX_DELAY_MS 30000
+
+#define SYSFS_FD_CACHE_SIZE 32
+
 #define MAX_FANS 4
 
 /* Sensor definitions */
@@ -365,13 +381,19 @@ void usage() {
   fprintf(stderr,
           "fand [-v] [-l <low-pct>] [-m <medium-pct>] "
           "[-h <high-pct>]\n"
-          "\t[-b <temp-bottom>] [-t <temp-top>] [-r <report-temp>]\n\n"
+          "\t[-b <temp-bottom>] [-t <temp-top>] [-r <report-temp>] "
+          "[-i <interval-ms>]\n"
+          "\t[-p <setpoint>[,<kp>,<ki>,<kd>,<feed-forward>]]\n\n"
           "\tlow-pct defaults to %d%% fan\n"
           "\tmedium-pct defaults to %d%% fan\n"
           "\thigh-pct defaults to %d%% fan\n"
           "\ttemp-bottom defaults to %dC\n"
           "\ttemp-top defaults to %dC\n"
-          "\treport-temp defaults to every %d measurements\n\n"
+          "\treport-temp defaults to every %d measurements\n"
+          "\tinterval-ms defaults to %d ms (at least %d ms)\n"
+          "\t-p controls the fans by PID to the max temp setpoint,\n"
+          "\t   instead of the low/medium/high steps (defaults %.2f, %.2f, "
+          "%.2f, %d%%..%d%%)\n\n"
           "fand compensates for uServer temperature reading %d degrees low\n"
           "kill with SIGUSR1 to stop watchdog\n",
           fan_low,
@@ -380,6 +402,13 @@ void usage() {
           EXTERNAL_TEMPS(temp_bottom),
           EXTERNAL_TEMPS(temp_top),
           report_temp,
+          CONTROL_INTERVAL_MS,
+          CONTROL_INTERVAL_MIN_MS,
+          FAN_PID_KP,
+          FAN_PID_KI,
+          FAN_PID_KD,
+          fan_low,
+          fan_high,
           EXTERNAL_TEMPS(USERVER_TEMP_FUDGE));
   exit(1);
 }
@@ -422,27 +451,88 @@ static int fan_controller_init_41(struct fan_controller *controller)
 }
 
 /*
- * Read an integer from the beginning of the file.
- * Return 0 for success, or errno on failures.
+ * sysfs attributes stay open once used: they are read again with pread()
+ * at offset 0, which makes the kernel generate the value again.
  */
-static int device_read_integer(const char *pathname, int *value)
+struct sysfs_fd {
+  char path[PATH_MAX];
+  int flags;
+  int fd;
+};
+
+static struct sysfs_fd sysfs_fds[SYSFS_FD_CACHE_SIZE];
+static int sysfs_fds_used;
+static int sysfs_fds_next; /* evicted next once all are used */
+
+static struct sysfs_fd *sysfs_fd_get(const char *path, int flags)
 {
-  FILE *fp;
-  int rc, saved_errno;
+  struct sysfs_fd *entry;
+  int i, fd;
+
+  for (i = 0; i < sysfs_fds_used; i++) {
+    entry = &sysfs_fds[i];
+    if (entry->fd >= 0 && entry->flags == flags &&
+        !strcmp(entry->path, path))
+      return entry;
+  }
 
-  fp = fopen(pathname, "r");
-  if (fp == NULL) {
-    return errno;
+  fd = open(path, flags | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (sysfs_fds_used < SYSFS_FD_CACHE_SIZE) {
+    entry = &sysfs_fds[sysfs_fds_used++];
+  } else {
+    entry = &sysfs_fds[sysfs_fds_next];
+    sysfs_fds_next = (sysfs_fds_next + 1) % SYSFS_FD_CACHE_SIZE;
+    close(entry->fd);
   }
+  snprintf(entry->path, sizeof(entry->path), "%s", path);
+  entry->flags = flags;
+  entry->fd = fd;
+  return entry;
+}
 
-  rc = fscanf(fp, "%d", value);
-  if (rc != 1) {
-    saved_errno = errno;
-    fclose(fp);  /* ignore errors */
-    return saved_errno;
+/* Close a stale fd (e.g. of a removed device), it is opened again next. */
+static void sysfs_fd_drop(struct sysfs_fd *entry)
+{
+  int err = errno;
+
+  close(entry->fd);
+  entry->fd = -1;
+  entry->path[0] = '\0';
+  errno = err;
+}
+
+/*
+ * Read an integer from the beginning of the file.
+ * Return 0 for success, or errno on failures.
+ */
+static int device_read_integer(const char *pathname, int *value)
+{
+  struct sysfs_fd *entry;
+  char buf[64];
+  char *end;
+  ssize_t n = -1;
+  long val;
+  int tries;
+
+  for (tries = 0; tries < 2 && n < 0; tries++) {
+    entry = sysfs_fd_get(pathname, O_RDONLY);
+    if (entry == NULL)
+      return errno;
+    n = pread(entry->fd, buf, sizeof(buf) - 1, 0);
+    if (n < 0)
+      sysfs_fd_drop(entry);
   }
+  if (n < 0)
+    return errno;
+  buf[n] = '\0';
 
-  fclose(fp);
+  errno = 0;
+  val = strtol(buf, &end, 10);
+  if (end == buf)
+    return errno ? errno : EINVAL;
+  *value = (int)val;
   return 0;
 }
 
@@ -451,25 +541,21 @@ static int device_read_integer(const char *pathname, int *value)
  * Return 0 for success, or errno on failures.
  */
 int device_write_integer(const char *pathname, int value) {
-  FILE *fp;
-  int rc, saved_errno;
+  struct sysfs_fd *entry;
   char data[64];
-
-  fp = fopen(pathname, "w");
-  if (!fp) {
-    return errno;
+  ssize_t n = -1;
+  int len, tries;
+
+  len = snprintf(data, sizeof(data), "%d", value);
+  for (tries = 0; tries < 2 && n < 0; tries++) {
+    entry = sysfs_fd_get(pathname, O_WRONLY);
+    if (entry == NULL)
+      return errno;
+    n = pwrite(entry->fd, data, len, 0);
+    if (n < 0)
+      sysfs_fd_drop(entry);
   }
-
-  snprintf(data, sizeof(data), "%d", value);
-  rc = fputs(data, fp);
-  if (rc < 0) {
-    saved_errno = errno;
-    fclose(fp); /* ignore errors */
-    return saved_errno;
-  }
-
-  fclose(fp);
-  return 0;
+  return n < 0 ? errno : 0;
 }
 
 static int file_read_line(const char *pathname, char *buf, size_t size)
@@ -1045,13 +1131,18 @@ error:
 
 int main(int argc, char **argv) {
   int fan_speed = fan_high;
-  int bad_reads = 0;
+  int bad_read_ms = 0;
   int fan_failure = 0;
   int fan_speed_changes = 0;
   int old_speed;
 
   int fan_bad[MAX_FANS];
   int fan;
+  int interval_ms = CONTROL_INTERVAL_MS;
+  int since_check_ms = 0;
+  int since_change_ms = 0;
+  struct fan_pid pid;
+  const char *pid_arg = NULL;
 
   unsigned log_count = 0; // How many times have we logged our temps?
   int opt;
@@ -1122,7 +1213,7 @@ int main(int argc, char **argv) {
     fan_speed = fan_high;
   }
 
-  while ((opt = getopt(argc, argv, "l:m:h:b:t:r:v")) != -1) {
+  while ((opt = getopt(argc, argv, "l:m:h:b:t:r:i:p:v")) != -1) {
     switch (opt) {
     case 'l':
       fan_low = atoi(optarg);
@@ -1142,6 +1233,14 @@ int main(int argc, char **argv) {
     case 'r':
       report_temp = atoi(optarg);
       break;
+    case 'i':
+      interval_ms = atoi(optarg);
+      if (interval_ms < CONTROL_INTERVAL_MIN_MS)
+        interval_ms = CONTROL_INTERVAL_MIN_MS;
+      break;
+    case 'p':
+      pid_arg = optarg;
+      break;
     case 'v':
       verbose = true;
       break;
@@ -1155,6 +1254,12 @@ int main(int argc, char **argv) {
     usage();
   }
 
+  /* The limits are known once -l/-h are parsed */
+  fan_pid_init(&pid, 0, fan_low, fan_high);
+  if (pid_arg != NULL && fan_pid_parse(&pid, pid_arg) != 0) {
+    usage();
+  }
+
   if (temp_bottom > temp_top) {
     fprintf(stderr,
             "Should temp-bottom (%d) be higher than "
@@ -1236,10 +1341,11 @@ int main(int argc, char **argv) {
     /* TODO(vineelak) : Add userver_temp too , in case we fail to read temp */
     if ((intake_temp == BAD_TEMP || exhaust_temp == BAD_TEMP ||
          switch_temp == BAD_TEMP)) {
-      bad_reads++;
+      /* Counted in time, the threshold is in default intervals */
+      bad_read_ms += interval_ms;
     }
 
-    if (bad_reads > BAD_READ_THRESHOLD) {
+    if (bad_read_ms > BAD_READ_THRESHOLD * CONTROL_INTERVAL_MS) {
       server_shutdown("Some sensors couldn't be read");
     }
 
@@ -1282,8 +1388,8 @@ int main(int argc, char **argv) {
     }
 
     /*
-     * Calculate change needed -- we should eventually
-     * do something more sophisticated, like PID.
+     * Calculate change needed: by PID to the setpoint with -p,
+     * otherwise by stepping between the low/medium/high speeds.
      *
      * We should use the intake temperature to adjust this
      * as well.
@@ -1298,28 +1404,36 @@ int main(int argc, char **argv) {
     }
 
     LOG_VERBOSE("checking/adjusting fan speed..");
-    /*
-     * If recovering from a fan problem, spin down fans gradually in case
-     * temperatures are still high. Gradual spin down also reduces wear on
-     * the fans.
-     */
-    if (fan_speed == fan_max) {
+    if (pid_arg != NULL) {
+      /* Fans forced to max by a failure spin down at the rate limit */
       if (fan_failure == 0) {
-        fan_speed = fan_high;
+        fan_speed = fan_pid_update(&pid, EXTERNAL_TEMPS((float)max_temp),
+                                   interval_ms / 1000.0f, fan_speed);
       }
-    } else if (fan_speed == fan_high) {
-      if (max_temp + COOLDOWN_SLOP < temp_top) {
-        fan_speed = fan_medium;
-      }
-    } else if (fan_speed == fan_medium) {
-      if (max_temp > temp_top) {
-        fan_speed = fan_high;
-      } else if (max_temp + COOLDOWN_SLOP < temp_bottom) {
-        fan_speed = fan_low;
-      }
-    } else {/* low */
-      if (max_temp > temp_bottom) {
-        fan_speed = fan_medium;
+    } else {
+      /*
+       * If recovering from a fan problem, spin down fans gradually in case
+       * temperatures are still high. Gradual spin down also reduces wear on
+       * the fans.
+       */
+      if (fan_speed == fan_max) {
+        if (fan_failure == 0) {
+          fan_speed = fan_high;
+        }
+      } else if (fan_speed == fan_high) {
+        if (max_temp + COOLDOWN_SLOP < temp_top) {
+          fan_speed = fan_medium;
+        }
+      } else if (fan_speed == fan_medium) {
+        if (max_temp > temp_top) {
+          fan_speed = fan_high;
+        } else if (max_temp + COOLDOWN_SLOP < temp_bottom) {
+          fan_speed = fan_low;
+        }
+      } else {/* low */
+        if (max_temp > temp_bottom) {
+          fan_speed = fan_medium;
+        }
       }
     }
 
@@ -1337,6 +1451,7 @@ int main(int argc, char **argv) {
       for (fan = 0; fan < total_fans; fan++) {
         write_fan_speed(fan + fan_offset, fan_speed);
       }
+      since_change_ms = 0;
     }
 
     /*
@@ -1348,7 +1463,17 @@ int main(int argc, char **argv) {
      * before measuring them.
      */
 
-    sleep(5);
+    usleep(interval_ms * 1000);
+    since_check_ms += interval_ms;
+    since_change_ms += interval_ms;
+    if (since_check_ms < FAN_CHECK_INTERVAL_MS ||
+        (since_change_ms < FAN_CHECK_INTERVAL_MS &&
+         since_check_ms < FAN_CHECK_MAX_DELAY_MS)) {
+      LOG_VERBOSE("kicking watchdog");
+      kick_watchdog();
+      continue;
+    }
+    since_check_ms = 0;
 
     /* Check fan RPMs */
 
@@ -1396,6 +1521,7 @@ int main(int argc, char **argv) {
       for (fan = 0; fan < total_fans; fan++) {
         write_fan_speed(fan + fan_offset, fan_speed);
       }
+      since_change_ms = 0;
 
       /*
        * On Wedge, we want to shut down everything if none of the fans